@@ -113,35 +113,118 @@
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
+#include <time.h>
 
 #include "netdissect.h"
+#include "netdissect-alloc.h"
 #include "addrtoname.h"
+#include "netdissect-state.h"
+#ifdef ASYNC_RESOLVER_SUPPORTED
+#include <pthread.h>
+#endif
 #include "addrtostr.h"
 #include "ethertype.h"
 #include "llc.h"
 #include "extract.h"
+#include "name-cache-file.h"
+#include "name-arena.h"
+#include "name-table.h"
 #include "oui.h"
+#include "prefix-trie.h"
+#include "strtoaddr.h"
 
 /*
  * hash tables for whatever-to-name translations
  *
- * ndo_error() called on strdup(3) failure with S_ERR_ND_MEM_ALLOC status
+ * The tables are nametables (see name-table.h), which take no memory
+ * until something's put in them and grow with what's seen, rather
+ * than fixed-size arrays that every thread has whatever the traffic.
+ *
+ * The names are kept in name arenas (see name-arena.h), and the tables
+ * hold their offsets; the names of all the tables other than the port
+ * and host name tables are in the per-thread "addr_names" arena, which
+ * is never emptied, so the names it hands out stay valid.
+ *
+ * ndo_error() called on allocation failure with S_ERR_ND_MEM_ALLOC status
  */
 
-#define HASHNAMESIZE 4096
+static ND_THREAD_LOCAL struct name_arena addr_names;
+
+#define ADDR_NAME(off)	name_arena_str(&addr_names, off)
+
+static uint32_t
+addr_name_add(netdissect_options *ndo, const char *name)
+{
+	return (name_arena_add(ndo, &addr_names, name, strlen(name)));
+}
 
 struct hnamemem {
+	struct nametable_node node;
 	uint32_t addr;
-	const char *name;
-	struct hnamemem *nxt;
+	uint32_t name;			/* offset in addr_names */
 };
 
-static struct hnamemem hnametable[HASHNAMESIZE];
-static struct hnamemem tporttable[HASHNAMESIZE];
-static struct hnamemem uporttable[HASHNAMESIZE];
-static struct hnamemem eprototable[HASHNAMESIZE];
-static struct hnamemem dnaddrtable[HASHNAMESIZE];
-static struct hnamemem ipxsaptable[HASHNAMESIZE];
+static ND_THREAD_LOCAL struct nametable dnaddrtable;
+static ND_THREAD_LOCAL struct nametable ipxsaptable;
+
+static struct hnamemem *
+lookup_hmem(const struct nametable *table, uint32_t addr)
+{
+	struct nametable_node *np;
+
+	for (np = nametable_first(table, addr); np != NULL; np = np->nt_nxt)
+		if (((struct hnamemem *)np)->addr == addr)
+			return ((struct hnamemem *)np);
+	return (NULL);
+}
+
+static void
+add_hmem(netdissect_options *ndo, struct nametable *table, uint32_t addr,
+	 uint32_t name)
+{
+	struct hnamemem *tp;
+
+	tp = (struct hnamemem *)calloc(1, sizeof(*tp));
+	if (tp == NULL)
+		(*ndo->ndo_error)(ndo, S_ERR_ND_MEM_ALLOC, "add_hmem: calloc");
+	tp->addr = addr;
+	tp->name = name;
+	nametable_insert(ndo, table, &tp->node, addr);
+}
+
+/*
+ * The Ethernet and IPX SAP tables are built by the first lookup that
+ * needs them, rather than by init_addrtoname(), as many runs never
+ * look anything up in them.
+ */
+#define TABLE_ETHER	0x01	/* enametable */
+#define TABLE_IPXSAP	0x02	/* ipxsaptable */
+
+static u_int tables_wanted;		/* set by init_addrtoname() */
+static ND_THREAD_LOCAL u_int tables_loaded;
+
+static void load_tables(netdissect_options *, u_int);
+
+#define NEED_TABLES(ndo, which) \
+	do { \
+		if ((tables_wanted & ~tables_loaded & (which)) != 0) \
+			load_tables(ndo, which); \
+	} while (0)
+
+/*
+ * TCP and UDP port names are indexed directly by port number; they're
+ * filled in by init_servarray() before any packets are printed and
+ * never change afterwards, so all threads share them, and the arena
+ * their names are in; with -n, they're never allocated.  Ports without
+ * a name are printed from a per-thread table of numbers, made as
+ * they're needed.
+ */
+#define NPORTS 65536
+
+static struct name_arena port_names;
+static uint32_t *tportnames;
+static uint32_t *uportnames;
+static ND_THREAD_LOCAL char (*portnumbers)[sizeof("00000")];
 
 #ifdef _WIN32
 /*
@@ -154,8 +237,8 @@ static struct hnamemem ipxsaptable[HASHNAMESIZE];
 static struct hostent *
 win32_gethostbyaddr(const char *addr, int len, int type)
 {
-	static struct hostent host;
-	static char hostbuf[NI_MAXHOST];
+	static ND_THREAD_LOCAL struct hostent host;
+	static ND_THREAD_LOCAL char hostbuf[NI_MAXHOST];
 	char hname[NI_MAXHOST];
 	struct sockaddr_in6 addr6;
 
@@ -183,46 +266,534 @@ win32_gethostbyaddr(const char *addr, int len, int type)
 #define gethostbyaddr win32_gethostbyaddr
 #endif /* _WIN32 */
 
-struct h6namemem {
-	nd_ipv6 addr;
-	char *name;
-	struct h6namemem *nxt;
+/*
+ * IPv4 and IPv6 host names are kept in bounded, set-associative caches:
+ * an address hashes to a set of NAMECACHE_WAYS entries and, if it isn't
+ * there, replaces the least recently used entry of the set.  Like the
+ * other tables, each thread has its own caches, so no locking is needed.
+ *
+ * Each cache has its own name arena.  A printer may still be holding
+ * the name of an entry that's replaced while printing the same packet
+ * (e.g. "src > dst"), so replaced names are left in the arena until
+ * it's mostly garbage; then the names still in use are copied to a new
+ * arena, and the old one's blocks go on the nd_malloc() list, to be
+ * freed by nd_free_all().
+ */
+#define NAMECACHE_WAYS		8
+#define NAMECACHE_DEFAULT_SIZE	65536
+
+struct ipnamemem {
+	uint64_t used;			/* namecache tick of last use, 0 if free */
+	time_t stamp;			/* when the name was looked up */
+	uint32_t name;			/* offset in the cache's arena */
+	u_char state;			/* NC_ values below */
+	union {
+		uint32_t a4;
+		nd_ipv6 a6;
+	} addr;
+};
+
+#define NC_DONE		0	/* name is final (possibly numeric) */
+#define NC_QUEUED	1	/* asynchronous lookup in progress */
+#define NC_RETRY	2	/* lookup couldn't be queued; try again */
+
+struct namecache {
+	struct ipnamemem *ent;		/* nsets * NAMECACHE_WAYS entries */
+	u_int nsets;			/* a power of 2 */
+	u_int maxsets;			/* set by --mem-limit, 0 if none */
+	uint64_t tick;
+	struct name_arena names;
+	size_t namebytes;		/* in the names of the entries */
 };
 
-static struct h6namemem h6nametable[HASHNAMESIZE];
+static ND_THREAD_LOCAL struct namecache ip4cache;
+static ND_THREAD_LOCAL struct namecache ip6cache;
+
+#define NAMECACHE_NAME(nc, p)	name_arena_str(&(nc)->names, (p)->name)
+#define NAMECACHE_NAME_SIZE(nc, p)	(strlen(NAMECACHE_NAME(nc, p)) + 1)
+
+static uint32_t
+namecache_mix(uint32_t h)
+{
+	h ^= h >> 16;
+	h *= 0x85ebca6bU;
+	h ^= h >> 13;
+	h *= 0xc2b2ae35U;
+	h ^= h >> 16;
+	return h;
+}
+
+/*
+ * Find the entry for the address "key" in "nc", or claim one for it.
+ * Return 1 if the entry holds a name that's still valid, 0 if the
+ * caller has to look the name up and call namecache_set().
+ */
+static int
+namecache_find(netdissect_options *ndo, struct namecache *nc,
+	       const void *key, size_t keylen, uint32_t hash,
+	       struct ipnamemem **pp)
+{
+	struct ipnamemem *set, *p, *victim;
+	u_int i;
+
+	if (nc->ent == NULL) {
+		u_int size, nsets;
+
+		size = ndo->ndo_name_cache_size != 0 ?
+		    ndo->ndo_name_cache_size : NAMECACHE_DEFAULT_SIZE;
+		for (nsets = 1; nsets < size / NAMECACHE_WAYS &&
+		    nsets < (1U << 24); nsets <<= 1)
+			;
+		if (nc->maxsets != 0 && nsets > nc->maxsets)
+			nsets = nc->maxsets;
+		nc->ent = (struct ipnamemem *)calloc(nsets * NAMECACHE_WAYS,
+		    sizeof(*nc->ent));
+		if (nc->ent == NULL)
+			(*ndo->ndo_error)(ndo, S_ERR_ND_MEM_ALLOC,
+					  "namecache_find: calloc");
+		nc->nsets = nsets;
+	}
+
+	set = &nc->ent[(namecache_mix(hash) & (nc->nsets - 1)) *
+	    NAMECACHE_WAYS];
+	victim = set;
+	for (i = 0; i < NAMECACHE_WAYS; i++) {
+		p = &set[i];
+		if (p->used == 0) {
+			victim = p;
+			break;
+		}
+		if (memcmp(&p->addr, key, keylen) == 0) {
+			p->used = ++nc->tick;
+			*pp = p;
+			if (ndo->ndo_name_cache_ttl == 0 ||
+			    time(NULL) - p->stamp <
+			    (time_t)ndo->ndo_name_cache_ttl) {
+				ndo->ndo_name_cache_hits++;
+				return 1;
+			}
+			ndo->ndo_name_cache_misses++;
+			return 0;
+		}
+		if (p->used < victim->used)
+			victim = p;
+	}
+	if (victim->name != NAME_ARENA_NONE) {
+		nc->namebytes -= NAMECACHE_NAME_SIZE(nc, victim);
+		victim->name = NAME_ARENA_NONE;
+	}
+	ndo->ndo_name_cache_misses++;
+	victim->used = ++nc->tick;
+	victim->state = NC_DONE;
+	memcpy(&victim->addr, key, keylen);
+	*pp = victim;
+	return 0;
+}
+
+/*
+ * Move the names of the entries of "nc" to a new arena, as most of
+ * what's in the old one are names that have been replaced.
+ */
+static void
+namecache_compact(netdissect_options *ndo, struct namecache *nc)
+{
+	struct name_arena old;
+	const char *name;
+	u_int i;
+
+	old = nc->names;
+	memset(&nc->names, 0, sizeof(nc->names));
+	for (i = 0; i < nc->nsets * NAMECACHE_WAYS; i++) {
+		if (nc->ent[i].name == NAME_ARENA_NONE)
+			continue;
+		name = name_arena_str(&old, nc->ent[i].name);
+		nc->ent[i].name = name_arena_add(ndo, &nc->names, name,
+		    strlen(name));
+	}
+	name_arena_retire(ndo, &old);
+}
+
+/*
+ * Give the entry "p" the name "name" (with the domain removed if -N
+ * was given) and return the copy kept in the cache.
+ */
+static const char *
+namecache_set(netdissect_options *ndo, struct namecache *nc,
+	      struct ipnamemem *p, const char *name, int hostname)
+{
+	const char *dotp;
+	size_t len;
+
+	len = strlen(name);
+	if (hostname && ndo->ndo_Nflag) {
+		/* Remove domain qualifications */
+		dotp = strchr(name, '.');
+		if (dotp)
+			len = dotp - name;
+	}
+	if (p->name != NAME_ARENA_NONE) {
+		nc->namebytes -= NAMECACHE_NAME_SIZE(nc, p);
+		p->name = NAME_ARENA_NONE;
+	}
+	if (nc->names.bytes > 2 * nc->namebytes + NAME_ARENA_BLOCK_SIZE)
+		namecache_compact(ndo, nc);
+	p->name = name_arena_add(ndo, &nc->names, name, len);
+	nc->namebytes += len + 1;
+	if (ndo->ndo_name_cache_ttl != 0)
+		p->stamp = time(NULL);
+	return (NAMECACHE_NAME(nc, p));
+}
+
+#ifdef NAME_CACHE_FILE_SUPPORTED
+/*
+ * Give "p" the name that --name-cache-file has for the address "key",
+ * or "numeric" if the file has it as having none, and return it; return
+ * NULL if the file doesn't have the address, or has it from longer ago
+ * than the name TTL.
+ */
+static const char *
+namecache_from_file(netdissect_options *ndo, struct namecache *nc,
+		    struct ipnamemem *p, int family, const void *key,
+		    const char *numeric)
+{
+	char name[NI_MAXHOST];
+
+	if (!name_cache_file_get(family, key, ndo->ndo_name_cache_ttl, name,
+	    sizeof(name)))
+		return (NULL);
+	if (p->state == NC_RETRY)
+		p->state = NC_DONE;
+	if (name[0] == '\0')
+		return (namecache_set(ndo, nc, p, numeric, 0));
+	return (namecache_set(ndo, nc, p, name, 1));
+}
+#endif
+
+static size_t
+namecache_usage(const struct namecache *nc)
+{
+	if (nc->ent == NULL)
+		return (0);
+	return (nc->nsets * NAMECACHE_WAYS * sizeof(*nc->ent) +
+	    name_arena_usage(&nc->names));
+}
+
+size_t
+namecache_mem_usage(netdissect_options *ndo _U_)
+{
+	return (namecache_usage(&ip4cache) + namecache_usage(&ip6cache));
+}
+
+/*
+ * Empty "nc", and have it come back at half the size, so that a busy
+ * cache isn't just filled and emptied again; returns the number of
+ * names thrown away.
+ */
+static uint64_t
+namecache_drop(struct namecache *nc)
+{
+	uint64_t n;
+	u_int i;
+
+	if (nc->ent == NULL)
+		return (0);
+	n = 0;
+	for (i = 0; i < nc->nsets * NAMECACHE_WAYS; i++)
+		if (nc->ent[i].used != 0)
+			n++;
+	free(nc->ent);
+	name_arena_free(&nc->names);
+	nc->ent = NULL;
+	nc->maxsets = nc->nsets > 1 ? nc->nsets / 2 : 1;
+	nc->nsets = 0;
+	nc->namebytes = 0;
+	return (n);
+}
+
+/*
+ * For --mem-limit, which calls this between packets, when none of the
+ * names are still being used.  The names are looked up again if
+ * they're needed, so this is the first place memory is taken from.
+ */
+uint64_t
+namecache_mem_reclaim(netdissect_options *ndo _U_, size_t want _U_)
+{
+	return (namecache_drop(&ip4cache) + namecache_drop(&ip6cache));
+}
+
+#ifdef ASYNC_RESOLVER_SUPPORTED
+/*
+ * With --resolver-threads, host names are looked up by a pool of
+ * threads.  ipaddr_string() and ip6addr_string() return the numeric
+ * address at once, and the name is used once the answer comes back;
+ * a failed lookup leaves the numeric address in the cache, so it isn't
+ * retried until the name TTL expires.
+ *
+ * Each thread that prints packets has a resolver_client with the list
+ * of its answers, as the caches they go into are per thread.
+ */
+#define RESOLVER_MAX_QUEUED	256	/* lookups queued or in progress */
+
+struct resolver_req {
+	struct resolver_req *next;
+	struct resolver_client *client;	/* who gets the answer */
+	int family;
+	uint32_t hash;
+	union {
+		uint32_t a4;
+		nd_ipv6 a6;
+	} addr;
+	int found;
+	char name[NI_MAXHOST];
+};
+
+struct resolver_client {
+	struct resolver_req *done;	/* answers, protected by resolver_mtx */
+	u_int outstanding;		/* lookups not yet collected */
+};
+
+static pthread_mutex_t resolver_mtx = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t resolver_cv = PTHREAD_COND_INITIALIZER;
+static struct resolver_req *resolver_head;
+static struct resolver_req **resolver_tail = &resolver_head;
+static u_int resolver_queued;
+static int resolver_started;
+
+/*
+ * Not freed when the thread exits, as a resolver thread may still
+ * be answering one of its lookups.
+ */
+static ND_THREAD_LOCAL struct resolver_client *resolver_self;
+
+static void *
+resolver_main(void *arg _U_)
+{
+	struct resolver_req *req;
+	union {
+		struct sockaddr_in sin;
+		struct sockaddr_in6 sin6;
+	} sa;
+	socklen_t salen;
+
+	for (;;) {
+		pthread_mutex_lock(&resolver_mtx);
+		while (resolver_head == NULL)
+			pthread_cond_wait(&resolver_cv, &resolver_mtx);
+		req = resolver_head;
+		resolver_head = req->next;
+		if (resolver_head == NULL)
+			resolver_tail = &resolver_head;
+		pthread_mutex_unlock(&resolver_mtx);
+
+		memset(&sa, 0, sizeof(sa));
+		if (req->family == AF_INET) {
+			sa.sin.sin_family = AF_INET;
+			memcpy(&sa.sin.sin_addr, &req->addr.a4, 4);
+			salen = sizeof(sa.sin);
+		} else {
+			sa.sin6.sin6_family = AF_INET6;
+			memcpy(&sa.sin6.sin6_addr, req->addr.a6, 16);
+			salen = sizeof(sa.sin6);
+		}
+		req->found = getnameinfo((struct sockaddr *)&sa, salen,
+		    req->name, sizeof(req->name), NULL, 0, NI_NAMEREQD) == 0;
+#ifdef NAME_CACHE_FILE_SUPPORTED
+		name_cache_file_put(req->family, &req->addr,
+		    req->found ? req->name : NULL);
+#endif
+
+		pthread_mutex_lock(&resolver_mtx);
+		req->next = req->client->done;
+		req->client->done = req;
+		resolver_queued--;
+		pthread_mutex_unlock(&resolver_mtx);
+	}
+	/* NOTREACHED */
+	return (NULL);
+}
+
+/*
+ * Queue a lookup of the host name for the address "key"; return 0 if
+ * too many lookups are already in progress.
+ */
+static int
+resolver_submit(netdissect_options *ndo, int family, const void *key,
+		size_t keylen, uint32_t hash)
+{
+	struct resolver_req *req;
+	sigset_t mask, omask;
+	pthread_t tid;
+	u_int i;
+	int err = 0;
+
+	if (resolver_self == NULL) {
+		resolver_self = (struct resolver_client *)calloc(1,
+		    sizeof(*resolver_self));
+		if (resolver_self == NULL)
+			(*ndo->ndo_error)(ndo, S_ERR_ND_MEM_ALLOC,
+					  "resolver_submit: calloc");
+	}
+	req = (struct resolver_req *)malloc(sizeof(*req));
+	if (req == NULL)
+		(*ndo->ndo_error)(ndo, S_ERR_ND_MEM_ALLOC,
+				  "resolver_submit: malloc");
+	req->next = NULL;
+	req->client = resolver_self;
+	req->family = family;
+	req->hash = hash;
+	memcpy(&req->addr, key, keylen);
+
+	pthread_mutex_lock(&resolver_mtx);
+	if (!resolver_started) {
+		/* Signals are for the main thread. */
+		sigfillset(&mask);
+		pthread_sigmask(SIG_SETMASK, &mask, &omask);
+		for (i = 0; i < ndo->ndo_resolver_threads; i++) {
+			err = pthread_create(&tid, NULL, resolver_main, NULL);
+			if (err != 0)
+				break;
+			pthread_detach(tid);
+		}
+		pthread_sigmask(SIG_SETMASK, &omask, NULL);
+		if (i == 0) {
+			pthread_mutex_unlock(&resolver_mtx);
+			(*ndo->ndo_error)(ndo, S_ERR_ND_MEM_ALLOC,
+			    "resolver_submit: unable to create resolver thread: %s",
+			    strerror(err));
+		}
+		resolver_started = 1;
+	}
+	if (resolver_queued >= RESOLVER_MAX_QUEUED) {
+		pthread_mutex_unlock(&resolver_mtx);
+		free(req);
+		return 0;
+	}
+	*resolver_tail = req;
+	resolver_tail = &req->next;
+	resolver_queued++;
+	pthread_cond_signal(&resolver_cv);
+	pthread_mutex_unlock(&resolver_mtx);
+	resolver_self->outstanding++;
+	return 1;
+}
+
+/*
+ * Put the answers to this thread's lookups into its caches.
+ */
+static void
+resolver_collect(netdissect_options *ndo)
+{
+	struct resolver_req *req, *next;
+	struct namecache *nc;
+	struct ipnamemem *set, *p;
+	size_t keylen;
+	u_int i;
+
+	pthread_mutex_lock(&resolver_mtx);
+	req = resolver_self->done;
+	resolver_self->done = NULL;
+	pthread_mutex_unlock(&resolver_mtx);
+
+	for (; req != NULL; req = next) {
+		next = req->next;
+		resolver_self->outstanding--;
+		if (req->family == AF_INET) {
+			nc = &ip4cache;
+			keylen = sizeof(req->addr.a4);
+		} else {
+			nc = &ip6cache;
+			keylen = sizeof(req->addr.a6);
+		}
+		/*
+		 * The entry may have been given to another address since,
+		 * or the cache emptied by --mem-limit.
+		 */
+		if (nc->ent == NULL) {
+			free(req);
+			continue;
+		}
+		set = &nc->ent[(namecache_mix(req->hash) & (nc->nsets - 1)) *
+		    NAMECACHE_WAYS];
+		for (i = 0; i < NAMECACHE_WAYS; i++) {
+			p = &set[i];
+			if (p->used != 0 && p->state == NC_QUEUED &&
+			    memcmp(&p->addr, &req->addr, keylen) == 0) {
+				p->state = NC_DONE;
+				if (req->found)
+					namecache_set(ndo, nc, p, req->name,
+					    1);
+				else if (ndo->ndo_name_cache_ttl != 0)
+					p->stamp = time(NULL);
+				break;
+			}
+		}
+		free(req);
+	}
+}
+
+/*
+ * Give the entry "p" its numeric name, unless it already has a name,
+ * and queue the lookup of its host name.
+ */
+static const char *
+resolver_start_lookup(netdissect_options *ndo, struct ipnamemem *p,
+		      int family, const void *key, size_t keylen,
+		      uint32_t hash, const char *numeric)
+{
+	struct namecache *nc = family == AF_INET ? &ip4cache : &ip6cache;
+
+	if (p->name == NAME_ARENA_NONE)
+		namecache_set(ndo, nc, p, numeric, 0);
+	if (p->state != NC_QUEUED)
+		p->state = resolver_submit(ndo, family, key, keylen, hash) ?
+		    NC_QUEUED : NC_RETRY;
+	return (NAMECACHE_NAME(nc, p));
+}
+#endif /* ASYNC_RESOLVER_SUPPORTED */
 
 struct enamemem {
+	struct nametable_node e_node;
 	u_short e_addr0;
 	u_short e_addr1;
 	u_short e_addr2;
-	const char *e_name;
-	u_char *e_nsap;			/* used only for nsaptable[] */
-	struct enamemem *e_nxt;
+	uint32_t e_name;		/* offset in addr_names */
+	u_char *e_nsap;			/* used only for nsaptable */
 };
 
-static struct enamemem enametable[HASHNAMESIZE];
-static struct enamemem nsaptable[HASHNAMESIZE];
+static ND_THREAD_LOCAL struct nametable enametable;
+static ND_THREAD_LOCAL struct nametable nsaptable;
+
+/*
+ * A set-associative cache in front of enametable, so that the handful
+ * of addresses in most frames are found without walking a hash chain.
+ * Each set is a cache line of EMEM_CACHE_WAYS entries, keyed by the
+ * address with EMEM_CACHE_USED set above it; a new entry goes at the
+ * front of its set, the oldest falling off the back.  The names are
+ * those of enametable, in addr_names, whose blocks never move, so the
+ * cache can point straight at them.
+ */
+#define EMEM_CACHE_SETS		256	/* a power of 2 */
+#define EMEM_CACHE_WAYS		4
+#define EMEM_CACHE_USED		((uint64_t)1 << 48)
+
+struct ND_ALIGNED(64) emem_cache_set {
+	uint64_t key[EMEM_CACHE_WAYS];
+	const char *name[EMEM_CACHE_WAYS];
+};
+
+static ND_THREAD_LOCAL struct emem_cache_set emem_cache[EMEM_CACHE_SETS];
 
 struct bsnamemem {
+	struct nametable_node bs_node;
 	u_short bs_addr0;
 	u_short bs_addr1;
 	u_short bs_addr2;
-	const char *bs_name;
+	uint32_t bs_name;		/* offset in addr_names */
 	u_char *bs_bytes;
 	unsigned int bs_nbytes;
-	struct bsnamemem *bs_nxt;
-};
-
-static struct bsnamemem bytestringtable[HASHNAMESIZE];
-
-struct protoidmem {
-	uint32_t p_oui;
-	u_short p_proto;
-	const char *p_name;
-	struct protoidmem *p_nxt;
 };
 
-static struct protoidmem protoidtable[HASHNAMESIZE];
+static ND_THREAD_LOCAL struct nametable bytestringtable;
 
 /*
  * A faster replacement for inet_ntoa().
@@ -233,7 +804,7 @@ intoa(uint32_t addr)
 	char *cp;
 	u_int byte;
 	int n;
-	static char buf[sizeof(".xxx.xxx.xxx.xxx")];
+	static ND_THREAD_LOCAL char buf[sizeof(".xxx.xxx.xxx.xxx")];
 
 	NTOHL(addr);
 	cp = buf + sizeof(buf);
@@ -263,6 +834,83 @@ static uint32_t f_localnet;
 extern cap_channel_t *capdns;
 #endif
 
+/*
+ * --resolve: the prefixes whose hosts are looked up (value 1) or, given
+ * with a "!", aren't (value 0), the longest match deciding.  A host
+ * that matches none of them is looked up only if no prefix was given
+ * without a "!".  They're added before any packets are printed and
+ * only read after that, so all threads share them.
+ */
+static struct prefix_trie *resolve_ip4;
+static struct prefix_trie *resolve_ip6;
+static int resolve_default = 1;
+
+/*
+ * Add a prefix, "[!]address[/length]", to the --resolve list; returns
+ * -1 if it isn't one.
+ */
+int
+add_resolve_prefix(netdissect_options *ndo, const char *spec)
+{
+	char buf[INET6_ADDRSTRLEN + sizeof("/128")];
+	u_char addr[16];
+	struct prefix_trie **triep;
+	const char *slash;
+	char *end;
+	u_int maxlen;
+	long plen;
+	int resolve;
+
+	resolve = 1;
+	if (*spec == '!') {
+		resolve = 0;
+		spec++;
+	}
+	slash = strchr(spec, '/');
+	if (slash == NULL)
+		slash = spec + strlen(spec);
+	if ((size_t)(slash - spec) >= sizeof(buf))
+		return (-1);
+	memcpy(buf, spec, slash - spec);
+	buf[slash - spec] = '\0';
+	if (strtoaddr(buf, addr)) {
+		triep = &resolve_ip4;
+		maxlen = 32;
+	} else if (strtoaddr6(buf, addr)) {
+		triep = &resolve_ip6;
+		maxlen = 128;
+	} else
+		return (-1);
+	plen = maxlen;
+	if (*slash == '/') {
+		plen = strtol(slash + 1, &end, 10);
+		if (end == slash + 1 || *end != '\0' || plen < 0 ||
+		    plen > (long)maxlen)
+			return (-1);
+	}
+	if (prefix_trie_add(triep, addr, (u_int)plen, resolve) == -1)
+		(*ndo->ndo_error)(ndo, S_ERR_ND_MEM_ALLOC, "%s: calloc",
+		    __func__);
+	if (resolve)
+		resolve_default = 0;
+	return (0);
+}
+
+static int
+resolve_wanted(const struct prefix_trie *trie, const void *addr,
+	       u_int alen)
+{
+	int resolve;
+
+	if (resolve_ip4 == NULL && resolve_ip6 == NULL)
+		return (1);
+	resolve = prefix_trie_lookup(trie, (const u_char *)addr, alen);
+	return (resolve == -1 ? resolve_default : resolve);
+}
+
+static const char *ipaddr_numeric(netdissect_options *, const u_char *);
+static const char *ip6addr_numeric(netdissect_options *, const u_char *);
+
 /*
  * Return a name for the IP address pointed to by ap.  This address
  * is assumed to be in network byte order.
@@ -287,16 +935,18 @@ ipaddr_string(netdissect_options *ndo, const u_char *ap)
 {
 	struct hostent *hp;
 	uint32_t addr;
-	struct hnamemem *p;
+	struct ipnamemem *p;
 
+	if (ndo->ndo_nflag)
+		return (ipaddr_numeric(ndo, ap));
 	memcpy(&addr, ap, sizeof(addr));
-	p = &hnametable[addr & (HASHNAMESIZE-1)];
-	for (; p->nxt; p = p->nxt) {
-		if (p->addr == addr)
-			return (p->name);
-	}
-	p->addr = addr;
-	p->nxt = newhnamemem(ndo);
+#ifdef ASYNC_RESOLVER_SUPPORTED
+	if (resolver_self != NULL && resolver_self->outstanding != 0)
+		resolver_collect(ndo);
+#endif
+	if (namecache_find(ndo, &ip4cache, &addr, sizeof(addr), addr, &p) &&
+	    p->state != NC_RETRY)
+		return (NAMECACHE_NAME(&ip4cache, p));
 
 	/*
 	 * Print names unless:
@@ -304,9 +954,28 @@ ipaddr_string(netdissect_options *ndo, const u_char *ap)
 	 *      (2) Address is foreign and -f was given. (If -f was not
 	 *	    given, f_netmask and f_localnet are 0 and the test
 	 *	    evaluates to true)
+	 *	(3) --resolve says not to.
 	 */
 	if (!ndo->ndo_nflag &&
-	    (addr & f_netmask) == f_localnet) {
+	    (addr & f_netmask) == f_localnet &&
+	    resolve_wanted(resolve_ip4, &addr, 32)) {
+#ifdef NAME_CACHE_FILE_SUPPORTED
+		const char *cp;
+
+		cp = namecache_from_file(ndo, &ip4cache, p, AF_INET, &addr,
+		    intoa(addr));
+		if (cp != NULL)
+			return (cp);
+#endif
+#ifdef ASYNC_RESOLVER_SUPPORTED
+		if (ndo->ndo_resolver_threads != 0
+#ifdef HAVE_CASPER
+		    && capdns == NULL
+#endif
+		    )
+			return (resolver_start_lookup(ndo, p, AF_INET, &addr,
+			    sizeof(addr), addr, intoa(addr)));
+#endif
 #ifdef HAVE_CASPER
 		if (capdns != NULL) {
 			hp = cap_gethostbyaddr(capdns, (char *)&addr, 4,
@@ -314,27 +983,49 @@ ipaddr_string(netdissect_options *ndo, const u_char *ap)
 		} else
 #endif
 			hp = gethostbyaddr((char *)&addr, 4, AF_INET);
-		if (hp) {
-			char *dotp;
-
-			p->name = strdup(hp->h_name);
-			if (p->name == NULL)
-				(*ndo->ndo_error)(ndo, S_ERR_ND_MEM_ALLOC,
-					"ipaddr_string: strdup(hp->h_name)");
-			if (ndo->ndo_Nflag) {
-				/* Remove domain qualifications */
-				dotp = strchr(p->name, '.');
-				if (dotp)
-					*dotp = '\0';
-			}
-			return (p->name);
-		}
+#ifdef NAME_CACHE_FILE_SUPPORTED
+		name_cache_file_put(AF_INET, &addr,
+		    hp != NULL ? hp->h_name : NULL);
+#endif
+		if (hp)
+			return (namecache_set(ndo, &ip4cache, p, hp->h_name,
+			    1));
 	}
-	p->name = strdup(intoa(addr));
-	if (p->name == NULL)
-		(*ndo->ndo_error)(ndo, S_ERR_ND_MEM_ALLOC,
-				  "ipaddr_string: strdup(intoa(addr))");
-	return (p->name);
+	return (namecache_set(ndo, &ip4cache, p, intoa(addr), 0));
+}
+
+/*
+ * Prefetch the name cache set that ipaddr_string() or ip6addr_string()
+ * will look the address up in, for a packet that's about to be printed.
+ */
+void
+ipaddr_prefetch(const u_char *ap)
+{
+	uint32_t addr;
+
+	if (ip4cache.ent == NULL)
+		return;
+	memcpy(&addr, ap, sizeof(addr));
+	ND_PREFETCH(&ip4cache.ent[(namecache_mix(addr) &
+	    (ip4cache.nsets - 1)) * NAMECACHE_WAYS]);
+}
+
+static uint32_t
+ip6addr_hash(const u_char *ap)
+{
+	uint32_t w[4];
+
+	memcpy(w, ap, sizeof(w));
+	return (w[0] ^ w[1] ^ w[2] ^ (w[3] * 0x9e3779b1U));
+}
+
+void
+ip6addr_prefetch(const u_char *ap)
+{
+	if (ip6cache.ent == NULL)
+		return;
+	ND_PREFETCH(&ip6cache.ent[(namecache_mix(ip6addr_hash(ap)) &
+	    (ip6cache.nsets - 1)) * NAMECACHE_WAYS]);
 }
 
 /*
@@ -345,30 +1036,45 @@ const char *
 ip6addr_string(netdissect_options *ndo, const u_char *ap)
 {
 	struct hostent *hp;
-	union {
-		nd_ipv6 addr;
-		struct for_hash_addr {
-			char fill[14];
-			uint16_t d;
-		} addra;
-	} addr;
-	struct h6namemem *p;
+	nd_ipv6 addr;
+	struct ipnamemem *p;
 	const char *cp;
 	char ntop_buf[INET6_ADDRSTRLEN];
+	uint32_t hash;
 
+	if (ndo->ndo_nflag)
+		return (ip6addr_numeric(ndo, ap));
 	memcpy(&addr, ap, sizeof(addr));
-	p = &h6nametable[addr.addra.d & (HASHNAMESIZE-1)];
-	for (; p->nxt; p = p->nxt) {
-		if (memcmp(&p->addr, &addr, sizeof(addr)) == 0)
-			return (p->name);
-	}
-	memcpy(p->addr, addr.addr, sizeof(nd_ipv6));
-	p->nxt = newh6namemem(ndo);
+	hash = ip6addr_hash(ap);
+#ifdef ASYNC_RESOLVER_SUPPORTED
+	if (resolver_self != NULL && resolver_self->outstanding != 0)
+		resolver_collect(ndo);
+#endif
+	if (namecache_find(ndo, &ip6cache, &addr, sizeof(addr), hash, &p) &&
+	    p->state != NC_RETRY)
+		return (NAMECACHE_NAME(&ip6cache, p));
 
 	/*
-	 * Do not print names if -n was given.
+	 * Do not print names if -n was given, or if --resolve says not to.
 	 */
-	if (!ndo->ndo_nflag) {
+	if (!ndo->ndo_nflag && resolve_wanted(resolve_ip6, &addr, 128)) {
+#ifdef NAME_CACHE_FILE_SUPPORTED
+		cp = namecache_from_file(ndo, &ip6cache, p, AF_INET6, &addr,
+		    addrtostr6(ap, ntop_buf, sizeof(ntop_buf)));
+		if (cp != NULL)
+			return (cp);
+#endif
+#ifdef ASYNC_RESOLVER_SUPPORTED
+		if (ndo->ndo_resolver_threads != 0
+#ifdef HAVE_CASPER
+		    && capdns == NULL
+#endif
+		    ) {
+			cp = addrtostr6(ap, ntop_buf, sizeof(ntop_buf));
+			return (resolver_start_lookup(ndo, p, AF_INET6, &addr,
+			    sizeof(addr), hash, cp));
+		}
+#endif
 #ifdef HAVE_CASPER
 		if (capdns != NULL) {
 			hp = cap_gethostbyaddr(capdns, (char *)&addr,
@@ -377,28 +1083,16 @@ ip6addr_string(netdissect_options *ndo, const u_char *ap)
 #endif
 			hp = gethostbyaddr((char *)&addr, sizeof(addr),
 			    AF_INET6);
-		if (hp) {
-			char *dotp;
-
-			p->name = strdup(hp->h_name);
-			if (p->name == NULL)
-				(*ndo->ndo_error)(ndo, S_ERR_ND_MEM_ALLOC,
-					"ip6addr_string: strdup(hp->h_name)");
-			if (ndo->ndo_Nflag) {
-				/* Remove domain qualifications */
-				dotp = strchr(p->name, '.');
-				if (dotp)
-					*dotp = '\0';
-			}
-			return (p->name);
-		}
+#ifdef NAME_CACHE_FILE_SUPPORTED
+		name_cache_file_put(AF_INET6, &addr,
+		    hp != NULL ? hp->h_name : NULL);
+#endif
+		if (hp)
+			return (namecache_set(ndo, &ip6cache, p, hp->h_name,
+			    1));
 	}
 	cp = addrtostr6(ap, ntop_buf, sizeof(ntop_buf));
-	p->name = strdup(cp);
-	if (p->name == NULL)
-		(*ndo->ndo_error)(ndo, S_ERR_ND_MEM_ALLOC,
-				  "ip6addr_string: strdup(cp)");
-	return (p->name);
+	return (namecache_set(ndo, &ip6cache, p, cp, 0));
 }
 
 static const char hex[16] = {
@@ -438,32 +1132,189 @@ octet_to_hex(char *cp, uint8_t octet)
 	return (cp);
 }
 
+/*
+ * With -n, addresses are formatted into the packet's nd_malloc() arena,
+ * which nd_free_all() empties after the packet is printed, instead of
+ * being looked up in the caches and added to them; no names are
+ * wanted, so there's nothing worth keeping.  The text is the same as
+ * intoa() and addrtostr6() give.
+ */
+static const char dec[256][4] = {
+	"0", "1", "2", "3", "4", "5", "6", "7", "8", "9", "10", "11",
+	"12", "13", "14", "15", "16", "17", "18", "19", "20", "21",
+	"22", "23", "24", "25", "26", "27", "28", "29", "30", "31",
+	"32", "33", "34", "35", "36", "37", "38", "39", "40", "41",
+	"42", "43", "44", "45", "46", "47", "48", "49", "50", "51",
+	"52", "53", "54", "55", "56", "57", "58", "59", "60", "61",
+	"62", "63", "64", "65", "66", "67", "68", "69", "70", "71",
+	"72", "73", "74", "75", "76", "77", "78", "79", "80", "81",
+	"82", "83", "84", "85", "86", "87", "88", "89", "90", "91",
+	"92", "93", "94", "95", "96", "97", "98", "99", "100", "101",
+	"102", "103", "104", "105", "106", "107", "108", "109", "110",
+	"111", "112", "113", "114", "115", "116", "117", "118", "119",
+	"120", "121", "122", "123", "124", "125", "126", "127", "128",
+	"129", "130", "131", "132", "133", "134", "135", "136", "137",
+	"138", "139", "140", "141", "142", "143", "144", "145", "146",
+	"147", "148", "149", "150", "151", "152", "153", "154", "155",
+	"156", "157", "158", "159", "160", "161", "162", "163", "164",
+	"165", "166", "167", "168", "169", "170", "171", "172", "173",
+	"174", "175", "176", "177", "178", "179", "180", "181", "182",
+	"183", "184", "185", "186", "187", "188", "189", "190", "191",
+	"192", "193", "194", "195", "196", "197", "198", "199", "200",
+	"201", "202", "203", "204", "205", "206", "207", "208", "209",
+	"210", "211", "212", "213", "214", "215", "216", "217", "218",
+	"219", "220", "221", "222", "223", "224", "225", "226", "227",
+	"228", "229", "230", "231", "232", "233", "234", "235", "236",
+	"237", "238", "239", "240", "241", "242", "243", "244", "245",
+	"246", "247", "248", "249", "250", "251", "252", "253", "254",
+	"255"
+};
+
+static char *
+numeric_buf(netdissect_options *ndo, size_t size)
+{
+	char *buf;
+
+	buf = (char *)nd_malloc(ndo, size);
+	if (buf == NULL)
+		(*ndo->ndo_error)(ndo, S_ERR_ND_MEM_ALLOC, "%s: malloc",
+		    __func__);
+	return (buf);
+}
+
+static char *
+ipaddr_format(char *cp, const u_char *ap)
+{
+	const char *dp;
+	u_int i;
+
+	for (i = 0; i < 4; i++) {
+		if (i != 0)
+			*cp++ = '.';
+		for (dp = dec[ap[i]]; *dp != '\0'; dp++)
+			*cp++ = *dp;
+	}
+	*cp = '\0';
+	return (cp);
+}
+
+static const char *
+ipaddr_numeric(netdissect_options *ndo, const u_char *ap)
+{
+	char *buf;
+
+	buf = numeric_buf(ndo, INET_ADDRSTRLEN);
+	(void)ipaddr_format(buf, ap);
+	return (buf);
+}
+
+/*
+ * RFC 5952: hex words without leading zeroes, the longest run of two
+ * or more zero words (the first, if there's a tie) shortened to "::",
+ * and IPv4-compatible and IPv4-mapped addresses with the IPv4 address
+ * in dotted decimal.
+ */
+static const char *
+ip6addr_numeric(netdissect_options *ndo, const u_char *ap)
+{
+	char *buf, *cp;
+	u_int words[8];
+	int i, base, len, cur;
+
+	base = -1;
+	len = 0;
+	cur = -1;
+	for (i = 0; i < 8; i++) {
+		words[i] = ((u_int)ap[2 * i] << 8) | ap[2 * i + 1];
+		if (words[i] != 0) {
+			cur = -1;
+			continue;
+		}
+		if (cur == -1)
+			cur = i;
+		if (i - cur + 1 > len) {
+			base = cur;
+			len = i - cur + 1;
+		}
+	}
+	if (len < 2)
+		base = -1;
+
+	buf = cp = numeric_buf(ndo, INET6_ADDRSTRLEN);
+	for (i = 0; i < 8; i++) {
+		if (base != -1 && i >= base && i < base + len) {
+			if (i == base)
+				*cp++ = ':';
+			continue;
+		}
+		if (i != 0)
+			*cp++ = ':';
+		if (i == 6 && base == 0 &&
+		    (len == 6 || (len == 5 && words[5] == 0xffff))) {
+			(void)ipaddr_format(cp, ap + 12);
+			return (buf);
+		}
+		if (words[i] >= 0x1000)
+			*cp++ = hex[words[i] >> 12];
+		if (words[i] >= 0x100)
+			*cp++ = hex[(words[i] >> 8) & 0xf];
+		if (words[i] >= 0x10)
+			*cp++ = hex[(words[i] >> 4) & 0xf];
+		*cp++ = hex[words[i] & 0xf];
+	}
+	if (base != -1 && base + len == 8)
+		*cp++ = ':';
+	*cp = '\0';
+	return (buf);
+}
+
+static const char *
+etheraddr_numeric(netdissect_options *ndo, const uint8_t *ep)
+{
+	char *buf, *cp;
+	u_int i;
+
+	buf = cp = numeric_buf(ndo, sizeof("xx:xx:xx:xx:xx:xx"));
+	for (i = 0; i < 6; i++) {
+		if (i != 0)
+			*cp++ = ':';
+		cp = octet_to_hex(cp, ep[i]);
+	}
+	*cp = '\0';
+	return (buf);
+}
+
 /* Find the hash node that corresponds the ether address 'ep' */
 
 static struct enamemem *
 lookup_emem(netdissect_options *ndo, const u_char *ep)
 {
 	u_int i, j, k;
+	uint32_t h;
+	struct nametable_node *np;
 	struct enamemem *tp;
 
 	k = (ep[0] << 8) | ep[1];
 	j = (ep[2] << 8) | ep[3];
 	i = (ep[4] << 8) | ep[5];
 
-	tp = &enametable[(i ^ j) & (HASHNAMESIZE-1)];
-	while (tp->e_nxt)
-		if (tp->e_addr0 == i &&
+	h = ((k << 16) | j) ^ (i * 0x9e3779b1U);
+	for (np = nametable_first(&enametable, h); np != NULL;
+	     np = np->nt_nxt) {
+		tp = (struct enamemem *)np;
+		if (np->nt_hash == h &&
+		    tp->e_addr0 == i &&
 		    tp->e_addr1 == j &&
 		    tp->e_addr2 == k)
 			return tp;
-		else
-			tp = tp->e_nxt;
+	}
+	tp = (struct enamemem *)calloc(1, sizeof(*tp));
+	if (tp == NULL)
+		(*ndo->ndo_error)(ndo, S_ERR_ND_MEM_ALLOC, "lookup_emem: calloc");
 	tp->e_addr0 = (u_short)i;
 	tp->e_addr1 = (u_short)j;
 	tp->e_addr2 = (u_short)k;
-	tp->e_nxt = (struct enamemem *)calloc(1, sizeof(*tp));
-	if (tp->e_nxt == NULL)
-		(*ndo->ndo_error)(ndo, S_ERR_ND_MEM_ALLOC, "lookup_emem: calloc");
+	nametable_insert(ndo, &enametable, &tp->e_node, h);
 
 	return tp;
 }
@@ -478,7 +1329,9 @@ lookup_bytestring(netdissect_options *ndo, const u_char *bs,
 		  const unsigned int nlen)
 {
 	struct bsnamemem *tp;
+	struct nametable_node *np;
 	u_int i, j, k;
+	uint32_t h;
 
 	if (nlen >= 6) {
 		k = (bs[0] << 8) | bs[1];
@@ -491,17 +1344,23 @@ lookup_bytestring(netdissect_options *ndo, const u_char *bs,
 	} else
 		i = j = k = 0;
 
-	tp = &bytestringtable[(i ^ j) & (HASHNAMESIZE-1)];
-	while (tp->bs_nxt)
-		if (nlen == tp->bs_nbytes &&
+	h = (((k << 16) | j) ^ (i * 0x9e3779b1U)) + nlen;
+	for (np = nametable_first(&bytestringtable, h); np != NULL;
+	     np = np->nt_nxt) {
+		tp = (struct bsnamemem *)np;
+		if (np->nt_hash == h &&
+		    nlen == tp->bs_nbytes &&
 		    tp->bs_addr0 == i &&
 		    tp->bs_addr1 == j &&
 		    tp->bs_addr2 == k &&
 		    memcmp((const char *)bs, (const char *)(tp->bs_bytes), nlen) == 0)
 			return tp;
-		else
-			tp = tp->bs_nxt;
+	}
 
+	tp = (struct bsnamemem *)calloc(1, sizeof(*tp));
+	if (tp == NULL)
+		(*ndo->ndo_error)(ndo, S_ERR_ND_MEM_ALLOC,
+				  "lookup_bytestring: calloc");
 	tp->bs_addr0 = (u_short)i;
 	tp->bs_addr1 = (u_short)j;
 	tp->bs_addr2 = (u_short)k;
@@ -513,10 +1372,7 @@ lookup_bytestring(netdissect_options *ndo, const u_char *bs,
 
 	memcpy(tp->bs_bytes, bs, nlen);
 	tp->bs_nbytes = nlen;
-	tp->bs_nxt = (struct bsnamemem *)calloc(1, sizeof(*tp));
-	if (tp->bs_nxt == NULL)
-		(*ndo->ndo_error)(ndo, S_ERR_ND_MEM_ALLOC,
-				  "lookup_bytestring: calloc");
+	nametable_insert(ndo, &bytestringtable, &tp->bs_node, h);
 
 	return tp;
 }
@@ -528,6 +1384,8 @@ lookup_nsap(netdissect_options *ndo, const u_char *nsap,
 	    u_int nsap_length)
 {
 	u_int i, j, k;
+	uint32_t h;
+	struct nametable_node *np;
 	struct enamemem *tp;
 	const u_char *ensap;
 
@@ -540,17 +1398,22 @@ lookup_nsap(netdissect_options *ndo, const u_char *nsap,
 	else
 		i = j = k = 0;
 
-	tp = &nsaptable[(i ^ j) & (HASHNAMESIZE-1)];
-	while (tp->e_nxt)
-		if (nsap_length == tp->e_nsap[0] &&
+	h = (((k << 16) | j) ^ (i * 0x9e3779b1U)) + nsap_length;
+	for (np = nametable_first(&nsaptable, h); np != NULL;
+	     np = np->nt_nxt) {
+		tp = (struct enamemem *)np;
+		if (np->nt_hash == h &&
+		    nsap_length == tp->e_nsap[0] &&
 		    tp->e_addr0 == i &&
 		    tp->e_addr1 == j &&
 		    tp->e_addr2 == k &&
 		    memcmp((const char *)nsap,
 			(char *)&(tp->e_nsap[1]), nsap_length) == 0)
 			return tp;
-		else
-			tp = tp->e_nxt;
+	}
+	tp = (struct enamemem *)calloc(1, sizeof(*tp));
+	if (tp == NULL)
+		(*ndo->ndo_error)(ndo, S_ERR_ND_MEM_ALLOC, "lookup_nsap: calloc");
 	tp->e_addr0 = (u_short)i;
 	tp->e_addr1 = (u_short)j;
 	tp->e_addr2 = (u_short)k;
@@ -559,63 +1422,30 @@ lookup_nsap(netdissect_options *ndo, const u_char *nsap,
 		(*ndo->ndo_error)(ndo, S_ERR_ND_MEM_ALLOC, "lookup_nsap: malloc");
 	tp->e_nsap[0] = (u_char)nsap_length;	/* guaranteed < ISONSAP_MAX_LENGTH */
 	memcpy((char *)&tp->e_nsap[1], (const char *)nsap, nsap_length);
-	tp->e_nxt = (struct enamemem *)calloc(1, sizeof(*tp));
-	if (tp->e_nxt == NULL)
-		(*ndo->ndo_error)(ndo, S_ERR_ND_MEM_ALLOC, "lookup_nsap: calloc");
+	nametable_insert(ndo, &nsaptable, &tp->e_node, h);
 
 	return tp;
 }
 
-/* Find the hash node that corresponds the protoid 'pi'. */
-
-static struct protoidmem *
-lookup_protoid(netdissect_options *ndo, const u_char *pi)
-{
-	u_int i, j;
-	struct protoidmem *tp;
-
-	/* 5 octets won't be aligned */
-	i = (((pi[0] << 8) + pi[1]) << 8) + pi[2];
-	j =   (pi[3] << 8) + pi[4];
-	/* XXX should be endian-insensitive, but do big-endian testing  XXX */
-
-	tp = &protoidtable[(i ^ j) & (HASHNAMESIZE-1)];
-	while (tp->p_nxt)
-		if (tp->p_oui == i && tp->p_proto == j)
-			return tp;
-		else
-			tp = tp->p_nxt;
-	tp->p_oui = i;
-	tp->p_proto = (u_short)j;
-	tp->p_nxt = (struct protoidmem *)calloc(1, sizeof(*tp));
-	if (tp->p_nxt == NULL)
-		(*ndo->ndo_error)(ndo, S_ERR_ND_MEM_ALLOC, "lookup_protoid: calloc");
-
-	return tp;
-}
-
-const char *
-etheraddr_string(netdissect_options *ndo, const uint8_t *ep)
+/*
+ * Give the enametable node "tp" for the address "ep" its name.
+ */
+static void
+etheraddr_name(netdissect_options *ndo, struct enamemem *tp,
+	       const uint8_t *ep)
 {
 	int i;
 	char *cp;
-	struct enamemem *tp;
 	int oui;
 	char buf[BUFSIZE];
 
-	tp = lookup_emem(ndo, ep);
-	if (tp->e_name)
-		return (tp->e_name);
 #ifdef USE_ETHER_NTOHOST
 	if (!ndo->ndo_nflag) {
 		char buf2[BUFSIZE];
 
 		if (ether_ntohost(buf2, (const struct ether_addr *)ep) == 0) {
-			tp->e_name = strdup(buf2);
-			if (tp->e_name == NULL)
-				(*ndo->ndo_error)(ndo, S_ERR_ND_MEM_ALLOC,
-					"etheraddr_string: strdup(buf2)");
-			return (tp->e_name);
+			tp->e_name = addr_name_add(ndo, buf2);
+			return;
 		}
 	}
 #endif
@@ -632,11 +1462,37 @@ etheraddr_string(netdissect_options *ndo, const uint8_t *ep)
 		    tok2str(oui_values, "Unknown", oui));
 	} else
 		*cp = '\0';
-	tp->e_name = strdup(buf);
-	if (tp->e_name == NULL)
-		(*ndo->ndo_error)(ndo, S_ERR_ND_MEM_ALLOC,
-				  "etheraddr_string: strdup(buf)");
-	return (tp->e_name);
+	tp->e_name = addr_name_add(ndo, buf);
+}
+
+const char *
+etheraddr_string(netdissect_options *ndo, const uint8_t *ep)
+{
+	struct emem_cache_set *set;
+	struct enamemem *tp;
+	uint64_t key;
+	u_int i;
+
+	if (ndo->ndo_nflag)
+		return (etheraddr_numeric(ndo, ep));
+	NEED_TABLES(ndo, TABLE_ETHER);
+	key = EXTRACT_BE_U_6(ep) | EMEM_CACHE_USED;
+	set = &emem_cache[(u_int)((key * 0x9e3779b97f4a7c15ULL) >> 40) &
+	    (EMEM_CACHE_SETS - 1)];
+	for (i = 0; i < EMEM_CACHE_WAYS; i++)
+		if (set->key[i] == key)
+			return (set->name[i]);
+
+	tp = lookup_emem(ndo, ep);
+	if (tp->e_name == NAME_ARENA_NONE)
+		etheraddr_name(ndo, tp, ep);
+	for (i = EMEM_CACHE_WAYS - 1; i > 0; i--) {
+		set->key[i] = set->key[i - 1];
+		set->name[i] = set->name[i - 1];
+	}
+	set->key[0] = key;
+	set->name[0] = ADDR_NAME(tp->e_name);
+	return (set->name[0]);
 }
 
 const char *
@@ -649,8 +1505,8 @@ le64addr_string(netdissect_options *ndo, const uint8_t *ep)
 	char buf[BUFSIZE];
 
 	tp = lookup_bytestring(ndo, ep, len);
-	if (tp->bs_name)
-		return (tp->bs_name);
+	if (tp->bs_name != NAME_ARENA_NONE)
+		return (ADDR_NAME(tp->bs_name));
 
 	cp = buf;
 	for (i = len; i > 0 ; --i) {
@@ -661,12 +1517,8 @@ le64addr_string(netdissect_options *ndo, const uint8_t *ep)
 
 	*cp = '\0';
 
-	tp->bs_name = strdup(buf);
-	if (tp->bs_name == NULL)
-		(*ndo->ndo_error)(ndo, S_ERR_ND_MEM_ALLOC,
-				  "le64addr_string: strdup(buf)");
-
-	return (tp->bs_name);
+	tp->bs_name = addr_name_add(ndo, buf);
+	return (ADDR_NAME(tp->bs_name));
 }
 
 const char *
@@ -674,7 +1526,7 @@ linkaddr_string(netdissect_options *ndo, const uint8_t *ep,
 		const unsigned int type, const unsigned int len)
 {
 	u_int i;
-	char *cp;
+	char *buf, *cp;
 	struct bsnamemem *tp;
 
 	if (len == 0)
@@ -687,11 +1539,11 @@ linkaddr_string(netdissect_options *ndo, const uint8_t *ep,
 		return (q922_string(ndo, ep, len));
 
 	tp = lookup_bytestring(ndo, ep, len);
-	if (tp->bs_name)
-		return (tp->bs_name);
+	if (tp->bs_name != NAME_ARENA_NONE)
+		return (ADDR_NAME(tp->bs_name));
 
-	tp->bs_name = cp = (char *)malloc(len*3);
-	if (tp->bs_name == NULL)
+	buf = cp = (char *)malloc(len*3);
+	if (buf == NULL)
 		(*ndo->ndo_error)(ndo, S_ERR_ND_MEM_ALLOC,
 				  "linkaddr_string: malloc");
 	cp = octet_to_hex(cp, *ep++);
@@ -699,8 +1551,9 @@ linkaddr_string(netdissect_options *ndo, const uint8_t *ep,
 		*cp++ = ':';
 		cp = octet_to_hex(cp, *ep++);
 	}
-	*cp = '\0';
-	return (tp->bs_name);
+	tp->bs_name = name_arena_add(ndo, &addr_names, buf, cp - buf);
+	free(buf);
+	return (ADDR_NAME(tp->bs_name));
 }
 
 #define ISONSAP_MAX_LENGTH 20
@@ -711,19 +1564,16 @@ isonsap_string(netdissect_options *ndo, const uint8_t *nsap,
 	u_int nsap_idx;
 	char *cp;
 	struct enamemem *tp;
+	char buf[sizeof("xx.xxxx.xxxx.xxxx.xxxx.xxxx.xxxx.xxxx.xxxx.xxxx.xx")];
 
 	if (nsap_length < 1 || nsap_length > ISONSAP_MAX_LENGTH)
 		return ("isonsap_string: illegal length");
 
 	tp = lookup_nsap(ndo, nsap, nsap_length);
-	if (tp->e_name)
-		return tp->e_name;
-
-	tp->e_name = cp = (char *)malloc(sizeof("xx.xxxx.xxxx.xxxx.xxxx.xxxx.xxxx.xxxx.xxxx.xxxx.xx"));
-	if (cp == NULL)
-		(*ndo->ndo_error)(ndo, S_ERR_ND_MEM_ALLOC,
-				  "isonsap_string: malloc");
+	if (tp->e_name != NAME_ARENA_NONE)
+		return (ADDR_NAME(tp->e_name));
 
+	cp = buf;
 	for (nsap_idx = 0; nsap_idx < nsap_length; nsap_idx++) {
 		cp = octet_to_hex(cp, *nsap++);
 		if (((nsap_idx & 1) == 0) &&
@@ -732,51 +1582,54 @@ isonsap_string(netdissect_options *ndo, const uint8_t *nsap,
 		}
 	}
 	*cp = '\0';
-	return (tp->e_name);
+	tp->e_name = addr_name_add(ndo, buf);
+	return (ADDR_NAME(tp->e_name));
 }
 
-const char *
-tcpport_string(netdissect_options *ndo, u_short port)
+static const char *
+portnumber_string(netdissect_options *ndo, u_short port)
 {
-	struct hnamemem *tp;
-	uint32_t i = port;
-	char buf[sizeof("00000")];
+	char *cp;
+	u_int i;
 
-	for (tp = &tporttable[i & (HASHNAMESIZE-1)]; tp->nxt; tp = tp->nxt)
-		if (tp->addr == i)
-			return (tp->name);
+	if (portnumbers == NULL) {
+		portnumbers = calloc(NPORTS, sizeof(*portnumbers));
+		if (portnumbers == NULL)
+			(*ndo->ndo_error)(ndo, S_ERR_ND_MEM_ALLOC,
+					  "portnumber_string: calloc");
+	}
+	cp = portnumbers[port];
+	if (*cp == '\0') {
+		/* Right-justify the digits, then slide them down. */
+		cp += sizeof(portnumbers[0]) - 1;
+		i = port;
+		do {
+			*--cp = (char)(i % 10) + '0';
+			i /= 10;
+		} while (i != 0);
+		memmove(portnumbers[port], cp,
+		    portnumbers[port] + sizeof(portnumbers[0]) - cp);
+		cp = portnumbers[port];
+	}
+	return (cp);
+}
 
-	tp->addr = i;
-	tp->nxt = newhnamemem(ndo);
+const char *
+tcpport_string(netdissect_options *ndo, u_short port)
+{
+	uint32_t name = tportnames != NULL ? tportnames[port] : NAME_ARENA_NONE;
 
-	(void)snprintf(buf, sizeof(buf), "%u", i);
-	tp->name = strdup(buf);
-	if (tp->name == NULL)
-		(*ndo->ndo_error)(ndo, S_ERR_ND_MEM_ALLOC,
-				  "tcpport_string: strdup(buf)");
-	return (tp->name);
+	return (name != NAME_ARENA_NONE ? name_arena_str(&port_names, name) :
+	    portnumber_string(ndo, port));
 }
 
 const char *
 udpport_string(netdissect_options *ndo, u_short port)
 {
-	struct hnamemem *tp;
-	uint32_t i = port;
-	char buf[sizeof("00000")];
+	uint32_t name = uportnames != NULL ? uportnames[port] : NAME_ARENA_NONE;
 
-	for (tp = &uporttable[i & (HASHNAMESIZE-1)]; tp->nxt; tp = tp->nxt)
-		if (tp->addr == i)
-			return (tp->name);
-
-	tp->addr = i;
-	tp->nxt = newhnamemem(ndo);
-
-	(void)snprintf(buf, sizeof(buf), "%u", i);
-	tp->name = strdup(buf);
-	if (tp->name == NULL)
-		(*ndo->ndo_error)(ndo, S_ERR_ND_MEM_ALLOC,
-				  "udpport_string: strdup(buf)");
-	return (tp->name);
+	return (name != NAME_ARENA_NONE ? name_arena_str(&port_names, name) :
+	    portnumber_string(ndo, port));
 }
 
 const char *
@@ -785,14 +1638,13 @@ ipxsap_string(netdissect_options *ndo, u_short port)
 	char *cp;
 	struct hnamemem *tp;
 	uint32_t i = port;
+	uint32_t name;
 	char buf[sizeof("0000")];
 
-	for (tp = &ipxsaptable[i & (HASHNAMESIZE-1)]; tp->nxt; tp = tp->nxt)
-		if (tp->addr == i)
-			return (tp->name);
-
-	tp->addr = i;
-	tp->nxt = newhnamemem(ndo);
+	NEED_TABLES(ndo, TABLE_IPXSAP);
+	tp = lookup_hmem(&ipxsaptable, i);
+	if (tp != NULL)
+		return (ADDR_NAME(tp->name));
 
 	cp = buf;
 	NTOHS(port);
@@ -801,138 +1653,40 @@ ipxsap_string(netdissect_options *ndo, u_short port)
 	*cp++ = hex[port >> 4 & 0xf];
 	*cp++ = hex[port & 0xf];
 	*cp++ = '\0';
-	tp->name = strdup(buf);
-	if (tp->name == NULL)
-		(*ndo->ndo_error)(ndo, S_ERR_ND_MEM_ALLOC,
-				  "ipxsap_string: strdup(buf)");
-	return (tp->name);
+	name = addr_name_add(ndo, buf);
+	add_hmem(ndo, &ipxsaptable, i, name);
+	return (ADDR_NAME(name));
 }
 
 static void
 init_servarray(netdissect_options *ndo)
 {
 	struct servent *sv;
-	struct hnamemem *table;
-	int i;
-	char buf[sizeof("0000000000")];
+	uint32_t *table;
+
+	tportnames = (uint32_t *)calloc(NPORTS, sizeof(*tportnames));
+	uportnames = (uint32_t *)calloc(NPORTS, sizeof(*uportnames));
+	if (tportnames == NULL || uportnames == NULL)
+		(*ndo->ndo_error)(ndo, S_ERR_ND_MEM_ALLOC,
+				  "init_servarray: calloc");
 
 	while ((sv = getservent()) != NULL) {
-		int port = ntohs(sv->s_port);
-		i = port & (HASHNAMESIZE-1);
+		u_short port = ntohs(sv->s_port);
+
 		if (strcmp(sv->s_proto, "tcp") == 0)
-			table = &tporttable[i];
+			table = tportnames;
 		else if (strcmp(sv->s_proto, "udp") == 0)
-			table = &uporttable[i];
+			table = uportnames;
 		else
 			continue;
 
-		while (table->name)
-			table = table->nxt;
-		if (ndo->ndo_nflag) {
-			(void)snprintf(buf, sizeof(buf), "%d", port);
-			table->name = strdup(buf);
-		} else
-			table->name = strdup(sv->s_name);
-		if (table->name == NULL)
-			(*ndo->ndo_error)(ndo, S_ERR_ND_MEM_ALLOC,
-					  "init_servarray: strdup");
-
-		table->addr = port;
-		table->nxt = newhnamemem(ndo);
-	}
-	endservent();
-}
-
-static const struct eproto {
-	const char *s;
-	u_short p;
-} eproto_db[] = {
-	{ "pup", ETHERTYPE_PUP },
-	{ "xns", ETHERTYPE_NS },
-	{ "ip", ETHERTYPE_IP },
-	{ "ip6", ETHERTYPE_IPV6 },
-	{ "arp", ETHERTYPE_ARP },
-	{ "rarp", ETHERTYPE_REVARP },
-	{ "sprite", ETHERTYPE_SPRITE },
-	{ "mopdl", ETHERTYPE_MOPDL },
-	{ "moprc", ETHERTYPE_MOPRC },
-	{ "decnet", ETHERTYPE_DN },
-	{ "lat", ETHERTYPE_LAT },
-	{ "sca", ETHERTYPE_SCA },
-	{ "lanbridge", ETHERTYPE_LANBRIDGE },
-	{ "vexp", ETHERTYPE_VEXP },
-	{ "vprod", ETHERTYPE_VPROD },
-	{ "atalk", ETHERTYPE_ATALK },
-	{ "atalkarp", ETHERTYPE_AARP },
-	{ "loopback", ETHERTYPE_LOOPBACK },
-	{ "decdts", ETHERTYPE_DECDTS },
-	{ "decdns", ETHERTYPE_DECDNS },
-	{ (char *)0, 0 }
-};
-
-static void
-init_eprotoarray(netdissect_options *ndo)
-{
-	int i;
-	struct hnamemem *table;
-
-	for (i = 0; eproto_db[i].s; i++) {
-		int j = htons(eproto_db[i].p) & (HASHNAMESIZE-1);
-		table = &eprototable[j];
-		while (table->name)
-			table = table->nxt;
-		table->name = eproto_db[i].s;
-		table->addr = htons(eproto_db[i].p);
-		table->nxt = newhnamemem(ndo);
-	}
-}
-
-static const struct protoidlist {
-	const u_char protoid[5];
-	const char *name;
-} protoidlist[] = {
-	{{ 0x00, 0x00, 0x0c, 0x01, 0x07 }, "CiscoMLS" },
-	{{ 0x00, 0x00, 0x0c, 0x20, 0x00 }, "CiscoCDP" },
-	{{ 0x00, 0x00, 0x0c, 0x20, 0x01 }, "CiscoCGMP" },
-	{{ 0x00, 0x00, 0x0c, 0x20, 0x03 }, "CiscoVTP" },
-	{{ 0x00, 0xe0, 0x2b, 0x00, 0xbb }, "ExtremeEDP" },
-	{{ 0x00, 0x00, 0x00, 0x00, 0x00 }, NULL }
-};
-
-/*
- * SNAP proto IDs with org code 0:0:0 are actually encapsulated Ethernet
- * types.
- */
-static void
-init_protoidarray(netdissect_options *ndo)
-{
-	int i;
-	struct protoidmem *tp;
-	const struct protoidlist *pl;
-	u_char protoid[5];
-
-	protoid[0] = 0;
-	protoid[1] = 0;
-	protoid[2] = 0;
-	for (i = 0; eproto_db[i].s; i++) {
-		u_short etype = htons(eproto_db[i].p);
-
-		memcpy((char *)&protoid[3], (char *)&etype, 2);
-		tp = lookup_protoid(ndo, protoid);
-		tp->p_name = strdup(eproto_db[i].s);
-		if (tp->p_name == NULL)
-			(*ndo->ndo_error)(ndo, S_ERR_ND_MEM_ALLOC,
-				"init_protoidarray: strdup(eproto_db[i].s)");
-	}
-	/* Hardwire some SNAP proto ID names */
-	for (pl = protoidlist; pl->name != NULL; ++pl) {
-		tp = lookup_protoid(ndo, pl->protoid);
-		/* Don't override existing name */
-		if (tp->p_name != NULL)
+		/* As before, the first entry for a port wins. */
+		if (table[port] != NAME_ARENA_NONE)
 			continue;
-
-		tp->p_name = pl->name;
+		table[port] = name_arena_add(ndo, &port_names, sv->s_name,
+		    strlen(sv->s_name));
 	}
+	endservent();
 }
 
 static const struct etherlist {
@@ -973,10 +1727,7 @@ init_etherarray(netdissect_options *ndo)
 	if (fp != NULL) {
 		while ((ep = pcap_next_etherent(fp)) != NULL) {
 			tp = lookup_emem(ndo, ep->addr);
-			tp->e_name = strdup(ep->name);
-			if (tp->e_name == NULL)
-				(*ndo->ndo_error)(ndo, S_ERR_ND_MEM_ALLOC,
-					"init_etherarray: strdup(ep->addr)");
+			tp->e_name = addr_name_add(ndo, ep->name);
 		}
 		(void)fclose(fp);
 	}
@@ -986,7 +1737,7 @@ init_etherarray(netdissect_options *ndo)
 	for (el = etherlist; el->name != NULL; ++el) {
 		tp = lookup_emem(ndo, el->addr);
 		/* Don't override existing name */
-		if (tp->e_name != NULL)
+		if (tp->e_name != NAME_ARENA_NONE)
 			continue;
 
 #ifdef USE_ETHER_NTOHOST
@@ -994,14 +1745,11 @@ init_etherarray(netdissect_options *ndo)
 		 * Use YP/NIS version of name if available.
 		 */
 		if (ether_ntohost(name, (const struct ether_addr *)el->addr) == 0) {
-			tp->e_name = strdup(name);
-			if (tp->e_name == NULL)
-				(*ndo->ndo_error)(ndo, S_ERR_ND_MEM_ALLOC,
-					"init_etherarray: strdup(name)");
+			tp->e_name = addr_name_add(ndo, name);
 			continue;
 		}
 #endif
-		tp->e_name = el->name;
+		tp->e_name = addr_name_add(ndo, el->name);
 	}
 }
 
@@ -1229,17 +1977,10 @@ static void
 init_ipxsaparray(netdissect_options *ndo)
 {
 	int i;
-	struct hnamemem *table;
-
-	for (i = 0; ipxsap_db[i].s != NULL; i++) {
-		u_int j = htons(ipxsap_db[i].v) & (HASHNAMESIZE-1);
-		table = &ipxsaptable[j];
-		while (table->name)
-			table = table->nxt;
-		table->name = ipxsap_db[i].s;
-		table->addr = htons(ipxsap_db[i].v);
-		table->nxt = newhnamemem(ndo);
-	}
+
+	for (i = 0; ipxsap_db[i].s != NULL; i++)
+		add_hmem(ndo, &ipxsaptable, htons(ipxsap_db[i].v),
+		    addr_name_add(ndo, ipxsap_db[i].s));
 }
 
 /*
@@ -1261,75 +2002,102 @@ init_addrtoname(netdissect_options *ndo, uint32_t localnet, uint32_t mask)
 		 */
 		return;
 
-	init_etherarray(ndo);
 	init_servarray(ndo);
-	init_eprotoarray(ndo);
-	init_protoidarray(ndo);
-	init_ipxsaparray(ndo);
+	tables_wanted = TABLE_ETHER | TABLE_IPXSAP;
 }
 
-const char *
-dnaddr_string(netdissect_options *ndo, u_short dnaddr)
+/*
+ * Build the tables that init_addrtoname() left for the first lookup
+ * that needs them; "which" is a set of TABLE_ values.
+ */
+static void
+load_tables(netdissect_options *ndo, u_int which)
 {
-	struct hnamemem *tp;
+	which &= tables_wanted & ~tables_loaded;
+	tables_loaded |= which;
+	if (which & TABLE_ETHER)
+		init_etherarray(ndo);
+	if (which & TABLE_IPXSAP)
+		init_ipxsaparray(ndo);
+}
 
-	for (tp = &dnaddrtable[dnaddr & (HASHNAMESIZE-1)]; tp->nxt != NULL;
-	     tp = tp->nxt)
-		if (tp->addr == dnaddr)
-			return (tp->name);
+/*
+ * Build all of those tables now, e.g. before giving up the privileges
+ * needed to read the files they come from.
+ */
+void
+load_addrtoname_tables(netdissect_options *ndo)
+{
+	load_tables(ndo, TABLE_ETHER | TABLE_IPXSAP);
+}
 
-	tp->addr = dnaddr;
-	tp->nxt = newhnamemem(ndo);
-	tp->name = dnnum_string(ndo, dnaddr);
+/*
+ * The tables filled in by init_addrtoname(), other than the port
+ * names, are per-thread; these routines let a thread start out with
+ * its own copy of the tables another thread has initialized, rather
+ * than re-reading the files they come from (which might no longer be
+ * accessible, if we've chrooted).
+ */
+struct addrtoname_tables {
+	u_int loaded;
+	const struct nametable *ipxsaptable;
+	const struct nametable *enametable;
+	const struct name_arena *names;
+};
 
-	return(tp->name);
+/*
+ * Return the calling thread's tables; the result remains valid as
+ * long as that thread exists and does no more lookups.
+ */
+const struct addrtoname_tables *
+get_addrtoname_tables(void)
+{
+	static ND_THREAD_LOCAL struct addrtoname_tables tables;
+
+	tables.loaded = tables_loaded;
+	tables.ipxsaptable = &ipxsaptable;
+	tables.enametable = &enametable;
+	tables.names = &addr_names;
+	return (&tables);
 }
 
-/* Return a zero'ed hnamemem struct and cuts down on calloc() overhead */
-struct hnamemem *
-newhnamemem(netdissect_options *ndo)
+void
+copy_addrtoname_tables(netdissect_options *ndo,
+    const struct addrtoname_tables *tables)
 {
-	struct hnamemem *p;
-	static struct hnamemem *ptr = NULL;
-	static u_int num = 0;
-
-	if (num  <= 0) {
-		num = 64;
-		ptr = (struct hnamemem *)calloc(num, sizeof (*ptr));
-		if (ptr == NULL)
-			(*ndo->ndo_error)(ndo, S_ERR_ND_MEM_ALLOC,
-					  "newhnamemem: calloc");
-	}
-	--num;
-	p = ptr++;
-	return (p);
+	/* The names are offsets, which mean the same in the arena's copy. */
+	nametable_copy(ndo, &ipxsaptable, tables->ipxsaptable,
+	    sizeof(struct hnamemem));
+	nametable_copy(ndo, &enametable, tables->enametable,
+	    sizeof(struct enamemem));
+	name_arena_copy(ndo, &addr_names, tables->names);
+	tables_loaded = tables->loaded;
 }
 
-/* Return a zero'ed h6namemem struct and cuts down on calloc() overhead */
-struct h6namemem *
-newh6namemem(netdissect_options *ndo)
+const char *
+dnaddr_string(netdissect_options *ndo, u_short dnaddr)
 {
-	struct h6namemem *p;
-	static struct h6namemem *ptr = NULL;
-	static u_int num = 0;
-
-	if (num  <= 0) {
-		num = 64;
-		ptr = (struct h6namemem *)calloc(num, sizeof (*ptr));
-		if (ptr == NULL)
-			(*ndo->ndo_error)(ndo, S_ERR_ND_MEM_ALLOC,
-					  "newh6namemem: calloc");
-	}
-	--num;
-	p = ptr++;
-	return (p);
+	struct hnamemem *tp;
+	char *str;
+	uint32_t name;
+
+	tp = lookup_hmem(&dnaddrtable, dnaddr);
+	if (tp != NULL)
+		return (ADDR_NAME(tp->name));
+
+	str = dnnum_string(ndo, dnaddr);
+	name = addr_name_add(ndo, str);
+	free(str);
+	add_hmem(ndo, &dnaddrtable, dnaddr, name);
+
+	return (ADDR_NAME(name));
 }
 
 /* Represent TCI part of the 802.1Q 4-octet tag as text. */
 const char *
 ieee8021q_tci_string(const uint16_t tci)
 {
-	static char buf[128];
+	static ND_THREAD_LOCAL char buf[128];
 	snprintf(buf, sizeof(buf), "vlan %u, p %u%s",
 	         tci & 0xfff,
 	         tci >> 13,
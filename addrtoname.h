@@ -29,6 +29,14 @@
 #define INET6_ADDRSTRLEN	46
 #endif
 
+/*
+ * Host names can be looked up by a pool of threads (--resolver-threads)
+ * on platforms with POSIX threads.
+ */
+#if defined(HAVE_PTHREADS) && !defined(_WIN32)
+#define ASYNC_RESOLVER_SUPPORTED
+#endif
+
 /* Name to address translation routines. */
 
 enum {
@@ -51,11 +59,16 @@ extern const char *dnaddr_string(netdissect_options *, u_short);
 extern const char *ipxsap_string(netdissect_options *, u_short);
 extern const char *ipaddr_string(netdissect_options *, const u_char *);
 extern const char *ip6addr_string(netdissect_options *, const u_char *);
+extern void ipaddr_prefetch(const u_char *);
+extern void ip6addr_prefetch(const u_char *);
 extern const char *intoa(uint32_t);
 
 extern void init_addrtoname(netdissect_options *, uint32_t, uint32_t);
-extern struct hnamemem *newhnamemem(netdissect_options *);
-extern struct h6namemem *newh6namemem(netdissect_options *);
+extern int add_resolve_prefix(netdissect_options *, const char *);
+extern void load_addrtoname_tables(netdissect_options *);
+struct addrtoname_tables;
+extern const struct addrtoname_tables *get_addrtoname_tables(void);
+extern void copy_addrtoname_tables(netdissect_options *, const struct addrtoname_tables *);
 extern const char * ieee8021q_tci_string(const uint16_t);
 
 /* macro(s) and inline function(s) with setjmp/longjmp logic to call
@@ -68,7 +81,7 @@ get_linkaddr_string(netdissect_options *ndo, const uint8_t *p,
     const unsigned int type, const unsigned int len)
 {
         if (!ND_TTEST_LEN(p, len))
-                longjmp(ndo->ndo_truncated, 1);
+                ND_LONGJMP(ndo->ndo_truncated);
         return linkaddr_string(ndo, p, type, len);
 }
 
@@ -76,7 +89,7 @@ static inline const char *
 get_etheraddr_string(netdissect_options *ndo, const uint8_t *p)
 {
         if (!ND_TTEST_LEN(p, MAC_ADDR_LEN))
-                longjmp(ndo->ndo_truncated, 1);
+                ND_LONGJMP(ndo->ndo_truncated);
         return etheraddr_string(ndo, p);
 }
 
@@ -84,7 +97,7 @@ static inline const char *
 get_le64addr_string(netdissect_options *ndo, const u_char *p)
 {
         if (!ND_TTEST_8(p))
-                longjmp(ndo->ndo_truncated, 1);
+                ND_LONGJMP(ndo->ndo_truncated);
         return le64addr_string(ndo, p);
 }
 
@@ -93,7 +106,7 @@ get_isonsap_string(netdissect_options *ndo, const uint8_t *nsap,
     u_int nsap_length)
 {
 	if (!ND_TTEST_LEN(nsap, nsap_length))
-                longjmp(ndo->ndo_truncated, 1);
+                ND_LONGJMP(ndo->ndo_truncated);
         return isonsap_string(ndo, nsap, nsap_length);
 }
 
@@ -101,7 +114,7 @@ static inline const char *
 get_ipaddr_string(netdissect_options *ndo, const u_char *p)
 {
         if (!ND_TTEST_4(p))
-                longjmp(ndo->ndo_truncated, 1);
+                ND_LONGJMP(ndo->ndo_truncated);
         return ipaddr_string(ndo, p);
 }
 
@@ -109,7 +122,7 @@ static inline const char *
 get_ip6addr_string(netdissect_options *ndo, const u_char *p)
 {
         if (!ND_TTEST_16(p))
-                longjmp(ndo->ndo_truncated, 1);
+                ND_LONGJMP(ndo->ndo_truncated);
         return ip6addr_string(ndo, p);
 }
 
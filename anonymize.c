@@ -0,0 +1,518 @@
+/*
+ * Copyright (c) 2026 The TCPDUMP project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that: (1) source code
+ * distributions retain the above copyright notice and this paragraph
+ * in its entirety, and (2) distributions including binary code include
+ * the above copyright notice and this paragraph in its entirety in
+ * the documentation or other materials provided with the distribution.
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND
+ * WITHOUT ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, WITHOUT
+ * LIMITATION, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE.
+ */
+
+
+
+/*
+ * IPv4 and IPv6 addresses are mapped with Crypto-PAn (Xu, Fan, Ammar
+ * and Moon, "Prefix-Preserving IP Address Anonymization", ICNP 2002):
+ * bit i of the address is flipped by the first bit of the AES
+ * encryption of its first i bits padded out with a secret pad, so two
+ * addresses that share an n-bit prefix map to two that share one, and
+ * the same key gives the same mapping in every run.  That takes an AES
+ * block per bit, 32 for an IPv4 address and 128 for an IPv6 one, so
+ * the mappings are memoized in direct-mapped tables, in which the few
+ * addresses that make up most of the traffic cost a lookup; a miss
+ * just overwrites its slot.  Unicast MAC addresses are replaced with
+ * the first bytes of an AES block, made locally administered; group
+ * addresses are left alone.
+ *
+ * The TCP, UDP and ICMPv6 checksums, which cover the addresses, and
+ * the IPv4 header checksum are adjusted for the change of addresses as
+ * RFC 1624 describes, rather than computed afresh, so that they come
+ * out right even if the packet wasn't captured whole, and a checksum
+ * that was wrong stays as wrong.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include "netdissect-stdinc.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef HAVE_LIBCRYPTO
+#include <openssl/evp.h>
+#endif
+
+#include "netdissect-ctype.h"
+#include "netdissect.h"
+#include "extract.h"
+#include "ethertype.h"
+#include "ipproto.h"
+#include "anonymize.h"
+
+#ifdef HAVE_LIBCRYPTO
+
+#define ANON_MUL	0x9e3779b9U
+
+struct anon_v4_slot {
+	uint32_t addr;
+	uint32_t anon;
+	int	used;
+};
+
+struct anon_v6_slot {
+	u_char	addr[16];
+	u_char	anon[16];
+	int	used;
+};
+
+struct anon_mac_slot {
+	u_char	addr[6];
+	u_char	anon[6];
+	int	used;
+};
+
+struct anon_state {
+	EVP_CIPHER_CTX *ctx;
+	u_char	pad[16];		/* AES of the second half of the key */
+	struct anon_v4_slot *v4;
+	struct anon_v6_slot *v6;
+	struct anon_mac_slot *mac;
+	uint64_t lookups, misses;
+};
+
+#ifndef HAVE_EVP_CIPHER_CTX_NEW
+/*
+ * Allocate an EVP_CIPHER_CTX, for older versions of OpenSSL that
+ * don't provide routines to allocate and free them.
+ */
+static EVP_CIPHER_CTX *
+EVP_CIPHER_CTX_new(void)
+{
+	return ((EVP_CIPHER_CTX *)calloc(1, sizeof(EVP_CIPHER_CTX)));
+}
+
+static void
+EVP_CIPHER_CTX_free(EVP_CIPHER_CTX *ctx)
+{
+	EVP_CIPHER_CTX_cleanup(ctx);
+	free(ctx);
+}
+#endif
+
+/*
+ * Encrypt one block.
+ */
+static void
+anon_aes(struct anon_state *as, const u_char *in, u_char *out)
+{
+	int outl;
+
+	(void)EVP_EncryptUpdate(as->ctx, out, &outl, in, 16);
+}
+
+/*
+ * Map the "nbits"-bit address at "addr" to "out" with Crypto-PAn.
+ */
+static void
+anon_cryptopan(struct anon_state *as, const u_char *addr, u_char *out,
+    u_int nbits)
+{
+	u_char in[16], enc[16];
+	u_int pos, b;
+
+	memcpy(in, as->pad, 16);
+	memcpy(out, addr, nbits / 8);
+	for (pos = 0; pos < nbits; pos++) {
+		/*
+		 * The first pos bits of the address, then the pad.
+		 */
+		b = pos / 8;
+		if (pos % 8 == 0) {
+			if (b != 0)
+				in[b - 1] = addr[b - 1];
+		} else
+			in[b] = (addr[b] & (0xff00 >> (pos % 8))) |
+			    (as->pad[b] & (0xff >> (pos % 8)));
+		anon_aes(as, in, enc);
+		out[b] ^= (enc[0] & 0x80) >> (pos % 8);
+		if (pos % 8 == 7)
+			in[b] = as->pad[b];
+	}
+}
+
+static void
+anon_v4(struct anon_state *as, u_char *p)
+{
+	struct anon_v4_slot *s;
+	uint32_t a;
+
+	a = EXTRACT_BE_U_4(p);
+	s = &as->v4[(a * ANON_MUL) >> 16 & (ANON_V4_SLOTS - 1)];
+	as->lookups++;
+	if (!s->used || s->addr != a) {
+		u_char out[4];
+
+		as->misses++;
+		anon_cryptopan(as, p, out, 32);
+		s->addr = a;
+		s->anon = EXTRACT_BE_U_4(out);
+		s->used = 1;
+	}
+	p[0] = (u_char)(s->anon >> 24);
+	p[1] = (u_char)(s->anon >> 16);
+	p[2] = (u_char)(s->anon >> 8);
+	p[3] = (u_char)s->anon;
+}
+
+static void
+anon_v6(struct anon_state *as, u_char *p)
+{
+	struct anon_v6_slot *s;
+	uint32_t h;
+
+	h = (EXTRACT_BE_U_4(p) ^ EXTRACT_BE_U_4(p + 4)) * ANON_MUL;
+	h = (h ^ EXTRACT_BE_U_4(p + 8)) * ANON_MUL;
+	h = (h ^ EXTRACT_BE_U_4(p + 12)) * ANON_MUL;
+	s = &as->v6[h >> 16 & (ANON_V6_SLOTS - 1)];
+	as->lookups++;
+	if (!s->used || memcmp(s->addr, p, 16) != 0) {
+		as->misses++;
+		memcpy(s->addr, p, 16);
+		anon_cryptopan(as, p, s->anon, 128);
+		s->used = 1;
+	}
+	memcpy(p, s->anon, 16);
+}
+
+static void
+anon_mac(struct anon_state *as, u_char *p)
+{
+	struct anon_mac_slot *s;
+	uint32_t h;
+
+	if (p[0] & 0x01)
+		return;		/* group address */
+	h = (EXTRACT_BE_U_4(p) ^ EXTRACT_BE_U_2(p + 4)) * ANON_MUL;
+	s = &as->mac[h >> 16 & (ANON_MAC_SLOTS - 1)];
+	as->lookups++;
+	if (!s->used || memcmp(s->addr, p, 6) != 0) {
+		u_char in[16], enc[16];
+
+		as->misses++;
+		memcpy(in, as->pad, 16);
+		memcpy(in, p, 6);
+		anon_aes(as, in, enc);
+		memcpy(s->addr, p, 6);
+		memcpy(s->anon, enc, 6);
+		s->anon[0] = (s->anon[0] & 0xfc) | 0x02;
+		s->used = 1;
+	}
+	memcpy(p, s->anon, 6);
+}
+
+/*
+ * Adjust the checksum at "ck" for the "len" bytes at "old" having been
+ * changed to those at "new": with HC the checksum and m and m' the old
+ * and new data, RFC 1624's HC' = ~(~HC + ~m + m') is the checksum of
+ * ~HC, ~m and m'.  "udp" says that 0 means no checksum.
+ */
+static void
+anon_cksum(u_char *ck, const u_char *old, const u_char *new, u_int len,
+    int udp)
+{
+	u_char buf[2 + 2 * 32];
+	struct cksum_vec vec[1];
+	uint16_t sum;
+	u_int i;
+
+	if (udp && ck[0] == 0 && ck[1] == 0)
+		return;
+	buf[0] = ~ck[0];
+	buf[1] = ~ck[1];
+	for (i = 0; i < len; i++) {
+		buf[2 + i] = ~old[i];
+		buf[2 + len + i] = new[i];
+	}
+	vec[0].ptr = buf;
+	vec[0].len = 2 + 2 * len;
+	sum = in_cksum(vec, 1);
+	if (udp && sum == 0)
+		sum = 0xffff;
+	memcpy(ck, &sum, 2);	/* in_cksum() sums in memory order */
+}
+
+/*
+ * Find the transport-layer header after an IP header at "p", ending
+ * at "ep", with the IPv6 extension headers walked over; return it, or
+ * NULL if there's none, as for a later fragment, and set *protop.
+ */
+static u_char *
+anon_l4(u_char *p, const u_char *ep, u_int *protop)
+{
+	u_char *l4;
+	u_int proto;
+
+	if ((*p >> 4) == 4) {
+		if ((EXTRACT_BE_U_2(p + 6) & 0x1fff) != 0)
+			return (NULL);
+		*protop = p[9];
+		return (p + (p[0] & 0x0f) * 4);
+	}
+	proto = p[6];
+	l4 = p + 40;
+	for (;;) {
+		if (proto == IPPROTO_HOPOPTS || proto == IPPROTO_ROUTING ||
+		    proto == IPPROTO_DSTOPTS) {
+			if (ep - l4 < 2)
+				return (NULL);
+			proto = l4[0];
+			l4 += (l4[1] + 1) * 8;
+		} else if (proto == IPPROTO_FRAGMENT) {
+			if (ep - l4 < 8 ||
+			    (EXTRACT_BE_U_2(l4 + 2) & 0xfff8) != 0)
+				return (NULL);
+			proto = l4[0];
+			l4 += 8;
+		} else
+			break;
+	}
+	*protop = proto;
+	return (l4);
+}
+
+/*
+ * Anonymize the addresses in an IPv4 or IPv6 header at "p", ending at
+ * "ep", and fix up the checksums that cover them.
+ */
+static void
+anon_ip(struct anon_state *as, u_char *p, const u_char *ep)
+{
+	u_char old[32], *addrs, *l4;
+	u_int alen, proto;
+
+	switch (*p >> 4) {
+
+	case 4:
+		if (ep - p < 20 || (p[0] & 0x0f) < 5)
+			return;
+		addrs = p + 12;
+		alen = 8;
+		memcpy(old, addrs, alen);
+		anon_v4(as, addrs);
+		anon_v4(as, addrs + 4);
+		if (ep - p >= (p[0] & 0x0f) * 4)
+			anon_cksum(p + 10, old, addrs, alen, 0);
+		break;
+
+	case 6:
+		if (ep - p < 40)
+			return;
+		addrs = p + 8;
+		alen = 32;
+		memcpy(old, addrs, alen);
+		anon_v6(as, addrs);
+		anon_v6(as, addrs + 16);
+		break;
+
+	default:
+		return;
+	}
+
+	if ((l4 = anon_l4(p, ep, &proto)) == NULL)
+		return;
+	switch (proto) {
+
+	case IPPROTO_TCP:
+		if (ep - l4 >= 18)
+			anon_cksum(l4 + 16, old, addrs, alen, 0);
+		break;
+
+	case IPPROTO_UDP:
+		if (ep - l4 >= 8)
+			anon_cksum(l4 + 6, old, addrs, alen, 1);
+		break;
+
+	case IPPROTO_ICMPV6:
+		if (alen == 32 && ep - l4 >= 4)
+			anon_cksum(l4 + 2, old, addrs, alen, 0);
+		break;
+	}
+}
+
+static int
+anon_xdigit(char c)
+{
+	if (ND_ASCII_ISDIGIT(c))
+		return (c - '0');
+	if (c >= 'a' && c <= 'f')
+		return (c - 'a' + 10);
+	if (c >= 'A' && c <= 'F')
+		return (c - 'A' + 10);
+	return (-1);
+}
+
+/*
+ * Read the key, 64 hexadecimal digits, from the first line of "fname"
+ * and set up the cipher and the memo tables.
+ */
+struct anon_state *
+anon_new(const char *fname, char *errbuf)
+{
+	struct anon_state *as;
+	FILE *fp;
+	char line[256], *p;
+	u_char key[32];
+	u_int i;
+	int hi, lo;
+
+	fp = fopen(fname, "r");
+	if (fp == NULL) {
+		snprintf(errbuf, PCAP_ERRBUF_SIZE, "can't open %s: %s", fname,
+		    pcap_strerror(errno));
+		return (NULL);
+	}
+	if (fgets(line, sizeof(line), fp) == NULL)
+		line[0] = '\0';
+	fclose(fp);
+	line[strcspn(line, "\r\n")] = '\0';
+	for (p = line, i = 0; i < 32; i++, p += 2) {
+		if ((hi = anon_xdigit(p[0])) < 0 || (lo = anon_xdigit(p[1])) < 0)
+			break;
+		key[i] = (u_char)(hi << 4 | lo);
+	}
+	if (i != 32 || *p != '\0') {
+		snprintf(errbuf, PCAP_ERRBUF_SIZE,
+		    "%s: the key must be 64 hexadecimal digits", fname);
+		return (NULL);
+	}
+
+	as = (struct anon_state *)calloc(1, sizeof(*as));
+	if (as == NULL ||
+	    (as->v4 = (struct anon_v4_slot *)calloc(ANON_V4_SLOTS,
+	    sizeof(*as->v4))) == NULL ||
+	    (as->v6 = (struct anon_v6_slot *)calloc(ANON_V6_SLOTS,
+	    sizeof(*as->v6))) == NULL ||
+	    (as->mac = (struct anon_mac_slot *)calloc(ANON_MAC_SLOTS,
+	    sizeof(*as->mac))) == NULL ||
+	    (as->ctx = EVP_CIPHER_CTX_new()) == NULL) {
+		snprintf(errbuf, PCAP_ERRBUF_SIZE, "out of memory");
+		anon_free(as);
+		return (NULL);
+	}
+	if (!EVP_EncryptInit_ex(as->ctx, EVP_aes_128_ecb(), NULL, key,
+	    NULL)) {
+		snprintf(errbuf, PCAP_ERRBUF_SIZE, "can't set up AES");
+		anon_free(as);
+		return (NULL);
+	}
+	(void)EVP_CIPHER_CTX_set_padding(as->ctx, 0);
+	anon_aes(as, key + 16, as->pad);
+	memset(key, 0, sizeof(key));
+	return (as);
+}
+
+/*
+ * Anonymize the "caplen" bytes of the packet at "p", in place: the
+ * Ethernet addresses at the beginning if "ether" is set, and, at "off",
+ * the IPv4 or IPv6 header if "type" is ETHERTYPE_IP, ETHERTYPE_IPV6 or
+ * 0 (go by the version), or the addresses of an Ethernet/IPv4 ARP
+ * packet if it's ETHERTYPE_ARP.
+ */
+void
+anon_packet(struct anon_state *as, u_char *p, u_int caplen, int ether,
+    u_int off, u_int type)
+{
+	const u_char *ep = p + caplen;
+	u_char *l3 = p + off;
+
+	if (ether && caplen >= 12) {
+		anon_mac(as, p);
+		anon_mac(as, p + 6);
+	}
+	if (off >= caplen)
+		return;
+	switch (type) {
+
+	case 0:
+	case ETHERTYPE_IP:
+	case ETHERTYPE_IPV6:
+		anon_ip(as, l3, ep);
+		break;
+
+	case ETHERTYPE_ARP:
+		if (ep - l3 < 28 || EXTRACT_BE_U_2(l3) != 1 ||
+		    EXTRACT_BE_U_2(l3 + 2) != ETHERTYPE_IP ||
+		    l3[4] != 6 || l3[5] != 4)
+			break;
+		anon_mac(as, l3 + 8);
+		anon_v4(as, l3 + 14);
+		anon_mac(as, l3 + 18);
+		anon_v4(as, l3 + 24);
+		break;
+	}
+}
+
+/*
+ * Report how many address lookups there were and how many of them
+ * weren't memoized.
+ */
+void
+anon_cache_stats(const struct anon_state *as, uint64_t *lookupsp,
+    uint64_t *missesp)
+{
+	*lookupsp = as->lookups;
+	*missesp = as->misses;
+}
+
+void
+anon_free(struct anon_state *as)
+{
+	if (as == NULL)
+		return;
+	if (as->ctx != NULL)
+		EVP_CIPHER_CTX_free(as->ctx);
+	free(as->v4);
+	free(as->v6);
+	free(as->mac);
+	free(as);
+}
+
+#else /* HAVE_LIBCRYPTO */
+
+struct anon_state *
+anon_new(const char *fname _U_, char *errbuf)
+{
+	snprintf(errbuf, PCAP_ERRBUF_SIZE, "crypto code not compiled in");
+	return (NULL);
+}
+
+void
+anon_packet(struct anon_state *as _U_, u_char *p _U_, u_int caplen _U_,
+    int ether _U_, u_int off _U_, u_int type _U_)
+{
+}
+
+void
+anon_cache_stats(const struct anon_state *as _U_, uint64_t *lookupsp,
+    uint64_t *missesp)
+{
+	*lookupsp = 0;
+	*missesp = 0;
+}
+
+void
+anon_free(struct anon_state *as _U_)
+{
+}
+
+#endif /* HAVE_LIBCRYPTO */
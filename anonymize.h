@@ -0,0 +1,38 @@
+/*
+ * Copyright (c) 2026 The TCPDUMP project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that: (1) source code
+ * distributions retain the above copyright notice and this paragraph
+ * in its entirety, and (2) distributions including binary code include
+ * the above copyright notice and this paragraph in its entirety in
+ * the documentation or other materials provided with the distribution.
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND
+ * WITHOUT ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, WITHOUT
+ * LIMITATION, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE.
+ */
+
+
+
+/*
+ * Prefix-preserving address anonymization, for --anonymize.
+ */
+#ifndef anonymize_h
+#define anonymize_h
+
+#define ANON_V4_SLOTS	65536	/* memoized IPv4 addresses, a power of 2 */
+#define ANON_V6_SLOTS	16384	/* memoized IPv6 addresses, a power of 2 */
+#define ANON_MAC_SLOTS	4096	/* memoized MAC addresses, a power of 2 */
+
+struct anon_state;
+
+extern struct anon_state *anon_new(const char *, char *);
+extern void anon_packet(struct anon_state *, u_char *, u_int, int, u_int,
+    u_int);
+extern void anon_cache_stats(const struct anon_state *, uint64_t *,
+    uint64_t *);
+extern void anon_free(struct anon_state *);
+
+#endif /* anonymize_h */
@@ -0,0 +1,177 @@
+/*
+ * Copyright (c) 2026 The TCPDUMP project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that: (1) source code
+ * distributions retain the above copyright notice and this paragraph
+ * in its entirety, and (2) distributions including binary code include
+ * the above copyright notice and this paragraph in its entirety in
+ * the documentation or other materials provided with the distribution.
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND
+ * WITHOUT ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, WITHOUT
+ * LIMITATION, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include "netdissect-stdinc.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "netdissect.h"
+#include "addrtoname.h"
+#include "extract.h"
+#include "netdissect-state.h"
+#include "arp-watch.h"
+
+struct arp_neighbor {
+	u_char	af;			/* AF_INET or AF_INET6; 0 = unused */
+	u_char	addr[16];
+	u_char	mac[MAC_ADDR_LEN];
+	u_char	over;			/* reported over the rate this second */
+	uint32_t last_sec;		/* when it was last seen */
+	uint32_t rate_sec;		/* the second being counted */
+	u_int	rate_count;		/* packets in it */
+};
+
+struct arp_watch_table {
+	struct arp_neighbor *slots;	/* NULL if there was no room */
+	struct arp_watch_stats counts;
+};
+
+static void
+arp_watch_free(netdissect_options *ndo, void *arg)
+{
+	struct arp_watch_table *tab = (struct arp_watch_table *)arg;
+
+	nd_state_free(ndo, tab->slots);
+	free(tab);
+}
+
+static const struct nd_state_type arp_watch_state_type = {
+	arp_watch_free
+};
+
+static struct arp_watch_table *
+arp_watch_table(netdissect_options *ndo)
+{
+	struct arp_watch_table *tab;
+	void **slot;
+
+	slot = nd_state_slot(ndo, &arp_watch_state_type,
+	    &arp_watch_state_type);
+	if ((tab = (struct arp_watch_table *)*slot) == NULL) {
+		tab = (struct arp_watch_table *)calloc(1, sizeof(*tab));
+		if (tab == NULL)
+			(*ndo->ndo_error)(ndo, S_ERR_ND_MEM_ALLOC,
+			    "%s: calloc", __func__);
+		tab->slots = (struct arp_neighbor *)nd_state_calloc(ndo,
+		    ARP_WATCH_SLOTS, sizeof(*tab->slots));
+		*slot = tab;
+	}
+	return (tab);
+}
+
+/*
+ * The packet being dissected binds the address "addr" of family "af"
+ * to the MAC address "mac".  Return 1, having dropped the packet's
+ * line, if that's only a refresh of what's in the table, and 0, having
+ * printed why, if the packet is to be printed.
+ */
+int
+arp_watch(netdissect_options *ndo, int af, const u_char *addr,
+    const u_char *mac)
+{
+	struct arp_watch_table *tab;
+	struct arp_neighbor *b, *an;
+	u_char key[16], hw[MAC_ADDR_LEN];
+	uint32_t now = (uint32_t)ndo->ndo_packet_sec;
+	uint32_t h = 2166136261U;
+	u_int alen, i;
+
+	alen = af == AF_INET ? 4 : 16;
+	GET_CPY_BYTES(key, addr, alen);
+	GET_CPY_BYTES(hw, mac, MAC_ADDR_LEN);
+	tab = arp_watch_table(ndo);
+	if (tab->slots == NULL)
+		return (0);
+
+	h = (h ^ (u_int)af) * 16777619U;
+	for (i = 0; i < alen; i++)
+		h = (h ^ key[i]) * 16777619U;
+	b = &tab->slots[(h % (ARP_WATCH_SLOTS / ARP_WATCH_WAYS)) *
+	    ARP_WATCH_WAYS];
+	for (i = 0; i < ARP_WATCH_WAYS; i++)
+		if (b[i].af == af && memcmp(b[i].addr, key, alen) == 0)
+			break;
+
+	if (i == ARP_WATCH_WAYS) {
+		an = b;
+		for (i = 0; i < ARP_WATCH_WAYS; i++) {
+			if (b[i].af == 0) {
+				an = &b[i];
+				break;
+			}
+			if ((int32_t)(b[i].last_sec - an->last_sec) < 0)
+				an = &b[i];
+		}
+		if (an->af != 0)
+			tab->counts.aws_evicted++;
+		else
+			tab->counts.aws_bindings++;
+		an->af = (u_char)af;
+		memcpy(an->addr, key, alen);
+		memcpy(an->mac, hw, MAC_ADDR_LEN);
+		an->last_sec = an->rate_sec = now;
+		an->rate_count = 1;
+		an->over = 0;
+		tab->counts.aws_new++;
+		ND_PRINT("[new] ");
+		return (0);
+	}
+
+	an = &b[i];
+	an->last_sec = now;
+	if (an->rate_sec != now) {
+		an->rate_sec = now;
+		an->rate_count = 0;
+		an->over = 0;
+	}
+	an->rate_count++;
+	if (memcmp(an->mac, hw, MAC_ADDR_LEN) != 0) {
+		tab->counts.aws_moved++;
+		ND_PRINT("[moved from %s] ", etheraddr_string(ndo, an->mac));
+		memcpy(an->mac, hw, MAC_ADDR_LEN);
+		return (0);
+	}
+	if (an->rate_count > ndo->ndo_arp_watch && !an->over) {
+		an->over = 1;
+		tab->counts.aws_over_rate++;
+		ND_PRINT("[over %u/s] ", ndo->ndo_arp_watch);
+		return (0);
+	}
+	tab->counts.aws_refreshed++;
+	ndo->ndo_drop_line = 1;
+	return (1);
+}
+
+/*
+ * Report what --arp-watch has seen, for this ndo.
+ */
+void
+arp_watch_stats(netdissect_options *ndo, struct arp_watch_stats *stats)
+{
+	const struct arp_watch_table *tab;
+
+	tab = (const struct arp_watch_table *)*nd_state_slot(ndo,
+	    &arp_watch_state_type, &arp_watch_state_type);
+	if (tab != NULL)
+		*stats = tab->counts;
+	else
+		memset(stats, 0, sizeof(*stats));
+}
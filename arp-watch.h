@@ -0,0 +1,56 @@
+/*
+ * Copyright (c) 2026 The TCPDUMP project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that: (1) source code
+ * distributions retain the above copyright notice and this paragraph
+ * in its entirety, and (2) distributions including binary code include
+ * the above copyright notice and this paragraph in its entirety in
+ * the documentation or other materials provided with the distribution.
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND
+ * WITHOUT ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, WITHOUT
+ * LIMITATION, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE.
+ */
+
+#ifndef arp_watch_h
+#define arp_watch_h
+
+/*
+ * --arp-watch: a table of the IPv4 and IPv6 neighbors learned from ARP
+ * requests and replies and from IPv6 Neighbor Solicitations and
+ * Advertisements, each an address, the MAC address it was last bound
+ * to, when it was last seen and how many packets it has sent in the
+ * current second.  A packet that binds an address for the first time,
+ * binds it to a different MAC address, or is from a sender that has
+ * gone over the --arp-watch rate in this second, is printed, after
+ * "[new] ", "[moved from MAC] " or "[over N/s] "; anything else that
+ * binds an address only refreshes it, and isn't printed.  Packets that
+ * bind nothing, such as ARP probes and Duplicate Address Detection,
+ * are printed as usual.
+ *
+ * The table is of a fixed size, in buckets of ARP_WATCH_WAYS, and a new
+ * address takes the place of the one in its bucket seen the longest
+ * ago; it's the ndo's, as dissector state (see netdissect-state.h).
+ * The printers call arp_watch() before they print anything, and return
+ * at once if it returns 1.
+ */
+#define ARP_WATCH_DEFAULT_RATE	10	/* packets a second from a sender */
+#define ARP_WATCH_SLOTS		16384
+#define ARP_WATCH_WAYS		4
+
+struct arp_watch_stats {
+	u_int aws_bindings;		/* addresses in the table now */
+	uint64_t aws_new;		/* bindings printed as new */
+	uint64_t aws_moved;		/* to a different MAC address */
+	uint64_t aws_over_rate;		/* seconds a sender was over the rate */
+	uint64_t aws_refreshed;		/* packets not printed */
+	uint64_t aws_evicted;		/* addresses dropped for new ones */
+};
+
+extern int arp_watch(netdissect_options *, int, const u_char *,
+    const u_char *);
+extern void arp_watch_stats(netdissect_options *, struct arp_watch_stats *);
+
+#endif /* arp_watch_h */
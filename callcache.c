@@ -0,0 +1,273 @@
+/*
+ * Copyright (c) 2026 The TCPDUMP project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that: (1) source code
+ * distributions retain the above copyright notice and this paragraph
+ * in its entirety, and (2) distributions including binary code include
+ * the above copyright notice and this paragraph in its entirety in
+ * the documentation or other materials provided with the distribution.
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND
+ * WITHOUT ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, WITHOUT
+ * LIMITATION, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include "netdissect-stdinc.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "netdissect.h"
+#include "callcache.h"
+#include "netdissect-state.h"
+
+struct callcache {
+	struct callcache_type type;
+	u_char *ring;		/* "size" entries of type.cct_size bytes */
+	u_int size;		/* 0 if there was no room for any */
+	u_int next;		/* the entry to use next */
+	int *chains;
+	u_int mask;		/* chains - 1 */
+	u_int maxsize;		/* set by --mem-limit, 0 if none */
+	int dropped;		/* emptied by --mem-limit */
+};
+
+#define CC_ENTRY(cc, i) \
+	((struct callcache_entry *)(void *)((cc)->ring + \
+	    (size_t)(i) * (cc)->type.cct_size))
+#define CC_KEY(cc, e)	((const u_char *)(e) + (cc)->type.cct_keyoff)
+
+static u_int
+callcache_hash(const struct callcache *cc, const void *key)
+{
+	const u_char *p = (const u_char *)key;
+	uint32_t h = 2166136261U;
+	size_t i;
+
+	for (i = 0; i < cc->type.cct_keylen; i++)
+		h = (h ^ p[i]) * 16777619U;
+	h ^= h >> 15;
+	h *= 0x85ebca6bU;
+	h ^= h >> 13;
+	return (h & cc->mask);
+}
+
+static void
+callcache_free(netdissect_options *ndo, void *state)
+{
+	struct callcache *cc = (struct callcache *)state;
+
+	nd_state_free(ndo, cc->ring);
+	nd_state_free(ndo, cc->chains);
+	free(cc);
+}
+
+static const struct nd_state_type callcache_state_type = {
+	callcache_free
+};
+
+/*
+ * Give the cache as many of the entries asked for as the state budget
+ * has room for, down to CALLCACHE_MIN_SIZE; if there's no room even for
+ * that, the cache has none, and remembers nothing.
+ */
+static void
+callcache_fill(netdissect_options *ndo, struct callcache *cc)
+{
+	u_int size, n;
+
+	size = ndo->ndo_call_cache_size != 0 ?
+	    ndo->ndo_call_cache_size : CALLCACHE_DEFAULT_SIZE;
+	if (cc->maxsize != 0 && size > cc->maxsize)
+		size = cc->maxsize;
+	for (;;) {
+		for (n = 1; n < size && n < (1U << 30); n *= 2)
+			continue;
+		cc->ring = (u_char *)nd_state_calloc(ndo, size,
+		    cc->type.cct_size);
+		if (cc->ring != NULL) {
+			cc->chains = (int *)nd_state_calloc(ndo, n,
+			    sizeof(*cc->chains));
+			if (cc->chains != NULL)
+				break;
+			nd_state_free(ndo, cc->ring);
+			cc->ring = NULL;
+		}
+		if (size <= CALLCACHE_MIN_SIZE)
+			return;
+		size /= 2;
+		if (size < CALLCACHE_MIN_SIZE)
+			size = CALLCACHE_MIN_SIZE;
+	}
+	memset(cc->chains, 0xff, n * sizeof(*cc->chains));
+	cc->size = size;
+	cc->mask = n - 1;
+}
+
+static struct callcache *
+callcache_alloc(netdissect_options *ndo, const struct callcache_type *type)
+{
+	struct callcache *cc;
+
+	cc = (struct callcache *)calloc(1, sizeof(*cc));
+	if (cc == NULL)
+		(*ndo->ndo_error)(ndo, S_ERR_ND_MEM_ALLOC, "%s: calloc",
+		    __func__);
+	cc->type = *type;
+	/* Keep the entries aligned. */
+	cc->type.cct_size = (type->cct_size + 7) & ~(size_t)7;
+	callcache_fill(ndo, cc);
+	return (cc);
+}
+
+/*
+ * Enter a call with the key "key" in the ndo's cache of type "type",
+ * making the cache if there isn't one yet.  Returns the entry, zeroed
+ * apart from its key, for the caller to fill in the rest of, or NULL
+ * if the cache has no room for any.
+ */
+void *
+callcache_enter(netdissect_options *ndo, const struct callcache_type *type,
+    const void *key)
+{
+	struct callcache *cc;
+	struct callcache_entry *e;
+	void **slot;
+	int i, *ip;
+	u_int h;
+
+	slot = nd_state_slot(ndo, type, &callcache_state_type);
+	if ((cc = (struct callcache *)*slot) == NULL)
+		cc = (struct callcache *)(*slot = callcache_alloc(ndo, type));
+	if (cc->dropped) {
+		cc->dropped = 0;
+		callcache_fill(ndo, cc);
+	}
+	if (cc->size == 0)
+		return (NULL);
+	i = (int)cc->next;
+	if (++cc->next >= cc->size)
+		cc->next = 0;
+	e = CC_ENTRY(cc, i);
+	if (e->cce_used) {
+		/* Take the oldest call off its chain. */
+		ip = &cc->chains[callcache_hash(cc, CC_KEY(cc, e))];
+		while (*ip != i)
+			ip = &CC_ENTRY(cc, *ip)->cce_next;
+		*ip = e->cce_next;
+	}
+	memset(e, 0, cc->type.cct_size);
+	memcpy((u_char *)e + cc->type.cct_keyoff, key, cc->type.cct_keylen);
+	e->cce_used = 1;
+	e->cce_ts = ndo->ndo_packet_ts;
+	h = callcache_hash(cc, key);
+	e->cce_next = cc->chains[h];
+	cc->chains[h] = i;
+	return (e);
+}
+
+/*
+ * Find the newest call with the key "key" in the ndo's cache of type
+ * "type".  Returns NULL if there's none, or if it's too old.
+ */
+void *
+callcache_find(netdissect_options *ndo, const struct callcache_type *type,
+    const void *key)
+{
+	const struct callcache *cc;
+	struct callcache_entry *e;
+	int i;
+
+	cc = (const struct callcache *)*nd_state_slot(ndo, type,
+	    &callcache_state_type);
+	if (cc == NULL || cc->size == 0)
+		return (NULL);
+	for (i = cc->chains[callcache_hash(cc, key)]; i != -1;
+	    i = e->cce_next) {
+		e = CC_ENTRY(cc, i);
+		if (memcmp(CC_KEY(cc, e), key, cc->type.cct_keylen) != 0)
+			continue;
+		if (cc->type.cct_timeout != 0 &&
+		    ND_TS_SEC(ndo->ndo_packet_ts - e->cce_ts) >
+		    (nd_ts_t)cc->type.cct_timeout)
+			return (NULL);
+		return (e);
+	}
+	return (NULL);
+}
+
+static void
+callcache_add_usage(void *arg, void *state)
+{
+	const struct callcache *cc = (const struct callcache *)state;
+
+	*(size_t *)arg += sizeof(*cc);
+	if (cc->size != 0)
+		*(size_t *)arg += cc->size * cc->type.cct_size +
+		    (cc->mask + 1) * sizeof(*cc->chains);
+}
+
+size_t
+callcache_mem_usage(netdissect_options *ndo)
+{
+	size_t usage = 0;
+
+	nd_state_foreach(ndo, &callcache_state_type, callcache_add_usage,
+	    &usage);
+	return (usage);
+}
+
+struct callcache_reclaim {
+	netdissect_options *ndo;
+	uint64_t n;
+};
+
+/*
+ * Empty the cache, and have it come back, when the next call is
+ * entered, at half the size.
+ */
+static void
+callcache_drop(void *arg, void *state)
+{
+	struct callcache_reclaim *r = (struct callcache_reclaim *)arg;
+	struct callcache *cc = (struct callcache *)state;
+	u_int i;
+
+	if (cc->size == 0)
+		return;
+	for (i = 0; i < cc->size; i++)
+		if (CC_ENTRY(cc, i)->cce_used)
+			r->n++;
+	nd_state_free(r->ndo, cc->ring);
+	nd_state_free(r->ndo, cc->chains);
+	cc->ring = NULL;
+	cc->chains = NULL;
+	cc->maxsize = cc->size > CALLCACHE_MIN_SIZE * 2 ?
+	    cc->size / 2 : CALLCACHE_MIN_SIZE;
+	cc->size = 0;
+	cc->next = 0;
+	cc->mask = 0;
+	cc->dropped = 1;
+}
+
+/*
+ * For --mem-limit.  A reply whose call has been thrown away is printed
+ * without what the call would have told, so the calls go after the
+ * host names, which can be looked up again.
+ */
+uint64_t
+callcache_mem_reclaim(netdissect_options *ndo, size_t want _U_)
+{
+	struct callcache_reclaim r;
+
+	r.ndo = ndo;
+	r.n = 0;
+	nd_state_foreach(ndo, &callcache_state_type, callcache_drop, &r);
+	return (r.n);
+}
@@ -0,0 +1,64 @@
+/*
+ * Copyright (c) 2026 The TCPDUMP project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that: (1) source code
+ * distributions retain the above copyright notice and this paragraph
+ * in its entirety, and (2) distributions including binary code include
+ * the above copyright notice and this paragraph in its entirety in
+ * the documentation or other materials provided with the distribution.
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND
+ * WITHOUT ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, WITHOUT
+ * LIMITATION, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE.
+ */
+
+#ifndef callcache_h
+#define callcache_h
+
+/*
+ * A cache of recent calls, for printers that need to know about the
+ * request to make sense of the reply, such as the NFS, RX and ISAKMP
+ * printers.
+ *
+ * A printer's entries are structures of its own that start with a
+ * struct callcache_entry and hold, somewhere in them, a key of a fixed
+ * size that the call is found by; any padding in the key must be zeroed.
+ * The entries are kept in a ring, of ndo_call_cache_size entries or
+ * CALLCACHE_DEFAULT_SIZE if that's 0, so that a new call replaces the
+ * oldest one, and on hash chains, newest first, so that a call is found
+ * without looking through the others and a repeated call is found
+ * before the one it repeats.  A call more than the cache's timeout
+ * older than the packet being looked at isn't found, unless the
+ * timeout is 0.
+ *
+ * The cache is allocated by callcache_enter() when the first call is
+ * entered, and kept in the ndo's state, with the printer's
+ * callcache_type as its key; if the state budget hasn't room for the
+ * full size, it gets fewer entries, down to CALLCACHE_MIN_SIZE, or none,
+ * in which case callcache_enter() returns NULL.
+ */
+#define CALLCACHE_DEFAULT_SIZE	16384
+#define CALLCACHE_MIN_SIZE	64
+
+struct callcache_entry {
+	int cce_next;		/* next on the hash chain, or -1 */
+	u_int cce_used;		/* 0 if the entry has never been used */
+	nd_ts_t cce_ts;		/* time stamp of the call */
+};
+
+/* Describes a printer's entries */
+struct callcache_type {
+	size_t cct_size;	/* size of an entry */
+	size_t cct_keyoff;	/* offset of the key in an entry */
+	size_t cct_keylen;	/* size of the key */
+	u_int cct_timeout;	/* seconds, 0 for none */
+};
+
+extern void *callcache_enter(netdissect_options *,
+    const struct callcache_type *, const void *);
+extern void *callcache_find(netdissect_options *,
+    const struct callcache_type *, const void *);
+
+#endif /* callcache_h */
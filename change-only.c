@@ -0,0 +1,169 @@
+/*
+ * Copyright (c) 2026 The TCPDUMP project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that: (1) source code
+ * distributions retain the above copyright notice and this paragraph
+ * in its entirety, and (2) distributions including binary code include
+ * the above copyright notice and this paragraph in its entirety in
+ * the documentation or other materials provided with the distribution.
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND
+ * WITHOUT ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, WITHOUT
+ * LIMITATION, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include "netdissect-stdinc.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "netdissect.h"
+#include "extract.h"
+#include "netdissect-state.h"
+#include "change-only.h"
+
+#define CHANGE_CHAINS		1024
+#define CHANGE_MAX_SENDERS	16384
+#define CHANGE_MAX_KEY		(16 + ND_CHANGE_MAX_ID)
+
+struct change_sender {
+	struct change_sender *next;	/* on its hash chain */
+	uint64_t hash;			/* of the last one shown */
+	u_int	repeats;		/* since then */
+	u_int	proto;
+	u_int	keylen;
+	u_char	key[CHANGE_MAX_KEY];	/* source address and ID */
+};
+
+struct change_table {
+	struct change_sender *chains[CHANGE_CHAINS];
+	u_int	count;
+};
+
+static void
+change_table_free(netdissect_options *ndo, void *arg)
+{
+	struct change_table *tab = (struct change_table *)arg;
+	struct change_sender *cs, *next;
+	u_int i;
+
+	for (i = 0; i < CHANGE_CHAINS; i++)
+		for (cs = tab->chains[i]; cs != NULL; cs = next) {
+			next = cs->next;
+			nd_state_free(ndo, cs);
+		}
+	free(tab);
+}
+
+static const struct nd_state_type change_state_type = {
+	change_table_free
+};
+
+/*
+ * Add the "len" bytes at "p" to the hash "h", or as many of them as
+ * were captured.
+ */
+uint64_t
+nd_change_hash(netdissect_options *ndo, uint64_t h, const u_char *p,
+	       u_int len)
+{
+	uint64_t w;
+
+	if (!ND_TTEST_LEN(p, len))
+		len = p < ndo->ndo_snapend ? ND_BYTES_AVAILABLE_AFTER(p) : 0;
+	h = (h ^ len) * ND_CHANGE_HASH_INIT;
+	for (; len >= 8; p += 8, len -= 8) {
+		memcpy(&w, p, 8);
+		h = (h ^ w) * ND_CHANGE_HASH_INIT;
+		h ^= h >> 29;
+	}
+	if (len != 0) {
+		w = 0;
+		memcpy(&w, p, len);
+		h = (h ^ w) * ND_CHANGE_HASH_INIT;
+		h ^= h >> 29;
+	}
+	return (h);
+}
+
+/*
+ * Is the packet of protocol "proto", from the sender with the "idlen"
+ * bytes of ID at "id", whose bytes that matter hash to "hash", the same
+ * as the last one from that sender?
+ */
+int
+nd_change_repeat(netdissect_options *ndo, u_int proto, const u_char *id,
+		 u_int idlen, uint64_t hash)
+{
+	struct change_table *tab;
+	struct change_sender *cs;
+	const u_char *iph = ndo->ndo_iph;
+	u_char key[CHANGE_MAX_KEY];
+	u_int keylen = 0, i;
+	uint32_t h = 2166136261U;
+	void **slot;
+
+	if (iph != NULL) {
+		if (IP_V((const struct ip *)iph) == 4) {
+			GET_CPY_BYTES(key, iph + 12, 4);
+			keylen = 4;
+		} else {
+			GET_CPY_BYTES(key, iph + 8, 16);
+			keylen = 16;
+		}
+	}
+	if (idlen > ND_CHANGE_MAX_ID)
+		idlen = ND_CHANGE_MAX_ID;
+	GET_CPY_BYTES(key + keylen, id, idlen);
+	keylen += idlen;
+
+	h = (h ^ proto) * 16777619U;
+	for (i = 0; i < keylen; i++)
+		h = (h ^ key[i]) * 16777619U;
+	h %= CHANGE_CHAINS;
+
+	slot = nd_state_slot(ndo, &change_state_type, &change_state_type);
+	if ((tab = (struct change_table *)*slot) == NULL) {
+		tab = (struct change_table *)calloc(1, sizeof(*tab));
+		if (tab == NULL)
+			(*ndo->ndo_error)(ndo, S_ERR_ND_MEM_ALLOC,
+			    "%s: calloc", __func__);
+		*slot = tab;
+	}
+	for (cs = tab->chains[h]; cs != NULL; cs = cs->next)
+		if (cs->proto == proto && cs->keylen == keylen &&
+		    memcmp(cs->key, key, keylen) == 0)
+			break;
+	if (cs != NULL) {
+		if (cs->hash == hash) {
+			cs->repeats++;
+			ndo->ndo_drop_line = 1;
+			return (1);
+		}
+		ND_PRINT("[changed after %u repeat%s] ", cs->repeats,
+		    PLURAL_SUFFIX(cs->repeats));
+		cs->hash = hash;
+		cs->repeats = 0;
+		return (0);
+	}
+
+	if (tab->count >= CHANGE_MAX_SENDERS)
+		return (0);
+	cs = (struct change_sender *)nd_state_calloc(ndo, 1, sizeof(*cs));
+	if (cs == NULL)
+		return (0);
+	cs->hash = hash;
+	cs->proto = proto;
+	cs->keylen = keylen;
+	memcpy(cs->key, key, keylen);
+	cs->next = tab->chains[h];
+	tab->chains[h] = cs;
+	tab->count++;
+	return (0);
+}
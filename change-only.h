@@ -0,0 +1,56 @@
+/*
+ * Copyright (c) 2026 The TCPDUMP project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that: (1) source code
+ * distributions retain the above copyright notice and this paragraph
+ * in its entirety, and (2) distributions including binary code include
+ * the above copyright notice and this paragraph in its entirety in
+ * the documentation or other materials provided with the distribution.
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND
+ * WITHOUT ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, WITHOUT
+ * LIMITATION, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE.
+ */
+
+#ifndef change_only_h
+#define change_only_h
+
+/*
+ * --changes-only: the hellos and advertisements that routers and
+ * bridges send every few seconds are shown only when they say
+ * something different from the last one from the same sender.
+ *
+ * A printer that takes part hashes the bytes of the packet that matter,
+ * leaving out sequence numbers, checksums and authentication data, with
+ * nd_change_hash(), and hands the hash, with its protocol and whatever
+ * identifies the sender within it, to nd_change_repeat() before it
+ * prints anything.  The sender is that, together with the source
+ * address of the IPv4 or IPv6 datagram the packet is in, if it's in
+ * one.  If the hash is the same as the last one, the packet's line is
+ * dropped, the repeat counted, and nd_change_repeat() returns 1, for
+ * the printer to return at once; otherwise it prints how many repeats
+ * there were since the last one shown, if there was a last one, and
+ * returns 0.
+ *
+ * Each ndo keeps its own table of senders, as dissector state (see
+ * netdissect-state.h); if it's full, packets from new senders are just
+ * shown.
+ */
+#define ND_CHANGE_STP		1
+#define ND_CHANGE_VRRP		2
+#define ND_CHANGE_HSRP		3
+#define ND_CHANGE_CARP		4
+#define ND_CHANGE_OSPF		5
+#define ND_CHANGE_EIGRP		6
+
+#define ND_CHANGE_HASH_INIT	0x9e3779b97f4a7c15ULL
+#define ND_CHANGE_MAX_ID	12	/* bytes of sender ID */
+
+extern uint64_t nd_change_hash(netdissect_options *, uint64_t,
+    const u_char *, u_int);
+extern int nd_change_repeat(netdissect_options *, u_int, const u_char *,
+    u_int, uint64_t);
+
+#endif /* change_only_h */
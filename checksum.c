@@ -29,6 +29,17 @@
 #include <assert.h>
 
 #include "netdissect.h"
+#include "extract.h"
+#include "compiler-tests.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__)) && \
+    (ND_IS_AT_LEAST_GNUC_VERSION(4,9) || defined(__clang__))
+#include <nmmintrin.h>
+#define CRC32C_SSE42
+#elif defined(__GNUC__) && defined(__ARM_FEATURE_CRC32)
+#include <arm_acle.h>
+#define CRC32C_ARM
+#endif
 
 /*
  * CRC-10 table generated using the following Python snippet:
@@ -123,17 +134,190 @@ verify_crc10_cksum(uint16_t accum, const u_char *p, int length)
     return accum;
 }
 
+/*
+ * CRC-32C (Castagnoli), as used by SCTP (RFC 3309) and iSCSI, computed
+ * LSB-first with the reflected polynomial; crc32c_table[k][i] is the
+ * CRC of byte i followed by k zero bytes, so that 8 bytes can be done
+ * with 8 independent table lookups ("slicing-by-8").
+ */
+#define CRC32C_POLYNOMIAL 0x82f63b78
+
+static uint32_t crc32c_table[8][256];
+
+static void
+init_crc32c_table(void)
+{
+    int i, j, k;
+    uint32_t accum;
+
+    for ( i = 0;  i < 256;  i++ )
+    {
+        accum = (uint32_t)i;
+        for ( j = 0;  j < 8;  j++ )
+        {
+            accum = (accum >> 1) ^ ((accum & 1) ? CRC32C_POLYNOMIAL : 0);
+        }
+        crc32c_table[0][i] = accum;
+    }
+    for ( k = 1;  k < 8;  k++ )
+    {
+        for ( i = 0;  i < 256;  i++ )
+        {
+            accum = crc32c_table[k - 1][i];
+            crc32c_table[k][i] = (accum >> 8) ^ crc32c_table[0][accum & 0xff];
+        }
+    }
+}
+
+static uint32_t
+crc32c_cksum_sliced(uint32_t crc, const u_char *p, u_int length)
+{
+    uint32_t hi;
+
+    while (length >= 8)
+    {
+        crc ^= EXTRACT_LE_U_4(p);
+        hi = EXTRACT_LE_U_4(p + 4);
+        crc = crc32c_table[7][crc & 0xff] ^
+              crc32c_table[6][(crc >> 8) & 0xff] ^
+              crc32c_table[5][(crc >> 16) & 0xff] ^
+              crc32c_table[4][crc >> 24] ^
+              crc32c_table[3][hi & 0xff] ^
+              crc32c_table[2][(hi >> 8) & 0xff] ^
+              crc32c_table[1][(hi >> 16) & 0xff] ^
+              crc32c_table[0][hi >> 24];
+        p += 8;
+        length -= 8;
+    }
+    while (length-- != 0)
+        crc = crc32c_table[0][(crc ^ *p++) & 0xff] ^ (crc >> 8);
+    return crc;
+}
+
+#ifdef CRC32C_SSE42
+/* SSE4.2 has an instruction for CRC-32C. */
+__attribute__((target("sse4.2")))
+static uint32_t
+crc32c_cksum_sse42(uint32_t crc, const u_char *p, u_int length)
+{
+#ifdef __x86_64__
+    uint64_t crc64 = crc, w64;
+
+    while (length >= 8)
+    {
+        memcpy(&w64, p, 8);
+        crc64 = _mm_crc32_u64(crc64, w64);
+        p += 8;
+        length -= 8;
+    }
+    crc = (uint32_t)crc64;
+#else
+    uint32_t w32;
+
+    while (length >= 4)
+    {
+        memcpy(&w32, p, 4);
+        crc = _mm_crc32_u32(crc, w32);
+        p += 4;
+        length -= 4;
+    }
+#endif
+    while (length-- != 0)
+        crc = _mm_crc32_u8(crc, *p++);
+    return crc;
+}
+#endif
+
+#ifdef CRC32C_ARM
+/* So does ARMv8, if the compiler has been told the CPU has it. */
+static uint32_t
+crc32c_cksum_arm(uint32_t crc, const u_char *p, u_int length)
+{
+    uint64_t w64;
+
+    while (length >= 8)
+    {
+        memcpy(&w64, p, 8);
+        crc = __crc32cd(crc, w64);
+        p += 8;
+        length -= 8;
+    }
+    while (length-- != 0)
+        crc = __crc32cb(crc, *p++);
+    return crc;
+}
+#endif
+
+/*
+ * Update a CRC-32C with the given data.  The caller starts with
+ * 0xffffffff and complements the result, as the users of CRC-32C do.
+ */
+uint32_t
+crc32c_cksum(uint32_t crc, const u_char *p, u_int length)
+{
+#if defined(CRC32C_SSE42)
+    if (__builtin_cpu_supports("sse4.2"))
+        return crc32c_cksum_sse42(crc, p, length);
+#elif defined(CRC32C_ARM)
+    return crc32c_cksum_arm(crc, p, length);
+#endif
+    return crc32c_cksum_sliced(crc, p, length);
+}
+
 /* precompute checksum tables */
 void
 init_checksum(void) {
 
     init_crc10_table();
+    init_crc32c_table();
 
 }
 
+/*
+ * The largest run of bytes whose Fletcher sums can be taken in 32 bits
+ * without a modulo, starting from sums below 255: c1 grows as
+ * 255 * n * (n + 1) / 2.
+ */
+#define OSI_CKSUM_BLOCK 5800
+
+/*
+ * Add "length" bytes at "p" to the Fletcher sums "c0" and "c1", and
+ * leave them below 255.  Eight bytes at a time, c1 gains eight times c0
+ * plus each byte weighted by how many of the eight sums it's in, which
+ * takes the byte-by-byte dependency of c1 on c0 out of the loop.
+ */
+static void
+osi_cksum_update(uint32_t *c0p, uint32_t *c1p, const uint8_t *p,
+                 u_int length)
+{
+    uint32_t c0 = *c0p, c1 = *c1p;
+    u_int n;
+
+    while (length != 0) {
+        n = length < OSI_CKSUM_BLOCK ? length : OSI_CKSUM_BLOCK;
+        length -= n;
+        while (n >= 8) {
+            c1 += 8 * c0 + 8 * p[0] + 7 * p[1] + 6 * p[2] + 5 * p[3] +
+                  4 * p[4] + 3 * p[5] + 2 * p[6] + p[7];
+            c0 += p[0] + p[1] + p[2] + p[3] + p[4] + p[5] + p[6] + p[7];
+            p += 8;
+            n -= 8;
+        }
+        while (n-- != 0) {
+            c0 += *p++;
+            c1 += c0;
+        }
+        c0 %= 255;
+        c1 %= 255;
+    }
+    *c0p = c0;
+    *c1p = c1;
+}
+
 /*
  * Creates the OSI Fletcher checksum. See 8473-1, Appendix C, section C.3.
  * The checksum field of the passed PDU does not need to be reset to zero.
+ * OSPF uses the same checksum for LSAs, RFC 2328 section 12.1.7.
  */
 uint16_t
 create_osi_cksum (const uint8_t *pptr, int checksum_offset, int length)
@@ -145,27 +329,26 @@ create_osi_cksum (const uint8_t *pptr, int checksum_offset, int length)
     uint32_t c0;
     uint32_t c1;
     uint16_t checksum;
-    int idx;
+    u_int before, field;
 
     c0 = 0;
     c1 = 0;
 
-    for (idx = 0; idx < length; idx++) {
-        /*
-         * Ignore the contents of the checksum field.
-         */
-        if (idx == checksum_offset ||
-            idx == checksum_offset+1) {
-            c1 += c0;
-            pptr++;
-        } else {
-            c0 = c0 + *(pptr++);
-            c1 += c0;
-        }
-    }
-
-    c0 = c0 % 255;
-    c1 = c1 % 255;
+    /*
+     * Sum the bytes before and after the checksum field, which counts
+     * as zeroes.
+     */
+    if (length < 0)
+        length = 0;
+    if (checksum_offset >= 0 && checksum_offset < length)
+        before = (u_int)checksum_offset;
+    else
+        before = (u_int)length;
+    field = (u_int)length - before < 2 ? (u_int)length - before : 2;
+    osi_cksum_update(&c0, &c1, pptr, before);
+    c1 = (c1 + field * c0) % 255;
+    osi_cksum_update(&c0, &c1, pptr + before + field,
+                     (u_int)length - before - field);
 
     mul = (length - checksum_offset)*(c0);
 
@@ -182,8 +365,13 @@ create_osi_cksum (const uint8_t *pptr, int checksum_offset, int length)
     if (x == 0) x = 255;
     if (y == 0) y = 255;
 
+    /*
+     * x may still be negative; take its low-order byte as the
+     * two's-complement bits, rather than shifting a negative value.
+     */
+    x &= 0x00FF;
     y &= 0x00FF;
-    checksum = ((x << 8) | y);
+    checksum = (uint16_t)((x << 8) | y);
 
     return checksum;
 }
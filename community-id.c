@@ -0,0 +1,226 @@
+/*
+ * Copyright (c) 2026 The TCPDUMP project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that: (1) source code
+ * distributions retain the above copyright notice and this paragraph
+ * in its entirety, and (2) distributions including binary code include
+ * the above copyright notice and this paragraph in its entirety in
+ * the documentation or other materials provided with the distribution.
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND
+ * WITHOUT ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, WITHOUT
+ * LIMITATION, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include "netdissect-stdinc.h"
+
+#include <string.h>
+
+#ifdef HAVE_LIBCRYPTO
+#include <openssl/sha.h>
+#endif
+
+#include "netdissect.h"
+#include "netdissect-fields.h"
+#include "extract.h"
+#include "ipproto.h"
+#include "community-id.h"
+
+#ifdef HAVE_LIBCRYPTO
+
+static const char community_b64[] =
+	"ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+/*
+ * The ICMP and ICMPv6 types that have a reply, or a request, as the
+ * other side of the flow; the type and that other type stand in for
+ * the ports, and packets of any other type are a flow of their own,
+ * with the type and code as the ports.
+ */
+struct community_icmp_pair {
+	uint8_t type;
+	uint8_t other;
+};
+
+static const struct community_icmp_pair community_icmp_pairs[] = {
+	{ 8, 0 },	/* echo, echo reply */
+	{ 0, 8 },
+	{ 13, 14 },	/* timestamp, timestamp reply */
+	{ 14, 13 },
+	{ 15, 16 },	/* information request, reply */
+	{ 16, 15 },
+	{ 10, 9 },	/* router solicitation, advertisement */
+	{ 9, 10 },
+	{ 17, 18 },	/* address mask request, reply */
+	{ 18, 17 },
+	{ 0, 0 }
+};
+
+static const struct community_icmp_pair community_icmp6_pairs[] = {
+	{ 128, 129 },	/* echo request, echo reply */
+	{ 129, 128 },
+	{ 133, 134 },	/* router solicitation, advertisement */
+	{ 134, 133 },
+	{ 135, 136 },	/* neighbor solicitation, advertisement */
+	{ 136, 135 },
+	{ 130, 131 },	/* multicast listener query, report */
+	{ 131, 130 },
+	{ 144, 145 },	/* home agent address discovery request, reply */
+	{ 145, 144 },
+	{ 139, 140 },	/* node information query, response */
+	{ 140, 139 },
+	{ 0, 0 }
+};
+
+/*
+ * The other side's type of an ICMP type, as a port, or -1 if it has none.
+ */
+static int
+community_icmp_other(const struct community_icmp_pair *p, uint8_t type)
+{
+	for (; p->type != 0 || p->other != 0; p++)
+		if (p->type == type)
+			return (p->other);
+	return (-1);
+}
+
+/*
+ * Hash the flow of the datagram with IP version "ver", header "iph" and
+ * payload "bp" of protocol "proto", if this is the first one for the
+ * packet, so that tunnelled datagrams and those quoted in ICMP errors
+ * don't replace the outermost one's; report the hash, and keep it for
+ * print.c to put at the end of the line.
+ *
+ * ip_print() and ip6_print() have already checked that the header was
+ * captured, and a reassembled datagram's is a copy outside the packet,
+ * so its addresses are read without bounds checks; the ports aren't.
+ */
+void
+community_id(netdissect_options *ndo, u_int ver, const u_char *iph,
+    uint8_t proto, const u_char *bp)
+{
+	u_char in[2 + 16 + 16 + 2 + 4];
+	u_char md[SHA_DIGEST_LENGTH];
+	const u_char *src, *dst;
+	const struct community_icmp_pair *pairs;
+	u_int alen, sport, dport, n, i, v;
+	int ported, oneway, other, c;
+	char *out;
+
+	if (ndo->ndo_community_id_str[0] != '\0')
+		return;
+	if (ver == 4) {
+		src = iph + 12;
+		dst = iph + 16;
+		alen = 4;
+	} else {
+		src = iph + 8;
+		dst = iph + 24;
+		alen = 16;
+	}
+
+	ported = 0;
+	oneway = 0;
+	sport = dport = 0;
+	switch (proto) {
+
+	case IPPROTO_TCP:
+	case IPPROTO_UDP:
+	case IPPROTO_SCTP:
+		if (!ND_TTEST_4(bp))
+			return;
+		sport = EXTRACT_BE_U_2(bp);
+		dport = EXTRACT_BE_U_2(bp + 2);
+		ported = 1;
+		break;
+
+	case IPPROTO_ICMP:
+	case IPPROTO_ICMPV6:
+		if (!ND_TTEST_2(bp))
+			return;
+		pairs = (proto == IPPROTO_ICMP) ?
+		    community_icmp_pairs : community_icmp6_pairs;
+		sport = EXTRACT_U_1(bp);
+		other = community_icmp_other(pairs, (uint8_t)sport);
+		if (other >= 0)
+			dport = (u_int)other;
+		else {
+			dport = EXTRACT_U_1(bp + 1);
+			oneway = 1;
+		}
+		ported = 1;
+		break;
+	}
+
+	/*
+	 * Put the lower address, or the lower port if the addresses are
+	 * the same, first, so that both directions hash the same.
+	 */
+	c = memcmp(src, dst, alen);
+	if (!oneway && (c > 0 || (c == 0 && sport > dport))) {
+		const u_char *t = src;
+
+		src = dst;
+		dst = t;
+		i = sport;
+		sport = dport;
+		dport = i;
+	}
+
+	n = 0;
+	in[n++] = (u_char)(ndo->ndo_community_seed >> 8);
+	in[n++] = (u_char)ndo->ndo_community_seed;
+	memcpy(in + n, src, alen);
+	n += alen;
+	memcpy(in + n, dst, alen);
+	n += alen;
+	in[n++] = proto;
+	in[n++] = 0;
+	if (ported) {
+		in[n++] = (u_char)(sport >> 8);
+		in[n++] = (u_char)sport;
+		in[n++] = (u_char)(dport >> 8);
+		in[n++] = (u_char)dport;
+	}
+	SHA1(in, n, md);
+
+	out = ndo->ndo_community_id_str;
+	*out++ = '1';
+	*out++ = ':';
+	for (i = 0; i < SHA_DIGEST_LENGTH; i += 3) {
+		v = (u_int)md[i] << 16;
+		if (i + 1 < SHA_DIGEST_LENGTH)
+			v |= (u_int)md[i + 1] << 8;
+		if (i + 2 < SHA_DIGEST_LENGTH)
+			v |= md[i + 2];
+		*out++ = community_b64[(v >> 18) & 0x3f];
+		*out++ = community_b64[(v >> 12) & 0x3f];
+		*out++ = (i + 1 < SHA_DIGEST_LENGTH) ?
+		    community_b64[(v >> 6) & 0x3f] : '=';
+		*out++ = (i + 2 < SHA_DIGEST_LENGTH) ?
+		    community_b64[v & 0x3f] : '=';
+	}
+	*out = '\0';
+	ND_FIELD_STRING(NDF_FRAME, NDF_FRAME_COMMUNITY_ID,
+	    ndo->ndo_community_id_str);
+}
+
+#else /* HAVE_LIBCRYPTO */
+
+/*
+ * tcpdump refuses --community-id without libcrypto, so this is never
+ * asked for anything.
+ */
+void
+community_id(netdissect_options *ndo _U_, u_int ver _U_,
+    const u_char *iph _U_, uint8_t proto _U_, const u_char *bp _U_)
+{
+}
+
+#endif /* HAVE_LIBCRYPTO */
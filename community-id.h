@@ -0,0 +1,31 @@
+/*
+ * Copyright (c) 2026 The TCPDUMP project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that: (1) source code
+ * distributions retain the above copyright notice and this paragraph
+ * in its entirety, and (2) distributions including binary code include
+ * the above copyright notice and this paragraph in its entirety in
+ * the documentation or other materials provided with the distribution.
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND
+ * WITHOUT ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, WITHOUT
+ * LIMITATION, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE.
+ */
+
+#ifndef community_id_h
+#define community_id_h
+
+/*
+ * Community ID flow hashes, version 1, for --community-id: "1:" and the
+ * base64 of the SHA-1 of the seed, the addresses, the protocol and the
+ * ports, in the same order for both directions of the flow, so that
+ * other tools hashing the same flow get the same string.
+ */
+#define COMMUNITY_ID_LEN	31	/* "1:" + 28 base64 characters + '\0' */
+
+extern void community_id(netdissect_options *, u_int, const u_char *,
+    uint8_t, const u_char *);
+
+#endif /* community_id_h */
@@ -0,0 +1,954 @@
+/*
+ * Copyright (c) 2026 The TCPDUMP project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that: (1) source code
+ * distributions retain the above copyright notice and this paragraph
+ * in its entirety, and (2) distributions including binary code include
+ * the above copyright notice and this paragraph in its entirety in
+ * the documentation or other materials provided with the distribution.
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND
+ * WITHOUT ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, WITHOUT
+ * LIMITATION, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE.
+ */
+
+
+/*
+ * A savefile compressed with gzip or zstd is read through a standard
+ * I/O stream whose reads come from a decompressor, so that libpcap
+ * reads it as it would the uncompressed file, and -r and -V don't need
+ * it decompressed to a temporary file, or through a pipe, first.
+ *
+ * The decompressed data is produced in "units" that go into a ring of
+ * slots, which the stream's reads take in order.  A gzip member that
+ * carries its own compressed size, as the members of a BGZF file do,
+ * and a zstd frame that fits in CR_FRAME_MAX bytes, can be decompressed
+ * on their own; the unit is then the compressed member or frame, and,
+ * with more than one thread, the units are decompressed by that many
+ * worker threads at once while another thread reads the file and finds
+ * where they start.  Anything else, such as an ordinary gzip file, or a
+ * zstd file written as one large frame by default, has to be
+ * decompressed from start to end; it's decompressed by the thread that
+ * reads the file, a CR_CHUNK at a time, which still takes the
+ * decompression off the thread that dissects the packets.
+ *
+ * Without pthreads, the units are decompressed by the reads.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#ifdef HAVE_FOPENCOOKIE
+#define _GNU_SOURCE	/* for fopencookie() */
+#endif
+
+#include "netdissect-stdinc.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <pcap.h>
+
+#include "compressed-reader.h"
+
+#ifdef COMPRESSED_READER_SUPPORTED
+
+#include <unistd.h>
+#ifdef HAVE_PTHREADS
+#include <pthread.h>
+#endif
+
+#if defined(HAVE_LIBZ) && defined(HAVE_ZLIB_H)
+#define CR_GZIP_SUPPORTED
+#include <zlib.h>
+#endif
+#if defined(HAVE_LIBZSTD) && defined(HAVE_ZSTD_H)
+#define CR_ZSTD_SUPPORTED
+#include <zstd.h>
+#endif
+
+#define CR_GZIP		1
+#define CR_ZSTD		2
+
+#define CR_READSIZE	(256 * 1024)	/* most read from the file at once */
+#define CR_CHUNK	(1024 * 1024)	/* decompressed by the reading thread */
+#define CR_FRAME_MAX	(8 * 1024 * 1024) /* largest unit to hand a worker */
+#define CR_OUT_MIN	(64 * 1024)
+#define CR_OUT_MAX	((size_t)1 << 30) /* most one unit may decompress to */
+#define CR_MAX_THREADS	64
+
+#define CR_EMPTY	0	/* free to be filled from the file */
+#define CR_PENDING	1	/* holds a unit to be decompressed */
+#define CR_BUSY		2	/* being decompressed by a worker */
+#define CR_DONE		3	/* holds decompressed data to be read */
+
+struct cr_slot {
+	int	state;
+	uint64_t seq;		/* the unit's place in the file */
+	u_char	*in;		/* a compressed unit */
+	size_t	inlen;
+	size_t	insize;
+	u_char	*out;		/* the decompressed data */
+	size_t	outlen;
+	size_t	outsize;
+	size_t	outpos;		/* how much of it has been read */
+	int	pending;	/* "in" still has to be decompressed */
+	int	error;		/* errno for the read to fail with, or 0 */
+};
+
+/* What decompresses whole units; one for each worker. */
+struct cr_decoder {
+	struct compressed_reader *cr;
+#ifdef CR_GZIP_SUPPORTED
+	z_stream zs;
+	int	zinit;
+#endif
+#ifdef CR_ZSTD_SUPPORTED
+	ZSTD_DCtx *dctx;
+#endif
+};
+
+struct compressed_reader {
+	int	fd;
+	int	kind;		/* CR_GZIP or CR_ZSTD */
+	FILE	*fp;
+
+	/* Owned by whatever reads the file. */
+	u_char	*ibuf;
+	size_t	isize;
+	size_t	ipos;		/* the first byte not yet used */
+	size_t	ilen;		/* the end of what's been read */
+	int	ieof;
+	int	streaming;	/* in a member or frame decompressed in order */
+#ifdef CR_GZIP_SUPPORTED
+	z_stream zs;
+	int	zinit;
+#endif
+#ifdef CR_ZSTD_SUPPORTED
+	ZSTD_DCtx *zds;
+#endif
+
+	struct cr_slot *slots;
+	u_int	nslots;
+	struct cr_decoder *dec;
+	u_int	nworkers;
+	uint64_t fill_seq;	/* the next unit to be filled */
+	uint64_t read_seq;	/* the unit being read */
+	int	done;		/* no more units will be filled */
+#ifdef HAVE_PTHREADS
+	uint64_t work_seq;	/* the next unit for a worker to look at */
+	int	stop;		/* the stream's being closed */
+	int	running;	/* the reading thread has been started */
+	pthread_t reader;
+	pthread_t *workers;
+	u_int	nstarted;	/* workers started */
+	pthread_mutex_t mtx;
+	pthread_cond_t cv;
+#endif
+};
+
+/*
+ * Make *bufp at least "want" bytes, keeping what's in it.
+ */
+static int
+cr_reserve(u_char **bufp, size_t *sizep, size_t want)
+{
+	u_char *nbuf;
+	size_t nsize;
+
+	if (*sizep >= want)
+		return (0);
+	nsize = *sizep != 0 ? *sizep : CR_OUT_MIN;
+	while (nsize < want)
+		nsize *= 2;
+	nbuf = (u_char *)realloc(*bufp, nsize);
+	if (nbuf == NULL)
+		return (-1);
+	*bufp = nbuf;
+	*sizep = nsize;
+	return (0);
+}
+
+/*
+ * Read from the file until at least "want" unused bytes are buffered
+ * or the end of the file is reached.  Returns -1, with errno set, on
+ * an error.
+ */
+static int
+cr_fill(struct compressed_reader *cr, size_t want)
+{
+	ssize_t n;
+
+	if (cr->ipos != 0) {
+		memmove(cr->ibuf, cr->ibuf + cr->ipos, cr->ilen - cr->ipos);
+		cr->ilen -= cr->ipos;
+		cr->ipos = 0;
+	}
+	if (cr_reserve(&cr->ibuf, &cr->isize, want + CR_READSIZE) == -1) {
+		errno = ENOMEM;
+		return (-1);
+	}
+	while (cr->ilen < want && !cr->ieof) {
+		n = read(cr->fd, cr->ibuf + cr->ilen, CR_READSIZE);
+		if (n == -1) {
+			if (errno == EINTR)
+				continue;
+			return (-1);
+		}
+		if (n == 0)
+			cr->ieof = 1;
+		cr->ilen += (size_t)n;
+	}
+	return (0);
+}
+
+#ifdef CR_GZIP_SUPPORTED
+/*
+ * If the gzip member at the current position says how long it is, in
+ * a BGZF "BC" extra subfield, make sure it's all buffered, and return
+ * its length; return 0 if it doesn't, and -1 on a read error.
+ */
+static long
+cr_gzip_unit(struct compressed_reader *cr)
+{
+	const u_char *p;
+	size_t xlen, off, slen, size;
+
+	if (cr_fill(cr, 12) == -1)
+		return (-1);
+	p = cr->ibuf + cr->ipos;
+	if (cr->ilen - cr->ipos < 12 || p[0] != 0x1f || p[1] != 0x8b ||
+	    p[2] != Z_DEFLATED || (p[3] & 0x04) == 0)
+		return (0);
+	xlen = p[10] | (p[11] << 8);
+	if (cr_fill(cr, 12 + xlen) == -1)
+		return (-1);
+	p = cr->ibuf + cr->ipos;
+	if (cr->ilen - cr->ipos < 12 + xlen)
+		return (0);
+	for (off = 12; off + 4 <= 12 + xlen; off += 4 + slen) {
+		slen = p[off + 2] | (p[off + 3] << 8);
+		if (p[off] != 'B' || p[off + 1] != 'C' || slen != 2 ||
+		    off + 6 > 12 + xlen)
+			continue;
+		size = (size_t)(p[off + 4] | (p[off + 5] << 8)) + 1;
+		if (size < 12 + xlen + 8)
+			return (0);
+		if (cr_fill(cr, size) == -1)
+			return (-1);
+		if (cr->ilen - cr->ipos < size)
+			return (0);
+		return ((long)size);
+	}
+	return (0);
+}
+
+static int
+cr_gzip_decode(struct cr_decoder *dec, struct cr_slot *s)
+{
+	const u_char *t;
+	size_t isize;
+
+	/* The member ends with its decompressed length, mod 2^32. */
+	t = s->in + s->inlen - 4;
+	isize = (size_t)t[0] | ((size_t)t[1] << 8) | ((size_t)t[2] << 16) |
+	    ((size_t)t[3] << 24);
+	if (isize > CR_OUT_MAX)
+		return (EIO);
+	if (cr_reserve(&s->out, &s->outsize, isize + 1) == -1)
+		return (ENOMEM);
+	if (!dec->zinit) {
+		if (inflateInit2(&dec->zs, 15 + 16) != Z_OK)
+			return (ENOMEM);
+		dec->zinit = 1;
+	} else
+		(void)inflateReset(&dec->zs);
+	dec->zs.next_in = s->in;
+	dec->zs.avail_in = (uInt)s->inlen;
+	dec->zs.next_out = s->out;
+	dec->zs.avail_out = (uInt)(isize + 1);
+	if (inflate(&dec->zs, Z_FINISH) != Z_STREAM_END ||
+	    dec->zs.total_out != isize)
+		return (EIO);
+	s->outlen = isize;
+	return (0);
+}
+#endif /* CR_GZIP_SUPPORTED */
+
+#ifdef CR_ZSTD_SUPPORTED
+/*
+ * If the zstd frame at the current position is no longer than
+ * CR_FRAME_MAX, make sure it's all buffered, and return its length;
+ * return 0 if it's longer, and -1 on a read error.
+ */
+static long
+cr_zstd_unit(struct compressed_reader *cr)
+{
+	size_t have, r;
+
+	for (;;) {
+		have = cr->ilen - cr->ipos;
+		r = ZSTD_findFrameCompressedSize(cr->ibuf + cr->ipos, have);
+		if (!ZSTD_isError(r))
+			return ((long)r);
+		if (cr->ieof || have >= CR_FRAME_MAX)
+			return (0);
+		if (cr_fill(cr, have + CR_READSIZE) == -1)
+			return (-1);
+	}
+}
+
+static int
+cr_zstd_decode(struct cr_decoder *dec, struct cr_slot *s)
+{
+	ZSTD_inBuffer in;
+	ZSTD_outBuffer out;
+	unsigned long long csize;
+	size_t want, r;
+
+	if (dec->dctx == NULL && (dec->dctx = ZSTD_createDCtx()) == NULL)
+		return (ENOMEM);
+	(void)ZSTD_DCtx_reset(dec->dctx, ZSTD_reset_session_only);
+	csize = ZSTD_getFrameContentSize(s->in, s->inlen);
+	if (csize == ZSTD_CONTENTSIZE_UNKNOWN ||
+	    csize == ZSTD_CONTENTSIZE_ERROR || csize > CR_OUT_MAX)
+		want = s->inlen * 4;
+	else
+		want = (size_t)csize;
+	if (cr_reserve(&s->out, &s->outsize, want) == -1)
+		return (ENOMEM);
+	in.src = s->in;
+	in.size = s->inlen;
+	in.pos = 0;
+	out.pos = 0;
+	for (;;) {
+		out.dst = s->out;
+		out.size = s->outsize;
+		r = ZSTD_decompressStream(dec->dctx, &out, &in);
+		if (ZSTD_isError(r))
+			return (EIO);
+		if (r == 0)
+			break;
+		if (out.pos < out.size) {
+			/* It wants input, but it's had the whole frame. */
+			if (in.pos == in.size)
+				return (EIO);
+			continue;
+		}
+		if (s->outsize >= CR_OUT_MAX ||
+		    cr_reserve(&s->out, &s->outsize, s->outsize * 2) == -1)
+			return (ENOMEM);
+	}
+	s->outlen = out.pos;
+	return (0);
+}
+#endif /* CR_ZSTD_SUPPORTED */
+
+/*
+ * Decompress the unit in s.
+ */
+static void
+cr_decode(struct compressed_reader *cr, struct cr_decoder *dec,
+    struct cr_slot *s)
+{
+	switch (cr->kind) {
+#ifdef CR_GZIP_SUPPORTED
+	case CR_GZIP:
+		s->error = cr_gzip_decode(dec, s);
+		break;
+#endif
+#ifdef CR_ZSTD_SUPPORTED
+	case CR_ZSTD:
+		s->error = cr_zstd_decode(dec, s);
+		break;
+#endif
+	}
+	s->pending = 0;
+}
+
+/*
+ * Decompress up to CR_CHUNK bytes of the member or frame that has to
+ * be decompressed in order into s, leaving "streaming" set if there's
+ * more of it.
+ */
+static int
+cr_stream(struct compressed_reader *cr, struct cr_slot *s)
+{
+	size_t ipos, outlen, have;
+
+	if (cr_reserve(&s->out, &s->outsize, CR_CHUNK) == -1) {
+		s->error = ENOMEM;
+		return (-1);
+	}
+	while (s->outlen < CR_CHUNK) {
+		ipos = cr->ipos;
+		outlen = s->outlen;
+#ifdef CR_GZIP_SUPPORTED
+		if (cr->kind == CR_GZIP) {
+			int status;
+
+			cr->zs.next_in = cr->ibuf + cr->ipos;
+			cr->zs.avail_in = (uInt)(cr->ilen - cr->ipos);
+			cr->zs.next_out = s->out + s->outlen;
+			cr->zs.avail_out = (uInt)(CR_CHUNK - s->outlen);
+			status = inflate(&cr->zs, Z_NO_FLUSH);
+			cr->ipos = cr->ilen - cr->zs.avail_in;
+			s->outlen = CR_CHUNK - cr->zs.avail_out;
+			if (status == Z_STREAM_END) {
+				cr->streaming = 0;
+				break;
+			}
+			if (status != Z_OK && status != Z_BUF_ERROR) {
+				s->error = EIO;
+				return (-1);
+			}
+		}
+#endif
+#ifdef CR_ZSTD_SUPPORTED
+		if (cr->kind == CR_ZSTD) {
+			ZSTD_inBuffer in;
+			ZSTD_outBuffer out;
+			size_t r;
+
+			in.src = cr->ibuf + cr->ipos;
+			in.size = cr->ilen - cr->ipos;
+			in.pos = 0;
+			out.dst = s->out;
+			out.size = CR_CHUNK;
+			out.pos = s->outlen;
+			r = ZSTD_decompressStream(cr->zds, &out, &in);
+			cr->ipos += in.pos;
+			s->outlen = out.pos;
+			if (ZSTD_isError(r)) {
+				s->error = EIO;
+				return (-1);
+			}
+			if (r == 0) {
+				cr->streaming = 0;
+				break;
+			}
+		}
+#endif
+		if (cr->ipos != ipos || s->outlen != outlen)
+			continue;
+
+		/* It can't go on without more of the file. */
+		have = cr->ilen - cr->ipos;
+		if (cr_fill(cr, have + 1) == -1) {
+			s->error = errno;
+			return (-1);
+		}
+		if (cr->ilen - cr->ipos == have) {
+			/* The file ends part of the way through. */
+			s->error = EIO;
+			return (-1);
+		}
+	}
+	return (1);
+}
+
+/*
+ * Fill s with the next unit.  Returns 1 if that was done, 0 at the end
+ * of the file, and -1, with s->error set, on an error.
+ */
+static int
+cr_produce(struct compressed_reader *cr, struct cr_slot *s)
+{
+	long n;
+
+	s->inlen = 0;
+	s->outlen = 0;
+	s->outpos = 0;
+	s->pending = 0;
+	s->error = 0;
+	if (cr->streaming)
+		return (cr_stream(cr, s));
+	if (cr_fill(cr, 1) == -1) {
+		s->error = errno;
+		return (-1);
+	}
+	if (cr->ipos == cr->ilen)
+		return (0);
+	n = 0;
+	switch (cr->kind) {
+#ifdef CR_GZIP_SUPPORTED
+	case CR_GZIP:
+		n = cr_gzip_unit(cr);
+		break;
+#endif
+#ifdef CR_ZSTD_SUPPORTED
+	case CR_ZSTD:
+		n = cr_zstd_unit(cr);
+		break;
+#endif
+	}
+	if (n == -1) {
+		s->error = errno;
+		return (-1);
+	}
+	if (n > 0) {
+		if (cr_reserve(&s->in, &s->insize, (size_t)n) == -1) {
+			s->error = ENOMEM;
+			return (-1);
+		}
+		memcpy(s->in, cr->ibuf + cr->ipos, (size_t)n);
+		s->inlen = (size_t)n;
+		cr->ipos += (size_t)n;
+		s->pending = 1;
+		return (1);
+	}
+
+	/*
+	 * This member or frame has to be decompressed from its start;
+	 * a gzip file may continue with another member, as one made by
+	 * concatenating gzip files does.
+	 */
+#ifdef CR_GZIP_SUPPORTED
+	if (cr->kind == CR_GZIP)
+		(void)inflateReset(&cr->zs);
+#endif
+#ifdef CR_ZSTD_SUPPORTED
+	if (cr->kind == CR_ZSTD)
+		(void)ZSTD_DCtx_reset(cr->zds, ZSTD_reset_session_only);
+#endif
+	cr->streaming = 1;
+	return (cr_stream(cr, s));
+}
+
+#ifdef HAVE_PTHREADS
+/*
+ * The thread that reads the file and fills the slots.
+ */
+static void *
+cr_reader_main(void *arg)
+{
+	struct compressed_reader *cr = (struct compressed_reader *)arg;
+	struct cr_slot *s;
+	int status;
+
+	pthread_mutex_lock(&cr->mtx);
+	for (;;) {
+		s = &cr->slots[cr->fill_seq % cr->nslots];
+		while (!cr->stop && s->state != CR_EMPTY)
+			pthread_cond_wait(&cr->cv, &cr->mtx);
+		if (cr->stop)
+			break;
+		pthread_mutex_unlock(&cr->mtx);
+		status = cr_produce(cr, s);
+		if (status == 1 && s->pending && cr->nworkers == 0)
+			cr_decode(cr, &cr->dec[0], s);
+		pthread_mutex_lock(&cr->mtx);
+		if (status == 0) {
+			cr->done = 1;
+			pthread_cond_broadcast(&cr->cv);
+			break;
+		}
+		s->seq = cr->fill_seq++;
+		s->state = s->pending ? CR_PENDING : CR_DONE;
+		if (status == -1)
+			cr->done = 1;
+		pthread_cond_broadcast(&cr->cv);
+		if (status == -1)
+			break;
+	}
+	pthread_mutex_unlock(&cr->mtx);
+	return (NULL);
+}
+
+/*
+ * A worker, which decompresses the units in the order they're in the
+ * file, so that the earliest are ready first.
+ */
+static void *
+cr_worker_main(void *arg)
+{
+	struct cr_decoder *dec = (struct cr_decoder *)arg;
+	struct compressed_reader *cr = dec->cr;
+	struct cr_slot *s;
+
+	pthread_mutex_lock(&cr->mtx);
+	while (!cr->stop) {
+		if (cr->work_seq == cr->fill_seq) {
+			if (cr->done)
+				break;
+			pthread_cond_wait(&cr->cv, &cr->mtx);
+			continue;
+		}
+		s = &cr->slots[cr->work_seq % cr->nslots];
+		cr->work_seq++;
+		/* A unit that was decompressed as it was read is skipped. */
+		if (s->seq != cr->work_seq - 1 || s->state != CR_PENDING)
+			continue;
+		s->state = CR_BUSY;
+		pthread_mutex_unlock(&cr->mtx);
+		cr_decode(cr, dec, s);
+		pthread_mutex_lock(&cr->mtx);
+		s->state = CR_DONE;
+		pthread_cond_broadcast(&cr->cv);
+	}
+	pthread_mutex_unlock(&cr->mtx);
+	return (NULL);
+}
+#endif /* HAVE_PTHREADS */
+
+/*
+ * The slot to read from next, or NULL at the end of the file.
+ */
+static struct cr_slot *
+cr_current(struct compressed_reader *cr)
+{
+	struct cr_slot *s;
+	int status;
+
+	s = &cr->slots[cr->read_seq % cr->nslots];
+#ifdef HAVE_PTHREADS
+	if (cr->running) {
+		pthread_mutex_lock(&cr->mtx);
+		while (!(s->state == CR_DONE && s->seq == cr->read_seq) &&
+		    !(cr->done && cr->read_seq == cr->fill_seq))
+			pthread_cond_wait(&cr->cv, &cr->mtx);
+		if (s->state != CR_DONE || s->seq != cr->read_seq)
+			s = NULL;
+		pthread_mutex_unlock(&cr->mtx);
+		return (s);
+	}
+#endif
+	if (s->state == CR_DONE)
+		return (s);
+	if (cr->done)
+		return (NULL);
+	status = cr_produce(cr, s);
+	if (status == 0) {
+		cr->done = 1;
+		return (NULL);
+	}
+	if (status == 1 && s->pending)
+		cr_decode(cr, &cr->dec[0], s);
+	if (status == -1)
+		cr->done = 1;
+	s->seq = cr->fill_seq++;
+	s->state = CR_DONE;
+	return (s);
+}
+
+/*
+ * Hand s, which has all been read, back to be filled again.
+ */
+static void
+cr_release(struct compressed_reader *cr, struct cr_slot *s)
+{
+#ifdef HAVE_PTHREADS
+	if (cr->running) {
+		pthread_mutex_lock(&cr->mtx);
+		s->state = CR_EMPTY;
+		cr->read_seq++;
+		pthread_cond_broadcast(&cr->cv);
+		pthread_mutex_unlock(&cr->mtx);
+		return;
+	}
+#endif
+	s->state = CR_EMPTY;
+	cr->read_seq++;
+}
+
+static ssize_t
+cr_read(struct compressed_reader *cr, char *buf, size_t len)
+{
+	struct cr_slot *s;
+	size_t done, n;
+
+	for (done = 0; done < len; ) {
+		if ((s = cr_current(cr)) == NULL)
+			break;
+		if (s->error != 0) {
+			/* Hand back what there is, and fail the next read. */
+			if (done != 0)
+				break;
+			errno = s->error;
+			return (-1);
+		}
+		n = s->outlen - s->outpos;
+		if (n > len - done)
+			n = len - done;
+		memcpy(buf + done, s->out + s->outpos, n);
+		s->outpos += n;
+		done += n;
+		if (s->outpos == s->outlen)
+			cr_release(cr, s);
+	}
+	return ((ssize_t)done);
+}
+
+static void
+cr_free(struct compressed_reader *cr)
+{
+	u_int i, ndec;
+
+#ifdef HAVE_PTHREADS
+	if (cr->running || cr->nstarted != 0) {
+		pthread_mutex_lock(&cr->mtx);
+		cr->stop = 1;
+		pthread_cond_broadcast(&cr->cv);
+		pthread_mutex_unlock(&cr->mtx);
+		pthread_join(cr->reader, NULL);
+	}
+	for (i = 0; i < cr->nstarted; i++)
+		pthread_join(cr->workers[i], NULL);
+	free(cr->workers);
+	pthread_mutex_destroy(&cr->mtx);
+	pthread_cond_destroy(&cr->cv);
+#endif
+	if (cr->slots != NULL) {
+		for (i = 0; i < cr->nslots; i++) {
+			free(cr->slots[i].in);
+			free(cr->slots[i].out);
+		}
+		free(cr->slots);
+	}
+	ndec = cr->nworkers != 0 ? cr->nworkers : 1;
+	if (cr->dec != NULL) {
+		for (i = 0; i < ndec; i++) {
+#ifdef CR_GZIP_SUPPORTED
+			if (cr->dec[i].zinit)
+				(void)inflateEnd(&cr->dec[i].zs);
+#endif
+#ifdef CR_ZSTD_SUPPORTED
+			ZSTD_freeDCtx(cr->dec[i].dctx);
+#endif
+		}
+		free(cr->dec);
+	}
+#ifdef CR_GZIP_SUPPORTED
+	if (cr->zinit)
+		(void)inflateEnd(&cr->zs);
+#endif
+#ifdef CR_ZSTD_SUPPORTED
+	ZSTD_freeDCtx(cr->zds);
+#endif
+	free(cr->ibuf);
+	(void)close(cr->fd);
+	free(cr);
+}
+
+#ifdef HAVE_FOPENCOOKIE
+static ssize_t
+cr_cookie_read(void *cookie, char *buf, size_t len)
+{
+	return (cr_read((struct compressed_reader *)cookie, buf, len));
+}
+
+static int
+cr_cookie_close(void *cookie)
+{
+	cr_free((struct compressed_reader *)cookie);
+	return (0);
+}
+
+static FILE *
+cr_fopen(struct compressed_reader *cr)
+{
+	cookie_io_functions_t io;
+
+	io.read = cr_cookie_read;
+	io.write = NULL;
+	io.seek = NULL;
+	io.close = cr_cookie_close;
+	return (fopencookie(cr, "r", io));
+}
+#else /* HAVE_FUNOPEN */
+static int
+cr_cookie_read(void *cookie, char *buf, int len)
+{
+	return ((int)cr_read((struct compressed_reader *)cookie, buf,
+	    (size_t)len));
+}
+
+static int
+cr_cookie_close(void *cookie)
+{
+	cr_free((struct compressed_reader *)cookie);
+	return (0);
+}
+
+static FILE *
+cr_fopen(struct compressed_reader *cr)
+{
+	return (funopen(cr, cr_cookie_read, NULL, NULL, cr_cookie_close));
+}
+#endif /* HAVE_FOPENCOOKIE */
+
+/*
+ * Which of the compressed formats that can be read the file starts
+ * with; 0 if none of them, or if it can't be read.
+ */
+static int
+cr_kind(int fd)
+{
+	u_char magic[4];
+	ssize_t n;
+
+	do
+		n = read(fd, magic, sizeof(magic));
+	while (n == -1 && errno == EINTR);
+	if (n != (ssize_t)sizeof(magic))
+		return (0);
+#ifdef CR_GZIP_SUPPORTED
+	if (magic[0] == 0x1f && magic[1] == 0x8b)
+		return (CR_GZIP);
+#endif
+#ifdef CR_ZSTD_SUPPORTED
+	if (magic[0] == 0x28 && magic[1] == 0xb5 && magic[2] == 0x2f &&
+	    magic[3] == 0xfd)
+		return (CR_ZSTD);
+#endif
+	return (0);
+}
+
+/*
+ * Returns 1 if fname is a file compressed in a format that can be
+ * read; the standard input, "-", isn't looked at.
+ */
+int
+compressed_reader_probe(const char *fname)
+{
+	int fd, kind;
+
+	if (strcmp(fname, "-") == 0)
+		return (0);
+	if ((fd = open(fname, O_RDONLY)) == -1)
+		return (0);
+	kind = cr_kind(fd);
+	(void)close(fd);
+	return (kind != 0);
+}
+
+/*
+ * Open the compressed file fname, decompressing it with "threads"
+ * threads; with 1, the file is read and decompressed by a single
+ * thread, and, with more, that many workers decompress the parts of it
+ * that can be decompressed on their own.  The stream returned by
+ * compressed_reader_file() is to be handed to pcap_fopen_offline();
+ * closing it frees the reader.  On failure, NULL is returned with a
+ * message in errbuf.
+ */
+struct compressed_reader *
+compressed_reader_open(const char *fname, int threads, char *errbuf)
+{
+	struct compressed_reader *cr;
+	u_int ndec;
+#ifdef HAVE_PTHREADS
+	u_int i;
+#endif
+
+	cr = (struct compressed_reader *)calloc(1, sizeof(*cr));
+	if (cr == NULL) {
+		(void)snprintf(errbuf, PCAP_ERRBUF_SIZE, "out of memory");
+		return (NULL);
+	}
+	if ((cr->fd = open(fname, O_RDONLY)) == -1) {
+		(void)snprintf(errbuf, PCAP_ERRBUF_SIZE, "%s: %s", fname,
+		    strerror(errno));
+		free(cr);
+		return (NULL);
+	}
+	if ((cr->kind = cr_kind(cr->fd)) == 0 ||
+	    lseek(cr->fd, 0, SEEK_SET) == -1) {
+		(void)snprintf(errbuf, PCAP_ERRBUF_SIZE,
+		    "%s: not a compressed file that can be read", fname);
+		(void)close(cr->fd);
+		free(cr);
+		return (NULL);
+	}
+#ifdef HAVE_PTHREADS
+	pthread_mutex_init(&cr->mtx, NULL);
+	pthread_cond_init(&cr->cv, NULL);
+	if (threads > CR_MAX_THREADS)
+		threads = CR_MAX_THREADS;
+	cr->nworkers = threads > 1 ? (u_int)threads : 0;
+	cr->nslots = 2 * cr->nworkers + 4;
+#else
+	cr->nslots = 1;
+#endif
+	ndec = cr->nworkers != 0 ? cr->nworkers : 1;
+	cr->slots = (struct cr_slot *)calloc(cr->nslots, sizeof(*cr->slots));
+	cr->dec = (struct cr_decoder *)calloc(ndec, sizeof(*cr->dec));
+	if (cr->slots == NULL || cr->dec == NULL)
+		goto nomem;
+#ifdef CR_GZIP_SUPPORTED
+	if (cr->kind == CR_GZIP) {
+		if (inflateInit2(&cr->zs, 15 + 16) != Z_OK)
+			goto nomem;
+		cr->zinit = 1;
+	}
+#endif
+#ifdef CR_ZSTD_SUPPORTED
+	if (cr->kind == CR_ZSTD && (cr->zds = ZSTD_createDCtx()) == NULL)
+		goto nomem;
+#endif
+	cr->fp = cr_fopen(cr);
+	if (cr->fp == NULL) {
+		(void)snprintf(errbuf, PCAP_ERRBUF_SIZE,
+		    "can't open a stream: %s", strerror(errno));
+		cr_free(cr);
+		return (NULL);
+	}
+#ifdef HAVE_PTHREADS
+	cr->workers = (pthread_t *)calloc(ndec, sizeof(pthread_t));
+	if (cr->workers == NULL)
+		goto nomem;
+	for (i = 0; i < cr->nworkers; i++) {
+		cr->dec[i].cr = cr;
+		if (pthread_create(&cr->workers[i], NULL, cr_worker_main,
+		    &cr->dec[i]) != 0)
+			goto nothread;
+		cr->nstarted++;
+	}
+	if (pthread_create(&cr->reader, NULL, cr_reader_main, cr) != 0)
+		goto nothread;
+	cr->running = 1;
+#else
+	(void)threads;
+#endif
+	return (cr);
+
+#ifdef HAVE_PTHREADS
+nothread:
+	(void)snprintf(errbuf, PCAP_ERRBUF_SIZE,
+	    "can't create a decompression thread");
+	(void)fclose(cr->fp);
+	return (NULL);
+#endif
+
+nomem:
+	(void)snprintf(errbuf, PCAP_ERRBUF_SIZE, "out of memory");
+	if (cr->fp != NULL)
+		(void)fclose(cr->fp);
+	else
+		cr_free(cr);
+	return (NULL);
+}
+
+/*
+ * The stream to read the decompressed savefile from.
+ */
+FILE *
+compressed_reader_file(const struct compressed_reader *cr)
+{
+	return (cr->fp);
+}
+
+/*
+ * The descriptor of the compressed file, for Capsicum to limit.
+ */
+int
+compressed_reader_fd(const struct compressed_reader *cr)
+{
+	return (cr->fd);
+}
+#endif /* COMPRESSED_READER_SUPPORTED */
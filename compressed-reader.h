@@ -0,0 +1,35 @@
+/*
+ * Copyright (c) 2026 The TCPDUMP project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that: (1) source code
+ * distributions retain the above copyright notice and this paragraph
+ * in its entirety, and (2) distributions including binary code include
+ * the above copyright notice and this paragraph in its entirety in
+ * the documentation or other materials provided with the distribution.
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND
+ * WITHOUT ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, WITHOUT
+ * LIMITATION, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE.
+ */
+
+
+/*
+ * Savefiles compressed with gzip or zstd, read with -r or -V without
+ * decompressing them first; the decompressor is handed to libpcap as a
+ * standard I/O stream.
+ */
+#if (defined(HAVE_FOPENCOOKIE) || defined(HAVE_FUNOPEN)) && \
+    ((defined(HAVE_LIBZ) && defined(HAVE_ZLIB_H)) || \
+     (defined(HAVE_LIBZSTD) && defined(HAVE_ZSTD_H)))
+#define COMPRESSED_READER_SUPPORTED
+
+struct compressed_reader;
+
+extern int compressed_reader_probe(const char *);
+extern struct compressed_reader *compressed_reader_open(const char *, int,
+    char *);
+extern FILE *compressed_reader_file(const struct compressed_reader *);
+extern int compressed_reader_fd(const struct compressed_reader *);
+#endif
@@ -0,0 +1,202 @@
+/*
+ * Copyright (c) 2026 The TCPDUMP project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that: (1) source code
+ * distributions retain the above copyright notice and this paragraph
+ * in its entirety, and (2) distributions including binary code include
+ * the above copyright notice and this paragraph in its entirety in
+ * the documentation or other materials provided with the distribution.
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND
+ * WITHOUT ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, WITHOUT
+ * LIMITATION, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE.
+ */
+
+
+/*
+ * The socket is made with a umask that leaves it accessible only by its
+ * owner, as whoever can connect to it can change what's captured.  A
+ * client that connects and then says nothing is given a second, so that
+ * it can't hold up the capture for longer than that.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include "netdissect-stdinc.h"
+
+#include "control-socket.h"
+
+#ifdef CONTROL_SOCKET_SUPPORTED
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/un.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pcap.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL	0
+#endif
+
+#define CONTROL_SOCKET_TIMEOUT	1	/* seconds to wait for a command */
+
+struct control_socket {
+	int	fd;
+	char	*path;
+};
+
+/*
+ * Make the socket "path", replacing a socket left there by an earlier
+ * run, and listen on it.  Returns NULL, with a message in ebuf, if
+ * that fails.
+ */
+struct control_socket *
+control_socket_open(const char *path, char *ebuf)
+{
+	struct control_socket *cs;
+	struct sockaddr_un sa;
+	struct stat st;
+	mode_t omask;
+	int fd, flags;
+
+	if (strlen(path) >= sizeof(sa.sun_path)) {
+		snprintf(ebuf, PCAP_ERRBUF_SIZE, "%s: name too long", path);
+		return (NULL);
+	}
+	memset(&sa, 0, sizeof(sa));
+	sa.sun_family = AF_UNIX;
+	strcpy(sa.sun_path, path);
+	if (lstat(path, &st) == 0 && S_ISSOCK(st.st_mode))
+		(void)unlink(path);
+
+	fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (fd == -1) {
+		snprintf(ebuf, PCAP_ERRBUF_SIZE, "socket: %s",
+		    pcap_strerror(errno));
+		return (NULL);
+	}
+	omask = umask(077);
+	if (bind(fd, (struct sockaddr *)&sa, sizeof(sa)) == -1) {
+		snprintf(ebuf, PCAP_ERRBUF_SIZE, "%s: %s", path,
+		    pcap_strerror(errno));
+		(void)umask(omask);
+		close(fd);
+		return (NULL);
+	}
+	(void)umask(omask);
+	if (listen(fd, 4) == -1 ||
+	    (flags = fcntl(fd, F_GETFL, 0)) == -1 ||
+	    fcntl(fd, F_SETFL, flags | O_NONBLOCK) == -1) {
+		snprintf(ebuf, PCAP_ERRBUF_SIZE, "%s: %s", path,
+		    pcap_strerror(errno));
+		close(fd);
+		(void)unlink(path);
+		return (NULL);
+	}
+	cs = (struct control_socket *)calloc(1, sizeof(*cs));
+	if (cs == NULL || (cs->path = strdup(path)) == NULL) {
+		snprintf(ebuf, PCAP_ERRBUF_SIZE, "control_socket_open: malloc");
+		free(cs);
+		close(fd);
+		(void)unlink(path);
+		return (NULL);
+	}
+	cs->fd = fd;
+	return (cs);
+}
+
+/*
+ * Read a command from the connection "fd" into "buf", stopping at the
+ * first newline; returns -1 if there isn't one, or it's too long.
+ */
+static int
+control_socket_read(int fd, char *buf, size_t size)
+{
+	struct timeval tv;
+	size_t len;
+	ssize_t n;
+	char *nl;
+
+	tv.tv_sec = CONTROL_SOCKET_TIMEOUT;
+	tv.tv_usec = 0;
+	(void)setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+	len = 0;
+	for (;;) {
+		n = recv(fd, buf + len, size - 1 - len, 0);
+		if (n == -1 && errno == EINTR)
+			continue;
+		if (n <= 0)
+			break;
+		len += n;
+		buf[len] = '\0';
+		if ((nl = strchr(buf, '\n')) != NULL) {
+			*nl = '\0';
+			return (0);
+		}
+		if (len == size - 1)
+			return (-1);
+	}
+	/* A command without a newline, ended by the client's shutdown. */
+	buf[len] = '\0';
+	return (n == 0 && len != 0 ? 0 : -1);
+}
+
+/*
+ * Take the commands waiting on the socket, if there are any, handing
+ * each to "handler" and sending back its reply.
+ */
+void
+control_socket_poll(struct control_socket *cs,
+    control_socket_handler handler, void *arg)
+{
+	char cmd[CONTROL_SOCKET_MAXLINE + 1];
+	char reply[CONTROL_SOCKET_MAXREPLY];
+	size_t len;
+	int fd, flags;
+#ifdef SO_NOSIGPIPE
+	int on = 1;
+#endif
+
+	while ((fd = accept(cs->fd, NULL, NULL)) != -1) {
+		/* Some systems have it inherit O_NONBLOCK; don't. */
+		if ((flags = fcntl(fd, F_GETFL, 0)) != -1)
+			(void)fcntl(fd, F_SETFL, flags & ~O_NONBLOCK);
+#ifdef SO_NOSIGPIPE
+		(void)setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &on,
+		    sizeof(on));
+#endif
+		if (control_socket_read(fd, cmd, sizeof(cmd)) == -1)
+			snprintf(reply, sizeof(reply),
+			    "error: no command, or too long a one\n");
+		else {
+			len = strlen(cmd);
+			if (len != 0 && cmd[len - 1] == '\r')
+				cmd[len - 1] = '\0';
+			reply[0] = '\0';
+			(*handler)(arg, cmd, reply, sizeof(reply));
+		}
+		/* A client that's gone away doesn't get its reply. */
+		(void)send(fd, reply, strlen(reply), MSG_NOSIGNAL);
+		close(fd);
+	}
+}
+
+void
+control_socket_close(struct control_socket *cs)
+{
+	close(cs->fd);
+	(void)unlink(cs->path);
+	free(cs->path);
+	free(cs);
+}
+#endif /* CONTROL_SOCKET_SUPPORTED */
@@ -0,0 +1,47 @@
+/*
+ * Copyright (c) 2026 The TCPDUMP project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that: (1) source code
+ * distributions retain the above copyright notice and this paragraph
+ * in its entirety, and (2) distributions including binary code include
+ * the above copyright notice and this paragraph in its entirety in
+ * the documentation or other materials provided with the distribution.
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND
+ * WITHOUT ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, WITHOUT
+ * LIMITATION, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE.
+ */
+
+
+/*
+ * The --control-socket socket, a UN*X-domain stream socket that a
+ * running capture takes commands on.  Each connection carries one
+ * command, a line of text, and gets back the reply, after which the
+ * socket is closed, so that "echo stats | nc -U path" works.
+ *
+ * The socket is only looked at between the batches of packets that the
+ * capture loop hands to pcap_dispatch(), by control_socket_poll(),
+ * which never waits for a connection; so a command takes effect
+ * between two packets, and never while one is being printed or written.
+ */
+#ifndef _WIN32
+#define CONTROL_SOCKET_SUPPORTED
+
+#define CONTROL_SOCKET_MAXLINE	1024	/* longest command */
+#define CONTROL_SOCKET_MAXREPLY	4096
+
+struct control_socket;
+
+/*
+ * Carries out the command "cmd", without its newline, putting the
+ * reply, which should end with a newline, in "reply".
+ */
+typedef void (*control_socket_handler)(void *, char *, char *, size_t);
+
+extern struct control_socket *control_socket_open(const char *, char *);
+extern void control_socket_poll(struct control_socket *,
+    control_socket_handler, void *);
+extern void control_socket_close(struct control_socket *);
+#endif
@@ -0,0 +1,210 @@
+/*
+ * Copyright (c) 2026 The TCPDUMP project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that: (1) source code
+ * distributions retain the above copyright notice and this paragraph
+ * in its entirety, and (2) distributions including binary code include
+ * the above copyright notice and this paragraph in its entirety in
+ * the documentation or other materials provided with the distribution.
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND
+ * WITHOUT ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, WITHOUT
+ * LIMITATION, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE.
+ */
+
+/*
+ * A thread bound with sched_setaffinity() only runs on the CPUs it's
+ * bound to, and the threads it creates start out bound to the same
+ * ones.  Memory is allocated, by default, from the NUMA node of the
+ * CPU of the thread that first touches it, and the kernel allocates
+ * the buffer of a capture socket when it's activated, so binding the
+ * thread that opens the interface to the CPUs of the node the network
+ * adapter is on has the buffer put on that node.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#ifdef __linux__
+#define _GNU_SOURCE	/* for sched_setaffinity() and cpu_set_t */
+#endif
+
+#include "netdissect-stdinc.h"
+
+#include <errno.h>
+#include <pcap.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "cpu-affinity.h"
+
+#ifdef CPU_AFFINITY_SUPPORTED
+
+#include <sched.h>
+
+struct cpu_affinity {
+	cpu_set_t set;
+	int ncpus;
+};
+
+/*
+ * Parse a list of CPUs, as in /sys/devices/system/node/node0/cpulist,
+ * e.g. "0,2,4-7".
+ */
+struct cpu_affinity *
+cpu_affinity_parse(const char *list, char *errbuf)
+{
+	struct cpu_affinity *ca;
+	const char *p;
+	char *endp;
+	unsigned long lo, hi;
+
+	ca = (struct cpu_affinity *)calloc(1, sizeof(*ca));
+	if (ca == NULL) {
+		snprintf(errbuf, PCAP_ERRBUF_SIZE, "out of memory");
+		return (NULL);
+	}
+	CPU_ZERO(&ca->set);
+	p = list;
+	for (;;) {
+		errno = 0;
+		lo = hi = strtoul(p, &endp, 10);
+		if (endp == p || errno != 0)
+			break;
+		if (*endp == '-') {
+			p = endp + 1;
+			hi = strtoul(p, &endp, 10);
+			if (endp == p || errno != 0)
+				break;
+		}
+		if (lo > hi || hi >= CPU_SETSIZE)
+			break;
+		for (; lo <= hi; lo++) {
+			if (!CPU_ISSET(lo, &ca->set))
+				ca->ncpus++;
+			CPU_SET(lo, &ca->set);
+		}
+		if (*endp != ',')
+			break;
+		p = endp + 1;
+	}
+	if (*endp != '\0' || ca->ncpus == 0) {
+		snprintf(errbuf, PCAP_ERRBUF_SIZE, "invalid CPU list \"%s\"",
+		    list);
+		free(ca);
+		return (NULL);
+	}
+	return (ca);
+}
+
+/*
+ * The CPUs of NUMA node "node".
+ */
+struct cpu_affinity *
+cpu_affinity_node(int node, char *errbuf)
+{
+	char path[64], list[1024];
+	FILE *fp;
+
+	snprintf(path, sizeof(path), "/sys/devices/system/node/node%d/cpulist",
+	    node);
+	fp = fopen(path, "r");
+	if (fp == NULL) {
+		snprintf(errbuf, PCAP_ERRBUF_SIZE, "NUMA node %d: %s", node,
+		    pcap_strerror(errno));
+		return (NULL);
+	}
+	if (fgets(list, sizeof(list), fp) == NULL)
+		list[0] = '\0';
+	fclose(fp);
+	list[strcspn(list, "\n")] = '\0';
+	return (cpu_affinity_parse(list, errbuf));
+}
+
+/*
+ * The CPUs the calling thread is bound to.
+ */
+struct cpu_affinity *
+cpu_affinity_get(char *errbuf)
+{
+	struct cpu_affinity *ca;
+
+	ca = (struct cpu_affinity *)calloc(1, sizeof(*ca));
+	if (ca == NULL) {
+		snprintf(errbuf, PCAP_ERRBUF_SIZE, "out of memory");
+		return (NULL);
+	}
+	if (sched_getaffinity(0, sizeof(ca->set), &ca->set) == -1) {
+		snprintf(errbuf, PCAP_ERRBUF_SIZE,
+		    "can't get the CPU affinity: %s", pcap_strerror(errno));
+		free(ca);
+		return (NULL);
+	}
+	ca->ncpus = CPU_COUNT(&ca->set);
+	return (ca);
+}
+
+/*
+ * The NUMA node of the network device "device", or -1 if it has none
+ * or it can't be found.
+ */
+int
+cpu_affinity_device_node(const char *device)
+{
+	char path[128];
+	FILE *fp;
+	int node;
+
+	if (strchr(device, '/') != NULL || strcmp(device, "..") == 0)
+		return (-1);
+	snprintf(path, sizeof(path), "/sys/class/net/%s/device/numa_node",
+	    device);
+	fp = fopen(path, "r");
+	if (fp == NULL)
+		return (-1);
+	if (fscanf(fp, "%d", &node) != 1)
+		node = -1;
+	fclose(fp);
+	return (node);
+}
+
+/*
+ * Bind the calling thread to the CPUs of "ca" or, if "nth" isn't
+ * negative, to only one of them, the nth, counting around again after
+ * the last one, so the threads of a stage can each have a CPU.
+ */
+int
+cpu_affinity_bind(const struct cpu_affinity *ca, int nth, char *errbuf)
+{
+	cpu_set_t one;
+	const cpu_set_t *set;
+	int cpu;
+
+	set = &ca->set;
+	if (nth >= 0) {
+		nth %= ca->ncpus;
+		for (cpu = 0; cpu < CPU_SETSIZE; cpu++)
+			if (CPU_ISSET(cpu, &ca->set) && nth-- == 0)
+				break;
+		CPU_ZERO(&one);
+		CPU_SET(cpu, &one);
+		set = &one;
+	}
+	if (sched_setaffinity(0, sizeof(*set), set) == -1) {
+		snprintf(errbuf, PCAP_ERRBUF_SIZE,
+		    "can't set the CPU affinity: %s", pcap_strerror(errno));
+		return (-1);
+	}
+	return (0);
+}
+
+void
+cpu_affinity_free(struct cpu_affinity *ca)
+{
+	free(ca);
+}
+#endif /* CPU_AFFINITY_SUPPORTED */
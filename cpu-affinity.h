@@ -0,0 +1,34 @@
+/*
+ * Copyright (c) 2026 The TCPDUMP project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that: (1) source code
+ * distributions retain the above copyright notice and this paragraph
+ * in its entirety, and (2) distributions including binary code include
+ * the above copyright notice and this paragraph in its entirety in
+ * the documentation or other materials provided with the distribution.
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND
+ * WITHOUT ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, WITHOUT
+ * LIMITATION, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE.
+ */
+
+
+/*
+ * Sets of CPUs for threads to be bound to, for --cpu-affinity and
+ * --numa-node; only on Linux, where a thread can be bound to CPUs on
+ * its own and the NUMA node of a network device can be found.
+ */
+#if defined(__linux__) && defined(HAVE_SCHED_SETAFFINITY)
+#define CPU_AFFINITY_SUPPORTED
+
+struct cpu_affinity;
+
+extern struct cpu_affinity *cpu_affinity_parse(const char *, char *);
+extern struct cpu_affinity *cpu_affinity_node(int, char *);
+extern struct cpu_affinity *cpu_affinity_get(char *);
+extern int cpu_affinity_device_node(const char *);
+extern int cpu_affinity_bind(const struct cpu_affinity *, int, char *);
+extern void cpu_affinity_free(struct cpu_affinity *);
+#endif
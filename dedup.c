@@ -0,0 +1,169 @@
+/*
+ * Copyright (c) 2026 The TCPDUMP project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that: (1) source code
+ * distributions retain the above copyright notice and this paragraph
+ * in its entirety, and (2) distributions including binary code include
+ * the above copyright notice and this paragraph in its entirety in
+ * the documentation or other materials provided with the distribution.
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND
+ * WITHOUT ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, WITHOUT
+ * LIMITATION, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE.
+ */
+
+
+
+/*
+ * A packet is taken for a duplicate if one with the same hash was seen
+ * within the window before it.  The hashes and the times they were
+ * seen are kept in a table of a fixed size, DEDUP_SLOTS, in buckets of
+ * DEDUP_WAYS slots that fill a cache line; a new hash takes the slot
+ * of its bucket that was filled the longest ago, so the table never
+ * needs cleaning out, and entries older than the window are simply
+ * ignored until they're reused.  As long as the packets arriving
+ * within the window are well short of DEDUP_SLOTS, duplicates are
+ * almost always found; with more, some get through.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include "netdissect-stdinc.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "netdissect-alloc.h"
+#include "dedup.h"
+
+#define DEDUP_MUL	0x9e3779b97f4a7c15ULL
+
+struct dedup_slot {
+	uint64_t hash;		/* 0 = unused */
+	uint64_t time;		/* microseconds */
+};
+
+struct dedup_table {
+	struct dedup_slot *slots;
+	u_int mask;		/* of the buckets */
+	uint64_t window;
+};
+
+/*
+ * Add "len" bytes at "p" to the hash "h", a word at a time.
+ */
+static uint64_t
+dedup_hash(uint64_t h, const u_char *p, u_int len)
+{
+	uint64_t w;
+
+	for (; len >= 8; p += 8, len -= 8) {
+		memcpy(&w, p, 8);
+		h = (h ^ w) * DEDUP_MUL;
+		h ^= h >> 29;
+	}
+	if (len != 0) {
+		w = 0;
+		memcpy(&w, p, len);
+		h = (h ^ w ^ (uint64_t)len << 56) * DEDUP_MUL;
+		h ^= h >> 29;
+	}
+	return (h);
+}
+
+/*
+ * Make a table for a window of "window" microseconds.
+ */
+struct dedup_table *
+dedup_new(uint64_t window)
+{
+	struct dedup_table *dt;
+
+	dt = (struct dedup_table *)malloc(sizeof(*dt));
+	if (dt == NULL)
+		return (NULL);
+	dt->slots = (struct dedup_slot *)nd_big_calloc(DEDUP_SLOTS,
+	    sizeof(*dt->slots));
+	if (dt->slots == NULL) {
+		free(dt);
+		return (NULL);
+	}
+	dt->mask = DEDUP_SLOTS / DEDUP_WAYS - 1;
+	dt->window = window;
+	return (dt);
+}
+
+/*
+ * Was the packet at "p", of "caplen" bytes captured out of "len", seen
+ * in the window before "now"?  If "ip" isn't NULL, it points to the
+ * packet's IPv4 or IPv6 header, and only the packet from there on is
+ * compared, without the fields a router changes: the TTL and header
+ * checksum, or the hop limit.
+ */
+int
+dedup_seen(struct dedup_table *dt, uint64_t now, const u_char *p,
+	   u_int caplen, u_int len, const u_char *ip)
+{
+	struct dedup_slot *b, *victim;
+	u_char hdr[60];
+	uint64_t h;
+	u_int n, i;
+
+	h = dedup_hash(DEDUP_MUL, (const u_char *)&len, sizeof(len));
+	if (ip != NULL) {
+		caplen -= (u_int)(ip - p);
+		p = ip;
+		n = 0;
+		if (caplen >= 20 && *p >> 4 == 4) {
+			n = (*p & 0x0f) * 4;
+			if (n < 20 || n > caplen)
+				n = 20;
+			memcpy(hdr, p, n);
+			hdr[8] = 0;		/* TTL */
+			hdr[10] = hdr[11] = 0;	/* header checksum */
+		} else if (caplen >= 40 && *p >> 4 == 6) {
+			n = 40;
+			memcpy(hdr, p, n);
+			hdr[7] = 0;		/* hop limit */
+		}
+		h = dedup_hash(h, hdr, n);
+		p += n;
+		caplen -= n;
+	}
+	h = dedup_hash(h, p, caplen);
+	h ^= h >> 32;
+	if (h == 0)
+		h = 1;
+
+	b = &dt->slots[(h & dt->mask) * DEDUP_WAYS];
+	victim = b;
+	for (i = 0; i < DEDUP_WAYS; i++) {
+		if (b[i].hash == h) {
+			if ((now >= b[i].time ? now - b[i].time :
+			    b[i].time - now) <= dt->window)
+				return (1);
+			victim = &b[i];
+			break;
+		}
+		if (b[i].hash == 0) {
+			victim = &b[i];
+			break;
+		}
+		if (b[i].time < victim->time)
+			victim = &b[i];
+	}
+	victim->hash = h;
+	victim->time = now;
+	return (0);
+}
+
+void
+dedup_free(struct dedup_table *dt)
+{
+	nd_big_free(dt->slots);
+	free(dt);
+}
@@ -0,0 +1,36 @@
+/*
+ * Copyright (c) 2026 The TCPDUMP project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that: (1) source code
+ * distributions retain the above copyright notice and this paragraph
+ * in its entirety, and (2) distributions including binary code include
+ * the above copyright notice and this paragraph in its entirety in
+ * the documentation or other materials provided with the distribution.
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND
+ * WITHOUT ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, WITHOUT
+ * LIMITATION, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE.
+ */
+
+
+
+/*
+ * Duplicate packet suppression, for --dedup.
+ */
+#ifndef dedup_h
+#define dedup_h
+
+#define DEDUP_DEFAULT_WINDOW	1000	/* microseconds */
+#define DEDUP_SLOTS		65536	/* a power of 2, of DEDUP_WAYS */
+#define DEDUP_WAYS		4
+
+struct dedup_table;
+
+extern struct dedup_table *dedup_new(uint64_t);
+extern int dedup_seen(struct dedup_table *, uint64_t, const u_char *,
+    u_int, u_int, const u_char *);
+extern void dedup_free(struct dedup_table *);
+
+#endif /* dedup_h */
@@ -0,0 +1,720 @@
+/*
+ * Copyright (c) 2026 The TCPDUMP project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that: (1) source code
+ * distributions retain the above copyright notice and this paragraph
+ * in its entirety, and (2) distributions including binary code include
+ * the above copyright notice and this paragraph in its entirety in
+ * the documentation or other materials provided with the distribution.
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND
+ * WITHOUT ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, WITHOUT
+ * LIMITATION, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE.
+ */
+
+
+
+/*
+ * The display filter language:
+ *
+ *	expr	:= term { ("or" | "||") term }
+ *	term	:= factor { ("and" | "&&") factor }
+ *	factor	:= ("not" | "!") factor | "(" expr ")" | test
+ *	test	:= name [ relop value ]
+ *	relop	:= "==" | "!=" | "<" | "<=" | ">" | ">=" | "eq" | "ne" |
+ *		   "lt" | "le" | "gt" | "ge" | "contains" | "startswith" |
+ *		   "endswith"
+ *
+ * A name is a field, such as "ip.src", or a protocol, such as "tcp",
+ * which is there if it reported any field; a test of a name alone is
+ * true if it's there at all.  "ip.addr", "ip6.addr", "ether.addr",
+ * "tcp.port" and "udp.port" stand for either of the source and the
+ * destination.  A value is a number, in decimal or in hex with 0x in
+ * front, an IPv4, IPv6 or MAC address, an IPv4 or IPv6 prefix with the
+ * number of bits after a "/", or a string in double quotes, in which
+ * a backslash quotes the next character.  "a != b" is "not a == b":
+ * no occurrence of a is b.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include "netdissect-stdinc.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "netdissect.h"
+#include "netdissect-fields.h"
+#include "strtoaddr.h"
+#include "dfilter.h"
+
+#define DF_MAXTESTS	64	/* one bit each in ndo_dfilter_hits */
+#define DF_MAXCODE	256
+#define DF_MAXDEPTH	32	/* of parentheses and nots */
+
+/* Tests */
+#define DF_PRESENT	0
+#define DF_EQ		1
+#define DF_LT		2
+#define DF_LE		3
+#define DF_GT		4
+#define DF_GE		5
+#define DF_CONTAINS	6
+#define DF_STARTSWITH	7
+#define DF_ENDSWITH	8
+
+/* Kinds of value */
+#define DF_V_NONE	0
+#define DF_V_NUM	1
+#define DF_V_ADDR	2
+#define DF_V_STR	3
+
+/* Program operations; anything less is a test */
+#define DF_AND		0xfd
+#define DF_OR		0xfe
+#define DF_NOT		0xff
+
+/* Three-valued logic */
+#define DF_FALSE	0
+#define DF_TRUE		1
+#define DF_UNKNOWN	2
+
+struct df_test {
+	u_char proto, field;	/* field 0: any field of the protocol */
+	u_char op;
+	u_char kind;
+	u_char next;		/* next test of the field + 1, or 0 */
+	u_char addrlen;
+	u_char plen;		/* prefix length in bits */
+	u_char addr[16];
+	uint64_t num;
+	const char *str;	/* in the string pool */
+	u_int slen;
+};
+
+struct nd_dfilter {
+	struct df_test tests[DF_MAXTESTS];
+	u_int ntests;
+	u_char code[DF_MAXCODE];
+	u_int ncode;
+	u_char first[NDF_NPROTOS][NDF_MAXFIELDS];	/* test + 1, or 0 */
+	char *pool_end;		/* of the strings used so far */
+	char pool[1];		/* the filter's strings, as long as it is */
+};
+
+/* Tokens */
+#define DF_T_END	0
+#define DF_T_LPAREN	1
+#define DF_T_RPAREN	2
+#define DF_T_AND	3
+#define DF_T_OR		4
+#define DF_T_NOT	5
+#define DF_T_RELOP	6
+#define DF_T_WORD	7
+#define DF_T_STRING	8
+
+struct df_parser {
+	struct nd_dfilter *df;
+	const char *p;		/* what's left to scan */
+	int tok;		/* the current token */
+	int op;			/* DF_T_RELOP: DF_EQ, ...; -1 for != */
+	const char *text;	/* DF_T_WORD, DF_T_STRING: its text */
+	size_t len;		/* and its length */
+	u_int depth;
+	char *errbuf;
+	size_t errbuflen;
+};
+
+static const struct {
+	const char *word;
+	int op;
+} df_relops[] = {
+	{ "==", DF_EQ }, { "!=", -1 }, { "<=", DF_LE }, { ">=", DF_GE },
+	{ "<", DF_LT }, { ">", DF_GT }, { "eq", DF_EQ }, { "ne", -1 },
+	{ "lt", DF_LT }, { "le", DF_LE }, { "gt", DF_GT }, { "ge", DF_GE },
+	{ "contains", DF_CONTAINS }, { "startswith", DF_STARTSWITH },
+	{ "endswith", DF_ENDSWITH }
+};
+
+static const struct {
+	const char *name;
+	const char *src, *dst;
+} df_aliases[] = {
+	{ "ip.addr", "ip.src", "ip.dst" },
+	{ "ip6.addr", "ip6.src", "ip6.dst" },
+	{ "ether.addr", "ether.src", "ether.dst" },
+	{ "tcp.port", "tcp.sport", "tcp.dport" },
+	{ "udp.port", "udp.sport", "udp.dport" }
+};
+
+static int	df_error(struct df_parser *, FORMAT_STRING(const char *fmt),
+		    ...) PRINTFLIKE(2, 3);
+static int	df_expr(struct df_parser *);
+
+static int
+df_error(struct df_parser *ps, const char *fmt, ...)
+{
+	va_list ap;
+
+	va_start(ap, fmt);
+	vsnprintf(ps->errbuf, ps->errbuflen, fmt, ap);
+	va_end(ap);
+	return (-1);
+}
+
+static int
+df_isword(int c)
+{
+	return ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ||
+	    (c >= '0' && c <= '9') || c == '_' || c == '.' || c == ':' ||
+	    c == '/' || c == '-');
+}
+
+static int
+df_isword_is(struct df_parser *ps, const char *word)
+{
+	return (strlen(word) == ps->len &&
+	    memcmp(word, ps->text, ps->len) == 0);
+}
+
+/*
+ * Scan the next token.  A string has its quoting taken out, into the
+ * string pool.
+ */
+static int
+df_next(struct df_parser *ps)
+{
+	const char *p;
+	char *s;
+	size_t i, n;
+
+	p = ps->p;
+	while (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r')
+		p++;
+	ps->text = p;
+	if (*p == '\0') {
+		ps->tok = DF_T_END;
+		return (0);
+	}
+	if (*p == '(' || *p == ')') {
+		ps->tok = *p == '(' ? DF_T_LPAREN : DF_T_RPAREN;
+		ps->p = p + 1;
+		return (0);
+	}
+	if ((p[0] == '&' && p[1] == '&') || (p[0] == '|' && p[1] == '|')) {
+		ps->tok = p[0] == '&' ? DF_T_AND : DF_T_OR;
+		ps->p = p + 2;
+		return (0);
+	}
+	if (*p == '"') {
+		s = ps->df->pool_end;
+		for (p++; *p != '"'; p++) {
+			if (*p == '\\' && p[1] != '\0')
+				p++;
+			else if (*p == '\0')
+				return (df_error(ps, "unterminated string"));
+			*s++ = *p;
+		}
+		ps->tok = DF_T_STRING;
+		ps->text = ps->df->pool_end;
+		ps->len = s - ps->df->pool_end;
+		ps->df->pool_end = s;
+		ps->p = p + 1;
+		return (0);
+	}
+	for (i = 0; i < sizeof(df_relops) / sizeof(df_relops[0]); i++) {
+		n = strlen(df_relops[i].word);
+		if (strncmp(p, df_relops[i].word, n) == 0 &&
+		    (!df_isword(df_relops[i].word[0]) || !df_isword(p[n]))) {
+			ps->tok = DF_T_RELOP;
+			ps->op = df_relops[i].op;
+			ps->p = p + n;
+			return (0);
+		}
+	}
+	if (*p == '!') {
+		ps->tok = DF_T_NOT;
+		ps->p = p + 1;
+		return (0);
+	}
+	if (!df_isword(*p))
+		return (df_error(ps, "unexpected character '%c'", *p));
+	while (df_isword(*p))
+		p++;
+	ps->len = p - ps->text;
+	ps->p = p;
+	if (df_isword_is(ps, "and"))
+		ps->tok = DF_T_AND;
+	else if (df_isword_is(ps, "or"))
+		ps->tok = DF_T_OR;
+	else if (df_isword_is(ps, "not"))
+		ps->tok = DF_T_NOT;
+	else
+		ps->tok = DF_T_WORD;
+	return (0);
+}
+
+static int
+df_emit(struct df_parser *ps, u_int op)
+{
+	if (ps->df->ncode == DF_MAXCODE)
+		return (df_error(ps, "filter too long"));
+	ps->df->code[ps->df->ncode++] = (u_char)op;
+	return (0);
+}
+
+/*
+ * Parse a MAC address, six pairs of hex digits between colons.
+ */
+static int
+df_parse_mac(const char *s, u_char *mac)
+{
+	u_int i, d, v;
+
+	for (i = 0; i < 6; i++) {
+		v = 0;
+		for (d = 0; d < 2; d++, s++) {
+			if (*s >= '0' && *s <= '9')
+				v = v << 4 | (*s - '0');
+			else if (*s >= 'a' && *s <= 'f')
+				v = v << 4 | (*s - 'a' + 10);
+			else if (*s >= 'A' && *s <= 'F')
+				v = v << 4 | (*s - 'A' + 10);
+			else
+				return (-1);
+		}
+		mac[i] = (u_char)v;
+		if (*s != (i == 5 ? '\0' : ':'))
+			return (-1);
+		s++;
+	}
+	return (0);
+}
+
+/*
+ * Fill in the value of "t" from the current token.
+ */
+static int
+df_value(struct df_parser *ps, struct df_test *t)
+{
+	char buf[64], *slash, *end;
+	unsigned long bits;
+
+	if (ps->tok == DF_T_STRING) {
+		t->kind = DF_V_STR;
+		t->str = ps->text;
+		t->slen = (u_int)ps->len;
+		return (0);
+	}
+	if (ps->tok != DF_T_WORD)
+		return (df_error(ps, "value expected"));
+	if (t->op >= DF_CONTAINS)
+		return (df_error(ps, "string expected after %s",
+		    t->op == DF_CONTAINS ? "contains" :
+		    t->op == DF_STARTSWITH ? "startswith" : "endswith"));
+	if (ps->len >= sizeof(buf))
+		return (df_error(ps, "bad value %.*s", (int)ps->len,
+		    ps->text));
+	memcpy(buf, ps->text, ps->len);
+	buf[ps->len] = '\0';
+	if (buf[0] >= '0' && buf[0] <= '9') {
+		t->num = strtoull(buf, &end, 0);
+		if (*end == '\0') {
+			t->kind = DF_V_NUM;
+			return (0);
+		}
+	}
+	t->kind = DF_V_ADDR;
+	if (df_parse_mac(buf, t->addr) == 0) {
+		t->addrlen = 6;
+		t->plen = 48;
+		return (0);
+	}
+	slash = strchr(buf, '/');
+	if (slash != NULL)
+		*slash++ = '\0';
+	if (strtoaddr(buf, t->addr) == 1)
+		t->addrlen = 4;
+	else if (strtoaddr6(buf, t->addr) == 1)
+		t->addrlen = 16;
+	else
+		return (df_error(ps, "bad value %.*s", (int)ps->len,
+		    ps->text));
+	t->plen = t->addrlen * 8;
+	if (slash != NULL) {
+		bits = strtoul(slash, &end, 10);
+		if (*slash == '\0' || *end != '\0' || bits > t->plen)
+			return (df_error(ps, "bad prefix length in %.*s",
+			    (int)ps->len, ps->text));
+		t->plen = (u_char)bits;
+		if (t->op != DF_EQ)
+			return (df_error(ps,
+			    "a prefix can only be compared with == or !="));
+	}
+	return (0);
+}
+
+/*
+ * Add a test of "name", with the relational operator and value, if
+ * any, that follow it.
+ */
+static int
+df_add_test(struct df_parser *ps, const char *name, size_t len, int op,
+	    const struct df_test *val)
+{
+	struct nd_dfilter *df = ps->df;
+	struct df_test *t;
+	u_int proto, field;
+
+	if (nd_field_lookup(name, len, &proto, &field) == -1)
+		return (df_error(ps, "unknown field %.*s", (int)len, name));
+	if (df->ntests == DF_MAXTESTS)
+		return (df_error(ps, "more than %u tests", DF_MAXTESTS));
+	t = &df->tests[df->ntests];
+	if (val != NULL)
+		*t = *val;
+	else
+		memset(t, 0, sizeof(*t));
+	t->proto = (u_char)proto;
+	t->field = (u_char)field;
+	t->op = (u_char)op;
+	t->next = df->first[proto][field];
+	df->first[proto][field] = (u_char)++df->ntests;
+	return (df_emit(ps, df->ntests - 1));
+}
+
+static int
+df_test(struct df_parser *ps)
+{
+	struct df_test val;
+	const char *name;
+	size_t len;
+	u_int i;
+	int op, neg;
+
+	if (ps->tok != DF_T_WORD)
+		return (df_error(ps, "field name expected"));
+	name = ps->text;
+	len = ps->len;
+	if (df_next(ps) == -1)
+		return (-1);
+	op = DF_PRESENT;
+	neg = 0;
+	memset(&val, 0, sizeof(val));
+	if (ps->tok == DF_T_RELOP) {
+		op = ps->op;
+		if (op == -1) {
+			op = DF_EQ;
+			neg = 1;
+		}
+		val.op = (u_char)op;
+		if (df_next(ps) == -1 || df_value(ps, &val) == -1 ||
+		    df_next(ps) == -1)
+			return (-1);
+	}
+	for (i = 0; i < sizeof(df_aliases) / sizeof(df_aliases[0]); i++) {
+		if (strlen(df_aliases[i].name) == len &&
+		    memcmp(df_aliases[i].name, name, len) == 0)
+			break;
+	}
+	if (i < sizeof(df_aliases) / sizeof(df_aliases[0])) {
+		if (df_add_test(ps, df_aliases[i].src,
+		    strlen(df_aliases[i].src), op, &val) == -1 ||
+		    df_add_test(ps, df_aliases[i].dst,
+		    strlen(df_aliases[i].dst), op, &val) == -1 ||
+		    df_emit(ps, DF_OR) == -1)
+			return (-1);
+	} else if (df_add_test(ps, name, len, op, &val) == -1)
+		return (-1);
+	if (neg)
+		return (df_emit(ps, DF_NOT));
+	return (0);
+}
+
+static int
+df_factor(struct df_parser *ps)
+{
+	int tok, ret;
+
+	if (ps->tok != DF_T_NOT && ps->tok != DF_T_LPAREN)
+		return (df_test(ps));
+	if (++ps->depth > DF_MAXDEPTH)
+		return (df_error(ps, "filter nested too deeply"));
+	tok = ps->tok;
+	if (df_next(ps) == -1)
+		return (-1);
+	if (tok == DF_T_NOT)
+		ret = df_factor(ps) == -1 ? -1 : df_emit(ps, DF_NOT);
+	else {
+		ret = df_expr(ps);
+		if (ret == 0 && ps->tok != DF_T_RPAREN)
+			ret = df_error(ps, "missing )");
+		if (ret == 0)
+			ret = df_next(ps);
+	}
+	ps->depth--;
+	return (ret);
+}
+
+static int
+df_term(struct df_parser *ps)
+{
+	if (df_factor(ps) == -1)
+		return (-1);
+	while (ps->tok == DF_T_AND) {
+		if (df_next(ps) == -1 || df_factor(ps) == -1 ||
+		    df_emit(ps, DF_AND) == -1)
+			return (-1);
+	}
+	return (0);
+}
+
+static int
+df_expr(struct df_parser *ps)
+{
+	if (df_term(ps) == -1)
+		return (-1);
+	while (ps->tok == DF_T_OR) {
+		if (df_next(ps) == -1 || df_term(ps) == -1 ||
+		    df_emit(ps, DF_OR) == -1)
+			return (-1);
+	}
+	return (0);
+}
+
+/*
+ * Compile the display filter "expr".  Returns NULL, with a message in
+ * "errbuf", if it's not valid; the result is freed with free().
+ */
+struct nd_dfilter *
+nd_dfilter_compile(const char *expr, char *errbuf, size_t errbuflen)
+{
+	struct df_parser ps;
+	struct nd_dfilter *df;
+
+	df = (struct nd_dfilter *)calloc(1, sizeof(*df) + strlen(expr));
+	if (df == NULL) {
+		snprintf(errbuf, errbuflen, "out of memory");
+		return (NULL);
+	}
+	df->pool_end = df->pool;
+	memset(&ps, 0, sizeof(ps));
+	ps.df = df;
+	ps.p = expr;
+	ps.errbuf = errbuf;
+	ps.errbuflen = errbuflen;
+	if (df_next(&ps) == -1 || df_expr(&ps) == -1 ||
+	    (ps.tok != DF_T_END &&
+	     df_error(&ps, "unexpected %s", ps.text) == -1)) {
+		free(df);
+		return (NULL);
+	}
+	return (df);
+}
+
+/*
+ * Evaluate the program with the tests in "hits" true and the others
+ * undecided, or false if "final" is set.
+ */
+static int
+df_eval(const struct nd_dfilter *df, uint64_t hits, int final)
+{
+	u_char stack[DF_MAXCODE];
+	u_int i, n;
+	int a, b;
+
+	n = 0;
+	for (i = 0; i < df->ncode; i++) {
+		switch (df->code[i]) {
+		case DF_NOT:
+			if (stack[n - 1] != DF_UNKNOWN)
+				stack[n - 1] ^= 1;
+			break;
+		case DF_AND:
+			b = stack[--n];
+			a = stack[n - 1];
+			stack[n - 1] = a == DF_FALSE || b == DF_FALSE ?
+			    DF_FALSE : a == DF_TRUE && b == DF_TRUE ?
+			    DF_TRUE : DF_UNKNOWN;
+			break;
+		case DF_OR:
+			b = stack[--n];
+			a = stack[n - 1];
+			stack[n - 1] = a == DF_TRUE || b == DF_TRUE ?
+			    DF_TRUE : a == DF_FALSE && b == DF_FALSE ?
+			    DF_FALSE : DF_UNKNOWN;
+			break;
+		default:
+			stack[n++] = hits >> df->code[i] & 1 ? DF_TRUE :
+			    final ? DF_FALSE : DF_UNKNOWN;
+			break;
+		}
+	}
+	return (stack[0]);
+}
+
+static int
+df_cmp(const u_char *a, u_int alen, const u_char *b, u_int blen)
+{
+	int c;
+
+	c = memcmp(a, b, alen < blen ? alen : blen);
+	if (c != 0)
+		return (c);
+	return (alen < blen ? -1 : alen > blen);
+}
+
+/*
+ * Does the field's value "val", of "type", satisfy "t"?
+ */
+static int
+df_test_match(const struct df_test *t, u_int type, const u_char *val,
+	      u_int len)
+{
+	const u_char *s = (const u_char *)t->str;
+	uint64_t v;
+	u_int i;
+	int c;
+
+	switch (t->kind) {
+	case DF_V_NONE:
+		return (1);
+	case DF_V_NUM:
+		if (type != NDF_T_UINT || len > 8)
+			return (0);
+		v = 0;
+		for (i = 0; i < len; i++)
+			v = v << 8 | val[i];
+		c = v < t->num ? -1 : v > t->num;
+		break;
+	case DF_V_ADDR:
+		if (type != NDF_T_ADDR || len != t->addrlen)
+			return (0);
+		if (t->plen < t->addrlen * 8) {
+			i = t->plen / 8;
+			if (memcmp(val, t->addr, i) != 0)
+				return (0);
+			return (t->plen % 8 == 0 ||
+			    ((val[i] ^ t->addr[i]) &
+			     (0xff00 >> t->plen % 8)) == 0);
+		}
+		c = memcmp(val, t->addr, len);
+		break;
+	default:
+		if (type != NDF_T_STRING)
+			return (0);
+		switch (t->op) {
+		case DF_CONTAINS:
+			for (i = 0; i + t->slen <= len; i++)
+				if (memcmp(val + i, s, t->slen) == 0)
+					return (1);
+			return (0);
+		case DF_STARTSWITH:
+			return (len >= t->slen &&
+			    memcmp(val, s, t->slen) == 0);
+		case DF_ENDSWITH:
+			return (len >= t->slen &&
+			    memcmp(val + len - t->slen, s, t->slen) == 0);
+		}
+		c = df_cmp(val, len, s, t->slen);
+		break;
+	}
+	switch (t->op) {
+	case DF_EQ:
+		return (c == 0);
+	case DF_LT:
+		return (c < 0);
+	case DF_LE:
+		return (c <= 0);
+	case DF_GT:
+		return (c > 0);
+	default:
+		return (c >= 0);
+	}
+}
+
+/*
+ * Start on a packet: none of the tests has held yet.
+ */
+void
+nd_dfilter_begin(netdissect_options *ndo)
+{
+	ndo->ndo_dfilter_hits = 0;
+	ndo->ndo_dfilter_verdict = ND_DFILTER_UNDECIDED;
+}
+
+/*
+ * A printer reported a field: see which tests it satisfies, and if it
+ * decided the verdict against the packet, stop dissecting it.  Fields
+ * of the frame itself are reported outside the printers, where the
+ * dissection can't be stopped, so a verdict they decide takes effect
+ * at the next field or the end of the packet.
+ */
+void
+nd_dfilter_field(netdissect_options *ndo, u_int proto, u_int field,
+		 u_int type, const u_char *val, u_int len)
+{
+	const struct nd_dfilter *df = ndo->ndo_dfilter;
+	const struct df_test *t;
+	uint64_t hits;
+	u_int i;
+
+	if (ndo->ndo_dfilter_verdict != ND_DFILTER_UNDECIDED) {
+		if (ndo->ndo_dfilter_verdict == ND_DFILTER_NOMATCH &&
+		    proto != NDF_FRAME)
+			goto drop;
+		return;
+	}
+	if (proto >= NDF_NPROTOS || field >= NDF_MAXFIELDS)
+		return;
+	hits = ndo->ndo_dfilter_hits;
+	for (i = df->first[proto][field]; i != 0; i = t->next) {
+		t = &df->tests[i - 1];
+		if ((hits >> (i - 1) & 1) == 0 &&
+		    df_test_match(t, type, val, len))
+			hits |= (uint64_t)1 << (i - 1);
+	}
+	/* The protocol is there. */
+	for (i = df->first[proto][0]; i != 0; i = df->tests[i - 1].next)
+		hits |= (uint64_t)1 << (i - 1);
+	if (hits == ndo->ndo_dfilter_hits)
+		return;
+	ndo->ndo_dfilter_hits = hits;
+	switch (df_eval(df, hits, 0)) {
+	case DF_TRUE:
+		ndo->ndo_dfilter_verdict = ND_DFILTER_MATCH;
+		return;
+	case DF_FALSE:
+		ndo->ndo_dfilter_verdict = ND_DFILTER_NOMATCH;
+		if (proto != NDF_FRAME)
+			goto drop;
+		return;
+	}
+	return;
+drop:
+	ndo->ndo_drop_line = 1;
+	ND_LONGJMP(ndo->ndo_truncated);
+}
+
+/*
+ * Done with the packet: does it match?  Tests that didn't hold by now
+ * never will.
+ */
+int
+nd_dfilter_match(netdissect_options *ndo)
+{
+	int verdict;
+
+	verdict = ndo->ndo_dfilter_verdict;
+	if (verdict == ND_DFILTER_UNDECIDED)
+		verdict = df_eval(ndo->ndo_dfilter, ndo->ndo_dfilter_hits, 1) ==
+		    DF_TRUE ? ND_DFILTER_MATCH : ND_DFILTER_NOMATCH;
+	ndo->ndo_dfilter_verdict = ND_DFILTER_IDLE;
+	return (verdict != ND_DFILTER_NOMATCH);
+}
@@ -0,0 +1,55 @@
+/*
+ * Copyright (c) 2026 The TCPDUMP project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that: (1) source code
+ * distributions retain the above copyright notice and this paragraph
+ * in its entirety, and (2) distributions including binary code include
+ * the above copyright notice and this paragraph in its entirety in
+ * the documentation or other materials provided with the distribution.
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND
+ * WITHOUT ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, WITHOUT
+ * LIMITATION, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE.
+ */
+
+
+
+#ifndef dfilter_h
+#define dfilter_h
+
+/*
+ * Display filters (--display-filter): an expression over the fields
+ * the printers report (see netdissect-fields.h), such as
+ *
+ *	domain.qname endswith ".corp" and not udp.port == 5353
+ *
+ * evaluated while the packet is dissected, with the packet's text
+ * taken back out of the output buffer if it doesn't match.
+ *
+ * nd_dfilter_compile() turns the expression into a list of tests and
+ * a postfix program combining them.  The program is read-only once
+ * compiled, so threads dissecting with copies of one ndo can share
+ * it; what's known about the current packet is kept in the ndo.  A
+ * test holds once any occurrence of its field satisfies it, so until
+ * the end of the packet a test that hasn't held yet is undecided, and
+ * the program is evaluated with three values each time a test comes
+ * to hold.  Once the verdict is known, later fields aren't looked at;
+ * if it's known not to match, nd_dfilter_field() stops the dissection
+ * at once with ndo->ndo_drop_line set, as for a truncated packet.
+ */
+#define ND_DFILTER_IDLE		0	/* not dissecting a packet */
+#define ND_DFILTER_UNDECIDED	1
+#define ND_DFILTER_MATCH	2
+#define ND_DFILTER_NOMATCH	3
+
+struct nd_dfilter;
+
+extern struct nd_dfilter *nd_dfilter_compile(const char *, char *, size_t);
+extern void nd_dfilter_begin(netdissect_options *);
+extern void nd_dfilter_field(netdissect_options *, u_int, u_int, u_int,
+    const u_char *, u_int);
+extern int nd_dfilter_match(netdissect_options *);
+
+#endif /* dfilter_h */
@@ -68,7 +68,107 @@
 #define UNALIGNED_OK
 #endif
 
-#if (defined(__i386__) || defined(_M_IX86) || defined(__X86__) || defined(__x86_64__) || defined(_M_X64)) || \
+#ifdef __has_builtin
+#define ND_HAS_BUILTIN(x)	__has_builtin(x)
+#else
+#define ND_HAS_BUILTIN(x)	0
+#endif
+
+#if (ND_IS_AT_LEAST_GNUC_VERSION(4,8) || \
+     (defined(__clang__) && ND_HAS_BUILTIN(__builtin_bswap16))) && \
+    defined(__BYTE_ORDER__) && \
+    (__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__ || \
+     __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__)
+/*
+ * The compiler knows the target's byte order and has byte-swapping
+ * builtins, so, whatever the processor, copy the bytes into a local
+ * with memcpy() and swap them if the host is little-endian.  The
+ * compiler turns a fixed-size memcpy() into a single load where the
+ * target allows unaligned loads (including ARMv6 and later and RISC-V
+ * built with -munaligned-access or an ISA guaranteeing them), and into
+ * the best sequence it has where it doesn't (byte loads, MIPS lwl/lwr),
+ * and the swap into one instruction (bswap, rev, rev8, ...) or shifts;
+ * it's never worse than assembling the bytes by hand, there's no
+ * undefined behavior for the sanitizer to object to, and the decision
+ * of whether unaligned loads are safe is left to the compiler flags
+ * for the target rather than to a list of processors here.
+ *
+ * The pointers are to nd_uintN_t byte arrays, so the compiler can't
+ * assume any alignment for them.
+ */
+#define ND_EXTRACT_MEMCPY_BSWAP
+
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+#define ND_BE_TO_HOST_16(v)	__builtin_bswap16(v)
+#define ND_BE_TO_HOST_32(v)	__builtin_bswap32(v)
+#define ND_BE_TO_HOST_64(v)	__builtin_bswap64(v)
+#define ND_LE_TO_HOST_16(v)	(v)
+#define ND_LE_TO_HOST_32(v)	(v)
+#define ND_LE_TO_HOST_64(v)	(v)
+#else
+#define ND_BE_TO_HOST_16(v)	(v)
+#define ND_BE_TO_HOST_32(v)	(v)
+#define ND_BE_TO_HOST_64(v)	(v)
+#define ND_LE_TO_HOST_16(v)	__builtin_bswap16(v)
+#define ND_LE_TO_HOST_32(v)	__builtin_bswap32(v)
+#define ND_LE_TO_HOST_64(v)	__builtin_bswap64(v)
+#endif
+
+static inline uint16_t
+EXTRACT_BE_U_2(const void *p)
+{
+	uint16_t val;
+
+	memcpy(&val, p, sizeof(val));
+	return ND_BE_TO_HOST_16(val);
+}
+
+static inline int16_t
+EXTRACT_BE_S_2(const void *p)
+{
+	return ((int16_t)EXTRACT_BE_U_2(p));
+}
+
+static inline uint32_t
+EXTRACT_BE_U_4(const void *p)
+{
+	uint32_t val;
+
+	memcpy(&val, p, sizeof(val));
+	return ND_BE_TO_HOST_32(val);
+}
+
+static inline int32_t
+EXTRACT_BE_S_4(const void *p)
+{
+	return ((int32_t)EXTRACT_BE_U_4(p));
+}
+
+static inline uint64_t
+EXTRACT_BE_U_8(const void *p)
+{
+	uint64_t val;
+
+	memcpy(&val, p, sizeof(val));
+	return ND_BE_TO_HOST_64(val);
+}
+
+static inline int64_t
+EXTRACT_BE_S_8(const void *p)
+{
+	return ((int64_t)EXTRACT_BE_U_8(p));
+}
+
+/*
+ * Extract an IPv4 address, which is in network byte order, and not
+ * necessarily aligned, and provide the result in host byte order.
+ */
+static inline uint32_t
+EXTRACT_IPV4_TO_HOST_ORDER(const void *p)
+{
+	return (EXTRACT_BE_U_4(p));
+}
+#elif (defined(__i386__) || defined(_M_IX86) || defined(__X86__) || defined(__x86_64__) || defined(_M_X64)) || \
     (defined(__m68k__) && (!defined(__mc68000__) && !defined(__mc68010__))) || \
     (defined(__ppc__) || defined(__ppc64__) || defined(_M_PPC) || defined(_ARCH_PPC) || defined(_ARCH_PPC64)) || \
     (defined(__s390__) || defined(__s390x__) || defined(__zarch__))
@@ -474,8 +574,54 @@ EXTRACT_IPV4_TO_NETWORK_ORDER(const void *p)
 
 /*
  * Macros to extract possibly-unaligned little-endian integral values.
- * XXX - do loads on little-endian machines that support unaligned loads?
+ * With the memcpy() and byte-swap builtins above, they're loads, too.
  */
+#ifdef ND_EXTRACT_MEMCPY_BSWAP
+static inline uint16_t
+EXTRACT_LE_U_2(const void *p)
+{
+	uint16_t val;
+
+	memcpy(&val, p, sizeof(val));
+	return ND_LE_TO_HOST_16(val);
+}
+
+static inline int16_t
+EXTRACT_LE_S_2(const void *p)
+{
+	return ((int16_t)EXTRACT_LE_U_2(p));
+}
+
+static inline uint32_t
+EXTRACT_LE_U_4(const void *p)
+{
+	uint32_t val;
+
+	memcpy(&val, p, sizeof(val));
+	return ND_LE_TO_HOST_32(val);
+}
+
+static inline int32_t
+EXTRACT_LE_S_4(const void *p)
+{
+	return ((int32_t)EXTRACT_LE_U_4(p));
+}
+
+static inline uint64_t
+EXTRACT_LE_U_8(const void *p)
+{
+	uint64_t val;
+
+	memcpy(&val, p, sizeof(val));
+	return ND_LE_TO_HOST_64(val);
+}
+
+static inline int64_t
+EXTRACT_LE_S_8(const void *p)
+{
+	return ((int64_t)EXTRACT_LE_U_8(p));
+}
+#else /* ND_EXTRACT_MEMCPY_BSWAP */
 #define EXTRACT_LE_U_2(p) \
 	((uint16_t)(((uint16_t)(*((const uint8_t *)(p) + 1)) << 8) | \
 	            ((uint16_t)(*((const uint8_t *)(p) + 0)) << 0)))
@@ -510,6 +656,7 @@ EXTRACT_IPV4_TO_NETWORK_ORDER(const void *p)
 	           ((uint64_t)(*((const uint8_t *)(p) + 2)) << 16) | \
 	           ((uint64_t)(*((const uint8_t *)(p) + 1)) << 8) | \
 	           ((uint64_t)(*((const uint8_t *)(p) + 0)) << 0)))
+#endif /* ND_EXTRACT_MEMCPY_BSWAP */
 
 /*
  * Non-power-of-2 sizes.
@@ -575,13 +722,25 @@ EXTRACT_IPV4_TO_NETWORK_ORDER(const void *p)
 #define ND_TTEST_16(p) ND_TTEST_LEN((p), 16)
 #define ND_TCHECK_16(p) ND_TCHECK_LEN((p), 16)
 
+/*
+ * The get_ functions, used through the GET_ macros below, check that
+ * the value was captured and longjmp out of the printer if it wasn't.
+ *
+ * A printer that reads several fields of a fixed-size header can
+ * instead check the whole header once, with ND_TCHECK_SIZE() or
+ * ND_TTEST_SIZE() on a pointer to it, and then read the fields of that
+ * header with the EXTRACT_ macros, which don't check again.  Only do
+ * that for fields of the structure that was checked, and within the
+ * code that the check covers.
+ */
+
 /* get_u_1 and get_s_1 */
 
 static inline uint8_t
 get_u_1(netdissect_options *ndo, const u_char *p)
 {
 	if (!ND_TTEST_1(p))
-		longjmp(ndo->ndo_truncated, 1);
+		ND_LONGJMP(ndo->ndo_truncated);
 	return EXTRACT_U_1(p);
 }
 
@@ -589,7 +748,7 @@ static inline int8_t
 get_s_1(netdissect_options *ndo, const u_char *p)
 {
 	if (!ND_TTEST_1(p))
-		longjmp(ndo->ndo_truncated, 1);
+		ND_LONGJMP(ndo->ndo_truncated);
 	return EXTRACT_S_1(p);
 }
 
@@ -599,7 +758,7 @@ static inline uint16_t
 get_be_u_2(netdissect_options *ndo, const u_char *p)
 {
 	if (!ND_TTEST_2(p))
-		longjmp(ndo->ndo_truncated, 1);
+		ND_LONGJMP(ndo->ndo_truncated);
 	return EXTRACT_BE_U_2(p);
 }
 
@@ -607,7 +766,7 @@ static inline uint32_t
 get_be_u_3(netdissect_options *ndo, const u_char *p)
 {
 	if (!ND_TTEST_3(p))
-		longjmp(ndo->ndo_truncated, 1);
+		ND_LONGJMP(ndo->ndo_truncated);
 	return EXTRACT_BE_U_3(p);
 }
 
@@ -615,7 +774,7 @@ static inline uint32_t
 get_be_u_4(netdissect_options *ndo, const u_char *p)
 {
 	if (!ND_TTEST_4(p))
-		longjmp(ndo->ndo_truncated, 1);
+		ND_LONGJMP(ndo->ndo_truncated);
 	return EXTRACT_BE_U_4(p);
 }
 
@@ -623,7 +782,7 @@ static inline uint64_t
 get_be_u_5(netdissect_options *ndo, const u_char *p)
 {
 	if (!ND_TTEST_5(p))
-		longjmp(ndo->ndo_truncated, 1);
+		ND_LONGJMP(ndo->ndo_truncated);
 	return EXTRACT_BE_U_5(p);
 }
 
@@ -631,7 +790,7 @@ static inline uint64_t
 get_be_u_6(netdissect_options *ndo, const u_char *p)
 {
 	if (!ND_TTEST_6(p))
-		longjmp(ndo->ndo_truncated, 1);
+		ND_LONGJMP(ndo->ndo_truncated);
 	return EXTRACT_BE_U_6(p);
 }
 
@@ -639,7 +798,7 @@ static inline uint64_t
 get_be_u_7(netdissect_options *ndo, const u_char *p)
 {
 	if (!ND_TTEST_7(p))
-		longjmp(ndo->ndo_truncated, 1);
+		ND_LONGJMP(ndo->ndo_truncated);
 	return EXTRACT_BE_U_7(p);
 }
 
@@ -647,7 +806,7 @@ static inline uint64_t
 get_be_u_8(netdissect_options *ndo, const u_char *p)
 {
 	if (!ND_TTEST_8(p))
-		longjmp(ndo->ndo_truncated, 1);
+		ND_LONGJMP(ndo->ndo_truncated);
 	return EXTRACT_BE_U_8(p);
 }
 
@@ -657,7 +816,7 @@ static inline int16_t
 get_be_s_2(netdissect_options *ndo, const u_char *p)
 {
 	if (!ND_TTEST_2(p))
-		longjmp(ndo->ndo_truncated, 1);
+		ND_LONGJMP(ndo->ndo_truncated);
 	return EXTRACT_BE_S_2(p);
 }
 
@@ -665,7 +824,7 @@ static inline int32_t
 get_be_s_3(netdissect_options *ndo, const u_char *p)
 {
 	if (!ND_TTEST_3(p))
-		longjmp(ndo->ndo_truncated, 1);
+		ND_LONGJMP(ndo->ndo_truncated);
 	return EXTRACT_BE_S_3(p);
 }
 
@@ -673,7 +832,7 @@ static inline int32_t
 get_be_s_4(netdissect_options *ndo, const u_char *p)
 {
 	if (!ND_TTEST_4(p))
-		longjmp(ndo->ndo_truncated, 1);
+		ND_LONGJMP(ndo->ndo_truncated);
 	return EXTRACT_BE_S_4(p);
 }
 
@@ -681,7 +840,7 @@ static inline int64_t
 get_be_s_5(netdissect_options *ndo, const u_char *p)
 {
 	if (!ND_TTEST_5(p))
-		longjmp(ndo->ndo_truncated, 1);
+		ND_LONGJMP(ndo->ndo_truncated);
 	return EXTRACT_BE_S_5(p);
 }
 
@@ -689,7 +848,7 @@ static inline int64_t
 get_be_s_6(netdissect_options *ndo, const u_char *p)
 {
 	if (!ND_TTEST_6(p))
-		longjmp(ndo->ndo_truncated, 1);
+		ND_LONGJMP(ndo->ndo_truncated);
 	return EXTRACT_BE_S_6(p);
 }
 
@@ -697,7 +856,7 @@ static inline int64_t
 get_be_s_7(netdissect_options *ndo, const u_char *p)
 {
 	if (!ND_TTEST_7(p))
-		longjmp(ndo->ndo_truncated, 1);
+		ND_LONGJMP(ndo->ndo_truncated);
 	return EXTRACT_BE_S_7(p);
 }
 
@@ -705,7 +864,7 @@ static inline int64_t
 get_be_s_8(netdissect_options *ndo, const u_char *p)
 {
 	if (!ND_TTEST_8(p))
-		longjmp(ndo->ndo_truncated, 1);
+		ND_LONGJMP(ndo->ndo_truncated);
 	return EXTRACT_BE_S_8(p);
 }
 
@@ -715,7 +874,7 @@ static inline uint16_t
 get_he_u_2(netdissect_options *ndo, const u_char *p)
 {
 	if (!ND_TTEST_2(p))
-		longjmp(ndo->ndo_truncated, 1);
+		ND_LONGJMP(ndo->ndo_truncated);
 	return EXTRACT_HE_U_2(p);
 }
 
@@ -723,7 +882,7 @@ static inline uint32_t
 get_he_u_4(netdissect_options *ndo, const u_char *p)
 {
 	if (!ND_TTEST_4(p))
-		longjmp(ndo->ndo_truncated, 1);
+		ND_LONGJMP(ndo->ndo_truncated);
 	return EXTRACT_HE_U_4(p);
 }
 
@@ -733,7 +892,7 @@ static inline int16_t
 get_he_s_2(netdissect_options *ndo, const u_char *p)
 {
 	if (!ND_TTEST_2(p))
-		longjmp(ndo->ndo_truncated, 1);
+		ND_LONGJMP(ndo->ndo_truncated);
 	return EXTRACT_HE_S_2(p);
 }
 
@@ -741,7 +900,7 @@ static inline int32_t
 get_he_s_4(netdissect_options *ndo, const u_char *p)
 {
 	if (!ND_TTEST_4(p))
-		longjmp(ndo->ndo_truncated, 1);
+		ND_LONGJMP(ndo->ndo_truncated);
 	return EXTRACT_HE_S_4(p);
 }
 
@@ -751,7 +910,7 @@ static inline uint16_t
 get_le_u_2(netdissect_options *ndo, const u_char *p)
 {
 	if (!ND_TTEST_2(p))
-		longjmp(ndo->ndo_truncated, 1);
+		ND_LONGJMP(ndo->ndo_truncated);
 	return EXTRACT_LE_U_2(p);
 }
 
@@ -759,7 +918,7 @@ static inline uint32_t
 get_le_u_3(netdissect_options *ndo, const u_char *p)
 {
 	if (!ND_TTEST_3(p))
-		longjmp(ndo->ndo_truncated, 1);
+		ND_LONGJMP(ndo->ndo_truncated);
 	return EXTRACT_LE_U_3(p);
 }
 
@@ -767,7 +926,7 @@ static inline uint32_t
 get_le_u_4(netdissect_options *ndo, const u_char *p)
 {
 	if (!ND_TTEST_4(p))
-		longjmp(ndo->ndo_truncated, 1);
+		ND_LONGJMP(ndo->ndo_truncated);
 	return EXTRACT_LE_U_4(p);
 }
 
@@ -775,7 +934,7 @@ static inline uint64_t
 get_le_u_5(netdissect_options *ndo, const u_char *p)
 {
 	if (!ND_TTEST_5(p))
-		longjmp(ndo->ndo_truncated, 1);
+		ND_LONGJMP(ndo->ndo_truncated);
 	return EXTRACT_LE_U_5(p);
 }
 
@@ -783,7 +942,7 @@ static inline uint64_t
 get_le_u_6(netdissect_options *ndo, const u_char *p)
 {
 	if (!ND_TTEST_6(p))
-		longjmp(ndo->ndo_truncated, 1);
+		ND_LONGJMP(ndo->ndo_truncated);
 	return EXTRACT_LE_U_6(p);
 }
 
@@ -791,7 +950,7 @@ static inline uint64_t
 get_le_u_7(netdissect_options *ndo, const u_char *p)
 {
 	if (!ND_TTEST_7(p))
-		longjmp(ndo->ndo_truncated, 1);
+		ND_LONGJMP(ndo->ndo_truncated);
 	return EXTRACT_LE_U_7(p);
 }
 
@@ -799,7 +958,7 @@ static inline uint64_t
 get_le_u_8(netdissect_options *ndo, const u_char *p)
 {
 	if (!ND_TTEST_8(p))
-		longjmp(ndo->ndo_truncated, 1);
+		ND_LONGJMP(ndo->ndo_truncated);
 	return EXTRACT_LE_U_8(p);
 }
 
@@ -809,7 +968,7 @@ static inline int16_t
 get_le_s_2(netdissect_options *ndo, const u_char *p)
 {
 	if (!ND_TTEST_2(p))
-		longjmp(ndo->ndo_truncated, 1);
+		ND_LONGJMP(ndo->ndo_truncated);
 	return EXTRACT_LE_S_2(p);
 }
 
@@ -817,7 +976,7 @@ static inline int32_t
 get_le_s_3(netdissect_options *ndo, const u_char *p)
 {
 	if (!ND_TTEST_3(p))
-		longjmp(ndo->ndo_truncated, 1);
+		ND_LONGJMP(ndo->ndo_truncated);
 	return EXTRACT_LE_S_3(p);
 }
 
@@ -825,7 +984,7 @@ static inline int32_t
 get_le_s_4(netdissect_options *ndo, const u_char *p)
 {
 	if (!ND_TTEST_4(p))
-		longjmp(ndo->ndo_truncated, 1);
+		ND_LONGJMP(ndo->ndo_truncated);
 	return EXTRACT_LE_S_4(p);
 }
 
@@ -833,7 +992,7 @@ static inline int64_t
 get_le_s_8(netdissect_options *ndo, const u_char *p)
 {
 	if (!ND_TTEST_8(p))
-		longjmp(ndo->ndo_truncated, 1);
+		ND_LONGJMP(ndo->ndo_truncated);
 	return EXTRACT_LE_S_8(p);
 }
 
@@ -843,7 +1002,7 @@ static inline uint32_t
 get_ipv4_to_host_order(netdissect_options *ndo, const u_char *p)
 {
 	if (!ND_TTEST_4(p))
-		longjmp(ndo->ndo_truncated, 1);
+		ND_LONGJMP(ndo->ndo_truncated);
 	return EXTRACT_IPV4_TO_HOST_ORDER(p);
 }
 
@@ -851,7 +1010,7 @@ static inline uint32_t
 get_ipv4_to_network_order(netdissect_options *ndo, const u_char *p)
 {
 	if (!ND_TTEST_4(p))
-		longjmp(ndo->ndo_truncated, 1);
+		ND_LONGJMP(ndo->ndo_truncated);
 	return EXTRACT_IPV4_TO_NETWORK_ORDER(p);
 }
 
@@ -859,7 +1018,7 @@ static inline void
 get_cpy_bytes(netdissect_options *ndo, u_char *dst, const u_char *p, size_t len)
 {
 	if (!ND_TTEST_LEN(p, len))
-		longjmp(ndo->ndo_truncated, 1);
+		ND_LONGJMP(ndo->ndo_truncated);
 	UNALIGNED_MEMCPY(dst, p, len);
 }
 
@@ -0,0 +1,482 @@
+/*
+ * Copyright (c) 2026 The TCPDUMP project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that: (1) source code
+ * distributions retain the above copyright notice and this paragraph
+ * in its entirety, and (2) distributions including binary code include
+ * the above copyright notice and this paragraph in its entirety in
+ * the documentation or other materials provided with the distribution.
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND
+ * WITHOUT ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, WITHOUT
+ * LIMITATION, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE.
+ */
+
+
+
+/*
+ * A flow index is a header followed by blocks, each covering the
+ * packets written since the one before, up to FLOW_INDEX_BLOCK_PACKETS
+ * of them, so that what's kept in memory while writing is bounded.  A
+ * block is a struct flow_index_block, saying how many flows it has and
+ * where in the savefile the packets it covers end, then three columns
+ * of nflows 32-bit values, the flow hashes in ascending order, the
+ * numbers of packets of the flows and the offsets in the block's data
+ * of their packet offsets, then the data: for each flow, the offsets
+ * of the records of its packets in the savefile, the first as it is
+ * and each of the rest as the difference from the one before, as
+ * LEB128 variable-length integers, which take a byte or two for the
+ * packets of a busy flow.  Finding a flow only takes reading the hash
+ * column of each block, and then the few bytes for the flow.
+ *
+ * As with the time index, the index is written in the byte order of
+ * the machine writing it, and one in the other byte order isn't used.
+ * A savefile that's still being written to, or whose writer died, has
+ * an index that covers the blocks written so far; what's past the end
+ * of the last block has to be read through.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include "netdissect-stdinc.h"
+
+#include <errno.h>
+#include <pcap.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "flow-index.h"
+
+#define FLOW_INDEX_MAGIC	0x54444658	/* "TDFX" */
+#define FLOW_INDEX_VERSION	1
+#define FLOW_INDEX_SLOTS	(2 * FLOW_INDEX_BLOCK_PACKETS)
+
+struct flow_index_hdr {
+	uint32_t magic;
+	uint16_t version;
+	uint16_t flags;		/* none yet */
+	uint32_t reserved[2];
+};
+
+struct flow_index_block {
+	uint32_t nflows;
+	uint32_t datalen;
+	uint64_t end;		/* the savefile offset the block covers to */
+};
+
+struct flow_index_flow {
+	uint32_t hash;
+	uint32_t count;
+	uint32_t dataoff;	/* while flushing */
+	uint32_t id;		/* index in fi_flows before sorting */
+	uint64_t prev;		/* while flushing */
+};
+
+struct flow_index {
+	FILE	*f;
+	uint32_t *slots;	/* FLOW_INDEX_SLOTS flow ids + 1, 0 = unused */
+	struct flow_index_flow *flows;
+	uint32_t nflows;
+	uint32_t *pkt_flow;	/* FLOW_INDEX_BLOCK_PACKETS of them */
+	uint64_t *pkt_off;
+	uint32_t npackets;
+	uint64_t end;
+	u_char	*data;		/* 10 bytes per packet at most */
+	uint32_t *col;		/* a column, while flushing */
+	uint32_t *rank;		/* of flow ids, while flushing */
+};
+
+/*
+ * Return the name of the flow index of the savefile fname, in memory
+ * to be freed by the caller, or NULL if it can't be allocated.
+ */
+char *
+flow_index_name(const char *fname)
+{
+	size_t len;
+	char *name;
+
+	len = strlen(fname) + sizeof(FLOW_INDEX_SUFFIX);
+	name = (char *)malloc(len);
+	if (name != NULL)
+		snprintf(name, len, "%s%s", fname, FLOW_INDEX_SUFFIX);
+	return (name);
+}
+
+static void
+flow_index_free(struct flow_index *fi)
+{
+	free(fi->slots);
+	free(fi->flows);
+	free(fi->pkt_flow);
+	free(fi->pkt_off);
+	free(fi->data);
+	free(fi->col);
+	free(fi->rank);
+	free(fi);
+}
+
+/*
+ * Start a flow index in f.  On failure, f is closed and NULL returned
+ * with a message in errbuf.
+ */
+struct flow_index *
+flow_index_open(FILE *f, char *errbuf)
+{
+	struct flow_index_hdr hdr;
+	struct flow_index *fi;
+
+	fi = (struct flow_index *)calloc(1, sizeof(*fi));
+	if (fi == NULL ||
+	    (fi->slots = (uint32_t *)calloc(FLOW_INDEX_SLOTS,
+	    sizeof(*fi->slots))) == NULL ||
+	    (fi->flows = (struct flow_index_flow *)malloc(
+	    FLOW_INDEX_BLOCK_PACKETS * sizeof(*fi->flows))) == NULL ||
+	    (fi->pkt_flow = (uint32_t *)malloc(
+	    FLOW_INDEX_BLOCK_PACKETS * sizeof(*fi->pkt_flow))) == NULL ||
+	    (fi->pkt_off = (uint64_t *)malloc(
+	    FLOW_INDEX_BLOCK_PACKETS * sizeof(*fi->pkt_off))) == NULL ||
+	    (fi->data = (u_char *)malloc(FLOW_INDEX_BLOCK_PACKETS * 10)) ==
+	    NULL ||
+	    (fi->col = (uint32_t *)malloc(
+	    FLOW_INDEX_BLOCK_PACKETS * sizeof(*fi->col))) == NULL ||
+	    (fi->rank = (uint32_t *)malloc(
+	    FLOW_INDEX_BLOCK_PACKETS * sizeof(*fi->rank))) == NULL) {
+		snprintf(errbuf, PCAP_ERRBUF_SIZE, "out of memory");
+		if (fi != NULL)
+			flow_index_free(fi);
+		(void)fclose(f);
+		return (NULL);
+	}
+	memset(&hdr, 0, sizeof(hdr));
+	hdr.magic = FLOW_INDEX_MAGIC;
+	hdr.version = FLOW_INDEX_VERSION;
+	if (fwrite(&hdr, sizeof(hdr), 1, f) != 1) {
+		snprintf(errbuf, PCAP_ERRBUF_SIZE, "%s", strerror(errno));
+		(void)fclose(f);
+		flow_index_free(fi);
+		return (NULL);
+	}
+	fi->f = f;
+	return (fi);
+}
+
+static int
+flow_cmp(const void *a, const void *b)
+{
+	uint32_t ha = ((const struct flow_index_flow *)a)->hash;
+	uint32_t hb = ((const struct flow_index_flow *)b)->hash;
+
+	return (ha < hb ? -1 : ha > hb);
+}
+
+static u_int
+flow_index_leb128(u_char *p, uint64_t v)
+{
+	u_int n = 0;
+
+	while (v >= 0x80) {
+		p[n++] = (u_char)(v | 0x80);
+		v >>= 7;
+	}
+	p[n++] = (u_char)v;
+	return (n);
+}
+
+/*
+ * Write out the block of the packets added since the last one; returns
+ * -1 if it couldn't be written.
+ */
+static int
+flow_index_flush(struct flow_index *fi)
+{
+	struct flow_index_block b;
+	struct flow_index_flow *fl;
+	uint32_t i, off;
+
+	if (fi->npackets == 0)
+		return (0);
+
+	/*
+	 * Sort the flows by hash, and lay out their data in that order:
+	 * first the sizes, then, with the offsets of each flow's data
+	 * known, the data.
+	 */
+	qsort(fi->flows, fi->nflows, sizeof(*fi->flows), flow_cmp);
+	for (i = 0; i < fi->nflows; i++) {
+		fi->rank[fi->flows[i].id] = i;
+		fi->flows[i].dataoff = 0;
+		fi->flows[i].prev = 0;
+	}
+	for (i = 0; i < fi->npackets; i++) {
+		u_char tmp[10];
+
+		fl = &fi->flows[fi->rank[fi->pkt_flow[i]]];
+		fl->dataoff += flow_index_leb128(tmp, fi->pkt_off[i] - fl->prev);
+		fl->prev = fi->pkt_off[i];
+	}
+	for (i = 0, off = 0; i < fi->nflows; i++) {
+		uint32_t len = fi->flows[i].dataoff;
+
+		fi->flows[i].dataoff = off;
+		fi->flows[i].prev = 0;
+		off += len;
+	}
+	b.nflows = fi->nflows;
+	b.datalen = off;
+	b.end = fi->end;
+	for (i = 0; i < fi->npackets; i++) {
+		fl = &fi->flows[fi->rank[fi->pkt_flow[i]]];
+		fl->dataoff += flow_index_leb128(fi->data + fl->dataoff,
+		    fi->pkt_off[i] - fl->prev);
+		fl->prev = fi->pkt_off[i];
+	}
+
+	if (fwrite(&b, sizeof(b), 1, fi->f) != 1)
+		return (-1);
+	for (i = 0; i < fi->nflows; i++)
+		fi->col[i] = fi->flows[i].hash;
+	if (fwrite(fi->col, sizeof(*fi->col), fi->nflows, fi->f) != fi->nflows)
+		return (-1);
+	for (i = 0; i < fi->nflows; i++)
+		fi->col[i] = fi->flows[i].count;
+	if (fwrite(fi->col, sizeof(*fi->col), fi->nflows, fi->f) != fi->nflows)
+		return (-1);
+	/* Each flow's data now ends where the next one's starts. */
+	for (i = 0, off = 0; i < fi->nflows; i++) {
+		fi->col[i] = off;
+		off = fi->flows[i].dataoff;
+	}
+	if (fwrite(fi->col, sizeof(*fi->col), fi->nflows, fi->f) != fi->nflows ||
+	    fwrite(fi->data, 1, b.datalen, fi->f) != b.datalen)
+		return (-1);
+
+	memset(fi->slots, 0, FLOW_INDEX_SLOTS * sizeof(*fi->slots));
+	fi->nflows = 0;
+	fi->npackets = 0;
+	return (0);
+}
+
+/*
+ * Add a packet of the flow with hash "hash", not 0, whose record, of
+ * "reclen" bytes, starts at "offset" in the savefile; a packet with a
+ * hash of 0, not of any IP flow, is only counted as covered.  Returns
+ * -1 if a block had to be written and couldn't be.
+ */
+int
+flow_index_add(struct flow_index *fi, uint32_t hash, uint64_t offset,
+    uint64_t reclen)
+{
+	uint32_t s, id;
+
+	fi->end = offset + reclen;
+	if (hash == 0)
+		return (0);
+	for (s = hash & (FLOW_INDEX_SLOTS - 1);
+	    fi->slots[s] != 0 && fi->flows[fi->slots[s] - 1].hash != hash;
+	    s = (s + 1) & (FLOW_INDEX_SLOTS - 1))
+		;
+	if (fi->slots[s] == 0) {
+		id = fi->nflows++;
+		fi->flows[id].hash = hash;
+		fi->flows[id].count = 0;
+		fi->flows[id].id = id;
+		fi->slots[s] = id + 1;
+	} else
+		id = fi->slots[s] - 1;
+	fi->flows[id].count++;
+	fi->pkt_flow[fi->npackets] = id;
+	fi->pkt_off[fi->npackets] = offset;
+	if (++fi->npackets == FLOW_INDEX_BLOCK_PACKETS)
+		return (flow_index_flush(fi));
+	return (0);
+}
+
+/*
+ * Write out the last block and finish the index; on failure, return -1
+ * with a message in errbuf.
+ */
+int
+flow_index_close(struct flow_index *fi, char *errbuf)
+{
+	int ret = 0;
+
+	if (flow_index_flush(fi) == -1) {
+		snprintf(errbuf, PCAP_ERRBUF_SIZE, "%s", strerror(errno));
+		ret = -1;
+	}
+	if (fclose(fi->f) != 0 && ret == 0) {
+		snprintf(errbuf, PCAP_ERRBUF_SIZE, "%s", strerror(errno));
+		ret = -1;
+	}
+	flow_index_free(fi);
+	return (ret);
+}
+
+/*
+ * Read "n" 32-bit values at "off" in "f" into "v".
+ */
+static int
+flow_index_read(FILE *f, long off, uint32_t *v, size_t n)
+{
+	return (fseek(f, off, SEEK_SET) == 0 &&
+	    fread(v, sizeof(*v), n, f) == n);
+}
+
+/*
+ * Look in the flow index of the savefile fname for the packets of the
+ * flow with hash "hash".  Returns 1 with the offsets of their records,
+ * in ascending order, in *offsetsp, in memory to be freed by the
+ * caller, and their number in *countp, and the offset the index covers
+ * the savefile to in *endp; 0 if there's no index; and -1, with a
+ * message in errbuf, if the index can't be used.
+ */
+int
+flow_index_find(const char *fname, uint32_t hash, uint64_t **offsetsp,
+    size_t *countp, uint64_t *endp, char *errbuf)
+{
+	struct flow_index_hdr hdr;
+	struct flow_index_block b;
+	uint32_t *hashes = NULL, v[2], lo, hi, mid, end;
+	uint64_t *offsets = NULL, *no, off;
+	size_t count = 0, max = 0;
+	u_char *data = NULL, *p, *ep;
+	long boff;
+	char *name;
+	FILE *f;
+	u_int shift;
+
+	name = flow_index_name(fname);
+	if (name == NULL) {
+		snprintf(errbuf, PCAP_ERRBUF_SIZE, "out of memory");
+		return (-1);
+	}
+	f = fopen(name, "rb");
+	if (f == NULL) {
+		if (errno == ENOENT) {
+			free(name);
+			return (0);
+		}
+		snprintf(errbuf, PCAP_ERRBUF_SIZE, "%s: %s", name,
+		    strerror(errno));
+		free(name);
+		return (-1);
+	}
+	if (fread(&hdr, sizeof(hdr), 1, f) != 1 ||
+	    hdr.magic != FLOW_INDEX_MAGIC) {
+		snprintf(errbuf, PCAP_ERRBUF_SIZE,
+		    "%s isn't a flow index from a machine with this byte order",
+		    name);
+		goto fail;
+	}
+	if (hdr.version != FLOW_INDEX_VERSION) {
+		snprintf(errbuf, PCAP_ERRBUF_SIZE,
+		    "%s is a version %u flow index, not version %u",
+		    name, hdr.version, FLOW_INDEX_VERSION);
+		goto fail;
+	}
+	*endp = 0;
+	boff = (long)sizeof(hdr);
+	for (;;) {
+		if (fseek(f, boff, SEEK_SET) != 0 ||
+		    fread(&b, sizeof(b), 1, f) != 1)
+			break;		/* the end, or a block cut short */
+		if (b.nflows > FLOW_INDEX_BLOCK_PACKETS ||
+		    b.datalen > FLOW_INDEX_BLOCK_PACKETS * 10)
+			goto bad;
+		if (hashes == NULL && (hashes = (uint32_t *)malloc(
+		    FLOW_INDEX_BLOCK_PACKETS * sizeof(*hashes))) == NULL)
+			goto nomem;
+		if (fread(hashes, sizeof(*hashes), b.nflows, f) != b.nflows)
+			break;
+
+		/* Binary search of the hash column. */
+		lo = 0;
+		hi = b.nflows;
+		while (lo < hi) {
+			mid = lo + (hi - lo) / 2;
+			if (hashes[mid] < hash)
+				lo = mid + 1;
+			else
+				hi = mid;
+		}
+		if (lo < b.nflows && hashes[lo] == hash) {
+			/* Its count, and where its data starts and ends. */
+			boff += (long)sizeof(b) + 4 * (long)b.nflows;
+			if (!flow_index_read(f, boff + 4 * (long)lo, &v[0], 1) ||
+			    !flow_index_read(f, boff + 4 * (long)b.nflows +
+			    4 * (long)lo, &v[1], 1))
+				break;
+			end = b.datalen;
+			if (lo + 1 < b.nflows &&
+			    !flow_index_read(f, boff + 4 * (long)b.nflows +
+			    4 * (long)(lo + 1), &end, 1))
+				break;
+			if (v[1] > end || end > b.datalen ||
+			    v[0] > end - v[1])
+				goto bad;
+			if (count + v[0] > max) {
+				max = count + v[0] + max;
+				no = (uint64_t *)realloc(offsets,
+				    max * sizeof(*offsets));
+				if (no == NULL)
+					goto nomem;
+				offsets = no;
+			}
+			if (data == NULL && (data = (u_char *)malloc(
+			    FLOW_INDEX_BLOCK_PACKETS * 10)) == NULL)
+				goto nomem;
+			if (fseek(f, boff + 8 * (long)b.nflows + (long)v[1],
+			    SEEK_SET) != 0 ||
+			    fread(data, 1, end - v[1], f) != end - v[1])
+				break;
+			p = data;
+			ep = data + (end - v[1]);
+			for (off = 0; v[0] != 0 && p < ep; v[0]--) {
+				uint64_t d = 0;
+
+				for (shift = 0; p < ep && shift < 64;
+				    shift += 7) {
+					d |= (uint64_t)(*p & 0x7f) << shift;
+					if ((*p++ & 0x80) == 0)
+						break;
+				}
+				off += d;
+				offsets[count++] = off;
+			}
+			boff -= (long)sizeof(b) + 4 * (long)b.nflows;
+		}
+		*endp = b.end;
+		boff += (long)sizeof(b) + 12 * (long)b.nflows +
+		    (long)b.datalen;
+	}
+	if (ferror(f)) {
+		snprintf(errbuf, PCAP_ERRBUF_SIZE, "%s: %s", name,
+		    strerror(errno));
+		goto fail;
+	}
+	(void)fclose(f);
+	free(name);
+	free(hashes);
+	free(data);
+	*offsetsp = offsets;
+	*countp = count;
+	return (1);
+bad:
+	snprintf(errbuf, PCAP_ERRBUF_SIZE, "%s is damaged", name);
+	goto fail;
+nomem:
+	snprintf(errbuf, PCAP_ERRBUF_SIZE, "out of memory");
+fail:
+	(void)fclose(f);
+	free(name);
+	free(hashes);
+	free(data);
+	free(offsets);
+	return (-1);
+}
@@ -0,0 +1,43 @@
+/*
+ * Copyright (c) 2026 The TCPDUMP project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that: (1) source code
+ * distributions retain the above copyright notice and this paragraph
+ * in its entirety, and (2) distributions including binary code include
+ * the above copyright notice and this paragraph in its entirety in
+ * the documentation or other materials provided with the distribution.
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND
+ * WITHOUT ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, WITHOUT
+ * LIMITATION, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE.
+ */
+
+
+
+/*
+ * Flow indexes of pcap savefiles, for -w with --write-flow-index, and
+ * for extracting one flow with -r and --flow.
+ *
+ * The flow index of a savefile is in the file with FLOW_INDEX_SUFFIX
+ * appended to its name, and gives, for the hash of each IP flow, the
+ * offsets of the records of its packets in the savefile.
+ */
+#ifndef flow_index_h
+#define flow_index_h
+
+#define FLOW_INDEX_SUFFIX		".fidx"
+#define FLOW_INDEX_BLOCK_PACKETS	262144	/* a power of 2 */
+
+struct flow_index;
+
+extern char *flow_index_name(const char *);
+extern struct flow_index *flow_index_open(FILE *, char *);
+extern int flow_index_add(struct flow_index *, uint32_t, uint64_t,
+    uint64_t);
+extern int flow_index_close(struct flow_index *, char *);
+extern int flow_index_find(const char *, uint32_t, uint64_t **, size_t *,
+    uint64_t *, char *);
+
+#endif /* flow_index_h */
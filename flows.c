@@ -0,0 +1,862 @@
+/*
+ * Copyright (c) 2026 The TCPDUMP project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that: (1) source code
+ * distributions retain the above copyright notice and this paragraph
+ * in its entirety, and (2) distributions including binary code include
+ * the above copyright notice and this paragraph in its entirety in
+ * the documentation or other materials provided with the distribution.
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND
+ * WITHOUT ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, WITHOUT
+ * LIMITATION, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include "netdissect-stdinc.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "netdissect.h"
+#include "netdissect-alloc.h"
+#include "addrtostr.h"
+#include "ethertype.h"
+#include "extract.h"
+#include "ipproto.h"
+#include "netdissect-fields.h"
+#include "tcp.h"
+#include "flows.h"
+
+/* IPFIX */
+#define IPFIX_VERSION		10
+#define IPFIX_HDRLEN		16
+#define IPFIX_TEMPLATE_SET	2
+#define IPFIX_TEMPLATE_V4	256
+#define IPFIX_TEMPLATE_V6	257
+#define IPFIX_RECLEN_V4		46
+#define IPFIX_RECLEN_V6		70
+#define IPFIX_MAXSETS		60000	/* bytes of records in a message */
+
+#define FLOWS_SNI_LEN		128	/* longer names are cut short */
+#define FLOWS_ALPN_LEN		32
+
+/* The labels of a flow that carried a TLS hello. */
+struct flows_tls {
+	u_int version;
+	char sni[FLOWS_SNI_LEN];
+	char alpn[FLOWS_ALPN_LEN];
+};
+
+struct nd_flows {
+	int format;
+	int collect;		/* --flow-collector */
+	uint64_t active_us;
+	uint64_t idle_us;
+
+	/* The table; a slot is free if its hash is 0. */
+	u_int size;		/* slots, a power of 2 */
+	u_int count;		/* flows in it */
+	u_int max;		/* most flows it may hold */
+	uint32_t *hash;
+	struct nd_flow_key *key;
+	uint64_t *packets;
+	uint64_t *bytes;
+	uint64_t *first;	/* microseconds */
+	uint64_t *last;
+	uint8_t *tcp_flags;
+	struct flows_tls **tls;	/* NULL unless it has labels */
+
+	/* The packet being dissected. */
+	struct nd_flow_pkt pkt;
+	uint64_t now;		/* its time stamp, in microseconds */
+	int collected;		/* it carried flows of its own */
+	uint64_t next_scan;
+
+	/* IPFIX data sets, and the message header's sequence number. */
+	u_char *set4, *set6;
+	u_int len4, len6;
+	uint32_t sequence;
+
+	uint64_t exported;
+	uint64_t full;		/* times the table was emptied early */
+};
+
+static const struct tok flows_tcp_flags[] = {
+	{ TH_FIN, "F" },
+	{ TH_SYN, "S" },
+	{ TH_RST, "R" },
+	{ TH_PUSH, "P" },
+	{ TH_ACK, "." },
+	{ TH_URG, "U" },
+	{ TH_ECNECHO, "E" },
+	{ TH_CWR, "W" },
+	{ 0, NULL }
+};
+
+/* The fields of the IPFIX templates, after the two addresses. */
+static const uint16_t ipfix_fields[][2] = {
+	{ 7, 2 },	/* sourceTransportPort */
+	{ 11, 2 },	/* destinationTransportPort */
+	{ 4, 1 },	/* protocolIdentifier */
+	{ 6, 1 },	/* tcpControlBits */
+	{ 2, 8 },	/* packetDeltaCount */
+	{ 1, 8 },	/* octetDeltaCount */
+	{ 152, 8 },	/* flowStartMilliseconds */
+	{ 153, 8 }	/* flowEndMilliseconds */
+};
+#define IPFIX_NFIELDS	(2 + sizeof(ipfix_fields) / sizeof(ipfix_fields[0]))
+
+static void *
+flows_calloc(netdissect_options *ndo, size_t n, size_t size)
+{
+	void *p;
+
+	p = nd_big_calloc(n, size);
+	if (p == NULL)
+		(*ndo->ndo_error)(ndo, S_ERR_ND_MEM_ALLOC, "nd_flows_new: calloc");
+	return (p);
+}
+
+/*
+ * Make a table for "flows" flows, exported in "format" after "active"
+ * seconds or when idle for "idle" seconds; if "collect" is set, the
+ * sFlow and NetFlow printers add the flows they report to it.
+ */
+struct nd_flows *
+nd_flows_new(netdissect_options *ndo, int format, u_int flows, u_int active,
+    u_int idle, int collect)
+{
+	struct nd_flows *fl;
+	u_int size;
+
+	/* Keep the table no more than three quarters full. */
+	for (size = 16; size < flows + flows / 3 + 1; size *= 2)
+		continue;
+	fl = (struct nd_flows *)flows_calloc(ndo, 1, sizeof(*fl));
+	fl->format = format;
+	fl->collect = collect;
+	fl->active_us = (uint64_t)active * 1000000;
+	fl->idle_us = (uint64_t)idle * 1000000;
+	fl->size = size;
+	fl->max = flows;
+	fl->hash = (uint32_t *)flows_calloc(ndo, size, sizeof(*fl->hash));
+	fl->key = (struct nd_flow_key *)flows_calloc(ndo, size,
+	    sizeof(*fl->key));
+	fl->packets = (uint64_t *)flows_calloc(ndo, size, sizeof(uint64_t));
+	fl->bytes = (uint64_t *)flows_calloc(ndo, size, sizeof(uint64_t));
+	fl->first = (uint64_t *)flows_calloc(ndo, size, sizeof(uint64_t));
+	fl->last = (uint64_t *)flows_calloc(ndo, size, sizeof(uint64_t));
+	fl->tcp_flags = (uint8_t *)flows_calloc(ndo, size, sizeof(uint8_t));
+	fl->tls = (struct flows_tls **)flows_calloc(ndo, size,
+	    sizeof(*fl->tls));
+	if (format == FLOWS_IPFIX) {
+		fl->set4 = (u_char *)flows_calloc(ndo, 1, IPFIX_MAXSETS);
+		fl->set6 = (u_char *)flows_calloc(ndo, 1, IPFIX_MAXSETS);
+	}
+	return (fl);
+}
+
+static uint32_t
+flows_hash(const struct nd_flow_key *k)
+{
+	uint32_t w[sizeof(*k) / 4], h = 0;
+	u_int i;
+
+	memcpy(w, k, sizeof(w));
+	for (i = 0; i < sizeof(w) / sizeof(w[0]); i++) {
+		h = (h ^ w[i]) * 0x9e3779b1U;
+		h ^= h >> 15;
+	}
+	return (h != 0 ? h : 1);
+}
+
+static u_char *
+flows_put(u_char *p, uint64_t v, u_int len)
+{
+	u_int i;
+
+	for (i = len; i != 0; i--) {
+		p[i - 1] = (u_char)v;
+		v >>= 8;
+	}
+	return (p + len);
+}
+
+/*
+ * Write the IPFIX message for the records collected so far, with the
+ * templates, so that each message can be decoded on its own.
+ */
+static void
+flows_ipfix_write(netdissect_options *ndo, struct nd_flows *fl)
+{
+	u_char hdr[IPFIX_HDRLEN + 4 + 2 * (4 + 4 * IPFIX_NFIELDS) + 4];
+	u_char *p;
+	u_int i, t, len;
+
+	if (fl->len4 == 0 && fl->len6 == 0)
+		return;
+	len = IPFIX_HDRLEN + 4 + 2 * (4 + 4 * IPFIX_NFIELDS);
+	if (fl->len4 != 0)
+		len += 4 + fl->len4;
+	if (fl->len6 != 0)
+		len += 4 + fl->len6;
+	p = flows_put(hdr, IPFIX_VERSION, 2);
+	p = flows_put(p, len, 2);
+	p = flows_put(p, fl->now / 1000000, 4);
+	p = flows_put(p, fl->sequence, 4);
+	p = flows_put(p, 0, 4);		/* observation domain */
+	p = flows_put(p, IPFIX_TEMPLATE_SET, 2);
+	p = flows_put(p, 4 + 2 * (4 + 4 * IPFIX_NFIELDS), 2);
+	for (t = 0; t < 2; t++) {
+		p = flows_put(p, t == 0 ? IPFIX_TEMPLATE_V4 : IPFIX_TEMPLATE_V6,
+		    2);
+		p = flows_put(p, IPFIX_NFIELDS, 2);
+		/* source and destination IPv4 or IPv6 address */
+		p = flows_put(p, t == 0 ? 8 : 27, 2);
+		p = flows_put(p, t == 0 ? 4 : 16, 2);
+		p = flows_put(p, t == 0 ? 12 : 28, 2);
+		p = flows_put(p, t == 0 ? 4 : 16, 2);
+		for (i = 0; i < IPFIX_NFIELDS - 2; i++) {
+			p = flows_put(p, ipfix_fields[i][0], 2);
+			p = flows_put(p, ipfix_fields[i][1], 2);
+		}
+	}
+	nd_outbuf_write(ndo, (const char *)hdr, p - hdr);
+	if (fl->len4 != 0) {
+		p = flows_put(hdr, IPFIX_TEMPLATE_V4, 2);
+		p = flows_put(p, 4 + fl->len4, 2);
+		nd_outbuf_write(ndo, (const char *)hdr, p - hdr);
+		nd_outbuf_write(ndo, (const char *)fl->set4, fl->len4);
+	}
+	if (fl->len6 != 0) {
+		p = flows_put(hdr, IPFIX_TEMPLATE_V6, 2);
+		p = flows_put(p, 4 + fl->len6, 2);
+		nd_outbuf_write(ndo, (const char *)hdr, p - hdr);
+		nd_outbuf_write(ndo, (const char *)fl->set6, fl->len6);
+	}
+	fl->sequence += (fl->len4 / IPFIX_RECLEN_V4) +
+	    (fl->len6 / IPFIX_RECLEN_V6);
+	fl->len4 = fl->len6 = 0;
+}
+
+static void
+flows_ipfix_record(netdissect_options *ndo, struct nd_flows *fl, u_int i)
+{
+	const struct nd_flow_key *k = &fl->key[i];
+	u_int alen = k->af == 4 ? 4 : 16;
+	u_char *p;
+
+	if (fl->len4 + fl->len6 + IPFIX_RECLEN_V6 > IPFIX_MAXSETS)
+		flows_ipfix_write(ndo, fl);
+	if (k->af == 4) {
+		p = fl->set4 + fl->len4;
+		fl->len4 += IPFIX_RECLEN_V4;
+	} else {
+		p = fl->set6 + fl->len6;
+		fl->len6 += IPFIX_RECLEN_V6;
+	}
+	memcpy(p, k->src, alen);
+	memcpy(p + alen, k->dst, alen);
+	p += 2 * alen;
+	p = flows_put(p, k->sport, 2);
+	p = flows_put(p, k->dport, 2);
+	p = flows_put(p, k->proto, 1);
+	p = flows_put(p, fl->tcp_flags[i], 1);
+	p = flows_put(p, fl->packets[i], 8);
+	p = flows_put(p, fl->bytes[i], 8);
+	p = flows_put(p, fl->first[i] / 1000, 8);
+	(void)flows_put(p, fl->last[i] / 1000, 8);
+}
+
+static char *
+flows_time(char *buf, size_t size, uint64_t us)
+{
+	time_t t = (time_t)(us / 1000000);
+	struct tm tmbuf, *tm;
+	size_t len;
+
+	if ((tm = nd_localtime(&t, &tmbuf)) == NULL ||
+	    (len = strftime(buf, size, "%Y-%m-%d %H:%M:%S", tm)) == 0)
+		len = 0;
+	snprintf(buf + len, size - len, ".%06u", (u_int)(us % 1000000));
+	return (buf);
+}
+
+static const char *
+flows_tls_version(char *buf, size_t size, u_int version)
+{
+	if (version == 0x0300)
+		return ("SSLv3");
+	if (version == 0x0301)
+		return ("TLSv1");
+	if (version > 0x0301 && version <= 0x0304)
+		snprintf(buf, size, "TLSv1.%u", version - 0x0301);
+	else
+		snprintf(buf, size, "0x%04x", version);
+	return (buf);
+}
+
+/*
+ * Append the TLS labels of the flow in slot "i", if it has any, to the
+ * "len" bytes of the record in "line".
+ */
+static int
+flows_tls_labels(const struct nd_flows *fl, u_int i, char *line,
+    size_t size, int len)
+{
+	const struct flows_tls *t = fl->tls[i];
+	char vbuf[16];
+
+	if (t == NULL || len < 0 || (size_t)len >= size)
+		return (len);
+	if (fl->format == FLOWS_JSON) {
+		if (t->version != 0)
+			len += snprintf(line + len, size - len,
+			    ",\"tls_version\":%u", t->version);
+		if (t->sni[0] != '\0' && (size_t)len < size)
+			len += snprintf(line + len, size - len,
+			    ",\"sni\":\"%s\"", t->sni);
+		if (t->alpn[0] != '\0' && (size_t)len < size)
+			len += snprintf(line + len, size - len,
+			    ",\"alpn\":\"%s\"", t->alpn);
+		return (len);
+	}
+	if (t->version != 0)
+		len += snprintf(line + len, size - len, ", %s",
+		    flows_tls_version(vbuf, sizeof(vbuf), t->version));
+	if (t->sni[0] != '\0' && (size_t)len < size)
+		len += snprintf(line + len, size - len, ", sni %s", t->sni);
+	if (t->alpn[0] != '\0' && (size_t)len < size)
+		len += snprintf(line + len, size - len, ", alpn %s", t->alpn);
+	return (len);
+}
+
+/*
+ * Export the flow in slot "i".
+ */
+static void
+flows_export(netdissect_options *ndo, struct nd_flows *fl, u_int i)
+{
+	const struct nd_flow_key *k = &fl->key[i];
+	char src[INET6_ADDRSTRLEN], dst[INET6_ADDRSTRLEN];
+	char first[40], last[40], line[512];
+	/* the addresses, with the ports or the ICMP type and code */
+	char ports[2 * INET6_ADDRSTRLEN + sizeof(" > ") +
+	    sizeof(" type 255 code 255")];
+	const char *proto;
+	char protobuf[16];
+	int len;
+
+	fl->exported++;
+	if (fl->format == FLOWS_IPFIX) {
+		flows_ipfix_record(ndo, fl, i);
+		return;
+	}
+	if (k->af == 4) {
+		addrtostr(k->src, src, sizeof(src));
+		addrtostr(k->dst, dst, sizeof(dst));
+	} else {
+		addrtostr6(k->src, src, sizeof(src));
+		addrtostr6(k->dst, dst, sizeof(dst));
+	}
+	if (fl->format == FLOWS_JSON) {
+		len = snprintf(line, sizeof(line),
+		    "{\"src\":\"%s\",\"dst\":\"%s\",\"proto\":%u,"
+		    "\"sport\":%u,\"dport\":%u,\"packets\":%" PRIu64
+		    ",\"bytes\":%" PRIu64 ",\"tcp_flags\":%u,"
+		    "\"start\":%" PRIu64 ".%06u,\"end\":%" PRIu64 ".%06u",
+		    src, dst, k->proto, k->sport, k->dport, fl->packets[i],
+		    fl->bytes[i], fl->tcp_flags[i],
+		    fl->first[i] / 1000000, (u_int)(fl->first[i] % 1000000),
+		    fl->last[i] / 1000000, (u_int)(fl->last[i] % 1000000));
+		len = flows_tls_labels(fl, i, line, sizeof(line), len);
+		if (len > 0 && (size_t)len < sizeof(line) - 2) {
+			line[len++] = '}';
+			line[len++] = '\n';
+			nd_outbuf_write(ndo, line, (size_t)len);
+		}
+		return;
+	}
+	if ((proto = netdb_protoname(k->proto)) == NULL) {
+		snprintf(protobuf, sizeof(protobuf), "proto %u", k->proto);
+		proto = protobuf;
+	}
+	if (k->proto == IPPROTO_TCP || k->proto == IPPROTO_UDP)
+		snprintf(ports, sizeof(ports), "%s.%u > %s.%u", src, k->sport,
+		    dst, k->dport);
+	else if (k->proto == IPPROTO_ICMP || k->proto == IPPROTO_ICMPV6)
+		snprintf(ports, sizeof(ports), "%s > %s type %u code %u", src,
+		    dst, k->dport >> 8, k->dport & 0xff);
+	else
+		snprintf(ports, sizeof(ports), "%s > %s", src, dst);
+	len = snprintf(line, sizeof(line),
+	    "%s %s %s %s: %" PRIu64 " packets, %" PRIu64 " bytes",
+	    flows_time(first, sizeof(first), fl->first[i]),
+	    flows_time(last, sizeof(last), fl->last[i]), proto, ports,
+	    fl->packets[i], fl->bytes[i]);
+	if (k->proto == IPPROTO_TCP && len > 0 && (size_t)len < sizeof(line))
+		len += snprintf(line + len, sizeof(line) - len, ", flags [%s]",
+		    bittok2str_nosep(flows_tcp_flags, "none",
+		    fl->tcp_flags[i]));
+	len = flows_tls_labels(fl, i, line, sizeof(line), len);
+	if (len > 0 && (size_t)len < sizeof(line) - 1) {
+		line[len++] = '\n';
+		nd_outbuf_write(ndo, line, (size_t)len);
+	}
+}
+
+/*
+ * Free slot "i", moving the flows after it back, as far as their home
+ * slots allow, so that no lookup stops short of them.
+ */
+static void
+flows_remove(struct nd_flows *fl, u_int i)
+{
+	u_int mask = fl->size - 1, j, home;
+
+	free(fl->tls[i]);
+	fl->tls[i] = NULL;
+	for (j = (i + 1) & mask; fl->hash[j] != 0; j = (j + 1) & mask) {
+		home = fl->hash[j] & mask;
+		if (i <= j ? (i < home && home <= j) : (i < home || home <= j))
+			continue;
+		fl->hash[i] = fl->hash[j];
+		fl->key[i] = fl->key[j];
+		fl->packets[i] = fl->packets[j];
+		fl->bytes[i] = fl->bytes[j];
+		fl->first[i] = fl->first[j];
+		fl->last[i] = fl->last[j];
+		fl->tcp_flags[i] = fl->tcp_flags[j];
+		fl->tls[i] = fl->tls[j];
+		fl->tls[j] = NULL;
+		i = j;
+	}
+	fl->hash[i] = 0;
+	fl->count--;
+}
+
+/*
+ * Export and remove the flows that have been idle or active too long.
+ */
+static void
+flows_expire(netdissect_options *ndo, struct nd_flows *fl)
+{
+	uint64_t now = fl->now;
+	u_int i;
+
+	for (i = 0; i < fl->size; ) {
+		if (fl->hash[i] != 0 &&
+		    ((now > fl->last[i] && now - fl->last[i] >= fl->idle_us) ||
+		    (now > fl->first[i] &&
+		    now - fl->first[i] >= fl->active_us))) {
+			flows_export(ndo, fl, i);
+			/* Another flow may have been moved into slot i. */
+			flows_remove(fl, i);
+			continue;
+		}
+		i++;
+	}
+	if (fl->format == FLOWS_IPFIX)
+		flows_ipfix_write(ndo, fl);
+}
+
+/*
+ * Export all the flows, and empty the table.
+ */
+void
+nd_flows_flush(netdissect_options *ndo)
+{
+	struct nd_flows *fl = ndo->ndo_flows;
+	u_int i;
+
+	if (fl == NULL)
+		return;
+	for (i = 0; i < fl->size; i++)
+		if (fl->hash[i] != 0) {
+			flows_export(ndo, fl, i);
+			fl->hash[i] = 0;
+			free(fl->tls[i]);
+			fl->tls[i] = NULL;
+		}
+	fl->count = 0;
+	if (fl->format == FLOWS_IPFIX)
+		flows_ipfix_write(ndo, fl);
+}
+
+/*
+ * Start on the key of a packet of "len" bytes on the wire.
+ */
+void
+nd_flow_pkt_begin(struct nd_flow_pkt *fp, u_int len)
+{
+	memset(&fp->key, 0, sizeof(fp->key));
+	fp->state = FLOWS_PKT_NONE;
+	fp->l4 = 0;
+	fp->ip_bytes = 0;
+	fp->len = len;
+	fp->tcp_flags = 0;
+	fp->tls_version = 0;
+	fp->tls_sni = NULL;
+	fp->tls_alpn = NULL;
+}
+
+/*
+ * Pick the key out of the fields of the outer IP header and the
+ * transport header after it.
+ */
+void
+nd_flow_pkt_field(struct nd_flow_pkt *fp, u_int proto, u_int field,
+    u_int type, const u_char *val, u_int len)
+{
+	uint64_t v = 0;
+	u_int i;
+
+	if (fp->state == FLOWS_PKT_DONE)
+		return;
+	if (type == NDF_T_UINT)
+		for (i = 0; i < len; i++)
+			v = v << 8 | val[i];
+	switch (proto) {
+
+	case NDF_IP:
+	case NDF_IP6:
+		/* The IPv4 and IPv6 fields are numbered alike. */
+		if (field == NDF_IP_SRC) {
+			if (fp->state != FLOWS_PKT_NONE) {
+				/* A tunnelled or quoted header. */
+				fp->state = FLOWS_PKT_DONE;
+				return;
+			}
+			fp->state = FLOWS_PKT_IP;
+			fp->key.af = proto == NDF_IP ? 4 : 6;
+		}
+		if (fp->state != FLOWS_PKT_IP)
+			return;
+		if ((field == NDF_IP_SRC || field == NDF_IP_DST) &&
+		    len == (fp->key.af == 4 ? 4 : 16))
+			memcpy(field == NDF_IP_SRC ? fp->key.src : fp->key.dst,
+			    val, len);
+		else if (field == NDF_IP_PROTO)
+			fp->key.proto = (uint8_t)v;
+		else if (field == NDF_IP_LEN)
+			fp->ip_bytes = proto == NDF_IP ? v : v + 40;
+		break;
+
+	case NDF_TCP:
+	case NDF_UDP:
+	case NDF_ICMP:
+	case NDF_ICMP6:
+		if (fp->state == FLOWS_PKT_IP) {
+			fp->state = FLOWS_PKT_L4;
+			fp->l4 = proto;
+			/* Past any IPv6 extension headers. */
+			fp->key.proto = proto == NDF_TCP ? IPPROTO_TCP :
+			    proto == NDF_UDP ? IPPROTO_UDP :
+			    proto == NDF_ICMP ? IPPROTO_ICMP : IPPROTO_ICMPV6;
+		} else if (fp->state != FLOWS_PKT_L4 || fp->l4 != proto)
+			return;
+		if (proto == NDF_ICMP || proto == NDF_ICMP6) {
+			if (field == NDF_ICMP_TYPE)
+				fp->key.dport |= (uint16_t)(v << 8);
+			else if (field == NDF_ICMP_CODE)
+				fp->key.dport |= (uint16_t)(v & 0xff);
+		} else if (field == NDF_TCP_SPORT)
+			fp->key.sport = (uint16_t)v;
+		else if (field == NDF_TCP_DPORT)
+			fp->key.dport = (uint16_t)v;
+		else if (proto == NDF_TCP && field == NDF_TCP_FLAGS)
+			fp->tcp_flags = (uint8_t)v;
+		break;
+
+	case NDF_TLS:
+		if (fp->state != FLOWS_PKT_L4 || fp->l4 != NDF_TCP)
+			return;
+		if (field == NDF_TLS_HELLO_VERSION)
+			fp->tls_version = (u_int)v;
+		else if (field == NDF_TLS_SNI && type == NDF_T_STRING) {
+			fp->tls_sni = val;
+			fp->tls_sni_len = len;
+		} else if (field == NDF_TLS_ALPN && type == NDF_T_STRING) {
+			fp->tls_alpn = val;
+			fp->tls_alpn_len = len;
+		}
+		break;
+	}
+}
+
+/*
+ * Start on a packet of "len" bytes on the wire; its time stamp has been
+ * set in ndo.
+ */
+void
+nd_flows_begin(netdissect_options *ndo, u_int len)
+{
+	struct nd_flows *fl = ndo->ndo_flows;
+
+	nd_flow_pkt_begin(&fl->pkt, len);
+	fl->collected = 0;
+	fl->now = (uint64_t)ND_TS_USEC(ndo->ndo_packet_ts);
+	if (fl->now >= fl->next_scan) {
+		if (fl->next_scan != 0)
+			flows_expire(ndo, fl);
+		fl->next_scan = fl->now + 1000000;
+	}
+}
+
+/*
+ * The field sink.
+ */
+void
+nd_flows_field(netdissect_options *ndo, u_int proto, u_int field,
+    u_int type, const u_char *val, u_int len)
+{
+	nd_flow_pkt_field(&ndo->ndo_flows->pkt, proto, field, type, val, len);
+}
+
+/*
+ * The slot of the flow with key "k", added to the table, as of "first",
+ * if it isn't in it.
+ */
+static u_int
+flows_lookup(netdissect_options *ndo, struct nd_flows *fl,
+    const struct nd_flow_key *k, uint64_t first)
+{
+	u_int mask = fl->size - 1, i;
+	uint32_t h;
+
+	h = flows_hash(k);
+	for (i = h & mask; fl->hash[i] != 0; i = (i + 1) & mask)
+		if (fl->hash[i] == h &&
+		    memcmp(&fl->key[i], k, sizeof(*k)) == 0)
+			return (i);
+	if (fl->count >= fl->max) {
+		/* Make room, all at once, rather than a flow at a time. */
+		fl->full++;
+		nd_flows_flush(ndo);
+		for (i = h & mask; fl->hash[i] != 0; i = (i + 1) & mask)
+			continue;
+	}
+	fl->hash[i] = h;
+	fl->key[i] = *k;
+	fl->packets[i] = 0;
+	fl->bytes[i] = 0;
+	fl->first[i] = first;
+	fl->last[i] = first;
+	fl->tcp_flags[i] = 0;
+	fl->count++;
+	return (i);
+}
+
+/*
+ * Copy "len" bytes of a label from the packet, cut short to fit and
+ * with anything that wouldn't do in a line of text or a JSON string
+ * replaced.
+ */
+static void
+flows_copy_label(char *dst, size_t size, const u_char *src, u_int len)
+{
+	u_int i;
+
+	if (len > size - 1)
+		len = (u_int)(size - 1);
+	for (i = 0; i < len; i++)
+		dst[i] = (src[i] > ' ' && src[i] < 0x7f && src[i] != '"' &&
+		    src[i] != '\\') ? (char)src[i] : '?';
+	dst[len] = '\0';
+}
+
+/*
+ * Label the flow in slot "i" with what the TLS hello of packet "fp"
+ * said; if there's no memory for it, it goes without.
+ */
+static void
+flows_tls_label(struct nd_flows *fl, u_int i, const struct nd_flow_pkt *fp)
+{
+	struct flows_tls *t;
+
+	if ((t = fl->tls[i]) == NULL) {
+		t = (struct flows_tls *)calloc(1, sizeof(*t));
+		if (t == NULL)
+			return;
+		fl->tls[i] = t;
+	}
+	if (fp->tls_version != 0)
+		t->version = fp->tls_version;
+	if (fp->tls_sni != NULL)
+		flows_copy_label(t->sni, sizeof(t->sni), fp->tls_sni,
+		    fp->tls_sni_len);
+	if (fp->tls_alpn != NULL)
+		flows_copy_label(t->alpn, sizeof(t->alpn), fp->tls_alpn,
+		    fp->tls_alpn_len);
+}
+
+/*
+ * Add the packet to its flow, if it had an IP header and didn't carry
+ * flows of its own.
+ */
+void
+nd_flows_end(netdissect_options *ndo)
+{
+	struct nd_flows *fl = ndo->ndo_flows;
+	u_int i;
+
+	if (fl->pkt.state == FLOWS_PKT_NONE || fl->collected)
+		return;
+	i = flows_lookup(ndo, fl, &fl->pkt.key, fl->now);
+	fl->packets[i]++;
+	fl->bytes[i] += fl->pkt.ip_bytes != 0 ? fl->pkt.ip_bytes : fl->pkt.len;
+	if (fl->now > fl->last[i])
+		fl->last[i] = fl->now;
+	fl->tcp_flags[i] |= fl->pkt.tcp_flags;
+	if (fl->pkt.tls_version != 0)
+		flows_tls_label(fl, i, &fl->pkt);
+}
+
+/*
+ * Whether the sFlow and NetFlow printers are to add the flows they
+ * report to the table (--flow-collector), rather than print them.
+ */
+int
+nd_flows_collecting(const netdissect_options *ndo)
+{
+	return (ndo->ndo_flows != NULL && ndo->ndo_flows->collect);
+}
+
+/*
+ * Add "packets" packets of "bytes" bytes, seen from "first" to "last"
+ * microseconds, or at the time of the packet being dissected if
+ * "first" is 0, to the flow with key "k", as reported by a flow
+ * exporter; the packet carrying the report isn't added to a flow of
+ * its own.
+ */
+void
+nd_flows_add(netdissect_options *ndo, const struct nd_flow_key *k,
+    uint64_t packets, uint64_t bytes, uint64_t first, uint64_t last,
+    u_int tcp_flags)
+{
+	struct nd_flows *fl = ndo->ndo_flows;
+	u_int i;
+
+	fl->collected = 1;
+	if (first == 0)
+		first = last = fl->now;
+	i = flows_lookup(ndo, fl, k, first);
+	fl->packets[i] += packets;
+	fl->bytes[i] += bytes;
+	if (first < fl->first[i])
+		fl->first[i] = first;
+	if (last > fl->last[i])
+		fl->last[i] = last;
+	fl->tcp_flags[i] |= (uint8_t)tcp_flags;
+}
+
+/*
+ * Add a sampled packet, of which the first "len" bytes, from "p", are
+ * an Ethernet frame if "ether" is set or an IPv4 or IPv6 packet if not,
+ * and which stands for "rate" packets, to its flow; "frame_len" is its
+ * length on the wire, counted if it has no IP header length.  "p" is
+ * known to be captured; a sampled header is cut short by the exporter,
+ * so it is looked at only as far as "len" goes, and a packet without
+ * an IP header is skipped.
+ */
+void
+nd_flows_add_header(netdissect_options *ndo, int ether, const u_char *p,
+    u_int len, u_int frame_len, u_int rate)
+{
+	struct nd_flow_key k;
+	uint64_t ip_bytes;
+	u_int type, hlen, proto, tcp_flags = 0;
+	int first_frag = 1;
+
+	if (ether) {
+		if (len < 14)
+			return;
+		type = EXTRACT_BE_U_2(p + 12);
+		p += 14;
+		len -= 14;
+		while ((type == ETHERTYPE_8021Q || type == ETHERTYPE_8021QinQ ||
+		    type == ETHERTYPE_8021Q9100) && len >= 4) {
+			type = EXTRACT_BE_U_2(p + 2);
+			p += 4;
+			len -= 4;
+		}
+		if (type != ETHERTYPE_IP && type != ETHERTYPE_IPV6)
+			return;
+	}
+	memset(&k, 0, sizeof(k));
+	if (len >= 20 && (p[0] >> 4) == 4) {
+		hlen = (p[0] & 0x0f) * 4;
+		if (hlen < 20 || hlen > len)
+			return;
+		k.af = 4;
+		memcpy(k.src, p + 12, 4);
+		memcpy(k.dst, p + 16, 4);
+		proto = p[9];
+		ip_bytes = EXTRACT_BE_U_2(p + 2);
+		first_frag = (EXTRACT_BE_U_2(p + 6) & 0x1fff) == 0;
+	} else if (len >= 40 && (p[0] >> 4) == 6) {
+		hlen = 40;
+		k.af = 6;
+		memcpy(k.src, p + 8, 16);
+		memcpy(k.dst, p + 24, 16);
+		proto = p[6];
+		ip_bytes = EXTRACT_BE_U_2(p + 4) + 40;
+		/* Past the extension headers the transport header may follow. */
+		while ((proto == IPPROTO_HOPOPTS || proto == IPPROTO_ROUTING ||
+		    proto == IPPROTO_DSTOPTS || proto == IPPROTO_FRAGMENT) &&
+		    len - hlen >= 8) {
+			if (proto == IPPROTO_FRAGMENT) {
+				first_frag = (EXTRACT_BE_U_2(p + hlen + 2) &
+				    0xfff8) == 0;
+				proto = p[hlen];
+				hlen += 8;
+			} else {
+				proto = p[hlen];
+				hlen += (p[hlen + 1] + 1) * 8;
+			}
+			if (hlen > len)
+				hlen = len;
+		}
+	} else
+		return;
+	k.proto = (uint8_t)proto;
+	p += hlen;
+	len -= hlen;
+	if (first_frag) {
+		if ((proto == IPPROTO_TCP && len >= 14) ||
+		    (proto == IPPROTO_UDP && len >= 4)) {
+			k.sport = EXTRACT_BE_U_2(p);
+			k.dport = EXTRACT_BE_U_2(p + 2);
+			if (proto == IPPROTO_TCP)
+				tcp_flags = p[13];
+		} else if ((proto == IPPROTO_ICMP ||
+		    proto == IPPROTO_ICMPV6) && len >= 2)
+			k.dport = (uint16_t)(p[0] << 8 | p[1]);
+	}
+	if (rate == 0)
+		rate = 1;
+	nd_flows_add(ndo, &k, rate,
+	    (uint64_t)rate * (ip_bytes != 0 ? ip_bytes : frame_len), 0, 0,
+	    tcp_flags);
+}
+
+/*
+ * How many flows have been exported, and how many times the table
+ * filled up and was emptied early.
+ */
+void
+nd_flows_counts(const netdissect_options *ndo, uint64_t *exported,
+    uint64_t *full)
+{
+	const struct nd_flows *fl = ndo->ndo_flows;
+
+	*exported = fl != NULL ? fl->exported : 0;
+	*full = fl != NULL ? fl->full : 0;
+}
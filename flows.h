@@ -0,0 +1,108 @@
+/*
+ * Copyright (c) 2026 The TCPDUMP project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that: (1) source code
+ * distributions retain the above copyright notice and this paragraph
+ * in its entirety, and (2) distributions including binary code include
+ * the above copyright notice and this paragraph in its entirety in
+ * the documentation or other materials provided with the distribution.
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND
+ * WITHOUT ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, WITHOUT
+ * LIMITATION, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE.
+ */
+
+
+#ifndef flows_h
+#define flows_h
+
+/*
+ * Flow records (--flows): packets are added up by flow, keyed by the
+ * addresses, protocol and ports reported to ndo_field by the first IP
+ * or IPv6 header and the TCP, UDP, ICMP or ICMPv6 header after it, and
+ * each flow is exported as a record once it has been idle for
+ * idle_timeout seconds or active for active_timeout seconds, by packet
+ * time, and when the capture ends.  The records are written to the
+ * output as text, as NDJSON or as IPFIX messages (RFC 7011).
+ *
+ * The table is allocated up front, with open addressing and linear
+ * probing over an array of hashes, and holds the keys, counters and
+ * times in arrays of their own, so that a lookup only touches the
+ * hashes until it finds a match.
+ *
+ * A TCP flow whose packets carried a TLS ClientHello or ServerHello is
+ * labelled with the version, server name and application protocol it
+ * gave, in the text and JSON records; the labels are allocated only
+ * for the flows that have them.
+ *
+ * With --flow-collector, the sFlow and NetFlow v5 printers add the
+ * flows reported by the exporters to the table instead, scaled by
+ * their sampling rates, with nd_flows_add() and nd_flows_add_header(),
+ * and the packets carrying the reports aren't added themselves.
+ */
+#define FLOWS_TEXT		0
+#define FLOWS_JSON		1
+#define FLOWS_IPFIX		2
+
+#define FLOWS_DEFAULT_SIZE	65536	/* flows in the table */
+#define FLOWS_DEFAULT_ACTIVE	60	/* seconds */
+#define FLOWS_DEFAULT_IDLE	15	/* seconds */
+
+/*
+ * The key of a packet's flow, and what else is wanted of it, picked
+ * out of the fields reported for it by nd_flow_pkt_field().
+ */
+struct nd_flow_key {
+	u_char src[16];
+	u_char dst[16];
+	uint16_t sport;
+	uint16_t dport;		/* ICMP type << 8 | code */
+	uint8_t proto;
+	uint8_t af;		/* 4 or 6 */
+	uint8_t pad[2];
+};
+
+/* How far the fields of the packet have got. */
+#define FLOWS_PKT_NONE		0	/* no IP header yet */
+#define FLOWS_PKT_IP		1	/* the IP header */
+#define FLOWS_PKT_L4		2	/* the transport header after it */
+#define FLOWS_PKT_DONE		3	/* a header inside that; ignored */
+
+struct nd_flow_pkt {
+	struct nd_flow_key key;
+	u_int state;
+	u_int l4;		/* NDF_ protocol of its transport header */
+	uint64_t ip_bytes;	/* from the IP header, or 0 */
+	u_int len;		/* on the wire */
+	uint8_t tcp_flags;
+	u_int tls_version;	/* of a TLS hello, or 0 */
+	const u_char *tls_sni;	/* in the packet */
+	u_int tls_sni_len;
+	const u_char *tls_alpn;
+	u_int tls_alpn_len;
+};
+
+extern void nd_flow_pkt_begin(struct nd_flow_pkt *, u_int);
+extern void nd_flow_pkt_field(struct nd_flow_pkt *, u_int, u_int, u_int,
+    const u_char *, u_int);
+
+struct nd_flows;
+
+extern struct nd_flows *nd_flows_new(netdissect_options *, int, u_int,
+    u_int, u_int, int);
+extern void nd_flows_begin(netdissect_options *, u_int);
+extern void nd_flows_field(netdissect_options *, u_int, u_int, u_int,
+    const u_char *, u_int);
+extern void nd_flows_end(netdissect_options *);
+extern int nd_flows_collecting(const netdissect_options *);
+extern void nd_flows_add(netdissect_options *, const struct nd_flow_key *,
+    uint64_t, uint64_t, uint64_t, uint64_t, u_int);
+extern void nd_flows_add_header(netdissect_options *, int, const u_char *,
+    u_int, u_int, u_int);
+extern void nd_flows_flush(netdissect_options *);
+extern void nd_flows_counts(const netdissect_options *, uint64_t *,
+    uint64_t *);
+
+#endif /* flows_h */
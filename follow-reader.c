@@ -0,0 +1,413 @@
+/*
+ * Copyright (c) 2026 The TCPDUMP project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that: (1) source code
+ * distributions retain the above copyright notice and this paragraph
+ * in its entirety, and (2) distributions including binary code include
+ * the above copyright notice and this paragraph in its entirety in
+ * the documentation or other materials provided with the distribution.
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND
+ * WITHOUT ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, WITHOUT
+ * LIMITATION, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE.
+ */
+
+/*
+ * A followed savefile is read through a standard I/O stream whose
+ * reads come from the file with read(2); one that finds nothing more
+ * to read waits for the file to be written to, with inotify on Linux
+ * and kqueue on the BSDs and macOS, or, elsewhere, by sleeping for a
+ * bit, and tries again.  The waits time out now and then even when
+ * there's a way to be told of writes, so that nothing is missed if a
+ * notification is.
+ *
+ * A writer rotating with -C, and -W, closes one file before it creates
+ * or truncates the next, so once the next file is seen to have changed
+ * since the one being read was opened, the one being read won't grow
+ * any more.  The next file's pcap file header, the same as that of the
+ * first, is skipped; a pcapng file's section header block is passed
+ * on, as libpcap takes it for the start of a new section.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#ifdef HAVE_FOPENCOOKIE
+#define _GNU_SOURCE	/* for fopencookie() */
+#endif
+
+#include "netdissect-stdinc.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <pcap.h>
+
+#include "follow-reader.h"
+
+#ifdef FOLLOW_READER_SUPPORTED
+
+#include <poll.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#ifdef HAVE_SYS_INOTIFY_H
+#include <sys/inotify.h>
+#elif defined(HAVE_SYS_EVENT_H)
+#include <sys/event.h>
+#include <sys/time.h>
+#endif
+
+#if defined(HAVE_SYS_INOTIFY_H) || defined(HAVE_SYS_EVENT_H)
+#define FR_WAIT_MS	1000	/* longest wait for a notification */
+#else
+#define FR_WAIT_MS	200	/* between looks at the file */
+#endif
+
+#define FR_PCAP_HDRLEN	24	/* of a pcap file header */
+#define FR_PCAPNG_MAGIC	0x0a0d0d0a	/* section header block type */
+
+struct follow_reader {
+	FILE	*fp;
+	int	fd;			/* of the file being read */
+	follow_next_func next;
+	void	*arg;
+	char	next_name[PATH_MAX + 1];
+	int	next_existed;		/* when the file was opened */
+	struct stat next_st;		/* and what it was then */
+	int	hdrlen;			/* to skip in later files, -1 unknown */
+	size_t	skip;			/* of the file header still to skip */
+	uint64_t files;			/* read from */
+	int	wfd;			/* inotify or kqueue, -1 if none */
+#ifdef HAVE_SYS_EVENT_H
+	int	dfd;			/* of the directory, for kqueue */
+#endif
+	volatile sig_atomic_t stop;
+};
+
+/*
+ * Note what the file after the one being read is like now, so that
+ * fr_next_started() can tell when it's been started afresh.
+ */
+static void
+fr_note_next(struct follow_reader *fr)
+{
+	if (fr->next == NULL)
+		return;
+	(*fr->next)(fr->arg, fr->next_name, sizeof(fr->next_name));
+	fr->next_existed = stat(fr->next_name, &fr->next_st) == 0;
+}
+
+static int
+fr_next_started(const struct follow_reader *fr)
+{
+	struct stat st;
+
+	if (fr->next == NULL || stat(fr->next_name, &st) == -1)
+		return (0);
+	return (!fr->next_existed || st.st_ino != fr->next_st.st_ino ||
+	    st.st_dev != fr->next_st.st_dev ||
+	    st.st_size != fr->next_st.st_size ||
+	    st.st_mtime != fr->next_st.st_mtime);
+}
+
+/*
+ * Have the waits told of writes to the file just opened.
+ */
+static void
+fr_watch(struct follow_reader *fr)
+{
+#if !defined(HAVE_SYS_INOTIFY_H) && defined(HAVE_SYS_EVENT_H)
+	struct kevent kev[2];
+	int n = 0;
+
+	if (fr->wfd == -1)
+		return;
+	EV_SET(&kev[n++], fr->fd, EVFILT_VNODE, EV_ADD | EV_CLEAR,
+	    NOTE_WRITE | NOTE_EXTEND | NOTE_DELETE | NOTE_RENAME, 0, NULL);
+	/* For the next file being created. */
+	if (fr->dfd != -1)
+		EV_SET(&kev[n++], fr->dfd, EVFILT_VNODE, EV_ADD | EV_CLEAR,
+		    NOTE_WRITE, 0, NULL);
+	(void)kevent(fr->wfd, kev, n, NULL, 0, NULL);
+#else
+	(void)fr;
+#endif
+}
+
+/*
+ * Set up the notifications of writes to the files in the directory of
+ * fname; if they can't be had, the waits just sleep.
+ */
+static void
+fr_notify_init(struct follow_reader *fr, const char *fname)
+{
+#if defined(HAVE_SYS_INOTIFY_H) || defined(HAVE_SYS_EVENT_H)
+	char dir[PATH_MAX + 1];
+	char *slash;
+
+	(void)strncpy(dir, fname, sizeof(dir) - 1);
+	dir[sizeof(dir) - 1] = '\0';
+	slash = strrchr(dir, '/');
+	if (slash == NULL)
+		(void)strcpy(dir, ".");
+	else if (slash == dir)
+		dir[1] = '\0';
+	else
+		*slash = '\0';
+#endif
+	fr->wfd = -1;
+#ifdef HAVE_SYS_INOTIFY_H
+	/* A watch of the directory covers the files in it. */
+	fr->wfd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (fr->wfd != -1 && inotify_add_watch(fr->wfd, dir,
+	    IN_MODIFY | IN_CREATE | IN_MOVED_TO | IN_CLOSE_WRITE) == -1) {
+		(void)close(fr->wfd);
+		fr->wfd = -1;
+	}
+#elif defined(HAVE_SYS_EVENT_H)
+	fr->wfd = kqueue();
+	fr->dfd = fr->next != NULL ? open(dir, O_RDONLY) : -1;
+#endif
+}
+
+/*
+ * Wait for something to be written, for a while at most.
+ */
+static void
+fr_wait(struct follow_reader *fr)
+{
+#ifdef HAVE_SYS_INOTIFY_H
+	char buf[4096];
+	struct pollfd pfd;
+
+	if (fr->wfd != -1) {
+		pfd.fd = fr->wfd;
+		pfd.events = POLLIN;
+		if (poll(&pfd, 1, FR_WAIT_MS) == 1) {
+			/* What happened doesn't matter; the reads will tell. */
+			while (read(fr->wfd, buf, sizeof(buf)) > 0)
+				;
+		}
+		return;
+	}
+#elif defined(HAVE_SYS_EVENT_H)
+	struct kevent kev;
+	struct timespec ts;
+
+	if (fr->wfd != -1) {
+		ts.tv_sec = FR_WAIT_MS / 1000;
+		ts.tv_nsec = (FR_WAIT_MS % 1000) * 1000000L;
+		(void)kevent(fr->wfd, NULL, 0, &kev, 1, &ts);
+		return;
+	}
+#endif
+	(void)poll(NULL, 0, FR_WAIT_MS);
+}
+
+/*
+ * Go on to the next file of the series.  Returns -1, with errno set,
+ * if it can't be opened.
+ */
+static int
+fr_switch(struct follow_reader *fr)
+{
+	uint32_t magic;
+	int fd;
+
+	if (fr->hdrlen == -1) {
+		/* The first file is all there, header and all. */
+		if (pread(fr->fd, &magic, sizeof(magic), 0) !=
+		    (ssize_t)sizeof(magic))
+			return (-1);
+		fr->hdrlen = magic == FR_PCAPNG_MAGIC ? 0 : FR_PCAP_HDRLEN;
+	}
+	fd = open(fr->next_name, O_RDONLY);
+	if (fd == -1)
+		return (-1);
+	(void)close(fr->fd);
+	fr->fd = fd;
+	fr->skip = (size_t)fr->hdrlen;
+	fr->files++;
+	fr_note_next(fr);
+	fr_watch(fr);
+	return (0);
+}
+
+static ssize_t
+fr_read(struct follow_reader *fr, char *buf, size_t len)
+{
+	ssize_t n;
+
+	for (;;) {
+		if (fr->stop)
+			return (0);
+		n = read(fr->fd, buf, len);
+		if (n == 0 && fr_next_started(fr)) {
+			/*
+			 * The writer has gone on to the next file, so
+			 * this one won't grow; what was written to it
+			 * since the read is read before moving on.
+			 */
+			n = read(fr->fd, buf, len);
+			if (n == 0) {
+				if (fr_switch(fr) == 0)
+					continue;
+				/* Perhaps it's gone again; look later. */
+				if (errno != ENOENT)
+					return (-1);
+			}
+		}
+		if (n == -1) {
+			if (errno == EINTR)
+				continue;
+			return (-1);
+		}
+		if (n == 0) {
+			fr_wait(fr);
+			continue;
+		}
+		if (fr->skip != 0) {
+			if ((size_t)n <= fr->skip) {
+				fr->skip -= (size_t)n;
+				continue;
+			}
+			memmove(buf, buf + fr->skip, (size_t)n - fr->skip);
+			n -= (ssize_t)fr->skip;
+			fr->skip = 0;
+		}
+		return (n);
+	}
+}
+
+static void
+fr_free(struct follow_reader *fr)
+{
+	if (fr->wfd != -1)
+		(void)close(fr->wfd);
+#ifdef HAVE_SYS_EVENT_H
+	if (fr->dfd != -1)
+		(void)close(fr->dfd);
+#endif
+	(void)close(fr->fd);
+	free(fr);
+}
+
+#ifdef HAVE_FOPENCOOKIE
+static ssize_t
+fr_cookie_read(void *cookie, char *buf, size_t len)
+{
+	return (fr_read((struct follow_reader *)cookie, buf, len));
+}
+
+static int
+fr_cookie_close(void *cookie)
+{
+	fr_free((struct follow_reader *)cookie);
+	return (0);
+}
+
+static FILE *
+fr_fopen(struct follow_reader *fr)
+{
+	cookie_io_functions_t io;
+
+	io.read = fr_cookie_read;
+	io.write = NULL;
+	io.seek = NULL;
+	io.close = fr_cookie_close;
+	return (fopencookie(fr, "r", io));
+}
+#else /* HAVE_FUNOPEN */
+static int
+fr_cookie_read(void *cookie, char *buf, int len)
+{
+	return ((int)fr_read((struct follow_reader *)cookie, buf,
+	    (size_t)len));
+}
+
+static int
+fr_cookie_close(void *cookie)
+{
+	fr_free((struct follow_reader *)cookie);
+	return (0);
+}
+
+static FILE *
+fr_fopen(struct follow_reader *fr)
+{
+	return (funopen(fr, fr_cookie_read, NULL, NULL, fr_cookie_close));
+}
+#endif /* HAVE_FOPENCOOKIE */
+
+/*
+ * Start following the savefile fname, and the files after it if "next"
+ * isn't NULL.  On failure, return NULL with a message in errbuf, which
+ * must be PCAP_ERRBUF_SIZE bytes.
+ */
+struct follow_reader *
+follow_reader_open(const char *fname, follow_next_func next, void *arg,
+    char *errbuf)
+{
+	struct follow_reader *fr;
+
+	fr = (struct follow_reader *)calloc(1, sizeof(*fr));
+	if (fr == NULL) {
+		(void)snprintf(errbuf, PCAP_ERRBUF_SIZE, "out of memory");
+		return (NULL);
+	}
+	if ((fr->fd = open(fname, O_RDONLY)) == -1) {
+		(void)snprintf(errbuf, PCAP_ERRBUF_SIZE, "%s: %s", fname,
+		    strerror(errno));
+		free(fr);
+		return (NULL);
+	}
+	fr->next = next;
+	fr->arg = arg;
+	fr->hdrlen = -1;
+	fr->files = 1;
+#ifdef HAVE_SYS_EVENT_H
+	fr->dfd = -1;
+#endif
+	fr_note_next(fr);
+	fr_notify_init(fr, fname);
+	fr_watch(fr);
+	fr->fp = fr_fopen(fr);
+	if (fr->fp == NULL) {
+		(void)snprintf(errbuf, PCAP_ERRBUF_SIZE,
+		    "can't open a stream: %s", strerror(errno));
+		fr_free(fr);
+		return (NULL);
+	}
+	return (fr);
+}
+
+FILE *
+follow_reader_file(const struct follow_reader *fr)
+{
+	return (fr->fp);
+}
+
+/*
+ * Return the number of files of the series read from so far.
+ */
+uint64_t
+follow_reader_files(const struct follow_reader *fr)
+{
+	return (fr->files);
+}
+
+void
+follow_reader_stop(struct follow_reader *fr)
+{
+	fr->stop = 1;
+}
+
+#endif /* FOLLOW_READER_SUPPORTED */
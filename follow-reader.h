@@ -0,0 +1,49 @@
+/*
+ * Copyright (c) 2026 The TCPDUMP project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that: (1) source code
+ * distributions retain the above copyright notice and this paragraph
+ * in its entirety, and (2) distributions including binary code include
+ * the above copyright notice and this paragraph in its entirety in
+ * the documentation or other materials provided with the distribution.
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND
+ * WITHOUT ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, WITHOUT
+ * LIMITATION, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE.
+ */
+
+/*
+ * Savefiles that are still being written, read with -r and --follow as
+ * "tail -f" reads a log: at the end of what's been written, the reads
+ * of the standard I/O stream handed to libpcap wait for more, so a
+ * record written in pieces is read whole once it's all there.
+ *
+ * If "next" isn't NULL, the savefile is one of a series that a writer
+ * rotates through, and next(arg, buf, size) puts the name of the file
+ * after the one being read in buf; once that file has been started
+ * afresh, what's left of the one being read is read, and the reads go
+ * on into the new file, past its file header.
+ *
+ * follow_reader_stop() may be called from a signal handler; the reads
+ * then end as if at the end of the file.
+ */
+#ifndef follow_reader_h
+#define follow_reader_h
+
+#if defined(HAVE_FOPENCOOKIE) || defined(HAVE_FUNOPEN)
+#define FOLLOW_READER_SUPPORTED
+
+struct follow_reader;
+
+typedef void (*follow_next_func)(void *, char *, size_t);
+
+extern struct follow_reader *follow_reader_open(const char *,
+    follow_next_func, void *, char *);
+extern FILE *follow_reader_file(const struct follow_reader *);
+extern uint64_t follow_reader_files(const struct follow_reader *);
+extern void follow_reader_stop(struct follow_reader *);
+#endif
+
+#endif /* follow_reader_h */
@@ -0,0 +1,261 @@
+/*
+ * Copyright (c) 2026 The TCPDUMP project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that: (1) source code
+ * distributions retain the above copyright notice and this paragraph
+ * in its entirety, and (2) distributions including binary code include
+ * the above copyright notice and this paragraph in its entirety in
+ * the documentation or other materials provided with the distribution.
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND
+ * WITHOUT ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, WITHOUT
+ * LIMITATION, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE.
+ */
+
+/*
+ * Rather than having -z run a compressor on each savefile after it's
+ * closed, which reads the whole file back and writes it again, the
+ * savefile can be compressed as it's written, by handing libpcap a
+ * standard I/O stream whose writes go through zlib; the compression
+ * is done by whichever thread writes the savefile, so by the writer
+ * thread with --writer-thread.  Each savefile is a complete gzip
+ * stream, so the files rotated with -C or -G can each be decompressed
+ * on their own.
+ *
+ * The stream can't seek, but can be asked where it is, so that -C can
+ * go by the amount written before compression.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#ifdef HAVE_FOPENCOOKIE
+#define _GNU_SOURCE	/* for fopencookie() */
+#endif
+
+#include "netdissect-stdinc.h"
+
+#include <errno.h>
+#include <pcap.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "gzip-savefile.h"
+
+#ifdef GZIP_SAVEFILE_SUPPORTED
+
+#include <unistd.h>
+#include <zlib.h>
+
+#define GZIP_BUFSIZE	(128 * 1024)	/* zlib's buffer, both ways */
+#define GZIP_MAXWRITE	(1U << 30)	/* most to hand gzwrite() at once */
+
+struct gzip_savefile {
+	gzFile gz;
+	FILE *fp;
+	uint64_t offset;	/* bytes written, before compression */
+	int closed;		/* the stream has been closed */
+	int status;		/* and what gzclose() returned */
+};
+
+/*
+ * Set errno after a zlib call on gz failed.
+ */
+static void
+gzip_set_errno(gzFile gz)
+{
+	int errnum;
+
+	(void)gzerror(gz, &errnum);
+	if (errnum != Z_ERRNO)
+		errno = EIO;
+}
+
+static int
+gzip_write(struct gzip_savefile *gsf, const char *buf, size_t len)
+{
+	size_t left;
+	unsigned n;
+
+	for (left = len; left != 0; left -= n, buf += n) {
+		n = left > GZIP_MAXWRITE ? GZIP_MAXWRITE : (unsigned)left;
+		if (gzwrite(gsf->gz, buf, n) != (int)n) {
+			gzip_set_errno(gsf->gz);
+			return (-1);
+		}
+	}
+	gsf->offset += len;
+	return (0);
+}
+
+static int
+gzip_close(struct gzip_savefile *gsf)
+{
+	gsf->closed = 1;
+	gsf->status = gzclose(gsf->gz);
+	return (gsf->status == Z_OK ? 0 : -1);
+}
+
+#ifdef HAVE_FOPENCOOKIE
+static ssize_t
+gzip_cookie_write(void *cookie, const char *buf, size_t len)
+{
+	/* A short count is taken as an error. */
+	if (gzip_write((struct gzip_savefile *)cookie, buf, len) == -1)
+		return (0);
+	return ((ssize_t)len);
+}
+
+static int
+gzip_cookie_seek(void *cookie, off64_t *offset, int whence)
+{
+	if (*offset != 0 || whence != SEEK_CUR) {
+		errno = ESPIPE;
+		return (-1);
+	}
+	*offset = (off64_t)((struct gzip_savefile *)cookie)->offset;
+	return (0);
+}
+
+static int
+gzip_cookie_close(void *cookie)
+{
+	return (gzip_close((struct gzip_savefile *)cookie));
+}
+
+static FILE *
+gzip_fopen(struct gzip_savefile *gsf)
+{
+	cookie_io_functions_t io;
+
+	io.read = NULL;
+	io.write = gzip_cookie_write;
+	io.seek = gzip_cookie_seek;
+	io.close = gzip_cookie_close;
+	return (fopencookie(gsf, "w", io));
+}
+#else /* HAVE_FUNOPEN */
+static int
+gzip_cookie_write(void *cookie, const char *buf, int len)
+{
+	if (gzip_write((struct gzip_savefile *)cookie, buf, (size_t)len) == -1)
+		return (-1);
+	return (len);
+}
+
+static fpos_t
+gzip_cookie_seek(void *cookie, fpos_t offset, int whence)
+{
+	if (offset != 0 || whence != SEEK_CUR) {
+		errno = ESPIPE;
+		return (-1);
+	}
+	return ((fpos_t)((struct gzip_savefile *)cookie)->offset);
+}
+
+static int
+gzip_cookie_close(void *cookie)
+{
+	return (gzip_close((struct gzip_savefile *)cookie));
+}
+
+static FILE *
+gzip_fopen(struct gzip_savefile *gsf)
+{
+	return (funopen(gsf, NULL, gzip_cookie_write, gzip_cookie_seek,
+	    gzip_cookie_close));
+}
+#endif /* HAVE_FOPENCOOKIE */
+
+/*
+ * Compress, at the given zlib level, what's written to the stream
+ * returned by gzip_savefile_file() into fd, which is closed when the
+ * stream is.  On failure, fd is closed, and NULL is returned with a
+ * message in errbuf.
+ */
+struct gzip_savefile *
+gzip_savefile_open(int fd, int level, char *errbuf)
+{
+	struct gzip_savefile *gsf;
+	char mode[4];
+
+	gsf = (struct gzip_savefile *)calloc(1, sizeof(*gsf));
+	if (gsf == NULL) {
+		(void)snprintf(errbuf, PCAP_ERRBUF_SIZE, "out of memory");
+		(void)close(fd);
+		return (NULL);
+	}
+	(void)snprintf(mode, sizeof(mode), "wb%d", level);
+	gsf->gz = gzdopen(fd, mode);
+	if (gsf->gz == NULL) {
+		(void)snprintf(errbuf, PCAP_ERRBUF_SIZE,
+		    "can't set up compression");
+		(void)close(fd);
+		free(gsf);
+		return (NULL);
+	}
+	(void)gzbuffer(gsf->gz, GZIP_BUFSIZE);
+	gsf->fp = gzip_fopen(gsf);
+	if (gsf->fp == NULL) {
+		(void)snprintf(errbuf, PCAP_ERRBUF_SIZE,
+		    "can't open a stream: %s", strerror(errno));
+		(void)gzclose(gsf->gz);
+		free(gsf);
+		return (NULL);
+	}
+	return (gsf);
+}
+
+/*
+ * The stream to write the savefile to; it's to be closed with fclose(),
+ * or by pcap_dump_close() or pcapng_savefile_close(), before
+ * gzip_savefile_close() is called.
+ */
+FILE *
+gzip_savefile_file(const struct gzip_savefile *gsf)
+{
+	return (gsf->fp);
+}
+
+/*
+ * Compress and write out everything written to the stream so far, so
+ * that it can all be decompressed by a reader of the file.  Returns -1,
+ * with errno set, on an error.
+ */
+int
+gzip_savefile_flush(struct gzip_savefile *gsf)
+{
+	if (fflush(gsf->fp) == EOF)
+		return (-1);
+	if (gzflush(gsf->gz, Z_SYNC_FLUSH) != Z_OK) {
+		gzip_set_errno(gsf->gz);
+		return (-1);
+	}
+	return (0);
+}
+
+/*
+ * Free gsf, closing the stream first if that hasn't been done.
+ * Returns -1, with errno set, if finishing the compressed file failed.
+ */
+int
+gzip_savefile_close(struct gzip_savefile *gsf)
+{
+	int status;
+
+	if (!gsf->closed)
+		(void)fclose(gsf->fp);
+	status = gsf->status;
+	free(gsf);
+	if (status != Z_OK) {
+		if (status != Z_ERRNO)
+			errno = EIO;
+		return (-1);
+	}
+	return (0);
+}
+#endif /* GZIP_SAVEFILE_SUPPORTED */
@@ -0,0 +1,32 @@
+/*
+ * Copyright (c) 2026 The TCPDUMP project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that: (1) source code
+ * distributions retain the above copyright notice and this paragraph
+ * in its entirety, and (2) distributions including binary code include
+ * the above copyright notice and this paragraph in its entirety in
+ * the documentation or other materials provided with the distribution.
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND
+ * WITHOUT ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, WITHOUT
+ * LIMITATION, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE.
+ */
+
+/*
+ * Savefiles compressed with zlib as they're written, for -w with
+ * --gzip-savefile; the compressor is handed a standard I/O stream,
+ * which libpcap or the pcapng writer write the savefile to.
+ */
+#if defined(HAVE_LIBZ) && defined(HAVE_ZLIB_H) && \
+    (defined(HAVE_FOPENCOOKIE) || defined(HAVE_FUNOPEN))
+#define GZIP_SAVEFILE_SUPPORTED
+
+struct gzip_savefile;
+
+extern struct gzip_savefile *gzip_savefile_open(int, int, char *);
+extern FILE *gzip_savefile_file(const struct gzip_savefile *);
+extern int gzip_savefile_flush(struct gzip_savefile *);
+extern int gzip_savefile_close(struct gzip_savefile *);
+#endif
@@ -0,0 +1,314 @@
+/*
+ * Copyright (c) 2026 The TCPDUMP project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that: (1) source code
+ * distributions retain the above copyright notice and this paragraph
+ * in its entirety, and (2) distributions including binary code include
+ * the above copyright notice and this paragraph in its entirety in
+ * the documentation or other materials provided with the distribution.
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND
+ * WITHOUT ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, WITHOUT
+ * LIMITATION, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE.
+ */
+
+
+/*
+ * A set of addresses and prefixes to match packets against, in user
+ * space, however many there are: the addresses are kept in an open
+ * addressing hash table, and the shorter prefixes in a binary trie for
+ * each address family, so that a lookup costs a hash probe and a walk
+ * of at most the address's length in bits.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include "netdissect-stdinc.h"
+
+#include <errno.h>
+#include <pcap.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "host-set.h"
+
+struct host_entry {
+	u_char he_len;			/* 4 or 16, 0 = unused */
+	u_char he_addr[16];
+};
+
+struct trie_node {
+	uint32_t tn_child[2];		/* 0 = none */
+	int tn_end;			/* a prefix ends here */
+};
+
+struct host_set {
+	struct host_entry *hs_table;
+	u_int hs_mask;			/* table size - 1 */
+	u_int hs_addresses;
+	struct trie_node *hs_nodes;	/* node 0 is unused */
+	u_int hs_nnodes, hs_maxnodes;
+	uint32_t hs_root[2];		/* IPv4, IPv6 */
+	u_int hs_prefixes;
+};
+
+static uint32_t
+host_hash(const u_char *addr, u_int len)
+{
+	uint32_t hash = 2166136261U;
+
+	while (len-- != 0)
+		hash = (hash ^ *addr++) * 16777619U;
+	hash ^= hash >> 15;
+	return (hash);
+}
+
+static struct host_entry *
+host_slot(struct host_entry *table, u_int mask, const u_char *addr,
+    u_int len)
+{
+	struct host_entry *he;
+	u_int i;
+
+	for (i = host_hash(addr, len) & mask;; i = (i + 1) & mask) {
+		he = &table[i];
+		if (he->he_len == 0 ||
+		    (he->he_len == len && memcmp(he->he_addr, addr, len) == 0))
+			return (he);
+	}
+}
+
+static int
+host_add(struct host_set *hs, const u_char *addr, u_int len)
+{
+	struct host_entry *table, *he;
+	u_int i, size;
+
+	if ((hs->hs_addresses + 1) * 2 > hs->hs_mask + 1) {
+		size = (hs->hs_mask + 1) * 2;
+		table = (struct host_entry *)calloc(size, sizeof(*table));
+		if (table == NULL)
+			return (-1);
+		for (i = 0; i <= hs->hs_mask; i++) {
+			he = &hs->hs_table[i];
+			if (he->he_len != 0)
+				*host_slot(table, size - 1, he->he_addr,
+				    he->he_len) = *he;
+		}
+		free(hs->hs_table);
+		hs->hs_table = table;
+		hs->hs_mask = size - 1;
+	}
+	he = host_slot(hs->hs_table, hs->hs_mask, addr, len);
+	if (he->he_len == 0) {
+		he->he_len = (u_char)len;
+		memcpy(he->he_addr, addr, len);
+		hs->hs_addresses++;
+	}
+	return (0);
+}
+
+static uint32_t
+trie_node_new(struct host_set *hs)
+{
+	struct trie_node *nodes;
+	u_int maxnodes;
+
+	if (hs->hs_nnodes == hs->hs_maxnodes) {
+		maxnodes = hs->hs_maxnodes != 0 ? hs->hs_maxnodes * 2 : 256;
+		nodes = (struct trie_node *)realloc(hs->hs_nodes,
+		    maxnodes * sizeof(*nodes));
+		if (nodes == NULL)
+			return (0);
+		hs->hs_nodes = nodes;
+		hs->hs_maxnodes = maxnodes;
+	}
+	memset(&hs->hs_nodes[hs->hs_nnodes], 0, sizeof(*hs->hs_nodes));
+	return (hs->hs_nnodes++);
+}
+
+/*
+ * Add the first "bits" bits of "addr", of "len" bytes, as a prefix.
+ */
+static int
+prefix_add(struct host_set *hs, const u_char *addr, u_int len, u_int bits)
+{
+	uint32_t *rootp, node, next;
+	u_int i, bit;
+
+	rootp = &hs->hs_root[len == 16];
+	if (*rootp == 0 && (*rootp = trie_node_new(hs)) == 0)
+		return (-1);
+	node = *rootp;
+	for (i = 0; i < bits; i++) {
+		if (hs->hs_nodes[node].tn_end)
+			return (0);	/* a shorter prefix covers it */
+		bit = (addr[i / 8] >> (7 - i % 8)) & 1;
+		if ((next = hs->hs_nodes[node].tn_child[bit]) == 0) {
+			if ((next = trie_node_new(hs)) == 0)
+				return (-1);
+			hs->hs_nodes[node].tn_child[bit] = next;
+		}
+		node = next;
+	}
+	if (!hs->hs_nodes[node].tn_end) {
+		hs->hs_nodes[node].tn_end = 1;
+		hs->hs_prefixes++;
+	}
+	return (0);
+}
+
+/*
+ * Parse a line of a hosts file: an IPv4 or IPv6 address, or a prefix in
+ * the form address/length.
+ */
+static int
+host_set_add(struct host_set *hs, char *line)
+{
+	u_char addr[16];
+	char *slash, *endp;
+	u_int len;
+	unsigned long bits;
+
+	slash = strchr(line, '/');
+	if (slash != NULL)
+		*slash = '\0';
+	if (inet_pton(AF_INET, line, addr) == 1)
+		len = 4;
+	else if (inet_pton(AF_INET6, line, addr) == 1)
+		len = 16;
+	else
+		return (-1);
+	bits = len * 8;
+	if (slash != NULL) {
+		errno = 0;
+		bits = strtoul(slash + 1, &endp, 10);
+		if (endp == slash + 1 || *endp != '\0' || errno != 0 ||
+		    bits > len * 8)
+			return (-1);
+	}
+	if (bits == len * 8)
+		return (host_add(hs, addr, len) == -1 ? -2 : 0);
+	return (prefix_add(hs, addr, len, (u_int)bits) == -1 ? -2 : 0);
+}
+
+/*
+ * Load the addresses and prefixes in "fname", one a line; text after a
+ * '#' on a line is ignored.
+ */
+struct host_set *
+host_set_load(const char *fname, char *errbuf)
+{
+	struct host_set *hs;
+	FILE *fp;
+	char line[256], *p, *end;
+	u_int lineno = 0;
+	int status;
+
+	fp = fopen(fname, "r");
+	if (fp == NULL) {
+		snprintf(errbuf, PCAP_ERRBUF_SIZE, "can't open %s: %s", fname,
+		    pcap_strerror(errno));
+		return (NULL);
+	}
+	hs = (struct host_set *)calloc(1, sizeof(*hs));
+	if (hs == NULL ||
+	    (hs->hs_table = (struct host_entry *)calloc(1024,
+	    sizeof(*hs->hs_table))) == NULL) {
+		snprintf(errbuf, PCAP_ERRBUF_SIZE, "out of memory");
+		host_set_free(hs);
+		fclose(fp);
+		return (NULL);
+	}
+	hs->hs_mask = 1024 - 1;
+	hs->hs_nnodes = 1;	/* node 0 means none */
+	hs->hs_maxnodes = 1;
+	hs->hs_nodes = (struct trie_node *)calloc(1, sizeof(*hs->hs_nodes));
+	while (fgets(line, sizeof(line), fp) != NULL) {
+		lineno++;
+		line[strcspn(line, "#\r\n")] = '\0';
+		for (p = line; *p == ' ' || *p == '\t'; p++)
+			;
+		for (end = p + strlen(p);
+		    end > p && (end[-1] == ' ' || end[-1] == '\t'); end--)
+			;
+		*end = '\0';
+		if (*p == '\0')
+			continue;
+		if (hs->hs_nodes == NULL)
+			status = -2;
+		else
+			status = host_set_add(hs, p);
+		if (status == -1) {
+			snprintf(errbuf, PCAP_ERRBUF_SIZE,
+			    "%s, line %u: invalid address or prefix", fname,
+			    lineno);
+			host_set_free(hs);
+			fclose(fp);
+			return (NULL);
+		}
+		if (status == -2) {
+			snprintf(errbuf, PCAP_ERRBUF_SIZE, "out of memory");
+			host_set_free(hs);
+			fclose(fp);
+			return (NULL);
+		}
+	}
+	fclose(fp);
+	return (hs);
+}
+
+/*
+ * Whether the address "addr", of "len" bytes, is in the set or in one
+ * of its prefixes.
+ */
+int
+host_set_match(const struct host_set *hs, const u_char *addr, u_int len)
+{
+	const struct host_entry *he;
+	uint32_t node;
+	u_int i;
+
+	if (hs->hs_addresses != 0) {
+		he = host_slot(hs->hs_table, hs->hs_mask, addr, len);
+		if (he->he_len != 0)
+			return (1);
+	}
+	node = hs->hs_root[len == 16];
+	for (i = 0; node != 0; i++) {
+		if (hs->hs_nodes[node].tn_end)
+			return (1);
+		if (i == len * 8)
+			break;
+		node = hs->hs_nodes[node].tn_child[
+		    (addr[i / 8] >> (7 - i % 8)) & 1];
+	}
+	return (0);
+}
+
+u_int
+host_set_addresses(const struct host_set *hs)
+{
+	return (hs->hs_addresses);
+}
+
+u_int
+host_set_prefixes(const struct host_set *hs)
+{
+	return (hs->hs_prefixes);
+}
+
+void
+host_set_free(struct host_set *hs)
+{
+	if (hs == NULL)
+		return;
+	free(hs->hs_table);
+	free(hs->hs_nodes);
+	free(hs);
+}
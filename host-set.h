@@ -0,0 +1,32 @@
+/*
+ * Copyright (c) 2026 The TCPDUMP project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that: (1) source code
+ * distributions retain the above copyright notice and this paragraph
+ * in its entirety, and (2) distributions including binary code include
+ * the above copyright notice and this paragraph in its entirety in
+ * the documentation or other materials provided with the distribution.
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND
+ * WITHOUT ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, WITHOUT
+ * LIMITATION, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE.
+ */
+
+
+/*
+ * Sets of IPv4 and IPv6 addresses and prefixes, for --hosts-file.
+ */
+#ifndef host_set_h
+#define host_set_h
+
+struct host_set;
+
+extern struct host_set *host_set_load(const char *, char *);
+extern int host_set_match(const struct host_set *, const u_char *, u_int);
+extern u_int host_set_addresses(const struct host_set *);
+extern u_int host_set_prefixes(const struct host_set *);
+extern void host_set_free(struct host_set *);
+
+#endif /* host_set_h */
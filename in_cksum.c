@@ -39,112 +39,279 @@
 # include <config.h>
 #endif
 
+#include <string.h>
+
 #include "netdissect-stdinc.h"
 
 #include "netdissect.h"
+#include "compiler-tests.h"
 
 /*
- * Checksum routine for Internet Protocol family headers (Portable Version).
+ * Checksum routine for Internet Protocol family headers.
+ *
+ * This routine is very heavily used, so the data is summed in wide
+ * pieces: 64 bits at a time in plain C, or 16-bit words into 32-bit
+ * vector lanes with SSE2, AVX2 (if the CPU has it) or NEON for longer
+ * data.  As 2^16 is 1 modulo 2^16 - 1, folding a wide sum down to 16
+ * bits with end-around carries gives the same one's complement sum as
+ * adding up 16-bit words.
  *
- * This routine is very heavily used in the network
- * code and should be modified for each CPU to be as fast as possible.
+ * As RFC 1071 notes, the sum of a byte-swapped piece is the byte-swapped
+ * sum of the piece, so a piece that starts at an odd offset in the
+ * data being checksummed is summed on its own and its sum swapped.
  */
 
-#define ADDCARRY(x)  {if ((x) > 65535) (x) -= 65535;}
-#define REDUCE {l_util.l = sum; sum = l_util.s[0] + l_util.s[1]; ADDCARRY(sum);}
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__)) && \
+    defined(__SSE2__)
+#include <emmintrin.h>
+#define CKSUM_SSE2
+#if ND_IS_AT_LEAST_GNUC_VERSION(4,9) || defined(__clang__)
+#include <immintrin.h>
+#define CKSUM_AVX2
+#endif
+#elif defined(__GNUC__) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#define CKSUM_NEON
+#endif
 
-uint16_t
-in_cksum(const struct cksum_vec *vec, int veclen)
+static uint64_t
+fold32(uint64_t sum)
 {
-	const uint16_t *w;
-	int sum = 0;
-	int mlen = 0;
-	int byte_swapped = 0;
-
-	union {
-		uint8_t		c[2];
-		uint16_t	s;
-	} s_util;
-	union {
-		uint16_t	s[2];
-		uint32_t	l;
-	} l_util;
+	sum = (sum & 0xffffffff) + (sum >> 32);
+	sum = (sum & 0xffffffff) + (sum >> 32);
+	return sum;
+}
 
-	for (; veclen != 0; vec++, veclen--) {
-		if (vec->len == 0)
-			continue;
-		w = (const uint16_t *)(const void *)vec->ptr;
-		if (mlen == -1) {
-			/*
-			 * The first byte of this chunk is the continuation
-			 * of a word spanning between this chunk and the
-			 * last chunk.
-			 *
-			 * s_util.c[0] is already saved when scanning previous
-			 * chunk.
-			 */
-			s_util.c[1] = *(const uint8_t *)w;
-			sum += s_util.s;
-			w = (const uint16_t *)(const void *)((const uint8_t *)w + 1);
-			mlen = vec->len - 1;
-		} else
-			mlen = vec->len;
-		/*
-		 * Force to even boundary.
-		 */
-		if ((1 & (uintptr_t) w) && (mlen > 0)) {
-			REDUCE;
-			sum <<= 8;
-			s_util.c[0] = *(const uint8_t *)w;
-			w = (const uint16_t *)(const void *)((const uint8_t *)w + 1);
-			mlen--;
-			byte_swapped = 1;
+static uint16_t
+fold16(uint64_t sum)
+{
+	sum = fold32(sum);
+	sum = (sum & 0xffff) + (sum >> 16);
+	sum = (sum & 0xffff) + (sum >> 16);
+	return (uint16_t)sum;
+}
+
+/*
+ * Add the data, as native-byte-order 16-bit words, to a partial sum;
+ * an odd byte at the end is padded with a zero byte.  The data is
+ * added 64 bits at a time, with the carries counted separately.
+ */
+static uint64_t
+cksum_add_portable(const uint8_t *p, size_t len, uint64_t sum)
+{
+	uint64_t w64, carry = 0;
+	uint32_t w32;
+	uint16_t w16;
+	uint8_t b[2];
+
+	sum = fold32(sum);
+	while (len >= 8) {
+		memcpy(&w64, p, 8);
+		sum += w64;
+		carry += sum < w64;
+		p += 8;
+		len -= 8;
+	}
+	sum = fold32(sum) + carry;
+	if (len >= 4) {
+		memcpy(&w32, p, 4);
+		sum += w32;
+		p += 4;
+		len -= 4;
+	}
+	if (len >= 2) {
+		memcpy(&w16, p, 2);
+		sum += w16;
+		p += 2;
+		len -= 2;
+	}
+	if (len != 0) {
+		b[0] = *p;
+		b[1] = 0;
+		memcpy(&w16, b, 2);
+		sum += w16;
+	}
+	return sum;
+}
+
+/*
+ * The vector versions sum a multiple of their block size, adding the
+ * 16-bit words into 32-bit lanes, two words per lane per block; that
+ * can go on for 32768 blocks before a lane might overflow.
+ */
+#define CKSUM_VEC_BLOCKS	32768
+
+#ifdef CKSUM_SSE2
+#define CKSUM_SSE2_BLOCK	32
+
+static uint64_t
+cksum_add_sse2(const uint8_t *p, size_t len)
+{
+	const __m128i mask = _mm_set1_epi32(0xffff);
+	__m128i acc0, acc1, acc2, acc3, v0, v1;
+	uint32_t lanes[4];
+	uint64_t sum = 0;
+	u_int n;
+
+	while (len != 0) {
+		acc0 = acc1 = acc2 = acc3 = _mm_setzero_si128();
+		for (n = 0; len != 0 && n < CKSUM_VEC_BLOCKS; n++) {
+			v0 = _mm_loadu_si128((const __m128i *)(const void *)p);
+			v1 = _mm_loadu_si128((const __m128i *)(const void *)(p + 16));
+			acc0 = _mm_add_epi32(acc0, _mm_and_si128(v0, mask));
+			acc1 = _mm_add_epi32(acc1, _mm_srli_epi32(v0, 16));
+			acc2 = _mm_add_epi32(acc2, _mm_and_si128(v1, mask));
+			acc3 = _mm_add_epi32(acc3, _mm_srli_epi32(v1, 16));
+			p += CKSUM_SSE2_BLOCK;
+			len -= CKSUM_SSE2_BLOCK;
 		}
-		/*
-		 * Unroll the loop to make overhead from
-		 * branches &c small.
-		 */
-		while ((mlen -= 32) >= 0) {
-			sum += w[0]; sum += w[1]; sum += w[2]; sum += w[3];
-			sum += w[4]; sum += w[5]; sum += w[6]; sum += w[7];
-			sum += w[8]; sum += w[9]; sum += w[10]; sum += w[11];
-			sum += w[12]; sum += w[13]; sum += w[14]; sum += w[15];
-			w += 16;
+		/* add pairs of lanes into 64-bit lanes, so they can't overflow */
+		acc0 = _mm_add_epi64(
+		    _mm_add_epi64(_mm_unpacklo_epi32(acc0, _mm_setzero_si128()),
+		    _mm_unpackhi_epi32(acc0, _mm_setzero_si128())),
+		    _mm_add_epi64(_mm_unpacklo_epi32(acc1, _mm_setzero_si128()),
+		    _mm_unpackhi_epi32(acc1, _mm_setzero_si128())));
+		acc2 = _mm_add_epi64(
+		    _mm_add_epi64(_mm_unpacklo_epi32(acc2, _mm_setzero_si128()),
+		    _mm_unpackhi_epi32(acc2, _mm_setzero_si128())),
+		    _mm_add_epi64(_mm_unpacklo_epi32(acc3, _mm_setzero_si128()),
+		    _mm_unpackhi_epi32(acc3, _mm_setzero_si128())));
+		_mm_storeu_si128((__m128i *)(void *)lanes,
+		    _mm_add_epi64(acc0, acc2));
+		sum += fold32(((uint64_t)lanes[1] << 32 | lanes[0])) +
+		    fold32(((uint64_t)lanes[3] << 32 | lanes[2]));
+	}
+	return sum;
+}
+#endif
+
+#ifdef CKSUM_AVX2
+#define CKSUM_AVX2_BLOCK	64
+
+__attribute__((target("avx2")))
+static uint64_t
+cksum_add_avx2(const uint8_t *p, size_t len)
+{
+	const __m256i mask = _mm256_set1_epi32(0xffff);
+	__m256i acc0, acc1, acc2, acc3, v0, v1;
+	uint32_t lanes[8];
+	uint64_t sum = 0;
+	u_int n, i;
+
+	while (len != 0) {
+		acc0 = acc1 = acc2 = acc3 = _mm256_setzero_si256();
+		for (n = 0; len != 0 && n < CKSUM_VEC_BLOCKS; n++) {
+			v0 = _mm256_loadu_si256((const __m256i *)(const void *)p);
+			v1 = _mm256_loadu_si256((const __m256i *)(const void *)(p + 32));
+			acc0 = _mm256_add_epi32(acc0, _mm256_and_si256(v0, mask));
+			acc1 = _mm256_add_epi32(acc1, _mm256_srli_epi32(v0, 16));
+			acc2 = _mm256_add_epi32(acc2, _mm256_and_si256(v1, mask));
+			acc3 = _mm256_add_epi32(acc3, _mm256_srli_epi32(v1, 16));
+			p += CKSUM_AVX2_BLOCK;
+			len -= CKSUM_AVX2_BLOCK;
 		}
-		mlen += 32;
-		while ((mlen -= 8) >= 0) {
-			sum += w[0]; sum += w[1]; sum += w[2]; sum += w[3];
-			w += 4;
+		/* add pairs of lanes into 64-bit lanes, so they can't overflow */
+		acc0 = _mm256_add_epi64(
+		    _mm256_add_epi64(_mm256_unpacklo_epi32(acc0, _mm256_setzero_si256()),
+		    _mm256_unpackhi_epi32(acc0, _mm256_setzero_si256())),
+		    _mm256_add_epi64(_mm256_unpacklo_epi32(acc1, _mm256_setzero_si256()),
+		    _mm256_unpackhi_epi32(acc1, _mm256_setzero_si256())));
+		acc2 = _mm256_add_epi64(
+		    _mm256_add_epi64(_mm256_unpacklo_epi32(acc2, _mm256_setzero_si256()),
+		    _mm256_unpackhi_epi32(acc2, _mm256_setzero_si256())),
+		    _mm256_add_epi64(_mm256_unpacklo_epi32(acc3, _mm256_setzero_si256()),
+		    _mm256_unpackhi_epi32(acc3, _mm256_setzero_si256())));
+		_mm256_storeu_si256((__m256i *)(void *)lanes,
+		    _mm256_add_epi64(acc0, acc2));
+		for (i = 0; i < 8; i += 2)
+			sum += fold32(((uint64_t)lanes[i + 1] << 32 | lanes[i]));
+	}
+	/*
+	 * Avoid the penalty for going back to SSE code with the upper
+	 * halves of the AVX registers in use.
+	 */
+	_mm256_zeroupper();
+	return sum;
+}
+#endif
+
+#ifdef CKSUM_NEON
+#define CKSUM_NEON_BLOCK	32
+
+static uint64_t
+cksum_add_neon(const uint8_t *p, size_t len)
+{
+	uint32x4_t acc0, acc1;
+	uint64x2_t wide;
+	uint64_t sum = 0;
+	u_int n;
+
+	while (len != 0) {
+		acc0 = acc1 = vdupq_n_u32(0);
+		for (n = 0; len != 0 && n < CKSUM_VEC_BLOCKS; n++) {
+			acc0 = vpadalq_u16(acc0,
+			    vreinterpretq_u16_u8(vld1q_u8(p)));
+			acc1 = vpadalq_u16(acc1,
+			    vreinterpretq_u16_u8(vld1q_u8(p + 16)));
+			p += CKSUM_NEON_BLOCK;
+			len -= CKSUM_NEON_BLOCK;
 		}
-		mlen += 8;
-		if (mlen == 0 && byte_swapped == 0)
-			continue;
-		REDUCE;
-		while ((mlen -= 2) >= 0) {
-			sum += *w++;
+		wide = vpaddlq_u32(acc0);
+		wide = vpadalq_u32(wide, acc1);
+		sum += fold32(vgetq_lane_u64(wide, 0)) +
+		    fold32(vgetq_lane_u64(wide, 1));
+	}
+	return sum;
+}
+#endif
+
+/*
+ * Return the one's complement sum of the data.  Short pieces, such as
+ * most headers, aren't worth setting the vector registers up for.
+ */
+static uint16_t
+cksum_sum(const uint8_t *p, size_t len)
+{
+	uint64_t sum = 0;
+	size_t vlen = 0;
+
+	if (len >= 128) {
+#if defined(CKSUM_AVX2)
+		if (__builtin_cpu_supports("avx2")) {
+			vlen = len - len % CKSUM_AVX2_BLOCK;
+			sum = cksum_add_avx2(p, vlen);
+		} else {
+			vlen = len - len % CKSUM_SSE2_BLOCK;
+			sum = cksum_add_sse2(p, vlen);
 		}
-		if (byte_swapped) {
-			REDUCE;
-			sum <<= 8;
-			byte_swapped = 0;
-			if (mlen == -1) {
-				s_util.c[1] = *(const uint8_t *)w;
-				sum += s_util.s;
-				mlen = 0;
-			} else
-				mlen = -1;
-		} else if (mlen == -1)
-			s_util.c[0] = *(const uint8_t *)w;
+#elif defined(CKSUM_SSE2)
+		vlen = len - len % CKSUM_SSE2_BLOCK;
+		sum = cksum_add_sse2(p, vlen);
+#elif defined(CKSUM_NEON)
+		vlen = len - len % CKSUM_NEON_BLOCK;
+		sum = cksum_add_neon(p, vlen);
+#endif
 	}
-	if (mlen == -1) {
-		/* The last mbuf has odd # of bytes. Follow the
-		   standard (the odd byte may be shifted left by 8 bits
-		   or not as determined by endian-ness of the machine) */
-		s_util.c[1] = 0;
-		sum += s_util.s;
+	return fold16(cksum_add_portable(p + vlen, len - vlen, sum));
+}
+
+uint16_t
+in_cksum(const struct cksum_vec *vec, int veclen)
+{
+	uint32_t sum = 0;
+	uint16_t psum;
+	int odd = 0;	/* the next piece starts at an odd offset */
+
+	for (; veclen != 0; vec++, veclen--) {
+		if (vec->len == 0)
+			continue;
+		psum = cksum_sum(vec->ptr, vec->len);
+		if (odd)
+			psum = (uint16_t)((psum << 8) | (psum >> 8));
+		sum += psum;
+		odd ^= vec->len & 1;
 	}
-	REDUCE;
-	return (~sum & 0xffff);
+	return (~fold16(sum) & 0xffff);
 }
 
 /*
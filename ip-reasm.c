@@ -0,0 +1,475 @@
+/*
+ * Copyright (c) 2026 The TCPDUMP project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that: (1) source code
+ * distributions retain the above copyright notice and this paragraph
+ * in its entirety, and (2) distributions including binary code include
+ * the above copyright notice and this paragraph in its entirety in
+ * the documentation or other materials provided with the distribution.
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND
+ * WITHOUT ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, WITHOUT
+ * LIMITATION, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE.
+ */
+
+/*
+ * The datagrams being put together are in a hash table, chained, and
+ * on a list in the order their first fragments came in, which is the
+ * order they time out in.  A datagram has the data of its fragments,
+ * at their offsets, and the ranges of it that have been filled in.
+ *
+ * A finished datagram is rebuilt, behind a copy of the IP header of
+ * its first fragment, in a buffer of its own that's pushed with
+ * nd_push_buffer(), so that it's freed even if the dissector doesn't
+ * return; the datagram is dropped from the table first, for the same
+ * reason.  For IPv6 the extension headers ahead of the fragment header
+ * aren't kept.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include "netdissect-stdinc.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "netdissect.h"
+#include "netdissect-alloc.h"
+#include "addrtoname.h"
+#include "extract.h"
+#include "ip.h"
+#include "ip6.h"
+#include "ip-reasm.h"
+#include "netdissect-state.h"
+
+#define IP_REASM_MIN_BUCKETS	64
+
+struct ip_reasm_key {
+	nd_ipv6 src;		/* IPv4 addresses are in the first 4 octets */
+	nd_ipv6 dst;
+	uint32_t id;
+	uint32_t proto;		/* IP version << 8 | protocol */
+};
+
+struct ip_reasm_range {
+	u_int start, end;
+};
+
+struct ip_reasm_dgram {
+	struct ip_reasm_dgram *hnext;
+	struct ip_reasm_dgram *prev;	/* older */
+	struct ip_reasm_dgram *next;	/* newer */
+	struct ip_reasm_key key;
+	uint32_t hash;
+	uint32_t first;		/* time stamp, in seconds, of its first fragment */
+	int dead;		/* dropped for an overlap */
+	u_char hdr[60];		/* IP header of the first fragment */
+	u_int hdrlen;		/* 0 until the first fragment is seen */
+	u_int total;		/* length, 0 until the last fragment is seen */
+	u_char *data;
+	u_int size;		/* bytes allocated for data */
+	u_int nfrags;
+	u_int nranges;
+	struct ip_reasm_range ranges[IP_REASM_MAX_FRAGS];
+};
+
+static ND_THREAD_LOCAL struct ip_reasm_dgram **ipr_buckets;
+static ND_THREAD_LOCAL u_int ipr_nbuckets;
+static ND_THREAD_LOCAL u_int ipr_ndgrams;
+static ND_THREAD_LOCAL struct ip_reasm_dgram *ipr_oldest, *ipr_newest;
+static ND_THREAD_LOCAL size_t ipr_bytes;	/* against the budget */
+
+static uint32_t
+ipr_hash(const struct ip_reasm_key *key)
+{
+	const u_char *p = (const u_char *)key;
+	uint32_t h = 0, w;
+	size_t i;
+
+	for (i = 0; i < sizeof(*key); i += 4) {
+		memcpy(&w, p + i, 4);
+		h = (h ^ w) * 0x9e3779b1U;
+	}
+	h ^= h >> 16;
+	h *= 0x85ebca6bU;
+	h ^= h >> 13;
+	h *= 0xc2b2ae35U;
+	h ^= h >> 16;
+	return h;
+}
+
+static void
+ipr_free(struct ip_reasm_dgram *d)
+{
+	struct ip_reasm_dgram **dp;
+
+	for (dp = &ipr_buckets[d->hash & (ipr_nbuckets - 1)]; *dp != d;
+	    dp = &(*dp)->hnext)
+		continue;
+	*dp = d->hnext;
+	if (d->prev != NULL)
+		d->prev->next = d->next;
+	else
+		ipr_oldest = d->next;
+	if (d->next != NULL)
+		d->next->prev = d->prev;
+	else
+		ipr_newest = d->prev;
+	ipr_bytes -= sizeof(*d) + d->size;
+	ipr_ndgrams--;
+	free(d->data);
+	free(d);
+}
+
+/*
+ * Make room for "n" more bytes for the datagram "d", dropping the
+ * oldest.  Returns -1 if there isn't room even without them.
+ */
+static int
+ipr_reserve(netdissect_options *ndo, const struct ip_reasm_dgram *d,
+    size_t n)
+{
+	while (ipr_bytes + n > ndo->ndo_ip_reasm_budget) {
+		if (ipr_oldest == NULL || ipr_oldest == d)
+			return (-1);
+		ipr_free(ipr_oldest);
+	}
+	return (0);
+}
+
+static void
+ipr_grow(netdissect_options *ndo)
+{
+	struct ip_reasm_dgram **b, *d, *next;
+	u_int n, i;
+
+	n = ipr_nbuckets != 0 ? ipr_nbuckets * 2 : IP_REASM_MIN_BUCKETS;
+	b = (struct ip_reasm_dgram **)nd_big_calloc(n, sizeof(*b));
+	if (b == NULL)
+		(*ndo->ndo_error)(ndo, S_ERR_ND_MEM_ALLOC, "%s: calloc",
+		    __func__);
+	for (i = 0; i < ipr_nbuckets; i++) {
+		for (d = ipr_buckets[i]; d != NULL; d = next) {
+			next = d->hnext;
+			d->hnext = b[d->hash & (n - 1)];
+			b[d->hash & (n - 1)] = d;
+		}
+	}
+	nd_big_free(ipr_buckets);
+	ipr_buckets = b;
+	ipr_nbuckets = n;
+}
+
+/*
+ * Find the datagram "key", if "create" is set making one if there
+ * isn't one.  Returns NULL if there's none, or no room for one.
+ */
+static struct ip_reasm_dgram *
+ipr_lookup(netdissect_options *ndo, const struct ip_reasm_key *key,
+    int create)
+{
+	struct ip_reasm_dgram *d;
+	uint32_t now = (uint32_t)ndo->ndo_packet_sec;
+	uint32_t h = ipr_hash(key);
+
+	while (ipr_oldest != NULL &&
+	    (int32_t)(now - ipr_oldest->first) > IP_REASM_TIMEOUT)
+		ipr_free(ipr_oldest);
+	if (ipr_nbuckets != 0) {
+		for (d = ipr_buckets[h & (ipr_nbuckets - 1)]; d != NULL;
+		    d = d->hnext)
+			if (d->hash == h &&
+			    memcmp(&d->key, key, sizeof(*key)) == 0)
+				return (d);
+	}
+	if (!create || ipr_reserve(ndo, NULL, sizeof(*d)) == -1)
+		return (NULL);
+	if (ipr_ndgrams >= ipr_nbuckets)
+		ipr_grow(ndo);
+	d = (struct ip_reasm_dgram *)calloc(1, sizeof(*d));
+	if (d == NULL)
+		(*ndo->ndo_error)(ndo, S_ERR_ND_MEM_ALLOC, "%s: calloc",
+		    __func__);
+	d->key = *key;
+	d->hash = h;
+	d->first = now;
+	d->hnext = ipr_buckets[h & (ipr_nbuckets - 1)];
+	ipr_buckets[h & (ipr_nbuckets - 1)] = d;
+	d->prev = ipr_newest;
+	if (ipr_newest != NULL)
+		ipr_newest->next = d;
+	else
+		ipr_oldest = d;
+	ipr_newest = d;
+	ipr_bytes += sizeof(*d);
+	ipr_ndgrams++;
+	return (d);
+}
+
+/*
+ * Add the "len" bytes of the fragment at offset "off" to the datagram;
+ * "more" is set if it isn't the last fragment.  Returns -1 if the
+ * datagram can't be put together, with "d->dead" set if that's because
+ * of an overlap.
+ */
+static int
+ipr_add(netdissect_options *ndo, struct ip_reasm_dgram *d, u_int off,
+    int more, const u_char *bp, u_int len)
+{
+	struct ip_reasm_range *r;
+	u_int end = off + len, start, size, i, j;
+	u_char *data;
+
+	if (end > IP_REASM_DGRAM_MAX || (more && len % 8 != 0) ||
+	    ++d->nfrags > IP_REASM_MAX_FRAGS)
+		return (-1);
+	if (d->total != 0 && end > d->total)
+		return (-1);
+	if (!more) {
+		if (d->nranges != 0 && d->ranges[d->nranges - 1].end > end)
+			return (-1);
+		d->total = end;
+	}
+	if (len == 0)
+		return (0);
+
+	for (i = 0; i < d->nranges; i++) {
+		if (d->ranges[i].start < end && off < d->ranges[i].end &&
+		    ndo->ndo_ip_reasm_overlap == IP_REASM_OVERLAP_DROP) {
+			d->dead = 1;
+			return (-1);
+		}
+	}
+
+	if (end > d->size) {
+		for (size = d->size != 0 ? d->size : 2048; size < end;
+		    size *= 2)
+			continue;
+		if (size > IP_REASM_DGRAM_MAX)
+			size = IP_REASM_DGRAM_MAX;
+		if (ipr_reserve(ndo, d, size - d->size) == -1)
+			return (-1);
+		data = (u_char *)realloc(d->data, size);
+		if (data == NULL)
+			(*ndo->ndo_error)(ndo, S_ERR_ND_MEM_ALLOC,
+			    "%s: realloc", __func__);
+		ipr_bytes += size - d->size;
+		d->data = data;
+		d->size = size;
+	}
+
+	if (ndo->ndo_ip_reasm_overlap == IP_REASM_OVERLAP_LAST)
+		memcpy(d->data + off, bp, len);
+	else {
+		/* Only fill in what isn't there yet. */
+		start = off;
+		for (i = 0; i < d->nranges && start < end; i++) {
+			r = &d->ranges[i];
+			if (r->end <= start)
+				continue;
+			if (r->start > start)
+				memcpy(d->data + start, bp + (start - off),
+				    (r->start < end ? r->start : end) - start);
+			start = r->end;
+		}
+		if (start < end)
+			memcpy(d->data + start, bp + (start - off), end - start);
+	}
+
+	/* Merge [off, end) into the ranges, which are kept sorted. */
+	for (i = 0; i < d->nranges && d->ranges[i].end < off; i++)
+		continue;
+	for (j = i; j < d->nranges && d->ranges[j].start <= end; j++) {
+		if (d->ranges[j].start < off)
+			off = d->ranges[j].start;
+		if (d->ranges[j].end > end)
+			end = d->ranges[j].end;
+	}
+	/* Ranges i to j - 1 are replaced by one. */
+	if (j == i) {
+		memmove(&d->ranges[i + 1], &d->ranges[i],
+		    (d->nranges - i) * sizeof(d->ranges[0]));
+		d->nranges++;
+	} else if (j > i + 1) {
+		memmove(&d->ranges[i + 1], &d->ranges[j],
+		    (d->nranges - j) * sizeof(d->ranges[0]));
+		d->nranges -= j - i - 1;
+	}
+	d->ranges[i].start = off;
+	d->ranges[i].end = end;
+	return (0);
+}
+
+/*
+ * If the datagram is all there, drop it from the table and return it,
+ * rebuilt, in a buffer that's been pushed; otherwise return NULL.
+ */
+static u_char *
+ipr_finish(netdissect_options *ndo, struct ip_reasm_dgram *d)
+{
+	u_char *buf;
+	u_int hdrlen = d->hdrlen, total = d->total;
+
+	if (hdrlen == 0 || total == 0 || d->nranges != 1 ||
+	    d->ranges[0].start != 0 || d->ranges[0].end != total)
+		return (NULL);
+	buf = (u_char *)malloc(hdrlen + total);
+	if (buf == NULL)
+		(*ndo->ndo_error)(ndo, S_ERR_ND_MEM_ALLOC, "%s: malloc",
+		    __func__);
+	memcpy(buf, d->hdr, hdrlen);
+	memcpy(buf + hdrlen, d->data, total);
+	ipr_free(d);
+	if (!nd_push_buffer(ndo, buf, buf, buf + hdrlen + total)) {
+		free(buf);
+		(*ndo->ndo_error)(ndo, S_ERR_ND_MEM_ALLOC,
+		    "%s: can't push buffer", __func__);
+	}
+	return (buf);
+}
+
+/*
+ * Handle an IPv4 fragment, with the header "ip" and "len" bytes of
+ * data at "bp".
+ */
+int
+ip_reasm_ip4_print(netdissect_options *ndo, const struct ip *ip,
+    const u_char *bp, u_int len)
+{
+	struct ip_reasm_key key;
+	struct ip_reasm_dgram *d;
+	struct ip *nip;
+	u_char *buf;
+	u_int off, hlen, nh;
+
+	memset(&key, 0, sizeof(key));
+	GET_CPY_BYTES(&key.src, ip->ip_src, sizeof(ip->ip_src));
+	GET_CPY_BYTES(&key.dst, ip->ip_dst, sizeof(ip->ip_dst));
+	key.id = GET_BE_U_2(ip->ip_id);
+	nh = GET_U_1(ip->ip_p);
+	key.proto = 4 << 8 | nh;
+	off = GET_BE_U_2(ip->ip_off);
+	hlen = IP_HL(ip) * 4;
+
+	if (!ND_TTEST_LEN(bp, len)) {
+		/* It can't be put together. */
+		if ((d = ipr_lookup(ndo, &key, 0)) != NULL && !d->dead)
+			ipr_free(d);
+		return (IP_REASM_NONE);
+	}
+	if ((d = ipr_lookup(ndo, &key, 1)) == NULL || d->dead)
+		return (IP_REASM_NONE);
+	if ((off & IP_OFFMASK) == 0) {
+		d->hdrlen = hlen;
+		GET_CPY_BYTES(d->hdr, ip, hlen);
+	}
+	if (ipr_add(ndo, d, (off & IP_OFFMASK) * 8, (off & IP_MF) != 0, bp,
+	    len) == -1) {
+		if (!d->dead)
+			ipr_free(d);
+		return (IP_REASM_NONE);
+	}
+	if ((buf = ipr_finish(ndo, d)) == NULL)
+		return (IP_REASM_HELD);
+
+	nip = (struct ip *)buf;
+	len = ND_BYTES_AVAILABLE_AFTER(buf + hlen);
+	nip->ip_len[0] = (u_char)((hlen + len) >> 8);
+	nip->ip_len[1] = (u_char)(hlen + len);
+	nip->ip_off[0] = nip->ip_off[1] = 0;
+	if (!ip_demux_prints_addrs(nh))
+		ND_PRINT("%s > %s: ", GET_IPADDR_STRING(nip->ip_src),
+		    GET_IPADDR_STRING(nip->ip_dst));
+	ip_print_demux(ndo, buf + hlen, len, 4, 0, GET_U_1(nip->ip_ttl), nh,
+	    buf);
+	nd_pop_packet_info(ndo);
+	return (IP_REASM_DONE);
+}
+
+/*
+ * Handle an IPv6 fragment, with the header "ip6", the fragment header
+ * at "fh" and "len" bytes of data after that.
+ */
+int
+ip_reasm_ip6_print(netdissect_options *ndo, const struct ip6_hdr *ip6,
+    const u_char *fh, u_int len)
+{
+	const struct ip6_frag *dp = (const struct ip6_frag *)fh;
+	const u_char *bp = fh + sizeof(struct ip6_frag);
+	struct ip_reasm_key key;
+	struct ip_reasm_dgram *d;
+	struct ip6_hdr *nip6;
+	u_char *buf;
+	u_int off, nh;
+
+	memset(&key, 0, sizeof(key));
+	GET_CPY_BYTES(&key.src, ip6->ip6_src, sizeof(ip6->ip6_src));
+	GET_CPY_BYTES(&key.dst, ip6->ip6_dst, sizeof(ip6->ip6_dst));
+	key.id = GET_BE_U_4(dp->ip6f_ident);
+	nh = GET_U_1(dp->ip6f_nxt);
+	key.proto = 6 << 8 | nh;
+	off = GET_BE_U_2(dp->ip6f_offlg);
+
+	if (!ND_TTEST_LEN(bp, len)) {
+		if ((d = ipr_lookup(ndo, &key, 0)) != NULL && !d->dead)
+			ipr_free(d);
+		return (IP_REASM_NONE);
+	}
+	if ((d = ipr_lookup(ndo, &key, 1)) == NULL || d->dead)
+		return (IP_REASM_NONE);
+	if (d->hdrlen == 0) {
+		d->hdrlen = sizeof(struct ip6_hdr);
+		GET_CPY_BYTES(d->hdr, ip6, sizeof(struct ip6_hdr));
+	}
+	if (ipr_add(ndo, d, off & IP6F_OFF_MASK, (off & IP6F_MORE_FRAG) != 0,
+	    bp, len) == -1) {
+		if (!d->dead)
+			ipr_free(d);
+		return (IP_REASM_NONE);
+	}
+	if ((buf = ipr_finish(ndo, d)) == NULL)
+		return (IP_REASM_HELD);
+
+	nip6 = (struct ip6_hdr *)buf;
+	len = ND_BYTES_AVAILABLE_AFTER(buf + sizeof(struct ip6_hdr));
+	nip6->ip6_plen[0] = (u_char)(len >> 8);
+	nip6->ip6_plen[1] = (u_char)len;
+	nip6->ip6_nxt[0] = (u_char)nh;
+	if ((off & IP6F_OFF_MASK) != 0)
+		ND_PRINT(" ");
+	ip_print_demux(ndo, buf + sizeof(struct ip6_hdr), len, 6, 0,
+	    GET_U_1(nip6->ip6_hlim), nh, buf);
+	nd_pop_packet_info(ndo);
+	return (IP_REASM_DONE);
+}
+
+size_t
+ip_reasm_mem_usage(netdissect_options *ndo _U_)
+{
+	return (ipr_bytes + ipr_nbuckets * sizeof(*ipr_buckets));
+}
+
+/*
+ * For --mem-limit: drop the datagrams whose first fragment came the
+ * longest ago until "want" bytes have been given back, or there are
+ * none left.  The fragments still to come of one that's dropped are
+ * printed as fragments.
+ */
+uint64_t
+ip_reasm_mem_reclaim(netdissect_options *ndo _U_, size_t want)
+{
+	size_t target;
+	uint64_t n;
+
+	target = ipr_bytes > want ? ipr_bytes - want : 0;
+	n = 0;
+	while (ipr_oldest != NULL && ipr_bytes > target) {
+		ipr_free(ipr_oldest);
+		n++;
+	}
+	return (n);
+}
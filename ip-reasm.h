@@ -0,0 +1,63 @@
+/*
+ * Copyright (c) 2026 The TCPDUMP project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that: (1) source code
+ * distributions retain the above copyright notice and this paragraph
+ * in its entirety, and (2) distributions including binary code include
+ * the above copyright notice and this paragraph in its entirety in
+ * the documentation or other materials provided with the distribution.
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND
+ * WITHOUT ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, WITHOUT
+ * LIMITATION, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE.
+ */
+
+#ifndef ip_reasm_h
+#define ip_reasm_h
+
+/*
+ * IPv4 and IPv6 fragment reassembly, for --ip-reassembly.
+ *
+ * The fragments of a datagram, going by its addresses, identification
+ * and protocol, are kept until they're all there, and then the
+ * datagram is handed to ip_print_demux() with the fragment that
+ * finished it.  A datagram is dropped if it isn't finished within
+ * IP_REASM_TIMEOUT seconds of its first fragment, if it would be
+ * longer than IP_REASM_DGRAM_MAX bytes or take more than
+ * IP_REASM_MAX_FRAGS fragments, or if a fragment wasn't all captured.
+ * The datagrams being put together are limited to
+ * ndo_ip_reasm_budget bytes in all, the oldest being dropped to stay
+ * within it.
+ *
+ * Where a fragment overlaps the data of one already seen,
+ * ndo_ip_reasm_overlap says whether the data first seen is kept, that
+ * of the later fragment is, or the datagram is dropped, as RFC 5722
+ * has it for IPv6; a dropped datagram's later fragments are printed
+ * as they are until it would have timed out.
+ */
+#define IP_REASM_DEFAULT_BUDGET	16	/* megabytes */
+#define IP_REASM_DGRAM_MAX	65535
+#define IP_REASM_MAX_FRAGS	64
+#define IP_REASM_TIMEOUT	30
+
+/* ndo_ip_reasm_overlap */
+#define IP_REASM_OVERLAP_FIRST	0
+#define IP_REASM_OVERLAP_LAST	1
+#define IP_REASM_OVERLAP_DROP	2
+
+/* What became of a fragment */
+#define IP_REASM_NONE		0	/* print it as it is */
+#define IP_REASM_HELD		1	/* kept for a datagram not done yet */
+#define IP_REASM_DONE		2	/* the datagram has been printed */
+
+struct ip;
+struct ip6_hdr;
+
+extern int ip_reasm_ip4_print(netdissect_options *, const struct ip *,
+    const u_char *, u_int);
+extern int ip_reasm_ip6_print(netdissect_options *, const struct ip6_hdr *,
+    const u_char *, u_int);
+
+#endif /* ip_reasm_h */
@@ -0,0 +1,193 @@
+/*
+ * Copyright (c) 2026 The TCPDUMP project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that: (1) source code
+ * distributions retain the above copyright notice and this paragraph
+ * in its entirety, and (2) distributions including binary code include
+ * the above copyright notice and this paragraph in its entirety in
+ * the documentation or other materials provided with the distribution.
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND
+ * WITHOUT ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, WITHOUT
+ * LIMITATION, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE.
+ */
+
+/*
+ * The map is a per-CPU array of KC_SLOTS counters of packets and
+ * bytes: one for each IPv4 protocol, then one for each IPv6 next
+ * header, then ARP and everything else.  The program finds the slot
+ * from the skb's protocol and, for IP, the byte at the protocol's
+ * offset from the network header, loaded with SKF_NET_OFF so that it
+ * works for any link-layer header; the next header of an IPv6 packet
+ * with extension headers is that of the first one.  Each CPU adds to
+ * its own copy without atomics, and the copies are added up when the
+ * map is read, so the counting doesn't bounce cache lines between CPUs
+ * at high packet rates.
+ *
+ * The socket is made with no protocol, so that nothing is queued on it
+ * before the program is attached, and then bound to the interface for
+ * all protocols; the program returns 0, so no packet is ever queued.
+ *
+ * Neither <pcap.h> nor "netdissect.h" may be included here; see
+ * kernel-counts-bpf.h.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdint.h>
+
+#include "kernel-counts.h"
+
+#ifdef KERNEL_COUNTS_SUPPORTED
+
+#include <errno.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <arpa/inet.h>
+#include <linux/bpf.h>
+#include <linux/filter.h>
+#include <linux/if_ether.h>
+#include <linux/if_packet.h>
+#include <stddef.h>
+#include <unistd.h>
+
+#include "kernel-counts-bpf.h"
+
+#define KC_INSN(code, dst, src, off, imm) \
+	{ (code), (dst), (src), (off), (imm) }
+
+/* The jumps are counted in instructions, from the one after. */
+static const struct bpf_insn kc_prog[] = {
+	/* 0 */	KC_INSN(BPF_ALU64 | BPF_MOV | BPF_X, BPF_REG_6, BPF_REG_1,
+		    0, 0),
+	/* 1 */	KC_INSN(BPF_LDX | BPF_MEM | BPF_W, BPF_REG_8, BPF_REG_6,
+		    offsetof(struct __sk_buff, len), 0),
+	/* 2 */	KC_INSN(BPF_LDX | BPF_MEM | BPF_W, BPF_REG_7, BPF_REG_6,
+		    offsetof(struct __sk_buff, protocol), 0),
+	/* 3 */	KC_INSN(BPF_ALU | BPF_END | BPF_TO_BE, BPF_REG_7, 0, 0, 16),
+	/* 4 */	KC_INSN(BPF_JMP | BPF_JEQ | BPF_K, BPF_REG_7, 0, 6, ETH_P_IP),
+	/* 5 */	KC_INSN(BPF_JMP | BPF_JEQ | BPF_K, BPF_REG_7, 0, 8,
+		    ETH_P_IPV6),
+	/* 6 */	KC_INSN(BPF_JMP | BPF_JEQ | BPF_K, BPF_REG_7, 0, 2, ETH_P_ARP),
+	/* 7 */	KC_INSN(BPF_ALU64 | BPF_MOV | BPF_K, BPF_REG_7, 0, 0,
+		    KC_OTHER),
+	/* 8 */	KC_INSN(BPF_JMP | BPF_JA, 0, 0, 8, 0),
+	/* 9 */	KC_INSN(BPF_ALU64 | BPF_MOV | BPF_K, BPF_REG_7, 0, 0, KC_ARP),
+	/* 10 */ KC_INSN(BPF_JMP | BPF_JA, 0, 0, 6, 0),
+	/* 11: IPv4; r0 is the byte, or the program has returned 0 */
+		KC_INSN(BPF_LD | BPF_ABS | BPF_B, 0, 0, 0, SKF_NET_OFF + 9),
+	/* 12 */ KC_INSN(BPF_ALU64 | BPF_MOV | BPF_X, BPF_REG_7, BPF_REG_0,
+		    0, 0),
+	/* 13 */ KC_INSN(BPF_JMP | BPF_JA, 0, 0, 3, 0),
+	/* 14: IPv6 */
+		KC_INSN(BPF_LD | BPF_ABS | BPF_B, 0, 0, 0, SKF_NET_OFF + 6),
+	/* 15 */ KC_INSN(BPF_ALU64 | BPF_MOV | BPF_X, BPF_REG_7, BPF_REG_0,
+		    0, 0),
+	/* 16 */ KC_INSN(BPF_ALU64 | BPF_ADD | BPF_K, BPF_REG_7, 0, 0,
+		    KC_IP6),
+	/* 17: the slot's key on the stack */
+		KC_INSN(BPF_STX | BPF_MEM | BPF_W, BPF_REG_10, BPF_REG_7, -4,
+		    0),
+	/* 18 */ KC_INSN(BPF_ALU64 | BPF_MOV | BPF_X, BPF_REG_2, BPF_REG_10,
+		    0, 0),
+	/* 19 */ KC_INSN(BPF_ALU64 | BPF_ADD | BPF_K, BPF_REG_2, 0, 0, -4),
+	/* 20, 21: the map, filled in when it's loaded */
+		KC_INSN(BPF_LD | BPF_DW | BPF_IMM, BPF_REG_1,
+		    BPF_PSEUDO_MAP_FD, 0, 0),
+		KC_INSN(0, 0, 0, 0, 0),
+	/* 22 */ KC_INSN(BPF_JMP | BPF_CALL, 0, 0, 0,
+		    BPF_FUNC_map_lookup_elem),
+	/* 23 */ KC_INSN(BPF_JMP | BPF_JEQ | BPF_K, BPF_REG_0, 0, 6, 0),
+	/* 24 */ KC_INSN(BPF_LDX | BPF_MEM | BPF_DW, BPF_REG_1, BPF_REG_0,
+		    offsetof(struct kc_value, packets), 0),
+	/* 25 */ KC_INSN(BPF_ALU64 | BPF_ADD | BPF_K, BPF_REG_1, 0, 0, 1),
+	/* 26 */ KC_INSN(BPF_STX | BPF_MEM | BPF_DW, BPF_REG_0, BPF_REG_1,
+		    offsetof(struct kc_value, packets), 0),
+	/* 27 */ KC_INSN(BPF_LDX | BPF_MEM | BPF_DW, BPF_REG_1, BPF_REG_0,
+		    offsetof(struct kc_value, bytes), 0),
+	/* 28 */ KC_INSN(BPF_ALU64 | BPF_ADD | BPF_X, BPF_REG_1, BPF_REG_8,
+		    0, 0),
+	/* 29 */ KC_INSN(BPF_STX | BPF_MEM | BPF_DW, BPF_REG_0, BPF_REG_1,
+		    offsetof(struct kc_value, bytes), 0),
+	/* 30: keep none of the packet */
+		KC_INSN(BPF_ALU64 | BPF_MOV | BPF_K, BPF_REG_0, 0, 0, 0),
+	/* 31 */ KC_INSN(BPF_JMP | BPF_EXIT, 0, 0, 0, 0)
+};
+#define KC_PROG_LEN	(sizeof(kc_prog) / sizeof(kc_prog[0]))
+#define KC_PROG_MAP	20
+
+static int
+kc_bpf(int cmd, union bpf_attr *attr)
+{
+	return ((int)syscall(__NR_bpf, cmd, attr, sizeof(*attr)));
+}
+
+int
+kc_bpf_open(unsigned int ifindex, int *map_fd, int *prog_fd, int *sock_fd,
+    const char **what)
+{
+	struct bpf_insn prog[KC_PROG_LEN];
+	union bpf_attr attr;
+	struct sockaddr_ll sll;
+
+	*map_fd = *prog_fd = *sock_fd = -1;
+
+	memset(&attr, 0, sizeof(attr));
+	attr.map_type = BPF_MAP_TYPE_PERCPU_ARRAY;
+	attr.key_size = sizeof(uint32_t);
+	attr.value_size = sizeof(struct kc_value);
+	attr.max_entries = KC_SLOTS;
+	if ((*map_fd = kc_bpf(BPF_MAP_CREATE, &attr)) == -1) {
+		*what = "creating the map";
+		return (errno);
+	}
+
+	memcpy(prog, kc_prog, sizeof(prog));
+	prog[KC_PROG_MAP].imm = *map_fd;
+	memset(&attr, 0, sizeof(attr));
+	attr.prog_type = BPF_PROG_TYPE_SOCKET_FILTER;
+	attr.insns = (uint64_t)(uintptr_t)prog;
+	attr.insn_cnt = KC_PROG_LEN;
+	attr.license = (uint64_t)(uintptr_t)"BSD";
+	if ((*prog_fd = kc_bpf(BPF_PROG_LOAD, &attr)) == -1) {
+		*what = "loading the program";
+		return (errno);
+	}
+
+	if ((*sock_fd = socket(AF_PACKET, SOCK_RAW, 0)) == -1) {
+		*what = "socket";
+		return (errno);
+	}
+	if (setsockopt(*sock_fd, SOL_SOCKET, SO_ATTACH_BPF, prog_fd,
+	    sizeof(*prog_fd)) == -1) {
+		*what = "attaching the program";
+		return (errno);
+	}
+	memset(&sll, 0, sizeof(sll));
+	sll.sll_family = AF_PACKET;
+	sll.sll_protocol = htons(ETH_P_ALL);
+	sll.sll_ifindex = (int)ifindex;
+	if (bind(*sock_fd, (struct sockaddr *)&sll, sizeof(sll)) == -1) {
+		*what = "bind";
+		return (errno);
+	}
+	return (0);
+}
+
+int
+kc_bpf_lookup(int map_fd, uint32_t key, struct kc_value *values)
+{
+	union bpf_attr attr;
+
+	memset(&attr, 0, sizeof(attr));
+	attr.map_fd = map_fd;
+	attr.key = (uint64_t)(uintptr_t)&key;
+	attr.value = (uint64_t)(uintptr_t)values;
+	return (kc_bpf(BPF_MAP_LOOKUP_ELEM, &attr));
+}
+#endif /* KERNEL_COUNTS_SUPPORTED */
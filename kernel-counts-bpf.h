@@ -0,0 +1,48 @@
+/*
+ * Copyright (c) 2026 The TCPDUMP project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that: (1) source code
+ * distributions retain the above copyright notice and this paragraph
+ * in its entirety, and (2) distributions including binary code include
+ * the above copyright notice and this paragraph in its entirety in
+ * the documentation or other materials provided with the distribution.
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND
+ * WITHOUT ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, WITHOUT
+ * LIMITATION, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE.
+ */
+
+/*
+ * The eBPF side of --kernel-counts, for kernel-counts.c only.  It's in
+ * a file of its own because <linux/bpf.h> and the pcap headers both
+ * define struct bpf_insn, differently, so kernel-counts-bpf.c includes
+ * neither <pcap.h> nor "netdissect.h", and this uses only plain types.
+ */
+
+/* The map's slots. */
+#define KC_IP		0
+#define KC_IP6		256
+#define KC_ARP		512
+#define KC_OTHER	513
+#define KC_SLOTS	514
+
+struct kc_value {
+	uint64_t packets;
+	uint64_t bytes;
+};
+
+/*
+ * Make the map and the program and attach it to a packet socket bound
+ * to "ifindex", or to all interfaces if it's 0.  Returns 0, or an errno
+ * value with "*what" set to what failed; the descriptors made so far
+ * are left set, and the others -1, for the caller to close.
+ */
+extern int kc_bpf_open(unsigned int, int *, int *, int *, const char **);
+
+/*
+ * Look up a slot; "values" has room for a copy from each possible CPU.
+ * Returns 0, or -1 with errno set.
+ */
+extern int kc_bpf_lookup(int, uint32_t, struct kc_value *);
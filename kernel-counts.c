@@ -0,0 +1,220 @@
+/*
+ * Copyright (c) 2026 The TCPDUMP project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that: (1) source code
+ * distributions retain the above copyright notice and this paragraph
+ * in its entirety, and (2) distributions including binary code include
+ * the above copyright notice and this paragraph in its entirety in
+ * the documentation or other materials provided with the distribution.
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND
+ * WITHOUT ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, WITHOUT
+ * LIMITATION, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE.
+ */
+
+/*
+ * The pcap side of --kernel-counts: the error messages and the names of
+ * the protocols counted.  The eBPF program and map are in
+ * kernel-counts-bpf.c, which can't include the pcap headers.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include "netdissect-stdinc.h"
+
+#include <errno.h>
+#include <pcap.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "kernel-counts.h"
+
+#ifdef KERNEL_COUNTS_SUPPORTED
+
+#include <net/if.h>
+#include <unistd.h>
+
+#include "netdissect.h"
+#include "ipproto.h"
+#include "kernel-counts-bpf.h"
+
+struct kernel_counts {
+	int	map_fd;
+	int	prog_fd;
+	int	sock_fd;
+	u_int	ncpus;			/* possible CPUs */
+	struct kc_value *percpu;	/* a slot's copies, for a lookup */
+	struct kc_value sums[KC_SLOTS];
+	struct kc_value last[KC_SLOTS];	/* as of the last report */
+};
+
+/*
+ * The number of possible CPUs, which is how many copies of a value a
+ * lookup in a per-CPU map returns; it's the highest one listed in
+ * /sys/devices/system/cpu/possible, e.g. "0-63", plus 1.
+ */
+static u_int
+kc_possible_cpus(void)
+{
+	FILE *f;
+	char buf[256], *p;
+	u_long n, most = 0;
+	long conf;
+
+	if ((f = fopen("/sys/devices/system/cpu/possible", "r")) != NULL) {
+		if (fgets(buf, sizeof(buf), f) != NULL) {
+			for (p = buf; *p != '\0'; ) {
+				if (*p < '0' || *p > '9') {
+					p++;
+					continue;
+				}
+				n = strtoul(p, &p, 10);
+				if (n + 1 > most)
+					most = n + 1;
+			}
+		}
+		fclose(f);
+	}
+	conf = sysconf(_SC_NPROCESSORS_CONF);
+	if (conf > 0 && (u_long)conf > most)
+		most = (u_long)conf;
+	return (most != 0 && most <= 65536 ? (u_int)most : 1);
+}
+
+static void
+kc_fail(char *errbuf, const char *what, int err)
+{
+	(void)snprintf(errbuf, PCAP_ERRBUF_SIZE, "--kernel-counts: %s: %s%s",
+	    what, strerror(err),
+	    err == EPERM ? " (CAP_BPF or CAP_SYS_ADMIN is needed)" : "");
+}
+
+/*
+ * Start counting the packets on "device", or on all interfaces if it's
+ * "any".  On failure, NULL is returned with a message in errbuf, which
+ * is PCAP_ERRBUF_SIZE bytes.
+ */
+struct kernel_counts *
+kernel_counts_open(const char *device, char *errbuf)
+{
+	struct kernel_counts *kc;
+	const char *what;
+	u_int ifindex = 0;
+	int err;
+
+	if (strcmp(device, "any") != 0 &&
+	    (ifindex = if_nametoindex(device)) == 0) {
+		kc_fail(errbuf, device, errno);
+		return (NULL);
+	}
+	kc = (struct kernel_counts *)calloc(1, sizeof(*kc));
+	if (kc == NULL) {
+		kc_fail(errbuf, "calloc", errno);
+		return (NULL);
+	}
+	kc->map_fd = kc->prog_fd = kc->sock_fd = -1;
+	kc->ncpus = kc_possible_cpus();
+	kc->percpu = (struct kc_value *)calloc(kc->ncpus,
+	    sizeof(struct kc_value));
+	if (kc->percpu == NULL) {
+		kc_fail(errbuf, "calloc", errno);
+		goto fail;
+	}
+
+	err = kc_bpf_open(ifindex, &kc->map_fd, &kc->prog_fd, &kc->sock_fd,
+	    &what);
+	if (err != 0) {
+		kc_fail(errbuf, what, err);
+		goto fail;
+	}
+	return (kc);
+
+fail:
+	kernel_counts_close(kc);
+	return (NULL);
+}
+
+static void
+kc_read(struct kernel_counts *kc)
+{
+	uint32_t key;
+	u_int cpu;
+
+	for (key = 0; key < KC_SLOTS; key++) {
+		if (kc_bpf_lookup(kc->map_fd, key, kc->percpu) == -1)
+			continue;
+		kc->sums[key].packets = kc->sums[key].bytes = 0;
+		for (cpu = 0; cpu < kc->ncpus; cpu++) {
+			kc->sums[key].packets += kc->percpu[cpu].packets;
+			kc->sums[key].bytes += kc->percpu[cpu].bytes;
+		}
+	}
+}
+
+/*
+ * Call "fn" for all packets and for each protocol counted, with their
+ * counts since the start or, if "since_last" is set, since the last
+ * call that had it set.  Doesn't allocate memory, so it can be used
+ * from a signal handler.
+ */
+void
+kernel_counts_foreach(struct kernel_counts *kc, int since_last,
+    kernel_counts_fn fn, void *arg)
+{
+	struct kc_value v[KC_SLOTS], all;
+	const char *pname;
+	char name[32];
+	u_int i;
+
+	kc_read(kc);
+	all.packets = all.bytes = 0;
+	for (i = 0; i < KC_SLOTS; i++) {
+		v[i] = kc->sums[i];
+		if (since_last) {
+			v[i].packets -= kc->last[i].packets;
+			v[i].bytes -= kc->last[i].bytes;
+			kc->last[i] = kc->sums[i];
+		}
+		all.packets += v[i].packets;
+		all.bytes += v[i].bytes;
+	}
+	(*fn)(arg, NULL, all.packets, all.bytes);
+	for (i = 0; i < KC_SLOTS; i++) {
+		if (v[i].packets == 0)
+			continue;
+		if (i == KC_ARP)
+			(*fn)(arg, "arp", v[i].packets, v[i].bytes);
+		else if (i == KC_OTHER)
+			(*fn)(arg, "other", v[i].packets, v[i].bytes);
+		else {
+			pname = netdb_protoname((uint8_t)(i % 256));
+			if (pname != NULL)
+				(void)snprintf(name, sizeof(name), "%s %s",
+				    i < KC_IP6 ? "ip" : "ip6", pname);
+			else
+				(void)snprintf(name, sizeof(name),
+				    "%s proto %u", i < KC_IP6 ? "ip" : "ip6",
+				    i % 256);
+			(*fn)(arg, name, v[i].packets, v[i].bytes);
+		}
+	}
+}
+
+void
+kernel_counts_close(struct kernel_counts *kc)
+{
+	if (kc->sock_fd != -1)
+		close(kc->sock_fd);
+	if (kc->prog_fd != -1)
+		close(kc->prog_fd);
+	if (kc->map_fd != -1)
+		close(kc->map_fd);
+	free(kc->percpu);
+	free(kc);
+}
+#endif /* KERNEL_COUNTS_SUPPORTED */
@@ -0,0 +1,42 @@
+/*
+ * Copyright (c) 2026 The TCPDUMP project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that: (1) source code
+ * distributions retain the above copyright notice and this paragraph
+ * in its entirety, and (2) distributions including binary code include
+ * the above copyright notice and this paragraph in its entirety in
+ * the documentation or other materials provided with the distribution.
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND
+ * WITHOUT ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, WITHOUT
+ * LIMITATION, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE.
+ */
+
+/*
+ * Counting in the kernel (--kernel-counts): an eBPF socket filter on a
+ * packet socket of its own counts every packet on the interface by IP
+ * protocol, for IPv4 and IPv6, and as ARP or other, in a per-CPU map,
+ * and keeps none of them, so nothing is copied to user space for the
+ * counts; the map is read when a report is made.  The pcap handle is
+ * left alone, for a filtered or sampled part of the traffic.
+ *
+ * The program and map are made with bpf(2) itself, with no libbpf.
+ */
+#if defined(__linux__) && defined(HAVE_LINUX_BPF_H)
+#define KERNEL_COUNTS_SUPPORTED
+
+struct kernel_counts;
+
+/*
+ * Called for each protocol seen, after one for all packets with a
+ * NULL name.
+ */
+typedef void (*kernel_counts_fn)(void *, const char *, uint64_t, uint64_t);
+
+extern struct kernel_counts *kernel_counts_open(const char *, char *);
+extern void kernel_counts_foreach(struct kernel_counts *, int,
+    kernel_counts_fn, void *);
+extern void kernel_counts_close(struct kernel_counts *);
+#endif
@@ -0,0 +1,172 @@
+/*
+ * Copyright (c) 2026 The TCPDUMP project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that: (1) source code
+ * distributions retain the above copyright notice and this paragraph
+ * in its entirety, and (2) distributions including binary code include
+ * the above copyright notice and this paragraph in its entirety in
+ * the documentation or other materials provided with the distribution.
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND
+ * WITHOUT ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, WITHOUT
+ * LIMITATION, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE.
+ */
+
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include "netdissect-stdinc.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "netdissect.h"
+#include "label-binding.h"
+
+#define LABEL_BINDING_CHAINS	4096
+#define LABEL_BINDING_NAMELEN	128
+
+struct label_binding {
+	struct label_binding_stats stats;
+	u_char key[LABEL_BINDING_KEYLEN];
+	u_int keylen;
+	uint32_t hash;			/* of the message that bound it */
+	char name[LABEL_BINDING_NAMELEN];
+	struct label_binding *next;	/* on its hash chain */
+};
+
+static ND_THREAD_LOCAL struct label_binding *label_binding_chains[LABEL_BINDING_CHAINS];
+static ND_THREAD_LOCAL struct label_binding **label_bindings; /* in order made */
+static ND_THREAD_LOCAL u_int label_nbindings, label_maxbindings;
+
+/*
+ * Add "len" bytes at "p" to the FNV-1a hash "h"; start with 2166136261.
+ */
+uint32_t
+label_binding_hash(uint32_t h, const u_char *p, u_int len)
+{
+	while (len-- != 0)
+		h = (h ^ *p++) * 16777619U;
+	return h;
+}
+
+static struct label_binding *
+label_binding_find(netdissect_options *ndo, const u_char *key, u_int keylen,
+                   const char *name)
+{
+	struct label_binding *lb, **lbp;
+
+	if (keylen > LABEL_BINDING_KEYLEN)
+		keylen = LABEL_BINDING_KEYLEN;
+	lbp = &label_binding_chains[label_binding_hash(2166136261U, key,
+	    keylen) % LABEL_BINDING_CHAINS];
+	for (lb = *lbp; lb != NULL; lb = lb->next)
+		if (lb->keylen == keylen && memcmp(lb->key, key, keylen) == 0)
+			return lb;
+	if (name == NULL)
+		return NULL;
+
+	if (label_nbindings == label_maxbindings) {
+		label_maxbindings = label_maxbindings ?
+		    label_maxbindings * 2 : 64;
+		label_bindings = (struct label_binding **)realloc(
+		    label_bindings,
+		    label_maxbindings * sizeof(*label_bindings));
+		if (label_bindings == NULL)
+			(*ndo->ndo_error)(ndo, S_ERR_ND_MEM_ALLOC,
+			    "%s: realloc", __func__);
+	}
+	lb = (struct label_binding *)calloc(1, sizeof(*lb));
+	if (lb == NULL)
+		(*ndo->ndo_error)(ndo, S_ERR_ND_MEM_ALLOC, "%s: calloc",
+		    __func__);
+	memcpy(lb->key, key, keylen);
+	lb->keylen = keylen;
+	strlcpy(lb->name, name, sizeof(lb->name));
+	lb->stats.lbs_name = lb->name;
+	lb->next = *lbp;
+	*lbp = lb;
+	label_bindings[label_nbindings++] = lb;
+	return lb;
+}
+
+/*
+ * "label" was bound to what "key" names, by a message whose hash is
+ * "hash".
+ */
+int
+label_bind(netdissect_options *ndo, const u_char *key, u_int keylen,
+           const char *name, u_int label, uint32_t hash)
+{
+	struct label_binding *lb;
+
+	lb = label_binding_find(ndo, key, keylen, name);
+	if (lb->stats.lbs_bound && lb->hash == hash) {
+		lb->stats.lbs_refreshes++;
+		return 0;
+	}
+	ND_PRINT("\n\t  %s: label %u", lb->name, label);
+	if (lb->stats.lbs_bound) {
+		if (lb->stats.lbs_label != label)
+			ND_PRINT(" (was %u)", lb->stats.lbs_label);
+		else
+			ND_PRINT(", message changed");
+	}
+	lb->stats.lbs_bound = 1;
+	lb->stats.lbs_label = label;
+	lb->stats.lbs_changes++;
+	lb->hash = hash;
+	return 1;
+}
+
+static int
+label_unbind_one(netdissect_options *ndo, struct label_binding *lb)
+{
+	if (!lb->stats.lbs_bound)
+		return 0;
+	ND_PRINT("\n\t  %s: label %u withdrawn", lb->name, lb->stats.lbs_label);
+	lb->stats.lbs_bound = 0;
+	lb->stats.lbs_changes++;
+	return 1;
+}
+
+/*
+ * What "key" names no longer has a label.
+ */
+int
+label_unbind(netdissect_options *ndo, const u_char *key, u_int keylen)
+{
+	struct label_binding *lb;
+
+	lb = label_binding_find(ndo, key, keylen, NULL);
+	return (lb != NULL ? label_unbind_one(ndo, lb) : 0);
+}
+
+/*
+ * Nothing whose key begins with the "keylen" bytes of "key" has a label.
+ */
+int
+label_unbind_all(netdissect_options *ndo, const u_char *key, u_int keylen)
+{
+	u_int i;
+	int changed = 0;
+
+	for (i = 0; i < label_nbindings; i++)
+		if (label_bindings[i]->keylen >= keylen &&
+		    memcmp(label_bindings[i]->key, key, keylen) == 0)
+			changed |= label_unbind_one(ndo, label_bindings[i]);
+	return changed;
+}
+
+void
+label_binding_foreach(label_binding_fn fn, void *arg)
+{
+	u_int i;
+
+	for (i = 0; i < label_nbindings; i++)
+		(*fn)(arg, &label_bindings[i]->stats);
+}
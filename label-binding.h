@@ -0,0 +1,37 @@
+/*
+ * Copyright (c) 2026 The TCPDUMP project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that: (1) source code
+ * distributions retain the above copyright notice and this paragraph
+ * in its entirety, and (2) distributions including binary code include
+ * the above copyright notice and this paragraph in its entirety in
+ * the documentation or other materials provided with the distribution.
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND
+ * WITHOUT ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, WITHOUT
+ * LIMITATION, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE.
+ */
+
+
+#ifndef label_binding_h
+#define label_binding_h
+
+/*
+ * The --label-bindings table of the labels bound to LDP FECs and RSVP-TE
+ * LSPs, keyed by a protocol-specific byte string and named for printing.
+ * The messages that bind a label are hashed, so that refreshes, and
+ * messages sent again, are told from changes without comparing them.
+ * Each of these returns 1, having printed the change, if the message
+ * changed a binding, and 0 if not.
+ */
+#define LABEL_BINDING_KEYLEN	64
+
+extern uint32_t label_binding_hash(uint32_t, const u_char *, u_int);
+extern int label_bind(netdissect_options *, const u_char *, u_int,
+    const char *, u_int, uint32_t);
+extern int label_unbind(netdissect_options *, const u_char *, u_int);
+extern int label_unbind_all(netdissect_options *, const u_char *, u_int);
+
+#endif /* label_binding_h */
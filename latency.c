@@ -0,0 +1,186 @@
+/*
+ * Copyright (c) 2026 The TCPDUMP project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that: (1) source code
+ * distributions retain the above copyright notice and this paragraph
+ * in its entirety, and (2) distributions including binary code include
+ * the above copyright notice and this paragraph in its entirety in
+ * the documentation or other materials provided with the distribution.
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND
+ * WITHOUT ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, WITHOUT
+ * LIMITATION, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include "netdissect-stdinc.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "netdissect.h"
+#include "latency.h"
+
+#define LATENCY_CHAINS	64
+
+static ND_THREAD_LOCAL struct latency_hist *latency_chains[LATENCY_CHAINS];
+static ND_THREAD_LOCAL struct latency_hist **latency_hists;	/* in order made */
+static ND_THREAD_LOCAL u_int latency_nhists, latency_maxhists;
+
+static u_int
+latency_bucket(uint64_t us)
+{
+	u_int e;
+
+	if (us < LATENCY_SUBBUCKETS)
+		return ((u_int)us);
+	for (e = 3; e < LATENCY_MAX_LOG2 && (us >> (e + 1)) != 0; e++)
+		continue;
+	if ((us >> (e + 1)) != 0)
+		return (LATENCY_BUCKETS - 1);
+	return ((e - 2) * LATENCY_SUBBUCKETS + (u_int)((us >> (e - 3)) & 7));
+}
+
+/*
+ * The lowest time, in microseconds, that goes in bucket "b".
+ */
+uint64_t
+latency_bucket_low(u_int b)
+{
+	if (b < LATENCY_SUBBUCKETS)
+		return (b);
+	return ((uint64_t)(LATENCY_SUBBUCKETS + b % LATENCY_SUBBUCKETS) <<
+	    (b / LATENCY_SUBBUCKETS - 1));
+}
+
+static struct latency_hist *
+latency_lookup(netdissect_options *ndo, const char *proto, const char *what)
+{
+	struct latency_hist *lh, **lhp;
+	uint32_t h = 2166136261U;
+	const char *p;
+
+	for (p = proto; *p != '\0'; p++)
+		h = (h ^ (u_char)*p) * 16777619U;
+	for (p = what; *p != '\0'; p++)
+		h = (h ^ (u_char)*p) * 16777619U;
+	lhp = &latency_chains[h % LATENCY_CHAINS];
+	for (lh = *lhp; lh != NULL; lh = lh->lh_next)
+		if (strcmp(lh->lh_proto, proto) == 0 &&
+		    strncmp(lh->lh_what, what, sizeof(lh->lh_what) - 1) == 0)
+			return (lh);
+
+	if (latency_nhists == latency_maxhists) {
+		latency_maxhists = latency_maxhists ? latency_maxhists * 2 : 32;
+		latency_hists = (struct latency_hist **)realloc(latency_hists,
+		    latency_maxhists * sizeof(*latency_hists));
+		if (latency_hists == NULL)
+			(*ndo->ndo_error)(ndo, S_ERR_ND_MEM_ALLOC,
+			    "%s: realloc", __func__);
+	}
+	lh = (struct latency_hist *)calloc(1, sizeof(*lh));
+	if (lh == NULL)
+		(*ndo->ndo_error)(ndo, S_ERR_ND_MEM_ALLOC, "%s: calloc",
+		    __func__);
+	lh->lh_proto = proto;
+	strlcpy(lh->lh_what, what, sizeof(lh->lh_what));
+	lh->lh_next = *lhp;
+	*lhp = lh;
+	latency_hists[latency_nhists++] = lh;
+	return (lh);
+}
+
+/*
+ * Return the time, in microseconds, from "then" to the packet being
+ * looked at.
+ */
+uint64_t
+latency_elapsed(netdissect_options *ndo, nd_ts_t then)
+{
+	return (ND_TS_ELAPSED_US(then, ndo->ndo_packet_ts));
+}
+
+/*
+ * Count a reply, to "what" over the protocol "proto", to a request made
+ * at "then".  "proto" must be a string constant.  Returns the time
+ * the reply took, in microseconds.
+ */
+uint64_t
+latency_record(netdissect_options *ndo, const char *proto, const char *what,
+    nd_ts_t then)
+{
+	struct latency_hist *lh;
+	uint64_t us;
+
+	us = latency_elapsed(ndo, then);
+	lh = latency_lookup(ndo, proto, what);
+	if (lh->lh_count == 0 || us < lh->lh_min_us)
+		lh->lh_min_us = us;
+	if (us > lh->lh_max_us)
+		lh->lh_max_us = us;
+	lh->lh_total_us += us;
+	lh->lh_count++;
+	lh->lh_buckets[latency_bucket(us)]++;
+	return (us);
+}
+
+/*
+ * Return the time, in microseconds, that "pct" percent of the replies
+ * counted in "lh" took at most, to within the size of a bucket.
+ */
+uint64_t
+latency_percentile(const struct latency_hist *lh, u_int pct)
+{
+	uint64_t want, seen = 0, t;
+	u_int b;
+
+	want = (lh->lh_count * pct + 99) / 100;
+	if (want == 0)
+		want = 1;
+	for (b = 0; b < LATENCY_BUCKETS; b++) {
+		seen += lh->lh_buckets[b];
+		if (seen >= want)
+			break;
+	}
+	if (b + 1 >= LATENCY_BUCKETS)
+		return (lh->lh_max_us);
+	/* The top of the bucket, but no more than the most seen. */
+	t = latency_bucket_low(b + 1) - 1;
+	return (t < lh->lh_max_us ? t : lh->lh_max_us);
+}
+
+/*
+ * Call "fn" for each histogram of this thread that has had replies
+ * counted, in the order they were first counted.
+ */
+void
+latency_foreach(latency_fn fn, void *arg)
+{
+	u_int i;
+
+	for (i = 0; i < latency_nhists; i++)
+		if (latency_hists[i]->lh_count != 0)
+			(*fn)(arg, latency_hists[i]);
+}
+
+/*
+ * Empty this thread's histograms, as for a new reporting interval.
+ */
+void
+latency_reset(void)
+{
+	struct latency_hist *lh;
+	u_int i;
+
+	for (i = 0; i < latency_nhists; i++) {
+		lh = latency_hists[i];
+		lh->lh_count = lh->lh_total_us = 0;
+		lh->lh_min_us = lh->lh_max_us = 0;
+		memset(lh->lh_buckets, 0, sizeof(lh->lh_buckets));
+	}
+}
@@ -0,0 +1,58 @@
+/*
+ * Copyright (c) 2026 The TCPDUMP project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that: (1) source code
+ * distributions retain the above copyright notice and this paragraph
+ * in its entirety, and (2) distributions including binary code include
+ * the above copyright notice and this paragraph in its entirety in
+ * the documentation or other materials provided with the distribution.
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND
+ * WITHOUT ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, WITHOUT
+ * LIMITATION, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE.
+ */
+
+#ifndef latency_h
+#define latency_h
+
+/*
+ * Response time histograms, for printers that can match replies to
+ * their requests, by protocol and by what was asked for, e.g. "nfs"
+ * and "v3 getattr" or "domain" and "AAAA".
+ *
+ * The times are in microseconds, from the time stamp of the request to
+ * that of the reply, in buckets that are exact up to 8 microseconds
+ * and then LATENCY_SUBBUCKETS to each power of two, so within 12.5% of
+ * the time, up to 2^LATENCY_MAX_LOG2 microseconds (about 25 days).
+ * The histograms are per thread, so counting takes no locks.
+ */
+#define LATENCY_SUBBUCKETS	8
+#define LATENCY_MAX_LOG2	41
+#define LATENCY_BUCKETS	\
+	((LATENCY_MAX_LOG2 - 1) * LATENCY_SUBBUCKETS)
+#define LATENCY_WHAT_LEN	32
+
+struct latency_hist {
+	const char *lh_proto;
+	char lh_what[LATENCY_WHAT_LEN];
+	uint64_t lh_count;
+	uint64_t lh_total_us;
+	uint64_t lh_min_us;
+	uint64_t lh_max_us;
+	uint64_t lh_buckets[LATENCY_BUCKETS];
+	struct latency_hist *lh_next;	/* on its hash chain */
+};
+
+typedef void (*latency_fn)(void *, const struct latency_hist *);
+
+extern uint64_t latency_elapsed(netdissect_options *, nd_ts_t);
+extern uint64_t latency_record(netdissect_options *, const char *,
+    const char *, nd_ts_t);
+extern uint64_t latency_bucket_low(u_int);
+extern uint64_t latency_percentile(const struct latency_hist *, u_int);
+extern void latency_foreach(latency_fn, void *);
+extern void latency_reset(void);
+
+#endif /* latency_h */
@@ -0,0 +1,220 @@
+/*
+ * Copyright (c) 2026 The TCPDUMP project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that: (1) source code
+ * distributions retain the above copyright notice and this paragraph
+ * in its entirety, and (2) distributions including binary code include
+ * the above copyright notice and this paragraph in its entirety in
+ * the documentation or other materials provided with the distribution.
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND
+ * WITHOUT ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, WITHOUT
+ * LIMITATION, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include "netdissect-stdinc.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "netdissect.h"
+#include "lsdb.h"
+
+#define LSDB_CHAINS	256
+
+struct lsdb_entry {
+	u_int le_proto;
+	u_char le_key[LSDB_KEY_LEN];
+	uint32_t le_seq;
+	struct lsdb_part *le_parts;
+	u_int le_nparts, le_maxparts;
+	struct lsdb_entry *le_next;	/* on its hash chain */
+};
+
+static ND_THREAD_LOCAL struct lsdb_entry *lsdb_chains[LSDB_CHAINS];
+static ND_THREAD_LOCAL struct lsdb_counts lsdb_count[LSDB_PROTOS];
+
+/* The parts of the copy being looked at, and those it removed */
+static ND_THREAD_LOCAL struct lsdb_part *lsdb_new, *lsdb_gone;
+static ND_THREAD_LOCAL u_int lsdb_nnew, lsdb_ngone, lsdb_maxparts;
+
+/*
+ * Start on the parts of a new copy.
+ */
+void
+lsdb_begin(void)
+{
+	lsdb_nnew = lsdb_ngone = 0;
+}
+
+/*
+ * Add the part of type "type" in the "len" bytes at "p" to the copy
+ * being looked at.  Return 1, or 0 if they weren't all captured, in
+ * which case the copy can't be compared.
+ */
+int
+lsdb_add_part(netdissect_options *ndo, u_int type, const u_char *p,
+    u_int len)
+{
+	struct lsdb_part *lp;
+	uint64_t h = 14695981039346656037ULL;
+	u_int i;
+
+	if (!ND_TTEST_LEN(p, len))
+		return (0);
+	if (lsdb_nnew == lsdb_maxparts) {
+		lsdb_maxparts = lsdb_maxparts ? lsdb_maxparts * 2 : 64;
+		lsdb_new = (struct lsdb_part *)realloc(lsdb_new,
+		    lsdb_maxparts * sizeof(*lsdb_new));
+		lsdb_gone = (struct lsdb_part *)realloc(lsdb_gone,
+		    lsdb_maxparts * sizeof(*lsdb_gone));
+		if (lsdb_new == NULL || lsdb_gone == NULL)
+			(*ndo->ndo_error)(ndo, S_ERR_ND_MEM_ALLOC,
+			    "%s: realloc", __func__);
+	}
+	h = (h ^ type) * 1099511628211ULL;
+	for (i = 0; i < len; i++)
+		h = (h ^ p[i]) * 1099511628211ULL;
+	lp = &lsdb_new[lsdb_nnew++];
+	lp->lp_hash = h;
+	lp->lp_type = type;
+	lp->lp_len = len;
+	lp->lp_changed = 1;
+	return (1);
+}
+
+/*
+ * Return 1 if "seq" is a later sequence number than "last" for "proto":
+ * IS-IS sequence numbers are unsigned, OSPF ones signed.
+ */
+static int
+lsdb_later(u_int proto, uint32_t seq, uint32_t last)
+{
+	if (proto == LSDB_OSPF)
+		return ((int32_t)seq > (int32_t)last);
+	return (seq > last);
+}
+
+/*
+ * Look up the copy of the LSP or LSA "key" of "proto", with sequence
+ * number "seq" and the parts added since lsdb_begin(), and return what
+ * it is to the last one, whose sequence number is put in "*lastseq".
+ * Unless it's older, it becomes the last one.  Afterwards lsdb_parts()
+ * gives which of its parts changed and lsdb_removed() those it removed.
+ */
+int
+lsdb_update(netdissect_options *ndo, u_int proto, const u_char *key,
+    uint32_t seq, uint32_t *lastseq)
+{
+	struct lsdb_entry *le, **lep;
+	uint32_t h = 2166136261U;
+	u_int i, j, changed;
+	int verdict;
+
+	h = (h ^ proto) * 16777619U;
+	for (i = 0; i < LSDB_KEY_LEN; i++)
+		h = (h ^ key[i]) * 16777619U;
+	lep = &lsdb_chains[h % LSDB_CHAINS];
+	for (le = *lep; le != NULL; le = le->le_next)
+		if (le->le_proto == proto &&
+		    memcmp(le->le_key, key, LSDB_KEY_LEN) == 0)
+			break;
+
+	if (le == NULL) {
+		le = (struct lsdb_entry *)calloc(1, sizeof(*le));
+		if (le == NULL)
+			(*ndo->ndo_error)(ndo, S_ERR_ND_MEM_ALLOC,
+			    "%s: calloc", __func__);
+		le->le_proto = proto;
+		memcpy(le->le_key, key, LSDB_KEY_LEN);
+		le->le_next = *lep;
+		*lep = le;
+		lsdb_count[proto].lc_entries++;
+		*lastseq = seq;
+		verdict = LSDB_NEW;
+	} else {
+		*lastseq = le->le_seq;
+		if (lsdb_later(proto, le->le_seq, seq)) {
+			lsdb_count[proto].lc_copies[LSDB_OLDER]++;
+			return (LSDB_OLDER);
+		}
+
+		/* Match the parts up, allowing for repeats of a part. */
+		for (j = 0; j < le->le_nparts; j++)
+			le->le_parts[j].lp_changed = 1;
+		changed = 0;
+		for (i = 0; i < lsdb_nnew; i++) {
+			for (j = 0; j < le->le_nparts; j++)
+				if (le->le_parts[j].lp_changed &&
+				    le->le_parts[j].lp_hash ==
+				    lsdb_new[i].lp_hash)
+					break;
+			if (j < le->le_nparts) {
+				le->le_parts[j].lp_changed = 0;
+				lsdb_new[i].lp_changed = 0;
+			} else
+				changed++;
+		}
+		for (j = 0; j < le->le_nparts; j++)
+			if (le->le_parts[j].lp_changed)
+				lsdb_gone[lsdb_ngone++] = le->le_parts[j];
+		if (changed != 0 || lsdb_ngone != 0)
+			verdict = LSDB_CHANGE;
+		else if (seq == le->le_seq)
+			verdict = LSDB_REPEAT;
+		else
+			verdict = LSDB_REFRESH;
+	}
+
+	le->le_seq = seq;
+	if (lsdb_nnew > le->le_maxparts) {
+		le->le_maxparts = lsdb_nnew;
+		le->le_parts = (struct lsdb_part *)realloc(le->le_parts,
+		    le->le_maxparts * sizeof(*le->le_parts));
+		if (le->le_parts == NULL)
+			(*ndo->ndo_error)(ndo, S_ERR_ND_MEM_ALLOC,
+			    "%s: realloc", __func__);
+	}
+	if (lsdb_nnew != 0)
+		memcpy(le->le_parts, lsdb_new, lsdb_nnew * sizeof(*lsdb_new));
+	le->le_nparts = lsdb_nnew;
+	lsdb_count[proto].lc_copies[verdict]++;
+	return (verdict);
+}
+
+/*
+ * Return the parts of the copy last given to lsdb_update(), and put how
+ * many there are in "*np".
+ */
+const struct lsdb_part *
+lsdb_parts(u_int *np)
+{
+	*np = lsdb_nnew;
+	return (lsdb_new);
+}
+
+/*
+ * Return the parts the copy last given to lsdb_update() removed, and
+ * put how many there are in "*np".
+ */
+const struct lsdb_part *
+lsdb_removed(u_int *np)
+{
+	*np = lsdb_ngone;
+	return (lsdb_gone);
+}
+
+/*
+ * Get this thread's counts for "proto".
+ */
+void
+lsdb_counts(u_int proto, struct lsdb_counts *lc)
+{
+	*lc = lsdb_count[proto];
+}
@@ -0,0 +1,65 @@
+/*
+ * Copyright (c) 2026 The TCPDUMP project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that: (1) source code
+ * distributions retain the above copyright notice and this paragraph
+ * in its entirety, and (2) distributions including binary code include
+ * the above copyright notice and this paragraph in its entirety in
+ * the documentation or other materials provided with the distribution.
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND
+ * WITHOUT ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, WITHOUT
+ * LIMITATION, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE.
+ */
+
+#ifndef lsdb_h
+#define lsdb_h
+
+/*
+ * A link-state database, for --lsdb: the last copy seen of each IS-IS
+ * LSP, by level and LSP ID, and of each OSPF LSA, by LS type, LS ID
+ * and advertising router, kept as the sequence number and the hashes
+ * of its parts (the TLVs of an LSP, the body of an LSA).  A copy can
+ * then be told to repeat the last one, to be older, to refresh it with
+ * nothing but a new sequence number, or to change it, and for a change
+ * which parts were added and which removed.  The database is per
+ * thread, so updating it takes no locks.
+ */
+#define LSDB_ISIS	0
+#define LSDB_OSPF	1
+#define LSDB_PROTOS	2
+
+#define LSDB_KEY_LEN	9
+
+/* What a copy is to the last one */
+#define LSDB_NEW	0
+#define LSDB_REPEAT	1
+#define LSDB_OLDER	2
+#define LSDB_REFRESH	3
+#define LSDB_CHANGE	4
+#define LSDB_VERDICTS	5
+
+struct lsdb_part {
+	uint64_t lp_hash;
+	u_int lp_type;
+	u_int lp_len;
+	int lp_changed;		/* not in the last copy */
+};
+
+struct lsdb_counts {
+	uint64_t lc_entries;
+	uint64_t lc_copies[LSDB_VERDICTS];
+};
+
+extern void lsdb_begin(void);
+extern int lsdb_add_part(netdissect_options *, u_int, const u_char *,
+    u_int);
+extern int lsdb_update(netdissect_options *, u_int, const u_char *,
+    uint32_t, uint32_t *);
+extern const struct lsdb_part *lsdb_parts(u_int *);
+extern const struct lsdb_part *lsdb_removed(u_int *);
+extern void lsdb_counts(u_int, struct lsdb_counts *);
+
+#endif /* lsdb_h */
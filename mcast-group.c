@@ -0,0 +1,305 @@
+/*
+ * Copyright (c) 2026 The TCPDUMP project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that: (1) source code
+ * distributions retain the above copyright notice and this paragraph
+ * in its entirety, and (2) distributions including binary code include
+ * the above copyright notice and this paragraph in its entirety in
+ * the documentation or other materials provided with the distribution.
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND
+ * WITHOUT ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, WITHOUT
+ * LIMITATION, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE.
+ */
+
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include "netdissect-stdinc.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "netdissect.h"
+#include "addrtostr.h"
+#include "latency.h"
+#include "mcast-group.h"
+
+#define MCAST_CHAINS		4096
+#define MCAST_IFNAME_LEN	16
+
+struct mcast_key {
+	int af;
+	u_char group[16];
+	u_char source[16];		/* all zero for (*,G) */
+};
+
+struct mcast_group {
+	struct mcast_group_stats stats;
+	struct mcast_key key;
+	nd_ts_t first_ts;		/* when it got its first member */
+	nd_ts_t last_ts;		/* when it lost its last one */
+	int join_pending;		/* "first_ts" not yet matched */
+	int prune_pending;		/* "last_ts" not yet matched */
+	char name[2 * INET6_ADDRSTRLEN + 4];
+	struct mcast_group *next;	/* on its hash chain */
+};
+
+/* A host that has reported for a group, on an interface. */
+struct mcast_member {
+	const struct mcast_group *group;
+	char ifname[MCAST_IFNAME_LEN];
+	u_char host[16];
+	int active;
+	struct mcast_member *next;	/* on its hash chain */
+};
+
+static ND_THREAD_LOCAL struct mcast_group *mcast_group_chains[MCAST_CHAINS];
+static ND_THREAD_LOCAL struct mcast_group **mcast_groups; /* in order made */
+static ND_THREAD_LOCAL u_int mcast_ngroups, mcast_maxgroups;
+static ND_THREAD_LOCAL struct mcast_member *mcast_member_chains[MCAST_CHAINS];
+
+static uint32_t
+mcast_hash(uint32_t h, const void *p, size_t len)
+{
+	const u_char *cp = (const u_char *)p;
+
+	while (len-- != 0)
+		h = (h ^ *cp++) * 16777619U;
+	return h;
+}
+
+static struct mcast_group *
+mcast_group_find(netdissect_options *ndo, int af, const u_char *group,
+                 const u_char *source)
+{
+	struct mcast_group *mg, **mgp;
+	struct mcast_key k;
+	char gbuf[INET6_ADDRSTRLEN], sbuf[INET6_ADDRSTRLEN];
+	size_t alen;
+
+	alen = af == AF_INET ? 4 : 16;
+	memset(&k, 0, sizeof(k));
+	k.af = af;
+	memcpy(k.group, group, alen);
+	if (source != NULL)
+		memcpy(k.source, source, alen);
+	mgp = &mcast_group_chains[mcast_hash(2166136261U, &k, sizeof(k)) %
+	    MCAST_CHAINS];
+	for (mg = *mgp; mg != NULL; mg = mg->next)
+		if (memcmp(&mg->key, &k, sizeof(k)) == 0)
+			return mg;
+
+	if (mcast_ngroups == mcast_maxgroups) {
+		mcast_maxgroups = mcast_maxgroups ? mcast_maxgroups * 2 : 64;
+		mcast_groups = (struct mcast_group **)realloc(mcast_groups,
+		    mcast_maxgroups * sizeof(*mcast_groups));
+		if (mcast_groups == NULL)
+			(*ndo->ndo_error)(ndo, S_ERR_ND_MEM_ALLOC,
+			    "%s: realloc", __func__);
+	}
+	mg = (struct mcast_group *)calloc(1, sizeof(*mg));
+	if (mg == NULL)
+		(*ndo->ndo_error)(ndo, S_ERR_ND_MEM_ALLOC, "%s: calloc",
+		    __func__);
+	mg->key = k;
+	if (af == AF_INET) {
+		addrtostr(k.group, gbuf, sizeof(gbuf));
+		addrtostr(k.source, sbuf, sizeof(sbuf));
+	} else {
+		addrtostr6(k.group, gbuf, sizeof(gbuf));
+		addrtostr6(k.source, sbuf, sizeof(sbuf));
+	}
+	snprintf(mg->name, sizeof(mg->name), "(%s,%s)",
+	    source != NULL ? sbuf : "*", gbuf);
+	mg->stats.mgs_group = mg->name;
+	mg->next = *mgp;
+	*mgp = mg;
+	mcast_groups[mcast_ngroups++] = mg;
+	return mg;
+}
+
+static struct mcast_member *
+mcast_member_find(netdissect_options *ndo, const struct mcast_group *mg,
+                  const u_char *host)
+{
+	struct mcast_member *mm, **mmp;
+	char ifname[MCAST_IFNAME_LEN];
+	size_t alen;
+	uint32_t h;
+
+	alen = mg->key.af == AF_INET ? 4 : 16;
+	memset(ifname, 0, sizeof(ifname));
+	if (ndo->ndo_ifname != NULL)
+		strncpy(ifname, ndo->ndo_ifname, sizeof(ifname) - 1);
+	h = mcast_hash(2166136261U, &mg, sizeof(mg));
+	h = mcast_hash(h, ifname, sizeof(ifname));
+	h = mcast_hash(h, host, alen);
+	mmp = &mcast_member_chains[h % MCAST_CHAINS];
+	for (mm = *mmp; mm != NULL; mm = mm->next)
+		if (mm->group == mg &&
+		    memcmp(mm->ifname, ifname, sizeof(ifname)) == 0 &&
+		    memcmp(mm->host, host, alen) == 0)
+			return mm;
+
+	mm = (struct mcast_member *)calloc(1, sizeof(*mm));
+	if (mm == NULL)
+		(*ndo->ndo_error)(ndo, S_ERR_ND_MEM_ALLOC, "%s: calloc",
+		    __func__);
+	mm->group = mg;
+	memcpy(mm->ifname, ifname, sizeof(ifname));
+	memcpy(mm->host, host, alen);
+	mm->next = *mmp;
+	*mmp = mm;
+	return mm;
+}
+
+static void
+mcast_host_print(netdissect_options *ndo, const struct mcast_member *mm)
+{
+	char buf[INET6_ADDRSTRLEN];
+
+	if (mm->group->key.af == AF_INET)
+		addrtostr(mm->host, buf, sizeof(buf));
+	else
+		addrtostr6(mm->host, buf, sizeof(buf));
+	ND_PRINT("%s", buf);
+	if (mm->ifname[0] != '\0')
+		ND_PRINT(" on %s", mm->ifname);
+}
+
+/*
+ * The host at "host" (in the packet) reported that it has joined, or
+ * left, "group" from "source", or from any source if "source" is NULL.
+ */
+int
+mcast_report(netdissect_options *ndo, int af, const u_char *group,
+             const u_char *source, const u_char *host, int join)
+{
+	struct mcast_group *mg;
+	struct mcast_member *mm;
+
+	mg = mcast_group_find(ndo, af, group, source);
+	mg->stats.mgs_reports++;
+	mm = mcast_member_find(ndo, mg, host);
+	if (mm->active == join)
+		return 0;
+	mm->active = join;
+	ND_PRINT("\n\t  %s %s by ", mg->name, join ? "joined" : "left");
+	mcast_host_print(ndo, mm);
+	if (join) {
+		mg->stats.mgs_joins++;
+		if (mg->stats.mgs_members++ == 0 && !mg->stats.mgs_upstream) {
+			mg->first_ts = ndo->ndo_packet_ts;
+			mg->join_pending = 1;
+		}
+		mg->prune_pending = 0;
+	} else {
+		mg->stats.mgs_leaves++;
+		if (--mg->stats.mgs_members == 0 && mg->stats.mgs_upstream) {
+			mg->last_ts = ndo->ndo_packet_ts;
+			mg->prune_pending = 1;
+		}
+		mg->join_pending = 0;
+	}
+	ND_PRINT(", %u member%s", mg->stats.mgs_members,
+	    PLURAL_SUFFIX(mg->stats.mgs_members));
+	return 1;
+}
+
+/*
+ * Apply an IGMPv3 or MLDv2 group record of type "type", for "group" with
+ * the "nsrcs" sources at "sources", from "host"; returns 1 if that
+ * changed any state.
+ */
+int
+mcast_record(netdissect_options *ndo, int af, u_int type,
+             const u_char *group, const u_char *sources, u_int nsrcs,
+             const u_char *host)
+{
+	u_int alen, i;
+	int changed = 0;
+
+	alen = af == AF_INET ? 4 : 16;
+	switch (type) {
+	case 1:		/* MODE_IS_INCLUDE */
+	case 5:		/* ALLOW_NEW_SOURCES */
+		if (type == 1 && nsrcs == 0)
+			changed |= mcast_report(ndo, af, group, NULL, host, 0);
+		for (i = 0; i < nsrcs; i++)
+			changed |= mcast_report(ndo, af, group,
+			    sources + i * alen, host, 1);
+		break;
+	case 2:		/* MODE_IS_EXCLUDE */
+	case 4:		/* CHANGE_TO_EXCLUDE_MODE */
+		changed |= mcast_report(ndo, af, group, NULL, host, 1);
+		break;
+	case 3:		/* CHANGE_TO_INCLUDE_MODE */
+		changed |= mcast_report(ndo, af, group, NULL, host, 0);
+		for (i = 0; i < nsrcs; i++)
+			changed |= mcast_report(ndo, af, group,
+			    sources + i * alen, host, 1);
+		break;
+	case 6:		/* BLOCK_OLD_SOURCES */
+		for (i = 0; i < nsrcs; i++)
+			changed |= mcast_report(ndo, af, group,
+			    sources + i * alen, host, 0);
+		break;
+	default:
+		break;
+	}
+	return changed;
+}
+
+/*
+ * A PIM router joined, or pruned, "group" from "source", or from the
+ * RP if "source" is NULL; the time since the first report for it, or
+ * the leave of its last member, is the join or leave latency.
+ */
+int
+mcast_pim(netdissect_options *ndo, int af, const u_char *group,
+          const u_char *source, int join)
+{
+	struct mcast_group *mg;
+	uint64_t us;
+
+	mg = mcast_group_find(ndo, af, group, source);
+	if (join)
+		mg->stats.mgs_pim_joins++;
+	else
+		mg->stats.mgs_pim_prunes++;
+	if (mg->stats.mgs_upstream == join)
+		return 0;
+	mg->stats.mgs_upstream = join;
+	ND_PRINT("\n\t  %s %s upstream", mg->name, join ? "joined" : "pruned");
+	if (join && mg->join_pending) {
+		us = latency_elapsed(ndo, mg->first_ts);
+		ND_PRINT(", %" PRIu64 ".%03u ms after the first report",
+		    us / 1000, (u_int)(us % 1000));
+		if (ndo->ndo_latency)
+			latency_record(ndo, "mcast", "join", mg->first_ts);
+	} else if (!join && mg->prune_pending) {
+		us = latency_elapsed(ndo, mg->last_ts);
+		ND_PRINT(", %" PRIu64 ".%03u ms after the last leave",
+		    us / 1000, (u_int)(us % 1000));
+		if (ndo->ndo_latency)
+			latency_record(ndo, "mcast", "leave", mg->last_ts);
+	}
+	mg->join_pending = 0;
+	mg->prune_pending = 0;
+	return 1;
+}
+
+void
+mcast_group_foreach(mcast_group_fn fn, void *arg)
+{
+	u_int i;
+
+	for (i = 0; i < mcast_ngroups; i++)
+		(*fn)(arg, &mcast_groups[i]->stats);
+}
@@ -0,0 +1,34 @@
+/*
+ * Copyright (c) 2026 The TCPDUMP project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that: (1) source code
+ * distributions retain the above copyright notice and this paragraph
+ * in its entirety, and (2) distributions including binary code include
+ * the above copyright notice and this paragraph in its entirety in
+ * the documentation or other materials provided with the distribution.
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND
+ * WITHOUT ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, WITHOUT
+ * LIMITATION, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE.
+ */
+
+
+#ifndef mcast_group_h
+#define mcast_group_h
+
+/*
+ * The --mcast-groups table of (S,G) and (*,G) state, learned from IGMP
+ * and MLD reports and PIM Join/Prune messages.  Each of these returns 1,
+ * having printed what changed, if the message changed the state, and 0
+ * if it only refreshed it; "source" is NULL for (*,G).
+ */
+extern int mcast_report(netdissect_options *, int, const u_char *,
+    const u_char *, const u_char *, int);
+extern int mcast_record(netdissect_options *, int, u_int, const u_char *,
+    const u_char *, u_int, const u_char *);
+extern int mcast_pim(netdissect_options *, int, const u_char *,
+    const u_char *, int);
+
+#endif /* mcast_group_h */
@@ -0,0 +1,331 @@
+/*
+ * Copyright (c) 2026 The TCPDUMP project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that: (1) source code
+ * distributions retain the above copyright notice and this paragraph
+ * in its entirety, and (2) distributions including binary code include
+ * the above copyright notice and this paragraph in its entirety in
+ * the documentation or other materials provided with the distribution.
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND
+ * WITHOUT ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, WITHOUT
+ * LIMITATION, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE.
+ */
+
+
+/*
+ * One connection is served at a time, and a request is given two
+ * seconds to arrive, so that a client can't tie up the thread for long;
+ * an HTTP server in front of it is needed for anything fancier.  The
+ * thread is run at a low priority where that can be set for a thread,
+ * as its work is the least urgent of the capture's.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include "netdissect-stdinc.h"
+
+#include "metrics.h"
+
+#ifdef METRICS_SUPPORTED
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+#include <netdb.h>
+
+#include <errno.h>
+#include <pcap.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "funcattrs.h"
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL	0
+#endif
+
+#define METRICS_TIMEOUT		2	/* seconds to wait for a request */
+#define METRICS_MAXREQUEST	4096
+#define METRICS_CONTENT_TYPE \
+	"application/openmetrics-text; version=1.0.0; charset=utf-8"
+
+struct metrics_server {
+	int	fd;
+};
+
+struct metrics_page {
+	char	*buf;
+	size_t	len;
+	size_t	size;
+	int	failed;		/* out of memory */
+};
+
+/*
+ * Listen on "spec", which is [address:]port, the address being an IPv6
+ * one in brackets or a host name or IPv4 address; without one, only
+ * connections from the host itself are taken.  Returns NULL, with a
+ * message in ebuf, if that fails.
+ */
+struct metrics_server *
+metrics_open(const char *spec, char *ebuf)
+{
+	struct metrics_server *ms;
+	struct addrinfo hints, *res, *ai;
+	char *host, *port, *p;
+	int fd, on = 1, err;
+
+	if ((host = strdup(spec)) == NULL) {
+		snprintf(ebuf, PCAP_ERRBUF_SIZE, "metrics_open: malloc");
+		return (NULL);
+	}
+	if ((p = strrchr(host, ':')) != NULL) {
+		*p = '\0';
+		port = p + 1;
+		if (host[0] == '[' && p > host && p[-1] == ']') {
+			p[-1] = '\0';
+			memmove(host, host + 1, strlen(host + 1) + 1);
+		}
+	} else {
+		port = host;
+		host = NULL;
+	}
+	memset(&hints, 0, sizeof(hints));
+	hints.ai_family = AF_UNSPEC;
+	hints.ai_socktype = SOCK_STREAM;
+	hints.ai_flags = AI_PASSIVE | AI_NUMERICSERV;
+	err = getaddrinfo(host != NULL ? host : "localhost", port, &hints,
+	    &res);
+	if (err != 0) {
+		snprintf(ebuf, PCAP_ERRBUF_SIZE, "%s: %s", spec,
+		    gai_strerror(err));
+		free(host != NULL ? host : port);
+		return (NULL);
+	}
+	free(host != NULL ? host : port);
+	fd = -1;
+	for (ai = res; ai != NULL; ai = ai->ai_next) {
+		fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+		if (fd == -1)
+			continue;
+		(void)setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on,
+		    sizeof(on));
+		if (bind(fd, ai->ai_addr, ai->ai_addrlen) == 0 &&
+		    listen(fd, 8) == 0)
+			break;
+		close(fd);
+		fd = -1;
+	}
+	if (fd == -1)
+		snprintf(ebuf, PCAP_ERRBUF_SIZE, "%s: %s", spec,
+		    pcap_strerror(errno));
+	freeaddrinfo(res);
+	if (fd == -1)
+		return (NULL);
+	ms = (struct metrics_server *)calloc(1, sizeof(*ms));
+	if (ms == NULL) {
+		snprintf(ebuf, PCAP_ERRBUF_SIZE, "metrics_open: malloc");
+		close(fd);
+		return (NULL);
+	}
+	ms->fd = fd;
+	return (ms);
+}
+
+static void PRINTFLIKE(2, 3)
+metrics_printf(struct metrics_page *mp, const char *fmt, ...)
+{
+	va_list ap;
+	size_t nsize;
+	char *nbuf;
+	int n;
+
+	for (;;) {
+		if (mp->failed)
+			return;
+		va_start(ap, fmt);
+		n = vsnprintf(mp->buf + mp->len, mp->size - mp->len, fmt, ap);
+		va_end(ap);
+		if (n < 0) {
+			mp->failed = 1;
+			return;
+		}
+		if ((size_t)n < mp->size - mp->len) {
+			mp->len += n;
+			return;
+		}
+		nsize = mp->size * 2 + n;
+		if ((nbuf = (char *)realloc(mp->buf, nsize)) == NULL) {
+			mp->failed = 1;
+			return;
+		}
+		mp->buf = nbuf;
+		mp->size = nsize;
+	}
+}
+
+/*
+ * Start the metric family "name", of type "type" ("counter" or
+ * "gauge"), described by "help".
+ */
+void
+metrics_family(struct metrics_page *mp, const char *name, const char *type,
+    const char *help)
+{
+	metrics_printf(mp, "# TYPE %s %s\n# HELP %s %s\n", name, type, name,
+	    help);
+}
+
+/*
+ * Add a value to the family "name"; "suffix" is "_total" for a counter,
+ * and "label", if not NULL, a label and its value, e.g. "worker=\"1\"".
+ */
+void
+metrics_value(struct metrics_page *mp, const char *name, const char *suffix,
+    const char *label, uint64_t value)
+{
+	if (label != NULL)
+		metrics_printf(mp, "%s%s{%s} %" PRIu64 "\n", name, suffix,
+		    label, value);
+	else
+		metrics_printf(mp, "%s%s %" PRIu64 "\n", name, suffix, value);
+}
+
+static void
+metrics_send(int fd, const char *buf, size_t len)
+{
+	ssize_t n;
+
+	while (len != 0) {
+		n = send(fd, buf, len, MSG_NOSIGNAL);
+		if (n == -1 && errno == EINTR)
+			continue;
+		if (n <= 0)
+			return;
+		buf += n;
+		len -= n;
+	}
+}
+
+static void
+metrics_reply(int fd, const char *status, const char *type,
+    const char *body, size_t len)
+{
+	char hdr[256];
+	int n;
+
+	n = snprintf(hdr, sizeof(hdr),
+	    "HTTP/1.0 %s\r\nContent-Type: %s\r\nContent-Length: %zu\r\n"
+	    "Connection: close\r\n\r\n", status, type, len);
+	metrics_send(fd, hdr, (size_t)n);
+	metrics_send(fd, body, len);
+}
+
+/*
+ * Read the request line; returns -1 if there isn't a whole one.  The
+ * headers that follow it are read as far as they've arrived with it,
+ * and ignored.
+ */
+static int
+metrics_read(int fd, char *buf, size_t size)
+{
+	struct timeval tv;
+	size_t len;
+	ssize_t n;
+	char *eol;
+
+	tv.tv_sec = METRICS_TIMEOUT;
+	tv.tv_usec = 0;
+	(void)setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+	len = 0;
+	for (;;) {
+		n = recv(fd, buf + len, size - 1 - len, 0);
+		if (n == -1 && errno == EINTR)
+			continue;
+		if (n <= 0)
+			return (-1);
+		len += n;
+		buf[len] = '\0';
+		if ((eol = strpbrk(buf, "\r\n")) != NULL) {
+			*eol = '\0';
+			return (0);
+		}
+		if (len == size - 1)
+			return (-1);
+	}
+}
+
+/*
+ * Serve the page made by "collector" until the process exits; the body
+ * of the metrics thread.
+ */
+void *
+metrics_serve(struct metrics_server *ms, metrics_collector collector,
+    void *arg)
+{
+	static const char not_found[] = "Not found; try /metrics\n";
+	static const char bad_request[] = "Bad request\n";
+	char req[METRICS_MAXREQUEST];
+	struct metrics_page page;
+	const char *path;
+	int fd;
+#ifdef SO_NOSIGPIPE
+	int on = 1;
+#endif
+
+#ifdef __linux__
+	/* On Linux, this is the thread's priority, not the process's. */
+	(void)setpriority(PRIO_PROCESS, 0, 19);
+#endif
+	memset(&page, 0, sizeof(page));
+	for (;;) {
+		fd = accept(ms->fd, NULL, NULL);
+		if (fd == -1) {
+			if (errno == EINTR || errno == ECONNABORTED)
+				continue;
+			/* Out of descriptors, say; try again later. */
+			sleep(1);
+			continue;
+		}
+#ifdef SO_NOSIGPIPE
+		(void)setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &on,
+		    sizeof(on));
+#endif
+		if (metrics_read(fd, req, sizeof(req)) == -1 ||
+		    strncmp(req, "GET ", 4) != 0) {
+			metrics_reply(fd, "400 Bad Request",
+			    "text/plain; charset=utf-8", bad_request,
+			    sizeof(bad_request) - 1);
+			close(fd);
+			continue;
+		}
+		path = req + 4;
+		if (strncmp(path, "/metrics", 8) != 0 ||
+		    (path[8] != ' ' && path[8] != '?' && path[8] != '\0')) {
+			metrics_reply(fd, "404 Not Found",
+			    "text/plain; charset=utf-8", not_found,
+			    sizeof(not_found) - 1);
+			close(fd);
+			continue;
+		}
+		page.len = 0;
+		page.failed = 0;
+		(*collector)(&page, arg);
+		metrics_printf(&page, "# EOF\n");
+		if (page.failed)
+			metrics_reply(fd, "500 Internal Server Error",
+			    "text/plain; charset=utf-8", "", 0);
+		else
+			metrics_reply(fd, "200 OK", METRICS_CONTENT_TYPE,
+			    page.buf, page.len);
+		close(fd);
+	}
+	/* NOTREACHED */
+}
+#endif /* METRICS_SUPPORTED */
@@ -0,0 +1,41 @@
+/*
+ * Copyright (c) 2026 The TCPDUMP project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that: (1) source code
+ * distributions retain the above copyright notice and this paragraph
+ * in its entirety, and (2) distributions including binary code include
+ * the above copyright notice and this paragraph in its entirety in
+ * the documentation or other materials provided with the distribution.
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND
+ * WITHOUT ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, WITHOUT
+ * LIMITATION, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE.
+ */
+
+
+/*
+ * The --metrics endpoint: an HTTP server, on a thread of its own, that
+ * answers "GET /metrics" with the capture's counters in the OpenMetrics
+ * text format, for Prometheus and the like to scrape.
+ *
+ * The counters are put in the page by the caller's collector, with
+ * metrics_family() and metrics_value(), each time the page is asked for.
+ */
+#if defined(HAVE_PTHREADS) && !defined(_WIN32)
+#define METRICS_SUPPORTED
+
+struct metrics_server;
+struct metrics_page;
+
+typedef void (*metrics_collector)(struct metrics_page *, void *);
+
+extern struct metrics_server *metrics_open(const char *, char *);
+extern void *metrics_serve(struct metrics_server *, metrics_collector,
+    void *);
+extern void metrics_family(struct metrics_page *, const char *,
+    const char *, const char *);
+extern void metrics_value(struct metrics_page *, const char *,
+    const char *, const char *, uint64_t);
+#endif
@@ -0,0 +1,687 @@
+/*
+ * Copyright (c) 2026 The TCPDUMP project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that: (1) source code
+ * distributions retain the above copyright notice and this paragraph
+ * in its entirety, and (2) distributions including binary code include
+ * the above copyright notice and this paragraph in its entirety in
+ * the documentation or other materials provided with the distribution.
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND
+ * WITHOUT ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, WITHOUT
+ * LIMITATION, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE.
+ */
+
+/*
+ * With -C, every savefile is rotated once it grows past a known size,
+ * so it can be preallocated at that size and written through a shared
+ * memory mapping, rather than through the standard I/O library with
+ * a pcap_dump_ftell() after every packet to check its size.  When the
+ * file is closed, it's truncated to the length actually written.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include "netdissect-stdinc.h"
+
+#ifndef _WIN32
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pcap.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "mmap-savefile.h"
+
+struct mmap_savefile {
+	int	fd;
+	u_char	*base;		/* start of the mapping */
+	size_t	size;		/* size of the mapping */
+	size_t	len;		/* number of bytes written so far */
+};
+
+/*
+ * The per-packet record header, as written by pcap_dump().
+ */
+struct mmap_sf_pkthdr {
+	uint32_t	tv_sec;
+	uint32_t	tv_usec;	/* or nanoseconds */
+	uint32_t	caplen;
+	uint32_t	len;
+};
+
+/*
+ * Set up a savefile on the (empty, open for reading and writing) file
+ * descriptor fd, for packets from p, with room for every packet that
+ * starts no more than limit bytes into the file.  On failure, return
+ * NULL with a message in errbuf, which must be PCAP_ERRBUF_SIZE bytes;
+ * fd is left open either way.
+ */
+struct mmap_savefile *
+mmap_savefile_open(pcap_t *p, int fd, uint64_t limit, char *errbuf)
+{
+	struct mmap_savefile *msf;
+	pcap_dumper_t *pdd;
+	FILE *fp;
+	off_t hdrlen;
+	uint64_t size;
+	int dupfd;
+#ifdef HAVE_POSIX_FALLOCATE
+	int err;
+#endif
+
+	/*
+	 * Let libpcap write the file header, so that it gets the
+	 * magic number and link-layer header type right.
+	 */
+	dupfd = dup(fd);
+	if (dupfd == -1) {
+		snprintf(errbuf, PCAP_ERRBUF_SIZE, "dup: %s",
+		    strerror(errno));
+		return (NULL);
+	}
+	fp = fdopen(dupfd, "w");
+	if (fp == NULL) {
+		snprintf(errbuf, PCAP_ERRBUF_SIZE, "fdopen: %s",
+		    strerror(errno));
+		close(dupfd);
+		return (NULL);
+	}
+	pdd = pcap_dump_fopen(p, fp);
+	if (pdd == NULL) {
+		snprintf(errbuf, PCAP_ERRBUF_SIZE, "%s", pcap_geterr(p));
+		fclose(fp);
+		return (NULL);
+	}
+	pcap_dump_close(pdd);
+	hdrlen = lseek(fd, 0, SEEK_END);
+	if (hdrlen == -1) {
+		snprintf(errbuf, PCAP_ERRBUF_SIZE, "lseek: %s",
+		    strerror(errno));
+		return (NULL);
+	}
+
+	size = limit + sizeof(struct mmap_sf_pkthdr) + pcap_snapshot(p);
+	if (size > SIZE_MAX || (uint64_t)(off_t)size != size) {
+		snprintf(errbuf, PCAP_ERRBUF_SIZE,
+		    "file size %" PRIu64 " is too large to map", size);
+		return (NULL);
+	}
+
+	/*
+	 * Preallocate the file, if we can, so that we don't take
+	 * page faults for blocks to be allocated while writing; if
+	 * the file system can't do that, just extend the file.
+	 */
+#ifdef HAVE_POSIX_FALLOCATE
+	err = posix_fallocate(fd, 0, (off_t)size);
+	if (err != 0 && err != EINVAL && err != EOPNOTSUPP) {
+		snprintf(errbuf, PCAP_ERRBUF_SIZE, "posix_fallocate: %s",
+		    strerror(err));
+		return (NULL);
+	}
+	if (err != 0)
+#endif
+	if (ftruncate(fd, (off_t)size) == -1) {
+		snprintf(errbuf, PCAP_ERRBUF_SIZE, "ftruncate: %s",
+		    strerror(errno));
+		return (NULL);
+	}
+
+	msf = (struct mmap_savefile *)malloc(sizeof(*msf));
+	if (msf == NULL) {
+		snprintf(errbuf, PCAP_ERRBUF_SIZE, "malloc: %s",
+		    strerror(errno));
+		return (NULL);
+	}
+	msf->base = (u_char *)mmap(NULL, (size_t)size, PROT_READ|PROT_WRITE,
+	    MAP_SHARED, fd, 0);
+	if (msf->base == (u_char *)MAP_FAILED) {
+		snprintf(errbuf, PCAP_ERRBUF_SIZE, "mmap: %s",
+		    strerror(errno));
+		free(msf);
+		return (NULL);
+	}
+	msf->fd = fd;
+	msf->size = (size_t)size;
+	msf->len = (size_t)hdrlen;
+	return (msf);
+}
+
+/*
+ * Append a packet to the savefile; return -1 if there's no room for it.
+ */
+int
+mmap_savefile_dump(struct mmap_savefile *msf, const struct pcap_pkthdr *h,
+    const u_char *sp)
+{
+	struct mmap_sf_pkthdr sf_hdr;
+
+	if (msf->size - msf->len < sizeof(sf_hdr) ||
+	    msf->size - msf->len - sizeof(sf_hdr) < h->caplen)
+		return (-1);
+	sf_hdr.tv_sec = (uint32_t)h->ts.tv_sec;
+	sf_hdr.tv_usec = (uint32_t)h->ts.tv_usec;
+	sf_hdr.caplen = h->caplen;
+	sf_hdr.len = h->len;
+	memcpy(msf->base + msf->len, &sf_hdr, sizeof(sf_hdr));
+	memcpy(msf->base + msf->len + sizeof(sf_hdr), sp, h->caplen);
+	msf->len += sizeof(sf_hdr) + h->caplen;
+	return (0);
+}
+
+/*
+ * Return the number of bytes written to the savefile so far.
+ */
+uint64_t
+mmap_savefile_length(const struct mmap_savefile *msf)
+{
+	return (msf->len);
+}
+
+/*
+ * Unmap the savefile, truncate it to the length written, and close it.
+ * On failure, return -1 with a message in errbuf.
+ */
+int
+mmap_savefile_close(struct mmap_savefile *msf, char *errbuf)
+{
+	int ret = 0;
+
+	if (munmap(msf->base, msf->size) == -1) {
+		snprintf(errbuf, PCAP_ERRBUF_SIZE, "munmap: %s",
+		    strerror(errno));
+		ret = -1;
+	}
+	if (ret == 0 && ftruncate(msf->fd, (off_t)msf->len) == -1) {
+		snprintf(errbuf, PCAP_ERRBUF_SIZE, "ftruncate: %s",
+		    strerror(errno));
+		ret = -1;
+	}
+	if (close(msf->fd) == -1 && ret == 0) {
+		snprintf(errbuf, PCAP_ERRBUF_SIZE, "close: %s",
+		    strerror(errno));
+		ret = -1;
+	}
+	free(msf);
+	return (ret);
+}
+
+/*
+ * The size of the window of a savefile being read that's mapped at a
+ * time; a packet record can be no more than half that.
+ */
+#define MMAP_READ_WINDOW	(64 * 1024 * 1024)
+#define MMAP_READ_MAX_CAPLEN	(MMAP_READ_WINDOW / 2)
+
+#define TSTAMP_SAME		0
+#define TSTAMP_NANO_TO_MICRO	1
+#define TSTAMP_MICRO_TO_NANO	2
+
+struct mmap_reader {
+	int	fd;
+	uint64_t filesize;
+	uint64_t off;		/* of the next record */
+	uint64_t end;		/* stop at the first record at or past this */
+	u_char	*base;		/* start of the window, or NULL */
+	uint64_t wstart;	/* offset of the window in the file */
+	size_t	wsize;		/* size of the window */
+	size_t	pagesize;
+	u_int	snaplen;
+	int	swapped;
+	int	nano;		/* time stamps in the file are in ns */
+	int	tstamp;		/* TSTAMP_ conversion to do */
+	volatile sig_atomic_t brk;
+	mmap_prefetch_fn prefetch;	/* for the next packet, or NULL */
+	u_char	*prefetch_arg;
+};
+
+static uint32_t
+mmap_reader_swap(const struct mmap_reader *mr, uint32_t v)
+{
+	if (!mr->swapped)
+		return (v);
+	return ((v >> 24) | ((v >> 8) & 0xff00) | ((v << 8) & 0xff0000) |
+	    (v << 24));
+}
+
+/*
+ * Set up to read the savefile fname, which p has already been opened
+ * on, through a mapping.  On failure, return NULL with a message in
+ * errbuf, which must be PCAP_ERRBUF_SIZE bytes.
+ */
+struct mmap_reader *
+mmap_reader_open(pcap_t *p, const char *fname, char *errbuf)
+{
+	struct mmap_reader *mr;
+	struct stat st;
+	uint32_t hdr[6];
+	ssize_t n;
+	int fd, nano, dlt;
+
+	if (strcmp(fname, "-") == 0) {
+		snprintf(errbuf, PCAP_ERRBUF_SIZE,
+		    "the standard input can't be mapped");
+		return (NULL);
+	}
+	fd = open(fname, O_RDONLY);
+	if (fd == -1) {
+		snprintf(errbuf, PCAP_ERRBUF_SIZE, "%s: %s", fname,
+		    strerror(errno));
+		return (NULL);
+	}
+	if (fstat(fd, &st) == -1) {
+		snprintf(errbuf, PCAP_ERRBUF_SIZE, "%s: fstat: %s", fname,
+		    strerror(errno));
+		close(fd);
+		return (NULL);
+	}
+	if (!S_ISREG(st.st_mode)) {
+		snprintf(errbuf, PCAP_ERRBUF_SIZE,
+		    "%s: not a regular file, so it can't be mapped", fname);
+		close(fd);
+		return (NULL);
+	}
+	n = pread(fd, hdr, sizeof(hdr), 0);
+	if (n != (ssize_t)sizeof(hdr)) {
+		snprintf(errbuf, PCAP_ERRBUF_SIZE, "%s: %s", fname,
+		    n == -1 ? strerror(errno) : "truncated file header");
+		close(fd);
+		return (NULL);
+	}
+
+	mr = (struct mmap_reader *)calloc(1, sizeof(*mr));
+	if (mr == NULL) {
+		snprintf(errbuf, PCAP_ERRBUF_SIZE, "malloc: %s",
+		    strerror(errno));
+		close(fd);
+		return (NULL);
+	}
+	switch (hdr[0]) {
+
+	case 0xa1b2c3d4:
+	case 0xd4c3b2a1:
+		nano = 0;
+		break;
+
+	case 0xa1b23c4d:
+	case 0x4d3cb2a1:
+		nano = 1;
+		break;
+
+	default:
+		/* pcapng, or something else libpcap can read */
+		snprintf(errbuf, PCAP_ERRBUF_SIZE,
+		    "%s: only pcap savefiles can be mapped", fname);
+		free(mr);
+		close(fd);
+		return (NULL);
+	}
+	mr->swapped = (hdr[0] & 0xff) == 0xa1;
+	mr->nano = nano;
+
+	/*
+	 * libpcap fixes up the byte order of the pseudo-headers of
+	 * these in savefiles from hosts with the other byte order;
+	 * that isn't done here.
+	 */
+	dlt = pcap_datalink(p);
+	if (mr->swapped &&
+	    (dlt == DLT_USB_LINUX || dlt == DLT_USB_LINUX_MMAPPED ||
+	     dlt == DLT_NFLOG)) {
+		snprintf(errbuf, PCAP_ERRBUF_SIZE,
+		    "%s: link-layer headers in the other byte order can't be mapped",
+		    fname);
+		free(mr);
+		close(fd);
+		return (NULL);
+	}
+
+	mr->tstamp = TSTAMP_SAME;
+#ifdef HAVE_PCAP_SET_TSTAMP_PRECISION
+	if (nano && pcap_get_tstamp_precision(p) == PCAP_TSTAMP_PRECISION_MICRO)
+		mr->tstamp = TSTAMP_NANO_TO_MICRO;
+	else if (!nano &&
+	    pcap_get_tstamp_precision(p) == PCAP_TSTAMP_PRECISION_NANO)
+		mr->tstamp = TSTAMP_MICRO_TO_NANO;
+#else
+	if (nano)
+		mr->tstamp = TSTAMP_NANO_TO_MICRO;
+#endif
+	mr->fd = fd;
+	mr->filesize = (uint64_t)st.st_size;
+	mr->off = sizeof(hdr);
+	mr->end = mr->filesize;
+	mr->pagesize = (size_t)sysconf(_SC_PAGESIZE);
+	mr->snaplen = (u_int)pcap_snapshot(p);
+#ifdef HAVE_POSIX_FADVISE
+	(void)posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+	return (mr);
+}
+
+/*
+ * Slide the window so that it starts at the page holding off.
+ */
+static int
+mmap_reader_map(struct mmap_reader *mr, uint64_t off, char *errbuf)
+{
+	uint64_t start;
+	size_t size;
+
+	if (mr->base != NULL) {
+		(void)munmap(mr->base, mr->wsize);
+		mr->base = NULL;
+	}
+	start = off - off % mr->pagesize;
+	size = MMAP_READ_WINDOW;
+	if (mr->filesize - start < size)
+		size = (size_t)(mr->filesize - start);
+	mr->base = (u_char *)mmap(NULL, size, PROT_READ, MAP_SHARED, mr->fd,
+	    (off_t)start);
+	if (mr->base == (u_char *)MAP_FAILED) {
+		mr->base = NULL;
+		snprintf(errbuf, PCAP_ERRBUF_SIZE, "mmap: %s",
+		    strerror(errno));
+		return (-1);
+	}
+	mr->wstart = start;
+	mr->wsize = size;
+#ifdef HAVE_MADVISE
+	(void)madvise(mr->base, size, MADV_SEQUENTIAL);
+	(void)madvise(mr->base, size, MADV_WILLNEED);
+#endif
+#ifdef HAVE_POSIX_FADVISE
+	/* Have the next window on its way in while this one's used. */
+	if (start + size < mr->filesize)
+		(void)posix_fadvise(mr->fd, (off_t)(start + size),
+		    MMAP_READ_WINDOW, POSIX_FADV_WILLNEED);
+#endif
+	return (0);
+}
+
+/*
+ * Make sure the len bytes at off, which are all in the file, are in
+ * the window, and return a pointer to them, or NULL, with a message
+ * in errbuf, on failure.
+ */
+static const u_char *
+mmap_reader_get(struct mmap_reader *mr, uint64_t off, size_t len,
+    char *errbuf)
+{
+	if (mr->base == NULL || off < mr->wstart ||
+	    off + len > mr->wstart + mr->wsize) {
+		if (mmap_reader_map(mr, off, errbuf) == -1)
+			return (NULL);
+	}
+	return (mr->base + (off - mr->wstart));
+}
+
+/*
+ * Hand the prefetch routine the next record's packet, if it's all in
+ * the window; the window isn't moved for it, as that would unmap the
+ * packet about to be handed to the callback.
+ */
+static void
+mmap_reader_prefetch(struct mmap_reader *mr)
+{
+	struct mmap_sf_pkthdr sf_hdr;
+	const u_char *rec;
+	uint32_t caplen;
+
+	if (mr->off < mr->wstart ||
+	    mr->off + sizeof(sf_hdr) > mr->wstart + mr->wsize)
+		return;
+	rec = mr->base + (mr->off - mr->wstart);
+	memcpy(&sf_hdr, rec, sizeof(sf_hdr));
+	caplen = mmap_reader_swap(mr, sf_hdr.caplen);
+	if (caplen > mr->snaplen)
+		caplen = mr->snaplen;
+	if (caplen > mr->wstart + mr->wsize - (mr->off + sizeof(sf_hdr)))
+		return;
+	(*mr->prefetch)(mr->prefetch_arg, rec + sizeof(sf_hdr), caplen);
+}
+
+/*
+ * Like pcap_loop() on a savefile with the filter fcode: hand cnt
+ * packets that pass the filter, or all of them if cnt is 0 or less,
+ * to callback, and return 0 if that's done or the end of the file is
+ * reached, -2 if mmap_reader_breakloop() was called, or -1, with a
+ * message in errbuf, on failure.
+ */
+int
+mmap_reader_loop(struct mmap_reader *mr, int cnt,
+    const struct bpf_program *fcode, pcap_handler callback, u_char *user,
+    char *errbuf)
+{
+	struct mmap_sf_pkthdr sf_hdr;
+	struct pcap_pkthdr h;
+	const u_char *rec;
+	uint64_t left;
+	int n = 0;
+
+	for (;;) {
+		if (mr->brk) {
+			mr->brk = 0;
+			return (-2);
+		}
+		if (mr->off >= mr->end)
+			return (0);
+		left = mr->filesize - mr->off;
+		if (left < sizeof(sf_hdr)) {
+			snprintf(errbuf, PCAP_ERRBUF_SIZE,
+			    "truncated dump file; tried to read %zu header bytes, only got %u",
+			    sizeof(sf_hdr), (u_int)left);
+			return (-1);
+		}
+		rec = mmap_reader_get(mr, mr->off, sizeof(sf_hdr), errbuf);
+		if (rec == NULL)
+			return (-1);
+		memcpy(&sf_hdr, rec, sizeof(sf_hdr));
+		h.caplen = mmap_reader_swap(mr, sf_hdr.caplen);
+		h.len = mmap_reader_swap(mr, sf_hdr.len);
+		if (h.caplen > MMAP_READ_MAX_CAPLEN) {
+			snprintf(errbuf, PCAP_ERRBUF_SIZE,
+			    "invalid packet capture length %u, bigger than maximum of %u",
+			    h.caplen, MMAP_READ_MAX_CAPLEN);
+			return (-1);
+		}
+		left -= sizeof(sf_hdr);
+		if (left < h.caplen) {
+			snprintf(errbuf, PCAP_ERRBUF_SIZE,
+			    "truncated dump file; tried to read %u captured bytes, only got %u",
+			    h.caplen, (u_int)left);
+			return (-1);
+		}
+		rec = mmap_reader_get(mr, mr->off, sizeof(sf_hdr) + h.caplen,
+		    errbuf);
+		if (rec == NULL)
+			return (-1);
+		mr->off += sizeof(sf_hdr) + h.caplen;
+
+		h.ts.tv_sec = mmap_reader_swap(mr, sf_hdr.tv_sec);
+		h.ts.tv_usec = mmap_reader_swap(mr, sf_hdr.tv_usec);
+		if (mr->tstamp == TSTAMP_NANO_TO_MICRO)
+			h.ts.tv_usec /= 1000;
+		else if (mr->tstamp == TSTAMP_MICRO_TO_NANO)
+			h.ts.tv_usec *= 1000;
+		/* As libpcap does, don't hand over more than the snapshot. */
+		if (h.caplen > mr->snaplen)
+			h.caplen = mr->snaplen;
+
+		rec += sizeof(sf_hdr);
+		if (fcode != NULL && fcode->bf_insns != NULL &&
+		    pcap_offline_filter(fcode, &h, rec) == 0)
+			continue;
+		if (mr->prefetch != NULL)
+			mmap_reader_prefetch(mr);
+		(*callback)(user, &h, rec);
+		if (cnt > 0 && ++n == cnt)
+			return (0);
+	}
+}
+
+/*
+ * Does what's at off look like the start of a run of packet records
+ * that goes on to the end of the file or for at least 8 records?
+ */
+static int
+mmap_reader_plausible(struct mmap_reader *mr, uint64_t off,
+    uint32_t first_sec)
+{
+	struct mmap_sf_pkthdr sf_hdr;
+	const u_char *rec;
+	uint32_t caplen, len, sec, prev_sec = 0, frac_max;
+	char ebuf[PCAP_ERRBUF_SIZE];
+	u_int i;
+
+	frac_max = mr->nano ? 1000000000 : 1000000;
+	for (i = 0; i < 8; i++) {
+		if (off == mr->filesize)
+			return (1);
+		if (mr->filesize - off < sizeof(sf_hdr))
+			return (0);
+		rec = mmap_reader_get(mr, off, sizeof(sf_hdr), ebuf);
+		if (rec == NULL)
+			return (0);
+		memcpy(&sf_hdr, rec, sizeof(sf_hdr));
+		caplen = mmap_reader_swap(mr, sf_hdr.caplen);
+		len = mmap_reader_swap(mr, sf_hdr.len);
+		sec = mmap_reader_swap(mr, sf_hdr.tv_sec);
+		/*
+		 * Runs of zeroes look like empty records from the
+		 * epoch, so those aren't taken; nor are time stamps
+		 * more than a year from the first packet's, and
+		 * earlier than, or over a day after, the previous one.
+		 */
+		if (len == 0 || caplen > len || caplen > mr->snaplen ||
+		    len > MMAP_READ_MAX_CAPLEN ||
+		    mmap_reader_swap(mr, sf_hdr.tv_usec) >= frac_max ||
+		    (sec < first_sec ? first_sec - sec : sec - first_sec) >
+		    366 * 86400 ||
+		    (i != 0 && (sec < prev_sec || sec - prev_sec > 86400)) ||
+		    mr->filesize - off - sizeof(sf_hdr) < caplen)
+			return (0);
+		prev_sec = sec;
+		off += sizeof(sf_hdr) + caplen;
+	}
+	return (1);
+}
+
+/*
+ * Split the packet records of the savefile into n runs of roughly the
+ * same size, for reading in parallel: fill in offsets[0] through
+ * offsets[n], with the ith run going from offsets[i] up to
+ * offsets[i + 1].  Only the first and last offsets are certain; the
+ * others are found by looking for something that looks like a run of
+ * packet records near the point that splits the file evenly, so that
+ * the file doesn't have to be read to find them.  Whoever reads the
+ * ith run must check that it ends where the next one starts.
+ */
+void
+mmap_reader_split(struct mmap_reader *mr, u_int n, uint64_t *offsets)
+{
+	struct mmap_sf_pkthdr sf_hdr;
+	char ebuf[PCAP_ERRBUF_SIZE];
+	const u_char *rec;
+	uint64_t first, size, off, limit;
+	uint32_t first_sec;
+	u_int i;
+
+	first = mr->off;
+	size = mr->filesize - first;
+	offsets[0] = first;
+	offsets[n] = mr->filesize;
+	if (size < sizeof(sf_hdr) ||
+	    (rec = mmap_reader_get(mr, first, sizeof(sf_hdr), ebuf)) == NULL) {
+		for (i = 1; i < n; i++)
+			offsets[i] = mr->filesize;
+		return;
+	}
+	memcpy(&sf_hdr, rec, sizeof(sf_hdr));
+	first_sec = mmap_reader_swap(mr, sf_hdr.tv_sec);
+	for (i = 1; i < n; i++) {
+		off = first + size / n * i;
+		if (off < offsets[i - 1])
+			off = offsets[i - 1];
+		limit = off + 2 * (MMAP_READ_MAX_CAPLEN + 16);
+		if (limit > mr->filesize)
+			limit = mr->filesize;
+		while (off < limit && !mmap_reader_plausible(mr, off, first_sec))
+			off++;
+		offsets[i] = off < limit ? off : mr->filesize;
+	}
+}
+
+/*
+ * Have mmap_reader_loop() start at the record at start and stop at
+ * the first one at or past end.
+ */
+void
+mmap_reader_set_range(struct mmap_reader *mr, uint64_t start, uint64_t end)
+{
+	mr->off = start;
+	mr->end = end;
+}
+
+/*
+ * Go on reading from the record at off, which must be the start of one.
+ */
+void
+mmap_reader_seek(struct mmap_reader *mr, uint64_t off)
+{
+	mr->off = off;
+}
+
+/*
+ * Return the offset of the next record to be read.
+ */
+uint64_t
+mmap_reader_offset(const struct mmap_reader *mr)
+{
+	return (mr->off);
+}
+
+/*
+ * Have mmap_reader_loop() call "fn", before handing each packet to the
+ * callback, with the packet after it, if that's already mapped, so that
+ * what printing it will need can be fetched into the cache meanwhile.
+ */
+void
+mmap_reader_set_prefetch(struct mmap_reader *mr, mmap_prefetch_fn fn,
+    u_char *arg)
+{
+	mr->prefetch = fn;
+	mr->prefetch_arg = arg;
+}
+
+/*
+ * Have mmap_reader_loop() return -2 before the next packet; safe to
+ * call from a signal handler.
+ */
+void
+mmap_reader_breakloop(struct mmap_reader *mr)
+{
+	mr->brk = 1;
+}
+
+void
+mmap_reader_close(struct mmap_reader *mr)
+{
+	if (mr->base != NULL)
+		(void)munmap(mr->base, mr->wsize);
+	close(mr->fd);
+	free(mr);
+}
+#endif /* _WIN32 */
@@ -0,0 +1,48 @@
+/*
+ * Copyright (c) 2026 The TCPDUMP project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that: (1) source code
+ * distributions retain the above copyright notice and this paragraph
+ * in its entirety, and (2) distributions including binary code include
+ * the above copyright notice and this paragraph in its entirety in
+ * the documentation or other materials provided with the distribution.
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND
+ * WITHOUT ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, WITHOUT
+ * LIMITATION, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE.
+ */
+
+/*
+ * Savefiles written through a memory mapping of a preallocated file,
+ * for -w with -C and --mmap-savefile.
+ */
+struct mmap_savefile;
+
+extern struct mmap_savefile *mmap_savefile_open(pcap_t *, int, uint64_t,
+    char *);
+extern int mmap_savefile_dump(struct mmap_savefile *,
+    const struct pcap_pkthdr *, const u_char *);
+extern uint64_t mmap_savefile_length(const struct mmap_savefile *);
+extern int mmap_savefile_close(struct mmap_savefile *, char *);
+
+/*
+ * Savefiles read through a sliding memory mapping, for -r with
+ * --mmap-read.
+ */
+struct mmap_reader;
+
+typedef void (*mmap_prefetch_fn)(u_char *, const u_char *, u_int);
+
+extern struct mmap_reader *mmap_reader_open(pcap_t *, const char *, char *);
+extern int mmap_reader_loop(struct mmap_reader *, int,
+    const struct bpf_program *, pcap_handler, u_char *, char *);
+extern void mmap_reader_split(struct mmap_reader *, u_int, uint64_t *);
+extern void mmap_reader_set_range(struct mmap_reader *, uint64_t, uint64_t);
+extern void mmap_reader_seek(struct mmap_reader *, uint64_t);
+extern void mmap_reader_set_prefetch(struct mmap_reader *, mmap_prefetch_fn,
+    u_char *);
+extern uint64_t mmap_reader_offset(const struct mmap_reader *);
+extern void mmap_reader_breakloop(struct mmap_reader *);
+extern void mmap_reader_close(struct mmap_reader *);
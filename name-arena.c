@@ -0,0 +1,229 @@
+/*
+ * Copyright (c) 2026 The TCPDUMP project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that: (1) source code
+ * distributions retain the above copyright notice and this paragraph
+ * in its entirety, and (2) distributions including binary code include
+ * the above copyright notice and this paragraph in its entirety in
+ * the documentation or other materials provided with the distribution.
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND
+ * WITHOUT ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, WITHOUT
+ * LIMITATION, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include "netdissect-stdinc.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "netdissect.h"
+#include "netdissect-alloc.h"
+#include "name-arena.h"
+
+/*
+ * Each block is malloc()ed with an nd_mem_chunk_t in front of it, so
+ * that name_arena_retire() can hand it to nd_free_all().
+ */
+#define NAME_ARENA_INDEX_MIN	1024
+
+static uint32_t
+name_arena_hash(const char *s, size_t len)
+{
+	uint32_t h = 2166136261U;	/* FNV-1a */
+
+	while (len-- != 0) {
+		h ^= (u_char)*s++;
+		h *= 16777619U;
+	}
+	return (h);
+}
+
+static char *
+name_arena_new_block(netdissect_options *ndo, struct name_arena *arena)
+{
+	nd_mem_chunk_t *chunkp;
+
+	if (arena->nblocks == NAME_ARENA_MAX_BLOCKS)
+		(*ndo->ndo_error)(ndo, S_ERR_ND_MEM_ALLOC,
+				  "name_arena_new_block: arena full");
+	if (arena->nblocks == arena->maxblocks) {
+		u_int n = arena->maxblocks != 0 ? arena->maxblocks * 2 : 16;
+		char **blocks;
+
+		blocks = (char **)realloc(arena->blocks, n * sizeof(*blocks));
+		if (blocks == NULL)
+			(*ndo->ndo_error)(ndo, S_ERR_ND_MEM_ALLOC,
+					  "name_arena_new_block: realloc");
+		arena->blocks = blocks;
+		arena->maxblocks = n;
+	}
+	chunkp = (nd_mem_chunk_t *)malloc(sizeof(*chunkp) +
+	    NAME_ARENA_BLOCK_SIZE);
+	if (chunkp == NULL)
+		(*ndo->ndo_error)(ndo, S_ERR_ND_MEM_ALLOC,
+				  "name_arena_new_block: malloc");
+	arena->blocks[arena->nblocks++] = (char *)(chunkp + 1);
+	return ((char *)(chunkp + 1));
+}
+
+/*
+ * Make the index big enough for one more string, rehashing the strings
+ * already in it if it has to grow.
+ */
+static void
+name_arena_grow_index(netdissect_options *ndo, struct name_arena *arena)
+{
+	uint32_t *index, size, i, j, off;
+	const char *s;
+
+	if (arena->count + 1 <= arena->indexsize / 2)
+		return;
+	size = arena->indexsize != 0 ? arena->indexsize * 2 :
+	    NAME_ARENA_INDEX_MIN;
+	index = (uint32_t *)nd_big_calloc(size, sizeof(*index));
+	if (index == NULL)
+		(*ndo->ndo_error)(ndo, S_ERR_ND_MEM_ALLOC,
+				  "name_arena_grow_index: calloc");
+	for (i = 0; i < arena->indexsize; i++) {
+		off = arena->index[i];
+		if (off == NAME_ARENA_NONE)
+			continue;
+		s = name_arena_str(arena, off);
+		j = name_arena_hash(s, strlen(s)) & (size - 1);
+		while (index[j] != NAME_ARENA_NONE)
+			j = (j + 1) & (size - 1);
+		index[j] = off;
+	}
+	nd_big_free(arena->index);
+	arena->index = index;
+	arena->indexsize = size;
+}
+
+/*
+ * Return the offset of the "len" bytes at "s", followed by a '\0', in
+ * "arena", adding them if they aren't already there.  A string too long
+ * for a block is cut short; nothing asked for here comes close.
+ */
+uint32_t
+name_arena_add(netdissect_options *ndo, struct name_arena *arena,
+	       const char *s, size_t len)
+{
+	uint32_t h, i, off;
+	const char *cp;
+	char *block;
+
+	if (len > NAME_ARENA_BLOCK_SIZE - 2)
+		len = NAME_ARENA_BLOCK_SIZE - 2;
+	name_arena_grow_index(ndo, arena);
+	h = name_arena_hash(s, len);
+	for (i = h & (arena->indexsize - 1);
+	     (off = arena->index[i]) != NAME_ARENA_NONE;
+	     i = (i + 1) & (arena->indexsize - 1)) {
+		cp = name_arena_str(arena, off);
+		if (strncmp(cp, s, len) == 0 && cp[len] == '\0')
+			return (off);
+	}
+
+	if (arena->nblocks == 0) {
+		/* Byte 0 of block 0 is offset 0, i.e. NAME_ARENA_NONE. */
+		block = name_arena_new_block(ndo, arena);
+		block[0] = '\0';
+		arena->pos = 1;
+		arena->bytes = 1;
+	} else if (arena->pos + len + 1 > NAME_ARENA_BLOCK_SIZE) {
+		name_arena_new_block(ndo, arena);
+		arena->pos = 0;
+	}
+	block = arena->blocks[arena->nblocks - 1];
+	off = ((arena->nblocks - 1) << NAME_ARENA_BLOCK_SHIFT) | arena->pos;
+	memcpy(block + arena->pos, s, len);
+	block[arena->pos + len] = '\0';
+	arena->pos += (uint32_t)len + 1;
+	arena->bytes += len + 1;
+
+	arena->index[i] = off;
+	arena->count++;
+	return (off);
+}
+
+/*
+ * Make "dst" a copy of "src", in which every offset means the same
+ * string; whatever "dst" held before is freed.
+ */
+void
+name_arena_copy(netdissect_options *ndo, struct name_arena *dst,
+		const struct name_arena *src)
+{
+	u_int i;
+
+	name_arena_free(dst);
+	for (i = 0; i < src->nblocks; i++)
+		memcpy(name_arena_new_block(ndo, dst), src->blocks[i],
+		    i + 1 < src->nblocks ? NAME_ARENA_BLOCK_SIZE : src->pos);
+	if (src->indexsize != 0) {
+		dst->index = (uint32_t *)nd_big_calloc(src->indexsize,
+		    sizeof(*dst->index));
+		if (dst->index == NULL)
+			(*ndo->ndo_error)(ndo, S_ERR_ND_MEM_ALLOC,
+					  "name_arena_copy: malloc");
+		memcpy(dst->index, src->index,
+		    src->indexsize * sizeof(*dst->index));
+	}
+	dst->pos = src->pos;
+	dst->indexsize = src->indexsize;
+	dst->count = src->count;
+	dst->bytes = src->bytes;
+}
+
+size_t
+name_arena_usage(const struct name_arena *arena)
+{
+	return (arena->nblocks *
+	    (sizeof(nd_mem_chunk_t) + (size_t)NAME_ARENA_BLOCK_SIZE) +
+	    arena->maxblocks * sizeof(*arena->blocks) +
+	    arena->indexsize * sizeof(*arena->index));
+}
+
+static void
+name_arena_reset(struct name_arena *arena)
+{
+	free(arena->blocks);
+	nd_big_free(arena->index);
+	memset(arena, 0, sizeof(*arena));
+}
+
+/*
+ * Empty "arena", leaving its blocks to be freed by nd_free_all(), so
+ * that the names already handed out for the packet being printed stay
+ * valid until it's done.
+ */
+void
+name_arena_retire(netdissect_options *ndo, struct name_arena *arena)
+{
+	u_int i;
+
+	for (i = 0; i < arena->nblocks; i++)
+		nd_add_alloc_list(ndo, (nd_mem_chunk_t *)arena->blocks[i] - 1);
+	name_arena_reset(arena);
+}
+
+/*
+ * Empty "arena" and free its blocks now, when none of its names are
+ * in use.
+ */
+void
+name_arena_free(struct name_arena *arena)
+{
+	u_int i;
+
+	for (i = 0; i < arena->nblocks; i++)
+		free((nd_mem_chunk_t *)arena->blocks[i] - 1);
+	name_arena_reset(arena);
+}
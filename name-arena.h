@@ -0,0 +1,64 @@
+/*
+ * Copyright (c) 2026 The TCPDUMP project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that: (1) source code
+ * distributions retain the above copyright notice and this paragraph
+ * in its entirety, and (2) distributions including binary code include
+ * the above copyright notice and this paragraph in its entirety in
+ * the documentation or other materials provided with the distribution.
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND
+ * WITHOUT ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, WITHOUT
+ * LIMITATION, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE.
+ */
+
+#ifndef name_arena_h
+#define name_arena_h
+
+#include "netdissect.h"
+
+/*
+ * An append-only store for the names the address-to-name tables hand
+ * out.  Each distinct string is kept once, and is referred to by a
+ * 32-bit offset: the number of the block it's in, then its position in
+ * that block.  Blocks are never moved or freed while the arena is in
+ * use, so a name's address stays valid until name_arena_retire() or
+ * name_arena_free().
+ *
+ * Offset 0 is never handed out, so NAME_ARENA_NONE can mean "no name".
+ */
+#define NAME_ARENA_BLOCK_SHIFT	16
+#define NAME_ARENA_BLOCK_SIZE	(1U << NAME_ARENA_BLOCK_SHIFT)
+#define NAME_ARENA_MAX_BLOCKS	(1U << (32 - NAME_ARENA_BLOCK_SHIFT))
+
+#define NAME_ARENA_NONE		0
+
+struct name_arena {
+	char **blocks;
+	u_int nblocks;
+	u_int maxblocks;		/* allocated size of blocks[] */
+	uint32_t pos;			/* first free byte of the last block */
+	uint32_t *index;		/* hash of offsets, 0 if empty */
+	uint32_t indexsize;		/* a power of 2, 0 if no index yet */
+	uint32_t count;			/* strings in the index */
+	size_t bytes;			/* used in the blocks */
+};
+
+extern uint32_t name_arena_add(netdissect_options *, struct name_arena *,
+    const char *, size_t);
+extern void name_arena_copy(netdissect_options *, struct name_arena *,
+    const struct name_arena *);
+extern size_t name_arena_usage(const struct name_arena *);
+extern void name_arena_retire(netdissect_options *, struct name_arena *);
+extern void name_arena_free(struct name_arena *);
+
+static inline const char *
+name_arena_str(const struct name_arena *arena, uint32_t off)
+{
+	return (arena->blocks[off >> NAME_ARENA_BLOCK_SHIFT] +
+	    (off & (NAME_ARENA_BLOCK_SIZE - 1)));
+}
+
+#endif /* name_arena_h */
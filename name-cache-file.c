@@ -0,0 +1,307 @@
+/*
+ * Copyright (c) 2026 The TCPDUMP project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that: (1) source code
+ * distributions retain the above copyright notice and this paragraph
+ * in its entirety, and (2) distributions including binary code include
+ * the above copyright notice and this paragraph in its entirety in
+ * the documentation or other materials provided with the distribution.
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND
+ * WITHOUT ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, WITHOUT
+ * LIMITATION, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE.
+ */
+
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include "netdissect-stdinc.h"
+
+#include <pcap.h>
+
+#include "name-cache-file.h"
+
+#ifdef NAME_CACHE_FILE_SUPPORTED
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define NCF_MAGIC	0x74636e63	/* "tcnc", in the host's byte order */
+#define NCF_VERSION	1
+#define NCF_WAYS	8		/* records per set */
+
+/*
+ * The file is a header and then the records, which are only ever used
+ * on the host that wrote them, so everything is in its byte order.
+ */
+struct ncf_header {
+	uint32_t magic;			/* written last, when it's set up */
+	uint32_t version;
+	uint32_t recsize;		/* sizeof(struct ncf_record) */
+	uint32_t nrecords;		/* a power of 2 */
+	uint8_t pad[48];
+};
+
+struct ncf_payload {
+	uint32_t stamp;			/* when the name was looked up */
+	uint8_t family;			/* 4 or 6, 0 if the record is free */
+	uint8_t pad;
+	uint8_t addr[16];
+	char name[102];			/* "" if the host has no name */
+};
+
+#define NCF_WORDS	(sizeof(struct ncf_payload) / sizeof(uint32_t))
+
+union ncf_copy {
+	struct ncf_payload p;
+	uint32_t w[NCF_WORDS];
+};
+
+/*
+ * The payload is read and written a word at a time, with relaxed
+ * atomics, so that a reader racing a writer gets a torn copy, which
+ * it throws away, rather than undefined behavior.
+ */
+struct ncf_record {
+	atomic_uint_least32_t seq;	/* odd while being written */
+	atomic_uint_least32_t w[NCF_WORDS];
+};
+
+static struct ncf_record *ncf_records;
+static uint32_t ncf_nsets;
+
+static uint32_t
+ncf_hash(int family, const uint8_t *addr)
+{
+	uint32_t h, w;
+	size_t i, alen;
+
+	alen = family == 4 ? 4 : 16;
+	h = (uint32_t)family;
+	for (i = 0; i < alen; i += 4) {
+		memcpy(&w, addr + i, sizeof(w));
+		h = (h ^ w) * 0x9e3779b1U;
+	}
+	h ^= h >> 16;
+	h *= 0x85ebca6bU;
+	h ^= h >> 13;
+	return (h);
+}
+
+static struct ncf_record *
+ncf_set(int family, const uint8_t *addr)
+{
+	return (&ncf_records[(ncf_hash(family, addr) & (ncf_nsets - 1)) *
+	    NCF_WAYS]);
+}
+
+static void
+ncf_read(struct ncf_record *r, union ncf_copy *c)
+{
+	size_t i;
+
+	for (i = 0; i < NCF_WORDS; i++)
+		c->w[i] = (uint32_t)atomic_load_explicit(&r->w[i],
+		    memory_order_relaxed);
+}
+
+/*
+ * Map the file "path", making it if it's new or empty; returns -1, with
+ * a message in ebuf, if it can't be used.
+ */
+int
+name_cache_file_open(const char *path, char *ebuf)
+{
+	struct ncf_header *h;
+	struct stat st;
+	void *map;
+	size_t size;
+	uint32_t n;
+	int fd;
+
+	fd = open(path, O_RDWR | O_CREAT, 0666);
+	if (fd == -1 || fstat(fd, &st) == -1) {
+		snprintf(ebuf, PCAP_ERRBUF_SIZE, "%s: %s", path,
+		    strerror(errno));
+		if (fd != -1)
+			close(fd);
+		return (-1);
+	}
+	size = (size_t)st.st_size;
+	if (size == 0) {
+		size = sizeof(*h) +
+		    (size_t)NAME_CACHE_FILE_RECORDS * sizeof(struct ncf_record);
+		if (ftruncate(fd, (off_t)size) == -1) {
+			snprintf(ebuf, PCAP_ERRBUF_SIZE, "%s: %s", path,
+			    strerror(errno));
+			close(fd);
+			return (-1);
+		}
+	}
+	if (size < sizeof(*h)) {
+		snprintf(ebuf, PCAP_ERRBUF_SIZE,
+		    "%s: not a name cache file", path);
+		close(fd);
+		return (-1);
+	}
+	map = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if (map == MAP_FAILED) {
+		snprintf(ebuf, PCAP_ERRBUF_SIZE, "%s: mmap: %s", path,
+		    strerror(errno));
+		return (-1);
+	}
+	h = (struct ncf_header *)map;
+
+	/*
+	 * A file that's all zeroes is new, possibly being set up by
+	 * another tcpdump at the same time, which would set it up the
+	 * same way.
+	 */
+	if (h->magic == 0) {
+		for (n = NCF_WAYS; n * 2 <= (size - sizeof(*h)) /
+		    sizeof(struct ncf_record); n *= 2)
+			;
+		h->version = NCF_VERSION;
+		h->recsize = sizeof(struct ncf_record);
+		h->nrecords = n;
+		atomic_thread_fence(memory_order_release);
+		h->magic = NCF_MAGIC;
+	}
+	n = h->nrecords;
+	if (h->magic != NCF_MAGIC || h->version != NCF_VERSION ||
+	    h->recsize != sizeof(struct ncf_record) || n < NCF_WAYS ||
+	    (n & (n - 1)) != 0 ||
+	    n > (size - sizeof(*h)) / sizeof(struct ncf_record)) {
+		snprintf(ebuf, PCAP_ERRBUF_SIZE,
+		    "%s: not a name cache file, or one from another version",
+		    path);
+		munmap(map, size);
+		return (-1);
+	}
+	ncf_records = (struct ncf_record *)(h + 1);
+	ncf_nsets = n / NCF_WAYS;
+	return (0);
+}
+
+/*
+ * Look up the AF_INET or AF_INET6 address "addr", and if there's a
+ * record for it less than "ttl" seconds old (NAME_CACHE_FILE_TTL if
+ * it's 0), copy its name, or "" if it has none, to "name" and return
+ * 1; otherwise return 0.
+ */
+int
+name_cache_file_get(int af, const void *addr, u_int ttl, char *name,
+		    size_t namesize)
+{
+	struct ncf_record *set, *r;
+	union ncf_copy c;
+	uint32_t seq, now;
+	int family;
+	u_int i;
+
+	if (ncf_records == NULL)
+		return (0);
+	family = af == AF_INET ? 4 : 6;
+	set = ncf_set(family, addr);
+	now = (uint32_t)time(NULL);
+	if (ttl == 0)
+		ttl = NAME_CACHE_FILE_TTL;
+	for (i = 0; i < NCF_WAYS; i++) {
+		r = &set[i];
+		seq = (uint32_t)atomic_load_explicit(&r->seq,
+		    memory_order_acquire);
+		if (seq & 1)
+			continue;
+		ncf_read(r, &c);
+		atomic_thread_fence(memory_order_acquire);
+		if ((uint32_t)atomic_load_explicit(&r->seq,
+		    memory_order_relaxed) != seq)
+			continue;
+		if (c.p.family != family ||
+		    memcmp(c.p.addr, addr, family == 4 ? 4 : 16) != 0)
+			continue;
+		if (now - c.p.stamp >= ttl)
+			return (0);
+		c.p.name[sizeof(c.p.name) - 1] = '\0';
+		snprintf(name, namesize, "%s", c.p.name);
+		return (1);
+	}
+	return (0);
+}
+
+/*
+ * Record that the AF_INET or AF_INET6 address "addr" has the name
+ * "name", or none if it's NULL.  Names too long for a record aren't
+ * kept.
+ */
+void
+name_cache_file_put(int af, const void *addr, const char *name)
+{
+	struct ncf_record *set, *r, *victim;
+	union ncf_copy c;
+	uint_least32_t seq;
+	uint32_t stamp, oldest;
+	size_t namelen;
+	int family;
+	u_int i;
+
+	if (ncf_records == NULL)
+		return;
+	namelen = name != NULL ? strlen(name) : 0;
+	if (namelen >= sizeof(c.p.name))
+		return;
+	family = af == AF_INET ? 4 : 6;
+
+	/*
+	 * The record for the address if there is one, else a free one,
+	 * else the oldest; a torn read only makes a poorer choice.
+	 */
+	set = ncf_set(family, addr);
+	victim = set;
+	oldest = UINT32_MAX;
+	for (i = 0; i < NCF_WAYS; i++) {
+		r = &set[i];
+		ncf_read(r, &c);
+		if (c.p.family == family &&
+		    memcmp(c.p.addr, addr, family == 4 ? 4 : 16) == 0) {
+			victim = r;
+			break;
+		}
+		stamp = c.p.family == 0 ? 0 : c.p.stamp;
+		if (stamp < oldest) {
+			victim = r;
+			oldest = stamp;
+		}
+	}
+
+	seq = atomic_load_explicit(&victim->seq, memory_order_relaxed);
+	if ((seq & 1) != 0 || !atomic_compare_exchange_strong_explicit(
+	    &victim->seq, &seq, seq + 1, memory_order_relaxed,
+	    memory_order_relaxed))
+		return;
+	atomic_thread_fence(memory_order_release);
+	memset(&c, 0, sizeof(c));
+	c.p.stamp = (uint32_t)time(NULL);
+	c.p.family = (uint8_t)family;
+	memcpy(c.p.addr, addr, family == 4 ? 4 : 16);
+	if (name != NULL)
+		memcpy(c.p.name, name, namelen);
+	for (i = 0; i < NCF_WORDS; i++)
+		atomic_store_explicit(&victim->w[i], c.w[i],
+		    memory_order_relaxed);
+	atomic_store_explicit(&victim->seq, seq + 2, memory_order_release);
+}
+#endif /* NAME_CACHE_FILE_SUPPORTED */
@@ -0,0 +1,49 @@
+/*
+ * Copyright (c) 2026 The TCPDUMP project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that: (1) source code
+ * distributions retain the above copyright notice and this paragraph
+ * in its entirety, and (2) distributions including binary code include
+ * the above copyright notice and this paragraph in its entirety in
+ * the documentation or other materials provided with the distribution.
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND
+ * WITHOUT ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, WITHOUT
+ * LIMITATION, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE.
+ */
+
+
+#ifndef name_cache_file_h
+#define name_cache_file_h
+
+/*
+ * --name-cache-file: host names kept in a file that's mapped into
+ * memory, so that they outlast the run and are shared by all the
+ * tcpdumps on the host using the same file.  The file is a table of
+ * fixed-size records, each an address, the name it was found to have
+ * (or none) and when; an address hashes to a set of records and, when
+ * it isn't there, replaces the oldest of them.
+ *
+ * Each record has a sequence number that a writer makes odd while it
+ * changes the record and even again when it's done; a reader copies
+ * the record and uses the copy only if the number was even and the
+ * same before and after, so reading takes no lock.  A writer claims a
+ * record by changing the number with a compare-and-swap, and doesn't
+ * wait for one that's already claimed, as a name that isn't written
+ * will just be looked up again.
+ */
+#if defined(HAVE_STDATOMIC_H) && !defined(__STDC_NO_ATOMICS__) && \
+    !defined(_WIN32)
+#define NAME_CACHE_FILE_SUPPORTED
+
+#define NAME_CACHE_FILE_RECORDS	65536	/* for a new file */
+#define NAME_CACHE_FILE_TTL	3600	/* seconds, if --name-cache-ttl is 0 */
+
+extern int name_cache_file_open(const char *, char *);
+extern int name_cache_file_get(int, const void *, u_int, char *, size_t);
+extern void name_cache_file_put(int, const void *, const char *);
+#endif
+
+#endif /* name_cache_file_h */
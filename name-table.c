@@ -0,0 +1,141 @@
+/*
+ * Copyright (c) 2026 The TCPDUMP project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that: (1) source code
+ * distributions retain the above copyright notice and this paragraph
+ * in its entirety, and (2) distributions including binary code include
+ * the above copyright notice and this paragraph in its entirety in
+ * the documentation or other materials provided with the distribution.
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND
+ * WITHOUT ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, WITHOUT
+ * LIMITATION, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include "netdissect-stdinc.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "netdissect.h"
+#include "name-table.h"
+
+#define NAMETABLE_MIN_SIZE	16
+#define NAMETABLE_MAX_SIZE	(1U << 20)
+#define NAMETABLE_LOAD		2	/* average chain length before growing */
+
+/*
+ * Callers' hashes are often just the address, so mix the bits before
+ * using the low ones.
+ */
+static u_int
+nametable_bucket(uint32_t h, u_int size)
+{
+	h ^= h >> 16;
+	h *= 0x85ebca6bU;
+	h ^= h >> 13;
+	h *= 0xc2b2ae35U;
+	h ^= h >> 16;
+	return (h & (size - 1));
+}
+
+/* Add "np" at the end of its chain in "heads". */
+static void
+nametable_link(struct nametable_node **heads, u_int size,
+	       struct nametable_node *np)
+{
+	struct nametable_node **npp;
+
+	for (npp = &heads[nametable_bucket(np->nt_hash, size)]; *npp != NULL;
+	     npp = &(*npp)->nt_nxt)
+		;
+	np->nt_nxt = NULL;
+	*npp = np;
+}
+
+static void
+nametable_resize(netdissect_options *ndo, struct nametable *t, u_int size)
+{
+	struct nametable_node **heads, *np, *next;
+	u_int i;
+
+	heads = (struct nametable_node **)calloc(size, sizeof(*heads));
+	if (heads == NULL)
+		(*ndo->ndo_error)(ndo, S_ERR_ND_MEM_ALLOC,
+				  "nametable_resize: calloc");
+	for (i = 0; i < t->size; i++)
+		for (np = t->heads[i]; np != NULL; np = next) {
+			next = np->nt_nxt;
+			nametable_link(heads, size, np);
+		}
+	free(t->heads);
+	t->heads = heads;
+	t->size = size;
+}
+
+/*
+ * Return the first entry of the chain that entries with the hash "h"
+ * are on, or NULL if there are none.
+ */
+struct nametable_node *
+nametable_first(const struct nametable *t, uint32_t h)
+{
+	if (t->heads == NULL)
+		return (NULL);
+	return (t->heads[nametable_bucket(h, t->size)]);
+}
+
+void
+nametable_insert(netdissect_options *ndo, struct nametable *t,
+		 struct nametable_node *np, uint32_t h)
+{
+	if (t->heads == NULL)
+		nametable_resize(ndo, t, NAMETABLE_MIN_SIZE);
+	else if (t->count >= t->size * NAMETABLE_LOAD &&
+	    t->size < NAMETABLE_MAX_SIZE)
+		nametable_resize(ndo, t, t->size * 2);
+	np->nt_hash = h;
+	nametable_link(t->heads, t->size, np);
+	t->count++;
+}
+
+/*
+ * Make "dst", which must be empty, a copy of "src", whose entries are
+ * "entsize" bytes long; anything the entries point to is shared.
+ */
+void
+nametable_copy(netdissect_options *ndo, struct nametable *dst,
+	       const struct nametable *src, size_t entsize)
+{
+	struct nametable_node *np, *cp, **npp;
+	u_int i;
+
+	if (src->heads == NULL)
+		return;
+	dst->heads = (struct nametable_node **)calloc(src->size,
+	    sizeof(*dst->heads));
+	if (dst->heads == NULL)
+		(*ndo->ndo_error)(ndo, S_ERR_ND_MEM_ALLOC,
+				  "nametable_copy: calloc");
+	dst->size = src->size;
+	for (i = 0; i < src->size; i++) {
+		npp = &dst->heads[i];
+		for (np = src->heads[i]; np != NULL; np = np->nt_nxt) {
+			cp = (struct nametable_node *)malloc(entsize);
+			if (cp == NULL)
+				(*ndo->ndo_error)(ndo, S_ERR_ND_MEM_ALLOC,
+						  "nametable_copy: malloc");
+			memcpy(cp, np, entsize);
+			cp->nt_nxt = NULL;
+			*npp = cp;
+			npp = &cp->nt_nxt;
+		}
+	}
+	dst->count = src->count;
+}
@@ -0,0 +1,53 @@
+/*
+ * Copyright (c) 2026 The TCPDUMP project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that: (1) source code
+ * distributions retain the above copyright notice and this paragraph
+ * in its entirety, and (2) distributions including binary code include
+ * the above copyright notice and this paragraph in its entirety in
+ * the documentation or other materials provided with the distribution.
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND
+ * WITHOUT ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, WITHOUT
+ * LIMITATION, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE.
+ */
+
+#ifndef name_table_h
+#define name_table_h
+
+#include "netdissect.h"
+
+/*
+ * Chained hash tables for the address-to-name translations.  A table
+ * takes no memory until something is put in it, starts out small and
+ * doubles as it fills, so a table for addresses that never show up
+ * costs nothing.
+ *
+ * An entry is a structure whose first member is a struct
+ * nametable_node; the caller allocates it, fills in its key and
+ * passes it and the key's hash to nametable_insert().  Lookups walk
+ * the chain from nametable_first(), comparing nt_hash before the key.
+ * Entries are never removed, and keep their order in a chain, so the
+ * first one inserted with a given key is the one that's found.
+ */
+struct nametable_node {
+	struct nametable_node *nt_nxt;
+	uint32_t nt_hash;
+};
+
+struct nametable {
+	struct nametable_node **heads;	/* NULL until the first insert */
+	u_int size;			/* a power of 2 */
+	u_int count;
+};
+
+extern struct nametable_node *nametable_first(const struct nametable *,
+    uint32_t);
+extern void nametable_insert(netdissect_options *, struct nametable *,
+    struct nametable_node *, uint32_t);
+extern void nametable_copy(netdissect_options *, struct nametable *,
+    const struct nametable *, size_t);
+
+#endif /* name_table_h */
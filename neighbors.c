@@ -0,0 +1,334 @@
+/*
+ * Copyright (c) 2026 The TCPDUMP project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that: (1) source code
+ * distributions retain the above copyright notice and this paragraph
+ * in its entirety, and (2) distributions including binary code include
+ * the above copyright notice and this paragraph in its entirety in
+ * the documentation or other materials provided with the distribution.
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND
+ * WITHOUT ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, WITHOUT
+ * LIMITATION, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include "netdissect-stdinc.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "netdissect-ctype.h"
+#include "netdissect.h"
+#include "ethertype.h"
+#include "extract.h"
+#include "neighbors.h"
+
+#define NEIGHBOR_CHAINS		256
+
+/* The LLDP TLVs that matter here. */
+#define LLDP_END_TLV		0
+#define LLDP_CHASSIS_ID_TLV	1
+#define LLDP_PORT_ID_TLV	2
+#define LLDP_TTL_TLV		3
+
+#define LLDP_CHASSIS_MAC	4	/* chassis ID subtypes */
+#define LLDP_CHASSIS_ADDR	5
+#define LLDP_PORT_MAC		3	/* port ID subtypes */
+#define LLDP_PORT_ADDR		4
+
+/* The CDP header and TLVs. */
+#define CDP_HEADER_LEN		4
+#define CDP_TLV_HEADER_LEN	4
+#define CDP_DEVICE_ID_TLV	0x0001
+#define CDP_PORT_ID_TLV		0x0003
+
+struct neighbor_entry {
+	struct neighbor_stats ne_stats;
+	u_char *ne_key;			/* chassis ID and port ID */
+	u_int ne_keylen;
+	uint64_t ne_hash;		/* of the last advertisement */
+	time_t ne_last;			/* when it was seen */
+	struct neighbor_entry *ne_next;	/* on its hash chain */
+};
+
+static ND_THREAD_LOCAL struct neighbor_entry *neighbor_chains[NEIGHBOR_CHAINS];
+static ND_THREAD_LOCAL struct neighbor_entry **neighbor_entries; /* in order seen */
+static ND_THREAD_LOCAL u_int neighbor_nentries, neighbor_maxentries;
+
+static uint64_t
+neighbor_hash(uint64_t h, const u_char *p, u_int len)
+{
+	u_int i;
+
+	for (i = 0; i < len; i++)
+		h = (h ^ p[i]) * 1099511628211ULL;
+	return (h);
+}
+
+/*
+ * Put a printable form of the "len" bytes of an ID at "p" in "buf": as
+ * a MAC address if "mac" is set and it is one, as an IPv4 address if
+ * "addr" is set and it's an LLDP IPv4 network address, and otherwise
+ * as text, with unprintable characters as '.'.
+ */
+static void
+neighbor_name(char *buf, const u_char *p, u_int len, int mac, int addr)
+{
+	u_int i;
+
+	if (mac && len == 6) {
+		snprintf(buf, NEIGHBOR_NAME_LEN,
+		    "%02x:%02x:%02x:%02x:%02x:%02x",
+		    p[0], p[1], p[2], p[3], p[4], p[5]);
+		return;
+	}
+	if (addr && len == 5 && p[0] == 1) {
+		snprintf(buf, NEIGHBOR_NAME_LEN, "%u.%u.%u.%u",
+		    p[1], p[2], p[3], p[4]);
+		return;
+	}
+	if (len > NEIGHBOR_NAME_LEN - 1)
+		len = NEIGHBOR_NAME_LEN - 1;
+	for (i = 0; i < len; i++)
+		buf[i] = ND_ASCII_ISPRINT(p[i]) ? (char)p[i] : '.';
+	buf[i] = '\0';
+}
+
+static struct neighbor_entry *
+neighbor_lookup(netdissect_options *ndo, u_int proto, const u_char *chassis,
+    u_int chassis_len, const u_char *port, u_int port_len, int *isnew)
+{
+	struct neighbor_entry *ne, **nep;
+	uint32_t h = 2166136261U;
+	u_int i, keylen = chassis_len + port_len;
+
+	h = (h ^ proto) * 16777619U;
+	for (i = 0; i < chassis_len; i++)
+		h = (h ^ chassis[i]) * 16777619U;
+	h = (h ^ 0x100) * 16777619U;
+	for (i = 0; i < port_len; i++)
+		h = (h ^ port[i]) * 16777619U;
+	nep = &neighbor_chains[h % NEIGHBOR_CHAINS];
+	for (ne = *nep; ne != NULL; ne = ne->ne_next)
+		if (ne->ne_stats.ns_proto == proto &&
+		    ne->ne_keylen == keylen &&
+		    memcmp(ne->ne_key, chassis, chassis_len) == 0 &&
+		    memcmp(ne->ne_key + chassis_len, port, port_len) == 0) {
+			*isnew = 0;
+			return (ne);
+		}
+
+	if (neighbor_nentries == neighbor_maxentries) {
+		neighbor_maxentries = neighbor_maxentries ?
+		    neighbor_maxentries * 2 : 32;
+		neighbor_entries = (struct neighbor_entry **)realloc(
+		    neighbor_entries,
+		    neighbor_maxentries * sizeof(*neighbor_entries));
+		if (neighbor_entries == NULL)
+			(*ndo->ndo_error)(ndo, S_ERR_ND_MEM_ALLOC,
+			    "%s: realloc", __func__);
+	}
+	ne = (struct neighbor_entry *)calloc(1, sizeof(*ne));
+	if (ne == NULL ||
+	    (ne->ne_key = (u_char *)malloc(keylen + 1)) == NULL)
+		(*ndo->ndo_error)(ndo, S_ERR_ND_MEM_ALLOC, "%s: calloc",
+		    __func__);
+	memcpy(ne->ne_key, chassis, chassis_len);
+	memcpy(ne->ne_key + chassis_len, port, port_len);
+	ne->ne_keylen = keylen;
+	ne->ne_stats.ns_proto = proto;
+	ne->ne_next = *nep;
+	*nep = ne;
+	neighbor_entries[neighbor_nentries++] = ne;
+	*isnew = 1;
+	return (ne);
+}
+
+/*
+ * Count the advertisement of neighbor "chassis", "port" and "proto",
+ * hashing to "h", with time to live "ttl", seen at "now".  Return 1 if
+ * it repeats the last one, and 0 otherwise.
+ */
+static int
+neighbor_update(netdissect_options *ndo, u_int proto, const u_char *chassis,
+    u_int chassis_len, const u_char *port, u_int port_len, uint64_t h,
+    u_int ttl, time_t now)
+{
+	struct neighbor_entry *ne;
+	struct neighbor_stats *ns;
+	int isnew, repeat;
+
+	ne = neighbor_lookup(ndo, proto, chassis, chassis_len, port,
+	    port_len, &isnew);
+	ns = &ne->ne_stats;
+	ns->ns_adverts++;
+	if (isnew) {
+		if (proto == NEIGHBOR_LLDP) {
+			/* Past the subtypes. */
+			neighbor_name(ns->ns_chassis, chassis + 1,
+			    chassis_len - 1, chassis[0] == LLDP_CHASSIS_MAC,
+			    chassis[0] == LLDP_CHASSIS_ADDR);
+			neighbor_name(ns->ns_port, port + 1, port_len - 1,
+			    port[0] == LLDP_PORT_MAC,
+			    port[0] == LLDP_PORT_ADDR);
+		} else {
+			neighbor_name(ns->ns_chassis, chassis, chassis_len,
+			    0, 0);
+			neighbor_name(ns->ns_port, port, port_len, 0, 0);
+		}
+		repeat = 0;
+	} else if (now > ne->ne_last + (time_t)ns->ns_ttl) {
+		/* It had been forgotten, so it's news again. */
+		ns->ns_expiries++;
+		repeat = 0;
+	} else
+		repeat = ne->ne_hash == h && ttl != 0;
+	if (!repeat)
+		ns->ns_changes++;
+	ne->ne_hash = h;
+	ne->ne_last = now;
+	ns->ns_ttl = ttl;
+	return (repeat);
+}
+
+/*
+ * Look at the LLDPDU of "len" bytes, all captured, at "p".
+ */
+static int
+neighbor_lldp(netdissect_options *ndo, const u_char *p, u_int len,
+    time_t now)
+{
+	const u_char *chassis = NULL, *port = NULL;
+	u_int chassis_len = 0, port_len = 0, ttl = 0, type, tlen;
+	uint64_t h = 14695981039346656037ULL;
+	int have_ttl = 0;
+
+	while (len >= 2) {
+		type = EXTRACT_BE_U_2(p) >> 9;
+		tlen = EXTRACT_BE_U_2(p) & 0x1ff;
+		if (len - 2 < tlen)
+			return (0);
+		if (type == LLDP_END_TLV)
+			break;
+		if (type == LLDP_CHASSIS_ID_TLV && chassis == NULL &&
+		    tlen >= 2) {
+			chassis = p + 2;
+			chassis_len = tlen;
+		} else if (type == LLDP_PORT_ID_TLV && port == NULL &&
+		    tlen >= 2) {
+			port = p + 2;
+			port_len = tlen;
+		}
+		if (type == LLDP_TTL_TLV && !have_ttl && tlen >= 2) {
+			ttl = EXTRACT_BE_U_2(p + 2);
+			have_ttl = 1;
+		} else
+			h = neighbor_hash(h, p, 2 + tlen);
+		p += 2 + tlen;
+		len -= 2 + tlen;
+	}
+	if (chassis == NULL || port == NULL || !have_ttl)
+		return (0);
+	return (neighbor_update(ndo, NEIGHBOR_LLDP, chassis, chassis_len,
+	    port, port_len, h, ttl, now));
+}
+
+/*
+ * Look at the CDP packet of "len" bytes, all captured, at "p".
+ */
+static int
+neighbor_cdp(netdissect_options *ndo, const u_char *p, u_int len,
+    time_t now)
+{
+	const u_char *device = NULL, *port = NULL;
+	u_int device_len = 0, port_len = 0, ttl, type, tlen;
+	uint64_t h = 14695981039346656037ULL;
+
+	if (len < CDP_HEADER_LEN)
+		return (0);
+	/* The version counts, the checksum covers the time to live. */
+	h = neighbor_hash(h, p, 1);
+	ttl = p[1];
+	p += CDP_HEADER_LEN;
+	len -= CDP_HEADER_LEN;
+	while (len >= CDP_TLV_HEADER_LEN) {
+		type = EXTRACT_BE_U_2(p);
+		tlen = EXTRACT_BE_U_2(p + 2);
+		if (tlen < CDP_TLV_HEADER_LEN || tlen > len)
+			return (0);
+		if (type == CDP_DEVICE_ID_TLV && device == NULL &&
+		    tlen > CDP_TLV_HEADER_LEN) {
+			device = p + CDP_TLV_HEADER_LEN;
+			device_len = tlen - CDP_TLV_HEADER_LEN;
+		} else if (type == CDP_PORT_ID_TLV && port == NULL &&
+		    tlen > CDP_TLV_HEADER_LEN) {
+			port = p + CDP_TLV_HEADER_LEN;
+			port_len = tlen - CDP_TLV_HEADER_LEN;
+		}
+		h = neighbor_hash(h, p, tlen);
+		p += tlen;
+		len -= tlen;
+	}
+	if (device == NULL || port == NULL)
+		return (0);
+	return (neighbor_update(ndo, NEIGHBOR_CDP, device, device_len, port,
+	    port_len, h, ttl, now));
+}
+
+/*
+ * Count the Ethernet frame of "length" bytes, "caplen" of them captured,
+ * at "p", seen at "now", if it's an LLDP or CDP advertisement.  Return
+ * 1 if it repeats the last advertisement from its neighbor, which
+ * hasn't run out yet, so that it needn't be printed, and 0 otherwise,
+ * including when it isn't all captured.
+ */
+int
+neighbor_repeat(netdissect_options *ndo, const u_char *p, u_int length,
+    u_int caplen, time_t now)
+{
+	u_int type;
+
+	if (caplen < length)
+		return (0);
+	if (length < 14)
+		return (0);
+	type = EXTRACT_BE_U_2(p + 12);
+	p += 14;
+	length -= 14;
+	while ((type == ETHERTYPE_8021Q || type == ETHERTYPE_8021QinQ ||
+	    type == ETHERTYPE_8021Q9100) && length >= 4) {
+		type = EXTRACT_BE_U_2(p + 2);
+		p += 4;
+		length -= 4;
+	}
+	if (type == ETHERTYPE_LLDP)
+		return (neighbor_lldp(ndo, p, length, now));
+	/*
+	 * An 802.3 length, rather than a type, with LLC and SNAP, OUI
+	 * 00-00-0c and protocol ID 0x2000.
+	 */
+	if (type <= 1500 && type <= length && type >= 8 &&
+	    memcmp(p, "\xaa\xaa\x03\x00\x00\x0c\x20\x00", 8) == 0)
+		return (neighbor_cdp(ndo, p + 8, type - 8, now));
+	return (0);
+}
+
+/*
+ * Call "fn" for each neighbor of this thread that advertisements have
+ * been seen from, in the order they were first seen.
+ */
+void
+neighbor_foreach(neighbor_fn fn, void *arg)
+{
+	u_int i;
+
+	for (i = 0; i < neighbor_nentries; i++)
+		(*fn)(arg, &neighbor_entries[i]->ne_stats);
+}
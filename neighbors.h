@@ -0,0 +1,49 @@
+/*
+ * Copyright (c) 2026 The TCPDUMP project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that: (1) source code
+ * distributions retain the above copyright notice and this paragraph
+ * in its entirety, and (2) distributions including binary code include
+ * the above copyright notice and this paragraph in its entirety in
+ * the documentation or other materials provided with the distribution.
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND
+ * WITHOUT ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, WITHOUT
+ * LIMITATION, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE.
+ */
+
+#ifndef neighbors_h
+#define neighbors_h
+
+/*
+ * A neighbor table, for --neighbors: the last LLDP or CDP advertisement
+ * seen from each chassis and port, kept as a hash of its TLVs other
+ * than the time to live.  An advertisement that hashes the same as the
+ * last one from its neighbor, and arrives before that one's time to
+ * live runs out, only refreshes it, and needn't be dissected at all.
+ * The table is per thread, so updating it takes no locks.
+ */
+#define NEIGHBOR_LLDP		0
+#define NEIGHBOR_CDP		1
+
+#define NEIGHBOR_NAME_LEN	64
+
+struct neighbor_stats {
+	u_int ns_proto;			/* NEIGHBOR_LLDP or NEIGHBOR_CDP */
+	char ns_chassis[NEIGHBOR_NAME_LEN];	/* or CDP device ID */
+	char ns_port[NEIGHBOR_NAME_LEN];
+	uint64_t ns_adverts;
+	uint64_t ns_changes;		/* those not repeating the last one */
+	uint64_t ns_expiries;		/* those after the last one ran out */
+	u_int ns_ttl;			/* of the last one, in seconds */
+};
+
+typedef void (*neighbor_fn)(void *, const struct neighbor_stats *);
+
+extern int neighbor_repeat(netdissect_options *, const u_char *, u_int,
+    u_int, time_t);
+extern void neighbor_foreach(neighbor_fn, void *);
+
+#endif /* neighbors_h */
@@ -19,6 +19,10 @@
 #endif
 
 #include <stdlib.h>
+#include <pthread.h>
+#ifndef _WIN32
+#include <sys/mman.h>
+#endif
 #include "netdissect-alloc.h"
 
 /*
@@ -36,18 +40,37 @@ nd_add_alloc_list(netdissect_options *ndo, nd_mem_chunk_t *chunkp)
 	ndo->ndo_last_mem_p = chunkp;
 }
 
-/* malloc replacement, with tracking in a linked list */
+/*
+ * malloc replacement; memory comes from the arena if there's room,
+ * otherwise from malloc() with tracking in a linked list
+ */
 void *
 nd_malloc(netdissect_options *ndo, size_t size)
 {
-	nd_mem_chunk_t *chunkp = malloc(sizeof(nd_mem_chunk_t) + size);
+	nd_mem_chunk_t *chunkp;
+	size_t asize;
+
+	ndo->ndo_nd_mallocs++;
+	asize = (size + (ND_ARENA_ALIGN - 1)) & ~(size_t)(ND_ARENA_ALIGN - 1);
+	if (asize >= size && asize <= ND_ARENA_SIZE - ndo->ndo_arena_used) {
+		if (ndo->ndo_arena == NULL)
+			ndo->ndo_arena = malloc(ND_ARENA_SIZE);
+		if (ndo->ndo_arena != NULL) {
+			void *p = ndo->ndo_arena + ndo->ndo_arena_used;
+
+			ndo->ndo_arena_used += asize;
+			return p;
+		}
+	}
+
+	chunkp = malloc(sizeof(nd_mem_chunk_t) + size);
 	if (chunkp == NULL)
 		return NULL;
 	nd_add_alloc_list(ndo, chunkp);
 	return chunkp + 1;
 }
 
-/* Free chunks in allocation linked list from last to first */
+/* Empty the arena and free chunks in allocation linked list from last to first */
 void
 nd_free_all(netdissect_options *ndo)
 {
@@ -59,4 +82,219 @@ nd_free_all(netdissect_options *ndo)
 		current = previous;
 	}
 	ndo->ndo_last_mem_p = NULL;
+	if (ndo->ndo_arena_used > ndo->ndo_arena_peak)
+		ndo->ndo_arena_peak = ndo->ndo_arena_used;
+	ndo->ndo_arena_used = 0;
+}
+
+/*
+ * What nd_big_calloc() has handed out, so that nd_big_free() knows how
+ * to free it; there are only ever a few.
+ */
+struct nd_big_map {
+	struct nd_big_map *next;
+	void	*addr;
+	size_t	len;
+	int	kind;			/* ND_BIG_* */
+};
+
+#define ND_BIG_CALLOC	0
+#define ND_BIG_THP	1
+#define ND_BIG_HUGE	2
+
+#define ND_HUGE_2M	(2 * 1024 * 1024)
+#define ND_HUGE_1G	(1024 * 1024 * 1024)
+
+static pthread_mutex_t nd_big_mtx = PTHREAD_MUTEX_INITIALIZER;
+static int nd_big_policy = ND_PAGES_NORMAL;
+static struct nd_big_map *nd_big_maps;
+static struct nd_big_alloc_stats nd_big_stats;
+
+/*
+ * Say what nd_big_calloc() is to use, before anything's allocated.
+ */
+void
+nd_big_pages(int policy)
+{
+	nd_big_policy = policy;
+}
+
+#ifndef _WIN32
+#ifdef MAP_HUGETLB
+/*
+ * Map "*lenp" bytes, rounded up, of huge pages of "pagesize" bytes, or
+ * return NULL.
+ */
+static void *
+nd_big_map_huge(size_t *lenp, size_t pagesize)
+{
+	size_t len;
+	void *p;
+	int flags;
+
+	len = (*lenp + pagesize - 1) & ~(pagesize - 1);
+	if (len < *lenp)
+		return (NULL);
+	flags = MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB;
+#ifdef MAP_HUGE_SHIFT
+	/* The page size, as its log 2, rather than the default one. */
+	flags |= (pagesize == ND_HUGE_1G ? 30 : 21) << MAP_HUGE_SHIFT;
+#else
+	if (pagesize != ND_HUGE_2M)
+		return (NULL);
+#endif
+	p = mmap(NULL, len, PROT_READ | PROT_WRITE, flags, -1, 0);
+	if (p == MAP_FAILED)
+		return (NULL);
+	*lenp = len;
+	return (p);
+}
+#endif
+
+#if defined(HAVE_MADVISE) && defined(MADV_HUGEPAGE)
+/*
+ * Map "*lenp" bytes, rounded up to and aligned on a 2MB boundary so that
+ * all of it can be transparent huge pages, and ask for them, or return
+ * NULL.
+ */
+static void *
+nd_big_map_thp(size_t *lenp)
+{
+	size_t len, lead;
+	u_char *p;
+
+	len = (*lenp + ND_HUGE_2M - 1) & ~(size_t)(ND_HUGE_2M - 1);
+	if (len < *lenp || len + ND_HUGE_2M < len)
+		return (NULL);
+	p = (u_char *)mmap(NULL, len + ND_HUGE_2M, PROT_READ | PROT_WRITE,
+	    MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if ((void *)p == MAP_FAILED)
+		return (NULL);
+	/* Give back what's before the boundary and after the end. */
+	lead = (ND_HUGE_2M - ((uintptr_t)p & (ND_HUGE_2M - 1))) &
+	    (ND_HUGE_2M - 1);
+	if (lead != 0)
+		(void)munmap(p, lead);
+	(void)munmap(p + lead + len, ND_HUGE_2M - lead);
+	p += lead;
+	(void)madvise(p, len, MADV_HUGEPAGE);
+	*lenp = len;
+	return (p);
+}
+#endif
+#endif /* _WIN32 */
+
+/*
+ * calloc() replacement for large, long-lived buffers; see
+ * netdissect-alloc.h.
+ */
+void *
+nd_big_calloc(size_t n, size_t size)
+{
+	struct nd_big_map *m;
+	size_t total, len;
+	void *p = NULL;
+	int kind = ND_BIG_CALLOC;
+
+	if (size != 0 && n > SIZE_MAX / size)
+		return (NULL);
+	total = n * size;
+	if (nd_big_policy == ND_PAGES_NORMAL || total < ND_BIG_ALLOC_MIN)
+		return (calloc(n, size));
+	m = (struct nd_big_map *)malloc(sizeof(*m));
+	if (m == NULL)
+		return (NULL);
+
+	len = total;
+#ifndef _WIN32
+#ifdef MAP_HUGETLB
+	if (nd_big_policy == ND_PAGES_1G)
+		p = nd_big_map_huge(&len, ND_HUGE_1G);
+	if (p == NULL && nd_big_policy >= ND_PAGES_2M)
+		p = nd_big_map_huge(&len, ND_HUGE_2M);
+	if (p != NULL)
+		kind = ND_BIG_HUGE;
+#endif
+#if defined(HAVE_MADVISE) && defined(MADV_HUGEPAGE)
+	if (p == NULL && (p = nd_big_map_thp(&len)) != NULL)
+		kind = ND_BIG_THP;
+#endif
+#endif /* _WIN32 */
+	if (p == NULL) {
+		len = total;
+		if ((p = calloc(n, size)) == NULL) {
+			free(m);
+			return (NULL);
+		}
+	}
+
+	m->addr = p;
+	m->len = len;
+	m->kind = kind;
+	pthread_mutex_lock(&nd_big_mtx);
+	m->next = nd_big_maps;
+	nd_big_maps = m;
+	switch (kind) {
+	case ND_BIG_HUGE:
+		nd_big_stats.nbs_huge_bytes += len;
+		break;
+	case ND_BIG_THP:
+		nd_big_stats.nbs_thp_bytes += len;
+		break;
+	default:
+		nd_big_stats.nbs_normal_bytes += len;
+		break;
+	}
+	/* Anything short of what was asked for. */
+	if (kind == ND_BIG_CALLOC ||
+	    (kind == ND_BIG_THP && nd_big_policy != ND_PAGES_THP))
+		nd_big_stats.nbs_fallbacks++;
+	pthread_mutex_unlock(&nd_big_mtx);
+	return (p);
+}
+
+/*
+ * Free what nd_big_calloc() returned.
+ */
+void
+nd_big_free(void *p)
+{
+	struct nd_big_map *m, **mp;
+
+	if (p == NULL)
+		return;
+	pthread_mutex_lock(&nd_big_mtx);
+	for (mp = &nd_big_maps; (m = *mp) != NULL; mp = &m->next)
+		if (m->addr == p)
+			break;
+	if (m != NULL) {
+		*mp = m->next;
+		switch (m->kind) {
+		case ND_BIG_HUGE:
+			nd_big_stats.nbs_huge_bytes -= m->len;
+			break;
+		case ND_BIG_THP:
+			nd_big_stats.nbs_thp_bytes -= m->len;
+			break;
+		default:
+			nd_big_stats.nbs_normal_bytes -= m->len;
+			break;
+		}
+	}
+	pthread_mutex_unlock(&nd_big_mtx);
+	if (m == NULL || m->kind == ND_BIG_CALLOC)
+		free(p);
+#ifndef _WIN32
+	else
+		(void)munmap(m->addr, m->len);
+#endif
+	free(m);
+}
+
+void
+nd_big_alloc_stats(struct nd_big_alloc_stats *nbs)
+{
+	pthread_mutex_lock(&nd_big_mtx);
+	*nbs = nd_big_stats;
+	pthread_mutex_unlock(&nd_big_mtx);
 }
@@ -26,8 +26,45 @@ typedef struct nd_mem_chunk {
 	/* variable size data */
 } nd_mem_chunk_t;
 
+/*
+ * Allocations made by nd_malloc() while printing a packet are carved
+ * out of a per-netdissect_options arena of ND_ARENA_SIZE bytes, which
+ * nd_free_all() empties; requests that don't fit get a chunk of their
+ * own from malloc().
+ */
+#define ND_ARENA_SIZE	65536
+#define ND_ARENA_ALIGN	16	/* at least the alignment malloc() gives */
+
 void nd_add_alloc_list(netdissect_options *, nd_mem_chunk_t *);
 void * nd_malloc(netdissect_options *, size_t);
 void nd_free_all(netdissect_options *);
 
+/*
+ * Rings, hash tables and other large buffers that live as long as the
+ * capture are allocated with nd_big_calloc(), which, if asked with
+ * nd_big_pages(), maps those of ND_BIG_ALLOC_MIN bytes or more with
+ * huge pages, to cut down on TLB misses; if no huge pages can be had it
+ * falls back to transparent huge pages, where the system has them, and
+ * then to calloc().  The memory is zeroed; nd_big_free() frees it,
+ * however it was allocated.
+ */
+#define ND_BIG_ALLOC_MIN	(1024 * 1024)
+
+#define ND_PAGES_NORMAL		0	/* calloc() */
+#define ND_PAGES_THP		1	/* madvise(MADV_HUGEPAGE) */
+#define ND_PAGES_2M		2	/* MAP_HUGETLB with 2MB pages */
+#define ND_PAGES_1G		3	/* MAP_HUGETLB with 1GB pages */
+
+struct nd_big_alloc_stats {
+	uint64_t nbs_huge_bytes;	/* mapped with MAP_HUGETLB */
+	uint64_t nbs_thp_bytes;		/* mapped for transparent huge pages */
+	uint64_t nbs_normal_bytes;	/* from calloc(), having fallen back */
+	uint64_t nbs_fallbacks;		/* allocations that got less than asked */
+};
+
+void nd_big_pages(int);
+void *nd_big_calloc(size_t, size_t);
+void nd_big_free(void *);
+void nd_big_alloc_stats(struct nd_big_alloc_stats *);
+
 #endif /* netdissect_alloc_h */
@@ -0,0 +1,255 @@
+/*
+ * Copyright (c) 2026 The TCPDUMP project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that: (1) source code
+ * distributions retain the above copyright notice and this paragraph
+ * in its entirety, and (2) distributions including binary code include
+ * the above copyright notice and this paragraph in its entirety in
+ * the documentation or other materials provided with the distribution.
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND
+ * WITHOUT ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, WITHOUT
+ * LIMITATION, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE.
+ */
+
+/*
+ * The contexts of netdissect-api.h.  Each wraps a netdissect_options
+ * whose output, error and warning routines hand everything to the
+ * context's callbacks; an error, which the dissectors expect not to
+ * return, longjmps back out of nd_dissect() instead of exiting.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <setjmp.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "netdissect-stdinc.h"
+
+#include "netdissect.h"
+#include "netdissect-api.h"
+#include "netdissect-alloc.h"
+#include "netdissect-state.h"
+#include "print.h"
+
+#include "pcap-missing.h"
+
+struct nd_context {
+	netdissect_options ndo;		/* first, so that an ndo is a context */
+	nd_output_fn output;
+	void *output_arg;
+	nd_message_fn message;
+	void *message_arg;
+	int dissecting;			/* in nd_dissect(), so error can be set */
+	jmp_buf error;
+};
+
+int
+nd_api_version(void)
+{
+	return (ND_API_VERSION);
+}
+
+static int
+api_output(netdissect_options *ndo, const char *buf, size_t len)
+{
+	nd_context *nd = (nd_context *)ndo;
+
+	if (nd->output == NULL)
+		return (0);
+	return ((*nd->output)(nd->output_arg, buf, len));
+}
+
+static void
+api_message(nd_context *nd, int is_error, const char *fmt, va_list ap)
+{
+	char msg[256];
+
+	if (nd->message == NULL)
+		return;
+	(void)vsnprintf(msg, sizeof(msg), fmt, ap);
+	(*nd->message)(nd->message_arg, is_error, msg);
+}
+
+/* VARARGS */
+static void NORETURN
+api_error(netdissect_options *ndo, status_exit_codes_t status _U_,
+	  const char *fmt, ...)
+{
+	nd_context *nd = (nd_context *)ndo;
+	va_list ap;
+
+	va_start(ap, fmt);
+	api_message(nd, 1, fmt, ap);
+	va_end(ap);
+	/*
+	 * Only dissection can get here; the other calls check for
+	 * their errors themselves.
+	 */
+	if (!nd->dissecting)
+		abort();
+	longjmp(nd->error, 1);
+}
+
+/* VARARGS */
+static void
+api_warning(netdissect_options *ndo, const char *fmt, ...)
+{
+	va_list ap;
+
+	va_start(ap, fmt);
+	api_message((nd_context *)ndo, 0, fmt, ap);
+	va_end(ap);
+}
+
+nd_context *
+nd_open(int dlt, int snaplen, char *errbuf, size_t errbuf_size)
+{
+	nd_context *nd;
+	netdissect_options *ndo;
+
+	if (nd_dispatch_init() == -1) {
+		snprintf(errbuf, errbuf_size, "nd_open: malloc");
+		return (NULL);
+	}
+	if (!has_printer(dlt)) {
+		snprintf(errbuf, errbuf_size,
+		    "packet printing is not supported for link type %d", dlt);
+		return (NULL);
+	}
+	nd = (nd_context *)calloc(1, sizeof(*nd));
+	if (nd == NULL) {
+		snprintf(errbuf, errbuf_size, "nd_open: calloc");
+		return (NULL);
+	}
+	ndo = &nd->ndo;
+	ndo_set_function_pointers(ndo);
+	ndo->ndo_output = api_output;
+	ndo->ndo_error = api_error;
+	ndo->ndo_warning = api_warning;
+	ndo->ndo_nflag = 1;
+	ndo->ndo_snaplen = snaplen > 0 && snaplen <= MAXIMUM_SNAPLEN ?
+	    snaplen : MAXIMUM_SNAPLEN;
+	ndo->ndo_if_printer = get_if_printer(ndo, dlt);
+	if (nd_outbuf_init(ndo, ND_OUTBUF_SIZE) == -1) {
+		free(nd);
+		snprintf(errbuf, errbuf_size, "nd_open: malloc");
+		return (NULL);
+	}
+	return (nd);
+}
+
+void
+nd_close(nd_context *nd)
+{
+	if (nd == NULL)
+		return;
+	nd_free_all(&nd->ndo);
+	nd_pop_all_packet_info(&nd->ndo);
+	nd_free_packet_info(&nd->ndo);
+	nd_state_free_all(&nd->ndo);
+	free(nd->ndo.ndo_arena);
+	free(nd->ndo.ndo_field_buf);
+	nd_outbuf_free(&nd->ndo);
+	free(nd);
+}
+
+void
+nd_set_output(nd_context *nd, nd_output_fn fn, void *arg)
+{
+	nd->output = fn;
+	nd->output_arg = arg;
+}
+
+void
+nd_set_messages(nd_context *nd, nd_message_fn fn, void *arg)
+{
+	nd->message = fn;
+	nd->message_arg = arg;
+}
+
+int
+nd_set_flag(nd_context *nd, int flag, int value)
+{
+	netdissect_options *ndo = &nd->ndo;
+
+	switch (flag) {
+
+	case 'A':
+		ndo->ndo_Aflag = value;
+		break;
+
+	case 'e':
+		ndo->ndo_eflag = value;
+		break;
+
+	case 'K':
+		ndo->ndo_Kflag = value;
+		break;
+
+	case 'q':
+		ndo->ndo_qflag = value;
+		break;
+
+	case 'S':
+		ndo->ndo_Sflag = value;
+		break;
+
+	case 't':
+		ndo->ndo_tflag = value;
+		break;
+
+	case 'v':
+		ndo->ndo_vflag = value;
+		break;
+
+	case 'x':
+		ndo->ndo_xflag = value;
+		break;
+
+	case 'X':
+		ndo->ndo_Xflag = value;
+		break;
+
+	default:
+		return (-1);
+	}
+	return (0);
+}
+
+int
+nd_dissect(nd_context *nd, const unsigned char *packet, unsigned int caplen,
+	   unsigned int len, time_t sec, unsigned int usec, unsigned int number)
+{
+	netdissect_options *ndo = &nd->ndo;
+	struct pcap_pkthdr h;
+
+	memset(&h, 0, sizeof(h));
+	h.ts.tv_sec = sec;
+	h.ts.tv_usec = usec;
+	h.caplen = caplen;
+	h.len = len;
+	ndo->ndo_packet_number = number != 0;
+	nd->dissecting = 1;
+	if (setjmp(nd->error) != 0) {
+		/*
+		 * Throw away the partly printed packet, and whatever
+		 * the printers had pushed or allocated for it.
+		 */
+		nd->dissecting = 0;
+		ndo->ndo_outbuf_len = 0;
+		nd_pop_all_packet_info(ndo);
+		nd_free_all(ndo);
+		return (-1);
+	}
+	pretty_print_packet(ndo, &h, packet, number);
+	nd->dissecting = 0;
+	return (0);
+}
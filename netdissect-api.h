@@ -0,0 +1,104 @@
+/*
+ * Copyright (c) 2026 The TCPDUMP project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that: (1) source code
+ * distributions retain the above copyright notice and this paragraph
+ * in its entirety, and (2) distributions including binary code include
+ * the above copyright notice and this paragraph in its entirety in
+ * the documentation or other materials provided with the distribution.
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND
+ * WITHOUT ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, WITHOUT
+ * LIMITATION, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE.
+ */
+
+#ifndef netdissect_api_h
+#define netdissect_api_h
+
+/*
+ * The interface for programs other than tcpdump that want packets
+ * dissected and printed the way tcpdump prints them.  This is the only
+ * libnetdissect header that gets installed, and it doesn't need
+ * config.h, pcap.h or any of the others; link with -lnetdissect and
+ * the libraries tcpdump itself is linked with.
+ *
+ * Call nd_init() once, then nd_open() a context for each stream of
+ * packets to be printed.  A context holds all the per-stream state,
+ * and its output, errors and warnings go to the callbacks given to it
+ * rather than to stdout and stderr.  Contexts can be used from
+ * different threads at the same time, as long as each is used by only
+ * one thread at a time.  The call caches and TCP sequence numbers are
+ * per context; the other caches the dissectors keep are per thread,
+ * shared by the contexts a thread uses, and last as long as the thread.
+ *
+ * Addresses and ports are always printed as numbers, so that nothing
+ * blocks on a name lookup.
+ */
+#include <stddef.h>
+#include <time.h>
+
+#define ND_API_VERSION	1
+
+typedef struct nd_context nd_context;
+
+/*
+ * Gets len bytes of printed output; returns -1, with errno set, if it
+ * couldn't take them, which makes nd_dissect() fail.
+ */
+typedef int (*nd_output_fn)(void *arg, const char *buf, size_t len);
+
+/* Gets an error (is_error != 0) or a warning, without a newline. */
+typedef void (*nd_message_fn)(void *arg, int is_error, const char *msg);
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+extern int nd_api_version(void);
+
+/*
+ * Process-wide setup and teardown; nd_init() returns -1, with a message
+ * in errbuf, if it fails.  The tables it and the first nd_open() build
+ * are only read after that.
+ */
+extern int nd_init(char *errbuf, size_t errbuf_size);
+extern void nd_cleanup(void);
+
+/*
+ * Returns a context for packets with the given DLT_ link-layer type and
+ * snapshot length (0 for the largest), or NULL, with a message in
+ * errbuf, if there's no printer for the type or no memory.
+ */
+extern nd_context *nd_open(int dlt, int snaplen, char *errbuf,
+    size_t errbuf_size);
+extern void nd_close(nd_context *);
+
+/* A NULL callback drops what would have gone to it. */
+extern void nd_set_output(nd_context *, nd_output_fn, void *arg);
+extern void nd_set_messages(nd_context *, nd_message_fn, void *arg);
+
+/*
+ * Sets one of the flags that the tcpdump option with the same letter
+ * sets: 'A', 'e', 'K', 'q', 'S', 't', 'v', 'x' or 'X'; value is the
+ * number of times the option would be given.  Returns -1 for any other
+ * letter.
+ */
+extern int nd_set_flag(nd_context *, int flag, int value);
+
+/*
+ * Prints one packet, with caplen of its len bytes captured at the time
+ * sec.usec; returns 0, or -1 if there was an error, which has already
+ * gone to the message callback.  The packet number is the one printed
+ * by '#' (0 for none).
+ */
+extern int nd_dissect(nd_context *, const unsigned char *packet,
+    unsigned int caplen, unsigned int len, time_t sec, unsigned int usec,
+    unsigned int number);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* netdissect_api_h */
@@ -0,0 +1,1012 @@
+/*
+ * Copyright (c) 2026 The TCPDUMP project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that: (1) source code
+ * distributions retain the above copyright notice and this paragraph
+ * in its entirety, and (2) distributions including binary code include
+ * the above copyright notice and this paragraph in its entirety in
+ * the documentation or other materials provided with the distribution.
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND
+ * WITHOUT ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, WITHOUT
+ * LIMITATION, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE.
+ */
+
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "netdissect-stdinc.h"
+#include "netdissect.h"
+#include "netdissect-fields.h"
+#include "addrtostr.h"
+#include "dfilter.h"
+#include "flows.h"
+#include "rates.h"
+#include "topn.h"
+
+#define NDF_FIELD_HDRLEN	5	/* protocol, field, type, length */
+#define NDF_RECORD_HDRLEN	4	/* length */
+
+#define NDJ_NO_LAYER		((u_int)-1)	/* nothing yet */
+#define NDJ_TOP_LEVEL		((u_int)-2)	/* after a top-level field */
+
+/*
+ * JSON names of the protocols and their fields, indexed by number.
+ */
+static const char *const ndj_proto_names[NDF_NPROTOS] = {
+	"frame", "ether", "ip", "ip6", "tcp", "udp", "icmp", "icmp6",
+	"domain", "vxlan", "vxlan_gpe", "geneve", "geneve_opt", "nsh",
+	"nflog", "sll2", "pktap", "tls", "mpls", "l2tp"
+};
+
+static const char *const ndj_field_names[NDF_NPROTOS][NDF_MAXFIELDS] = {
+	{ NULL, "ts_sec", "ts_frac", "caplen", "len", "invalid",
+	  "truncated", "community_id" },
+	{ NULL, "dst", "src", "type", "vlan" },
+	{ NULL, "src", "dst", "proto", "ttl", "len", "id", "tos", "off" },
+	{ NULL, "src", "dst", "nxt", "hlim", "plen", "flow" },
+	{ NULL, "sport", "dport", "seq", "ack", "flags", "win",
+	  "payload_len" },
+	{ NULL, "sport", "dport", "len" },
+	{ NULL, "type", "code" },
+	{ NULL, "type", "code" },
+	{ NULL, "id", "qr", "opcode", "rcode", "qdcount", "ancount",
+	  "nscount", "arcount", "qname", "qtype", "qclass", "latency" },
+	{ NULL, "flags", "vni" },
+	{ NULL, "flags", "vni", "next" },
+	{ NULL, "vni", "proto", "flags", "optlen" },
+	{ NULL, "class", "type", "len" },
+	{ NULL, "spi", "si", "md_type", "next", "flags" },
+	{ NULL, "family", "rid", "hook", "mark", "indev", "outdev",
+	  "physindev", "physoutdev", "prefix", "uid", "gid" },
+	{ NULL, "ifindex", "proto", "hatype", "pkttype", "addr" },
+	{ NULL, "dlt", "ifname", "flags", "pid", "cmdname", "svc_class",
+	  "epid", "ecmdname" },
+	{ NULL, "type", "version", "len", "handshake", "hello_version",
+	  "sni", "alpn", "cipher" },
+	{ NULL, "label", "exp", "ttl", "depth" },
+	{ NULL, "tunnel", "session", "msgtype", "result_code", "host_name",
+	  "assigned_tunnel", "assigned_session", "call_serial" }
+};
+
+static const char ndj_hex[] = "0123456789abcdef";
+
+static int	ndf_noprintf(netdissect_options *,
+		     FORMAT_STRING(const char *fmt), ...)
+		     PRINTFLIKE(2, 3);
+
+/* Text output is thrown away. */
+static int
+ndf_noprintf(netdissect_options *ndo _U_, const char *fmt _U_, ...)
+{
+	return (0);
+}
+
+/*
+ * Make room for "len" more bytes in the record being built.
+ */
+static void
+ndf_reserve(netdissect_options *ndo, size_t len)
+{
+	size_t size;
+	u_char *buf;
+
+	if (len <= ndo->ndo_field_size - ndo->ndo_field_len)
+		return;
+	size = ndo->ndo_field_size != 0 ? ndo->ndo_field_size : 1024;
+	while (len > size - ndo->ndo_field_len)
+		size *= 2;
+	buf = (u_char *)realloc(ndo->ndo_field_buf, size);
+	if (buf == NULL)
+		(*ndo->ndo_error)(ndo, S_ERR_ND_MEM_ALLOC,
+				  "ndf_reserve: realloc");
+	ndo->ndo_field_buf = buf;
+	ndo->ndo_field_size = size;
+}
+
+/*
+ * The encoder: append the field to the current record.
+ */
+static void
+ndf_encode(netdissect_options *ndo, u_int proto, u_int field, u_int type,
+	   const u_char *val, u_int len)
+{
+	u_char *p;
+
+	if (len > 0xffff)
+		len = 0xffff;
+	ndf_reserve(ndo, NDF_FIELD_HDRLEN + len);
+	p = ndo->ndo_field_buf + ndo->ndo_field_len;
+	p[0] = (u_char)proto;
+	p[1] = (u_char)field;
+	p[2] = (u_char)type;
+	p[3] = (u_char)(len >> 8);
+	p[4] = (u_char)len;
+	memcpy(p + NDF_FIELD_HDRLEN, val, len);
+	ndo->ndo_field_len += NDF_FIELD_HDRLEN + len;
+}
+
+/*
+ * Append "len" bytes to the record being built.
+ */
+static void
+ndf_put(netdissect_options *ndo, const void *p, size_t len)
+{
+	ndf_reserve(ndo, len);
+	memcpy(ndo->ndo_field_buf + ndo->ndo_field_len, p, len);
+	ndo->ndo_field_len += len;
+}
+
+#define ndf_puts(ndo, s)	ndf_put((ndo), (s), strlen(s))
+
+/*
+ * Append "v" in decimal.
+ */
+static void
+ndj_uint(netdissect_options *ndo, uint64_t v)
+{
+	char buf[20];
+	char *p = buf + sizeof(buf);
+
+	do {
+		*--p = (char)('0' + v % 10);
+		v /= 10;
+	} while (v != 0);
+	ndf_put(ndo, p, buf + sizeof(buf) - p);
+}
+
+/*
+ * Append "len" bytes of "s" as a JSON string.  Runs of characters
+ * that need no escaping are copied in one go; control characters,
+ * quotes, backslashes and anything outside printable ASCII are
+ * escaped, so the output is always valid UTF-8.
+ */
+static void
+ndj_string(netdissect_options *ndo, const u_char *s, u_int len)
+{
+	const u_char *end = s + len;
+	const u_char *run;
+	u_char *p;
+	u_char c;
+
+	/* Worst case: every byte becomes \u00XX. */
+	ndf_reserve(ndo, 2 + 6 * (size_t)len);
+	p = ndo->ndo_field_buf + ndo->ndo_field_len;
+	*p++ = '"';
+	while (s < end) {
+		run = s;
+		while (s < end && (c = *s) >= 0x20 && c < 0x7f &&
+		    c != '"' && c != '\\')
+			s++;
+		memcpy(p, run, s - run);
+		p += s - run;
+		if (s == end)
+			break;
+		c = *s++;
+		*p++ = '\\';
+		switch (c) {
+		case '"':
+		case '\\':
+			*p++ = c;
+			break;
+		case '\n':
+			*p++ = 'n';
+			break;
+		case '\r':
+			*p++ = 'r';
+			break;
+		case '\t':
+			*p++ = 't';
+			break;
+		default:
+			*p++ = 'u';
+			*p++ = '0';
+			*p++ = '0';
+			*p++ = ndj_hex[c >> 4];
+			*p++ = ndj_hex[c & 0x0f];
+			break;
+		}
+	}
+	*p++ = '"';
+	ndo->ndo_field_len = p - ndo->ndo_field_buf;
+}
+
+/*
+ * Append an address as a string: dotted quad for 4 bytes, the usual
+ * IPv6 notation for 16, and colon-separated hex otherwise (MAC
+ * addresses).
+ */
+static void
+ndj_addr(netdissect_options *ndo, const u_char *a, u_int len)
+{
+	char buf[INET6_ADDRSTRLEN];
+	u_char *p;
+	u_int i, b;
+
+	if (len == 16) {
+		ndf_puts(ndo, "\"");
+		ndf_puts(ndo, addrtostr6(a, buf, sizeof(buf)));
+		ndf_puts(ndo, "\"");
+		return;
+	}
+	ndf_reserve(ndo, 2 + 4 * (size_t)len);
+	p = ndo->ndo_field_buf + ndo->ndo_field_len;
+	*p++ = '"';
+	for (i = 0; i < len; i++) {
+		b = a[i];
+		if (len == 4) {
+			if (i != 0)
+				*p++ = '.';
+			if (b >= 100)
+				*p++ = (u_char)('0' + b / 100);
+			if (b >= 10)
+				*p++ = (u_char)('0' + b / 10 % 10);
+			*p++ = (u_char)('0' + b % 10);
+		} else {
+			if (i != 0)
+				*p++ = ':';
+			*p++ = ndj_hex[b >> 4];
+			*p++ = ndj_hex[b & 0x0f];
+		}
+	}
+	*p++ = '"';
+	ndo->ndo_field_len = p - ndo->ndo_field_buf;
+}
+
+/*
+ * The JSON encoder: append the field to the current line, opening a
+ * new object if it belongs to a different layer than the last one.
+ * Frame fields reported once the layers have started (the protocol
+ * that was truncated, the Community ID) go at the top level rather
+ * than into a second frame object.
+ */
+static void
+ndj_field(netdissect_options *ndo, u_int proto, u_int field, u_int type,
+	  const u_char *val, u_int len)
+{
+	const char *name;
+	uint64_t v;
+	u_int i;
+
+	if (proto == NDF_FRAME && ndo->ndo_field_layer != NDF_FRAME &&
+	    ndo->ndo_field_layers[NDF_FRAME] != 0) {
+		if (ndo->ndo_field_layer != NDJ_TOP_LEVEL)
+			ndf_puts(ndo, "}");
+		ndf_puts(ndo, ",\"");
+		ndo->ndo_field_layer = NDJ_TOP_LEVEL;
+	} else if (proto != ndo->ndo_field_layer) {
+		if (ndo->ndo_field_layer == NDJ_TOP_LEVEL)
+			ndf_puts(ndo, ",");
+		else if (ndo->ndo_field_layer != NDJ_NO_LAYER)
+			ndf_puts(ndo, "},");
+		ndf_puts(ndo, "\"");
+		if (proto < NDF_NPROTOS) {
+			ndf_puts(ndo, ndj_proto_names[proto]);
+			if (++ndo->ndo_field_layers[proto] > 1) {
+				ndf_puts(ndo, "_");
+				ndj_uint(ndo, ndo->ndo_field_layers[proto]);
+			}
+		} else {
+			ndf_puts(ndo, "proto");
+			ndj_uint(ndo, proto);
+		}
+		ndf_puts(ndo, "\":{\"");
+		ndo->ndo_field_layer = proto;
+	} else
+		ndf_puts(ndo, ",\"");
+	name = NULL;
+	if (proto < NDF_NPROTOS && field < NDF_MAXFIELDS)
+		name = ndj_field_names[proto][field];
+	if (name != NULL)
+		ndf_puts(ndo, name);
+	else {
+		ndf_puts(ndo, "field");
+		ndj_uint(ndo, field);
+	}
+	ndf_puts(ndo, "\":");
+
+	switch (type) {
+	case NDF_T_UINT:
+		v = 0;
+		for (i = 0; i < len && i < 8; i++)
+			v = (v << 8) | val[i];
+		ndj_uint(ndo, v);
+		break;
+	case NDF_T_ADDR:
+		ndj_addr(ndo, val, len);
+		break;
+	default:
+		ndj_string(ndo, val, len);
+		break;
+	}
+}
+
+/*
+ * Per-protocol counters.  Entries are kept in the order they were
+ * first seen, with an open-addressed hash of the names (holding
+ * index + 1, 0 meaning empty) to find them, and an array of indices
+ * that's put in descending order of packet count when reporting.
+ */
+struct ndst_entry {
+	const char *name;
+	uint64_t packets;
+	uint64_t bytes;
+	u_int serial;		/* packet that was last counted */
+};
+
+/*
+ * Per-VNI and per-metadata counters, each in an open-addressed hash of
+ * its own, keyed by what's counted and its value, and put in
+ * descending order of packet count when reporting.
+ */
+struct ndst_key {
+	uint64_t key;		/* 0 means empty */
+	uint64_t packets;
+	uint64_t bytes;
+	u_int serial;		/* packet that was last counted */
+};
+
+struct ndst_keys {
+	struct ndst_key *slots;
+	u_int *order;		/* of the used slots */
+	u_int n;
+	u_int size;		/* slots, a power of 2 */
+};
+
+/*
+ * The metadata fields counted, with their names in the report; the key
+ * is the index in this table + 1 in the upper 32 bits and the value in
+ * the lower.
+ */
+static const struct {
+	u_int proto;
+	u_int field;
+	const char *name;
+} ndst_meta_fields[] = {
+	{ NDF_NFLOG, NDF_NFLOG_MARK, "nflog mark" },
+	{ NDF_NFLOG, NDF_NFLOG_INDEV, "nflog indev" },
+	{ NDF_NFLOG, NDF_NFLOG_OUTDEV, "nflog outdev" },
+	{ NDF_SLL2, NDF_SLL2_IFINDEX, "sll2 ifindex" },
+};
+#define NDST_META_FIELDS \
+	(sizeof(ndst_meta_fields) / sizeof(ndst_meta_fields[0]))
+
+struct nd_proto_stats {
+	struct ndst_entry *entries;
+	u_int *order;
+	u_int nentries;
+	u_int size;		/* entries allocated */
+	u_int *hash;
+	u_int hashsize;		/* a power of 2 */
+	struct ndst_keys vnis;	/* protocol << 24 | VNI */
+	u_int vni_serial;	/* packet whose VNI was last counted */
+	struct ndst_keys metas;
+	u_int serial;		/* number of the current packet */
+	u_int len;		/* its length on the wire */
+	uint64_t packets;
+	uint64_t bytes;
+};
+
+static u_int
+ndst_hash(const char *name)
+{
+	u_int h = 2166136261U;
+
+	while (*name != '\0')
+		h = (h ^ (u_char)*name++) * 16777619U;
+	return (h);
+}
+
+static u_int
+ndst_hash_key(uint64_t key64)
+{
+	uint32_t key;
+
+	key = (uint32_t)(key64 ^ key64 >> 32);
+	key ^= key >> 16;
+	key *= 0x85ebca6bU;
+	key ^= key >> 13;
+	return (key);
+}
+
+static void
+ndst_rehash(netdissect_options *ndo, struct nd_proto_stats *st)
+{
+	u_int size, i, j;
+	u_int *hash;
+
+	size = st->hashsize != 0 ? st->hashsize * 2 : 64;
+	hash = (u_int *)calloc(size, sizeof(*hash));
+	if (hash == NULL)
+		(*ndo->ndo_error)(ndo, S_ERR_ND_MEM_ALLOC,
+				  "ndst_rehash: calloc");
+	for (i = 0; i < st->nentries; i++) {
+		j = ndst_hash(st->entries[i].name) & (size - 1);
+		while (hash[j] != 0)
+			j = (j + 1) & (size - 1);
+		hash[j] = i + 1;
+	}
+	free(st->hash);
+	st->hash = hash;
+	st->hashsize = size;
+}
+
+/*
+ * Count the current packet against "name", once however many times
+ * it turns up in the packet.
+ */
+static void
+ndst_count(netdissect_options *ndo, const char *name)
+{
+	struct nd_proto_stats *st = ndo->ndo_stats;
+	struct ndst_entry *e;
+	u_int i, size;
+
+	if (name == NULL || *name == '\0')
+		return;
+	if (st->nentries * 2 >= st->hashsize)
+		ndst_rehash(ndo, st);
+	i = ndst_hash(name) & (st->hashsize - 1);
+	while (st->hash[i] != 0) {
+		e = &st->entries[st->hash[i] - 1];
+		if (strcmp(e->name, name) == 0)
+			goto found;
+		i = (i + 1) & (st->hashsize - 1);
+	}
+	if (st->nentries == st->size) {
+		size = st->size != 0 ? st->size * 2 : 32;
+		e = (struct ndst_entry *)realloc(st->entries,
+		    size * sizeof(*e));
+		if (e == NULL)
+			(*ndo->ndo_error)(ndo, S_ERR_ND_MEM_ALLOC,
+					  "ndst_count: realloc");
+		st->entries = e;
+		st->order = (u_int *)realloc(st->order,
+		    size * sizeof(*st->order));
+		if (st->order == NULL)
+			(*ndo->ndo_error)(ndo, S_ERR_ND_MEM_ALLOC,
+					  "ndst_count: realloc");
+		st->size = size;
+	}
+	st->order[st->nentries] = st->nentries;
+	e = &st->entries[st->nentries++];
+	st->hash[i] = st->nentries;
+	e->name = name;
+	e->packets = 0;
+	e->bytes = 0;
+	e->serial = st->serial - 1;
+found:
+	if (e->serial == st->serial)
+		return;
+	e->serial = st->serial;
+	e->packets++;
+	e->bytes += st->len;
+}
+
+static void
+ndst_keys_rehash(netdissect_options *ndo, struct ndst_keys *kt)
+{
+	struct ndst_key *slots;
+	u_int *order;
+	u_int size, i, j;
+
+	size = kt->size != 0 ? kt->size * 2 : 64;
+	slots = (struct ndst_key *)calloc(size, sizeof(*slots));
+	order = (u_int *)calloc(size / 2, sizeof(*order));
+	if (slots == NULL || order == NULL)
+		(*ndo->ndo_error)(ndo, S_ERR_ND_MEM_ALLOC,
+				  "ndst_keys_rehash: calloc");
+	for (i = 0; i < kt->n; i++) {
+		j = ndst_hash_key(kt->slots[kt->order[i]].key) & (size - 1);
+		while (slots[j].key != 0)
+			j = (j + 1) & (size - 1);
+		slots[j] = kt->slots[kt->order[i]];
+		order[i] = j;
+	}
+	free(kt->slots);
+	free(kt->order);
+	kt->slots = slots;
+	kt->order = order;
+	kt->size = size;
+}
+
+/*
+ * Count the current packet against "key", once however many times
+ * it turns up in the packet.
+ */
+static void
+ndst_keys_count(netdissect_options *ndo, struct ndst_keys *kt, uint64_t key)
+{
+	struct nd_proto_stats *st = ndo->ndo_stats;
+	struct ndst_key *k;
+	u_int i;
+
+	if (kt->n * 2 >= kt->size)
+		ndst_keys_rehash(ndo, kt);
+	i = ndst_hash_key(key) & (kt->size - 1);
+	while (kt->slots[i].key != key) {
+		if (kt->slots[i].key == 0) {
+			kt->slots[i].key = key;
+			kt->slots[i].serial = st->serial - 1;
+			kt->order[kt->n++] = i;
+			break;
+		}
+		i = (i + 1) & (kt->size - 1);
+	}
+	k = &kt->slots[i];
+	if (k->serial == st->serial)
+		return;
+	k->serial = st->serial;
+	k->packets++;
+	k->bytes += st->len;
+}
+
+/*
+ * Put the used slots in descending order of packet count.  Insertion
+ * sort; the order rarely changes much between calls.
+ */
+static void
+ndst_keys_sort(struct ndst_keys *kt)
+{
+	u_int i, j, t;
+
+	for (i = 1; i < kt->n; i++) {
+		t = kt->order[i];
+		for (j = i; j != 0 &&
+		    kt->slots[kt->order[j - 1]].packets <
+		    kt->slots[t].packets; j--)
+			kt->order[j] = kt->order[j - 1];
+		kt->order[j] = t;
+	}
+}
+
+static uint64_t
+ndst_val(const u_char *val, u_int len)
+{
+	uint64_t v;
+	u_int i;
+
+	v = 0;
+	for (i = 0; i < len; i++)
+		v = v << 8 | val[i];
+	return (v);
+}
+
+/*
+ * Count the current packet against the VNI "val" of the tunnel
+ * protocol "proto", if it's the packet's outermost tunnel.
+ */
+static void
+ndst_vni_count(netdissect_options *ndo, u_int proto, const u_char *val,
+	       u_int len)
+{
+	struct nd_proto_stats *st = ndo->ndo_stats;
+
+	if (st->vni_serial == st->serial || len == 0 || len > 4)
+		return;
+	st->vni_serial = st->serial;
+	ndst_keys_count(ndo, &st->vnis,
+	    (uint64_t)proto << 24 | (ndst_val(val, len) & 0xffffff));
+}
+
+/*
+ * Count the current packet against the value of a metadata field, if
+ * it's one of those in ndst_meta_fields[].
+ */
+static void
+ndst_meta_count(netdissect_options *ndo, u_int proto, u_int field,
+		const u_char *val, u_int len)
+{
+	u_int i;
+
+	if (len == 0 || len > 4)
+		return;
+	for (i = 0; i < NDST_META_FIELDS; i++) {
+		if (ndst_meta_fields[i].proto == proto &&
+		    ndst_meta_fields[i].field == field) {
+			ndst_keys_count(ndo, &ndo->ndo_stats->metas,
+			    (uint64_t)(i + 1) << 32 | ndst_val(val, len));
+			return;
+		}
+	}
+}
+
+/*
+ * The counter: each protocol that reports fields is a layer of the
+ * packet.
+ */
+static void
+ndst_field(netdissect_options *ndo, u_int proto, u_int field,
+	   u_int type _U_, const u_char *val, u_int len)
+{
+	if ((proto == NDF_VXLAN && field == NDF_VXLAN_VNI) ||
+	    (proto == NDF_VXLAN_GPE && field == NDF_VXLAN_GPE_VNI) ||
+	    (proto == NDF_GENEVE && field == NDF_GENEVE_VNI))
+		ndst_vni_count(ndo, proto, val, len);
+	else if (proto == NDF_NFLOG || proto == NDF_SLL2)
+		ndst_meta_count(ndo, proto, field, val, len);
+	if (proto == NDF_FRAME || proto == ndo->ndo_field_layer ||
+	    proto >= NDF_NPROTOS)
+		return;
+	ndo->ndo_field_layer = proto;
+	ndst_count(ndo, ndj_proto_names[proto]);
+}
+
+/*
+ * Switch "ndo" from text to binary records, and write the stream
+ * header.  Returns -1 if the header couldn't be written.
+ */
+int
+nd_field_output_init(netdissect_options *ndo)
+{
+	ndo->ndo_field = ndf_encode;
+	ndo->ndo_printf = ndf_noprintf;
+	ndo->ndo_field_buf = NULL;
+	ndo->ndo_field_len = 0;
+	ndo->ndo_field_size = 0;
+	return ((*ndo->ndo_output)(ndo, NDF_MAGIC, sizeof(NDF_MAGIC) - 1));
+}
+
+/*
+ * Switch "ndo" from text to NDJSON, one line per packet.
+ */
+void
+nd_json_output_init(netdissect_options *ndo)
+{
+	ndo->ndo_field = ndj_field;
+	ndo->ndo_printf = ndf_noprintf;
+	ndo->ndo_field_buf = NULL;
+	ndo->ndo_field_len = 0;
+	ndo->ndo_field_size = 0;
+}
+
+/*
+ * Switch "ndo" from text to counting packets and bytes by protocol.
+ */
+void
+nd_stats_output_init(netdissect_options *ndo)
+{
+	ndo->ndo_field = ndst_field;
+	ndo->ndo_printf = ndf_noprintf;
+	ndo->ndo_stats = (struct nd_proto_stats *)calloc(1,
+	    sizeof(*ndo->ndo_stats));
+	if (ndo->ndo_stats == NULL)
+		(*ndo->ndo_error)(ndo, S_ERR_ND_MEM_ALLOC,
+				  "nd_stats_output_init: calloc");
+}
+
+/*
+ * Switch "ndo" from text to adding packets, or if "collect" is set the
+ * flows reported by sFlow and NetFlow exporters, up by flow, and
+ * writing a record, in "format", for each flow.
+ */
+void
+nd_flows_output_init(netdissect_options *ndo, int format, u_int flows,
+		     u_int active, u_int idle, int collect)
+{
+	ndo->ndo_field = nd_flows_field;
+	ndo->ndo_printf = ndf_noprintf;
+	ndo->ndo_flows = nd_flows_new(ndo, format, flows, active, idle,
+				      collect);
+}
+
+/*
+ * Switch "ndo" from text to working out PTP clock offsets and path
+ * delays, with ptp_stats_report() writing them.
+ */
+void
+nd_ptp_output_init(netdissect_options *ndo)
+{
+	ndo->ndo_printf = ndf_noprintf;
+	ndo->ndo_ptp_stats = 1;
+}
+
+/*
+ * Keep the text, but only for the packets that match the display
+ * filter "df".
+ */
+void
+nd_dfilter_output_init(netdissect_options *ndo, struct nd_dfilter *df)
+{
+	ndo->ndo_field = nd_dfilter_field;
+	ndo->ndo_dfilter = df;
+	ndo->ndo_dfilter_verdict = ND_DFILTER_IDLE;
+}
+
+/*
+ * Switch "ndo" from text to counting the busiest addresses, ports and
+ * protocols, and writing the top "n" of each every "interval" seconds.
+ */
+void
+nd_topn_output_init(netdissect_options *ndo, u_int n, u_int interval,
+		    int clear)
+{
+	ndo->ndo_field = nd_topn_field;
+	ndo->ndo_printf = ndf_noprintf;
+	ndo->ndo_topn = nd_topn_new(ndo, n, interval, clear);
+}
+
+/*
+ * Switch "ndo" from text to adding up the packets and bytes of each
+ * "interval" seconds, and writing them in "format".
+ */
+void
+nd_rates_output_init(netdissect_options *ndo, int format, u_int interval)
+{
+	ndo->ndo_field = nd_rates_field;
+	ndo->ndo_printf = ndf_noprintf;
+	ndo->ndo_rates = nd_rates_new(ndo, format, interval);
+}
+
+/*
+ * Call "fn" for each protocol counted so far, busiest first, after
+ * one for all packets with a NULL name.  Doesn't allocate memory, so
+ * it can be used from a signal handler.
+ */
+void
+nd_stats_foreach(netdissect_options *ndo, nd_stats_fn fn, void *arg)
+{
+	struct nd_proto_stats *st = ndo->ndo_stats;
+	u_int i, j, t;
+
+	if (st == NULL)
+		return;
+	(*fn)(arg, NULL, st->packets, st->bytes);
+	/*
+	 * Insertion sort; the order rarely changes much between calls.
+	 */
+	for (i = 1; i < st->nentries; i++) {
+		t = st->order[i];
+		for (j = i; j != 0 &&
+		    st->entries[st->order[j - 1]].packets <
+		    st->entries[t].packets; j--)
+			st->order[j] = st->order[j - 1];
+		st->order[j] = t;
+	}
+	for (i = 0; i < st->nentries; i++)
+		(*fn)(arg, st->entries[st->order[i]].name,
+		    st->entries[st->order[i]].packets,
+		    st->entries[st->order[i]].bytes);
+}
+
+/*
+ * Call "fn" for each VNI counted so far, busiest first, with the name
+ * of its tunnel protocol.  Like nd_stats_foreach(), doesn't allocate
+ * memory.
+ */
+void
+nd_stats_vni_foreach(netdissect_options *ndo, nd_stats_vni_fn fn, void *arg)
+{
+	struct nd_proto_stats *st = ndo->ndo_stats;
+	const struct ndst_key *k;
+	u_int i;
+
+	if (st == NULL)
+		return;
+	ndst_keys_sort(&st->vnis);
+	for (i = 0; i < st->vnis.n; i++) {
+		k = &st->vnis.slots[st->vnis.order[i]];
+		(*fn)(arg, ndj_proto_names[k->key >> 24],
+		    (uint32_t)(k->key & 0xffffff), k->packets, k->bytes);
+	}
+}
+
+/*
+ * Call "fn" for each NFLOG mark and NFLOG or SLL2 interface index
+ * counted so far, busiest first, with the name of what it is, such as
+ * "nflog mark".  Doesn't allocate memory either.
+ */
+void
+nd_stats_meta_foreach(netdissect_options *ndo, nd_stats_meta_fn fn,
+		      void *arg)
+{
+	struct nd_proto_stats *st = ndo->ndo_stats;
+	const struct ndst_key *k;
+	u_int i;
+
+	if (st == NULL)
+		return;
+	ndst_keys_sort(&st->metas);
+	for (i = 0; i < st->metas.n; i++) {
+		k = &st->metas.slots[st->metas.order[i]];
+		(*fn)(arg, ndst_meta_fields[(k->key >> 32) - 1].name,
+		    (uint32_t)k->key, k->packets, k->bytes);
+	}
+}
+
+/*
+ * Report an unsigned integer in as few bytes as it fits in: 1, 2, 4
+ * or 8.
+ */
+void
+nd_field_uint(netdissect_options *ndo, u_int proto, u_int field,
+	      uint64_t v)
+{
+	u_char buf[8];
+	u_int len, i;
+
+	if (v <= 0xff)
+		len = 1;
+	else if (v <= 0xffff)
+		len = 2;
+	else if (v <= 0xffffffff)
+		len = 4;
+	else
+		len = 8;
+	for (i = len; i != 0; i--) {
+		buf[i - 1] = (u_char)v;
+		v >>= 8;
+	}
+	(*ndo->ndo_field)(ndo, proto, field, NDF_T_UINT, buf, len);
+}
+
+/*
+ * Report "len" bytes of the packet at "p", if they were captured.
+ */
+void
+nd_field_bytes(netdissect_options *ndo, u_int proto, u_int field,
+	       u_int type, const u_char *p, u_int len)
+{
+	if (!ND_TTEST_LEN(p, len))
+		return;
+	(*ndo->ndo_field)(ndo, proto, field, type, p, len);
+}
+
+/*
+ * Report a string of at most "size" bytes, ending at the first NUL if
+ * there is one; an empty one is left out.
+ */
+void
+nd_field_nstring(netdissect_options *ndo, u_int proto, u_int field,
+		 const u_char *p, u_int size)
+{
+	const u_char *nul;
+
+	if (!ND_TTEST_LEN(p, size))
+		return;
+	nul = (const u_char *)memchr(p, '\0', size);
+	if (nul != NULL)
+		size = (u_int)(nul - p);
+	if (size != 0)
+		(*ndo->ndo_field)(ndo, proto, field, NDF_T_STRING, p, size);
+}
+
+/*
+ * Start the record for a packet, with its pcap header fields.
+ */
+void
+nd_field_begin(netdissect_options *ndo, const struct pcap_pkthdr *h)
+{
+	ndo->ndo_field_len = 0;
+	if (ndo->ndo_field == ndf_encode) {
+		ndf_reserve(ndo, NDF_RECORD_HDRLEN);
+		ndo->ndo_field_len = NDF_RECORD_HDRLEN;
+	} else if (ndo->ndo_field == ndj_field) {
+		ndf_puts(ndo, "{");
+		ndo->ndo_field_layer = NDJ_NO_LAYER;
+		memset(ndo->ndo_field_layers, 0,
+		    sizeof(ndo->ndo_field_layers));
+	} else if (ndo->ndo_field == ndst_field) {
+		ndo->ndo_stats->serial++;
+		ndo->ndo_stats->len = h->len;
+		ndo->ndo_stats->packets++;
+		ndo->ndo_stats->bytes += h->len;
+		ndo->ndo_field_layer = NDF_FRAME;
+		return;
+	} else if (ndo->ndo_field == nd_flows_field) {
+		nd_flows_begin(ndo, h->len);
+		return;
+	} else if (ndo->ndo_field == nd_topn_field) {
+		nd_topn_begin(ndo, h->len);
+		return;
+	} else if (ndo->ndo_field == nd_rates_field) {
+		nd_rates_begin(ndo, h->len);
+		return;
+	} else if (ndo->ndo_field == nd_dfilter_field)
+		nd_dfilter_begin(ndo);
+	else
+		return;
+	nd_field_uint(ndo, NDF_FRAME, NDF_FRAME_TS_SEC,
+	    (uint64_t)(uint32_t)h->ts.tv_sec);
+	nd_field_uint(ndo, NDF_FRAME, NDF_FRAME_TS_FRAC,
+	    (uint64_t)h->ts.tv_usec);
+	nd_field_uint(ndo, NDF_FRAME, NDF_FRAME_CAPLEN, h->caplen);
+	nd_field_uint(ndo, NDF_FRAME, NDF_FRAME_LEN, h->len);
+}
+
+/*
+ * Finish the packet's record and hand it to the output.
+ */
+void
+nd_field_end(netdissect_options *ndo)
+{
+	size_t len;
+
+	if (ndo->ndo_field == ndst_field) {
+		/*
+		 * The last protocol to be dissected, if it didn't report
+		 * any fields itself.
+		 */
+		ndst_count(ndo, ndo->ndo_protocol);
+		return;
+	}
+	if (ndo->ndo_field == nd_flows_field) {
+		nd_flows_end(ndo);
+		return;
+	}
+	if (ndo->ndo_field == nd_topn_field) {
+		nd_topn_end(ndo);
+		return;
+	}
+	if (ndo->ndo_field == nd_rates_field) {
+		nd_rates_end(ndo);
+		return;
+	}
+	if (ndo->ndo_field_len == 0)
+		return;
+	if (ndo->ndo_field == ndj_field) {
+		if (ndo->ndo_field_layer != NDJ_NO_LAYER &&
+		    ndo->ndo_field_layer != NDJ_TOP_LEVEL)
+			ndf_puts(ndo, "}");
+		ndf_puts(ndo, "}\n");
+		nd_outbuf_write(ndo, (const char *)ndo->ndo_field_buf,
+		    ndo->ndo_field_len);
+		ndo->ndo_field_len = 0;
+		return;
+	}
+	if (ndo->ndo_field != ndf_encode)
+		return;
+	len = ndo->ndo_field_len - NDF_RECORD_HDRLEN;
+	ndo->ndo_field_buf[0] = (u_char)(len >> 24);
+	ndo->ndo_field_buf[1] = (u_char)(len >> 16);
+	ndo->ndo_field_buf[2] = (u_char)(len >> 8);
+	ndo->ndo_field_buf[3] = (u_char)len;
+	nd_outbuf_write(ndo, (const char *)ndo->ndo_field_buf,
+	    ndo->ndo_field_len);
+	ndo->ndo_field_len = 0;
+}
+
+/*
+ * Look up a field by its JSON name, "proto.field", of "len" bytes at
+ * "name", or a protocol by its name alone, for which *fieldp is set
+ * to 0.  Returns -1 if there's no such field or protocol.
+ */
+int
+nd_field_lookup(const char *name, size_t len, u_int *protop, u_int *fieldp)
+{
+	const char *dot, *fname;
+	size_t plen, flen;
+	u_int proto, field;
+
+	dot = (const char *)memchr(name, '.', len);
+	plen = dot != NULL ? (size_t)(dot - name) : len;
+	for (proto = 0; proto < NDF_NPROTOS; proto++) {
+		if (strlen(ndj_proto_names[proto]) == plen &&
+		    memcmp(ndj_proto_names[proto], name, plen) == 0)
+			break;
+	}
+	if (proto == NDF_NPROTOS)
+		return (-1);
+	*protop = proto;
+	if (dot == NULL) {
+		*fieldp = 0;
+		return (0);
+	}
+	flen = len - plen - 1;
+	for (field = 1; field < NDF_MAXFIELDS; field++) {
+		fname = ndj_field_names[proto][field];
+		if (fname != NULL && strlen(fname) == flen &&
+		    memcmp(fname, dot + 1, flen) == 0) {
+			*fieldp = field;
+			return (0);
+		}
+	}
+	return (-1);
+}
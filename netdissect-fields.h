@@ -0,0 +1,311 @@
+/*
+ * Copyright (c) 2026 The TCPDUMP project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that: (1) source code
+ * distributions retain the above copyright notice and this paragraph
+ * in its entirety, and (2) distributions including binary code include
+ * the above copyright notice and this paragraph in its entirety in
+ * the documentation or other materials provided with the distribution.
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND
+ * WITHOUT ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, WITHOUT
+ * LIMITATION, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE.
+ */
+
+#ifndef netdissect_fields_h
+#define netdissect_fields_h
+
+#include "netdissect-stdinc.h"
+#include "netdissect.h"
+
+/*
+ * Structured output.  When ndo->ndo_field is set (--field-output),
+ * printers report the fields they decode through it as well as
+ * printing them; nd_field_output_init() points it at an encoder that
+ * writes each packet as one length-prefixed binary record, and turns
+ * the text output off.
+ *
+ * The stream starts with the 4 bytes "NDF" 0x01.  Each record is a
+ * 4-byte big-endian length followed by that many bytes of fields, each
+ * of which is
+ *
+ *	1 byte	protocol (NDF_FRAME, ...)
+ *	1 byte	field, numbered per protocol (NDF_IP_SRC, ...)
+ *	1 byte	type (NDF_T_UINT, NDF_T_ADDR or NDF_T_STRING)
+ *	2 bytes	length of the value, big-endian
+ *	value:	an unsigned integer in that many bytes, big-endian;
+ *		an address in network byte order; or a string without
+ *		a terminating NUL.
+ *
+ * New protocols and fields may be added, but numbers are never reused.
+ *
+ * nd_json_output_init() instead points it at an encoder that writes
+ * each packet as one line of JSON (NDJSON), with an object per layer
+ * named for the protocol, holding its fields by name, e.g.
+ *
+ *	{"frame":{"ts_sec":...},"ether":{...},"ip":{"src":"10.0.0.1",...}}
+ *
+ * Integers are JSON numbers and addresses are strings in their usual
+ * notation.  A protocol that appears again, as in a tunnel, gets its
+ * count appended to its name: "ip", then "ip_2".  "truncated", which
+ * is only known once the layers have been reported, is a top-level
+ * member.
+ *
+ * nd_stats_output_init() (--stats-only) points it at a counter that
+ * adds each packet to the totals for the protocols that report fields
+ * and for the last one dissected (ndo->ndo_protocol); they're read
+ * back with nd_stats_foreach().  It also adds each packet sent over
+ * VXLAN, VXLAN-GPE or Geneve to the totals for the VNI of its
+ * outermost tunnel, read back with nd_stats_vni_foreach(), and each
+ * NFLOG or SLL2 packet to the totals for its mark and interface
+ * indexes, read back with nd_stats_meta_foreach().
+ *
+ * nd_flows_output_init() (--flows) points it at the flow table of
+ * flows.c, which adds each packet to its flow and writes flow records
+ * rather than packets.
+ *
+ * nd_topn_output_init() (--top) points it at the sketches of topn.c,
+ * which count the busiest addresses, ports and protocols and write a
+ * table of them every interval rather than packets.
+ *
+ * nd_rates_output_init() (--rates) points it at the counters of
+ * rates.c, which add up the packets and bytes of each interval by
+ * protocol, VLAN and MPLS label and write them as a time series.
+ *
+ * nd_ptp_output_init() (--ptp-stats) only throws the text away, and
+ * has the PTP printer time the delay request-response exchanges rather
+ * than print them, for ptp_stats_report() to write.
+ *
+ * nd_dfilter_output_init() (--display-filter) points it at the display
+ * filter of dfilter.c, and leaves the text on: the printers print as
+ * usual, and the filter's verdict on the fields decides whether the
+ * packet's text is kept.
+ */
+#define NDF_MAGIC		"NDF\001"
+
+/* Types */
+#define NDF_T_UINT		1
+#define NDF_T_ADDR		2
+#define NDF_T_STRING		3
+
+/* Protocols, and their fields */
+#define NDF_FRAME		0
+#define NDF_FRAME_TS_SEC	1
+#define NDF_FRAME_TS_FRAC	2	/* micro- or nanoseconds */
+#define NDF_FRAME_CAPLEN	3
+#define NDF_FRAME_LEN		4
+#define NDF_FRAME_INVALID	5	/* header failed the sanity checks */
+#define NDF_FRAME_TRUNCATED	6	/* string: protocol that was cut off */
+#define NDF_FRAME_COMMUNITY_ID	7	/* string: --community-id flow hash */
+
+#define NDF_ETHER		1
+#define NDF_ETHER_DST		1
+#define NDF_ETHER_SRC		2
+#define NDF_ETHER_TYPE		3
+#define NDF_ETHER_VLAN		4
+
+#define NDF_IP			2
+#define NDF_IP_SRC		1
+#define NDF_IP_DST		2
+#define NDF_IP_PROTO		3
+#define NDF_IP_TTL		4
+#define NDF_IP_LEN		5
+#define NDF_IP_ID		6
+#define NDF_IP_TOS		7
+#define NDF_IP_OFF		8
+
+#define NDF_IP6			3
+#define NDF_IP6_SRC		1
+#define NDF_IP6_DST		2
+#define NDF_IP6_NXT		3
+#define NDF_IP6_HLIM		4
+#define NDF_IP6_PLEN		5
+#define NDF_IP6_FLOW		6
+
+#define NDF_TCP			4
+#define NDF_TCP_SPORT		1
+#define NDF_TCP_DPORT		2
+#define NDF_TCP_SEQ		3
+#define NDF_TCP_ACK		4
+#define NDF_TCP_FLAGS		5
+#define NDF_TCP_WIN		6
+#define NDF_TCP_PAYLOAD_LEN	7
+
+#define NDF_UDP			5
+#define NDF_UDP_SPORT		1
+#define NDF_UDP_DPORT		2
+#define NDF_UDP_LEN		3
+
+#define NDF_ICMP		6
+#define NDF_ICMP_TYPE		1
+#define NDF_ICMP_CODE		2
+
+#define NDF_ICMP6		7
+#define NDF_ICMP6_TYPE		1
+#define NDF_ICMP6_CODE		2
+
+#define NDF_DOMAIN		8
+#define NDF_DOMAIN_ID		1
+#define NDF_DOMAIN_QR		2	/* 1 for a response */
+#define NDF_DOMAIN_OPCODE	3
+#define NDF_DOMAIN_RCODE	4	/* from the header only */
+#define NDF_DOMAIN_QDCOUNT	5
+#define NDF_DOMAIN_ANCOUNT	6
+#define NDF_DOMAIN_NSCOUNT	7
+#define NDF_DOMAIN_ARCOUNT	8
+#define NDF_DOMAIN_QNAME	9	/* string: the first question's name */
+#define NDF_DOMAIN_QTYPE	10
+#define NDF_DOMAIN_QCLASS	11
+#define NDF_DOMAIN_LATENCY	12	/* microseconds, with --latency-report */
+
+#define NDF_VXLAN		9
+#define NDF_VXLAN_FLAGS		1
+#define NDF_VXLAN_VNI		2
+
+#define NDF_VXLAN_GPE		10
+#define NDF_VXLAN_GPE_FLAGS	1
+#define NDF_VXLAN_GPE_VNI	2
+#define NDF_VXLAN_GPE_NEXT	3	/* next protocol */
+
+#define NDF_GENEVE		11
+#define NDF_GENEVE_VNI		1
+#define NDF_GENEVE_PROTO	2	/* Ethertype */
+#define NDF_GENEVE_FLAGS	3
+#define NDF_GENEVE_OPTLEN	4	/* bytes of options */
+
+#define NDF_GENEVE_OPT		12	/* each option, as a layer of its own */
+#define NDF_GENEVE_OPT_CLASS	1
+#define NDF_GENEVE_OPT_TYPE	2
+#define NDF_GENEVE_OPT_LEN	3	/* bytes, with the option header */
+
+#define NDF_NSH			13
+#define NDF_NSH_SPI		1	/* service path identifier */
+#define NDF_NSH_SI		2	/* service index */
+#define NDF_NSH_MD_TYPE		3
+#define NDF_NSH_NEXT		4	/* next protocol */
+#define NDF_NSH_FLAGS		5
+
+#define NDF_NFLOG		14	/* the NFLOG header and its TLVs */
+#define NDF_NFLOG_FAMILY	1
+#define NDF_NFLOG_RID		2	/* resource ID */
+#define NDF_NFLOG_HOOK		3
+#define NDF_NFLOG_MARK		4
+#define NDF_NFLOG_INDEV		5	/* ifindex */
+#define NDF_NFLOG_OUTDEV	6
+#define NDF_NFLOG_PHYSINDEV	7
+#define NDF_NFLOG_PHYSOUTDEV	8
+#define NDF_NFLOG_PREFIX	9	/* string: the log prefix */
+#define NDF_NFLOG_UID		10
+#define NDF_NFLOG_GID		11
+
+#define NDF_SLL2		15
+#define NDF_SLL2_IFINDEX	1
+#define NDF_SLL2_PROTO		2	/* Ethertype */
+#define NDF_SLL2_HATYPE		3
+#define NDF_SLL2_PKTTYPE	4
+#define NDF_SLL2_ADDR		5
+
+#define NDF_PKTAP		16
+#define NDF_PKTAP_DLT		1
+#define NDF_PKTAP_IFNAME	2	/* string */
+#define NDF_PKTAP_FLAGS		3
+#define NDF_PKTAP_PID		4
+#define NDF_PKTAP_CMDNAME	5	/* string */
+#define NDF_PKTAP_SVC_CLASS	6
+#define NDF_PKTAP_EPID		7
+#define NDF_PKTAP_ECMDNAME	8	/* string */
+
+#define NDF_TLS			17	/* the first record of a segment */
+#define NDF_TLS_TYPE		1	/* content type */
+#define NDF_TLS_VERSION		2	/* of the record */
+#define NDF_TLS_LEN		3	/* of the record */
+#define NDF_TLS_HANDSHAKE	4	/* the first handshake message type */
+#define NDF_TLS_HELLO_VERSION	5	/* offered or chosen */
+#define NDF_TLS_SNI		6	/* string: the server name */
+#define NDF_TLS_ALPN		7	/* string: first offered, or chosen */
+#define NDF_TLS_CIPHER		8	/* chosen by the server */
+
+#define NDF_MPLS		18	/* the label stack */
+#define NDF_MPLS_LABEL		1	/* of the top entry */
+#define NDF_MPLS_EXP		2	/* of the top entry */
+#define NDF_MPLS_TTL		3	/* of the top entry */
+#define NDF_MPLS_DEPTH		4	/* entries in the stack */
+
+#define NDF_L2TP		19	/* the header and control AVPs */
+#define NDF_L2TP_TUNNEL		1
+#define NDF_L2TP_SESSION	2
+#define NDF_L2TP_MSGTYPE	3	/* of a control message */
+#define NDF_L2TP_RESULT_CODE	4
+#define NDF_L2TP_HOST_NAME	5	/* string */
+#define NDF_L2TP_ASSND_TUN_ID	6	/* assigned tunnel ID */
+#define NDF_L2TP_ASSND_SESS_ID	7	/* assigned session ID */
+#define NDF_L2TP_CALL_SER_NUM	8	/* call serial number */
+
+#define NDF_NPROTOS		20	/* at most 32; see ndo_field_layers */
+#define NDF_MAXFIELDS		13	/* fields of a protocol, + 1 */
+
+extern int nd_field_output_init(netdissect_options *);
+extern void nd_json_output_init(netdissect_options *);
+typedef void (*nd_stats_fn)(void *, const char *, uint64_t, uint64_t);
+
+extern void nd_stats_output_init(netdissect_options *);
+extern void nd_stats_foreach(netdissect_options *, nd_stats_fn, void *);
+typedef void (*nd_stats_vni_fn)(void *, const char *, uint32_t, uint64_t,
+				uint64_t);
+
+extern void nd_stats_vni_foreach(netdissect_options *, nd_stats_vni_fn,
+				 void *);
+typedef void (*nd_stats_meta_fn)(void *, const char *, uint32_t, uint64_t,
+				 uint64_t);
+
+extern void nd_stats_meta_foreach(netdissect_options *, nd_stats_meta_fn,
+				  void *);
+extern void nd_flows_output_init(netdissect_options *, int, u_int, u_int,
+				 u_int, int);
+extern void nd_topn_output_init(netdissect_options *, u_int, u_int, int);
+extern void nd_rates_output_init(netdissect_options *, int, u_int);
+extern void nd_ptp_output_init(netdissect_options *);
+struct nd_dfilter;
+extern void nd_dfilter_output_init(netdissect_options *, struct nd_dfilter *);
+extern void nd_field_uint(netdissect_options *, u_int, u_int, uint64_t);
+extern void nd_field_bytes(netdissect_options *, u_int, u_int, u_int,
+			   const u_char *, u_int);
+extern void nd_field_nstring(netdissect_options *, u_int, u_int,
+			     const u_char *, u_int);
+extern void nd_field_begin(netdissect_options *, const struct pcap_pkthdr *);
+extern void nd_field_end(netdissect_options *);
+extern int nd_field_lookup(const char *, size_t, u_int *, u_int *);
+
+/*
+ * Report a field, if anyone's listening.  Addresses must be in the
+ * packet buffer; ones that weren't captured are left out.
+ */
+#define ND_FIELD_UINT(proto, field, v) \
+	do { \
+		if (ndo->ndo_field != NULL) \
+			nd_field_uint(ndo, (proto), (field), (v)); \
+	} while (0)
+#define ND_FIELD_ADDR(proto, field, p, len) \
+	do { \
+		if (ndo->ndo_field != NULL) \
+			nd_field_bytes(ndo, (proto), (field), NDF_T_ADDR, \
+			    (const u_char *)(p), (len)); \
+	} while (0)
+#define ND_FIELD_STRING(proto, field, s) \
+	do { \
+		if (ndo->ndo_field != NULL) \
+			(*ndo->ndo_field)(ndo, (proto), (field), \
+			    NDF_T_STRING, (const u_char *)(s), \
+			    (u_int)strlen(s)); \
+	} while (0)
+/* A string in a fixed-size field of the packet, NUL-padded or not. */
+#define ND_FIELD_NSTRING(proto, field, s, size) \
+	do { \
+		if (ndo->ndo_field != NULL) \
+			nd_field_nstring(ndo, (proto), (field), \
+			    (const u_char *)(s), (size)); \
+	} while (0)
+
+#endif /* netdissect_fields_h */
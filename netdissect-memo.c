@@ -0,0 +1,326 @@
+/*
+ * Copyright (c) 2026 The TCPDUMP project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that: (1) source code
+ * distributions retain the above copyright notice and this paragraph
+ * in its entirety, and (2) distributions including binary code include
+ * the above copyright notice and this paragraph in its entirety in
+ * the documentation or other materials provided with the distribution.
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND
+ * WITHOUT ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, WITHOUT
+ * LIMITATION, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE.
+ */
+
+/*
+ * The entries are kept in a table of a fixed size, in buckets of
+ * ND_MEMO_WAYS, as for --dedup; a new entry takes the slot of its
+ * bucket that was used the longest ago.  Each entry holds the packet,
+ * with the ignored bytes zeroed, and its text, so a hash collision
+ * is never taken for a match, at the cost of a compare on every hit.
+ *
+ * nd_memo_replay() is called once the time stamp has been printed; if
+ * it doesn't print the packet, it leaves the packet's key, and where
+ * its text starts in the output buffer, for nd_memo_record() to use
+ * once the packet has been dissected.  The text is only remembered if
+ * it's all still in the output buffer, that is if the buffer wasn't
+ * written out in the middle of it.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include "netdissect-stdinc.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "netdissect.h"
+#include "netdissect-alloc.h"
+#include "netdissect-memo.h"
+
+#define MEMO_MUL	0x9e3779b97f4a7c15ULL
+
+struct nd_memo_entry {
+	uint64_t hash;			/* 0 = unused */
+	uint64_t used;			/* the memo's tick when last used */
+	const char *printer;		/* ndo_if_printer_name */
+	u_int	flags;			/* memo_flags() */
+	u_int	caplen;
+	u_int	len;
+	u_int	hdrlen;			/* what the printer returned */
+	u_int	first;			/* the packet it was printed for */
+	u_int	count;			/* times it's been seen */
+	u_int	textlen;
+	u_char	data[ND_MEMO_MAX_CAPLEN];
+	char	text[ND_MEMO_MAX_TEXT];
+};
+
+struct nd_memo {
+	struct nd_memo_entry *entries;
+	u_int	nentries;
+	u_int	mask;			/* of the buckets */
+	u_int	mode;
+	struct nd_memo_ignore ignore[ND_MEMO_MAX_IGNORE];
+	u_int	nignore;
+	uint64_t tick;
+	struct nd_memo_stats stats;
+
+	/* The packet being dissected, left by nd_memo_replay(). */
+	int	pending;
+	struct nd_memo_entry *match;	/* ND_MEMO_VERIFY: its entry */
+	uint64_t hash;
+	const char *printer;
+	u_int	flags;
+	u_int	caplen;
+	u_int	len;
+	size_t	text_start;
+	uint64_t outbuf_writes;
+	u_char	key[ND_MEMO_MAX_CAPLEN];
+};
+
+/*
+ * Add "len" bytes at "p" to the hash "h", a word at a time.
+ */
+static uint64_t
+memo_hash(uint64_t h, const u_char *p, u_int len)
+{
+	uint64_t w;
+
+	for (; len >= 8; p += 8, len -= 8) {
+		memcpy(&w, p, 8);
+		h = (h ^ w) * MEMO_MUL;
+		h ^= h >> 29;
+	}
+	if (len != 0) {
+		w = 0;
+		memcpy(&w, p, len);
+		h = (h ^ w ^ (uint64_t)len << 56) * MEMO_MUL;
+		h ^= h >> 29;
+	}
+	return (h);
+}
+
+/*
+ * The flags that change what the printers print, which can change while
+ * capturing, with --degrade or through the control socket.
+ */
+static u_int
+memo_flags(const netdissect_options *ndo)
+{
+	return ((u_int)(ndo->ndo_vflag & 0xff) |
+	    (u_int)(ndo->ndo_qflag & 0x3) << 8 |
+	    (u_int)(ndo->ndo_eflag & 0x3) << 10 |
+	    (u_int)(ndo->ndo_nflag & 0x3) << 12 |
+	    (u_int)(ndo->ndo_Nflag & 0x3) << 14 |
+	    (u_int)(ndo->ndo_Sflag != 0) << 16 |
+	    (u_int)(ndo->ndo_Kflag != 0) << 17 |
+	    (u_int)(ndo->ndo_fflag != 0) << 18 |
+	    (u_int)(ndo->ndo_bflag != 0) << 19 |
+	    (u_int)(ndo->ndo_uflag != 0) << 20 |
+	    (u_int)(ndo->ndo_Hflag != 0) << 21 |
+	    (u_int)(ndo->ndo_check_outgoing != 0) << 22);
+}
+
+/*
+ * Make a memo of "entries" entries, rounded up to a power of 2, that
+ * works as "mode" says, leaving out the "nignore" byte ranges of
+ * "ignore" when comparing packets.
+ */
+struct nd_memo *
+nd_memo_new(u_int entries, u_int mode, const struct nd_memo_ignore *ignore,
+	    u_int nignore)
+{
+	struct nd_memo *m;
+	u_int n;
+
+	if (nignore > ND_MEMO_MAX_IGNORE)
+		return (NULL);
+	for (n = ND_MEMO_WAYS; n < entries && n <= UINT_MAX / 2; n <<= 1)
+		;
+	m = (struct nd_memo *)calloc(1, sizeof(*m));
+	if (m == NULL)
+		return (NULL);
+	m->entries = (struct nd_memo_entry *)nd_big_calloc(n,
+	    sizeof(*m->entries));
+	if (m->entries == NULL) {
+		free(m);
+		return (NULL);
+	}
+	m->nentries = n;
+	m->mask = n / ND_MEMO_WAYS - 1;
+	m->mode = mode;
+	if (nignore != 0)
+		memcpy(m->ignore, ignore, nignore * sizeof(*ignore));
+	m->nignore = nignore;
+	return (m);
+}
+
+/*
+ * Make an empty memo that works like "m", for another ndo.
+ */
+struct nd_memo *
+nd_memo_dup(const struct nd_memo *m)
+{
+	return (nd_memo_new(m->nentries, m->mode, m->ignore, m->nignore));
+}
+
+void
+nd_memo_stats(const struct nd_memo *m, struct nd_memo_stats *nms)
+{
+	*nms = m->stats;
+}
+
+void
+nd_memo_free(struct nd_memo *m)
+{
+	nd_big_free(m->entries);
+	free(m);
+}
+
+/*
+ * If a packet just like the one at "sp" was printed before, print what
+ * was printed for it then, set "*hdrlenp" to the length its link-layer
+ * printer returned and return 1.  Otherwise, return 0, and remember the
+ * packet for nd_memo_record().
+ */
+int
+nd_memo_replay(netdissect_options *ndo, const struct pcap_pkthdr *h,
+	       const u_char *sp, u_int *hdrlenp)
+{
+	struct nd_memo *m = ndo->ndo_memo;
+	struct nd_memo_entry *b, *e;
+	const struct nd_memo_ignore *mi;
+	uint64_t hash;
+	u_int caplen = h->caplen;
+	u_int i, n;
+
+	m->pending = 0;
+	if (caplen > ND_MEMO_MAX_CAPLEN || ndo->ndo_outbuf == NULL) {
+		m->stats.nms_skipped++;
+		return (0);
+	}
+	memcpy(m->key, sp, caplen);
+	for (i = 0; i < m->nignore; i++) {
+		mi = &m->ignore[i];
+		if (mi->nmi_offset >= caplen)
+			continue;
+		n = caplen - mi->nmi_offset;
+		memset(m->key + mi->nmi_offset, 0,
+		    mi->nmi_len < n ? mi->nmi_len : n);
+	}
+	m->printer = ndo->ndo_if_printer_name;
+	m->flags = memo_flags(ndo);
+	m->caplen = caplen;
+	m->len = h->len;
+	hash = memo_hash(MEMO_MUL, (const u_char *)&m->printer,
+	    sizeof(m->printer));
+	hash = memo_hash(hash, (const u_char *)&m->flags, sizeof(m->flags));
+	hash = memo_hash(hash, (const u_char *)&m->len, sizeof(m->len));
+	hash = memo_hash(hash, m->key, caplen);
+	hash ^= hash >> 32;
+	if (hash == 0)
+		hash = 1;
+	m->hash = hash;
+
+	m->match = NULL;
+	b = &m->entries[(hash & m->mask) * ND_MEMO_WAYS];
+	for (i = 0; i < ND_MEMO_WAYS; i++) {
+		e = &b[i];
+		if (e->hash == hash && e->printer == m->printer &&
+		    e->flags == m->flags && e->caplen == caplen &&
+		    e->len == m->len && memcmp(e->data, m->key, caplen) == 0) {
+			m->match = e;
+			break;
+		}
+	}
+	if (m->match != NULL && m->mode != ND_MEMO_VERIFY) {
+		e = m->match;
+		e->used = ++m->tick;
+		e->count++;
+		m->stats.nms_hits++;
+		if (m->mode == ND_MEMO_COMPACT)
+			ND_PRINT("repeated x%u of packet %u", e->count,
+			    e->first);
+		else
+			nd_outbuf_write(ndo, e->text, e->textlen);
+		*hdrlenp = e->hdrlen;
+		return (1);
+	}
+	m->pending = 1;
+	m->text_start = ndo->ndo_outbuf_len;
+	m->outbuf_writes = ndo->ndo_outbuf_writes;
+	return (0);
+}
+
+/*
+ * The packet left by nd_memo_replay() has been printed, and its link-
+ * layer printer returned "hdrlen"; remember what was printed for it,
+ * as packet "packet_number", or, with ND_MEMO_VERIFY, check it against
+ * what was remembered.
+ */
+void
+nd_memo_record(netdissect_options *ndo, u_int hdrlen, u_int packet_number)
+{
+	struct nd_memo *m = ndo->ndo_memo;
+	struct nd_memo_entry *b, *e;
+	size_t textlen;
+	u_int i;
+
+	if (!m->pending)
+		return;
+	m->pending = 0;
+	if (ndo->ndo_outbuf_writes != m->outbuf_writes ||
+	    ndo->ndo_outbuf_len < m->text_start ||
+	    ndo->ndo_outbuf_len - m->text_start > ND_MEMO_MAX_TEXT) {
+		m->stats.nms_skipped++;
+		return;
+	}
+	textlen = ndo->ndo_outbuf_len - m->text_start;
+
+	if ((e = m->match) != NULL) {
+		e->used = ++m->tick;
+		e->count++;
+		m->stats.nms_hits++;
+		if (textlen != e->textlen || e->hdrlen != hdrlen ||
+		    memcmp(e->text, ndo->ndo_outbuf + m->text_start,
+		    textlen) != 0) {
+			/* Keep the latest, as it'd be printed now. */
+			m->stats.nms_mismatches++;
+			memcpy(e->text, ndo->ndo_outbuf + m->text_start,
+			    textlen);
+			e->textlen = (u_int)textlen;
+			e->hdrlen = hdrlen;
+		}
+		return;
+	}
+
+	b = &m->entries[(m->hash & m->mask) * ND_MEMO_WAYS];
+	e = b;
+	for (i = 0; i < ND_MEMO_WAYS; i++) {
+		if (b[i].hash == 0) {
+			e = &b[i];
+			break;
+		}
+		if (b[i].used < e->used)
+			e = &b[i];
+	}
+	if (e->hash != 0)
+		m->stats.nms_evicted++;
+	m->stats.nms_misses++;
+	e->hash = m->hash;
+	e->used = ++m->tick;
+	e->printer = m->printer;
+	e->flags = m->flags;
+	e->caplen = m->caplen;
+	e->len = m->len;
+	e->hdrlen = hdrlen;
+	e->first = packet_number;
+	e->count = 1;
+	e->textlen = (u_int)textlen;
+	memcpy(e->data, m->key, m->caplen);
+	memcpy(e->text, ndo->ndo_outbuf + m->text_start, textlen);
+}
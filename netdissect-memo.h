@@ -0,0 +1,80 @@
+/*
+ * Copyright (c) 2026 The TCPDUMP project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that: (1) source code
+ * distributions retain the above copyright notice and this paragraph
+ * in its entirety, and (2) distributions including binary code include
+ * the above copyright notice and this paragraph in its entirety in
+ * the documentation or other materials provided with the distribution.
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND
+ * WITHOUT ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, WITHOUT
+ * LIMITATION, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE.
+ */
+
+#ifndef netdissect_memo_h
+#define netdissect_memo_h
+
+/*
+ * Remembering what was printed for a packet (--memo), so that a packet
+ * just like it, such as the next keepalive, hello or beacon, is printed
+ * from that rather than dissected again.
+ *
+ * Packets are alike if they're for the same link-layer printer, with
+ * the same flags that change what's printed (-v, -q, -e, -n and so
+ * on), the same captured length and length, and the same bytes, apart
+ * from those at the --memo-ignore offsets.  What's remembered is what
+ * pretty_print_packet() printed after the time stamp and interface
+ * name, up to the hex or ASCII dump, which is always done afresh.
+ *
+ * Only packets of up to ND_MEMO_MAX_CAPLEN bytes whose text took up no
+ * more than ND_MEMO_MAX_TEXT bytes are remembered; each ndo has its
+ * own memo, and nd_memo_dup() makes an empty one like it for another.
+ *
+ * Printers whose output depends on earlier packets, such as TCP's
+ * relative sequence numbers or NFS's matching of replies to calls,
+ * can print something different for the same bytes; ND_MEMO_VERIFY
+ * dissects every packet anyway and counts the ones whose text didn't
+ * match what was remembered.  Anything that's fed by the printers,
+ * such as the summaries, only sees the packets that were dissected.
+ */
+#define ND_MEMO_COPY		0	/* print the remembered text */
+#define ND_MEMO_COMPACT		1	/* print "repeated xN of packet P" */
+#define ND_MEMO_VERIFY		2	/* dissect, and compare the text */
+
+#define ND_MEMO_DEFAULT_ENTRIES	4096	/* a power of 2, of ND_MEMO_WAYS */
+#define ND_MEMO_WAYS		4
+#define ND_MEMO_MAX_CAPLEN	512
+#define ND_MEMO_MAX_TEXT	2048
+#define ND_MEMO_MAX_IGNORE	16
+
+/* Bytes left out of the comparison, such as a sequence number. */
+struct nd_memo_ignore {
+	u_int nmi_offset;
+	u_int nmi_len;
+};
+
+struct nd_memo_stats {
+	uint64_t nms_hits;		/* printed from the memo */
+	uint64_t nms_misses;		/* dissected, and remembered */
+	uint64_t nms_skipped;		/* too big, or not remembered */
+	uint64_t nms_evicted;		/* to make room for another */
+	uint64_t nms_mismatches;	/* ND_MEMO_VERIFY: text differed */
+};
+
+struct nd_memo;
+
+extern struct nd_memo *nd_memo_new(u_int, u_int,
+    const struct nd_memo_ignore *, u_int);
+extern struct nd_memo *nd_memo_dup(const struct nd_memo *);
+extern void nd_memo_stats(const struct nd_memo *, struct nd_memo_stats *);
+extern void nd_memo_free(struct nd_memo *);
+
+/* For pretty_print_packet(). */
+extern int nd_memo_replay(netdissect_options *, const struct pcap_pkthdr *,
+    const u_char *, u_int *);
+extern void nd_memo_record(netdissect_options *, u_int, u_int);
+
+#endif /* netdissect_memo_h */
@@ -0,0 +1,82 @@
+/*
+ * Copyright (c) 2026 The TCPDUMP project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that: (1) source code
+ * distributions retain the above copyright notice and this paragraph
+ * in its entirety, and (2) distributions including binary code include
+ * the above copyright notice and this paragraph in its entirety in
+ * the documentation or other materials provided with the distribution.
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND
+ * WITHOUT ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, WITHOUT
+ * LIMITATION, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE.
+ */
+
+/*
+ * Loading dissector plugins; see netdissect-plugin.h.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdio.h>
+
+#include "netdissect-stdinc.h"
+
+#ifdef HAVE_DLOPEN
+#include <dlfcn.h>
+#endif
+
+#include "netdissect.h"
+#include "netdissect-plugin.h"
+
+#ifdef HAVE_DLOPEN
+int
+nd_load_plugin(const char *path, char *errbuf, size_t errbuf_size)
+{
+	const struct nd_plugin *p;
+	void *handle;
+
+	handle = dlopen(path, RTLD_NOW | RTLD_LOCAL);
+	if (handle == NULL) {
+		(void)snprintf(errbuf, errbuf_size, "%s", dlerror());
+		return (-1);
+	}
+	p = (const struct nd_plugin *)dlsym(handle, ND_PLUGIN_SYMBOL);
+	if (p == NULL) {
+		(void)snprintf(errbuf, errbuf_size,
+		    "%s: not a dissector plugin", path);
+		(void)dlclose(handle);
+		return (-1);
+	}
+	if (p->version != ND_PLUGIN_VERSION ||
+	    p->ndo_size != sizeof(netdissect_options)) {
+		(void)snprintf(errbuf, errbuf_size,
+		    "%s: built for a different version of tcpdump", path);
+		(void)dlclose(handle);
+		return (-1);
+	}
+	if (p->init == NULL || (*p->init)() == -1) {
+		(void)snprintf(errbuf, errbuf_size,
+		    "%s: plugin %s couldn't register its dissectors", path,
+		    p->name != NULL ? p->name : "(unnamed)");
+		/*
+		 * Some of its dissectors may have been registered, so
+		 * it has to stay loaded.
+		 */
+		return (-1);
+	}
+	return (0);
+}
+#else
+int
+nd_load_plugin(const char *path, char *errbuf, size_t errbuf_size)
+{
+	(void)snprintf(errbuf, errbuf_size,
+	    "%s: dissector plugins aren't supported on this platform", path);
+	return (-1);
+}
+#endif
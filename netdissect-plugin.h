@@ -0,0 +1,77 @@
+/*
+ * Copyright (c) 2026 The TCPDUMP project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that: (1) source code
+ * distributions retain the above copyright notice and this paragraph
+ * in its entirety, and (2) distributions including binary code include
+ * the above copyright notice and this paragraph in its entirety in
+ * the documentation or other materials provided with the distribution.
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND
+ * WITHOUT ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, WITHOUT
+ * LIMITATION, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE.
+ */
+
+#ifndef netdissect_plugin_h
+#define netdissect_plugin_h
+
+#include "netdissect-stdinc.h"
+#include "netdissect.h"
+#include "portdispatch.h"
+
+/*
+ * Dissector plugins.  A plugin is a shared object, built against the
+ * same headers as the tcpdump that loads it, that defines an nd_plugin
+ * with ND_PLUGIN(); its init routine registers its dissectors with
+ * nd_register_ethertype(), nd_register_ipproto() and
+ * nd_register_port(), and returns 0, or -1 if it can't.  Its printers
+ * are called like the built-in ones, so they use the GET_ macros,
+ * ND_PRINT() and the field routines, e.g.
+ *
+ *	static int
+ *	foo_print(netdissect_options *ndo, const u_char *bp, u_int len,
+ *	    const struct port_info *pi)
+ *	{
+ *		ndo->ndo_protocol = "foo";
+ *		ND_PRINT("FOO op %u", GET_U_1(bp));
+ *		return (1);
+ *	}
+ *
+ *	static const struct port_dissector foo = { "foo", foo_print };
+ *
+ *	static int
+ *	foo_init(void)
+ *	{
+ *		return (nd_register_port(IPPROTO_UDP, 7777, 7777,
+ *		    PORT_EITHER, &foo));
+ *	}
+ *
+ *	ND_PLUGIN("foo", foo_init);
+ *
+ * The plugin's dissectors are kept, not copied, and it is never
+ * unloaded.  nd_load_plugin() is called after nd_dispatch_init() and
+ * before any packets are dissected; it returns -1, with a message in
+ * "errbuf", if the plugin can't be loaded, was built for a different
+ * ND_PLUGIN_VERSION or netdissect_options, or its init routine fails.
+ */
+#define ND_PLUGIN_VERSION	1
+
+struct nd_plugin {
+	u_int version;		/* ND_PLUGIN_VERSION */
+	size_t ndo_size;	/* sizeof(netdissect_options) */
+	const char *name;
+	int (*init)(void);
+};
+
+#define ND_PLUGIN_SYMBOL	"nd_plugin"
+
+#define ND_PLUGIN(name, init) \
+	const struct nd_plugin nd_plugin = { \
+		ND_PLUGIN_VERSION, sizeof(netdissect_options), (name), (init) \
+	}
+
+extern int nd_load_plugin(const char *, char *, size_t);
+
+#endif /* netdissect_plugin_h */
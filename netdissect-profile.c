@@ -0,0 +1,452 @@
+/*
+ * Copyright (c) 2026 The TCPDUMP project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that: (1) source code
+ * distributions retain the above copyright notice and this paragraph
+ * in its entirety, and (2) distributions including binary code include
+ * the above copyright notice and this paragraph in its entirety in
+ * the documentation or other materials provided with the distribution.
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND
+ * WITHOUT ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, WITHOUT
+ * LIMITATION, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "netdissect-stdinc.h"
+#include "netdissect.h"
+#include "netdissect-profile.h"
+
+/*
+ * There are a few hundred dissectors in the tables, so a fixed-size
+ * hash of their names is plenty; ones that don't fit aren't counted.
+ */
+#define NDP_SLOTS	1024	/* a power of 2 */
+#define NDP_MAX_ENTRIES	(NDP_SLOTS / 2)
+#define NDP_DEPTH	32	/* calls tracked; deeper ones aren't timed */
+
+struct ndp_entry {
+	const char *name;
+	uint64_t calls;
+	uint64_t total_ns;
+	uint64_t self_ns;
+	uint64_t truncated;
+};
+
+struct ndp_frame {
+	struct ndp_entry *e;
+	uint64_t start;
+	uint64_t child_ns;	/* time spent in calls made from this one */
+};
+
+struct nd_profile {
+	struct ndp_entry slots[NDP_SLOTS];
+	struct ndp_entry *entries[NDP_MAX_ENTRIES];	/* for reporting */
+	u_int nentries;
+	struct ndp_frame stack[NDP_DEPTH];
+	u_int depth;		/* may be more than NDP_DEPTH */
+};
+
+static uint64_t
+ndp_now(void)
+{
+#ifdef CLOCK_MONOTONIC
+	struct timespec ts;
+
+	(void)clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ((uint64_t)ts.tv_sec * 1000000000 + (uint64_t)ts.tv_nsec);
+#else
+	return ((uint64_t)clock() * (1000000000 / CLOCKS_PER_SEC));
+#endif
+}
+
+static struct ndp_entry *
+ndp_lookup(struct nd_profile *pr, const char *name)
+{
+	struct ndp_entry *e;
+	const char *p;
+	u_int h = 2166136261U;
+
+	for (p = name; *p != '\0'; p++)
+		h = (h ^ (u_char)*p) * 16777619U;
+	for (;;) {
+		e = &pr->slots[h & (NDP_SLOTS - 1)];
+		if (e->name == NULL)
+			break;
+		if (e->name == name || strcmp(e->name, name) == 0)
+			return (e);
+		h++;
+	}
+	if (pr->nentries == NDP_MAX_ENTRIES)
+		return (NULL);
+	e->name = name;
+	pr->entries[pr->nentries++] = e;
+	return (e);
+}
+
+/*
+ * Turn profiling on for "ndo".
+ */
+void
+nd_profile_init(netdissect_options *ndo)
+{
+	ndo->ndo_profile = (struct nd_profile *)calloc(1,
+	    sizeof(*ndo->ndo_profile));
+	if (ndo->ndo_profile == NULL)
+		(*ndo->ndo_error)(ndo, S_ERR_ND_MEM_ALLOC,
+				  "nd_profile_init: calloc");
+}
+
+/*
+ * A call to the dissector "name" is starting.
+ */
+void
+nd_profile_enter(netdissect_options *ndo, const char *name)
+{
+	struct nd_profile *pr = ndo->ndo_profile;
+	struct ndp_frame *f;
+	struct ndp_entry *e;
+
+	if (pr->depth++ >= NDP_DEPTH)
+		return;
+	f = &pr->stack[pr->depth - 1];
+	e = ndp_lookup(pr, name);
+	if (e != NULL)
+		e->calls++;
+	f->e = e;
+	f->child_ns = 0;
+	f->start = ndp_now();
+}
+
+static void
+ndp_pop(struct nd_profile *pr, uint64_t now)
+{
+	struct ndp_frame *f;
+	uint64_t ns;
+
+	if (pr->depth-- > NDP_DEPTH)
+		return;
+	f = &pr->stack[pr->depth];
+	ns = now - f->start;
+	if (f->e != NULL) {
+		f->e->total_ns += ns;
+		f->e->self_ns += ns - f->child_ns;
+	}
+	if (pr->depth != 0)
+		pr->stack[pr->depth - 1].child_ns += ns;
+}
+
+/*
+ * The innermost call has returned.
+ */
+void
+nd_profile_leave(netdissect_options *ndo)
+{
+	struct nd_profile *pr = ndo->ndo_profile;
+
+	if (pr->depth != 0)
+		ndp_pop(pr, ndp_now());
+}
+
+/*
+ * Close all the calls that are still open, as when the packet was
+ * found to be truncated, in which case the innermost that was timed
+ * gets the blame.
+ */
+void
+nd_profile_unwind(netdissect_options *ndo, int truncated)
+{
+	struct nd_profile *pr = ndo->ndo_profile;
+	uint64_t now;
+	u_int top;
+
+	if (pr->depth == 0)
+		return;
+	if (truncated) {
+		top = pr->depth < NDP_DEPTH ? pr->depth : NDP_DEPTH;
+		if (pr->stack[top - 1].e != NULL)
+			pr->stack[top - 1].e->truncated++;
+	}
+	now = ndp_now();
+	while (pr->depth != 0)
+		ndp_pop(pr, now);
+}
+
+/*
+ * Call "fn" for each dissector that's been called, the one with the
+ * most time spent in itself first.  Doesn't allocate memory, so it can
+ * be used from a signal handler.
+ */
+void
+nd_profile_foreach(netdissect_options *ndo, nd_profile_fn fn, void *arg)
+{
+	struct nd_profile *pr = ndo->ndo_profile;
+	struct ndp_entry *e;
+	u_int i, j;
+
+	if (pr == NULL)
+		return;
+	for (i = 1; i < pr->nentries; i++) {
+		e = pr->entries[i];
+		for (j = i; j != 0 && pr->entries[j - 1]->self_ns < e->self_ns;
+		    j--)
+			pr->entries[j] = pr->entries[j - 1];
+		pr->entries[j] = e;
+	}
+	for (i = 0; i < pr->nentries; i++) {
+		e = pr->entries[i];
+		(*fn)(arg, e->name, e->calls, e->total_ns, e->self_ns,
+		    e->truncated);
+	}
+}
+
+/*
+ * Snapshot length accounting.  The bytes needed are counted in
+ * NDS_GRAIN-byte buckets, which is as fine as a snapshot length is
+ * worth choosing; packets needing more than NDS_MAX_NEED go in the
+ * last bucket.
+ */
+#define NDS_PATH_LEN	64	/* longer paths are cut short */
+#define NDS_SLOTS	256	/* a power of 2 */
+#define NDS_MAX_PATHS	(NDS_SLOTS / 2)	/* others are counted together */
+#define NDS_GRAIN	16
+#define NDS_MAX_NEED	65536
+#define NDS_BUCKETS	(NDS_MAX_NEED / NDS_GRAIN + 2)
+
+struct nds_path {
+	char name[NDS_PATH_LEN];
+	uint64_t packets;
+	uint64_t truncated;
+	u_int max;
+	uint64_t buckets[NDS_BUCKETS];	/* [b] needed at most b * NDS_GRAIN */
+};
+
+struct nd_snapacct {
+	const u_char *base;	/* the packet being dissected */
+	const u_char *end;	/* the end of what was captured of it */
+	uint64_t need;		/* bytes of it looked at, or wanted */
+	int truncated;		/* a printer found it truncated */
+	char path[NDS_PATH_LEN];
+	size_t pathlen;
+	struct nds_path *slots[NDS_SLOTS];
+	struct nds_path *paths[NDS_MAX_PATHS];	/* for reporting */
+	u_int npaths;
+	struct nds_path other;	/* the paths that didn't fit */
+	struct nds_path all;	/* every packet */
+};
+
+/*
+ * Turn snapshot length accounting on for "ndo".
+ */
+void
+nd_snaplen_init(netdissect_options *ndo)
+{
+	ndo->ndo_snapacct = (struct nd_snapacct *)calloc(1,
+	    sizeof(*ndo->ndo_snapacct));
+	if (ndo->ndo_snapacct == NULL)
+		(*ndo->ndo_error)(ndo, S_ERR_ND_MEM_ALLOC,
+				  "nd_snaplen_init: calloc");
+	strlcpy(ndo->ndo_snapacct->other.name, "(other)",
+	    sizeof(ndo->ndo_snapacct->other.name));
+}
+
+/*
+ * Dissection of the "caplen" bytes captured at "sp" is starting.
+ */
+void
+nd_snaplen_begin(netdissect_options *ndo, const u_char *sp, u_int caplen)
+{
+	struct nd_snapacct *sa = ndo->ndo_snapacct;
+
+	sa->base = sp;
+	sa->end = sp + caplen;
+	sa->need = 0;
+	sa->truncated = 0;
+	sa->path[0] = '\0';
+	sa->pathlen = 0;
+}
+
+/*
+ * A bounds check asked whether the "len" bytes at "p" were captured.
+ */
+void
+nd_snaplen_note(const netdissect_options *ndo, const u_char *p, uint64_t len)
+{
+	struct nd_snapacct *sa = ndo->ndo_snapacct;
+	uint64_t need;
+
+	if (p < sa->base || p > sa->end)
+		return;		/* not in the packet itself */
+	need = (uint64_t)(p - sa->base) + len;
+	if (need > sa->need)
+		sa->need = need;
+}
+
+/*
+ * The dissector "name" is being called for the packet.
+ */
+void
+nd_snaplen_enter(netdissect_options *ndo, const char *name)
+{
+	struct nd_snapacct *sa = ndo->ndo_snapacct;
+	size_t len;
+
+	len = strlen(name);
+	if (sa->pathlen + 1 + len >= sizeof(sa->path))
+		return;
+	if (sa->pathlen != 0)
+		sa->path[sa->pathlen++] = '/';
+	memcpy(sa->path + sa->pathlen, name, len + 1);
+	sa->pathlen += len;
+}
+
+/*
+ * A printer reported the packet as truncated.
+ */
+void
+nd_snaplen_truncated(netdissect_options *ndo)
+{
+	ndo->ndo_snapacct->truncated = 1;
+}
+
+static struct nds_path *
+nds_lookup(netdissect_options *ndo, struct nd_snapacct *sa)
+{
+	struct nds_path **slot;
+	const char *p;
+	u_int h = 2166136261U;
+
+	for (p = sa->path; *p != '\0'; p++)
+		h = (h ^ (u_char)*p) * 16777619U;
+	for (;;) {
+		slot = &sa->slots[h & (NDS_SLOTS - 1)];
+		if (*slot == NULL)
+			break;
+		if (strcmp((*slot)->name, sa->path) == 0)
+			return (*slot);
+		h++;
+	}
+	if (sa->npaths == NDS_MAX_PATHS)
+		return (&sa->other);
+	*slot = (struct nds_path *)calloc(1, sizeof(**slot));
+	if (*slot == NULL)
+		(*ndo->ndo_error)(ndo, S_ERR_ND_MEM_ALLOC,
+				  "nds_lookup: calloc");
+	strlcpy((*slot)->name, sa->path, sizeof((*slot)->name));
+	sa->paths[sa->npaths++] = *slot;
+	return (*slot);
+}
+
+static void
+nds_count(struct nds_path *np, u_int need, int truncated)
+{
+	u_int b;
+
+	np->packets++;
+	if (truncated)
+		np->truncated++;
+	if (need > np->max)
+		np->max = need;
+	b = (need + NDS_GRAIN - 1) / NDS_GRAIN;
+	if (b >= NDS_BUCKETS)
+		b = NDS_BUCKETS - 1;
+	np->buckets[b]++;
+}
+
+/*
+ * Dissection of the packet, which was "len" bytes long on the wire,
+ * is done; count it.
+ */
+void
+nd_snaplen_end(netdissect_options *ndo, u_int len)
+{
+	struct nd_snapacct *sa = ndo->ndo_snapacct;
+	u_int need;
+
+	/* No snapshot length gets more than the whole packet. */
+	need = sa->need < len ? (u_int)sa->need : len;
+	if (sa->pathlen == 0)
+		strlcpy(sa->path, "-", sizeof(sa->path));
+	nds_count(nds_lookup(ndo, sa), need, sa->truncated);
+	nds_count(&sa->all, need, sa->truncated);
+}
+
+/*
+ * The bytes needed by "permille" thousandths of the packets counted in
+ * "np", rounded up to a bucket, but no more than the most needed.
+ */
+static u_int
+nds_percentile(const struct nds_path *np, u_int permille)
+{
+	uint64_t want, seen = 0;
+	u_int b;
+
+	want = (np->packets * permille + 999) / 1000;
+	if (want == 0)
+		want = 1;
+	for (b = 0; b < NDS_BUCKETS - 1; b++) {
+		seen += np->buckets[b];
+		if (seen >= want)
+			break;
+	}
+	if (b == NDS_BUCKETS - 1 || b * NDS_GRAIN > np->max)
+		return (np->max);
+	return (b * NDS_GRAIN);
+}
+
+/*
+ * Call "fn" for each protocol path that packets have had, the one with
+ * the most packets first, with the bytes needed by "permille"
+ * thousandths of them.  Doesn't allocate memory, so it can be used
+ * from a signal handler.
+ */
+void
+nd_snaplen_foreach(netdissect_options *ndo, u_int permille, nd_snaplen_fn fn,
+    void *arg)
+{
+	struct nd_snapacct *sa = ndo->ndo_snapacct;
+	struct nds_path *np;
+	u_int i, j;
+
+	if (sa == NULL)
+		return;
+	for (i = 1; i < sa->npaths; i++) {
+		np = sa->paths[i];
+		for (j = i; j != 0 && sa->paths[j - 1]->packets < np->packets;
+		    j--)
+			sa->paths[j] = sa->paths[j - 1];
+		sa->paths[j] = np;
+	}
+	for (i = 0; i < sa->npaths; i++) {
+		np = sa->paths[i];
+		(*fn)(arg, np->name, np->packets, np->truncated, np->max,
+		    nds_percentile(np, permille));
+	}
+	np = &sa->other;
+	if (np->packets != 0)
+		(*fn)(arg, np->name, np->packets, np->truncated, np->max,
+		    nds_percentile(np, permille));
+}
+
+/*
+ * The snapshot length that would have been enough for "permille"
+ * thousandths of all the packets, of which there were "*packets".
+ */
+u_int
+nd_snaplen_recommend(netdissect_options *ndo, u_int permille,
+    uint64_t *packets)
+{
+	struct nd_snapacct *sa = ndo->ndo_snapacct;
+
+	*packets = sa->all.packets;
+	return (nds_percentile(&sa->all, permille));
+}
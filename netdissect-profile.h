@@ -0,0 +1,113 @@
+/*
+ * Copyright (c) 2026 The TCPDUMP project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that: (1) source code
+ * distributions retain the above copyright notice and this paragraph
+ * in its entirety, and (2) distributions including binary code include
+ * the above copyright notice and this paragraph in its entirety in
+ * the documentation or other materials provided with the distribution.
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND
+ * WITHOUT ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, WITHOUT
+ * LIMITATION, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE.
+ */
+
+#ifndef netdissect_profile_h
+#define netdissect_profile_h
+
+/*
+ * Per-dissector profiling, built with ENABLE_DISSECTOR_PROFILE and
+ * turned on for an ndo with nd_profile_init() (--profile-dissectors).
+ *
+ * The dispatch code brackets each call to a dissector it looked up
+ * with ND_PROFILE_ENTER() and ND_PROFILE_LEAVE(); that counts the
+ * call and the time spent in it, both in total and in the dissector
+ * itself rather than in the ones it called through the tables.  A
+ * packet that turns out to be truncated longjmps past the
+ * ND_PROFILE_LEAVE()s, so pretty_print_packet() calls
+ * nd_profile_unwind() to close the calls still open and blame the
+ * innermost one for the truncation.
+ *
+ * Counting is per ndo and not locked.
+ */
+#ifdef ENABLE_DISSECTOR_PROFILE
+typedef void (*nd_profile_fn)(void *, const char *name, uint64_t calls,
+    uint64_t total_ns, uint64_t self_ns, uint64_t truncated);
+
+extern void nd_profile_init(netdissect_options *);
+extern void nd_profile_enter(netdissect_options *, const char *);
+extern void nd_profile_leave(netdissect_options *);
+extern void nd_profile_unwind(netdissect_options *, int);
+extern void nd_profile_foreach(netdissect_options *, nd_profile_fn, void *);
+
+#define ND_PROFILE_ENTER(name) \
+	do { \
+		if (ndo->ndo_profile != NULL) \
+			nd_profile_enter(ndo, (name)); \
+		if (ndo->ndo_snapacct != NULL) \
+			nd_snaplen_enter(ndo, (name)); \
+	} while (0)
+#define ND_PROFILE_LEAVE() \
+	do { \
+		if (ndo->ndo_profile != NULL) \
+			nd_profile_leave(ndo); \
+	} while (0)
+#define ND_PROFILE_UNWIND(truncated) \
+	do { \
+		if (ndo->ndo_profile != NULL) \
+			nd_profile_unwind(ndo, (truncated)); \
+	} while (0)
+
+/*
+ * Snapshot length accounting (--snaplen-report), in the same builds.
+ *
+ * For each packet, the bounds checks note how far into it the
+ * printers looked, or wanted to look, and the dispatch code notes the
+ * dissectors called, which make up the packet's protocol path, such as
+ * "EN10MB/ip/tcp/http".  For each path, the number of packets, how
+ * many of them were found to be truncated, and a histogram of the
+ * bytes needed are kept, so the smallest snapshot length that would
+ * have sufficed for most of the packets can be worked out.
+ *
+ * Only the bytes of the packet itself are counted, not those of the
+ * buffers printers make for reassembled or decrypted data.
+ */
+typedef void (*nd_snaplen_fn)(void *, const char *path, uint64_t packets,
+    uint64_t truncated, u_int max, u_int most);
+
+extern void nd_snaplen_init(netdissect_options *);
+extern void nd_snaplen_begin(netdissect_options *, const u_char *, u_int);
+extern void nd_snaplen_enter(netdissect_options *, const char *);
+extern void nd_snaplen_truncated(netdissect_options *);
+extern void nd_snaplen_end(netdissect_options *, u_int);
+extern void nd_snaplen_foreach(netdissect_options *, u_int, nd_snaplen_fn,
+    void *);
+extern u_int nd_snaplen_recommend(netdissect_options *, u_int, uint64_t *);
+
+#define ND_SNAPLEN_BEGIN(sp, caplen) \
+	do { \
+		if (ndo->ndo_snapacct != NULL) \
+			nd_snaplen_begin(ndo, (sp), (caplen)); \
+	} while (0)
+#define ND_SNAPLEN_TRUNCATED() \
+	do { \
+		if (ndo->ndo_snapacct != NULL) \
+			nd_snaplen_truncated(ndo); \
+	} while (0)
+#define ND_SNAPLEN_END(len) \
+	do { \
+		if (ndo->ndo_snapacct != NULL) \
+			nd_snaplen_end(ndo, (len)); \
+	} while (0)
+#else
+#define ND_PROFILE_ENTER(name)		do { } while (0)
+#define ND_PROFILE_LEAVE()		do { } while (0)
+#define ND_PROFILE_UNWIND(truncated)	do { } while (0)
+#define ND_SNAPLEN_BEGIN(sp, caplen)	do { } while (0)
+#define ND_SNAPLEN_TRUNCATED()		do { } while (0)
+#define ND_SNAPLEN_END(len)		do { } while (0)
+#endif
+
+#endif /* netdissect_profile_h */
@@ -0,0 +1,295 @@
+/*
+ * Copyright (c) 2026 The TCPDUMP project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that: (1) source code
+ * distributions retain the above copyright notice and this paragraph
+ * in its entirety, and (2) distributions including binary code include
+ * the above copyright notice and this paragraph in its entirety in
+ * the documentation or other materials provided with the distribution.
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND
+ * WITHOUT ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, WITHOUT
+ * LIMITATION, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include "netdissect-stdinc.h"
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "netdissect.h"
+#include "netdissect-state.h"
+
+struct nd_state_slot {
+	const void *key;
+	const struct nd_state_type *type;
+	void *state;
+	struct nd_state_slot *next;
+};
+
+/*
+ * What's put in front of each allocation, so that nd_state_free() knows
+ * how much it's giving back; a union, to keep what follows aligned.
+ */
+union nd_state_header {
+	size_t size;
+	uint64_t align1;
+	double align2;
+	void *align3;
+};
+
+/*
+ * The accounting is for the process, not the ndo, and is locked; the
+ * tables are allocated when they're first used or grown, not per
+ * packet.
+ */
+static pthread_mutex_t state_mtx = PTHREAD_MUTEX_INITIALIZER;
+static struct nd_state_stats state_counts;
+
+/*
+ * Returns the slot for "key" in the ndo, making an empty one if there
+ * isn't one yet.  The slot found is moved to the front of the list, as
+ * a dissector usually looks up its state for several packets in a row.
+ */
+void **
+nd_state_slot(netdissect_options *ndo, const void *key,
+    const struct nd_state_type *type)
+{
+	struct nd_state_slot *s, **sp;
+
+	for (sp = &ndo->ndo_state; (s = *sp) != NULL; sp = &s->next) {
+		if (s->key == key) {
+			if (sp != &ndo->ndo_state) {
+				*sp = s->next;
+				s->next = ndo->ndo_state;
+				ndo->ndo_state = s;
+			}
+			return (&s->state);
+		}
+	}
+	s = (struct nd_state_slot *)calloc(1, sizeof(*s));
+	if (s == NULL)
+		(*ndo->ndo_error)(ndo, S_ERR_ND_MEM_ALLOC, "%s: calloc",
+		    __func__);
+	s->key = key;
+	s->type = type;
+	s->next = ndo->ndo_state;
+	ndo->ndo_state = s;
+	return (&s->state);
+}
+
+/*
+ * Allocate "n" zeroed objects of "size" bytes for the ndo's state.
+ * Returns NULL if that would take more than the budget.
+ */
+void *
+nd_state_calloc(netdissect_options *ndo, size_t n, size_t size)
+{
+	union nd_state_header *h;
+	size_t bytes;
+
+	if (size != 0 && n > (SIZE_MAX - sizeof(*h)) / size)
+		(*ndo->ndo_error)(ndo, S_ERR_ND_MEM_ALLOC, "%s: calloc",
+		    __func__);
+	bytes = n * size + sizeof(*h);
+
+	pthread_mutex_lock(&state_mtx);
+	if (ndo->ndo_state_budget != 0 &&
+	    bytes > ndo->ndo_state_budget - state_counts.nss_bytes) {
+		state_counts.nss_refused++;
+		pthread_mutex_unlock(&state_mtx);
+		return (NULL);
+	}
+	state_counts.nss_bytes += bytes;
+	if (state_counts.nss_bytes > state_counts.nss_peak)
+		state_counts.nss_peak = state_counts.nss_bytes;
+	pthread_mutex_unlock(&state_mtx);
+
+	h = (union nd_state_header *)calloc(1, bytes);
+	if (h == NULL)
+		(*ndo->ndo_error)(ndo, S_ERR_ND_MEM_ALLOC, "%s: calloc",
+		    __func__);
+	h->size = bytes;
+	return (h + 1);
+}
+
+void
+nd_state_free(netdissect_options *ndo _U_, void *p)
+{
+	union nd_state_header *h;
+
+	if (p == NULL)
+		return;
+	h = (union nd_state_header *)p - 1;
+	pthread_mutex_lock(&state_mtx);
+	state_counts.nss_bytes -= h->size;
+	pthread_mutex_unlock(&state_mtx);
+	free(h);
+}
+
+/*
+ * Call "fn" for the state in each of the ndo's slots of type "type".
+ */
+void
+nd_state_foreach(netdissect_options *ndo, const struct nd_state_type *type,
+    void (*fn)(void *, void *), void *arg)
+{
+	struct nd_state_slot *s;
+
+	for (s = ndo->ndo_state; s != NULL; s = s->next)
+		if (s->type == type && s->state != NULL)
+			(*fn)(arg, s->state);
+}
+
+/*
+ * Free all of the ndo's state, e.g. when the thread that had it is done.
+ */
+void
+nd_state_free_all(netdissect_options *ndo)
+{
+	struct nd_state_slot *s;
+
+	nd_mem_release(ndo);
+	while ((s = ndo->ndo_state) != NULL) {
+		ndo->ndo_state = s->next;
+		if (s->state != NULL)
+			(*s->type->nst_free)(ndo, s->state);
+		free(s);
+	}
+}
+
+void
+nd_state_stats(struct nd_state_stats *stats)
+{
+	pthread_mutex_lock(&state_mtx);
+	*stats = state_counts;
+	pthread_mutex_unlock(&state_mtx);
+}
+
+/* The pools, in the order they're evicted from. */
+static const struct nd_mem_pool mem_pools[] = {
+	{ "host names", namecache_mem_usage, namecache_mem_reclaim },
+	{ "calls", callcache_mem_usage, callcache_mem_reclaim },
+	{ "tcp conversations", tcp_conn_mem_usage, tcp_conn_mem_reclaim },
+	{ "tcp streams", tcp_reasm_mem_usage, tcp_reasm_mem_reclaim },
+	{ "ip datagrams", ip_reasm_mem_usage, ip_reasm_mem_reclaim },
+};
+#define N_MEM_POOLS	(sizeof(mem_pools) / sizeof(mem_pools[0]))
+
+static size_t mem_total;		/* what the ndos last said they had */
+static size_t mem_peak;
+static uint64_t mem_evicted[N_MEM_POOLS];
+
+static size_t
+mem_usage(netdissect_options *ndo)
+{
+	size_t usage;
+	u_int i;
+
+	usage = 0;
+	for (i = 0; i < N_MEM_POOLS; i++)
+		usage += (*mem_pools[i].nmp_usage)(ndo);
+	return (usage);
+}
+
+/*
+ * Replace what the ndo last said it had with "usage", and return how
+ * far over the low mark the process is, or 0 if it's within the limit.
+ */
+static size_t
+mem_update(netdissect_options *ndo, size_t usage)
+{
+	size_t low, over;
+
+	pthread_mutex_lock(&state_mtx);
+	mem_total = mem_total - ndo->ndo_mem_charged + usage;
+	ndo->ndo_mem_charged = usage;
+	if (mem_total > mem_peak)
+		mem_peak = mem_total;
+	over = 0;
+	if (mem_total > ndo->ndo_mem_limit) {
+		low = ndo->ndo_mem_limit - ndo->ndo_mem_limit / 8;
+		over = mem_total - low;
+	}
+	pthread_mutex_unlock(&state_mtx);
+	return (over);
+}
+
+/*
+ * Called after each packet with --mem-limit.
+ */
+void
+nd_mem_check(netdissect_options *ndo)
+{
+	size_t want, before, after;
+	uint64_t n;
+	u_int i;
+
+	want = mem_update(ndo, mem_usage(ndo));
+	if (want == 0)
+		return;
+	for (i = 0; i < N_MEM_POOLS && want != 0; i++) {
+		before = (*mem_pools[i].nmp_usage)(ndo);
+		if (before == 0)
+			continue;
+		n = (*mem_pools[i].nmp_reclaim)(ndo, want);
+		after = (*mem_pools[i].nmp_usage)(ndo);
+		if (after < before)
+			want = before - after >= want ? 0 :
+			    want - (before - after);
+		pthread_mutex_lock(&state_mtx);
+		mem_evicted[i] += n;
+		pthread_mutex_unlock(&state_mtx);
+	}
+	(void)mem_update(ndo, mem_usage(ndo));
+}
+
+/*
+ * Stop counting the ndo's memory, e.g. when the thread that had it is
+ * done.
+ */
+void
+nd_mem_release(netdissect_options *ndo)
+{
+	if (ndo->ndo_mem_charged == 0)
+		return;
+	pthread_mutex_lock(&state_mtx);
+	mem_total -= ndo->ndo_mem_charged;
+	ndo->ndo_mem_charged = 0;
+	pthread_mutex_unlock(&state_mtx);
+}
+
+size_t
+nd_mem_peak(void)
+{
+	size_t peak;
+
+	pthread_mutex_lock(&state_mtx);
+	peak = mem_peak;
+	pthread_mutex_unlock(&state_mtx);
+	return (peak);
+}
+
+/*
+ * Call "fn" with the name of each pool and the number of entries evicted
+ * from it.
+ */
+void
+nd_mem_foreach(nd_mem_fn fn, void *arg)
+{
+	uint64_t evicted[N_MEM_POOLS];
+	u_int i;
+
+	pthread_mutex_lock(&state_mtx);
+	memcpy(evicted, mem_evicted, sizeof(evicted));
+	pthread_mutex_unlock(&state_mtx);
+	for (i = 0; i < N_MEM_POOLS; i++)
+		(*fn)(arg, mem_pools[i].nmp_name, evicted[i]);
+}
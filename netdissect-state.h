@@ -0,0 +1,94 @@
+/*
+ * Copyright (c) 2026 The TCPDUMP project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that: (1) source code
+ * distributions retain the above copyright notice and this paragraph
+ * in its entirety, and (2) distributions including binary code include
+ * the above copyright notice and this paragraph in its entirety in
+ * the documentation or other materials provided with the distribution.
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND
+ * WITHOUT ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, WITHOUT
+ * LIMITATION, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE.
+ */
+
+#ifndef netdissect_state_h
+#define netdissect_state_h
+
+/*
+ * The state that dissectors carry from one packet to the next, such as
+ * the call caches and the TCP sequence number table, kept per ndo
+ * rather than in file-static tables, so that each thread's or
+ * context's ndo has its own.
+ *
+ * A dissector finds its state with nd_state_slot(), giving the address
+ * of something of its own, such as its callcache_type, as the key; the
+ * slot is a pointer, NULL until the dissector sets it, that the ndo
+ * keeps until nd_state_free_all() hands it to the type's nst_free.
+ *
+ * The memory for the state is got with nd_state_calloc() and given back
+ * with nd_state_free().  It's counted against a limit, ndo_state_budget
+ * bytes (--state-memory), for all the ndos in the process together, and
+ * nd_state_calloc() returns NULL rather than go over it; the dissector
+ * then makes do with a smaller table, evicting its own old entries
+ * sooner, or with none.  Running out of memory is an error, as usual.
+ */
+struct nd_state_type {
+	void (*nst_free)(netdissect_options *, void *);
+};
+
+struct nd_state_stats {
+	size_t nss_bytes;	/* in use, by all ndos */
+	size_t nss_peak;
+	uint64_t nss_refused;	/* allocations refused for the budget */
+};
+
+extern void **nd_state_slot(netdissect_options *, const void *,
+    const struct nd_state_type *);
+extern void *nd_state_calloc(netdissect_options *, size_t, size_t);
+extern void nd_state_free(netdissect_options *, void *);
+extern void nd_state_free_all(netdissect_options *);
+extern void nd_state_stats(struct nd_state_stats *);
+extern void nd_state_foreach(netdissect_options *,
+    const struct nd_state_type *, void (*)(void *, void *), void *);
+
+/*
+ * --mem-limit: a limit, ndo_mem_limit bytes, on the memory of all the
+ * caches together, for all the ndos in the process: the host name
+ * caches, the call caches, the TCP sequence number table and the TCP
+ * and IP reassembly buffers, which are the pools below.  It's applied
+ * between packets, by nd_mem_check(), so nothing a dissector is using
+ * goes away under it.  That adds up what the caller's ndo has in the
+ * pools, and if the process is over the limit, has each pool in turn,
+ * the cheapest to do without first, evict from the caller's caches
+ * until the process would be an eighth under it.  A pool's nmp_reclaim
+ * is asked to free at least the bytes given if it can, and returns the
+ * number of entries it evicted.
+ */
+struct nd_mem_pool {
+	const char *nmp_name;	/* what it evicts, for the report */
+	size_t (*nmp_usage)(netdissect_options *);
+	uint64_t (*nmp_reclaim)(netdissect_options *, size_t);
+};
+
+typedef void (*nd_mem_fn)(void *, const char *, uint64_t);
+
+extern void nd_mem_check(netdissect_options *);
+extern void nd_mem_release(netdissect_options *);
+extern size_t nd_mem_peak(void);
+extern void nd_mem_foreach(nd_mem_fn, void *);
+
+extern size_t namecache_mem_usage(netdissect_options *);
+extern uint64_t namecache_mem_reclaim(netdissect_options *, size_t);
+extern size_t callcache_mem_usage(netdissect_options *);
+extern uint64_t callcache_mem_reclaim(netdissect_options *, size_t);
+extern size_t tcp_conn_mem_usage(netdissect_options *);
+extern uint64_t tcp_conn_mem_reclaim(netdissect_options *, size_t);
+extern size_t tcp_reasm_mem_usage(netdissect_options *);
+extern uint64_t tcp_reasm_mem_reclaim(netdissect_options *, size_t);
+extern size_t ip_reasm_mem_usage(netdissect_options *);
+extern uint64_t ip_reasm_mem_reclaim(netdissect_options *, size_t);
+
+#endif /* netdissect_state_h */
@@ -0,0 +1,207 @@
+/*
+ * Copyright (c) 2026 The TCPDUMP project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that: (1) source code
+ * distributions retain the above copyright notice and this paragraph
+ * in its entirety, and (2) distributions including binary code include
+ * the above copyright notice and this paragraph in its entirety in
+ * the documentation or other materials provided with the distribution.
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND
+ * WITHOUT ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, WITHOUT
+ * LIMITATION, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include "netdissect-stdinc.h"
+
+#include "netdissect.h"
+#include "netdissect-fields.h"
+#include "netdissect-tlv.h"
+#include "addrtoname.h"
+#include "extract.h"
+
+/*
+ * The entry for "type", or NULL if it has none.
+ */
+static const struct nd_tlv_type *
+tlv_lookup(const struct nd_tlv_table *t, u_int type)
+{
+	const struct nd_tlv_type *tt;
+
+	if (type >= t->ntypes)
+		return (NULL);
+	tt = &t->types[type];
+	return (tt->name != NULL ? tt : NULL);
+}
+
+/*
+ * The name of "type", or NULL if the table doesn't know it.
+ */
+const char *
+nd_tlv_name(const struct nd_tlv_table *t, u_int type)
+{
+	const struct nd_tlv_type *tt = tlv_lookup(t, type);
+
+	return (tt != NULL ? tt->name : NULL);
+}
+
+/*
+ * The shortest value the entry can be decoded from: its "min_len", but
+ * never less than the bytes it reads.
+ */
+static u_int
+tlv_min_len(const struct nd_tlv_type *tt)
+{
+	u_int need;
+
+	switch (tt->kind) {
+
+	case ND_TLV_UINT:
+	case ND_TLV_TOK:
+	case ND_TLV_OCTETS:
+		need = tt->width;
+		break;
+
+	case ND_TLV_IPADDR:
+		need = 4;
+		break;
+
+	case ND_TLV_IP6ADDR:
+		need = 16;
+		break;
+
+	default:
+		need = 0;
+		break;
+	}
+	return (tt->min_len > need ? tt->min_len : need);
+}
+
+/*
+ * Print "len" bytes in hex, a buffer at a time rather than a byte at a
+ * time.
+ */
+static void
+tlv_hex_print(netdissect_options *ndo, const u_char *p, u_int len)
+{
+	static const char hex[] = "0123456789abcdef";
+	char buf[2 * 64 + 1];
+	u_int i, n;
+
+	while (len != 0) {
+		n = len < 64 ? len : 64;
+		for (i = 0; i < n; i++) {
+			buf[2 * i] = hex[EXTRACT_U_1(p + i) >> 4];
+			buf[2 * i + 1] = hex[EXTRACT_U_1(p + i) & 0xf];
+		}
+		buf[2 * n] = '\0';
+		ND_PRINT("%s", buf);
+		p += n;
+		len -= n;
+	}
+}
+
+static uint64_t
+tlv_uint(const u_char *p, u_int width)
+{
+	uint64_t v = 0;
+
+	while (width-- != 0)
+		v = v << 8 | EXTRACT_U_1(p++);
+	return (v);
+}
+
+/*
+ * Print the "len" bytes of value at "val" of a TLV of type "type", as
+ * the table says, and report its field; a type the table doesn't know
+ * is left alone.
+ */
+void
+nd_tlv_value_print(netdissect_options *ndo, const struct nd_tlv_table *t,
+		   u_int type, const u_char *val, u_int len)
+{
+	const struct nd_tlv_type *tt;
+	u_int i;
+	uint64_t v;
+
+	tt = tlv_lookup(t, type);
+	if (tt == NULL)
+		return;
+	if (len < tlv_min_len(tt)) {
+		ND_PRINT("%s", t->too_short);
+		return;
+	}
+	/* The one check: everything below reads the value unchecked. */
+	ND_TCHECK_LEN(val, len);
+
+	if (ndo->ndo_field != NULL && tt->field != 0) {
+		switch (tt->kind) {
+
+		case ND_TLV_UINT:
+		case ND_TLV_TOK:
+		case ND_TLV_FUNC:
+			if (tt->width != 0 && len >= tt->width)
+				nd_field_uint(ndo, t->proto, tt->field,
+				    tlv_uint(val, tt->width));
+			break;
+
+		case ND_TLV_STRING:
+			if (len != 0)
+				(*ndo->ndo_field)(ndo, t->proto, tt->field,
+				    NDF_T_STRING, val, len);
+			break;
+
+		case ND_TLV_IPADDR:
+		case ND_TLV_IP6ADDR:
+			(*ndo->ndo_field)(ndo, t->proto, tt->field,
+			    NDF_T_ADDR, val, tt->kind == ND_TLV_IPADDR ? 4 : 16);
+			break;
+		}
+	}
+
+	switch (tt->kind) {
+
+	case ND_TLV_NONE:
+		break;
+
+	case ND_TLV_UINT:
+		ND_PRINT("%" PRIu64, tlv_uint(val, tt->width));
+		break;
+
+	case ND_TLV_TOK:
+		v = tlv_uint(val, tt->width);
+		ND_PRINT("%s", tok2str(tt->tok, tt->fmt, (u_int)v));
+		break;
+
+	case ND_TLV_OCTETS:
+		tlv_hex_print(ndo, val, tt->width != 0 ? tt->width : len);
+		break;
+
+	case ND_TLV_STRING:
+		for (i = 0; i < len; i++)
+			fn_print_char(ndo, EXTRACT_U_1(val + i));
+		break;
+
+	case ND_TLV_IPADDR:
+		ND_PRINT("%s", ipaddr_string(ndo, val));
+		break;
+
+	case ND_TLV_IP6ADDR:
+		ND_PRINT("%s", ip6addr_string(ndo, val));
+		break;
+
+	case ND_TLV_FUNC:
+		(*tt->print)(ndo, val, len);
+		break;
+	}
+	return;
+
+trunc:
+	nd_print_trunc(ndo);
+}
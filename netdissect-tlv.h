@@ -0,0 +1,75 @@
+/*
+ * Copyright (c) 2026 The TCPDUMP project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that: (1) source code
+ * distributions retain the above copyright notice and this paragraph
+ * in its entirety, and (2) distributions including binary code include
+ * the above copyright notice and this paragraph in its entirety in
+ * the documentation or other materials provided with the distribution.
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND
+ * WITHOUT ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, WITHOUT
+ * LIMITATION, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE.
+ */
+
+#ifndef netdissect_tlv_h
+#define netdissect_tlv_h
+
+#include "netdissect-stdinc.h"
+#include "netdissect.h"
+
+/*
+ * Table-driven TLV values.  A printer describes the types it knows in
+ * a const array indexed by type, with a name, the shortest value that
+ * makes sense and how to decode it, and nd_tlv_value_print() does the
+ * rest: an index rather than a switch or a tok2str() search to find
+ * the type, one check that the whole value was captured, and the
+ * decoding, after which the value's bytes are read unchecked.  A type
+ * with a structured-output field also reports it, so the one table
+ * drives both the text and --field-output.
+ *
+ * The printer keeps its own loop over the TLVs, since the headers
+ * differ in ways (flags, vendor IDs, lengths with or without the
+ * header) a table doesn't capture well.
+ */
+#define ND_TLV_NONE	0	/* no value is printed */
+#define ND_TLV_UINT	1	/* "width" bytes, big-endian, in decimal */
+#define ND_TLV_TOK	2	/* "width" bytes, big-endian, named by "tok" */
+#define ND_TLV_OCTETS	3	/* "width" bytes, or all of them if 0, in hex */
+#define ND_TLV_STRING	4	/* all of it, as characters */
+#define ND_TLV_IPADDR	5	/* an IPv4 address */
+#define ND_TLV_IP6ADDR	6	/* an IPv6 address */
+#define ND_TLV_FUNC	7	/* passed to "print" */
+
+typedef void (*nd_tlv_print_fn)(netdissect_options *, const u_char *, u_int);
+
+struct nd_tlv_type {
+	const char *name;	/* NULL for a type with no entry */
+	uint8_t	kind;		/* ND_TLV_... */
+	uint8_t	width;		/* bytes of a UINT, TOK or OCTETS value */
+	uint8_t	min_len;	/* shorter values are too short; at least
+				   what "kind" and "width" read */
+	uint8_t	field;		/* of the table's protocol, or 0 for none */
+	const struct tok *tok;	/* ND_TLV_TOK names */
+	const char *fmt;	/* ND_TLV_TOK format for unnamed values */
+	nd_tlv_print_fn print;	/* ND_TLV_FUNC decoder */
+};
+
+struct nd_tlv_table {
+	const struct nd_tlv_type *types;	/* indexed by type */
+	u_int	ntypes;
+	u_int	proto;		/* NDF_... protocol of the fields */
+	const char *too_short;	/* printed for a value below min_len */
+};
+
+#define ND_TLV_TABLE(types, proto, too_short) \
+	{ (types), sizeof(types) / sizeof((types)[0]), (proto), (too_short) }
+
+extern const char *nd_tlv_name(const struct nd_tlv_table *, u_int);
+extern void nd_tlv_value_print(netdissect_options *,
+			       const struct nd_tlv_table *, u_int,
+			       const u_char *, u_int);
+
+#endif /* netdissect_tlv_h */
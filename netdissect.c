@@ -33,6 +33,7 @@
 #include <stdlib.h>
 
 #ifdef USE_LIBSMI
+#include <pthread.h>
 #include <smi.h>
 #endif
 
@@ -64,14 +65,6 @@ nd_init(char *errbuf, size_t errbuf_size)
 	}
 #endif /* _WIN32 */
 
-#ifdef USE_LIBSMI
-	/*
-	 * XXX - should we just fail if this fails?  Some of the
-	 * libsmi calls may fail.
-	 */
-	smiInit("tcpdump");
-#endif
-
 	/*
 	 * Clears the error buffer, and uses it so we don't get
 	 * "unused argument" warnings at compile time.
@@ -118,10 +111,44 @@ nd_have_smi_support(void)
  */
 int nd_smi_module_loaded;
 
+#ifdef USE_LIBSMI
+/*
+ * libsmi is initialized, which reads its configuration, only when a
+ * module is first loaded, and the modules given to
+ * nd_defer_smi_module() are only loaded when the first SNMP packet
+ * asks nd_smi_modules_ready(), so that a capture that never sees one
+ * doesn't wait for them.
+ */
+struct nd_smi_pending {
+	struct nd_smi_pending *next;
+	char	*module;
+};
+
+static pthread_mutex_t nd_smi_mtx = PTHREAD_MUTEX_INITIALIZER;
+static struct nd_smi_pending *nd_smi_pending_modules;
+static struct nd_smi_pending **nd_smi_pending_tail = &nd_smi_pending_modules;
+
+static void
+nd_smi_init(void)
+{
+	static int done;
+
+	if (!done) {
+		/*
+		 * XXX - should we just fail if this fails?  Some of the
+		 * libsmi calls may fail.
+		 */
+		smiInit("tcpdump");
+		done = 1;
+	}
+}
+#endif
+
 int
 nd_load_smi_module(const char *module, char *errbuf, size_t errbuf_size)
 {
 #ifdef USE_LIBSMI
+	nd_smi_init();
 	if (smiLoadModule(module) == 0) {
 		snprintf(errbuf, errbuf_size, "could not load MIB module %s",
 		    module);
@@ -136,6 +163,62 @@ nd_load_smi_module(const char *module, char *errbuf, size_t errbuf_size)
 #endif
 }
 
+/*
+ * Load "module" when the first SNMP packet is printed, rather than now.
+ */
+int
+nd_defer_smi_module(const char *module, char *errbuf, size_t errbuf_size)
+{
+#ifdef USE_LIBSMI
+	struct nd_smi_pending *p;
+
+	p = (struct nd_smi_pending *)malloc(sizeof(*p));
+	if (p == NULL || (p->module = strdup(module)) == NULL) {
+		free(p);
+		snprintf(errbuf, errbuf_size, "MIB module %s: malloc", module);
+		return (-1);
+	}
+	p->next = NULL;
+	*nd_smi_pending_tail = p;
+	nd_smi_pending_tail = &p->next;
+	return (0);
+#else
+	snprintf(errbuf, errbuf_size, "MIB module %s not loaded: no libsmi support",
+	    module);
+	return (-1);
+#endif
+}
+
+/*
+ * Load any modules still waiting to be, warning about those that can't
+ * be, and return 1 if any module has been loaded.  Any thread printing
+ * packets can get here first.
+ */
+int
+nd_smi_modules_ready(netdissect_options *ndo _U_)
+{
+#ifdef USE_LIBSMI
+	struct nd_smi_pending *p;
+	char errbuf[128];
+	int loaded;
+
+	pthread_mutex_lock(&nd_smi_mtx);
+	while ((p = nd_smi_pending_modules) != NULL) {
+		nd_smi_pending_modules = p->next;
+		if (nd_load_smi_module(p->module, errbuf, sizeof(errbuf)) == -1)
+			(*ndo->ndo_warning)(ndo, "%s", errbuf);
+		free(p->module);
+		free(p);
+	}
+	nd_smi_pending_tail = &nd_smi_pending_modules;
+	loaded = nd_smi_module_loaded;
+	pthread_mutex_unlock(&nd_smi_mtx);
+	return (loaded);
+#else
+	return (0);
+#endif
+}
+
 const char *
 nd_smi_version_string(void)
 {
@@ -146,6 +229,24 @@ nd_smi_version_string(void)
 #endif
 }
 
+/*
+ * Nearly every length-bounded layer pushes a snapshot end, so the
+ * entries of the packet info stack are kept on a free list when popped
+ * rather than freed, and the heap is only used when the nesting gets
+ * deeper than it has been before.
+ */
+static struct netdissect_saved_packet_info *
+nd_get_packet_info(netdissect_options *ndo)
+{
+	struct netdissect_saved_packet_info *ndspi;
+
+	ndspi = ndo->ndo_packet_info_free;
+	if (ndspi != NULL) {
+		ndo->ndo_packet_info_free = ndspi->ndspi_prev;
+		return (ndspi);
+	}
+	return ((struct netdissect_saved_packet_info *)malloc(sizeof(struct netdissect_saved_packet_info)));
+}
 
 int
 nd_push_buffer(netdissect_options *ndo, u_char *new_buffer,
@@ -153,7 +254,7 @@ nd_push_buffer(netdissect_options *ndo, u_char *new_buffer,
 {
 	struct netdissect_saved_packet_info *ndspi;
 
-	ndspi = (struct netdissect_saved_packet_info *)malloc(sizeof(struct netdissect_saved_packet_info));
+	ndspi = nd_get_packet_info(ndo);
 	if (ndspi == NULL)
 		return (0);	/* fail */
 	ndspi->ndspi_buffer = new_buffer;
@@ -177,7 +278,7 @@ nd_push_snapend(netdissect_options *ndo, const u_char *new_snapend)
 {
 	struct netdissect_saved_packet_info *ndspi;
 
-	ndspi = (struct netdissect_saved_packet_info *)malloc(sizeof(struct netdissect_saved_packet_info));
+	ndspi = nd_get_packet_info(ndo);
 	if (ndspi == NULL)
 		return (0);	/* fail */
 	ndspi->ndspi_buffer = NULL;	/* no new buffer */
@@ -225,7 +326,8 @@ nd_pop_packet_info(netdissect_options *ndo)
 	ndo->ndo_packet_info_stack = ndspi->ndspi_prev;
 
 	free(ndspi->ndspi_buffer);
-	free(ndspi);
+	ndspi->ndspi_prev = ndo->ndo_packet_info_free;
+	ndo->ndo_packet_info_free = ndspi;
 }
 
 void
@@ -234,3 +336,17 @@ nd_pop_all_packet_info(netdissect_options *ndo)
 	while (ndo->ndo_packet_info_stack != NULL)
 		nd_pop_packet_info(ndo);
 }
+
+/*
+ * Free the entries nd_pop_packet_info() kept for reuse.
+ */
+void
+nd_free_packet_info(netdissect_options *ndo)
+{
+	struct netdissect_saved_packet_info *ndspi;
+
+	while ((ndspi = ndo->ndo_packet_info_free) != NULL) {
+		ndo->ndo_packet_info_free = ndspi->ndspi_prev;
+		free(ndspi);
+	}
+}
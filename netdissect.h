@@ -31,6 +31,24 @@
 #include <sys/types.h>
 #include <setjmp.h>
 #include "status-exit-codes.h"
+#include "timeval-operations.h"
+
+/*
+ * Printers longjmp out when a packet turns out to be truncated, and
+ * pretty_print_packet() sets the jump buffer for every packet.  Nothing
+ * depends on the signal mask being put back, which setjmp() saves, and
+ * longjmp() restores, with a system call on some platforms, so use
+ * sigsetjmp() with a savemask of 0 where POSIX provides it.
+ */
+#ifdef _WIN32
+typedef jmp_buf nd_jmp_buf;
+#define ND_SETJMP(env)	setjmp(env)
+#define ND_LONGJMP(env)	longjmp((env), 1)
+#else
+typedef sigjmp_buf nd_jmp_buf;
+#define ND_SETJMP(env)	sigsetjmp((env), 0)
+#define ND_LONGJMP(env)	siglongjmp((env), 1)
+#endif
 
 /*
  * Data types corresponding to multi-byte integral values within data
@@ -145,6 +163,8 @@ extern const char *tok2strbuf(const struct tok *, const char *, u_int,
 extern const char *tok2str(const struct tok *, const char *, u_int);
 extern char *bittok2str(const struct tok *, const char *, u_int);
 extern char *bittok2str_nosep(const struct tok *, const char *, u_int);
+extern char *bittok2strbuf(const struct tok *, const char *, u_int,
+			   const char *sep, char *buf, size_t bufsize);
 
 /* Initialize netdissect. */
 extern int nd_init(char *, size_t);
@@ -157,11 +177,16 @@ extern int nd_have_smi_support(void);
 extern int nd_load_smi_module(const char *, char *, size_t);
 /* Flag indicating whether an SMI module has been loaded. */
 extern int nd_smi_module_loaded;
+/* Load an SMI module when it's first needed. */
+extern int nd_defer_smi_module(const char *, char *, size_t);
 /* Version number of the SMI library, or NULL if we don't have libsmi support. */
 extern const char *nd_smi_version_string(void);
 
 typedef struct netdissect_options netdissect_options;
 
+/* Load the deferred SMI modules, if not yet done; has one been loaded? */
+extern int nd_smi_modules_ready(netdissect_options *);
+
 #define IF_PRINTER_ARGS (netdissect_options *, const struct pcap_pkthdr *, const u_char *)
 
 typedef u_int (*uint_if_printer) IF_PRINTER_ARGS;
@@ -219,16 +244,60 @@ struct netdissect_options {
 				 */
   int ndo_Hflag;		/* dissect 802.11s draft mesh standard */
   const char *ndo_protocol;	/* protocol */
-  jmp_buf ndo_truncated;	/* jmp_buf for setjmp()/longjmp() */
+  nd_jmp_buf ndo_truncated;	/* for ND_SETJMP()/ND_LONGJMP() */
   void *ndo_last_mem_p;		/* pointer to the last allocated memory chunk */
+  char *ndo_arena;		/* per-packet allocation arena */
+  size_t ndo_arena_used;	/* bytes of the arena handed out */
+  uint64_t ndo_nd_mallocs;	/* nd_malloc() calls, for benchmarking */
+  size_t ndo_arena_peak;	/* most of the arena a packet has used */
   int ndo_packet_number;	/* print a packet number in the beginning of line */
+  const char *ndo_ifname;	/* interface to print after the time stamp, or NULL */
   int ndo_suppress_default_print; /* don't use default_print() for unknown packet types */
   int ndo_tstamp_precision;	/* requested time stamp precision */
+  u_int ndo_name_cache_size;	/* host name cache entries, 0 = default */
+  u_int ndo_name_cache_ttl;	/* seconds a host name is kept, 0 = forever */
+  uint64_t ndo_name_cache_hits;	/* host names found in the cache */
+  uint64_t ndo_name_cache_misses; /* and not found, or found stale */
+  u_int ndo_resolver_threads;	/* host name lookup threads, 0 = look up inline */
+  size_t ndo_tcp_reasm_budget;	/* --tcp-reassembly bytes, 0 = off */
+  size_t ndo_ip_reasm_budget;	/* --ip-reassembly bytes, 0 = off */
+  u_int ndo_ip_reasm_overlap;	/* --ip-reassembly-overlap policy */
+  u_int ndo_call_cache_size;	/* calls remembered, 0 = default */
+  size_t ndo_state_budget;	/* --state-memory bytes, 0 = no limit */
+  struct nd_state_slot *ndo_state; /* dissector state; netdissect-state.h */
+  size_t ndo_mem_limit;		/* --mem-limit bytes, 0 = no limit */
+  size_t ndo_mem_charged;	/* the ndo's share of it, last counted */
+  int ndo_latency;		/* --latency-report */
+  int ndo_bgp_summary;		/* --bgp-summary */
+  int ndo_bgp_peers;		/* --bgp-peers */
+  int ndo_lsdb;			/* --lsdb */
+  int ndo_openflow_summary;	/* --openflow-summary */
+  int ndo_radius_summary;	/* --radius-summary */
+  int ndo_dhcp_events;		/* --dhcp-events */
+  int ndo_ppp_sessions;		/* --ppp-sessions */
+  int ndo_mcast_groups;		/* --mcast-groups */
+  int ndo_label_bindings;	/* --label-bindings */
+  int ndo_tcp_analysis;		/* --tcp-analysis */
+  int ndo_mptcp_connections;	/* --mptcp-connections */
+  int ndo_rtp_analysis;		/* --rtp-analysis */
+  int ndo_bfd_sessions;		/* --bfd-sessions */
+  int ndo_http_transactions;	/* --http-transactions */
+  int ndo_someip_summary;	/* --someip-summary */
+  int ndo_v2x_stations;		/* --v2x-stations */
+  int ndo_community_id;		/* --community-id */
+  uint16_t ndo_community_seed;	/* and its seed */
+  FILE *ndo_tap_file;		/* --extract-payloads, or NULL */
+  int ndo_ptp_stats;		/* --ptp-stats */
+  int ndo_check_outgoing;	/* --check-outgoing-cksums */
+  int ndo_all_outgoing;		/* -Q out: every packet was sent by us */
+  int ndo_changes_only;		/* --changes-only; change-only.h */
+  u_int ndo_arp_watch;		/* --arp-watch rate, 0 = off; arp-watch.h */
   const char *program_name;	/* Name of the program using the library */
 
   char *ndo_espsecret;
   struct sa_list *ndo_sa_list_head;  /* used by print-esp.c */
   struct sa_list *ndo_sa_default;
+  struct sa_index *ndo_sa_index;     /* hash index of ndo_sa_list_head */
 
   char *ndo_sigsecret;		/* Signature verification secret key */
 
@@ -240,22 +309,79 @@ struct netdissect_options {
   /*global pointers to beginning and end of current packet (during printing) */
   const u_char *ndo_packetp;
   const u_char *ndo_snapend;
+  nd_ts_t ndo_packet_ts;	/* its time stamp */
+  time_t ndo_packet_sec;	/* seconds part of it */
+  u_int ndo_packet_usec;	/* and microseconds */
+  u_int ndo_packet_nsec;	/* or nanoseconds */
 
   /* stack of saved packet boundary and buffer information */
   struct netdissect_saved_packet_info *ndo_packet_info_stack;
+  /* entries popped off it, kept for the next push */
+  struct netdissect_saved_packet_info *ndo_packet_info_free;
+
+  /*
+   * The IPv4 and IPv6 headers of the datagrams whose payloads are being
+   * printed, or NULL, and their final destinations, as found by
+   * ip_print() (with -v, which has it walk the options) and ip6_print(),
+   * for nextproto4_cksum() and nextproto6_cksum().
+   */
+  const u_char *ndo_ip4_hdr;
+  uint32_t ndo_ip4_dst;		/* in network byte order */
+  const u_char *ndo_ip6_hdr;
+  const u_char *ndo_ip6_dst;
+
+  /*
+   * The IPv4 or IPv6 header of the innermost datagram whose payload is
+   * being printed, as given to ip_print_demux(), or NULL.
+   */
+  const u_char *ndo_iph;
 
   /* pointer to the uint_if_printer or the void_if_printer function */
   if_printer_t ndo_if_printer;
   int ndo_void_printer; /* void_if_printer ? (FALSE/TRUE) */
+  const char *ndo_if_printer_name; /* link-layer type, for profiling */
 
   /* pointer to void function to output stuff */
   void (*ndo_default_print)(netdissect_options *,
 			    const u_char *bp, u_int length);
 
+  /* output buffer used by ndo_printf(); NULL if output is unbuffered */
+  char *ndo_outbuf;
+  size_t ndo_outbuf_size;	/* size of the output buffer */
+  size_t ndo_outbuf_len;	/* number of bytes in the output buffer */
+  uint64_t ndo_outbuf_writes;	/* times output was handed to ndo_output */
+  size_t ndo_max_output;	/* --max-output-per-packet, or 0 */
+  size_t ndo_output_left;	/* 1 + what the printer may still print, or 0 */
+  int ndo_output_cut;		/* the printer was cut off at the limit */
+  int ndo_drop_line;		/* a printer asked that the packet not be shown */
+  char ndo_community_id_str[31]; /* the packet's Community ID, or "" */
+  int ndo_outgoing;		/* the packet was sent by this host */
+  void *ndo_output_arg;		/* private data for ndo_output */
+
   /* pointer to function to do regular output */
   int  (*ndo_printf)(netdissect_options *,
 		     const char *fmt, ...)
 		     PRINTFLIKE_FUNCPTR(2, 3);
+  /* pointer to function to write out the output buffer */
+  int  (*ndo_output)(netdissect_options *, const char *buf, size_t len);
+  /* pointer to function to report a decoded field; NULL if not wanted */
+  void (*ndo_field)(netdissect_options *, u_int proto, u_int field,
+		    u_int type, const u_char *val, u_int len);
+  u_char *ndo_field_buf;	/* record being built by the field encoder */
+  size_t ndo_field_len;		/* bytes of it used */
+  size_t ndo_field_size;	/* bytes allocated */
+  u_int ndo_field_layer;	/* JSON: protocol of the open object */
+  u_char ndo_field_layers[32];	/* JSON: times each protocol was seen */
+  struct nd_proto_stats *ndo_stats;	/* --stats-only counters */
+  struct nd_flows *ndo_flows;	/* --flows table */
+  struct nd_topn *ndo_topn;	/* --top sketches */
+  struct nd_rates *ndo_rates;	/* --rates counters */
+  struct nd_dfilter *ndo_dfilter;	/* --display-filter program */
+  uint64_t ndo_dfilter_hits;	/* its tests that held for the packet */
+  int ndo_dfilter_verdict;	/* ND_DFILTER_... for the packet */
+  struct nd_memo *ndo_memo;	/* --memo; netdissect-memo.h */
+  struct nd_profile *ndo_profile;	/* --profile-dissectors counters */
+  struct nd_snapacct *ndo_snapacct;	/* --snaplen-report counters */
   /* pointer to function to output errors */
   void NORETURN_FUNCPTR (*ndo_error)(netdissect_options *,
 				     status_exit_codes_t status,
@@ -267,12 +393,21 @@ struct netdissect_options {
 		      PRINTFLIKE_FUNCPTR(2, 3);
 };
 
+/* Are the time stamps of the packets read in nanoseconds? */
+#ifdef HAVE_PCAP_SET_TSTAMP_PRECISION
+#define ND_TSTAMP_NANO(ndo) \
+	((ndo)->ndo_tstamp_precision == PCAP_TSTAMP_PRECISION_NANO)
+#else
+#define ND_TSTAMP_NANO(ndo)	0
+#endif
+
 extern int nd_push_buffer(netdissect_options *, u_char *, const u_char *,
     const u_char *);
 extern int nd_push_snapend(netdissect_options *, const u_char *);
 extern void nd_change_snapend(netdissect_options *, const u_char *);
 extern void nd_pop_packet_info(netdissect_options *);
 extern void nd_pop_all_packet_info(netdissect_options *);
+extern void nd_free_packet_info(netdissect_options *);
 
 #define PT_VAT		1	/* Visual Audio Tool */
 #define PT_WB		2	/* distributed White Board */
@@ -360,8 +495,22 @@ extern void nd_pop_all_packet_info(netdissect_options *);
  */
 #define IS_NOT_NEGATIVE(x) (((x) > 0) || ((x) == 0))
 
+/*
+ * With --snaplen-report, note how far into the packet each check
+ * looks; see netdissect-profile.h.
+ */
+#ifdef ENABLE_DISSECTOR_PROFILE
+extern void nd_snaplen_note(const netdissect_options *, const u_char *,
+    uint64_t);
+#define ND_SNAPLEN_NOTE(p, l) \
+  (ndo->ndo_snapacct == NULL || \
+	(nd_snaplen_note(ndo, (const u_char *)(p), (uint64_t)(l)), 1))
+#else
+#define ND_SNAPLEN_NOTE(p, l) 1
+#endif
+
 #define ND_TTEST_LEN(p, l) \
-  (IS_NOT_NEGATIVE(l) && \
+  (IS_NOT_NEGATIVE(l) && ND_SNAPLEN_NOTE(p, l) && \
 	((uintptr_t)ndo->ndo_snapend - (l) <= (uintptr_t)ndo->ndo_snapend && \
          (uintptr_t)(p) <= (uintptr_t)ndo->ndo_snapend - (l)))
 
@@ -388,7 +537,22 @@ extern void nd_pop_all_packet_info(netdissect_options *);
 #define ND_PRINT(...) (ndo->ndo_printf)(ndo, __VA_ARGS__)
 #define ND_DEFAULTPRINT(ap, length) (*ndo->ndo_default_print)(ndo, ap, length)
 
+/*
+ * Output buffering.  If an output buffer has been allocated with
+ * nd_outbuf_init(), ndo_printf() formats into it, and the buffer is
+ * handed to ndo->ndo_output when the packet has been printed or when
+ * the buffer fills up.
+ */
+#define ND_OUTBUF_SIZE	65536
+
+extern int nd_outbuf_init(netdissect_options *, size_t);
+extern void nd_outbuf_free(netdissect_options *);
+extern void nd_outbuf_write(netdissect_options *, const char *, size_t);
+extern void nd_outbuf_flush(netdissect_options *);
+
 extern void ts_print(netdissect_options *, const struct timeval *);
+extern struct tm *nd_localtime(const time_t *, struct tm *);
+extern struct tm *nd_gmtime(const time_t *, struct tm *);
 extern void signed_relts_print(netdissect_options *, int32_t);
 extern void unsigned_relts_print(netdissect_options *, uint32_t);
 
@@ -475,6 +639,7 @@ extern u_int dsa_if_print IF_PRINTER_ARGS;
 extern u_int edsa_if_print IF_PRINTER_ARGS;
 extern void enc_if_print IF_PRINTER_ARGS;
 extern u_int ether_if_print IF_PRINTER_ARGS;
+extern u_int ether_quick_print IF_PRINTER_ARGS;
 extern u_int fddi_if_print IF_PRINTER_ARGS;
 extern u_int fr_if_print IF_PRINTER_ARGS;
 extern u_int ieee802_11_if_print IF_PRINTER_ARGS;
@@ -525,6 +690,21 @@ extern void symantec_if_print IF_PRINTER_ARGS;
 extern u_int token_if_print IF_PRINTER_ARGS;
 extern void usb_linux_48_byte_if_print IF_PRINTER_ARGS;
 extern void usb_linux_64_byte_if_print IF_PRINTER_ARGS;
+/* The --latency-report counts of the URBs completed on a USB endpoint. */
+struct usb_endpoint_stats {
+	u_int ues_bus;
+	u_int ues_device;
+	u_int ues_endpoint;		/* with 0x80 set for IN */
+	u_int ues_transfer_type;
+	uint64_t ues_urbs;
+	uint64_t ues_bytes;		/* as completed */
+	uint64_t ues_errors;		/* URBs completed with an error */
+	nd_ts_t	ues_first_ts;		/* the first URB counted */
+	nd_ts_t	ues_last_ts;		/* the last completion counted */
+};
+typedef void (*usb_endpoint_fn)(void *, const struct usb_endpoint_stats *);
+extern void usb_endpoint_foreach(usb_endpoint_fn, void *);
+extern void usb_endpoint_reset(void);
 extern u_int vsock_if_print IF_PRINTER_ARGS;
 
 /*
@@ -542,6 +722,56 @@ struct lladdr_info {
 	const u_char *addr;
 };
 
+/*
+ * Dissector dispatch.  ethertype_print() and ip_print_demux() look the
+ * type or protocol up in tables indexed by it, filled in by
+ * nd_dispatch_init() from the built-in dissectors and by the
+ * nd_register_*() routines, which may replace a built-in; a printer of
+ * NULL removes the entry.  The dissector is kept, not copied, so it
+ * must stay around.  Registering must be done before packets
+ * are dissected, as the tables are shared with dissection threads
+ * without locking.
+ *
+ * nd_disable_dissector() turns off the built-in dissectors with a
+ * given name, so those packets are printed as unknown; it must be
+ * called before nd_dispatch_init(), and returns -1 if no dissector
+ * has that name.  nd_dispatch_init() returns -1 if it runs out of
+ * memory.
+ *
+ * TCP and UDP application printers are chosen by port in the same
+ * way; see portdispatch.h.  nd_map_port() sends a port to a named
+ * one of them, ahead of the built-in port assignments.
+ */
+typedef void (*ethertype_printer)(netdissect_options *, const u_char *,
+    u_int length, u_int caplen, const struct lladdr_info *src,
+    const struct lladdr_info *dst);
+
+struct ethertype_dissector {
+	u_short type;
+	const char *name;
+	ethertype_printer printer;
+};
+
+typedef void (*ipproto_printer)(netdissect_options *, const u_char *,
+    u_int length, u_int ver, int fragmented, u_int ttl_hl,
+    const u_char *iph);
+
+struct ipproto_dissector {
+	uint8_t proto;
+	const char *name;
+	ipproto_printer printer;
+};
+
+extern const struct ethertype_dissector ethertype_dissectors[];
+extern const struct ipproto_dissector ipproto_dissectors[];
+
+extern int nd_dispatch_init(void);
+extern int nd_register_ethertype(const struct ethertype_dissector *);
+extern int nd_register_ipproto(const struct ipproto_dissector *);
+extern int nd_disable_dissector(const char *);
+extern int nd_map_port(u_int, const char *);
+extern int nd_dissector_disabled(const char *);
+
 /* The printer routines. */
 
 extern void aarp_print(netdissect_options *, const u_char *, u_int);
@@ -550,14 +780,63 @@ extern void ahcp_print(netdissect_options *, const u_char *, const u_int);
 extern void aodv_print(netdissect_options *, const u_char *, u_int, int);
 extern void aoe_print(netdissect_options *, const u_char *, const u_int);
 extern int  arista_ethertype_print(netdissect_options *,const u_char *, u_int);
+extern int arista_hw_tstamp(const u_char *, u_int, u_int, int, time_t,
+    time_t *, uint32_t *);
 extern void arp_print(netdissect_options *, const u_char *, u_int, u_int);
 extern void ascii_print(netdissect_options *, const u_char *, u_int);
 extern void atalk_print(netdissect_options *, const u_char *, u_int);
 extern void atm_print(netdissect_options *, u_int, u_int, u_int, const u_char *, u_int, u_int);
 extern void babel_print(netdissect_options *, const u_char *, u_int);
 extern void beep_print(netdissect_options *, const u_char *, u_int);
-extern void bfd_print(netdissect_options *, const u_char *, u_int, u_int);
-extern void bgp_print(netdissect_options *, const u_char *, u_int);
+extern void bfd_print(netdissect_options *, const u_char *, u_int, u_int, const u_char *);
+/* The --bfd-sessions state and counters of a system's BFD session. */
+struct bfd_session_stats {
+	const char *bss_name;		/* "address My-Discriminator" */
+	const char *bss_state;		/* the one it last sent */
+	uint32_t bss_interval;		/* agreed transmit interval, us */
+	uint64_t bss_packets;
+	uint64_t bss_transitions;	/* changes of state */
+	uint64_t bss_gaps;		/* times between packets while Up */
+	uint64_t bss_dev_total;		/* their differences from the interval, us */
+	uint64_t bss_max_gap;		/* us */
+	uint64_t bss_late;		/* gaps over the interval */
+	uint64_t bss_detect;		/* and over the detection time */
+	uint64_t bss_early;		/* jittered more than is allowed */
+};
+typedef void (*bfd_session_fn)(void *, const struct bfd_session_stats *);
+extern void bfd_session_foreach(bfd_session_fn, void *);
+extern void bgp_print(netdissect_options *, const u_char *, u_int, const u_char *);
+typedef void (*bgp_peer_fn)(void *, const char *, const char *, uint64_t,
+    uint64_t);
+extern void bgp_peer_foreach(bgp_peer_fn, void *);
+/* The --bgp-peers counters for the messages a speaker sent a peer. */
+#define BGP_PEER_NOTIFICATIONS	4	/* kinds of NOTIFICATION counted */
+struct bgp_session_stats {
+	const char *bss_src;		/* the speaker */
+	const char *bss_dst;		/* and its peer */
+	uint64_t bss_opens;
+	uint64_t bss_updates;
+	uint64_t bss_notifications;
+	uint64_t bss_keepalives;
+	uint64_t bss_route_refreshes;
+	uint64_t bss_unknown;		/* messages of other types */
+	uint64_t bss_announced;		/* prefixes */
+	uint64_t bss_withdrawn;
+	uint64_t bss_eor;		/* End-of-RIB markers */
+	uint64_t bss_update_us;		/* from the first UPDATE to the last */
+	u_int bss_update_peak;		/* most UPDATEs in a second */
+	uint64_t bss_keepalive_intervals;
+	uint64_t bss_keepalive_mean_us;
+	uint64_t bss_keepalive_min_us;
+	uint64_t bss_keepalive_max_us;
+	uint64_t bss_keepalive_jitter_us; /* mean change between intervals */
+	u_int bss_nnotifications;
+	const char *bss_notification[BGP_PEER_NOTIFICATIONS];
+	uint64_t bss_notification_count[BGP_PEER_NOTIFICATIONS];
+	uint64_t bss_other_notifications; /* of other kinds than those */
+};
+typedef void (*bgp_session_fn)(void *, const struct bgp_session_stats *);
+extern void bgp_session_foreach(bgp_session_fn, void *);
 extern const char *bgp_vpn_rd_print(netdissect_options *, const u_char *);
 extern void bootp_print(netdissect_options *, const u_char *, u_int);
 extern void calm_fast_print(netdissect_options *, const u_char *, u_int, const struct lladdr_info *);
@@ -566,7 +845,7 @@ extern void cdp_print(netdissect_options *, const u_char *, u_int, u_int);
 extern void cfm_print(netdissect_options *, const u_char *, u_int);
 extern u_int chdlc_print(netdissect_options *, const u_char *, u_int);
 extern void cisco_autorp_print(netdissect_options *, const u_char *, u_int);
-extern void cnfp_print(netdissect_options *, const u_char *);
+extern void cnfp_print(netdissect_options *, const u_char *, u_int, const u_char *);
 extern void dccp_print(netdissect_options *, const u_char *, const u_char *, u_int);
 extern void decnet_print(netdissect_options *, const u_char *, u_int, u_int);
 extern void dhcp6_print(netdissect_options *, const u_char *, u_int);
@@ -579,6 +858,7 @@ extern void eigrp_print(netdissect_options *, const u_char *, u_int);
 extern void esp_print(netdissect_options *, const u_char *, u_int, const u_char *, u_int, int, u_int);
 extern u_int ether_print(netdissect_options *, const u_char *, u_int, u_int, void (*)(netdissect_options *, const u_char *), const u_char *);
 extern u_int ether_print_switch_tag(netdissect_options *, const u_char *, u_int, u_int, void (*)(netdissect_options *, const u_char *), u_int);
+extern void ether_prefetch(netdissect_options *, const u_char *, u_int);
 extern int ethertype_print(netdissect_options *, u_short, const u_char *, u_int, u_int, const struct lladdr_info *, const struct lladdr_info *);
 extern u_int fddi_print(netdissect_options *, const u_char *, u_int, u_int);
 extern void forces_print(netdissect_options *, const u_char *, u_int);
@@ -587,6 +867,29 @@ extern int frag6_print(netdissect_options *, const u_char *, const u_char *);
 extern void ftp_print(netdissect_options *, const u_char *, u_int);
 extern void geneve_print(netdissect_options *, const u_char *, u_int);
 extern void geonet_print(netdissect_options *, const u_char *, u_int, const struct lladdr_info *);
+/* The --v2x-stations counters for a GeoNetworking or CALM FAST station. */
+struct v2x_station_stats {
+	const char *vss_station;	/* "gn" or "calm", and its address */
+	uint64_t vss_messages;
+	uint64_t vss_first_us;		/* time stamps, in microseconds */
+	uint64_t vss_last_us;
+	uint64_t vss_max_gap_us;	/* longest between two messages */
+	u_int vss_peak;			/* most in a second */
+	uint64_t vss_recent;		/* since the last report, or expiry */
+	uint64_t vss_beacons;
+	uint64_t vss_single_hop;	/* single-hop broadcasts */
+	uint64_t vss_multi_hop;		/* geo- and multi-hop broadcasts */
+	uint64_t vss_unicasts;		/* and location service */
+	uint64_t vss_cams;		/* by BTP ItsPduHeader type */
+	uint64_t vss_denms;
+	int vss_have_position;
+	int32_t vss_lat;		/* 1/10 microdegrees */
+	int32_t vss_lon;
+	uint64_t vss_moves;		/* the position changed */
+};
+typedef void (*v2x_station_fn)(void *, const struct v2x_station_stats *);
+extern void v2x_station_foreach(v2x_station_fn, void *);
+extern void v2x_station_expire(uint64_t);
 extern void gre_print(netdissect_options *, const u_char *, u_int);
 extern int hbhopt_process(netdissect_options *, const u_char *, int *, uint32_t *);
 extern void hex_and_ascii_print(netdissect_options *, const char *, const u_char *, u_int);
@@ -595,11 +898,56 @@ extern void hex_print_with_offset(netdissect_options *, const char *ident, const
 extern void hncp_print(netdissect_options *, const u_char *, u_int);
 extern void hsrp_print(netdissect_options *, const u_char *, u_int);
 extern void http_print(netdissect_options *, const u_char *, u_int);
+extern int http_frame(const u_char *, u_int, u_int *);
+extern void http_transaction(netdissect_options *, const u_char *, u_int, const u_char *, u_int, u_int);
 extern void icmp6_print(netdissect_options *, const u_char *, u_int, const u_char *, int);
 extern void icmp_print(netdissect_options *, const u_char *, u_int, const u_char *, int);
 extern u_int ieee802_15_4_print(netdissect_options *, const u_char *, u_int);
+/* The --wpan-stats counters for the frames from a source. */
+struct wpan_stats {
+	int ws_has_pan;			/* ws_pan is the source PAN ID */
+	uint16_t ws_pan;
+	u_int ws_addr_len;		/* 2, 8, or 0 for none */
+	u_char ws_addr[8];		/* as in the frame, little-endian */
+	uint64_t ws_frames;
+	uint64_t ws_bytes;
+	uint64_t ws_types[8];		/* frames of each frame type */
+};
+typedef void (*wpan_fn)(void *, const struct wpan_stats *);
+extern void ieee802_15_4_count(netdissect_options *, int, const u_char *,
+    u_int, u_int);
+extern void wpan_foreach(wpan_fn, void *);
 extern u_int ieee802_11_radio_print(netdissect_options *, const u_char *, u_int, u_int);
-extern void igmp_print(netdissect_options *, const u_char *, u_int);
+/* The --beacon-stats counters for the beacons of a BSS. */
+struct bssid_stats {
+	u_char bs_bssid[6];
+	char bs_ssid[33];		/* unprintable characters as '.' */
+	u_int bs_freq;			/* MHz, or 0 if not known */
+	uint64_t bs_beacons;
+	uint64_t bs_changes;		/* those not repeating the last one */
+	uint64_t bs_signals;		/* those with a signal strength */
+	int bs_signal_min;		/* dBm */
+	int bs_signal_max;
+	int64_t bs_signal_total;
+};
+typedef void (*bssid_fn)(void *, const struct bssid_stats *);
+extern int ieee802_11_beacon_repeat(netdissect_options *, int,
+    const u_char *, u_int, u_int);
+extern void bssid_foreach(bssid_fn, void *);
+extern void igmp_print(netdissect_options *, const u_char *, u_int, const u_char *);
+/* The --mcast-groups state and counters for an (S,G) or (*,G). */
+struct mcast_group_stats {
+	const char *mgs_group;		/* "(S,G)" or "(*,G)" */
+	u_int mgs_members;		/* hosts that are members now */
+	int mgs_upstream;		/* joined upstream by PIM */
+	uint64_t mgs_reports;		/* reports for it, refreshes included */
+	uint64_t mgs_joins;		/* hosts becoming members */
+	uint64_t mgs_leaves;		/* and ceasing to be */
+	uint64_t mgs_pim_joins;		/* PIM joins for it, refreshes included */
+	uint64_t mgs_pim_prunes;
+};
+typedef void (*mcast_group_fn)(void *, const struct mcast_group_stats *);
+extern void mcast_group_foreach(mcast_group_fn, void *);
 extern void igrp_print(netdissect_options *, const u_char *, u_int);
 extern void ip6_print(netdissect_options *, const u_char *, u_int);
 extern void ipN_print(netdissect_options *, const u_char *, u_int);
@@ -612,8 +960,37 @@ extern void isakmp_rfc3948_print(netdissect_options *, const u_char *, u_int, co
 extern void isoclns_print(netdissect_options *, const u_char *, u_int);
 extern void krb_print(netdissect_options *, const u_char *);
 extern void l2tp_print(netdissect_options *, const u_char *, u_int);
+/* The --ppp-sessions state and counters for an L2TP or PPPoE session. */
+#define PPP_SESSION_L2TP	0
+#define PPP_SESSION_PPPOE	1
+#define PPP_SESSION_TUNNEL	0x10000	/* the session of an L2TP tunnel */
+#define PPP_SESSION_SEEN	0	/* only data seen */
+#define PPP_SESSION_SETUP	1	/* being set up */
+#define PPP_SESSION_UP		2
+#define PPP_SESSION_DOWN	3
+struct ppp_session_stats {
+	u_int pss_proto;		/* PPP_SESSION_L2TP or PPP_SESSION_PPPOE */
+	u_int pss_tunnel;		/* L2TP tunnel ID, as addressed */
+	u_int pss_session;		/* session ID, or PPP_SESSION_TUNNEL */
+	u_int pss_state;
+	uint64_t pss_packets;		/* data packets to it */
+	uint64_t pss_bytes;		/* and their PPP bytes */
+	uint64_t pss_control;		/* control or discovery messages */
+};
+typedef void (*ppp_session_fn)(void *, const struct ppp_session_stats *);
+extern void ppp_session_foreach(ppp_session_fn, void *);
 extern void lane_print(netdissect_options *, const u_char *, u_int, u_int);
 extern void ldp_print(netdissect_options *, const u_char *, u_int);
+/* The --label-bindings state and counters for an LDP FEC or RSVP-TE LSP. */
+struct label_binding_stats {
+	const char *lbs_name;		/* what the label is bound to */
+	u_int lbs_label;		/* the last label bound */
+	int lbs_bound;			/* and whether it still is */
+	uint64_t lbs_changes;		/* messages that changed it */
+	uint64_t lbs_refreshes;		/* and that didn't */
+};
+typedef void (*label_binding_fn)(void *, const struct label_binding_stats *);
+extern void label_binding_foreach(label_binding_fn, void *);
 extern void lisp_print(netdissect_options *, const u_char *, u_int);
 extern u_int llap_print(netdissect_options *, const u_char *, u_int);
 extern int llc_print(netdissect_options *, const u_char *, u_int, u_int, const struct lladdr_info *, const struct lladdr_info *);
@@ -631,9 +1008,33 @@ extern int mobility_print(netdissect_options *, const u_char *, const u_char *);
 extern void mpcp_print(netdissect_options *, const u_char *, u_int);
 extern void mpls_print(netdissect_options *, const u_char *, u_int);
 extern int mptcp_print(netdissect_options *, const u_char *, u_int, u_char);
+/* The --mptcp-connections counters for an MPTCP connection. */
+struct mptcp_conn_stats {
+	const char *mcs_first;		/* its first subflow, "addr.port > addr.port" */
+	uint32_t mcs_token[2];		/* [0] the initiator's */
+	u_int mcs_tokens;		/* a bit for each token that's known */
+	u_int mcs_subflows;
+	uint64_t mcs_packets;
+	uint64_t mcs_data[2];		/* bytes of data, [0] from the initiator */
+	uint64_t mcs_first_us;		/* when the first and last packets came */
+	uint64_t mcs_last_us;
+	u_int mcs_data_fins;		/* a bit for each side that's sent one */
+	int mcs_fast_close;
+};
+/* And for one of its subflows. */
+struct mptcp_subflow_stats {
+	const char *mss_name;		/* as its first segment went */
+	int mss_join;			/* started with MP_JOIN */
+	uint64_t mss_packets;
+	uint64_t mss_data[2];		/* bytes mapped, [0] from the initiator */
+};
+typedef void (*mptcp_conn_fn)(void *, const struct mptcp_conn_stats *);
+typedef void (*mptcp_subflow_fn)(void *, const struct mptcp_subflow_stats *);
+extern void mptcp_conn_foreach(mptcp_conn_fn, mptcp_subflow_fn, void *);
+extern void mptcp_track(netdissect_options *, const u_char *, const u_char *, u_int, const u_char *, u_int);
 extern void msdp_print(netdissect_options *, const u_char *, u_int);
 extern void msnlb_print(netdissect_options *, const u_char *);
-extern void nbt_tcp_print(netdissect_options *, const u_char *, u_int);
+extern void nbt_tcp_print(netdissect_options *, const u_char *, u_int, const u_char *, u_int, u_int);
 extern void nbt_udp137_print(netdissect_options *, const u_char *, u_int);
 extern void nbt_udp138_print(netdissect_options *, const u_char *, u_int);
 extern void netbeui_print(netdissect_options *, u_short, const u_char *, u_int);
@@ -642,11 +1043,39 @@ extern void nfsreply_noaddr_print(netdissect_options *, const u_char *, u_int, c
 extern void nfsreq_noaddr_print(netdissect_options *, const u_char *, u_int, const u_char *);
 extern const u_char *fqdn_print(netdissect_options *, const u_char *, const u_char *);
 extern void domain_print(netdissect_options *, const u_char *, u_int, int);
+extern void domain_latency(netdissect_options *, const u_char *, u_int, const u_char *, u_int, u_int);
 extern void nsh_print(netdissect_options *, const u_char *, u_int);
 extern void ntp_print(netdissect_options *, const u_char *, u_int);
 extern void oam_print(netdissect_options *, const u_char *, u_int, u_int);
 extern void olsr_print(netdissect_options *, const u_char *, u_int, int);
-extern void openflow_print(netdissect_options *, const u_char *, const u_int);
+extern void openflow_print(netdissect_options *, const u_char *, const u_int,
+    const u_char *, u_int, u_int);
+/* The --openflow-summary counters for one kind of message to a switch. */
+struct openflow_rate {
+	uint64_t or_count;
+	uint64_t or_first_us;		/* time stamps, in microseconds */
+	uint64_t or_last_us;
+	uint64_t or_second;		/* the second "or_in_second" were in */
+	u_int or_in_second;
+	u_int or_peak;			/* most in a second */
+};
+/* The --openflow-summary counters for the connection of a switch. */
+struct openflow_switch_stats {
+	const char *ofs_switch;		/* its address and port */
+	int ofs_have_dpid;		/* it sent a FEATURES_REPLY */
+	uint64_t ofs_dpid;
+	uint64_t ofs_messages_from;	/* sent by the switch */
+	uint64_t ofs_messages_to;	/* sent to it */
+	struct openflow_rate ofs_flow_mods;
+	struct openflow_rate ofs_packet_ins;
+	struct openflow_rate ofs_packet_outs;
+	uint64_t ofs_flow_removed;
+	uint64_t ofs_port_status;
+	uint64_t ofs_errors;		/* sent by either side */
+};
+typedef void (*openflow_switch_fn)(void *,
+    const struct openflow_switch_stats *);
+extern void openflow_switch_foreach(openflow_switch_fn, void *);
 extern void ospf6_print(netdissect_options *, const u_char *, u_int);
 extern void ospf_print(netdissect_options *, const u_char *, u_int, const u_char *);
 extern int ospf_grace_lsa_print(netdissect_options *, const u_char *, u_int);
@@ -659,36 +1088,109 @@ extern u_int ppp_print(netdissect_options *, const u_char *, u_int);
 extern u_int pppoe_print(netdissect_options *, const u_char *, u_int);
 extern void pptp_print(netdissect_options *, const u_char *);
 extern void ptp_print(netdissect_options *, const u_char *, u_int);
+extern void ptp_stats_report(netdissect_options *, time_t);
 extern int print_unknown_data(netdissect_options *, const u_char *, const char *, int);
 extern const char *q922_string(netdissect_options *, const u_char *, u_int);
 extern void q933_print(netdissect_options *, const u_char *, u_int);
 extern void radius_print(netdissect_options *, const u_char *, u_int);
+extern void radius_latency(netdissect_options *, const u_char *, u_int, const u_char *, u_int, u_int);
+extern int radius_summary_attrs(const char *);
+#define RADIUS_SUMMARY_DEFAULT	"User-Name,Acct-Session-Id,Framed-IP-Address"
 extern void resp_print(netdissect_options *, const u_char *, u_int);
+extern void resp_extract(netdissect_options *, const u_char *, u_int, int);
+/* The --extract-payloads counters for a Redis command. */
+struct resp_command_stats {
+	const char *rc_name;		/* upper-cased */
+	uint64_t rc_count;
+	uint64_t rc_bytes;		/* of the commands, as sent */
+};
+typedef void (*resp_command_fn)(void *, const struct resp_command_stats *);
+extern void resp_command_foreach(resp_command_fn, void *);
 extern void rip_print(netdissect_options *, const u_char *, u_int);
 extern void ripng_print(netdissect_options *, const u_char *, unsigned int);
 extern void rpki_rtr_print(netdissect_options *, const u_char *, u_int);
 extern void rrcp_print(netdissect_options *, const u_char *, u_int, const struct lladdr_info *, const struct lladdr_info *);
 extern void rsvp_print(netdissect_options *, const u_char *, u_int);
 extern int rt6_print(netdissect_options *, const u_char *, const u_char *);
+/* The --rtp-analysis counters for an RTP stream. */
+struct rtp_stream_stats {
+	const char *rss_stream;		/* "addr.port > addr.port" */
+	uint32_t rss_ssrc;
+	u_int rss_pt;			/* its first payload type */
+	u_int rss_clock;		/* and that one's clock rate, or 0 */
+	uint64_t rss_packets;
+	uint64_t rss_expected;		/* from the sequence numbers */
+	int64_t rss_lost;		/* less those received */
+	uint64_t rss_gaps;		/* in the sequence numbers */
+	uint64_t rss_out_of_order;
+	uint64_t rss_duplicates;
+	uint64_t rss_jumps;		/* sequence numbers too far off to count */
+	uint64_t rss_jitter_us;		/* if the clock rate is known */
+	uint64_t rss_max_jitter_us;
+	uint64_t rss_last_us;		/* when the last packet came */
+};
+typedef void (*rtp_analysis_fn)(void *, const struct rtp_stream_stats *);
+extern void rtp_analysis_foreach(rtp_analysis_fn, void *);
+extern void rtp_analysis_expire(uint64_t);
 extern void rtsp_print(netdissect_options *, const u_char *, u_int);
 extern void rx_print(netdissect_options *, const u_char *, u_int, u_int, u_int, const u_char *);
-extern void sctp_print(netdissect_options *, const u_char *, const u_char *, u_int);
+extern void sctp_print(netdissect_options *, const u_char *, const u_char *, u_int, int);
 extern void sflow_print(netdissect_options *, const u_char *, u_int);
 extern void ssh_print(netdissect_options *, const u_char *, u_int);
 extern void sip_print(netdissect_options *, const u_char *, u_int);
 extern void slow_print(netdissect_options *, const u_char *, u_int);
-extern void smb_tcp_print(netdissect_options *, const u_char *, u_int);
+extern void smb2_print(netdissect_options *, const u_char *, u_int, const u_char *, u_int, u_int);
+/* The --latency-report counts of the SMB2 READs and WRITEs to a share. */
+#define SMB2_SHARE_LEN	80
+struct smb2_share_stats {
+	char ss_share[SMB2_SHARE_LEN];	/* as in a TREE_CONNECT */
+	uint64_t ss_reads;
+	uint64_t ss_read_bytes;
+	uint64_t ss_writes;
+	uint64_t ss_write_bytes;
+	nd_ts_t	ss_first_ts;		/* the first request counted */
+	nd_ts_t	ss_last_ts;		/* the last response counted */
+};
+typedef void (*smb2_share_fn)(void *, const struct smb2_share_stats *);
+extern void smb2_share_foreach(smb2_share_fn, void *);
+extern void smb2_share_reset(void);
+extern void smb_tcp_print(netdissect_options *, const u_char *, u_int, const u_char *, u_int, u_int);
 extern void smtp_print(netdissect_options *, const u_char *, u_int);
 extern int snap_print(netdissect_options *, const u_char *, u_int, u_int, const struct lladdr_info *, const struct lladdr_info *, u_int);
 extern void snmp_print(netdissect_options *, const u_char *, u_int);
 extern void stp_print(netdissect_options *, const u_char *, u_int);
 extern void sunrpc_print(netdissect_options *, const u_char *, u_int, const u_char *);
+extern void sunrpc_reply_latency(netdissect_options *, const u_char *, const u_char *);
 extern void syslog_print(netdissect_options *, const u_char *, u_int);
+/* The --tcp-analysis counters for a TCP conversation. */
+struct tcp_analysis_stats {
+	const char *tas_conn;		/* "addr.port > addr.port" */
+	int tas_closed;			/* by a RST, or a FIN each way */
+	uint64_t tas_packets;
+	uint64_t tas_bytes;		/* of payload */
+	uint64_t tas_retransmissions;
+	uint64_t tas_out_of_order;
+	uint64_t tas_lost;		/* segments not captured */
+	uint64_t tas_keepalives;
+	uint64_t tas_dup_acks;
+	uint64_t tas_zero_windows;	/* times a window closed */
+	uint64_t tas_zero_window_us;	/* and how long they stayed closed */
+	uint64_t tas_window_full;
+	uint64_t tas_rtt_samples;
+	uint64_t tas_rtt_min_us;
+	uint64_t tas_rtt_max_us;
+	uint64_t tas_rtt_total_us;
+	uint64_t tas_handshake_us;	/* SYN to the ACK of the SYN-ACK, or 0 */
+};
+typedef void (*tcp_analysis_fn)(void *, const struct tcp_analysis_stats *);
+extern void tcp_analysis_foreach(tcp_analysis_fn, void *);
 extern void tcp_print(netdissect_options *, const u_char *, u_int, const u_char *, int);
 extern void telnet_print(netdissect_options *, const u_char *, u_int);
 extern void tftp_print(netdissect_options *, const u_char *, u_int);
 extern void timed_print(netdissect_options *, const u_char *);
 extern void tipc_print(netdissect_options *, const u_char *, u_int, u_int);
+extern int tls_frame(const u_char *, u_int, u_int *);
+extern int tls_print(netdissect_options *, const u_char *, u_int);
 extern u_int token_print(netdissect_options *, const u_char *, u_int, u_int);
 extern void udld_print(netdissect_options *, const u_char *, u_int);
 extern void udp_print(netdissect_options *, const u_char *, u_int, const u_char *, int, u_int);
@@ -704,10 +1206,32 @@ extern void zephyr_print(netdissect_options *, const u_char *, int);
 extern void zmtp1_print(netdissect_options *, const u_char *, u_int);
 extern void zmtp1_datagram_print(netdissect_options *, const u_char *, const u_int);
 extern void someip_print(netdissect_options *, const u_char *, const u_int);
+/* The --someip-summary counters for a method or event of a service. */
+struct someip_method_stats {
+	uint16_t sms_service;
+	uint16_t sms_method;		/* or event, with 0x8000 set */
+	uint64_t sms_messages;
+	uint64_t sms_first_us;		/* time stamps, in microseconds */
+	uint64_t sms_last_us;
+	u_int sms_peak;			/* most in a second */
+	uint64_t sms_requests;		/* expecting a response */
+	uint64_t sms_no_return;		/* REQUEST_NO_RETURN */
+	uint64_t sms_notifications;
+	uint64_t sms_responses;		/* RESPONSE and ERROR */
+	uint64_t sms_errors;		/* ERROR, or a return code but E_OK */
+	uint64_t sms_unmatched;		/* responses to no request seen */
+	uint64_t sms_timed;		/* responses paired with a request */
+	uint64_t sms_rtt_total_us;
+	uint64_t sms_rtt_min_us;
+	uint64_t sms_rtt_max_us;
+};
+typedef void (*someip_method_fn)(void *, const struct someip_method_stats *);
+extern void someip_method_foreach(someip_method_fn, void *);
 
 /* checksum routines */
 extern void init_checksum(void);
 extern uint16_t verify_crc10_cksum(uint16_t, const u_char *, int);
+extern uint32_t crc32c_cksum(uint32_t, const u_char *, u_int);
 extern uint16_t create_osi_cksum(const uint8_t *, int, int);
 
 struct cksum_vec {
@@ -717,8 +1241,17 @@ struct cksum_vec {
 extern uint16_t in_cksum(const struct cksum_vec *, int);
 extern uint16_t in_cksum_shouldbe(uint16_t, uint16_t);
 
+/*
+ * True if the packet was sent by this host, whose TCP, UDP and SCTP
+ * checksums the NIC may fill in after the packet was captured, and
+ * which --check-outgoing-cksums hasn't asked us to check anyway.
+ */
+#define ND_CKSUM_OFFLOADED(ndo) \
+  ((ndo)->ndo_outgoing && !(ndo)->ndo_check_outgoing)
+
 /* IP protocol demuxing routines */
 extern void ip_print_demux(netdissect_options *, const u_char *, u_int, u_int, int, u_int, uint8_t, const u_char *);
+extern int ip_demux_prints_addrs(uint8_t);
 
 extern uint16_t nextproto4_cksum(netdissect_options *, const struct ip *, const uint8_t *, u_int, u_int, uint8_t);
 
@@ -734,15 +1267,39 @@ extern void nd_print_invalid(netdissect_options *);
 extern int mask2plen(uint32_t);
 extern int mask62plen(const u_char *);
 
-extern const char *dnnum_string(netdissect_options *, u_short);
+extern char *dnnum_string(netdissect_options *, u_short);
 
 extern int decode_prefix4(netdissect_options *, const u_char *, u_int, char *, size_t);
 extern int decode_prefix6(netdissect_options *, const u_char *, u_int, char *, size_t);
 
 extern void esp_print_decodesecret(netdissect_options *);
+extern void esp_print_freesecrets(netdissect_options *);
+typedef void (*esp_sa_fn)(void *, uint32_t, const char *, uint64_t,
+    uint64_t, uint64_t, uint64_t);
+extern void esp_sa_foreach(netdissect_options *, esp_sa_fn, void *);
 extern int esp_print_decrypt_buffer_by_ikev2(netdissect_options *, int,
 					     const u_char spii[8],
 					     const u_char spir[8],
 					     const u_char *, const u_char *);
 
+/* The TCP printer's relative sequence number table, for an ndo */
+struct tcp_conn_stats {
+	u_int tcs_conns;	/* conversations in it now */
+	u_int tcs_peak;		/* most there have been at once */
+	u_int tcs_slots;	/* its size */
+	uint64_t tcs_closed;	/* dropped after a RST or FINs */
+	uint64_t tcs_evicted;	/* dropped after going idle */
+};
+
+extern void tcp_conn_stats(netdissect_options *, struct tcp_conn_stats *);
+extern void tcp_conn_prefetch(netdissect_options *, const u_char *,
+    const u_char *, u_int, uint16_t, uint16_t);
+
+/* NFS replies that the NFS printer found no call for, in this thread */
+extern uint64_t nfs_unmatched_replies(void);
+
+/* NFSv4 operations it saw in calls, and in failed replies, in this thread */
+typedef void (*nfs4_op_fn)(void *, const char *, uint64_t, uint64_t);
+extern void nfs4_op_foreach(nfs4_op_fn, void *);
+
 #endif  /* netdissect_h */
@@ -0,0 +1,275 @@
+/*
+ * Copyright (c) 2026 The TCPDUMP project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that: (1) source code
+ * distributions retain the above copyright notice and this paragraph
+ * in its entirety, and (2) distributions including binary code include
+ * the above copyright notice and this paragraph in its entirety in
+ * the documentation or other materials provided with the distribution.
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND
+ * WITHOUT ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, WITHOUT
+ * LIMITATION, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE.
+ */
+
+
+/*
+ * The buffer is circular: the bytes waiting to be written are the
+ * "used" bytes from "head" on, wrapping around the end, so that the
+ * thread can write them all with at most two iovecs.  The thread works
+ * on those bytes without the lock, and writes only add bytes after
+ * them, so the lock is only held to copy the output in and to move the
+ * head.
+ *
+ * When the standard output is a pipe, Linux lets its buffer be made
+ * larger with F_SETPIPE_SZ, up to /proc/sys/fs/pipe-max-size for a
+ * process without CAP_SYS_RESOURCE; it's asked for as much as the
+ * buffer here, which does no harm if the reader keeps up, and lets the
+ * kernel hold more when it doesn't.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#ifdef __linux__
+#define _GNU_SOURCE	/* for F_SETPIPE_SZ */
+#endif
+
+#include "netdissect-stdinc.h"
+
+#include <pcap.h>
+
+#include "netdissect-alloc.h"
+#include "output-buffer.h"
+
+#ifdef OUTPUT_BUFFER_SUPPORTED
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+struct output_buffer {
+	int	fd;
+	int	drop;			/* throw output away rather than wait */
+	char	*data;
+	size_t	size;
+	size_t	head;			/* the first byte to be written */
+	size_t	used;
+	int	error;			/* errno of a failed write, or 0 */
+	struct output_buffer_stats stats;
+	pthread_mutex_t mtx;
+	pthread_cond_t data_cv;		/* output added */
+	pthread_cond_t room_cv;		/* output written */
+};
+
+#ifdef F_SETPIPE_SZ
+static void
+grow_pipe(struct output_buffer *ob)
+{
+	struct stat st;
+	FILE *f;
+	int want, max;
+
+	if (fstat(ob->fd, &st) == -1 || !S_ISFIFO(st.st_mode))
+		return;
+	want = ob->size > INT_MAX ? INT_MAX : (int)ob->size;
+	if (fcntl(ob->fd, F_SETPIPE_SZ, want) == -1 && errno == EPERM) {
+		f = fopen("/proc/sys/fs/pipe-max-size", "r");
+		if (f != NULL) {
+			if (fscanf(f, "%d", &max) == 1 && max < want)
+				(void)fcntl(ob->fd, F_SETPIPE_SZ, max);
+			fclose(f);
+		}
+	}
+	ob->stats.obs_pipe_size = fcntl(ob->fd, F_GETPIPE_SZ);
+	if (ob->stats.obs_pipe_size == -1)
+		ob->stats.obs_pipe_size = 0;
+}
+#endif
+
+/*
+ * Returns a buffer of "size" bytes, or at least OUTPUT_BUFFER_MIN_SIZE,
+ * for output to "fd"; "drop" says what to do when it's full.
+ */
+struct output_buffer *
+output_buffer_create(int fd, size_t size, int drop, char *ebuf)
+{
+	struct output_buffer *ob;
+
+	if (size < OUTPUT_BUFFER_MIN_SIZE)
+		size = OUTPUT_BUFFER_MIN_SIZE;
+	ob = (struct output_buffer *)calloc(1, sizeof(*ob));
+	if (ob == NULL || (ob->data = (char *)nd_big_calloc(1, size)) == NULL) {
+		snprintf(ebuf, PCAP_ERRBUF_SIZE,
+		    "output_buffer_create: malloc");
+		free(ob);
+		return (NULL);
+	}
+	ob->fd = fd;
+	ob->drop = drop;
+	ob->size = size;
+	ob->stats.obs_size = size;
+	pthread_mutex_init(&ob->mtx, NULL);
+	pthread_cond_init(&ob->data_cv, NULL);
+	pthread_cond_init(&ob->room_cv, NULL);
+#ifdef F_SETPIPE_SZ
+	grow_pipe(ob);
+#endif
+	return (ob);
+}
+
+/*
+ * The thread.  It only returns if a write fails, after which the
+ * output is thrown away and output_buffer_write() fails with the
+ * error.
+ */
+void *
+output_buffer_run(void *arg)
+{
+	struct output_buffer *ob = (struct output_buffer *)arg;
+	struct iovec iov[2];
+	int iovcnt;
+	ssize_t n;
+
+	pthread_mutex_lock(&ob->mtx);
+	for (;;) {
+		while (ob->used == 0)
+			pthread_cond_wait(&ob->data_cv, &ob->mtx);
+		iov[0].iov_base = ob->data + ob->head;
+		iov[0].iov_len = ob->size - ob->head;
+		if (iov[0].iov_len >= ob->used) {
+			iov[0].iov_len = ob->used;
+			iovcnt = 1;
+		} else {
+			iov[1].iov_base = ob->data;
+			iov[1].iov_len = ob->used - iov[0].iov_len;
+			iovcnt = 2;
+		}
+		pthread_mutex_unlock(&ob->mtx);
+
+		n = writev(ob->fd, iov, iovcnt);
+
+		pthread_mutex_lock(&ob->mtx);
+		if (n == -1) {
+			if (errno == EINTR)
+				continue;
+			ob->error = errno;
+			ob->used = 0;
+			pthread_cond_broadcast(&ob->room_cv);
+			break;
+		}
+		ob->head = (ob->head + (size_t)n) % ob->size;
+		ob->used -= (size_t)n;
+		ob->stats.obs_writes++;
+		pthread_cond_broadcast(&ob->room_cv);
+	}
+	pthread_mutex_unlock(&ob->mtx);
+	return (NULL);
+}
+
+/* Called with the lock held, for at most the room there is. */
+static void
+buffer_copy(struct output_buffer *ob, const char *buf, size_t len)
+{
+	size_t tail, first;
+
+	tail = (ob->head + ob->used) % ob->size;
+	first = ob->size - tail;
+	if (first > len)
+		first = len;
+	memcpy(ob->data + tail, buf, first);
+	memcpy(ob->data, buf + first, len - first);
+	ob->used += len;
+	if (ob->used > ob->stats.obs_peak)
+		ob->stats.obs_peak = ob->used;
+	pthread_cond_signal(&ob->data_cv);
+}
+
+/*
+ * Returns 0, or -1 with errno set if the thread couldn't write earlier
+ * output.
+ */
+int
+output_buffer_write(struct output_buffer *ob, const char *buf, size_t len)
+{
+	size_t n;
+	int waited;
+
+	pthread_mutex_lock(&ob->mtx);
+	if (ob->drop && ob->error == 0) {
+		if (len > ob->size - ob->used) {
+			ob->stats.obs_dropped++;
+			ob->stats.obs_dropped_bytes += len;
+		} else
+			buffer_copy(ob, buf, len);
+		len = 0;
+	}
+	/*
+	 * Output larger than the buffer goes in as the room for it is
+	 * made.
+	 */
+	waited = 0;
+	while (len != 0 && ob->error == 0) {
+		if (ob->used == ob->size) {
+			if (!waited)
+				ob->stats.obs_waits++;
+			waited = 1;
+			pthread_cond_wait(&ob->room_cv, &ob->mtx);
+			continue;
+		}
+		n = ob->size - ob->used;
+		if (n > len)
+			n = len;
+		buffer_copy(ob, buf, n);
+		buf += n;
+		len -= n;
+	}
+	if (ob->error != 0) {
+		errno = ob->error;
+		pthread_mutex_unlock(&ob->mtx);
+		return (-1);
+	}
+	pthread_mutex_unlock(&ob->mtx);
+	return (0);
+}
+
+/*
+ * Wait for everything in the buffer to be written; returns 0, or -1 with
+ * errno set if it couldn't be.
+ */
+int
+output_buffer_flush(struct output_buffer *ob)
+{
+	int error;
+
+	pthread_mutex_lock(&ob->mtx);
+	while (ob->used != 0)
+		pthread_cond_wait(&ob->room_cv, &ob->mtx);
+	error = ob->error;
+	pthread_mutex_unlock(&ob->mtx);
+	if (error != 0) {
+		errno = error;
+		return (-1);
+	}
+	return (0);
+}
+
+void
+output_buffer_stats(struct output_buffer *ob,
+    struct output_buffer_stats *stats)
+{
+	pthread_mutex_lock(&ob->mtx);
+	*stats = ob->stats;
+	stats->obs_used = ob->used;
+	pthread_mutex_unlock(&ob->mtx);
+}
+#endif /* OUTPUT_BUFFER_SUPPORTED */
@@ -0,0 +1,54 @@
+/*
+ * Copyright (c) 2026 The TCPDUMP project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that: (1) source code
+ * distributions retain the above copyright notice and this paragraph
+ * in its entirety, and (2) distributions including binary code include
+ * the above copyright notice and this paragraph in its entirety in
+ * the documentation or other materials provided with the distribution.
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND
+ * WITHOUT ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, WITHOUT
+ * LIMITATION, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE.
+ */
+
+
+/*
+ * A buffer between the printing and the standard output, written out by
+ * a thread of its own (--output-thread), so that a program reading the
+ * output that falls behind holds up that thread rather than the capture.
+ * What's handed to output_buffer_write(), normally the output for one
+ * packet, is copied into the buffer; the thread writes out everything
+ * there is with one writev(), taking a batch of packets at a time.
+ *
+ * When the buffer has no room, output_buffer_write() either waits for
+ * the room or, if the buffer was created to drop, throws the output
+ * away and counts it.  It's called by one thread at a time.
+ */
+#if defined(HAVE_PTHREADS) && !defined(_WIN32)
+#define OUTPUT_BUFFER_SUPPORTED
+
+#define OUTPUT_BUFFER_MIN_SIZE	(64 * 1024)
+
+struct output_buffer;
+
+struct output_buffer_stats {
+	size_t	obs_size;
+	size_t	obs_used;		/* bytes waiting to be written now */
+	size_t	obs_peak;		/* most bytes waiting at once */
+	int	obs_pipe_size;		/* of the pipe written to, or 0 */
+	uint64_t obs_writes;		/* writev() calls */
+	uint64_t obs_waits;		/* times a write waited for room */
+	uint64_t obs_dropped;		/* writes thrown away for room */
+	uint64_t obs_dropped_bytes;
+};
+
+extern struct output_buffer *output_buffer_create(int, size_t, int, char *);
+extern void *output_buffer_run(void *);
+extern int output_buffer_write(struct output_buffer *, const char *, size_t);
+extern int output_buffer_flush(struct output_buffer *);
+extern void output_buffer_stats(struct output_buffer *,
+    struct output_buffer_stats *);
+#endif
@@ -0,0 +1,342 @@
+/*
+ * Copyright (c) 2026 The TCPDUMP project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that: (1) source code
+ * distributions retain the above copyright notice and this paragraph
+ * in its entirety, and (2) distributions including binary code include
+ * the above copyright notice and this paragraph in its entirety in
+ * the documentation or other materials provided with the distribution.
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND
+ * WITHOUT ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, WITHOUT
+ * LIMITATION, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE.
+ */
+
+/*
+ * The ring is a power of two bytes long, and the head and tail are byte
+ * counts that only ever go up, so that head == tail means empty and the
+ * bytes in use are tail - head.  Each packet is a record header and the
+ * packet data, rounded up to RING_ALIGN bytes, and never wraps around
+ * the end of the buffer, so that the printer can be handed it in place:
+ * if a record won't fit before the end, the space left there is skipped,
+ * marked as such by a header with a length of 0 if there's room for
+ * one, and the record goes at the start.
+ *
+ * Only the capture thread stores to the tail and only the printing
+ * thread stores to the head.  A thread that finds the ring empty (or
+ * full) sets its "waiting" flag, with the lock held, and checks again
+ * before sleeping; the other thread looks at the flag after moving the
+ * tail (or head), and takes the lock to wake it only if it's set.  The
+ * atomics are sequentially consistent, so either the sleeper sees the
+ * move or the mover sees the flag.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include "netdissect-stdinc.h"
+
+#include <pcap.h>
+
+#include "netdissect-alloc.h"
+#include "packet-ring.h"
+
+#ifdef PACKET_RING_SUPPORTED
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define RING_ALIGN	8
+#define RING_ROUND(n)	(((n) + RING_ALIGN - 1) & ~(size_t)(RING_ALIGN - 1))
+#define RING_LINE	64	/* keeps the head and tail apart */
+
+struct ring_record {
+	struct pcap_pkthdr hdr;
+	u_int	number;
+	u_int	len;			/* of the record; 0 = skip to the start */
+};
+
+struct packet_ring {
+	u_char	*data;
+	size_t	size;
+	size_t	mask;
+	size_t	current;		/* length of the record got */
+	atomic_uint_least64_t released;	/* counted by the printing thread */
+	struct packet_ring_stats stats;	/* counted by the capture thread */
+	pthread_mutex_t mtx;
+	pthread_cond_t get_cv;		/* a packet put */
+	pthread_cond_t put_cv;		/* a packet released */
+	char	pad1[RING_LINE];
+	atomic_size_t head;		/* stored by the printing thread */
+	atomic_int put_waiting;
+	char	pad2[RING_LINE];
+	atomic_size_t tail;		/* stored by the capture thread */
+	atomic_int get_waiting;
+};
+
+/*
+ * Make a ring of at least "size" bytes.  Returns NULL, with a message in
+ * ebuf, if that fails.
+ */
+struct packet_ring *
+packet_ring_create(size_t size, char *ebuf)
+{
+	struct packet_ring *r;
+	size_t n;
+
+	for (n = PACKET_RING_MIN_SIZE; n < size; n *= 2)
+		if (n > SIZE_MAX / 4) {
+			snprintf(ebuf, PCAP_ERRBUF_SIZE,
+			    "ring size %zu too large", size);
+			return (NULL);
+		}
+	r = (struct packet_ring *)calloc(1, sizeof(*r));
+	if (r == NULL || (r->data = (u_char *)nd_big_calloc(1, n)) == NULL) {
+		snprintf(ebuf, PCAP_ERRBUF_SIZE, "packet_ring_create: malloc");
+		free(r);
+		return (NULL);
+	}
+	r->size = n;
+	r->mask = n - 1;
+	r->stats.prs_size = n;
+	pthread_mutex_init(&r->mtx, NULL);
+	pthread_cond_init(&r->get_cv, NULL);
+	pthread_cond_init(&r->put_cv, NULL);
+	atomic_init(&r->head, 0);
+	atomic_init(&r->tail, 0);
+	atomic_init(&r->put_waiting, 0);
+	atomic_init(&r->get_waiting, 0);
+	atomic_init(&r->released, 0);
+	return (r);
+}
+
+void
+packet_ring_destroy(struct packet_ring *r)
+{
+	pthread_mutex_destroy(&r->mtx);
+	pthread_cond_destroy(&r->get_cv);
+	pthread_cond_destroy(&r->put_cv);
+	nd_big_free(r->data);
+	free(r);
+}
+
+/*
+ * On the capture thread: wait until no more than "used" bytes are in
+ * use, counting the wait in "waits" if that's not NULL, and return the
+ * head.
+ */
+static size_t
+ring_wait_room(struct packet_ring *r, size_t tail, size_t used,
+    uint64_t *waits)
+{
+	size_t head;
+
+	head = atomic_load(&r->head);
+	if (tail - head <= used)
+		return (head);
+	if (waits != NULL)
+		(*waits)++;
+	pthread_mutex_lock(&r->mtx);
+	atomic_store(&r->put_waiting, 1);
+	while (tail - (head = atomic_load(&r->head)) > used)
+		pthread_cond_wait(&r->put_cv, &r->mtx);
+	atomic_store(&r->put_waiting, 0);
+	pthread_mutex_unlock(&r->mtx);
+	return (head);
+}
+
+/*
+ * Copy a packet, and the number to print it with, into the ring; if
+ * it's full, wait for room if "wait" is set, and otherwise drop the
+ * packet, counting it, and return 0.  Returns -1 if the packet is too
+ * large for the ring ever to have room for it, and 1 if it was put.
+ */
+static int
+ring_put(struct packet_ring *r, const struct pcap_pkthdr *h,
+    const u_char *sp, u_int number, int wait)
+{
+	struct ring_record *rec;
+	size_t tail, head, off, skip, need;
+
+	need = RING_ROUND(sizeof(*rec) + h->caplen);
+	if (need > r->size / 2)
+		return (-1);
+	tail = atomic_load_explicit(&r->tail, memory_order_relaxed);
+	off = tail & r->mask;
+	skip = r->size - off < need ? r->size - off : 0;
+	if (wait)
+		head = ring_wait_room(r, tail, r->size - skip - need,
+		    &r->stats.prs_waits);
+	else {
+		head = atomic_load(&r->head);
+		if (tail - head > r->size - skip - need) {
+			r->stats.prs_dropped++;
+			return (0);
+		}
+	}
+
+	if (skip != 0) {
+		if (skip >= sizeof(*rec))
+			((struct ring_record *)(r->data + off))->len = 0;
+		tail += skip;
+		off = 0;
+	}
+	rec = (struct ring_record *)(r->data + off);
+	rec->hdr = *h;
+	rec->number = number;
+	rec->len = (u_int)need;
+	memcpy(rec + 1, sp, h->caplen);
+	tail += need;
+	if (tail - head > r->stats.prs_peak)
+		r->stats.prs_peak = tail - head;
+	r->stats.prs_packets++;
+
+	atomic_store(&r->tail, tail);
+	if (atomic_load(&r->get_waiting)) {
+		pthread_mutex_lock(&r->mtx);
+		pthread_cond_signal(&r->get_cv);
+		pthread_mutex_unlock(&r->mtx);
+	}
+	return (1);
+}
+
+/*
+ * Copy a packet into the ring, waiting for room if it's full.
+ */
+int
+packet_ring_put(struct packet_ring *r, const struct pcap_pkthdr *h,
+    const u_char *sp, u_int number)
+{
+	return (ring_put(r, h, sp, number, 1) == -1 ? -1 : 0);
+}
+
+/*
+ * Copy a packet into the ring if there's room for it; returns 0 if it
+ * was dropped.
+ */
+int
+packet_ring_try_put(struct packet_ring *r, const struct pcap_pkthdr *h,
+    const u_char *sp, u_int number)
+{
+	return (ring_put(r, h, sp, number, 0));
+}
+
+/*
+ * On the printing thread: make "head" the head, and wake the capture
+ * thread if it's waiting for the room.
+ */
+static void
+ring_advance(struct packet_ring *r, size_t head)
+{
+	atomic_store(&r->head, head);
+	if (atomic_load(&r->put_waiting)) {
+		pthread_mutex_lock(&r->mtx);
+		pthread_cond_signal(&r->put_cv);
+		pthread_mutex_unlock(&r->mtx);
+	}
+}
+
+/*
+ * Wait for the next packet, and return it, its header and its number;
+ * it stays in the ring until packet_ring_release().
+ */
+const u_char *
+packet_ring_get(struct packet_ring *r, struct pcap_pkthdr *h, u_int *number)
+{
+	struct ring_record *rec;
+	size_t head, off;
+
+	head = atomic_load_explicit(&r->head, memory_order_relaxed);
+	for (;;) {
+		if (atomic_load(&r->tail) == head) {
+			pthread_mutex_lock(&r->mtx);
+			atomic_store(&r->get_waiting, 1);
+			while (atomic_load(&r->tail) == head)
+				pthread_cond_wait(&r->get_cv, &r->mtx);
+			atomic_store(&r->get_waiting, 0);
+			pthread_mutex_unlock(&r->mtx);
+		}
+		off = head & r->mask;
+		rec = (struct ring_record *)(r->data + off);
+		if (r->size - off >= sizeof(*rec) && rec->len != 0)
+			break;
+		/* The rest of the buffer was skipped. */
+		head += r->size - off;
+		ring_advance(r, head);
+	}
+	*h = rec->hdr;
+	*number = rec->number;
+	r->current = rec->len;
+	return ((const u_char *)(rec + 1));
+}
+
+/*
+ * Return the packet after the one got last, and its captured length, if
+ * it's been put yet, without waiting; it's only to be looked at, for
+ * prefetching, until it's got.
+ */
+const u_char *
+packet_ring_peek(struct packet_ring *r, u_int *caplen)
+{
+	struct ring_record *rec;
+	size_t head, off;
+
+	head = atomic_load_explicit(&r->head, memory_order_relaxed) +
+	    r->current;
+	if (atomic_load(&r->tail) == head)
+		return (NULL);
+	off = head & r->mask;
+	rec = (struct ring_record *)(r->data + off);
+	if (r->size - off < sizeof(*rec) || rec->len == 0) {
+		head += r->size - off;
+		if (atomic_load(&r->tail) == head)
+			return (NULL);
+		rec = (struct ring_record *)r->data;
+	}
+	*caplen = rec->hdr.caplen;
+	return ((const u_char *)(rec + 1));
+}
+
+/*
+ * Give back the room of the packet got last.
+ */
+void
+packet_ring_release(struct packet_ring *r)
+{
+	atomic_fetch_add_explicit(&r->released, 1, memory_order_relaxed);
+	ring_advance(r,
+	    atomic_load_explicit(&r->head, memory_order_relaxed) + r->current);
+	r->current = 0;
+}
+
+/*
+ * On the capture thread: wait until every packet put has been released.
+ */
+void
+packet_ring_drain(struct packet_ring *r)
+{
+	(void)ring_wait_room(r,
+	    atomic_load_explicit(&r->tail, memory_order_relaxed), 0, NULL);
+}
+
+/*
+ * The counts are read without locking, so they may be a packet behind.
+ */
+void
+packet_ring_stats(struct packet_ring *r, struct packet_ring_stats *stats)
+{
+	size_t head;
+	uint64_t released;
+
+	head = atomic_load(&r->head);
+	released = atomic_load_explicit(&r->released, memory_order_relaxed);
+	*stats = r->stats;
+	stats->prs_used = atomic_load(&r->tail) - head;
+	stats->prs_queued = (u_int)(stats->prs_packets - released);
+}
+#endif /* PACKET_RING_SUPPORTED */
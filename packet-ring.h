@@ -0,0 +1,63 @@
+/*
+ * Copyright (c) 2026 The TCPDUMP project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that: (1) source code
+ * distributions retain the above copyright notice and this paragraph
+ * in its entirety, and (2) distributions including binary code include
+ * the above copyright notice and this paragraph in its entirety in
+ * the documentation or other materials provided with the distribution.
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND
+ * WITHOUT ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, WITHOUT
+ * LIMITATION, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE.
+ */
+
+/*
+ * A ring of packets handed from one thread, the one capturing them, to
+ * one other, the one printing them (--print-thread).  The ring is a
+ * single buffer allocated up front, so that a burst that the printing
+ * can't keep up with is held in it rather than in the kernel's buffer;
+ * the two threads only share its head and tail, which are C11 atomics,
+ * and only take a lock to sleep when the ring is empty or full.
+ *
+ * packet_ring_put() copies a packet in, waiting for room if need be,
+ * and packet_ring_try_put() drops it instead (for a printer that's
+ * allowed to fall behind);
+ * packet_ring_get() waits for a packet and returns it in place, and
+ * packet_ring_release() gives its room back once it's been printed;
+ * packet_ring_peek() returns the one after it, if there is one yet.
+ */
+#if defined(HAVE_PTHREADS) && defined(HAVE_STDATOMIC_H) && \
+    !defined(__STDC_NO_ATOMICS__)
+#define PACKET_RING_SUPPORTED
+
+#define PACKET_RING_MIN_SIZE	(1024 * 1024)
+
+struct packet_ring;
+
+struct packet_ring_stats {
+	size_t	prs_size;
+	size_t	prs_used;		/* bytes in use now */
+	u_int	prs_queued;		/* packets in the ring now */
+	size_t	prs_peak;		/* most bytes in use at once */
+	uint64_t prs_packets;		/* put in the ring */
+	uint64_t prs_waits;		/* times put waited for room */
+	uint64_t prs_dropped;		/* not put, for want of room */
+};
+
+extern struct packet_ring *packet_ring_create(size_t, char *);
+extern void packet_ring_destroy(struct packet_ring *);
+extern int packet_ring_put(struct packet_ring *, const struct pcap_pkthdr *,
+    const u_char *, u_int);
+extern int packet_ring_try_put(struct packet_ring *,
+    const struct pcap_pkthdr *, const u_char *, u_int);
+extern const u_char *packet_ring_get(struct packet_ring *,
+    struct pcap_pkthdr *, u_int *);
+extern const u_char *packet_ring_peek(struct packet_ring *, u_int *);
+extern void packet_ring_release(struct packet_ring *);
+extern void packet_ring_drain(struct packet_ring *);
+extern void packet_ring_stats(struct packet_ring *,
+    struct packet_ring_stats *);
+#endif
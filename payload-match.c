@@ -0,0 +1,410 @@
+/*
+ * Copyright (c) 2026 The TCPDUMP project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that: (1) source code
+ * distributions retain the above copyright notice and this paragraph
+ * in its entirety, and (2) distributions including binary code include
+ * the above copyright notice and this paragraph in its entirety in
+ * the documentation or other materials provided with the distribution.
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND
+ * WITHOUT ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, WITHOUT
+ * LIMITATION, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE.
+ */
+
+/*
+ * A set of byte strings to search payloads for, however many there
+ * are, in one pass: the patterns are compiled into an Aho-Corasick
+ * automaton, turned into a table of transitions so that each byte
+ * costs one lookup.  The bytes that appear in no pattern all behave
+ * the same, so they share a column of the table, which keeps it to
+ * the states times the number of different bytes in the patterns.
+ *
+ * Most of a payload is usually spent in the start state, waiting for
+ * a byte that can begin a pattern; the search skips ahead to the next
+ * such byte 16 at a time, with SSE2 or NEON compares when there are
+ * at most PM_VEC_BYTES of them, and a byte at a time through a table
+ * otherwise.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include "netdissect-stdinc.h"
+
+#include <errno.h>
+#include <pcap.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "payload-match.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__)) && \
+    defined(__SSE2__)
+#include <emmintrin.h>
+#define PM_SSE2
+#elif defined(__GNUC__) && defined(__aarch64__) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#define PM_NEON
+#endif
+
+#define PM_VEC_BYTES	8		/* start bytes compared 16 at a time */
+#define PM_SKIP_MAX	32		/* more start bytes aren't skipped to */
+#define PM_MATCH	0x80000000U	/* in a transition: a pattern ends */
+
+struct pm_pattern {
+	u_char *pp_bytes;
+	u_int pp_len;
+};
+
+struct payload_matcher {
+	uint32_t *pm_delta;		/* [state * pm_nclasses + class] */
+	u_int pm_nclasses;
+	u_int pm_nstates;
+	u_int pm_patterns;
+	u_char pm_class[256];		/* column of each byte */
+	u_char pm_start[256];		/* can begin a pattern */
+	u_int pm_nstart;		/* of the bytes in pm_start */
+	u_char pm_startbytes[PM_VEC_BYTES];	/* if there are so few */
+	int pm_skip;			/* worth skipping to them */
+};
+
+/*
+ * Parse a line of a patterns file into "buf": the line's bytes,
+ * except that \xHH stands for the byte with hex value HH and \\ for a
+ * backslash.  Returns the pattern's length, or -1 if it's invalid or
+ * too long.
+ */
+static int
+pm_parse(const char *line, u_char *buf)
+{
+	static const char hex[] = "0123456789abcdef0123456789ABCDEF";
+	const char *h1, *h2;
+	u_int len = 0;
+
+	while (*line != '\0') {
+		if (len == PAYLOAD_MATCH_MAX_LEN)
+			return (-1);
+		if (line[0] == '\\' && line[1] == '\\') {
+			buf[len++] = '\\';
+			line += 2;
+		} else if (line[0] == '\\' && line[1] == 'x') {
+			if (line[2] == '\0' ||
+			    (h1 = strchr(hex, line[2])) == NULL ||
+			    line[3] == '\0' ||
+			    (h2 = strchr(hex, line[3])) == NULL)
+				return (-1);
+			buf[len++] = (u_char)(((h1 - hex) & 15) << 4 |
+			    ((h2 - hex) & 15));
+			line += 4;
+		} else
+			buf[len++] = (u_char)*line++;
+	}
+	return ((int)len);
+}
+
+/*
+ * Read the patterns in "fp" into "*patsp", returning how many there
+ * are, -1 if a line is invalid, with its number in "*linenop", or -2
+ * if we ran out of memory.
+ */
+static int
+pm_read(FILE *fp, struct pm_pattern **patsp, u_int *linenop)
+{
+	struct pm_pattern *pats = NULL, *newpats;
+	char line[PAYLOAD_MATCH_MAX_LEN * 4 + 3];
+	u_char buf[PAYLOAD_MATCH_MAX_LEN];
+	u_int npats = 0, maxpats = 0;
+	size_t n;
+	int len;
+
+	*linenop = 0;
+	while (fgets(line, sizeof(line), fp) != NULL) {
+		(*linenop)++;
+		n = strlen(line);
+		if (n != 0 && line[n - 1] != '\n' && !feof(fp))
+			goto invalid;	/* too long */
+		line[strcspn(line, "\r\n")] = '\0';
+		if (line[0] == '\0')
+			continue;
+		if ((len = pm_parse(line, buf)) == -1)
+			goto invalid;
+		if (npats == maxpats) {
+			maxpats = maxpats != 0 ? maxpats * 2 : 64;
+			newpats = (struct pm_pattern *)realloc(pats,
+			    maxpats * sizeof(*pats));
+			if (newpats == NULL)
+				goto nomem;
+			pats = newpats;
+		}
+		if ((pats[npats].pp_bytes = (u_char *)malloc(len)) == NULL)
+			goto nomem;
+		memcpy(pats[npats].pp_bytes, buf, len);
+		pats[npats].pp_len = (u_int)len;
+		npats++;
+	}
+	*patsp = pats;
+	return ((int)npats);
+
+invalid:
+	while (npats != 0)
+		free(pats[--npats].pp_bytes);
+	free(pats);
+	return (-1);
+nomem:
+	while (npats != 0)
+		free(pats[--npats].pp_bytes);
+	free(pats);
+	return (-2);
+}
+
+/*
+ * Build the automaton for the "npats" patterns in "pats".
+ */
+static int
+pm_build(struct payload_matcher *pm, const struct pm_pattern *pats,
+    u_int npats)
+{
+	uint32_t *delta, *fail = NULL, *queue = NULL, s, t, f;
+	u_char *out = NULL, used[256];
+	u_int i, j, c, nc, nused, maxstates, head, tail;
+	uint64_t total = 1;
+
+	memset(used, 0, sizeof(used));
+	for (i = 0; i < npats; i++) {
+		total += pats[i].pp_len;
+		for (j = 0; j < pats[i].pp_len; j++)
+			used[pats[i].pp_bytes[j]] = 1;
+	}
+	for (nused = 0, c = 0; c < 256; c++)
+		nused += used[c];
+
+	/*
+	 * Column 0 is for the bytes in no pattern, unless every byte is
+	 * in one.
+	 */
+	if (nused == 256) {
+		for (c = 0; c < 256; c++)
+			pm->pm_class[c] = (u_char)c;
+		nc = 256;
+	} else {
+		nc = 1;
+		for (c = 0; c < 256; c++)
+			pm->pm_class[c] = used[c] ? (u_char)nc++ : 0;
+	}
+	pm->pm_nclasses = nc;
+
+	/* The states and their transitions have to fit below PM_MATCH. */
+	if (total * nc >= PM_MATCH)
+		return (-1);
+	maxstates = (u_int)total;
+	delta = (uint32_t *)calloc((size_t)maxstates * nc, sizeof(*delta));
+	if (delta == NULL)
+		return (-1);
+	pm->pm_delta = delta;
+	fail = (uint32_t *)calloc(maxstates, sizeof(*fail));
+	queue = (uint32_t *)malloc(maxstates * sizeof(*queue));
+	out = (u_char *)calloc(maxstates, 1);
+	if (fail == NULL || queue == NULL || out == NULL)
+		goto fail;
+
+	/* The trie; 0 is the start state, and means no transition. */
+	pm->pm_nstates = 1;
+	for (i = 0; i < npats; i++) {
+		s = 0;
+		for (j = 0; j < pats[i].pp_len; j++) {
+			c = pm->pm_class[pats[i].pp_bytes[j]];
+			if (delta[s * nc + c] == 0)
+				delta[s * nc + c] = pm->pm_nstates++;
+			s = delta[s * nc + c];
+		}
+		out[s] = 1;
+	}
+
+	/*
+	 * Breadth first, a state's failure state is shallower, so its
+	 * transitions are already complete when they're copied.
+	 */
+	head = tail = 0;
+	for (c = 0; c < nc; c++)
+		if ((t = delta[c]) != 0)
+			queue[tail++] = t;
+	while (head != tail) {
+		s = queue[head++];
+		f = fail[s];
+		for (c = 0; c < nc; c++) {
+			t = delta[s * nc + c];
+			if (t != 0) {
+				fail[t] = delta[f * nc + c];
+				out[t] |= out[fail[t]];
+				queue[tail++] = t;
+			} else
+				delta[s * nc + c] = delta[f * nc + c];
+		}
+	}
+
+	/*
+	 * A transition is kept as the offset of its state's row, to save
+	 * a multiplication a byte, with PM_MATCH set if a pattern ends
+	 * there.
+	 */
+	for (i = 0; i < pm->pm_nstates * nc; i++)
+		delta[i] = delta[i] * nc | (out[delta[i]] ? PM_MATCH : 0);
+
+	for (c = 0; c < 256; c++) {
+		if (delta[pm->pm_class[c]] != 0) {
+			pm->pm_start[c] = 1;
+			if (pm->pm_nstart < PM_VEC_BYTES)
+				pm->pm_startbytes[pm->pm_nstart] = (u_char)c;
+			pm->pm_nstart++;
+		}
+	}
+	pm->pm_skip = pm->pm_nstart <= PM_SKIP_MAX;
+	free(fail);
+	free(queue);
+	free(out);
+	return (0);
+
+fail:
+	free(fail);
+	free(queue);
+	free(out);
+	return (-1);
+}
+
+/*
+ * Load the patterns in "fname", one a line, as with grep -F -f; empty
+ * lines are ignored.
+ */
+struct payload_matcher *
+payload_match_load(const char *fname, char *errbuf)
+{
+	struct payload_matcher *pm;
+	struct pm_pattern *pats;
+	FILE *fp;
+	u_int lineno;
+	int npats, i;
+
+	fp = fopen(fname, "r");
+	if (fp == NULL) {
+		snprintf(errbuf, PCAP_ERRBUF_SIZE, "can't open %s: %s", fname,
+		    pcap_strerror(errno));
+		return (NULL);
+	}
+	npats = pm_read(fp, &pats, &lineno);
+	fclose(fp);
+	if (npats == -1) {
+		snprintf(errbuf, PCAP_ERRBUF_SIZE,
+		    "%s, line %u: invalid or too long pattern", fname, lineno);
+		return (NULL);
+	}
+	if (npats == -2) {
+		snprintf(errbuf, PCAP_ERRBUF_SIZE, "out of memory");
+		return (NULL);
+	}
+	if (npats == 0) {
+		snprintf(errbuf, PCAP_ERRBUF_SIZE, "%s has no patterns",
+		    fname);
+		return (NULL);
+	}
+	pm = (struct payload_matcher *)calloc(1, sizeof(*pm));
+	if (pm == NULL || pm_build(pm, pats, (u_int)npats) == -1) {
+		snprintf(errbuf, PCAP_ERRBUF_SIZE, "out of memory");
+		payload_match_free(pm);
+		pm = NULL;
+	} else
+		pm->pm_patterns = (u_int)npats;
+	for (i = 0; i < npats; i++)
+		free(pats[i].pp_bytes);
+	free(pats);
+	return (pm);
+}
+
+/*
+ * Skip ahead from "p" to the next byte that can begin a pattern, or
+ * to "ep" if there's none.
+ */
+static const u_char *
+pm_skip(const struct payload_matcher *pm, const u_char *p, const u_char *ep)
+{
+#if defined(PM_SSE2) || defined(PM_NEON)
+	u_int i;
+
+	if (pm->pm_nstart <= PM_VEC_BYTES) {
+#ifdef PM_SSE2
+		__m128i want[PM_VEC_BYTES], v, hit;
+		int mask;
+
+		for (i = 0; i < pm->pm_nstart; i++)
+			want[i] = _mm_set1_epi8((char)pm->pm_startbytes[i]);
+		while (ep - p >= 16) {
+			v = _mm_loadu_si128((const __m128i *)p);
+			hit = _mm_cmpeq_epi8(v, want[0]);
+			for (i = 1; i < pm->pm_nstart; i++)
+				hit = _mm_or_si128(hit,
+				    _mm_cmpeq_epi8(v, want[i]));
+			if ((mask = _mm_movemask_epi8(hit)) != 0)
+				return (p + __builtin_ctz((u_int)mask));
+			p += 16;
+		}
+#else
+		uint8x16_t want[PM_VEC_BYTES], v, hit;
+
+		for (i = 0; i < pm->pm_nstart; i++)
+			want[i] = vdupq_n_u8(pm->pm_startbytes[i]);
+		while (ep - p >= 16) {
+			v = vld1q_u8(p);
+			hit = vceqq_u8(v, want[0]);
+			for (i = 1; i < pm->pm_nstart; i++)
+				hit = vorrq_u8(hit, vceqq_u8(v, want[i]));
+			if (vmaxvq_u8(hit) != 0)
+				break;	/* it's in these 16 */
+			p += 16;
+		}
+#endif
+	}
+#endif
+	while (p < ep && !pm->pm_start[*p])
+		p++;
+	return (p);
+}
+
+/*
+ * Whether any of the patterns is in the "len" bytes at "p".
+ */
+int
+payload_match(const struct payload_matcher *pm, const u_char *p, u_int len)
+{
+	const u_char *ep = p + len;
+	const uint32_t *delta = pm->pm_delta;
+	uint32_t s = 0;			/* the offset of the state's row */
+
+	while (p < ep) {
+		if (s == 0 && pm->pm_skip &&
+		    (p = pm_skip(pm, p, ep)) == ep)
+			break;
+		s = delta[s + pm->pm_class[*p++]];
+		if (s & PM_MATCH)
+			return (1);
+	}
+	return (0);
+}
+
+u_int
+payload_match_patterns(const struct payload_matcher *pm)
+{
+	return (pm->pm_patterns);
+}
+
+void
+payload_match_free(struct payload_matcher *pm)
+{
+	if (pm == NULL)
+		return;
+	free(pm->pm_delta);
+	free(pm);
+}
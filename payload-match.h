@@ -0,0 +1,34 @@
+/*
+ * Copyright (c) 2026 The TCPDUMP project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that: (1) source code
+ * distributions retain the above copyright notice and this paragraph
+ * in its entirety, and (2) distributions including binary code include
+ * the above copyright notice and this paragraph in its entirety in
+ * the documentation or other materials provided with the distribution.
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND
+ * WITHOUT ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, WITHOUT
+ * LIMITATION, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE.
+ */
+
+/*
+ * Sets of byte strings to search packet payloads for, for
+ * --payload-match.
+ */
+#ifndef payload_match_h
+#define payload_match_h
+
+#define PAYLOAD_MATCH_MAX_LEN	1024	/* bytes in a pattern */
+
+struct payload_matcher;
+
+extern struct payload_matcher *payload_match_load(const char *, char *);
+extern int payload_match(const struct payload_matcher *, const u_char *,
+    u_int);
+extern u_int payload_match_patterns(const struct payload_matcher *);
+extern void payload_match_free(struct payload_matcher *);
+
+#endif /* payload_match_h */
@@ -0,0 +1,89 @@
+/*
+ * Copyright (c) 2026 The TCPDUMP project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that: (1) source code
+ * distributions retain the above copyright notice and this paragraph
+ * in its entirety, and (2) distributions including binary code include
+ * the above copyright notice and this paragraph in its entirety in
+ * the documentation or other materials provided with the distribution.
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND
+ * WITHOUT ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, WITHOUT
+ * LIMITATION, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include "netdissect-stdinc.h"
+
+#include <errno.h>
+#include <stdio.h>
+
+#include "netdissect.h"
+#include "payload-tap.h"
+
+static void
+tap_put_u4(u_char *p, uint32_t v)
+{
+	p[0] = (u_char)(v >> 24);
+	p[1] = (u_char)(v >> 16);
+	p[2] = (u_char)(v >> 8);
+	p[3] = (u_char)v;
+}
+
+/*
+ * Write a record of type "type", with code "code", with the "nfields"
+ * fields in "fields" to the --extract-payloads file.  What of a field
+ * wasn't captured is left out, and the record is marked TAP_CUT.
+ */
+void
+tap_record(netdissect_options *ndo, u_int type, u_int code,
+    const struct tap_field *fields, u_int nfields)
+{
+	u_char hdr[16];
+	u_char flen[TAP_MAX_FIELDS][4];
+	u_int caplen[TAP_MAX_FIELDS];
+	uint32_t total;
+	u_int i;
+
+	if (nfields > TAP_MAX_FIELDS)
+		nfields = TAP_MAX_FIELDS;
+	total = 12;
+	for (i = 0; i < nfields; i++) {
+		caplen[i] = fields[i].tf_len;
+		if (!ND_TTEST_LEN(fields[i].tf_data, caplen[i])) {
+			caplen[i] = fields[i].tf_data < ndo->ndo_snapend ?
+			    ND_BYTES_AVAILABLE_AFTER(fields[i].tf_data) : 0;
+			type |= TAP_CUT;
+		}
+		tap_put_u4(flen[i], caplen[i]);
+		total += 4 + caplen[i];
+	}
+	tap_put_u4(hdr, total);
+	hdr[4] = (u_char)type;
+	hdr[5] = (u_char)(code >> 8);
+	hdr[6] = (u_char)code;
+	tap_put_u4(hdr + 7, (uint32_t)ndo->ndo_packet_sec);
+	tap_put_u4(hdr + 11, (uint32_t)ndo->ndo_packet_usec);
+	hdr[15] = (u_char)nfields;
+
+	if (fwrite(hdr, sizeof(hdr), 1, ndo->ndo_tap_file) != 1)
+		goto error;
+	for (i = 0; i < nfields; i++) {
+		if (fwrite(flen[i], 4, 1, ndo->ndo_tap_file) != 1)
+			goto error;
+		if (caplen[i] != 0 && fwrite(fields[i].tf_data, caplen[i], 1,
+		    ndo->ndo_tap_file) != 1)
+			goto error;
+	}
+	return;
+
+error:
+	(*ndo->ndo_error)(ndo, S_ERR_ND_WRITE_FILE,
+	    "Unable to write the extracted payloads: %s",
+	    pcap_strerror(errno));
+}
@@ -0,0 +1,58 @@
+/*
+ * Copyright (c) 2026 The TCPDUMP project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that: (1) source code
+ * distributions retain the above copyright notice and this paragraph
+ * in its entirety, and (2) distributions including binary code include
+ * the above copyright notice and this paragraph in its entirety in
+ * the documentation or other materials provided with the distribution.
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND
+ * WITHOUT ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, WITHOUT
+ * LIMITATION, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE.
+ */
+
+#ifndef payload_tap_h
+#define payload_tap_h
+
+/*
+ * --extract-payloads: printers that can pick the payload out of a
+ * message, rather than printing it, write it to ndo_tap_file as a
+ * record of fields, so that a program reading the file or pipe gets
+ * the messages without parsing tcpdump's output.
+ *
+ * Each record, with all numbers big-endian, is
+ *
+ *	4 bytes	the length of the rest of the record
+ *	1 byte	the type, TAP_SYSLOG or TAP_RESP, or'ed with TAP_CUT if
+ *		part of a field wasn't captured
+ *	2 bytes	a type-specific code: the PRI of a syslog message, the
+ *		number of arguments of a Redis command
+ *	4 bytes	the seconds of the packet's time stamp
+ *	4 bytes	and its microseconds
+ *	1 byte	the number of fields
+ *
+ * and then, for each field, its length in 4 bytes and its bytes.  A
+ * syslog record has one field, the MSG part, after the PRI; a Redis
+ * record has the command name and, if there is one, its first
+ * argument, normally the key.
+ *
+ * The fields are copied from the packet with one fwrite() each.
+ */
+#define TAP_SYSLOG	1
+#define TAP_RESP	2
+#define TAP_CUT		0x80
+
+#define TAP_MAX_FIELDS	8
+
+struct tap_field {
+	const u_char *tf_data;
+	u_int tf_len;		/* as in the message */
+};
+
+extern void tap_record(netdissect_options *, u_int, u_int,
+    const struct tap_field *, u_int);
+
+#endif /* payload_tap_h */
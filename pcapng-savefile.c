@@ -0,0 +1,398 @@
+/*
+ * Copyright (c) 2026 The TCPDUMP project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that: (1) source code
+ * distributions retain the above copyright notice and this paragraph
+ * in its entirety, and (2) distributions including binary code include
+ * the above copyright notice and this paragraph in its entirety in
+ * the documentation or other materials provided with the distribution.
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND
+ * WITHOUT ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, WITHOUT
+ * LIMITATION, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE.
+ */
+
+/*
+ * A pcapng savefile is written as a section header block, an interface
+ * description block for each interface, and an enhanced packet block
+ * for each packet, giving the interface it came from; all in host byte
+ * order, which the byte-order magic of the section header tells the
+ * reader.  The interface description blocks all have to come before
+ * the first packet that refers to them, so all the interfaces are
+ * added before any packets are written.  When the savefile is closed,
+ * an interface statistics block can be written for each interface,
+ * with the capture's packet and drop counts.
+ *
+ * Each block is put together in a buffer of PCAPNG_BUFSIZE bytes,
+ * which is written out in one go when the next block doesn't fit,
+ * rather than with a standard I/O call for each part of every block.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include "netdissect-stdinc.h"
+
+#include <errno.h>
+#include <pcap.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "pcapng-savefile.h"
+
+#define PCAPNG_SHB		0x0A0D0D0AU	/* section header block */
+#define PCAPNG_IDB		0x00000001U	/* interface description block */
+#define PCAPNG_ISB		0x00000005U	/* interface statistics block */
+#define PCAPNG_EPB		0x00000006U	/* enhanced packet block */
+#define PCAPNG_BYTE_ORDER_MAGIC	0x1A2B3C4DU
+
+#define PCAPNG_OPT_ENDOFOPT	0
+#define PCAPNG_OPT_IF_NAME	2
+#define PCAPNG_OPT_IF_TSRESOL	9
+#define PCAPNG_OPT_ISB_STARTTIME	2
+#define PCAPNG_OPT_ISB_ENDTIME	3
+#define PCAPNG_OPT_ISB_IFRECV	4
+#define PCAPNG_OPT_ISB_IFDROP	5
+#define PCAPNG_OPT_ISB_OSDROP	7
+
+#define PCAPNG_PAD(n)		(((n) + 3) & ~(size_t)3)
+#define PCAPNG_BUFSIZE		(1024 * 1024)
+
+struct pcapng_savefile {
+	FILE	*fp;
+	int	nano;		/* time stamps are in nanoseconds */
+	u_int	ninterfaces;
+	u_char	*buf;		/* blocks not yet written */
+	size_t	len;		/* bytes in buf */
+	uint64_t written;	/* bytes written before those */
+};
+
+struct pcapng_block_header {
+	uint32_t	type;
+	uint32_t	len;
+};
+
+struct pcapng_shb {
+	uint32_t	byte_order_magic;
+	uint16_t	major;
+	uint16_t	minor;
+	uint32_t	section_len[2];	/* -1, not known */
+};
+
+struct pcapng_idb {
+	uint16_t	linktype;
+	uint16_t	reserved;
+	uint32_t	snaplen;
+};
+
+struct pcapng_isb {
+	uint32_t	interface_id;
+	uint32_t	ts_high;
+	uint32_t	ts_low;
+};
+
+struct pcapng_epb {
+	uint32_t	interface_id;
+	uint32_t	ts_high;
+	uint32_t	ts_low;
+	uint32_t	caplen;
+	uint32_t	len;
+};
+
+struct pcapng_option {
+	uint16_t	code;
+	uint16_t	len;
+};
+
+/*
+ * Write out the blocks in the buffer.
+ */
+static int
+pcapng_write_buf(struct pcapng_savefile *psf)
+{
+	if (psf->len != 0 &&
+	    fwrite(psf->buf, 1, psf->len, psf->fp) != psf->len)
+		return (-1);
+	psf->written += psf->len;
+	psf->len = 0;
+	return (0);
+}
+
+/*
+ * Start a block of the given type with len bytes between its header
+ * and its trailing length, making room for all of it in the buffer;
+ * returns a pointer to where those len bytes go, or NULL, with errno
+ * set, on a write error.  A block bigger than the buffer goes in a
+ * bigger buffer of its own.
+ */
+static u_char *
+pcapng_block_begin(struct pcapng_savefile *psf, uint32_t type, size_t len)
+{
+	struct pcapng_block_header bh;
+	size_t total;
+	u_char *p;
+
+	total = sizeof(bh) + len + sizeof(uint32_t);
+	if (psf->len + total > PCAPNG_BUFSIZE && pcapng_write_buf(psf) == -1)
+		return (NULL);
+	if (total > PCAPNG_BUFSIZE) {
+		p = (u_char *)realloc(psf->buf, total);
+		if (p == NULL)
+			return (NULL);
+		psf->buf = p;
+	}
+	bh.type = type;
+	bh.len = (uint32_t)total;
+	p = psf->buf + psf->len;
+	memcpy(p, &bh, sizeof(bh));
+	memcpy(p + sizeof(bh) + len, &bh.len, sizeof(bh.len));
+	psf->len += total;
+	return (p + sizeof(bh));
+}
+
+/*
+ * Put an option at p and return a pointer to just past it and its
+ * padding.
+ */
+static u_char *
+pcapng_put_option(u_char *p, uint16_t code, const void *data, size_t len)
+{
+	struct pcapng_option opt;
+
+	opt.code = code;
+	opt.len = (uint16_t)len;
+	memcpy(p, &opt, sizeof(opt));
+	p += sizeof(opt);
+	if (len != 0)
+		memcpy(p, data, len);
+	memset(p + len, 0, PCAPNG_PAD(len) - len);
+	return (p + PCAPNG_PAD(len));
+}
+
+static u_char *
+pcapng_put_ts(const struct pcapng_savefile *psf, u_char *p,
+    const struct timeval *tv)
+{
+	uint64_t ts;
+	uint32_t w;
+
+	ts = (uint64_t)tv->tv_sec * (psf->nano ? 1000000000U : 1000000U) +
+	    (uint64_t)tv->tv_usec;
+	w = (uint32_t)(ts >> 32);
+	memcpy(p, &w, sizeof(w));
+	w = (uint32_t)ts;
+	memcpy(p + sizeof(w), &w, sizeof(w));
+	return (p + 2 * sizeof(w));
+}
+
+/*
+ * Start writing a savefile to fp, which it takes over, with its
+ * section header.  nano says whether the packets' time stamps are in
+ * nanoseconds rather than microseconds.  On failure, return NULL with
+ * a message in errbuf, which must be PCAP_ERRBUF_SIZE bytes; fp is
+ * closed either way.
+ */
+struct pcapng_savefile *
+pcapng_savefile_fopen(FILE *fp, int nano, char *errbuf)
+{
+	struct pcapng_savefile *psf;
+	struct pcapng_shb shb;
+	u_char *p;
+
+	psf = (struct pcapng_savefile *)calloc(1, sizeof(*psf));
+	if (psf == NULL || (psf->buf = (u_char *)malloc(PCAPNG_BUFSIZE)) == NULL) {
+		snprintf(errbuf, PCAP_ERRBUF_SIZE, "malloc: %s",
+		    strerror(errno));
+		free(psf);
+		if (fp != stdout)
+			(void)fclose(fp);
+		return (NULL);
+	}
+	psf->fp = fp;
+	psf->nano = nano;
+
+	shb.byte_order_magic = PCAPNG_BYTE_ORDER_MAGIC;
+	shb.major = 1;
+	shb.minor = 0;
+	shb.section_len[0] = shb.section_len[1] = 0xffffffffU;
+	p = pcapng_block_begin(psf, PCAPNG_SHB, sizeof(shb) + 4);
+	memcpy(p, &shb, sizeof(shb));
+	(void)pcapng_put_option(p + sizeof(shb), PCAPNG_OPT_ENDOFOPT, NULL, 0);
+	return (psf);
+}
+
+/*
+ * Create the savefile fname, or write to the standard output if it's
+ * "-", as pcapng_savefile_fopen() does.
+ */
+struct pcapng_savefile *
+pcapng_savefile_open(const char *fname, int nano, char *errbuf)
+{
+	FILE *fp;
+
+	if (strcmp(fname, "-") == 0)
+		fp = stdout;
+	else
+		fp = fopen(fname, "wb");
+	if (fp == NULL) {
+		snprintf(errbuf, PCAP_ERRBUF_SIZE, "%s: %s", fname,
+		    strerror(errno));
+		return (NULL);
+	}
+	return (pcapng_savefile_fopen(fp, nano, errbuf));
+}
+
+/*
+ * Add an interface, with the given name, which may be NULL, link-layer
+ * header type and snapshot length; the first one added is interface 0,
+ * the next 1, and so on.  Returns -1, with errno set, on a write error.
+ */
+int
+pcapng_savefile_add_interface(struct pcapng_savefile *psf, const char *name,
+    int linktype, int snaplen)
+{
+	struct pcapng_idb idb;
+	size_t namelen = 0, len;
+	u_char tsresol = 9, *p;
+
+	len = sizeof(idb);
+	if (name != NULL) {
+		namelen = strlen(name);
+		if (namelen > 0xffff - 3)
+			namelen = 0xffff - 3;
+		len += sizeof(struct pcapng_option) + PCAPNG_PAD(namelen);
+	}
+	if (psf->nano)
+		len += sizeof(struct pcapng_option) + PCAPNG_PAD(1);
+	len += sizeof(struct pcapng_option);
+
+	idb.linktype = (uint16_t)linktype;
+	idb.reserved = 0;
+	idb.snaplen = (uint32_t)snaplen;
+	if ((p = pcapng_block_begin(psf, PCAPNG_IDB, len)) == NULL)
+		return (-1);
+	memcpy(p, &idb, sizeof(idb));
+	p += sizeof(idb);
+	if (name != NULL)
+		p = pcapng_put_option(p, PCAPNG_OPT_IF_NAME, name, namelen);
+	if (psf->nano)
+		p = pcapng_put_option(p, PCAPNG_OPT_IF_TSRESOL, &tsresol, 1);
+	(void)pcapng_put_option(p, PCAPNG_OPT_ENDOFOPT, NULL, 0);
+	psf->ninterfaces++;
+	return (0);
+}
+
+/*
+ * Write a packet from interface ifid.  Returns -1, with errno set, on
+ * a write error.
+ */
+int
+pcapng_savefile_dump(struct pcapng_savefile *psf, u_int ifid,
+    const struct pcap_pkthdr *h, const u_char *sp)
+{
+	struct pcapng_epb epb;
+	u_char *p;
+
+	if (ifid >= psf->ninterfaces) {
+		errno = EINVAL;
+		return (-1);
+	}
+	p = pcapng_block_begin(psf, PCAPNG_EPB,
+	    sizeof(epb) + PCAPNG_PAD(h->caplen));
+	if (p == NULL)
+		return (-1);
+	epb.interface_id = ifid;
+	(void)pcapng_put_ts(psf, (u_char *)&epb.ts_high, &h->ts);
+	epb.caplen = h->caplen;
+	epb.len = h->len;
+	memcpy(p, &epb, sizeof(epb));
+	p += sizeof(epb);
+	memcpy(p, sp, h->caplen);
+	memset(p + h->caplen, 0, PCAPNG_PAD(h->caplen) - h->caplen);
+	return (0);
+}
+
+/*
+ * Write the statistics of interface ifid, as retrieved with
+ * pcap_stats(), for the capture from start to end, which are in the
+ * same units as the packets' time stamps.  Returns -1, with errno set,
+ * on a write error.
+ */
+int
+pcapng_savefile_stats(struct pcapng_savefile *psf, u_int ifid,
+    const struct timeval *start, const struct timeval *end,
+    const struct pcap_stat *ps)
+{
+	struct pcapng_isb isb;
+	uint64_t count;
+	u_char ts[8], *p;
+	size_t len;
+
+	if (ifid >= psf->ninterfaces) {
+		errno = EINVAL;
+		return (-1);
+	}
+	len = sizeof(isb) + 2 * (sizeof(struct pcapng_option) + sizeof(ts)) +
+	    3 * (sizeof(struct pcapng_option) + sizeof(count)) +
+	    sizeof(struct pcapng_option);
+	if ((p = pcapng_block_begin(psf, PCAPNG_ISB, len)) == NULL)
+		return (-1);
+	isb.interface_id = ifid;
+	(void)pcapng_put_ts(psf, (u_char *)&isb.ts_high, end);
+	memcpy(p, &isb, sizeof(isb));
+	p += sizeof(isb);
+	(void)pcapng_put_ts(psf, ts, start);
+	p = pcapng_put_option(p, PCAPNG_OPT_ISB_STARTTIME, ts, sizeof(ts));
+	(void)pcapng_put_ts(psf, ts, end);
+	p = pcapng_put_option(p, PCAPNG_OPT_ISB_ENDTIME, ts, sizeof(ts));
+	count = ps->ps_recv;
+	p = pcapng_put_option(p, PCAPNG_OPT_ISB_IFRECV, &count, sizeof(count));
+	count = ps->ps_ifdrop;
+	p = pcapng_put_option(p, PCAPNG_OPT_ISB_IFDROP, &count, sizeof(count));
+	count = ps->ps_drop;
+	p = pcapng_put_option(p, PCAPNG_OPT_ISB_OSDROP, &count, sizeof(count));
+	(void)pcapng_put_option(p, PCAPNG_OPT_ENDOFOPT, NULL, 0);
+	return (0);
+}
+
+/*
+ * The length of the savefile so far, including what's still in the
+ * buffer.
+ */
+uint64_t
+pcapng_savefile_length(const struct pcapng_savefile *psf)
+{
+	return (psf->written + psf->len);
+}
+
+int
+pcapng_savefile_flush(struct pcapng_savefile *psf)
+{
+	if (pcapng_write_buf(psf) == -1)
+		return (-1);
+	return (fflush(psf->fp) == EOF ? -1 : 0);
+}
+
+/*
+ * Write out what's left, close the savefile and free it; returns -1,
+ * with errno set, if that couldn't all be written.
+ */
+int
+pcapng_savefile_close(struct pcapng_savefile *psf)
+{
+	int ret;
+
+	ret = pcapng_write_buf(psf);
+	if (psf->fp == stdout) {
+		if (fflush(psf->fp) == EOF)
+			ret = -1;
+	} else if (fclose(psf->fp) == EOF)
+		ret = -1;
+	free(psf->buf);
+	free(psf);
+	return (ret);
+}
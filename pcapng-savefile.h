@@ -0,0 +1,35 @@
+/*
+ * Copyright (c) 2026 The TCPDUMP project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that: (1) source code
+ * distributions retain the above copyright notice and this paragraph
+ * in its entirety, and (2) distributions including binary code include
+ * the above copyright notice and this paragraph in its entirety in
+ * the documentation or other materials provided with the distribution.
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND
+ * WITHOUT ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, WITHOUT
+ * LIMITATION, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE.
+ */
+
+/*
+ * pcapng savefiles, for -w with --pcapng or more than one -i; libpcap
+ * can only write pcap savefiles, and only for one pcap_t.
+ */
+struct pcapng_savefile;
+
+extern struct pcapng_savefile *pcapng_savefile_open(const char *, int,
+    char *);
+extern struct pcapng_savefile *pcapng_savefile_fopen(FILE *, int, char *);
+extern int pcapng_savefile_add_interface(struct pcapng_savefile *,
+    const char *, int, int);
+extern int pcapng_savefile_dump(struct pcapng_savefile *, u_int,
+    const struct pcap_pkthdr *, const u_char *);
+extern int pcapng_savefile_stats(struct pcapng_savefile *, u_int,
+    const struct timeval *, const struct timeval *,
+    const struct pcap_stat *);
+extern uint64_t pcapng_savefile_length(const struct pcapng_savefile *);
+extern int pcapng_savefile_flush(struct pcapng_savefile *);
+extern int pcapng_savefile_close(struct pcapng_savefile *);
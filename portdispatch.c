@@ -0,0 +1,300 @@
+/*
+ * Copyright (c) 2026 The TCPDUMP project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that: (1) source code
+ * distributions retain the above copyright notice and this paragraph
+ * in its entirety, and (2) distributions including binary code include
+ * the above copyright notice and this paragraph in its entirety in
+ * the documentation or other materials provided with the distribution.
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND
+ * WITHOUT ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, WITHOUT
+ * LIMITATION, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "netdissect-stdinc.h"
+#include "netdissect.h"
+#include "netdissect-profile.h"
+#include "portdispatch.h"
+
+/*
+ * The dissector numbered "i": a built-in one or, after those, one that
+ * was registered.
+ */
+static const struct port_dissector *
+port_table_dissector(const struct port_table *t, u_int i)
+{
+	if (t->nregistered != 0 && i >= t->ndissectors)
+		return (t->registered[i - t->ndissectors]);
+	return (&t->dissectors[i]);
+}
+
+/*
+ * Returns the number of the dissector named "name", or -1.
+ */
+int
+port_table_find(const struct port_table *t, const char *name)
+{
+	u_int i;
+
+	for (i = 0; t->dissectors[i].name != NULL; i++)
+		if (strcmp(t->dissectors[i].name, name) == 0)
+			return ((int)i);
+	for (i = 0; i < t->nregistered; i++)
+		if (strcmp(t->registered[i]->name, name) == 0)
+			return ((int)(t->ndissectors + i));
+	return (-1);
+}
+
+/*
+ * Put "rule" before the one at "pos".
+ */
+static int
+port_table_insert(struct port_table *t, u_int pos,
+    const struct port_rule *rule)
+{
+	struct port_rule *rules;
+
+	if (t->nrules >= PORT_MAX_RULES)
+		return (-1);
+	rules = (struct port_rule *)realloc(t->rules,
+	    (t->nrules + 1) * sizeof(*rules));
+	if (rules == NULL)
+		return (-1);
+	memmove(&rules[pos + 1], &rules[pos],
+	    (t->nrules - pos) * sizeof(*rules));
+	rules[pos] = *rule;
+	t->nrules++;
+	t->rules = rules;
+	return (0);
+}
+
+static int
+port_table_add(struct port_table *t, const struct port_rule *rule)
+{
+	return (port_table_insert(t, t->nrules, rule));
+}
+
+/*
+ * Have "port", on either side, go to the dissector named "name" ahead
+ * of the built-in rules.  Must be called before port_table_build();
+ * returns -1 if there's no such dissector, it wasn't compiled in, or
+ * there's no room.
+ */
+int
+port_table_map(struct port_table *t, u_int port, const char *name)
+{
+	struct port_rule rule;
+	int i;
+
+	if (port > 65535 || t->rank[0] != NULL)
+		return (-1);
+	if ((i = port_table_find(t, name)) == -1 ||
+	    port_table_dissector(t, i)->printer == NULL)
+		return (-1);
+	rule.lo = rule.hi = (u_short)port;
+	rule.side = PORT_EITHER;
+	rule.dissector = (u_char)i;
+	if (port_table_insert(t, t->nmapped, &rule) == -1)
+		return (-1);
+	t->nmapped++;
+	return (0);
+}
+
+/*
+ * Fill in the tables from the rules, each port getting the first rule
+ * that covers it.
+ */
+static int
+port_table_rank(struct port_table *t)
+{
+	const struct port_rule *rule;
+	u_int i, side, port;
+
+	for (side = 0; side < 2; side++) {
+		if (t->rank[side] == NULL)
+			t->rank[side] = (u_char *)calloc(65536, 1);
+		else
+			memset(t->rank[side], 0, 65536);
+		if (t->rank[side] == NULL)
+			return (-1);
+	}
+	/*
+	 * Go backwards, so that each port ends up with the first rule
+	 * that covers it.
+	 */
+	i = t->nrules;
+	while (i-- != 0) {
+		rule = &t->rules[i];
+		for (port = rule->lo; port <= rule->hi; port++) {
+			if (rule->side & PORT_SRC)
+				t->rank[0][port] = (u_char)(i + 1);
+			if (rule->side & PORT_DST)
+				t->rank[1][port] = (u_char)(i + 1);
+		}
+	}
+	return (0);
+}
+
+/*
+ * Have ports "lo" through "hi" on "side" go to "pd", a dissector that
+ * isn't built in, after any --port-map rules and ahead of the built-in
+ * ones and of those registered before it.  This can be done after
+ * port_table_build(), which redoes the tables, but not once packets
+ * are being dissected.  Returns -1 if the rule is invalid or there's
+ * no room.
+ */
+int
+port_table_register(struct port_table *t, u_int lo, u_int hi, u_int side,
+    const struct port_dissector *pd)
+{
+	const struct port_dissector **registered;
+	struct port_rule rule;
+
+	if (lo > hi || hi > 65535 || side == 0 || (side & ~PORT_EITHER) ||
+	    pd->name == NULL || pd->printer == NULL)
+		return (-1);
+	if (t->ndissectors == 0)
+		while (t->dissectors[t->ndissectors].name != NULL)
+			t->ndissectors++;
+	if (t->ndissectors + t->nregistered > 255)
+		return (-1);
+	registered = (const struct port_dissector **)realloc(t->registered,
+	    (t->nregistered + 1) * sizeof(*registered));
+	if (registered == NULL)
+		return (-1);
+	t->registered = registered;
+	rule.lo = (u_short)lo;
+	rule.hi = (u_short)hi;
+	rule.side = (u_char)side;
+	rule.dissector = (u_char)(t->ndissectors + t->nregistered);
+	if (port_table_insert(t, t->nmapped, &rule) == -1)
+		return (-1);
+	registered[t->nregistered++] = pd;
+	if (t->rank[0] != NULL)
+		return (port_table_rank(t));
+	return (0);
+}
+
+/*
+ * Add the built-in rules whose dissectors were compiled in and haven't
+ * been disabled after the mapped ones, and fill in the tables.  Returns
+ * -1 if memory couldn't be allocated.
+ */
+int
+port_table_build(struct port_table *t)
+{
+	const struct port_rule *rule;
+	u_int i;
+
+	if (t->rank[0] != NULL)
+		return (0);
+	for (i = 0; i < t->nbuiltin; i++) {
+		rule = &t->builtin[i];
+		if (t->dissectors[rule->dissector].printer == NULL ||
+		    nd_dissector_disabled(t->dissectors[rule->dissector].name))
+			continue;
+		if (port_table_add(t, rule) == -1)
+			return (-1);
+	}
+	return (port_table_rank(t));
+}
+
+/*
+ * Returns the number, from 1, of the first rule matching the packet's
+ * ports, and sets the side that matched, or returns 0 if none does.
+ */
+static u_int
+port_first_rule(const struct port_table *t, struct port_info *pi)
+{
+	u_int s, d;
+
+	if (t->rank[0] == NULL)
+		return (0);
+	s = t->rank[0][pi->sport];
+	d = t->rank[1][pi->dport];
+	if (d != 0 && (s == 0 || d <= s)) {
+		pi->side = PORT_DST;
+		return (d);
+	}
+	if (s != 0) {
+		pi->side = PORT_SRC;
+		return (s);
+	}
+	return (0);
+}
+
+/*
+ * Returns the dissector for the first rule matching the packet's
+ * ports, or NULL.
+ */
+const struct port_dissector *
+port_match(const struct port_table *t, struct port_info *pi)
+{
+	u_int r;
+
+	if ((r = port_first_rule(t, pi)) == 0)
+		return (NULL);
+	return (port_table_dissector(t, t->rules[r - 1].dissector));
+}
+
+/*
+ * Hand the payload to the dissector for the first rule matching the
+ * packet's ports.  Returns 0 if there was none, or if all of those
+ * that matched turned the packet down.
+ */
+int
+port_dispatch(netdissect_options *ndo, const struct port_table *t,
+    const u_char *bp, u_int length, struct port_info *pi)
+{
+	const struct port_rule *rule;
+	const struct port_dissector *pd;
+	u_int r;
+	int done;
+
+	if ((r = port_first_rule(t, pi)) == 0)
+		return (0);
+
+	for (;;) {
+		rule = &t->rules[r - 1];
+		pd = port_table_dissector(t, rule->dissector);
+		ND_PROFILE_ENTER(pd->name);
+		done = (*pd->printer)(ndo, bp, length, pi);
+		ND_PROFILE_LEAVE();
+		if (done)
+			return (1);
+
+		/*
+		 * Turned down; go on to the next rule that matches, other
+		 * than those for the same dissector.
+		 */
+		for (; r < t->nrules; r++) {
+			if (t->rules[r].dissector == rule->dissector)
+				continue;
+			if ((t->rules[r].side & PORT_DST) &&
+			    pi->dport >= t->rules[r].lo &&
+			    pi->dport <= t->rules[r].hi) {
+				pi->side = PORT_DST;
+				break;
+			}
+			if ((t->rules[r].side & PORT_SRC) &&
+			    pi->sport >= t->rules[r].lo &&
+			    pi->sport <= t->rules[r].hi) {
+				pi->side = PORT_SRC;
+				break;
+			}
+		}
+		if (r == t->nrules)
+			return (0);
+		r++;
+	}
+}
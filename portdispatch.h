@@ -0,0 +1,114 @@
+/*
+ * Copyright (c) 2026 The TCPDUMP project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that: (1) source code
+ * distributions retain the above copyright notice and this paragraph
+ * in its entirety, and (2) distributions including binary code include
+ * the above copyright notice and this paragraph in its entirety in
+ * the documentation or other materials provided with the distribution.
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND
+ * WITHOUT ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, WITHOUT
+ * LIMITATION, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE.
+ */
+
+#ifndef portdispatch_h
+#define portdispatch_h
+
+/*
+ * Choosing an application printer by TCP or UDP port.
+ *
+ * A protocol has a list of rules, each a range of ports, the side
+ * (source, destination or either) they're matched against, and the
+ * dissector to use; the first rule that matches a packet wins, as
+ * with a chain of IS_SRC_OR_DST_PORT() tests.  The rules are turned
+ * into two tables indexed by port that hold the first rule for that
+ * port on each side, so a packet costs two lookups.
+ *
+ * A dissector returns 0 if it turns the packet down (e.g. it's too
+ * short to be what the port says), in which case the next rule that
+ * matches with a different dissector is tried.
+ */
+#define PORT_SRC	0x01
+#define PORT_DST	0x02
+#define PORT_EITHER	(PORT_SRC|PORT_DST)
+
+struct port_info {
+	u_int sport, dport;
+	const u_char *iph;	/* IPv4 or IPv6 header */
+	int fragmented;
+	u_int ttl_hl;
+	u_int side;		/* set to the side that matched */
+};
+
+typedef int (*port_printer)(netdissect_options *, const u_char *, u_int,
+    const struct port_info *);
+
+/*
+ * A dissector for messages over TCP can have a framer, for
+ * --tcp-reassembly (see tcp-reasm.h).  It's given what should be the
+ * start of a message and the number of bytes there are from there,
+ * and returns 1 and sets the length of the message if there are enough
+ * bytes to tell it, 0 if there aren't, and -1 if that isn't the start
+ * of a message.  A dissector with PORT_ONE_MESSAGE set only looks at
+ * the first message it's handed, so it's handed them one at a time.
+ */
+typedef int (*port_framer)(const u_char *, u_int, u_int *);
+
+#define PORT_ONE_MESSAGE	0x01
+
+struct port_dissector {
+	const char *name;
+	port_printer printer;	/* NULL if compiled out (ND_OMIT_xxx) */
+	port_framer framer;	/* NULL if not reassembled */
+	u_int flags;
+};
+
+struct port_rule {
+	u_short lo, hi;		/* range of ports, inclusive */
+	u_char side;		/* PORT_SRC, PORT_DST or PORT_EITHER */
+	u_char dissector;	/* index into the dissectors */
+};
+
+#define PORT_MAX_RULES	255
+
+struct port_table {
+	const struct port_dissector *dissectors;  /* ends with a NULL name */
+	const struct port_rule *builtin;
+	u_int nbuiltin;
+	struct port_rule *rules;	/* registered and --port-map ones,
+					   then built-in */
+	u_int nrules;
+	u_int nmapped;
+	u_char *rank[2];		/* by source and destination port */
+	const struct port_dissector **registered;  /* numbered after
+						      "dissectors" */
+	u_int nregistered;
+	u_int ndissectors;		/* in "dissectors", once counted */
+};
+
+extern struct port_table tcp_port_table;
+extern struct port_table udp_port_table;
+
+extern int port_table_find(const struct port_table *, const char *);
+extern int port_table_map(struct port_table *, u_int, const char *);
+extern int port_table_register(struct port_table *, u_int, u_int, u_int,
+    const struct port_dissector *);
+extern int port_table_build(struct port_table *);
+extern const struct port_dissector *port_match(const struct port_table *,
+    struct port_info *);
+extern int port_dispatch(netdissect_options *, const struct port_table *,
+    const u_char *, u_int, struct port_info *);
+
+/*
+ * Send TCP (IPPROTO_TCP) or UDP (IPPROTO_UDP) traffic with a port from
+ * "lo" to "hi" on the given side to a dissector that isn't built in,
+ * e.g. one of a plugin's, ahead of the built-in assignments; see
+ * nd_register_ethertype() in netdissect.h.
+ */
+extern int nd_register_port(u_int, u_int, u_int, u_int,
+    const struct port_dissector *);
+
+#endif /* portdispatch_h */
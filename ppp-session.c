@@ -0,0 +1,163 @@
+/*
+ * Copyright (c) 2026 The TCPDUMP project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that: (1) source code
+ * distributions retain the above copyright notice and this paragraph
+ * in its entirety, and (2) distributions including binary code include
+ * the above copyright notice and this paragraph in its entirety in
+ * the documentation or other materials provided with the distribution.
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND
+ * WITHOUT ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, WITHOUT
+ * LIMITATION, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE.
+ */
+
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include "netdissect-stdinc.h"
+
+#include <stdlib.h>
+
+#include "netdissect.h"
+#include "ppp-session.h"
+
+#define PPP_SESSION_CHAINS	4096
+
+static ND_THREAD_LOCAL struct ppp_session *ppp_session_chains[PPP_SESSION_CHAINS];
+static ND_THREAD_LOCAL struct ppp_session **ppp_sessions; /* in order made */
+static ND_THREAD_LOCAL u_int ppp_nsessions, ppp_maxsessions;
+
+/*
+ * Return the entry for "session" of "tunnel" (0 for PPPoE) of protocol
+ * "proto", making it if there isn't one.
+ */
+struct ppp_session *
+ppp_session_find(netdissect_options *ndo, u_int proto, u_int tunnel,
+                 u_int session)
+{
+	struct ppp_session *ps, **psp;
+	uint32_t h = 2166136261U;
+
+	h = (h ^ proto) * 16777619U;
+	h = (h ^ (tunnel >> 8)) * 16777619U;
+	h = (h ^ (tunnel & 0xff)) * 16777619U;
+	h = (h ^ (session >> 8)) * 16777619U;
+	h = (h ^ (session & 0xff)) * 16777619U;
+	psp = &ppp_session_chains[h % PPP_SESSION_CHAINS];
+	for (ps = *psp; ps != NULL; ps = ps->next)
+		if (ps->stats.pss_proto == proto &&
+		    ps->stats.pss_tunnel == tunnel &&
+		    ps->stats.pss_session == session)
+			return ps;
+
+	if (ppp_nsessions == ppp_maxsessions) {
+		ppp_maxsessions = ppp_maxsessions ? ppp_maxsessions * 2 : 64;
+		ppp_sessions = (struct ppp_session **)realloc(ppp_sessions,
+		    ppp_maxsessions * sizeof(*ppp_sessions));
+		if (ppp_sessions == NULL)
+			(*ndo->ndo_error)(ndo, S_ERR_ND_MEM_ALLOC,
+			    "%s: realloc", __func__);
+	}
+	ps = (struct ppp_session *)calloc(1, sizeof(*ps));
+	if (ps == NULL)
+		(*ndo->ndo_error)(ndo, S_ERR_ND_MEM_ALLOC, "%s: calloc",
+		    __func__);
+	ps->stats.pss_proto = proto;
+	ps->stats.pss_tunnel = tunnel;
+	ps->stats.pss_session = session;
+	ps->stats.pss_state = PPP_SESSION_SEEN;
+	ps->next = *psp;
+	*psp = ps;
+	ppp_sessions[ppp_nsessions++] = ps;
+	return ps;
+}
+
+/*
+ * Make "a" and "b" the two directions of a tunnel or call.
+ */
+void
+ppp_session_pair(struct ppp_session *a, struct ppp_session *b)
+{
+	if (a == b)
+		return;
+	if (a->peer != NULL)
+		a->peer->peer = NULL;
+	if (b->peer != NULL)
+		b->peer->peer = NULL;
+	a->peer = b;
+	b->peer = a;
+}
+
+static void
+ppp_session_set(struct ppp_session *ps, u_int state)
+{
+	if (ps->stats.pss_state == PPP_SESSION_DOWN &&
+	    state != PPP_SESSION_DOWN) {
+		/* The ID is being used again. */
+		ps->stats.pss_packets = 0;
+		ps->stats.pss_bytes = 0;
+		ps->stats.pss_control = 0;
+	}
+	ps->stats.pss_state = state;
+}
+
+/*
+ * Move "ps", and the other direction of it if it's known, to "state".
+ */
+void
+ppp_session_state(struct ppp_session *ps, u_int state)
+{
+	ppp_session_set(ps, state);
+	if (ps->peer != NULL)
+		ppp_session_set(ps->peer, state);
+}
+
+/*
+ * Take down the L2TP sessions of "tunnel" that aren't already down, and
+ * return how many there were.
+ */
+u_int
+ppp_session_tunnel_down(u_int tunnel)
+{
+	struct ppp_session *ps;
+	u_int i, n = 0;
+
+	for (i = 0; i < ppp_nsessions; i++) {
+		ps = ppp_sessions[i];
+		if (ps->stats.pss_proto != PPP_SESSION_L2TP ||
+		    ps->stats.pss_tunnel != tunnel ||
+		    ps->stats.pss_session == PPP_SESSION_TUNNEL ||
+		    ps->stats.pss_state == PPP_SESSION_DOWN)
+			continue;
+		ppp_session_set(ps, PPP_SESSION_DOWN);
+		n++;
+	}
+	return n;
+}
+
+/*
+ * Count a data packet, carrying "length" bytes of PPP, to "ps"; the
+ * packet isn't shown, as --ppp-sessions only shows the control plane.
+ */
+void
+ppp_session_data(netdissect_options *ndo, struct ppp_session *ps,
+                 u_int length)
+{
+	ps->stats.pss_packets++;
+	ps->stats.pss_bytes += length;
+	ndo->ndo_drop_line = 1;
+}
+
+void
+ppp_session_foreach(ppp_session_fn fn, void *arg)
+{
+	u_int i;
+
+	for (i = 0; i < ppp_nsessions; i++)
+		(*fn)(arg, &ppp_sessions[i]->stats);
+}
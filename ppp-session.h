@@ -0,0 +1,43 @@
+/*
+ * Copyright (c) 2026 The TCPDUMP project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that: (1) source code
+ * distributions retain the above copyright notice and this paragraph
+ * in its entirety, and (2) distributions including binary code include
+ * the above copyright notice and this paragraph in its entirety in
+ * the documentation or other materials provided with the distribution.
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND
+ * WITHOUT ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, WITHOUT
+ * LIMITATION, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE.
+ */
+
+
+#ifndef ppp_session_h
+#define ppp_session_h
+
+/*
+ * The --ppp-sessions table of L2TP tunnels and sessions and PPPoE
+ * sessions, keyed by the IDs as the packets to them carry them.  An
+ * L2TP tunnel or call has an entry for each direction, each pointing at
+ * the other once the control messages have shown which they are, so
+ * that a call is brought up, and torn down, as a whole.  A session whose
+ * ID is used again after it went down starts over.
+ */
+struct ppp_session {
+	struct ppp_session_stats stats;
+	struct ppp_session *peer;	/* the other direction, or NULL */
+	struct ppp_session *next;	/* on its hash chain */
+};
+
+extern struct ppp_session *ppp_session_find(netdissect_options *, u_int,
+    u_int, u_int);
+extern void ppp_session_pair(struct ppp_session *, struct ppp_session *);
+extern void ppp_session_state(struct ppp_session *, u_int);
+extern u_int ppp_session_tunnel_down(u_int);
+extern void ppp_session_data(netdissect_options *, struct ppp_session *,
+    u_int);
+
+#endif /* ppp_session_h */
@@ -0,0 +1,160 @@
+/*
+ * Copyright (c) 2026 The TCPDUMP project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that: (1) source code
+ * distributions retain the above copyright notice and this paragraph
+ * in its entirety, and (2) distributions including binary code include
+ * the above copyright notice and this paragraph in its entirety in
+ * the documentation or other materials provided with the distribution.
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND
+ * WITHOUT ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, WITHOUT
+ * LIMITATION, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE.
+ */
+
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "netdissect-stdinc.h"
+
+#include "prefix-trie.h"
+
+struct prefix_trie {
+	u_char key[PREFIX_TRIE_MAXBYTES];	/* zero past plen bits */
+	u_int plen;
+	int value;				/* -1 if only a branch */
+	struct prefix_trie *child[2];
+};
+
+/* Bit "i" of "a", counting from the top of the first byte. */
+static u_int
+bit(const u_char *a, u_int i)
+{
+	return ((a[i / 8] >> (7 - i % 8)) & 1);
+}
+
+/* The number of leading bits, up to "max", that "a" and "b" share. */
+static u_int
+common_bits(const u_char *a, const u_char *b, u_int max)
+{
+	u_int i;
+	u_char x;
+
+	for (i = 0; i < max; i += 8) {
+		x = a[i / 8] ^ b[i / 8];
+		if (x != 0) {
+			while ((x & 0x80) == 0) {
+				x <<= 1;
+				i++;
+			}
+			break;
+		}
+	}
+	return (i < max ? i : max);
+}
+
+static struct prefix_trie *
+node_new(const u_char *addr, u_int plen, int value)
+{
+	struct prefix_trie *n;
+
+	n = (struct prefix_trie *)calloc(1, sizeof(*n));
+	if (n == NULL)
+		return (NULL);
+	memcpy(n->key, addr, (plen + 7) / 8);
+	if (plen % 8 != 0)
+		n->key[plen / 8] &= (u_char)(0xff << (8 - plen % 8));
+	n->plen = plen;
+	n->value = value;
+	return (n);
+}
+
+/*
+ * Add the prefix of the first "plen" bits of "addr", with the value
+ * "value", which must not be -1.
+ */
+int
+prefix_trie_add(struct prefix_trie **np, const u_char *addr, u_int plen,
+		int value)
+{
+	struct prefix_trie *n, *leaf, *branch;
+	u_int common;
+
+	if (plen > PREFIX_TRIE_MAXBYTES * 8)
+		plen = PREFIX_TRIE_MAXBYTES * 8;
+	while ((n = *np) != NULL) {
+		common = common_bits(addr, n->key,
+		    plen < n->plen ? plen : n->plen);
+		if (common < n->plen) {
+			/*
+			 * The new prefix leaves the path to "n" above it:
+			 * either it goes in above "n", or they branch.
+			 */
+			if (common == plen) {
+				leaf = node_new(addr, plen, value);
+				if (leaf == NULL)
+					return (-1);
+				leaf->child[bit(n->key, plen)] = n;
+				*np = leaf;
+				return (0);
+			}
+			leaf = node_new(addr, plen, value);
+			branch = node_new(addr, common, -1);
+			if (leaf == NULL || branch == NULL) {
+				free(leaf);
+				free(branch);
+				return (-1);
+			}
+			branch->child[bit(addr, common)] = leaf;
+			branch->child[bit(n->key, common)] = n;
+			*np = branch;
+			return (0);
+		}
+		if (plen == n->plen) {
+			n->value = value;
+			return (0);
+		}
+		np = &n->child[bit(addr, n->plen)];
+	}
+	*np = node_new(addr, plen, value);
+	return (*np == NULL ? -1 : 0);
+}
+
+/*
+ * Return the value of the longest prefix that the "alen"-bit address
+ * "addr" falls in.
+ */
+int
+prefix_trie_lookup(const struct prefix_trie *n, const u_char *addr,
+		   u_int alen)
+{
+	int value;
+
+	value = -1;
+	while (n != NULL && n->plen <= alen &&
+	    common_bits(addr, n->key, n->plen) == n->plen) {
+		if (n->value != -1)
+			value = n->value;
+		if (n->plen == alen)
+			break;
+		n = n->child[bit(addr, n->plen)];
+	}
+	return (value);
+}
+
+void
+prefix_trie_free(struct prefix_trie *n)
+{
+	if (n == NULL)
+		return;
+	prefix_trie_free(n->child[0]);
+	prefix_trie_free(n->child[1]);
+	free(n);
+}
@@ -0,0 +1,44 @@
+/*
+ * Copyright (c) 2026 The TCPDUMP project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that: (1) source code
+ * distributions retain the above copyright notice and this paragraph
+ * in its entirety, and (2) distributions including binary code include
+ * the above copyright notice and this paragraph in its entirety in
+ * the documentation or other materials provided with the distribution.
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND
+ * WITHOUT ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, WITHOUT
+ * LIMITATION, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE.
+ */
+
+
+#ifndef prefix_trie_h
+#define prefix_trie_h
+
+/*
+ * A path-compressed binary trie of address prefixes, each with an int
+ * value, for finding the value of the longest prefix an address falls
+ * in.  Nodes are only made where prefixes branch, so a lookup visits at
+ * most one node per prefix on its path.  The addresses are in network
+ * byte order, of any length up to PREFIX_TRIE_MAXBYTES bytes; a trie
+ * should only hold addresses of one length.
+ *
+ * The trie is a pointer to its root, NULL when it's empty.
+ * prefix_trie_add() replaces the value of a prefix that was already
+ * added, and returns -1 if it's out of memory; prefix_trie_lookup()
+ * returns -1 if no prefix matches.
+ */
+#define PREFIX_TRIE_MAXBYTES	16
+
+struct prefix_trie;
+
+extern int prefix_trie_add(struct prefix_trie **, const u_char *, u_int,
+    int);
+extern int prefix_trie_lookup(const struct prefix_trie *, const u_char *,
+    u_int);
+extern void prefix_trie_free(struct prefix_trie *);
+
+#endif /* prefix_trie_h */
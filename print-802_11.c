@@ -28,8 +28,11 @@
 
 #include "netdissect-stdinc.h"
 
+#include <stdlib.h>
 #include <string.h>
 
+#include "netdissect-ctype.h"
+
 #include "netdissect.h"
 #include "addrtoname.h"
 
@@ -3269,6 +3272,198 @@ ieee802_11_radio_print(netdissect_options *ndo,
 #undef BIT
 }
 
+/*
+ * Beacon statistics, for --beacon-stats.
+ *
+ * A BSS sends the same beacon ten times a second, apart from the
+ * timestamp, the sequence number and the TIM, so on a monitor-mode
+ * capture most beacons repeat the last one from their BSSID.  Those
+ * are only counted, along with the signal strength and channel from
+ * the radiotap header, without dissecting them; the rest are printed.
+ */
+#define BSSID_CHAINS	64
+
+struct bssid_entry {
+	struct bssid_stats be_stats;
+	uint64_t be_hash;		/* of the last beacon */
+	struct bssid_entry *be_next;	/* on its hash chain */
+};
+
+static ND_THREAD_LOCAL struct bssid_entry *bssid_chains[BSSID_CHAINS];
+static ND_THREAD_LOCAL struct bssid_entry **bssid_entries;	/* in order seen */
+static ND_THREAD_LOCAL u_int bssid_nentries, bssid_maxentries;
+
+/*
+ * The sizes and alignments of the radiotap fields up to the dBm
+ * antenna signal; they're always in the first presence word, and all
+ * of known size, so their offsets follow from that word alone.
+ */
+static const uint8_t radiotap_size[] = { 8, 1, 1, 4, 2, 1 };
+static const uint8_t radiotap_align[] = { 8, 1, 1, 2, 1, 1 };
+
+static struct bssid_entry *
+bssid_lookup(netdissect_options *ndo, const u_char *bssid)
+{
+	struct bssid_entry *be, **bep;
+	uint32_t h = 2166136261U;
+	u_int i;
+
+	for (i = 0; i < 6; i++)
+		h = (h ^ bssid[i]) * 16777619U;
+	bep = &bssid_chains[h % BSSID_CHAINS];
+	for (be = *bep; be != NULL; be = be->be_next)
+		if (memcmp(be->be_stats.bs_bssid, bssid, 6) == 0)
+			return (be);
+
+	if (bssid_nentries == bssid_maxentries) {
+		bssid_maxentries = bssid_maxentries ? bssid_maxentries * 2 : 32;
+		bssid_entries = (struct bssid_entry **)realloc(bssid_entries,
+		    bssid_maxentries * sizeof(*bssid_entries));
+		if (bssid_entries == NULL)
+			(*ndo->ndo_error)(ndo, S_ERR_ND_MEM_ALLOC,
+			    "%s: realloc", __func__);
+	}
+	be = (struct bssid_entry *)calloc(1, sizeof(*be));
+	if (be == NULL)
+		(*ndo->ndo_error)(ndo, S_ERR_ND_MEM_ALLOC, "%s: calloc",
+		    __func__);
+	memcpy(be->be_stats.bs_bssid, bssid, 6);
+	be->be_next = *bep;
+	*bep = be;
+	bssid_entries[bssid_nentries++] = be;
+	return (be);
+}
+
+/*
+ * Count the frame of "length" bytes, "caplen" of them captured, at "p",
+ * if it's a beacon, with a radiotap header if "radiotap" is set.
+ * Return 1 if it repeats the last beacon from its BSSID, so that it
+ * needn't be printed, and 0 otherwise.
+ */
+int
+ieee802_11_beacon_repeat(netdissect_options *ndo, int radiotap,
+    const u_char *p, u_int length, u_int caplen)
+{
+	const u_char *ep, *ie, *ssid = NULL;
+	u_int hlen, off, bit, fcslen = 0, freq = 0, ssid_len = 0, i, ie_len;
+	u_int field[IEEE80211_RADIOTAP_DBM_ANTSIGNAL + 1];
+	uint32_t present;
+	uint64_t h = 14695981039346656037ULL;
+	struct bssid_entry *be;
+	struct bssid_stats *bs;
+	int signal = 0, have_signal = 0;
+
+	if (radiotap) {
+		if (caplen < 8)
+			return (0);
+		hlen = EXTRACT_LE_U_2(p + 2);
+		if (hlen < 8 || hlen > caplen)
+			return (0);
+		present = EXTRACT_LE_U_4(p + 4);
+		for (off = 4; EXTRACT_LE_U_4(p + off) & (1U << IEEE80211_RADIOTAP_EXT);
+		    off += 4)
+			if (off + 8 > hlen)
+				return (0);
+		off += 4;
+		for (bit = 0; bit <= IEEE80211_RADIOTAP_DBM_ANTSIGNAL; bit++) {
+			field[bit] = 0;
+			if ((present & (1U << bit)) == 0)
+				continue;
+			off = roundup2(off, radiotap_align[bit]);
+			if (off + radiotap_size[bit] > hlen)
+				break;
+			field[bit] = off;
+			off += radiotap_size[bit];
+		}
+		for (; bit <= IEEE80211_RADIOTAP_DBM_ANTSIGNAL; bit++)
+			field[bit] = 0;
+		if (field[IEEE80211_RADIOTAP_FLAGS] != 0 &&
+		    (p[field[IEEE80211_RADIOTAP_FLAGS]] &
+		     IEEE80211_RADIOTAP_F_FCS))
+			fcslen = 4;
+		if (field[IEEE80211_RADIOTAP_CHANNEL] != 0)
+			freq = EXTRACT_LE_U_2(p + field[IEEE80211_RADIOTAP_CHANNEL]);
+		if (field[IEEE80211_RADIOTAP_DBM_ANTSIGNAL] != 0) {
+			signal = EXTRACT_S_1(p +
+			    field[IEEE80211_RADIOTAP_DBM_ANTSIGNAL]);
+			have_signal = 1;
+		}
+		p += hlen;
+		length -= hlen;
+		caplen -= hlen;
+	}
+
+	/* The header, the timestamp, beacon interval and capabilities. */
+	if (caplen < 24 + 12 || length < 24 + 12 + fcslen)
+		return (0);
+	if (FC_TYPE(EXTRACT_LE_U_2(p)) != T_MGMT ||
+	    FC_SUBTYPE(EXTRACT_LE_U_2(p)) != ST_BEACON)
+		return (0);
+	ep = p + (caplen < length - fcslen ? caplen : length - fcslen);
+
+	/*
+	 * Hash the beacon interval, the capabilities and the elements
+	 * other than the TIM, and whatever's left if the last element
+	 * runs past the end.
+	 */
+	for (i = 24 + 8; i < 24 + 12; i++)
+		h = (h ^ p[i]) * 1099511628211ULL;
+	for (ie = p + 24 + 12; ie < ep; ie += 2 + ie_len) {
+		if (ep - ie < 2 || (u_int)(ep - ie) - 2 < (ie_len = ie[1])) {
+			for (; ie < ep; ie++)
+				h = (h ^ *ie) * 1099511628211ULL;
+			break;
+		}
+		if (ie[0] == E_TIM)
+			continue;
+		if (ie[0] == E_SSID && ssid == NULL) {
+			ssid = ie + 2;
+			ssid_len = ie_len;
+		}
+		for (i = 0; i < 2 + ie_len; i++)
+			h = (h ^ ie[i]) * 1099511628211ULL;
+	}
+
+	be = bssid_lookup(ndo, p + 16);
+	bs = &be->be_stats;
+	if (freq != 0)
+		bs->bs_freq = freq;
+	if (have_signal) {
+		if (bs->bs_signals == 0 || signal < bs->bs_signal_min)
+			bs->bs_signal_min = signal;
+		if (bs->bs_signals == 0 || signal > bs->bs_signal_max)
+			bs->bs_signal_max = signal;
+		bs->bs_signal_total += signal;
+		bs->bs_signals++;
+	}
+	if (bs->bs_beacons++ != 0 && be->be_hash == h)
+		return (1);
+	be->be_hash = h;
+	bs->bs_changes++;
+	if (ssid != NULL) {
+		if (ssid_len > sizeof(bs->bs_ssid) - 1)
+			ssid_len = sizeof(bs->bs_ssid) - 1;
+		for (i = 0; i < ssid_len; i++)
+			bs->bs_ssid[i] = ND_ASCII_ISPRINT(ssid[i]) ?
+			    (char)ssid[i] : '.';
+		bs->bs_ssid[i] = '\0';
+	}
+	return (0);
+}
+
+/*
+ * Call "fn" for each BSSID of this thread that beacons have been seen
+ * from, in the order they were first seen.
+ */
+void
+bssid_foreach(bssid_fn fn, void *arg)
+{
+	u_int i;
+
+	for (i = 0; i < bssid_nentries; i++)
+		(*fn)(arg, &bssid_entries[i]->be_stats);
+}
+
 static u_int
 ieee802_11_radio_avs_print(netdissect_options *ndo,
 			   const u_char *p, u_int length, u_int caplen)
@@ -28,6 +28,9 @@
 
 #include "netdissect-stdinc.h"
 
+#include <stdlib.h>
+#include <string.h>
+
 #include "netdissect.h"
 #include "addrtoname.h"
 
@@ -528,6 +531,110 @@ ieee802_15_4_addr_len(uint16_t addr_type)
 	return 0;
 }
 
+/*
+ * Which PAN IDs a frame with the frame control field "fc" and addresses
+ * of the given lengths has, from the PAN ID Compression bit.
+ *
+ * Returns -1 if the bit is set in a frame before version 2 with only
+ * one address, which is invalid, and 0 otherwise.
+ */
+static int
+ieee802_15_4_pan_ids(uint16_t fc, int dst_addr_len, int src_addr_len,
+		     int *dst_panp, int *src_panp)
+{
+	int frame_version, pan_id_comp, src_pan, dst_pan, ret;
+
+	frame_version = FC_FRAME_VERSION(fc);
+	ret = 0;
+	src_pan = 0;
+	dst_pan = 0;
+	pan_id_comp = CHECK_BIT(fc, 6);
+
+	/* The PAN ID Compression rules are complicated. */
+
+	/* First check old versions, where the rules are simple. */
+	if (frame_version < 2) {
+		if (pan_id_comp) {
+			src_pan = 0;
+			dst_pan = 1;
+			if (dst_addr_len <= 0 || src_addr_len <= 0)
+				ret = -1;
+		} else {
+			src_pan = 1;
+			dst_pan = 1;
+		}
+		if (dst_addr_len <= 0) {
+			dst_pan = 0;
+		}
+		if (src_addr_len <= 0) {
+			src_pan = 0;
+		}
+	} else {
+		/* Frame version 2 rules are more complicated, and they depend
+		   on the address modes of the frame, generic rules are same,
+		   but then there are some special cases. */
+		if (pan_id_comp) {
+			src_pan = 0;
+			dst_pan = 1;
+		} else {
+			src_pan = 1;
+			dst_pan = 1;
+		}
+		if (dst_addr_len <= 0) {
+			dst_pan = 0;
+		}
+		if (src_addr_len <= 0) {
+			src_pan = 0;
+		}
+		if (pan_id_comp) {
+			if (src_addr_len == 0 &&
+			    dst_addr_len == 0) {
+				/* Both addresses are missing, but PAN ID
+				   compression set, special case we have
+				   destination PAN but no addresses. */
+				dst_pan = 1;
+			} else if ((src_addr_len == 0 &&
+				    dst_addr_len > 0) ||
+				   (src_addr_len > 0 &&
+				    dst_addr_len == 0)) {
+				/* Only one address present, and PAN ID
+				   compression is set, we do not have PAN id at
+				   all. */
+				dst_pan = 0;
+				src_pan = 0;
+			} else if (src_addr_len == 8 &&
+				   dst_addr_len == 8) {
+				/* Both addresses are Extended, and PAN ID
+				   compression set, we do not have PAN ID at
+				   all. */
+				dst_pan = 0;
+				src_pan = 0;
+			}
+		} else {
+			/* Special cases where PAN ID Compression is not set. */
+			if (src_addr_len == 8 &&
+			    dst_addr_len == 8) {
+				/* Both addresses are Extended, and PAN ID
+				   compression not set, we do have only one PAN
+				   ID (destination). */
+				dst_pan = 1;
+				src_pan = 0;
+			}
+#ifdef BROKEN_6TISCH_PAN_ID_COMPRESSION
+			if (src_addr_len == 8 &&
+			    dst_addr_len == 2) {
+				/* Special case for the broken 6tisch
+				   implementations. */
+				src_pan = 0;
+			}
+#endif /* BROKEN_6TISCH_PAN_ID_COMPRESSION */
+		}
+	}
+	*dst_panp = dst_pan;
+	*src_panp = src_pan;
+	return ret;
+}
+
 /*
  * Print out the ieee 802.15.4 address.
  */
@@ -1794,7 +1901,7 @@ ieee802_15_4_std_frames(netdissect_options *ndo,
 			const u_char *p, u_int caplen,
 			uint16_t fc)
 {
-	int len, frame_version, pan_id_comp;
+	int len, frame_version;
 	int frame_type;
 	int src_pan, dst_pan, src_addr_len, dst_addr_len;
 	int security_level, miclen = 0;
@@ -1806,11 +1913,12 @@ ieee802_15_4_std_frames(netdissect_options *ndo,
 	payload_ie_present = 0;
 
 	crc_check = 0;
+	fcs = 0;
 	/* Assume 2 octet FCS, the FCS length depends on the PHY, and we do not
-	   know about that. */
-	if (caplen < 4) {
+	   know about that.  With -q nothing after the addresses is printed,
+	   so the FCS isn't looked for. */
+	if (caplen < 4 || ndo->ndo_qflag) {
 		/* Cannot have FCS, assume no FCS. */
-		fcs = 0;
 	} else {
 		/* Test for 4 octet FCS. */
 		fcs = GET_LE_U_4(p + caplen - 4);
@@ -1862,7 +1970,7 @@ ieee802_15_4_std_frames(netdissect_options *ndo,
 		seq = GET_U_1(p + 2);
 		p += 3;
 		caplen -= 3;
-		if (ndo->ndo_vflag)
+		if (ndo->ndo_vflag || ndo->ndo_qflag)
 			ND_PRINT("seq %02x ", seq);
 	}
 
@@ -1877,92 +1985,11 @@ ieee802_15_4_std_frames(netdissect_options *ndo,
 		ND_PRINT("[ERROR: Invalid dst address mode]");
 		return 0;
 	}
-	src_pan = 0;
-	dst_pan = 0;
-	pan_id_comp = CHECK_BIT(fc, 6);
-
-	/* The PAN ID Compression rules are complicated. */
-
-	/* First check old versions, where the rules are simple. */
-	if (frame_version < 2) {
-		if (pan_id_comp) {
-			src_pan = 0;
-			dst_pan = 1;
-			if (dst_addr_len <= 0 || src_addr_len <= 0) {
-				/* Invalid frame, PAN ID Compression must be 0
-				   if only one address in the frame. */
-				ND_PRINT("[ERROR: PAN ID Compression != 0, and only one address with frame version < 2]");
-			}
-		} else {
-			src_pan = 1;
-			dst_pan = 1;
-		}
-		if (dst_addr_len <= 0) {
-			dst_pan = 0;
-		}
-		if (src_addr_len <= 0) {
-			src_pan = 0;
-		}
-	} else {
-		/* Frame version 2 rules are more complicated, and they depend
-		   on the address modes of the frame, generic rules are same,
-		   but then there are some special cases. */
-		if (pan_id_comp) {
-			src_pan = 0;
-			dst_pan = 1;
-		} else {
-			src_pan = 1;
-			dst_pan = 1;
-		}
-		if (dst_addr_len <= 0) {
-			dst_pan = 0;
-		}
-		if (src_addr_len <= 0) {
-			src_pan = 0;
-		}
-		if (pan_id_comp) {
-			if (src_addr_len == 0 &&
-			    dst_addr_len == 0) {
-				/* Both addresses are missing, but PAN ID
-				   compression set, special case we have
-				   destination PAN but no addresses. */
-				dst_pan = 1;
-			} else if ((src_addr_len == 0 &&
-				    dst_addr_len > 0) ||
-				   (src_addr_len > 0 &&
-				    dst_addr_len == 0)) {
-				/* Only one address present, and PAN ID
-				   compression is set, we do not have PAN id at
-				   all. */
-				dst_pan = 0;
-				src_pan = 0;
-			} else if (src_addr_len == 8 &&
-				   dst_addr_len == 8) {
-				/* Both addresses are Extended, and PAN ID
-				   compression set, we do not have PAN ID at
-				   all. */
-				dst_pan = 0;
-				src_pan = 0;
-			}
-		} else {
-			/* Special cases where PAN ID Compression is not set. */
-			if (src_addr_len == 8 &&
-			    dst_addr_len == 8) {
-				/* Both addresses are Extended, and PAN ID
-				   compression not set, we do have only one PAN
-				   ID (destination). */
-				dst_pan = 1;
-				src_pan = 0;
-			}
-#ifdef BROKEN_6TISCH_PAN_ID_COMPRESSION
-			if (src_addr_len == 8 &&
-			    dst_addr_len == 2) {
-				/* Special case for the broken 6tisch
-				   implementations. */
-				src_pan = 0;
-			}
-#endif /* BROKEN_6TISCH_PAN_ID_COMPRESSION */
-		}
+	if (ieee802_15_4_pan_ids(fc, dst_addr_len, src_addr_len,
+				 &dst_pan, &src_pan) == -1) {
+		/* Invalid frame, PAN ID Compression must be 0 if only one
+		   address in the frame. */
+		ND_PRINT("[ERROR: PAN ID Compression != 0, and only one address with frame version < 2]");
 	}
 
 	/* Print dst PAN and address. */
@@ -2007,6 +2034,11 @@ ieee802_15_4_std_frames(netdissect_options *ndo,
 	ND_PRINT(" ");
 	p += src_addr_len;
 	caplen -= src_addr_len;
+
+	/* With -q, that's all: no security header, IEs or payload. */
+	if (ndo->ndo_qflag)
+		return 1;
+
 	if (CHECK_BIT(fc, 3)) {
 		/*
 		 * XXX - if frame_version is 0, this is the 2003
@@ -2207,8 +2239,9 @@ ieee802_15_4_mp_frame(netdissect_options *ndo,
 	crc_check = 0;
 
 	/* Assume 2 octet FCS, the FCS length depends on the PHY, and we do not
-	   know about that. */
-	if (caplen < 3) {
+	   know about that.  With -q it isn't looked for, as for the other
+	   frames. */
+	if (caplen < 3 || ndo->ndo_qflag) {
 		/* Cannot have FCS, assume no FCS. */
 		fcs = 0;
 	} else {
@@ -2268,7 +2301,7 @@ ieee802_15_4_mp_frame(netdissect_options *ndo,
 			seq = GET_U_1(p + 2);
 			p += 3;
 			caplen -= 3;
-			if (ndo->ndo_vflag)
+			if (ndo->ndo_vflag || ndo->ndo_qflag)
 				ND_PRINT("seq %02x ", seq);
 		}
 	} else {
@@ -2276,7 +2309,7 @@ ieee802_15_4_mp_frame(netdissect_options *ndo,
 		seq = GET_U_1(p + 1);
 		p += 2;
 		caplen -= 2;
-		if (ndo->ndo_vflag)
+		if (ndo->ndo_vflag || ndo->ndo_qflag)
 			ND_PRINT("seq %02x ", seq);
 	}
 
@@ -2325,6 +2358,9 @@ ieee802_15_4_mp_frame(netdissect_options *ndo,
 	p += src_addr_len;
 	caplen -= src_addr_len;
 
+	if (ndo->ndo_qflag)
+		return 1;
+
 	if (security_enabled) {
 		len = ieee802_15_4_print_aux_sec_header(ndo, p, caplen,
 							&security_level);
@@ -2530,3 +2566,152 @@ ieee802_15_4_tap_if_print(netdissect_options *ndo,
 
 	return ieee802_15_4_print(ndo, p+length, h->caplen-length) + length;
 }
+
+/*
+ * Frame counts, for --wpan-stats.
+ *
+ * Each frame is counted against its source PAN ID and address, found
+ * from the frame control field without dissecting the rest of it;
+ * frames without a source address, such as acknowledgements, and the
+ * multipurpose, fragment and extended frames, whose headers are laid
+ * out differently, are counted against the entry with neither.
+ */
+#define WPAN_CHAINS	256
+
+struct wpan_entry {
+	struct wpan_stats we_stats;
+	struct wpan_entry *we_next;	/* on its hash chain */
+};
+
+static ND_THREAD_LOCAL struct wpan_entry *wpan_chains[WPAN_CHAINS];
+static ND_THREAD_LOCAL struct wpan_entry **wpan_entries;	/* in order seen */
+static ND_THREAD_LOCAL u_int wpan_nentries, wpan_maxentries;
+
+static struct wpan_entry *
+wpan_lookup(netdissect_options *ndo, int has_pan, uint16_t pan,
+	    const u_char *addr, u_int addr_len)
+{
+	struct wpan_entry *we, **wep;
+	struct wpan_stats *ws;
+	uint32_t h = 2166136261U;
+	u_int i;
+
+	h = (h ^ (has_pan ? pan : 0x10000)) * 16777619U;
+	for (i = 0; i < addr_len; i++)
+		h = (h ^ addr[i]) * 16777619U;
+	wep = &wpan_chains[h % WPAN_CHAINS];
+	for (we = *wep; we != NULL; we = we->we_next) {
+		ws = &we->we_stats;
+		if (ws->ws_has_pan == has_pan && ws->ws_pan == pan &&
+		    ws->ws_addr_len == addr_len &&
+		    memcmp(ws->ws_addr, addr, addr_len) == 0)
+			return (we);
+	}
+
+	if (wpan_nentries == wpan_maxentries) {
+		wpan_maxentries = wpan_maxentries ? wpan_maxentries * 2 : 32;
+		wpan_entries = (struct wpan_entry **)realloc(wpan_entries,
+		    wpan_maxentries * sizeof(*wpan_entries));
+		if (wpan_entries == NULL)
+			(*ndo->ndo_error)(ndo, S_ERR_ND_MEM_ALLOC,
+			    "%s: realloc", __func__);
+	}
+	we = (struct wpan_entry *)calloc(1, sizeof(*we));
+	if (we == NULL)
+		(*ndo->ndo_error)(ndo, S_ERR_ND_MEM_ALLOC, "%s: calloc",
+		    __func__);
+	ws = &we->we_stats;
+	ws->ws_has_pan = has_pan;
+	ws->ws_pan = pan;
+	ws->ws_addr_len = addr_len;
+	memcpy(ws->ws_addr, addr, addr_len);
+	we->we_next = *wep;
+	*wep = we;
+	wpan_entries[wpan_nentries++] = we;
+	return (we);
+}
+
+/*
+ * Count the frame of "length" bytes, "caplen" of them captured, at "p",
+ * with a TAP header in front of it if "tap" is set.
+ */
+void
+ieee802_15_4_count(netdissect_options *ndo, int tap, const u_char *p,
+		   u_int length, u_int caplen)
+{
+	struct wpan_stats *ws;
+	u_int off, hlen, frame_type;
+	int dst_addr_len, src_addr_len, dst_pan, src_pan, has_pan;
+	uint16_t fc, pan;
+
+	if (tap) {
+		if (caplen < 4)
+			return;
+		hlen = EXTRACT_LE_U_2(p + 2);
+		if (EXTRACT_U_1(p) != 0 || hlen < 4 || hlen > caplen)
+			return;
+		p += hlen;
+		length -= hlen;
+		caplen -= hlen;
+	}
+	if (caplen < 2)
+		return;
+
+	fc = EXTRACT_LE_U_2(p);
+	frame_type = FC_FRAME_TYPE(fc);
+	has_pan = 0;
+	pan = 0;
+	src_addr_len = 0;
+	off = 0;
+	if (frame_type <= 0x03) {
+		dst_addr_len = ieee802_15_4_addr_len((fc >> 10) & 0x3);
+		src_addr_len = ieee802_15_4_addr_len((fc >> 14) & 0x3);
+		if (dst_addr_len < 0 || src_addr_len < 0) {
+			src_addr_len = 0;
+		} else {
+			(void)ieee802_15_4_pan_ids(fc, dst_addr_len,
+			    src_addr_len, &dst_pan, &src_pan);
+			/* The sequence number, unless it's suppressed. */
+			off = CHECK_BIT(fc, 8) ? 2 : 3;
+			if (dst_pan) {
+				if (caplen >= off + 2) {
+					/* Also the source's, if compressed. */
+					pan = EXTRACT_LE_U_2(p + off);
+					has_pan = 1;
+				}
+				off += 2;
+			}
+			off += dst_addr_len;
+			if (src_pan) {
+				if (caplen >= off + 2) {
+					pan = EXTRACT_LE_U_2(p + off);
+					has_pan = 1;
+				}
+				off += 2;
+			}
+			if (src_addr_len == 0 || caplen < off + src_addr_len)
+				src_addr_len = 0;
+		}
+	}
+	if (src_addr_len == 0) {
+		has_pan = 0;
+		pan = 0;
+	}
+	ws = &wpan_lookup(ndo, has_pan, pan, p + off, src_addr_len)->we_stats;
+	ws->ws_frames++;
+	ws->ws_bytes += length;
+	ws->ws_types[frame_type]++;
+}
+
+/*
+ * Call "fn" for each source of this thread that frames have been seen
+ * from, in the order they were first seen.
+ */
+void
+wpan_foreach(wpan_fn fn, void *arg)
+{
+	u_int i;
+
+	for (i = 0; i < wpan_nentries; i++)
+		(*fn)(arg, &wpan_entries[i]->we_stats);
+}
@@ -100,14 +100,14 @@ static int
 ahcp_time_print(netdissect_options *ndo, const u_char *cp, const u_char *ep)
 {
 	time_t t;
-	struct tm *tm;
+	struct tm tmbuf, *tm;
 	char buf[BUFSIZE];
 
 	if (cp + 4 != ep)
 		goto invalid;
 	ND_TCHECK_4(cp);
 	t = GET_BE_U_4(cp);
-	if (NULL == (tm = gmtime(&t)))
+	if (NULL == (tm = nd_gmtime(&t, &tmbuf)))
 		ND_PRINT(": gmtime() error");
 	else if (0 == strftime(buf, sizeof(buf), "%Y-%m-%d %H:%M:%S", tm))
 		ND_PRINT(": strftime() error");
@@ -37,9 +37,15 @@
 
 #include "netdissect-stdinc.h"
 
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+
 #include "netdissect.h"
 #include "extract.h"
 #include "addrtoname.h"
+#include "callcache.h"
+#include "latency.h"
 
 
 #define AOE_V1 1
@@ -345,6 +351,101 @@ trunc:
 }
 
 /* cp points to the Ver/Flags octet */
+/*
+ * For --latency-report, a command is matched to its response by its tag,
+ * which the initiator picks, and the target's major and minor address
+ * and the command; the Ethernet addresses aren't passed to aoe_print(),
+ * so two initiators with a tag in common for the same target can be
+ * confused, which the tags, usually a counter or a time, make unlikely.
+ */
+#define AOE_CALL_TIMEOUT	60	/* seconds */
+
+struct aoe_call_key {
+	uint32_t tag;
+	uint16_t major;
+	uint8_t minor;
+	uint8_t command;
+};
+
+struct aoe_call_entry {
+	struct callcache_entry ce;
+	struct aoe_call_key key;
+	uint8_t ata_cmd;	/* of an ATA command */
+	uint8_t aflags;
+	uint8_t answered;	/* its first response has been counted */
+};
+
+static const struct callcache_type aoe_call_type = {
+	sizeof(struct aoe_call_entry),
+	offsetof(struct aoe_call_entry, key),
+	sizeof(struct aoe_call_key),
+	AOE_CALL_TIMEOUT
+};
+
+/*
+ * Count the time from a command to its first response; "cp" is at the
+ * Error field of the "len" bytes from there on.
+ */
+static void
+aoev1_latency(netdissect_options *ndo, const u_char *cp, u_int len,
+              uint8_t flags)
+{
+	struct aoe_call_entry *ace;
+	struct aoe_call_key key;
+	char what[LATENCY_WHAT_LEN];
+
+	if (len < AOEV1_COMMON_HDR_LEN - 1 || !ND_TTEST_LEN(cp, 9))
+		return;
+	memset(&key, 0, sizeof(key));
+	key.major = GET_BE_U_2(cp + 1);
+	key.minor = GET_U_1(cp + 3);
+	key.command = GET_U_1(cp + 4);
+	key.tag = GET_BE_U_4(cp + 5);
+	if (!(flags & AOEV1_FLAG_R)) {
+		ace = (struct aoe_call_entry *)callcache_enter(ndo,
+		    &aoe_call_type, &key);
+		if (ace == NULL)
+			return;
+		ace->answered = 0;
+		ace->ata_cmd = 0;
+		ace->aflags = 0;
+		if (key.command == AOEV1_CMD_ISSUE_ATA_COMMAND &&
+		    len >= 9 + AOEV1_ISSUE_ARG_LEN && ND_TTEST_LEN(cp + 9, 4)) {
+			ace->aflags = GET_U_1(cp + 9);
+			ace->ata_cmd = GET_U_1(cp + 12);
+		}
+		return;
+	}
+	ace = (struct aoe_call_entry *)callcache_find(ndo, &aoe_call_type,
+	    &key);
+	if (ace == NULL || ace->answered)
+		return;
+	ace->answered = 1;
+	if (key.command != AOEV1_CMD_ISSUE_ATA_COMMAND)
+		snprintf(what, sizeof(what), "%s",
+		    tok2str(cmdcode_str, "command 0x%02x", key.command));
+	else {
+		switch (ace->ata_cmd) {
+
+		case 0x20:	/* READ SECTORS */
+		case 0x24:	/* READ SECTORS EXT */
+		case 0x25:	/* READ DMA EXT */
+		case 0x30:	/* WRITE SECTORS */
+		case 0x34:	/* WRITE SECTORS EXT */
+		case 0x35:	/* WRITE DMA EXT */
+			snprintf(what, sizeof(what), "ATA %s",
+			    ace->aflags & AOEV1_AFLAG_W ? "write" : "read");
+			break;
+
+		default:
+			snprintf(what, sizeof(what), "ATA 0x%02x",
+			    ace->ata_cmd);
+			break;
+		}
+	}
+	latency_record(ndo, "aoe", what, ace->ce.cce_ts);
+}
+
 static void
 aoev1_print(netdissect_options *ndo,
             const u_char *cp, const u_int len)
@@ -359,6 +460,8 @@ aoev1_print(netdissect_options *ndo,
 	flags = GET_U_1(cp) & 0x0F;
 	ND_PRINT(", Flags: [%s]", bittok2str(aoev1_flag_str, "none", flags));
 	cp += 1;
+	if (ndo->ndo_latency)
+		aoev1_latency(ndo, cp, len - 1, flags);
 	if (! ndo->ndo_vflag)
 		return;
 	/* Error */
@@ -13,6 +13,7 @@
 #include "netdissect.h"
 #include "extract.h"
 #include "addrtoname.h"
+#include "ethertype.h"
 
 #define ARISTA_SUBTYPE_TIMESTAMP 0x01
 
@@ -34,11 +35,11 @@ arista_print_date_hms_time(netdissect_options *ndo, uint32_t seconds,
 		uint32_t nanoseconds)
 {
 	time_t ts;
-	struct tm *tm;
+	struct tm tmbuf, *tm;
 	char buf[BUFSIZE];
 
 	ts = seconds + (nanoseconds / 1000000000);
-	if (NULL == (tm = gmtime(&ts)))
+	if (NULL == (tm = nd_gmtime(&ts, &tmbuf)))
 		ND_PRINT(": gmtime() error");
 	else if (0 == strftime(buf, sizeof(buf), "%Y-%m-%d %H:%M:%S", tm))
 		ND_PRINT(": strftime() error");
@@ -92,3 +93,63 @@ arista_ethertype_print(netdissect_options *ndo, const u_char *bp, u_int len _U_)
 	}
 	return bytesConsumed;
 }
+
+/*
+ * The trailer a Metamako (now Arista) MetaWatch device appends to the
+ * frame it stamps: the time stamp, then flags, a device ID and a port.
+ */
+#define METAMAKO_TRAILER_LEN	12
+
+/*
+ * Get the hardware time stamp of the Ethernet frame "p", with "caplen"
+ * octets of its "length" captured, for --hw-time-stamp: from the Arista
+ * header after the source address, or, if "trailer" is set, from a
+ * Metamako trailer at the end of a frame captured without its FCS.  A
+ * 48-bit time stamp only has the low 16 bits of the seconds, so the rest
+ * are those of the seconds nearest "ref".  TAI time stamps aren't moved
+ * to UTC.  Returns 1, with the time stamp in "*secs" and "*nsecs", if
+ * there is one, 0 otherwise.
+ */
+int
+arista_hw_tstamp(const u_char *p, u_int caplen, u_int length, int trailer,
+		 time_t ref, time_t *secs, uint32_t *nsecs)
+{
+	uint32_t s;
+
+	if (trailer) {
+		if (caplen != length ||
+		    caplen < 2 * MAC_ADDR_LEN + 2 + METAMAKO_TRAILER_LEN)
+			return 0;
+		p += caplen - METAMAKO_TRAILER_LEN;
+		*secs = (time_t)EXTRACT_BE_U_4(p);
+		*nsecs = EXTRACT_BE_U_4(p + 4);
+		return *nsecs < 1000000000;
+	}
+	if (caplen < 2 * MAC_ADDR_LEN + 2 + 4 + 6 ||
+	    EXTRACT_BE_U_2(p + 2 * MAC_ADDR_LEN) != ETHERTYPE_ARISTA ||
+	    EXTRACT_BE_U_2(p + 2 * MAC_ADDR_LEN + 2) != ARISTA_SUBTYPE_TIMESTAMP)
+		return 0;
+	p += 2 * MAC_ADDR_LEN + 2 + 2;
+	switch (EXTRACT_BE_U_2(p)) {
+	case ARISTA_TIMESTAMP_64_TAI:
+	case ARISTA_TIMESTAMP_64_UTC:
+		if (caplen < 2 * MAC_ADDR_LEN + 2 + 4 + 8)
+			return 0;
+		*secs = (time_t)EXTRACT_BE_U_4(p + 2);
+		*nsecs = EXTRACT_BE_U_4(p + 6);
+		break;
+	case ARISTA_TIMESTAMP_48_TAI:
+	case ARISTA_TIMESTAMP_48_UTC:
+		s = EXTRACT_BE_U_2(p + 2);
+		*secs = (ref & ~(time_t)0xffff) | (time_t)s;
+		if (*secs > ref + 0x8000)
+			*secs -= 0x10000;
+		else if (*secs + 0x8000 < ref)
+			*secs += 0x10000;
+		*nsecs = EXTRACT_BE_U_4(p + 4);
+		break;
+	default:
+		return 0;
+	}
+	return *nsecs < 1000000000;
+}
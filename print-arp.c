@@ -33,6 +33,7 @@
 #include "addrtoname.h"
 #include "ethertype.h"
 #include "extract.h"
+#include "arp-watch.h"
 
 
 /*
@@ -392,6 +393,17 @@ arp_print(netdissect_options *ndo,
 		return;
 	}
 
+	/*
+	 * With --arp-watch, a request or reply binds its sender's
+	 * address, unless it's a probe, from 0.0.0.0.
+	 */
+	if (ndo->ndo_arp_watch && (op == ARPOP_REQUEST || op == ARPOP_REPLY) &&
+	    linkaddr == LINKADDR_ETHER && pro == ETHERTYPE_IP &&
+	    PROTO_LEN(ap) == 4 && HRD_LEN(ap) == MAC_ADDR_LEN &&
+	    isnonzero(ndo, SPA(ap), 4) &&
+	    arp_watch(ndo, AF_INET, SPA(ap), SHA(ap)))
+		return;
+
         if (!ndo->ndo_eflag) {
             ND_PRINT("ARP, ");
         }
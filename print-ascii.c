@@ -45,6 +45,7 @@
 #include "netdissect-stdinc.h"
 
 #include <stdio.h>
+#include <string.h>
 
 #include "netdissect-ctype.h"
 
@@ -60,20 +61,54 @@
 
 static void hex_and_ascii_print_with_offset(netdissect_options *, const char *, const u_char *, u_int, u_int);
 
+/*
+ * The printers below build each line (or, for ascii_print(), each
+ * chunk of output) in a local buffer and print it with one ND_PRINT()
+ * rather than formatting every byte with its own call.  They clamp
+ * the length to what was captured first, so the bytes can then be
+ * read directly.
+ */
+static const char hexdigits[16] = "0123456789abcdef";
+
+#define ASCII_CHUNK 256
+
+/*
+ * Put "v" in hex, zero-padded to at least 4 digits, at "p"; return a
+ * pointer past the last digit.
+ */
+static char *
+hex_offset_format(char *p, u_int v)
+{
+	char digits[8];
+	u_int n = 0;
+
+	do {
+		digits[n++] = hexdigits[v & 0xf];
+		v >>= 4;
+	} while (v != 0);
+	while (n < 4)
+		digits[n++] = '0';
+	while (n != 0)
+		*p++ = digits[--n];
+	return (p);
+}
+
 void
 ascii_print(netdissect_options *ndo,
             const u_char *cp, u_int length)
 {
 	u_int caplength;
 	u_char s;
+	char buf[ASCII_CHUNK + 1], *bp;
 
 	ndo->ndo_protocol = "ascii";
 	caplength = (ndo->ndo_snapend > cp) ? ND_BYTES_AVAILABLE_AFTER(cp) : 0;
 	if (length > caplength)
 		length = caplength;
 	ND_PRINT("\n");
+	bp = buf;
 	while (length > 0) {
-		s = GET_U_1(cp);
+		s = *cp;
 		cp++;
 		length--;
 		if (s == '\r') {
@@ -86,15 +121,24 @@ ascii_print(netdissect_options *ndo,
 			 *
 			 * In the middle of a line, just print a '.'.
 			 */
-			if (length > 1 && GET_U_1(cp) != '\n')
-				ND_PRINT(".");
+			if (length > 1 && *cp != '\n')
+				*bp++ = '.';
 		} else {
 			if (!ND_ASCII_ISGRAPH(s) &&
 			    (s != '\t' && s != ' ' && s != '\n'))
-				ND_PRINT(".");
+				*bp++ = '.';
 			else
-				ND_PRINT("%c", s);
+				*bp++ = (char)s;
 		}
+		if (bp == buf + ASCII_CHUNK) {
+			*bp = '\0';
+			ND_PRINT("%s", buf);
+			bp = buf;
+		}
+	}
+	if (bp != buf) {
+		*bp = '\0';
+		ND_PRINT("%s", buf);
 	}
 }
 
@@ -103,53 +147,41 @@ hex_and_ascii_print_with_offset(netdissect_options *ndo, const char *ident,
     const u_char *cp, u_int length, u_int oset)
 {
 	u_int caplength;
-	u_int i;
-	u_int s1, s2;
-	u_int nshorts;
-	char hexstuff[HEXDUMP_SHORTS_PER_LINE*HEXDUMP_HEXSTUFF_PER_SHORT+1], *hsp;
-	char asciistuff[ASCII_LINELENGTH+1], *asp;
+	u_int i, n;
+	u_int s;
+	/* "0xOOOOOOOO: " + hex + "  " + ASCII */
+	char line[12 + HEXDUMP_HEXSTUFF_PER_LINE + 2 + HEXDUMP_BYTES_PER_LINE + 1];
+	char *lp, *hexend, *asp;
 
 	caplength = (ndo->ndo_snapend > cp) ? ND_BYTES_AVAILABLE_AFTER(cp) : 0;
 	if (length > caplength)
 		length = caplength;
-	nshorts = length / sizeof(u_short);
-	i = 0;
-	hsp = hexstuff; asp = asciistuff;
-	while (nshorts != 0) {
-		s1 = GET_U_1(cp);
-		cp++;
-		s2 = GET_U_1(cp);
-		cp++;
-		(void)snprintf(hsp, sizeof(hexstuff) - (hsp - hexstuff),
-		    " %02x%02x", s1, s2);
-		hsp += HEXDUMP_HEXSTUFF_PER_SHORT;
-		*(asp++) = (char)(ND_ASCII_ISGRAPH(s1) ? s1 : '.');
-		*(asp++) = (char)(ND_ASCII_ISGRAPH(s2) ? s2 : '.');
-		i++;
-		if (i >= HEXDUMP_SHORTS_PER_LINE) {
-			*hsp = *asp = '\0';
-			ND_PRINT("%s0x%04x: %-*s  %s",
-			    ident, oset, HEXDUMP_HEXSTUFF_PER_LINE,
-			    hexstuff, asciistuff);
-			i = 0; hsp = hexstuff; asp = asciistuff;
-			oset += HEXDUMP_BYTES_PER_LINE;
+	while (length != 0) {
+		n = length < HEXDUMP_BYTES_PER_LINE ?
+		    length : HEXDUMP_BYTES_PER_LINE;
+		lp = line;
+		*lp++ = '0';
+		*lp++ = 'x';
+		lp = hex_offset_format(lp, oset);
+		*lp++ = ':';
+		*lp++ = ' ';
+		hexend = lp + HEXDUMP_HEXSTUFF_PER_LINE;
+		asp = hexend + 2;
+		for (i = 0; i < n; i++) {
+			s = cp[i];
+			if ((i & 1) == 0)
+				*lp++ = ' ';
+			*lp++ = hexdigits[s >> 4];
+			*lp++ = hexdigits[s & 0xf];
+			*asp++ = (char)(ND_ASCII_ISGRAPH(s) ? s : '.');
 		}
-		nshorts--;
-	}
-	if (length & 1) {
-		s1 = GET_U_1(cp);
-		cp++;
-		(void)snprintf(hsp, sizeof(hexstuff) - (hsp - hexstuff),
-		    " %02x", s1);
-		hsp += 3;
-		*(asp++) = (char)(ND_ASCII_ISGRAPH(s1) ? s1 : '.');
-		++i;
-	}
-	if (i > 0) {
-		*hsp = *asp = '\0';
-		ND_PRINT("%s0x%04x: %-*s  %s",
-		     ident, oset, HEXDUMP_HEXSTUFF_PER_LINE,
-		     hexstuff, asciistuff);
+		/* Pad the hex to its full width, as "%-*s" did. */
+		memset(lp, ' ', hexend + 2 - lp);
+		*asp = '\0';
+		ND_PRINT("%s%s", ident, line);
+		cp += n;
+		length -= n;
+		oset += HEXDUMP_BYTES_PER_LINE;
 	}
 }
 
@@ -169,29 +201,36 @@ hex_print_with_offset(netdissect_options *ndo,
 		      u_int oset)
 {
 	u_int caplength;
-	u_int i, s;
-	u_int nshorts;
+	u_int i, n;
+	u_int s;
+	/* "0xOOOOOOOO: " + hex */
+	char line[12 + HEXDUMP_HEXSTUFF_PER_LINE + 1];
+	char *lp;
 
 	caplength = (ndo->ndo_snapend > cp) ? ND_BYTES_AVAILABLE_AFTER(cp) : 0;
 	if (length > caplength)
 		length = caplength;
-	nshorts = length / sizeof(u_short);
-	i = 0;
-	while (nshorts != 0) {
-		if ((i++ % 8) == 0) {
-			ND_PRINT("%s0x%04x: ", ident, oset);
-			oset += HEXDUMP_BYTES_PER_LINE;
+	while (length != 0) {
+		n = length < HEXDUMP_BYTES_PER_LINE ?
+		    length : HEXDUMP_BYTES_PER_LINE;
+		lp = line;
+		*lp++ = '0';
+		*lp++ = 'x';
+		lp = hex_offset_format(lp, oset);
+		*lp++ = ':';
+		*lp++ = ' ';
+		for (i = 0; i < n; i++) {
+			s = cp[i];
+			if ((i & 1) == 0)
+				*lp++ = ' ';
+			*lp++ = hexdigits[s >> 4];
+			*lp++ = hexdigits[s & 0xf];
 		}
-		s = GET_U_1(cp);
-		cp++;
-		ND_PRINT(" %02x%02x", s, GET_U_1(cp));
-		cp++;
-		nshorts--;
-	}
-	if (length & 1) {
-		if ((i % 8) == 0)
-			ND_PRINT("%s0x%04x: ", ident, oset);
-		ND_PRINT(" %02x", GET_U_1(cp));
+		*lp = '\0';
+		ND_PRINT("%s%s", ident, line);
+		cp += n;
+		length -= n;
+		oset += HEXDUMP_BYTES_PER_LINE;
 	}
 }
 
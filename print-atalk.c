@@ -28,10 +28,12 @@
 #include "netdissect-stdinc.h"
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
 #include "netdissect.h"
 #include "addrtoname.h"
+#include "name-table.h"
 #include "ethertype.h"
 #include "extract.h"
 #include "appletalk.h"
@@ -573,24 +575,53 @@ nbp_name_print(netdissect_options *ndo,
 }
 
 
-#define HASHNAMESIZE 4096
-
 struct hnamemem {
+	struct nametable_node node;
 	u_int addr;
 	char *name;
-	struct hnamemem *nxt;
 };
 
-static struct hnamemem hnametable[HASHNAMESIZE];
+static ND_THREAD_LOCAL struct nametable hnametable;
+
+static struct hnamemem *
+lookup_hmem(u_int addr)
+{
+	struct nametable_node *np;
+
+	for (np = nametable_first(&hnametable, addr); np != NULL;
+	     np = np->nt_nxt)
+		if (((struct hnamemem *)np)->addr == addr)
+			return ((struct hnamemem *)np);
+	return (NULL);
+}
+
+/* Give "addr" the name "name", and return the copy kept in the table. */
+static const char *
+add_hmem(netdissect_options *ndo, u_int addr, const char *name)
+{
+	struct hnamemem *tp;
+
+	tp = (struct hnamemem *)malloc(sizeof(*tp));
+	if (tp == NULL)
+		(*ndo->ndo_error)(ndo, S_ERR_ND_MEM_ALLOC,
+				  "ataddr_string: malloc");
+	tp->addr = addr;
+	tp->name = strdup(name);
+	if (tp->name == NULL)
+		(*ndo->ndo_error)(ndo, S_ERR_ND_MEM_ALLOC,
+				  "ataddr_string: strdup(nambuf)");
+	nametable_insert(ndo, &hnametable, &tp->node, addr);
+	return (tp->name);
+}
 
 static const char *
 ataddr_string(netdissect_options *ndo,
               u_short atnet, u_char athost)
 {
-	struct hnamemem *tp, *tp2;
+	struct hnamemem *tp;
 	u_int i = (atnet << 8) | athost;
 	char nambuf[256+1];
-	static int first = 1;
+	static ND_THREAD_LOCAL int first = 1;
 	FILE *fp;
 
 	/*
@@ -626,16 +657,7 @@ ataddr_string(netdissect_options *ndo,
 					else
 						continue;
 
-					for (tp = &hnametable[i2 & (HASHNAMESIZE-1)];
-					     tp->nxt; tp = tp->nxt)
-						;
-					tp->addr = i2;
-					tp->nxt = newhnamemem(ndo);
-					tp->name = strdup(nambuf);
-					if (tp->name == NULL)
-						(*ndo->ndo_error)(ndo,
-						    S_ERR_ND_MEM_ALLOC,
-						    "ataddr_string: strdup(nambuf)");
+					add_hmem(ndo, i2, nambuf);
 				}
 				fclose(fp);
 			}
@@ -645,37 +667,23 @@ ataddr_string(netdissect_options *ndo,
 	/*
 	 * Now try to look up the address in the table.
 	 */
-	for (tp = &hnametable[i & (HASHNAMESIZE-1)]; tp->nxt; tp = tp->nxt)
-		if (tp->addr == i)
-			return (tp->name);
+	tp = lookup_hmem(i);
+	if (tp != NULL)
+		return (tp->name);
 
 	/* didn't have the node name -- see if we've got the net name */
-	i |= 255;
-	for (tp2 = &hnametable[i & (HASHNAMESIZE-1)]; tp2->nxt; tp2 = tp2->nxt)
-		if (tp2->addr == i) {
-			tp->addr = (atnet << 8) | athost;
-			tp->nxt = newhnamemem(ndo);
-			(void)snprintf(nambuf, sizeof(nambuf), "%s.%u",
-			    tp2->name, athost);
-			tp->name = strdup(nambuf);
-			if (tp->name == NULL)
-				(*ndo->ndo_error)(ndo, S_ERR_ND_MEM_ALLOC,
-					"ataddr_string: strdup(nambuf)");
-			return (tp->name);
-		}
+	tp = lookup_hmem(i | 255);
+	if (tp != NULL) {
+		(void)snprintf(nambuf, sizeof(nambuf), "%s.%u",
+		    tp->name, athost);
+		return (add_hmem(ndo, i, nambuf));
+	}
 
-	tp->addr = (atnet << 8) | athost;
-	tp->nxt = newhnamemem(ndo);
 	if (athost != 255)
 		(void)snprintf(nambuf, sizeof(nambuf), "%u.%u", atnet, athost);
 	else
 		(void)snprintf(nambuf, sizeof(nambuf), "%u", atnet);
-	tp->name = strdup(nambuf);
-	if (tp->name == NULL)
-		(*ndo->ndo_error)(ndo, S_ERR_ND_MEM_ALLOC,
-				  "ataddr_string: strdup(nambuf)");
-
-	return (tp->name);
+	return (add_hmem(ndo, i, nambuf));
 }
 
 static const struct tok skt2str[] = {
@@ -690,7 +698,7 @@ static const char *
 ddpskt_string(netdissect_options *ndo,
               u_int skt)
 {
-	static char buf[8];
+	static ND_THREAD_LOCAL char buf[8];
 
 	if (ndo->ndo_nflag) {
 		(void)snprintf(buf, sizeof(buf), "%u", skt);
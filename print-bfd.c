@@ -26,9 +26,17 @@
 
 #include "netdissect-stdinc.h"
 
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
 #include "netdissect.h"
+#include "addrtostr.h"
 #include "extract.h"
+#include "latency.h"
 
+#include "ip.h"
+#include "ip6.h"
 #include "udp.h"
 
 /*
@@ -294,9 +302,232 @@ trunc:
         return 1;
 }
 
+/*
+ * The --bfd-sessions table: for each system sending BFDv1 control
+ * packets, by its address and My Discriminator, the state and timers
+ * it last sent, and when.  A control packet is printed only if it
+ * changes the state, the timers or the detection multiplier, or if it
+ * comes later than the transmit interval the two systems have agreed
+ * on, or earlier than the jitter RFC 5880 section 6.8.7 allows; the
+ * agreed interval is the larger of the sender's Desired Min TX Interval
+ * and the Required Min RX Interval the other system last sent it.
+ */
+#define BFD_CHAINS	4096
+
+struct bfd_session_key {
+	int af;
+	u_char addr[16];
+	uint32_t discr;
+};
+
+struct bfd_session {
+	struct bfd_session_stats stats;
+	struct bfd_session_key key;
+	uint32_t tx, rx;		/* intervals sent, microseconds */
+	u_int mult;
+	u_int state;
+	nd_ts_t last_ts;		/* of the last packet */
+	char name[INET6_ADDRSTRLEN + sizeof(" 0x00000000")];
+	struct bfd_session *next;	/* on its hash chain */
+};
+
+static ND_THREAD_LOCAL struct bfd_session *bfd_session_chains[BFD_CHAINS];
+static ND_THREAD_LOCAL struct bfd_session **bfd_sessions; /* in order seen */
+static ND_THREAD_LOCAL u_int bfd_nsessions, bfd_maxsessions;
+
+static struct bfd_session *
+bfd_session_find(netdissect_options *ndo, const struct bfd_session_key *k,
+                 int create)
+{
+	struct bfd_session *bs, **bsp;
+	const u_char *cp = (const u_char *)k;
+	char buf[INET6_ADDRSTRLEN];
+	uint32_t h = 2166136261U;
+	size_t i;
+
+	for (i = 0; i < sizeof(*k); i++)
+		h = (h ^ cp[i]) * 16777619U;
+	bsp = &bfd_session_chains[h % BFD_CHAINS];
+	for (bs = *bsp; bs != NULL; bs = bs->next)
+		if (memcmp(&bs->key, k, sizeof(*k)) == 0)
+			return bs;
+	if (!create)
+		return NULL;
+
+	if (bfd_nsessions == bfd_maxsessions) {
+		bfd_maxsessions = bfd_maxsessions ? bfd_maxsessions * 2 : 64;
+		bfd_sessions = (struct bfd_session **)realloc(bfd_sessions,
+		    bfd_maxsessions * sizeof(*bfd_sessions));
+		if (bfd_sessions == NULL)
+			(*ndo->ndo_error)(ndo, S_ERR_ND_MEM_ALLOC,
+			    "%s: realloc", __func__);
+	}
+	bs = (struct bfd_session *)calloc(1, sizeof(*bs));
+	if (bs == NULL)
+		(*ndo->ndo_error)(ndo, S_ERR_ND_MEM_ALLOC, "%s: calloc",
+		    __func__);
+	bs->key = *k;
+	if (k->af == 4)
+		addrtostr(k->addr, buf, sizeof(buf));
+	else
+		addrtostr6(k->addr, buf, sizeof(buf));
+	snprintf(bs->name, sizeof(bs->name), "%s 0x%08x", buf, k->discr);
+	bs->stats.bss_name = bs->name;
+	bs->next = *bsp;
+	*bsp = bs;
+	bfd_sessions[bfd_nsessions++] = bs;
+	return bs;
+}
+
+static void
+bfd_ms_print(netdissect_options *ndo, uint64_t us)
+{
+	ND_PRINT("%" PRIu64 ".%03u ms", us / 1000, (u_int)(us % 1000));
+}
+
+/*
+ * Update the session of the sender of the control packet "bfd" in the
+ * datagram "iph", printing what changed, or what was wrong with when
+ * it came; if nothing was, the packet isn't shown.
+ */
+static void
+bfd_session_update(netdissect_options *ndo,
+                   const struct bfd_header_t *bfd, const u_char *iph)
+{
+	const struct ip *ip = (const struct ip *)iph;
+	const struct ip6_hdr *ip6 = (const struct ip6_hdr *)iph;
+	struct bfd_session_key k, pk;
+	struct bfd_session *bs;
+	const struct bfd_session *peer;
+	uint32_t tx, rx, interval;
+	uint64_t gap, dev;
+	u_int state, mult, flags, diag;
+	int changed = 0, timed;
+
+	memset(&k, 0, sizeof(k));
+	memset(&pk, 0, sizeof(pk));
+	if (iph == NULL)
+		return;
+	switch (IP_V(ip)) {
+	case 4:
+		k.af = pk.af = 4;
+		GET_CPY_BYTES(k.addr, ip->ip_src, sizeof(nd_ipv4));
+		GET_CPY_BYTES(pk.addr, ip->ip_dst, sizeof(nd_ipv4));
+		break;
+	case 6:
+		k.af = pk.af = 6;
+		GET_CPY_BYTES(k.addr, ip6->ip6_src, sizeof(nd_ipv6));
+		GET_CPY_BYTES(pk.addr, ip6->ip6_dst, sizeof(nd_ipv6));
+		break;
+	default:
+		return;
+	}
+	k.discr = GET_BE_U_4(bfd->my_discriminator);
+	pk.discr = GET_BE_U_4(bfd->your_discriminator);
+	if (k.discr == 0)		/* not allowed; nothing to key it by */
+		return;
+	flags = GET_U_1(bfd->flags);
+	state = (flags & 0xc0) >> 6;
+	diag = BFD_EXTRACT_DIAG(GET_U_1(bfd->version_diag));
+	mult = GET_U_1(bfd->detect_time_multiplier);
+	tx = GET_BE_U_4(bfd->desired_min_tx_interval);
+	rx = GET_BE_U_4(bfd->required_min_rx_interval);
+
+	bs = bfd_session_find(ndo, &k, 1);
+	bs->stats.bss_packets++;
+	if (bs->stats.bss_packets == 1) {
+		ND_PRINT("\n\t  %s: new, state %s", bs->name,
+		    tok2str(bfd_v1_state_values, "unknown (%u)", state));
+		changed = 1;
+	} else if (state != bs->state) {
+		ND_PRINT("\n\t  %s: %s -> %s", bs->name,
+		    tok2str(bfd_v1_state_values, "unknown (%u)", bs->state),
+		    tok2str(bfd_v1_state_values, "unknown (%u)", state));
+		if (diag != 0)
+			ND_PRINT(", %s",
+			    tok2str(bfd_diag_values, "diagnostic %u", diag));
+		bs->stats.bss_transitions++;
+		changed = 1;
+	}
+	if (bs->stats.bss_packets == 1 || tx != bs->tx || rx != bs->rx ||
+	    mult != bs->mult) {
+		ND_PRINT("\n\t  %s: tx ", bs->name);
+		bfd_ms_print(ndo, tx);
+		ND_PRINT(", rx ");
+		bfd_ms_print(ndo, rx);
+		ND_PRINT(", multiplier %u", mult);
+		/* The agreed interval changes too; don't time this one. */
+		timed = 0;
+		changed = 1;
+	} else
+		timed = 1;
+
+	/*
+	 * Only time a packet that follows another one sent while Up;
+	 * until then the interval is at least a second, and a Final
+	 * packet is sent at once in reply to a Poll.
+	 */
+	peer = pk.discr != 0 ? bfd_session_find(ndo, &pk, 0) : NULL;
+	interval = tx;
+	if (peer != NULL && peer->rx > interval)
+		interval = peer->rx;
+	if (timed && state == 3 && bs->state == 3 &&
+	    !(flags & 0x10) && interval != 0) {
+		gap = latency_elapsed(ndo, bs->last_ts);
+		dev = gap > interval ? gap - interval : interval - gap;
+		bs->stats.bss_gaps++;
+		bs->stats.bss_dev_total += dev;
+		if (gap > bs->stats.bss_max_gap)
+			bs->stats.bss_max_gap = gap;
+		if (gap > interval) {
+			ND_PRINT("\n\t  %s: ", bs->name);
+			bfd_ms_print(ndo, gap);
+			ND_PRINT(" since the last packet, over the ");
+			bfd_ms_print(ndo, interval);
+			ND_PRINT(" interval");
+			bs->stats.bss_late++;
+			if (gap > (uint64_t)interval * mult) {
+				ND_PRINT(" and the ");
+				bfd_ms_print(ndo, (uint64_t)interval * mult);
+				ND_PRINT(" detection time");
+				bs->stats.bss_detect++;
+			}
+			changed = 1;
+		} else if (gap * 100 < (uint64_t)interval * 75) {
+			/* Jitter takes at most 25% off the interval. */
+			ND_PRINT("\n\t  %s: ", bs->name);
+			bfd_ms_print(ndo, gap);
+			ND_PRINT(" since the last packet, under 75%% of the ");
+			bfd_ms_print(ndo, interval);
+			ND_PRINT(" interval");
+			bs->stats.bss_early++;
+			changed = 1;
+		}
+	}
+	bs->state = state;
+	/* The state is two bits, all of which have names. */
+	bs->stats.bss_state = tok2str(bfd_v1_state_values, "unknown", state);
+	bs->stats.bss_interval = interval;
+	bs->tx = tx;
+	bs->rx = rx;
+	bs->mult = mult;
+	bs->last_ts = ndo->ndo_packet_ts;
+	if (!changed)
+		ndo->ndo_drop_line = 1;
+}
+
+void
+bfd_session_foreach(bfd_session_fn fn, void *arg)
+{
+	u_int i;
+
+	for (i = 0; i < bfd_nsessions; i++)
+		(*fn)(arg, &bfd_sessions[i]->stats);
+}
+
 void
 bfd_print(netdissect_options *ndo, const u_char *pptr,
-          u_int len, u_int port)
+          u_int len, u_int port, const u_char *iph)
 {
 	ndo->ndo_protocol = "bfd";
         if (port == BFD_CONTROL_PORT ||
@@ -366,7 +597,7 @@ bfd_print(netdissect_options *ndo, const u_char *pptr,
                            tok2str(bfd_v1_state_values, "unknown (%u)", (flags & 0xc0) >> 6),
                            bittok2str(bfd_v1_flag_values, "none", flags & 0x3f),
                            len);
-                    return;
+                    break;
                 }
 
                 ND_PRINT("BFDv1, length: %u\n\t%s, State %s, Flags: [%s], Diagnostic: %s (0x%02x)",
@@ -410,10 +641,17 @@ bfd_print(netdissect_options *ndo, const u_char *pptr,
                 }
                 break;
             }
+            if (ndo->ndo_bfd_sessions && version == 1)
+                bfd_session_update(ndo, bfd_header, iph);
         } else if (port == BFD_ECHO_PORT) {
             /*
              * Echo packet.
              */
+            if (ndo->ndo_bfd_sessions) {
+                /* Only the control packets are of interest. */
+                ndo->ndo_drop_line = 1;
+                return;
+            }
             ND_PRINT("BFD, Echo, length: %u",
                    len);
             if (ndo->ndo_vflag >= 1) {
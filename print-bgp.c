@@ -41,10 +41,12 @@
 #include "netdissect-stdinc.h"
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
 #include "netdissect.h"
 #include "addrtoname.h"
+#include "addrtostr.h"
 #include "extract.h"
 #include "af.h"
 #include "l2vpn.h"
@@ -557,7 +559,7 @@ static const struct tok bgp_add_path_recvsend[] = {
     { 0, NULL },
 };
 
-static char astostr[20];
+static ND_THREAD_LOCAL char astostr[20];
 
 /*
  * as_printf
@@ -679,7 +681,7 @@ bgp_vpn_ip_print(netdissect_options *ndo,
 {
 
     /* worst case string is s fully formatted v6 address */
-    static char addr[sizeof("1234:5678:89ab:cdef:1234:5678:89ab:cdef")];
+    static ND_THREAD_LOCAL char addr[sizeof("1234:5678:89ab:cdef:1234:5678:89ab:cdef")];
     char *pos = addr;
 
     switch(addr_length) {
@@ -769,7 +771,7 @@ bgp_vpn_rd_print(netdissect_options *ndo,
                  const u_char *pptr)
 {
     /* allocate space for the largest possible string */
-    static char rd[sizeof("xxxxxxxxxx:xxxxx (xxx.xxx.xxx.xxx:xxxxx)")];
+    static ND_THREAD_LOCAL char rd[sizeof("xxxxxxxxxx:xxxxx (xxx.xxx.xxx.xxx:xxxxx)")];
     char *pos = rd;
 
     /* ok lets load the RD format */
@@ -1594,6 +1596,46 @@ check_add_path(netdissect_options *ndo, const u_char *pptr, u_int length,
     return 0;
 }
 
+/*
+ * Return 1 if bgp_nlri_print() can decode NLRI of the AFI "af" and the
+ * SAFI "safi", 0 if not.
+ */
+static int
+bgp_mp_af_known(uint16_t af, uint8_t safi)
+{
+    switch(af<<8 | safi) {
+    case (AFNUM_INET<<8 | SAFNUM_UNICAST):
+    case (AFNUM_INET<<8 | SAFNUM_MULTICAST):
+    case (AFNUM_INET<<8 | SAFNUM_UNIMULTICAST):
+    case (AFNUM_INET<<8 | SAFNUM_LABUNICAST):
+    case (AFNUM_INET<<8 | SAFNUM_RT_ROUTING_INFO):
+    case (AFNUM_INET<<8 | SAFNUM_VPNUNICAST):
+    case (AFNUM_INET<<8 | SAFNUM_VPNMULTICAST):
+    case (AFNUM_INET<<8 | SAFNUM_VPNUNIMULTICAST):
+    case (AFNUM_INET<<8 | SAFNUM_MULTICAST_VPN):
+    case (AFNUM_INET<<8 | SAFNUM_MDT):
+    case (AFNUM_INET6<<8 | SAFNUM_UNICAST):
+    case (AFNUM_INET6<<8 | SAFNUM_MULTICAST):
+    case (AFNUM_INET6<<8 | SAFNUM_UNIMULTICAST):
+    case (AFNUM_INET6<<8 | SAFNUM_LABUNICAST):
+    case (AFNUM_INET6<<8 | SAFNUM_VPNUNICAST):
+    case (AFNUM_INET6<<8 | SAFNUM_VPNMULTICAST):
+    case (AFNUM_INET6<<8 | SAFNUM_VPNUNIMULTICAST):
+    case (AFNUM_NSAP<<8 | SAFNUM_UNICAST):
+    case (AFNUM_NSAP<<8 | SAFNUM_MULTICAST):
+    case (AFNUM_NSAP<<8 | SAFNUM_UNIMULTICAST):
+    case (AFNUM_NSAP<<8 | SAFNUM_VPNUNICAST):
+    case (AFNUM_NSAP<<8 | SAFNUM_VPNMULTICAST):
+    case (AFNUM_NSAP<<8 | SAFNUM_VPNUNIMULTICAST):
+    case (AFNUM_L2VPN<<8 | SAFNUM_VPNUNICAST):
+    case (AFNUM_L2VPN<<8 | SAFNUM_VPNMULTICAST):
+    case (AFNUM_L2VPN<<8 | SAFNUM_VPNUNIMULTICAST):
+    case (AFNUM_VPLS<<8 | SAFNUM_VPLS):
+        return 1;
+    }
+    return 0;
+}
+
 static int
 bgp_mp_af_print(netdissect_options *ndo,
 	        const u_char *tptr, u_int tlen,
@@ -1614,36 +1656,7 @@ bgp_mp_af_print(netdissect_options *ndo,
                   tok2str(bgp_safi_values, "Unknown SAFI", safi),
                   safi);
 
-        switch(af<<8 | safi) {
-        case (AFNUM_INET<<8 | SAFNUM_UNICAST):
-        case (AFNUM_INET<<8 | SAFNUM_MULTICAST):
-        case (AFNUM_INET<<8 | SAFNUM_UNIMULTICAST):
-        case (AFNUM_INET<<8 | SAFNUM_LABUNICAST):
-        case (AFNUM_INET<<8 | SAFNUM_RT_ROUTING_INFO):
-        case (AFNUM_INET<<8 | SAFNUM_VPNUNICAST):
-        case (AFNUM_INET<<8 | SAFNUM_VPNMULTICAST):
-        case (AFNUM_INET<<8 | SAFNUM_VPNUNIMULTICAST):
-        case (AFNUM_INET<<8 | SAFNUM_MULTICAST_VPN):
-        case (AFNUM_INET<<8 | SAFNUM_MDT):
-        case (AFNUM_INET6<<8 | SAFNUM_UNICAST):
-        case (AFNUM_INET6<<8 | SAFNUM_MULTICAST):
-        case (AFNUM_INET6<<8 | SAFNUM_UNIMULTICAST):
-        case (AFNUM_INET6<<8 | SAFNUM_LABUNICAST):
-        case (AFNUM_INET6<<8 | SAFNUM_VPNUNICAST):
-        case (AFNUM_INET6<<8 | SAFNUM_VPNMULTICAST):
-        case (AFNUM_INET6<<8 | SAFNUM_VPNUNIMULTICAST):
-        case (AFNUM_NSAP<<8 | SAFNUM_UNICAST):
-        case (AFNUM_NSAP<<8 | SAFNUM_MULTICAST):
-        case (AFNUM_NSAP<<8 | SAFNUM_UNIMULTICAST):
-        case (AFNUM_NSAP<<8 | SAFNUM_VPNUNICAST):
-        case (AFNUM_NSAP<<8 | SAFNUM_VPNMULTICAST):
-        case (AFNUM_NSAP<<8 | SAFNUM_VPNUNIMULTICAST):
-        case (AFNUM_L2VPN<<8 | SAFNUM_VPNUNICAST):
-        case (AFNUM_L2VPN<<8 | SAFNUM_VPNMULTICAST):
-        case (AFNUM_L2VPN<<8 | SAFNUM_VPNUNIMULTICAST):
-        case (AFNUM_VPLS<<8 | SAFNUM_VPLS):
-            break;
-        default:
+        if (!bgp_mp_af_known(af, safi)) {
             ND_TCHECK_LEN(tptr, tlen);
             ND_PRINT("\n\t    no AFI %u / SAFI %u decoder", af, safi);
             if (ndo->ndo_vflag <= 1)
@@ -2698,6 +2711,661 @@ trunc:
     nd_print_trunc(ndo);
 }
 
+/*
+ * --bgp-summary: rather than formatting every prefix of an UPDATE,
+ * which during a full table transfer is most of the time spent, count
+ * the prefixes of each NLRI field by stepping over their lengths and
+ * print how many there were, with the first few as a sample.  The
+ * counts are also added up per peer, that is per source address, and
+ * per AFI/SAFI, for bgp_peer_foreach().
+ */
+#define BGP_SUMMARY_SAMPLES	3
+#define BGP_PEER_CHAINS		64
+
+struct bgp_nlri_batch {
+    uint16_t af;
+    uint8_t safi;
+    int add_path;
+    u_int count;
+    u_int nsamples;
+    const u_char *sample[BGP_SUMMARY_SAMPLES];
+    u_int sample_len[BGP_SUMMARY_SAMPLES];	/* bytes left from there */
+};
+
+struct bgp_peer_count {
+    u_int version;		/* 4 or 6 */
+    u_char addr[16];
+    uint16_t af;
+    uint8_t safi;
+    uint64_t announced;
+    uint64_t withdrawn;
+    struct bgp_peer_count *next;	/* on its hash chain */
+};
+
+static ND_THREAD_LOCAL struct bgp_peer_count *bgp_peer_chains[BGP_PEER_CHAINS];
+static ND_THREAD_LOCAL struct bgp_peer_count **bgp_peers;	/* in order made */
+static ND_THREAD_LOCAL u_int bgp_npeers, bgp_maxpeers;
+
+/*
+ * Return the length of the NLRI at "p", not counting any path ID, for
+ * the AFI "af" and the SAFI "safi", or -1 if it's longer than the "len"
+ * bytes left or has an illegal prefix length.
+ */
+static int
+bgp_nlri_length(netdissect_options *ndo, uint16_t af, uint8_t safi,
+                const u_char *p, u_int len)
+{
+    u_int plen;
+
+    if (len < 1)
+        return -1;
+    if (safi == SAFNUM_MULTICAST_VPN || safi == SAFNUM_EVPN) {
+        /* route type, length, route */
+        if (len < 2)
+            return -1;
+        plen = 2 + GET_U_1(p + 1);
+    } else if (af == AFNUM_L2VPN || af == AFNUM_VPLS) {
+        /* length in bytes */
+        if (len < 2)
+            return -1;
+        plen = 2 + GET_BE_U_2(p);
+    } else {
+        /* length in bits, of any labels and RD as well as the prefix */
+        plen = GET_U_1(p);
+        if (safi == SAFNUM_UNICAST || safi == SAFNUM_MULTICAST ||
+            safi == SAFNUM_UNIMULTICAST) {
+            if ((af == AFNUM_INET && plen > 32) ||
+                (af == AFNUM_INET6 && plen > 128))
+                return -1;
+        }
+        plen = 1 + (plen + 7) / 8;
+    }
+    if (plen > len)
+        return -1;
+    return plen;
+}
+
+/*
+ * Count the NLRI in the "len" bytes at "p" into "b", whose AFI and SAFI
+ * are set, remembering where the first BGP_SUMMARY_SAMPLES of them are.
+ * Return 0, or -1 if an NLRI couldn't be stepped over, in which case
+ * those before it are counted.
+ */
+static int
+bgp_nlri_count(netdissect_options *ndo, struct bgp_nlri_batch *b,
+               const u_char *p, u_int len)
+{
+    u_int skip;
+    int nlen;
+
+    b->count = b->nsamples = 0;
+    b->add_path = 0;
+    if (b->safi == SAFNUM_UNICAST || b->safi == SAFNUM_MULTICAST ||
+        b->safi == SAFNUM_UNIMULTICAST) {
+        if (b->af == AFNUM_INET)
+            b->add_path = check_add_path(ndo, p, len, 32);
+        else if (b->af == AFNUM_INET6)
+            b->add_path = check_add_path(ndo, p, len, 128);
+    }
+    skip = b->add_path ? 4 : 0;
+    while (len != 0) {
+        if (len < skip)
+            return -1;
+        nlen = bgp_nlri_length(ndo, b->af, b->safi, p + skip, len - skip);
+        if (nlen < 0)
+            return -1;
+        if (b->nsamples < BGP_SUMMARY_SAMPLES) {
+            b->sample[b->nsamples] = p;
+            b->sample_len[b->nsamples] = len - skip;
+            b->nsamples++;
+        }
+        b->count++;
+        p += skip + nlen;
+        len -= skip + nlen;
+    }
+    return 0;
+}
+
+/*
+ * Add "announced" and "withdrawn" prefixes of the AFI "af" and the SAFI
+ * "safi" to the counts for the peer that sent the IPv4 or IPv6 packet
+ * whose header is at "iph".
+ */
+static void
+bgp_peer_count(netdissect_options *ndo, const u_char *iph, uint16_t af,
+               uint8_t safi, u_int announced, u_int withdrawn)
+{
+    struct bgp_peer_count *pc, **pcp;
+    u_char addr[16];
+    u_int version, alen, i;
+    uint32_t h = 2166136261U;
+
+    /*
+     * The IP header was checked by the IP dissector, and isn't in the
+     * buffer being dissected if the message was reassembled.
+     */
+    if (iph == NULL)
+        return;
+    version = EXTRACT_U_1(iph) >> 4;
+    if (version == 4) {
+        alen = 4;
+        memcpy(addr, iph + 12, alen);
+    } else if (version == 6) {
+        alen = 16;
+        memcpy(addr, iph + 8, alen);
+    } else
+        return;
+    for (i = 0; i < alen; i++)
+        h = (h ^ addr[i]) * 16777619U;
+    h = (h ^ (af << 8 | safi)) * 16777619U;
+    pcp = &bgp_peer_chains[h % BGP_PEER_CHAINS];
+    for (pc = *pcp; pc != NULL; pc = pc->next)
+        if (pc->version == version && pc->af == af && pc->safi == safi &&
+            memcmp(pc->addr, addr, alen) == 0)
+            break;
+    if (pc == NULL) {
+        if (bgp_npeers == bgp_maxpeers) {
+            bgp_maxpeers = bgp_maxpeers ? bgp_maxpeers * 2 : 16;
+            bgp_peers = (struct bgp_peer_count **)realloc(bgp_peers,
+                bgp_maxpeers * sizeof(*bgp_peers));
+            if (bgp_peers == NULL)
+                (*ndo->ndo_error)(ndo, S_ERR_ND_MEM_ALLOC,
+                    "%s: realloc", __func__);
+        }
+        pc = (struct bgp_peer_count *)calloc(1, sizeof(*pc));
+        if (pc == NULL)
+            (*ndo->ndo_error)(ndo, S_ERR_ND_MEM_ALLOC, "%s: calloc",
+                __func__);
+        pc->version = version;
+        memcpy(pc->addr, addr, alen);
+        pc->af = af;
+        pc->safi = safi;
+        pc->next = *pcp;
+        *pcp = pc;
+        bgp_peers[bgp_npeers++] = pc;
+    }
+    pc->announced += announced;
+    pc->withdrawn += withdrawn;
+}
+
+/*
+ * Call "fn" for each peer and AFI/SAFI of this thread that --bgp-summary
+ * has counted prefixes for, in the order they were first seen.
+ */
+void
+bgp_peer_foreach(bgp_peer_fn fn, void *arg)
+{
+    const struct bgp_peer_count *pc;
+    char peer[INET6_ADDRSTRLEN], family[64];
+    u_int i;
+
+    for (i = 0; i < bgp_npeers; i++) {
+        pc = bgp_peers[i];
+        if (pc->version == 6)
+            addrtostr6(pc->addr, peer, sizeof(peer));
+        else
+            addrtostr(pc->addr, peer, sizeof(peer));
+        snprintf(family, sizeof(family), "%s %s",
+                 tok2str(af_values, "AFI %u", pc->af),
+                 tok2str(bgp_safi_values, "SAFI %u", pc->safi));
+        (*fn)(arg, peer, family, pc->announced, pc->withdrawn);
+    }
+}
+
+/*
+ * Count, summarize and sample the NLRI of the AFI "af" and the SAFI
+ * "safi" in the "len" bytes at "p", announced unless "withdrawn" is set;
+ * "arg" points to the IP header.
+ */
+static void
+bgp_nlri_summary(netdissect_options *ndo, void *arg, uint16_t af,
+                 uint8_t safi, const u_char *p, u_int len, int withdrawn)
+{
+    const u_char *iph = *(const u_char **)arg;
+    struct bgp_nlri_batch b;
+    char buf[MAXHOSTNAMELEN + 100];
+    int bad;
+    u_int i;
+
+    b.af = af;
+    b.safi = safi;
+    bad = bgp_nlri_count(ndo, &b, p, len);
+    ND_PRINT("\n\t  %s %s: ",
+             tok2str(af_values, "AFI %u", af),
+             tok2str(bgp_safi_values, "SAFI %u", safi));
+    if (withdrawn && len == 0) {
+        ND_PRINT("End-of-Rib Marker");
+        return;
+    }
+    ND_PRINT("%u %s", b.count, withdrawn ? "withdrawn" : "announced");
+    if (bgp_mp_af_known(af, safi)) {
+        for (i = 0; i < b.nsamples; i++)
+            if (bgp_nlri_print(ndo, af, safi, b.sample[i], b.sample_len[i],
+                               buf, sizeof(buf),
+                               b.add_path && af == AFNUM_INET,
+                               b.add_path && af == AFNUM_INET6) < 0)
+                break;
+        if (b.count > b.nsamples)
+            ND_PRINT("\n\t      (%u more)", b.count - b.nsamples);
+    }
+    if (bad)
+        ND_PRINT("\n\t    (illegal prefix length)");
+    bgp_peer_count(ndo, iph, af, safi, withdrawn ? 0 : b.count,
+                   withdrawn ? b.count : 0);
+}
+
+typedef void (*bgp_nlri_fn)(netdissect_options *, void *, uint16_t,
+                            uint8_t, const u_char *, u_int, int);
+
+/*
+ * Call "fn", with "arg", for each NLRI field of the UPDATE at "dat":
+ * the withdrawn routes, those of each MP_REACH_NLRI and MP_UNREACH_NLRI
+ * attribute, skipping the other attributes, and the NLRI at the end.
+ * It's handed the AFI, the SAFI, where the field is and how long, and
+ * whether the routes are withdrawn.  Return 1 if the UPDATE is empty,
+ * an End-of-RIB marker for IPv4 unicast, 0 if it was walked, -1 if the
+ * path attributes were too short for their lengths and -2 if the
+ * message was too short for its fields.
+ */
+static int
+bgp_update_walk(netdissect_options *ndo, const u_char *dat, u_int length,
+                bgp_nlri_fn fn, void *arg)
+{
+    const u_char *p;
+    u_int withdrawn_routes_len, len, off;
+    uint8_t aflags, atype, alenlen, snpa;
+    uint16_t alen;
+    int ret = 0;
+
+    if (length < BGP_SIZE)
+        return -2;
+    p = dat + BGP_SIZE;
+    length -= BGP_SIZE;
+
+    if (length < 2)
+        return -2;
+    withdrawn_routes_len = GET_BE_U_2(p);
+    p += 2;
+    length -= 2;
+    if (length < withdrawn_routes_len)
+        return -2;
+    if (withdrawn_routes_len != 0)
+        (*fn)(ndo, arg, AFNUM_INET, SAFNUM_UNICAST, p, withdrawn_routes_len,
+              1);
+    p += withdrawn_routes_len;
+    length -= withdrawn_routes_len;
+
+    if (length < 2)
+        return -2;
+    len = GET_BE_U_2(p);
+    p += 2;
+    length -= 2;
+
+    if (withdrawn_routes_len == 0 && len == 0 && length == 0) {
+        /* No withdrawn routes, no path attributes, no NLRI */
+        return 1;
+    }
+    if (length < len)
+        return -2;
+
+    while (len != 0) {
+        if (len < 2) {
+            ret = -1;
+            break;
+        }
+        aflags = GET_U_1(p);
+        atype = GET_U_1(p + 1);
+        alenlen = bgp_attr_lenlen(aflags, p + 2);
+        if (len < 2U + alenlen) {
+            ret = -1;
+            break;
+        }
+        alen = bgp_attr_len(aflags, p + 2);
+        p += 2 + alenlen;
+        len -= 2 + alenlen;
+        length -= 2 + alenlen;
+        if (len < alen) {
+            ret = -1;
+            break;
+        }
+        if (atype == BGPTYPE_MP_REACH_NLRI && alen >= 5) {
+            /* AFI, SAFI, next hop, SNPAs, NLRI */
+            off = 4 + GET_U_1(p + 3);
+            if (off < alen) {
+                snpa = GET_U_1(p + off);
+                off++;
+                while (snpa != 0 && off < alen) {
+                    off += 1 + GET_U_1(p + off);
+                    snpa--;
+                }
+            }
+            if (off <= alen)
+                (*fn)(ndo, arg, GET_BE_U_2(p), GET_U_1(p + 2), p + off,
+                      alen - off, 0);
+            else
+                ret = -1;
+        } else if (atype == BGPTYPE_MP_UNREACH_NLRI && alen >= 3) {
+            /* AFI, SAFI, withdrawn routes */
+            (*fn)(ndo, arg, GET_BE_U_2(p), GET_U_1(p + 2), p + 3, alen - 3,
+                  1);
+        }
+        p += alen;
+        len -= alen;
+        length -= alen;
+    }
+    p += len;
+    length -= len;
+
+    if (length != 0)
+        (*fn)(ndo, arg, AFNUM_INET, SAFNUM_UNICAST, p, length, 0);
+    return ret;
+}
+
+/*
+ * Print an UPDATE for --bgp-summary, summarizing each NLRI field.
+ */
+static void
+bgp_update_summary(netdissect_options *ndo, const u_char *iph,
+                   const u_char *dat, u_int length)
+{
+    switch (bgp_update_walk(ndo, dat, length, bgp_nlri_summary, &iph)) {
+    case 1:
+        ND_PRINT("\n\t  End-of-Rib Marker (empty NLRI)");
+        break;
+    case -1:
+        ND_PRINT("\n\t  [path attrs too short]");
+        break;
+    case -2:
+        nd_print_trunc(ndo);
+        break;
+    }
+}
+
+/*
+ * --bgp-peers: count the messages each speaker sends each of its peers,
+ * the prefixes its UPDATEs announce and withdraw, how often it sends
+ * them and KEEPALIVEs, and the NOTIFICATIONs it sends, for
+ * bgp_session_foreach().  With --tcp-reassembly, which --bgp-peers
+ * turns on, the messages are whole however they were segmented.
+ */
+struct bgp_session {
+    u_int version;		/* 4 or 6 */
+    u_char src[16];
+    u_char dst[16];
+    uint64_t messages[BGP_ROUTE_REFRESH + 1];	/* 0 for unknown types */
+    uint64_t announced;
+    uint64_t withdrawn;
+    uint64_t eor;
+    uint64_t first_update_us;	/* time stamps, in microseconds */
+    uint64_t last_update_us;
+    uint64_t update_second;	/* the second "in_second" UPDATEs were in */
+    u_int in_second;
+    u_int update_peak;
+    uint64_t keepalive_us;	/* when the last KEEPALIVE was sent, or 0 */
+    uint64_t intervals;		/* between KEEPALIVEs */
+    uint64_t interval_total_us;
+    uint64_t interval_min_us;
+    uint64_t interval_max_us;
+    uint64_t last_interval_us;
+    uint64_t jitter_total_us;	/* of the changes from one to the next */
+    u_int nnotifications;
+    uint8_t notification_code[BGP_PEER_NOTIFICATIONS];
+    uint8_t notification_subcode[BGP_PEER_NOTIFICATIONS];
+    uint64_t notification_count[BGP_PEER_NOTIFICATIONS];
+    uint64_t other_notifications;
+    struct bgp_session *next;	/* on its hash chain */
+};
+
+static ND_THREAD_LOCAL struct bgp_session *bgp_session_chains[BGP_PEER_CHAINS];
+static ND_THREAD_LOCAL struct bgp_session **bgp_sessions;	/* in order made */
+static ND_THREAD_LOCAL u_int bgp_nsessions, bgp_maxsessions;
+
+/*
+ * Return the counters for the messages sent by the source of the IPv4
+ * or IPv6 packet whose header is at "iph" to its destination, or NULL
+ * if "iph" isn't one.
+ */
+static struct bgp_session *
+bgp_session_lookup(netdissect_options *ndo, const u_char *iph)
+{
+    struct bgp_session *bs, **bsp;
+    u_char src[16], dst[16];
+    u_int version, alen, i;
+    uint32_t h = 2166136261U;
+
+    /* As for bgp_peer_count(). */
+    if (iph == NULL)
+        return NULL;
+    version = EXTRACT_U_1(iph) >> 4;
+    if (version == 4) {
+        alen = 4;
+        memcpy(src, iph + 12, alen);
+        memcpy(dst, iph + 16, alen);
+    } else if (version == 6) {
+        alen = 16;
+        memcpy(src, iph + 8, alen);
+        memcpy(dst, iph + 24, alen);
+    } else
+        return NULL;
+    for (i = 0; i < alen; i++)
+        h = (h ^ src[i]) * 16777619U;
+    for (i = 0; i < alen; i++)
+        h = (h ^ dst[i]) * 16777619U;
+    bsp = &bgp_session_chains[h % BGP_PEER_CHAINS];
+    for (bs = *bsp; bs != NULL; bs = bs->next)
+        if (bs->version == version && memcmp(bs->src, src, alen) == 0 &&
+            memcmp(bs->dst, dst, alen) == 0)
+            return bs;
+
+    if (bgp_nsessions == bgp_maxsessions) {
+        bgp_maxsessions = bgp_maxsessions ? bgp_maxsessions * 2 : 16;
+        bgp_sessions = (struct bgp_session **)realloc(bgp_sessions,
+            bgp_maxsessions * sizeof(*bgp_sessions));
+        if (bgp_sessions == NULL)
+            (*ndo->ndo_error)(ndo, S_ERR_ND_MEM_ALLOC,
+                "%s: realloc", __func__);
+    }
+    bs = (struct bgp_session *)calloc(1, sizeof(*bs));
+    if (bs == NULL)
+        (*ndo->ndo_error)(ndo, S_ERR_ND_MEM_ALLOC, "%s: calloc", __func__);
+    bs->version = version;
+    memcpy(bs->src, src, alen);
+    memcpy(bs->dst, dst, alen);
+    bs->next = *bsp;
+    *bsp = bs;
+    bgp_sessions[bgp_nsessions++] = bs;
+    return bs;
+}
+
+/*
+ * Add the NLRI of an UPDATE to the counts of the bgp_session "arg".
+ */
+static void
+bgp_nlri_tally(netdissect_options *ndo, void *arg, uint16_t af,
+               uint8_t safi, const u_char *p, u_int len, int withdrawn)
+{
+    struct bgp_session *bs = (struct bgp_session *)arg;
+    struct bgp_nlri_batch b;
+
+    if (withdrawn && len == 0) {
+        bs->eor++;
+        return;
+    }
+    b.af = af;
+    b.safi = safi;
+    (void)bgp_nlri_count(ndo, &b, p, len);
+    if (withdrawn)
+        bs->withdrawn += b.count;
+    else
+        bs->announced += b.count;
+}
+
+/*
+ * Count the whole, captured, message of "length" bytes at "dat" for
+ * --bgp-peers.
+ */
+static void
+bgp_session_count(netdissect_options *ndo, const u_char *iph,
+                  const u_char *dat, u_int length)
+{
+    struct bgp_session *bs;
+    uint64_t now, d;
+    uint8_t type, code, subcode;
+    u_int i;
+
+    bs = bgp_session_lookup(ndo, iph);
+    if (bs == NULL)
+        return;
+    now = (uint64_t)ND_TS_USEC(ndo->ndo_packet_ts);
+    type = GET_U_1(dat + 18);
+    bs->messages[type <= BGP_ROUTE_REFRESH ? type : 0]++;
+    switch (type) {
+    case BGP_OPEN:
+        /* A new session; time its KEEPALIVEs afresh. */
+        bs->keepalive_us = 0;
+        break;
+    case BGP_UPDATE:
+        if (bgp_update_walk(ndo, dat, length, bgp_nlri_tally, bs) == 1)
+            bs->eor++;
+        if (bs->messages[BGP_UPDATE] == 1)
+            bs->first_update_us = now;
+        bs->last_update_us = now;
+        if (bs->messages[BGP_UPDATE] == 1 ||
+            ndo->ndo_packet_sec != (time_t)bs->update_second) {
+            bs->update_second = ndo->ndo_packet_sec;
+            bs->in_second = 0;
+        }
+        if (++bs->in_second > bs->update_peak)
+            bs->update_peak = bs->in_second;
+        break;
+    case BGP_KEEPALIVE:
+        /* The capture can go back in time. */
+        if (bs->keepalive_us != 0 && now >= bs->keepalive_us) {
+            d = now - bs->keepalive_us;
+            if (bs->intervals == 0 || d < bs->interval_min_us)
+                bs->interval_min_us = d;
+            if (d > bs->interval_max_us)
+                bs->interval_max_us = d;
+            if (bs->intervals != 0)
+                bs->jitter_total_us += d > bs->last_interval_us ?
+                    d - bs->last_interval_us : bs->last_interval_us - d;
+            bs->interval_total_us += d;
+            bs->last_interval_us = d;
+            bs->intervals++;
+        }
+        bs->keepalive_us = now;
+        break;
+    case BGP_NOTIFICATION:
+        if (length < BGP_NOTIFICATION_SIZE)
+            break;
+        code = GET_U_1(dat + 19);
+        subcode = GET_U_1(dat + 20);
+        for (i = 0; i < bs->nnotifications; i++)
+            if (bs->notification_code[i] == code &&
+                bs->notification_subcode[i] == subcode)
+                break;
+        if (i == bs->nnotifications) {
+            if (i == BGP_PEER_NOTIFICATIONS) {
+                bs->other_notifications++;
+                break;
+            }
+            bs->notification_code[i] = code;
+            bs->notification_subcode[i] = subcode;
+            bs->nnotifications++;
+        }
+        bs->notification_count[i]++;
+        break;
+    }
+}
+
+/*
+ * Return the name of the NOTIFICATION error subcode "subcode" of the
+ * error code "code".
+ */
+static const char *
+bgp_notify_minor_str(uint8_t code, uint8_t subcode)
+{
+    switch (code) {
+    case BGP_NOTIFY_MAJOR_MSG:
+        return tok2str(bgp_notify_minor_msg_values, "Unknown", subcode);
+    case BGP_NOTIFY_MAJOR_OPEN:
+        return tok2str(bgp_notify_minor_open_values, "Unknown", subcode);
+    case BGP_NOTIFY_MAJOR_UPDATE:
+        return tok2str(bgp_notify_minor_update_values, "Unknown", subcode);
+    case BGP_NOTIFY_MAJOR_FSM:
+        return tok2str(bgp_notify_minor_fsm_values, "Unknown", subcode);
+    case BGP_NOTIFY_MAJOR_CAP:
+        return tok2str(bgp_notify_minor_cap_values, "Unknown", subcode);
+    case BGP_NOTIFY_MAJOR_CEASE:
+        return tok2str(bgp_notify_minor_cease_values, "Unknown", subcode);
+    }
+    return "Unknown";
+}
+
+/*
+ * Call "fn" for each speaker and peer of this thread that --bgp-peers
+ * has counted messages for, in the order they were first seen.
+ */
+void
+bgp_session_foreach(bgp_session_fn fn, void *arg)
+{
+    const struct bgp_session *bs;
+    struct bgp_session_stats bss;
+    char src[INET6_ADDRSTRLEN], dst[INET6_ADDRSTRLEN];
+    char notification[BGP_PEER_NOTIFICATIONS][128];
+    u_int i, j;
+
+    for (i = 0; i < bgp_nsessions; i++) {
+        bs = bgp_sessions[i];
+        if (bs->version == 6) {
+            addrtostr6(bs->src, src, sizeof(src));
+            addrtostr6(bs->dst, dst, sizeof(dst));
+        } else {
+            addrtostr(bs->src, src, sizeof(src));
+            addrtostr(bs->dst, dst, sizeof(dst));
+        }
+        memset(&bss, 0, sizeof(bss));
+        bss.bss_src = src;
+        bss.bss_dst = dst;
+        bss.bss_opens = bs->messages[BGP_OPEN];
+        bss.bss_updates = bs->messages[BGP_UPDATE];
+        bss.bss_notifications = bs->messages[BGP_NOTIFICATION];
+        bss.bss_keepalives = bs->messages[BGP_KEEPALIVE];
+        bss.bss_route_refreshes = bs->messages[BGP_ROUTE_REFRESH];
+        bss.bss_unknown = bs->messages[0];
+        bss.bss_announced = bs->announced;
+        bss.bss_withdrawn = bs->withdrawn;
+        bss.bss_eor = bs->eor;
+        if (bs->last_update_us > bs->first_update_us)
+            bss.bss_update_us = bs->last_update_us - bs->first_update_us;
+        bss.bss_update_peak = bs->update_peak;
+        bss.bss_keepalive_intervals = bs->intervals;
+        if (bs->intervals != 0) {
+            bss.bss_keepalive_mean_us = bs->interval_total_us / bs->intervals;
+            bss.bss_keepalive_min_us = bs->interval_min_us;
+            bss.bss_keepalive_max_us = bs->interval_max_us;
+        }
+        if (bs->intervals > 1)
+            bss.bss_keepalive_jitter_us =
+                bs->jitter_total_us / (bs->intervals - 1);
+        for (j = 0; j < bs->nnotifications; j++) {
+            snprintf(notification[j], sizeof(notification[j]),
+                     "%s (%u), subcode %s (%u)",
+                     tok2str(bgp_notify_major_values, "Unknown Error",
+                             bs->notification_code[j]),
+                     bs->notification_code[j],
+                     bgp_notify_minor_str(bs->notification_code[j],
+                                          bs->notification_subcode[j]),
+                     bs->notification_subcode[j]);
+            bss.bss_notification[j] = notification[j];
+            bss.bss_notification_count[j] = bs->notification_count[j];
+        }
+        bss.bss_nnotifications = bs->nnotifications;
+        bss.bss_other_notifications = bs->other_notifications;
+        (*fn)(arg, &bss);
+    }
+}
+
 static void
 bgp_update_print(netdissect_options *ndo,
                  const u_char *dat, u_int length)
@@ -3038,7 +3706,7 @@ trunc:
 }
 
 static int
-bgp_pdu_print(netdissect_options *ndo,
+bgp_pdu_print(netdissect_options *ndo, const u_char *iph,
               const u_char *dat, u_int length)
 {
     const struct bgp *bgp_header;
@@ -3058,7 +3726,10 @@ bgp_pdu_print(netdissect_options *ndo,
         bgp_open_print(ndo, dat, length);
         break;
     case BGP_UPDATE:
-        bgp_update_print(ndo, dat, length);
+        if (ndo->ndo_bgp_summary)
+            bgp_update_summary(ndo, iph, dat, length);
+        else
+            bgp_update_print(ndo, dat, length);
         break;
     case BGP_NOTIFICATION:
         bgp_notification_print(ndo, dat, length);
@@ -3083,7 +3754,7 @@ trunc:
 
 void
 bgp_print(netdissect_options *ndo,
-          const u_char *dat, u_int length _U_)
+          const u_char *dat, u_int length _U_, const u_char *iph)
 {
     const u_char *p;
     const u_char *ep = ndo->ndo_snapend;
@@ -3094,11 +3765,14 @@ bgp_print(netdissect_options *ndo,
     };
     const struct bgp *bgp_header;
     uint16_t hlen;
+    int printing;
 
     ndo->ndo_protocol = "bgp";
     ND_PRINT(": BGP");
 
-    if (ndo->ndo_vflag < 1) /* lets be less chatty */
+    /* lets be less chatty, unless summarizing or counting */
+    printing = ndo->ndo_vflag >= 1 || ndo->ndo_bgp_summary;
+    if (!printing && !ndo->ndo_bgp_peers)
         return;
 
     p = dat;
@@ -3122,26 +3796,31 @@ bgp_print(netdissect_options *ndo,
         ND_TCHECK_LEN(p, BGP_SIZE);
         bgp_header = (const struct bgp *)p;
 
-        if (start != p)
+        if (start != p && printing)
             nd_print_trunc(ndo);
 
         hlen = GET_BE_U_2(bgp_header->bgp_len);
         if (hlen < BGP_SIZE) {
-            ND_PRINT("\nmessage length %u < %u", hlen, BGP_SIZE);
-            nd_print_invalid(ndo);
+            if (printing) {
+                ND_PRINT("\nmessage length %u < %u", hlen, BGP_SIZE);
+                nd_print_invalid(ndo);
+            }
             break;
         }
 
         if (ND_TTEST_LEN(p, hlen)) {
-            if (!bgp_pdu_print(ndo, p, hlen))
+            if (ndo->ndo_bgp_peers)
+                bgp_session_count(ndo, iph, p, hlen);
+            if (printing && !bgp_pdu_print(ndo, iph, p, hlen))
                 return;
             p += hlen;
             start = p;
         } else {
-            ND_PRINT("\n[|BGP %s]",
-                      tok2str(bgp_msg_values,
-                              "Unknown Message Type",
-                              GET_U_1(bgp_header->bgp_type)));
+            if (printing)
+                ND_PRINT("\n[|BGP %s]",
+                          tok2str(bgp_msg_values,
+                                  "Unknown Message Type",
+                                  GET_U_1(bgp_header->bgp_type)));
             break;
         }
     }
@@ -3149,5 +3828,6 @@ bgp_print(netdissect_options *ndo,
     return;
 
 trunc:
-    nd_print_trunc(ndo);
+    if (printing)
+        nd_print_trunc(ndo);
 }
@@ -27,11 +27,14 @@
 
 #include "netdissect-stdinc.h"
 
+#include <stddef.h>
 #include <string.h>
 
 #include "netdissect.h"
 #include "addrtoname.h"
+#include "callcache.h"
 #include "extract.h"
+#include "latency.h"
 
 
 /*
@@ -262,6 +265,7 @@ struct cmu_vend {
 
 static void rfc1048_print(netdissect_options *, const u_char *);
 static void cmu_print(netdissect_options *, const u_char *);
+static void bootp_events(netdissect_options *, const u_char *, u_int);
 static char *client_fqdn_flags(u_int flags);
 
 static const struct tok bootp_flag_values[] = {
@@ -288,6 +292,11 @@ bootp_print(netdissect_options *ndo,
 	uint8_t bp_op, bp_htype, bp_hlen;
 
 	ndo->ndo_protocol = "bootp";
+	if (ndo->ndo_dhcp_events || ndo->ndo_latency) {
+		bootp_events(ndo, cp, length);
+		if (ndo->ndo_dhcp_events)
+			return;
+	}
 	bp = (const struct bootp *)cp;
 	ND_TCHECK_1(bp->bp_op);
 	bp_op = GET_U_1(bp->bp_op);
@@ -583,6 +592,142 @@ static const struct tok dhcp_msg_values[] = {
 	{ 0, NULL }
 };
 
+/*
+ * The DISCOVER, REQUEST and INFORM messages of clients are kept in a
+ * call cache, by transaction ID and client hardware address, so that the
+ * OFFER, ACK or NAK that answers one can be timed.
+ */
+struct bootp_xact_key {
+	uint32_t xid;
+	uint8_t hlen;
+	uint8_t chaddr[16];
+};
+
+struct bootp_xact_entry {
+	struct callcache_entry ce;
+	struct bootp_xact_key key;
+	uint8_t type;		/* DHCP message type of the request */
+	uint8_t answered;	/* its first answer has been counted */
+};
+
+#define BOOTP_XACT_TIMEOUT	60
+
+static const struct callcache_type bootp_xact_type = {
+	sizeof(struct bootp_xact_entry),
+	offsetof(struct bootp_xact_entry, key),
+	sizeof(struct bootp_xact_key),
+	BOOTP_XACT_TIMEOUT
+};
+
+/*
+ * --dhcp-events and --latency-report: find the DHCP message type, server
+ * identifier and requested address in the options, without printing
+ * them, enter the message in the call cache if it's a request or time
+ * it if it answers one, and, with --dhcp-events, print it on one line.
+ */
+static void
+bootp_events(netdissect_options *ndo, const u_char *cp, u_int length)
+{
+	static const u_char vm_rfc1048[4] = VM_RFC1048;
+	const struct bootp *bp = (const struct bootp *)cp;
+	const u_char *op, *ep, *server = NULL, *reqip = NULL;
+	struct bootp_xact_entry *bxe;
+	struct bootp_xact_key key;
+	u_int type = 0, tag, len, reqtype;
+	uint64_t us;
+	int timed = 0;
+
+	if (!ND_TTEST_LEN(cp, offsetof(struct bootp, bp_vend))) {
+		if (ndo->ndo_dhcp_events) {
+			ND_PRINT("DHCP");
+			nd_print_trunc(ndo);
+		}
+		return;
+	}
+	ep = cp + length;
+	if (ND_TTEST_4(bp->bp_vend) &&
+	    memcmp(bp->bp_vend, vm_rfc1048, sizeof(vm_rfc1048)) == 0) {
+		op = bp->bp_vend + sizeof(vm_rfc1048);
+		while (op < ep && ND_TTEST_1(op)) {
+			tag = GET_U_1(op);
+			op++;
+			if (tag == TAG_PAD)
+				continue;
+			if (tag == TAG_END || op >= ep || !ND_TTEST_1(op))
+				break;
+			len = GET_U_1(op);
+			op++;
+			if (len > ND_BYTES_BETWEEN(ep, op) ||
+			    !ND_TTEST_LEN(op, len))
+				break;
+			if (tag == TAG_DHCP_MESSAGE && len == 1)
+				type = GET_U_1(op);
+			else if (tag == TAG_SERVER_ID && len == 4)
+				server = op;
+			else if (tag == TAG_REQUESTED_IP && len == 4)
+				reqip = op;
+			op += len;
+		}
+	}
+
+	memset(&key, 0, sizeof(key));
+	key.xid = GET_BE_U_4(bp->bp_xid);
+	key.hlen = (uint8_t)min(GET_U_1(bp->bp_hlen), sizeof(key.chaddr));
+	memcpy(key.chaddr, bp->bp_chaddr, key.hlen);
+	us = 0;
+	switch (type) {
+	case DHCPDISCOVER:
+	case DHCPREQUEST:
+	case DHCPINFORM:
+		bxe = (struct bootp_xact_entry *)callcache_enter(ndo,
+		    &bootp_xact_type, &key);
+		if (bxe != NULL)
+			bxe->type = (uint8_t)type;
+		break;
+	case DHCPOFFER:
+	case DHCPACK:
+	case DHCPNAK:
+		bxe = (struct bootp_xact_entry *)callcache_find(ndo,
+		    &bootp_xact_type, &key);
+		if (bxe == NULL)
+			break;
+		reqtype = bxe->type;
+		if (type == DHCPOFFER ? reqtype != DHCPDISCOVER :
+		    reqtype != DHCPREQUEST && reqtype != DHCPINFORM)
+			break;
+		timed = 1;
+		if (ndo->ndo_latency && !bxe->answered)
+			us = latency_record(ndo, "dhcp",
+			    tok2str(dhcp_msg_values, "type-%u", type),
+			    bxe->ce.cce_ts);
+		else
+			us = latency_elapsed(ndo, bxe->ce.cce_ts);
+		bxe->answered = 1;
+		break;
+	}
+	if (!ndo->ndo_dhcp_events)
+		return;
+
+	if (type != 0)
+		ND_PRINT("DHCP %s",
+		    tok2str(dhcp_msg_values, "Unknown (%u)", type));
+	else
+		ND_PRINT("BOOTP %s", tok2str(bootp_op_values, "unknown (0x%02x)",
+		    GET_U_1(bp->bp_op)));
+	ND_PRINT(", xid 0x%x", key.xid);
+	if (GET_U_1(bp->bp_htype) == 1 && key.hlen == 6)
+		ND_PRINT(", chaddr %s", GET_ETHERADDR_STRING(bp->bp_chaddr));
+	if (GET_IPV4_TO_NETWORK_ORDER(bp->bp_yiaddr))
+		ND_PRINT(", yiaddr %s", GET_IPADDR_STRING(bp->bp_yiaddr));
+	if (reqip != NULL)
+		ND_PRINT(", requested %s", GET_IPADDR_STRING(reqip));
+	if (server != NULL)
+		ND_PRINT(", server %s", GET_IPADDR_STRING(server));
+	if (timed)
+		ND_PRINT(", %" PRIu64 ".%03u ms", us / 1000,
+		    (u_int)(us % 1000));
+}
+
 #define AGENT_SUBOPTION_CIRCUIT_ID	1	/* RFC 3046 */
 #define AGENT_SUBOPTION_REMOTE_ID	2	/* RFC 3046 */
 #define AGENT_SUBOPTION_SUBSCRIBER_ID	6	/* RFC 3993 */
@@ -1093,7 +1238,7 @@ trunc:
 static char *
 client_fqdn_flags(u_int flags)
 {
-	static char buf[8+1];
+	static ND_THREAD_LOCAL char buf[8+1];
 	int i = 0;
 
 	if (flags & CLIENT_FQDN_FLAGS_S)
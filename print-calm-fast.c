@@ -26,6 +26,7 @@
 #include "netdissect.h"
 #include "extract.h"
 #include "addrtoname.h"
+#include "v2x-stations.h"
 
 /*
    ISO 29281:2009
@@ -52,6 +53,18 @@ calm_fast_print(netdissect_options *ndo, const u_char *bp, u_int length, const s
 	length -= 2;
 	bp += 2;
 
+	/*
+	 * With --v2x-stations, count it against the station it's from,
+	 * and only print it at -vv and up.
+	 */
+	if (ndo->ndo_v2x_stations && src != NULL) {
+		(void)v2x_station_count(ndo, V2X_CALM_FAST, src->addr);
+		if (ndo->ndo_vflag < 2) {
+			ndo->ndo_drop_line = 1;
+			return;
+		}
+	}
+
 	ND_PRINT("CALM FAST");
 	if (src != NULL)
 		ND_PRINT(" src:%s", (src->addr_string)(ndo, src->addr));
@@ -44,6 +44,7 @@
 
 #include "netdissect.h" /* for checksum structure and functions */
 #include "extract.h"
+#include "change-only.h"
 
 void
 carp_print(netdissect_options *ndo, const u_char *bp, u_int len, u_int ttl)
@@ -59,6 +60,16 @@ carp_print(netdissect_options *ndo, const u_char *bp, u_int len, u_int ttl)
 		type_s = "advertise";
 	else
 		type_s = "unknown";
+	if (ndo->ndo_changes_only && version == 2 && type == 1) {
+		uint64_t h;
+		u_char t = (u_char)ttl;
+
+		/* Leave out the checksum, counter and HMAC. */
+		h = nd_change_hash(ndo, ND_CHANGE_HASH_INIT, &t, 1);
+		h = nd_change_hash(ndo, h, bp, len < 6 ? len : 6);
+		if (nd_change_repeat(ndo, ND_CHANGE_CARP, bp + 1, 1, h))
+			return;
+	}
 	ND_PRINT("CARPv%u-%s %u: ", version, type_s, len);
 	if (ttl != 255)
 		ND_PRINT("[ttl=%u!] ", ttl);
@@ -30,7 +30,7 @@
  * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 
-/* \summary: Cisco NetFlow protocol printer */
+/* \summary: Cisco NetFlow protocol and IPFIX printer */
 
 /*
  * Cisco NetFlow protocol
@@ -38,6 +38,8 @@
  * See
  *
  *    https://www.cisco.com/c/en/us/td/docs/net_mgmt/netflow_collection_engine/3-6/user/guide/format.html#wp1005892
+ *
+ * and, for version 9 and IPFIX, RFC 3954 and RFC 7011.
  */
 
 #ifdef HAVE_CONFIG_H
@@ -47,12 +49,17 @@
 #include "netdissect-stdinc.h"
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
 #include "netdissect.h"
 #include "addrtoname.h"
 #include "extract.h"
+#include "flows.h"
+#include "netdissect-state.h"
 
+#include "ip.h"
+#include "ip6.h"
 #include "tcp.h"
 #include "ipproto.h"
 
@@ -250,6 +257,63 @@ trunc:
 	return;
 }
 
+/*
+ * The records, and the count in the header, as NetFlow v5 exporters
+ * send them: 48 bytes, without the v6 peer_nexthop, and 16 bits.
+ */
+#define NFREC_V5_LEN	48
+
+/*
+ * With --flow-collector, add the flows of a NetFlow v5 export packet to
+ * the flow table, scaled by its sampling interval, rather than printing
+ * them.
+ */
+static void
+cnfp_v5_collect(netdissect_options *ndo, const struct nfhdr_v5 *nh)
+{
+	const u_char *rp;
+	const struct nfrec_v5 *nr;
+	struct nd_flow_key key;
+	uint64_t now, first, last, ago;
+	u_int nrecs, interval, uptime;
+
+	nrecs = GET_BE_U_2(nh->count);
+	/* The top two bits are the sampling mode. */
+	interval = GET_BE_U_2(nh->sampling_interval) & 0x3fff;
+	if (interval == 0)
+		interval = 1;
+	uptime = GET_BE_U_4(nh->msys_uptime);
+	now = (uint64_t)GET_BE_U_4(nh->utc_sec) * 1000000 +
+	    GET_BE_U_4(nh->utc_nsec) / 1000;
+	for (rp = (const u_char *)&nh[1]; nrecs != 0;
+	    rp += NFREC_V5_LEN, nrecs--) {
+		nr = (const struct nfrec_v5 *)rp;
+		memset(&key, 0, sizeof(key));
+		key.af = 4;
+		GET_CPY_BYTES(key.src, nr->src_ina, 4);
+		GET_CPY_BYTES(key.dst, nr->dst_ina, 4);
+		key.proto = GET_U_1(nr->proto);
+		/* For ICMP, the type and code are in the destination port. */
+		if (key.proto == IPPROTO_TCP || key.proto == IPPROTO_UDP)
+			key.sport = GET_BE_U_2(nr->srcport);
+		if (key.proto == IPPROTO_TCP || key.proto == IPPROTO_UDP ||
+		    key.proto == IPPROTO_ICMP)
+			key.dport = GET_BE_U_2(nr->dstport);
+		/* The times are of the exporter's uptime, in milliseconds. */
+		ago = (uint64_t)(uint32_t)(uptime -
+		    GET_BE_U_4(nr->start_time)) * 1000;
+		first = ago < now ? now - ago : now;
+		ago = (uint64_t)(uint32_t)(uptime -
+		    GET_BE_U_4(nr->last_time)) * 1000;
+		last = ago < now ? now - ago : now;
+		nd_flows_add(ndo, &key,
+		    (uint64_t)GET_BE_U_4(nr->packets) * interval,
+		    (uint64_t)GET_BE_U_4(nr->octets) * interval,
+		    first, last < first ? first : last,
+		    key.proto == IPPROTO_TCP ? GET_U_1(nr->tcp_flags) : 0);
+	}
+}
+
 static void
 cnfp_v5_print(netdissect_options *ndo, const u_char *cp)
 {
@@ -265,6 +329,11 @@ cnfp_v5_print(netdissect_options *ndo, const u_char *cp)
 	nh = (const struct nfhdr_v5 *)cp;
 	ND_TCHECK_SIZE(nh);
 
+	if (nd_flows_collecting(ndo)) {
+		cnfp_v5_collect(ndo, nh);
+		return;
+	}
+
 	ver = GET_BE_U_2(nh->version);
 	nrecs = GET_BE_U_4(nh->count);
 #if 0
@@ -459,8 +528,756 @@ trunc:
 	return;
 }
 
+/*
+ * NetFlow version 9 (RFC 3954) and IPFIX (RFC 7011) export packets
+ * carry templates, each giving the fields of the records of the data
+ * sets with its template ID, and the records can't be decoded without
+ * them.  The templates seen are kept, for each exporter and observation
+ * domain (v9 source ID), in a table carried from one packet to the
+ * next; each is turned, when it arrives, into a table of the offset,
+ * width and way of printing of each field, so the records of a data set
+ * are decoded without looking anything up again.
+ */
+#define NFHDR_V9_LEN		20
+#define IPFIX_HDR_LEN		16
+
+#define NF9_TEMPLATE_SET	0
+#define NF9_OPTIONS_SET		1
+#define IPFIX_TEMPLATE_SET	2
+#define IPFIX_OPTIONS_SET	3
+#define CNFP_MIN_DATA_SET	256
+
+#define IPFIX_VARLEN		65535	/* field length of variable length */
+#define IPFIX_ENTERPRISE	0x8000	/* field ID bit for a PEN after it */
+
+#define CNFP_TMPL_CHAINS	1024
+#define CNFP_MAX_TEMPLATES	4096
+
+/* How a field's value is printed. */
+#define CNFP_UINT		0
+#define CNFP_IPV4		1
+#define CNFP_IPV6		2
+#define CNFP_MAC		3
+#define CNFP_PROTO		4
+#define CNFP_STRING		5
+#define CNFP_BYTES		6
+
+struct cnfp_ie {
+	uint16_t	ie;
+	uint8_t		kind;
+	const char	*name;
+};
+
+/*
+ * The information elements with a name, from the IANA IPFIX registry;
+ * numbers below 128 are those of NetFlow v9 too.
+ */
+static const struct cnfp_ie cnfp_ies[] = {
+	{ 1, CNFP_UINT, "octetDeltaCount" },
+	{ 2, CNFP_UINT, "packetDeltaCount" },
+	{ 3, CNFP_UINT, "deltaFlowCount" },
+	{ 4, CNFP_PROTO, "protocolIdentifier" },
+	{ 5, CNFP_UINT, "ipClassOfService" },
+	{ 6, CNFP_UINT, "tcpControlBits" },
+	{ 7, CNFP_UINT, "sourceTransportPort" },
+	{ 8, CNFP_IPV4, "sourceIPv4Address" },
+	{ 9, CNFP_UINT, "sourceIPv4PrefixLength" },
+	{ 10, CNFP_UINT, "ingressInterface" },
+	{ 11, CNFP_UINT, "destinationTransportPort" },
+	{ 12, CNFP_IPV4, "destinationIPv4Address" },
+	{ 13, CNFP_UINT, "destinationIPv4PrefixLength" },
+	{ 14, CNFP_UINT, "egressInterface" },
+	{ 15, CNFP_IPV4, "ipNextHopIPv4Address" },
+	{ 16, CNFP_UINT, "bgpSourceAsNumber" },
+	{ 17, CNFP_UINT, "bgpDestinationAsNumber" },
+	{ 18, CNFP_IPV4, "bgpNextHopIPv4Address" },
+	{ 21, CNFP_UINT, "flowEndSysUpTime" },
+	{ 22, CNFP_UINT, "flowStartSysUpTime" },
+	{ 27, CNFP_IPV6, "sourceIPv6Address" },
+	{ 28, CNFP_IPV6, "destinationIPv6Address" },
+	{ 29, CNFP_UINT, "sourceIPv6PrefixLength" },
+	{ 30, CNFP_UINT, "destinationIPv6PrefixLength" },
+	{ 31, CNFP_UINT, "flowLabelIPv6" },
+	{ 32, CNFP_UINT, "icmpTypeCodeIPv4" },
+	{ 34, CNFP_UINT, "samplingInterval" },
+	{ 35, CNFP_UINT, "samplingAlgorithm" },
+	{ 56, CNFP_MAC, "sourceMacAddress" },
+	{ 58, CNFP_UINT, "vlanId" },
+	{ 60, CNFP_UINT, "ipVersion" },
+	{ 61, CNFP_UINT, "flowDirection" },
+	{ 62, CNFP_IPV6, "ipNextHopIPv6Address" },
+	{ 80, CNFP_MAC, "destinationMacAddress" },
+	{ 82, CNFP_STRING, "interfaceName" },
+	{ 83, CNFP_STRING, "interfaceDescription" },
+	{ 136, CNFP_UINT, "flowEndReason" },
+	{ 139, CNFP_UINT, "icmpTypeCodeIPv6" },
+	{ 148, CNFP_UINT, "flowId" },
+	{ 149, CNFP_UINT, "observationDomainId" },
+	{ 150, CNFP_UINT, "flowStartSeconds" },
+	{ 151, CNFP_UINT, "flowEndSeconds" },
+	{ 152, CNFP_UINT, "flowStartMilliseconds" },
+	{ 153, CNFP_UINT, "flowEndMilliseconds" },
+	{ 160, CNFP_UINT, "systemInitTimeMilliseconds" },
+	{ 0, 0, NULL }
+};
+
+/* The scope field types of NetFlow v9 options templates. */
+static const struct cnfp_ie cnfp_v9_scopes[] = {
+	{ 1, CNFP_UINT, "scopeSystem" },
+	{ 2, CNFP_UINT, "scopeInterface" },
+	{ 3, CNFP_UINT, "scopeLineCard" },
+	{ 4, CNFP_UINT, "scopeCache" },
+	{ 5, CNFP_UINT, "scopeTemplate" },
+	{ 0, 0, NULL }
+};
+
+struct cnfp_field {
+	uint32_t	pen;		/* enterprise number, or 0 */
+	uint16_t	ie;
+	uint16_t	len;		/* IPFIX_VARLEN for variable length */
+	u_int		off;		/* in records of fixed length */
+	u_int		kind;
+	const char	*name;		/* NULL if it hasn't one */
+};
+
+struct cnfp_tmpl_key {
+	u_char		exporter[16];	/* IPv4 or IPv6 source address */
+	uint32_t	domain;		/* observation domain or source ID */
+	uint16_t	id;
+	uint8_t		version;	/* 9 or 10 */
+	uint8_t		af;
+};
+
+struct cnfp_tmpl {
+	struct cnfp_tmpl_key key;
+	struct cnfp_tmpl *next;		/* on its hash chain */
+	struct cnfp_tmpl *older, *newer; /* in the order defined */
+	struct cnfp_field *fields;
+	u_int		nfields;
+	u_int		nscopes;	/* of an options template */
+	u_int		reclen;		/* of each record, or 0 if it varies */
+	u_int		minlen;		/* of the shortest record, 0 until laid out */
+};
+
+struct cnfp_tmpl_table {
+	struct cnfp_tmpl *chains[CNFP_TMPL_CHAINS];
+	struct cnfp_tmpl *oldest, *newest;
+	u_int		count;
+};
+
+static void
+cnfp_tmpl_table_free(netdissect_options *ndo, void *state)
+{
+	struct cnfp_tmpl_table *tab = (struct cnfp_tmpl_table *)state;
+	struct cnfp_tmpl *t, *older;
+
+	for (t = tab->newest; t != NULL; t = older) {
+		older = t->older;
+		nd_state_free(ndo, t->fields);
+		nd_state_free(ndo, t);
+	}
+	free(tab);
+}
+
+static const struct nd_state_type cnfp_tmpl_state_type = {
+	cnfp_tmpl_table_free
+};
+
+static uint32_t
+cnfp_tmpl_hash(const struct cnfp_tmpl_key *key)
+{
+	const u_char *p = (const u_char *)key;
+	uint32_t h = 2166136261U;
+	u_int i;
+
+	for (i = 0; i < sizeof(*key); i++)
+		h = (h ^ p[i]) * 16777619U;
+	return (h % CNFP_TMPL_CHAINS);
+}
+
+/*
+ * Fill in the key of template "id" of the export packet from the
+ * datagram "iph"; the exporter is left as zeroes if there's no IP
+ * header to take it from.
+ */
+static void
+cnfp_tmpl_key_init(netdissect_options *ndo, struct cnfp_tmpl_key *key,
+    const u_char *iph, u_int version, uint32_t domain, u_int id)
+{
+	const struct ip *ip = (const struct ip *)iph;
+	const struct ip6_hdr *ip6 = (const struct ip6_hdr *)iph;
+
+	memset(key, 0, sizeof(*key));
+	key->domain = domain;
+	key->id = (uint16_t)id;
+	key->version = (uint8_t)version;
+	if (iph == NULL)
+		return;
+	switch (IP_V(ip)) {
+	case 4:
+		key->af = 4;
+		GET_CPY_BYTES(key->exporter, ip->ip_src, sizeof(nd_ipv4));
+		break;
+	case 6:
+		key->af = 6;
+		GET_CPY_BYTES(key->exporter, ip6->ip6_src, sizeof(nd_ipv6));
+		break;
+	}
+}
+
+static struct cnfp_tmpl *
+cnfp_tmpl_find(netdissect_options *ndo, const struct cnfp_tmpl_key *key)
+{
+	const struct cnfp_tmpl_table *tab;
+	struct cnfp_tmpl *t;
+
+	tab = (const struct cnfp_tmpl_table *)*nd_state_slot(ndo,
+	    &cnfp_tmpl_state_type, &cnfp_tmpl_state_type);
+	if (tab == NULL)
+		return (NULL);
+	for (t = tab->chains[cnfp_tmpl_hash(key)]; t != NULL; t = t->next)
+		if (memcmp(&t->key, key, sizeof(*key)) == 0)
+			return (t);
+	return (NULL);
+}
+
+/* Take the template "t" out of the table, and free it. */
+static void
+cnfp_tmpl_remove(netdissect_options *ndo, struct cnfp_tmpl_table *tab,
+    struct cnfp_tmpl *t)
+{
+	struct cnfp_tmpl **tp;
+
+	for (tp = &tab->chains[cnfp_tmpl_hash(&t->key)]; *tp != t;
+	    tp = &(*tp)->next)
+		continue;
+	*tp = t->next;
+	if (t->older != NULL)
+		t->older->newer = t->newer;
+	else
+		tab->oldest = t->newer;
+	if (t->newer != NULL)
+		t->newer->older = t->older;
+	else
+		tab->newest = t->older;
+	tab->count--;
+	nd_state_free(ndo, t->fields);
+	nd_state_free(ndo, t);
+}
+
+/*
+ * Withdraw template "key", or, if "all" is set, all the templates of
+ * its exporter, observation domain and version.
+ */
+static void
+cnfp_tmpl_withdraw(netdissect_options *ndo, const struct cnfp_tmpl_key *key,
+    int all)
+{
+	struct cnfp_tmpl_table *tab;
+	struct cnfp_tmpl *t, *older;
+
+	tab = (struct cnfp_tmpl_table *)*nd_state_slot(ndo,
+	    &cnfp_tmpl_state_type, &cnfp_tmpl_state_type);
+	if (tab == NULL)
+		return;
+	for (t = tab->newest; t != NULL; t = older) {
+		older = t->older;
+		if (all ? (t->key.af == key->af &&
+		    memcmp(t->key.exporter, key->exporter,
+		    sizeof(key->exporter)) == 0 &&
+		    t->key.domain == key->domain &&
+		    t->key.version == key->version) :
+		    memcmp(&t->key, key, sizeof(*key)) == 0)
+			cnfp_tmpl_remove(ndo, tab, t);
+	}
+}
+
+/*
+ * Make the entry for template "key", with room for "nfields" fields,
+ * replacing any it had, and evicting the template defined longest ago
+ * if the table is full.  Returns NULL if there's no memory for it; the
+ * template then isn't kept.
+ */
+static struct cnfp_tmpl *
+cnfp_tmpl_add(netdissect_options *ndo, const struct cnfp_tmpl_key *key,
+    u_int nfields)
+{
+	struct cnfp_tmpl_table *tab;
+	struct cnfp_tmpl *t;
+	void **slot;
+	uint32_t h;
+
+	slot = nd_state_slot(ndo, &cnfp_tmpl_state_type,
+	    &cnfp_tmpl_state_type);
+	if ((tab = (struct cnfp_tmpl_table *)*slot) == NULL) {
+		tab = (struct cnfp_tmpl_table *)calloc(1, sizeof(*tab));
+		if (tab == NULL)
+			(*ndo->ndo_error)(ndo, S_ERR_ND_MEM_ALLOC,
+			    "%s: calloc", __func__);
+		*slot = tab;
+	}
+	if ((t = cnfp_tmpl_find(ndo, key)) != NULL)
+		cnfp_tmpl_remove(ndo, tab, t);
+	if (tab->count >= CNFP_MAX_TEMPLATES)
+		cnfp_tmpl_remove(ndo, tab, tab->oldest);
+
+	t = (struct cnfp_tmpl *)nd_state_calloc(ndo, 1, sizeof(*t));
+	if (t == NULL)
+		return (NULL);
+	t->fields = (struct cnfp_field *)nd_state_calloc(ndo, nfields,
+	    sizeof(*t->fields));
+	if (t->fields == NULL) {
+		nd_state_free(ndo, t);
+		return (NULL);
+	}
+	t->key = *key;
+	t->nfields = nfields;
+	h = cnfp_tmpl_hash(key);
+	t->next = tab->chains[h];
+	tab->chains[h] = t;
+	t->older = tab->newest;
+	if (tab->newest != NULL)
+		tab->newest->newer = t;
+	else
+		tab->oldest = t;
+	tab->newest = t;
+	tab->count++;
+	return (t);
+}
+
+/*
+ * Work out how a field is printed, from its information element and
+ * width, once, when its template arrives.
+ */
+static void
+cnfp_field_compile(struct cnfp_field *f, int v9_scope)
+{
+	const struct cnfp_ie *ie;
+
+	f->name = NULL;
+	f->kind = CNFP_BYTES;
+	if (f->pen == 0) {
+		for (ie = v9_scope ? cnfp_v9_scopes : cnfp_ies;
+		    ie->name != NULL; ie++) {
+			if (ie->ie == f->ie) {
+				f->name = ie->name;
+				f->kind = ie->kind;
+				break;
+			}
+		}
+	}
+	switch (f->kind) {
+	case CNFP_IPV4:
+		if (f->len != 4)
+			f->kind = CNFP_BYTES;
+		break;
+	case CNFP_IPV6:
+		if (f->len != 16)
+			f->kind = CNFP_BYTES;
+		break;
+	case CNFP_MAC:
+		if (f->len != 6)
+			f->kind = CNFP_BYTES;
+		break;
+	case CNFP_STRING:
+		break;
+	default:
+		/* Unsigned integers may be sent in fewer bytes (reduced size encoding). */
+		if (f->len >= 1 && f->len <= 8)
+			f->kind = f->kind == CNFP_PROTO ? CNFP_PROTO : CNFP_UINT;
+		else
+			f->kind = CNFP_BYTES;
+		break;
+	}
+}
+
+/*
+ * Lay out the fields of template "t": their offsets, if its records are
+ * all the same length, and the length of its records.
+ */
+static void
+cnfp_tmpl_compile(struct cnfp_tmpl *t)
+{
+	struct cnfp_field *f;
+	u_int i, off = 0, varlen = 0;
+
+	for (i = 0; i < t->nfields; i++) {
+		f = &t->fields[i];
+		f->off = off;
+		if (f->len == IPFIX_VARLEN) {
+			varlen = 1;
+			off++;
+		} else
+			off += f->len;
+	}
+	t->minlen = off;
+	t->reclen = varlen ? 0 : off;
+}
+
+static void
+cnfp_field_name_print(netdissect_options *ndo, const struct cnfp_field *f)
+{
+	if (f->name != NULL)
+		ND_PRINT("%s", f->name);
+	else if (f->pen != 0)
+		ND_PRINT("pen%u:ie%u", f->pen, f->ie);
+	else
+		ND_PRINT("ie%u", f->ie);
+}
+
+/* Print the value, "len" bytes at "p", of field "f" of a record. */
+static void
+cnfp_field_print(netdissect_options *ndo, const struct cnfp_field *f,
+    const u_char *p, u_int len)
+{
+	const char *p_name;
+	uint64_t v;
+	u_int i;
+
+	cnfp_field_name_print(ndo, f);
+	ND_PRINT(" ");
+	switch (f->kind) {
+	case CNFP_UINT:
+	case CNFP_PROTO:
+		switch (len) {
+		case 1:
+			v = GET_U_1(p);
+			break;
+		case 2:
+			v = GET_BE_U_2(p);
+			break;
+		case 4:
+			v = GET_BE_U_4(p);
+			break;
+		case 8:
+			v = GET_BE_U_8(p);
+			break;
+		default:
+			for (v = 0, i = 0; i < len; i++)
+				v = (v << 8) | GET_U_1(p + i);
+			break;
+		}
+		if (f->kind == CNFP_PROTO && !ndo->ndo_nflag &&
+		    (p_name = netdb_protoname((uint8_t)v)) != NULL)
+			ND_PRINT("%s", p_name);
+		else
+			ND_PRINT("%" PRIu64, v);
+		break;
+	case CNFP_IPV4:
+		ND_PRINT("%s", GET_IPADDR_STRING(p));
+		break;
+	case CNFP_IPV6:
+		ND_PRINT("%s", GET_IP6ADDR_STRING(p));
+		break;
+	case CNFP_MAC:
+		ND_PRINT("%s", GET_ETHERADDR_STRING(p));
+		break;
+	case CNFP_STRING:
+		ND_PRINT("\"");
+		(void)nd_printzp(ndo, p, len, ndo->ndo_snapend);
+		ND_PRINT("\"");
+		break;
+	default:
+		ND_PRINT("0x");
+		for (i = 0; i < len; i++)
+			ND_PRINT("%02x", GET_U_1(p + i));
+		break;
+	}
+}
+
+/*
+ * Print the records of a data set, "len" bytes at "cp", with template
+ * "t"; whatever is left that's shorter than a record is padding.
+ */
+static void
+cnfp_data_print(netdissect_options *ndo, const struct cnfp_tmpl *t,
+    const u_char *cp, u_int len)
+{
+	const struct cnfp_field *f, *fend = t->fields + t->nfields;
+	u_int flen;
+
+	if (t->reclen != 0) {
+		/* Every field is at its offset in the record. */
+		ND_PRINT(", %u recs", len / t->reclen);
+		for (; len >= t->reclen; cp += t->reclen, len -= t->reclen) {
+			ND_TCHECK_LEN(cp, t->reclen);
+			ND_PRINT("\n    ");
+			for (f = t->fields; f < fend; f++) {
+				if (f != t->fields)
+					ND_PRINT(", ");
+				cnfp_field_print(ndo, f, cp + f->off, f->len);
+			}
+		}
+		return;
+	}
+
+	/* Some field is of variable length; go through them in turn. */
+	while (len >= t->minlen) {
+		ND_PRINT("\n    ");
+		for (f = t->fields; f < fend; f++) {
+			flen = f->len;
+			if (flen == IPFIX_VARLEN) {
+				if (len < 1)
+					goto bad;
+				flen = GET_U_1(cp);
+				cp++;
+				len--;
+				if (flen == 255) {
+					if (len < 2)
+						goto bad;
+					flen = GET_BE_U_2(cp);
+					cp += 2;
+					len -= 2;
+				}
+			}
+			if (len < flen)
+				goto bad;
+			if (f != t->fields)
+				ND_PRINT(", ");
+			cnfp_field_print(ndo, f, cp, flen);
+			cp += flen;
+			len -= flen;
+		}
+	}
+	return;
+
+bad:
+	nd_print_invalid(ndo);
+	return;
+
+trunc:
+	nd_print_trunc(ndo);
+}
+
+/*
+ * Print, and keep, the templates of a template or options template set,
+ * "len" bytes at "cp", of an export packet of version "ver".  Returns
+ * -1 if the set is too short for what it says.
+ */
+static int
+cnfp_template_set_print(netdissect_options *ndo, const u_char *cp, u_int len,
+    u_int ver, const u_char *iph, uint32_t domain, int options)
+{
+	struct cnfp_tmpl_key key;
+	struct cnfp_tmpl *t;
+	struct cnfp_field *f;
+	u_int id, nfields, nscopes, hlen, fid, flen, i, off;
+	uint32_t pen;
+
+	while (len >= 4) {
+		/* The header of a template record, before its fields. */
+		t = NULL;
+		id = GET_BE_U_2(cp);
+		hlen = 4;
+		nscopes = 0;
+		if (ver == 9 && options) {
+			/* The lengths, in bytes, of the scope and option fields. */
+			if (len < 6)
+				break;
+			nscopes = GET_BE_U_2(cp + 2) / 4;
+			nfields = nscopes + GET_BE_U_2(cp + 4) / 4;
+			hlen = 6;
+		} else {
+			nfields = GET_BE_U_2(cp + 2);
+			if (options && nfields != 0) {
+				if (len < 6)
+					goto invalid;
+				nscopes = GET_BE_U_2(cp + 4);
+				hlen = 6;
+			}
+		}
+		if (nfields == 0 && ver == 9) {
+			/* The padding at the end of the set. */
+			break;
+		}
+		cp += hlen;
+		len -= hlen;
+		cnfp_tmpl_key_init(ndo, &key, iph, ver, domain, id);
+
+		if (nfields == 0) {
+			/* An IPFIX template withdrawal. */
+			ND_PRINT("\n  withdraw template %u", id);
+			cnfp_tmpl_withdraw(ndo, &key,
+			    id == IPFIX_TEMPLATE_SET || id == IPFIX_OPTIONS_SET);
+			continue;
+		}
+		if (options)
+			ND_PRINT("\n  options template %u, %u scopes, %u fields",
+			    id, nscopes, nfields);
+		else
+			ND_PRINT("\n  template %u, %u fields", id, nfields);
+		if (id < CNFP_MIN_DATA_SET || nscopes > nfields)
+			goto invalid;
+
+		t = cnfp_tmpl_add(ndo, &key, nfields);
+		for (i = 0; i < nfields; i++) {
+			if (len < 4)
+				goto invalid;
+			fid = GET_BE_U_2(cp);
+			flen = GET_BE_U_2(cp + 2);
+			off = 4;
+			pen = 0;
+			if (ver != 9 && (fid & IPFIX_ENTERPRISE)) {
+				if (len < 8)
+					goto invalid;
+				fid &= ~IPFIX_ENTERPRISE;
+				pen = GET_BE_U_4(cp + 4);
+				off = 8;
+			}
+			cp += off;
+			len -= off;
+			if (t != NULL) {
+				f = &t->fields[i];
+				f->ie = (uint16_t)fid;
+				f->len = (uint16_t)flen;
+				f->pen = pen;
+				cnfp_field_compile(f, ver == 9 && i < nscopes);
+				if (ndo->ndo_vflag) {
+					ND_PRINT("\n    ");
+					cnfp_field_name_print(ndo, f);
+					if (flen == IPFIX_VARLEN)
+						ND_PRINT("/var");
+					else
+						ND_PRINT("/%u", flen);
+				}
+			}
+		}
+		if (t != NULL) {
+			t->nscopes = nscopes;
+			cnfp_tmpl_compile(t);
+			if (t->minlen == 0) {
+				/* Its records would be of no bytes. */
+				cnfp_tmpl_withdraw(ndo, &key, 0);
+				nd_print_invalid(ndo);
+			}
+		} else
+			ND_PRINT(" (not kept)");
+	}
+	return (0);
+
+invalid:
+	/* Don't keep what there was of it. */
+	if (t != NULL)
+		cnfp_tmpl_withdraw(ndo, &key, 0);
+	nd_print_invalid(ndo);
+	return (-1);
+}
+
+/*
+ * Print the sets of a NetFlow v9 or IPFIX export packet, "len" bytes
+ * at "cp", after its header.
+ */
+static void
+cnfp_sets_print(netdissect_options *ndo, const u_char *cp, u_int len,
+    u_int ver, const u_char *iph, uint32_t domain)
+{
+	struct cnfp_tmpl_key key;
+	const struct cnfp_tmpl *t;
+	u_int id, slen;
+
+	while (len >= 4) {
+		id = GET_BE_U_2(cp);
+		slen = GET_BE_U_2(cp + 2);
+		if (slen < 4 || slen > len) {
+			ND_PRINT("\n  set %u, length %u", id, slen);
+			nd_print_invalid(ndo);
+			return;
+		}
+		switch (id) {
+
+		case NF9_TEMPLATE_SET:
+		case NF9_OPTIONS_SET:
+		case IPFIX_TEMPLATE_SET:
+		case IPFIX_OPTIONS_SET:
+			if ((ver == 9) != (id <= NF9_OPTIONS_SET)) {
+				ND_PRINT("\n  set %u, length %u", id, slen);
+				nd_print_invalid(ndo);
+				break;
+			}
+			(void)cnfp_template_set_print(ndo, cp + 4, slen - 4,
+			    ver, iph, domain,
+			    id == NF9_OPTIONS_SET || id == IPFIX_OPTIONS_SET);
+			break;
+
+		default:
+			if (id < CNFP_MIN_DATA_SET) {
+				ND_PRINT("\n  set %u, length %u", id, slen);
+				break;
+			}
+			ND_PRINT("\n  data %u", id);
+			cnfp_tmpl_key_init(ndo, &key, iph, ver, domain, id);
+			/*
+			 * A template that turned out to be truncated is
+			 * left with its records of no length.
+			 */
+			if ((t = cnfp_tmpl_find(ndo, &key)) == NULL ||
+			    t->minlen == 0) {
+				ND_PRINT(", %u bytes, no template", slen - 4);
+				break;
+			}
+			cnfp_data_print(ndo, t, cp + 4, slen - 4);
+			break;
+		}
+		cp += slen;
+		len -= slen;
+	}
+}
+
+static void
+cnfp_v9_print(netdissect_options *ndo, const u_char *cp, u_int length,
+    const u_char *iph)
+{
+	uint32_t uptime, domain;
+
+	ND_TCHECK_LEN(cp, NFHDR_V9_LEN);
+	uptime = GET_BE_U_4(cp + 4);
+	domain = GET_BE_U_4(cp + 16);
+	ND_PRINT("NetFlow v9, %u.%03u uptime, %u, #%u, source %u, %u recs",
+	    uptime / 1000, uptime % 1000, GET_BE_U_4(cp + 8),
+	    GET_BE_U_4(cp + 12), domain, GET_BE_U_2(cp + 2));
+	if (length < NFHDR_V9_LEN)
+		goto invalid;
+	cnfp_sets_print(ndo, cp + NFHDR_V9_LEN, length - NFHDR_V9_LEN, 9,
+	    iph, domain);
+	return;
+
+invalid:
+	nd_print_invalid(ndo);
+	return;
+
+trunc:
+	nd_print_trunc(ndo);
+}
+
+static void
+cnfp_ipfix_print(netdissect_options *ndo, const u_char *cp, u_int length,
+    const u_char *iph)
+{
+	uint32_t domain;
+	u_int mlen;
+
+	ND_TCHECK_LEN(cp, IPFIX_HDR_LEN);
+	mlen = GET_BE_U_2(cp + 2);
+	domain = GET_BE_U_4(cp + 12);
+	ND_PRINT("IPFIX, length %u, %u, #%u, domain %u", mlen,
+	    GET_BE_U_4(cp + 4), GET_BE_U_4(cp + 8), domain);
+	if (mlen < IPFIX_HDR_LEN || mlen > length)
+		goto invalid;
+	cnfp_sets_print(ndo, cp + IPFIX_HDR_LEN, mlen - IPFIX_HDR_LEN, 10,
+	    iph, domain);
+	return;
+
+invalid:
+	nd_print_invalid(ndo);
+	return;
+
+trunc:
+	nd_print_trunc(ndo);
+}
+
 void
-cnfp_print(netdissect_options *ndo, const u_char *cp)
+cnfp_print(netdissect_options *ndo, const u_char *cp, u_int length,
+    const u_char *iph)
 {
 	int ver;
 
@@ -484,6 +1301,14 @@ cnfp_print(netdissect_options *ndo, const u_char *cp)
 		cnfp_v6_print(ndo, cp);
 		break;
 
+	case 9:
+		cnfp_v9_print(ndo, cp, length, iph);
+		break;
+
+	case 10:
+		cnfp_ipfix_print(ndo, cp, length, iph);
+		break;
+
 	default:
 		ND_PRINT("NetFlow v%x", ver);
 		break;
@@ -1214,7 +1214,7 @@ print_reason(netdissect_options *ndo,
 	ND_PRINT("%s ", tok2str(reason2str, "reason-%u", reason));
 }
 
-const char *
+char *
 dnnum_string(netdissect_options *ndo, u_short dnaddr)
 {
 	char *str;
@@ -1222,7 +1222,7 @@ dnnum_string(netdissect_options *ndo, u_short dnaddr)
 	u_int area = (u_short)(dnaddr & AREAMASK) >> AREASHIFT;
 	u_int node = dnaddr & NODEMASK;
 
-	/* malloc() return used by the 'dnaddrtable' hash table: do not free() */
+	/* The caller frees it; dnaddr_string() keeps a copy in the name arena. */
 	str = (char *)malloc(siz = sizeof("00.0000"));
 	if (str == NULL)
 		(*ndo->ndo_error)(ndo, S_ERR_ND_MEM_ALLOC, "dnnum_string: malloc");
@@ -49,12 +49,15 @@
 
 #include "netdissect-stdinc.h"
 
+#include <stddef.h>
 #include <stdio.h>
 #include <string.h>
 
 #include "netdissect.h"
 #include "addrtoname.h"
+#include "callcache.h"
 #include "extract.h"
+#include "latency.h"
 
 /* lease duration */
 #define DHCP6_DURATION_INFINITE 0xffffffff
@@ -785,6 +788,223 @@ trunc:
 	nd_print_trunc(ndo);
 }
 
+/*
+ * Find the option of type "type" among the options from "cp" to "ep",
+ * without printing anything; returns a pointer to its data, and its
+ * length in "lenp", or NULL if it's not there.
+ */
+static const u_char *
+dhcp6opt_find(netdissect_options *ndo, const u_char *cp, const u_char *ep,
+    u_int type, u_int *lenp)
+{
+	u_int opttype, optlen;
+
+	while (ND_BYTES_BETWEEN(ep, cp) >= sizeof(struct dhcp6opt) &&
+	    ND_TTEST_4(cp)) {
+		opttype = GET_BE_U_2(cp);
+		optlen = GET_BE_U_2(cp + 2);
+		cp += sizeof(struct dhcp6opt);
+		if (optlen > ND_BYTES_BETWEEN(ep, cp))
+			break;
+		if (opttype == type) {
+			*lenp = optlen;
+			return (cp);
+		}
+		cp += optlen;
+	}
+	return (NULL);
+}
+
+/*
+ * The messages of clients are kept in a call cache, by transaction ID
+ * and client DUID, so that the advertise or reply that answers one can
+ * be timed.  Only the start of a long DUID is kept in the key.
+ */
+#define DHCP6_XACT_DUIDLEN	20
+
+struct dhcp6_xact_key {
+	uint32_t xid;
+	uint8_t duidlen;
+	uint8_t duid[DHCP6_XACT_DUIDLEN];
+};
+
+struct dhcp6_xact_entry {
+	struct callcache_entry ce;
+	struct dhcp6_xact_key key;
+	uint8_t type;		/* message type of the request */
+	uint8_t answered;	/* its first answer has been counted */
+};
+
+#define DHCP6_XACT_TIMEOUT	60
+
+static const struct callcache_type dhcp6_xact_type = {
+	sizeof(struct dhcp6_xact_entry),
+	offsetof(struct dhcp6_xact_entry, key),
+	sizeof(struct dhcp6_xact_key),
+	DHCP6_XACT_TIMEOUT
+};
+
+/*
+ * Print a DUID as a MAC address if it's made from an Ethernet address,
+ * else in hex, up to "DHCP6_XACT_DUIDLEN" bytes of it.
+ */
+static void
+dhcp6_duid_print(netdissect_options *ndo, const u_char *cp, u_int len)
+{
+	u_int duidtype, i;
+
+	if (len >= 2 && ND_TTEST_LEN(cp, len)) {
+		duidtype = GET_BE_U_2(cp);
+		if (duidtype == 1 && len == 14 && GET_BE_U_2(cp + 2) == 1) {
+			ND_PRINT("%s", GET_ETHERADDR_STRING(cp + 8));
+			return;
+		}
+		if (duidtype == 3 && len == 10 && GET_BE_U_2(cp + 2) == 1) {
+			ND_PRINT("%s", GET_ETHERADDR_STRING(cp + 4));
+			return;
+		}
+	}
+	for (i = 0; i < len && i < DHCP6_XACT_DUIDLEN; i++)
+		ND_PRINT("%02x", GET_U_1(cp + i));
+	if (i < len)
+		ND_PRINT("...");
+}
+
+#define DHCP6_MAX_RELAYS	32	/* HOP_COUNT_LIMIT in RFC 8415 */
+
+/*
+ * --dhcp-events and --latency-report: look through any relay messages
+ * for the client's message, find its client and server identifiers and
+ * first address and prefix, without printing the options, enter it in
+ * the call cache if it's from a client or time it if it answers one,
+ * and, with --dhcp-events, print it on one line.
+ */
+static void
+dhcp6_events(netdissect_options *ndo, const u_char *cp, const u_char *ep)
+{
+	const u_char *opts, *clientid, *serverid, *addr, *prefix, *ia;
+	u_int msgtype, relays, len, clientidlen, serveridlen, ialen;
+	struct dhcp6_xact_entry *dxe;
+	struct dhcp6_xact_key key;
+	uint64_t us;
+	int timed = 0;
+
+	/* Look for the relayed message in each relay message */
+	msgtype = GET_U_1(cp);
+	for (relays = 0;
+	    (msgtype == DH6_RELAY_FORW || msgtype == DH6_RELAY_REPLY) &&
+	    relays < DHCP6_MAX_RELAYS; relays++) {
+		if (ND_BYTES_BETWEEN(ep, cp) < sizeof(struct dhcp6_relay))
+			goto trunc;
+		opts = dhcp6opt_find(ndo, cp + sizeof(struct dhcp6_relay), ep,
+		    DH6OPT_RELAY_MSG, &len);
+		if (opts == NULL || len < sizeof(struct dhcp6) ||
+		    !ND_TTEST_1(opts)) {
+			if (ndo->ndo_dhcp_events)
+				ND_PRINT(" %s",
+				    tok2str(dh6_msgtype_str, "msgtype-%u",
+				    msgtype));
+			return;
+		}
+		cp = opts;
+		ep = opts + len;
+		msgtype = GET_U_1(cp);
+	}
+	if (ND_BYTES_BETWEEN(ep, cp) < sizeof(struct dhcp6) ||
+	    msgtype == DH6_RELAY_FORW || msgtype == DH6_RELAY_REPLY)
+		goto trunc;
+
+	opts = cp + sizeof(struct dhcp6);
+	clientid = dhcp6opt_find(ndo, opts, ep, DH6OPT_CLIENTID, &clientidlen);
+	serverid = dhcp6opt_find(ndo, opts, ep, DH6OPT_SERVERID, &serveridlen);
+	addr = prefix = NULL;
+	ia = dhcp6opt_find(ndo, opts, ep, DH6OPT_IA_NA, &ialen);
+	if (ia != NULL && ialen >= 12)
+		addr = dhcp6opt_find(ndo, ia + 12, ia + ialen,
+		    DH6OPT_IA_ADDR, &len);
+	else if ((ia = dhcp6opt_find(ndo, opts, ep, DH6OPT_IA_TA,
+	    &ialen)) != NULL && ialen >= 4)
+		addr = dhcp6opt_find(ndo, ia + 4, ia + ialen,
+		    DH6OPT_IA_ADDR, &len);
+	if (addr != NULL && (len < 16 || !ND_TTEST_16(addr)))
+		addr = NULL;
+	ia = dhcp6opt_find(ndo, opts, ep, DH6OPT_IA_PD, &ialen);
+	if (ia != NULL && ialen >= 12)
+		prefix = dhcp6opt_find(ndo, ia + 12, ia + ialen,
+		    DH6OPT_IA_PD_PREFIX, &len);
+	if (prefix != NULL && (len < 25 || !ND_TTEST_LEN(prefix, 25)))
+		prefix = NULL;
+
+	memset(&key, 0, sizeof(key));
+	key.xid = GET_BE_U_4(cp) & DH6_XIDMASK;
+	if (clientid != NULL) {
+		key.duidlen = (uint8_t)min(clientidlen, sizeof(key.duid));
+		if (!ND_TTEST_LEN(clientid, key.duidlen))
+			goto trunc;
+		memcpy(key.duid, clientid, key.duidlen);
+	}
+	us = 0;
+	switch (msgtype) {
+	case DH6_SOLICIT:
+	case DH6_REQUEST:
+	case DH6_CONFIRM:
+	case DH6_RENEW:
+	case DH6_REBIND:
+	case DH6_RELEASE:
+	case DH6_DECLINE:
+	case DH6_INFORM_REQ:
+		dxe = (struct dhcp6_xact_entry *)callcache_enter(ndo,
+		    &dhcp6_xact_type, &key);
+		if (dxe != NULL)
+			dxe->type = (uint8_t)msgtype;
+		break;
+	case DH6_ADVERTISE:
+	case DH6_REPLY:
+		dxe = (struct dhcp6_xact_entry *)callcache_find(ndo,
+		    &dhcp6_xact_type, &key);
+		if (dxe == NULL ||
+		    (msgtype == DH6_ADVERTISE && dxe->type != DH6_SOLICIT))
+			break;
+		timed = 1;
+		if (ndo->ndo_latency && !dxe->answered)
+			us = latency_record(ndo, "dhcp6",
+			    tok2str(dh6_msgtype_str, "msgtype-%u", dxe->type),
+			    dxe->ce.cce_ts);
+		else
+			us = latency_elapsed(ndo, dxe->ce.cce_ts);
+		dxe->answered = 1;
+		break;
+	}
+	if (!ndo->ndo_dhcp_events)
+		return;
+
+	ND_PRINT(" %s", tok2str(dh6_msgtype_str, "msgtype-%u", msgtype));
+	if (relays != 0)
+		ND_PRINT(" (relayed)");
+	ND_PRINT(", xid 0x%x", key.xid);
+	if (clientid != NULL) {
+		ND_PRINT(", client ");
+		dhcp6_duid_print(ndo, clientid, clientidlen);
+	}
+	if (addr != NULL)
+		ND_PRINT(", address %s", GET_IP6ADDR_STRING(addr));
+	if (prefix != NULL)
+		ND_PRINT(", prefix %s/%u", GET_IP6ADDR_STRING(prefix + 9),
+		    GET_U_1(prefix + 8));
+	if (serverid != NULL) {
+		ND_PRINT(", server ");
+		dhcp6_duid_print(ndo, serverid, serveridlen);
+	}
+	if (timed)
+		ND_PRINT(", %" PRIu64 ".%03u ms", us / 1000,
+		    (u_int)(us % 1000));
+	return;
+
+trunc:
+	if (ndo->ndo_dhcp_events)
+		nd_print_trunc(ndo);
+}
+
 /*
  * Print dhcp6 packets
  */
@@ -812,6 +1032,12 @@ dhcp6_print(netdissect_options *ndo,
 	msgtype = GET_U_1(dh6->dh6_msgtypexid.msgtype);
 	name = tok2str(dh6_msgtype_str, "msgtype-%u", msgtype);
 
+	if (ndo->ndo_dhcp_events || ndo->ndo_latency) {
+		dhcp6_events(ndo, cp, ep);
+		if (ndo->ndo_dhcp_events)
+			return;
+	}
+
 	if (!ndo->ndo_vflag) {
 		ND_PRINT(" %s", name);
 		return;
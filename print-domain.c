@@ -27,13 +27,22 @@
 
 #include "netdissect-stdinc.h"
 
+#include <stddef.h>
 #include <string.h>
 
+#include "netdissect-ctype.h"
+
 #include "netdissect.h"
+#include "netdissect-alloc.h"
+#include "netdissect-fields.h"
 #include "addrtoname.h"
 #include "addrtostr.h"
+#include "callcache.h"
 #include "extract.h"
+#include "latency.h"
 
+#include "ip.h"
+#include "ip6.h"
 #include "nameser.h"
 
 static const char *ns_ops[] = {
@@ -53,7 +62,7 @@ static const char *ns_resp[] = {
 
 static const char *
 ns_rcode(u_int rcode) {
-	static char buf[sizeof(" Resp4095")];
+	static ND_THREAD_LOCAL char buf[sizeof(" Resp4095")];
 
 	if (rcode < sizeof(ns_resp)/sizeof(ns_resp[0])) {
 		return (ns_resp[rcode]);
@@ -161,16 +170,147 @@ labellen(netdissect_options *ndo,
 		return(i);
 }
 
-/* print a <domain-name> */
-const u_char *
-fqdn_print(netdissect_options *ndo,
-          const u_char *cp, const u_char *bp)
+/*
+ * Names already printed in the message being printed by domain_print(),
+ * by the offset in the message of the label they start with, as the
+ * text they were printed as.  Compression pointers point back to names
+ * and the ends of names seen before, so most names after the first few
+ * are printed from here rather than by going through their labels and
+ * pointers again.
+ *
+ * The slots are valid for the message whose generation dns_names_gen
+ * they have; the text is in the per-packet arena.  The name starting
+ * at a given offset is printed the same way wherever a pointer to it
+ * is found, as a pointer can only point back from where it is and so
+ * the pointers in the name are checked the same way, so only names
+ * that were printed whole are entered.
+ */
+#define DNS_NAME_SLOTS	256		/* a power of 2 */
+#define DNS_NAME_MAXTEXT	1024
+#define DNS_NAME_MAXLABELS	128
+
+struct dns_name {
+	u_int dn_gen;
+	u_int dn_offset;
+	const char *dn_text;
+};
+
+static ND_THREAD_LOCAL struct dns_name dns_names[DNS_NAME_SLOTS];
+static ND_THREAD_LOCAL u_int dns_names_gen;
+static ND_THREAD_LOCAL u_int dns_names_count;
+
+static struct dns_name *
+dns_name_slot(u_int offset)
+{
+	struct dns_name *dn;
+	u_int h = (offset * 2654435761U) >> 24;
+
+	for (;; h++) {
+		dn = &dns_names[h & (DNS_NAME_SLOTS - 1)];
+		if (dn->dn_gen != dns_names_gen || dn->dn_offset == offset)
+			return (dn);
+	}
+}
+
+/* Start a new message; forget the names of the one before. */
+static void
+dns_names_reset(void)
+{
+	if (++dns_names_gen == 0) {
+		/* Don't take slots of 2^32 messages ago for valid. */
+		memset(dns_names, 0, sizeof(dns_names));
+		dns_names_gen = 1;
+	}
+	dns_names_count = 0;
+}
+
+/* The text a pointer to "offset" was printed as, or NULL. */
+static const char *
+dns_name_find(u_int offset)
+{
+	struct dns_name *dn = dns_name_slot(offset);
+
+	return (dn->dn_gen == dns_names_gen ? dn->dn_text : NULL);
+}
+
+/* Add the label "cp", of length "l", to "text" as nd_printn() prints it. */
+static int
+dns_name_append(netdissect_options *ndo, char *text, u_int *lenp,
+    const u_char *cp, u_int l)
+{
+	u_int len = *lenp;
+	u_char c;
+
+	for (; l != 0; l--, cp++) {
+		if (len + 5 > DNS_NAME_MAXTEXT)
+			return (0);
+		c = GET_U_1(cp);
+		if (!ND_ISASCII(c)) {
+			c = ND_TOASCII(c);
+			text[len++] = 'M';
+			text[len++] = '-';
+		}
+		if (!ND_ASCII_ISPRINT(c)) {
+			c ^= 0x40;
+			text[len++] = '^';
+		}
+		text[len++] = (char)c;
+	}
+	text[len++] = '.';
+	*lenp = len;
+	return (1);
+}
+
+/*
+ * Enter the name just printed as "text", and each name it ends with
+ * that starts in the labels at "offsets", whose text starts at "pos".
+ */
+static void
+dns_names_enter(netdissect_options *ndo, const char *text, u_int len,
+    const u_int *offsets, const u_int *pos, u_int nlabels)
+{
+	struct dns_name *dn;
+	char *t = NULL;
+	u_int i;
+
+	for (i = 0; i < nlabels; i++) {
+		if (dns_names_count >= DNS_NAME_SLOTS * 3 / 4)
+			return;
+		dn = dns_name_slot(offsets[i]);
+		if (dn->dn_gen == dns_names_gen)
+			continue;
+		if (t == NULL) {
+			t = (char *)nd_malloc(ndo, len + 1);
+			if (t == NULL)
+				return;
+			memcpy(t, text, len);
+			t[len] = '\0';
+		}
+		dn->dn_gen = dns_names_gen;
+		dn->dn_offset = offsets[i];
+		dn->dn_text = t + pos[i];
+		dns_names_count++;
+	}
+}
+
+/*
+ * Print a <domain-name>, using the names of the message being printed
+ * by domain_print() if "cached" is set.
+ */
+static const u_char *
+ns_nprint(netdissect_options *ndo,
+          const u_char *cp, const u_char *bp, int cached)
 {
 	u_int i, l;
 	const u_char *rp = NULL;
 	int compress = 0;
 	u_int elt;
 	u_int offset, max_offset;
+	char text[DNS_NAME_MAXTEXT];
+	u_int len = 0, nlabels = 0;
+	u_int offsets[DNS_NAME_MAXLABELS], pos[DNS_NAME_MAXLABELS];
+	const char *t;
+	int keep = cached;
 
 	if ((l = labellen(ndo, cp)) == (u_int)-1)
 		return(NULL);
@@ -208,6 +348,16 @@ fqdn_print(netdissect_options *ndo,
 					ND_PRINT("<BAD PTR>");
 					return(NULL);
 				}
+				if (cached && (t = dns_name_find(offset)) != NULL) {
+					ND_PRINT("%s", t);
+					l = (u_int)strlen(t);
+					if (keep && len + l <= DNS_NAME_MAXTEXT) {
+						memcpy(text + len, t, l);
+						dns_names_enter(ndo, text, len + l,
+						    offsets, pos, nlabels);
+					}
+					return (rp);
+				}
 				max_offset = offset;
 				cp = bp + offset;
 				if ((l = labellen(ndo, cp)) == (u_int)-1)
@@ -224,6 +374,8 @@ fqdn_print(netdissect_options *ndo,
 				case EDNS0_ELT_BITLABEL:
 					if (blabel_print(ndo, cp) == NULL)
 						return (NULL);
+					/* Not worth keeping. */
+					keep = 0;
 					break;
 				default:
 					/* unknown ELT */
@@ -233,6 +385,17 @@ fqdn_print(netdissect_options *ndo,
 			} else {
 				if (nd_printn(ndo, cp, l, ndo->ndo_snapend))
 					return(NULL);
+				if (keep) {
+					offset = (u_int)(cp - 1 - bp);
+					if (nlabels < DNS_NAME_MAXLABELS &&
+					    offset < 0x4000) {
+						offsets[nlabels] = offset;
+						pos[nlabels++] = len;
+					}
+					if (!dns_name_append(ndo, text, &len,
+					    cp, l))
+						keep = 0;
+				}
 			}
 
 			cp += l;
@@ -248,9 +411,20 @@ fqdn_print(netdissect_options *ndo,
 		}
 	else
 		ND_PRINT(".");
+	/* Only a name that was printed whole can be kept. */
+	if (keep && i == 0)
+		dns_names_enter(ndo, text, len, offsets, pos, nlabels);
 	return (rp);
 }
 
+/* print a <domain-name> */
+const u_char *
+fqdn_print(netdissect_options *ndo,
+          const u_char *cp, const u_char *bp)
+{
+	return (ns_nprint(ndo, cp, bp, 0));
+}
+
 /* print a <character-string> */
 static const u_char *
 ns_cprint(netdissect_options *ndo,
@@ -377,7 +551,7 @@ ns_qprint(netdissect_options *ndo,
 	}
 
 	ND_PRINT("? ");
-	cp = fqdn_print(ndo, np, bp);
+	cp = ns_nprint(ndo, np, bp, 1);
 	return(cp ? cp + 4 : NULL);
 }
 
@@ -392,7 +566,7 @@ ns_rprint(netdissect_options *ndo,
 
 	if (ndo->ndo_vflag) {
 		ND_PRINT(" ");
-		if ((cp = fqdn_print(ndo, cp, bp)) == NULL)
+		if ((cp = ns_nprint(ndo, cp, bp, 1)) == NULL)
 			return NULL;
 	} else
 		cp = ns_nskip(ndo, cp);
@@ -457,7 +631,7 @@ ns_rprint(netdissect_options *ndo,
 	case T_DNAME:
 #endif
 		ND_PRINT(" ");
-		if (fqdn_print(ndo, cp, bp) == NULL)
+		if (ns_nprint(ndo, cp, bp, 1) == NULL)
 			return(NULL);
 		break;
 
@@ -465,10 +639,10 @@ ns_rprint(netdissect_options *ndo,
 		if (!ndo->ndo_vflag)
 			break;
 		ND_PRINT(" ");
-		if ((cp = fqdn_print(ndo, cp, bp)) == NULL)
+		if ((cp = ns_nprint(ndo, cp, bp, 1)) == NULL)
 			return(NULL);
 		ND_PRINT(" ");
-		if ((cp = fqdn_print(ndo, cp, bp)) == NULL)
+		if ((cp = ns_nprint(ndo, cp, bp, 1)) == NULL)
 			return(NULL);
 		if (!ND_TTEST_LEN(cp, 5 * 4))
 			return(NULL);
@@ -487,7 +661,7 @@ ns_rprint(netdissect_options *ndo,
 		ND_PRINT(" ");
 		if (!ND_TTEST_2(cp))
 			return(NULL);
-		if (fqdn_print(ndo, cp + 2, bp) == NULL)
+		if (ns_nprint(ndo, cp + 2, bp, 1) == NULL)
 			return(NULL);
 		ND_PRINT(" %u", GET_BE_U_2(cp));
 		break;
@@ -506,7 +680,7 @@ ns_rprint(netdissect_options *ndo,
 		ND_PRINT(" ");
 		if (!ND_TTEST_6(cp))
 			return(NULL);
-		if (fqdn_print(ndo, cp + 6, bp) == NULL)
+		if (ns_nprint(ndo, cp + 6, bp, 1) == NULL)
 			return(NULL);
 		ND_PRINT(":%u %u %u", GET_BE_U_2(cp + 4),
 			  GET_BE_U_2(cp), GET_BE_U_2(cp + 2));
@@ -547,7 +721,7 @@ ns_rprint(netdissect_options *ndo,
 		}
 		if (pbit > 0) {
 			ND_PRINT(" ");
-			if (fqdn_print(ndo, cp + 1 + sizeof(a) - pbyte, bp) == NULL)
+			if (ns_nprint(ndo, cp + 1 + sizeof(a) - pbyte, bp, 1) == NULL)
 				return(NULL);
 		}
 		break;
@@ -581,7 +755,7 @@ ns_rprint(netdissect_options *ndo,
 		if (!ndo->ndo_vflag)
 			break;
 		ND_PRINT(" ");
-		if ((cp = fqdn_print(ndo, cp, bp)) == NULL)
+		if ((cp = ns_nprint(ndo, cp, bp, 1)) == NULL)
 			return(NULL);
 		cp += 6;
 		if (!ND_TTEST_2(cp))
@@ -609,6 +783,53 @@ ns_rprint(netdissect_options *ndo,
 	return (rp);		/* XXX This isn't always right */
 }
 
+/*
+ * Report the header and the first question of the message "bp" as
+ * fields (see netdissect-fields.h), rather than decoding it all for
+ * text that would be thrown away.
+ */
+static void
+domain_fields(netdissect_options *ndo, const u_char *bp)
+{
+	const dns_header_t *np = (const dns_header_t *)bp;
+	const u_char *cp;
+	const char *qname;
+	uint16_t flags;
+	u_int i;
+
+	flags = GET_BE_U_2(np->flags);
+	ND_FIELD_UINT(NDF_DOMAIN, NDF_DOMAIN_ID, GET_BE_U_2(np->id));
+	ND_FIELD_UINT(NDF_DOMAIN, NDF_DOMAIN_QR, DNS_QR(flags) != 0);
+	ND_FIELD_UINT(NDF_DOMAIN, NDF_DOMAIN_OPCODE, DNS_OPCODE(flags));
+	ND_FIELD_UINT(NDF_DOMAIN, NDF_DOMAIN_RCODE, DNS_RCODE(flags));
+	ND_FIELD_UINT(NDF_DOMAIN, NDF_DOMAIN_QDCOUNT, GET_BE_U_2(np->qdcount));
+	ND_FIELD_UINT(NDF_DOMAIN, NDF_DOMAIN_ANCOUNT, GET_BE_U_2(np->ancount));
+	ND_FIELD_UINT(NDF_DOMAIN, NDF_DOMAIN_NSCOUNT, GET_BE_U_2(np->nscount));
+	ND_FIELD_UINT(NDF_DOMAIN, NDF_DOMAIN_ARCOUNT, GET_BE_U_2(np->arcount));
+	if (GET_BE_U_2(np->qdcount) == 0)
+		return;
+
+	/* The name goes in the cache of names as it's "printed". */
+	cp = (const u_char *)(np + 1);
+	if (!ND_TTEST_1(cp))
+		return;
+	i = GET_U_1(cp);
+	if ((cp = ns_nprint(ndo, cp, bp, 1)) == NULL)
+		return;
+	if (i == 0)
+		qname = ".";
+	else if ((i & INDIR_MASK) == INDIR_MASK)
+		qname = dns_name_find(GET_BE_U_2(np + 1) & 0x3fff);
+	else
+		qname = dns_name_find(sizeof(*np));
+	if (qname != NULL)
+		ND_FIELD_STRING(NDF_DOMAIN, NDF_DOMAIN_QNAME, qname);
+	if (!ND_TTEST_4(cp))
+		return;
+	ND_FIELD_UINT(NDF_DOMAIN, NDF_DOMAIN_QTYPE, GET_BE_U_2(cp));
+	ND_FIELD_UINT(NDF_DOMAIN, NDF_DOMAIN_QCLASS, GET_BE_U_2(cp + 2));
+}
+
 void
 domain_print(netdissect_options *ndo,
          const u_char *bp, u_int length, int is_mdns)
@@ -622,6 +843,7 @@ domain_print(netdissect_options *ndo,
 
 	ndo->ndo_protocol = "domain";
 	np = (const dns_header_t *)bp;
+	dns_names_reset();
 
 	if(length < sizeof(*np)) {
 		nd_print_protocol(ndo);
@@ -631,6 +853,21 @@ domain_print(netdissect_options *ndo,
 	}
 
 	ND_TCHECK_SIZE(np);
+	if (ndo->ndo_field != NULL && ndo->ndo_dfilter == NULL) {
+		domain_fields(ndo, bp);
+		return;
+	}
+	if (ndo->ndo_field != NULL) {
+		/*
+		 * The message is printed as well for --display-filter;
+		 * take the name domain_fields() "prints" back out.
+		 */
+		size_t len = ndo->ndo_outbuf_len;
+
+		domain_fields(ndo, bp);
+		if (ndo->ndo_outbuf_len >= len)
+			ndo->ndo_outbuf_len = len;
+	}
 	flags = GET_BE_U_2(np->flags);
 	/* get the byte-order right */
 	qdcount = GET_BE_U_2(np->qdcount);
@@ -854,3 +1091,105 @@ domain_print(netdissect_options *ndo,
   trunc:
 	nd_print_trunc(ndo);
 }
+
+/*
+ * Queries seen, for --latency-report, so that the first response to one
+ * can be counted against the type of record it asked for.
+ */
+struct dns_query_key {
+	uint32_t id;
+	uint32_t ipver;
+	nd_ipv6 client;
+	nd_ipv6 server;
+	uint32_t cport;
+	uint32_t sport;
+};
+
+struct dns_query_entry {
+	struct callcache_entry ce;
+	struct dns_query_key key;
+	uint32_t qtype;
+	u_int answered;
+};
+
+#define DNS_QUERY_TIMEOUT	30
+
+static const struct callcache_type dns_query_type = {
+	sizeof(struct dns_query_entry),
+	offsetof(struct dns_query_entry, key),
+	sizeof(struct dns_query_key),
+	DNS_QUERY_TIMEOUT
+};
+
+/*
+ * Count the time to the first response to each query, by query type,
+ * for the DNS message "bp" from port "sport" to port "dport" of the
+ * IPv4 or IPv6 datagram "iph".  Nothing is printed, and a message that
+ * isn't all there is passed over.
+ */
+void
+domain_latency(netdissect_options *ndo, const u_char *bp, u_int length,
+    const u_char *iph, u_int sport, u_int dport)
+{
+	const dns_header_t *np = (const dns_header_t *)bp;
+	const struct ip *ip = (const struct ip *)iph;
+	const struct ip6_hdr *ip6 = (const struct ip6_hdr *)iph;
+	struct dns_query_entry *dqe;
+	struct dns_query_key key;
+	const u_char *cp;
+	uint64_t us;
+	uint16_t flags;
+	int response;
+
+	if (iph == NULL || length < sizeof(*np) || !ND_TTEST_SIZE(np))
+		return;
+	flags = GET_BE_U_2(np->flags);
+	response = DNS_QR(flags) != 0;
+	memset(&key, 0, sizeof(key));
+	key.ipver = IP_V(ip);
+	switch (key.ipver) {
+	case 4:
+		if (!ND_TTEST_SIZE(ip))
+			return;
+		memcpy(response ? &key.server : &key.client, ip->ip_src,
+		    sizeof(nd_ipv4));
+		memcpy(response ? &key.client : &key.server, ip->ip_dst,
+		    sizeof(nd_ipv4));
+		break;
+	case 6:
+		if (!ND_TTEST_SIZE(ip6))
+			return;
+		memcpy(response ? &key.server : &key.client, ip6->ip6_src,
+		    sizeof(nd_ipv6));
+		memcpy(response ? &key.client : &key.server, ip6->ip6_dst,
+		    sizeof(nd_ipv6));
+		break;
+	default:
+		return;
+	}
+	key.id = GET_BE_U_2(np->id);
+	key.cport = response ? dport : sport;
+	key.sport = response ? sport : dport;
+
+	if (response) {
+		dqe = (struct dns_query_entry *)callcache_find(ndo,
+		    &dns_query_type, &key);
+		if (dqe == NULL || dqe->answered)
+			return;
+		dqe->answered = 1;
+		us = latency_record(ndo, "domain",
+		    tok2str(ns_type2str, "Type%u", dqe->qtype),
+		    dqe->ce.cce_ts);
+		ND_FIELD_UINT(NDF_DOMAIN, NDF_DOMAIN_LATENCY, us);
+		return;
+	}
+	if (DNS_OPCODE(flags) != 0 || GET_BE_U_2(np->qdcount) != 1)
+		return;
+	cp = ns_nskip(ndo, (const u_char *)(np + 1));
+	if (cp == NULL || !ND_TTEST_2(cp))
+		return;
+	dqe = (struct dns_query_entry *)callcache_enter(ndo,
+	    &dns_query_type, &key);
+	if (dqe != NULL)
+		dqe->qtype = GET_BE_U_2(cp);
+}
@@ -33,6 +33,7 @@
 
 #include "netdissect.h"
 #include "extract.h"
+#include "change-only.h"
 #include "addrtoname.h"
 
 
@@ -241,6 +242,16 @@ eigrp_print(netdissect_options *ndo, const u_char *pptr, u_int len)
 	return;
     }
 
+    /*
+     * With --changes-only, a hello is a repeat if it's the same as the
+     * last one from the router for the AS.
+     */
+    if (ndo->ndo_changes_only &&
+        GET_U_1(eigrp_com_header->opcode) == EIGRP_OPCODE_HELLO &&
+        nd_change_repeat(ndo, ND_CHANGE_EIGRP, eigrp_com_header->asn, 4,
+                         nd_change_hash(ndo, ND_CHANGE_HASH_INIT, pptr, len)))
+        return;
+
     /* in non-verbose mode just lets print the basic Message Type*/
     if (ndo->ndo_vflag < 1) {
         ND_PRINT("EIGRP %s, length: %u",
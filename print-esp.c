@@ -45,6 +45,8 @@
 #endif
 
 #include "netdissect.h"
+#include "netdissect-alloc.h"
+#include "addrtostr.h"
 #include "strtoaddr.h"
 #include "extract.h"
 
@@ -104,6 +106,7 @@ union inaddr_u {
 };
 struct sa_list {
 	struct sa_list	*next;
+	struct sa_list	*hnext;       /* next in the same hash bucket */
 	u_int		daddr_version;
 	union inaddr_u	daddr;
 	uint32_t	spi;          /* if == 0, then IKEv2 */
@@ -117,8 +120,116 @@ struct sa_list {
 	int             authsecret_len;
 	u_char		secret[256];  /* is that big enough for all secrets? */
 	int		secretlen;
+	EVP_CIPHER_CTX	*ctx;         /* keyed with secret; NULL until used */
+	/* Sequence numbers seen, for the --stats-only replay summary */
+	uint64_t	seq_packets;
+	uint64_t	seq_replayed; /* already seen, within the window */
+	uint64_t	seq_late;     /* before the window */
+	uint32_t	seq_first;    /* lowest in or after the window */
+	uint32_t	seq_high;
+	uint64_t	seq_window;   /* bit n set if seq_high - n was seen */
 };
 
+/*
+ * The replay window, as RFC 4303 section 3.4.3 recommends for a
+ * receiver; 64-bit extended sequence numbers aren't followed.
+ */
+#define ESP_REPLAY_WINDOW	64
+
+/*
+ * Hash tables indexing the SA list, one for ESP SAs, keyed on the SPI
+ * and destination address, and one for IKEv2 SAs (those with an SPI
+ * of 0), keyed on the IKE SPIs.  Each bucket is in list order, so
+ * that, as in the list, a later secret overrides an earlier one with
+ * the same key.  The tables are grown as SAs are added.
+ */
+#define SA_INDEX_MIN_BUCKETS	64
+
+struct sa_index {
+	u_int		nbuckets;     /* a power of 2 */
+	u_int		count;
+	struct sa_list	**esp;
+	struct sa_list	**ikev2;
+};
+
+static uint32_t
+sa_hash_bytes(uint32_t hash, const u_char *p, u_int len)
+{
+	while (len-- != 0)
+		hash = (hash ^ *p++) * 16777619U;
+	return hash;
+}
+
+static uint32_t
+sa_esp_hash(uint32_t spi, u_int daddr_version, const u_char *daddr)
+{
+	uint32_t hash = 2166136261U ^ (spi * 2654435761U);
+
+	return sa_hash_bytes(hash, daddr,
+	    daddr_version == 6 ? sizeof(nd_ipv6) : sizeof(nd_ipv4));
+}
+
+static uint32_t
+sa_ikev2_hash(int initiator, const u_char spii[8], const u_char spir[8])
+{
+	uint32_t hash = 2166136261U ^ (uint32_t)initiator;
+
+	hash = sa_hash_bytes(hash, spii, 8);
+	return sa_hash_bytes(hash, spir, 8);
+}
+
+static struct sa_list **
+sa_index_bucket(struct sa_index *idx, const struct sa_list *sa)
+{
+	if (sa->spi == 0)
+		return &idx->ikev2[sa_ikev2_hash(sa->initiator, sa->spii,
+		    sa->spir) & (idx->nbuckets - 1)];
+	return &idx->esp[sa_esp_hash(sa->spi, sa->daddr_version,
+	    (const u_char *)&sa->daddr) & (idx->nbuckets - 1)];
+}
+
+static void
+sa_index_free(struct sa_index *idx)
+{
+	if (idx == NULL)
+		return;
+	free(idx->esp);
+	free(idx->ikev2);
+	free(idx);
+}
+
+/*
+ * (Re)build the index for the SA list with room for at least nbuckets
+ * SAs; returns NULL if we run out of memory.
+ */
+static struct sa_index *
+sa_index_build(struct sa_list *head, u_int nbuckets)
+{
+	struct sa_index *idx;
+	struct sa_list *sa, **bp;
+
+	idx = (struct sa_index *)calloc(1, sizeof(*idx));
+	if (idx == NULL)
+		return NULL;
+	idx->nbuckets = nbuckets;
+	idx->esp = (struct sa_list **)calloc(nbuckets, sizeof(*idx->esp));
+	idx->ikev2 = (struct sa_list **)calloc(nbuckets, sizeof(*idx->ikev2));
+	if (idx->esp == NULL || idx->ikev2 == NULL) {
+		sa_index_free(idx);
+		return NULL;
+	}
+	for (sa = head; sa != NULL; sa = sa->next) {
+		/* append, to keep the buckets in list order */
+		for (bp = sa_index_bucket(idx, sa); *bp != NULL;
+		    bp = &(*bp)->hnext)
+			;
+		sa->hnext = NULL;
+		*bp = sa;
+		idx->count++;
+	}
+	return idx;
+}
+
 #ifndef HAVE_EVP_CIPHER_CTX_NEW
 /*
  * Allocate an EVP_CIPHER_CTX.
@@ -178,6 +289,10 @@ set_cipher_parameters(EVP_CIPHER_CTX *ctx, const EVP_CIPHER *cipher,
 }
 #endif
 
+/*
+ * The plaintext buffer is allocated with nd_malloc(), so it's freed
+ * when the packet has been printed.
+ */
 static u_char *
 do_decrypt(netdissect_options *ndo, const char *caller, struct sa_list *sa,
     const u_char *iv, const u_char *ct, unsigned int ctlen)
@@ -188,27 +303,38 @@ do_decrypt(netdissect_options *ndo, const char *caller, struct sa_list *sa,
 	u_char *pt;
 	int len;
 
-	ctx = EVP_CIPHER_CTX_new();
-	if (ctx == NULL) {
-		/*
-		 * Failed to initialize the cipher context.
-		 * From a look at the OpenSSL code, this appears to
-		 * mean "couldn't allocate memory for the cipher context";
-		 * note that we're not passing any parameters, so there's
-		 * not much else it can mean.
-		 */
-		(*ndo->ndo_error)(ndo, S_ERR_ND_MEM_ALLOC,
-		    "%s: can't allocate memory for cipher context", caller);
-		return NULL;
-	}
+	/*
+	 * Set up the cipher and key the first time the SA is used, and
+	 * keep the context, so that only the IV needs to be set for
+	 * each packet.
+	 */
+	if (sa->ctx == NULL) {
+		ctx = EVP_CIPHER_CTX_new();
+		if (ctx == NULL) {
+			/*
+			 * Failed to initialize the cipher context.
+			 * From a look at the OpenSSL code, this appears to
+			 * mean "couldn't allocate memory for the cipher
+			 * context"; note that we're not passing any
+			 * parameters, so there's not much else it can mean.
+			 */
+			(*ndo->ndo_error)(ndo, S_ERR_ND_MEM_ALLOC,
+			    "%s: can't allocate memory for cipher context",
+			    caller);
+			return NULL;
+		}
 
-	if (set_cipher_parameters(ctx, sa->evp, sa->secret, NULL) < 0) {
-		EVP_CIPHER_CTX_free(ctx);
-		(*ndo->ndo_warning)(ndo, "%s: espkey init failed", caller);
-		return NULL;
+		if (set_cipher_parameters(ctx, sa->evp, sa->secret, NULL) < 0) {
+			EVP_CIPHER_CTX_free(ctx);
+			(*ndo->ndo_warning)(ndo, "%s: espkey init failed",
+			    caller);
+			return NULL;
+		}
+		sa->ctx = ctx;
 	}
+	ctx = sa->ctx;
+
 	if (set_cipher_parameters(ctx, NULL, NULL, iv) < 0) {
-		EVP_CIPHER_CTX_free(ctx);
 		(*ndo->ndo_warning)(ndo, "%s: IV init failed", caller);
 		return NULL;
 	}
@@ -222,7 +348,6 @@ do_decrypt(netdissect_options *ndo, const char *caller, struct sa_list *sa,
 	 */
 	block_size = (unsigned int)EVP_CIPHER_CTX_block_size(ctx);
 	if ((ctlen % block_size) != 0) {
-		EVP_CIPHER_CTX_free(ctx);
 		(*ndo->ndo_warning)(ndo,
 		    "%s: ciphertext size %u is not a multiple of the cipher block size %u",
 		    caller, ctlen, block_size);
@@ -234,9 +359,8 @@ do_decrypt(netdissect_options *ndo, const char *caller, struct sa_list *sa,
 	 * we can't decrypt on top of the input buffer.
 	 */
 	ptlen = ctlen;
-	pt = (u_char *)malloc(ptlen);
+	pt = (u_char *)nd_malloc(ndo, ptlen);
 	if (pt == NULL) {
-		EVP_CIPHER_CTX_free(ctx);
 		(*ndo->ndo_error)(ndo, S_ERR_ND_MEM_ALLOC,
 		    "%s: can't allocate memory for decryption buffer", caller);
 		return NULL;
@@ -247,20 +371,15 @@ do_decrypt(netdissect_options *ndo, const char *caller, struct sa_list *sa,
 	 * cipher block size, so we don't need to worry about padding.
 	 */
 	if (!EVP_CIPHER_CTX_set_padding(ctx, 0)) {
-		free(pt);
-		EVP_CIPHER_CTX_free(ctx);
 		(*ndo->ndo_warning)(ndo,
 		    "%s: EVP_CIPHER_CTX_set_padding failed", caller);
 		return NULL;
 	}
 	if (!EVP_DecryptUpdate(ctx, pt, &len, ct, ctlen)) {
-		free(pt);
-		EVP_CIPHER_CTX_free(ctx);
 		(*ndo->ndo_warning)(ndo, "%s: EVP_DecryptUpdate failed",
 		    caller);
 		return NULL;
 	}
-	EVP_CIPHER_CTX_free(ctx);
 	return pt;
 }
 
@@ -274,7 +393,8 @@ do_decrypt(netdissect_options *ndo, const char *caller, struct sa_list *sa,
  *
  * Our caller must pop the buffer off the stack when it's finished
  * dissecting anything in it and before it does any dissection of
- * anything in the old buffer.  That will free the new buffer.
+ * anything in the old buffer.  The new buffer is freed when the
+ * packet has been printed.
  */
 USES_APPLE_DEPRECATED_API
 int esp_print_decrypt_buffer_by_ikev2(netdissect_options *ndo,
@@ -293,7 +413,10 @@ int esp_print_decrypt_buffer_by_ikev2(netdissect_options *ndo,
 	if(initiator) initiator=1;
 
 	/* see if we can find the SA, and if so, decode it */
-	for (sa = ndo->ndo_sa_list_head; sa != NULL; sa = sa->next) {
+	if (ndo->ndo_sa_index == NULL)
+		return 0;
+	for (sa = ndo->ndo_sa_index->ikev2[sa_ikev2_hash(initiator, spii, spir) &
+	    (ndo->ndo_sa_index->nbuckets - 1)]; sa != NULL; sa = sa->hnext) {
 		if (sa->spi == 0
 		    && initiator == sa->initiator
 		    && memcmp(spii, sa->spii, 8) == 0
@@ -321,14 +444,12 @@ int esp_print_decrypt_buffer_by_ikev2(netdissect_options *ndo,
 		return 0;
 
 	/*
-	 * Switch to the output buffer for dissection, and save it
-	 * on the buffer stack so it can be freed; our caller must
-	 * pop it when done.
+	 * Switch to the output buffer for dissection, saving the
+	 * current one on the buffer stack; our caller must pop it
+	 * when done.
 	 */
-	if (!nd_push_buffer(ndo, pt, pt, pt + ctlen)) {
-		free(pt);
+	if (!nd_push_buffer(ndo, NULL, pt, pt + ctlen))
 		return 0;
-	}
 
 	return 1;
 }
@@ -339,7 +460,8 @@ static void esp_print_addsa(netdissect_options *ndo,
 {
 	/* copy the "sa" */
 
-	struct sa_list *nsa;
+	struct sa_list *nsa, **bp;
+	struct sa_index *idx;
 
 	/* malloc() return used in a 'struct sa_list': do not free() */
 	nsa = (struct sa_list *)malloc(sizeof(struct sa_list));
@@ -348,12 +470,53 @@ static void esp_print_addsa(netdissect_options *ndo,
 				  "esp_print_addsa: malloc");
 
 	*nsa = *sa;
+	nsa->ctx = NULL;
 
 	if (sa_def)
 		ndo->ndo_sa_default = nsa;
 
 	nsa->next = ndo->ndo_sa_list_head;
 	ndo->ndo_sa_list_head = nsa;
+
+	/*
+	 * Index the new SA, growing the index if it's full; the new SA
+	 * goes at the front of its bucket, as it does in the list.
+	 */
+	idx = ndo->ndo_sa_index;
+	if (idx == NULL || idx->count >= idx->nbuckets) {
+		idx = sa_index_build(nsa, idx == NULL ?
+		    SA_INDEX_MIN_BUCKETS : idx->nbuckets * 2);
+		if (idx == NULL)
+			(*ndo->ndo_error)(ndo, S_ERR_ND_MEM_ALLOC,
+					  "esp_print_addsa: calloc");
+		sa_index_free(ndo->ndo_sa_index);
+		ndo->ndo_sa_index = idx;
+	} else {
+		bp = sa_index_bucket(idx, nsa);
+		nsa->hnext = *bp;
+		*bp = nsa;
+		idx->count++;
+	}
+}
+
+/*
+ * Discard all the SAs, so that the secrets are decoded again, from
+ * ndo->ndo_espsecret, when they're next needed.
+ */
+void esp_print_freesecrets(netdissect_options *ndo)
+{
+	struct sa_list *sa, *next;
+
+	for (sa = ndo->ndo_sa_list_head; sa != NULL; sa = next) {
+		next = sa->next;
+		if (sa->ctx != NULL)
+			EVP_CIPHER_CTX_free(sa->ctx);
+		free(sa);
+	}
+	ndo->ndo_sa_list_head = NULL;
+	ndo->ndo_sa_default = NULL;
+	sa_index_free(ndo->ndo_sa_index);
+	ndo->ndo_sa_index = NULL;
 }
 
 
@@ -685,6 +848,7 @@ USES_APPLE_RST
 
 void esp_print_decodesecret(netdissect_options *ndo)
 {
+	char *secrets;
 	char *line;
 	char *p;
 	static int initialized = 0;
@@ -694,7 +858,16 @@ void esp_print_decodesecret(netdissect_options *ndo)
 		initialized = 1;
 	}
 
-	p = ndo->ndo_espsecret;
+	/*
+	 * Work on a copy; the string may be shared with the
+	 * netdissect_options of other threads, each of which
+	 * builds its own SA list from it.
+	 */
+	secrets = strdup(ndo->ndo_espsecret);
+	if (secrets == NULL)
+		(*ndo->ndo_error)(ndo, S_ERR_ND_MEM_ALLOC,
+				  "esp_print_decodesecret: strdup");
+	p = secrets;
 
 	while (p && p[0] != '\0') {
 		/* pick out the first line or first thing until a comma */
@@ -705,10 +878,76 @@ void esp_print_decodesecret(netdissect_options *ndo)
 
 		esp_print_decode_onesecret(ndo, line, "cmdline", 0);
 	}
+	free(secrets);
 
 	ndo->ndo_espsecret = NULL;
 }
 
+/*
+ * Count the ESP packet with sequence number "seq" for the SA "sa".
+ */
+static void
+esp_replay_check(struct sa_list *sa, uint32_t seq)
+{
+	uint32_t d;
+
+	if (sa->seq_packets++ == 0) {
+		sa->seq_first = sa->seq_high = seq;
+		sa->seq_window = 1;
+		return;
+	}
+	if (seq > sa->seq_high) {
+		d = seq - sa->seq_high;
+		sa->seq_window = d >= ESP_REPLAY_WINDOW ? 1 :
+		    (sa->seq_window << d) | 1;
+		sa->seq_high = seq;
+		return;
+	}
+	d = sa->seq_high - seq;
+	if (d >= ESP_REPLAY_WINDOW)
+		sa->seq_late++;
+	else if (sa->seq_window & ((uint64_t)1 << d))
+		sa->seq_replayed++;
+	else {
+		sa->seq_window |= (uint64_t)1 << d;
+		if (seq < sa->seq_first)
+			sa->seq_first = seq;
+	}
+}
+
+/*
+ * Call "fn" for each ESP SA of "ndo" that packets have been seen for,
+ * with how many, how many sequence numbers between the first and the
+ * highest weren't seen, and how many packets were replays or came too
+ * late for the replay window.
+ */
+void
+esp_sa_foreach(netdissect_options *ndo, esp_sa_fn fn, void *arg)
+{
+	const struct sa_list *sa;
+	char dst[INET6_ADDRSTRLEN];
+	uint64_t seen, span;
+
+	for (sa = ndo->ndo_sa_list_head; sa != NULL; sa = sa->next) {
+		if (sa->seq_packets == 0)
+			continue;
+		if (sa->daddr_version == 6)
+			addrtostr6(&sa->daddr.in6, dst, sizeof(dst));
+		else
+			addrtostr(&sa->daddr.in4, dst, sizeof(dst));
+		seen = sa->seq_packets - sa->seq_replayed - sa->seq_late;
+		span = (uint64_t)(sa->seq_high - sa->seq_first) + 1;
+		(*fn)(arg, sa->spi, dst, sa->seq_packets,
+		    span > seen ? span - seen : 0, sa->seq_replayed,
+		    sa->seq_late);
+	}
+}
+
+#else
+void
+esp_sa_foreach(netdissect_options *ndo _U_, esp_sa_fn fn _U_, void *arg _U_)
+{
+}
 #endif
 
 #ifdef HAVE_LIBCRYPTO
@@ -780,7 +1019,10 @@ esp_print(netdissect_options *ndo,
 		/* if we can't get nexthdr, we do not need to decrypt it */
 
 		/* see if we can find the SA, and if so, decode it */
-		for (sa = ndo->ndo_sa_list_head; sa != NULL; sa = sa->next) {
+		for (sa = ndo->ndo_sa_index->esp[sa_esp_hash(
+		    GET_BE_U_4(esp->esp_spi), 6, ip6->ip6_dst) &
+		    (ndo->ndo_sa_index->nbuckets - 1)];
+		    sa != NULL; sa = sa->hnext) {
 			if (sa->spi == GET_BE_U_4(esp->esp_spi) &&
 			    sa->daddr_version == 6 &&
 			    UNALIGNED_MEMCMP(&sa->daddr.in6, &ip6->ip6_dst,
@@ -795,7 +1037,10 @@ esp_print(netdissect_options *ndo,
 			return;
 
 		/* see if we can find the SA, and if so, decode it */
-		for (sa = ndo->ndo_sa_list_head; sa != NULL; sa = sa->next) {
+		for (sa = ndo->ndo_sa_index->esp[sa_esp_hash(
+		    GET_BE_U_4(esp->esp_spi), 4, ip->ip_dst) &
+		    (ndo->ndo_sa_index->nbuckets - 1)];
+		    sa != NULL; sa = sa->hnext) {
 			if (sa->spi == GET_BE_U_4(esp->esp_spi) &&
 			    sa->daddr_version == 4 &&
 			    UNALIGNED_MEMCMP(&sa->daddr.in4, &ip->ip_dst,
@@ -811,7 +1056,9 @@ esp_print(netdissect_options *ndo,
 	/* if we didn't find the specific one, then look for
 	 * an unspecified one.
 	 */
-	if (sa == NULL)
+	if (sa != NULL)
+		esp_replay_check(sa, GET_BE_U_4(esp->esp_seq));
+	else
 		sa = ndo->ndo_sa_default;
 
 	/* if not found fail */
@@ -871,12 +1118,11 @@ esp_print(netdissect_options *ndo,
 		return;
 
 	/*
-	 * Switch to the output buffer for dissection, and
-	 * save it on the buffer stack so it can be freed.
+	 * Switch to the output buffer for dissection, saving the
+	 * current one on the buffer stack.
 	 */
 	ep = pt + payloadlen;
-	if (!nd_push_buffer(ndo, pt, pt, ep)) {
-		free(pt);
+	if (!nd_push_buffer(ndo, NULL, pt, ep)) {
 		(*ndo->ndo_error)(ndo, S_ERR_ND_MEM_ALLOC,
 			"esp_print: can't push buffer on buffer stack");
 	}
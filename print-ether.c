@@ -27,10 +27,19 @@
 
 #include "netdissect-stdinc.h"
 
+#include <stdlib.h>
+#include <string.h>
+
 #include "netdissect.h"
+#include "netdissect-fields.h"
+#include "netdissect-profile.h"
 #include "extract.h"
 #include "addrtoname.h"
 #include "ethertype.h"
+#include "ip.h"
+#include "ip6.h"
+#include "tcp.h"
+#include "udp.h"
 
 /*
  * Structure of an Ethernet header.
@@ -105,6 +114,76 @@ const struct tok ethertype_values[] = {
     { 0, NULL}
 };
 
+/*
+ * The layouts of the last few shapes of Ethernet header seen, for
+ * ether_print_common(): the number of VLAN tags, their TPIDs and the
+ * type field after them, and the dissector for that type.  A frame
+ * whose type words are a layout's, at the layout's offsets, goes
+ * straight to the dissector, without the VLAN and length/type checks;
+ * that's for traffic that's all of a few shapes, such as QinQ with IPv4,
+ * repeated for every frame.  Only the shapes whose headers print
+ * nothing without -e, and whose type has a dissector, are kept; they
+ * depend only on the dispatch table, which doesn't change once packets
+ * are being dissected.
+ */
+#define ETHER_LAYOUT_TAGS	4	/* most VLAN tags in a layout */
+#define ETHER_LAYOUTS		4
+
+struct ether_layout {
+	u_int	ntags;
+	u_short	words[ETHER_LAYOUT_TAGS + 1];	/* the TPIDs, then the type */
+	const struct ethertype_dissector *d;
+};
+
+static ND_THREAD_LOCAL struct ether_layout ether_layouts[ETHER_LAYOUTS];
+static ND_THREAD_LOCAL u_int ether_nlayouts, ether_next_layout;
+
+static const struct ethertype_dissector *ethertype_lookup(u_short);
+
+/*
+ * Find the layout of the header from the first length/type field, at
+ * "p", on, if there's one and the header's all there.
+ */
+static const struct ether_layout *
+ether_layout_find(netdissect_options *ndo, const u_char *p, u_int length,
+    u_int caplen)
+{
+	const struct ether_layout *l;
+	u_int i, n;
+
+	for (l = ether_layouts; l < ether_layouts + ether_nlayouts; l++) {
+		n = 2 + 4 * l->ntags;
+		if (caplen < n || length < n || !ND_TTEST_LEN(p, n))
+			continue;
+		for (i = 0; i <= l->ntags; i++)
+			if (EXTRACT_BE_U_2(p + 4 * i) != l->words[i])
+				break;
+		if (i > l->ntags)
+			return (l);
+	}
+	return (NULL);
+}
+
+static void
+ether_layout_add(const u_short *words, u_int ntags,
+    const struct ethertype_dissector *d)
+{
+	struct ether_layout *l;
+
+	/* It may be here already, if it was cut short when looked for. */
+	for (l = ether_layouts; l < ether_layouts + ether_nlayouts; l++)
+		if (l->ntags == ntags &&
+		    memcmp(l->words, words, (ntags + 1) * sizeof(words[0])) == 0)
+			return;
+	l = &ether_layouts[ether_next_layout];
+	ether_next_layout = (ether_next_layout + 1) % ETHER_LAYOUTS;
+	if (ether_nlayouts < ETHER_LAYOUTS)
+		ether_nlayouts++;
+	l->ntags = ntags;
+	memcpy(l->words, words, (ntags + 1) * sizeof(words[0]));
+	l->d = d;
+}
+
 static void
 ether_addresses_print(netdissect_options *ndo, const u_char *src,
 		      const u_char *dst)
@@ -144,9 +223,15 @@ ether_print_common(netdissect_options *ndo, const u_char *p, u_int length,
 	u_int orig_length;
 	u_int hdrlen;
 	u_short length_type;
+	uint32_t vlan;
 	int printed_length;
 	int llc_hdrlen;
 	struct lladdr_info src, dst;
+	const struct ether_layout *layout;
+	const struct ethertype_dissector *d;
+	u_short words[ETHER_LAYOUT_TAGS + 1];
+	u_int ntags;
+	int quiet;
 
 	if (caplen < ETHER_HDRLEN + switch_tag_len) {
 		nd_print_trunc(ndo);
@@ -177,6 +262,9 @@ ether_print_common(netdissect_options *ndo, const u_char *p, u_int length,
 	p += 2*MAC_ADDR_LEN;
 	hdrlen = 2*MAC_ADDR_LEN;
 
+	ND_FIELD_ADDR(NDF_ETHER, NDF_ETHER_DST, dst.addr, MAC_ADDR_LEN);
+	ND_FIELD_ADDR(NDF_ETHER, NDF_ETHER_SRC, src.addr, MAC_ADDR_LEN);
+
 	if (ndo->ndo_eflag)
 		ether_addresses_print(ndo, src.addr, dst.addr);
 
@@ -191,6 +279,26 @@ ether_print_common(netdissect_options *ndo, const u_char *p, u_int length,
 	p += switch_tag_len;
 	hdrlen += switch_tag_len;
 
+	/*
+	 * If we're not printing the link-layer header, a header of a
+	 * shape seen before goes straight to the dissector for its type.
+	 */
+	quiet = !ndo->ndo_eflag && ndo->ndo_field == NULL;
+	if (quiet && (layout = ether_layout_find(ndo, p, length, caplen)) !=
+	    NULL) {
+		u_int n = 2 + 4 * layout->ntags;
+
+		p += n;
+		length -= n;
+		caplen -= n;
+		hdrlen += n;
+		ND_PROFILE_ENTER(layout->d->name);
+		(*layout->d->printer)(ndo, p, length, caplen, &src, &dst);
+		ND_PROFILE_LEAVE();
+		return (hdrlen);
+	}
+	ntags = 0;
+
 	/*
 	 * Get the length/type field, skip past it, and print it
 	 * if we're printing the link-layer header.
@@ -226,8 +334,14 @@ recurse:
 			nd_print_trunc(ndo);
 			return (hdrlen + length);
 		}
+		/* The tag and the enclosed type field, checked at once */
+		vlan = GET_BE_U_4(p);
+		if (ntags < ETHER_LAYOUT_TAGS)
+			words[ntags] = length_type;
+		ntags++;
+		ND_FIELD_UINT(NDF_ETHER, NDF_ETHER_VLAN, vlan >> 16);
 		if (ndo->ndo_eflag) {
-			uint16_t tag = GET_BE_U_2(p);
+			uint16_t tag = (uint16_t)(vlan >> 16);
 
 			ether_type_print(ndo, length_type);
 			if (!printed_length) {
@@ -238,7 +352,7 @@ recurse:
 			ND_PRINT("%s, ", ieee8021q_tci_string(tag));
 		}
 
-		length_type = GET_BE_U_2(p + 2);
+		length_type = (u_short)(vlan & 0xffff);
 		p += 4;
 		length -= 4;
 		caplen -= 4;
@@ -248,6 +362,7 @@ recurse:
 	/*
 	 * We now have the final length/type field.
 	 */
+	ND_FIELD_UINT(NDF_ETHER, NDF_ETHER_TYPE, length_type);
 	if (length_type <= MAX_ETHERNET_LENGTH_VAL) {
 		/*
 		 * It's a length field, containing the length of the
@@ -315,6 +430,8 @@ recurse:
 		}
 		ether_type_print(ndo, length_type);
 		ND_PRINT(", length %u: ", orig_length);
+		/* The Arista header isn't part of a layout. */
+		quiet = 0;
 		int bytesConsumed = arista_ethertype_print(ndo, p, length);
 		if (bytesConsumed > 0) {
 			p += bytesConsumed;
@@ -343,6 +460,11 @@ recurse:
 			else
 				ND_PRINT(", ");
 		}
+		if (quiet && ntags <= ETHER_LAYOUT_TAGS &&
+		    (d = ethertype_lookup(length_type)) != NULL) {
+			words[ntags] = length_type;
+			ether_layout_add(words, ntags, d);
+		}
 		if (ethertype_print(ndo, length_type, p, length, caplen, &src, &dst) == 0) {
 			/* type not known, print raw packet */
 			if (!ndo->ndo_eflag) {
@@ -417,6 +539,208 @@ ether_if_print(netdissect_options *ndo, const struct pcap_pkthdr *h,
 	return (ether_print(ndo, p, h->len, h->caplen, NULL, NULL));
 }
 
+/*
+ * With -q, print a TCP or UDP packet over IPv4 or IPv6 over Ethernet,
+ * with or without VLAN tags, the way ether_if_print() and the IP, TCP
+ * and UDP printers would, but without going through them.  Returns the
+ * length of the link-layer header, or 0, having printed nothing, if
+ * the packet isn't one of those or has anything about it that the
+ * printers would report, such as being truncated or an IP fragment;
+ * the caller then prints it with ether_if_print().
+ */
+u_int
+ether_quick_print(netdissect_options *ndo, const struct pcap_pkthdr *h,
+		  const u_char *p)
+{
+	const u_char *ep = p + h->caplen;
+	const struct ip *ip;
+	const struct ip6_hdr *ip6;
+	const struct tcphdr *tp;
+	const struct udphdr *up;
+	const u_char *src, *dst;
+	u_int hdrlen, length, iplen, hlen, ulen;
+	uint16_t length_type;
+	uint8_t nh;
+	int v6;
+
+	if (ndo->ndo_eflag || ndo->ndo_vflag || ndo->ndo_packettype != 0 ||
+	    ndo->ndo_field != NULL || ndo->ndo_profile != NULL ||
+	    ndo->ndo_snapacct != NULL || ndo->ndo_latency ||
+	    ndo->ndo_community_id || ndo->ndo_tcp_analysis ||
+	    ndo->ndo_mptcp_connections || ndo->ndo_max_output != 0)
+		return (0);
+	if (h->caplen < ETHER_HDRLEN)
+		return (0);
+	hdrlen = ETHER_HDRLEN;
+	length_type = EXTRACT_BE_U_2(p + 2*MAC_ADDR_LEN);
+	while (length_type == ETHERTYPE_8021Q  ||
+		length_type == ETHERTYPE_8021Q9100 ||
+		length_type == ETHERTYPE_8021Q9200 ||
+		length_type == ETHERTYPE_8021QinQ) {
+		if (h->caplen < hdrlen + 4)
+			return (0);
+		length_type = EXTRACT_BE_U_2(p + hdrlen + 2);
+		hdrlen += 4;
+	}
+	length = h->len - hdrlen;
+
+	switch (length_type) {
+
+	case ETHERTYPE_IP:
+		ip = (const struct ip *)(p + hdrlen);
+		if (ND_BYTES_BETWEEN(ep, ip) < sizeof(*ip) ||
+		    length < sizeof(*ip) ||
+		    (EXTRACT_U_1(ip->ip_vhl) & 0xf0) != 0x40)
+			return (0);
+		hlen = (EXTRACT_U_1(ip->ip_vhl) & 0x0f) * 4;
+		iplen = EXTRACT_BE_U_2(ip->ip_len);
+		if (hlen < sizeof(*ip) || iplen < hlen || length < iplen ||
+		    (EXTRACT_BE_U_2(ip->ip_off) & (IP_MF|IP_OFFMASK)) != 0)
+			return (0);
+		nh = EXTRACT_U_1(ip->ip_p);
+		src = ip->ip_src;
+		dst = ip->ip_dst;
+		tp = (const struct tcphdr *)((const u_char *)ip + hlen);
+		length = iplen - hlen;
+		v6 = 0;
+		break;
+
+	case ETHERTYPE_IPV6:
+		ip6 = (const struct ip6_hdr *)(p + hdrlen);
+		if (ND_BYTES_BETWEEN(ep, ip6) < sizeof(*ip6) ||
+		    length < sizeof(*ip6) ||
+		    (EXTRACT_U_1(ip6->ip6_vfc) & 0xf0) != 0x60)
+			return (0);
+		iplen = EXTRACT_BE_U_2(ip6->ip6_plen);
+		/* A Jumbo Payload has a payload length of 0. */
+		if (iplen == 0 || length < iplen + sizeof(*ip6))
+			return (0);
+		nh = EXTRACT_U_1(ip6->ip6_nxt);
+		src = ip6->ip6_src;
+		dst = ip6->ip6_dst;
+		tp = (const struct tcphdr *)(ip6 + 1);
+		length = iplen;
+		v6 = 1;
+		break;
+
+	default:
+		return (0);
+	}
+
+	/* The IP printers cut off the captured data at the IP length. */
+	if ((const u_char *)tp > ep)
+		return (0);
+	if (ND_BYTES_BETWEEN(ep, tp) > length)
+		ep = (const u_char *)tp + length;
+
+	switch (nh) {
+
+	case IPPROTO_TCP:
+		if (ND_BYTES_BETWEEN(ep, tp) < sizeof(*tp))
+			return (0);
+		hlen = (EXTRACT_U_1(tp->th_offx2) >> 4) * 4;
+		if (hlen < sizeof(*tp) || hlen > length)
+			return (0);
+		ND_PRINT("%s %s.%s > %s.%s: tcp %u", v6 ? "IP6" : "IP",
+			 v6 ? ip6addr_string(ndo, src) : ipaddr_string(ndo, src),
+			 tcpport_string(ndo, EXTRACT_BE_U_2(tp->th_sport)),
+			 v6 ? ip6addr_string(ndo, dst) : ipaddr_string(ndo, dst),
+			 tcpport_string(ndo, EXTRACT_BE_U_2(tp->th_dport)),
+			 length - hlen);
+		break;
+
+	case IPPROTO_UDP:
+		up = (const struct udphdr *)tp;
+		if (ND_BYTES_BETWEEN(ep, up) < sizeof(*up))
+			return (0);
+		ulen = EXTRACT_BE_U_2(up->uh_ulen);
+		if (ulen < sizeof(*up) || ulen > length)
+			return (0);
+		ND_PRINT("%s %s.%s > %s.%s: UDP, length %u", v6 ? "IP6" : "IP",
+			 v6 ? ip6addr_string(ndo, src) : ipaddr_string(ndo, src),
+			 udpport_string(ndo, EXTRACT_BE_U_2(up->uh_sport)),
+			 v6 ? ip6addr_string(ndo, dst) : ipaddr_string(ndo, dst),
+			 udpport_string(ndo, EXTRACT_BE_U_2(up->uh_dport)),
+			 ulen - (u_int)sizeof(*up));
+		break;
+
+	default:
+		return (0);
+	}
+	return (hdrlen);
+}
+
+/*
+ * Prefetch what printing the Ethernet frame at "p", of which "caplen"
+ * bytes were captured, will read first and is least likely to be in
+ * the cache: the frame itself and, for IPv4 and IPv6, the name cache
+ * sets of its addresses and, for TCP, its conversation's slot in the
+ * relative sequence number table.  It's called for the next packet of
+ * a batch while the current one is being printed, so it only reads.
+ */
+void
+ether_prefetch(netdissect_options *ndo, const u_char *p, u_int caplen)
+{
+	const u_char *nh, *src, *dst;
+	u_int hdrlen, alen;
+	uint16_t length_type;
+	uint8_t proto;
+
+	ND_PREFETCH(p);
+	if (caplen > 64)
+		ND_PREFETCH(p + 64);
+	if (caplen < ETHER_HDRLEN)
+		return;
+	hdrlen = ETHER_HDRLEN;
+	length_type = EXTRACT_BE_U_2(p + 2*MAC_ADDR_LEN);
+	while (length_type == ETHERTYPE_8021Q  ||
+		length_type == ETHERTYPE_8021Q9100 ||
+		length_type == ETHERTYPE_8021Q9200 ||
+		length_type == ETHERTYPE_8021QinQ) {
+		if (caplen < hdrlen + 4)
+			return;
+		length_type = EXTRACT_BE_U_2(p + hdrlen + 2);
+		hdrlen += 4;
+	}
+	nh = p + hdrlen;
+	caplen -= hdrlen;
+
+	switch (length_type) {
+
+	case ETHERTYPE_IP:
+		if (caplen < sizeof(struct ip))
+			return;
+		src = ((const struct ip *)nh)->ip_src;
+		dst = ((const struct ip *)nh)->ip_dst;
+		alen = sizeof(nd_ipv4);
+		ipaddr_prefetch(src);
+		ipaddr_prefetch(dst);
+		proto = EXTRACT_U_1(((const struct ip *)nh)->ip_p);
+		hdrlen = (EXTRACT_U_1(((const struct ip *)nh)->ip_vhl) & 0x0f) * 4;
+		break;
+
+	case ETHERTYPE_IPV6:
+		if (caplen < sizeof(struct ip6_hdr))
+			return;
+		src = ((const struct ip6_hdr *)nh)->ip6_src;
+		dst = ((const struct ip6_hdr *)nh)->ip6_dst;
+		alen = sizeof(nd_ipv6);
+		ip6addr_prefetch(src);
+		ip6addr_prefetch(dst);
+		proto = EXTRACT_U_1(((const struct ip6_hdr *)nh)->ip6_nxt);
+		hdrlen = sizeof(struct ip6_hdr);
+		break;
+
+	default:
+		return;
+	}
+	if (proto != IPPROTO_TCP || hdrlen < sizeof(struct ip) ||
+	    caplen < hdrlen + 4)
+		return;
+	tcp_conn_prefetch(ndo, src, dst, alen, EXTRACT_BE_U_2(nh + hdrlen),
+	    EXTRACT_BE_U_2(nh + hdrlen + 2));
+}
+
 /*
  * This is the top level routine of the printer.  'p' points
  * to the ether header of the packet, 'h->len' is the length
@@ -472,6 +796,349 @@ netanalyzer_transparent_if_print(netdissect_options *ndo,
 	return (12 + ether_print(ndo, p + 12, h->len - 12, h->caplen - 12, NULL, NULL));
 }
 
+/*
+ * Adapters from the ethertype dispatch signature to the printers.
+ */
+static void
+ethertype_ip_print(netdissect_options *ndo, const u_char *p, u_int length,
+    u_int caplen _U_, const struct lladdr_info *src _U_,
+    const struct lladdr_info *dst _U_)
+{
+	ip_print(ndo, p, length);
+}
+
+static void
+ethertype_ip6_print(netdissect_options *ndo, const u_char *p, u_int length,
+    u_int caplen _U_, const struct lladdr_info *src _U_,
+    const struct lladdr_info *dst _U_)
+{
+	ip6_print(ndo, p, length);
+}
+
+static void
+ethertype_arp_print(netdissect_options *ndo, const u_char *p, u_int length,
+    u_int caplen, const struct lladdr_info *src _U_,
+    const struct lladdr_info *dst _U_)
+{
+	arp_print(ndo, p, length, caplen);
+}
+
+static void
+ethertype_decnet_print(netdissect_options *ndo, const u_char *p,
+    u_int length, u_int caplen, const struct lladdr_info *src _U_,
+    const struct lladdr_info *dst _U_)
+{
+	decnet_print(ndo, p, length, caplen);
+}
+
+static void
+ethertype_atalk_print(netdissect_options *ndo, const u_char *p,
+    u_int length, u_int caplen _U_, const struct lladdr_info *src _U_,
+    const struct lladdr_info *dst _U_)
+{
+	if (ndo->ndo_vflag)
+		ND_PRINT("et1 ");
+	atalk_print(ndo, p, length);
+}
+
+static void
+ethertype_aarp_print(netdissect_options *ndo, const u_char *p,
+    u_int length, u_int caplen _U_, const struct lladdr_info *src _U_,
+    const struct lladdr_info *dst _U_)
+{
+	aarp_print(ndo, p, length);
+}
+
+static void
+ethertype_ipx_print(netdissect_options *ndo, const u_char *p, u_int length,
+    u_int caplen _U_, const struct lladdr_info *src _U_,
+    const struct lladdr_info *dst _U_)
+{
+	ND_PRINT("(NOV-ETHII) ");
+	ipx_print(ndo, p, length);
+}
+
+static void
+ethertype_isoclns_print(netdissect_options *ndo, const u_char *p,
+    u_int length, u_int caplen, const struct lladdr_info *src _U_,
+    const struct lladdr_info *dst _U_)
+{
+	if (length == 0 || caplen == 0) {
+		ndo->ndo_protocol = "isoclns";
+		nd_print_trunc(ndo);
+		return;
+	}
+	isoclns_print(ndo, p + 1, length - 1);
+}
+
+static void
+ethertype_pppoe_print(netdissect_options *ndo, const u_char *p,
+    u_int length, u_int caplen _U_, const struct lladdr_info *src _U_,
+    const struct lladdr_info *dst _U_)
+{
+	pppoe_print(ndo, p, length);
+}
+
+#ifndef ND_OMIT_EAP
+static void
+ethertype_eap_print(netdissect_options *ndo, const u_char *p, u_int length,
+    u_int caplen _U_, const struct lladdr_info *src _U_,
+    const struct lladdr_info *dst _U_)
+{
+	eap_print(ndo, p, length);
+}
+#else
+#define ethertype_eap_print	NULL
+#endif
+
+#ifndef ND_OMIT_RRCP
+static void
+ethertype_rrcp_print(netdissect_options *ndo, const u_char *p,
+    u_int length, u_int caplen _U_, const struct lladdr_info *src,
+    const struct lladdr_info *dst)
+{
+	rrcp_print(ndo, p, length, src, dst);
+}
+#else
+#define ethertype_rrcp_print	NULL
+#endif
+
+static void
+ethertype_ppp_print(netdissect_options *ndo, const u_char *p, u_int length,
+    u_int caplen _U_, const struct lladdr_info *src _U_,
+    const struct lladdr_info *dst _U_)
+{
+	if (length) {
+		ND_PRINT(": ");
+		ppp_print(ndo, p, length);
+	}
+}
+
+#ifndef ND_OMIT_MPCP
+static void
+ethertype_mpcp_print(netdissect_options *ndo, const u_char *p,
+    u_int length, u_int caplen _U_, const struct lladdr_info *src _U_,
+    const struct lladdr_info *dst _U_)
+{
+	mpcp_print(ndo, p, length);
+}
+#else
+#define ethertype_mpcp_print	NULL
+#endif
+
+#ifndef ND_OMIT_SLOW
+static void
+ethertype_slow_print(netdissect_options *ndo, const u_char *p,
+    u_int length, u_int caplen _U_, const struct lladdr_info *src _U_,
+    const struct lladdr_info *dst _U_)
+{
+	slow_print(ndo, p, length);
+}
+#else
+#define ethertype_slow_print	NULL
+#endif
+
+#ifndef ND_OMIT_CFM
+static void
+ethertype_cfm_print(netdissect_options *ndo, const u_char *p, u_int length,
+    u_int caplen _U_, const struct lladdr_info *src _U_,
+    const struct lladdr_info *dst _U_)
+{
+	cfm_print(ndo, p, length);
+}
+#else
+#define ethertype_cfm_print	NULL
+#endif
+
+#ifndef ND_OMIT_LLDP
+static void
+ethertype_lldp_print(netdissect_options *ndo, const u_char *p,
+    u_int length, u_int caplen _U_, const struct lladdr_info *src _U_,
+    const struct lladdr_info *dst _U_)
+{
+	lldp_print(ndo, p, length);
+}
+#else
+#define ethertype_lldp_print	NULL
+#endif
+
+static void
+ethertype_nsh_print(netdissect_options *ndo, const u_char *p, u_int length,
+    u_int caplen _U_, const struct lladdr_info *src _U_,
+    const struct lladdr_info *dst _U_)
+{
+	nsh_print(ndo, p, length);
+}
+
+#ifndef ND_OMIT_LOOPBACK
+static void
+ethertype_loopback_print(netdissect_options *ndo, const u_char *p,
+    u_int length, u_int caplen _U_, const struct lladdr_info *src _U_,
+    const struct lladdr_info *dst _U_)
+{
+	loopback_print(ndo, p, length);
+}
+#else
+#define ethertype_loopback_print	NULL
+#endif
+
+static void
+ethertype_mpls_print(netdissect_options *ndo, const u_char *p,
+    u_int length, u_int caplen _U_, const struct lladdr_info *src _U_,
+    const struct lladdr_info *dst _U_)
+{
+	mpls_print(ndo, p, length);
+}
+
+#ifndef ND_OMIT_TIPC
+static void
+ethertype_tipc_print(netdissect_options *ndo, const u_char *p,
+    u_int length, u_int caplen, const struct lladdr_info *src _U_,
+    const struct lladdr_info *dst _U_)
+{
+	tipc_print(ndo, p, length, caplen);
+}
+#else
+#define ethertype_tipc_print	NULL
+#endif
+
+#ifndef ND_OMIT_MSNLB
+static void
+ethertype_msnlb_print(netdissect_options *ndo, const u_char *p,
+    u_int length _U_, u_int caplen _U_, const struct lladdr_info *src _U_,
+    const struct lladdr_info *dst _U_)
+{
+	msnlb_print(ndo, p);
+}
+#else
+#define ethertype_msnlb_print	NULL
+#endif
+
+#ifndef ND_OMIT_GEONET
+static void
+ethertype_geonet_print(netdissect_options *ndo, const u_char *p,
+    u_int length, u_int caplen _U_, const struct lladdr_info *src,
+    const struct lladdr_info *dst _U_)
+{
+	geonet_print(ndo, p, length, src);
+}
+#else
+#define ethertype_geonet_print	NULL
+#endif
+
+#ifndef ND_OMIT_CALM_FAST
+static void
+ethertype_calm_fast_print(netdissect_options *ndo, const u_char *p,
+    u_int length, u_int caplen _U_, const struct lladdr_info *src,
+    const struct lladdr_info *dst _U_)
+{
+	calm_fast_print(ndo, p, length, src);
+}
+#else
+#define ethertype_calm_fast_print	NULL
+#endif
+
+#ifndef ND_OMIT_AOE
+static void
+ethertype_aoe_print(netdissect_options *ndo, const u_char *p, u_int length,
+    u_int caplen _U_, const struct lladdr_info *src _U_,
+    const struct lladdr_info *dst _U_)
+{
+	aoe_print(ndo, p, length);
+}
+#else
+#define ethertype_aoe_print	NULL
+#endif
+
+static void
+ethertype_ptp_print(netdissect_options *ndo, const u_char *p, u_int length,
+    u_int caplen _U_, const struct lladdr_info *src _U_,
+    const struct lladdr_info *dst _U_)
+{
+	ptp_print(ndo, p, length);
+}
+
+/*
+ * The built-in ethertype dissectors.  ETHERTYPE_LAT, ETHERTYPE_SCA,
+ * ETHERTYPE_MOPRC, ETHERTYPE_MOPDL and ETHERTYPE_IEEE1905_1 have none
+ * yet and get default_print.
+ */
+const struct ethertype_dissector ethertype_dissectors[] = {
+	{ ETHERTYPE_IP,		"ip",		ethertype_ip_print },
+	{ ETHERTYPE_IPV6,	"ip6",		ethertype_ip6_print },
+	{ ETHERTYPE_ARP,	"arp",		ethertype_arp_print },
+	{ ETHERTYPE_REVARP,	"arp",		ethertype_arp_print },
+	{ ETHERTYPE_DN,		"decnet",	ethertype_decnet_print },
+	{ ETHERTYPE_ATALK,	"atalk",	ethertype_atalk_print },
+	{ ETHERTYPE_AARP,	"aarp",		ethertype_aarp_print },
+	{ ETHERTYPE_IPX,	"ipx",		ethertype_ipx_print },
+	{ ETHERTYPE_ISO,	"isoclns",	ethertype_isoclns_print },
+	{ ETHERTYPE_PPPOED,	"pppoe",	ethertype_pppoe_print },
+	{ ETHERTYPE_PPPOES,	"pppoe",	ethertype_pppoe_print },
+	{ ETHERTYPE_PPPOED2,	"pppoe",	ethertype_pppoe_print },
+	{ ETHERTYPE_PPPOES2,	"pppoe",	ethertype_pppoe_print },
+	{ ETHERTYPE_EAPOL,	"eap",		ethertype_eap_print },
+	{ ETHERTYPE_RRCP,	"rrcp",		ethertype_rrcp_print },
+	{ ETHERTYPE_PPP,	"ppp",		ethertype_ppp_print },
+	{ ETHERTYPE_MPCP,	"mpcp",		ethertype_mpcp_print },
+	{ ETHERTYPE_SLOW,	"slow",		ethertype_slow_print },
+	{ ETHERTYPE_CFM,	"cfm",		ethertype_cfm_print },
+	{ ETHERTYPE_CFM_OLD,	"cfm",		ethertype_cfm_print },
+	{ ETHERTYPE_LLDP,	"lldp",		ethertype_lldp_print },
+	{ ETHERTYPE_NSH,	"nsh",		ethertype_nsh_print },
+	{ ETHERTYPE_LOOPBACK,	"loopback",	ethertype_loopback_print },
+	{ ETHERTYPE_MPLS,	"mpls",		ethertype_mpls_print },
+	{ ETHERTYPE_MPLS_MULTI,	"mpls",		ethertype_mpls_print },
+	{ ETHERTYPE_TIPC,	"tipc",		ethertype_tipc_print },
+	{ ETHERTYPE_MS_NLB_HB,	"msnlb",	ethertype_msnlb_print },
+	{ ETHERTYPE_GEONET_OLD,	"geonet",	ethertype_geonet_print },
+	{ ETHERTYPE_GEONET,	"geonet",	ethertype_geonet_print },
+	{ ETHERTYPE_CALM_FAST,	"calm_fast",	ethertype_calm_fast_print },
+	{ ETHERTYPE_AOE,	"aoe",		ethertype_aoe_print },
+	{ ETHERTYPE_PTP,	"ptp",		ethertype_ptp_print },
+	{ 0,			NULL,		NULL }
+};
+
+/*
+ * The dispatch table, indexed by the upper and then the lower byte of
+ * the type so that only the blocks of types in use take up space.
+ */
+static const struct ethertype_dissector **ethertype_dispatch[256];
+
+/*
+ * Set the dissector for its ethertype.  Returns -1 if memory couldn't
+ * be allocated.
+ */
+int
+nd_register_ethertype(const struct ethertype_dissector *d)
+{
+	const struct ethertype_dissector **block;
+
+	block = ethertype_dispatch[d->type >> 8];
+	if (block == NULL) {
+		if (d->printer == NULL)
+			return (0);
+		block = (const struct ethertype_dissector **)calloc(256,
+		    sizeof(*block));
+		if (block == NULL)
+			return (-1);
+		ethertype_dispatch[d->type >> 8] = block;
+	}
+	block[d->type & 0xff] = d->printer != NULL ? d : NULL;
+	return (0);
+}
+
+static const struct ethertype_dissector *
+ethertype_lookup(u_short ether_type)
+{
+	const struct ethertype_dissector * const *block;
+
+	block = ethertype_dispatch[ether_type >> 8];
+	if (block == NULL)
+		return (NULL);
+	return (block[ether_type & 0xff]);
+}
+
 /*
  * Prints the packet payload, given an Ethernet type code for the payload's
  * protocol.
@@ -485,133 +1152,12 @@ ethertype_print(netdissect_options *ndo,
 		u_int length, u_int caplen,
 		const struct lladdr_info *src, const struct lladdr_info *dst)
 {
-	switch (ether_type) {
-
-	case ETHERTYPE_IP:
-		ip_print(ndo, p, length);
-		return (1);
+	const struct ethertype_dissector *d;
 
-	case ETHERTYPE_IPV6:
-		ip6_print(ndo, p, length);
-		return (1);
-
-	case ETHERTYPE_ARP:
-	case ETHERTYPE_REVARP:
-		arp_print(ndo, p, length, caplen);
-		return (1);
-
-	case ETHERTYPE_DN:
-		decnet_print(ndo, p, length, caplen);
-		return (1);
-
-	case ETHERTYPE_ATALK:
-		if (ndo->ndo_vflag)
-			ND_PRINT("et1 ");
-		atalk_print(ndo, p, length);
-		return (1);
-
-	case ETHERTYPE_AARP:
-		aarp_print(ndo, p, length);
-		return (1);
-
-	case ETHERTYPE_IPX:
-		ND_PRINT("(NOV-ETHII) ");
-		ipx_print(ndo, p, length);
-		return (1);
-
-	case ETHERTYPE_ISO:
-		if (length == 0 || caplen == 0) {
-			ndo->ndo_protocol = "isoclns";
-			nd_print_trunc(ndo);
-			return (1);
-		}
-		isoclns_print(ndo, p + 1, length - 1);
-		return(1);
-
-	case ETHERTYPE_PPPOED:
-	case ETHERTYPE_PPPOES:
-	case ETHERTYPE_PPPOED2:
-	case ETHERTYPE_PPPOES2:
-		pppoe_print(ndo, p, length);
-		return (1);
-
-	case ETHERTYPE_EAPOL:
-		eap_print(ndo, p, length);
-		return (1);
-
-	case ETHERTYPE_RRCP:
-		rrcp_print(ndo, p, length, src, dst);
-		return (1);
-
-	case ETHERTYPE_PPP:
-		if (length) {
-			ND_PRINT(": ");
-			ppp_print(ndo, p, length);
-		}
-		return (1);
-
-	case ETHERTYPE_MPCP:
-		mpcp_print(ndo, p, length);
-		return (1);
-
-	case ETHERTYPE_SLOW:
-		slow_print(ndo, p, length);
-		return (1);
-
-	case ETHERTYPE_CFM:
-	case ETHERTYPE_CFM_OLD:
-		cfm_print(ndo, p, length);
-		return (1);
-
-	case ETHERTYPE_LLDP:
-		lldp_print(ndo, p, length);
-		return (1);
-
-	case ETHERTYPE_NSH:
-		nsh_print(ndo, p, length);
-		return (1);
-
-	case ETHERTYPE_LOOPBACK:
-		loopback_print(ndo, p, length);
-		return (1);
-
-	case ETHERTYPE_MPLS:
-	case ETHERTYPE_MPLS_MULTI:
-		mpls_print(ndo, p, length);
-		return (1);
-
-	case ETHERTYPE_TIPC:
-		tipc_print(ndo, p, length, caplen);
-		return (1);
-
-	case ETHERTYPE_MS_NLB_HB:
-		msnlb_print(ndo, p);
-		return (1);
-
-	case ETHERTYPE_GEONET_OLD:
-	case ETHERTYPE_GEONET:
-		geonet_print(ndo, p, length, src);
-		return (1);
-
-	case ETHERTYPE_CALM_FAST:
-		calm_fast_print(ndo, p, length, src);
-		return (1);
-
-	case ETHERTYPE_AOE:
-		aoe_print(ndo, p, length);
-		return (1);
-
-	case ETHERTYPE_PTP:
-		ptp_print(ndo, p, length);
-		return (1);
-
-	case ETHERTYPE_LAT:
-	case ETHERTYPE_SCA:
-	case ETHERTYPE_MOPRC:
-	case ETHERTYPE_MOPDL:
-	case ETHERTYPE_IEEE1905_1:
-		/* default_print for now */
-	default:
+	if ((d = ethertype_lookup(ether_type)) == NULL)
 		return (0);
-	}
+	ND_PROFILE_ENTER(d->name);
+	(*d->printer)(ndo, p, length, caplen, src, dst);
+	ND_PROFILE_LEAVE();
+	return (1);
 }
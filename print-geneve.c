@@ -24,6 +24,7 @@
 #include "netdissect-stdinc.h"
 
 #include "netdissect.h"
+#include "netdissect-fields.h"
 #include "extract.h"
 #include "ethertype.h"
 
@@ -142,6 +143,27 @@ geneve_opts_print(netdissect_options *ndo, const u_char *bp, u_int len)
     }
 }
 
+/*
+ * Report the class, type and length of each option as fields, whatever
+ * the verbosity.
+ */
+static void
+geneve_opts_fields(netdissect_options *ndo, const u_char *bp, u_int len)
+{
+    u_int opt_len;
+
+    while (len >= 4) {
+        opt_len = 4 + ((GET_U_1(bp + 3) & OPT_LEN_MASK) * 4);
+        ND_FIELD_UINT(NDF_GENEVE_OPT, NDF_GENEVE_OPT_CLASS, GET_BE_U_2(bp));
+        ND_FIELD_UINT(NDF_GENEVE_OPT, NDF_GENEVE_OPT_TYPE, GET_U_1(bp + 2));
+        ND_FIELD_UINT(NDF_GENEVE_OPT, NDF_GENEVE_OPT_LEN, opt_len);
+        if (opt_len > len)
+            return;
+        bp += opt_len;
+        len -= opt_len;
+    }
+}
+
 void
 geneve_print(netdissect_options *ndo, const u_char *bp, u_int len)
 {
@@ -190,6 +212,13 @@ geneve_print(netdissect_options *ndo, const u_char *bp, u_int len)
     bp += 1;
     len -= 1;
 
+    opts_len = (ver_opt & HDR_OPTS_LEN_MASK) * 4;
+
+    ND_FIELD_UINT(NDF_GENEVE, NDF_GENEVE_VNI, vni);
+    ND_FIELD_UINT(NDF_GENEVE, NDF_GENEVE_PROTO, prot);
+    ND_FIELD_UINT(NDF_GENEVE, NDF_GENEVE_FLAGS, flags);
+    ND_FIELD_UINT(NDF_GENEVE, NDF_GENEVE_OPTLEN, opts_len);
+
     ND_PRINT(", Flags [%s]",
               bittok2str_nosep(geneve_flag_values, "none", flags));
     ND_PRINT(", vni 0x%x", vni);
@@ -201,8 +230,6 @@ geneve_print(netdissect_options *ndo, const u_char *bp, u_int len)
         ND_PRINT(", proto %s (0x%04x)",
                   tok2str(ethertype_values, "unknown", prot), prot);
 
-    opts_len = (ver_opt & HDR_OPTS_LEN_MASK) * 4;
-
     if (len < opts_len) {
         ND_PRINT(" truncated-geneve - %u bytes missing",
                   opts_len - len);
@@ -211,6 +238,9 @@ geneve_print(netdissect_options *ndo, const u_char *bp, u_int len)
 
     ND_TCHECK_LEN(bp, opts_len);
 
+    if (opts_len > 0 && ndo->ndo_field != NULL)
+        geneve_opts_fields(ndo, bp, opts_len);
+
     if (opts_len > 0) {
         ND_PRINT(", options [");
 
@@ -26,6 +26,7 @@
 #include "netdissect.h"
 #include "extract.h"
 #include "addrtoname.h"
+#include "v2x-stations.h"
 
 
 /*
@@ -102,6 +103,68 @@ trunc:
 }
 
 
+/*
+ * Count the packet for --v2x-stations against the station in its
+ * source position vector; returns 0 if it's too short to have one.
+ * The extended headers are only skipped, to get to the BTP message
+ * type, for the packet types whose extended header length is known,
+ * as in geonet_print().
+ */
+static int
+geonet_station_count(netdissect_options *ndo, const u_char *bp,
+		     u_int length)
+{
+	struct v2x_station_stats *st;
+	u_int next_hdr, hdr_type, hdr_subtype, msg_type;
+	int hdr_size = -1;
+
+	if (length < 36 || !ND_TTEST_LEN(bp, 36))
+		return (0);
+	next_hdr = GET_U_1(bp) & 0x0f;
+	hdr_type = GET_U_1(bp + 1) >> 4;
+	hdr_subtype = GET_U_1(bp + 1) & 0x0f;
+	st = v2x_station_count(ndo, V2X_GEONET, bp + 8);
+	v2x_station_position(st, GET_BE_S_4(bp + 20), GET_BE_S_4(bp + 24));
+	switch (hdr_type) {
+		case 0: /* Any */
+			hdr_size = 0;
+			break;
+		case 1: /* Beacon */
+			st->vss_beacons++;
+			hdr_size = 0;
+			break;
+		case 2: /* GeoUnicast */
+		case 6: /* LocService */
+			st->vss_unicasts++;
+			break;
+		case 3: /* GeoAnycast */
+		case 4: /* GeoBroadcast */
+			st->vss_multi_hop++;
+			break;
+		case 5: switch (hdr_subtype) {
+				case 0: /* TopoScopeBcast-SH */
+					st->vss_single_hop++;
+					hdr_size = 0;
+					break;
+				case 1: /* TopoScopeBcast-MH */
+					st->vss_multi_hop++;
+					hdr_size = 68 - 36;
+					break;
+			}
+			break;
+	}
+	if (hdr_size >= 0 && (next_hdr == 1 || next_hdr == 2) &&
+	    length >= 36 + (u_int)hdr_size + 6 &&
+	    ND_TTEST_1(bp + 36 + hdr_size + 5)) {
+		msg_type = GET_U_1(bp + 36 + hdr_size + 5);
+		if (msg_type == 0)
+			st->vss_cams++;
+		else if (msg_type == 1)
+			st->vss_denms++;
+	}
+	return (1);
+}
+
 /*
  * This is the top level routine of the printer.  'p' points
  * to the geonet header of the packet.
@@ -121,6 +184,12 @@ geonet_print(netdissect_options *ndo, const u_char *bp, u_int length,
 	int hdr_size = -1;
 
 	ndo->ndo_protocol = "geonet";
+	/* With --v2x-stations, only -vv and up print each packet. */
+	if (ndo->ndo_v2x_stations && geonet_station_count(ndo, bp, length) &&
+	    ndo->ndo_vflag < 2) {
+		ndo->ndo_drop_line = 1;
+		return;
+	}
 	ND_PRINT("GeoNet ");
 	if (src != NULL)
 		ND_PRINT("src:%s", (src->addr_string)(ndo, src->addr));
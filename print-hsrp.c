@@ -40,6 +40,7 @@
 #include "netdissect.h"
 #include "addrtoname.h"
 #include "extract.h"
+#include "change-only.h"
 
 /* HSRP op code types. */
 static const char *op_code_str[] = {
@@ -102,6 +103,11 @@ hsrp_print(netdissect_options *ndo, const u_char *bp, u_int len)
 	ndo->ndo_protocol = "hsrp";
 	ND_TCHECK_1(hp->hsrp_version);
 	version = GET_U_1(hp->hsrp_version);
+	if (ndo->ndo_changes_only && version == 0 &&
+	    GET_U_1(hp->hsrp_op_code) == 0 &&	/* hello */
+	    nd_change_repeat(ndo, ND_CHANGE_HSRP, hp->hsrp_group, 1,
+	    nd_change_hash(ndo, ND_CHANGE_HASH_INIT, bp, len)))
+		return;
 	ND_PRINT("HSRPv%u", version);
 	if (version != 0)
 		return;
@@ -19,11 +19,21 @@
 
 #include "netdissect-stdinc.h"
 
+#include <stddef.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
+#include "netdissect-ctype.h"
 #include "netdissect.h"
+#include "ascii_strcasecmp.h"
+#include "callcache.h"
 #include "extract.h"
+#include "latency.h"
+#include "tcp-reasm.h"
+
+#include "ip.h"
+#include "ip6.h"
 
 /*
  * Includes WebDAV requests.
@@ -76,3 +86,409 @@ http_print(netdissect_options *ndo, const u_char *pptr, u_int len)
 	ndo->ndo_protocol = "http";
 	txtproto_print(ndo, pptr, len, httpcmds, RESP_CODE_SECOND_TOKEN);
 }
+
+#define HTTP_ISXDIGIT(c) \
+	(ND_ASCII_ISDIGIT(c) || ((c) >= 'a' && (c) <= 'f') || \
+	 ((c) >= 'A' && (c) <= 'F'))
+
+#define HTTP_TOKEN_MAX	20	/* longer than any method or version */
+#define HTTP_HEADER_MAX	65536	/* the most the header block can take */
+#define HTTP_CRLF_MAX	4	/* empty lines before a message, in octets */
+/* A longer body isn't held back for; see http_parse_message(). */
+#define HTTP_BODY_MAX	(TCP_REASM_FLOW_MAX / 2)
+
+/*
+ * What http_parse() found in a message.  "hdrlen" is 0 if the header
+ * block hasn't all been seen.
+ */
+struct http_msg {
+	int response;
+	int line;		/* the request or status line was all seen */
+	const u_char *method;	/* of a request */
+	u_int methodlen;
+	const u_char *uri;
+	u_int urilen;
+	u_int status;		/* of a response */
+	u_int hdrlen;		/* the line and the header fields */
+	int bodyknown;		/* bodylen is known */
+	uint64_t bodylen;	/* without the chunk framing */
+};
+
+/*
+ * Look for the end of the line that starts at "off" in the "avail" bytes
+ * at "bp"; returns the offset just past its LF, or 0 if it isn't there.
+ */
+static u_int
+http_line_end(const u_char *bp, u_int avail, u_int off)
+{
+	const u_char *nl;
+
+	nl = (const u_char *)memchr(bp + off, '\n', avail - off);
+	return (nl != NULL ? (u_int)(nl - bp) + 1 : 0);
+}
+
+/*
+ * Parse the HTTP/1.x message that should start at "bp", of which
+ * "avail" bytes have been captured, into "m".  Returns 1 and sets
+ * "*msglen" to the length of the message if enough of it's there to
+ * tell, 0 if not, and -1 if it's not the start of a message, as a
+ * framer does (see portdispatch.h).
+ *
+ * A message is the header block and the body, by Content-Length or
+ * chunked; a response body that runs to the end of the connection, and
+ * one of more than HTTP_BODY_MAX bytes, isn't held back for, and the
+ * header block is a message by itself.  The response to a HEAD request
+ * has no body whatever its Content-Length says, which can't be told
+ * from the response alone; a response that's followed by another one
+ * where its body would start is taken to be one.
+ */
+static int
+http_parse_message(const u_char *bp, u_int avail, struct http_msg *m,
+    u_int *msglen)
+{
+	const char **cmd;
+	u_int i, ls, le, len, vl, off;
+	uint64_t clen = 0, size;
+	int have_clen = 0, chunked = 0;
+
+	memset(m, 0, sizeof(*m));
+	for (i = 0; i < avail && EXTRACT_U_1(bp + i) != ' '; i++)
+		if (i >= HTTP_TOKEN_MAX || !ND_ASCII_ISGRAPH(EXTRACT_U_1(bp + i)))
+			return (-1);
+	if (i == avail)
+		return (0);
+	if (i == 8 && memcmp(bp, "HTTP/1.", 7) == 0)
+		m->response = 1;
+	else {
+		for (cmd = httpcmds; *cmd != NULL; cmd++)
+			if (strlen(*cmd) == i && memcmp(bp, *cmd, i) == 0)
+				break;
+		if (*cmd == NULL)
+			return (-1);
+		m->method = bp;
+		m->methodlen = i;
+	}
+	i++;
+	if (m->response) {
+		if (avail < i + 3)
+			return (0);
+		for (len = 0; len < 3; len++) {
+			if (!ND_ASCII_ISDIGIT(EXTRACT_U_1(bp + i + len)))
+				return (-1);
+			m->status = m->status * 10 + EXTRACT_U_1(bp + i + len) - '0';
+		}
+	} else {
+		m->uri = bp + i;
+		while (i < avail && ND_ASCII_ISGRAPH(EXTRACT_U_1(bp + i)))
+			i++;
+		m->urilen = (u_int)(bp + i - m->uri);
+	}
+	if ((ls = http_line_end(bp, avail, i)) == 0)
+		return (avail > HTTP_HEADER_MAX ? -1 : 0);
+	m->line = 1;
+
+	/* The header fields, up to the empty line. */
+	for (;;) {
+		if ((le = http_line_end(bp, avail, ls)) == 0)
+			return (avail > HTTP_HEADER_MAX ? -1 : 0);
+		len = le - ls - 1;
+		if (len != 0 && EXTRACT_U_1(bp + ls + len - 1) == '\r')
+			len--;
+		if (len == 0)
+			break;
+		if (len > 15 &&
+		    ascii_strncasecmp((const char *)bp + ls, "content-length:",
+		    15) == 0) {
+			for (i = ls + 15; i < ls + len &&
+			    (EXTRACT_U_1(bp + i) == ' ' ||
+			     EXTRACT_U_1(bp + i) == '\t'); i++)
+				;
+			if (i == ls + len)
+				return (-1);
+			for (clen = 0; i < ls + len &&
+			    ND_ASCII_ISDIGIT(EXTRACT_U_1(bp + i)); i++) {
+				clen = clen * 10 + EXTRACT_U_1(bp + i) - '0';
+				if (clen > UINT32_MAX * (uint64_t)1024)
+					return (-1);
+			}
+			have_clen = 1;
+		} else if (len > 18 &&
+		    ascii_strncasecmp((const char *)bp + ls,
+		    "transfer-encoding:", 18) == 0) {
+			/* chunked has to be the last coding. */
+			for (vl = len; vl > 18 &&
+			    (EXTRACT_U_1(bp + ls + vl - 1) == ' ' ||
+			     EXTRACT_U_1(bp + ls + vl - 1) == '\t'); vl--)
+				;
+			chunked = vl >= 18 + 7 &&
+			    ascii_strncasecmp((const char *)bp + ls + vl - 7,
+			    "chunked", 7) == 0;
+		}
+		ls = le;
+		if (ls > HTTP_HEADER_MAX)
+			return (-1);
+	}
+	m->hdrlen = le;
+	*msglen = le;
+
+	/* The body. */
+	m->bodyknown = 1;
+	if (m->response && (m->status / 100 == 1 || m->status == 204 ||
+	    m->status == 304))
+		return (1);
+	if (chunked) {
+		for (off = le; ; off = le) {
+			size = 0;
+			for (i = off; i < avail &&
+			    HTTP_ISXDIGIT(EXTRACT_U_1(bp + i)); i++) {
+				size = size * 16 +
+				    (ND_ASCII_ISDIGIT(EXTRACT_U_1(bp + i)) ?
+				     EXTRACT_U_1(bp + i) - '0' :
+				     (EXTRACT_U_1(bp + i) | 0x20) - 'a' + 10);
+				if (size > HTTP_BODY_MAX)
+					goto long_body;
+			}
+			if (i == off && i < avail)
+				return (-1);
+			if ((le = http_line_end(bp, avail, off)) == 0)
+				break;
+			if (size == 0) {
+				/* The trailer fields, up to the empty line. */
+				for (;;) {
+					ls = le;
+					if ((le = http_line_end(bp, avail,
+					    ls)) == 0)
+						goto more;
+					if (le - ls == 1 || (le - ls == 2 &&
+					    EXTRACT_U_1(bp + ls) == '\r'))
+						break;
+				}
+				*msglen = le;
+				return (1);
+			}
+			m->bodylen += size;
+			if (m->bodylen > HTTP_BODY_MAX)
+				goto long_body;
+			if (avail - le < size)
+				break;
+			le += (u_int)size;
+			if ((le = http_line_end(bp, avail, le)) == 0)
+				break;
+		}
+more:
+		if (avail - m->hdrlen <= HTTP_BODY_MAX)
+			return (0);
+long_body:
+		m->bodyknown = 0;
+		m->bodylen = 0;
+		return (1);
+	}
+	if (!have_clen) {
+		if (m->response) {
+			/* It runs to the end of the connection. */
+			m->bodyknown = 0;
+		}
+		return (1);
+	}
+	m->bodylen = clen;
+	if (clen > HTTP_BODY_MAX)
+		return (1);
+	if (m->response && clen != 0 && avail - le >= 7 &&
+	    memcmp(bp + le, "HTTP/1.", 7) == 0) {
+		m->bodylen = 0;		/* to a HEAD request */
+		return (1);
+	}
+	*msglen = le + (u_int)clen;
+	return (1);
+}
+
+/*
+ * As http_parse_message(), but passing over the empty lines RFC 9112
+ * section 2.2 lets a client send before a request, as part of it.
+ */
+static int
+http_parse(const u_char *bp, u_int avail, struct http_msg *m,
+    u_int *msglen)
+{
+	u_int skip;
+	int ret;
+
+	for (skip = 0; skip < avail && skip < HTTP_CRLF_MAX &&
+	    (EXTRACT_U_1(bp + skip) == '\r' ||
+	     EXTRACT_U_1(bp + skip) == '\n'); skip++)
+		;
+	if (skip == HTTP_CRLF_MAX)
+		return (-1);
+	ret = http_parse_message(bp + skip, avail - skip, m, msglen);
+	if (ret == 1)
+		*msglen += skip;
+	if (m->hdrlen != 0)
+		m->hdrlen += skip;
+	return (ret);
+}
+
+/*
+ * The framer for --tcp-reassembly.
+ */
+int
+http_frame(const u_char *bp, u_int avail, u_int *msglen)
+{
+	struct http_msg m;
+
+	return (http_parse(bp, avail, &m, msglen));
+}
+
+/*
+ * Requests seen, for --http-transactions, so that a response can be
+ * paired with the request it answers.  Responses come in the order of
+ * the requests, so those of a connection are numbered, from 0, with
+ * an entry for the connection, HTTP_CONN_INDEX, that has the numbers
+ * of the next request and the next response; it's entered again with
+ * each request, so that it's as recent as the requests are.
+ */
+struct http_call_key {
+	uint32_t ipver;
+	nd_ipv6 client;
+	nd_ipv6 server;
+	uint32_t cport;
+	uint32_t sport;
+	uint32_t index;
+};
+
+#define HTTP_CONN_INDEX	0xffffffffU
+#define HTTP_METHOD_LEN	17	/* "BASELINE-CONTROL" */
+#define HTTP_URI_LEN	80
+
+struct http_call_entry {
+	struct callcache_entry ce;
+	struct http_call_key key;
+	uint32_t nreq;		/* of the connection's entry */
+	uint32_t nresp;
+	char method[HTTP_METHOD_LEN];
+	char uri[HTTP_URI_LEN];
+};
+
+#define HTTP_CALL_TIMEOUT	300
+
+static const struct callcache_type http_call_type = {
+	sizeof(struct http_call_entry),
+	offsetof(struct http_call_entry, key),
+	sizeof(struct http_call_key),
+	HTTP_CALL_TIMEOUT
+};
+
+/*
+ * For --http-transactions, note the request, or print what the response
+ * answered, of the HTTP message "bp" from port "sport" to port "dport"
+ * of the IPv4 or IPv6 datagram "iph": the method, the URI, the status,
+ * the size of the body and the time from the request.  The times are
+ * counted for --latency-report too.  The lines of segments that don't
+ * give one are dropped, when the segment's seen to be HTTP (see
+ * tcp_print()); this clears ndo_drop_line, and the first response of a
+ * segment is printed after ": " and the others after "; ".
+ */
+void
+http_transaction(netdissect_options *ndo, const u_char *bp, u_int length,
+    const u_char *iph, u_int sport, u_int dport)
+{
+	const struct ip *ip = (const struct ip *)iph;
+	const struct ip6_hdr *ip6 = (const struct ip6_hdr *)iph;
+	struct http_call_entry *conn, *hce;
+	struct http_call_key key;
+	struct http_msg m;
+	uint32_t nreq, nresp;
+	uint64_t us;
+	u_int avail, msglen, i;
+
+	if (iph == NULL)
+		return;
+	avail = ND_BYTES_AVAILABLE_AFTER(bp);
+	if (avail > length)
+		avail = length;
+	if (http_parse(bp, avail, &m, &msglen) == -1 || !m.line)
+		return;
+	/*
+	 * The IP header has been looked at already, and a reassembled
+	 * message isn't in the packet, so it isn't checked against the
+	 * snapshot end again.
+	 */
+	memset(&key, 0, sizeof(key));
+	key.ipver = EXTRACT_U_1(ip->ip_vhl) >> 4;
+	switch (key.ipver) {
+	case 4:
+		memcpy(m.response ? &key.server : &key.client, ip->ip_src,
+		    sizeof(nd_ipv4));
+		memcpy(m.response ? &key.client : &key.server, ip->ip_dst,
+		    sizeof(nd_ipv4));
+		break;
+	case 6:
+		memcpy(m.response ? &key.server : &key.client, ip6->ip6_src,
+		    sizeof(nd_ipv6));
+		memcpy(m.response ? &key.client : &key.server, ip6->ip6_dst,
+		    sizeof(nd_ipv6));
+		break;
+	default:
+		return;
+	}
+	key.cport = m.response ? dport : sport;
+	key.sport = m.response ? sport : dport;
+	key.index = HTTP_CONN_INDEX;
+	conn = (struct http_call_entry *)callcache_find(ndo, &http_call_type,
+	    &key);
+
+	if (!m.response) {
+		nreq = conn != NULL ? conn->nreq : 0;
+		nresp = conn != NULL ? conn->nresp : 0;
+		key.index = nreq;
+		hce = (struct http_call_entry *)callcache_enter(ndo,
+		    &http_call_type, &key);
+		if (hce == NULL)
+			return;
+		memcpy(hce->method, m.method, m.methodlen);
+		if (m.urilen < sizeof(hce->uri))
+			memcpy(hce->uri, m.uri, m.urilen);
+		else {
+			i = sizeof(hce->uri) - 4;
+			memcpy(hce->uri, m.uri, i);
+			memcpy(hce->uri + i, "...", 3);
+		}
+		key.index = HTTP_CONN_INDEX;
+		conn = (struct http_call_entry *)callcache_enter(ndo,
+		    &http_call_type, &key);
+		if (conn != NULL) {
+			conn->nreq = nreq + 1;
+			conn->nresp = nresp;
+		}
+		return;
+	}
+
+	/* An interim response comes before the one that answers. */
+	if (m.status / 100 == 1 && m.status != 101)
+		return;
+	hce = NULL;
+	if (conn != NULL && conn->nresp != conn->nreq) {
+		key.index = conn->nresp++;
+		hce = (struct http_call_entry *)callcache_find(ndo,
+		    &http_call_type, &key);
+	}
+	if (hce != NULL && strcmp(hce->method, "HEAD") == 0)
+		m.bodylen = 0;
+	ND_PRINT("%s", ndo->ndo_drop_line ? ": " : "; ");
+	ndo->ndo_drop_line = 0;
+	if (hce != NULL)
+		ND_PRINT("%s %s %03u", hce->method, hce->uri, m.status);
+	else
+		ND_PRINT("[request not seen] %03u", m.status);
+	if (m.hdrlen != 0 && m.bodyknown)
+		ND_PRINT(", %" PRIu64 " byte%s", m.bodylen,
+		    PLURAL_SUFFIX(m.bodylen));
+	if (hce != NULL) {
+		if (ndo->ndo_latency)
+			us = latency_record(ndo, "http", hce->method,
+			    hce->ce.cce_ts);
+		else
+			us = latency_elapsed(ndo, hce->ce.cce_ts);
+		ND_PRINT(", %" PRIu64 ".%03u ms", us / 1000,
+		    (u_int)(us % 1000));
+	}
+}
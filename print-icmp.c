@@ -31,6 +31,7 @@
 #include <string.h>
 
 #include "netdissect.h"
+#include "netdissect-fields.h"
 #include "addrtoname.h"
 #include "extract.h"
 
@@ -280,7 +281,7 @@ icmp_tstamp_print(u_int tstamp)
 {
     u_int msec,sec,min,hrs;
 
-    static char buf[64];
+    static ND_THREAD_LOCAL char buf[64];
 
     msec = tstamp % 1000;
     sec = tstamp / 1000;
@@ -321,6 +322,8 @@ icmp_print(netdissect_options *ndo, const u_char *bp, u_int plen, const u_char *
 	ND_TCHECK_1(dp->icmp_code);
 	icmp_type = GET_U_1(dp->icmp_type);
 	icmp_code = GET_U_1(dp->icmp_code);
+	ND_FIELD_UINT(NDF_ICMP, NDF_ICMP_TYPE, icmp_type);
+	ND_FIELD_UINT(NDF_ICMP, NDF_ICMP_CODE, icmp_code);
 	switch (icmp_type) {
 
 	case ICMP_ECHO:
@@ -31,12 +31,15 @@
 #include <string.h>
 
 #include "netdissect.h"
+#include "netdissect-fields.h"
 #include "addrtoname.h"
 #include "addrtostr.h"
 #include "extract.h"
 
 #include "ip6.h"
 #include "ipproto.h"
+#include "arp-watch.h"
+#include "mcast-group.h"
 
 #include "udp.h"
 #include "ah.h"
@@ -484,6 +487,7 @@ static void print_lladdr(netdissect_options *ndo, const u_char *, size_t);
 static int icmp6_opt_print(netdissect_options *ndo, const u_char *, int);
 static void mld6_print(netdissect_options *ndo, const u_char *);
 static void mldv2_report_print(netdissect_options *ndo, const u_char *, u_int);
+static void mld_groups(netdissect_options *ndo, const u_char *, u_int, const u_char *);
 static void mldv2_query_print(netdissect_options *ndo, const u_char *, u_int);
 static const struct udphdr *get_upperlayer(netdissect_options *ndo, const u_char *, u_int *);
 static void dnsname_print(netdissect_options *ndo, const u_char *, const u_char *);
@@ -689,6 +693,12 @@ static const struct tok icmp6_dst_unreach_code_values[] = {
     { 0,	NULL }
 };
 
+/*
+ * The flags are formatted into the caller's buffer, which is big enough
+ * for all of the names in any of these tables.
+ */
+#define ICMP6_FLAGS_BUFSIZE	64
+
 static const struct tok icmp6_opt_pi_flag_values[] = {
     { ND_OPT_PI_FLAG_ONLINK, "onlink" },
     { ND_OPT_PI_FLAG_AUTO, "auto" },
@@ -711,30 +721,39 @@ static const struct tok icmp6_nd_na_flag_values[] = {
     { 0,	NULL }
 };
 
-
-static const struct tok icmp6_opt_values[] = {
-   { ND_OPT_SOURCE_LINKADDR, "source link-address"},
-   { ND_OPT_TARGET_LINKADDR, "destination link-address"},
-   { ND_OPT_PREFIX_INFORMATION, "prefix info"},
-   { ND_OPT_REDIRECTED_HEADER, "redirected header"},
-   { ND_OPT_MTU, "mtu"},
-   { ND_OPT_RDNSS, "rdnss"},
-   { ND_OPT_DNSSL, "dnssl"},
-   { ND_OPT_ADVINTERVAL, "advertisement interval"},
-   { ND_OPT_HOMEAGENT_INFO, "homeagent information"},
-   { ND_OPT_ROUTE_INFO, "route info"},
-   { 0,	NULL }
+/*
+ * The option types, the RPL suboption types and modes of operation and
+ * the MLDv2 record types are small numbers, looked up for each option
+ * or record, so they're arrays indexed by the value, for tok2strary(),
+ * rather than token tables to be scanned; a NULL is an unknown value.
+ */
+static const char *icmp6_opt_values[] = {
+	NULL,
+	"source link-address",		/* ND_OPT_SOURCE_LINKADDR */
+	"destination link-address",	/* ND_OPT_TARGET_LINKADDR */
+	"prefix info",			/* ND_OPT_PREFIX_INFORMATION */
+	"redirected header",		/* ND_OPT_REDIRECTED_HEADER */
+	"mtu",				/* ND_OPT_MTU */
+	NULL,
+	"advertisement interval",	/* ND_OPT_ADVINTERVAL */
+	"homeagent information",	/* ND_OPT_HOMEAGENT_INFO */
+	NULL, NULL, NULL, NULL, NULL, NULL, NULL,		/* 9-15 */
+	NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL,		/* 16-23 */
+	"route info",			/* ND_OPT_ROUTE_INFO */
+	"rdnss",			/* ND_OPT_RDNSS */
+	NULL, NULL, NULL, NULL, NULL,				/* 26-30 */
+	"dnssl",			/* ND_OPT_DNSSL */
 };
 
 /* mldv2 report types */
-static const struct tok mldv2report2str[] = {
-	{ 1,	"is_in" },
-	{ 2,	"is_ex" },
-	{ 3,	"to_in" },
-	{ 4,	"to_ex" },
-	{ 5,	"allow" },
-	{ 6,	"block" },
-	{ 0,	NULL }
+static const char *mldv2report2str[] = {
+	NULL,
+	"is_in",
+	"is_ex",
+	"to_in",
+	"to_ex",
+	"allow",
+	"block",
 };
 
 static const char *
@@ -753,7 +772,7 @@ get_rtpref(u_int v)
 static const char *
 get_lifetime(uint32_t v)
 {
-	static char buf[20];
+	static ND_THREAD_LOCAL char buf[20];
 
 	if (v == (uint32_t)~0UL)
 		return "infinity";
@@ -786,25 +805,24 @@ static uint16_t icmp6_cksum(netdissect_options *ndo, const struct ip6_hdr *ip6,
 				IPPROTO_ICMPV6);
 }
 
-static const struct tok rpl_mop_values[] = {
-        { RPL_DIO_NONSTORING,         "nonstoring"},
-        { RPL_DIO_STORING,            "storing"},
-        { RPL_DIO_NONSTORING_MULTICAST, "nonstoring-multicast"},
-        { RPL_DIO_STORING_MULTICAST,  "storing-multicast"},
-        { 0, NULL},
+static const char *rpl_mop_values[] = {
+        "nonstoring",			/* RPL_DIO_NONSTORING */
+        "storing",			/* RPL_DIO_STORING */
+        "nonstoring-multicast",		/* RPL_DIO_NONSTORING_MULTICAST */
+        "storing-multicast",		/* RPL_DIO_STORING_MULTICAST */
 };
 
-static const struct tok rpl_subopt_values[] = {
-        { RPL_OPT_PAD1, "pad1"},
-        { RPL_OPT_PADN, "padN"},
-        { RPL_DIO_METRICS, "metrics"},
-        { RPL_DIO_ROUTINGINFO, "routinginfo"},
-        { RPL_DIO_CONFIG,    "config"},
-        { RPL_DAO_RPLTARGET, "rpltarget"},
-        { RPL_DAO_TRANSITINFO, "transitinfo"},
-        { RPL_DIO_DESTPREFIX, "destprefix"},
-        { RPL_DAO_RPLTARGET_DESC, "rpltargetdesc"},
-        { 0, NULL},
+static const char *rpl_subopt_values[] = {
+        "pad1",				/* RPL_OPT_PAD1 */
+        "padN",				/* RPL_OPT_PADN */
+        "metrics",			/* RPL_DIO_METRICS */
+        "routinginfo",			/* RPL_DIO_ROUTINGINFO */
+        "config",			/* RPL_DIO_CONFIG */
+        "rpltarget",			/* RPL_DAO_RPLTARGET */
+        "transitinfo",			/* RPL_DAO_TRANSITINFO */
+        NULL,
+        "destprefix",			/* RPL_DIO_DESTPREFIX */
+        "rpltargetdesc",		/* RPL_DAO_RPLTARGET_DESC */
 };
 
 static void
@@ -826,7 +844,7 @@ rpl_printopts(netdissect_options *ndo, const uint8_t *opts, u_int length)
                 		goto trunc;
 	                optlen = GET_U_1(opt->rpl_dio_len)+RPL_GENOPTION_LEN;
                         ND_PRINT(" opt:%s len:%u ",
-                                  tok2str(rpl_subopt_values, "subopt:%u", dio_type),
+                                  tok2strary(rpl_subopt_values, "subopt:%u", dio_type),
                                   optlen);
                         ND_TCHECK_LEN(opt, optlen);
                         if (length < optlen)
@@ -863,7 +881,7 @@ rpl_dio_print(netdissect_options *ndo,
                   GET_U_1(dio->rpl_instanceid),
                   GET_BE_U_2(dio->rpl_dagrank),
                   RPL_DIO_GROUNDED(GET_U_1(dio->rpl_mopprf)) ? "grounded,":"",
-                  tok2str(rpl_mop_values, "mop%u", RPL_DIO_MOP(GET_U_1(dio->rpl_mopprf))),
+                  tok2strary(rpl_mop_values, "mop%u", RPL_DIO_MOP(GET_U_1(dio->rpl_mopprf))),
                   RPL_DIO_PRF(GET_U_1(dio->rpl_mopprf)));
 
         if(ndo->ndo_vflag > 1) {
@@ -1022,6 +1040,45 @@ trunc:
 
 }
 
+/*
+ * --arp-watch: a Neighbor Solicitation binds its source address to its
+ * source link-layer address option, unless it's from the unspecified
+ * address, for Duplicate Address Detection; a Neighbor Advertisement
+ * binds its target to its target link-layer address option.  Return 1
+ * if the message is only a refresh, and isn't to be printed.
+ */
+static int
+icmp6_nd_watch(netdissect_options *ndo, const u_char *bp, u_int length,
+	       const struct ip6_hdr *ip, u_int type)
+{
+	static const u_char unspecified[16];
+	const u_char *addr, *op;
+	u_int want, optlen;
+
+	if (length < 24 || !ND_TTEST_LEN(bp, 24))
+		return (0);
+	if (type == ND_NEIGHBOR_SOLICIT) {
+		addr = ip->ip6_src;
+		if (memcmp(addr, unspecified, sizeof(unspecified)) == 0)
+			return (0);
+		want = ND_OPT_SOURCE_LINKADDR;
+	} else {
+		addr = bp + 8;
+		want = ND_OPT_TARGET_LINKADDR;
+	}
+	for (op = bp + 24, length -= 24; length >= 8; op += optlen,
+	    length -= optlen) {
+		if (!ND_TTEST_2(op))
+			return (0);
+		optlen = GET_U_1(op + 1) * 8;
+		if (optlen == 0 || optlen > length)
+			return (0);
+		if (GET_U_1(op) == want && optlen == 8)
+			return (arp_watch(ndo, AF_INET6, addr, op + 2));
+	}
+	return (0);
+}
+
 
 void
 icmp6_print(netdissect_options *ndo,
@@ -1048,6 +1105,12 @@ icmp6_print(netdissect_options *ndo,
 		return;
 	}
 
+	if (ndo->ndo_arp_watch && !fragmented && ND_TTEST_1(dp->icmp6_type) &&
+	    (GET_U_1(dp->icmp6_type) == ND_NEIGHBOR_SOLICIT ||
+	     GET_U_1(dp->icmp6_type) == ND_NEIGHBOR_ADVERT) &&
+	    icmp6_nd_watch(ndo, bp, length, ip, GET_U_1(dp->icmp6_type)))
+		return;
+
 	if (ndo->ndo_vflag && !fragmented) {
 		uint16_t sum, udp_sum;
 
@@ -1066,6 +1129,10 @@ icmp6_print(netdissect_options *ndo,
 
 	ND_TCHECK_1(dp->icmp6_type);
 	icmp6_type = GET_U_1(dp->icmp6_type);
+	ND_FIELD_UINT(NDF_ICMP6, NDF_ICMP6_TYPE, icmp6_type);
+	if (ND_TTEST_1(dp->icmp6_code))
+		ND_FIELD_UINT(NDF_ICMP6, NDF_ICMP6_CODE,
+		    GET_U_1(dp->icmp6_code));
 	ND_PRINT("ICMP6, %s", tok2str(icmp6_type_values,"unknown icmp6 type (%u)",icmp6_type));
 
         /* display cosmetics: print the packet length for printer that use the vflag now */
@@ -1192,9 +1259,13 @@ icmp6_print(netdissect_options *ndo,
 		break;
 	case ICMP6_MEMBERSHIP_REPORT:
 		mld6_print(ndo, (const u_char *)dp);
+		if (ndo->ndo_mcast_groups)
+			mld_groups(ndo, (const u_char *)dp, length, bp2);
 		break;
 	case ICMP6_MEMBERSHIP_REDUCTION:
 		mld6_print(ndo, (const u_char *)dp);
+		if (ndo->ndo_mcast_groups)
+			mld_groups(ndo, (const u_char *)dp, length, bp2);
 		break;
 	case ND_ROUTER_SOLICIT:
 #define RTSOLLEN 8
@@ -1208,13 +1279,16 @@ icmp6_print(netdissect_options *ndo,
 #define RTADVLEN 16
 		if (ndo->ndo_vflag) {
 			const struct nd_router_advert *p;
+			char flags[ICMP6_FLAGS_BUFSIZE];
 
 			p = (const struct nd_router_advert *)dp;
 			ND_TCHECK_4(p->nd_ra_retransmit);
 			ND_PRINT("\n\thop limit %u, Flags [%s]"
                                   ", pref %s, router lifetime %us, reachable time %ums, retrans timer %ums",
                                   GET_U_1(p->nd_ra_curhoplimit),
-                                  bittok2str(icmp6_opt_ra_flag_values,"none",GET_U_1(p->nd_ra_flags_reserved)),
+                                  bittok2strbuf(icmp6_opt_ra_flag_values, "none",
+                                      GET_U_1(p->nd_ra_flags_reserved),
+                                      ", ", flags, sizeof(flags)),
                                   get_rtpref(GET_U_1(p->nd_ra_flags_reserved)),
                                   GET_BE_U_2(p->nd_ra_router_lifetime),
                                   GET_BE_U_4(p->nd_ra_reachable),
@@ -1242,6 +1316,7 @@ icmp6_print(netdissect_options *ndo,
 	case ND_NEIGHBOR_ADVERT:
 	    {
 		const struct nd_neighbor_advert *p;
+		char flags[ICMP6_FLAGS_BUFSIZE];
 
 		p = (const struct nd_neighbor_advert *)dp;
 		ND_TCHECK_16(p->nd_na_target);
@@ -1249,9 +1324,10 @@ icmp6_print(netdissect_options *ndo,
                           GET_IP6ADDR_STRING(p->nd_na_target));
 		if (ndo->ndo_vflag) {
                         ND_PRINT(", Flags [%s]",
-                                  bittok2str(icmp6_nd_na_flag_values,
+                                  bittok2strbuf(icmp6_nd_na_flag_values,
                                              "none",
-                                             GET_BE_U_4(p->nd_na_flags_reserved)));
+                                             GET_BE_U_4(p->nd_na_flags_reserved),
+                                             ", ", flags, sizeof(flags)));
 #define NDADVLEN 24
 			if (icmp6_opt_print(ndo, (const u_char *)dp + NDADVLEN,
 					    length - NDADVLEN) == -1)
@@ -1290,6 +1366,8 @@ icmp6_print(netdissect_options *ndo,
 		break;
 	case ICMP6_V2_MEMBERSHIP_REPORT:
 		mldv2_report_print(ndo, (const u_char *) dp, length);
+		if (ndo->ndo_mcast_groups)
+			mld_groups(ndo, (const u_char *)dp, length, bp2);
 		break;
 	case ICMP6_MOBILEPREFIX_SOLICIT: /* fall through */
 	case ICMP6_HADISCOV_REQUEST:
@@ -1441,6 +1519,7 @@ icmp6_opt_print(netdissect_options *ndo, const u_char *bp, int resid)
 	nd_ipv6 in6;
 	size_t l;
 	u_int i;
+	char flags[ICMP6_FLAGS_BUFSIZE];
 
 	cp = bp;
 	/* 'ep' points to the end of available data. */
@@ -1460,7 +1539,7 @@ icmp6_opt_print(netdissect_options *ndo, const u_char *bp, int resid)
 			goto trunc;
 
                 ND_PRINT("\n\t  %s option (%u), length %u (%u): ",
-                          tok2str(icmp6_opt_values, "unknown", opt_type),
+                          tok2strary(icmp6_opt_values, "unknown", opt_type),
                           opt_type,
                           opt_len << 3,
                           opt_len);
@@ -1481,7 +1560,9 @@ icmp6_opt_print(netdissect_options *ndo, const u_char *bp, int resid)
                                   GET_IP6ADDR_STRING(opp->nd_opt_pi_prefix),
                                   GET_U_1(opp->nd_opt_pi_prefix_len),
                                   (opt_len != 4) ? "badlen" : "",
-                                  bittok2str(icmp6_opt_pi_flag_values, "none", GET_U_1(opp->nd_opt_pi_flags_reserved)),
+                                  bittok2strbuf(icmp6_opt_pi_flag_values, "none",
+                                      GET_U_1(opp->nd_opt_pi_flags_reserved),
+                                      ", ", flags, sizeof(flags)),
                                   get_lifetime(GET_BE_U_4(opp->nd_opt_pi_valid_time)));
                         ND_PRINT(", pref. time %s",
 				 get_lifetime(GET_BE_U_4(opp->nd_opt_pi_preferred_time)));
@@ -1621,7 +1702,7 @@ mldv2_report_print(netdissect_options *ndo, const u_char *bp, u_int len)
 	    }
             ND_TCHECK_LEN(bp + 4 + group, sizeof(nd_ipv6));
             ND_PRINT(" [gaddr %s", GET_IP6ADDR_STRING(bp + group + 4));
-	    ND_PRINT(" %s", tok2str(mldv2report2str, " [v2-report-#%u]",
+	    ND_PRINT(" %s", tok2strary(mldv2report2str, " [v2-report-#%u]",
                                          GET_U_1(bp + group)));
             nsrcs = GET_BE_U_2(bp + group + 2);
 	    /* Check the number of sources and print them */
@@ -1652,6 +1733,51 @@ trunc:
     return;
 }
 
+/*
+ * Update the --mcast-groups state from an MLD report or done from the
+ * host that sent the datagram; one that changes nothing isn't shown.
+ */
+static void
+mld_groups(netdissect_options *ndo, const u_char *bp, u_int len,
+           const u_char *ip6)
+{
+    const u_char *host;
+    u_int group, nsrcs, ngroups, i;
+    int changed = 0;
+
+    if (ip6 == NULL || len < 8 || !ND_TTEST_LEN(bp, 8))
+        return;
+    host = ip6 + 8;
+    switch (GET_U_1(bp)) {
+    case ICMP6_MEMBERSHIP_REPORT:
+    case ICMP6_MEMBERSHIP_REDUCTION:
+        if (len < MLD_MINLEN || !ND_TTEST_LEN(bp + 8, sizeof(nd_ipv6)))
+            return;
+        changed = mcast_report(ndo, AF_INET6, bp + 8, NULL, host,
+            GET_U_1(bp) == ICMP6_MEMBERSHIP_REPORT);
+        break;
+    case ICMP6_V2_MEMBERSHIP_REPORT:
+        ngroups = GET_BE_U_2(bp + 6);
+        group = 8;
+        for (i = 0; i < ngroups; i++) {
+            if (len < group + 20 || !ND_TTEST_LEN(bp + group, 20))
+                break;
+            nsrcs = GET_BE_U_2(bp + group + 2);
+            if (len < group + 20 + nsrcs * sizeof(nd_ipv6) ||
+                !ND_TTEST_LEN(bp + group + 20, nsrcs * sizeof(nd_ipv6)))
+                break;
+            changed |= mcast_record(ndo, AF_INET6, GET_U_1(bp + group),
+                bp + group + 4, bp + group + 20, nsrcs, host);
+            group += 20 + nsrcs * sizeof(nd_ipv6);
+        }
+        break;
+    default:
+        return;
+    }
+    if (!changed)
+        ndo->ndo_drop_line = 1;
+}
+
 static void
 mldv2_query_print(netdissect_options *ndo, const u_char *bp, u_int len)
 {
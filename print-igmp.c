@@ -38,6 +38,7 @@
 #include "netdissect.h"
 #include "addrtoname.h"
 #include "extract.h"
+#include "mcast-group.h"
 
 #ifndef IN_CLASSD
 #define IN_CLASSD(i) (((int32_t)(i) & 0xf0000000) == 0xe0000000)
@@ -205,6 +206,52 @@ trunc:
     nd_print_trunc(ndo);
 }
 
+/*
+ * Update the --mcast-groups state from a report or leave from the host
+ * that sent the datagram; one that changes nothing isn't shown.
+ */
+static void
+igmp_groups(netdissect_options *ndo, const u_char *bp, u_int len,
+            const u_char *iph)
+{
+    const u_char *host;
+    u_int group, nsrcs, ngroups, i;
+    int changed = 0;
+
+    if (iph == NULL || GET_U_1(iph) >> 4 != 4 ||
+        len < 8 || !ND_TTEST_LEN(bp, 8))
+        return;
+    host = iph + 12;
+    switch (GET_U_1(bp)) {
+    case 0x12:
+    case 0x16:
+        changed = mcast_report(ndo, AF_INET, bp + 4, NULL, host, 1);
+        break;
+    case 0x17:
+        changed = mcast_report(ndo, AF_INET, bp + 4, NULL, host, 0);
+        break;
+    case 0x22:
+        ngroups = GET_BE_U_2(bp + 6);
+        group = 8;
+        for (i = 0; i < ngroups; i++) {
+            if (len < group + 8 || !ND_TTEST_LEN(bp + group, 8))
+                break;
+            nsrcs = GET_BE_U_2(bp + group + 2);
+            if (len < group + 8 + (nsrcs << 2) ||
+                !ND_TTEST_LEN(bp + group + 8, nsrcs << 2))
+                break;
+            changed |= mcast_record(ndo, AF_INET, GET_U_1(bp + group),
+                bp + group + 4, bp + group + 8, nsrcs, host);
+            group += 8 + (nsrcs << 2);
+        }
+        break;
+    default:
+        return;
+    }
+    if (!changed)
+        ndo->ndo_drop_line = 1;
+}
+
 static void
 print_igmpv3_query(netdissect_options *ndo,
                    const u_char *bp, u_int len)
@@ -263,13 +310,15 @@ trunc:
 
 void
 igmp_print(netdissect_options *ndo,
-           const u_char *bp, u_int len)
+           const u_char *bp, u_int len, const u_char *iph)
 {
     struct cksum_vec vec[1];
 
     ndo->ndo_protocol = "igmp";
     if (ndo->ndo_qflag) {
         ND_PRINT("igmp");
+        if (ndo->ndo_mcast_groups)
+            igmp_groups(ndo, bp, len, iph);
         return;
     }
 
@@ -341,6 +390,8 @@ igmp_print(netdissect_options *ndo,
         if (in_cksum(vec, 1))
             ND_PRINT(" bad igmp cksum %x!", GET_BE_U_2(bp + 2));
     }
+    if (ndo->ndo_mcast_groups)
+        igmp_groups(ndo, bp, len, iph);
     return;
 trunc:
     nd_print_trunc(ndo);
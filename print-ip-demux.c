@@ -30,12 +30,325 @@
 #include <string.h>
 
 #include "netdissect.h"
+#include "netdissect-profile.h"
 #include "addrtoname.h"
 #include "extract.h"
+#include "community-id.h"
 
 #include "ip.h"
 #include "ipproto.h"
 
+/*
+ * Adapters from the IP protocol dispatch signature to the printers.
+ */
+
+/*
+ * Not called for the built-in AH dissector, which ip_print_demux()
+ * handles itself so that it can go on to the next header; this is
+ * for it to have an entry in the table.
+ */
+static void
+ipproto_ah_print(netdissect_options *ndo, const u_char *bp,
+    u_int length _U_, u_int ver _U_, int fragmented _U_, u_int ttl_hl _U_,
+    const u_char *iph _U_)
+{
+	ah_print(ndo, bp);
+}
+
+static void
+ipproto_esp_print(netdissect_options *ndo, const u_char *bp,
+    u_int length, u_int ver, int fragmented, u_int ttl_hl,
+    const u_char *iph)
+{
+	esp_print(ndo, bp, length, iph, ver, fragmented, ttl_hl);
+	/*
+	 * Either this has decrypted the payload and
+	 * printed it, in which case there's nothing more
+	 * to do, or it hasn't, in which case there's
+	 * nothing more to do.
+	 */
+}
+
+static void
+ipproto_ipcomp_print(netdissect_options *ndo, const u_char *bp,
+    u_int length _U_, u_int ver _U_, int fragmented _U_, u_int ttl_hl _U_,
+    const u_char *iph _U_)
+{
+	ipcomp_print(ndo, bp);
+	/*
+	 * Either this has decompressed the payload and
+	 * printed it, in which case there's nothing more
+	 * to do, or it hasn't, in which case there's
+	 * nothing more to do.
+	 */
+}
+
+static void
+ipproto_sctp_print(netdissect_options *ndo, const u_char *bp,
+    u_int length, u_int ver _U_, int fragmented, u_int ttl_hl _U_,
+    const u_char *iph)
+{
+	sctp_print(ndo, bp, iph, length, fragmented);
+}
+
+#ifndef ND_OMIT_DCCP
+static void
+ipproto_dccp_print(netdissect_options *ndo, const u_char *bp,
+    u_int length, u_int ver _U_, int fragmented _U_, u_int ttl_hl _U_,
+    const u_char *iph)
+{
+	dccp_print(ndo, bp, iph, length);
+}
+#else
+#define ipproto_dccp_print	NULL
+#endif
+
+static void
+ipproto_tcp_print(netdissect_options *ndo, const u_char *bp,
+    u_int length, u_int ver _U_, int fragmented, u_int ttl_hl _U_,
+    const u_char *iph)
+{
+	tcp_print(ndo, bp, length, iph, fragmented);
+}
+
+static void
+ipproto_udp_print(netdissect_options *ndo, const u_char *bp,
+    u_int length, u_int ver _U_, int fragmented, u_int ttl_hl,
+    const u_char *iph)
+{
+	udp_print(ndo, bp, length, iph, fragmented, ttl_hl);
+}
+
+static void
+ipproto_icmp_print(netdissect_options *ndo, const u_char *bp,
+    u_int length, u_int ver _U_, int fragmented, u_int ttl_hl _U_,
+    const u_char *iph)
+{
+	icmp_print(ndo, bp, length, iph, fragmented);
+}
+
+static void
+ipproto_icmp6_print(netdissect_options *ndo, const u_char *bp,
+    u_int length, u_int ver _U_, int fragmented, u_int ttl_hl _U_,
+    const u_char *iph)
+{
+	icmp6_print(ndo, bp, length, iph, fragmented);
+}
+
+#ifndef ND_OMIT_IGRP
+static void
+ipproto_igrp_print(netdissect_options *ndo, const u_char *bp,
+    u_int length, u_int ver _U_, int fragmented _U_, u_int ttl_hl _U_,
+    const u_char *iph _U_)
+{
+	/*
+	 * XXX - the current IANA protocol number assignments
+	 * page lists 9 as "any private interior gateway
+	 * (used by Cisco for their IGRP)" and 88 as
+	 * "EIGRP" from Cisco.
+	 *
+	 * Recent BSD <netinet/in.h> headers define
+	 * IP_PROTO_PIGP as 9 and IP_PROTO_IGRP as 88.
+	 * We define IP_PROTO_PIGP as 9 and
+	 * IP_PROTO_EIGRP as 88; those names better
+	 * match was the current protocol number
+	 * assignments say.
+	 */
+	igrp_print(ndo, bp, length);
+}
+#else
+#define ipproto_igrp_print	NULL
+#endif
+
+static void
+ipproto_eigrp_print(netdissect_options *ndo, const u_char *bp,
+    u_int length, u_int ver _U_, int fragmented _U_, u_int ttl_hl _U_,
+    const u_char *iph _U_)
+{
+	eigrp_print(ndo, bp, length);
+}
+
+static void
+ipproto_nd_print(netdissect_options *ndo, const u_char *bp _U_,
+    u_int length, u_int ver _U_, int fragmented _U_, u_int ttl_hl _U_,
+    const u_char *iph _U_)
+{
+	ND_PRINT(" nd %u", length);
+}
+
+#ifndef ND_OMIT_EGP
+static void
+ipproto_egp_print(netdissect_options *ndo, const u_char *bp,
+    u_int length, u_int ver _U_, int fragmented _U_, u_int ttl_hl _U_,
+    const u_char *iph _U_)
+{
+	egp_print(ndo, bp, length);
+}
+#else
+#define ipproto_egp_print	NULL
+#endif
+
+static void
+ipproto_ospf_print(netdissect_options *ndo, const u_char *bp,
+    u_int length, u_int ver, int fragmented _U_, u_int ttl_hl _U_,
+    const u_char *iph)
+{
+	if (ver == 6)
+		ospf6_print(ndo, bp, length);
+	else
+		ospf_print(ndo, bp, length, iph);
+}
+
+static void
+ipproto_igmp_print(netdissect_options *ndo, const u_char *bp,
+    u_int length, u_int ver _U_, int fragmented _U_, u_int ttl_hl _U_,
+    const u_char *iph)
+{
+	igmp_print(ndo, bp, length, iph);
+}
+
+static void
+ipproto_ipip_print(netdissect_options *ndo, const u_char *bp,
+    u_int length, u_int ver _U_, int fragmented _U_, u_int ttl_hl _U_,
+    const u_char *iph _U_)
+{
+	/* ipv4-in-ip encapsulation */
+	ip_print(ndo, bp, length);
+}
+
+static void
+ipproto_ip6ip_print(netdissect_options *ndo, const u_char *bp,
+    u_int length, u_int ver _U_, int fragmented _U_, u_int ttl_hl _U_,
+    const u_char *iph _U_)
+{
+	/* ip6-in-ip encapsulation */
+	ip6_print(ndo, bp, length);
+}
+
+#ifndef ND_OMIT_RSVP
+static void
+ipproto_rsvp_print(netdissect_options *ndo, const u_char *bp,
+    u_int length, u_int ver _U_, int fragmented _U_, u_int ttl_hl _U_,
+    const u_char *iph _U_)
+{
+	rsvp_print(ndo, bp, length);
+}
+#else
+#define ipproto_rsvp_print	NULL
+#endif
+
+static void
+ipproto_gre_print(netdissect_options *ndo, const u_char *bp,
+    u_int length, u_int ver _U_, int fragmented _U_, u_int ttl_hl _U_,
+    const u_char *iph _U_)
+{
+	gre_print(ndo, bp, length);
+}
+
+static void
+ipproto_mobile_print(netdissect_options *ndo, const u_char *bp,
+    u_int length, u_int ver _U_, int fragmented _U_, u_int ttl_hl _U_,
+    const u_char *iph _U_)
+{
+	mobile_print(ndo, bp, length);
+}
+
+static void
+ipproto_pim_print(netdissect_options *ndo, const u_char *bp,
+    u_int length, u_int ver _U_, int fragmented _U_, u_int ttl_hl _U_,
+    const u_char *iph)
+{
+	pim_print(ndo, bp, length, iph);
+}
+
+static void
+ipproto_vrrp_print(netdissect_options *ndo, const u_char *bp,
+    u_int length, u_int ver _U_, int fragmented _U_, u_int ttl_hl,
+    const u_char *iph)
+{
+	if (ndo->ndo_packettype == PT_CARP) {
+		carp_print(ndo, bp, length, ttl_hl);
+	} else {
+		vrrp_print(ndo, bp, length, iph, ttl_hl);
+	}
+}
+
+static void
+ipproto_pgm_print(netdissect_options *ndo, const u_char *bp,
+    u_int length, u_int ver _U_, int fragmented _U_, u_int ttl_hl _U_,
+    const u_char *iph)
+{
+	pgm_print(ndo, bp, length, iph);
+}
+
+static void
+ipproto_none_print(netdissect_options *ndo, const u_char *bp _U_,
+    u_int length _U_, u_int ver _U_, int fragmented _U_, u_int ttl_hl _U_,
+    const u_char *iph _U_)
+{
+	ND_PRINT("no next header");
+}
+
+/*
+ * The built-in IP protocol dissectors.
+ */
+const struct ipproto_dissector ipproto_dissectors[] = {
+	{ IPPROTO_AH,		"ah",		ipproto_ah_print },
+	{ IPPROTO_ESP,		"esp",		ipproto_esp_print },
+	{ IPPROTO_IPCOMP,	"ipcomp",	ipproto_ipcomp_print },
+	{ IPPROTO_SCTP,		"sctp",		ipproto_sctp_print },
+	{ IPPROTO_DCCP,		"dccp",		ipproto_dccp_print },
+	{ IPPROTO_TCP,		"tcp",		ipproto_tcp_print },
+	{ IPPROTO_UDP,		"udp",		ipproto_udp_print },
+	{ IPPROTO_ICMP,		"icmp",		ipproto_icmp_print },
+	{ IPPROTO_ICMPV6,	"icmp6",	ipproto_icmp6_print },
+	{ IPPROTO_PIGP,		"igrp",		ipproto_igrp_print },
+	{ IPPROTO_EIGRP,	"eigrp",	ipproto_eigrp_print },
+	{ IPPROTO_ND,		"nd",		ipproto_nd_print },
+	{ IPPROTO_EGP,		"egp",		ipproto_egp_print },
+	{ IPPROTO_OSPF,		"ospf",		ipproto_ospf_print },
+	{ IPPROTO_IGMP,		"igmp",		ipproto_igmp_print },
+	{ IPPROTO_IPV4,		"ip",		ipproto_ipip_print },
+	{ IPPROTO_IPV6,		"ip6",		ipproto_ip6ip_print },
+	{ IPPROTO_RSVP,		"rsvp",		ipproto_rsvp_print },
+	{ IPPROTO_GRE,		"gre",		ipproto_gre_print },
+	{ IPPROTO_MOBILE,	"mobile",	ipproto_mobile_print },
+	{ IPPROTO_PIM,		"pim",		ipproto_pim_print },
+	{ IPPROTO_VRRP,		"vrrp",		ipproto_vrrp_print },
+	{ IPPROTO_PGM,		"pgm",		ipproto_pgm_print },
+	{ IPPROTO_NONE,		"none",		ipproto_none_print },
+	{ 0,			NULL,		NULL }
+};
+
+static const struct ipproto_dissector *ipproto_dispatch[256];
+
+/*
+ * Set the dissector for its IP protocol.
+ */
+int
+nd_register_ipproto(const struct ipproto_dissector *d)
+{
+	ipproto_dispatch[d->proto] = d->printer != NULL ? d : NULL;
+	return (0);
+}
+
+/*
+ * Returns non-zero if the dissector for "nh" prints the source and
+ * destination addresses itself, with its ports, so the IP printer
+ * shouldn't.
+ */
+int
+ip_demux_prints_addrs(uint8_t nh)
+{
+	ipproto_printer printer;
+
+	if (ipproto_dispatch[nh] == NULL)
+		return (0);
+	printer = ipproto_dispatch[nh]->printer;
+	return (printer == ipproto_tcp_print || printer == ipproto_udp_print ||
+		printer == ipproto_sctp_print || printer == ipproto_dccp_print);
+}
+
 void
 ip_print_demux(netdissect_options *ndo,
 	       const u_char *bp,
@@ -44,162 +357,39 @@ ip_print_demux(netdissect_options *ndo,
 {
 	int advance;
 	const char *p_name;
+	const struct ipproto_dissector *d;
+	const u_char *saved_iph;
 
-	advance = 0;
-
-again:
-	switch (nh) {
-
-	case IPPROTO_AH:
+	while (nh == IPPROTO_AH && ipproto_dispatch[nh] != NULL &&
+	    ipproto_dispatch[nh]->printer == ipproto_ah_print) {
 		if (!ND_TTEST_1(bp)) {
 			ndo->ndo_protocol = "ah";
 			nd_print_trunc(ndo);
-			break;
+			return;
 		}
 		nh = GET_U_1(bp);
 		advance = ah_print(ndo, bp);
 		if (advance <= 0)
-			break;
+			return;
 		bp += advance;
 		length -= advance;
-		goto again;
-
-	case IPPROTO_ESP:
-	{
-		esp_print(ndo, bp, length, iph, ver, fragmented, ttl_hl);
-		/*
-		 * Either this has decrypted the payload and
-		 * printed it, in which case there's nothing more
-		 * to do, or it hasn't, in which case there's
-		 * nothing more to do.
-		 */
-		break;
 	}
-
-	case IPPROTO_IPCOMP:
-	{
-		ipcomp_print(ndo, bp);
-		/*
-		 * Either this has decompressed the payload and
-		 * printed it, in which case there's nothing more
-		 * to do, or it hasn't, in which case there's
-		 * nothing more to do.
-		 */
-		break;
+	if (ndo->ndo_community_id)
+		community_id(ndo, ver, iph, nh, bp);
+
+	if ((d = ipproto_dispatch[nh]) != NULL) {
+		saved_iph = ndo->ndo_iph;
+		ndo->ndo_iph = iph;
+		ND_PROFILE_ENTER(d->name);
+		(*d->printer)(ndo, bp, length, ver, fragmented, ttl_hl, iph);
+		ND_PROFILE_LEAVE();
+		ndo->ndo_iph = saved_iph;
+		return;
 	}
 
-	case IPPROTO_SCTP:
-		sctp_print(ndo, bp, iph, length);
-		break;
-
-	case IPPROTO_DCCP:
-		dccp_print(ndo, bp, iph, length);
-		break;
-
-	case IPPROTO_TCP:
-		tcp_print(ndo, bp, length, iph, fragmented);
-		break;
-
-	case IPPROTO_UDP:
-		udp_print(ndo, bp, length, iph, fragmented, ttl_hl);
-		break;
-
-	case IPPROTO_ICMP:
-		icmp_print(ndo, bp, length, iph, fragmented);
-		break;
-
-	case IPPROTO_ICMPV6:
-		icmp6_print(ndo, bp, length, iph, fragmented);
-		break;
-
-	case IPPROTO_PIGP:
-		/*
-		 * XXX - the current IANA protocol number assignments
-		 * page lists 9 as "any private interior gateway
-		 * (used by Cisco for their IGRP)" and 88 as
-		 * "EIGRP" from Cisco.
-		 *
-		 * Recent BSD <netinet/in.h> headers define
-		 * IP_PROTO_PIGP as 9 and IP_PROTO_IGRP as 88.
-		 * We define IP_PROTO_PIGP as 9 and
-		 * IP_PROTO_EIGRP as 88; those names better
-		 * match was the current protocol number
-		 * assignments say.
-		 */
-		igrp_print(ndo, bp, length);
-		break;
-
-	case IPPROTO_EIGRP:
-		eigrp_print(ndo, bp, length);
-		break;
-
-	case IPPROTO_ND:
-		ND_PRINT(" nd %u", length);
-		break;
-
-	case IPPROTO_EGP:
-		egp_print(ndo, bp, length);
-		break;
-
-	case IPPROTO_OSPF:
-		if (ver == 6)
-			ospf6_print(ndo, bp, length);
-		else
-			ospf_print(ndo, bp, length, iph);
-		break;
-
-	case IPPROTO_IGMP:
-		igmp_print(ndo, bp, length);
-		break;
-
-	case IPPROTO_IPV4:
-		/* ipv4-in-ip encapsulation */
-		ip_print(ndo, bp, length);
-		break;
-
-	case IPPROTO_IPV6:
-		/* ip6-in-ip encapsulation */
-		ip6_print(ndo, bp, length);
-		break;
-
-	case IPPROTO_RSVP:
-		rsvp_print(ndo, bp, length);
-		break;
-
-	case IPPROTO_GRE:
-		gre_print(ndo, bp, length);
-		break;
-
-	case IPPROTO_MOBILE:
-		mobile_print(ndo, bp, length);
-		break;
-
-	case IPPROTO_PIM:
-		pim_print(ndo, bp, length, iph);
-		break;
-
-	case IPPROTO_VRRP:
-		if (ndo->ndo_packettype == PT_CARP) {
-			carp_print(ndo, bp, length, ttl_hl);
-		} else {
-			vrrp_print(ndo, bp, length, iph, ttl_hl);
-		}
-		break;
-
-	case IPPROTO_PGM:
-		pgm_print(ndo, bp, length, iph);
-		break;
-
-	case IPPROTO_NONE:
-		ND_PRINT("no next header");
-		break;
-
-	default:
-		if (ndo->ndo_nflag==0 && (p_name = netdb_protoname(nh)) != NULL)
-			ND_PRINT(" %s", p_name);
-		else
-			ND_PRINT(" ip-proto-%u", nh);
-		ND_PRINT(" %u", length);
-		break;
-	}
+	if (ndo->ndo_nflag==0 && (p_name = netdb_protoname(nh)) != NULL)
+		ND_PRINT(" %s", p_name);
+	else
+		ND_PRINT(" ip-proto-%u", nh);
+	ND_PRINT(" %u", length);
 }
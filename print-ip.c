@@ -30,10 +30,12 @@
 #include <string.h>
 
 #include "netdissect.h"
+#include "netdissect-fields.h"
 #include "addrtoname.h"
 #include "extract.h"
 
 #include "ip.h"
+#include "ip-reasm.h"
 #include "ipproto.h"
 
 
@@ -159,6 +161,8 @@ nextproto4_cksum(netdissect_options *ndo,
 	ph.src = GET_IPV4_TO_NETWORK_ORDER(ip->ip_src);
 	if (IP_HL(ip) == 5)
 		ph.dst = GET_IPV4_TO_NETWORK_ORDER(ip->ip_dst);
+	else if ((const u_char *)ip == ndo->ndo_ip4_hdr)
+		ph.dst = ndo->ndo_ip4_dst;	/* found by ip_print() */
 	else
 		ph.dst = ip_finddst(ndo, ip);
 
@@ -243,13 +247,16 @@ trunc:
 /*
  * print IP options.
    If truncated return -1, else 0.
+ * If there's a source route, set *dstp to its final destination, as
+ * ip_finddst() would.
  */
 static int
 ip_optprint(netdissect_options *ndo,
-            const u_char *cp, u_int length)
+            const u_char *cp, u_int length, uint32_t *dstp)
 {
 	u_int option_len;
 	const char *sep = "";
+	int found_route = 0;
 
 	for (; length > 0; cp += option_len, length -= option_len) {
 		u_int option_code;
@@ -292,9 +299,15 @@ ip_optprint(netdissect_options *ndo,
 				goto trunc;
 			break;
 
-		case IPOPT_RR:       /* fall through */
 		case IPOPT_SSRR:
 		case IPOPT_LSRR:
+			if (!found_route && option_len >= 7) {
+				*dstp = GET_IPV4_TO_NETWORK_ORDER(cp +
+				    option_len - 4);
+				found_route = 1;
+			}
+			ND_FALL_THROUGH;
+		case IPOPT_RR:
 			if (ip_printroute(ndo, cp, option_len) == -1)
 				goto trunc;
 			break;
@@ -348,6 +361,11 @@ ip_print(netdissect_options *ndo,
 	uint16_t sum, ip_sum;
 	const char *p_name;
 	int truncated = 0;
+	int reasm = IP_REASM_NONE;
+	int found_dst = 0;
+	uint32_t final_dst;
+	const u_char *saved_hdr;
+	uint32_t saved_dst;
 
 	ndo->ndo_protocol = "ip";
 	ip = (const struct ip *)bp;
@@ -373,7 +391,11 @@ ip_print(netdissect_options *ndo,
 		return;
 	}
 
-	len = GET_BE_U_2(ip->ip_len);
+	/*
+	 * ND_TCHECK_SIZE(ip) covered the 20 bytes before the options;
+	 * ip_optprint() fetches those with the GET_ macros.
+	 */
+	len = EXTRACT_BE_U_2(ip->ip_len);
 	if (length < len)
 		ND_PRINT("truncated-ip - %u bytes missing! ",
 			len - length);
@@ -400,12 +422,21 @@ ip_print(netdissect_options *ndo,
 
 	len -= hlen;
 
-	off = GET_BE_U_2(ip->ip_off);
+	off = EXTRACT_BE_U_2(ip->ip_off);
+
+        ip_proto = EXTRACT_U_1(ip->ip_p);
 
-        ip_proto = GET_U_1(ip->ip_p);
+	ND_FIELD_ADDR(NDF_IP, NDF_IP_SRC, ip->ip_src, 4);
+	ND_FIELD_ADDR(NDF_IP, NDF_IP_DST, ip->ip_dst, 4);
+	ND_FIELD_UINT(NDF_IP, NDF_IP_PROTO, ip_proto);
+	ND_FIELD_UINT(NDF_IP, NDF_IP_TTL, EXTRACT_U_1(ip->ip_ttl));
+	ND_FIELD_UINT(NDF_IP, NDF_IP_LEN, EXTRACT_BE_U_2(ip->ip_len));
+	ND_FIELD_UINT(NDF_IP, NDF_IP_ID, EXTRACT_BE_U_2(ip->ip_id));
+	ND_FIELD_UINT(NDF_IP, NDF_IP_TOS, EXTRACT_U_1(ip->ip_tos));
+	ND_FIELD_UINT(NDF_IP, NDF_IP_OFF, off);
 
         if (ndo->ndo_vflag) {
-            ip_tos = GET_U_1(ip->ip_tos);
+            ip_tos = EXTRACT_U_1(ip->ip_tos);
             ND_PRINT("(tos 0x%x", ip_tos);
             /* ECN bits */
             switch (ip_tos & 0x03) {
@@ -426,7 +457,7 @@ ip_print(netdissect_options *ndo,
                 break;
             }
 
-            ip_ttl = GET_U_1(ip->ip_ttl);
+            ip_ttl = EXTRACT_U_1(ip->ip_ttl);
             if (ip_ttl >= 1)
                 ND_PRINT(", ttl %u", ip_ttl);
 
@@ -436,21 +467,23 @@ ip_print(netdissect_options *ndo,
 	     * For unfragmented datagrams, note the don't fragment flag.
 	     */
 	    ND_PRINT(", id %u, offset %u, flags [%s], proto %s (%u)",
-                         GET_BE_U_2(ip->ip_id),
+                         EXTRACT_BE_U_2(ip->ip_id),
                          (off & IP_OFFMASK) * 8,
                          bittok2str(ip_frag_values, "none", off & (IP_RES|IP_DF|IP_MF)),
                          tok2str(ipproto_values, "unknown", ip_proto),
                          ip_proto);
 
-            ND_PRINT(", length %u", GET_BE_U_2(ip->ip_len));
+            ND_PRINT(", length %u", EXTRACT_BE_U_2(ip->ip_len));
 
             if ((hlen - sizeof(struct ip)) > 0) {
                 ND_PRINT(", options (");
+                final_dst = EXTRACT_IPV4_TO_NETWORK_ORDER(ip->ip_dst);
                 if (ip_optprint(ndo, (const u_char *)(ip + 1),
-                    hlen - sizeof(struct ip)) == -1) {
+                    hlen - sizeof(struct ip), &final_dst) == -1) {
                         ND_PRINT(" [truncated-option]");
 			truncated = 1;
-                }
+                } else
+			found_dst = 1;
                 ND_PRINT(")");
             }
 
@@ -459,7 +492,7 @@ ip_print(netdissect_options *ndo,
 	        vec[0].len = hlen;
 	        sum = in_cksum(vec, 1);
 		if (sum != 0) {
-		    ip_sum = GET_BE_U_2(ip->ip_sum);
+		    ip_sum = EXTRACT_BE_U_2(ip->ip_sum);
 		    ND_PRINT(", bad cksum %x (->%x)!", ip_sum,
 			     in_cksum_shouldbe(ip_sum, sum));
 		}
@@ -468,30 +501,54 @@ ip_print(netdissect_options *ndo,
 	    ND_PRINT(")\n    ");
 	    if (truncated) {
 		ND_PRINT("%s > %s: ",
-			 GET_IPADDR_STRING(ip->ip_src),
-			 GET_IPADDR_STRING(ip->ip_dst));
+			 ipaddr_string(ndo, ip->ip_src),
+			 ipaddr_string(ndo, ip->ip_dst));
 		nd_print_trunc(ndo);
 		nd_pop_packet_info(ndo);
 		return;
 	    }
 	}
 
+	/*
+	 * With --ip-reassembly, a fragment is held until the rest of its
+	 * datagram is there, and then the datagram is printed whole.
+	 */
+	if (ndo->ndo_ip_reasm_budget != 0 && (off & (IP_MF|IP_OFFMASK)) != 0)
+		reasm = ip_reasm_ip4_print(ndo, ip, (const u_char *)ip + hlen,
+		    len);
+	if (reasm == IP_REASM_DONE) {
+		nd_pop_packet_info(ndo);
+		return;
+	}
+
 	/*
 	 * If this is fragment zero, hand it to the next higher
 	 * level protocol.  Let them know whether there are more
 	 * fragments.
 	 */
-	if ((off & IP_OFFMASK) == 0) {
-		uint8_t nh = GET_U_1(ip->ip_p);
+	if ((off & IP_OFFMASK) == 0 && reasm != IP_REASM_HELD) {
+		uint8_t nh = EXTRACT_U_1(ip->ip_p);
 
-		if (nh != IPPROTO_TCP && nh != IPPROTO_UDP &&
-		    nh != IPPROTO_SCTP && nh != IPPROTO_DCCP) {
+		if (!ip_demux_prints_addrs(nh)) {
 			ND_PRINT("%s > %s: ",
-				     GET_IPADDR_STRING(ip->ip_src),
-				     GET_IPADDR_STRING(ip->ip_dst));
+				     ipaddr_string(ndo, ip->ip_src),
+				     ipaddr_string(ndo, ip->ip_dst));
+		}
+		/*
+		 * If the options were walked, tell nextproto4_cksum()
+		 * the final destination, so that it needn't walk them
+		 * again.
+		 */
+		saved_hdr = ndo->ndo_ip4_hdr;
+		saved_dst = ndo->ndo_ip4_dst;
+		if (found_dst) {
+			ndo->ndo_ip4_hdr = bp;
+			ndo->ndo_ip4_dst = final_dst;
 		}
 		ip_print_demux(ndo, (const u_char *)ip + hlen, len, 4,
-		    off & IP_MF, GET_U_1(ip->ip_ttl), nh, bp);
+		    off & IP_MF, EXTRACT_U_1(ip->ip_ttl), nh, bp);
+		ndo->ndo_ip4_hdr = saved_hdr;
+		ndo->ndo_ip4_dst = saved_dst;
 	} else {
 		/*
 		 * Ultra quiet now means that all this stuff should be
@@ -507,12 +564,14 @@ ip_print(netdissect_options *ndo,
 		 * next level protocol header.  print the ip addr
 		 * and the protocol.
 		 */
-		ND_PRINT("%s > %s:", GET_IPADDR_STRING(ip->ip_src),
-		          GET_IPADDR_STRING(ip->ip_dst));
+		ND_PRINT("%s > %s:", ipaddr_string(ndo, ip->ip_src),
+		          ipaddr_string(ndo, ip->ip_dst));
 		if (!ndo->ndo_nflag && (p_name = netdb_protoname(ip_proto)) != NULL)
 			ND_PRINT(" %s", p_name);
 		else
 			ND_PRINT(" ip-proto-%u", ip_proto);
+		if (reasm == IP_REASM_HELD)
+			ND_PRINT(" [reassembling]");
 	}
 	nd_pop_packet_info(ndo);
 	return;
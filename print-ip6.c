@@ -30,12 +30,67 @@
 #include <string.h>
 
 #include "netdissect.h"
+#include "netdissect-fields.h"
 #include "addrtoname.h"
 #include "extract.h"
 
 #include "ip6.h"
+#include "ip-reasm.h"
 #include "ipproto.h"
 
+/*
+ * Return the final destination that the routing header "dp" gives, or
+ * "dst" if it doesn't give one, or as much of one as was captured.
+ */
+static const u_char *
+rthdr_final_dst(netdissect_options *ndo, const struct ip6_rthdr *dp,
+		const u_char *dst)
+{
+	const struct ip6_rthdr0 *dp0;
+	const struct ip6_srh *srh;
+	const u_char *p;
+	int i, len;
+
+	if (!ND_TTEST_SIZE(dp))
+		return (dst);
+	len = GET_U_1(dp->ip6r_len);
+	switch (GET_U_1(dp->ip6r_type)) {
+
+	case IPV6_RTHDR_TYPE_0:
+	case IPV6_RTHDR_TYPE_2:		/* Mobile IPv6 ID-20 */
+		dp0 = (const struct ip6_rthdr0 *)dp;
+		if (len % 2 == 1)
+			break;
+		len >>= 1;
+		p = (const u_char *) dp0->ip6r0_addr;
+		for (i = 0; i < len; i++) {
+			if (!ND_TTEST_16(p))
+				break;
+			dst = p;
+			p += 16;
+		}
+		break;
+
+	case IPV6_RTHDR_TYPE_4:
+		/* IPv6 Segment Routing Header (SRH) */
+		srh = (const struct ip6_srh *)dp;
+		if (len % 2 == 1)
+			break;
+		p = (const u_char *) srh->srh_segments;
+		/*
+		 * The list of segments are encoded in the reverse order.
+		 * Accordingly, the final DA is encoded in srh_segments[0]
+		 */
+		if (ND_TTEST_16(p))
+			dst = p;
+		break;
+
+	default:
+		break;
+	}
+	return (dst);
+}
+
 /*
  * If routing headers are presend and valid, set dst to the final destination.
  * Otherwise, set it to the IPv6 destination.
@@ -50,17 +105,12 @@ ip6_finddst(netdissect_options *ndo, nd_ipv6 *dst,
 	const u_char *cp;
 	u_int advance;
 	u_int nh;
-	const void *dst_addr;
-	const struct ip6_rthdr *dp;
-	const struct ip6_rthdr0 *dp0;
-	const struct ip6_srh *srh;
-	const u_char *p;
-	int i, len;
+	const u_char *dst_addr;
 
 	cp = (const u_char *)ip6;
 	advance = sizeof(struct ip6_hdr);
 	nh = GET_U_1(ip6->ip6_nxt);
-	dst_addr = (const void *)ip6->ip6_dst;
+	dst_addr = ip6->ip6_dst;
 
 	while (cp < ndo->ndo_snapend) {
 		cp += advance;
@@ -97,41 +147,8 @@ ip6_finddst(netdissect_options *ndo, nd_ipv6 *dst,
 			/*
 			 * OK, we found it.
 			 */
-			dp = (const struct ip6_rthdr *)cp;
-			ND_TCHECK_SIZE(dp);
-			len = GET_U_1(dp->ip6r_len);
-			switch (GET_U_1(dp->ip6r_type)) {
-
-			case IPV6_RTHDR_TYPE_0:
-			case IPV6_RTHDR_TYPE_2:		/* Mobile IPv6 ID-20 */
-				dp0 = (const struct ip6_rthdr0 *)dp;
-				if (len % 2 == 1)
-					goto trunc;
-				len >>= 1;
-				p = (const u_char *) dp0->ip6r0_addr;
-				for (i = 0; i < len; i++) {
-					ND_TCHECK_16(p);
-					dst_addr = (const void *)p;
-					p += 16;
-				}
-				break;
-			case IPV6_RTHDR_TYPE_4:
-				/* IPv6 Segment Routing Header (SRH) */
-				srh = (const struct ip6_srh *)dp;
-				if (len % 2 == 1)
-					goto trunc;
-				p = (const u_char *) srh->srh_segments;
-				/*
-				 * The list of segments are encoded in the reverse order.
-				 * Accordingly, the final DA is encoded in srh_segments[0]
-				 */
-				ND_TCHECK_16(p);
-				dst_addr = (const void *)p;
-				break;
-
-			default:
-				break;
-			}
+			dst_addr = rthdr_final_dst(ndo,
+			    (const struct ip6_rthdr *)cp, dst_addr);
 
 			/*
 			 * Only one routing header to a customer.
@@ -190,7 +207,14 @@ nextproto6_cksum(netdissect_options *ndo,
         memset(&ph, 0, sizeof(ph));
         GET_CPY_BYTES(&ph.ph_src, ip6->ip6_src, sizeof(nd_ipv6));
         nh = GET_U_1(ip6->ip6_nxt);
-        switch (nh) {
+        if ((const u_char *)ip6 == ndo->ndo_ip6_hdr) {
+                /*
+                 * ip6_print() found the final destination while
+                 * walking the extension headers.
+                 */
+                GET_CPY_BYTES(&ph.ph_dst, ndo->ndo_ip6_dst,
+                    sizeof(nd_ipv6));
+        } else switch (nh) {
 
         case IPPROTO_HOPOPTS:
         case IPPROTO_DSTOPTS:
@@ -235,9 +259,13 @@ ip6_print(netdissect_options *ndo, const u_char *bp, u_int length)
 	uint32_t payload_len;
 	uint8_t nh;
 	int fragmented = 0;
+	int reasm;
 	u_int flow;
 	int found_extension_header;
 	int found_jumbo;
+	int found_routing;
+	const u_char *final_dst;
+	const u_char *saved_hdr, *saved_dst;
 
 	ndo->ndo_protocol = "ip6";
 	ip6 = (const struct ip6_hdr *)bp;
@@ -256,7 +284,11 @@ ip6_print(netdissect_options *ndo, const u_char *bp, u_int length)
           return;
 	}
 
-	payload_len = GET_BE_U_2(ip6->ip6_plen);
+	/*
+	 * All 40 bytes are in ND_TCHECK_SIZE(ip6); the extension headers
+	 * walked below aren't.
+	 */
+	payload_len = EXTRACT_BE_U_2(ip6->ip6_plen);
 	/*
 	 * RFC 1883 says:
 	 *
@@ -287,9 +319,18 @@ ip6_print(netdissect_options *ndo, const u_char *bp, u_int length)
 	} else
 		len = length + sizeof(struct ip6_hdr);
 
-        nh = GET_U_1(ip6->ip6_nxt);
+        nh = EXTRACT_U_1(ip6->ip6_nxt);
+
+	ND_FIELD_ADDR(NDF_IP6, NDF_IP6_SRC, ip6->ip6_src, 16);
+	ND_FIELD_ADDR(NDF_IP6, NDF_IP6_DST, ip6->ip6_dst, 16);
+	ND_FIELD_UINT(NDF_IP6, NDF_IP6_NXT, nh);
+	ND_FIELD_UINT(NDF_IP6, NDF_IP6_HLIM, EXTRACT_U_1(ip6->ip6_hlim));
+	ND_FIELD_UINT(NDF_IP6, NDF_IP6_PLEN, payload_len);
+	ND_FIELD_UINT(NDF_IP6, NDF_IP6_FLOW,
+	    EXTRACT_BE_U_4(ip6->ip6_flow) & 0x000fffff);
+
         if (ndo->ndo_vflag) {
-            flow = GET_BE_U_4(ip6->ip6_flow);
+            flow = EXTRACT_BE_U_4(ip6->ip6_flow);
             ND_PRINT("(");
 #if 0
             /* rfc1883 */
@@ -306,7 +347,7 @@ ip6_print(netdissect_options *ndo, const u_char *bp, u_int length)
 #endif
 
             ND_PRINT("hlim %u, next-header %s (%u) payload length: %u) ",
-                         GET_U_1(ip6->ip6_hlim),
+                         EXTRACT_U_1(ip6->ip6_hlim),
                          tok2str(ipproto_values,"unknown",nh),
                          nh,
                          payload_len);
@@ -323,6 +364,8 @@ ip6_print(netdissect_options *ndo, const u_char *bp, u_int length)
 	/* Process extension headers */
 	found_extension_header = 0;
 	found_jumbo = 0;
+	found_routing = 0;
+	final_dst = ip6->ip6_dst;
 	while (cp < ndo->ndo_snapend && advance > 0) {
 		if (len < (u_int)advance)
 			goto trunc;
@@ -331,10 +374,9 @@ ip6_print(netdissect_options *ndo, const u_char *bp, u_int length)
 		total_advance += advance;
 
 		if (cp == (const u_char *)(ip6 + 1) &&
-		    nh != IPPROTO_TCP && nh != IPPROTO_UDP &&
-		    nh != IPPROTO_DCCP && nh != IPPROTO_SCTP) {
-			ND_PRINT("%s > %s: ", GET_IP6ADDR_STRING(ip6->ip6_src),
-				     GET_IP6ADDR_STRING(ip6->ip6_dst));
+		    !ip_demux_prints_addrs(nh)) {
+			ND_PRINT("%s > %s: ", ip6addr_string(ndo, ip6->ip6_src),
+				     ip6addr_string(ndo, ip6->ip6_dst));
 		}
 
 		switch (nh) {
@@ -361,6 +403,23 @@ ip6_print(netdissect_options *ndo, const u_char *bp, u_int length)
 
 		case IPPROTO_FRAGMENT:
 			advance = frag6_print(ndo, cp, (const u_char *)ip6);
+			if (ndo->ndo_ip_reasm_budget != 0 &&
+			    ND_TTEST_LEN(cp, sizeof(struct ip6_frag)) &&
+			    len >= sizeof(struct ip6_frag)) {
+				/*
+				 * Hold the fragment until the datagram is
+				 * all there, then print that whole.
+				 */
+				reasm = ip_reasm_ip6_print(ndo, ip6, cp,
+				    len - sizeof(struct ip6_frag));
+				if (reasm == IP_REASM_HELD)
+					ND_PRINT("%s[reassembling]",
+					    advance < 0 ? " " : "");
+				if (reasm != IP_REASM_NONE) {
+					nd_pop_packet_info(ndo);
+					return;
+				}
+			}
 			if (advance < 0 || ndo->ndo_snapend <= cp + advance) {
 				nd_pop_packet_info(ndo);
 				return;
@@ -392,6 +451,15 @@ ip6_print(netdissect_options *ndo, const u_char *bp, u_int length)
 
 		case IPPROTO_ROUTING:
 			ND_TCHECK_1(cp);
+			/*
+			 * As with ip6_finddst(), only the first routing
+			 * header says where the datagram is going.
+			 */
+			if (!found_routing) {
+				final_dst = rthdr_final_dst(ndo,
+				    (const struct ip6_rthdr *)cp, final_dst);
+				found_routing = 1;
+			}
 			advance = rt6_print(ndo, cp, (const u_char *)ip6);
 			if (advance < 0) {
 				nd_pop_packet_info(ndo);
@@ -468,8 +536,18 @@ ip6_print(netdissect_options *ndo, const u_char *bp, u_int length)
 					len -= total_advance;
 				}
 			}
+			/*
+			 * Tell nextproto6_cksum() the final destination,
+			 * so that it needn't walk the headers again.
+			 */
+			saved_hdr = ndo->ndo_ip6_hdr;
+			saved_dst = ndo->ndo_ip6_dst;
+			ndo->ndo_ip6_hdr = bp;
+			ndo->ndo_ip6_dst = final_dst;
 			ip_print_demux(ndo, cp, len, 6, fragmented,
 			    GET_U_1(ip6->ip6_hlim), nh, bp);
+			ndo->ndo_ip6_hdr = saved_hdr;
+			ndo->ndo_ip6_dst = saved_dst;
 			nd_pop_packet_info(ndo);
 			return;
 		}
@@ -45,6 +45,7 @@
 
 #include "netdissect-stdinc.h"
 
+#include <stddef.h>
 #include <string.h>
 
 #include "netdissect-ctype.h"
@@ -53,6 +54,7 @@
 #include "addrtoname.h"
 #include "extract.h"
 
+#include "callcache.h"
 #include "ip.h"
 #include "ip6.h"
 #include "ipproto.h"
@@ -634,18 +636,24 @@ ikev1_print(netdissect_options *ndo,
 	    const u_char *bp,  u_int length,
 	    const u_char *bp2, const struct isakmp *base);
 
-#define MAXINITIATORS	20
-static int ninitiator = 0;
 union inaddr_u {
 	nd_ipv4 in4;
 	nd_ipv6 in6;
 };
-static struct {
+/* Initiators seen, by cookie; see callcache.h */
+struct cookie_entry {
+	struct callcache_entry ce;
 	cookie_t initiator;
 	u_int version;
 	union inaddr_u iaddr;
 	union inaddr_u raddr;
-} cookiecache[MAXINITIATORS];
+};
+static const struct callcache_type cookie_type = {
+	sizeof(struct cookie_entry),
+	offsetof(struct cookie_entry, initiator),
+	sizeof(cookie_t),
+	0
+};
 
 /* protocol id */
 static const char *protoidstr[] = {
@@ -753,61 +761,55 @@ iszero(const u_char *p, size_t l)
 }
 
 /* find cookie from initiator cache */
-static int
-cookie_find(const cookie_t *in)
+static const struct cookie_entry *
+cookie_find(netdissect_options *ndo, const cookie_t *in)
 {
-	int i;
-
-	for (i = 0; i < MAXINITIATORS; i++) {
-		if (memcmp(in, &cookiecache[i].initiator, sizeof(*in)) == 0)
-			return i;
-	}
-
-	return -1;
+	return (const struct cookie_entry *)callcache_find(ndo, &cookie_type,
+	    in);
 }
 
 /* record initiator */
 static void
 cookie_record(netdissect_options *ndo, const cookie_t *in, const u_char *bp2)
 {
-	int i;
+	struct cookie_entry *ce;
 	const struct ip *ip;
 	const struct ip6_hdr *ip6;
 
-	i = cookie_find(in);
-	if (0 <= i) {
-		ninitiator = (i + 1) % MAXINITIATORS;
+	if (cookie_find(ndo, in) != NULL)
 		return;
-	}
 
 	ip = (const struct ip *)bp2;
 	switch (IP_V(ip)) {
 	case 4:
-		cookiecache[ninitiator].version = 4;
-		UNALIGNED_MEMCPY(&cookiecache[ninitiator].iaddr.in4,
-				 ip->ip_src, sizeof(nd_ipv4));
-		UNALIGNED_MEMCPY(&cookiecache[ninitiator].raddr.in4,
-				 ip->ip_dst, sizeof(nd_ipv4));
+		ce = (struct cookie_entry *)callcache_enter(ndo, &cookie_type,
+		    in);
+		if (ce == NULL)
+			return;
+		ce->version = 4;
+		UNALIGNED_MEMCPY(&ce->iaddr.in4, ip->ip_src, sizeof(nd_ipv4));
+		UNALIGNED_MEMCPY(&ce->raddr.in4, ip->ip_dst, sizeof(nd_ipv4));
 		break;
 	case 6:
 		ip6 = (const struct ip6_hdr *)bp2;
-		cookiecache[ninitiator].version = 6;
-		UNALIGNED_MEMCPY(&cookiecache[ninitiator].iaddr.in6,
-				 ip6->ip6_src, sizeof(nd_ipv6));
-		UNALIGNED_MEMCPY(&cookiecache[ninitiator].raddr.in6,
-				 ip6->ip6_dst, sizeof(nd_ipv6));
+		ce = (struct cookie_entry *)callcache_enter(ndo, &cookie_type,
+		    in);
+		if (ce == NULL)
+			return;
+		ce->version = 6;
+		UNALIGNED_MEMCPY(&ce->iaddr.in6, ip6->ip6_src, sizeof(nd_ipv6));
+		UNALIGNED_MEMCPY(&ce->raddr.in6, ip6->ip6_dst, sizeof(nd_ipv6));
 		break;
 	default:
 		return;
 	}
-	UNALIGNED_MEMCPY(&cookiecache[ninitiator].initiator, in, sizeof(*in));
-	ninitiator = (ninitiator + 1) % MAXINITIATORS;
 }
 
 #define cookie_isinitiator(ndo, x, y)	cookie_sidecheck(ndo, (x), (y), 1)
 #define cookie_isresponder(ndo, x, y)	cookie_sidecheck(ndo, (x), (y), 0)
 static int
-cookie_sidecheck(netdissect_options *ndo, int i, const u_char *bp2, int initiator)
+cookie_sidecheck(netdissect_options *ndo, const struct cookie_entry *ce,
+		 const u_char *bp2, int initiator)
 {
 	const struct ip *ip;
 	const struct ip6_hdr *ip6;
@@ -815,25 +817,25 @@ cookie_sidecheck(netdissect_options *ndo, int i, const u_char *bp2, int initiato
 	ip = (const struct ip *)bp2;
 	switch (IP_V(ip)) {
 	case 4:
-		if (cookiecache[i].version != 4)
+		if (ce->version != 4)
 			return 0;
 		if (initiator) {
-			if (UNALIGNED_MEMCMP(ip->ip_src, &cookiecache[i].iaddr.in4, sizeof(nd_ipv4)) == 0)
+			if (UNALIGNED_MEMCMP(ip->ip_src, &ce->iaddr.in4, sizeof(nd_ipv4)) == 0)
 				return 1;
 		} else {
-			if (UNALIGNED_MEMCMP(ip->ip_src, &cookiecache[i].raddr.in4, sizeof(nd_ipv4)) == 0)
+			if (UNALIGNED_MEMCMP(ip->ip_src, &ce->raddr.in4, sizeof(nd_ipv4)) == 0)
 				return 1;
 		}
 		break;
 	case 6:
-		if (cookiecache[i].version != 6)
+		if (ce->version != 6)
 			return 0;
 		ip6 = (const struct ip6_hdr *)bp2;
 		if (initiator) {
-			if (UNALIGNED_MEMCMP(ip6->ip6_src, &cookiecache[i].iaddr.in6, sizeof(nd_ipv6)) == 0)
+			if (UNALIGNED_MEMCMP(ip6->ip6_src, &ce->iaddr.in6, sizeof(nd_ipv6)) == 0)
 				return 1;
 		} else {
-			if (UNALIGNED_MEMCMP(ip6->ip6_src, &cookiecache[i].raddr.in6, sizeof(nd_ipv6)) == 0)
+			if (UNALIGNED_MEMCMP(ip6->ip6_src, &ce->raddr.in6, sizeof(nd_ipv6)) == 0)
 				return 1;
 		}
 		break;
@@ -2821,7 +2823,7 @@ trunc:
 static char *
 numstr(u_int x)
 {
-	static char buf[20];
+	static ND_THREAD_LOCAL char buf[20];
 	snprintf(buf, sizeof(buf), "#%u", x);
 	return buf;
 }
@@ -2835,7 +2837,7 @@ ikev1_print(netdissect_options *ndo,
 	const u_char *ep;
 	u_int flags;
 	u_char np;
-	int i;
+	const struct cookie_entry *ce;
 	u_int phase;
 
 	p = (const struct isakmp *)bp;
@@ -2847,9 +2849,11 @@ ikev1_print(netdissect_options *ndo,
 	else
 		ND_PRINT(" phase %u/others", phase);
 
-	i = cookie_find(&base->i_ck);
-	if (i < 0) {
-		if (iszero((const u_char *)&base->r_ck, sizeof(base->r_ck))) {
+	ce = cookie_find(ndo, &base->i_ck);
+	if (ce == NULL) {
+		/* An initiator cookie of zero isn't a valid one. */
+		if (iszero((const u_char *)&base->r_ck, sizeof(base->r_ck)) &&
+		    !iszero((const u_char *)&base->i_ck, sizeof(base->i_ck))) {
 			/* the first packet */
 			ND_PRINT(" I");
 			if (bp2)
@@ -2857,9 +2861,9 @@ ikev1_print(netdissect_options *ndo,
 		} else
 			ND_PRINT(" ?");
 	} else {
-		if (bp2 && cookie_isinitiator(ndo, i, bp2))
+		if (bp2 && cookie_isinitiator(ndo, ce, bp2))
 			ND_PRINT(" I");
-		else if (bp2 && cookie_isresponder(ndo, i, bp2))
+		else if (bp2 && cookie_isresponder(ndo, ce, bp2))
 			ND_PRINT(" R");
 		else
 			ND_PRINT(" ?");
@@ -49,6 +49,7 @@
 #include "gmpls.h"
 #include "oui.h"
 #include "signature.h"
+#include "lsdb.h"
 
 
 /*
@@ -1712,7 +1713,7 @@ static char *
 isis_print_id(netdissect_options *ndo, const uint8_t *cp, u_int id_len)
 {
     u_int i;
-    static char id[sizeof("xxxx.xxxx.xxxx.yy-zz")];
+    static ND_THREAD_LOCAL char id[sizeof("xxxx.xxxx.xxxx.yy-zz")];
     char *pos = id;
     u_int sysid_len;
 
@@ -2280,6 +2281,77 @@ isis_clear_checksum_lifetime(void *header)
     header_lsp->remaining_lifetime[1] = 0;
 }
 
+/*
+ * Look up the LSP with the header "header_lsp", of type "pdu_type", and
+ * the "len" bytes of TLVs at "pptr", in the LSDB, and print what it is to
+ * the last copy of it.  Return the verdict, or -1 if the TLVs weren't all
+ * captured or don't add up, so that the LSP can't be compared.
+ */
+static int
+isis_lsdb_update(netdissect_options *ndo, uint8_t pdu_type,
+                 const struct isis_lsp_header *header_lsp,
+                 const uint8_t *pptr, u_int len)
+{
+    u_char key[LSDB_KEY_LEN];
+    uint32_t seq, lastseq;
+    uint8_t tlv_type, tlv_len;
+    u_int i, n, changed;
+    const struct lsdb_part *lp;
+    int verdict;
+
+    lsdb_begin();
+    while (len >= 2) {
+        if (!ND_TTEST_2(pptr))
+            return (-1);
+        tlv_type = GET_U_1(pptr);
+        tlv_len = GET_U_1(pptr + 1);
+        if (len - 2 < tlv_len)
+            return (-1);
+        /*
+         * The authentication and checksum TLVs change with every copy,
+         * so only their being there counts.
+         */
+        if (!lsdb_add_part(ndo, tlv_type, pptr + 2,
+                           (tlv_type == ISIS_TLV_AUTH ||
+                            tlv_type == ISIS_TLV_CHECKSUM) ? 0 : tlv_len))
+            return (-1);
+        pptr += 2 + tlv_len;
+        len -= 2 + tlv_len;
+    }
+
+    key[0] = pdu_type;
+    GET_CPY_BYTES(key + 1, header_lsp->lsp_id, LSP_ID_LEN);
+    seq = GET_BE_U_4(header_lsp->sequence_number);
+    verdict = lsdb_update(ndo, LSDB_ISIS, key, seq, &lastseq);
+    switch (verdict) {
+    case LSDB_NEW:
+        ND_PRINT("\n\t  LSDB: new");
+        break;
+    case LSDB_REPEAT:
+        ND_PRINT("\n\t  LSDB: repeat");
+        break;
+    case LSDB_OLDER:
+        ND_PRINT("\n\t  LSDB: older than seq 0x%08x", lastseq);
+        break;
+    case LSDB_REFRESH:
+        ND_PRINT("\n\t  LSDB: refresh of seq 0x%08x", lastseq);
+        break;
+    case LSDB_CHANGE:
+        lp = lsdb_parts(&n);
+        for (i = changed = 0; i < n; i++)
+            changed += lp[i].lp_changed;
+        lp = lsdb_removed(&n);
+        ND_PRINT("\n\t  LSDB: change from seq 0x%08x, %u TLVs added, %u removed",
+                 lastseq, changed, n);
+        for (i = 0; i < n; i++)
+            ND_PRINT("\n\t    removed %s TLV #%u, length: %u",
+                     tok2str(isis_tlv_values, "unknown", lp[i].lp_type),
+                     lp[i].lp_type, lp[i].lp_len);
+        break;
+    }
+    return (verdict);
+}
+
 /*
  * isis_print
  * Decode IS-IS packets.  Return 0 on error.
@@ -2322,6 +2394,9 @@ isis_print(netdissect_options *ndo,
     uint8_t auth_type;
     uint8_t num_system_ids;
     int sigcheck;
+    int lsdb_verdict;
+    u_int lsdb_part = 0, lsdb_nparts = 0;
+    const struct lsdb_part *lsdb_tlv = NULL;
 
     ndo->ndo_protocol = "isis";
     packet_len=length;
@@ -2589,6 +2664,21 @@ isis_print(netdissect_options *ndo,
 
         INVALID_OR_DECREMENT(packet_len,ISIS_COMMON_HEADER_SIZE+ISIS_LSP_HEADER_SIZE);
         pptr = p + (ISIS_COMMON_HEADER_SIZE+ISIS_LSP_HEADER_SIZE);
+
+        /*
+         * With --lsdb, print only the TLVs a change of the LSP added,
+         * and nothing more of a copy that changes nothing.
+         */
+        if (ndo->ndo_lsdb) {
+            lsdb_verdict = isis_lsdb_update(ndo, pdu_type, header_lsp,
+                                            pptr, packet_len);
+            if (lsdb_verdict == LSDB_REPEAT ||
+                lsdb_verdict == LSDB_OLDER ||
+                lsdb_verdict == LSDB_REFRESH)
+                return (1);
+            if (lsdb_verdict == LSDB_CHANGE)
+                lsdb_tlv = lsdb_parts(&lsdb_nparts);
+        }
         break;
 
     case ISIS_PDU_L1_CSNP:
@@ -2687,6 +2777,12 @@ isis_print(netdissect_options *ndo,
         tlen = tlv_len; /* copy temporary len & pointer to packet data */
         tptr = pptr;
 
+        if (lsdb_part < lsdb_nparts && !lsdb_tlv[lsdb_part++].lp_changed) {
+            pptr += tlv_len;
+            packet_len -= tlv_len;
+            continue;
+        }
+
         /* first lets see if we know the TLVs name*/
 	ND_PRINT("\n\t    %s TLV #%u, length: %u",
                tok2str(isis_tlv_values,
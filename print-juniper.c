@@ -420,6 +420,19 @@ static const struct juniper_cookie_table_t juniper_cookie_table[] = {
     { 0, 0, NULL }
 };
 
+/*
+ * What the extension TLVs said about the interface; the values are only
+ * valid if their JUNIPER_EXT_TLV_ bit is set in "present".
+ */
+struct juniper_ext_info_t {
+    uint16_t present;		/* 1 << JUNIPER_EXT_TLV_xxx */
+    uint32_t ifd_idx;
+    uint32_t ifd_mediatype;
+    uint32_t ifl_idx;
+    uint32_t ifl_unit;
+    uint32_t ifl_encaps;
+};
+
 struct juniper_l2info_t {
     uint32_t length;
     uint32_t caplen;
@@ -432,6 +445,7 @@ struct juniper_l2info_t {
     u_int bundle;
     uint16_t proto;
     uint8_t flags;
+    struct juniper_ext_info_t ext;
 };
 
 #define LS_COOKIE_ID            0x54
@@ -1216,23 +1230,128 @@ juniper_read_tlv_value(netdissect_options *ndo,
    return tlv_value;
 }
 
+/*
+ * Find the cookie table entry for a PIC type.  A capture only has the
+ * one, so the last one found is remembered rather than looked for
+ * again for every packet.
+ */
+static const struct juniper_cookie_table_t *
+juniper_cookie_lookup(uint32_t pictype)
+{
+    static ND_THREAD_LOCAL const struct juniper_cookie_table_t *last;
+    static ND_THREAD_LOCAL uint32_t last_pictype;
+    static ND_THREAD_LOCAL int last_valid;
+    const struct juniper_cookie_table_t *lp;
+
+    if (last_valid && last_pictype == pictype)
+        return last;
+    for (lp = juniper_cookie_table; lp->s != NULL; lp++)
+        if (lp->pictype == pictype)
+            break;
+    last = lp->s != NULL ? lp : NULL;
+    last_pictype = pictype;
+    last_valid = 1;
+    return last;
+}
+
+/*
+ * Walk the "len" bytes of extension TLVs at "tptr", filling in "ext"
+ * and printing them with -vv.  Returns 0 if a TLV runs past the end.
+ */
+static int
+juniper_parse_ext(netdissect_options *ndo, const u_char *tptr, u_int len,
+                  struct juniper_ext_info_t *ext)
+{
+    uint8_t tlv_type,tlv_len;
+    int tlv_value;
+
+    while (len > JUNIPER_EXT_TLV_OVERHEAD) {
+        tlv_type = GET_U_1(tptr);
+        tptr++;
+        tlv_len = GET_U_1(tptr);
+        tptr++;
+
+        /* sanity checks */
+        if (tlv_type == 0 || tlv_len == 0)
+            break;
+        if (tlv_len+JUNIPER_EXT_TLV_OVERHEAD > len)
+            return 0;
+
+        if (ndo->ndo_vflag > 1)
+            ND_PRINT("\n\t  %s Extension TLV #%u, length %u, value ",
+                   tok2str(jnx_ext_tlv_values,"Unknown",tlv_type),
+                   tlv_type,
+                   tlv_len);
+
+        tlv_value = juniper_read_tlv_value(ndo, tptr, tlv_type, tlv_len);
+        switch (tlv_type) {
+        case JUNIPER_EXT_TLV_IFD_NAME:
+            /* FIXME */
+            break;
+        case JUNIPER_EXT_TLV_IFD_MEDIATYPE:
+        case JUNIPER_EXT_TLV_TTP_IFD_MEDIATYPE:
+            if (tlv_value != -1) {
+                ext->ifd_mediatype = tlv_value;
+                ext->present |= 1U << JUNIPER_EXT_TLV_IFD_MEDIATYPE;
+                if (ndo->ndo_vflag > 1)
+                    ND_PRINT("%s (%u)",
+                           tok2str(juniper_ifmt_values, "Unknown", tlv_value),
+                           tlv_value);
+            }
+            break;
+        case JUNIPER_EXT_TLV_IFL_ENCAPS:
+        case JUNIPER_EXT_TLV_TTP_IFL_ENCAPS:
+            if (tlv_value != -1) {
+                ext->ifl_encaps = tlv_value;
+                ext->present |= 1U << JUNIPER_EXT_TLV_IFL_ENCAPS;
+                if (ndo->ndo_vflag > 1)
+                    ND_PRINT("%s (%u)",
+                           tok2str(juniper_ifle_values, "Unknown", tlv_value),
+                           tlv_value);
+            }
+            break;
+        case JUNIPER_EXT_TLV_IFL_IDX: /* fall through */
+        case JUNIPER_EXT_TLV_IFL_UNIT:
+        case JUNIPER_EXT_TLV_IFD_IDX:
+        default:
+            if (tlv_value != -1) {
+                if (tlv_type == JUNIPER_EXT_TLV_IFL_IDX)
+                    ext->ifl_idx = tlv_value;
+                else if (tlv_type == JUNIPER_EXT_TLV_IFL_UNIT)
+                    ext->ifl_unit = tlv_value;
+                else if (tlv_type == JUNIPER_EXT_TLV_IFD_IDX)
+                    ext->ifd_idx = tlv_value;
+                if (tlv_type < 16)
+                    ext->present |= 1U << tlv_type;
+                if (ndo->ndo_vflag > 1)
+                    ND_PRINT("%u", tlv_value);
+            }
+            break;
+        }
+
+        tptr+=tlv_len;
+        len -= tlv_len+JUNIPER_EXT_TLV_OVERHEAD;
+    }
+    return 1;
+}
+
 static int
 juniper_parse_header(netdissect_options *ndo,
                      const u_char *p, const struct pcap_pkthdr *h, struct juniper_l2info_t *l2info)
 {
-    const struct juniper_cookie_table_t *lp = juniper_cookie_table;
+    const struct juniper_cookie_table_t *lp;
     u_int idx, jnx_ext_len, jnx_header_len = 0;
-    uint8_t tlv_type,tlv_len;
 #ifdef DLT_JUNIPER_ATM2
     uint32_t control_word;
 #endif
-    int tlv_value;
     const u_char *tptr;
 
 
     l2info->header_len = 0;
     l2info->cookie_len = 0;
+    l2info->cookie_type = 0;
     l2info->proto = 0;
+    l2info->ext.present = 0;
 
 
     l2info->length = h->len;
@@ -1276,62 +1395,8 @@ juniper_parse_header(netdissect_options *ndo,
             ND_PRINT(", PCAP Extension(s) total length %u", jnx_ext_len);
 
         ND_TCHECK_LEN(tptr, jnx_ext_len);
-        while (jnx_ext_len > JUNIPER_EXT_TLV_OVERHEAD) {
-            tlv_type = GET_U_1(tptr);
-            tptr++;
-            tlv_len = GET_U_1(tptr);
-            tptr++;
-            tlv_value = 0;
-
-            /* sanity checks */
-            if (tlv_type == 0 || tlv_len == 0)
-                break;
-            if (tlv_len+JUNIPER_EXT_TLV_OVERHEAD > jnx_ext_len)
-                goto trunc;
-
-            if (ndo->ndo_vflag > 1)
-                ND_PRINT("\n\t  %s Extension TLV #%u, length %u, value ",
-                       tok2str(jnx_ext_tlv_values,"Unknown",tlv_type),
-                       tlv_type,
-                       tlv_len);
-
-            tlv_value = juniper_read_tlv_value(ndo, tptr, tlv_type, tlv_len);
-            switch (tlv_type) {
-            case JUNIPER_EXT_TLV_IFD_NAME:
-                /* FIXME */
-                break;
-            case JUNIPER_EXT_TLV_IFD_MEDIATYPE:
-            case JUNIPER_EXT_TLV_TTP_IFD_MEDIATYPE:
-                if (tlv_value != -1) {
-                    if (ndo->ndo_vflag > 1)
-                        ND_PRINT("%s (%u)",
-                               tok2str(juniper_ifmt_values, "Unknown", tlv_value),
-                               tlv_value);
-                }
-                break;
-            case JUNIPER_EXT_TLV_IFL_ENCAPS:
-            case JUNIPER_EXT_TLV_TTP_IFL_ENCAPS:
-                if (tlv_value != -1) {
-                    if (ndo->ndo_vflag > 1)
-                        ND_PRINT("%s (%u)",
-                               tok2str(juniper_ifle_values, "Unknown", tlv_value),
-                               tlv_value);
-                }
-                break;
-            case JUNIPER_EXT_TLV_IFL_IDX: /* fall through */
-            case JUNIPER_EXT_TLV_IFL_UNIT:
-            case JUNIPER_EXT_TLV_IFD_IDX:
-            default:
-                if (tlv_value != -1) {
-                    if (ndo->ndo_vflag > 1)
-                        ND_PRINT("%u", tlv_value);
-                }
-                break;
-            }
-
-            tptr+=tlv_len;
-            jnx_ext_len -= tlv_len+JUNIPER_EXT_TLV_OVERHEAD;
-        }
+        if (!juniper_parse_ext(ndo, tptr, jnx_ext_len, &l2info->ext))
+            goto trunc;
 
         if (ndo->ndo_vflag > 1)
             ND_PRINT("\n\t-----original packet-----\n\t");
@@ -1361,67 +1426,63 @@ juniper_parse_header(netdissect_options *ndo,
 
     /* search through the cookie table and copy values matching for our PIC type */
     ND_TCHECK_1(p);
-    while (lp->s != NULL) {
-        if (lp->pictype == l2info->pictype) {
-
-            l2info->cookie_len += lp->cookie_len;
+    lp = juniper_cookie_lookup(l2info->pictype);
+    if (lp != NULL) {
+        l2info->cookie_len += lp->cookie_len;
 
-            switch (GET_U_1(p)) {
-            case LS_COOKIE_ID:
-                l2info->cookie_type = LS_COOKIE_ID;
-                l2info->cookie_len += 2;
-                break;
-            case AS_COOKIE_ID:
-                l2info->cookie_type = AS_COOKIE_ID;
-                l2info->cookie_len = 8;
-                break;
+        switch (GET_U_1(p)) {
+        case LS_COOKIE_ID:
+            l2info->cookie_type = LS_COOKIE_ID;
+            l2info->cookie_len += 2;
+            break;
+        case AS_COOKIE_ID:
+            l2info->cookie_type = AS_COOKIE_ID;
+            l2info->cookie_len = 8;
+            break;
 
-            default:
-                l2info->bundle = l2info->cookie[0];
-                break;
-            }
+        default:
+            l2info->bundle = l2info->cookie[0];
+            break;
+        }
 
 
 #ifdef DLT_JUNIPER_MFR
-            /* MFR child links don't carry cookies */
-            if (l2info->pictype == DLT_JUNIPER_MFR &&
-                (GET_U_1(p) & MFR_BE_MASK) == MFR_BE_MASK) {
-                l2info->cookie_len = 0;
-            }
+        /* MFR child links don't carry cookies */
+        if (l2info->pictype == DLT_JUNIPER_MFR &&
+            (GET_U_1(p) & MFR_BE_MASK) == MFR_BE_MASK) {
+            l2info->cookie_len = 0;
+        }
 #endif
 
-            l2info->header_len += l2info->cookie_len;
-            l2info->length -= l2info->cookie_len;
-            l2info->caplen -= l2info->cookie_len;
+        l2info->header_len += l2info->cookie_len;
+        l2info->length -= l2info->cookie_len;
+        l2info->caplen -= l2info->cookie_len;
 
-            if (ndo->ndo_eflag)
-                ND_PRINT("%s-PIC, cookie-len %u",
-                       lp->s,
-                       l2info->cookie_len);
+        if (ndo->ndo_eflag)
+            ND_PRINT("%s-PIC, cookie-len %u",
+                   lp->s,
+                   l2info->cookie_len);
 
-            if (l2info->cookie_len > 8) {
-                nd_print_invalid(ndo);
-                return 0;
-            }
+        if (l2info->cookie_len > 8) {
+            nd_print_invalid(ndo);
+            return 0;
+        }
 
-            if (l2info->cookie_len > 0) {
-                ND_TCHECK_LEN(p, l2info->cookie_len);
-                if (ndo->ndo_eflag)
-                    ND_PRINT(", cookie 0x");
-                for (idx = 0; idx < l2info->cookie_len; idx++) {
-                    l2info->cookie[idx] = GET_U_1(p + idx); /* copy cookie data */
-                    if (ndo->ndo_eflag) ND_PRINT("%02x", GET_U_1(p + idx));
-                }
+        if (l2info->cookie_len > 0) {
+            ND_TCHECK_LEN(p, l2info->cookie_len);
+            if (ndo->ndo_eflag)
+                ND_PRINT(", cookie 0x");
+            for (idx = 0; idx < l2info->cookie_len; idx++) {
+                l2info->cookie[idx] = GET_U_1(p + idx); /* copy cookie data */
+                if (ndo->ndo_eflag) ND_PRINT("%02x", GET_U_1(p + idx));
             }
+        }
 
-            if (ndo->ndo_eflag) ND_PRINT(": "); /* print demarc b/w L2/L3*/
+        if (ndo->ndo_eflag) ND_PRINT(": "); /* print demarc b/w L2/L3*/
 
 
-            ND_TCHECK_2(p + l2info->cookie_len);
-            l2info->proto = GET_BE_U_2(p + l2info->cookie_len);
-            break;
-        }
-        ++lp;
+        ND_TCHECK_2(p + l2info->cookie_len);
+        l2info->proto = GET_BE_U_2(p + l2info->cookie_len);
     }
     p+=l2info->cookie_len;
 
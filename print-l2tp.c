@@ -32,7 +32,10 @@
 #include "netdissect-stdinc.h"
 
 #include "netdissect.h"
+#include "netdissect-fields.h"
+#include "netdissect-tlv.h"
 #include "extract.h"
+#include "ppp-session.h"
 
 #define L2TP_FLAG_TYPE		0x8000	/* Type (0=Data, 1=Control) */
 #define L2TP_FLAG_LENGTH	0x4000	/* Length */
@@ -146,51 +149,6 @@ static const struct tok l2tp_msgtype2str[] = {
 #define L2TP_AVP_SEQ_REQUIRED 		39 /* Sequencing Required */
 #define L2TP_AVP_PPP_DISCON_CC		46 /* PPP Disconnect Cause Code - RFC 3145 */
 
-static const struct tok l2tp_avp2str[] = {
-	{ L2TP_AVP_MSGTYPE,		"MSGTYPE" },
-	{ L2TP_AVP_RESULT_CODE,		"RESULT_CODE" },
-	{ L2TP_AVP_PROTO_VER,		"PROTO_VER" },
-	{ L2TP_AVP_FRAMING_CAP,		"FRAMING_CAP" },
-	{ L2TP_AVP_BEARER_CAP,		"BEARER_CAP" },
-	{ L2TP_AVP_TIE_BREAKER,		"TIE_BREAKER" },
-	{ L2TP_AVP_FIRM_VER,		"FIRM_VER" },
-	{ L2TP_AVP_HOST_NAME,		"HOST_NAME" },
-	{ L2TP_AVP_VENDOR_NAME,		"VENDOR_NAME" },
-	{ L2TP_AVP_ASSND_TUN_ID,	"ASSND_TUN_ID" },
-	{ L2TP_AVP_RECV_WIN_SIZE,	"RECV_WIN_SIZE" },
-	{ L2TP_AVP_CHALLENGE,		"CHALLENGE" },
-	{ L2TP_AVP_Q931_CC,		"Q931_CC", },
-	{ L2TP_AVP_CHALLENGE_RESP,	"CHALLENGE_RESP" },
-	{ L2TP_AVP_ASSND_SESS_ID,	"ASSND_SESS_ID" },
-	{ L2TP_AVP_CALL_SER_NUM,	"CALL_SER_NUM" },
-	{ L2TP_AVP_MINIMUM_BPS,		"MINIMUM_BPS" },
-	{ L2TP_AVP_MAXIMUM_BPS,		"MAXIMUM_BPS" },
-	{ L2TP_AVP_BEARER_TYPE,		"BEARER_TYPE" },
-	{ L2TP_AVP_FRAMING_TYPE,	"FRAMING_TYPE" },
-	{ L2TP_AVP_PACKET_PROC_DELAY,	"PACKET_PROC_DELAY" },
-	{ L2TP_AVP_CALLED_NUMBER,	"CALLED_NUMBER" },
-	{ L2TP_AVP_CALLING_NUMBER,	"CALLING_NUMBER" },
-	{ L2TP_AVP_SUB_ADDRESS,		"SUB_ADDRESS" },
-	{ L2TP_AVP_TX_CONN_SPEED,	"TX_CONN_SPEED" },
-	{ L2TP_AVP_PHY_CHANNEL_ID,	"PHY_CHANNEL_ID" },
-	{ L2TP_AVP_INI_RECV_LCP,	"INI_RECV_LCP" },
-	{ L2TP_AVP_LAST_SENT_LCP,	"LAST_SENT_LCP" },
-	{ L2TP_AVP_LAST_RECV_LCP,	"LAST_RECV_LCP" },
-	{ L2TP_AVP_PROXY_AUTH_TYPE,	"PROXY_AUTH_TYPE" },
-	{ L2TP_AVP_PROXY_AUTH_NAME,	"PROXY_AUTH_NAME" },
-	{ L2TP_AVP_PROXY_AUTH_CHAL,	"PROXY_AUTH_CHAL" },
-	{ L2TP_AVP_PROXY_AUTH_ID,	"PROXY_AUTH_ID" },
-	{ L2TP_AVP_PROXY_AUTH_RESP,	"PROXY_AUTH_RESP" },
-	{ L2TP_AVP_CALL_ERRORS,		"CALL_ERRORS" },
-	{ L2TP_AVP_ACCM,		"ACCM" },
-	{ L2TP_AVP_RANDOM_VECTOR,	"RANDOM_VECTOR" },
-	{ L2TP_AVP_PRIVATE_GRP_ID,	"PRIVATE_GRP_ID" },
-	{ L2TP_AVP_RX_CONN_SPEED,	"RX_CONN_SPEED" },
-	{ L2TP_AVP_SEQ_REQUIRED,	"SEQ_REQUIRED" },
-	{ L2TP_AVP_PPP_DISCON_CC,	"PPP_DISCON_CC" },
-	{ 0,				NULL }
-};
-
 static const struct tok l2tp_authentype2str[] = {
 	{ L2TP_AUTHEN_TYPE_RESERVED,	"Reserved" },
 	{ L2TP_AUTHEN_TYPE_TEXTUAL,	"Textual" },
@@ -290,34 +248,13 @@ print_16bits_val(netdissect_options *ndo, const uint8_t *dat)
 	ND_PRINT("%u", GET_BE_U_2(dat));
 }
 
-static void
-print_32bits_val(netdissect_options *ndo, const uint8_t *dat)
-{
-	ND_PRINT("%u", GET_BE_U_4(dat));
-}
-
 /***********************************/
 /* AVP-specific print out routines */
 /***********************************/
-static void
-l2tp_msgtype_print(netdissect_options *ndo, const u_char *dat, u_int length)
-{
-	if (length < 2) {
-		ND_PRINT("AVP too short");
-		return;
-	}
-	ND_PRINT("%s", tok2str(l2tp_msgtype2str, "MSGTYPE-#%u",
-	    GET_BE_U_2(dat)));
-}
-
 static void
 l2tp_result_code_print(netdissect_options *ndo, const u_char *dat, u_int length)
 {
 	/* Result Code */
-	if (length < 2) {
-		ND_PRINT("AVP too short");
-		return;
-	}
 	ND_PRINT("%u", GET_BE_U_2(dat));
 	dat += 2;
 	length -= 2;
@@ -341,23 +278,17 @@ l2tp_result_code_print(netdissect_options *ndo, const u_char *dat, u_int length)
 }
 
 static void
-l2tp_proto_ver_print(netdissect_options *ndo, const u_char *dat, u_int length)
+l2tp_proto_ver_print(netdissect_options *ndo, const u_char *dat,
+		     u_int length _U_)
 {
-	if (length < 2) {
-		ND_PRINT("AVP too short");
-		return;
-	}
 	ND_PRINT("%u.%u", (GET_BE_U_2(dat) >> 8),
 		  (GET_BE_U_2(dat) & 0xff));
 }
 
 static void
-l2tp_framing_cap_print(netdissect_options *ndo, const u_char *dat, u_int length)
+l2tp_framing_cap_print(netdissect_options *ndo, const u_char *dat,
+		       u_int length _U_)
 {
-	if (length < 4) {
-		ND_PRINT("AVP too short");
-		return;
-	}
 	if (GET_BE_U_4(dat) &  L2TP_FRAMING_CAP_ASYNC_MASK) {
 		ND_PRINT("A");
 	}
@@ -367,12 +298,9 @@ l2tp_framing_cap_print(netdissect_options *ndo, const u_char *dat, u_int length)
 }
 
 static void
-l2tp_bearer_cap_print(netdissect_options *ndo, const u_char *dat, u_int length)
+l2tp_bearer_cap_print(netdissect_options *ndo, const u_char *dat,
+		      u_int length _U_)
 {
-	if (length < 4) {
-		ND_PRINT("AVP too short");
-		return;
-	}
 	if (GET_BE_U_4(dat) &  L2TP_BEARER_CAP_ANALOG_MASK) {
 		ND_PRINT("A");
 	}
@@ -384,10 +312,6 @@ l2tp_bearer_cap_print(netdissect_options *ndo, const u_char *dat, u_int length)
 static void
 l2tp_q931_cc_print(netdissect_options *ndo, const u_char *dat, u_int length)
 {
-	if (length < 3) {
-		ND_PRINT("AVP too short");
-		return;
-	}
 	print_16bits_val(ndo, dat);
 	ND_PRINT(", %02x", GET_U_1(dat + 2));
 	dat += 3;
@@ -399,12 +323,9 @@ l2tp_q931_cc_print(netdissect_options *ndo, const u_char *dat, u_int length)
 }
 
 static void
-l2tp_bearer_type_print(netdissect_options *ndo, const u_char *dat, u_int length)
+l2tp_bearer_type_print(netdissect_options *ndo, const u_char *dat,
+		       u_int length _U_)
 {
-	if (length < 4) {
-		ND_PRINT("AVP too short");
-		return;
-	}
 	if (GET_BE_U_4(dat) &  L2TP_BEARER_TYPE_ANALOG_MASK) {
 		ND_PRINT("A");
 	}
@@ -414,12 +335,9 @@ l2tp_bearer_type_print(netdissect_options *ndo, const u_char *dat, u_int length)
 }
 
 static void
-l2tp_framing_type_print(netdissect_options *ndo, const u_char *dat, u_int length)
+l2tp_framing_type_print(netdissect_options *ndo, const u_char *dat,
+			u_int length _U_)
 {
-	if (length < 4) {
-		ND_PRINT("AVP too short");
-		return;
-	}
 	if (GET_BE_U_4(dat) &  L2TP_FRAMING_TYPE_ASYNC_MASK) {
 		ND_PRINT("A");
 	}
@@ -429,29 +347,16 @@ l2tp_framing_type_print(netdissect_options *ndo, const u_char *dat, u_int length
 }
 
 static void
-l2tp_packet_proc_delay_print(netdissect_options *ndo)
+l2tp_packet_proc_delay_print(netdissect_options *ndo, const u_char *dat _U_,
+			     u_int length _U_)
 {
 	ND_PRINT("obsolete");
 }
 
 static void
-l2tp_proxy_auth_type_print(netdissect_options *ndo, const u_char *dat, u_int length)
+l2tp_proxy_auth_id_print(netdissect_options *ndo, const u_char *dat,
+			 u_int length _U_)
 {
-	if (length < 2) {
-		ND_PRINT("AVP too short");
-		return;
-	}
-	ND_PRINT("%s", tok2str(l2tp_authentype2str,
-			     "AuthType-#%u", GET_BE_U_2(dat)));
-}
-
-static void
-l2tp_proxy_auth_id_print(netdissect_options *ndo, const u_char *dat, u_int length)
-{
-	if (length < 2) {
-		ND_PRINT("AVP too short");
-		return;
-	}
 	ND_PRINT("%u", GET_BE_U_2(dat) & L2TP_PROXY_AUTH_ID_MASK);
 }
 
@@ -460,10 +365,6 @@ l2tp_call_errors_print(netdissect_options *ndo, const u_char *dat, u_int length)
 {
 	uint32_t val;
 
-	if (length < 2) {
-		ND_PRINT("AVP too short");
-		return;
-	}
 	dat += 2;	/* skip "Reserved" */
 	length -= 2;
 
@@ -515,10 +416,6 @@ l2tp_accm_print(netdissect_options *ndo, const u_char *dat, u_int length)
 {
 	uint32_t val;
 
-	if (length < 2) {
-		ND_PRINT("AVP too short");
-		return;
-	}
 	dat += 2;	/* skip "Reserved" */
 	length -= 2;
 
@@ -540,10 +437,6 @@ l2tp_accm_print(netdissect_options *ndo, const u_char *dat, u_int length)
 static void
 l2tp_ppp_discon_cc_print(netdissect_options *ndo, const u_char *dat, u_int length)
 {
-	if (length < 5) {
-		ND_PRINT("AVP too short");
-		return;
-	}
 	/* Disconnect Code */
 	ND_PRINT("%04x, ", GET_BE_U_2(dat));
 	dat += 2;
@@ -564,11 +457,101 @@ l2tp_ppp_discon_cc_print(netdissect_options *ndo, const u_char *dat, u_int lengt
 	}
 }
 
+/*
+ * The IETF-defined AVPs, by attribute type.
+ */
+#define L2TP_AVP(name, kind, width, min_len, field) \
+	{ (name), (kind), (width), (min_len), (field), NULL, NULL, NULL }
+#define L2TP_AVP_TOK(name, field, tok, fmt) \
+	{ (name), ND_TLV_TOK, 2, 2, (field), (tok), (fmt), NULL }
+#define L2TP_AVP_FUNC(name, min_len, field, print) \
+	{ (name), ND_TLV_FUNC, (field) != 0 ? 2 : 0, (min_len), (field), \
+	  NULL, NULL, (print) }
+
+static const struct nd_tlv_type l2tp_avp_types[] = {
+	[L2TP_AVP_MSGTYPE] = L2TP_AVP_TOK("MSGTYPE", NDF_L2TP_MSGTYPE,
+	    l2tp_msgtype2str, "MSGTYPE-#%u"),
+	[L2TP_AVP_RESULT_CODE] = L2TP_AVP_FUNC("RESULT_CODE", 2,
+	    NDF_L2TP_RESULT_CODE, l2tp_result_code_print),
+	[L2TP_AVP_PROTO_VER] = L2TP_AVP_FUNC("PROTO_VER", 2, 0,
+	    l2tp_proto_ver_print),
+	[L2TP_AVP_FRAMING_CAP] = L2TP_AVP_FUNC("FRAMING_CAP", 4, 0,
+	    l2tp_framing_cap_print),
+	[L2TP_AVP_BEARER_CAP] = L2TP_AVP_FUNC("BEARER_CAP", 4, 0,
+	    l2tp_bearer_cap_print),
+	[L2TP_AVP_TIE_BREAKER] = L2TP_AVP("TIE_BREAKER", ND_TLV_OCTETS, 8, 8, 0),
+	[L2TP_AVP_FIRM_VER] = L2TP_AVP("FIRM_VER", ND_TLV_UINT, 2, 2, 0),
+	[L2TP_AVP_HOST_NAME] = L2TP_AVP("HOST_NAME", ND_TLV_STRING, 0, 0,
+	    NDF_L2TP_HOST_NAME),
+	[L2TP_AVP_VENDOR_NAME] = L2TP_AVP("VENDOR_NAME", ND_TLV_STRING, 0, 0, 0),
+	[L2TP_AVP_ASSND_TUN_ID] = L2TP_AVP("ASSND_TUN_ID", ND_TLV_UINT, 2, 2,
+	    NDF_L2TP_ASSND_TUN_ID),
+	[L2TP_AVP_RECV_WIN_SIZE] = L2TP_AVP("RECV_WIN_SIZE", ND_TLV_UINT, 2, 2,
+	    0),
+	[L2TP_AVP_CHALLENGE] = L2TP_AVP("CHALLENGE", ND_TLV_OCTETS, 0, 0, 0),
+	[L2TP_AVP_Q931_CC] = L2TP_AVP_FUNC("Q931_CC", 3, 0, l2tp_q931_cc_print),
+	[L2TP_AVP_CHALLENGE_RESP] = L2TP_AVP("CHALLENGE_RESP", ND_TLV_OCTETS,
+	    16, 16, 0),
+	[L2TP_AVP_ASSND_SESS_ID] = L2TP_AVP("ASSND_SESS_ID", ND_TLV_UINT, 2, 2,
+	    NDF_L2TP_ASSND_SESS_ID),
+	[L2TP_AVP_CALL_SER_NUM] = L2TP_AVP("CALL_SER_NUM", ND_TLV_UINT, 4, 4,
+	    NDF_L2TP_CALL_SER_NUM),
+	[L2TP_AVP_MINIMUM_BPS] = L2TP_AVP("MINIMUM_BPS", ND_TLV_UINT, 4, 4, 0),
+	[L2TP_AVP_MAXIMUM_BPS] = L2TP_AVP("MAXIMUM_BPS", ND_TLV_UINT, 4, 4, 0),
+	[L2TP_AVP_BEARER_TYPE] = L2TP_AVP_FUNC("BEARER_TYPE", 4, 0,
+	    l2tp_bearer_type_print),
+	[L2TP_AVP_FRAMING_TYPE] = L2TP_AVP_FUNC("FRAMING_TYPE", 4, 0,
+	    l2tp_framing_type_print),
+	[L2TP_AVP_PACKET_PROC_DELAY] = L2TP_AVP_FUNC("PACKET_PROC_DELAY", 0, 0,
+	    l2tp_packet_proc_delay_print),
+	[L2TP_AVP_CALLED_NUMBER] = L2TP_AVP("CALLED_NUMBER", ND_TLV_STRING, 0, 0,
+	    0),
+	[L2TP_AVP_CALLING_NUMBER] = L2TP_AVP("CALLING_NUMBER", ND_TLV_STRING, 0,
+	    0, 0),
+	[L2TP_AVP_SUB_ADDRESS] = L2TP_AVP("SUB_ADDRESS", ND_TLV_STRING, 0, 0, 0),
+	[L2TP_AVP_TX_CONN_SPEED] = L2TP_AVP("TX_CONN_SPEED", ND_TLV_UINT, 4, 4,
+	    0),
+	[L2TP_AVP_PHY_CHANNEL_ID] = L2TP_AVP("PHY_CHANNEL_ID", ND_TLV_UINT, 4, 4,
+	    0),
+	[L2TP_AVP_INI_RECV_LCP] = L2TP_AVP("INI_RECV_LCP", ND_TLV_OCTETS, 0, 0,
+	    0),
+	[L2TP_AVP_LAST_SENT_LCP] = L2TP_AVP("LAST_SENT_LCP", ND_TLV_OCTETS, 0, 0,
+	    0),
+	[L2TP_AVP_LAST_RECV_LCP] = L2TP_AVP("LAST_RECV_LCP", ND_TLV_OCTETS, 0, 0,
+	    0),
+	[L2TP_AVP_PROXY_AUTH_TYPE] = L2TP_AVP_TOK("PROXY_AUTH_TYPE", 0,
+	    l2tp_authentype2str, "AuthType-#%u"),
+	[L2TP_AVP_PROXY_AUTH_NAME] = L2TP_AVP("PROXY_AUTH_NAME", ND_TLV_STRING,
+	    0, 0, 0),
+	[L2TP_AVP_PROXY_AUTH_CHAL] = L2TP_AVP("PROXY_AUTH_CHAL", ND_TLV_OCTETS,
+	    0, 0, 0),
+	[L2TP_AVP_PROXY_AUTH_ID] = L2TP_AVP_FUNC("PROXY_AUTH_ID", 2, 0,
+	    l2tp_proxy_auth_id_print),
+	[L2TP_AVP_PROXY_AUTH_RESP] = L2TP_AVP("PROXY_AUTH_RESP", ND_TLV_OCTETS,
+	    0, 0, 0),
+	[L2TP_AVP_CALL_ERRORS] = L2TP_AVP_FUNC("CALL_ERRORS", 2, 0,
+	    l2tp_call_errors_print),
+	[L2TP_AVP_ACCM] = L2TP_AVP_FUNC("ACCM", 2, 0, l2tp_accm_print),
+	[L2TP_AVP_RANDOM_VECTOR] = L2TP_AVP("RANDOM_VECTOR", ND_TLV_OCTETS, 0, 0,
+	    0),
+	[L2TP_AVP_PRIVATE_GRP_ID] = L2TP_AVP("PRIVATE_GRP_ID", ND_TLV_STRING, 0,
+	    0, 0),
+	[L2TP_AVP_RX_CONN_SPEED] = L2TP_AVP("RX_CONN_SPEED", ND_TLV_UINT, 4, 4,
+	    0),
+	[L2TP_AVP_SEQ_REQUIRED] = L2TP_AVP("SEQ_REQUIRED", ND_TLV_NONE, 0, 0, 0),
+	[L2TP_AVP_PPP_DISCON_CC] = L2TP_AVP_FUNC("PPP_DISCON_CC", 5, 0,
+	    l2tp_ppp_discon_cc_print)
+};
+
+static const struct nd_tlv_table l2tp_avps =
+	ND_TLV_TABLE(l2tp_avp_types, NDF_L2TP, "AVP too short");
+
 static u_int
 l2tp_avp_print(netdissect_options *ndo, const u_char *dat, u_int length)
 {
 	u_int len;
 	uint16_t attr_type;
+	const char *name;
 	int hidden = FALSE;
 
 	ND_PRINT(" ");
@@ -615,114 +598,17 @@ l2tp_avp_print(netdissect_options *ndo, const u_char *dat, u_int length)
 		/* IETF-defined Attributes */
 		dat += 2;
 		attr_type = GET_BE_U_2(dat); dat += 2;
-		ND_PRINT("%s", tok2str(l2tp_avp2str, "AVP-#%u", attr_type));
+		name = nd_tlv_name(&l2tp_avps, attr_type);
+		if (name != NULL)
+			ND_PRINT("%s", name);
+		else
+			ND_PRINT("AVP-#%u", attr_type);
 		ND_PRINT("(");
-		if (hidden) {
+		if (hidden)
 			ND_PRINT("???");
-		} else {
-			switch (attr_type) {
-			case L2TP_AVP_MSGTYPE:
-				l2tp_msgtype_print(ndo, dat, len-6);
-				break;
-			case L2TP_AVP_RESULT_CODE:
-				l2tp_result_code_print(ndo, dat, len-6);
-				break;
-			case L2TP_AVP_PROTO_VER:
-				l2tp_proto_ver_print(ndo, dat, len-6);
-				break;
-			case L2TP_AVP_FRAMING_CAP:
-				l2tp_framing_cap_print(ndo, dat, len-6);
-				break;
-			case L2TP_AVP_BEARER_CAP:
-				l2tp_bearer_cap_print(ndo, dat, len-6);
-				break;
-			case L2TP_AVP_TIE_BREAKER:
-				if (len-6 < 8) {
-					ND_PRINT("AVP too short");
-					break;
-				}
-				print_octets(ndo, dat, 8);
-				break;
-			case L2TP_AVP_FIRM_VER:
-			case L2TP_AVP_ASSND_TUN_ID:
-			case L2TP_AVP_RECV_WIN_SIZE:
-			case L2TP_AVP_ASSND_SESS_ID:
-				if (len-6 < 2) {
-					ND_PRINT("AVP too short");
-					break;
-				}
-				print_16bits_val(ndo, dat);
-				break;
-			case L2TP_AVP_HOST_NAME:
-			case L2TP_AVP_VENDOR_NAME:
-			case L2TP_AVP_CALLING_NUMBER:
-			case L2TP_AVP_CALLED_NUMBER:
-			case L2TP_AVP_SUB_ADDRESS:
-			case L2TP_AVP_PROXY_AUTH_NAME:
-			case L2TP_AVP_PRIVATE_GRP_ID:
-				print_string(ndo, dat, len-6);
-				break;
-			case L2TP_AVP_CHALLENGE:
-			case L2TP_AVP_INI_RECV_LCP:
-			case L2TP_AVP_LAST_SENT_LCP:
-			case L2TP_AVP_LAST_RECV_LCP:
-			case L2TP_AVP_PROXY_AUTH_CHAL:
-			case L2TP_AVP_PROXY_AUTH_RESP:
-			case L2TP_AVP_RANDOM_VECTOR:
-				print_octets(ndo, dat, len-6);
-				break;
-			case L2TP_AVP_Q931_CC:
-				l2tp_q931_cc_print(ndo, dat, len-6);
-				break;
-			case L2TP_AVP_CHALLENGE_RESP:
-				if (len-6 < 16) {
-					ND_PRINT("AVP too short");
-					break;
-				}
-				print_octets(ndo, dat, 16);
-				break;
-			case L2TP_AVP_CALL_SER_NUM:
-			case L2TP_AVP_MINIMUM_BPS:
-			case L2TP_AVP_MAXIMUM_BPS:
-			case L2TP_AVP_TX_CONN_SPEED:
-			case L2TP_AVP_PHY_CHANNEL_ID:
-			case L2TP_AVP_RX_CONN_SPEED:
-				if (len-6 < 4) {
-					ND_PRINT("AVP too short");
-					break;
-				}
-				print_32bits_val(ndo, dat);
-				break;
-			case L2TP_AVP_BEARER_TYPE:
-				l2tp_bearer_type_print(ndo, dat, len-6);
-				break;
-			case L2TP_AVP_FRAMING_TYPE:
-				l2tp_framing_type_print(ndo, dat, len-6);
-				break;
-			case L2TP_AVP_PACKET_PROC_DELAY:
-				l2tp_packet_proc_delay_print(ndo);
-				break;
-			case L2TP_AVP_PROXY_AUTH_TYPE:
-				l2tp_proxy_auth_type_print(ndo, dat, len-6);
-				break;
-			case L2TP_AVP_PROXY_AUTH_ID:
-				l2tp_proxy_auth_id_print(ndo, dat, len-6);
-				break;
-			case L2TP_AVP_CALL_ERRORS:
-				l2tp_call_errors_print(ndo, dat, len-6);
-				break;
-			case L2TP_AVP_ACCM:
-				l2tp_accm_print(ndo, dat, len-6);
-				break;
-			case L2TP_AVP_SEQ_REQUIRED:
-				break;	/* No Attribute Value */
-			case L2TP_AVP_PPP_DISCON_CC:
-				l2tp_ppp_discon_cc_print(ndo, dat, len-6);
-				break;
-			default:
-				break;
-			}
-		}
+		else
+			nd_tlv_value_print(ndo, &l2tp_avps, attr_type, dat,
+			    len - 6);
 		ND_PRINT(")");
 	}
 
@@ -734,6 +620,132 @@ l2tp_avp_print(netdissect_options *ndo, const u_char *dat, u_int length)
 }
 
 
+/*
+ * Print the --ppp-sessions event, if any, of the control message, with
+ * the AVPs at "dat", to "session" of "tunnel".  The tunnel and session
+ * IDs an end assigns are the ones the other end sends to it with, so
+ * the IDs in the replies tie the two directions of each together.
+ */
+static void
+l2tp_session_control(netdissect_options *ndo, u_int tunnel, u_int session,
+                     const u_char *dat, u_int length)
+{
+	struct ppp_session *ps, *pt, *other;
+	u_int len, attr_type, msgtype = 0, asgnd_tun = 0, asgnd_sess = 0, n;
+	int have_msgtype = FALSE;
+
+	while (length >= 8 && ND_TTEST_LEN(dat, 8)) {
+		len = GET_BE_U_2(dat) & L2TP_AVP_HDR_LEN_MASK;
+		if (len < 6 || len > length || !ND_TTEST_LEN(dat, len))
+			break;
+		if (!(GET_BE_U_2(dat) & L2TP_AVP_HDR_FLAG_HIDDEN) &&
+		    GET_BE_U_2(dat + 2) == 0 && len >= 8) {
+			attr_type = GET_BE_U_2(dat + 4);
+			if (attr_type == L2TP_AVP_MSGTYPE) {
+				msgtype = GET_BE_U_2(dat + 6);
+				have_msgtype = TRUE;
+			} else if (attr_type == L2TP_AVP_ASSND_TUN_ID)
+				asgnd_tun = GET_BE_U_2(dat + 6);
+			else if (attr_type == L2TP_AVP_ASSND_SESS_ID)
+				asgnd_sess = GET_BE_U_2(dat + 6);
+		}
+		dat += len;
+		length -= len;
+	}
+
+	pt = NULL;
+	if (tunnel != 0) {
+		pt = ppp_session_find(ndo, PPP_SESSION_L2TP, tunnel,
+		    PPP_SESSION_TUNNEL);
+		pt->stats.pss_control++;
+	}
+	ps = NULL;
+	if (pt != NULL && session != 0) {
+		ps = ppp_session_find(ndo, PPP_SESSION_L2TP, tunnel, session);
+		ps->stats.pss_control++;
+	}
+	if (!have_msgtype)
+		return;		/* a ZLB */
+
+	switch (msgtype) {
+	case L2TP_MSGTYPE_SCCRQ:
+		if (asgnd_tun != 0)
+			ppp_session_state(
+			    ppp_session_find(ndo, PPP_SESSION_L2TP, asgnd_tun,
+			    PPP_SESSION_TUNNEL), PPP_SESSION_SETUP);
+		break;
+	case L2TP_MSGTYPE_SCCRP:
+		if (pt == NULL || asgnd_tun == 0)
+			break;
+		other = ppp_session_find(ndo, PPP_SESSION_L2TP, asgnd_tun,
+		    PPP_SESSION_TUNNEL);
+		ppp_session_pair(pt, other);
+		ppp_session_state(pt, PPP_SESSION_SETUP);
+		break;
+	case L2TP_MSGTYPE_SCCCN:
+		if (pt == NULL)
+			break;
+		ppp_session_state(pt, PPP_SESSION_UP);
+		ND_PRINT(" tunnel %u", tunnel);
+		if (pt->peer != NULL)
+			ND_PRINT("/%u", pt->peer->stats.pss_tunnel);
+		ND_PRINT(" up");
+		break;
+	case L2TP_MSGTYPE_STOPCCN:
+		if (pt == NULL)
+			break;
+		ppp_session_state(pt, PPP_SESSION_DOWN);
+		n = ppp_session_tunnel_down(tunnel);
+		ND_PRINT(" tunnel %u", tunnel);
+		if (pt->peer != NULL) {
+			ND_PRINT("/%u", pt->peer->stats.pss_tunnel);
+			n += ppp_session_tunnel_down(pt->peer->stats.pss_tunnel);
+		}
+		ND_PRINT(" down, %u session%s down", n, PLURAL_SUFFIX(n));
+		break;
+	case L2TP_MSGTYPE_ICRQ:
+	case L2TP_MSGTYPE_OCRQ:
+		if (pt == NULL || pt->peer == NULL || asgnd_sess == 0)
+			break;
+		ppp_session_state(
+		    ppp_session_find(ndo, PPP_SESSION_L2TP,
+		    pt->peer->stats.pss_tunnel, asgnd_sess), PPP_SESSION_SETUP);
+		break;
+	case L2TP_MSGTYPE_ICRP:
+	case L2TP_MSGTYPE_OCRP:
+		if (ps == NULL)
+			break;
+		if (pt->peer != NULL && asgnd_sess != 0) {
+			other = ppp_session_find(ndo, PPP_SESSION_L2TP,
+			    pt->peer->stats.pss_tunnel, asgnd_sess);
+			ppp_session_pair(ps, other);
+		}
+		ppp_session_state(ps, PPP_SESSION_SETUP);
+		break;
+	case L2TP_MSGTYPE_ICCN:
+	case L2TP_MSGTYPE_OCCN:
+		if (ps == NULL)
+			break;
+		ppp_session_state(ps, PPP_SESSION_UP);
+		ND_PRINT(" session %u/%u up", tunnel, session);
+		break;
+	case L2TP_MSGTYPE_CDN:
+		if (ps == NULL)
+			break;
+		ppp_session_state(ps, PPP_SESSION_DOWN);
+		ND_PRINT(" session %u/%u down, %" PRIu64 " packets, %" PRIu64
+		    " bytes", tunnel, session, ps->stats.pss_packets,
+		    ps->stats.pss_bytes);
+		if (ps->peer != NULL)
+			ND_PRINT(", %" PRIu64 " packets, %" PRIu64
+			    " bytes back", ps->peer->stats.pss_packets,
+			    ps->peer->stats.pss_bytes);
+		break;
+	default:
+		break;
+	}
+}
+
 void
 l2tp_print(netdissect_options *ndo, const u_char *dat, u_int length)
 {
@@ -742,6 +754,9 @@ l2tp_print(netdissect_options *ndo, const u_char *dat, u_int length)
 	uint16_t pad;
 	int flag_t, flag_l, flag_s, flag_o;
 	uint16_t l2tp_len;
+	u_int tunnel, session;
+	const u_char *avps;
+	u_int avps_len;
 
 	ndo->ndo_protocol = "l2tp";
 	flag_t = flag_l = flag_s = flag_o = FALSE;
@@ -791,11 +806,15 @@ l2tp_print(netdissect_options *ndo, const u_char *dat, u_int length)
 	}
 
 	ND_TCHECK_2(ptr);		/* Tunnel ID */
-	ND_PRINT("(%u/", GET_BE_U_2(ptr));
+	tunnel = GET_BE_U_2(ptr);
+	ND_PRINT("(%u/", tunnel);
+	ND_FIELD_UINT(NDF_L2TP, NDF_L2TP_TUNNEL, tunnel);
 	ptr += 2;
 	cnt += 2;
 	ND_TCHECK_2(ptr);		/* Session ID */
-	ND_PRINT("%u)",  GET_BE_U_2(ptr));
+	session = GET_BE_U_2(ptr);
+	ND_PRINT("%u)", session);
+	ND_FIELD_UINT(NDF_L2TP, NDF_L2TP_SESSION, session);
 	ptr += 2;
 	cnt += 2;
 
@@ -833,6 +852,8 @@ l2tp_print(netdissect_options *ndo, const u_char *dat, u_int length)
 			ND_PRINT(" No length");
 			return;
 		}
+		avps = ptr;
+		avps_len = length - cnt;
 		if (length - cnt == 0) {
 			ND_PRINT(" ZLB");
 		} else {
@@ -853,6 +874,12 @@ l2tp_print(netdissect_options *ndo, const u_char *dat, u_int length)
 				ptr += avp_length;
 			}
 		}
+		if (ndo->ndo_ppp_sessions)
+			l2tp_session_control(ndo, tunnel, session, avps,
+			    avps_len);
+	} else if (ndo->ndo_ppp_sessions) {
+		ppp_session_data(ndo, ppp_session_find(ndo, PPP_SESSION_L2TP,
+		    tunnel, session), length - cnt);
 	} else {
 		ND_PRINT(" {");
 		ppp_print(ndo, ptr, length - cnt);
@@ -28,6 +28,8 @@
 
 #include "l2vpn.h"
 #include "af.h"
+#include "addrtostr.h"
+#include "label-binding.h"
 
 
 /*
@@ -547,17 +549,138 @@ invalid:
     return(tlv_len+4); /* Type & Length fields not included */
 }
 
+/*
+ * Update the --label-bindings table from the FEC and Generic Label TLVs,
+ * at "tptr", of a Label Mapping or Label Withdraw message from the LSR
+ * and label space at "lsr".
+ */
+static int
+ldp_msg_bindings(netdissect_options *ndo, const u_char *lsr, u_int msg_type,
+                 const u_char *tptr, u_int tlen)
+{
+    u_char key[LABEL_BINDING_KEYLEN];
+    char name[128], addr[INET6_ADDRSTRLEN];
+    const u_char *fec = NULL, *p;
+    u_int fec_len = 0, label = 0, tlv_type, tlv_len, len, af, plen, n;
+    int have_label = FALSE, changed = 0;
+    uint32_t hash;
+
+    hash = label_binding_hash(2166136261U, tptr, tlen);
+    for (p = tptr, len = tlen; len >= 4; p += 4 + tlv_len, len -= 4 + tlv_len) {
+        tlv_type = LDP_MASK_TLV_TYPE(GET_BE_U_2(p));
+        tlv_len = GET_BE_U_2(p + 2);
+        if (tlv_len > len - 4)
+            break;
+        if (tlv_type == LDP_TLV_FEC) {
+            fec = p + 4;
+            fec_len = tlv_len;
+        } else if (tlv_type == LDP_TLV_GENERIC_LABEL && tlv_len >= 4) {
+            label = GET_BE_U_4(p + 4) & 0xfffff;
+            have_label = TRUE;
+        }
+    }
+    if (fec == NULL || (msg_type == LDP_MSG_LABEL_MAPPING && !have_label))
+        return 0;
+
+    memset(key, 0, sizeof(key));
+    key[0] = 'L';
+    memcpy(key + 1, lsr, 6);		/* LSR ID and label space */
+    while (fec_len >= 1) {
+        if (GET_U_1(fec) == LDP_FEC_WILDCARD) {
+            if (msg_type == LDP_MSG_LABEL_WITHDRAW)
+                changed |= label_unbind_all(ndo, key, 7);
+            break;
+        }
+        if (fec_len < 4 || (GET_U_1(fec) != LDP_FEC_PREFIX &&
+            GET_U_1(fec) != LDP_FEC_HOSTADDRESS))
+            break;
+        af = GET_BE_U_2(fec + 1);
+        plen = GET_U_1(fec + 3);
+        if (GET_U_1(fec) == LDP_FEC_PREFIX)
+            n = (plen + 7) / 8;
+        else {
+            n = plen;		/* the address length, in bytes */
+            plen *= 8;
+        }
+        if ((af != AFNUM_INET && af != AFNUM_INET6) ||
+            n > (af == AFNUM_INET ? 4U : 16U) || fec_len < 4 + n)
+            break;
+        memset(key + 7, 0, sizeof(key) - 7);
+        memcpy(key + 7, fec, 4);
+        GET_CPY_BYTES(key + 11, fec + 4, n);
+        if (af == AFNUM_INET)
+            addrtostr(key + 11, addr, sizeof(addr));
+        else
+            addrtostr6(key + 11, addr, sizeof(addr));
+        snprintf(name, sizeof(name), "ldp %s:%u %s/%u",
+                 GET_IPADDR_STRING(lsr), GET_BE_U_2(lsr + 4), addr, plen);
+        if (msg_type == LDP_MSG_LABEL_MAPPING)
+            changed |= label_bind(ndo, key, 27, name, label, hash);
+        else
+            changed |= label_unbind(ndo, key, 27);
+        fec += 4 + n;
+        fec_len -= 4 + n;
+    }
+    return changed;
+}
+
+/*
+ * Walk the messages of the PDUs at "pptr" for --label-bindings; a
+ * segment that changes no binding isn't shown.
+ */
+static void
+ldp_bindings(netdissect_options *ndo, const u_char *pptr, u_int len)
+{
+    const u_char *tptr;
+    u_int pdu_len, tlen, msg_type, msg_len;
+    int changed = 0;
+
+    while (len >= sizeof(struct ldp_common_header) &&
+           ND_TTEST_LEN(pptr, sizeof(struct ldp_common_header))) {
+        if (GET_BE_U_2(pptr) != LDP_VERSION)
+            break;
+        pdu_len = GET_BE_U_2(pptr + 2);
+        if (pdu_len < sizeof(struct ldp_common_header) - 4 ||
+            pdu_len + 4 > len)
+            break;
+        tptr = pptr + sizeof(struct ldp_common_header);
+        tlen = pdu_len - (sizeof(struct ldp_common_header) - 4);
+        while (tlen >= sizeof(struct ldp_msg_header) &&
+               ND_TTEST_LEN(tptr, sizeof(struct ldp_msg_header))) {
+            msg_type = LDP_MASK_MSG_TYPE(GET_BE_U_2(tptr));
+            msg_len = GET_BE_U_2(tptr + 2);
+            if (msg_len < sizeof(struct ldp_msg_header) - 4 ||
+                msg_len + 4 > tlen || !ND_TTEST_LEN(tptr, msg_len + 4))
+                goto done;
+            if (msg_type == LDP_MSG_LABEL_MAPPING ||
+                msg_type == LDP_MSG_LABEL_WITHDRAW)
+                changed |= ldp_msg_bindings(ndo, pptr + 4, msg_type,
+                    tptr + sizeof(struct ldp_msg_header),
+                    msg_len - (sizeof(struct ldp_msg_header) - 4));
+            tptr += msg_len + 4;
+            tlen -= msg_len + 4;
+        }
+        pptr += pdu_len + 4;
+        len -= pdu_len + 4;
+    }
+done:
+    if (!changed)
+        ndo->ndo_drop_line = 1;
+}
+
 void
 ldp_print(netdissect_options *ndo,
           const u_char *pptr, u_int len)
 {
+    const u_char *bp = pptr;
+    u_int length = len;
     u_int processed;
 
     ndo->ndo_protocol = "ldp";
     while (len > (sizeof(struct ldp_common_header) + sizeof(struct ldp_msg_header))) {
         processed = ldp_pdu_print(ndo, pptr);
         if (processed == 0)
-            return;
+            break;
         if (len < processed) {
             ND_PRINT(" [remaining length %u < %u]", len, processed);
             nd_print_invalid(ndo);
@@ -566,6 +689,8 @@ ldp_print(netdissect_options *ndo,
         len -= processed;
         pptr += processed;
     }
+    if (ndo->ndo_label_bindings)
+        ldp_bindings(ndo, bp, length);
 }
 
 static u_int
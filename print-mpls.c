@@ -35,6 +35,7 @@
 #include "netdissect-stdinc.h"
 
 #include "netdissect.h"
+#include "netdissect-fields.h"
 #include "extract.h"
 #include "mpls.h"
 
@@ -76,6 +77,14 @@ mpls_print(netdissect_options *ndo, const u_char *bp, u_int length)
 		       (label_stack_depth && ndo->ndo_vflag) ? "\n\t" : " ",
        		       MPLS_LABEL(label_entry));
 		label_stack_depth++;
+		if (label_stack_depth == 1) {
+			ND_FIELD_UINT(NDF_MPLS, NDF_MPLS_LABEL,
+			    MPLS_LABEL(label_entry));
+			ND_FIELD_UINT(NDF_MPLS, NDF_MPLS_EXP,
+			    MPLS_EXP(label_entry));
+			ND_FIELD_UINT(NDF_MPLS, NDF_MPLS_TTL,
+			    MPLS_TTL(label_entry));
+		}
 		if (ndo->ndo_vflag &&
 		    MPLS_LABEL(label_entry) < sizeof(mpls_labelname) / sizeof(mpls_labelname[0]))
 			ND_PRINT(" (%s)", mpls_labelname[MPLS_LABEL(label_entry)]);
@@ -87,6 +96,7 @@ mpls_print(netdissect_options *ndo, const u_char *bp, u_int length)
 		p += sizeof(label_entry);
 		length -= sizeof(label_entry);
 	} while (!MPLS_STACK(label_entry));
+	ND_FIELD_UINT(NDF_MPLS, NDF_MPLS_DEPTH, label_stack_depth);
 
 	/*
 	 * Try to figure out the packet type.
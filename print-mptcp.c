@@ -42,9 +42,18 @@
 
 #include "netdissect-stdinc.h"
 
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef HAVE_LIBCRYPTO
+#include <openssl/sha.h>
+#endif
+
 #include "netdissect.h"
 #include "extract.h"
 #include "addrtoname.h"
+#include "addrtostr.h"
 
 #include "tcp.h"
 
@@ -165,6 +174,66 @@ struct mp_prio {
 
 #define MP_PRIO_B                       0x01
 
+/*
+ * --mptcp-connections keeps a table of MPTCP connections and of the
+ * subflows that belong to them.  A subflow is found by its addresses
+ * and ports; one that carries MP_CAPABLE starts a connection, and one
+ * that starts with MP_JOIN joins the connection that owns the token it
+ * carries.  A token is the top 32 bits of the SHA-1 hash of a key
+ * (RFC 8684 section 3.2), so, without libcrypto, joins that carry the
+ * same token can be put together but not with the first subflow.
+ *
+ * The data sent each way is followed by the DSS mappings: only the
+ * part of a mapping above the highest data sequence number mapped so
+ * far, on any subflow, counts for the connection, so data sent again
+ * on another subflow isn't counted twice.
+ *
+ * At most MPTCP_MAX_CONNS connections and MPTCP_MAX_SUBFLOWS subflows
+ * are kept, until the end, for the report; those after that aren't
+ * followed.
+ */
+#define MPTCP_MAX_CONNS         (1U << 16)
+#define MPTCP_MAX_SUBFLOWS      (1U << 18)
+#define MP_CHAINS               65536
+
+struct mp_conn;
+
+struct mp_subflow {
+        struct mptcp_subflow_stats stats;
+        u_char src[16];                 /* as its first segment went */
+        u_char dst[16];                 /* IPv4 addresses are in the first 4 */
+        uint16_t sport;
+        uint16_t dport;
+        u_int alen;
+        u_int side;                     /* the side of the connection src is */
+        struct mp_conn *conn;
+        char name[2 * INET6_ADDRSTRLEN + 16];
+        struct mp_subflow *next;        /* on its hash chain */
+        struct mp_subflow *conn_next;   /* in its connection */
+};
+
+/* A token, on the hash chain for it. */
+struct mp_token {
+        uint32_t token;
+        struct mp_conn *conn;
+        struct mp_token *next;
+};
+
+struct mp_conn {
+        struct mptcp_conn_stats stats;
+        struct mp_token tok[2];         /* [0] the initiator's */
+        int have_dsn[2];
+        uint64_t dsn[2];                /* the highest mapped each way, plus one */
+        int open;                       /* it's had a segment without SYN */
+        struct mp_subflow *subflows;
+        struct mp_subflow **last;       /* where the next one goes */
+};
+
+static ND_THREAD_LOCAL struct mp_subflow **mp_subflow_chains;
+static ND_THREAD_LOCAL struct mp_token **mp_token_chains;
+static ND_THREAD_LOCAL struct mp_conn **mp_conns;       /* in order made */
+static ND_THREAD_LOCAL u_int mp_nconns, mp_maxconns, mp_nsubflows;
+
 static int
 dummy_print(netdissect_options *ndo _U_,
             const u_char *opt _U_, u_int opt_len _U_, u_char flags _U_)
@@ -439,6 +508,412 @@ static const struct {
         { "unknown",    dummy_print },
 };
 
+/*
+ * A hash of the subflow's addresses and ports that's the same both
+ * ways.
+ */
+static uint32_t
+mp_subflow_hash(const u_char *src, const u_char *dst, u_int alen,
+                uint16_t sport, uint16_t dport)
+{
+        uint32_t a = 2166136261U, b = 2166136261U;
+        u_int i;
+
+        for (i = 0; i < alen; i++) {
+                a = (a ^ src[i]) * 16777619U;
+                b = (b ^ dst[i]) * 16777619U;
+        }
+        a = (a ^ sport) * 16777619U;
+        b = (b ^ dport) * 16777619U;
+        return (a ^ b);
+}
+
+/*
+ * Find the subflow a segment is on, and whether it goes the other way
+ * from the subflow's first segment.
+ */
+static struct mp_subflow *
+mp_subflow_find(const u_char *src, const u_char *dst, u_int alen,
+                uint16_t sport, uint16_t dport, u_int *dir)
+{
+        struct mp_subflow *sf;
+
+        if (mp_subflow_chains == NULL)
+                return NULL;
+        sf = mp_subflow_chains[mp_subflow_hash(src, dst, alen, sport, dport) %
+                               MP_CHAINS];
+        for (; sf != NULL; sf = sf->next) {
+                if (sf->alen != alen)
+                        continue;
+                if (sf->sport == sport && sf->dport == dport &&
+                    memcmp(sf->src, src, alen) == 0 &&
+                    memcmp(sf->dst, dst, alen) == 0) {
+                        *dir = 0;
+                        return sf;
+                }
+                if (sf->sport == dport && sf->dport == sport &&
+                    memcmp(sf->src, dst, alen) == 0 &&
+                    memcmp(sf->dst, src, alen) == 0) {
+                        *dir = 1;
+                        return sf;
+                }
+        }
+        return NULL;
+}
+
+static struct mp_conn *
+mp_conn_new(netdissect_options *ndo)
+{
+        struct mp_conn *c;
+
+        if (mp_nconns == MPTCP_MAX_CONNS)
+                return NULL;
+        if (mp_nconns == mp_maxconns) {
+                mp_maxconns = mp_maxconns ? mp_maxconns * 2 : 64;
+                mp_conns = (struct mp_conn **)realloc(mp_conns,
+                    mp_maxconns * sizeof(*mp_conns));
+                if (mp_conns == NULL)
+                        (*ndo->ndo_error)(ndo, S_ERR_ND_MEM_ALLOC,
+                            "%s: realloc", __func__);
+        }
+        c = (struct mp_conn *)calloc(1, sizeof(*c));
+        if (c == NULL)
+                (*ndo->ndo_error)(ndo, S_ERR_ND_MEM_ALLOC, "%s: calloc",
+                    __func__);
+        c->tok[0].conn = c->tok[1].conn = c;
+        c->last = &c->subflows;
+        mp_conns[mp_nconns++] = c;
+        return c;
+}
+
+/*
+ * Start a subflow of the connection, as going the way of this segment
+ * from the given side of the connection.  It goes in front of any
+ * earlier one with the same addresses and ports, so a new connection
+ * on them replaces it.
+ */
+static struct mp_subflow *
+mp_subflow_new(netdissect_options *ndo, struct mp_conn *c, u_int side,
+               int join, const u_char *src, const u_char *dst, u_int alen,
+               uint16_t sport, uint16_t dport)
+{
+        struct mp_subflow *sf, **sfp;
+        char sbuf[INET6_ADDRSTRLEN], dbuf[INET6_ADDRSTRLEN];
+
+        if (mp_nsubflows == MPTCP_MAX_SUBFLOWS)
+                return NULL;
+        if (mp_subflow_chains == NULL) {
+                mp_subflow_chains = (struct mp_subflow **)calloc(MP_CHAINS,
+                    sizeof(*mp_subflow_chains));
+                if (mp_subflow_chains == NULL)
+                        (*ndo->ndo_error)(ndo, S_ERR_ND_MEM_ALLOC,
+                            "%s: calloc", __func__);
+        }
+        sf = (struct mp_subflow *)calloc(1, sizeof(*sf));
+        if (sf == NULL)
+                (*ndo->ndo_error)(ndo, S_ERR_ND_MEM_ALLOC, "%s: calloc",
+                    __func__);
+        memcpy(sf->src, src, alen);
+        memcpy(sf->dst, dst, alen);
+        sf->sport = sport;
+        sf->dport = dport;
+        sf->alen = alen;
+        sf->side = side;
+        sf->conn = c;
+        if (alen == 4) {
+                addrtostr(src, sbuf, sizeof(sbuf));
+                addrtostr(dst, dbuf, sizeof(dbuf));
+        } else {
+                addrtostr6(src, sbuf, sizeof(sbuf));
+                addrtostr6(dst, dbuf, sizeof(dbuf));
+        }
+        snprintf(sf->name, sizeof(sf->name), "%s.%u > %s.%u", sbuf, sport,
+            dbuf, dport);
+        sf->stats.mss_name = sf->name;
+        sf->stats.mss_join = join;
+        sfp = &mp_subflow_chains[mp_subflow_hash(src, dst, alen, sport,
+                                                 dport) % MP_CHAINS];
+        sf->next = *sfp;
+        *sfp = sf;
+        mp_nsubflows++;
+
+        *c->last = sf;
+        c->last = &sf->conn_next;
+        if (c->stats.mcs_subflows++ == 0)
+                c->stats.mcs_first = sf->name;
+        return sf;
+}
+
+/*
+ * Find the connection that owns a token, and which side of it owns it.
+ */
+static struct mp_conn *
+mp_token_find(uint32_t token, u_int *side)
+{
+        struct mp_token *t;
+
+        if (mp_token_chains == NULL)
+                return NULL;
+        for (t = mp_token_chains[token % MP_CHAINS]; t != NULL; t = t->next)
+                if (t->token == token) {
+                        *side = (u_int)(t - t->conn->tok);
+                        return t->conn;
+                }
+        return NULL;
+}
+
+/*
+ * Give a side of the connection its token, if it hasn't got one.
+ */
+static void
+mp_token_set(netdissect_options *ndo, struct mp_conn *c, u_int side,
+             uint32_t token)
+{
+        struct mp_token *t = &c->tok[side], **tp;
+
+        if (c->stats.mcs_tokens & (1U << side))
+                return;
+        if (mp_token_chains == NULL) {
+                mp_token_chains = (struct mp_token **)calloc(MP_CHAINS,
+                    sizeof(*mp_token_chains));
+                if (mp_token_chains == NULL)
+                        (*ndo->ndo_error)(ndo, S_ERR_ND_MEM_ALLOC,
+                            "%s: calloc", __func__);
+        }
+        t->token = token;
+        tp = &mp_token_chains[token % MP_CHAINS];
+        t->next = *tp;
+        *tp = t;
+        c->stats.mcs_token[side] = token;
+        c->stats.mcs_tokens |= 1U << side;
+}
+
+/*
+ * A side of the connection has sent its key; work out its token.
+ */
+static void
+mp_key_set(netdissect_options *ndo _U_, struct mp_conn *c _U_,
+           u_int side _U_, const u_char *key _U_)
+{
+#ifdef HAVE_LIBCRYPTO
+        u_char md[SHA_DIGEST_LENGTH];
+
+        SHA1(key, 8, md);
+        mp_token_set(ndo, c, side, EXTRACT_BE_U_4(md));
+#endif
+}
+
+/*
+ * Count a DSS mapping sent by the given side of the subflow's
+ * connection.
+ */
+static void
+mp_map(struct mp_subflow *sf, u_int side, uint64_t dsn, int dsn64,
+       u_int dll, int fin)
+{
+        struct mp_conn *c = sf->conn;
+        uint64_t end;
+
+        /* A DATA_FIN takes one from the mapping. */
+        if (fin && dll != 0)
+                dll--;
+        if (!dsn64 && c->have_dsn[side]) {
+                /* Put a 32-bit DSN in the 2^32 around the highest. */
+                dsn |= c->dsn[side] & ~(uint64_t)0xffffffff;
+                if (dsn > c->dsn[side] + 0x80000000U &&
+                    dsn >= ((uint64_t)1 << 32))
+                        dsn -= (uint64_t)1 << 32;
+                else if (dsn + 0x80000000U < c->dsn[side])
+                        dsn += (uint64_t)1 << 32;
+        }
+        end = dsn + dll;
+        sf->stats.mss_data[side] += dll;
+        if (!c->have_dsn[side]) {
+                c->have_dsn[side] = 1;
+                c->dsn[side] = end;
+                c->stats.mcs_data[side] += dll;
+        } else if (end > c->dsn[side]) {
+                c->stats.mcs_data[side] += end - max(dsn, c->dsn[side]);
+                c->dsn[side] = end;
+        }
+        if (fin)
+                c->stats.mcs_data_fins |= 1U << side;
+}
+
+/*
+ * Parse a DSS option, which has been checked to be all there, for its
+ * mapping.
+ */
+static void
+mp_dss_track(struct mp_subflow *sf, u_int side, const u_char *opt,
+             u_int opt_len)
+{
+        uint8_t mdss_flags;
+        uint64_t dsn;
+        u_int need;
+
+        if (opt_len < 4)
+                return;
+        mdss_flags = EXTRACT_U_1(opt + 3);
+        if (mdss_flags & MP_DSS_F)
+                sf->conn->stats.mcs_data_fins |= 1U << side;
+        if (!(mdss_flags & MP_DSS_M))
+                return;
+        opt += 4;
+        opt_len -= 4;
+        if (mdss_flags & MP_DSS_A) {
+                need = (mdss_flags & MP_DSS_a) ? 8 : 4;
+                if (opt_len < need)
+                        return;
+                opt += need;
+                opt_len -= need;
+        }
+        need = (mdss_flags & MP_DSS_m) ? 8 : 4;
+        if (opt_len < need + 4 + 2)
+                return;
+        dsn = need == 8 ? EXTRACT_BE_U_8(opt) : EXTRACT_BE_U_4(opt);
+        mp_map(sf, side, dsn, need == 8, EXTRACT_BE_U_2(opt + need + 4),
+               (mdss_flags & MP_DSS_F) != 0);
+}
+
+/*
+ * Follow a TCP segment for --mptcp-connections; bp is its header,
+ * hlen bytes long with the options, and src and dst are its addresses,
+ * alen bytes long.  Nothing is printed.
+ */
+void
+mptcp_track(netdissect_options *ndo, const u_char *src, const u_char *dst,
+            u_int alen, const u_char *bp, u_int hlen)
+{
+        const struct tcphdr *tp = (const struct tcphdr *)bp;
+        struct mp_subflow *sf;
+        struct mp_conn *c;
+        const u_char *cp, *ep;
+        uint16_t sport, dport;
+        uint64_t now;
+        u_int dir = 0, side, kind, len, subtype;
+        u_char flags;
+
+        if (hlen <= sizeof(*tp) || ND_BYTES_AVAILABLE_AFTER(bp) < sizeof(*tp))
+                return;
+        sport = EXTRACT_BE_U_2(tp->th_sport);
+        dport = EXTRACT_BE_U_2(tp->th_dport);
+        flags = EXTRACT_U_1(tp->th_flags);
+        sf = mp_subflow_find(src, dst, alen, sport, dport, &dir);
+
+        /* Only the options that were captured. */
+        cp = bp + sizeof(*tp);
+        ep = bp + min(hlen, ND_BYTES_AVAILABLE_AFTER(bp));
+        while (cp < ep) {
+                kind = EXTRACT_U_1(cp);
+                if (kind == TCPOPT_EOL)
+                        break;
+                if (kind == TCPOPT_NOP) {
+                        cp++;
+                        continue;
+                }
+                if (ep - cp < 2)
+                        break;
+                len = EXTRACT_U_1(cp + 1);
+                if (len < 2 || len > (u_int)(ep - cp))
+                        break;
+                if (kind != TCPOPT_MPTCP || len < 3) {
+                        cp += len;
+                        continue;
+                }
+                subtype = EXTRACT_U_1(cp + 2) >> 4;
+                switch (subtype) {
+
+                case MPTCP_SUB_CAPABLE:
+                        /*
+                         * A SYN starts a connection, unless it's sent
+                         * again; so does a SYN-ACK or ACK on a subflow
+                         * that's new to us, from the side that sends it.
+                         */
+                        if (sf == NULL ||
+                            ((flags & (TH_SYN|TH_ACK)) == TH_SYN &&
+                             sf->conn->open)) {
+                                if ((c = mp_conn_new(ndo)) == NULL)
+                                        break;
+                                side = (flags & (TH_SYN|TH_ACK)) ==
+                                    (TH_SYN|TH_ACK);
+                                sf = mp_subflow_new(ndo, c, side, 0, src,
+                                    dst, alen, sport, dport);
+                                dir = 0;
+                                if (sf == NULL)
+                                        break;
+                        }
+                        if (sf->stats.mss_join)
+                                break;
+                        side = sf->side ^ dir;
+                        if (len == 12 || len >= 20)
+                                mp_key_set(ndo, sf->conn, side, cp + 4);
+                        if (len >= 20)
+                                mp_key_set(ndo, sf->conn, side ^ 1, cp + 12);
+                        break;
+
+                case MPTCP_SUB_JOIN:
+                        /*
+                         * The SYN carries the token of the side it goes
+                         * to; one that no connection owns gets a
+                         * connection of its own.
+                         */
+                        if ((flags & (TH_SYN|TH_ACK)) != TH_SYN || len != 12)
+                                break;
+                        c = mp_token_find(EXTRACT_BE_U_4(cp + 4), &side);
+                        if (c == NULL) {
+                                if ((c = mp_conn_new(ndo)) == NULL)
+                                        break;
+                                side = 1;
+                                mp_token_set(ndo, c, side,
+                                    EXTRACT_BE_U_4(cp + 4));
+                        }
+                        if (sf != NULL && sf->conn == c)
+                                break;
+                        sf = mp_subflow_new(ndo, c, side ^ 1, 1, src, dst,
+                            alen, sport, dport);
+                        dir = 0;
+                        break;
+
+                case MPTCP_SUB_DSS:
+                        if (sf != NULL && !(flags & TH_SYN))
+                                mp_dss_track(sf, sf->side ^ dir, cp, len);
+                        break;
+
+                case MPTCP_SUB_FCLOSE:
+                        if (sf != NULL)
+                                sf->conn->stats.mcs_fast_close = 1;
+                        break;
+                }
+                cp += len;
+        }
+        if (sf == NULL)
+                return;
+
+        c = sf->conn;
+        now = (uint64_t)ND_TS_USEC(ndo->ndo_packet_ts);
+        if (c->stats.mcs_packets++ == 0)
+                c->stats.mcs_first_us = now;
+        c->stats.mcs_last_us = now;
+        if (!(flags & TH_SYN))
+                c->open = 1;
+        sf->stats.mss_packets++;
+}
+
+void
+mptcp_conn_foreach(mptcp_conn_fn cfn, mptcp_subflow_fn sfn, void *arg)
+{
+        const struct mp_subflow *sf;
+        u_int i;
+
+        for (i = 0; i < mp_nconns; i++) {
+                (*cfn)(arg, &mp_conns[i]->stats);
+                for (sf = mp_conns[i]->subflows; sf != NULL;
+                     sf = sf->conn_next)
+                        (*sfn)(arg, &sf->stats);
+        }
+}
+
 int
 mptcp_print(netdissect_options *ndo,
             const u_char *cp, u_int len, u_char flags)
@@ -34,6 +34,7 @@
 #include "netdissect-stdinc.h"
 
 #include "netdissect.h"
+#include "netdissect-fields.h"
 #include "extract.h"
 
 #ifdef DLT_NFLOG
@@ -128,6 +129,63 @@ nflog_hdr_print(netdissect_options *ndo, const nflog_hdr_t *hdr, u_int length)
 	ND_PRINT(", length %u: ", length);
 }
 
+/*
+ * Report the metadata in a TLV, whose value, of "len" bytes, is at "v",
+ * as fields.
+ */
+static void
+nflog_tlv_fields(netdissect_options *ndo, u_int type, const u_char *v,
+		 u_int len)
+{
+	u_int field;
+
+	switch (type) {
+
+	case NFULA_PACKET_HDR:
+		if (len >= sizeof(nflog_packet_hdr_t))
+			ND_FIELD_UINT(NDF_NFLOG, NDF_NFLOG_HOOK,
+			    GET_U_1(((const nflog_packet_hdr_t *)v)->hook));
+		return;
+
+	case NFULA_PREFIX:
+		ND_FIELD_NSTRING(NDF_NFLOG, NDF_NFLOG_PREFIX, v, len);
+		return;
+
+	case NFULA_MARK:
+		field = NDF_NFLOG_MARK;
+		break;
+
+	case NFULA_IFINDEX_INDEV:
+		field = NDF_NFLOG_INDEV;
+		break;
+
+	case NFULA_IFINDEX_OUTDEV:
+		field = NDF_NFLOG_OUTDEV;
+		break;
+
+	case NFULA_IFINDEX_PHYSINDEV:
+		field = NDF_NFLOG_PHYSINDEV;
+		break;
+
+	case NFULA_IFINDEX_PHYSOUTDEV:
+		field = NDF_NFLOG_PHYSOUTDEV;
+		break;
+
+	case NFULA_UID:
+		field = NDF_NFLOG_UID;
+		break;
+
+	case NFULA_GID:
+		field = NDF_NFLOG_GID;
+		break;
+
+	default:
+		return;
+	}
+	if (len >= 4)
+		ND_FIELD_UINT(NDF_NFLOG, field, GET_BE_U_4(v));
+}
+
 u_int
 nflog_if_print(netdissect_options *ndo,
 			   const struct pcap_pkthdr *h, const u_char *p)
@@ -150,6 +208,9 @@ nflog_if_print(netdissect_options *ndo,
 
 	if (ndo->ndo_eflag)
 		nflog_hdr_print(ndo, hdr, length);
+	ND_FIELD_UINT(NDF_NFLOG, NDF_NFLOG_FAMILY,
+	    GET_U_1(hdr->nflog_family));
+	ND_FIELD_UINT(NDF_NFLOG, NDF_NFLOG_RID, GET_BE_U_2(hdr->nflog_rid));
 
 	p += sizeof(nflog_hdr_t);
 	length -= sizeof(nflog_hdr_t);
@@ -176,6 +237,12 @@ nflog_if_print(netdissect_options *ndo,
 		if (caplen < size)
 			goto trunc;	/* No. */
 
+		if (ndo->ndo_field != NULL &&
+		    GET_HE_U_2(tlv->tlv_length) > sizeof(nflog_tlv_t))
+			nflog_tlv_fields(ndo, GET_HE_U_2(tlv->tlv_type),
+			    p + sizeof(nflog_tlv_t),
+			    GET_HE_U_2(tlv->tlv_length) - sizeof(nflog_tlv_t));
+
 		if (GET_HE_U_2(tlv->tlv_type) == NFULA_PAYLOAD) {
 			/*
 			 * This TLV's data is the packet payload.
@@ -27,6 +27,7 @@
 
 #include "netdissect-stdinc.h"
 
+#include <stddef.h>
 #include <stdio.h>
 #include <string.h>
 #include <limits.h>
@@ -35,6 +36,8 @@
 #include "addrtoname.h"
 #include "extract.h"
 
+#include "callcache.h"
+#include "latency.h"
 #include "nfs.h"
 #include "nfsfh.h"
 
@@ -44,10 +47,15 @@
 #include "rpc_msg.h"
 
 
+struct xid_map_entry;
+
 static void nfs_printfh(netdissect_options *, const uint32_t *, const u_int);
-static int xid_map_enter(netdissect_options *, const struct sunrpc_msg *, const u_char *);
-static int xid_map_find(netdissect_options *, const struct sunrpc_msg *, const u_char *, uint32_t *, uint32_t *);
+static int xid_map_enter(netdissect_options *, const struct sunrpc_msg *, const u_char *, struct xid_map_entry **);
+static int xid_map_find(netdissect_options *, const struct sunrpc_msg *, const u_char *, uint32_t *, uint32_t *, struct xid_map_entry **);
 static void interp_reply(netdissect_options *, const struct sunrpc_msg *, uint32_t, uint32_t, int);
+static void nfs4_call_print(netdissect_options *, const struct sunrpc_msg *, u_int, const struct xid_map_entry *);
+static void nfs4_reply_print(netdissect_options *, const struct sunrpc_msg *, uint32_t, u_int, const struct xid_map_entry *);
+static void nfs4_latency(netdissect_options *, const struct xid_map_entry *, char *, size_t);
 static const uint32_t *parse_post_op_attr(netdissect_options *, const uint32_t *, int);
 
 /*
@@ -379,6 +387,7 @@ nfsreply_noaddr_print(netdissect_options *ndo,
                       const u_char *bp2)
 {
 	const struct sunrpc_msg *rp;
+	struct xid_map_entry *xmep;
 	uint32_t proc, vers, reply_stat;
 	enum sunrpc_reject_stat rstat;
 	uint32_t rlow;
@@ -394,8 +403,12 @@ nfsreply_noaddr_print(netdissect_options *ndo,
 
 	case SUNRPC_MSG_ACCEPTED:
 		ND_PRINT("reply ok %u", length);
-		if (xid_map_find(ndo, rp, bp2, &proc, &vers) >= 0)
-			interp_reply(ndo, rp, proc, vers, length);
+		if (xid_map_find(ndo, rp, bp2, &proc, &vers, &xmep) >= 0) {
+			if (vers == NFS_VER4)
+				nfs4_reply_print(ndo, rp, proc, length, xmep);
+			else
+				interp_reply(ndo, rp, proc, vers, length);
+		}
 		break;
 
 	case SUNRPC_MSG_DENIED:
@@ -581,6 +594,7 @@ nfsreq_noaddr_print(netdissect_options *ndo,
 {
 	const struct sunrpc_msg *rp;
 	const uint32_t *dp;
+	struct xid_map_entry *xmep;
 	nfs_type type;
 	int v3;
 	uint32_t proc;
@@ -591,9 +605,15 @@ nfsreq_noaddr_print(netdissect_options *ndo,
 	ND_PRINT("%u", length);
 	rp = (const struct sunrpc_msg *)bp;
 
-	if (!xid_map_enter(ndo, rp, bp2))	/* record proc number for later on */
+	/* record proc number for later on */
+	if (!xid_map_enter(ndo, rp, bp2, &xmep))
 		goto trunc;
 
+	if (GET_BE_U_4(&rp->rm_call.cb_vers) == NFS_VER4) {
+		nfs4_call_print(ndo, rp, length, xmep);
+		return;
+	}
+
 	v3 = (GET_BE_U_4(&rp->rm_call.cb_vers) == NFS_VER3);
 	proc = GET_BE_U_4(&rp->rm_call.cb_proc);
 
@@ -948,41 +968,73 @@ nfs_printfh(netdissect_options *ndo,
 }
 
 /*
- * Maintain a small cache of recent client.XID.server/proc pairs, to allow
+ * Maintain a cache of recent client.XID.server/proc pairs, to allow
  * us to match up replies with requests and thus to know how to parse
- * the reply.
+ * the reply; see callcache.h.
  */
 
-struct xid_map_entry {
+struct xid_map_key {
 	uint32_t	xid;		/* transaction ID (net order) */
-	int ipver;			/* IP version (4 or 6) */
+	uint32_t	ipver;		/* IP version (4 or 6) */
 	nd_ipv6	client;			/* client IP address (net order) */
 	nd_ipv6	server;			/* server IP address (net order) */
+};
+
+struct xid_map_entry {
+	struct callcache_entry ce;
+	struct xid_map_key key;
 	uint32_t	proc;		/* call proc number (host order) */
 	uint32_t	vers;		/* program version (host order) */
+	int		answered;	/* a reply has been seen */
+};
+
+#define NFS4_OPS_KEPT	16	/* of a COMPOUND, for its reply */
+
+/*
+ * The operations of an NFSv4 COMPOUND call, in a cache of their own
+ * with the call's key, so that the entries for the other versions
+ * don't have room for them.
+ */
+struct nfs4_ops_entry {
+	struct callcache_entry ce;
+	struct xid_map_key key;
+	u_int		nops;		/* operations in ops */
+	uint8_t		ops[NFS4_OPS_KEPT];
 };
 
 /*
- * Map entries are kept in an array that we manage as a ring;
- * new entries are always added at the tail of the ring.  Initially,
- * all the entries are zero and hence don't match anything.
+ * A call more than XID_MAP_TIMEOUT seconds older than a reply isn't
+ * taken to be what it answers.
  */
+#define	XID_MAP_TIMEOUT		120
 
-#define	XIDMAPSIZE	64
+static const struct callcache_type xid_map_type = {
+	sizeof(struct xid_map_entry),
+	offsetof(struct xid_map_entry, key),
+	sizeof(struct xid_map_key),
+	XID_MAP_TIMEOUT
+};
 
-static struct xid_map_entry xid_map[XIDMAPSIZE];
+static const struct callcache_type nfs4_ops_type = {
+	sizeof(struct nfs4_ops_entry),
+	offsetof(struct nfs4_ops_entry, key),
+	sizeof(struct xid_map_key),
+	XID_MAP_TIMEOUT
+};
 
-static int xid_map_next = 0;
-static int xid_map_hint = 0;
+static ND_THREAD_LOCAL uint64_t nfs_unmatched;
 
 static int
 xid_map_enter(netdissect_options *ndo,
-              const struct sunrpc_msg *rp, const u_char *bp)
+              const struct sunrpc_msg *rp, const u_char *bp,
+              struct xid_map_entry **xmepp)
 {
 	const struct ip *ip = NULL;
 	const struct ip6_hdr *ip6 = NULL;
+	struct xid_map_key key;
 	struct xid_map_entry *xmep;
 
+	*xmepp = NULL;
 	if (!ND_TTEST_4(rp->rm_call.cb_proc))
 		return (0);
 	switch (IP_V((const struct ip *)bp)) {
@@ -996,89 +1048,113 @@ xid_map_enter(netdissect_options *ndo,
 		return (1);
 	}
 
-	xmep = &xid_map[xid_map_next];
-
-	if (++xid_map_next >= XIDMAPSIZE)
-		xid_map_next = 0;
-
-	UNALIGNED_MEMCPY(&xmep->xid, &rp->rm_xid, sizeof(xmep->xid));
+	memset(&key, 0, sizeof(key));
+	UNALIGNED_MEMCPY(&key.xid, &rp->rm_xid, sizeof(key.xid));
 	if (ip) {
-		xmep->ipver = 4;
-		UNALIGNED_MEMCPY(&xmep->client, ip->ip_src,
+		key.ipver = 4;
+		UNALIGNED_MEMCPY(&key.client, ip->ip_src,
 				 sizeof(ip->ip_src));
-		UNALIGNED_MEMCPY(&xmep->server, ip->ip_dst,
+		UNALIGNED_MEMCPY(&key.server, ip->ip_dst,
 				 sizeof(ip->ip_dst));
 	}
 	else if (ip6) {
-		xmep->ipver = 6;
-		UNALIGNED_MEMCPY(&xmep->client, ip6->ip6_src,
+		key.ipver = 6;
+		UNALIGNED_MEMCPY(&key.client, ip6->ip6_src,
 				 sizeof(ip6->ip6_src));
-		UNALIGNED_MEMCPY(&xmep->server, ip6->ip6_dst,
+		UNALIGNED_MEMCPY(&key.server, ip6->ip6_dst,
 				 sizeof(ip6->ip6_dst));
 	}
+	xmep = (struct xid_map_entry *)callcache_enter(ndo, &xid_map_type,
+	    &key);
+	if (xmep == NULL)
+		return (1);
 	xmep->proc = GET_BE_U_4(&rp->rm_call.cb_proc);
 	xmep->vers = GET_BE_U_4(&rp->rm_call.cb_vers);
+	*xmepp = xmep;
 	return (1);
 }
 
 /*
- * Returns 0 and puts NFSPROC_xxx in proc return and
- * version in vers return, or returns -1 on failure
+ * Count the time from the call "xmep" to its first reply (see latency.h).
+ */
+static void
+xid_map_latency(netdissect_options *ndo, struct xid_map_entry *xmep)
+{
+	uint32_t proc = xmep->proc;
+	char what[LATENCY_WHAT_LEN];
+
+	if (xmep->answered)
+		return;
+	xmep->answered = 1;
+	if (xmep->vers == NFS_VER4) {
+		nfs4_latency(ndo, xmep, what, sizeof(what));
+		latency_record(ndo, "nfs", what, xmep->ce.cce_ts);
+		return;
+	}
+	if (xmep->vers == NFS_VER2 && proc < NFS_NPROCS)
+		proc = nfsv3_procid[proc];
+	else if (xmep->vers != NFS_VER3)
+		return;
+	if (proc >= NFSPROC_NOOP)
+		return;
+	snprintf(what, sizeof(what), "v%u %s", xmep->vers,
+	    tok2str(nfsproc_str, "proc-%u", proc));
+	latency_record(ndo, "nfs", what, xmep->ce.cce_ts);
+}
+
+/*
+ * Returns 0 and puts NFSPROC_xxx in proc return, version in vers
+ * return and the call's entry in xmepp return, or returns -1 on failure
  */
 static int
 xid_map_find(netdissect_options *ndo, const struct sunrpc_msg *rp,
-	     const u_char *bp, uint32_t *proc, uint32_t *vers)
+	     const u_char *bp, uint32_t *proc, uint32_t *vers,
+	     struct xid_map_entry **xmepp)
 {
-	int i;
 	struct xid_map_entry *xmep;
-	uint32_t xid;
+	struct xid_map_key key;
 	const struct ip *ip = (const struct ip *)bp;
 	const struct ip6_hdr *ip6 = (const struct ip6_hdr *)bp;
-	int cmp;
-
-	UNALIGNED_MEMCPY(&xid, &rp->rm_xid, sizeof(xmep->xid));
-	/* Start searching from where we last left off */
-	i = xid_map_hint;
-	do {
-		xmep = &xid_map[i];
-		cmp = 1;
-		if (xmep->ipver != IP_V(ip) || xmep->xid != xid)
-			goto nextitem;
-		switch (xmep->ipver) {
-		case 4:
-			if (UNALIGNED_MEMCMP(ip->ip_src, &xmep->server,
-					     sizeof(ip->ip_src)) != 0 ||
-			    UNALIGNED_MEMCMP(ip->ip_dst, &xmep->client,
-					     sizeof(ip->ip_dst)) != 0) {
-				cmp = 0;
-			}
-			break;
-		case 6:
-			if (UNALIGNED_MEMCMP(ip6->ip6_src, &xmep->server,
-					     sizeof(ip6->ip6_src)) != 0 ||
-			    UNALIGNED_MEMCMP(ip6->ip6_dst, &xmep->client,
-					     sizeof(ip6->ip6_dst)) != 0) {
-				cmp = 0;
-			}
-			break;
-		default:
-			cmp = 0;
-			break;
-		}
-		if (cmp) {
-			/* match */
-			xid_map_hint = i;
-			*proc = xmep->proc;
-			*vers = xmep->vers;
-			return 0;
-		}
-	nextitem:
-		if (++i >= XIDMAPSIZE)
-			i = 0;
-	} while (i != xid_map_hint);
 
-	/* search failed */
-	return (-1);
+	memset(&key, 0, sizeof(key));
+	UNALIGNED_MEMCPY(&key.xid, &rp->rm_xid, sizeof(key.xid));
+	key.ipver = IP_V(ip);
+	switch (key.ipver) {
+	case 4:
+		UNALIGNED_MEMCPY(&key.server, ip->ip_src, sizeof(ip->ip_src));
+		UNALIGNED_MEMCPY(&key.client, ip->ip_dst, sizeof(ip->ip_dst));
+		break;
+	case 6:
+		UNALIGNED_MEMCPY(&key.server, ip6->ip6_src,
+				 sizeof(ip6->ip6_src));
+		UNALIGNED_MEMCPY(&key.client, ip6->ip6_dst,
+				 sizeof(ip6->ip6_dst));
+		break;
+	default:
+		nfs_unmatched++;
+		return (-1);
+	}
+	xmep = (struct xid_map_entry *)callcache_find(ndo, &xid_map_type, &key);
+	if (xmep == NULL) {
+		/* search failed */
+		nfs_unmatched++;
+		return (-1);
+	}
+	/* match */
+	xid_map_latency(ndo, xmep);
+	*proc = xmep->proc;
+	*vers = xmep->vers;
+	*xmepp = xmep;
+	return 0;
+}
+
+/*
+ * Return how many replies this thread hasn't found the call for.
+ */
+uint64_t
+nfs_unmatched_replies(void)
+{
+	return (nfs_unmatched);
 }
 
 /*
@@ -1913,3 +1989,456 @@ trunc:
 	if (!nfserr)
 		nd_print_trunc(ndo);
 }
+
+/*
+ * NFSv4 (RFC 7530, RFC 8881 and RFC 7862).  Apart from the null
+ * procedure, a call is a COMPOUND of operations, each a number followed
+ * by its arguments; the arguments of those in nfs4_ops with a spec are
+ * skipped over to find the next one, and the list printed stops at the
+ * first without one, such as OPEN, which takes too much walking to be
+ * worth it here.  The operations found are kept with the call, so that
+ * a reply that failed can be put down to the operation that failed,
+ * which is the last one it has a result for.
+ *
+ * A spec is a letter for each argument:
+ *	'4', '8'	that many bytes
+ *	's'		a stateid or a sessionid
+ *	'o'		a counted opaque, such as a file handle or a name
+ *	'b'		a bitmap4
+ *	'a'		a fattr4, a bitmap4 and an opaque of values
+ *	'l'		a state owner, a clientid and an opaque
+ */
+#define NFS4PROC_COMPOUND	1
+#define NFS4_STATEID_LEN	16
+#define NFS4_NOPS		72
+
+struct nfs4_op {
+	const char *name;
+	const char *args;		/* NULL if they're not skipped */
+};
+
+static const struct nfs4_op nfs4_ops[NFS4_NOPS] = {
+	[0]  = { "ILLEGAL",		NULL },
+	[3]  = { "ACCESS",		"4" },
+	[4]  = { "CLOSE",		"4s" },
+	[5]  = { "COMMIT",		"84" },
+	[6]  = { "CREATE",		NULL },
+	[7]  = { "DELEGPURGE",		"8" },
+	[8]  = { "DELEGRETURN",		"s" },
+	[9]  = { "GETATTR",		"b" },
+	[10] = { "GETFH",		"" },
+	[11] = { "LINK",		"o" },
+	[12] = { "LOCK",		NULL },
+	[13] = { "LOCKT",		"488l" },
+	[14] = { "LOCKU",		"44s88" },
+	[15] = { "LOOKUP",		"o" },
+	[16] = { "LOOKUPP",		"" },
+	[17] = { "NVERIFY",		"a" },
+	[18] = { "OPEN",		NULL },
+	[19] = { "OPENATTR",		"4" },
+	[20] = { "OPEN_CONFIRM",	"s4" },
+	[21] = { "OPEN_DOWNGRADE",	"s444" },
+	[22] = { "PUTFH",		"o" },
+	[23] = { "PUTPUBFH",		"" },
+	[24] = { "PUTROOTFH",		"" },
+	[25] = { "READ",		"s84" },
+	[26] = { "READDIR",		"8844b" },
+	[27] = { "READLINK",		"" },
+	[28] = { "REMOVE",		"o" },
+	[29] = { "RENAME",		"oo" },
+	[30] = { "RENEW",		"8" },
+	[31] = { "RESTOREFH",		"" },
+	[32] = { "SAVEFH",		"" },
+	[33] = { "SECINFO",		"o" },
+	[34] = { "SETATTR",		"sa" },
+	[35] = { "SETCLIENTID",		NULL },
+	[36] = { "SETCLIENTID_CONFIRM",	"88" },
+	[37] = { "VERIFY",		"a" },
+	[38] = { "WRITE",		"s84o" },
+	[39] = { "RELEASE_LOCKOWNER",	"l" },
+	[40] = { "BACKCHANNEL_CTL",	NULL },
+	[41] = { "BIND_CONN_TO_SESSION", "s44" },
+	[42] = { "EXCHANGE_ID",		NULL },
+	[43] = { "CREATE_SESSION",	NULL },
+	[44] = { "DESTROY_SESSION",	"s" },
+	[45] = { "FREE_STATEID",	"s" },
+	[46] = { "GET_DIR_DELEGATION",	NULL },
+	[47] = { "GETDEVICEINFO",	NULL },
+	[48] = { "GETDEVICELIST",	NULL },
+	[49] = { "LAYOUTCOMMIT",	NULL },
+	[50] = { "LAYOUTGET",		NULL },
+	[51] = { "LAYOUTRETURN",	NULL },
+	[52] = { "SECINFO_NO_NAME",	"4" },
+	[53] = { "SEQUENCE",		"s4444" },
+	[54] = { "SET_SSV",		NULL },
+	[55] = { "TEST_STATEID",	NULL },
+	[56] = { "WANT_DELEGATION",	NULL },
+	[57] = { "DESTROY_CLIENTID",	"8" },
+	[58] = { "RECLAIM_COMPLETE",	"4" },
+	[59] = { "ALLOCATE",		"s88" },
+	[60] = { "COPY",		NULL },
+	[61] = { "COPY_NOTIFY",		NULL },
+	[62] = { "DEALLOCATE",		"s88" },
+	[63] = { "IO_ADVISE",		NULL },
+	[64] = { "LAYOUTERROR",		NULL },
+	[65] = { "LAYOUTSTATS",		NULL },
+	[66] = { "OFFLOAD_CANCEL",	"s" },
+	[67] = { "OFFLOAD_STATUS",	"s" },
+	[68] = { "READ_PLUS",		"s84" },
+	[69] = { "SEEK",		"s84" },
+	[70] = { "WRITE_SAME",		NULL },
+	[71] = { "CLONE",		"ss888" },
+};
+
+/* The NFSv4 errors that aren't in status2str. */
+static const struct tok nfs4_status2str[] = {
+	{ 10009, "SAME" },
+	{ 10010, "DENIED" },
+	{ 10011, "EXPIRED" },
+	{ 10012, "LOCKED" },
+	{ 10013, "GRACE" },
+	{ 10014, "FHEXPIRED" },
+	{ 10015, "SHARE_DENIED" },
+	{ 10016, "WRONGSEC" },
+	{ 10017, "CLID_INUSE" },
+	{ 10018, "RESOURCE" },
+	{ 10019, "MOVED" },
+	{ 10020, "NOFILEHANDLE" },
+	{ 10021, "MINOR_VERS_MISMATCH" },
+	{ 10022, "STALE_CLIENTID" },
+	{ 10023, "STALE_STATEID" },
+	{ 10024, "OLD_STATEID" },
+	{ 10025, "BAD_STATEID" },
+	{ 10026, "BAD_SEQID" },
+	{ 10027, "NOT_SAME" },
+	{ 10028, "LOCK_RANGE" },
+	{ 10029, "SYMLINK" },
+	{ 10030, "RESTOREFH" },
+	{ 10031, "LEASE_MOVED" },
+	{ 10032, "ATTRNOTSUPP" },
+	{ 10033, "NO_GRACE" },
+	{ 10034, "RECLAIM_BAD" },
+	{ 10035, "RECLAIM_CONFLICT" },
+	{ 10036, "BADXDR" },
+	{ 10037, "LOCKS_HELD" },
+	{ 10038, "OPENMODE" },
+	{ 10039, "BADOWNER" },
+	{ 10040, "BADCHAR" },
+	{ 10041, "BADNAME" },
+	{ 10042, "BAD_RANGE" },
+	{ 10043, "LOCK_NOTSUPP" },
+	{ 10044, "OP_ILLEGAL" },
+	{ 10045, "DEADLOCK" },
+	{ 10046, "FILE_OPEN" },
+	{ 10047, "ADMIN_REVOKED" },
+	{ 10048, "CB_PATH_DOWN" },
+	{ 10052, "BADSESSION" },
+	{ 10053, "BADSLOT" },
+	{ 10054, "COMPLETE_ALREADY" },
+	{ 10055, "CONN_NOT_BOUND_TO_SESSION" },
+	{ 10058, "LAYOUTTRYLATER" },
+	{ 10059, "LAYOUTUNAVAILABLE" },
+	{ 10063, "SEQ_MISORDERED" },
+	{ 10065, "REQ_TOO_BIG" },
+	{ 10066, "REP_TOO_BIG" },
+	{ 10068, "RETRY_UNCACHED_REP" },
+	{ 10070, "TOO_MANY_OPS" },
+	{ 10071, "OP_NOT_IN_SESSION" },
+	{ 10077, "BAD_HIGH_SLOT" },
+	{ 10078, "DEADSESSION" },
+	{ 10087, "DELEG_REVOKED" },
+	{ 0,     NULL }
+};
+
+static ND_THREAD_LOCAL uint64_t nfs4_op_calls[NFS4_NOPS];
+static ND_THREAD_LOCAL uint64_t nfs4_op_errors[NFS4_NOPS];
+
+/* Operations not in nfs4_ops count as ILLEGAL, which is what they get. */
+static u_int
+nfs4_op_index(uint32_t op)
+{
+	if (op >= NFS4_NOPS || nfs4_ops[op].name == NULL)
+		return (0);
+	return (op);
+}
+
+/*
+ * Skip the arguments that "spec" describes, at "cp", with "*leftp"
+ * bytes of the call, all of them captured, left; return where the next
+ * operation starts, or NULL if they don't fit.
+ */
+static const u_char *
+nfs4_skip_args(netdissect_options *ndo, const u_char *cp, u_int *leftp,
+	       const char *spec)
+{
+	u_int left = *leftp;
+	u_int n, count;
+
+	for (; *spec != '\0'; spec++) {
+		switch (*spec) {
+
+		case '4':
+			n = 4;
+			break;
+
+		case '8':
+			n = 8;
+			break;
+
+		case 's':
+			n = NFS4_STATEID_LEN;
+			break;
+
+		case 'l':
+			if (left < 8)
+				return (NULL);
+			cp += 8;
+			left -= 8;
+			/* FALLTHROUGH */
+		case 'o':
+			if (left < 4)
+				return (NULL);
+			count = GET_BE_U_4(cp);
+			if (count > left - 4)
+				return (NULL);
+			n = 4 + roundup2(count, 4);
+			break;
+
+		case 'a':
+		case 'b':
+			if (left < 4)
+				return (NULL);
+			count = GET_BE_U_4(cp);
+			if (count > (left - 4) / 4)
+				return (NULL);
+			n = 4 + count * 4;
+			if (*spec == 'a') {
+				if (left - n < 4)
+					return (NULL);
+				count = GET_BE_U_4(cp + n);
+				if (count > left - n - 4)
+					return (NULL);
+				n += 4 + roundup2(count, 4);
+			}
+			break;
+
+		default:
+			return (NULL);
+		}
+		if (n > left)
+			return (NULL);
+		cp += n;
+		left -= n;
+	}
+	*leftp = left;
+	return (cp);
+}
+
+/*
+ * How many bytes of the "length" bytes of RPC message from "rp" are
+ * left, and captured, from "cp" on.
+ */
+static u_int
+nfs4_left(netdissect_options *ndo, const struct sunrpc_msg *rp,
+	  u_int length, const u_char *cp)
+{
+	u_int off = (u_int)(cp - (const u_char *)rp);
+	u_int left;
+
+	if (cp >= ndo->ndo_snapend || off >= length)
+		return (0);
+	left = length - off;
+	if (left > ND_BYTES_AVAILABLE_AFTER(cp))
+		left = ND_BYTES_AVAILABLE_AFTER(cp);
+	return (left);
+}
+
+static void
+nfs4_call_print(netdissect_options *ndo, const struct sunrpc_msg *rp,
+		u_int length, const struct xid_map_entry *xmep)
+{
+	struct nfs4_ops_entry *opse = NULL;
+	const u_char *cp, *tag;
+	uint32_t proc, minor, nops, op, taglen;
+	u_int left, i, idx;
+	const char *spec;
+
+	proc = GET_BE_U_4(&rp->rm_call.cb_proc);
+	if (proc != NFS4PROC_COMPOUND) {
+		if (proc == NFSPROC_NULL)
+			ND_PRINT(" v4 null");
+		else
+			ND_PRINT(" v4 proc-%u", proc);
+		return;
+	}
+	cp = (const u_char *)parsereq(ndo, rp, length);
+	if (cp == NULL)
+		goto trunc;
+	left = nfs4_left(ndo, rp, length, cp);
+	if (left < 4)
+		goto trunc;
+	taglen = GET_BE_U_4(cp);
+	if (taglen > left - 4 || left - 4 - roundup2(taglen, 4) < 8)
+		goto trunc;
+	tag = cp + 4;
+	cp += 4 + roundup2(taglen, 4);
+	left -= 4 + roundup2(taglen, 4);
+	minor = GET_BE_U_4(cp);
+	nops = GET_BE_U_4(cp + 4);
+	cp += 8;
+	left -= 8;
+
+	ND_PRINT(" v4.%u COMPOUND", minor);
+	if (xmep != NULL)
+		opse = (struct nfs4_ops_entry *)callcache_enter(ndo,
+		    &nfs4_ops_type, &xmep->key);
+	for (i = 0; i < nops; i++) {
+		if (left < 4) {
+			ND_PRINT(",...");
+			break;
+		}
+		op = GET_BE_U_4(cp);
+		cp += 4;
+		left -= 4;
+		idx = nfs4_op_index(op);
+		if (idx == 0 && op != 0)
+			ND_PRINT("%sop-%u", i == 0 ? " " : ",", op);
+		else
+			ND_PRINT("%s%s", i == 0 ? " " : ",", nfs4_ops[idx].name);
+		nfs4_op_calls[idx]++;
+		if (opse != NULL && opse->nops < NFS4_OPS_KEPT)
+			opse->ops[opse->nops++] = (uint8_t)idx;
+		spec = nfs4_ops[idx].args;
+		if (spec == NULL ||
+		    (cp = nfs4_skip_args(ndo, cp, &left, spec)) == NULL) {
+			if (i + 1 < nops)
+				ND_PRINT(",...");
+			break;
+		}
+	}
+	if (ndo->ndo_vflag && taglen != 0) {
+		ND_PRINT(" tag \"");
+		(void)nd_printn(ndo, tag, taglen, NULL);
+		ND_PRINT("\"");
+	}
+	return;
+
+trunc:
+	nd_print_trunc(ndo);
+}
+
+static void
+nfs4_reply_print(netdissect_options *ndo, const struct sunrpc_msg *rp,
+		 uint32_t proc, u_int length, const struct xid_map_entry *xmep)
+{
+	const struct nfs4_ops_entry *opse;
+	const u_char *cp;
+	uint32_t status, taglen, nres;
+	u_int left, idx, nops;
+	int nfserr = 0;
+
+	if (proc != NFS4PROC_COMPOUND) {
+		if (proc == NFSPROC_NULL)
+			ND_PRINT(" v4 null");
+		else
+			ND_PRINT(" v4 proc-%u", proc);
+		return;
+	}
+	ND_PRINT(" v4 COMPOUND");
+	cp = (const u_char *)parserep(ndo, rp, length, &nfserr);
+	if (cp == NULL) {
+		if (!nfserr)
+			nd_print_trunc(ndo);
+		return;
+	}
+	left = nfs4_left(ndo, rp, length, cp);
+	if (left < 8)
+		goto trunc;
+	status = GET_BE_U_4(cp);
+	taglen = GET_BE_U_4(cp + 4);
+	if (taglen > left - 8 || left - 8 - roundup2(taglen, 4) < 4)
+		goto trunc;
+	nres = GET_BE_U_4(cp + 8 + roundup2(taglen, 4));
+
+	if (status != 0) {
+		/* The last result is for the operation that failed. */
+		opse = (const struct nfs4_ops_entry *)callcache_find(ndo,
+		    &nfs4_ops_type, &xmep->key);
+		nops = opse != NULL ? opse->nops : 0;
+		idx = 0;
+		if (nres != 0 && nres <= nops) {
+			idx = opse->ops[nres - 1];
+			nfs4_op_errors[idx]++;
+		}
+		if (!ndo->ndo_qflag) {
+			ND_PRINT(" ERROR: %s",
+			    status < 10009 ?
+			    tok2str(status2str, "unk %u", status) :
+			    tok2str(nfs4_status2str, "unk %u", status));
+			if (nres != 0 && nres <= nops)
+				ND_PRINT(" in %s", nfs4_ops[idx].name);
+		}
+	}
+	ND_PRINT(" (%u result%s)", nres, PLURAL_SUFFIX(nres));
+	return;
+
+trunc:
+	nd_print_trunc(ndo);
+}
+
+/*
+ * What --latency-report calls the call "xmep": the first operation
+ * that isn't SEQUENCE or one that sets the file handle, which is what
+ * the compound is for, or else its last one.
+ */
+static void
+nfs4_latency(netdissect_options *ndo, const struct xid_map_entry *xmep,
+	     char *what, size_t len)
+{
+	const struct nfs4_ops_entry *opse;
+	u_int i, idx;
+
+	if (xmep->proc == NFSPROC_NULL) {
+		snprintf(what, len, "v4 null");
+		return;
+	}
+	if (xmep->proc != NFS4PROC_COMPOUND) {
+		snprintf(what, len, "v4 proc-%u", xmep->proc);
+		return;
+	}
+	opse = (const struct nfs4_ops_entry *)callcache_find(ndo,
+	    &nfs4_ops_type, &xmep->key);
+	if (opse == NULL || opse->nops == 0) {
+		snprintf(what, len, "v4 COMPOUND");
+		return;
+	}
+	idx = opse->ops[opse->nops - 1];
+	for (i = 0; i < opse->nops; i++) {
+		switch (opse->ops[i]) {
+
+		case 22:	/* PUTFH */
+		case 23:	/* PUTPUBFH */
+		case 24:	/* PUTROOTFH */
+		case 53:	/* SEQUENCE */
+			continue;
+		}
+		idx = opse->ops[i];
+		break;
+	}
+	snprintf(what, len, "v4 %s", nfs4_ops[idx].name);
+}
+
+/*
+ * Call "fn" for each NFSv4 operation this thread has seen in a call,
+ * with how many calls it was in and how many replies failed in it.
+ */
+void
+nfs4_op_foreach(nfs4_op_fn fn, void *arg)
+{
+	u_int i;
+
+	for (i = 0; i < NFS4_NOPS; i++)
+		if (nfs4_op_calls[i] != 0 || nfs4_op_errors[i] != 0)
+			(*fn)(arg, nfs4_ops[i].name, nfs4_op_calls[i],
+			    nfs4_op_errors[i]);
+}
@@ -32,6 +32,7 @@
 #include "netdissect-stdinc.h"
 
 #include "netdissect.h"
+#include "netdissect-fields.h"
 #include "extract.h"
 
 static const struct tok nsh_flags [] = {
@@ -82,6 +83,12 @@ nsh_print(netdissect_options *ndo, const u_char *bp, u_int len)
     service_index = GET_U_1(bp);
     bp += 1;
 
+    ND_FIELD_UINT(NDF_NSH, NDF_NSH_SPI, service_path_id);
+    ND_FIELD_UINT(NDF_NSH, NDF_NSH_SI, service_index);
+    ND_FIELD_UINT(NDF_NSH, NDF_NSH_MD_TYPE, md_type);
+    ND_FIELD_UINT(NDF_NSH, NDF_NSH_NEXT, next_protocol);
+    ND_FIELD_UINT(NDF_NSH, NDF_NSH_FLAGS, flags & 0x30);
+
     ND_PRINT("NSH, ");
     if (ndo->ndo_vflag > 1) {
         ND_PRINT("ver %u, ", ver);
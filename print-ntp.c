@@ -545,7 +545,7 @@ p_ntp_time(netdissect_options *ndo,
 	if (i) {
 	    int64_t seconds_64bit = (int64_t)i - JAN_1970;
 	    time_t seconds;
-	    struct tm *tm;
+	    struct tm tmbuf, *tm;
 	    char time_buf[128];
 
 	    seconds = (time_t)seconds_64bit;
@@ -556,7 +556,7 @@ p_ntp_time(netdissect_options *ndo,
 		 */
 		ND_PRINT(" (unrepresentable)");
 	    } else {
-		tm = gmtime(&seconds);
+		tm = nd_gmtime(&seconds, &tmbuf);
 		if (tm == NULL) {
 		    /*
 		     * gmtime() can't handle it.
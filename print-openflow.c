@@ -38,10 +38,16 @@
 
 #include "netdissect-stdinc.h"
 
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
 #include "netdissect.h"
+#include "addrtostr.h"
 #include "extract.h"
 #include "openflow.h"
 #include "oui.h"
+#include "tcp.h"
 
 
 #define OF_VER_1_0    0x01
@@ -128,13 +134,224 @@ trunc:
 	return ep;
 }
 
+/*
+ * --openflow-summary: count the messages on each switch's connection to
+ * its controller, and how fast flow-mods, packet-ins and packet-outs
+ * come, for openflow_switch_foreach(), without decoding the messages.
+ * With --tcp-reassembly, which --openflow-summary turns on, the messages
+ * are whole however they were segmented.
+ *
+ * These message types are numbered alike in OpenFlow 1.0 to 1.5.
+ */
+#define OF_TYPE_ERROR		0x01
+#define OF_TYPE_FEATURES_REPLY	0x06
+#define OF_TYPE_PACKET_IN	0x0a
+#define OF_TYPE_FLOW_REMOVED	0x0b
+#define OF_TYPE_PORT_STATUS	0x0c
+#define OF_TYPE_PACKET_OUT	0x0d
+#define OF_TYPE_FLOW_MOD	0x0e
+
+#define OF_SWITCH_CHAINS	256
+
+struct of_conn {
+	u_char sw[16];			/* the switch */
+	u_char ctl[16];			/* and its controller */
+	uint16_t sw_port;
+	uint16_t ctl_port;
+	u_int version;			/* 4 or 6 */
+};
+
+struct of_switch {
+	struct openflow_switch_stats stats;
+	struct of_conn conn;
+	char name[INET6_ADDRSTRLEN + 6];
+	struct of_switch *next;		/* on its hash chain */
+};
+
+static ND_THREAD_LOCAL struct of_switch *of_switch_chains[OF_SWITCH_CHAINS];
+static ND_THREAD_LOCAL struct of_switch **of_switches;	/* in order made */
+static ND_THREAD_LOCAL u_int of_nswitches, of_maxswitches;
+
+/*
+ * Return the counters for the connection of the IPv4 or IPv6 packet
+ * whose header is at "iph", between ports "sport" and "dport", and put
+ * whether it's from the switch in "*from", or return NULL if "iph"
+ * isn't one.  The end on an OpenFlow port is the controller.
+ */
+static struct of_switch *
+of_switch_lookup(netdissect_options *ndo, const u_char *iph, u_int sport,
+                 u_int dport, int *from)
+{
+	struct of_switch *os, **osp;
+	struct of_conn c;
+	const u_char *src, *dst;
+	u_int alen, i;
+	uint32_t h = 2166136261U;
+
+	if (iph == NULL)
+		return NULL;
+	memset(&c, 0, sizeof(c));
+	c.version = EXTRACT_U_1(iph) >> 4;
+	if (c.version == 4) {
+		alen = 4;
+		src = iph + 12;
+		dst = iph + 16;
+	} else if (c.version == 6) {
+		alen = 16;
+		src = iph + 8;
+		dst = iph + 24;
+	} else
+		return NULL;
+	if (dport == OPENFLOW_PORT_IANA || dport == OPENFLOW_PORT_OLD)
+		*from = 1;
+	else if (sport == OPENFLOW_PORT_IANA || sport == OPENFLOW_PORT_OLD)
+		*from = 0;
+	else
+		*from = sport > dport;
+	memcpy(c.sw, *from ? src : dst, alen);
+	memcpy(c.ctl, *from ? dst : src, alen);
+	c.sw_port = (uint16_t)(*from ? sport : dport);
+	c.ctl_port = (uint16_t)(*from ? dport : sport);
+	for (i = 0; i < sizeof(c); i++)
+		h = (h ^ ((const u_char *)&c)[i]) * 16777619U;
+	osp = &of_switch_chains[h % OF_SWITCH_CHAINS];
+	for (os = *osp; os != NULL; os = os->next)
+		if (memcmp(&os->conn, &c, sizeof(c)) == 0)
+			return os;
+
+	if (of_nswitches == of_maxswitches) {
+		of_maxswitches = of_maxswitches ? of_maxswitches * 2 : 16;
+		of_switches = (struct of_switch **)realloc(of_switches,
+		    of_maxswitches * sizeof(*of_switches));
+		if (of_switches == NULL)
+			(*ndo->ndo_error)(ndo, S_ERR_ND_MEM_ALLOC,
+			    "%s: realloc", __func__);
+	}
+	os = (struct of_switch *)calloc(1, sizeof(*os));
+	if (os == NULL)
+		(*ndo->ndo_error)(ndo, S_ERR_ND_MEM_ALLOC, "%s: calloc",
+		    __func__);
+	os->conn = c;
+	if (c.version == 4)
+		addrtostr(c.sw, os->name, sizeof(os->name));
+	else
+		addrtostr6(c.sw, os->name, sizeof(os->name));
+	i = (u_int)strlen(os->name);
+	snprintf(os->name + i, sizeof(os->name) - i, ".%u", c.sw_port);
+	os->stats.ofs_switch = os->name;
+	os->next = *osp;
+	*osp = os;
+	of_switches[of_nswitches++] = os;
+	return os;
+}
+
+static void
+of_rate_count(netdissect_options *ndo, struct openflow_rate *r)
+{
+	uint64_t now;
+
+	now = (uint64_t)ND_TS_USEC(ndo->ndo_packet_ts);
+	if (r->or_count++ == 0)
+		r->or_first_us = now;
+	r->or_last_us = now;
+	if (r->or_count == 1 ||
+	    ndo->ndo_packet_sec != (time_t)r->or_second) {
+		r->or_second = ndo->ndo_packet_sec;
+		r->or_in_second = 0;
+	}
+	if (++r->or_in_second > r->or_peak)
+		r->or_peak = r->or_in_second;
+}
+
+/*
+ * Count the messages in the captured part of a TCP segment, presuming it
+ * begins on a message boundary, and print how many there were.
+ */
+static void
+of_summary(netdissect_options *ndo, const u_char *cp, const u_char *iph,
+           u_int sport, u_int dport)
+{
+	struct of_switch *os;
+	struct openflow_switch_stats *st;
+	u_int n = 0, type, length;
+	int from;
+
+	os = of_switch_lookup(ndo, iph, sport, dport, &from);
+	st = os != NULL ? &os->stats : NULL;
+	while (ND_BYTES_AVAILABLE_AFTER(cp) >= OF_HEADER_LEN) {
+		type = GET_U_1(cp + 1);
+		length = GET_BE_U_2(cp + 2);
+		if (length < OF_HEADER_LEN)
+			break;
+		n++;
+		if (st == NULL)
+			;
+		else if (from) {
+			st->ofs_messages_from++;
+			switch (type) {
+			case OF_TYPE_FEATURES_REPLY:
+				if (length >= OF_HEADER_LEN + 8 &&
+				    ND_TTEST_8(cp + OF_HEADER_LEN)) {
+					st->ofs_dpid =
+					    GET_BE_U_8(cp + OF_HEADER_LEN);
+					st->ofs_have_dpid = 1;
+				}
+				break;
+			case OF_TYPE_PACKET_IN:
+				of_rate_count(ndo, &st->ofs_packet_ins);
+				break;
+			case OF_TYPE_FLOW_REMOVED:
+				st->ofs_flow_removed++;
+				break;
+			case OF_TYPE_PORT_STATUS:
+				st->ofs_port_status++;
+				break;
+			}
+		} else {
+			st->ofs_messages_to++;
+			switch (type) {
+			case OF_TYPE_FLOW_MOD:
+				of_rate_count(ndo, &st->ofs_flow_mods);
+				break;
+			case OF_TYPE_PACKET_OUT:
+				of_rate_count(ndo, &st->ofs_packet_outs);
+				break;
+			}
+		}
+		if (st != NULL && type == OF_TYPE_ERROR)
+			st->ofs_errors++;
+		if (ND_BYTES_AVAILABLE_AFTER(cp) <= length)
+			break;
+		cp += length;
+	}
+	ND_PRINT(", %u message%s", n, PLURAL_SUFFIX(n));
+}
+
+/*
+ * Call "fn" for each switch connection of this thread that messages
+ * have been counted on, in the order they were first seen.
+ */
+void
+openflow_switch_foreach(openflow_switch_fn fn, void *arg)
+{
+	u_int i;
+
+	for (i = 0; i < of_nswitches; i++)
+		(*fn)(arg, &of_switches[i]->stats);
+}
+
 /* Print a TCP segment worth of OpenFlow messages presuming the segment begins
  * on a message boundary. */
 void
-openflow_print(netdissect_options *ndo, const u_char *cp, const u_int len _U_)
+openflow_print(netdissect_options *ndo, const u_char *cp, const u_int len _U_,
+               const u_char *iph, u_int sport, u_int dport)
 {
 	ndo->ndo_protocol = "openflow";
 	ND_PRINT(": OpenFlow");
+	if (ndo->ndo_openflow_summary) {
+		of_summary(ndo, cp, iph, sport, dport);
+		return;
+	}
 	while (cp < ndo->ndo_snapend)
 		cp = of_header_body_print(ndo, cp, ndo->ndo_snapend);
 }
@@ -32,7 +32,9 @@
 #include "netdissect.h"
 #include "addrtoname.h"
 #include "extract.h"
+#include "change-only.h"
 #include "gmpls.h"
+#include "lsdb.h"
 
 #include "ospf.h"
 
@@ -609,6 +611,79 @@ trunc:
     return 1;
 }
 
+#define OSPF_MAXAGE	3600	/* age of an LSA being flushed */
+
+/*
+ * Look up the LSA "lsap", with "ls_length" bytes of body, in the LSDB,
+ * and print what it is to the last copy of it.  Return the verdict, or
+ * -1 if the body wasn't all captured, so that the LSA can't be compared.
+ */
+static int
+ospf_lsdb_update(netdissect_options *ndo, const struct lsa *lsap,
+                 u_int ls_length)
+{
+	u_char key[LSDB_KEY_LEN];
+	uint32_t lastseq;
+	int verdict;
+
+	lsdb_begin();
+	if (!lsdb_add_part(ndo, 0, (const u_char *)&lsap->lsa_un, ls_length))
+		return (-1);
+	/* Flushing an LSA changes it, even if nothing else does. */
+	if (GET_BE_U_2(lsap->ls_hdr.ls_age) >= OSPF_MAXAGE)
+		(void)lsdb_add_part(ndo, 1, (const u_char *)&lsap->lsa_un, 0);
+
+	key[0] = GET_U_1(lsap->ls_hdr.ls_type);
+	GET_CPY_BYTES(key + 1, lsap->ls_hdr.un_lsa_id.lsa_id, 4);
+	GET_CPY_BYTES(key + 5, lsap->ls_hdr.ls_router, 4);
+	verdict = lsdb_update(ndo, LSDB_OSPF, key,
+	    GET_BE_U_4(lsap->ls_hdr.ls_seq), &lastseq);
+	switch (verdict) {
+	case LSDB_NEW:
+		ND_PRINT("\n\t    LSDB: new");
+		break;
+	case LSDB_REPEAT:
+		ND_PRINT("\n\t    LSDB: repeat");
+		break;
+	case LSDB_OLDER:
+		ND_PRINT("\n\t    LSDB: older than seq 0x%08x", lastseq);
+		break;
+	case LSDB_REFRESH:
+		ND_PRINT("\n\t    LSDB: refresh of seq 0x%08x", lastseq);
+		break;
+	case LSDB_CHANGE:
+		ND_PRINT("\n\t    LSDB: change from seq 0x%08x", lastseq);
+		break;
+	}
+	return (verdict);
+}
+
+/*
+ * Print the checksum of the LSA "lsap", "ls_length" bytes long with its
+ * header, and whether it's right.  It covers everything but the LS age.
+ */
+static void
+ospf_print_lsa_cksum(netdissect_options *ndo, const struct lsa *lsap,
+                     u_int ls_length)
+{
+	uint16_t checksum, calculated_checksum;
+
+	checksum = GET_BE_U_2(lsap->ls_hdr.ls_chksum);
+	ND_PRINT("\n\t    Checksum 0x%04x", checksum);
+	if (!ND_TTEST_LEN(lsap, ls_length)) {
+		ND_PRINT(" (unverified)");
+		return;
+	}
+	calculated_checksum = create_osi_cksum(
+	    (const uint8_t *)lsap->ls_hdr.ls_options,
+	    (int)(lsap->ls_hdr.ls_chksum - lsap->ls_hdr.ls_options),
+	    (int)(ls_length - sizeof(lsap->ls_hdr.ls_age)));
+	if (checksum == calculated_checksum)
+		ND_PRINT(" (correct)");
+	else
+		ND_PRINT(" (incorrect should be 0x%04x)", calculated_checksum);
+}
+
 /*
  * Print a single link state advertisement.  If truncated or if LSA length
  * field is less than the length of the LSA header, return NULl, else
@@ -632,9 +707,24 @@ ospf_print_lsa(netdissect_options *ndo,
         ls_length = ospf_print_lshdr(ndo, &lsap->ls_hdr);
         if (ls_length == -1)
                 return(NULL);
+	if (ndo->ndo_vflag > 2)
+		ospf_print_lsa_cksum(ndo, lsap, ls_length);
 	ls_end = (const uint8_t *)lsap + ls_length;
 	ls_length -= sizeof(struct lsa_hdr);
 
+	/*
+	 * With --lsdb, print the body of an LSA only if it's new or it
+	 * changed.
+	 */
+	if (ndo->ndo_lsdb) {
+		switch (ospf_lsdb_update(ndo, lsap, ls_length)) {
+		case LSDB_REPEAT:
+		case LSDB_OLDER:
+		case LSDB_REFRESH:
+			return (ls_end);
+		}
+	}
+
 	switch (GET_U_1(lsap->ls_hdr.ls_type)) {
 
 	case LS_TYPE_ROUTER:
@@ -1125,6 +1215,23 @@ ospf_print(netdissect_options *ndo,
 	/* If the type is valid translate it, or just print the type */
 	/* value.  If it's not valid, say so and return */
 	ND_TCHECK_1(op->ospf_type);
+	if (ndo->ndo_changes_only &&
+	    GET_U_1(op->ospf_type) == OSPF_TYPE_HELLO) {
+		uint64_t h;
+
+		/*
+		 * Leave out the checksum and the authentication data, with
+		 * its cryptographic sequence number.
+		 */
+		h = nd_change_hash(ndo, ND_CHANGE_HASH_INIT, bp,
+		    length < 12 ? length : 12);
+		h = nd_change_hash(ndo, h, bp + 14, 2);
+		if (length > 24)
+			h = nd_change_hash(ndo, h, bp + 24, length - 24);
+		if (nd_change_repeat(ndo, ND_CHANGE_OSPF, op->ospf_routerid,
+		    4, h))
+			return;
+	}
 	cp = tok2str(type2str, "unknown LS-type %u", GET_U_1(op->ospf_type));
 	ND_PRINT("OSPFv%u, %s, length %u", GET_U_1(op->ospf_version), cp,
 		 length);
@@ -442,6 +442,32 @@ trunc:
 }
 
 
+/*
+ * Print the checksum of the LSA "lsap", "length" bytes long with its
+ * header, and whether it's right.  It covers everything but the LS age.
+ */
+static void
+ospf6_print_lsa_cksum(netdissect_options *ndo, const struct lsa6 *lsap,
+                      u_int length)
+{
+	uint16_t checksum, calculated_checksum;
+
+	checksum = GET_BE_U_2(lsap->ls_hdr.ls_chksum);
+	ND_PRINT("\n\t    Checksum 0x%04x", checksum);
+	if (!ND_TTEST_LEN(lsap, length)) {
+		ND_PRINT(" (unverified)");
+		return;
+	}
+	calculated_checksum = create_osi_cksum(
+	    (const uint8_t *)lsap->ls_hdr.ls_type,
+	    (int)(lsap->ls_hdr.ls_chksum - lsap->ls_hdr.ls_type),
+	    (int)(length - sizeof(lsap->ls_hdr.ls_age)));
+	if (checksum == calculated_checksum)
+		ND_PRINT(" (correct)");
+	else
+		ND_PRINT(" (incorrect should be 0x%04x)", calculated_checksum);
+}
+
 /*
  * Print a single link state advertisement.  If truncated return 1, else 0.
  */
@@ -484,6 +510,8 @@ ospf6_print_lsa(netdissect_options *ndo,
 		return (1);
         lsa_length = length - sizeof(struct lsa6_hdr);
         tptr = (const uint8_t *)lsap+sizeof(struct lsa6_hdr);
+	if (ndo->ndo_vflag > 2)
+		ospf6_print_lsa_cksum(ndo, lsap, length);
 
 	switch (GET_BE_U_2(lsap->ls_hdr.ls_type)) {
 	case LS_TYPE_ROUTER | LS_SCOPE_AREA:
@@ -30,6 +30,7 @@
 #include "netdissect.h"
 #include "addrtoname.h"
 #include "extract.h"
+#include "mcast-group.h"
 
 #include "ip.h"
 #include "ip6.h"
@@ -156,6 +157,7 @@ struct pim {
 };
 
 static void pimv2_print(netdissect_options *, const u_char *bp, u_int len, const u_char *);
+static void pimv2_groups(netdissect_options *, const u_char *bp, u_int len);
 
 static void
 pimv1_join_prune_print(netdissect_options *ndo,
@@ -495,7 +497,6 @@ pim_print(netdissect_options *ndo,
 			          PIM_VER(pim_typever),
 			          tok2str(pimv2_type_values,"Unknown Type",PIM_TYPE(pim_typever)),
 			          len);
-			return;
 		} else {
 			ND_PRINT("PIMv%u, length %u\n\t%s",
 			          PIM_VER(pim_typever),
@@ -503,6 +504,9 @@ pim_print(netdissect_options *ndo,
 			          tok2str(pimv2_type_values,"Unknown Type",PIM_TYPE(pim_typever)));
 			pimv2_print(ndo, bp, len, bp2);
 		}
+		if (ndo->ndo_mcast_groups &&
+		    PIM_TYPE(pim_typever) == PIMV2_TYPE_JOIN_PRUNE)
+			pimv2_groups(ndo, bp, len);
 		break;
 	default:
 		ND_PRINT("PIMv%u, length %u",
@@ -681,6 +685,78 @@ trunc:
 	return -1;
 }
 
+/*
+ * Return the address in the encoded group or source address at "bp",
+ * and put its family in "*af" and its flags in "*flags"; it's been
+ * checked by pimv2_addr_print().
+ */
+static const u_char *
+pimv2_encoded_addr(netdissect_options *ndo, const u_char *bp,
+                   u_int addr_len, int *af, u_int *flags)
+{
+	if (addr_len == 0) {
+		*af = GET_U_1(bp) == 1 ? AF_INET : AF_INET6;
+		*flags = GET_U_1(bp + 2);
+		return bp + 4;
+	}
+	*af = addr_len == sizeof(nd_ipv4) ? AF_INET : AF_INET6;
+	*flags = GET_U_1(bp);
+	return bp + 2;
+}
+
+/*
+ * Update the --mcast-groups state from the joins and prunes of a
+ * Join/Prune message; one that changes nothing isn't shown.  A source
+ * with the WC bit is the (*,G) join or prune, and one of (S,G,rpt)
+ * doesn't change what's joined upstream.
+ */
+static void
+pimv2_groups(netdissect_options *ndo, const u_char *bp, u_int len)
+{
+	const u_char *group, *source;
+	u_int addr_len, ngroup, njoin, nprune, i, j, flags;
+	int advance, af, gaf, changed = 0;
+
+	if (len < 4 || !ND_TTEST_4(bp))
+		return;
+	addr_len = GET_U_1(bp + 1) & 0x0f;
+	bp += 4;
+	len -= 4;
+	if ((advance = pimv2_addr_print(ndo, bp, len, pimv2_unicast, addr_len, 1)) < 0)
+		return;
+	bp += advance; len -= advance;
+	if (len < 4 || !ND_TTEST_4(bp))
+		return;
+	ngroup = GET_U_1(bp + 1);
+	bp += 4; len -= 4;
+	for (i = 0; i < ngroup; i++) {
+		if ((advance = pimv2_addr_print(ndo, bp, len, pimv2_group, addr_len, 1)) < 0)
+			break;
+		group = pimv2_encoded_addr(ndo, bp, addr_len, &gaf, &flags);
+		bp += advance; len -= advance;
+		if (len < 4 || !ND_TTEST_4(bp))
+			break;
+		njoin = GET_BE_U_2(bp);
+		nprune = GET_BE_U_2(bp + 2);
+		bp += 4; len -= 4;
+		for (j = 0; j < njoin + nprune; j++) {
+			if ((advance = pimv2_addr_print(ndo, bp, len, pimv2_source, addr_len, 1)) < 0)
+				goto done;
+			source = pimv2_encoded_addr(ndo, bp, addr_len, &af, &flags);
+			bp += advance; len -= advance;
+			if (af != gaf)
+				continue;
+			if (flags & 0x02)
+				changed |= mcast_pim(ndo, af, group, NULL, j < njoin);
+			else if (!(flags & 0x01))
+				changed |= mcast_pim(ndo, af, group, source, j < njoin);
+		}
+	}
+done:
+	if (!changed)
+		ndo->ndo_drop_line = 1;
+}
+
 enum checksum_status {
 	CORRECT,
 	INCORRECT,
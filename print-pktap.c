@@ -28,6 +28,7 @@
 #include "netdissect-stdinc.h"
 
 #include "netdissect.h"
+#include "netdissect-fields.h"
 #include "extract.h"
 
 #ifdef DLT_PKTAP
@@ -89,6 +90,26 @@ pktap_header_print(netdissect_options *ndo, const u_char *bp, u_int length)
 	ND_PRINT(", length %u: ", length);
 }
 
+/*
+ * Report the interface and process the packet was for as fields.
+ */
+static void
+pktap_header_fields(netdissect_options *ndo, const pktap_header_t *hdr)
+{
+	ND_FIELD_UINT(NDF_PKTAP, NDF_PKTAP_DLT, GET_LE_U_4(hdr->pkt_dlt));
+	ND_FIELD_NSTRING(NDF_PKTAP, NDF_PKTAP_IFNAME, hdr->pkt_ifname,
+	    sizeof(hdr->pkt_ifname));
+	ND_FIELD_UINT(NDF_PKTAP, NDF_PKTAP_FLAGS, GET_LE_U_4(hdr->pkt_flags));
+	ND_FIELD_UINT(NDF_PKTAP, NDF_PKTAP_PID, GET_LE_U_4(hdr->pkt_pid));
+	ND_FIELD_NSTRING(NDF_PKTAP, NDF_PKTAP_CMDNAME, hdr->pkt_cmdname,
+	    sizeof(hdr->pkt_cmdname));
+	ND_FIELD_UINT(NDF_PKTAP, NDF_PKTAP_SVC_CLASS,
+	    GET_LE_U_4(hdr->pkt_svc_class));
+	ND_FIELD_UINT(NDF_PKTAP, NDF_PKTAP_EPID, GET_LE_U_4(hdr->pkt_epid));
+	ND_FIELD_NSTRING(NDF_PKTAP, NDF_PKTAP_ECMDNAME, hdr->pkt_ecmdname,
+	    sizeof(hdr->pkt_ecmdname));
+}
+
 /*
  * This is the top level routine of the printer.  'p' points
  * to the ether header of the packet, 'h->ts' is the timestamp,
@@ -132,6 +153,8 @@ pktap_if_print(netdissect_options *ndo,
 
 	if (ndo->ndo_eflag)
 		pktap_header_print(ndo, p, length);
+	if (ndo->ndo_field != NULL)
+		pktap_header_fields(ndo, hdr);
 
 	length -= hdrlen;
 	caplen -= hdrlen;
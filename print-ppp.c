@@ -43,6 +43,7 @@
 #endif
 
 #include <stdlib.h>
+#include <string.h>
 
 #include "netdissect.h"
 #include "extract.h"
@@ -1408,9 +1409,9 @@ static void
 ppp_hdlc(netdissect_options *ndo,
          const u_char *p, u_int length)
 {
-	u_char *b, *t, c;
-	const u_char *s;
-	u_int i, proto;
+	u_char *b, *t;
+	const u_char *s, *e;
+	u_int i, n, proto;
 	const void *se;
 
         if (length == 0)
@@ -1424,18 +1425,28 @@ ppp_hdlc(netdissect_options *ndo,
 	 * Unescape all the data into a temporary, private, buffer.
 	 * Do this so that we dont overwrite the original packet
 	 * contents.
+	 *
+	 * Most of the data needs no unescaping, so copy the runs
+	 * between escapes as they are, and only look at the bytes
+	 * that were captured, all of them at once.
 	 */
-	for (s = p, t = b, i = length; i != 0 && ND_TTEST_1(s); i--) {
-		c = GET_U_1(s);
-		s++;
-		if (c == 0x7d) {
-			if (i <= 1 || !ND_TTEST_1(s))
-				break;
-			i--;
-			c = GET_U_1(s) ^ 0x20;
-			s++;
+	i = (ndo->ndo_snapend > p) ? ND_BYTES_AVAILABLE_AFTER(p) : 0;
+	if (i > length)
+		i = length;
+	for (s = p, t = b; i != 0; ) {
+		e = (const u_char *)memchr(s, 0x7d, i);
+		n = (e != NULL) ? ND_BYTES_BETWEEN(e, s) : i;
+		memcpy(t, s, n);
+		s += n;
+		t += n;
+		i -= n;
+		if (i <= 1) {
+			/* no escape, or nothing after it */
+			break;
 		}
-		*t++ = c;
+		*t++ = s[1] ^ 0x20;
+		s += 2;
+		i -= 2;
 	}
 
 	/*
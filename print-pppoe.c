@@ -33,6 +33,7 @@
 
 #include "netdissect.h"
 #include "extract.h"
+#include "ppp-session.h"
 
 /* Codes */
 enum {
@@ -93,6 +94,30 @@ pppoe_if_print(netdissect_options *ndo, const struct pcap_pkthdr *h, const u_cha
 	return (pppoe_print(ndo, p, h->len));
 }
 
+/*
+ * Print the --ppp-sessions event, if any, of the discovery packet with
+ * code "code" for session "sessionid".
+ */
+static void
+pppoe_session_control(netdissect_options *ndo, u_int code, u_int sessionid)
+{
+	struct ppp_session *ps;
+
+	if (sessionid == 0)
+		return;
+	ps = ppp_session_find(ndo, PPP_SESSION_PPPOE, 0, sessionid);
+	if (code == PPPOE_PADS) {
+		ppp_session_state(ps, PPP_SESSION_UP);
+		ND_PRINT(" session 0x%x up", sessionid);
+	} else if (code == PPPOE_PADT) {
+		ppp_session_state(ps, PPP_SESSION_DOWN);
+		ND_PRINT(" session 0x%x down, %" PRIu64 " packets, %" PRIu64
+		    " bytes", sessionid, ps->stats.pss_packets,
+		    ps->stats.pss_bytes);
+	}
+	ps->stats.pss_control++;
+}
+
 u_int
 pppoe_print(netdissect_options *ndo, const u_char *bp, u_int length)
 {
@@ -192,7 +217,13 @@ pppoe_print(netdissect_options *ndo, const u_char *bp, u_int length)
 			p += tag_len;
 			/* p points to next tag */
 		}
+		if (ndo->ndo_ppp_sessions)
+			pppoe_session_control(ndo, pppoe_code, pppoe_sessionid);
 		return (0);
+	} else if (ndo->ndo_ppp_sessions) {
+		ppp_session_data(ndo, ppp_session_find(ndo, PPP_SESSION_PPPOE,
+		    0, pppoe_sessionid), pppoe_length);
+		return (PPPOE_HDRLEN);
 	} else {
 		/* PPPoE data */
 		ND_PRINT(" ");
@@ -24,7 +24,10 @@
 #include "netdissect-stdinc.h"
 #include "netdissect.h"
 #include "extract.h"
+#include <stdarg.h>
+#include <stdio.h>
 #include <string.h>
+#include <time.h>
 
 /*
  * PTP header
@@ -427,6 +430,323 @@ static void ptp_print_2(netdissect_options *ndo, const u_char *bp, u_int length)
             break;
     }
 }
+/*
+ * --ptp-stats: rather than printing each message, work out each slave's
+ * offset from its master and the mean path delay between them, from the
+ * delay request-response exchanges, as
+ *
+ *     offset = ((t2 - t1) - (t4 - t3)) / 2
+ *     delay  = ((t2 - t1) + (t4 - t3)) / 2
+ *
+ * where t1 is when the master's last Sync left it, from the Sync or, if
+ * it's two-step, the Follow_Up with the same sequenceId, t4 is when the
+ * slave's Delay_Req reached the master, from the Delay_Resp that has the
+ * Delay_Req's sequenceId and the slave's port identity, and t2 and t3,
+ * when the Sync reached the slave and the Delay_Req left it, are the
+ * capture time stamps; so the figures are the slave's own when the
+ * capture is taken on it, best with nanosecond time stamps.
+ *
+ * The ports and pairs are kept in tables of fixed size, per thread, and
+ * messages from ports that don't fit are only counted.
+ */
+#define PTP_NPORTS  64
+#define PTP_NPAIRS  64
+
+#define PTP_PORT_ID_LEN 10          /* clock identity and port number */
+
+#define PTP_SYNC_NONE       0
+#define PTP_SYNC_WAITING    1       /* for its Follow_Up */
+#define PTP_SYNC_DONE       2
+
+struct ptp_port {
+    u_char id[PTP_PORT_ID_LEN];
+    uint8_t domain;
+    /* as a master */
+    int sync_state;
+    uint16_t sync_seq;
+    int64_t sync_corr;              /* of a two-step Sync */
+    int64_t sync_t1, sync_t2;
+    int utc_offset;                 /* seconds, if its time scale is PTP */
+    /* as a slave */
+    int have_req;
+    uint16_t req_seq;
+    int64_t req_t3;
+};
+
+struct ptp_pair {
+    u_char master[PTP_PORT_ID_LEN];
+    u_char slave[PTP_PORT_ID_LEN];
+    uint8_t domain;
+    uint64_t exchanges;
+    int64_t offset, delay;          /* of the last one, in ns */
+    int64_t offset_min, offset_max, delay_min, delay_max;
+    double offset_mean, delay_mean;
+    double offset_jitter;           /* mean change from one to the next */
+};
+
+static ND_THREAD_LOCAL struct ptp_port ptp_ports[PTP_NPORTS];
+static ND_THREAD_LOCAL u_int ptp_nports;
+static ND_THREAD_LOCAL struct ptp_pair ptp_pairs[PTP_NPAIRS];
+static ND_THREAD_LOCAL u_int ptp_npairs;
+static ND_THREAD_LOCAL uint64_t ptp_not_kept;   /* no room for them */
+
+static struct ptp_port *
+ptp_port_lookup(const u_char *id, uint8_t domain, int create)
+{
+    struct ptp_port *p;
+    u_int i;
+
+    for (i = 0; i < ptp_nports; i++) {
+        p = &ptp_ports[i];
+        if (p->domain == domain && memcmp(p->id, id, PTP_PORT_ID_LEN) == 0)
+            return p;
+    }
+    if (!create)
+        return NULL;
+    if (ptp_nports == PTP_NPORTS) {
+        ptp_not_kept++;
+        return NULL;
+    }
+    p = &ptp_ports[ptp_nports++];
+    memcpy(p->id, id, PTP_PORT_ID_LEN);
+    p->domain = domain;
+    return p;
+}
+
+static struct ptp_pair *
+ptp_pair_lookup(const struct ptp_port *m, const struct ptp_port *s)
+{
+    struct ptp_pair *pp;
+    u_int i;
+
+    for (i = 0; i < ptp_npairs; i++) {
+        pp = &ptp_pairs[i];
+        if (pp->domain == m->domain &&
+            memcmp(pp->master, m->id, PTP_PORT_ID_LEN) == 0 &&
+            memcmp(pp->slave, s->id, PTP_PORT_ID_LEN) == 0)
+            return pp;
+    }
+    if (ptp_npairs == PTP_NPAIRS) {
+        ptp_not_kept++;
+        return NULL;
+    }
+    pp = &ptp_pairs[ptp_npairs++];
+    memcpy(pp->master, m->id, PTP_PORT_ID_LEN);
+    memcpy(pp->slave, s->id, PTP_PORT_ID_LEN);
+    pp->domain = m->domain;
+    return pp;
+}
+
+/* A 10-octet timestamp, in nanoseconds since the epoch of the capture. */
+static int64_t
+ptp_stats_time(netdissect_options *ndo, const u_char *bp, int utc_offset)
+{
+    uint64_t secs;
+
+    secs = ((uint64_t)GET_BE_U_2(bp) << 32) | GET_BE_U_4(bp + 2);
+    return (int64_t)((secs - (uint64_t)(int64_t)utc_offset) * 1000000000U +
+                     GET_BE_U_4(bp + 6));
+}
+
+static int64_t
+ptp_stats_now(netdissect_options *ndo)
+{
+    return ndo->ndo_packet_ts;
+}
+
+/* a - b, wrapping rather than overflowing on nonsense time stamps */
+static int64_t
+ptp_stats_diff(int64_t a, int64_t b)
+{
+    return (int64_t)((uint64_t)a - (uint64_t)b);
+}
+
+static void
+ptp_stats_exchange(struct ptp_pair *pp, int64_t t1, int64_t t2, int64_t t3,
+                   int64_t t4)
+{
+    int64_t ms, sm, last;
+    double d;
+
+    last = pp->offset;
+    ms = ptp_stats_diff(t2, t1);
+    sm = ptp_stats_diff(t4, t3);
+    pp->offset = ptp_stats_diff(ms, sm) / 2;
+    pp->delay = (int64_t)((uint64_t)ms + (uint64_t)sm) / 2;
+    if (pp->exchanges++ == 0) {
+        pp->offset_min = pp->offset_max = pp->offset;
+        pp->delay_min = pp->delay_max = pp->delay;
+    } else {
+        d = (double)pp->offset - (double)last;
+        pp->offset_jitter += ((d < 0 ? -d : d) - pp->offset_jitter) /
+                             (double)(pp->exchanges - 1);
+    }
+    if (pp->offset < pp->offset_min)
+        pp->offset_min = pp->offset;
+    if (pp->offset > pp->offset_max)
+        pp->offset_max = pp->offset;
+    if (pp->delay < pp->delay_min)
+        pp->delay_min = pp->delay;
+    if (pp->delay > pp->delay_max)
+        pp->delay_max = pp->delay;
+    pp->offset_mean += ((double)pp->offset - pp->offset_mean) /
+                       (double)pp->exchanges;
+    pp->delay_mean += ((double)pp->delay - pp->delay_mean) /
+                      (double)pp->exchanges;
+}
+
+static void
+ptp_stats_count(netdissect_options *ndo, const u_char *bp)
+{
+    struct ptp_port *p, *s;
+    struct ptp_pair *pp;
+    uint8_t msg_type, domain;
+    uint16_t flags, seq;
+    int64_t corr, t;
+
+    msg_type = GET_U_1(bp) & PTP_MSG_TYPE_MASK;
+    domain = GET_U_1(bp + 4);
+    flags = GET_BE_U_2(bp + 6);
+    /* the correction field is in 2^-16 nanoseconds */
+    corr = (int64_t)GET_BE_U_8(bp + 8) / 65536;
+    ND_TCHECK_LEN(bp + 20, PTP_PORT_ID_LEN);
+    seq = GET_BE_U_2(bp + 30);
+
+    switch (msg_type) {
+    case M_SYNC:
+    case M_DELAY_REQ:
+    case M_ANNOUNCE:
+        p = ptp_port_lookup(bp + 20, domain, 1);
+        break;
+    case M_FOLLOW_UP:
+    case M_DELAY_RESP:
+        p = ptp_port_lookup(bp + 20, domain, 0);
+        break;
+    default:
+        return;
+    }
+    if (p == NULL)
+        return;
+    switch (msg_type) {
+    case M_SYNC:
+        if (flags & PTP_TWO_STEP_MASK) {
+            p->sync_corr = corr;
+            p->sync_state = PTP_SYNC_WAITING;
+        } else {
+            t = ptp_stats_time(ndo, bp + PTP_HDR_LEN, p->utc_offset);
+            p->sync_t1 = ptp_stats_diff(t, -corr);
+            p->sync_state = PTP_SYNC_DONE;
+        }
+        p->sync_seq = seq;
+        p->sync_t2 = ptp_stats_now(ndo);
+        break;
+    case M_FOLLOW_UP:
+        if (p->sync_state != PTP_SYNC_WAITING || seq != p->sync_seq)
+            break;
+        t = ptp_stats_time(ndo, bp + PTP_HDR_LEN, p->utc_offset);
+        p->sync_t1 = ptp_stats_diff(t, -(p->sync_corr + corr));
+        p->sync_state = PTP_SYNC_DONE;
+        break;
+    case M_DELAY_REQ:
+        p->req_seq = seq;
+        p->req_t3 = ptp_stats_now(ndo);
+        p->have_req = 1;
+        break;
+    case M_DELAY_RESP:
+        ND_TCHECK_LEN(bp + PTP_HDR_LEN + 10, PTP_PORT_ID_LEN);
+        s = ptp_port_lookup(bp + PTP_HDR_LEN + 10, domain, 0);
+        if (s == NULL || !s->have_req || seq != s->req_seq ||
+            p->sync_state != PTP_SYNC_DONE)
+            break;
+        t = ptp_stats_time(ndo, bp + PTP_HDR_LEN, p->utc_offset);
+        s->have_req = 0;
+        pp = ptp_pair_lookup(p, s);
+        if (pp == NULL)
+            break;
+        ptp_stats_exchange(pp, p->sync_t1, p->sync_t2, s->req_t3,
+                           ptp_stats_diff(t, corr));
+        break;
+    case M_ANNOUNCE:
+        /* currentUtcOffset, to take PTP time to the capture's UTC */
+        if (flags & PTP_TIMESCALE_MASK)
+            p->utc_offset = (int16_t)GET_BE_U_2(bp + PTP_HDR_LEN + 10);
+        else
+            p->utc_offset = 0;
+        break;
+    }
+    return;
+
+trunc:
+    nd_print_trunc(ndo);
+}
+
+static void
+ptp_stats_write(netdissect_options *ndo, const char *fmt, ...)
+    PRINTFLIKE(2, 3);
+
+static void
+ptp_stats_write(netdissect_options *ndo, const char *fmt, ...)
+{
+    char line[256];
+    va_list ap;
+    int len;
+
+    va_start(ap, fmt);
+    len = vsnprintf(line, sizeof(line), fmt, ap);
+    va_end(ap);
+    if (len > 0)
+        nd_outbuf_write(ndo, line,
+            (size_t)len < sizeof(line) ? (size_t)len : sizeof(line) - 1);
+}
+
+static const char *
+ptp_port_id_string(const u_char *id, char *buf, size_t size)
+{
+    snprintf(buf, size, "%02x%02x%02x.%02x%02x.%02x%02x%02x-%u",
+             id[0], id[1], id[2], id[3], id[4], id[5], id[6], id[7],
+             ((u_int)id[8] << 8) | id[9]);
+    return buf;
+}
+
+/*
+ * Write the --ptp-stats figures for each pair of master and slave so far,
+ * headed with the packet time "when" if it's not 0.
+ */
+void
+ptp_stats_report(netdissect_options *ndo, time_t when)
+{
+    const struct ptp_pair *pp;
+    struct tm tmbuf, *tm;
+    char buf[32], master[32], slave[32];
+    u_int i;
+
+    if (when != 0 && (tm = nd_localtime(&when, &tmbuf)) != NULL &&
+        strftime(buf, sizeof(buf), "%Y-%m-%d %H:%M:%S", tm) != 0)
+        ptp_stats_write(ndo, "ptp to %s\n", buf);
+    for (i = 0; i < ptp_npairs; i++) {
+        pp = &ptp_pairs[i];
+        ptp_stats_write(ndo,
+            "ptp %s > %s domain %u: %" PRIu64 " exchange%s\n",
+            ptp_port_id_string(pp->master, master, sizeof(master)),
+            ptp_port_id_string(pp->slave, slave, sizeof(slave)),
+            pp->domain, pp->exchanges, PLURAL_SUFFIX(pp->exchanges));
+        ptp_stats_write(ndo,
+            "    offset %" PRId64 " ns, mean %.1f, min %" PRId64 ", max %"
+            PRId64 ", jitter %.1f\n", pp->offset, pp->offset_mean,
+            pp->offset_min, pp->offset_max, pp->offset_jitter);
+        ptp_stats_write(ndo,
+            "    path delay %" PRId64 " ns, mean %.1f, min %" PRId64
+            ", max %" PRId64 "\n", pp->delay, pp->delay_mean,
+            pp->delay_min, pp->delay_max);
+    }
+    if (ptp_not_kept != 0)
+        ptp_stats_write(ndo, "ptp %" PRIu64 " message%s from ports past the"
+            " first %u, or pairs past the first %u, not kept\n",
+            ptp_not_kept, PLURAL_SUFFIX(ptp_not_kept), PTP_NPORTS,
+            PTP_NPAIRS);
+    nd_outbuf_flush(ndo);
+}
+
 /*
  * PTP general message
  */
@@ -440,6 +760,11 @@ ptp_print(netdissect_options *ndo, const u_char *bp, u_int len)
         goto trunc;
     }
     vers = GET_BE_U_2(bp) & PTP_VERS_MASK;
+    if (ndo->ndo_ptp_stats) {
+        if (vers == PTP_VER_2)
+            ptp_stats_count(ndo, bp);
+        return;
+    }
     ND_PRINT("PTPv%u",vers);
     switch(vers) {
         case PTP_VER_1:
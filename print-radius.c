@@ -88,15 +88,23 @@
 
 #include "netdissect-stdinc.h"
 
+#include <stddef.h>
+#include <stdlib.h>
 #include <string.h>
 
 #include "netdissect-ctype.h"
 
 #include "netdissect.h"
 #include "addrtoname.h"
+#include "ascii_strcasecmp.h"
+#include "callcache.h"
 #include "extract.h"
+#include "latency.h"
 #include "oui.h"
 
+#include "ip.h"
+#include "ip6.h"
+
 
 #define TAM_SIZE(x) (sizeof(x)/sizeof(x[0]) )
 
@@ -1008,6 +1016,7 @@ print_attr_time(netdissect_options *ndo,
                 const u_char *data, u_int length, u_short attr_code _U_)
 {
    time_t attr_time;
+   struct tm tmbuf, *tm;
    char string[26];
 
    if (length != 4)
@@ -1019,10 +1028,12 @@ print_attr_time(netdissect_options *ndo,
    ND_TCHECK_4(data);
 
    attr_time = GET_BE_U_4(data);
-   strlcpy(string, ctime(&attr_time), sizeof(string));
-   /* Get rid of the newline */
-   string[24] = '\0';
-   ND_PRINT("%.24s", string);
+   /* As ctime() has it, without the newline or its static buffer */
+   if ((tm = nd_localtime(&attr_time, &tmbuf)) == NULL ||
+       strftime(string, sizeof(string), "%a %b %e %H:%M:%S %Y", tm) == 0)
+       ND_PRINT("(Can't convert time)");
+   else
+       ND_PRINT("%s", string);
    return;
 
    trunc:
@@ -1212,6 +1223,224 @@ trunc:
    nd_print_trunc(ndo);
 }
 
+/*
+ * The attributes --radius-summary prints, in the order given, and for
+ * each attribute type its place in that list + 1, or 0 if it's not in
+ * it.  They're set up before any packets are looked at, and only read
+ * after that.
+ */
+#define RADIUS_SUMMARY_MAX	16
+
+static u_int radius_summary_types[RADIUS_SUMMARY_MAX];
+static u_int radius_summary_ntypes;
+static u_char radius_summary_slot[256];
+
+/*
+ * Set the attributes for --radius-summary from a comma-separated list
+ * of names, such as "User-Name", in any case, or numbers.  Returns -1
+ * if one isn't known or there are too many.
+ */
+int
+radius_summary_attrs(const char *list)
+{
+   const char *cp;
+   char *end;
+   size_t len;
+   u_int type, n;
+   u_long v;
+
+   n = 0;
+   memset(radius_summary_slot, 0, sizeof(radius_summary_slot));
+   for (cp = list; *cp != '\0'; cp += len + (cp[len] == ',')) {
+       len = strcspn(cp, ",");
+       if (len == 0)
+           return (-1);
+       if (ND_ASCII_ISDIGIT(*cp)) {
+           v = strtoul(cp, &end, 10);
+           if ((size_t)(end - cp) != len || v == 0 || v > 255)
+               return (-1);
+           type = (u_int)v;
+       } else {
+           for (type = 1; type < TAM_SIZE(attr_type); type++)
+               if (ascii_strncasecmp(attr_type[type].name, cp, len) == 0 &&
+                   attr_type[type].name[len] == '\0')
+                   break;
+           if (type == TAM_SIZE(attr_type))
+               return (-1);
+       }
+       if (radius_summary_slot[type] != 0)
+           continue;
+       if (n == RADIUS_SUMMARY_MAX)
+           return (-1);
+       radius_summary_types[n++] = type;
+       radius_summary_slot[type] = (u_char)n;
+   }
+   radius_summary_ntypes = n;
+   return (0);
+}
+
+/*
+ * --radius-summary: one line for the message, with only the attributes
+ * asked for.  The attributes are indexed by one pass over them, the
+ * first of each type wanted, and then printed in the order asked for.
+ */
+static void
+radius_summary_print(netdissect_options *ndo, const u_char *attr,
+                     u_int length)
+{
+   u_int off[RADIUS_SUMMARY_MAX];
+   u_int i, pos, slot, type, len;
+
+   memset(off, 0, sizeof(off));
+   for (pos = 0; pos + 2 <= length; pos += len) {
+       type = GET_U_1(attr + pos);
+       len = GET_U_1(attr + pos + 1);
+       if (len < 2 || len > length - pos)
+           break;
+       slot = radius_summary_slot[type];
+       if (slot != 0 && off[slot - 1] == 0)
+           off[slot - 1] = pos + 1;
+   }
+   for (i = 0; i < radius_summary_ntypes; i++) {
+       if (off[i] == 0)
+           continue;
+       pos = off[i] - 1;
+       type = radius_summary_types[i];
+       len = GET_U_1(attr + pos + 1);
+       ND_PRINT(", %s: ", type < TAM_SIZE(attr_type) ?
+                attr_type[type].name : "Unknown");
+       if (len > 2 && type < TAM_SIZE(attr_type) &&
+           attr_type[type].print_func != NULL)
+           (*attr_type[type].print_func)(ndo, attr + pos + 2, len - 2,
+                                         (u_short)type);
+   }
+}
+
+/*
+ * The requests seen, for --latency-report, so that the first response
+ * to one can be counted against its type, by client and server address
+ * and port and identifier; see callcache.h.
+ */
+struct radius_req_key {
+   uint32_t ipver;
+   nd_ipv6 client;
+   nd_ipv6 server;
+   uint32_t cport;
+   uint32_t sport;
+   uint32_t id;
+};
+
+struct radius_req_entry {
+   struct callcache_entry ce;
+   struct radius_req_key key;
+   u_int code;
+   u_int answered;
+};
+
+#define RADIUS_REQ_TIMEOUT	30
+
+static const struct callcache_type radius_req_type = {
+   sizeof(struct radius_req_entry),
+   offsetof(struct radius_req_entry, key),
+   sizeof(struct radius_req_key),
+   RADIUS_REQ_TIMEOUT
+};
+
+/*
+ * The request code a response code answers, or 0 if it's not a
+ * response.
+ */
+static u_int
+radius_request_code(u_int code)
+{
+   switch (code) {
+   case RADCMD_ACCESS_ACC:
+   case RADCMD_ACCESS_REJ:
+   case RADCMD_ACCESS_CHA:
+      return (RADCMD_ACCESS_REQ);
+   case RADCMD_ACCOUN_RES:
+      return (RADCMD_ACCOUN_REQ);
+   case RADCMD_DISCON_ACK:
+   case RADCMD_DISCON_NAK:
+      return (RADCMD_DISCON_REQ);
+   case RADCMD_COA_ACK:
+   case RADCMD_COA_NAK:
+      return (RADCMD_COA_REQ);
+   }
+   return (0);
+}
+
+/*
+ * Count the time to the first response to each request, by the type of
+ * the response, for the RADIUS message "bp" from port "sport" to port
+ * "dport" of the IPv4 or IPv6 datagram "iph".  Nothing is printed.
+ */
+void
+radius_latency(netdissect_options *ndo, const u_char *bp, u_int length,
+               const u_char *iph, u_int sport, u_int dport)
+{
+   const struct radius_hdr *rad = (const struct radius_hdr *)bp;
+   const struct ip *ip = (const struct ip *)iph;
+   const struct ip6_hdr *ip6 = (const struct ip6_hdr *)iph;
+   struct radius_req_entry *rre;
+   struct radius_req_key key;
+   u_int code, reqcode;
+   int response;
+
+   if (iph == NULL || length < MIN_RADIUS_LEN || !ND_TTEST_4(bp))
+      return;
+   code = GET_U_1(rad->code);
+   reqcode = radius_request_code(code);
+   response = reqcode != 0;
+   if (!response && code != RADCMD_ACCESS_REQ &&
+       code != RADCMD_ACCOUN_REQ && code != RADCMD_DISCON_REQ &&
+       code != RADCMD_COA_REQ)
+      return;
+   memset(&key, 0, sizeof(key));
+   key.ipver = IP_V(ip);
+   switch (key.ipver) {
+   case 4:
+      if (!ND_TTEST_SIZE(ip))
+         return;
+      memcpy(response ? &key.server : &key.client, ip->ip_src,
+             sizeof(nd_ipv4));
+      memcpy(response ? &key.client : &key.server, ip->ip_dst,
+             sizeof(nd_ipv4));
+      break;
+   case 6:
+      if (!ND_TTEST_SIZE(ip6))
+         return;
+      memcpy(response ? &key.server : &key.client, ip6->ip6_src,
+             sizeof(nd_ipv6));
+      memcpy(response ? &key.client : &key.server, ip6->ip6_dst,
+             sizeof(nd_ipv6));
+      break;
+   default:
+      return;
+   }
+   key.id = GET_U_1(rad->id);
+   key.cport = response ? dport : sport;
+   key.sport = response ? sport : dport;
+
+   if (response) {
+      rre = (struct radius_req_entry *)callcache_find(ndo,
+          &radius_req_type, &key);
+      if (rre == NULL || rre->answered || rre->code != reqcode)
+         return;
+      rre->answered = 1;
+      (void)latency_record(ndo, "radius",
+          tok2str(radius_command_values, "code-%u", code),
+          rre->ce.cce_ts);
+      return;
+   }
+   rre = (struct radius_req_entry *)callcache_enter(ndo, &radius_req_type,
+       &key);
+   if (rre != NULL) {
+      rre->code = code;
+      rre->answered = 0;
+   }
+}
+
 void
 radius_print(netdissect_options *ndo,
              const u_char *dat, u_int length)
@@ -1233,6 +1462,18 @@ radius_print(netdissect_options *ndo,
    if (len > length)
 	  len = length;
 
+   if (ndo->ndo_radius_summary) {
+       ND_PRINT("RADIUS, %s (%u), id: 0x%02x length: %u",
+              tok2str(radius_command_values,"Unknown Command",GET_U_1(rad->code)),
+              GET_U_1(rad->code),
+              GET_U_1(rad->id),
+              len);
+       if (len > MIN_RADIUS_LEN)
+          radius_summary_print(ndo, dat + MIN_RADIUS_LEN,
+                               len - MIN_RADIUS_LEN);
+       return;
+   }
+
    if (ndo->ndo_vflag < 1) {
        ND_PRINT("RADIUS, %s (%u), id: 0x%02x length: %u",
               tok2str(radius_command_values,"Unknown Command",GET_U_1(rad->code)),
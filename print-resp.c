@@ -40,7 +40,9 @@
 #include <stdlib.h>
 #include <errno.h>
 
+#include "netdissect-ctype.h"
 #include "extract.h"
+#include "payload-tap.h"
 
 
 /*
@@ -69,6 +71,7 @@ static int resp_print_bulk_string(netdissect_options *, const u_char *, int);
 static int resp_print_bulk_array(netdissect_options *, const u_char *, int);
 static int resp_print_inline(netdissect_options *, const u_char *, int);
 static int resp_get_length(netdissect_options *, const u_char *, int, const u_char **);
+static int resp_extract_command(netdissect_options *, const u_char *, int);
 
 #define LCHECK2(_tot_len, _len) \
     {                           \
@@ -540,3 +543,194 @@ invalid:
     *endp = bp;
     return (-5);
 }
+
+/*
+ * --extract-payloads: count each command sent to the server, by name,
+ * for resp_command_foreach(), and write its name and first argument
+ * to the extraction file, without printing them.  The arguments after
+ * the first are skipped by their lengths, without being looked at.
+ */
+#define RESP_NAME_LEN		32
+#define RESP_COMMAND_CHAINS	64
+#define RESP_MAX_COMMANDS	256	/* names counted; the rest are "(other)" */
+
+struct resp_command {
+	struct resp_command_stats stats;
+	char name[RESP_NAME_LEN + 1];
+	struct resp_command *next;	/* on its hash chain */
+};
+
+static ND_THREAD_LOCAL struct resp_command *resp_command_chains[RESP_COMMAND_CHAINS];
+static ND_THREAD_LOCAL struct resp_command **resp_commands;	/* in order made */
+static ND_THREAD_LOCAL u_int resp_ncommands, resp_maxcommands;
+
+static void
+resp_count(netdissect_options *ndo, const u_char *name, u_int len,
+           u_int bytes)
+{
+    struct resp_command *rc, **rcp;
+    char buf[RESP_NAME_LEN + 1];
+    u_int i;
+    u_char c;
+    uint32_t h = 2166136261U;
+
+    if (len > RESP_NAME_LEN || !ND_TTEST_LEN(name, len) || len == 0)
+        len = 0;
+    for (i = 0; i < len; i++) {
+        c = GET_U_1(name + i);
+        if (c >= 'a' && c <= 'z')
+            c -= 'a' - 'A';
+        else if (!ND_ASCII_ISGRAPH(c))
+            c = '?';
+        buf[i] = (char)c;
+    }
+    buf[i] = '\0';
+    if (len == 0 || resp_ncommands == RESP_MAX_COMMANDS)
+        strlcpy(buf, "(other)", sizeof(buf));
+    for (i = 0; buf[i] != '\0'; i++)
+        h = (h ^ (u_char)buf[i]) * 16777619U;
+    rcp = &resp_command_chains[h % RESP_COMMAND_CHAINS];
+    for (rc = *rcp; rc != NULL; rc = rc->next)
+        if (strcmp(rc->name, buf) == 0)
+            break;
+    if (rc == NULL) {
+        if (resp_ncommands == resp_maxcommands) {
+            resp_maxcommands = resp_maxcommands ? resp_maxcommands * 2 : 16;
+            resp_commands = (struct resp_command **)realloc(resp_commands,
+                resp_maxcommands * sizeof(*resp_commands));
+            if (resp_commands == NULL)
+                (*ndo->ndo_error)(ndo, S_ERR_ND_MEM_ALLOC,
+                    "%s: realloc", __func__);
+        }
+        rc = (struct resp_command *)calloc(1, sizeof(*rc));
+        if (rc == NULL)
+            (*ndo->ndo_error)(ndo, S_ERR_ND_MEM_ALLOC, "%s: calloc",
+                __func__);
+        strlcpy(rc->name, buf, sizeof(rc->name));
+        rc->stats.rc_name = rc->name;
+        rc->next = *rcp;
+        *rcp = rc;
+        resp_commands[resp_ncommands++] = rc;
+    }
+    rc->stats.rc_count++;
+    rc->stats.rc_bytes += bytes;
+}
+
+/*
+ * Call "fn" for each command of this thread that has been counted, in
+ * the order they were first seen.
+ */
+void
+resp_command_foreach(resp_command_fn fn, void *arg)
+{
+    u_int i;
+
+    for (i = 0; i < resp_ncommands; i++)
+        (*fn)(arg, &resp_commands[i]->stats);
+}
+
+/*
+ * Extract the command at "bp", an array of bulk strings or an inline
+ * command; returns its length, or -1 if it isn't one or isn't all there.
+ */
+static int
+resp_extract_command(netdissect_options *ndo, const u_char *bp, int length)
+{
+    struct tap_field f[2];
+    const u_char *p;
+    int length_cur = length, nargs, i, arg_len;
+    u_int nf = 0;
+
+    LCHECK2(length, 1);
+    ND_TCHECK_1(bp);
+    if (GET_U_1(bp) == RESP_ARRAY) {
+        SKIP_OPCODE(bp, length_cur);
+        GET_LENGTH(ndo, length_cur, bp, nargs);
+        if (nargs <= 0)
+            goto trunc;
+        for (i = 0; i < nargs; i++) {
+            LCHECK(length_cur);
+            ND_TCHECK_1(bp);
+            if (GET_U_1(bp) != RESP_BULK_STRING)
+                goto trunc;
+            SKIP_OPCODE(bp, length_cur);
+            GET_LENGTH(ndo, length_cur, bp, arg_len);
+            if (arg_len < 0)
+                goto trunc;
+            LCHECK2(length_cur, 2);
+            LCHECK2(length_cur - 2, arg_len);
+            if (i < 2) {
+                f[nf].tf_data = bp;
+                f[nf].tf_len = arg_len;
+                nf++;
+            }
+            bp += arg_len + 2;
+            length_cur -= arg_len + 2;
+        }
+    } else {
+        /* <name> [<key> ...]<\r||\n||\r\n...>, split at spaces */
+        CONSUME_CR_OR_LF(bp, length_cur);
+        nargs = 0;
+        for (;;) {
+            while (length_cur > 0 && ND_TTEST_1(bp) && *bp == ' ') {
+                bp++;
+                length_cur--;
+            }
+            LCHECK(length_cur);
+            ND_TCHECK_1(bp);
+            if (*bp == '\r' || *bp == '\n')
+                break;
+            for (p = bp; length_cur > 0 && ND_TTEST_1(p) &&
+                 *p != ' ' && *p != '\r' && *p != '\n'; p++)
+                length_cur--;
+            if (nargs < 2) {
+                f[nf].tf_data = bp;
+                f[nf].tf_len = ND_BYTES_BETWEEN(p, bp);
+                nf++;
+            }
+            nargs++;
+            bp = p;
+        }
+        CONSUME_CR_OR_LF(bp, length_cur);
+        if (nargs == 0)
+            goto trunc;
+    }
+
+    resp_count(ndo, f[0].tf_data, f[0].tf_len, length - length_cur);
+    tap_record(ndo, TAP_RESP, nargs - 1, f, nf);
+    return (length - length_cur);
+
+trunc:
+    return (-1);
+}
+
+/*
+ * Extract the commands in a segment sent to the server, if "to_server",
+ * printing only how many there were, or print the length of a segment
+ * from it.
+ */
+void
+resp_extract(netdissect_options *ndo, const u_char *bp, u_int length,
+             int to_server)
+{
+    int ret_len, length_cur = length;
+    u_int n = 0;
+
+    ndo->ndo_protocol = "resp";
+    ND_PRINT(": RESP");
+    if (!to_server) {
+        ND_PRINT(", reply, length %u", length);
+        return;
+    }
+    while (length_cur > 0) {
+        ret_len = resp_extract_command(ndo, bp, length_cur);
+        if (ret_len < 0)
+            break;
+        bp += ret_len;
+        length_cur -= ret_len;
+        n++;
+    }
+    ND_PRINT(", %u command%s", n, PLURAL_SUFFIX(n));
+    if (length_cur > 0)
+        nd_print_trunc(ndo);
+}
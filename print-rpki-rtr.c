@@ -130,7 +130,7 @@ static const struct tok rpki_rtr_error_codes[] = {
 static char *
 indent_string (u_int indent)
 {
-    static char buf[20];
+    static ND_THREAD_LOCAL char buf[20];
     u_int idx;
 
     idx = 0;
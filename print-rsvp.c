@@ -28,6 +28,7 @@
 #include "netdissect.h"
 #include "extract.h"
 #include "addrtoname.h"
+#include "label-binding.h"
 #include "ethertype.h"
 #include "gmpls.h"
 #include "af.h"
@@ -1905,9 +1906,9 @@ trunc:
     return -1;
 }
 
-void
-rsvp_print(netdissect_options *ndo,
-           const u_char *pptr, u_int len)
+static void
+rsvp_msg_print(netdissect_options *ndo,
+               const u_char *pptr, u_int len)
 {
     const struct rsvp_common_header *rsvp_com_header;
     uint8_t version_flags, msg_type;
@@ -2056,3 +2057,159 @@ rsvp_print(netdissect_options *ndo,
 trunc:
     nd_print_trunc(ndo);
 }
+
+/*
+ * Name, in "name", the LSP whose LSP_TUNNEL SESSION object body is at
+ * "session" and whose FILTER_SPEC or SENDER_TEMPLATE body is at "sender",
+ * both of C-Type "ctype".
+ */
+static void
+rsvp_lsp_name(netdissect_options *ndo, char *name, size_t size,
+              u_int ctype, const u_char *session, const u_char *sender)
+{
+    if (ctype == RSVP_CTYPE_TUNNEL_IPV4)
+        snprintf(name, size, "rsvp tunnel %s/%u ext %s lsp %s/%u",
+                 GET_IPADDR_STRING(session), GET_BE_U_2(session + 6),
+                 GET_IPADDR_STRING(session + 8), GET_IPADDR_STRING(sender),
+                 GET_BE_U_2(sender + 6));
+    else
+        snprintf(name, size, "rsvp tunnel %s/%u ext %s lsp %s/%u",
+                 GET_IP6ADDR_STRING(session), GET_BE_U_2(session + 18),
+                 GET_IP6ADDR_STRING(session + 20), GET_IP6ADDR_STRING(sender),
+                 GET_BE_U_2(sender + 18));
+}
+
+/*
+ * Update the --label-bindings table from the message at "pptr": the
+ * LABEL objects of a Resv bind labels to the LSPs of the FILTER_SPECs
+ * before them, and a ResvTear or PathTear takes them away.  The hash
+ * leaves out the INTEGRITY and refresh reduction objects, which change
+ * from one refresh to the next.
+ */
+static int
+rsvp_msg_bindings(netdissect_options *ndo, const u_char *pptr, u_int len)
+{
+    u_char key[LABEL_BINDING_KEYLEN];
+    char name[128];
+    const u_char *tptr, *session = NULL, *sender = NULL;
+    u_int msg_type, tlen, obj_len, class_num, ctype, session_ctype = 0;
+    u_int slen = 0, flen = 0;
+    int changed = 0;
+    uint32_t hash = 2166136261U;
+
+    msg_type = GET_U_1(pptr + 1);
+    if (msg_type != RSVP_MSGTYPE_RESV && msg_type != RSVP_MSGTYPE_RESVTEAR &&
+        msg_type != RSVP_MSGTYPE_PATHTEAR)
+        return 0;
+    for (tptr = pptr + sizeof(struct rsvp_common_header),
+         tlen = len - sizeof(struct rsvp_common_header);
+         tlen >= sizeof(struct rsvp_object_header);
+         tptr += obj_len, tlen -= obj_len) {
+        obj_len = GET_BE_U_2(tptr);
+        if (obj_len < sizeof(struct rsvp_object_header) || obj_len > tlen ||
+            (obj_len & 3) != 0)
+            break;
+        class_num = GET_U_1(tptr + 2);
+        if (class_num != RSVP_OBJ_INTEGRITY &&
+            class_num != RSVP_OBJ_MESSAGE_ID &&
+            class_num != RSVP_OBJ_MESSAGE_ID_ACK &&
+            class_num != RSVP_OBJ_MESSAGE_ID_LIST)
+            hash = label_binding_hash(hash, tptr, obj_len);
+    }
+
+    memset(key, 0, sizeof(key));
+    key[0] = 'R';
+    for (tptr = pptr + sizeof(struct rsvp_common_header),
+         tlen = len - sizeof(struct rsvp_common_header);
+         tlen >= sizeof(struct rsvp_object_header);
+         tptr += obj_len, tlen -= obj_len) {
+        obj_len = GET_BE_U_2(tptr);
+        if (obj_len < sizeof(struct rsvp_object_header) || obj_len > tlen ||
+            (obj_len & 3) != 0)
+            break;
+        class_num = GET_U_1(tptr + 2);
+        ctype = GET_U_1(tptr + 3);
+        switch (class_num) {
+        case RSVP_OBJ_SESSION:
+            if (ctype == RSVP_CTYPE_TUNNEL_IPV4 && obj_len == 16)
+                slen = 12;
+            else if (ctype == RSVP_CTYPE_TUNNEL_IPV6 && obj_len == 40)
+                slen = 36;
+            else
+                return changed;
+            session = tptr + 4;
+            session_ctype = ctype;
+            memcpy(key + 1, session, slen);
+            break;
+        case RSVP_OBJ_FILTERSPEC:
+        case RSVP_OBJ_SENDER_TEMPLATE:
+            if (session == NULL || ctype != session_ctype)
+                break;
+            flen = ctype == RSVP_CTYPE_TUNNEL_IPV4 ? 8 : 20;
+            if (obj_len != 4 + flen)
+                break;
+            sender = tptr + 4;
+            memcpy(key + 1 + slen, sender, flen);
+            if (msg_type == RSVP_MSGTYPE_RESVTEAR ||
+                msg_type == RSVP_MSGTYPE_PATHTEAR)
+                changed |= label_unbind(ndo, key, 1 + slen + flen);
+            break;
+        case RSVP_OBJ_LABEL:
+            if (msg_type != RSVP_MSGTYPE_RESV || sender == NULL ||
+                ctype != RSVP_CTYPE_1 || obj_len != 8)
+                break;
+            rsvp_lsp_name(ndo, name, sizeof(name), session_ctype, session,
+                          sender);
+            changed |= label_bind(ndo, key, 1 + slen + flen, name,
+                                  GET_BE_U_4(tptr + 4), hash);
+            break;
+        default:
+            break;
+        }
+    }
+    return changed;
+}
+
+/*
+ * Walk the message at "pptr", or the submessages of a Bundle, for
+ * --label-bindings; one that changes no binding isn't shown.
+ */
+static void
+rsvp_bindings(netdissect_options *ndo, const u_char *pptr, u_int len)
+{
+    u_int plen, sublen;
+    int changed = 0;
+
+    if (len < sizeof(struct rsvp_common_header) ||
+        !ND_TTEST_LEN(pptr, sizeof(struct rsvp_common_header)))
+        return;
+    plen = GET_BE_U_2(pptr + 6);
+    if (plen < sizeof(struct rsvp_common_header) || plen > len ||
+        !ND_TTEST_LEN(pptr, plen))
+        return;
+    if (GET_U_1(pptr + 1) != RSVP_MSGTYPE_BUNDLE)
+        changed = rsvp_msg_bindings(ndo, pptr, plen);
+    else {
+        pptr += sizeof(struct rsvp_common_header);
+        plen -= sizeof(struct rsvp_common_header);
+        while (plen >= sizeof(struct rsvp_common_header)) {
+            sublen = GET_BE_U_2(pptr + 6);
+            if (sublen < sizeof(struct rsvp_common_header) || sublen > plen)
+                break;
+            changed |= rsvp_msg_bindings(ndo, pptr, sublen);
+            pptr += sublen;
+            plen -= sublen;
+        }
+    }
+    if (!changed)
+        ndo->ndo_drop_line = 1;
+}
+
+void
+rsvp_print(netdissect_options *ndo,
+           const u_char *pptr, u_int len)
+{
+    rsvp_msg_print(ndo, pptr, len);
+    if (ndo->ndo_label_bindings)
+        rsvp_bindings(ndo, pptr, len);
+}
@@ -39,6 +39,7 @@
 #include <config.h>
 #endif
 
+#include <stddef.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -48,7 +49,9 @@
 #include "addrtoname.h"
 #include "extract.h"
 
+#include "callcache.h"
 #include "ip.h"
+#include "ip6.h"
 
 #define FS_RX_PORT	7000
 #define CB_RX_PORT	7001
@@ -478,24 +481,38 @@ static const struct tok rx_ack_reasons[] = {
  * numbers for replies.  This allows us to make sense of RX reply packets.
  */
 
-struct rx_cache_entry {
+struct rx_cache_key {
 	uint32_t	callnum;	/* Call number (net order) */
-	uint32_t	client;		/* client IP address (net order) */
-	uint32_t	server;		/* server IP address (net order) */
-	u_int		dport;		/* server port (host order) */
-	uint16_t	serviceId;	/* Service identifier (net order) */
+	uint32_t	cid;		/* Connection and channel (net order) */
+	uint32_t	ipver;		/* IP version (4 or 6) */
+	nd_ipv6		client;		/* client IP address (net order) */
+	nd_ipv6		server;		/* server IP address (net order) */
+	uint32_t	dport;		/* server port (host order) */
+	uint32_t	serviceId;	/* Service identifier (net order) */
+};
+
+struct rx_cache_entry {
+	struct callcache_entry ce;
+	struct rx_cache_key key;
 	uint32_t	opcode;		/* RX opcode (host order) */
 };
 
-#define RX_CACHE_SIZE	64
+/*
+ * The entries are in a callcache (see callcache.h); a call more than
+ * RX_CACHE_TIMEOUT seconds older than a reply isn't what it answers.
+ */
+#define RX_CACHE_TIMEOUT	120
 
-static struct rx_cache_entry	rx_cache[RX_CACHE_SIZE];
+static const struct callcache_type rx_cache_type = {
+	sizeof(struct rx_cache_entry),
+	offsetof(struct rx_cache_entry, key),
+	sizeof(struct rx_cache_key),
+	RX_CACHE_TIMEOUT
+};
 
-static uint32_t	rx_cache_next = 0;
-static uint32_t	rx_cache_hint = 0;
-static void	rx_cache_insert(netdissect_options *, const u_char *, const struct ip *, u_int);
+static void	rx_cache_insert(netdissect_options *, const u_char *, const u_char *, u_int);
 static int	rx_cache_find(netdissect_options *, const struct rx_header *,
-			      const struct ip *, uint32_t, uint32_t *);
+			      const u_char *, uint32_t, uint32_t *);
 
 static void fs_print(netdissect_options *, const u_char *, u_int);
 static void fs_reply_print(netdissect_options *, const u_char *, u_int, uint32_t);
@@ -597,7 +614,7 @@ rx_print(netdissect_options *ndo,
 		 * have a chance to print out replies
 		 */
 
-		rx_cache_insert(ndo, bp, (const struct ip *) bp2, dport);
+		rx_cache_insert(ndo, bp, bp2, dport);
 
 		switch (dport) {
 			case FS_RX_PORT:	/* AFS file service */
@@ -636,7 +653,7 @@ rx_print(netdissect_options *ndo,
 					GET_BE_U_4(rxh->seq) == 1) ||
 		    type == RX_PACKET_TYPE_ABORT) &&
 		   (flags & RX_CLIENT_INITIATED) == 0 &&
-		   rx_cache_find(ndo, rxh, (const struct ip *) bp2,
+		   rx_cache_find(ndo, rxh, bp2,
 				 sport, &opcode)) {
 
 		switch (sport) {
@@ -679,34 +696,66 @@ rx_print(netdissect_options *ndo,
 }
 
 /*
- * Insert an entry into the cache.  Taken from print-nfs.c
+ * Make the key for the call "rxh" from "src" to "dst" at the port
+ * "port" of the latter.  Returns 0 if it isn't over IPv4 or IPv6.
+ */
+
+static int
+rx_cache_key(netdissect_options *ndo, struct rx_cache_key *key,
+	     const struct rx_header *rxh, const u_char *bp2, int reply,
+	     u_int port)
+{
+	const struct ip *ip = (const struct ip *)bp2;
+	const struct ip6_hdr *ip6 = (const struct ip6_hdr *)bp2;
+	nd_ipv6 *src = reply ? &key->server : &key->client;
+	nd_ipv6 *dst = reply ? &key->client : &key->server;
+
+	memset(key, 0, sizeof(*key));
+	key->ipver = IP_V(ip);
+	switch (key->ipver) {
+	case 4:
+		GET_CPY_BYTES(src, ip->ip_src, sizeof(nd_ipv4));
+		GET_CPY_BYTES(dst, ip->ip_dst, sizeof(nd_ipv4));
+		break;
+	case 6:
+		GET_CPY_BYTES(src, ip6->ip6_src, sizeof(nd_ipv6));
+		GET_CPY_BYTES(dst, ip6->ip6_dst, sizeof(nd_ipv6));
+		break;
+	default:
+		return (0);
+	}
+	key->callnum = GET_BE_U_4(rxh->callNumber);
+	key->cid = GET_BE_U_4(rxh->cid);
+	key->dport = port;
+	key->serviceId = GET_BE_U_2(rxh->serviceId);
+	return (1);
+}
+
+/*
+ * Insert an entry into the cache.
  */
 
 static void
 rx_cache_insert(netdissect_options *ndo,
-                const u_char *bp, const struct ip *ip, u_int dport)
+                const u_char *bp, const u_char *bp2, u_int dport)
 {
 	struct rx_cache_entry *rxent;
+	struct rx_cache_key key;
 	const struct rx_header *rxh = (const struct rx_header *) bp;
 
 	if (!ND_TTEST_4(bp + sizeof(struct rx_header)))
 		return;
+	if (!rx_cache_key(ndo, &key, rxh, bp2, 0, dport))
+		return;
 
-	rxent = &rx_cache[rx_cache_next];
-
-	if (++rx_cache_next >= RX_CACHE_SIZE)
-		rx_cache_next = 0;
-
-	rxent->callnum = GET_BE_U_4(rxh->callNumber);
-	rxent->client = GET_IPV4_TO_NETWORK_ORDER(ip->ip_src);
-	rxent->server = GET_IPV4_TO_NETWORK_ORDER(ip->ip_dst);
-	rxent->dport = dport;
-	rxent->serviceId = GET_BE_U_2(rxh->serviceId);
-	rxent->opcode = GET_BE_U_4(bp + sizeof(struct rx_header));
+	rxent = (struct rx_cache_entry *)callcache_enter(ndo, &rx_cache_type,
+	    &key);
+	if (rxent != NULL)
+		rxent->opcode = GET_BE_U_4(bp + sizeof(struct rx_header));
 }
 
 /*
- * Lookup an entry in the cache.  Also taken from print-nfs.c
+ * Lookup an entry in the cache.
  *
  * Note that because this is a reply, we're looking at the _source_
  * port.
@@ -714,39 +763,22 @@ rx_cache_insert(netdissect_options *ndo,
 
 static int
 rx_cache_find(netdissect_options *ndo, const struct rx_header *rxh,
-	      const struct ip *ip, u_int sport, uint32_t *opcode)
+	      const u_char *bp2, u_int sport, uint32_t *opcode)
 {
-	uint32_t i;
 	struct rx_cache_entry *rxent;
-	uint32_t clip;
-	uint32_t sip;
-
-	clip = GET_IPV4_TO_NETWORK_ORDER(ip->ip_dst);
-	sip = GET_IPV4_TO_NETWORK_ORDER(ip->ip_src);
-
-	/* Start the search where we last left off */
+	struct rx_cache_key key;
 
-	i = rx_cache_hint;
-	do {
-		rxent = &rx_cache[i];
-		if (rxent->callnum == GET_BE_U_4(rxh->callNumber) &&
-		    rxent->client == clip &&
-		    rxent->server == sip &&
-		    rxent->serviceId == GET_BE_U_2(rxh->serviceId) &&
-		    rxent->dport == sport) {
-
-			/* We got a match! */
-
-			rx_cache_hint = i;
-			*opcode = rxent->opcode;
-			return(1);
-		}
-		if (++i >= RX_CACHE_SIZE)
-			i = 0;
-	} while (i != rx_cache_hint);
+	if (!rx_cache_key(ndo, &key, rxh, bp2, 1, sport))
+		return(0);
+	rxent = (struct rx_cache_entry *)callcache_find(ndo, &rx_cache_type, &key);
+	if (rxent == NULL) {
+		/* Our search failed */
+		return(0);
+	}
 
-	/* Our search failed */
-	return(0);
+	/* We got a match! */
+	*opcode = rxent->opcode;
+	return(1);
 }
 
 /*
@@ -798,11 +830,11 @@ rx_cache_find(netdissect_options *ndo, const struct rx_header *rxh,
 			ND_PRINT(" %" PRIu64, _i); \
 		}
 
-#define DATEOUT() { time_t _t; struct tm *tm; char str[256]; \
+#define DATEOUT() { time_t _t; struct tm tmbuf, *tm; char str[256]; \
 			ND_TCHECK_4(bp); \
 			_t = (time_t) GET_BE_S_4(bp); \
 			bp += sizeof(int32_t); \
-			tm = localtime(&_t); \
+			tm = nd_localtime(&_t, &tmbuf); \
 			strftime(str, 256, "%Y/%m/%d %H:%M:%S", tm); \
 			ND_PRINT(" %s", str); \
 		}
@@ -156,7 +156,7 @@ struct sctpHeader{
   nd_uint16_t source;
   nd_uint16_t destination;
   nd_uint32_t verificationTag;
-  nd_uint32_t adler32;
+  nd_uint32_t adler32;		/* now a CRC-32C; see RFC 3309 */
 };
 
 /* various descriptor parsers */
@@ -451,7 +451,8 @@ void
 sctp_print(netdissect_options *ndo,
 	   const u_char *bp,        /* beginning of sctp packet */
 	   const u_char *bp2,       /* beginning of enclosing */
-	   u_int sctpPacketLength)  /* ip packet */
+	   u_int sctpPacketLength,  /* ip packet */
+	   int fragmented)
 {
   u_int sctpPacketLengthRemaining;
   const struct sctpHeader *sctpPktHdr;
@@ -508,6 +509,29 @@ sctp_print(netdissect_options *ndo,
 	 isforces = 1;
   }
 
+  if (ndo->ndo_vflag && !ndo->ndo_Kflag && !fragmented &&
+      !ND_CKSUM_OFFLOADED(ndo) && ND_TTEST_LEN(bp, sctpPacketLength)) {
+    /*
+     * Check the CRC-32C (RFC 3309), computed with the checksum
+     * field set to zero; it's sent least significant byte first.
+     */
+    static const u_char zero_cksum[4];
+    uint32_t crc, sctp_sum;
+
+    crc = crc32c_cksum(0xffffffff, bp, 8);
+    crc = crc32c_cksum(crc, zero_cksum, 4);
+    crc = ~crc32c_cksum(crc, bp + sizeof(struct sctpHeader),
+			sctpPacketLength - sizeof(struct sctpHeader));
+    sctp_sum = GET_LE_U_4(sctpPktHdr->adler32);
+    if (crc != sctp_sum)
+      ND_PRINT(" [bad sctp cksum 0x%08x -> 0x%08x!]",
+	       GET_BE_U_4(sctpPktHdr->adler32),
+	       (crc >> 24) | ((crc >> 8) & 0xff00) |
+	       ((crc << 8) & 0xff0000) | (crc << 24));
+    else
+      ND_PRINT(" [sctp sum ok]");
+  }
+
   bp += sizeof(struct sctpHeader);
   sctpPacketLengthRemaining -= sizeof(struct sctpHeader);
 
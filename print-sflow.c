@@ -27,9 +27,13 @@
 
 #include "netdissect-stdinc.h"
 
+#include <string.h>
+
 #include "netdissect.h"
 #include "extract.h"
 #include "addrtoname.h"
+#include "flows.h"
+#include "ipproto.h"
 
 /*
  * sFlow datagram
@@ -164,6 +168,28 @@ struct sflow_expanded_flow_raw_t {
     nd_uint32_t header_size;
 };
 
+struct sflow_flow_ipv4_data_t {
+    nd_uint32_t length;
+    nd_uint32_t protocol;
+    nd_ipv4     src_ip;
+    nd_ipv4     dst_ip;
+    nd_uint32_t src_port;
+    nd_uint32_t dst_port;
+    nd_uint32_t tcp_flags;
+    nd_uint32_t tos;
+};
+
+struct sflow_flow_ipv6_data_t {
+    nd_uint32_t length;
+    nd_uint32_t protocol;
+    nd_ipv6     src_ip;
+    nd_ipv6     dst_ip;
+    nd_uint32_t src_port;
+    nd_uint32_t dst_port;
+    nd_uint32_t tcp_flags;
+    nd_uint32_t priority;
+};
+
 struct sflow_ethernet_frame_t {
     nd_uint32_t length;
     nd_byte     src_mac[8];
@@ -856,6 +882,146 @@ trunc:
     return 1;
 }
 
+/*
+ * With --flow-collector, add the packet sampled by a flow sample, as
+ * "rate" packets, to the flow table, from the first of its records
+ * that has its header or its IPv4 or IPv6 addresses and ports.  The
+ * sample is known to be captured.
+ */
+static void
+sflow_collect_flow_records(netdissect_options *ndo,
+                           const u_char *tptr, u_int tlen, u_int nrecords,
+                           u_int rate)
+{
+    const struct sflow_expanded_flow_raw_t *raw;
+    const struct sflow_flow_ipv4_data_t *ip4;
+    const struct sflow_flow_ipv6_data_t *ip6;
+    struct nd_flow_key key;
+    u_int flow_type, flow_len, protocol, length, stripped, header_size;
+
+    if (rate == 0)
+	rate = 1;
+    for (; nrecords > 0; nrecords--) {
+	if (tlen < sizeof(struct sflow_flow_record_t))
+	    return;
+	flow_type = GET_BE_U_4(tptr);	/* enterprise 0 only */
+	flow_len = GET_BE_U_4(tptr + 4);
+	tptr += sizeof(struct sflow_flow_record_t);
+	tlen -= sizeof(struct sflow_flow_record_t);
+	if (tlen < flow_len)
+	    return;
+
+	switch (flow_type) {
+	case SFLOW_FLOW_RAW_PACKET:
+	    if (flow_len < sizeof(struct sflow_expanded_flow_raw_t))
+		break;
+	    raw = (const struct sflow_expanded_flow_raw_t *)tptr;
+	    protocol = GET_BE_U_4(raw->protocol);
+	    length = GET_BE_U_4(raw->length);
+	    stripped = GET_BE_U_4(raw->stripped_bytes);
+	    header_size = GET_BE_U_4(raw->header_size);
+	    if (header_size > flow_len - sizeof(struct sflow_expanded_flow_raw_t) ||
+		(protocol != SFLOW_HEADER_PROTOCOL_ETHERNET &&
+		 protocol != SFLOW_HEADER_PROTOCOL_IPV4 &&
+		 protocol != SFLOW_HEADER_PROTOCOL_IPV6))
+		break;
+	    nd_flows_add_header(ndo, protocol == SFLOW_HEADER_PROTOCOL_ETHERNET,
+				tptr + sizeof(struct sflow_expanded_flow_raw_t),
+				header_size,
+				length > stripped ? length - stripped : length,
+				rate);
+	    return;
+
+	case SFLOW_FLOW_IPV4_DATA:
+	    if (flow_len < sizeof(struct sflow_flow_ipv4_data_t))
+		break;
+	    ip4 = (const struct sflow_flow_ipv4_data_t *)tptr;
+	    memset(&key, 0, sizeof(key));
+	    key.af = 4;
+	    GET_CPY_BYTES(key.src, ip4->src_ip, 4);
+	    GET_CPY_BYTES(key.dst, ip4->dst_ip, 4);
+	    key.proto = (uint8_t)GET_BE_U_4(ip4->protocol);
+	    if (key.proto == IPPROTO_TCP || key.proto == IPPROTO_UDP) {
+		key.sport = (uint16_t)GET_BE_U_4(ip4->src_port);
+		key.dport = (uint16_t)GET_BE_U_4(ip4->dst_port);
+	    }
+	    nd_flows_add(ndo, &key, rate,
+			 (uint64_t)rate * GET_BE_U_4(ip4->length), 0, 0,
+			 key.proto == IPPROTO_TCP ? GET_BE_U_4(ip4->tcp_flags) : 0);
+	    return;
+
+	case SFLOW_FLOW_IPV6_DATA:
+	    if (flow_len < sizeof(struct sflow_flow_ipv6_data_t))
+		break;
+	    ip6 = (const struct sflow_flow_ipv6_data_t *)tptr;
+	    memset(&key, 0, sizeof(key));
+	    key.af = 6;
+	    GET_CPY_BYTES(key.src, ip6->src_ip, 16);
+	    GET_CPY_BYTES(key.dst, ip6->dst_ip, 16);
+	    key.proto = (uint8_t)GET_BE_U_4(ip6->protocol);
+	    if (key.proto == IPPROTO_TCP || key.proto == IPPROTO_UDP) {
+		key.sport = (uint16_t)GET_BE_U_4(ip6->src_port);
+		key.dport = (uint16_t)GET_BE_U_4(ip6->dst_port);
+	    }
+	    nd_flows_add(ndo, &key, rate,
+			 (uint64_t)rate * GET_BE_U_4(ip6->length), 0, 0,
+			 key.proto == IPPROTO_TCP ? GET_BE_U_4(ip6->tcp_flags) : 0);
+	    return;
+	}
+	tptr += flow_len;
+	tlen -= flow_len;
+    }
+}
+
+/*
+ * With --flow-collector, add the packets sampled by the flow samples
+ * of a datagram, after its header, to the flow table, rather than
+ * printing them.
+ */
+static void
+sflow_collect(netdissect_options *ndo,
+              const u_char *tptr, u_int tlen, u_int nsamples)
+{
+    const struct sflow_flow_sample_t *fs;
+    const struct sflow_expanded_flow_sample_t *efs;
+    u_int sample_type, sample_len;
+
+    while (nsamples > 0 && tlen >= sizeof(struct sflow_sample_header)) {
+	sample_type = GET_BE_U_4(tptr) & 0x0FFF;
+	sample_len = GET_BE_U_4(tptr + 4);
+	tptr += sizeof(struct sflow_sample_header);
+	tlen -= sizeof(struct sflow_sample_header);
+	if (sample_type == 0 || sample_len == 0 || tlen < sample_len)
+	    return;
+	ND_TCHECK_LEN(tptr, sample_len);
+
+	if (sample_type == SFLOW_FLOW_SAMPLE &&
+	    sample_len >= sizeof(struct sflow_flow_sample_t)) {
+	    fs = (const struct sflow_flow_sample_t *)tptr;
+	    sflow_collect_flow_records(ndo,
+				       tptr + sizeof(struct sflow_flow_sample_t),
+				       sample_len - sizeof(struct sflow_flow_sample_t),
+				       GET_BE_U_4(fs->records),
+				       GET_BE_U_4(fs->rate));
+	} else if (sample_type == SFLOW_EXPANDED_FLOW_SAMPLE &&
+		   sample_len >= sizeof(struct sflow_expanded_flow_sample_t)) {
+	    efs = (const struct sflow_expanded_flow_sample_t *)tptr;
+	    sflow_collect_flow_records(ndo,
+				       tptr + sizeof(struct sflow_expanded_flow_sample_t),
+				       sample_len - sizeof(struct sflow_expanded_flow_sample_t),
+				       GET_BE_U_4(efs->records),
+				       GET_BE_U_4(efs->rate));
+	}
+	tptr += sample_len;
+	tlen -= sample_len;
+	nsamples--;
+    }
+    return;
+
+trunc:
+    nd_print_trunc(ndo);
+}
+
 void
 sflow_print(netdissect_options *ndo,
             const u_char *pptr, u_int len)
@@ -889,6 +1055,13 @@ sflow_print(netdissect_options *ndo,
         return;
     }
 
+    if (nd_flows_collecting(ndo)) {
+        sflow_collect(ndo, tptr + sizeof(struct sflow_datagram_t),
+                      tlen - sizeof(struct sflow_datagram_t),
+                      GET_BE_U_4(sflow_datagram->samples));
+        return;
+    }
+
     if (ndo->ndo_vflag < 1) {
         ND_PRINT("sFlowv%u, %s agent %s, agent-id %u, length %u",
                GET_BE_U_4(sflow_datagram->version),
@@ -48,8 +48,8 @@
 #define SLIPDIR_OUT 1
 
 
-static u_int lastlen[2][256];
-static u_int lastconn = 255;
+static ND_THREAD_LOCAL u_int lastlen[2][256];
+static ND_THREAD_LOCAL u_int lastconn = 255;
 
 static int sliplink_print(netdissect_options *, const u_char *, const struct ip *, u_int);
 static int compressed_sl_print(netdissect_options *, const u_char *, const struct ip *, u_int, int);
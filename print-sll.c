@@ -32,6 +32,7 @@
 #include "netdissect-stdinc.h"
 
 #include "netdissect.h"
+#include "netdissect-fields.h"
 #include "addrtoname.h"
 #include "ethertype.h"
 #include "extract.h"
@@ -234,6 +235,8 @@ sll_if_print(netdissect_options *ndo, const struct pcap_pkthdr *h, const u_char
 	}
 
 	sllp = (const struct sll_header *)p;
+	if (GET_BE_U_2(sllp->sll_pkttype) == LINUX_SLL_OUTGOING)
+		ndo->ndo_outgoing = 1;
 
 	if (ndo->ndo_eflag)
 		sll_print(ndo, sllp, length);
@@ -427,13 +430,34 @@ sll2_if_print(netdissect_options *ndo, const struct pcap_pkthdr *h, const u_char
 	}
 
 	sllp = (const struct sll2_header *)p;
+	if (GET_U_1(sllp->sll2_pkttype) == LINUX_SLL_OUTGOING)
+		ndo->ndo_outgoing = 1;
 #ifdef HAVE_NET_IF_H
+	/*
+	 * With structured output the text is thrown away, so don't look
+	 * up the interface's name for it.
+	 */
 	if_index = GET_BE_U_4(sllp->sll2_if_index);
-	if (if_indextoname(if_index, ifname))
+	if ((ndo->ndo_field == NULL || ndo->ndo_dfilter != NULL) &&
+	    if_indextoname(if_index, ifname))
 		ND_PRINT("ifindex %u (%s) ", if_index, ifname);
 	else
 		ND_PRINT("ifindex %u ", if_index);
 #endif
+	if (ndo->ndo_field != NULL) {
+		ND_FIELD_UINT(NDF_SLL2, NDF_SLL2_IFINDEX,
+		    GET_BE_U_4(sllp->sll2_if_index));
+		ND_FIELD_UINT(NDF_SLL2, NDF_SLL2_PROTO,
+		    GET_BE_U_2(sllp->sll2_protocol));
+		ND_FIELD_UINT(NDF_SLL2, NDF_SLL2_HATYPE,
+		    GET_BE_U_2(sllp->sll2_hatype));
+		ND_FIELD_UINT(NDF_SLL2, NDF_SLL2_PKTTYPE,
+		    GET_U_1(sllp->sll2_pkttype));
+		if (GET_U_1(sllp->sll2_halen) != 0 &&
+		    GET_U_1(sllp->sll2_halen) <= SLL_ADDRLEN)
+			ND_FIELD_ADDR(NDF_SLL2, NDF_SLL2_ADDR, sllp->sll2_addr,
+			    GET_U_1(sllp->sll2_halen));
+	}
 
 	if (ndo->ndo_eflag)
 		sll2_print(ndo, sllp, length);
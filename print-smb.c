@@ -21,8 +21,8 @@
 #include "smb.h"
 
 
-static int request = 0;
-static int unicodestr = 0;
+static ND_THREAD_LOCAL int request = 0;
+static ND_THREAD_LOCAL int unicodestr = 0;
 
 extern const u_char *startbuf;
 
@@ -64,6 +64,13 @@ struct smbfnsint
 
 #define FLG_CHAIN	(1 << 0)
 
+/*
+ * Does an SMB2 or SMB3 message, or the transform header of an encrypted
+ * or compressed one, start at "p"?
+ */
+#define smb2_magic(p) \
+    (GET_U_1(p) >= 0xFC && GET_U_1(p) <= 0xFE && memcmp((p) + 1, "SMB", 3) == 0)
+
 static const struct smbfns *
 smbfind(int id, const struct smbfns *list)
 {
@@ -110,7 +117,7 @@ static void
 trans2_qfsinfo(netdissect_options *ndo,
                const u_char *param, const u_char *data, u_int pcnt, u_int dcnt)
 {
-    static u_int level = 0;
+    static ND_THREAD_LOCAL u_int level = 0;
     const char *fmt="";
 
     if (request) {
@@ -940,7 +947,8 @@ trunc:
  */
 void
 nbt_tcp_print(netdissect_options *ndo,
-              const u_char *data, u_int length)
+              const u_char *data, u_int length, const u_char *iph,
+              u_int sport, u_int dport)
 {
     u_int caplen;
     u_int type;
@@ -1038,6 +1046,9 @@ nbt_tcp_print(netdissect_options *ndo,
 			    nbt_len - caplen);
 		}
 		print_smb(ndo, data, maxbuf > data + nbt_len ? data + nbt_len : maxbuf);
+	    } else if (nbt_len >= 4 && caplen >= 4 && smb2_magic(data)) {
+		smb2_print(ndo, data, min(nbt_len, length), iph, sport, dport);
+		ND_PRINT("\n");
 	    } else
 		ND_PRINT("Session packet:(raw data or continuation?)\n");
 	    break;
@@ -1258,7 +1269,8 @@ trunc:
  */
 void
 smb_tcp_print(netdissect_options *ndo,
-              const u_char * data, u_int length)
+              const u_char * data, u_int length, const u_char *iph,
+              u_int sport, u_int dport)
 {
     u_int caplen;
     u_int smb_len;
@@ -1290,6 +1302,9 @@ smb_tcp_print(netdissect_options *ndo,
 	} else
 	    ND_PRINT(" ");
 	print_smb(ndo, data, maxbuf > data + smb_len ? data + smb_len : maxbuf);
+    } else if (smb_len >= 4 && caplen >= 4 && smb2_magic(data)) {
+	ND_PRINT(" ");
+	smb2_print(ndo, data, min(smb_len, length), iph, sport, dport);
     } else
 	ND_PRINT(" SMB-over-TCP packet:(raw data or continuation?)\n");
     return;
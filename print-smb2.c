@@ -0,0 +1,673 @@
+/*
+ * Copyright (c) 2026 The TCPDUMP project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that: (1) source code
+ * distributions retain the above copyright notice and this paragraph
+ * in its entirety, and (2) distributions including binary code include
+ * the above copyright notice and this paragraph in its entirety in
+ * the documentation or other materials provided with the distribution.
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND
+ * WITHOUT ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, WITHOUT
+ * LIMITATION, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE.
+ */
+
+/* \summary: SMB2/SMB3 printer */
+
+/*
+ * See [MS-SMB2], "Server Message Block (SMB) Protocol Versions 2 and 3".
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include "netdissect-stdinc.h"
+
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "netdissect-ctype.h"
+
+#include "netdissect.h"
+#include "extract.h"
+#include "addrtoname.h"
+#include "ip.h"
+#include "ip6.h"
+#include "callcache.h"
+#include "latency.h"
+#include "smb.h"
+
+#define SMB2_HDR_LEN		64
+
+/* The header, in which the fields after Flags differ for async messages */
+#define SMB2_STATUS		8
+#define SMB2_COMMAND		12
+#define SMB2_CREDITS		14
+#define SMB2_FLAGS		16
+#define SMB2_NEXT_COMMAND	20
+#define SMB2_MESSAGE_ID		24
+#define SMB2_ASYNC_ID		32
+#define SMB2_TREE_ID		36
+#define SMB2_SESSION_ID		40
+
+#define SMB2_FLAGS_SERVER_TO_REDIR	0x00000001
+#define SMB2_FLAGS_ASYNC_COMMAND	0x00000002
+#define SMB2_FLAGS_RELATED_OPERATIONS	0x00000004
+
+/* The transform header of an encrypted message */
+#define SMB2_TRANSFORM_LEN	52
+#define SMB2_TRANSFORM_SIZE	36
+#define SMB2_TRANSFORM_SESSION	44
+
+#define SMB2_NEGOTIATE		0x0000
+#define SMB2_SESSION_SETUP	0x0001
+#define SMB2_LOGOFF		0x0002
+#define SMB2_TREE_CONNECT	0x0003
+#define SMB2_TREE_DISCONNECT	0x0004
+#define SMB2_CREATE		0x0005
+#define SMB2_CLOSE		0x0006
+#define SMB2_FLUSH		0x0007
+#define SMB2_READ		0x0008
+#define SMB2_WRITE		0x0009
+#define SMB2_LOCK		0x000A
+#define SMB2_IOCTL		0x000B
+#define SMB2_CANCEL		0x000C
+#define SMB2_ECHO		0x000D
+#define SMB2_QUERY_DIRECTORY	0x000E
+#define SMB2_CHANGE_NOTIFY	0x000F
+#define SMB2_QUERY_INFO		0x0010
+#define SMB2_SET_INFO		0x0011
+#define SMB2_OPLOCK_BREAK	0x0012
+
+static const struct tok smb2_cmd_str[] = {
+	{ SMB2_NEGOTIATE,	"NEGOTIATE" },
+	{ SMB2_SESSION_SETUP,	"SESSION_SETUP" },
+	{ SMB2_LOGOFF,		"LOGOFF" },
+	{ SMB2_TREE_CONNECT,	"TREE_CONNECT" },
+	{ SMB2_TREE_DISCONNECT,	"TREE_DISCONNECT" },
+	{ SMB2_CREATE,		"CREATE" },
+	{ SMB2_CLOSE,		"CLOSE" },
+	{ SMB2_FLUSH,		"FLUSH" },
+	{ SMB2_READ,		"READ" },
+	{ SMB2_WRITE,		"WRITE" },
+	{ SMB2_LOCK,		"LOCK" },
+	{ SMB2_IOCTL,		"IOCTL" },
+	{ SMB2_CANCEL,		"CANCEL" },
+	{ SMB2_ECHO,		"ECHO" },
+	{ SMB2_QUERY_DIRECTORY,	"QUERY_DIRECTORY" },
+	{ SMB2_CHANGE_NOTIFY,	"CHANGE_NOTIFY" },
+	{ SMB2_QUERY_INFO,	"QUERY_INFO" },
+	{ SMB2_SET_INFO,	"SET_INFO" },
+	{ SMB2_OPLOCK_BREAK,	"OPLOCK_BREAK" },
+	{ 0, NULL }
+};
+
+static const struct tok smb2_flag_str[] = {
+	{ 0x00000004,	"related" },
+	{ 0x00000008,	"signed" },
+	{ 0x10000000,	"dfs" },
+	{ 0x20000000,	"replay" },
+	{ 0, NULL }
+};
+
+static const struct tok smb2_dialect_str[] = {
+	{ 0x0202,	"2.0.2" },
+	{ 0x0210,	"2.1" },
+	{ 0x02FF,	"2.x" },
+	{ 0x0300,	"3.0" },
+	{ 0x0302,	"3.0.2" },
+	{ 0x0311,	"3.1.1" },
+	{ 0, NULL }
+};
+
+static const struct tok smb2_share_type_str[] = {
+	{ 1,	"disk" },
+	{ 2,	"pipe" },
+	{ 3,	"print" },
+	{ 0, NULL }
+};
+
+#define SMB2_STATUS_SUCCESS		0x00000000
+#define SMB2_STATUS_PENDING		0x00000103
+#define SMB2_STATUS_BUFFER_OVERFLOW	0x80000005
+
+#define SMB2_NAME_LEN		256
+
+/*
+ * The requests seen, for --latency-report, so that the first response
+ * to one can be counted against its command, and the READs and WRITEs
+ * against the share, by MessageId within the TCP connection; see
+ * callcache.h.  The trees connected to are kept the same way, by
+ * SessionId and TreeId, for the names of their shares.
+ */
+struct smb2_conn {
+	uint32_t ipver;
+	nd_ipv6 client;
+	nd_ipv6 server;
+	uint32_t cport;
+	uint32_t sport;
+};
+
+struct smb2_call_key {
+	struct smb2_conn conn;
+	uint64_t mid;
+};
+
+struct smb2_call_entry {
+	struct callcache_entry ce;
+	struct smb2_call_key key;
+	uint64_t sid;
+	uint32_t tid;
+	u_int command;
+	u_int answered;
+	char path[SMB2_SHARE_LEN];	/* for a TREE_CONNECT */
+};
+
+struct smb2_tree_key {
+	struct smb2_conn conn;
+	uint32_t tid;
+	uint64_t sid;
+};
+
+struct smb2_tree_entry {
+	struct callcache_entry ce;
+	struct smb2_tree_key key;
+	char share[SMB2_SHARE_LEN];
+};
+
+/*
+ * A request more than SMB2_CALL_TIMEOUT seconds older than a response
+ * isn't taken to be what it answers; a tree is kept until the cache
+ * is full.
+ */
+#define SMB2_CALL_TIMEOUT	120
+
+static const struct callcache_type smb2_call_type = {
+	sizeof(struct smb2_call_entry),
+	offsetof(struct smb2_call_entry, key),
+	sizeof(struct smb2_call_key),
+	SMB2_CALL_TIMEOUT
+};
+
+static const struct callcache_type smb2_tree_type = {
+	sizeof(struct smb2_tree_entry),
+	offsetof(struct smb2_tree_entry, key),
+	sizeof(struct smb2_tree_key),
+	0
+};
+
+/*
+ * The READ and WRITE bytes by share, in the order the shares were first
+ * counted.
+ */
+#define SMB2_SHARE_CHAINS	64
+
+struct smb2_share_entry {
+	struct smb2_share_stats ss;
+	struct smb2_share_entry *next;	/* on its hash chain */
+};
+
+static ND_THREAD_LOCAL struct smb2_share_entry *smb2_share_chains[SMB2_SHARE_CHAINS];
+static ND_THREAD_LOCAL struct smb2_share_entry **smb2_shares;
+static ND_THREAD_LOCAL u_int smb2_nshares, smb2_maxshares;
+
+/*
+ * Put the UTF-16LE string of "len" bytes at "p" into "buf", with
+ * anything other than printable ASCII as '.', as much of it as fits.
+ */
+static void
+smb2_string(netdissect_options *ndo, const u_char *p, u_int len,
+	    char *buf, size_t size)
+{
+	size_t l = 0;
+	u_int c;
+
+	for (; len >= 2 && l + 1 < size; p += 2, len -= 2) {
+		c = GET_LE_U_2(p);
+		buf[l++] = ND_ASCII_ISPRINT(c) ? (char)c : '.';
+	}
+	buf[l] = '\0';
+}
+
+/*
+ * Get the string at "off" from the start of the header "hdr", of "len"
+ * bytes, for a message that's "length" bytes long.
+ */
+static int
+smb2_get_string(netdissect_options *ndo, const u_char *hdr, u_int length,
+		u_int off, u_int len, char *buf, size_t size)
+{
+	buf[0] = '\0';
+	if (off < SMB2_HDR_LEN || off > length || len > length - off)
+		return (0);
+	smb2_string(ndo, hdr + off, len, buf, size);
+	return (1);
+}
+
+static int
+smb2_conn(netdissect_options *ndo, const u_char *iph, u_int sport,
+	  u_int dport, int response, struct smb2_conn *conn)
+{
+	const struct ip *ip = (const struct ip *)iph;
+	const struct ip6_hdr *ip6 = (const struct ip6_hdr *)iph;
+
+	memset(conn, 0, sizeof(*conn));
+	if (iph == NULL)
+		return (0);
+	conn->ipver = IP_V(ip);
+	switch (conn->ipver) {
+	case 4:
+		if (!ND_TTEST_SIZE(ip))
+			return (0);
+		memcpy(response ? &conn->server : &conn->client, ip->ip_src,
+		    sizeof(nd_ipv4));
+		memcpy(response ? &conn->client : &conn->server, ip->ip_dst,
+		    sizeof(nd_ipv4));
+		break;
+	case 6:
+		if (!ND_TTEST_SIZE(ip6))
+			return (0);
+		memcpy(response ? &conn->server : &conn->client, ip6->ip6_src,
+		    sizeof(nd_ipv6));
+		memcpy(response ? &conn->client : &conn->server, ip6->ip6_dst,
+		    sizeof(nd_ipv6));
+		break;
+	default:
+		return (0);
+	}
+	conn->cport = response ? dport : sport;
+	conn->sport = response ? sport : dport;
+	return (1);
+}
+
+static struct smb2_share_stats *
+smb2_share_lookup(netdissect_options *ndo, const char *share)
+{
+	struct smb2_share_entry *se, **sep;
+	uint32_t h = 2166136261U;
+	const char *p;
+
+	for (p = share; *p != '\0'; p++)
+		h = (h ^ (u_char)*p) * 16777619U;
+	sep = &smb2_share_chains[h % SMB2_SHARE_CHAINS];
+	for (se = *sep; se != NULL; se = se->next)
+		if (strcmp(se->ss.ss_share, share) == 0)
+			return (&se->ss);
+
+	if (smb2_nshares == smb2_maxshares) {
+		smb2_maxshares = smb2_maxshares ? smb2_maxshares * 2 : 16;
+		smb2_shares = (struct smb2_share_entry **)realloc(smb2_shares,
+		    smb2_maxshares * sizeof(*smb2_shares));
+		if (smb2_shares == NULL)
+			(*ndo->ndo_error)(ndo, S_ERR_ND_MEM_ALLOC,
+			    "%s: realloc", __func__);
+	}
+	se = (struct smb2_share_entry *)calloc(1, sizeof(*se));
+	if (se == NULL)
+		(*ndo->ndo_error)(ndo, S_ERR_ND_MEM_ALLOC, "%s: calloc",
+		    __func__);
+	strlcpy(se->ss.ss_share, share, sizeof(se->ss.ss_share));
+	se->next = *sep;
+	*sep = se;
+	smb2_shares[smb2_nshares++] = se;
+	return (&se->ss);
+}
+
+/*
+ * Count the "bytes" read or written by the call "sce" against the share
+ * of its tree.
+ */
+static void
+smb2_share_count(netdissect_options *ndo, const struct smb2_call_entry *sce,
+		 int write, uint64_t bytes)
+{
+	struct smb2_tree_key key;
+	struct smb2_tree_entry *ste;
+	struct smb2_share_stats *ss;
+	char share[SMB2_SHARE_LEN];
+
+	memset(&key, 0, sizeof(key));
+	key.conn = sce->key.conn;
+	key.sid = sce->sid;
+	key.tid = sce->tid;
+	ste = (struct smb2_tree_entry *)callcache_find(ndo, &smb2_tree_type, &key);
+	if (ste != NULL)
+		strlcpy(share, ste->share, sizeof(share));
+	else
+		snprintf(share, sizeof(share), "tree 0x%08x on %s", sce->tid,
+		    key.conn.ipver == 4 ?
+		    ipaddr_string(ndo, (const u_char *)&key.conn.server) :
+		    ip6addr_string(ndo, (const u_char *)&key.conn.server));
+	ss = smb2_share_lookup(ndo, share);
+	if (ss->ss_reads == 0 && ss->ss_writes == 0)
+		ss->ss_first_ts = sce->ce.cce_ts;
+	ss->ss_last_ts = ndo->ndo_packet_ts;
+	if (write) {
+		ss->ss_writes++;
+		ss->ss_write_bytes += bytes;
+	} else {
+		ss->ss_reads++;
+		ss->ss_read_bytes += bytes;
+	}
+}
+
+/*
+ * Call "fn" for each share of this thread that has had READs or WRITEs
+ * counted, in the order they were first counted.
+ */
+void
+smb2_share_foreach(smb2_share_fn fn, void *arg)
+{
+	u_int i;
+
+	for (i = 0; i < smb2_nshares; i++)
+		if (smb2_shares[i]->ss.ss_reads != 0 ||
+		    smb2_shares[i]->ss.ss_writes != 0)
+			(*fn)(arg, &smb2_shares[i]->ss);
+}
+
+/*
+ * Empty this thread's share counts, as for a new reporting interval.
+ */
+void
+smb2_share_reset(void)
+{
+	struct smb2_share_stats *ss;
+	u_int i;
+
+	for (i = 0; i < smb2_nshares; i++) {
+		ss = &smb2_shares[i]->ss;
+		ss->ss_reads = ss->ss_read_bytes = 0;
+		ss->ss_writes = ss->ss_write_bytes = 0;
+	}
+}
+
+/*
+ * Enter the request "hdr", of "length" bytes, for --latency-report.
+ */
+static void
+smb2_call_enter(netdissect_options *ndo, const struct smb2_conn *conn,
+		const u_char *hdr, u_int length, u_int command, uint64_t sid,
+		uint32_t tid)
+{
+	struct smb2_call_key key;
+	struct smb2_call_entry *sce;
+	const u_char *body = hdr + SMB2_HDR_LEN;
+
+	/* A CANCEL has the MessageId of the request it cancels. */
+	if (command == SMB2_CANCEL)
+		return;
+	memset(&key, 0, sizeof(key));
+	key.conn = *conn;
+	key.mid = GET_LE_U_8(hdr + SMB2_MESSAGE_ID);
+	sce = (struct smb2_call_entry *)callcache_enter(ndo, &smb2_call_type,
+	    &key);
+	if (sce == NULL)
+		return;
+	sce->sid = sid;
+	sce->tid = tid;
+	sce->command = command;
+	sce->answered = 0;
+	sce->path[0] = '\0';
+	if (command == SMB2_TREE_CONNECT && length >= SMB2_HDR_LEN + 8)
+		(void)smb2_get_string(ndo, hdr, length, GET_LE_U_2(body + 4),
+		    GET_LE_U_2(body + 6), sce->path, sizeof(sce->path));
+}
+
+/*
+ * Count the time to the response "hdr", of "length" bytes, from its
+ * request, and what a READ or WRITE moved, for --latency-report.
+ */
+static void
+smb2_call_answer(netdissect_options *ndo, const struct smb2_conn *conn,
+		 const u_char *hdr, u_int length, u_int command,
+		 uint32_t status)
+{
+	struct smb2_call_key key;
+	struct smb2_call_entry *sce;
+	struct smb2_tree_key tkey;
+	struct smb2_tree_entry *ste;
+	const u_char *body = hdr + SMB2_HDR_LEN;
+
+	/* An interim response; the real one comes later. */
+	if (status == SMB2_STATUS_PENDING &&
+	    (GET_LE_U_4(hdr + SMB2_FLAGS) & SMB2_FLAGS_ASYNC_COMMAND))
+		return;
+	memset(&key, 0, sizeof(key));
+	key.conn = *conn;
+	key.mid = GET_LE_U_8(hdr + SMB2_MESSAGE_ID);
+	sce = (struct smb2_call_entry *)callcache_find(ndo, &smb2_call_type, &key);
+	if (sce == NULL || sce->answered || sce->command != command)
+		return;
+	sce->answered = 1;
+	/* A CHANGE_NOTIFY waits for something to change. */
+	if (command != SMB2_CHANGE_NOTIFY)
+		latency_record(ndo, "smb2", tok2str(smb2_cmd_str, "cmd-%u",
+		    command), sce->ce.cce_ts);
+	if (status != SMB2_STATUS_SUCCESS &&
+	    !(command == SMB2_READ && status == SMB2_STATUS_BUFFER_OVERFLOW))
+		return;
+	switch (command) {
+
+	case SMB2_TREE_CONNECT:
+		memset(&tkey, 0, sizeof(tkey));
+		tkey.conn = *conn;
+		tkey.sid = GET_LE_U_8(hdr + SMB2_SESSION_ID);
+		tkey.tid = GET_LE_U_4(hdr + SMB2_TREE_ID);
+		ste = (struct smb2_tree_entry *)callcache_enter(ndo,
+		    &smb2_tree_type, &tkey);
+		if (ste != NULL)
+			strlcpy(ste->share, sce->path, sizeof(ste->share));
+		break;
+
+	case SMB2_READ:
+	case SMB2_WRITE:
+		if (length < SMB2_HDR_LEN + 8)
+			break;
+		smb2_share_count(ndo, sce, command == SMB2_WRITE,
+		    GET_LE_U_4(body + 4));
+		break;
+	}
+}
+
+static void
+smb2_print_fid(netdissect_options *ndo, const u_char *p)
+{
+	if (ndo->ndo_vflag)
+		ND_PRINT(", fid 0x%" PRIx64 ":0x%" PRIx64, GET_LE_U_8(p),
+		    GET_LE_U_8(p + 8));
+}
+
+/*
+ * Print what's worth knowing of the body of the message "hdr", of
+ * "length" bytes.
+ */
+static void
+smb2_print_body(netdissect_options *ndo, const u_char *hdr, u_int length,
+		u_int command, int response, uint32_t status)
+{
+	const u_char *body = hdr + SMB2_HDR_LEN;
+	u_int blen = length - SMB2_HDR_LEN;
+	char name[SMB2_NAME_LEN];
+	u_int count, i;
+	const char *sep;
+
+	if (response && status != SMB2_STATUS_SUCCESS &&
+	    !(command == SMB2_READ && status == SMB2_STATUS_BUFFER_OVERFLOW))
+		return;
+	switch (command) {
+
+	case SMB2_NEGOTIATE:
+		if (!response) {
+			if (blen < 36)
+				break;
+			count = GET_LE_U_2(body + 2);
+			if (count > (blen - 36) / 2)
+				count = (blen - 36) / 2;
+			ND_PRINT(", dialects [");
+			sep = "";
+			for (i = 0; i < count; i++) {
+				ND_PRINT("%s%s", sep, tok2str(smb2_dialect_str,
+				    "0x%04x", GET_LE_U_2(body + 36 + i * 2)));
+				sep = ", ";
+			}
+			ND_PRINT("]");
+		} else if (blen >= 6)
+			ND_PRINT(", dialect %s", tok2str(smb2_dialect_str,
+			    "0x%04x", GET_LE_U_2(body + 4)));
+		break;
+
+	case SMB2_TREE_CONNECT:
+		if (!response) {
+			if (blen >= 8 && smb2_get_string(ndo, hdr, length,
+			    GET_LE_U_2(body + 4), GET_LE_U_2(body + 6), name,
+			    sizeof(name)))
+				ND_PRINT(", path %s", name);
+		} else if (blen >= 3)
+			ND_PRINT(", %s share", tok2str(smb2_share_type_str,
+			    "type-%u", GET_U_1(body + 2)));
+		break;
+
+	case SMB2_CREATE:
+		if (!response) {
+			if (blen >= 48 && smb2_get_string(ndo, hdr, length,
+			    GET_LE_U_2(body + 44), GET_LE_U_2(body + 46), name,
+			    sizeof(name)))
+				ND_PRINT(", name \"%s\"", name);
+		} else if (blen >= 80) {
+			ND_PRINT(", size %" PRIu64, GET_LE_U_8(body + 48));
+			smb2_print_fid(ndo, body + 64);
+		}
+		break;
+
+	case SMB2_CLOSE:
+		if (!response && blen >= 24)
+			smb2_print_fid(ndo, body + 8);
+		break;
+
+	case SMB2_READ:
+	case SMB2_WRITE:
+		if (!response) {
+			if (blen < 32)
+				break;
+			ND_PRINT(", length %u, offset %" PRIu64,
+			    GET_LE_U_4(body + 4), GET_LE_U_8(body + 8));
+			smb2_print_fid(ndo, body + 16);
+		} else if (blen >= 8)
+			ND_PRINT(", %s %u", command == SMB2_READ ?
+			    "length" : "count", GET_LE_U_4(body + 4));
+		break;
+	}
+}
+
+/*
+ * Print the SMB2 or SMB3 message "bp", of "length" bytes, or the
+ * transform header of an encrypted or compressed one, which came from
+ * port "sport" to port "dport" in the IPv4 or IPv6 datagram "iph".
+ */
+void
+smb2_print(netdissect_options *ndo, const u_char *bp, u_int length,
+	   const u_char *iph, u_int sport, u_int dport)
+{
+	const u_char *hdr = bp;
+	struct smb2_conn conn;
+	u_int command, flags, next, len, msgs = 0;
+	uint32_t status, tid = 0;
+	uint64_t sid = 0;
+	int response, have_conn = -1;
+
+	ndo->ndo_protocol = "smb2";
+	switch (GET_U_1(bp)) {
+
+	case 0xFD:
+		ND_PRINT("SMB3 encrypted");
+		if (length >= SMB2_TRANSFORM_LEN)
+			ND_PRINT(", sid 0x%016" PRIx64 ", length %u",
+			    GET_LE_U_8(bp + SMB2_TRANSFORM_SESSION),
+			    GET_LE_U_4(bp + SMB2_TRANSFORM_SIZE));
+		return;
+
+	case 0xFC:
+		ND_PRINT("SMB3 compressed");
+		if (length >= 8)
+			ND_PRINT(", length %u", GET_LE_U_4(bp + 4));
+		return;
+	}
+
+	for (;;) {
+		if (length < SMB2_HDR_LEN) {
+			nd_print_invalid(ndo);
+			return;
+		}
+		if (GET_LE_U_2(hdr + 4) != SMB2_HDR_LEN) {
+			ND_PRINT("SMB2 bad header size %u",
+			    GET_LE_U_2(hdr + 4));
+			return;
+		}
+		flags = GET_LE_U_4(hdr + SMB2_FLAGS);
+		command = GET_LE_U_2(hdr + SMB2_COMMAND);
+		response = (flags & SMB2_FLAGS_SERVER_TO_REDIR) != 0;
+		status = GET_LE_U_4(hdr + SMB2_STATUS);
+		next = GET_LE_U_4(hdr + SMB2_NEXT_COMMAND);
+		len = (next != 0 && next < length) ? next : length;
+
+		/* A related operation can leave these to the one before. */
+		if (!(flags & SMB2_FLAGS_RELATED_OPERATIONS) ||
+		    GET_LE_U_8(hdr + SMB2_SESSION_ID) != UINT64_MAX)
+			sid = GET_LE_U_8(hdr + SMB2_SESSION_ID);
+		if (!(flags & SMB2_FLAGS_ASYNC_COMMAND) &&
+		    (!(flags & SMB2_FLAGS_RELATED_OPERATIONS) ||
+		     GET_LE_U_4(hdr + SMB2_TREE_ID) != UINT32_MAX))
+			tid = GET_LE_U_4(hdr + SMB2_TREE_ID);
+
+		if (msgs++ != 0)
+			ND_PRINT("; ");
+		ND_PRINT("SMB2 %s %s, mid %" PRIu64,
+		    tok2str(smb2_cmd_str, "cmd-%u", command),
+		    response ? "response" : "request",
+		    GET_LE_U_8(hdr + SMB2_MESSAGE_ID));
+		if (response && status != SMB2_STATUS_SUCCESS)
+			ND_PRINT(", %s", nt_errstr(status));
+		if (ndo->ndo_vflag) {
+			ND_PRINT(", sid 0x%016" PRIx64, sid);
+			if (flags & SMB2_FLAGS_ASYNC_COMMAND)
+				ND_PRINT(", async 0x%" PRIx64,
+				    GET_LE_U_8(hdr + SMB2_ASYNC_ID));
+			else
+				ND_PRINT(", tid 0x%08x", tid);
+			ND_PRINT(", credits %u", GET_LE_U_2(hdr + SMB2_CREDITS));
+			if (flags & ~(SMB2_FLAGS_SERVER_TO_REDIR |
+			    SMB2_FLAGS_ASYNC_COMMAND))
+				ND_PRINT(", flags [%s]",
+				    bittok2str(smb2_flag_str, "0x%x", flags &
+				    ~(SMB2_FLAGS_SERVER_TO_REDIR |
+				    SMB2_FLAGS_ASYNC_COMMAND)));
+		}
+		smb2_print_body(ndo, hdr, len, command, response, status);
+
+		if (ndo->ndo_latency) {
+			if (have_conn < 0)
+				have_conn = smb2_conn(ndo, iph, sport, dport,
+				    response, &conn);
+			if (have_conn && response)
+				smb2_call_answer(ndo, &conn, hdr, len, command,
+				    status);
+			else if (have_conn)
+				smb2_call_enter(ndo, &conn, hdr, len, command,
+				    sid, tid);
+		}
+
+		if (next == 0)
+			break;
+		if (next < SMB2_HDR_LEN || next >= length) {
+			ND_PRINT("; bad next command offset %u", next);
+			return;
+		}
+		hdr += next;
+		length -= next;
+	}
+}
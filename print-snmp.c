@@ -65,6 +65,7 @@
 #include "netdissect-stdinc.h"
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
 #ifdef USE_LIBSMI
@@ -954,6 +955,80 @@ trunc:
 	return -1;
 }
 
+/*
+ * smiGetNodeByOID() walks the MIB tree, and pollers ask for the same
+ * objects over and over, so the node for each OID, as encoded, and
+ * the decoded OID are kept in a hash table of a fixed size, one entry
+ * a slot, the newest OID in a slot replacing the last.  The modules
+ * are all loaded before any packet is looked at, so a node found, or
+ * not found, stays right.
+ */
+#define SMI_CACHE_SIZE		256	/* OIDs, a power of 2 */
+#define SMI_CACHE_OID_LEN	48	/* longest encoded OID kept */
+
+struct smi_cache_entry {
+	u_int sce_len;			/* encoded length, 0 = unused */
+	u_char sce_encoded[SMI_CACHE_OID_LEN];
+	SmiNode *sce_node;		/* NULL if not in the MIB */
+	unsigned int sce_oidlen;
+	unsigned int sce_oid[SMI_CACHE_OID_LEN + 1];
+};
+
+static ND_THREAD_LOCAL struct smi_cache_entry *smi_cache;
+
+/*
+ * Decode the OID in "elem" into "oid", as smi_decode_oid() does, and
+ * return its node in the loaded MIB modules, or NULL if there's none.
+ * "*status" is set to -1 if the OID was cut short.
+ */
+static SmiNode *
+smi_lookup_oid(netdissect_options *ndo,
+               struct be *elem, unsigned int *oid,
+               unsigned int oidsize, unsigned int *oidlen, int *status)
+{
+	const u_char *p = (const u_char *)elem->data.raw;
+	uint32_t asnlen = elem->asnlen;
+	struct smi_cache_entry *sce = NULL;
+	uint32_t h = 2166136261U;
+	SmiNode *smiNode;
+	uint32_t i;
+
+	if (asnlen != 0 && asnlen <= SMI_CACHE_OID_LEN &&
+	    ND_TTEST_LEN(p, asnlen)) {
+		if (smi_cache == NULL) {
+			smi_cache = (struct smi_cache_entry *)calloc(
+			    SMI_CACHE_SIZE, sizeof(*smi_cache));
+			if (smi_cache == NULL)
+				(*ndo->ndo_error)(ndo, S_ERR_ND_MEM_ALLOC,
+				    "%s: calloc", __func__);
+		}
+		for (i = 0; i < asnlen; i++)
+			h = (h ^ p[i]) * 16777619U;
+		sce = &smi_cache[h & (SMI_CACHE_SIZE - 1)];
+		if (sce->sce_len == asnlen &&
+		    memcmp(sce->sce_encoded, p, asnlen) == 0) {
+			*oidlen = sce->sce_oidlen < oidsize ?
+			    sce->sce_oidlen : oidsize;
+			memcpy(oid, sce->sce_oid, *oidlen * sizeof(*oid));
+			*status = 0;
+			return sce->sce_node;
+		}
+	}
+
+	*status = smi_decode_oid(ndo, elem, oid, oidsize, oidlen);
+	if (*status < 0)
+		return NULL;
+	smiNode = smiGetNodeByOID(*oidlen, oid);
+	if (sce != NULL && *oidlen <= SMI_CACHE_OID_LEN + 1) {
+		sce->sce_len = asnlen;
+		memcpy(sce->sce_encoded, p, asnlen);
+		sce->sce_node = smiNode;
+		sce->sce_oidlen = *oidlen;
+		memcpy(sce->sce_oid, oid, *oidlen * sizeof(*oid));
+	}
+	return smiNode;
+}
+
 static int smi_check_type(SmiBasetype basetype, int be)
 {
     int i;
@@ -1052,15 +1127,14 @@ smi_print_variable(netdissect_options *ndo,
 	SmiNode *smiNode = NULL;
 	unsigned int i;
 
-	if (!nd_smi_module_loaded) {
+	if (!nd_smi_modules_ready(ndo)) {
 		*status = asn1_print(ndo, elem);
 		return NULL;
 	}
-	*status = smi_decode_oid(ndo, elem, oid, sizeof(oid) / sizeof(unsigned int),
-	    &oidlen);
+	smiNode = smi_lookup_oid(ndo, elem, oid,
+	    sizeof(oid) / sizeof(unsigned int), &oidlen, status);
 	if (*status < 0)
 		return NULL;
-	smiNode = smiGetNodeByOID(oidlen, oid);
 	if (! smiNode) {
 		*status = asn1_print(ndo, elem);
 		return NULL;
@@ -1085,7 +1159,7 @@ smi_print_value(netdissect_options *ndo,
 	unsigned int i, oid[128], oidlen;
 	SmiType *smiType;
 	SmiNamedNumber *nn;
-	int done = 0;
+	int done = 0, status;
 
 	if (! smiNode || ! (smiNode->nodekind
 			    & (SMI_NODEKIND_SCALAR | SMI_NODEKIND_COLUMN))) {
@@ -1141,12 +1215,11 @@ smi_print_value(netdissect_options *ndo,
 	        if (smiType->basetype == SMI_BASETYPE_BITS) {
 		        /* print bit labels */
 		} else {
-			if (nd_smi_module_loaded &&
-			    smi_decode_oid(ndo, elem, oid,
-					   sizeof(oid)/sizeof(unsigned int),
-					   &oidlen) == 0) {
-				smiNode = smiGetNodeByOID(oidlen, oid);
-				if (smiNode) {
+			if (nd_smi_modules_ready(ndo)) {
+				smiNode = smi_lookup_oid(ndo, elem, oid,
+				    sizeof(oid)/sizeof(unsigned int),
+				    &oidlen, &status);
+				if (status == 0 && smiNode) {
 				        if (ndo->ndo_vflag) {
 						ND_PRINT("%s::", smiGetNodeModule(smiNode)->name);
 					}
@@ -20,8 +20,16 @@
 #endif
 
 #include "netdissect-stdinc.h"
+
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
 #include "netdissect.h"
+#include "callcache.h"
 #include "extract.h"
+#include "latency.h"
 #include "udp.h"
 
 /*
@@ -76,6 +84,189 @@ static const struct tok return_code_values[] = {
     { 0, NULL }
 };
 
+#define SOMEIP_REQUEST              0x00
+#define SOMEIP_REQUEST_NO_RETURN    0x01
+#define SOMEIP_NOTIFICATION         0x02
+#define SOMEIP_RESPONSE             0x80
+#define SOMEIP_ERROR                0x81
+#define SOMEIP_TP_FLAG              0x20
+
+/*
+ * --someip-summary: the messages of each method and event of each
+ * service are counted, and each response is paired, by service, method,
+ * client and session, with the request it answers, through the call
+ * cache, and timed, for --latency-report too.  The table of methods is
+ * per thread, so counting takes no locks.
+ */
+#define SOMEIP_CHAINS       1024
+#define SOMEIP_CALL_TIMEOUT 60
+
+struct someip_method {
+    struct someip_method_stats stats;
+    uint64_t second;                /* the second "in_second" were in */
+    u_int in_second;
+    struct someip_method *next;     /* on its hash chain */
+};
+
+static ND_THREAD_LOCAL struct someip_method *someip_chains[SOMEIP_CHAINS];
+static ND_THREAD_LOCAL struct someip_method **someip_methods; /* in order made */
+static ND_THREAD_LOCAL u_int someip_nmethods, someip_maxmethods;
+
+struct someip_call_key {
+    uint16_t service;
+    uint16_t method;
+    uint16_t client;
+    uint16_t session;
+};
+
+struct someip_call_entry {
+    struct callcache_entry ce;
+    struct someip_call_key key;
+    uint8_t answered;       /* its first response has been counted */
+};
+
+static const struct callcache_type someip_call_type = {
+    sizeof(struct someip_call_entry),
+    offsetof(struct someip_call_entry, key),
+    sizeof(struct someip_call_key),
+    SOMEIP_CALL_TIMEOUT
+};
+
+static struct someip_method *
+someip_method_find(netdissect_options *ndo, uint16_t service, uint16_t method)
+{
+    struct someip_method *sm, **smp;
+
+    smp = &someip_chains[((uint32_t)service << 16 | method) * 2654435761U %
+        SOMEIP_CHAINS];
+    for (sm = *smp; sm != NULL; sm = sm->next)
+        if (sm->stats.sms_service == service &&
+            sm->stats.sms_method == method)
+            return sm;
+
+    if (someip_nmethods == someip_maxmethods) {
+        someip_maxmethods = someip_maxmethods ? someip_maxmethods * 2 : 64;
+        someip_methods = (struct someip_method **)realloc(someip_methods,
+            someip_maxmethods * sizeof(*someip_methods));
+        if (someip_methods == NULL)
+            (*ndo->ndo_error)(ndo, S_ERR_ND_MEM_ALLOC, "%s: realloc",
+                __func__);
+    }
+    sm = (struct someip_method *)calloc(1, sizeof(*sm));
+    if (sm == NULL)
+        (*ndo->ndo_error)(ndo, S_ERR_ND_MEM_ALLOC, "%s: calloc", __func__);
+    sm->stats.sms_service = service;
+    sm->stats.sms_method = method;
+    sm->next = *smp;
+    *smp = sm;
+    someip_methods[someip_nmethods++] = sm;
+    return sm;
+}
+
+/*
+ * Count the message, enter it in the call cache if it's a request and
+ * time it if it's a response to one; return the response time, in
+ * microseconds, with "*timed" set, for a response that was matched.
+ */
+static uint64_t
+someip_count(netdissect_options *ndo, uint32_t message_id,
+             uint32_t request_id, uint8_t message_type, uint8_t return_code,
+             int *timed)
+{
+    struct someip_method *sm = NULL;
+    struct someip_method_stats *st = NULL;
+    struct someip_call_entry *sce;
+    struct someip_call_key key;
+    char what[LATENCY_WHAT_LEN];
+    uint64_t now, us = 0;
+
+    *timed = 0;
+    if (ndo->ndo_someip_summary) {
+        sm = someip_method_find(ndo, message_id >> 16, message_id & 0xffff);
+        st = &sm->stats;
+        now = (uint64_t)ND_TS_USEC(ndo->ndo_packet_ts);
+        if (st->sms_messages++ == 0)
+            st->sms_first_us = now;
+        st->sms_last_us = now;
+        if (st->sms_messages == 1 ||
+            ndo->ndo_packet_sec != (time_t)sm->second) {
+            sm->second = ndo->ndo_packet_sec;
+            sm->in_second = 0;
+        }
+        if (++sm->in_second > st->sms_peak)
+            st->sms_peak = sm->in_second;
+    }
+
+    memset(&key, 0, sizeof(key));
+    key.service = message_id >> 16;
+    key.method = message_id & 0xffff;
+    key.client = request_id >> 16;
+    key.session = request_id & 0xffff;
+    switch (message_type & ~SOMEIP_TP_FLAG) {
+    case SOMEIP_REQUEST:
+        if (st != NULL)
+            st->sms_requests++;
+        sce = (struct someip_call_entry *)callcache_enter(ndo,
+            &someip_call_type, &key);
+        if (sce != NULL)
+            sce->answered = 0;
+        break;
+    case SOMEIP_REQUEST_NO_RETURN:
+        if (st != NULL)
+            st->sms_no_return++;
+        break;
+    case SOMEIP_NOTIFICATION:
+        if (st != NULL)
+            st->sms_notifications++;
+        break;
+    case SOMEIP_RESPONSE:
+    case SOMEIP_ERROR:
+        if (st != NULL) {
+            st->sms_responses++;
+            if ((message_type & ~SOMEIP_TP_FLAG) == SOMEIP_ERROR ||
+                return_code != 0)
+                st->sms_errors++;
+        }
+        sce = (struct someip_call_entry *)callcache_find(ndo,
+            &someip_call_type, &key);
+        if (sce == NULL) {
+            if (st != NULL)
+                st->sms_unmatched++;
+            break;
+        }
+        if (ndo->ndo_latency && !sce->answered) {
+            snprintf(what, sizeof(what), "0x%04x.0x%04x", key.service,
+                key.method);
+            us = latency_record(ndo, "someip", what, sce->ce.cce_ts);
+        } else
+            us = latency_elapsed(ndo, sce->ce.cce_ts);
+        if (st != NULL && !sce->answered) {
+            if (st->sms_timed++ == 0 || us < st->sms_rtt_min_us)
+                st->sms_rtt_min_us = us;
+            if (us > st->sms_rtt_max_us)
+                st->sms_rtt_max_us = us;
+            st->sms_rtt_total_us += us;
+        }
+        sce->answered = 1;
+        *timed = 1;
+        break;
+    }
+    return us;
+}
+
+/*
+ * Call "fn" for each method and event of this thread that messages have
+ * been counted for, in the order they were first seen.
+ */
+void
+someip_method_foreach(someip_method_fn fn, void *arg)
+{
+    u_int i;
+
+    for (i = 0; i < someip_nmethods; i++)
+        (*fn)(arg, &someip_methods[i]->stats);
+}
+
 void
 someip_print(netdissect_options *ndo, const u_char *bp, u_int len)
 {
@@ -91,6 +282,8 @@ someip_print(netdissect_options *ndo, const u_char *bp, u_int len)
     uint8_t interface_version;
     uint8_t message_type;
     uint8_t return_code;
+    uint64_t us;
+    int timed;
 
     ndo->ndo_protocol = "someip";
 
@@ -125,12 +318,28 @@ someip_print(netdissect_options *ndo, const u_char *bp, u_int len)
     return_code = GET_U_1(bp);
     bp += 1;
 
+    us = 0;
+    timed = 0;
+    if (ndo->ndo_someip_summary || ndo->ndo_latency) {
+        us = someip_count(ndo, message_id, request_id, message_type,
+                          return_code, &timed);
+        /* With --someip-summary, only -vv and up print each message. */
+        if (ndo->ndo_someip_summary && ndo->ndo_vflag < 2) {
+            ndo->ndo_drop_line = 1;
+            return;
+        }
+    }
+
     ND_PRINT("SOMEIP, service %u, %s %u, len %u, client %u, session %u, "
-	     "pver %u, iver %u, msgtype %s, retcode %s\n",
+	     "pver %u, iver %u, msgtype %s, retcode %s",
 	     service_id, event_flag ? "event" : "method", method_or_event_id,
 	     message_len, client_id, session_id, protocol_version,
 	     interface_version,
 	     tok2str(message_type_values, "Unknown", message_type),
 	     tok2str(return_code_values, "Unknown", return_code));
+    if (timed)
+        ND_PRINT(", response time %" PRIu64 ".%03u ms", us / 1000,
+                 (u_int)(us % 1000));
+    ND_PRINT("\n");
     return;
 }
@@ -20,6 +20,7 @@
 
 #include "netdissect.h"
 #include "extract.h"
+#include "change-only.h"
 
 #define	RSTP_EXTRACT_PORT_ROLE(x) (((x)&0x0C)>>2)
 /* STP timers are expressed in multiples of 1/256th second */
@@ -89,7 +90,7 @@ static const struct tok rstp_obj_port_role_values[] = {
 static char *
 stp_print_bridge_id(netdissect_options *ndo, const u_char *p)
 {
-    static char bridge_id_str[sizeof("pppp.aa:bb:cc:dd:ee:ff")];
+    static ND_THREAD_LOCAL char bridge_id_str[sizeof("pppp.aa:bb:cc:dd:ee:ff")];
 
     snprintf(bridge_id_str, sizeof(bridge_id_str),
              "%.2x%.2x.%.2x:%.2x:%.2x:%.2x:%.2x:%.2x",
@@ -429,6 +430,18 @@ stp_print(netdissect_options *ndo, const u_char *p, u_int length)
 
     ND_TCHECK_1(stp_bpdu->protocol_version);
     protocol_version = GET_U_1(stp_bpdu->protocol_version);
+
+    /*
+     * With --changes-only, a configuration BPDU is a repeat if it's the
+     * same as the last one from the bridge port; TCNs are always shown.
+     */
+    if (ndo->ndo_changes_only &&
+        length >= sizeof(struct stp_bpdu_) - 1 &&
+        GET_U_1(stp_bpdu->bpdu_type) != STP_BPDU_TYPE_TOPO_CHANGE &&
+        nd_change_repeat(ndo, ND_CHANGE_STP, stp_bpdu->bridge_id, 10,
+                         nd_change_hash(ndo, ND_CHANGE_HASH_INIT, p, length)))
+        return;
+
     ND_PRINT("STP %s", tok2str(stp_proto_values, "Unknown STP protocol (0x%02x)",
                          protocol_version));
 
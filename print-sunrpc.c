@@ -49,12 +49,15 @@
 #endif /* HAVE_RPC_RPCENT_H */
 #endif /* defined(HAVE_GETRPCBYNUMBER) && defined(HAVE_RPC_RPC_H) */
 
+#include <stddef.h>
 #include <stdio.h>
 #include <string.h>
 
 #include "netdissect.h"
 #include "addrtoname.h"
+#include "callcache.h"
 #include "extract.h"
+#include "latency.h"
 
 #include "ip.h"
 #include "ip6.h"
@@ -154,9 +157,95 @@ static const struct tok proc2str[] = {
 	{ 0,				NULL }
 };
 
+/*
+ * Calls seen, for --latency-report, so that the first reply to one can
+ * be counted against the procedure it called.
+ */
+struct sunrpc_call_key {
+	uint32_t xid;
+	uint32_t ipver;
+	nd_ipv6 client;
+	nd_ipv6 server;
+};
+
+struct sunrpc_call_entry {
+	struct callcache_entry ce;
+	struct sunrpc_call_key key;
+	uint32_t prog;
+	uint32_t vers;
+	uint32_t proc;
+	u_int answered;
+};
+
+#define SUNRPC_CALL_TIMEOUT	120
+
+static const struct callcache_type sunrpc_call_type = {
+	sizeof(struct sunrpc_call_entry),
+	offsetof(struct sunrpc_call_entry, key),
+	sizeof(struct sunrpc_call_key),
+	SUNRPC_CALL_TIMEOUT
+};
+
 /* Forwards */
 static char *progstr(uint32_t);
 
+static int
+sunrpc_call_key(netdissect_options *ndo, struct sunrpc_call_key *key,
+    const struct sunrpc_msg *rp, const u_char *bp2, int reply)
+{
+	const struct ip *ip = (const struct ip *)bp2;
+	const struct ip6_hdr *ip6 = (const struct ip6_hdr *)bp2;
+	nd_ipv6 *src = reply ? &key->server : &key->client;
+	nd_ipv6 *dst = reply ? &key->client : &key->server;
+
+	memset(key, 0, sizeof(*key));
+	key->ipver = IP_V(ip);
+	switch (key->ipver) {
+	case 4:
+		GET_CPY_BYTES(src, ip->ip_src, sizeof(nd_ipv4));
+		GET_CPY_BYTES(dst, ip->ip_dst, sizeof(nd_ipv4));
+		break;
+	case 6:
+		GET_CPY_BYTES(src, ip6->ip6_src, sizeof(nd_ipv6));
+		GET_CPY_BYTES(dst, ip6->ip6_dst, sizeof(nd_ipv6));
+		break;
+	default:
+		return (0);
+	}
+	key->xid = GET_BE_U_4(rp->rm_xid);
+	return (1);
+}
+
+/*
+ * Count the time to the first reply "bp", in the IPv4 or IPv6 datagram
+ * "bp2", to a call sunrpc_print() saw.  Nothing is printed.
+ */
+void
+sunrpc_reply_latency(netdissect_options *ndo, const u_char *bp,
+    const u_char *bp2)
+{
+	const struct sunrpc_msg *rp = (const struct sunrpc_msg *)bp;
+	struct sunrpc_call_entry *sce;
+	struct sunrpc_call_key key;
+	char what[LATENCY_WHAT_LEN];
+
+	if (!ND_TTEST_4(rp->rm_xid) ||
+	    !sunrpc_call_key(ndo, &key, rp, bp2, 1))
+		return;
+	sce = (struct sunrpc_call_entry *)callcache_find(ndo,
+	    &sunrpc_call_type, &key);
+	if (sce == NULL || sce->answered)
+		return;
+	sce->answered = 1;
+	if (sce->prog == SUNRPC_PMAPPROG)
+		snprintf(what, sizeof(what), "pmap.%u %s", sce->vers,
+		    tok2str(proc2str, "proc-%u", sce->proc));
+	else
+		snprintf(what, sizeof(what), "%u.%u proc-%u", sce->prog,
+		    sce->vers, sce->proc);
+	latency_record(ndo, "sunrpc", what, sce->ce.cce_ts);
+}
+
 void
 sunrpc_print(netdissect_options *ndo, const u_char *bp,
                     u_int length, const u_char *bp2)
@@ -171,6 +260,21 @@ sunrpc_print(netdissect_options *ndo, const u_char *bp,
 	rp = (const struct sunrpc_msg *)bp;
 	ND_TCHECK_SIZE(rp);
 
+	if (ndo->ndo_latency) {
+		struct sunrpc_call_entry *sce;
+		struct sunrpc_call_key key;
+
+		if (sunrpc_call_key(ndo, &key, rp, bp2, 0)) {
+			sce = (struct sunrpc_call_entry *)callcache_enter(ndo,
+			    &sunrpc_call_type, &key);
+			if (sce != NULL) {
+				sce->prog = GET_BE_U_4(rp->rm_call.cb_prog);
+				sce->vers = GET_BE_U_4(rp->rm_call.cb_vers);
+				sce->proc = GET_BE_U_4(rp->rm_call.cb_proc);
+			}
+		}
+	}
+
 	if (!ndo->ndo_nflag) {
 		snprintf(srcid, sizeof(srcid), "0x%x",
 		    GET_BE_U_4(rp->rm_xid));
@@ -231,8 +335,8 @@ progstr(uint32_t prog)
 #if defined(HAVE_GETRPCBYNUMBER) && defined(HAVE_RPC_RPC_H)
 	struct rpcent *rp;
 #endif
-	static char buf[32];
-	static uint32_t lastprog = 0;
+	static ND_THREAD_LOCAL char buf[32];
+	static ND_THREAD_LOCAL uint32_t lastprog = 0;
 
 	if (lastprog != 0 && prog == lastprog)
 		return (buf);
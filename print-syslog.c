@@ -24,6 +24,7 @@
 
 #include "netdissect.h"
 #include "extract.h"
+#include "payload-tap.h"
 
 
 /*
@@ -114,7 +115,19 @@ syslog_print(netdissect_options *ndo,
     facility = (pri & SYSLOG_FACILITY_MASK) >> 3;
     severity = pri & SYSLOG_SEVERITY_MASK;
 
-    if (ndo->ndo_vflag < 1 )
+    /*
+     * With --extract-payloads, the message is written out rather than
+     * printed.
+     */
+    if (ndo->ndo_tap_file != NULL) {
+        struct tap_field msg;
+
+        msg.tf_data = pptr + msg_off;
+        msg.tf_len = msg_off < len ? len - msg_off : 0;
+        tap_record(ndo, TAP_SYSLOG, pri, &msg, 1);
+    }
+
+    if (ndo->ndo_vflag < 1 || ndo->ndo_tap_file != NULL)
     {
         ND_PRINT("SYSLOG %s.%s, length: %u",
                tok2str(syslog_facility_values, "unknown (%u)", facility),
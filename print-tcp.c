@@ -40,6 +40,8 @@ __RCSID("$NetBSD: print-tcp.c,v 1.8 2007/07/24 11:53:48 drochner Exp $");
 #include <string.h>
 
 #include "netdissect.h"
+#include "netdissect-fields.h"
+#include "netdissect-state.h"
 #include "addrtoname.h"
 #include "extract.h"
 
@@ -50,6 +52,9 @@ __RCSID("$NetBSD: print-tcp.c,v 1.8 2007/07/24 11:53:48 drochner Exp $");
 #include "ipproto.h"
 #include "rpc_auth.h"
 #include "rpc_msg.h"
+#include "portdispatch.h"
+#include "tcp-reasm.h"
+#include "tcp-analysis.h"
 
 #ifdef HAVE_LIBCRYPTO
 #include <openssl/md5.h>
@@ -67,39 +72,73 @@ static void print_tcp_fastopen_option(netdissect_options *ndo, const u_char *cp,
 #define MAX_RST_DATA_LEN	30
 
 
-struct tha {
-        nd_ipv4 src;
-        nd_ipv4 dst;
-        u_int port;
-};
-
-struct tcp_seq_hash {
-        struct tcp_seq_hash *nxt;
-        struct tha addr;
-        uint32_t seq;
-        uint32_t ack;
-};
-
-struct tha6 {
-        nd_ipv6 src;
+/*
+ * The initial sequence numbers of the conversations seen, for printing
+ * relative ones.  The table is open-addressed, with linear probing, and
+ * is keyed on both addresses and both ports, put in an arbitrary
+ * collating order so that there's only one entry for both directions.
+ *
+ * When the table gets three-quarters full it's rebuilt, without the
+ * conversations that were closed, with a RST or a FIN each way, more
+ * than TCP_CONN_LINGER seconds before the current packet, or that have
+ * been idle for more than TCP_CONN_IDLE seconds, and at a size that
+ * leaves it at most half full; so it grows only with the number of
+ * conversations that are live at once, and shrinks again after a
+ * burst.  A closed conversation is kept a little while so that the last
+ * ACKs and any retransmissions still get relative numbers.  If the
+ * table is at TCP_CONN_MAX_SLOTS, or the state budget hasn't room for
+ * the larger one, the idle time allowed is halved until enough
+ * conversations go.  If there's no room for a table at all, sequence
+ * numbers are printed as they are.
+ *
+ * The table is in the ndo's state.
+ */
+struct tcp_conn_key {
+        nd_ipv6 src;            /* IPv4 addresses are in the first 4 octets */
         nd_ipv6 dst;
-        u_int port;
+        uint32_t port;          /* source port << 16 | destination port */
+        uint32_t family;        /* 4 or 6 */
 };
 
-struct tcp_seq_hash6 {
-        struct tcp_seq_hash6 *nxt;
-        struct tha6 addr;
+struct tcp_conn {
+        struct tcp_conn_key key;
+        uint32_t hash;          /* 0 if the slot is free */
+        uint32_t last;          /* time stamp, in seconds, of the last packet */
         uint32_t seq;
         uint32_t ack;
+        u_int state;
 };
 
-#define TSEQ_HASHSIZE 919
+#define TCP_CONN_FIN_SRC        0x01    /* FIN seen from key.src */
+#define TCP_CONN_FIN_DST        0x02    /* FIN seen from key.dst */
+#define TCP_CONN_CLOSED         0x04    /* RST, or FIN both ways */
+
+#define TCP_CONN_MIN_SLOTS      1024
+#define TCP_CONN_MAX_SLOTS      (1U << 22)
+#define TCP_CONN_IDLE           300
+#define TCP_CONN_LINGER         4
 
 /* These tcp options do not have the size octet */
 #define ZEROLENOPT(o) ((o) == TCPOPT_EOL || (o) == TCPOPT_NOP)
 
-static struct tcp_seq_hash tcp_seq_hash4[TSEQ_HASHSIZE];
-static struct tcp_seq_hash6 tcp_seq_hash6[TSEQ_HASHSIZE];
+struct tcp_conn_table {
+        struct tcp_conn *conns;
+        u_int mask;             /* slots - 1 */
+        struct tcp_conn_stats counts;
+};
+
+static void
+tcp_conn_free(netdissect_options *ndo, void *state)
+{
+        struct tcp_conn_table *tab = (struct tcp_conn_table *)state;
+
+        nd_state_free(ndo, tab->conns);
+        free(tab);
+}
+
+static const struct nd_state_type tcp_conn_state_type = {
+        tcp_conn_free
+};
 
 static const struct tok tcp_flag_values[] = {
         { TH_FIN, "F" },
@@ -156,6 +195,799 @@ tcp6_cksum(netdissect_options *ndo,
                                 IPPROTO_TCP);
 }
 
+/*
+ * Application printers chosen by port, in the order they're tried.
+ */
+
+static int
+tcp_telnet_dissect(netdissect_options *ndo, const u_char *bp,
+    u_int length, const struct port_info *pi _U_)
+{
+        telnet_print(ndo, bp, length);
+        return (1);
+}
+
+#ifndef ND_OMIT_SMTP
+static int
+tcp_smtp_dissect(netdissect_options *ndo, const u_char *bp,
+    u_int length, const struct port_info *pi _U_)
+{
+        ND_PRINT(": ");
+        smtp_print(ndo, bp, length);
+        return (1);
+}
+#else
+#define tcp_smtp_dissect	NULL
+#endif
+
+static int
+tcp_whois_dissect(netdissect_options *ndo, const u_char *bp,
+    u_int length, const struct port_info *pi _U_)
+{
+        ND_PRINT(": ");
+        ndo->ndo_protocol = "whois";	/* needed by txtproto_print() */
+        txtproto_print(ndo, bp, length, NULL, 0); /* RFC 3912 */
+        return (1);
+}
+
+static int
+tcp_bgp_dissect(netdissect_options *ndo, const u_char *bp,
+    u_int length, const struct port_info *pi)
+{
+        bgp_print(ndo, bp, length, pi->iph);
+        return (1);
+}
+
+#ifndef ND_OMIT_PPTP
+static int
+tcp_pptp_dissect(netdissect_options *ndo, const u_char *bp,
+    u_int length _U_, const struct port_info *pi _U_)
+{
+        pptp_print(ndo, bp);
+        return (1);
+}
+#else
+#define tcp_pptp_dissect	NULL
+#endif
+
+static int
+tcp_resp_dissect(netdissect_options *ndo, const u_char *bp,
+    u_int length, const struct port_info *pi)
+{
+        if (ndo->ndo_tap_file != NULL)
+                resp_extract(ndo, bp, length, pi->side == PORT_DST);
+        else
+                resp_print(ndo, bp, length);
+        return (1);
+}
+
+#ifndef ND_OMIT_SSH
+static int
+tcp_ssh_dissect(netdissect_options *ndo, const u_char *bp,
+    u_int length, const struct port_info *pi _U_)
+{
+        ssh_print(ndo, bp, length);
+        return (1);
+}
+#else
+#define tcp_ssh_dissect	NULL
+#endif
+
+#ifdef ENABLE_SMB
+static int
+tcp_nbt_ssn_dissect(netdissect_options *ndo, const u_char *bp,
+    u_int length, const struct port_info *pi)
+{
+        nbt_tcp_print(ndo, bp, length, pi->iph, pi->sport, pi->dport);
+        return (1);
+}
+
+static int
+tcp_smb_dissect(netdissect_options *ndo, const u_char *bp,
+    u_int length, const struct port_info *pi)
+{
+        smb_tcp_print(ndo, bp, length, pi->iph, pi->sport, pi->dport);
+        return (1);
+}
+#endif
+
+#ifndef ND_OMIT_BEEP
+static int
+tcp_beep_dissect(netdissect_options *ndo, const u_char *bp,
+    u_int length, const struct port_info *pi _U_)
+{
+        beep_print(ndo, bp, length);
+        return (1);
+}
+#else
+#define tcp_beep_dissect	NULL
+#endif
+
+static int
+tcp_openflow_dissect(netdissect_options *ndo, const u_char *bp,
+    u_int length, const struct port_info *pi)
+{
+        openflow_print(ndo, bp, length, pi->iph, pi->sport, pi->dport);
+        return (1);
+}
+
+#ifndef ND_OMIT_FTP
+static int
+tcp_ftp_dissect(netdissect_options *ndo, const u_char *bp,
+    u_int length, const struct port_info *pi _U_)
+{
+        ND_PRINT(": ");
+        ftp_print(ndo, bp, length);
+        return (1);
+}
+#else
+#define tcp_ftp_dissect	NULL
+#endif
+
+static int
+tcp_http_dissect(netdissect_options *ndo, const u_char *bp,
+    u_int length, const struct port_info *pi)
+{
+        if (ndo->ndo_http_transactions) {
+                http_transaction(ndo, bp, length, pi->iph, pi->sport,
+                    pi->dport);
+                return (1);
+        }
+        ND_PRINT(": ");
+        http_print(ndo, bp, length);
+        return (1);
+}
+
+#ifndef ND_OMIT_RTSP
+static int
+tcp_rtsp_dissect(netdissect_options *ndo, const u_char *bp,
+    u_int length, const struct port_info *pi _U_)
+{
+        ND_PRINT(": ");
+        rtsp_print(ndo, bp, length);
+        return (1);
+}
+#else
+#define tcp_rtsp_dissect	NULL
+#endif
+
+static int
+tcp_dns_dissect(netdissect_options *ndo, const u_char *bp,
+    u_int length, const struct port_info *pi)
+{
+        if (length <= 2)
+                return (0);
+        if (ndo->ndo_latency)
+                domain_latency(ndo, bp + 2, length - 2, pi->iph, pi->sport,
+                    pi->dport);
+        /* domain_print() assumes it does not have to prepend a space before its
+         * own output to separate it from the output of the calling function. This
+         * works well with udp_print(), but requires a small prop here.
+         */
+        ND_PRINT(" ");
+
+        /*
+         * TCP DNS query has 2byte length at the head.
+         * XXX packet could be unaligned, it can go strange
+         */
+        domain_print(ndo, bp + 2, length - 2, 0);
+        return (1);
+}
+
+#ifndef ND_OMIT_MSDP
+static int
+tcp_msdp_dissect(netdissect_options *ndo, const u_char *bp,
+    u_int length, const struct port_info *pi _U_)
+{
+        msdp_print(ndo, bp, length);
+        return (1);
+}
+#else
+#define tcp_msdp_dissect	NULL
+#endif
+
+static int
+tcp_rpki_rtr_dissect(netdissect_options *ndo, const u_char *bp,
+    u_int length, const struct port_info *pi _U_)
+{
+        rpki_rtr_print(ndo, bp, length);
+        return (1);
+}
+
+#ifndef ND_OMIT_LDP
+static int
+tcp_ldp_dissect(netdissect_options *ndo, const u_char *bp,
+    u_int length, const struct port_info *pi _U_)
+{
+        ldp_print(ndo, bp, length);
+        return (1);
+}
+#else
+#define tcp_ldp_dissect	NULL
+#endif
+
+#ifndef ND_OMIT_TLS
+static int
+tcp_tls_dissect(netdissect_options *ndo, const u_char *bp,
+    u_int length, const struct port_info *pi _U_)
+{
+        return (tls_print(ndo, bp, length));
+}
+#else
+#define tcp_tls_dissect	NULL
+#define tls_frame	NULL
+#endif
+
+static int
+tcp_nfs_dissect(netdissect_options *ndo, const u_char *bp,
+    u_int length, const struct port_info *pi)
+{
+        uint32_t fraglen;
+        const struct sunrpc_msg *rp;
+        enum sunrpc_msg_type direction;
+
+        /*
+         * If data present, header length valid, and NFS port used,
+         * assume NFS.
+         * Pass offset of data plus 4 bytes for RPC TCP msg length
+         * to NFS print routines.
+         */
+        if (length < 4 || !ND_TTEST_4(bp))
+                return (0);
+        fraglen = GET_BE_U_4(bp) & 0x7FFFFFFF;
+        if (fraglen > (length) - 4)
+                fraglen = (length) - 4;
+        rp = (const struct sunrpc_msg *)(bp + 4);
+        if (ND_TTEST_4(rp->rm_direction)) {
+                direction = (enum sunrpc_msg_type) GET_BE_U_4(rp->rm_direction);
+                if (pi->dport == NFS_PORT && direction == SUNRPC_CALL) {
+                        ND_PRINT(": NFS request xid %u ",
+                                 GET_BE_U_4(rp->rm_xid));
+                        nfsreq_noaddr_print(ndo, (const u_char *)rp, fraglen, pi->iph);
+                        return (1);
+                }
+                if (pi->sport == NFS_PORT && direction == SUNRPC_REPLY) {
+                        ND_PRINT(": NFS reply xid %u ",
+                                 GET_BE_U_4(rp->rm_xid));
+                        nfsreply_noaddr_print(ndo, (const u_char *)rp, fraglen, pi->iph);
+                        return (1);
+                }
+        }
+        return (1);
+}
+
+/*
+ * Framers, for --tcp-reassembly; see portdispatch.h.  The bytes have
+ * been checked to have been captured.
+ */
+static int
+tcp_bgp_frame(const u_char *bp, u_int avail, u_int *msglen)
+{
+        u_int i;
+
+        for (i = 0; i < 16 && i < avail; i++)
+                if (EXTRACT_U_1(bp + i) != 0xff)
+                        return (-1);
+        if (avail < 19)
+                return (0);
+        *msglen = EXTRACT_BE_U_2(bp + 16);
+        return (*msglen >= 19 ? 1 : -1);
+}
+
+#ifdef ENABLE_SMB
+static int
+tcp_nbt_ssn_frame(const u_char *bp, u_int avail, u_int *msglen)
+{
+        u_int type;
+
+        if (avail < 4)
+                return (0);
+        type = EXTRACT_U_1(bp);
+        if (type != 0x00 && (type < 0x81 || type > 0x85))
+                return (-1);
+        *msglen = 4 + ((EXTRACT_U_1(bp + 1) & 0x01) << 16 |
+                       EXTRACT_BE_U_2(bp + 2));
+        return (1);
+}
+
+static int
+tcp_smb_frame(const u_char *bp, u_int avail, u_int *msglen)
+{
+        if (avail < 4)
+                return (0);
+        if (EXTRACT_U_1(bp) != 0x00)
+                return (-1);
+        *msglen = 4 + EXTRACT_BE_U_3(bp + 1);
+        return (1);
+}
+#endif
+
+static int
+tcp_openflow_frame(const u_char *bp, u_int avail, u_int *msglen)
+{
+        if (avail < 4)
+                return (0);
+        *msglen = EXTRACT_BE_U_2(bp + 2);
+        return (*msglen >= 8 ? 1 : -1);
+}
+
+static int
+tcp_dns_frame(const u_char *bp, u_int avail, u_int *msglen)
+{
+        if (avail < 2)
+                return (0);
+        *msglen = 2 + EXTRACT_BE_U_2(bp);
+        return (*msglen > 2 ? 1 : -1);
+}
+
+static int
+tcp_msdp_frame(const u_char *bp, u_int avail, u_int *msglen)
+{
+        if (avail < 3)
+                return (0);
+        if (EXTRACT_U_1(bp) == 0)
+                return (-1);
+        *msglen = EXTRACT_BE_U_2(bp + 1);
+        return (*msglen >= 3 ? 1 : -1);
+}
+
+static int
+tcp_rpki_rtr_frame(const u_char *bp, u_int avail, u_int *msglen)
+{
+        uint32_t len;
+
+        if (avail < 8)
+                return (0);
+        len = EXTRACT_BE_U_4(bp + 4);
+        if (len < 8 || len > TCP_REASM_FLOW_MAX)
+                return (-1);
+        *msglen = len;
+        return (1);
+}
+
+static int
+tcp_ldp_frame(const u_char *bp, u_int avail, u_int *msglen)
+{
+        if (avail < 4)
+                return (0);
+        if (EXTRACT_BE_U_2(bp) != 1)    /* LDP version */
+                return (-1);
+        *msglen = 4 + EXTRACT_BE_U_2(bp + 2);
+        return (1);
+}
+
+static int
+tcp_nfs_frame(const u_char *bp, u_int avail, u_int *msglen)
+{
+        uint32_t fraglen;
+
+        if (avail < 4)
+                return (0);
+        fraglen = EXTRACT_BE_U_4(bp) & 0x7FFFFFFF;
+        if (fraglen == 0 || fraglen > TCP_REASM_FLOW_MAX)
+                return (-1);
+        *msglen = 4 + fraglen;
+        return (1);
+}
+
+enum {
+        TCP_TELNET,
+        TCP_SMTP,
+        TCP_WHOIS,
+        TCP_BGP,
+        TCP_PPTP,
+        TCP_RESP,
+        TCP_SSH,
+#ifdef ENABLE_SMB
+        TCP_NBT_SSN,
+        TCP_SMB,
+#endif
+        TCP_BEEP,
+        TCP_OPENFLOW,
+        TCP_FTP,
+        TCP_HTTP,
+        TCP_RTSP,
+        TCP_DNS,
+        TCP_MSDP,
+        TCP_RPKI_RTR,
+        TCP_LDP,
+        TCP_NFS,
+        TCP_TLS,
+};
+
+static const struct port_dissector tcp_port_dissectors[] = {
+        { "telnet", tcp_telnet_dissect, NULL, 0 },
+        { "smtp", tcp_smtp_dissect, NULL, 0 },
+        { "whois", tcp_whois_dissect, NULL, 0 },
+        { "bgp", tcp_bgp_dissect, tcp_bgp_frame, 0 },
+        { "pptp", tcp_pptp_dissect, NULL, 0 },
+        { "resp", tcp_resp_dissect, NULL, 0 },
+        { "ssh", tcp_ssh_dissect, NULL, 0 },
+#ifdef ENABLE_SMB
+        { "nbt_ssn", tcp_nbt_ssn_dissect, tcp_nbt_ssn_frame,
+          PORT_ONE_MESSAGE },
+        { "smb", tcp_smb_dissect, tcp_smb_frame, PORT_ONE_MESSAGE },
+#endif
+        { "beep", tcp_beep_dissect, NULL, 0 },
+        { "openflow", tcp_openflow_dissect, tcp_openflow_frame, 0 },
+        { "ftp", tcp_ftp_dissect, NULL, 0 },
+        { "http", tcp_http_dissect, http_frame, PORT_ONE_MESSAGE },
+        { "rtsp", tcp_rtsp_dissect, NULL, 0 },
+        { "dns", tcp_dns_dissect, tcp_dns_frame, PORT_ONE_MESSAGE },
+        { "msdp", tcp_msdp_dissect, tcp_msdp_frame, 0 },
+        { "rpki_rtr", tcp_rpki_rtr_dissect, tcp_rpki_rtr_frame, 0 },
+        { "ldp", tcp_ldp_dissect, tcp_ldp_frame, 0 },
+        { "nfs", tcp_nfs_dissect, tcp_nfs_frame, PORT_ONE_MESSAGE },
+        { "tls", tcp_tls_dissect, tls_frame, 0 },
+        { NULL, NULL, NULL, 0 }
+};
+
+static const struct port_rule tcp_port_rules[] = {
+        { TELNET_PORT, TELNET_PORT, PORT_EITHER, TCP_TELNET },
+        { SMTP_PORT, SMTP_PORT, PORT_EITHER, TCP_SMTP },
+        { WHOIS_PORT, WHOIS_PORT, PORT_EITHER, TCP_WHOIS },
+        { BGP_PORT, BGP_PORT, PORT_EITHER, TCP_BGP },
+        { PPTP_PORT, PPTP_PORT, PORT_EITHER, TCP_PPTP },
+        { REDIS_PORT, REDIS_PORT, PORT_EITHER, TCP_RESP },
+        { SSH_PORT, SSH_PORT, PORT_EITHER, TCP_SSH },
+#ifdef ENABLE_SMB
+        { NETBIOS_SSN_PORT, NETBIOS_SSN_PORT, PORT_EITHER, TCP_NBT_SSN },
+        { SMB_PORT, SMB_PORT, PORT_EITHER, TCP_SMB },
+#endif
+        { BEEP_PORT, BEEP_PORT, PORT_EITHER, TCP_BEEP },
+        { OPENFLOW_PORT_OLD, OPENFLOW_PORT_OLD, PORT_EITHER, TCP_OPENFLOW },
+        { OPENFLOW_PORT_IANA, OPENFLOW_PORT_IANA, PORT_EITHER, TCP_OPENFLOW },
+        { FTP_PORT, FTP_PORT, PORT_EITHER, TCP_FTP },
+        { HTTP_PORT, HTTP_PORT, PORT_EITHER, TCP_HTTP },
+        { HTTP_PORT_ALT, HTTP_PORT_ALT, PORT_EITHER, TCP_HTTP },
+        { RTSP_PORT, RTSP_PORT, PORT_EITHER, TCP_RTSP },
+        { RTSP_PORT_ALT, RTSP_PORT_ALT, PORT_EITHER, TCP_RTSP },
+        { NAMESERVER_PORT, NAMESERVER_PORT, PORT_EITHER, TCP_DNS },
+        { MSDP_PORT, MSDP_PORT, PORT_EITHER, TCP_MSDP },
+        { RPKI_RTR_PORT, RPKI_RTR_PORT, PORT_EITHER, TCP_RPKI_RTR },
+        { LDP_PORT, LDP_PORT, PORT_EITHER, TCP_LDP },
+        { NFS_PORT, NFS_PORT, PORT_EITHER, TCP_NFS },
+        { HTTPS_PORT, HTTPS_PORT, PORT_EITHER, TCP_TLS },
+        { DNS_TLS_PORT, DNS_TLS_PORT, PORT_EITHER, TCP_TLS },
+        { IMAPS_PORT, IMAPS_PORT, PORT_EITHER, TCP_TLS },
+        { POP3S_PORT, POP3S_PORT, PORT_EITHER, TCP_TLS },
+        { HTTPS_PORT_ALT, HTTPS_PORT_ALT, PORT_EITHER, TCP_TLS },
+};
+
+struct port_table tcp_port_table = {
+        tcp_port_dissectors,
+        tcp_port_rules, sizeof(tcp_port_rules) / sizeof(tcp_port_rules[0]),
+        NULL, 0, 0, { NULL, NULL }, NULL, 0, 0
+};
+
+static uint32_t
+tcp_conn_hash(const struct tcp_conn_key *key)
+{
+        const u_char *p = (const u_char *)key;
+        uint32_t h = 0, w;
+        size_t i;
+
+        for (i = 0; i < sizeof(*key); i += 4) {
+                memcpy(&w, p + i, 4);
+                h = (h ^ w) * 0x9e3779b1U;
+        }
+        h ^= h >> 16;
+        h *= 0x85ebca6bU;
+        h ^= h >> 13;
+        h *= 0xc2b2ae35U;
+        h ^= h >> 16;
+        return (h != 0 ? h : 1);
+}
+
+/*
+ * Returns 1 if the conversation should be dropped when the table is
+ * rebuilt at time "now", allowing "idle" seconds without a packet.
+ */
+static int
+tcp_conn_expired(const struct tcp_conn *c, uint32_t now, int32_t idle)
+{
+        int32_t age = (int32_t)(now - c->last);
+
+        if ((c->state & TCP_CONN_CLOSED) &&
+            age >= (idle < TCP_CONN_LINGER ? idle : TCP_CONN_LINGER))
+                return (1);
+        return (age >= idle);
+}
+
+/*
+ * Rebuild the table without the conversations that have expired, at
+ * the smallest size that leaves it at most half full.
+ */
+static void
+tcp_conn_rebuild(netdissect_options *ndo, struct tcp_conn_table *t)
+{
+        struct tcp_conn *tab, *c;
+        u_int slots, nslots, live, i, j;
+        uint32_t now = (uint32_t)ndo->ndo_packet_sec;
+        int32_t idle = TCP_CONN_IDLE;
+
+        slots = t->mask + 1;
+        for (;;) {
+                live = 0;
+                for (i = 0; i < slots; i++)
+                        if (t->conns[i].hash != 0 &&
+                            !tcp_conn_expired(&t->conns[i], now, idle))
+                                live++;
+                if (live <= TCP_CONN_MAX_SLOTS / 2 || idle == 0) {
+                        for (nslots = TCP_CONN_MIN_SLOTS; nslots / 2 < live;
+                             nslots *= 2)
+                                continue;
+                        tab = (struct tcp_conn *)nd_state_calloc(ndo, nslots,
+                                                                 sizeof(*tab));
+                        if (tab != NULL || idle == 0)
+                                break;
+                }
+                idle /= 2;
+        }
+
+        for (i = 0; i < slots; i++) {
+                c = &t->conns[i];
+                if (c->hash == 0)
+                        continue;
+                if (tab == NULL || tcp_conn_expired(c, now, idle)) {
+                        if (c->state & TCP_CONN_CLOSED)
+                                t->counts.tcs_closed++;
+                        else
+                                t->counts.tcs_evicted++;
+                        continue;
+                }
+                for (j = c->hash & (nslots - 1); tab[j].hash != 0;
+                     j = (j + 1) & (nslots - 1))
+                        continue;
+                tab[j] = *c;
+        }
+        if (tab == NULL) {
+                /* No room for even an empty one; empty this one. */
+                memset(t->conns, 0, slots * sizeof(*t->conns));
+                t->counts.tcs_conns = 0;
+                return;
+        }
+        nd_state_free(ndo, t->conns);
+        t->conns = tab;
+        t->mask = nslots - 1;
+        t->counts.tcs_conns = live;
+        t->counts.tcs_slots = nslots;
+}
+
+/*
+ * Make the key for the conversation between the addresses, of "alen"
+ * bytes, and ports, the same whichever way the packet is going; returns
+ * 1 if the packet is going from the key's destination to its source.
+ */
+static int
+tcp_conn_key_init(struct tcp_conn_key *key, const void *src, const void *dst,
+                  size_t alen, uint16_t sport, uint16_t dport)
+{
+        int rev;
+
+        rev = 0;
+        if (sport > dport)
+                rev = 1;
+        else if (sport == dport) {
+                if (UNALIGNED_MEMCMP(src, dst, alen) > 0)
+                        rev = 1;
+        }
+        memset(key, 0, sizeof(*key));
+        key->family = alen == sizeof(nd_ipv6) ? 6 : 4;
+        if (rev) {
+                UNALIGNED_MEMCPY(&key->src, dst, alen);
+                UNALIGNED_MEMCPY(&key->dst, src, alen);
+                key->port = ((u_int)dport) << 16 | sport;
+        } else {
+                UNALIGNED_MEMCPY(&key->dst, dst, alen);
+                UNALIGNED_MEMCPY(&key->src, src, alen);
+                key->port = ((u_int)sport) << 16 | dport;
+        }
+        return (rev);
+}
+
+/*
+ * Prefetch the slot that tcp_print() will start looking for the
+ * conversation in, for a packet that's about to be printed; "alen" is
+ * 4 for IPv4 addresses and 16 for IPv6 ones.
+ */
+void
+tcp_conn_prefetch(netdissect_options *ndo, const u_char *src,
+                  const u_char *dst, u_int alen, uint16_t sport,
+                  uint16_t dport)
+{
+        const struct tcp_conn_table *t;
+        struct tcp_conn_key key;
+
+        if (ndo->ndo_Sflag || ndo->ndo_qflag)
+                return;
+        t = (const struct tcp_conn_table *)*nd_state_slot(ndo,
+            &tcp_conn_state_type, &tcp_conn_state_type);
+        if (t == NULL || t->conns == NULL)
+                return;
+        (void)tcp_conn_key_init(&key, src, dst, alen, sport, dport);
+        ND_PREFETCH(&t->conns[tcp_conn_hash(&key) & t->mask]);
+}
+
+/*
+ * Find the entry for the conversation "key", or make one, with a state
+ * of 0, for it.  Sets "*found" to say which.  Returns NULL if there's
+ * no room for the table.
+ */
+static struct tcp_conn *
+tcp_conn_lookup(netdissect_options *ndo, const struct tcp_conn_key *key,
+                int *found)
+{
+        struct tcp_conn_table *t;
+        struct tcp_conn *c;
+        void **slot;
+        uint32_t h;
+        u_int i;
+
+        slot = nd_state_slot(ndo, &tcp_conn_state_type, &tcp_conn_state_type);
+        if ((t = (struct tcp_conn_table *)*slot) == NULL) {
+                t = (struct tcp_conn_table *)calloc(1, sizeof(*t));
+                if (t == NULL)
+                        (*ndo->ndo_error)(ndo, S_ERR_ND_MEM_ALLOC,
+                                          "%s: calloc", __func__);
+                *slot = t;
+        }
+        if (t->conns == NULL) {
+                t->conns = (struct tcp_conn *)nd_state_calloc(ndo,
+                    TCP_CONN_MIN_SLOTS, sizeof(*t->conns));
+                if (t->conns == NULL)
+                        return (NULL);
+                t->mask = TCP_CONN_MIN_SLOTS - 1;
+                t->counts.tcs_slots = TCP_CONN_MIN_SLOTS;
+        }
+        h = tcp_conn_hash(key);
+        for (i = h & t->mask; (c = &t->conns[i])->hash != 0;
+             i = (i + 1) & t->mask) {
+                if (c->hash == h && memcmp(&c->key, key, sizeof(*key)) == 0) {
+                        *found = 1;
+                        return (c);
+                }
+        }
+
+        if (t->counts.tcs_conns + 1 > (t->mask + 1) / 4 * 3) {
+                tcp_conn_rebuild(ndo, t);
+                for (i = h & t->mask; t->conns[i].hash != 0;
+                     i = (i + 1) & t->mask)
+                        continue;
+                c = &t->conns[i];
+        }
+        memset(c, 0, sizeof(*c));
+        c->key = *key;
+        c->hash = h;
+        if (++t->counts.tcs_conns > t->counts.tcs_peak)
+                t->counts.tcs_peak = t->counts.tcs_conns;
+        *found = 0;
+        return (c);
+}
+
+/*
+ * Report the relative sequence number table's occupancy and how many
+ * conversations have been dropped from it, for this ndo.
+ */
+void
+tcp_conn_stats(netdissect_options *ndo, struct tcp_conn_stats *stats)
+{
+        const struct tcp_conn_table *t;
+
+        t = (const struct tcp_conn_table *)*nd_state_slot(ndo,
+            &tcp_conn_state_type, &tcp_conn_state_type);
+        if (t != NULL)
+                *stats = t->counts;
+        else
+                memset(stats, 0, sizeof(*stats));
+}
+
+static void
+tcp_conn_add_usage(void *arg, void *state)
+{
+        const struct tcp_conn_table *t = (const struct tcp_conn_table *)state;
+
+        *(size_t *)arg += sizeof(*t);
+        if (t->conns != NULL)
+                *(size_t *)arg += (t->mask + 1) * sizeof(*t->conns);
+}
+
+size_t
+tcp_conn_mem_usage(netdissect_options *ndo)
+{
+        size_t usage = 0;
+
+        nd_state_foreach(ndo, &tcp_conn_state_type, tcp_conn_add_usage,
+                         &usage);
+        return (usage);
+}
+
+struct tcp_conn_reclaim {
+        netdissect_options *ndo;
+        uint64_t n;
+};
+
+static void
+tcp_conn_drop(void *arg, void *state)
+{
+        struct tcp_conn_reclaim *r = (struct tcp_conn_reclaim *)arg;
+        struct tcp_conn_table *t = (struct tcp_conn_table *)state;
+
+        if (t->conns == NULL)
+                return;
+        r->n += t->counts.tcs_conns;
+        t->counts.tcs_evicted += t->counts.tcs_conns;
+        t->counts.tcs_conns = 0;
+        t->counts.tcs_slots = 0;
+        nd_state_free(r->ndo, t->conns);
+        t->conns = NULL;
+        t->mask = 0;
+}
+
+/*
+ * For --mem-limit: empty the table.  It comes back at its smallest size
+ * with the next segment, and the conversations in it start again from
+ * the next segment of each, as if the capture had started there.
+ */
+uint64_t
+tcp_conn_mem_reclaim(netdissect_options *ndo, size_t want _U_)
+{
+        struct tcp_conn_reclaim r;
+
+        r.ndo = ndo;
+        r.n = 0;
+        nd_state_foreach(ndo, &tcp_conn_state_type, tcp_conn_drop, &r);
+        return (r.n);
+}
+
+/*
+ * Follow the segment for --tcp-analysis, and print what it shows.
+ */
+static void
+tcp_print_analysis(netdissect_options *ndo, const struct ip *ip,
+                   const struct ip6_hdr *ip6, const u_char *bp, u_int length)
+{
+        if (ip6)
+                tcp_analyze(ndo, ip6->ip6_src, ip6->ip6_dst,
+                            sizeof(ip6->ip6_src), bp, length);
+        else
+                tcp_analyze(ndo, ip->ip_src, ip->ip_dst, sizeof(ip->ip_src),
+                            bp, length);
+}
+
+/*
+ * Follow the segment for --mptcp-connections.
+ */
+static void
+tcp_track_mptcp(netdissect_options *ndo, const struct ip *ip,
+                const struct ip6_hdr *ip6, const u_char *bp, u_int hlen)
+{
+        if (ip6)
+                mptcp_track(ndo, ip6->ip6_src, ip6->ip6_dst,
+                            sizeof(ip6->ip6_src), bp, hlen);
+        else
+                mptcp_track(ndo, ip->ip_src, ip->ip_dst, sizeof(ip->ip_src),
+                            bp, hlen);
+}
+
+/*
+ * Returns the dissector that a segment goes to if it's to be
+ * reassembled, otherwise NULL.
+ */
+static const struct port_dissector *
+tcp_reasm_match(netdissect_options *ndo, struct port_info *pi)
+{
+        const struct port_dissector *pd;
+
+        if (ndo->ndo_tcp_reasm_budget == 0 || pi->fragmented ||
+            ndo->ndo_packettype)
+                return (NULL);
+        if ((pd = port_match(&tcp_port_table, pi)) == NULL ||
+            pd->framer == NULL)
+                return (NULL);
+        return (pd);
+}
+
 void
 tcp_print(netdissect_options *ndo,
           const u_char *bp, u_int length,
@@ -172,6 +1004,8 @@ tcp_print(netdissect_options *ndo,
         uint16_t magic;
         int rev;
         const struct ip6_hdr *ip6;
+        struct port_info pi;
+        const struct port_dissector *pd;
 
         ndo->ndo_protocol = "tcp";
         tp = (const struct tcphdr *)bp;
@@ -195,8 +1029,8 @@ tcp_print(netdissect_options *ndo,
                 return;
         }
 
-        sport = GET_BE_U_2(tp->th_sport);
-        dport = GET_BE_U_2(tp->th_dport);
+        sport = EXTRACT_BE_U_2(tp->th_sport);
+        dport = EXTRACT_BE_U_2(tp->th_dport);
 
         if (ip6) {
                 if (GET_U_1(ip6->ip6_nxt) == IPPROTO_TCP) {
@@ -232,133 +1066,67 @@ tcp_print(netdissect_options *ndo,
                 return;
         }
 
-        seq = GET_BE_U_4(tp->th_seq);
-        ack = GET_BE_U_4(tp->th_ack);
-        win = GET_BE_U_2(tp->th_win);
-        urp = GET_BE_U_2(tp->th_urp);
+        /* In ND_TCHECK_SIZE(tp); the options are fetched as parsed. */
+        seq = EXTRACT_BE_U_4(tp->th_seq);
+        ack = EXTRACT_BE_U_4(tp->th_ack);
+        win = EXTRACT_BE_U_2(tp->th_win);
+        urp = EXTRACT_BE_U_2(tp->th_urp);
+
+        ND_FIELD_UINT(NDF_TCP, NDF_TCP_SPORT, sport);
+        ND_FIELD_UINT(NDF_TCP, NDF_TCP_DPORT, dport);
+        ND_FIELD_UINT(NDF_TCP, NDF_TCP_SEQ, seq);
+        ND_FIELD_UINT(NDF_TCP, NDF_TCP_ACK, ack);
+        ND_FIELD_UINT(NDF_TCP, NDF_TCP_FLAGS, EXTRACT_U_1(tp->th_flags));
+        ND_FIELD_UINT(NDF_TCP, NDF_TCP_WIN, win);
+        if (hlen <= length)
+                ND_FIELD_UINT(NDF_TCP, NDF_TCP_PAYLOAD_LEN, length - hlen);
+        if (ndo->ndo_mptcp_connections && hlen <= length)
+                tcp_track_mptcp(ndo, ip, ip6, bp, hlen);
 
         if (ndo->ndo_qflag) {
                 ND_PRINT("tcp %u", length - hlen);
                 if (hlen > length) {
                         ND_PRINT(" [bad hdr length %u - too long, > %u]",
                                  hlen, length);
-                }
+                } else if (ndo->ndo_tcp_analysis)
+                        tcp_print_analysis(ndo, ip, ip6, bp, length);
                 return;
         }
 
-        flags = GET_U_1(tp->th_flags);
+        flags = EXTRACT_U_1(tp->th_flags);
         ND_PRINT("Flags [%s]", bittok2str_nosep(tcp_flag_values, "none", flags));
 
         if (!ndo->ndo_Sflag && (flags & TH_ACK)) {
+                struct tcp_conn *th;
+                struct tcp_conn_key key;
+                const void *src, *dst;
+                size_t alen;
+                int found;
+
                 /*
                  * Find (or record) the initial sequence numbers for
                  * this conversation.  (we pick an arbitrary
                  * collating order so there's only one entry for
                  * both directions).
                  */
-                rev = 0;
                 if (ip6) {
-                        struct tcp_seq_hash6 *th;
-                        struct tcp_seq_hash6 *tcp_seq_hash;
-                        const void *src, *dst;
-                        struct tha6 tha;
-
-                        tcp_seq_hash = tcp_seq_hash6;
                         src = (const void *)ip6->ip6_src;
                         dst = (const void *)ip6->ip6_dst;
-                        if (sport > dport)
-                                rev = 1;
-                        else if (sport == dport) {
-                                if (UNALIGNED_MEMCMP(src, dst, sizeof(ip6->ip6_dst)) > 0)
-                                        rev = 1;
-                        }
-                        if (rev) {
-                                UNALIGNED_MEMCPY(&tha.src, dst, sizeof(ip6->ip6_dst));
-                                UNALIGNED_MEMCPY(&tha.dst, src, sizeof(ip6->ip6_src));
-                                tha.port = ((u_int)dport) << 16 | sport;
-                        } else {
-                                UNALIGNED_MEMCPY(&tha.dst, dst, sizeof(ip6->ip6_dst));
-                                UNALIGNED_MEMCPY(&tha.src, src, sizeof(ip6->ip6_src));
-                                tha.port = ((u_int)sport) << 16 | dport;
-                        }
-
-                        for (th = &tcp_seq_hash[tha.port % TSEQ_HASHSIZE];
-                             th->nxt; th = th->nxt)
-                                if (memcmp((char *)&tha, (char *)&th->addr,
-                                           sizeof(th->addr)) == 0)
-                                        break;
-
-                        if (!th->nxt || (flags & TH_SYN)) {
-                                /* didn't find it or new conversation */
-                                /* calloc() return used by the 'tcp_seq_hash6'
-                                   hash table: do not free() */
-                                if (th->nxt == NULL) {
-                                        th->nxt = (struct tcp_seq_hash6 *)
-                                                calloc(1, sizeof(*th));
-                                        if (th->nxt == NULL)
-                                                (*ndo->ndo_error)(ndo,
-                                                        S_ERR_ND_MEM_ALLOC,
-                                                        "tcp_print: calloc");
-                                }
-                                th->addr = tha;
-                                if (rev)
-                                        th->ack = seq, th->seq = ack - 1;
-                                else
-                                        th->seq = seq, th->ack = ack - 1;
-                        } else {
-                                if (rev)
-                                        seq -= th->ack, ack -= th->seq;
-                                else
-                                        seq -= th->seq, ack -= th->ack;
-                        }
-
-                        thseq = th->seq;
-                        thack = th->ack;
+                        alen = sizeof(ip6->ip6_src);
                 } else {
-                        struct tcp_seq_hash *th;
-                        struct tcp_seq_hash *tcp_seq_hash;
-                        struct tha tha;
-
-                        tcp_seq_hash = tcp_seq_hash4;
-                        if (sport > dport)
-                                rev = 1;
-                        else if (sport == dport) {
-                                if (UNALIGNED_MEMCMP(ip->ip_src, ip->ip_dst, sizeof(ip->ip_dst)) > 0)
-                                        rev = 1;
-                        }
-                        if (rev) {
-                                UNALIGNED_MEMCPY(&tha.src, ip->ip_dst,
-                                                 sizeof(ip->ip_dst));
-                                UNALIGNED_MEMCPY(&tha.dst, ip->ip_src,
-                                                 sizeof(ip->ip_src));
-                                tha.port = ((u_int)dport) << 16 | sport;
-                        } else {
-                                UNALIGNED_MEMCPY(&tha.dst, ip->ip_dst,
-                                                 sizeof(ip->ip_dst));
-                                UNALIGNED_MEMCPY(&tha.src, ip->ip_src,
-                                                 sizeof(ip->ip_src));
-                                tha.port = ((u_int)sport) << 16 | dport;
-                        }
-
-                        for (th = &tcp_seq_hash[tha.port % TSEQ_HASHSIZE];
-                             th->nxt; th = th->nxt)
-                                if (memcmp((char *)&tha, (char *)&th->addr,
-                                           sizeof(th->addr)) == 0)
-                                        break;
-
-                        if (!th->nxt || (flags & TH_SYN)) {
+                        src = (const void *)ip->ip_src;
+                        dst = (const void *)ip->ip_dst;
+                        alen = sizeof(ip->ip_src);
+                }
+                rev = tcp_conn_key_init(&key, src, dst, alen, sport, dport);
+                th = tcp_conn_lookup(ndo, &key, &found);
+                if (th == NULL) {
+                        /* No room for the table; print them as they are. */
+                        thseq = thack = 0;
+                } else {
+                        if (!found || (flags & TH_SYN)) {
                                 /* didn't find it or new conversation */
-                                /* calloc() return used by the 'tcp_seq_hash4'
-                                   hash table: do not free() */
-                                if (th->nxt == NULL) {
-                                        th->nxt = (struct tcp_seq_hash *)
-                                                calloc(1, sizeof(*th));
-                                        if (th->nxt == NULL)
-                                                (*ndo->ndo_error)(ndo,
-                                                        S_ERR_ND_MEM_ALLOC,
-                                                        "tcp_print: calloc");
-                                }
-                                th->addr = tha;
+                                th->state = 0;
                                 if (rev)
                                         th->ack = seq, th->seq = ack - 1;
                                 else
@@ -369,6 +1137,14 @@ tcp_print(netdissect_options *ndo,
                                 else
                                         seq -= th->seq, ack -= th->ack;
                         }
+                        th->last = (uint32_t)ndo->ndo_packet_sec;
+                        if (flags & TH_FIN)
+                                th->state |= rev ? TCP_CONN_FIN_DST :
+                                    TCP_CONN_FIN_SRC;
+                        if ((flags & TH_RST) ||
+                            (th->state & (TCP_CONN_FIN_SRC|TCP_CONN_FIN_DST))
+                            == (TCP_CONN_FIN_SRC|TCP_CONN_FIN_DST))
+                                th->state |= TCP_CONN_CLOSED;
 
                         thseq = th->seq;
                         thack = th->ack;
@@ -387,10 +1163,14 @@ tcp_print(netdissect_options *ndo,
                 /* Check the checksum, if possible. */
                 uint16_t sum, tcp_sum;
 
-                if (IP_V(ip) == 4) {
+                if (ND_CKSUM_OFFLOADED(ndo)) {
+                        /* Possibly not filled in yet; see netdissect.h. */
+                        ND_PRINT(", cksum 0x%04x (unverified, outgoing)",
+                            GET_BE_U_2(tp->th_sum));
+                } else if (IP_V(ip) == 4) {
                         if (ND_TTEST_LEN(tp->th_sport, length)) {
                                 sum = tcp_cksum(ndo, ip, tp, length);
-                                tcp_sum = GET_BE_U_2(tp->th_sum);
+                                tcp_sum = EXTRACT_BE_U_2(tp->th_sum);
 
                                 ND_PRINT(", cksum 0x%04x", tcp_sum);
                                 if (sum != 0)
@@ -402,7 +1182,7 @@ tcp_print(netdissect_options *ndo,
                 } else if (IP_V(ip) == 6) {
                         if (ND_TTEST_LEN(tp->th_sport, length)) {
                                 sum = tcp6_cksum(ndo, ip6, tp, length);
-                                tcp_sum = GET_BE_U_2(tp->th_sum);
+                                tcp_sum = EXTRACT_BE_U_2(tp->th_sum);
 
                                 ND_PRINT(", cksum 0x%04x", tcp_sum);
                                 if (sum != 0)
@@ -681,9 +1461,23 @@ tcp_print(netdissect_options *ndo,
          * Print length field before crawling down the stack.
          */
         ND_PRINT(", length %u", length);
-
-        if (length <= 0)
+        if (ndo->ndo_tcp_analysis)
+                tcp_print_analysis(ndo, ip, ip6, bp, length + TH_OFF(tp) * 4);
+
+        pi.sport = sport;
+        pi.dport = dport;
+        pi.iph = bp2;
+        pi.fragmented = fragmented;
+        pi.ttl_hl = 0;
+        if (length <= 0) {
+                /* A reassembled stream still has to know of these. */
+                if ((flags & (TH_SYN|TH_FIN|TH_RST)) &&
+                    (pd = tcp_reasm_match(ndo, &pi)) != NULL)
+                        (void)tcp_reasm_print(ndo, pd, &pi,
+                                              EXTRACT_BE_U_4(tp->th_seq), flags,
+                                              bp, 0);
                 return;
+        }
 
         /*
          * Decode payload if necessary.
@@ -706,95 +1500,20 @@ tcp_print(netdissect_options *ndo,
                 return;
         }
 
-        if (IS_SRC_OR_DST_PORT(TELNET_PORT)) {
-                telnet_print(ndo, bp, length);
-        } else if (IS_SRC_OR_DST_PORT(SMTP_PORT)) {
-                ND_PRINT(": ");
-                smtp_print(ndo, bp, length);
-        } else if (IS_SRC_OR_DST_PORT(WHOIS_PORT)) {
-                ND_PRINT(": ");
-                ndo->ndo_protocol = "whois";	/* needed by txtproto_print() */
-                txtproto_print(ndo, bp, length, NULL, 0); /* RFC 3912 */
-        } else if (IS_SRC_OR_DST_PORT(BGP_PORT))
-                bgp_print(ndo, bp, length);
-        else if (IS_SRC_OR_DST_PORT(PPTP_PORT))
-                pptp_print(ndo, bp);
-        else if (IS_SRC_OR_DST_PORT(REDIS_PORT))
-                resp_print(ndo, bp, length);
-        else if (IS_SRC_OR_DST_PORT(SSH_PORT))
-                ssh_print(ndo, bp, length);
-#ifdef ENABLE_SMB
-        else if (IS_SRC_OR_DST_PORT(NETBIOS_SSN_PORT))
-                nbt_tcp_print(ndo, bp, length);
-        else if (IS_SRC_OR_DST_PORT(SMB_PORT))
-                smb_tcp_print(ndo, bp, length);
-#endif
-        else if (IS_SRC_OR_DST_PORT(BEEP_PORT))
-                beep_print(ndo, bp, length);
-        else if (IS_SRC_OR_DST_PORT(OPENFLOW_PORT_OLD) || IS_SRC_OR_DST_PORT(OPENFLOW_PORT_IANA))
-                openflow_print(ndo, bp, length);
-        else if (IS_SRC_OR_DST_PORT(FTP_PORT)) {
-                ND_PRINT(": ");
-                ftp_print(ndo, bp, length);
-        } else if (IS_SRC_OR_DST_PORT(HTTP_PORT) || IS_SRC_OR_DST_PORT(HTTP_PORT_ALT)) {
-                ND_PRINT(": ");
-                http_print(ndo, bp, length);
-        } else if (IS_SRC_OR_DST_PORT(RTSP_PORT) || IS_SRC_OR_DST_PORT(RTSP_PORT_ALT)) {
-                ND_PRINT(": ");
-                rtsp_print(ndo, bp, length);
-        } else if (length > 2 &&
-                 (IS_SRC_OR_DST_PORT(NAMESERVER_PORT))) {
-                /* domain_print() assumes it does not have to prepend a space before its
-                 * own output to separate it from the output of the calling function. This
-                 * works well with udp_print(), but requires a small prop here.
-                 */
-                ND_PRINT(" ");
-
-                /*
-                 * TCP DNS query has 2byte length at the head.
-                 * XXX packet could be unaligned, it can go strange
-                 */
-                domain_print(ndo, bp + 2, length - 2, 0);
-        } else if (IS_SRC_OR_DST_PORT(MSDP_PORT)) {
-                msdp_print(ndo, bp, length);
-        } else if (IS_SRC_OR_DST_PORT(RPKI_RTR_PORT)) {
-                rpki_rtr_print(ndo, bp, length);
-        }
-        else if (length > 0 && (IS_SRC_OR_DST_PORT(LDP_PORT))) {
-                ldp_print(ndo, bp, length);
-        }
-        else if ((IS_SRC_OR_DST_PORT(NFS_PORT)) &&
-                 length >= 4 && ND_TTEST_4(bp)) {
-                /*
-                 * If data present, header length valid, and NFS port used,
-                 * assume NFS.
-                 * Pass offset of data plus 4 bytes for RPC TCP msg length
-                 * to NFS print routines.
-                 */
-                uint32_t fraglen;
-                const struct sunrpc_msg *rp;
-                enum sunrpc_msg_type direction;
-
-                fraglen = GET_BE_U_4(bp) & 0x7FFFFFFF;
-                if (fraglen > (length) - 4)
-                        fraglen = (length) - 4;
-                rp = (const struct sunrpc_msg *)(bp + 4);
-                if (ND_TTEST_4(rp->rm_direction)) {
-                        direction = (enum sunrpc_msg_type) GET_BE_U_4(rp->rm_direction);
-                        if (dport == NFS_PORT && direction == SUNRPC_CALL) {
-                                ND_PRINT(": NFS request xid %u ",
-                                         GET_BE_U_4(rp->rm_xid));
-                                nfsreq_noaddr_print(ndo, (const u_char *)rp, fraglen, (const u_char *)ip);
-                                return;
-                        }
-                        if (sport == NFS_PORT && direction == SUNRPC_REPLY) {
-                                ND_PRINT(": NFS reply xid %u ",
-                                         GET_BE_U_4(rp->rm_xid));
-                                nfsreply_noaddr_print(ndo, (const u_char *)rp, fraglen, (const u_char *)ip);
-                                return;
-                        }
-                }
-        }
+        /*
+         * With --http-transactions, only the HTTP segments that finish
+         * a transaction are shown; http_transaction() clears this.
+         */
+        if (ndo->ndo_http_transactions &&
+            (pd = port_match(&tcp_port_table, &pi)) != NULL &&
+            pd->printer == tcp_http_dissect)
+                ndo->ndo_drop_line = 1;
+
+        if ((pd = tcp_reasm_match(ndo, &pi)) != NULL &&
+            tcp_reasm_print(ndo, pd, &pi, EXTRACT_BE_U_4(tp->th_seq), flags,
+                            bp, length))
+                return;
+        port_dispatch(ndo, &tcp_port_table, bp, length, &pi);
 
         return;
  bad:
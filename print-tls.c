@@ -0,0 +1,417 @@
+/*
+ * Copyright (c) 2026 The TCPDUMP project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that: (1) source code
+ * distributions retain the above copyright notice and this paragraph
+ * in its entirety, and (2) distributions including binary code include
+ * the above copyright notice and this paragraph in its entirety in
+ * the documentation or other materials provided with the distribution.
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND
+ * WITHOUT ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, WITHOUT
+ * LIMITATION, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE.
+ */
+
+/* \summary: Transport Layer Security (TLS) record printer */
+
+/*
+ * Only the record headers are looked at, and the ClientHello and
+ * ServerHello messages, for the version, the server name (RFC 6066),
+ * the application protocols (RFC 7301) and, for a ServerHello, the
+ * cipher suite; the rest of the handshake is named, and the contents
+ * of the other records, encrypted or not, are skipped.  Nothing is
+ * allocated or copied: the hellos are walked where they are.
+ *
+ * A segment is taken to be TLS if it starts with what looks like a
+ * record header; one that starts in the middle of a record, as most
+ * of those of a bulk transfer do, is left to the TCP printer, unless
+ * --tcp-reassembly has put the records back together.  That is also
+ * what it takes to see a ClientHello that doesn't fit in a segment,
+ * as one with a post-quantum key share doesn't.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include "netdissect-stdinc.h"
+
+#include <string.h>
+
+#include "netdissect.h"
+#include "extract.h"
+#include "netdissect-fields.h"
+
+#define TLS_RECORD_HDR_LEN	5
+#define TLS_RECORD_MAX		(16384 + 2048)	/* a TLSCiphertext */
+#define TLS_HANDSHAKE_HDR_LEN	4
+
+#define TLS_CHANGE_CIPHER_SPEC	20
+#define TLS_ALERT		21
+#define TLS_HANDSHAKE		22
+#define TLS_APPLICATION_DATA	23
+#define TLS_HEARTBEAT		24
+
+#define TLS_CLIENT_HELLO	1
+#define TLS_SERVER_HELLO	2
+
+#define TLS_EXT_SERVER_NAME	0
+#define TLS_EXT_ALPN		16
+#define TLS_EXT_SUPPORTED_VERSIONS 43
+
+/* RFC 8701 reserves these, to be sent so that servers ignore them. */
+#define TLS_GREASE(v)	(((v) & 0x0f0f) == 0x0a0a && ((v) >> 8) == ((v) & 0xff))
+
+static const struct tok tls_version_str[] = {
+	{ 0x0300, "SSLv3"   },
+	{ 0x0301, "TLSv1"   },
+	{ 0x0302, "TLSv1.1" },
+	{ 0x0303, "TLSv1.2" },
+	{ 0x0304, "TLSv1.3" },
+	{ 0, NULL }
+};
+
+static const struct tok tls_handshake_str[] = {
+	{ 0,  "HelloRequest"        },
+	{ 1,  "ClientHello"         },
+	{ 2,  "ServerHello"         },
+	{ 4,  "NewSessionTicket"    },
+	{ 5,  "EndOfEarlyData"      },
+	{ 8,  "EncryptedExtensions" },
+	{ 11, "Certificate"         },
+	{ 12, "ServerKeyExchange"   },
+	{ 13, "CertificateRequest"  },
+	{ 14, "ServerHelloDone"     },
+	{ 15, "CertificateVerify"   },
+	{ 16, "ClientKeyExchange"   },
+	{ 20, "Finished"            },
+	{ 24, "KeyUpdate"           },
+	{ 254, "MessageHash"        },
+	{ 0, NULL }
+};
+
+static const struct tok tls_alert_level_str[] = {
+	{ 1, "warning" },
+	{ 2, "fatal"   },
+	{ 0, NULL }
+};
+
+/* What's been found in a hello; the strings are in the packet. */
+struct tls_hello {
+	u_int version;		/* from supported_versions, or the legacy one */
+	u_int cipher;		/* ServerHello */
+	const u_char *sni;
+	u_int sni_len;
+	const u_char *alpn;	/* the list of protocols */
+	u_int alpn_len;
+};
+
+/*
+ * The framer, for --tcp-reassembly (see portdispatch.h); it gives up
+ * on what isn't a record header as soon as it can tell.
+ */
+int
+tls_frame(const u_char *bp, u_int avail, u_int *msglen)
+{
+	u_int type, len;
+
+	if (avail < 1)
+		return (0);
+	type = EXTRACT_U_1(bp);
+	if (type < TLS_CHANGE_CIPHER_SPEC || type > TLS_HEARTBEAT)
+		return (-1);
+	if (avail < 2)
+		return (0);
+	if (EXTRACT_U_1(bp + 1) != 3)
+		return (-1);
+	if (avail < TLS_RECORD_HDR_LEN)
+		return (0);
+	len = EXTRACT_BE_U_2(bp + 3);
+	if (len == 0 || len > TLS_RECORD_MAX)
+		return (-1);
+	*msglen = TLS_RECORD_HDR_LEN + len;
+	return (1);
+}
+
+/*
+ * Parse the extensions of a hello, the "len" bytes at "cp".
+ */
+static void
+tls_hello_extensions(netdissect_options *ndo, const u_char *cp, u_int len,
+		     u_int htype, struct tls_hello *h)
+{
+	u_int type, elen, n, v, best;
+	const u_char *ep;
+
+	while (len >= 4) {
+		type = GET_BE_U_2(cp);
+		elen = GET_BE_U_2(cp + 2);
+		cp += 4;
+		len -= 4;
+		if (elen > len)
+			break;
+		switch (type) {
+
+		case TLS_EXT_SERVER_NAME:
+			/* A list of names; the first host_name is the one. */
+			if (htype != TLS_CLIENT_HELLO || elen < 5)
+				break;
+			n = GET_BE_U_2(cp + 3);
+			if (GET_U_1(cp + 2) == 0 && n != 0 && n <= elen - 5) {
+				ND_TCHECK_LEN(cp + 5, n);
+				h->sni = cp + 5;
+				h->sni_len = n;
+			}
+			break;
+
+		case TLS_EXT_ALPN:
+			if (elen < 2)
+				break;
+			n = GET_BE_U_2(cp);
+			if (n != 0 && n <= elen - 2) {
+				ND_TCHECK_LEN(cp + 2, n);
+				h->alpn = cp + 2;
+				h->alpn_len = n;
+			}
+			break;
+
+		case TLS_EXT_SUPPORTED_VERSIONS:
+			if (htype == TLS_SERVER_HELLO) {
+				if (elen == 2)
+					h->version = GET_BE_U_2(cp);
+				break;
+			}
+			if (elen < 1)
+				break;
+			n = GET_U_1(cp);
+			if (n > elen - 1)
+				n = elen - 1;
+			best = 0;
+			for (ep = cp + 1; n >= 2; ep += 2, n -= 2) {
+				v = GET_BE_U_2(ep);
+				if (!TLS_GREASE(v) && v > best)
+					best = v;
+			}
+			if (best != 0)
+				h->version = best;
+			break;
+		}
+		cp += elen;
+		len -= elen;
+	}
+	return;
+
+trunc:
+	/* Leave what didn't fit out; the caller prints the rest. */
+	return;
+}
+
+/*
+ * Parse a ClientHello or ServerHello, of which the "len" bytes at "cp"
+ * are in this segment.
+ */
+static void
+tls_hello_parse(netdissect_options *ndo, const u_char *cp, u_int len,
+		u_int htype, struct tls_hello *h)
+{
+	u_int n;
+
+	memset(h, 0, sizeof(*h));
+	/* legacy_version, random and the session ID's length */
+	if (len < 35)
+		return;
+	h->version = GET_BE_U_2(cp);
+	n = GET_U_1(cp + 34);
+	cp += 35;
+	len -= 35;
+	if (n > len)
+		return;
+	cp += n;
+	len -= n;
+	if (htype == TLS_CLIENT_HELLO) {
+		/* cipher_suites and compression_methods */
+		if (len < 2 || (n = GET_BE_U_2(cp)) > len - 2)
+			return;
+		cp += 2 + n;
+		len -= 2 + n;
+		if (len < 1 || (n = GET_U_1(cp)) > len - 1)
+			return;
+		cp += 1 + n;
+		len -= 1 + n;
+	} else {
+		/* cipher_suite and compression_method */
+		if (len < 3)
+			return;
+		h->cipher = GET_BE_U_2(cp);
+		cp += 3;
+		len -= 3;
+	}
+	if (len < 2)
+		return;
+	n = GET_BE_U_2(cp);
+	if (n > len - 2)
+		n = len - 2;
+	tls_hello_extensions(ndo, cp + 2, n, htype, h);
+}
+
+static void
+tls_hello_print(netdissect_options *ndo, const u_char *cp, u_int len,
+		u_int htype, int report)
+{
+	struct tls_hello h;
+	u_int n;
+	const u_char *p;
+	int first;
+
+	tls_hello_parse(ndo, cp, len, htype, &h);
+	if (h.version == 0)
+		return;
+	ND_PRINT(" %s", tok2str(tls_version_str, "version 0x%04x",
+	    h.version));
+	if (h.sni != NULL) {
+		ND_PRINT(", sni ");
+		(void)nd_printn(ndo, h.sni, h.sni_len, NULL);
+	}
+	if (h.alpn != NULL) {
+		first = 1;
+		for (p = h.alpn, len = h.alpn_len; len >= 1; ) {
+			n = GET_U_1(p);
+			if (n == 0 || n > len - 1)
+				break;
+			ND_PRINT("%s", first ? ", alpn " : ",");
+			(void)nd_printn(ndo, p + 1, n, NULL);
+			first = 0;
+			p += 1 + n;
+			len -= 1 + n;
+		}
+	}
+	if (htype == TLS_SERVER_HELLO)
+		ND_PRINT(", cipher 0x%04x", h.cipher);
+
+	if (!report)
+		return;
+	ND_FIELD_UINT(NDF_TLS, NDF_TLS_HELLO_VERSION, h.version);
+	if (h.sni != NULL)
+		ND_FIELD_NSTRING(NDF_TLS, NDF_TLS_SNI, h.sni, h.sni_len);
+	/* The client's first choice, or the server's. */
+	if (h.alpn != NULL && (n = GET_U_1(h.alpn)) != 0 &&
+	    n <= h.alpn_len - 1)
+		ND_FIELD_NSTRING(NDF_TLS, NDF_TLS_ALPN, h.alpn + 1, n);
+	if (htype == TLS_SERVER_HELLO)
+		ND_FIELD_UINT(NDF_TLS, NDF_TLS_CIPHER, h.cipher);
+}
+
+/*
+ * Print the handshake messages of a record of "reclen" bytes, the
+ * first "len" of them at "cp".
+ */
+static void
+tls_handshake_print(netdissect_options *ndo, const u_char *cp, u_int len,
+		    u_int reclen, int *reportedp)
+{
+	u_int htype, hlen;
+
+	while (len >= TLS_HANDSHAKE_HDR_LEN) {
+		htype = GET_U_1(cp);
+		hlen = GET_BE_U_3(cp + 1);
+		if (TLS_HANDSHAKE_HDR_LEN + hlen > reclen) {
+			/* A Finished after ChangeCipherSpec, or a fragment. */
+			ND_PRINT(", encrypted handshake");
+			return;
+		}
+		ND_PRINT(", %s", tok2str(tls_handshake_str, "handshake %u",
+		    htype));
+		if (!*reportedp)
+			ND_FIELD_UINT(NDF_TLS, NDF_TLS_HANDSHAKE, htype);
+		cp += TLS_HANDSHAKE_HDR_LEN;
+		len -= TLS_HANDSHAKE_HDR_LEN;
+		reclen -= TLS_HANDSHAKE_HDR_LEN;
+		if (htype == TLS_CLIENT_HELLO || htype == TLS_SERVER_HELLO) {
+			tls_hello_print(ndo, cp, hlen < len ? hlen : len, htype,
+			    !*reportedp);
+			*reportedp = 1;
+		}
+		if (hlen > len)
+			return;
+		cp += hlen;
+		len -= hlen;
+		reclen -= hlen;
+	}
+}
+
+/*
+ * Print the records that start at "bp", the "length" bytes of a
+ * segment or of reassembled records; return 0, having printed nothing,
+ * if it doesn't start with one.
+ */
+int
+tls_print(netdissect_options *ndo, const u_char *bp, u_int length)
+{
+	u_int type, version, reclen, avail;
+	int reported = 0;
+
+	ndo->ndo_protocol = "tls";
+	if (length < TLS_RECORD_HDR_LEN ||
+	    !ND_TTEST_LEN(bp, TLS_RECORD_HDR_LEN) ||
+	    tls_frame(bp, TLS_RECORD_HDR_LEN, &reclen) != 1)
+		return (0);
+
+	ND_PRINT(": TLS");
+	ND_FIELD_UINT(NDF_TLS, NDF_TLS_TYPE, GET_U_1(bp));
+	ND_FIELD_UINT(NDF_TLS, NDF_TLS_VERSION, GET_BE_U_2(bp + 1));
+	ND_FIELD_UINT(NDF_TLS, NDF_TLS_LEN, GET_BE_U_2(bp + 3));
+	while (length != 0) {
+		if (length < TLS_RECORD_HDR_LEN ||
+		    !ND_TTEST_LEN(bp, TLS_RECORD_HDR_LEN) ||
+		    tls_frame(bp, TLS_RECORD_HDR_LEN, &reclen) != 1) {
+			ND_PRINT(", ...");
+			break;
+		}
+		type = GET_U_1(bp);
+		version = GET_BE_U_2(bp + 1);
+		reclen -= TLS_RECORD_HDR_LEN;
+		bp += TLS_RECORD_HDR_LEN;
+		length -= TLS_RECORD_HDR_LEN;
+		avail = reclen < length ? reclen : length;
+
+		switch (type) {
+
+		case TLS_HANDSHAKE:
+			tls_handshake_print(ndo, bp, avail, reclen, &reported);
+			break;
+
+		case TLS_CHANGE_CIPHER_SPEC:
+			ND_PRINT(", change cipher spec");
+			break;
+
+		case TLS_ALERT:
+			if (reclen == 2 && avail == 2)
+				ND_PRINT(", %s alert %u",
+				    tok2str(tls_alert_level_str, "level %u",
+				    GET_U_1(bp)), GET_U_1(bp + 1));
+			else
+				ND_PRINT(", encrypted alert");
+			break;
+
+		case TLS_APPLICATION_DATA:
+			ND_PRINT(", application data %u", reclen);
+			break;
+
+		case TLS_HEARTBEAT:
+			ND_PRINT(", heartbeat %u", reclen);
+			break;
+		}
+		if (ndo->ndo_vflag)
+			ND_PRINT(" (%s)",
+			    tok2str(tls_version_str, "version 0x%04x", version));
+		if (reclen > length) {
+			/* The rest is in the segments that follow. */
+			break;
+		}
+		bp += reclen;
+		length -= reclen;
+	}
+	return (1);
+}
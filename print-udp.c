@@ -28,6 +28,7 @@
 #include "netdissect-stdinc.h"
 
 #include "netdissect.h"
+#include "netdissect-fields.h"
 #include "addrtoname.h"
 #include "extract.h"
 #include "appletalk.h"
@@ -41,6 +42,8 @@
 #include "rpc_msg.h"
 
 #include "nfs.h"
+#include "portdispatch.h"
+#include "rtp-analysis.h"
 
 
 struct rtcphdr {
@@ -228,6 +231,22 @@ trunc:
 	nd_print_trunc(ndo);
 }
 
+/*
+ * Follow the packet for --rtp-analysis, and print what it shows.
+ */
+static void
+udp_rtp_analyze(netdissect_options *ndo, const struct ip *ip,
+		const struct ip6_hdr *ip6, u_int sport, u_int dport,
+		const u_char *bp, u_int length)
+{
+	if (ip6)
+		rtp_analyze(ndo, ip6->ip6_src, ip6->ip6_dst,
+			    sizeof(ip6->ip6_src), sport, dport, bp, length);
+	else
+		rtp_analyze(ndo, ip->ip_src, ip->ip_dst, sizeof(ip->ip_src),
+			    sport, dport, bp, length);
+}
+
 static const u_char *
 rtcp_print(netdissect_options *ndo, const u_char *hdr, const u_char *ep)
 {
@@ -381,6 +400,752 @@ udpipaddr_print(netdissect_options *ndo, const struct ip *ip, int sport, int dpo
 	}
 }
 
+/*
+ * Application printers chosen by port, in the order they're tried.
+ */
+
+static int
+udp_dns_dissect(netdissect_options *ndo, const u_char *bp,
+    u_int length, const struct port_info *pi)
+{
+	if (ndo->ndo_latency)
+		domain_latency(ndo, bp, length, pi->iph, pi->sport, pi->dport);
+	domain_print(ndo, bp, length, 0);
+	return (1);
+}
+
+static int
+udp_mdns_dissect(netdissect_options *ndo, const u_char *bp,
+    u_int length, const struct port_info *pi _U_)
+{
+	domain_print(ndo, bp, length, 1);
+	return (1);
+}
+
+#ifndef ND_OMIT_TIMED
+static int
+udp_timed_dissect(netdissect_options *ndo, const u_char *bp,
+    u_int length _U_, const struct port_info *pi _U_)
+{
+	timed_print(ndo, bp);
+	return (1);
+}
+#else
+#define udp_timed_dissect	NULL
+#endif
+
+#ifndef ND_OMIT_TFTP
+static int
+udp_tftp_dissect(netdissect_options *ndo, const u_char *bp,
+    u_int length, const struct port_info *pi _U_)
+{
+	tftp_print(ndo, bp, length);
+	return (1);
+}
+#else
+#define udp_tftp_dissect	NULL
+#endif
+
+#ifndef ND_OMIT_BOOTP
+static int
+udp_bootp_dissect(netdissect_options *ndo, const u_char *bp,
+    u_int length, const struct port_info *pi _U_)
+{
+	bootp_print(ndo, bp, length);
+	return (1);
+}
+#else
+#define udp_bootp_dissect	NULL
+#endif
+
+#ifndef ND_OMIT_RIP
+static int
+udp_rip_dissect(netdissect_options *ndo, const u_char *bp,
+    u_int length, const struct port_info *pi _U_)
+{
+	rip_print(ndo, bp, length);
+	return (1);
+}
+#else
+#define udp_rip_dissect	NULL
+#endif
+
+#ifndef ND_OMIT_AODV
+static int
+udp_aodv_dissect(netdissect_options *ndo, const u_char *bp,
+    u_int length, const struct port_info *pi)
+{
+	aodv_print(ndo, bp, length, IP_V((const struct ip *)pi->iph) == 6);
+	return (1);
+}
+#else
+#define udp_aodv_dissect	NULL
+#endif
+
+#ifndef ND_OMIT_ISAKMP
+static int
+udp_isakmp_dissect(netdissect_options *ndo, const u_char *bp,
+    u_int length, const struct port_info *pi)
+{
+	isakmp_print(ndo, bp, length, pi->iph);
+	return (1);
+}
+#else
+#define udp_isakmp_dissect	NULL
+#endif
+
+#ifndef ND_OMIT_ISAKMP
+static int
+udp_isakmp_natt_dissect(netdissect_options *ndo, const u_char *bp,
+    u_int length, const struct port_info *pi)
+{
+	isakmp_rfc3948_print(ndo, bp, length, pi->iph,
+	    IP_V((const struct ip *)pi->iph), pi->fragmented, pi->ttl_hl);
+	return (1);
+}
+#else
+#define udp_isakmp_natt_dissect	NULL
+#endif
+
+static int
+udp_snmp_dissect(netdissect_options *ndo, const u_char *bp,
+    u_int length, const struct port_info *pi _U_)
+{
+	snmp_print(ndo, bp, length);
+	return (1);
+}
+
+#ifndef ND_OMIT_NTP
+static int
+udp_ntp_dissect(netdissect_options *ndo, const u_char *bp,
+    u_int length, const struct port_info *pi _U_)
+{
+	ntp_print(ndo, bp, length);
+	return (1);
+}
+#else
+#define udp_ntp_dissect	NULL
+#endif
+
+#ifndef ND_OMIT_KRB
+static int
+udp_krb_dissect(netdissect_options *ndo, const u_char *bp,
+    u_int length _U_, const struct port_info *pi _U_)
+{
+	krb_print(ndo, bp);
+	return (1);
+}
+#else
+#define udp_krb_dissect	NULL
+#endif
+
+#ifndef ND_OMIT_L2TP
+static int
+udp_l2tp_dissect(netdissect_options *ndo, const u_char *bp,
+    u_int length, const struct port_info *pi _U_)
+{
+	l2tp_print(ndo, bp, length);
+	return (1);
+}
+#else
+#define udp_l2tp_dissect	NULL
+#endif
+
+#ifdef ENABLE_SMB
+static int
+udp_nbt_ns_dissect(netdissect_options *ndo, const u_char *bp,
+    u_int length, const struct port_info *pi _U_)
+{
+	nbt_udp137_print(ndo, bp, length);
+	return (1);
+}
+
+static int
+udp_nbt_dgram_dissect(netdissect_options *ndo, const u_char *bp,
+    u_int length, const struct port_info *pi _U_)
+{
+	nbt_udp138_print(ndo, bp, length);
+	return (1);
+}
+#endif
+
+static int
+udp_vat_dissect(netdissect_options *ndo, const u_char *bp,
+    u_int length, const struct port_info *pi _U_)
+{
+	vat_print(ndo, bp, length);
+	return (1);
+}
+
+#ifndef ND_OMIT_ZEPHYR
+static int
+udp_zephyr_dissect(netdissect_options *ndo, const u_char *bp,
+    u_int length, const struct port_info *pi _U_)
+{
+	zephyr_print(ndo, bp, length);
+	return (1);
+}
+#else
+#define udp_zephyr_dissect	NULL
+#endif
+
+#ifndef ND_OMIT_RX
+static int
+udp_rx_dissect(netdissect_options *ndo, const u_char *bp,
+    u_int length, const struct port_info *pi)
+{
+	rx_print(ndo, bp, length, pi->sport, pi->dport, pi->iph);
+	return (1);
+}
+#else
+#define udp_rx_dissect	NULL
+#endif
+
+#ifndef ND_OMIT_RIPNG
+static int
+udp_ripng_dissect(netdissect_options *ndo, const u_char *bp,
+    u_int length, const struct port_info *pi _U_)
+{
+	ripng_print(ndo, bp, length);
+	return (1);
+}
+#else
+#define udp_ripng_dissect	NULL
+#endif
+
+#ifndef ND_OMIT_DHCP6
+static int
+udp_dhcp6_dissect(netdissect_options *ndo, const u_char *bp,
+    u_int length, const struct port_info *pi _U_)
+{
+	dhcp6_print(ndo, bp, length);
+	return (1);
+}
+#else
+#define udp_dhcp6_dissect	NULL
+#endif
+
+#ifndef ND_OMIT_AHCP
+static int
+udp_ahcp_dissect(netdissect_options *ndo, const u_char *bp,
+    u_int length, const struct port_info *pi _U_)
+{
+	ahcp_print(ndo, bp, length);
+	return (1);
+}
+#else
+#define udp_ahcp_dissect	NULL
+#endif
+
+#ifndef ND_OMIT_BABEL
+static int
+udp_babel_dissect(netdissect_options *ndo, const u_char *bp,
+    u_int length, const struct port_info *pi _U_)
+{
+	babel_print(ndo, bp, length);
+	return (1);
+}
+#else
+#define udp_babel_dissect	NULL
+#endif
+
+#ifndef ND_OMIT_HNCP
+static int
+udp_hncp_dissect(netdissect_options *ndo, const u_char *bp,
+    u_int length, const struct port_info *pi _U_)
+{
+	hncp_print(ndo, bp, length);
+	return (1);
+}
+#else
+#define udp_hncp_dissect	NULL
+#endif
+
+#ifndef ND_OMIT_WB
+static int
+udp_wb_dissect(netdissect_options *ndo, const u_char *bp,
+    u_int length, const struct port_info *pi _U_)
+{
+	wb_print(ndo, bp, length);
+	return (1);
+}
+#else
+#define udp_wb_dissect	NULL
+#endif
+
+static int
+udp_cisco_autorp_dissect(netdissect_options *ndo, const u_char *bp,
+    u_int length, const struct port_info *pi _U_)
+{
+	cisco_autorp_print(ndo, bp, length);
+	return (1);
+}
+
+static int
+udp_radius_dissect(netdissect_options *ndo, const u_char *bp,
+    u_int length, const struct port_info *pi)
+{
+	if (ndo->ndo_latency)
+		radius_latency(ndo, bp, length, pi->iph, pi->sport, pi->dport);
+	radius_print(ndo, bp, length);
+	return (1);
+}
+
+#ifndef ND_OMIT_HSRP
+static int
+udp_hsrp_dissect(netdissect_options *ndo, const u_char *bp,
+    u_int length, const struct port_info *pi _U_)
+{
+	hsrp_print(ndo, bp, length);
+	return (1);
+}
+#else
+#define udp_hsrp_dissect	NULL
+#endif
+
+#ifndef ND_OMIT_LWRES
+static int
+udp_lwres_dissect(netdissect_options *ndo, const u_char *bp,
+    u_int length, const struct port_info *pi _U_)
+{
+	lwres_print(ndo, bp, length);
+	return (1);
+}
+#else
+#define udp_lwres_dissect	NULL
+#endif
+
+#ifndef ND_OMIT_LDP
+static int
+udp_ldp_dissect(netdissect_options *ndo, const u_char *bp,
+    u_int length, const struct port_info *pi _U_)
+{
+	ldp_print(ndo, bp, length);
+	return (1);
+}
+#else
+#define udp_ldp_dissect	NULL
+#endif
+
+#ifndef ND_OMIT_OLSR
+static int
+udp_olsr_dissect(netdissect_options *ndo, const u_char *bp,
+    u_int length, const struct port_info *pi)
+{
+	olsr_print(ndo, bp, length,
+	    (IP_V((const struct ip *)pi->iph) == 6) ? 1 : 0);
+	return (1);
+}
+#else
+#define udp_olsr_dissect	NULL
+#endif
+
+#ifndef ND_OMIT_LSPPING
+static int
+udp_lspping_dissect(netdissect_options *ndo, const u_char *bp,
+    u_int length, const struct port_info *pi _U_)
+{
+	lspping_print(ndo, bp, length);
+	return (1);
+}
+#else
+#define udp_lspping_dissect	NULL
+#endif
+
+static int
+udp_bfd_dissect(netdissect_options *ndo, const u_char *bp,
+    u_int length, const struct port_info *pi)
+{
+	bfd_print(ndo, bp, length, pi->dport, pi->iph);
+	return (1);
+}
+
+#ifndef ND_OMIT_LMP
+static int
+udp_lmp_dissect(netdissect_options *ndo, const u_char *bp,
+    u_int length, const struct port_info *pi _U_)
+{
+	lmp_print(ndo, bp, length);
+	return (1);
+}
+#else
+#define udp_lmp_dissect	NULL
+#endif
+
+#ifndef ND_OMIT_VQP
+static int
+udp_vqp_dissect(netdissect_options *ndo, const u_char *bp,
+    u_int length, const struct port_info *pi _U_)
+{
+	vqp_print(ndo, bp, length);
+	return (1);
+}
+#else
+#define udp_vqp_dissect	NULL
+#endif
+
+#ifndef ND_OMIT_SFLOW
+static int
+udp_sflow_dissect(netdissect_options *ndo, const u_char *bp,
+    u_int length, const struct port_info *pi _U_)
+{
+	sflow_print(ndo, bp, length);
+	return (1);
+}
+#else
+#define udp_sflow_dissect	NULL
+#endif
+
+#ifndef ND_OMIT_CNFP
+static int
+udp_cnfp_dissect(netdissect_options *ndo, const u_char *bp,
+    u_int length, const struct port_info *pi)
+{
+	cnfp_print(ndo, bp, length, pi->iph);
+	return (1);
+}
+#else
+#define udp_cnfp_dissect	NULL
+#endif
+
+static int
+udp_lwapp_control_dissect(netdissect_options *ndo, const u_char *bp,
+    u_int length, const struct port_info *pi)
+{
+	lwapp_control_print(ndo, bp, length, pi->side == PORT_DST);
+	return (1);
+}
+
+static int
+udp_lwapp_data_dissect(netdissect_options *ndo, const u_char *bp,
+    u_int length, const struct port_info *pi _U_)
+{
+	lwapp_data_print(ndo, bp, length);
+	return (1);
+}
+
+#ifndef ND_OMIT_SIP
+static int
+udp_sip_dissect(netdissect_options *ndo, const u_char *bp,
+    u_int length, const struct port_info *pi _U_)
+{
+	sip_print(ndo, bp, length);
+	return (1);
+}
+#else
+#define udp_sip_dissect	NULL
+#endif
+
+#ifndef ND_OMIT_SYSLOG
+static int
+udp_syslog_dissect(netdissect_options *ndo, const u_char *bp,
+    u_int length, const struct port_info *pi _U_)
+{
+	syslog_print(ndo, bp, length);
+	return (1);
+}
+#else
+#define udp_syslog_dissect	NULL
+#endif
+
+#ifndef ND_OMIT_OTV
+static int
+udp_otv_dissect(netdissect_options *ndo, const u_char *bp,
+    u_int length, const struct port_info *pi _U_)
+{
+	otv_print(ndo, bp, length);
+	return (1);
+}
+#else
+#define udp_otv_dissect	NULL
+#endif
+
+static int
+udp_vxlan_dissect(netdissect_options *ndo, const u_char *bp,
+    u_int length, const struct port_info *pi _U_)
+{
+	vxlan_print(ndo, bp, length);
+	return (1);
+}
+
+static int
+udp_geneve_dissect(netdissect_options *ndo, const u_char *bp,
+    u_int length, const struct port_info *pi _U_)
+{
+	geneve_print(ndo, bp, length);
+	return (1);
+}
+
+#ifndef ND_OMIT_LISP
+static int
+udp_lisp_dissect(netdissect_options *ndo, const u_char *bp,
+    u_int length, const struct port_info *pi _U_)
+{
+	lisp_print(ndo, bp, length);
+	return (1);
+}
+#else
+#define udp_lisp_dissect	NULL
+#endif
+
+static int
+udp_vxlan_gpe_dissect(netdissect_options *ndo, const u_char *bp,
+    u_int length, const struct port_info *pi _U_)
+{
+	vxlan_gpe_print(ndo, bp, length);
+	return (1);
+}
+
+#ifndef ND_OMIT_ZEP
+static int
+udp_zep_dissect(netdissect_options *ndo, const u_char *bp,
+    u_int length, const struct port_info *pi _U_)
+{
+	zep_print(ndo, bp, length);
+	return (1);
+}
+#else
+#define udp_zep_dissect	NULL
+#endif
+
+static int
+udp_mpls_dissect(netdissect_options *ndo, const u_char *bp,
+    u_int length, const struct port_info *pi _U_)
+{
+	mpls_print(ndo, bp, length);
+	return (1);
+}
+
+static int
+udp_kip_dissect(netdissect_options *ndo, const u_char *bp, u_int length,
+    const struct port_info *pi _U_)
+{
+	if (!ND_TTEST_1(((const struct LAP *)bp)->type) ||
+	    GET_U_1(((const struct LAP *)bp)->type) != lapDDP)
+		return (0);
+	if (ndo->ndo_vflag)
+		ND_PRINT("kip ");
+	llap_print(ndo, bp, length);
+	return (1);
+}
+
+static int
+udp_ptp_dissect(netdissect_options *ndo, const u_char *bp,
+    u_int length, const struct port_info *pi _U_)
+{
+	ptp_print(ndo, bp, length);
+	return (1);
+}
+
+#ifndef ND_OMIT_SOMEIP
+static int
+udp_someip_dissect(netdissect_options *ndo, const u_char *bp,
+    u_int length, const struct port_info *pi _U_)
+{
+	someip_print(ndo, bp, length);
+	return (1);
+}
+#else
+#define udp_someip_dissect	NULL
+#endif
+
+enum {
+	UDP_DNS,
+	UDP_MDNS,
+	UDP_TIMED,
+	UDP_TFTP,
+	UDP_BOOTP,
+	UDP_RIP,
+	UDP_AODV,
+	UDP_ISAKMP,
+	UDP_ISAKMP_NATT,
+	UDP_SNMP,
+	UDP_NTP,
+	UDP_KRB,
+	UDP_L2TP,
+#ifdef ENABLE_SMB
+	UDP_NBT_NS,
+	UDP_NBT_DGRAM,
+#endif
+	UDP_VAT,
+	UDP_ZEPHYR,
+	UDP_RX,
+	UDP_RIPNG,
+	UDP_DHCP6,
+	UDP_AHCP,
+	UDP_BABEL,
+	UDP_HNCP,
+	UDP_WB,
+	UDP_CISCO_AUTORP,
+	UDP_RADIUS,
+	UDP_HSRP,
+	UDP_LWRES,
+	UDP_LDP,
+	UDP_OLSR,
+	UDP_LSPPING,
+	UDP_BFD,
+	UDP_LMP,
+	UDP_VQP,
+	UDP_SFLOW,
+	UDP_CNFP,
+	UDP_LWAPP_CONTROL,
+	UDP_LWAPP_DATA,
+	UDP_SIP,
+	UDP_SYSLOG,
+	UDP_OTV,
+	UDP_VXLAN,
+	UDP_GENEVE,
+	UDP_LISP,
+	UDP_VXLAN_GPE,
+	UDP_ZEP,
+	UDP_MPLS,
+	UDP_KIP,
+	UDP_PTP,
+	UDP_SOMEIP,
+};
+
+static const struct port_dissector udp_port_dissectors[] = {
+	{ "dns", udp_dns_dissect, NULL, 0 },
+	{ "mdns", udp_mdns_dissect, NULL, 0 },
+	{ "timed", udp_timed_dissect, NULL, 0 },
+	{ "tftp", udp_tftp_dissect, NULL, 0 },
+	{ "bootp", udp_bootp_dissect, NULL, 0 },
+	{ "rip", udp_rip_dissect, NULL, 0 },
+	{ "aodv", udp_aodv_dissect, NULL, 0 },
+	{ "isakmp", udp_isakmp_dissect, NULL, 0 },
+	{ "isakmp_natt", udp_isakmp_natt_dissect, NULL, 0 },
+	{ "snmp", udp_snmp_dissect, NULL, 0 },
+	{ "ntp", udp_ntp_dissect, NULL, 0 },
+	{ "krb", udp_krb_dissect, NULL, 0 },
+	{ "l2tp", udp_l2tp_dissect, NULL, 0 },
+#ifdef ENABLE_SMB
+	{ "nbt_ns", udp_nbt_ns_dissect, NULL, 0 },
+	{ "nbt_dgram", udp_nbt_dgram_dissect, NULL, 0 },
+#endif
+	{ "vat", udp_vat_dissect, NULL, 0 },
+	{ "zephyr", udp_zephyr_dissect, NULL, 0 },
+	{ "rx", udp_rx_dissect, NULL, 0 },
+	{ "ripng", udp_ripng_dissect, NULL, 0 },
+	{ "dhcp6", udp_dhcp6_dissect, NULL, 0 },
+	{ "ahcp", udp_ahcp_dissect, NULL, 0 },
+	{ "babel", udp_babel_dissect, NULL, 0 },
+	{ "hncp", udp_hncp_dissect, NULL, 0 },
+	{ "wb", udp_wb_dissect, NULL, 0 },
+	{ "cisco_autorp", udp_cisco_autorp_dissect, NULL, 0 },
+	{ "radius", udp_radius_dissect, NULL, 0 },
+	{ "hsrp", udp_hsrp_dissect, NULL, 0 },
+	{ "lwres", udp_lwres_dissect, NULL, 0 },
+	{ "ldp", udp_ldp_dissect, NULL, 0 },
+	{ "olsr", udp_olsr_dissect, NULL, 0 },
+	{ "lspping", udp_lspping_dissect, NULL, 0 },
+	{ "bfd", udp_bfd_dissect, NULL, 0 },
+	{ "lmp", udp_lmp_dissect, NULL, 0 },
+	{ "vqp", udp_vqp_dissect, NULL, 0 },
+	{ "sflow", udp_sflow_dissect, NULL, 0 },
+	{ "cnfp", udp_cnfp_dissect, NULL, 0 },
+	{ "lwapp_control", udp_lwapp_control_dissect, NULL, 0 },
+	{ "lwapp_data", udp_lwapp_data_dissect, NULL, 0 },
+	{ "sip", udp_sip_dissect, NULL, 0 },
+	{ "syslog", udp_syslog_dissect, NULL, 0 },
+	{ "otv", udp_otv_dissect, NULL, 0 },
+	{ "vxlan", udp_vxlan_dissect, NULL, 0 },
+	{ "geneve", udp_geneve_dissect, NULL, 0 },
+	{ "lisp", udp_lisp_dissect, NULL, 0 },
+	{ "vxlan_gpe", udp_vxlan_gpe_dissect, NULL, 0 },
+	{ "zep", udp_zep_dissect, NULL, 0 },
+	{ "mpls", udp_mpls_dissect, NULL, 0 },
+	{ "kip", udp_kip_dissect, NULL, 0 },
+	{ "ptp", udp_ptp_dissect, NULL, 0 },
+	{ "someip", udp_someip_dissect, NULL, 0 },
+	{ NULL, NULL, NULL, 0 }
+};
+
+static const struct port_rule udp_port_rules[] = {
+	/*
+	 * Since there are 10 possible ports to check, a range
+	 * is used for RX.  VAT, WB, HSRP and BFD are only
+	 * recognized by destination port.
+	 */
+	{ NAMESERVER_PORT, NAMESERVER_PORT, PORT_EITHER, UDP_DNS },
+	{ MULTICASTDNS_PORT, MULTICASTDNS_PORT, PORT_EITHER, UDP_MDNS },
+	{ TIMED_PORT, TIMED_PORT, PORT_EITHER, UDP_TIMED },
+	{ TFTP_PORT, TFTP_PORT, PORT_EITHER, UDP_TFTP },
+	{ BOOTPC_PORT, BOOTPC_PORT, PORT_EITHER, UDP_BOOTP },
+	{ BOOTPS_PORT, BOOTPS_PORT, PORT_EITHER, UDP_BOOTP },
+	{ RIP_PORT, RIP_PORT, PORT_EITHER, UDP_RIP },
+	{ AODV_PORT, AODV_PORT, PORT_EITHER, UDP_AODV },
+	{ ISAKMP_PORT, ISAKMP_PORT, PORT_EITHER, UDP_ISAKMP },
+	{ ISAKMP_PORT_NATT, ISAKMP_PORT_NATT, PORT_EITHER, UDP_ISAKMP_NATT },
+	{ ISAKMP_PORT_USER1, ISAKMP_PORT_USER1, PORT_EITHER, UDP_ISAKMP },
+	{ ISAKMP_PORT_USER2, ISAKMP_PORT_USER2, PORT_EITHER, UDP_ISAKMP },
+	{ SNMP_PORT, SNMP_PORT, PORT_EITHER, UDP_SNMP },
+	{ SNMPTRAP_PORT, SNMPTRAP_PORT, PORT_EITHER, UDP_SNMP },
+	{ NTP_PORT, NTP_PORT, PORT_EITHER, UDP_NTP },
+	{ KERBEROS_PORT, KERBEROS_PORT, PORT_EITHER, UDP_KRB },
+	{ KERBEROS_SEC_PORT, KERBEROS_SEC_PORT, PORT_EITHER, UDP_KRB },
+	{ L2TP_PORT, L2TP_PORT, PORT_EITHER, UDP_L2TP },
+#ifdef ENABLE_SMB
+	{ NETBIOS_NS_PORT, NETBIOS_NS_PORT, PORT_EITHER, UDP_NBT_NS },
+	{ NETBIOS_DGRAM_PORT, NETBIOS_DGRAM_PORT, PORT_EITHER, UDP_NBT_DGRAM },
+#endif
+	{ VAT_PORT, VAT_PORT, PORT_DST, UDP_VAT },
+	{ ZEPHYR_SRV_PORT, ZEPHYR_SRV_PORT, PORT_EITHER, UDP_ZEPHYR },
+	{ ZEPHYR_CLT_PORT, ZEPHYR_CLT_PORT, PORT_EITHER, UDP_ZEPHYR },
+	{ RX_PORT_LOW, RX_PORT_HIGH, PORT_EITHER, UDP_RX },
+	{ RIPNG_PORT, RIPNG_PORT, PORT_EITHER, UDP_RIPNG },
+	{ DHCP6_SERV_PORT, DHCP6_SERV_PORT, PORT_EITHER, UDP_DHCP6 },
+	{ DHCP6_CLI_PORT, DHCP6_CLI_PORT, PORT_EITHER, UDP_DHCP6 },
+	{ AHCP_PORT, AHCP_PORT, PORT_EITHER, UDP_AHCP },
+	{ BABEL_PORT, BABEL_PORT, PORT_EITHER, UDP_BABEL },
+	{ BABEL_PORT_OLD, BABEL_PORT_OLD, PORT_EITHER, UDP_BABEL },
+	{ HNCP_PORT, HNCP_PORT, PORT_EITHER, UDP_HNCP },
+	{ WB_PORT, WB_PORT, PORT_DST, UDP_WB },
+	{ CISCO_AUTORP_PORT, CISCO_AUTORP_PORT, PORT_EITHER, UDP_CISCO_AUTORP },
+	{ RADIUS_PORT, RADIUS_PORT, PORT_EITHER, UDP_RADIUS },
+	{ RADIUS_NEW_PORT, RADIUS_NEW_PORT, PORT_EITHER, UDP_RADIUS },
+	{ RADIUS_ACCOUNTING_PORT, RADIUS_ACCOUNTING_PORT, PORT_EITHER, UDP_RADIUS },
+	{ RADIUS_NEW_ACCOUNTING_PORT, RADIUS_NEW_ACCOUNTING_PORT, PORT_EITHER, UDP_RADIUS },
+	{ RADIUS_CISCO_COA_PORT, RADIUS_CISCO_COA_PORT, PORT_EITHER, UDP_RADIUS },
+	{ RADIUS_COA_PORT, RADIUS_COA_PORT, PORT_EITHER, UDP_RADIUS },
+	{ HSRP_PORT, HSRP_PORT, PORT_DST, UDP_HSRP },
+	{ LWRES_PORT, LWRES_PORT, PORT_EITHER, UDP_LWRES },
+	{ LDP_PORT, LDP_PORT, PORT_EITHER, UDP_LDP },
+	{ OLSR_PORT, OLSR_PORT, PORT_EITHER, UDP_OLSR },
+	{ MPLS_LSP_PING_PORT, MPLS_LSP_PING_PORT, PORT_EITHER, UDP_LSPPING },
+	{ BFD_CONTROL_PORT, BFD_CONTROL_PORT, PORT_DST, UDP_BFD },
+	{ BFD_MULTIHOP_PORT, BFD_MULTIHOP_PORT, PORT_DST, UDP_BFD },
+	{ BFD_LAG_PORT, BFD_LAG_PORT, PORT_DST, UDP_BFD },
+	{ BFD_ECHO_PORT, BFD_ECHO_PORT, PORT_DST, UDP_BFD },
+	{ LMP_PORT, LMP_PORT, PORT_EITHER, UDP_LMP },
+	{ VQP_PORT, VQP_PORT, PORT_EITHER, UDP_VQP },
+	{ SFLOW_PORT, SFLOW_PORT, PORT_EITHER, UDP_SFLOW },
+	{ IPFIX_PORT, IPFIX_PORT, PORT_EITHER, UDP_CNFP },
+	{ LWAPP_CONTROL_PORT, LWAPP_CONTROL_PORT, PORT_EITHER, UDP_LWAPP_CONTROL },
+	{ LWAPP_DATA_PORT, LWAPP_DATA_PORT, PORT_EITHER, UDP_LWAPP_DATA },
+	{ SIP_PORT, SIP_PORT, PORT_EITHER, UDP_SIP },
+	{ SYSLOG_PORT, SYSLOG_PORT, PORT_EITHER, UDP_SYSLOG },
+	{ OTV_PORT, OTV_PORT, PORT_EITHER, UDP_OTV },
+	{ VXLAN_PORT, VXLAN_PORT, PORT_EITHER, UDP_VXLAN },
+	{ GENEVE_PORT, GENEVE_PORT, PORT_EITHER, UDP_GENEVE },
+	{ LISP_CONTROL_PORT, LISP_CONTROL_PORT, PORT_EITHER, UDP_LISP },
+	{ VXLAN_GPE_PORT, VXLAN_GPE_PORT, PORT_EITHER, UDP_VXLAN_GPE },
+	{ ZEP_PORT, ZEP_PORT, PORT_EITHER, UDP_ZEP },
+	{ MPLS_PORT, MPLS_PORT, PORT_EITHER, UDP_MPLS },
+	/* the ports atalk_port() accepts */
+	{ 16512, 16639, PORT_EITHER, UDP_KIP },
+	{ 200, 327, PORT_EITHER, UDP_KIP },
+	{ 768, 895, PORT_EITHER, UDP_KIP },
+	{ PTP_EVENT_PORT, PTP_EVENT_PORT, PORT_EITHER, UDP_PTP },
+	{ PTP_GENERAL_PORT, PTP_GENERAL_PORT, PORT_EITHER, UDP_PTP },
+	{ SOMEIP_PORT, SOMEIP_PORT, PORT_EITHER, UDP_SOMEIP },
+};
+
+struct port_table udp_port_table = {
+	udp_port_dissectors,
+	udp_port_rules, sizeof(udp_port_rules) / sizeof(udp_port_rules[0]),
+	NULL, 0, 0, { NULL, NULL }, NULL, 0, 0
+};
+
 void
 udp_print(netdissect_options *ndo, const u_char *bp, u_int length,
 	  const u_char *bp2, int fragmented, u_int ttl_hl)
@@ -405,8 +1170,8 @@ udp_print(netdissect_options *ndo, const u_char *bp, u_int length,
 		goto trunc;
 	}
 
-	sport = GET_BE_U_2(up->uh_sport);
-	dport = GET_BE_U_2(up->uh_dport);
+	sport = EXTRACT_BE_U_2(up->uh_sport);
+	dport = EXTRACT_BE_U_2(up->uh_dport);
 
 	if (length < sizeof(struct udphdr)) {
 		udpipaddr_print(ndo, ip, sport, dport);
@@ -417,7 +1182,7 @@ udp_print(netdissect_options *ndo, const u_char *bp, u_int length,
 		udpipaddr_print(ndo, ip, sport, dport);
 		goto trunc;
 	}
-	ulen = GET_BE_U_2(up->uh_ulen);
+	ulen = EXTRACT_BE_U_2(up->uh_ulen);
 	/*
 	 * IPv6 Jumbo Datagrams; see RFC 2675.
 	 * If the length is zero, and the length provided to us is
@@ -425,6 +1190,9 @@ udp_print(netdissect_options *ndo, const u_char *bp, u_int length,
 	 */
 	if (ulen == 0 && length > 65535)
 		ulen = length;
+	ND_FIELD_UINT(NDF_UDP, NDF_UDP_SPORT, sport);
+	ND_FIELD_UINT(NDF_UDP, NDF_UDP_DPORT, dport);
+	ND_FIELD_UINT(NDF_UDP, NDF_UDP_LEN, ulen);
 	if (ulen < sizeof(struct udphdr)) {
 		udpipaddr_print(ndo, ip, sport, dport);
 		ND_PRINT("truncated-udplength %u", ulen);
@@ -452,26 +1220,36 @@ udp_print(netdissect_options *ndo, const u_char *bp, u_int length,
 			vat_print(ndo, (const void *)(up + 1), length);
 			break;
 
+#ifndef ND_OMIT_WB
 		case PT_WB:
 			udpipaddr_print(ndo, ip, sport, dport);
 			wb_print(ndo, (const u_char *)(up + 1), length);
 			break;
+#endif
 
 		case PT_RPC:
 			rp = (const struct sunrpc_msg *)(up + 1);
 			ND_TCHECK_4(rp->rm_direction);
-			direction = (enum sunrpc_msg_type) GET_BE_U_4(rp->rm_direction);
+			direction = (enum sunrpc_msg_type) EXTRACT_BE_U_4(rp->rm_direction);
 			if (direction == SUNRPC_CALL)
 				sunrpc_print(ndo, (const u_char *)rp, length,
 				    (const u_char *)ip);
-			else
+			else {
+				if (ndo->ndo_latency)
+					sunrpc_reply_latency(ndo,
+					    (const u_char *)rp,
+					    (const u_char *)ip);
 				nfsreply_print(ndo, (const u_char *)rp, length,
 				    (const u_char *)ip);			/*XXX*/
+			}
 			break;
 
 		case PT_RTP:
 			udpipaddr_print(ndo, ip, sport, dport);
 			rtp_print(ndo, (const void *)(up + 1), length);
+			if (ndo->ndo_rtp_analysis)
+				udp_rtp_analyze(ndo, ip, ip6, sport, dport,
+				    cp, length);
 			break;
 
 		case PT_RTCP:
@@ -485,21 +1263,27 @@ udp_print(netdissect_options *ndo, const u_char *bp, u_int length,
 			snmp_print(ndo, (const u_char *)(up + 1), length);
 			break;
 
+#ifndef ND_OMIT_CNFP
 		case PT_CNFP:
 			udpipaddr_print(ndo, ip, sport, dport);
-			cnfp_print(ndo, cp);
+			cnfp_print(ndo, cp, length, (const u_char *)ip);
 			break;
+#endif
 
+#ifndef ND_OMIT_TFTP
 		case PT_TFTP:
 			udpipaddr_print(ndo, ip, sport, dport);
 			tftp_print(ndo, cp, length);
 			break;
+#endif
 
+#ifndef ND_OMIT_AODV
 		case PT_AODV:
 			udpipaddr_print(ndo, ip, sport, dport);
 			aodv_print(ndo, (const u_char *)(up + 1), length,
 			    ip6 != NULL);
 			break;
+#endif
 
 		case PT_RADIUS:
 			udpipaddr_print(ndo, ip, sport, dport);
@@ -516,18 +1300,22 @@ udp_print(netdissect_options *ndo, const u_char *bp, u_int length,
 			udpipaddr_print(ndo, ip, sport, dport);
 			pgm_print(ndo, cp, length, bp2);
 			break;
+#ifndef ND_OMIT_LMP
 		case PT_LMP:
 			udpipaddr_print(ndo, ip, sport, dport);
 			lmp_print(ndo, cp, length);
 			break;
+#endif
 		case PT_PTP:
 			udpipaddr_print(ndo, ip, sport, dport);
 			ptp_print(ndo, cp, length);
 			break;
+#ifndef ND_OMIT_SOMEIP
 		case PT_SOMEIP:
 			udpipaddr_print(ndo, ip, sport, dport);
 			someip_print(ndo, cp, length);
 			break;
+#endif
 		}
 		return;
 	}
@@ -571,9 +1359,14 @@ udp_print(netdissect_options *ndo, const u_char *bp, u_int length,
 		 * XXX - do this even if vflag == 1?
 		 * TCP does, and we do so for UDP-over-IPv6.
 		 */
-	        if (IP_V(ip) == 4 && (ndo->ndo_vflag > 1)) {
+		if (ND_CKSUM_OFFLOADED(ndo)) {
+			/* Possibly not filled in yet; see netdissect.h. */
+			if (IP_V(ip) == 6 || ndo->ndo_vflag > 1)
+				ND_PRINT("[udp sum unverified, outgoing] ");
+		}
+	        else if (IP_V(ip) == 4 && (ndo->ndo_vflag > 1)) {
 			ND_TCHECK_2(up->uh_sum);
-			udp_sum = GET_BE_U_2(up->uh_sum);
+			udp_sum = EXTRACT_BE_U_2(up->uh_sum);
 			if (udp_sum == 0) {
 				ND_PRINT("[no cksum] ");
 			} else if (ND_TTEST_LEN(cp, length)) {
@@ -592,7 +1385,7 @@ udp_print(netdissect_options *ndo, const u_char *bp, u_int length,
 			if (ND_TTEST_LEN(cp, length)) {
 				sum = udp6_cksum(ndo, ip6, up, length + sizeof(struct udphdr));
 				ND_TCHECK_2(up->uh_sum);
-				udp_sum = GET_BE_U_2(up->uh_sum);
+				udp_sum = EXTRACT_BE_U_2(up->uh_sum);
 
 	                        if (sum != 0) {
 					ND_PRINT("[bad udp cksum 0x%04x -> 0x%04x!] ",
@@ -605,135 +1398,14 @@ udp_print(netdissect_options *ndo, const u_char *bp, u_int length,
 	}
 
 	if (!ndo->ndo_qflag) {
-		if (IS_SRC_OR_DST_PORT(NAMESERVER_PORT))
-			domain_print(ndo, (const u_char *)(up + 1), length, 0);
-		else if (IS_SRC_OR_DST_PORT(MULTICASTDNS_PORT))
-			domain_print(ndo, (const u_char *)(up + 1), length, 1);
-		else if (IS_SRC_OR_DST_PORT(TIMED_PORT))
-			timed_print(ndo, (const u_char *)(up + 1));
-		else if (IS_SRC_OR_DST_PORT(TFTP_PORT))
-			tftp_print(ndo, (const u_char *)(up + 1), length);
-		else if (IS_SRC_OR_DST_PORT(BOOTPC_PORT) || IS_SRC_OR_DST_PORT(BOOTPS_PORT))
-			bootp_print(ndo, (const u_char *)(up + 1), length);
-		else if (IS_SRC_OR_DST_PORT(RIP_PORT))
-			rip_print(ndo, (const u_char *)(up + 1), length);
-		else if (IS_SRC_OR_DST_PORT(AODV_PORT))
-			aodv_print(ndo, (const u_char *)(up + 1), length,
-			    ip6 != NULL);
-	        else if (IS_SRC_OR_DST_PORT(ISAKMP_PORT))
-			 isakmp_print(ndo, (const u_char *)(up + 1), length, bp2);
-	        else if (IS_SRC_OR_DST_PORT(ISAKMP_PORT_NATT))
-			 isakmp_rfc3948_print(ndo, (const u_char *)(up + 1), length, bp2, IP_V(ip), fragmented, ttl_hl);
-	        else if (IS_SRC_OR_DST_PORT(ISAKMP_PORT_USER1) || IS_SRC_OR_DST_PORT(ISAKMP_PORT_USER2))
-			isakmp_print(ndo, (const u_char *)(up + 1), length, bp2);
-		else if (IS_SRC_OR_DST_PORT(SNMP_PORT) || IS_SRC_OR_DST_PORT(SNMPTRAP_PORT))
-			snmp_print(ndo, (const u_char *)(up + 1), length);
-		else if (IS_SRC_OR_DST_PORT(NTP_PORT))
-			ntp_print(ndo, (const u_char *)(up + 1), length);
-		else if (IS_SRC_OR_DST_PORT(KERBEROS_PORT) || IS_SRC_OR_DST_PORT(KERBEROS_SEC_PORT))
-			krb_print(ndo, (const u_char *)(up + 1));
-		else if (IS_SRC_OR_DST_PORT(L2TP_PORT))
-			l2tp_print(ndo, (const u_char *)(up + 1), length);
-#ifdef ENABLE_SMB
-		else if (IS_SRC_OR_DST_PORT(NETBIOS_NS_PORT))
-			nbt_udp137_print(ndo, (const u_char *)(up + 1), length);
-		else if (IS_SRC_OR_DST_PORT(NETBIOS_DGRAM_PORT))
-			nbt_udp138_print(ndo, (const u_char *)(up + 1), length);
-#endif
-		else if (dport == VAT_PORT)
-			vat_print(ndo, (const void *)(up + 1), length);
-		else if (IS_SRC_OR_DST_PORT(ZEPHYR_SRV_PORT) || IS_SRC_OR_DST_PORT(ZEPHYR_CLT_PORT))
-			zephyr_print(ndo, (const u_char *)(up + 1), length);
-		/*
-		 * Since there are 10 possible ports to check, I think
-		 * a <> test would be more efficient
-		 */
-		else if ((sport >= RX_PORT_LOW && sport <= RX_PORT_HIGH) ||
-			 (dport >= RX_PORT_LOW && dport <= RX_PORT_HIGH))
-			rx_print(ndo, (const u_char *)(up + 1), length, sport, dport,
-				 (const u_char *) ip);
-		else if (IS_SRC_OR_DST_PORT(RIPNG_PORT))
-			ripng_print(ndo, (const u_char *)(up + 1), length);
-		else if (IS_SRC_OR_DST_PORT(DHCP6_SERV_PORT) || IS_SRC_OR_DST_PORT(DHCP6_CLI_PORT))
-			dhcp6_print(ndo, (const u_char *)(up + 1), length);
-		else if (IS_SRC_OR_DST_PORT(AHCP_PORT))
-			ahcp_print(ndo, (const u_char *)(up + 1), length);
-		else if (IS_SRC_OR_DST_PORT(BABEL_PORT) || IS_SRC_OR_DST_PORT(BABEL_PORT_OLD))
-			babel_print(ndo, (const u_char *)(up + 1), length);
-		else if (IS_SRC_OR_DST_PORT(HNCP_PORT))
-			hncp_print(ndo, (const u_char *)(up + 1), length);
-		/*
-		 * Kludge in test for whiteboard packets.
-		 */
-		else if (dport == WB_PORT)
-			wb_print(ndo, (const u_char *)(up + 1), length);
-		else if (IS_SRC_OR_DST_PORT(CISCO_AUTORP_PORT))
-			cisco_autorp_print(ndo, (const u_char *)(up + 1), length);
-		else if (IS_SRC_OR_DST_PORT(RADIUS_PORT) ||
-			 IS_SRC_OR_DST_PORT(RADIUS_NEW_PORT) ||
-			 IS_SRC_OR_DST_PORT(RADIUS_ACCOUNTING_PORT) ||
-			 IS_SRC_OR_DST_PORT(RADIUS_NEW_ACCOUNTING_PORT) ||
-			 IS_SRC_OR_DST_PORT(RADIUS_CISCO_COA_PORT) ||
-			 IS_SRC_OR_DST_PORT(RADIUS_COA_PORT) )
-			radius_print(ndo, (const u_char *)(up+1), length);
-		else if (dport == HSRP_PORT)
-			hsrp_print(ndo, (const u_char *)(up + 1), length);
-		else if (IS_SRC_OR_DST_PORT(LWRES_PORT))
-			lwres_print(ndo, (const u_char *)(up + 1), length);
-		else if (IS_SRC_OR_DST_PORT(LDP_PORT))
-			ldp_print(ndo, (const u_char *)(up + 1), length);
-		else if (IS_SRC_OR_DST_PORT(OLSR_PORT))
-			olsr_print(ndo, (const u_char *)(up + 1), length,
-					(IP_V(ip) == 6) ? 1 : 0);
-		else if (IS_SRC_OR_DST_PORT(MPLS_LSP_PING_PORT))
-			lspping_print(ndo, (const u_char *)(up + 1), length);
-		else if (dport == BFD_CONTROL_PORT ||
-			 dport == BFD_MULTIHOP_PORT ||
-			 dport == BFD_LAG_PORT ||
-			 dport == BFD_ECHO_PORT )
-			bfd_print(ndo, (const u_char *)(up+1), length, dport);
-                else if (IS_SRC_OR_DST_PORT(LMP_PORT))
-			lmp_print(ndo, (const u_char *)(up + 1), length);
-		else if (IS_SRC_OR_DST_PORT(VQP_PORT))
-			vqp_print(ndo, (const u_char *)(up + 1), length);
-                else if (IS_SRC_OR_DST_PORT(SFLOW_PORT))
-                        sflow_print(ndo, (const u_char *)(up + 1), length);
-	        else if (dport == LWAPP_CONTROL_PORT)
-			lwapp_control_print(ndo, (const u_char *)(up + 1), length, 1);
-                else if (sport == LWAPP_CONTROL_PORT)
-                        lwapp_control_print(ndo, (const u_char *)(up + 1), length, 0);
-                else if (IS_SRC_OR_DST_PORT(LWAPP_DATA_PORT))
-                        lwapp_data_print(ndo, (const u_char *)(up + 1), length);
-                else if (IS_SRC_OR_DST_PORT(SIP_PORT))
-			sip_print(ndo, (const u_char *)(up + 1), length);
-                else if (IS_SRC_OR_DST_PORT(SYSLOG_PORT))
-			syslog_print(ndo, (const u_char *)(up + 1), length);
-                else if (IS_SRC_OR_DST_PORT(OTV_PORT))
-			otv_print(ndo, (const u_char *)(up + 1), length);
-                else if (IS_SRC_OR_DST_PORT(VXLAN_PORT))
-			vxlan_print(ndo, (const u_char *)(up + 1), length);
-                else if (IS_SRC_OR_DST_PORT(GENEVE_PORT))
-			geneve_print(ndo, (const u_char *)(up + 1), length);
-		else if (IS_SRC_OR_DST_PORT(LISP_CONTROL_PORT))
-			lisp_print(ndo, (const u_char *)(up + 1), length);
-		else if (IS_SRC_OR_DST_PORT(VXLAN_GPE_PORT))
-			vxlan_gpe_print(ndo, (const u_char *)(up + 1), length);
-		else if (IS_SRC_OR_DST_PORT(ZEP_PORT))
-			zep_print(ndo, (const u_char *)(up + 1), length);
-		else if (IS_SRC_OR_DST_PORT(MPLS_PORT))
-			mpls_print(ndo, (const u_char *)(up + 1), length);
-		else if (ND_TTEST_1(((const struct LAP *)cp)->type) &&
-			 GET_U_1(((const struct LAP *)cp)->type) == lapDDP &&
-			 (atalk_port(sport) || atalk_port(dport))) {
-			if (ndo->ndo_vflag)
-				ND_PRINT("kip ");
-			llap_print(ndo, cp, length);
-                } else if (IS_SRC_OR_DST_PORT(PTP_EVENT_PORT) ||
-                        IS_SRC_OR_DST_PORT(PTP_GENERAL_PORT)) {
-                        ptp_print(ndo, cp, length);
-                } else if (IS_SRC_OR_DST_PORT(SOMEIP_PORT))
-                        someip_print(ndo, (const u_char *)(up + 1), length);
-                else {
+		struct port_info pi;
+
+		pi.sport = sport;
+		pi.dport = dport;
+		pi.iph = bp2;
+		pi.fragmented = fragmented;
+		pi.ttl_hl = ttl_hl;
+		if (!port_dispatch(ndo, &udp_port_table, cp, length, &pi)) {
 			if (ulen > length)
 				ND_PRINT("UDP, bad length %u > %u",
 				    ulen, length);
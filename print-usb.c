@@ -27,8 +27,14 @@
 
 #include "netdissect-stdinc.h"
 
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
 #include "netdissect.h"
 #include "extract.h"
+#include "callcache.h"
+#include "latency.h"
 
 #ifdef DLT_USB_LINUX
 /*
@@ -135,6 +141,58 @@ typedef struct _usb_isodesc {
 	nd_byte		pad[4];
 } usb_isodesc;
 
+/*
+ * The URBs submitted, for --latency-report, so that the completion of
+ * one can be timed against its submission and counted against its
+ * endpoint, by URB ID on the endpoint; see callcache.h.
+ */
+struct usb_urb_key {
+	uint8_t id[8];		/* as in the header */
+	uint16_t bus;
+	uint8_t device;
+	uint8_t endpoint;	/* with URB_TRANSFER_IN for IN */
+	uint32_t pad;
+};
+
+struct usb_urb_entry {
+	struct callcache_entry ce;
+	struct usb_urb_key key;
+	u_int transfer_type;
+	u_int completed;
+};
+
+/*
+ * A submission more than USB_URB_TIMEOUT seconds older than a
+ * completion isn't taken to be what it completes; an interrupt URB can
+ * wait a long time for something to happen.
+ */
+#define USB_URB_TIMEOUT	120
+
+static const struct callcache_type usb_urb_type = {
+	sizeof(struct usb_urb_entry),
+	offsetof(struct usb_urb_entry, key),
+	sizeof(struct usb_urb_key),
+	USB_URB_TIMEOUT
+};
+
+/*
+ * The URBs and bytes completed by endpoint, in the order the endpoints
+ * were first counted.
+ */
+#define USB_ENDPOINT_CHAINS	64
+
+struct usb_endpoint_entry {
+	struct usb_endpoint_stats ues;
+	struct usb_endpoint_entry *next;	/* on its hash chain */
+};
+
+static ND_THREAD_LOCAL struct usb_endpoint_entry *usb_endpoint_chains[USB_ENDPOINT_CHAINS];
+static ND_THREAD_LOCAL struct usb_endpoint_entry **usb_endpoints;
+static ND_THREAD_LOCAL u_int usb_nendpoints, usb_maxendpoints;
+
+static const char *usb_transfer_names[] = {
+	"isochronous", "interrupt", "control", "bulk"
+};
 
 /* returns direction: 1=inbound 2=outbound -1=invalid */
 static int
@@ -239,6 +297,135 @@ usb_header_print(netdissect_options *ndo, const pcap_usb_header *uh)
 		 GET_U_1(uh->endpoint_number) & 0x7f);
 }
 
+static struct usb_endpoint_stats *
+usb_endpoint_lookup(netdissect_options *ndo, const struct usb_urb_key *key,
+		    u_int transfer_type)
+{
+	struct usb_endpoint_entry *ue, **uep;
+	struct usb_endpoint_stats *ues;
+	uint32_t h;
+
+	h = ((uint32_t)key->bus << 16 | (uint32_t)key->device << 8 |
+	    key->endpoint) * 0x9e3779b1U ^ transfer_type;
+	uep = &usb_endpoint_chains[(h >> 16) % USB_ENDPOINT_CHAINS];
+	for (ue = *uep; ue != NULL; ue = ue->next) {
+		ues = &ue->ues;
+		if (ues->ues_bus == key->bus &&
+		    ues->ues_device == key->device &&
+		    ues->ues_endpoint == key->endpoint &&
+		    ues->ues_transfer_type == transfer_type)
+			return (ues);
+	}
+
+	if (usb_nendpoints == usb_maxendpoints) {
+		usb_maxendpoints = usb_maxendpoints ? usb_maxendpoints * 2 : 16;
+		usb_endpoints = (struct usb_endpoint_entry **)realloc(
+		    usb_endpoints, usb_maxendpoints * sizeof(*usb_endpoints));
+		if (usb_endpoints == NULL)
+			(*ndo->ndo_error)(ndo, S_ERR_ND_MEM_ALLOC,
+			    "%s: realloc", __func__);
+	}
+	ue = (struct usb_endpoint_entry *)calloc(1, sizeof(*ue));
+	if (ue == NULL)
+		(*ndo->ndo_error)(ndo, S_ERR_ND_MEM_ALLOC, "%s: calloc",
+		    __func__);
+	ues = &ue->ues;
+	ues->ues_bus = key->bus;
+	ues->ues_device = key->device;
+	ues->ues_endpoint = key->endpoint;
+	ues->ues_transfer_type = transfer_type;
+	ue->next = *uep;
+	*uep = ue;
+	usb_endpoints[usb_nendpoints++] = ue;
+	return (ues);
+}
+
+/*
+ * Call "fn" for each endpoint of this thread that has had URBs
+ * completed, in the order they were first counted.
+ */
+void
+usb_endpoint_foreach(usb_endpoint_fn fn, void *arg)
+{
+	u_int i;
+
+	for (i = 0; i < usb_nendpoints; i++)
+		if (usb_endpoints[i]->ues.ues_urbs != 0)
+			(*fn)(arg, &usb_endpoints[i]->ues);
+}
+
+/*
+ * Empty this thread's endpoint counts, as for a new reporting interval.
+ */
+void
+usb_endpoint_reset(void)
+{
+	struct usb_endpoint_stats *ues;
+	u_int i;
+
+	for (i = 0; i < usb_nendpoints; i++) {
+		ues = &usb_endpoints[i]->ues;
+		ues->ues_urbs = ues->ues_bytes = ues->ues_errors = 0;
+	}
+}
+
+/*
+ * Enter the URB submitted by "uh", or time its completion and count it
+ * against its endpoint, for --latency-report.
+ */
+static void
+usb_urb_track(netdissect_options *ndo, const pcap_usb_header *uh)
+{
+	struct usb_urb_key key;
+	struct usb_urb_entry *ue;
+	struct usb_endpoint_stats *ues;
+	u_int transfer_type, event_type;
+	char what[LATENCY_WHAT_LEN];
+
+	transfer_type = GET_U_1(uh->transfer_type);
+	event_type = GET_U_1(uh->event_type);
+	if (transfer_type > URB_BULK)
+		return;
+	memset(&key, 0, sizeof(key));
+	GET_CPY_BYTES(key.id, uh->id, sizeof(key.id));
+	key.bus = GET_HE_U_2(uh->bus_id);
+	key.device = GET_U_1(uh->device_address);
+	key.endpoint = GET_U_1(uh->endpoint_number);
+
+	if (event_type == URB_SUBMIT) {
+		ue = (struct usb_urb_entry *)callcache_enter(ndo,
+		    &usb_urb_type, &key);
+		if (ue == NULL)
+			return;
+		ue->transfer_type = transfer_type;
+		ue->completed = 0;
+		return;
+	}
+	if (event_type != URB_COMPLETE && event_type != URB_ERROR)
+		return;
+
+	ues = usb_endpoint_lookup(ndo, &key, transfer_type);
+	ue = (struct usb_urb_entry *)callcache_find(ndo, &usb_urb_type, &key);
+	if (ue != NULL && (ue->completed || ue->transfer_type != transfer_type))
+		ue = NULL;
+	if (ues->ues_urbs == 0)
+		ues->ues_first_ts = ue != NULL ? ue->ce.cce_ts :
+		    ndo->ndo_packet_ts;
+	ues->ues_last_ts = ndo->ndo_packet_ts;
+	ues->ues_urbs++;
+	ues->ues_bytes += GET_HE_U_4(uh->urb_len);
+	if (event_type == URB_ERROR || GET_HE_S_4(uh->status) != 0)
+		ues->ues_errors++;
+	if (ue == NULL)
+		return;
+	ue->completed = 1;
+	snprintf(what, sizeof(what), "%s %u:%u:%u %s",
+	    usb_transfer_names[transfer_type], key.bus, key.device,
+	    key.endpoint & 0x7f,
+	    (key.endpoint & URB_TRANSFER_IN) ? "in" : "out");
+	latency_record(ndo, "usb", what, ue->ce.cce_ts);
+}
+
 /*
  * This is the top level routine of the printer for captures with a
  * 48-byte header.
@@ -260,6 +447,8 @@ usb_linux_48_byte_if_print(netdissect_options *ndo, const struct pcap_pkthdr *h,
 	ndo->ndo_ll_header_length += sizeof (pcap_usb_header);
 
 	usb_header_print(ndo, (const pcap_usb_header *) p);
+	if (ndo->ndo_latency)
+		usb_urb_track(ndo, (const pcap_usb_header *) p);
 
 	return;
 }
@@ -286,6 +475,8 @@ usb_linux_64_byte_if_print(netdissect_options *ndo, const struct pcap_pkthdr *h,
 	ndo->ndo_ll_header_length += sizeof (pcap_usb_header_mmapped);
 
 	usb_header_print(ndo, (const pcap_usb_header *) p);
+	if (ndo->ndo_latency)
+		usb_urb_track(ndo, (const pcap_usb_header *) p);
 
 	return;
 }
@@ -33,6 +33,7 @@
 
 #include "netdissect.h"
 #include "extract.h"
+#include "change-only.h"
 #include "addrtoname.h"
 
 #include "ip.h"
@@ -115,6 +116,19 @@ vrrp_print(netdissect_options *ndo,
 	version = (GET_U_1(bp) & 0xf0) >> 4;
 	type = GET_U_1(bp) & 0x0f;
 	type_s = tok2str(type2str, "unknown type (%u)", type);
+	if (ndo->ndo_changes_only && (version == 2 || version == 3) &&
+	    type == VRRP_TYPE_ADVERTISEMENT) {
+		uint64_t h;
+		u_char t = (u_char)ttl;
+
+		/* Leave out the checksum. */
+		h = nd_change_hash(ndo, ND_CHANGE_HASH_INIT, &t, 1);
+		h = nd_change_hash(ndo, h, bp, len < 6 ? len : 6);
+		if (len > 8)
+			h = nd_change_hash(ndo, h, bp + 8, len - 8);
+		if (nd_change_repeat(ndo, ND_CHANGE_VRRP, bp + 1, 1, h))
+			return;
+	}
 	ND_PRINT("VRRPv%u, %s", version, type_s);
 	if (ttl != 255)
 		ND_PRINT(", (ttl %u)", ttl);
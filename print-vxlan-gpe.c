@@ -32,6 +32,7 @@
 #include "netdissect-stdinc.h"
 
 #include "netdissect.h"
+#include "netdissect-fields.h"
 #include "extract.h"
 
 static const struct tok vxlan_gpe_flags [] = {
@@ -78,6 +79,10 @@ vxlan_gpe_print(netdissect_options *ndo, const u_char *bp, u_int len)
     vni = GET_BE_U_3(bp);
     bp += 4;
 
+    ND_FIELD_UINT(NDF_VXLAN_GPE, NDF_VXLAN_GPE_FLAGS, flags);
+    ND_FIELD_UINT(NDF_VXLAN_GPE, NDF_VXLAN_GPE_VNI, vni);
+    ND_FIELD_UINT(NDF_VXLAN_GPE, NDF_VXLAN_GPE_NEXT, next_protocol);
+
     ND_PRINT("VXLAN-GPE, ");
     ND_PRINT("flags [%s], ",
               bittok2str_nosep(vxlan_gpe_flags, "none", flags));
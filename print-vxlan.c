@@ -24,6 +24,7 @@
 #include "netdissect-stdinc.h"
 
 #include "netdissect.h"
+#include "netdissect-fields.h"
 #include "extract.h"
 
 
@@ -61,6 +62,9 @@ vxlan_print(netdissect_options *ndo, const u_char *bp, u_int len)
     vni = GET_BE_U_3(bp);
     bp += 4;
 
+    ND_FIELD_UINT(NDF_VXLAN, NDF_VXLAN_FLAGS, flags);
+    ND_FIELD_UINT(NDF_VXLAN, NDF_VXLAN_VNI, vni);
+
     ND_PRINT("VXLAN, ");
     ND_PRINT("flags [%s] (0x%02x), ", flags & 0x08 ? "I" : ".", flags);
     ND_PRINT("vni %u\n", vni);
@@ -84,10 +84,10 @@ static void zep_print_ts(netdissect_options *ndo, const u_char *p)
 	 */
 	if (i) {
 		time_t seconds = i - JAN_1970;
-		struct tm *tm;
+		struct tm tmbuf, *tm;
 		char time_buf[128];
 
-		tm = localtime(&seconds);
+		tm = nd_localtime(&seconds, &tmbuf);
 		strftime(time_buf, sizeof (time_buf), "%Y/%m/%d %H:%M:%S", tm);
 		ND_PRINT(" (%s)", time_buf);
 	}
@@ -32,13 +32,21 @@
 #include <stdlib.h>
 #include <string.h>
 #include <setjmp.h>
+#include <pthread.h>
 
 #include "netdissect-stdinc.h"
 
 #include "netdissect.h"
 #include "addrtoname.h"
 #include "print.h"
+#include "dfilter.h"
 #include "netdissect-alloc.h"
+#include "netdissect-fields.h"
+#include "netdissect-memo.h"
+#include "netdissect-profile.h"
+#include "netdissect-state.h"
+#include "ipproto.h"
+#include "portdispatch.h"
 
 #include "pcap-missing.h"
 
@@ -81,17 +89,19 @@ static const struct uint_printer uint_printers[] = {
 #ifdef DLT_ATM_CLIP
 	{ cip_if_print,		DLT_ATM_CLIP },
 #endif
-#ifdef DLT_IP_OVER_FC
+#if defined(DLT_IP_OVER_FC) && !defined(ND_OMIT_IPFC)
 	{ ipfc_if_print,	DLT_IP_OVER_FC },
 #endif
 #ifdef DLT_LANE8023
 	{ lane_if_print,	DLT_LANE8023 },
 #endif
+#ifndef ND_OMIT_ARCNET
 	{ arcnet_if_print,	DLT_ARCNET },
 #ifdef DLT_ARCNET_LINUX
 	{ arcnet_linux_if_print, DLT_ARCNET_LINUX },
 #endif
-#ifdef DLT_IPOIB
+#endif
+#if defined(DLT_IPOIB) && !defined(ND_OMIT_IPOIB)
 	{ ipoib_if_print,       DLT_IPOIB },
 #endif
 #ifdef DLT_C_HDLC
@@ -131,6 +141,7 @@ static const struct uint_printer uint_printers[] = {
 #ifdef DLT_LTALK
 	{ ltalk_if_print,	DLT_LTALK },
 #endif
+#ifndef ND_OMIT_JUNIPER
 #ifdef DLT_JUNIPER_ATM1
 	{ juniper_atm1_if_print, DLT_JUNIPER_ATM1 },
 #endif
@@ -176,6 +187,7 @@ static const struct uint_printer uint_printers[] = {
 #ifdef DLT_JUNIPER_CHDLC
 	{ juniper_chdlc_if_print,	DLT_JUNIPER_CHDLC },
 #endif
+#endif /* ND_OMIT_JUNIPER */
 #ifdef DLT_PKTAP
 	{ pktap_if_print,	DLT_PKTAP },
 #endif
@@ -207,7 +219,7 @@ static const struct uint_printer uint_printers[] = {
 #ifdef DLT_DSA_TAG_BRCM_PREPEND
 	{ brcm_tag_prepend_if_print, DLT_DSA_TAG_BRCM_PREPEND },
 #endif
-#ifdef DLT_VSOCK
+#if defined(DLT_VSOCK) && !defined(ND_OMIT_VSOCK)
 	{ vsock_if_print,	DLT_VSOCK },
 #endif
 #ifdef DLT_DSA_TAG_DSA
@@ -220,7 +232,7 @@ static const struct uint_printer uint_printers[] = {
 };
 
 static const struct void_printer void_printers[] = {
-#ifdef DLT_APPLE_IP_OVER_IEEE1394
+#if defined(DLT_APPLE_IP_OVER_IEEE1394) && !defined(ND_OMIT_AP1394)
 	{ ap1394_if_print,	DLT_APPLE_IP_OVER_IEEE1394 },
 #endif
 #ifdef DLT_BLUETOOTH_HCI_H4_WITH_PHDR
@@ -246,7 +258,7 @@ static const struct void_printer void_printers[] = {
 #ifdef DLT_SUNATM
 	{ sunatm_if_print,	DLT_SUNATM },
 #endif
-#ifdef DLT_SYMANTEC_FIREWALL
+#if defined(DLT_SYMANTEC_FIREWALL) && !defined(ND_OMIT_SYMANTEC)
 	{ symantec_if_print,	DLT_SYMANTEC_FIREWALL },
 #endif
 #ifdef DLT_USB_LINUX
@@ -273,22 +285,193 @@ static int	ndo_printf(netdissect_options *ndo,
 		     FORMAT_STRING(const char *fmt), ...)
 		     PRINTFLIKE(2, 3);
 
+/*
+ * Link-layer printers indexed by DLT_ value, for the values below
+ * DLT_INDEX_SIZE, which is all of them at present; others are looked
+ * up with a search of the tables.
+ */
+#define DLT_INDEX_SIZE	512
+
+static uint_if_printer uint_printer_index[DLT_INDEX_SIZE];
+static void_if_printer void_printer_index[DLT_INDEX_SIZE];
+static int printer_index_built;
+
+/* Names given to nd_disable_dissector(). */
+static const char **disabled_dissectors;
+static u_int n_disabled_dissectors;
+
+static int	dispatch_build(void);
+static void	build_printer_index(void);
+
 void
 init_print(netdissect_options *ndo, uint32_t localnet, uint32_t mask)
 {
 
 	init_addrtoname(ndo, localnet, mask);
+	if (nd_dispatch_init() == -1)
+		(*ndo->ndo_error)(ndo, S_ERR_ND_MEM_ALLOC,
+				  "init_print: malloc");
+	if (nd_outbuf_init(ndo, ND_OUTBUF_SIZE) == -1)
+		(*ndo->ndo_error)(ndo, S_ERR_ND_MEM_ALLOC,
+				  "init_print: malloc");
+}
+
+/*
+ * Fill in the dispatch tables from the built-in dissectors that
+ * haven't been disabled, and any --port-map entries, index the
+ * link-layer printers, and build the CRC tables.  This is done once
+ * per process, by whichever thread gets here first; the tables are
+ * only read after that, so the dissectors can use them without locks.
+ */
+static pthread_mutex_t dispatch_mtx = PTHREAD_MUTEX_INITIALIZER;
+
+int
+nd_dispatch_init(void)
+{
+	static int done;
+	int ret;
+
+	pthread_mutex_lock(&dispatch_mtx);
+	ret = 0;
+	if (!done) {
+		ret = dispatch_build();
+		if (ret == 0)
+			done = 1;
+	}
+	pthread_mutex_unlock(&dispatch_mtx);
+	return (ret);
+}
+
+static int
+dispatch_build(void)
+{
+	const struct ethertype_dissector *et;
+	const struct ipproto_dissector *ipp;
+
 	init_checksum();
+	for (et = ethertype_dissectors; et->name != NULL; et++) {
+		if (!nd_dissector_disabled(et->name) &&
+		    nd_register_ethertype(et) == -1)
+			return (-1);
+	}
+	for (ipp = ipproto_dissectors; ipp->name != NULL; ipp++) {
+		if (!nd_dissector_disabled(ipp->name))
+			nd_register_ipproto(ipp);
+	}
+	if (port_table_build(&tcp_port_table) == -1 ||
+	    port_table_build(&udp_port_table) == -1)
+		return (-1);
+	build_printer_index();
+	return (0);
 }
 
-uint_if_printer
-lookup_uint_printer(int type)
+int
+nd_disable_dissector(const char *name)
 {
-	const struct uint_printer *p;
+	const struct ethertype_dissector *et;
+	const struct ipproto_dissector *ipp;
+	const char **names;
 
-	for (p = uint_printers; p->f; ++p)
-		if (type == p->type)
-			return p->f;
+	for (et = ethertype_dissectors; et->name != NULL; et++)
+		if (strcmp(et->name, name) == 0)
+			break;
+	if (et->name == NULL) {
+		for (ipp = ipproto_dissectors; ipp->name != NULL; ipp++)
+			if (strcmp(ipp->name, name) == 0)
+				break;
+		if (ipp->name == NULL &&
+		    port_table_find(&tcp_port_table, name) == -1 &&
+		    port_table_find(&udp_port_table, name) == -1)
+			return (-1);
+	}
+	if (nd_dissector_disabled(name))
+		return (0);
+	names = (const char **)realloc(disabled_dissectors,
+	    (n_disabled_dissectors + 1) * sizeof(*names));
+	if (names == NULL)
+		return (-1);
+	names[n_disabled_dissectors++] = name;
+	disabled_dissectors = names;
+	return (0);
+}
+
+/*
+ * Have TCP and UDP traffic to or from "port" go to the dissector called
+ * "name", for whichever of the two has one.  Must be called before
+ * nd_dispatch_init(); returns -1 if neither does.
+ */
+int
+nd_map_port(u_int port, const char *name)
+{
+	int found = 0;
+
+	if (port_table_find(&tcp_port_table, name) != -1) {
+		if (port_table_map(&tcp_port_table, port, name) == -1)
+			return (-1);
+		found = 1;
+	}
+	if (port_table_find(&udp_port_table, name) != -1) {
+		if (port_table_map(&udp_port_table, port, name) == -1)
+			return (-1);
+		found = 1;
+	}
+	return (found ? 0 : -1);
+}
+
+/*
+ * Returns -1 if "ipproto" is neither TCP nor UDP or the rule can't be
+ * added; see port_table_register().
+ */
+int
+nd_register_port(u_int ipproto, u_int lo, u_int hi, u_int side,
+    const struct port_dissector *pd)
+{
+	switch (ipproto) {
+
+	case IPPROTO_TCP:
+		return (port_table_register(&tcp_port_table, lo, hi, side, pd));
+
+	case IPPROTO_UDP:
+		return (port_table_register(&udp_port_table, lo, hi, side, pd));
+
+	default:
+		return (-1);
+	}
+}
+
+int
+nd_dissector_disabled(const char *name)
+{
+	u_int i;
+
+	for (i = 0; i < n_disabled_dissectors; i++)
+		if (strcmp(disabled_dissectors[i], name) == 0)
+			return (1);
+	return (0);
+}
+
+static void
+build_printer_index(void)
+{
+	const struct uint_printer *up;
+	const struct void_printer *vp;
+
+	if (printer_index_built)
+		return;
+	/*
+	 * Go backwards, so that if a type appears more than once the
+	 * first entry wins, as it does with a search.
+	 */
+	for (up = uint_printers; up->f; ++up)
+		;
+	while (up-- != uint_printers)
+		if (up->type >= 0 && up->type < DLT_INDEX_SIZE)
+			uint_printer_index[up->type] = up->f;
+	for (vp = void_printers; vp->f; ++vp)
+		;
+	while (vp-- != void_printers)
+		if (vp->type >= 0 && vp->type < DLT_INDEX_SIZE)
+			void_printer_index[vp->type] = vp->f;
 
 #if defined(DLT_USER2) && defined(DLT_PKTAP)
 	/*
@@ -303,19 +486,33 @@ lookup_uint_printer(int type)
 	 *
 	 * However, files written on OS X Mavericks for a DLT_PKTAP
 	 * capture have a link-layer header type of LINKTYPE_USER2.
-	 * If we don't have a printer for DLT_USER2, and type is
-	 * DLT_USER2, we look up the printer for DLT_PKTAP and use
-	 * that.
+	 * If we don't have a printer for DLT_USER2, we use the
+	 * printer for DLT_PKTAP for it.
 	 */
-	if (type == DLT_USER2) {
-		for (p = uint_printers; p->f; ++p)
-			if (DLT_PKTAP == p->type)
-				return p->f;
+	if (DLT_USER2 < DLT_INDEX_SIZE && DLT_PKTAP < DLT_INDEX_SIZE) {
+		if (uint_printer_index[DLT_USER2] == NULL)
+			uint_printer_index[DLT_USER2] =
+			    uint_printer_index[DLT_PKTAP];
+		if (void_printer_index[DLT_USER2] == NULL)
+			void_printer_index[DLT_USER2] =
+			    void_printer_index[DLT_PKTAP];
 	}
 #endif
+	printer_index_built = 1;
+}
+
+uint_if_printer
+lookup_uint_printer(int type)
+{
+	const struct uint_printer *p;
 
+	build_printer_index();
+	if (type >= 0 && type < DLT_INDEX_SIZE)
+		return uint_printer_index[type];
+	for (p = uint_printers; p->f; ++p)
+		if (type == p->type)
+			return p->f;
 	return NULL;
-	/* NOTREACHED */
 }
 
 void_if_printer
@@ -323,36 +520,13 @@ lookup_void_printer(int type)
 {
 	const struct void_printer *p;
 
+	build_printer_index();
+	if (type >= 0 && type < DLT_INDEX_SIZE)
+		return void_printer_index[type];
 	for (p = void_printers; p->f; ++p)
 		if (type == p->type)
 			return p->f;
-
-#if defined(DLT_USER2) && defined(DLT_PKTAP)
-	/*
-	 * Apple incorrectly chose to use DLT_USER2 for their PKTAP
-	 * header.
-	 *
-	 * We map DLT_PKTAP, whether it's DLT_USER2 as it is on Darwin-
-	 * based OSes or the same value as LINKTYPE_PKTAP as it is on
-	 * other OSes, to LINKTYPE_PKTAP, so files written with
-	 * this version of libpcap for a DLT_PKTAP capture have a link-
-	 * layer header type of LINKTYPE_PKTAP.
-	 *
-	 * However, files written on OS X Mavericks for a DLT_PKTAP
-	 * capture have a link-layer header type of LINKTYPE_USER2.
-	 * If we don't have a printer for DLT_USER2, and type is
-	 * DLT_USER2, we look up the printer for DLT_PKTAP and use
-	 * that.
-	 */
-	if (type == DLT_USER2) {
-		for (p = void_printers; p->f; ++p)
-			if (DLT_PKTAP == p->type)
-				return p->f;
-	}
-#endif
-
 	return NULL;
-	/* NOTREACHED */
 }
 
 if_printer_t
@@ -383,8 +557,9 @@ get_if_printer(netdissect_options *ndo, int type)
 	if_printer_t printer;
 
 	printer = lookup_printer(ndo, type);
+	dltname = pcap_datalink_val_to_name(type);
+	ndo->ndo_if_printer_name = dltname != NULL ? dltname : "link-layer";
 	if (printer.printer == NULL) {
-		dltname = pcap_datalink_val_to_name(type);
 		if (dltname != NULL)
 			(*ndo->ndo_error)(ndo, S_ERR_ND_NO_PRINTER,
 					  "packet printing is not supported for link type %s: use -w",
@@ -402,7 +577,20 @@ pretty_print_packet(netdissect_options *ndo, const struct pcap_pkthdr *h,
 {
 	u_int hdrlen;
 	int invalid_header = 0;
+	size_t line_start;
 
+	ndo->ndo_packet_ts = ND_TS_FROM_TIMEVAL(&h->ts, ND_TSTAMP_NANO(ndo));
+	ndo->ndo_packet_sec = h->ts.tv_sec;
+	ndo->ndo_packet_nsec = (u_int)(h->ts.tv_usec *
+	    (ND_TSTAMP_NANO(ndo) ? 1 : 1000));
+	ndo->ndo_packet_usec = ndo->ndo_packet_nsec / 1000;
+	ndo->ndo_drop_line = 0;
+	ndo->ndo_output_cut = 0;
+	ndo->ndo_community_id_str[0] = '\0';
+	ndo->ndo_outgoing = ndo->ndo_all_outgoing;
+	line_start = ndo->ndo_outbuf_len;
+	if (ndo->ndo_field != NULL)
+		nd_field_begin(ndo, h);
 	if (ndo->ndo_packet_number)
 		ND_PRINT("%5u  ", packets_captured);
 
@@ -444,6 +632,12 @@ pretty_print_packet(netdissect_options *ndo, const struct pcap_pkthdr *h,
 	}
 	if (invalid_header) {
 		ND_PRINT("]\n");
+		ND_FIELD_UINT(NDF_FRAME, NDF_FRAME_INVALID, 1);
+		if (ndo->ndo_dfilter != NULL && !nd_dfilter_match(ndo) &&
+		    ndo->ndo_outbuf_len >= line_start)
+			ndo->ndo_outbuf_len = line_start;
+		nd_field_end(ndo);
+		nd_outbuf_flush(ndo);
 		return;
 	}
 
@@ -460,6 +654,8 @@ pretty_print_packet(netdissect_options *ndo, const struct pcap_pkthdr *h,
 	 */
 
 	ts_print(ndo, &h->ts);
+	if (ndo->ndo_ifname != NULL)
+		ND_PRINT("%s ", ndo->ndo_ifname);
 
 	/*
 	 * Printers must check that they're not walking off the end of
@@ -471,18 +667,53 @@ pretty_print_packet(netdissect_options *ndo, const struct pcap_pkthdr *h,
 
 	ndo->ndo_protocol = "";
 	ndo->ndo_ll_header_length = 0;
-	if (setjmp(ndo->ndo_truncated) == 0) {
-		/* Print the packet. */
+	ndo->ndo_ip4_hdr = NULL;
+	ndo->ndo_ip6_hdr = NULL;
+	ndo->ndo_iph = NULL;
+	ND_SNAPLEN_BEGIN(sp, h->caplen);
+	if (ndo->ndo_memo != NULL &&
+	    nd_memo_replay(ndo, h, sp, &hdrlen)) {
+		/* Printed as it was before; see netdissect-memo.h */
+	} else if (ndo->ndo_qflag && !ndo->ndo_void_printer &&
+	    ndo->ndo_if_printer.uint_printer == ether_if_print &&
+	    (hdrlen = ether_quick_print(ndo, h, sp)) != 0) {
+		/* A plain TCP or UDP packet, printed without the printers */
+	} else if (ND_SETJMP(ndo->ndo_truncated) == 0) {
+		/*
+		 * Print the packet; with --max-output-per-packet, the
+		 * output functions jump back here when the printers have
+		 * printed that much.
+		 */
+		if (ndo->ndo_max_output != 0)
+			ndo->ndo_output_left = ndo->ndo_max_output + 1;
+		ND_PROFILE_ENTER(ndo->ndo_if_printer_name);
 		if (ndo->ndo_void_printer == TRUE) {
 			(ndo->ndo_if_printer.void_printer)(ndo, h, sp);
 			hdrlen = ndo->ndo_ll_header_length;
 		} else
 			hdrlen = (ndo->ndo_if_printer.uint_printer)(ndo, h, sp);
+		ND_PROFILE_LEAVE();
+		ndo->ndo_output_left = 0;
 	} else {
-		/* A printer quit because the packet was truncated; report it */
-		ND_PRINT(" [|%s]", ndo->ndo_protocol);
+		/*
+		 * A printer quit because the packet was truncated, it
+		 * reached the output limit, or the display filter stopped
+		 * the dissection; report the first two.
+		 */
+		ndo->ndo_output_left = 0;
+		ND_PROFILE_UNWIND(!ndo->ndo_drop_line);
+		if (ndo->ndo_output_cut)
+			ND_PRINT(" [|%s: output limit]", ndo->ndo_protocol);
+		else if (!ndo->ndo_drop_line) {
+			ND_SNAPLEN_TRUNCATED();
+			ND_PRINT(" [|%s]", ndo->ndo_protocol);
+			ND_FIELD_STRING(NDF_FRAME, NDF_FRAME_TRUNCATED,
+			    ndo->ndo_protocol);
+		}
 		hdrlen = ndo->ndo_ll_header_length;
 	}
+	if (ndo->ndo_community_id_str[0] != '\0')
+		ND_PRINT(" community-id %s", ndo->ndo_community_id_str);
 
 	/*
 	 * Empty the stack of packet information, freeing all pushed buffers;
@@ -497,6 +728,27 @@ pretty_print_packet(netdissect_options *ndo, const struct pcap_pkthdr *h,
 	 * changed it.
 	 */
 	ndo->ndo_snapend = sp + h->caplen;
+	ND_SNAPLEN_END(h->len);
+
+	/*
+	 * A printer may have asked that the packet not be shown at all,
+	 * e.g. the data packets of --ppp-sessions, or it may not match
+	 * the display filter; take its line back out of the output
+	 * buffer, if it's all still there.
+	 */
+	if (ndo->ndo_dfilter != NULL && !nd_dfilter_match(ndo))
+		ndo->ndo_drop_line = 1;
+	if (ndo->ndo_drop_line &&
+	    (ndo->ndo_field == NULL || ndo->ndo_dfilter != NULL) &&
+	    ndo->ndo_outbuf != NULL && ndo->ndo_outbuf_len >= line_start) {
+		ndo->ndo_outbuf_len = line_start;
+		nd_free_all(ndo);
+		if (ndo->ndo_mem_limit != 0)
+			nd_mem_check(ndo);
+		return;
+	}
+	if (ndo->ndo_memo != NULL)
+		nd_memo_record(ndo, hdrlen, packets_captured);
 	if (ndo->ndo_Xflag) {
 		/*
 		 * Print the raw packet data in hex and ASCII.
@@ -556,7 +808,27 @@ pretty_print_packet(netdissect_options *ndo, const struct pcap_pkthdr *h,
 	}
 
 	ND_PRINT("\n");
+	if (ndo->ndo_field != NULL)
+		nd_field_end(ndo);
+	nd_outbuf_flush(ndo);
 	nd_free_all(ndo);
+	if (ndo->ndo_mem_limit != 0)
+		nd_mem_check(ndo);
+}
+
+/*
+ * Prefetch what printing the packet at "sp", of which "caplen" bytes
+ * were captured, will read first; it's called for the next packet of a
+ * batch while the current one is being printed.
+ */
+void
+prefetch_packet(netdissect_options *ndo, const u_char *sp, u_int caplen)
+{
+	if (!ndo->ndo_void_printer &&
+	    ndo->ndo_if_printer.uint_printer == ether_if_print)
+		ether_prefetch(ndo, sp, caplen);
+	else
+		ND_PREFETCH(sp);
 }
 
 /*
@@ -575,6 +847,8 @@ ndo_error(netdissect_options *ndo, status_exit_codes_t status,
 {
 	va_list ap;
 
+	/* Don't lose whatever was printed before the error. */
+	nd_outbuf_flush(ndo);
 	if (ndo->program_name)
 		(void)fprintf(stderr, "%s: ", ndo->program_name);
 	va_start(ap, fmt);
@@ -609,14 +883,289 @@ ndo_warning(netdissect_options *ndo, const char *fmt, ...)
 	}
 }
 
+/*
+ * Default output function: write the buffered output to the standard
+ * output.
+ */
+static int
+ndo_output(netdissect_options *ndo _U_, const char *buf, size_t len)
+{
+	if (fwrite(buf, 1, len, stdout) != len)
+		return (-1);
+	return (0);
+}
+
+/*
+ * Allocate an output buffer of the specified size; until it is freed,
+ * ndo_printf() accumulates the output in it rather than writing it
+ * out on every call.
+ */
+int
+nd_outbuf_init(netdissect_options *ndo, size_t size)
+{
+	char *buf;
+
+	buf = (char *)malloc(size);
+	if (buf == NULL)
+		return (-1);
+	nd_outbuf_free(ndo);
+	ndo->ndo_outbuf = buf;
+	ndo->ndo_outbuf_size = size;
+	ndo->ndo_outbuf_len = 0;
+	return (0);
+}
+
+/*
+ * Write out anything still in the output buffer and go back to
+ * unbuffered output.
+ */
+void
+nd_outbuf_free(netdissect_options *ndo)
+{
+	if (ndo->ndo_outbuf == NULL)
+		return;
+	nd_outbuf_flush(ndo);
+	free(ndo->ndo_outbuf);
+	ndo->ndo_outbuf = NULL;
+	ndo->ndo_outbuf_size = 0;
+	ndo->ndo_outbuf_len = 0;
+}
+
+/*
+ * Hand the data directly to the output function.
+ */
+static void
+nd_output(netdissect_options *ndo, const char *buf, size_t len)
+{
+	if (len == 0)
+		return;
+	ndo->ndo_outbuf_writes++;
+	if ((*ndo->ndo_output)(ndo, buf, len) == -1) {
+		/*
+		 * Drop the buffer, so that ndo_error() doesn't
+		 * try to write it out again.
+		 */
+		ndo->ndo_outbuf_len = 0;
+		(*ndo->ndo_error)(ndo, S_ERR_ND_WRITE_FILE,
+				  "Unable to write output: %s",
+				  pcap_strerror(errno));
+	}
+}
+
+void
+nd_outbuf_flush(netdissect_options *ndo)
+{
+	size_t len;
+
+	if (ndo->ndo_outbuf == NULL || ndo->ndo_outbuf_len == 0)
+		return;
+	len = ndo->ndo_outbuf_len;
+	ndo->ndo_outbuf_len = 0;
+	nd_output(ndo, ndo->ndo_outbuf, len);
+}
+
+/*
+ * Count "len" bytes of a printer's output against
+ * --max-output-per-packet, and return how many of them it may print; if
+ * that's fewer, the limit has been reached, and the caller prints them
+ * and jumps back to pretty_print_packet().  This is only called while
+ * ndo_output_left is set, that is, inside the printers.
+ */
+static size_t
+nd_output_limit(netdissect_options *ndo, size_t len)
+{
+	if (len < ndo->ndo_output_left) {
+		ndo->ndo_output_left -= len;
+		return (len);
+	}
+	len = ndo->ndo_output_left - 1;
+	ndo->ndo_output_left = 0;
+	ndo->ndo_output_cut = 1;
+	return (len);
+}
+
+/*
+ * Append the data to the output buffer, flushing it first if the data
+ * doesn't fit; data that wouldn't fit even in an empty buffer is
+ * written out directly.
+ */
+void
+nd_outbuf_write(netdissect_options *ndo, const char *buf, size_t len)
+{
+	size_t n;
+
+	if (ndo->ndo_output_left != 0 &&
+	    (n = nd_output_limit(ndo, len)) != len) {
+		nd_outbuf_write(ndo, buf, n);
+		ND_LONGJMP(ndo->ndo_truncated);
+	}
+	if (ndo->ndo_outbuf == NULL) {
+		nd_output(ndo, buf, len);
+		return;
+	}
+	if (len > ndo->ndo_outbuf_size - ndo->ndo_outbuf_len) {
+		nd_outbuf_flush(ndo);
+		if (len > ndo->ndo_outbuf_size) {
+			nd_output(ndo, buf, len);
+			return;
+		}
+	}
+	memcpy(ndo->ndo_outbuf + ndo->ndo_outbuf_len, buf, len);
+	ndo->ndo_outbuf_len += len;
+}
+
+/*
+ * Format an unsigned integer in decimal at the end of the supplied
+ * buffer; return a pointer to the first digit.
+ */
+static char *
+nd_format_uint(char *end, u_int val)
+{
+	do {
+		*--end = (char)('0' + val % 10);
+		val /= 10;
+	} while (val != 0);
+	return (end);
+}
+
+static int
+ndo_vprintf(netdissect_options *ndo, const char *fmt, va_list args)
+{
+	size_t room, n;
+	va_list args2;
+	char *tmp;
+	int cut = 0;
+	int ret;
+
+	room = ndo->ndo_outbuf_size - ndo->ndo_outbuf_len;
+	va_copy(args2, args);
+	ret = vsnprintf(ndo->ndo_outbuf + ndo->ndo_outbuf_len, room,
+			fmt, args);
+	if (ret < 0) {
+		va_end(args2);
+		return (ret);
+	}
+	if ((size_t)ret < room) {
+		/* It fit. */
+		va_end(args2);
+		if (ndo->ndo_output_left != 0 &&
+		    (n = nd_output_limit(ndo, (size_t)ret)) != (size_t)ret) {
+			ndo->ndo_outbuf_len += n;
+			ND_LONGJMP(ndo->ndo_truncated);
+		}
+		ndo->ndo_outbuf_len += ret;
+		return (ret);
+	}
+
+	/*
+	 * It didn't fit; flush the buffer and try again, formatting
+	 * into a temporary buffer if it won't fit even in an empty
+	 * output buffer.
+	 */
+	nd_outbuf_flush(ndo);
+	n = (size_t)ret;
+	if (ndo->ndo_output_left != 0 &&
+	    (n = nd_output_limit(ndo, n)) != (size_t)ret)
+		cut = 1;
+	if ((size_t)ret < ndo->ndo_outbuf_size) {
+		ret = vsnprintf(ndo->ndo_outbuf, ndo->ndo_outbuf_size,
+				fmt, args2);
+		if (ret > 0)
+			ndo->ndo_outbuf_len = n;
+	} else {
+		tmp = (char *)malloc((size_t)ret + 1);
+		if (tmp == NULL) {
+			va_end(args2);
+			(*ndo->ndo_error)(ndo, S_ERR_ND_MEM_ALLOC,
+					  "ndo_printf: malloc");
+		}
+		ret = vsnprintf(tmp, (size_t)ret + 1, fmt, args2);
+		if (ret > 0)
+			nd_output(ndo, tmp, n);
+		free(tmp);
+	}
+	va_end(args2);
+	if (cut)
+		ND_LONGJMP(ndo->ndo_truncated);
+	return (ret);
+}
+
 static int
 ndo_printf(netdissect_options *ndo, const char *fmt, ...)
 {
 	va_list args;
-	int ret;
+	const char *s, *e;
+	char numbuf[sizeof("4294967295")];
+	char c;
+	size_t len;
+	int prec, ret;
+
+	if (ndo->ndo_outbuf == NULL) {
+		va_start(args, fmt);
+		ret = vfprintf(stdout, fmt, args);
+		va_end(args);
+
+		if (ret < 0)
+			ndo_error(ndo, S_ERR_ND_WRITE_FILE,
+				  "Unable to write output: %s",
+				  pcap_strerror(errno));
+		return (ret);
+	}
+
+	/*
+	 * Fast paths for the most common formats: a plain string with
+	 * no conversions, and a single %s, %.*s, %u or %c conversion.
+	 */
+	if (strchr(fmt, '%') == NULL) {
+		len = strlen(fmt);
+		nd_outbuf_write(ndo, fmt, len);
+		return ((int)len);
+	}
+	if (strcmp(fmt, "%.*s") == 0) {
+		va_start(args, fmt);
+		prec = va_arg(args, int);
+		s = va_arg(args, const char *);
+		va_end(args);
+		if (s != NULL && prec >= 0) {
+			e = (const char *)memchr(s, '\0', (size_t)prec);
+			len = (e != NULL) ? (size_t)(e - s) : (size_t)prec;
+			nd_outbuf_write(ndo, s, len);
+			return ((int)len);
+		}
+	}
+	if (fmt[0] == '%' && fmt[1] != '\0' && fmt[2] == '\0') {
+		switch (fmt[1]) {
+
+		case 's':
+			va_start(args, fmt);
+			s = va_arg(args, const char *);
+			va_end(args);
+			if (s == NULL)
+				break;	/* leave it to vsnprintf() */
+			len = strlen(s);
+			nd_outbuf_write(ndo, s, len);
+			return ((int)len);
+
+		case 'u':
+			va_start(args, fmt);
+			s = nd_format_uint(numbuf + sizeof(numbuf),
+					   va_arg(args, u_int));
+			va_end(args);
+			len = numbuf + sizeof(numbuf) - s;
+			nd_outbuf_write(ndo, s, len);
+			return ((int)len);
+
+		case 'c':
+			va_start(args, fmt);
+			c = (char)va_arg(args, int);
+			va_end(args);
+			nd_outbuf_write(ndo, &c, 1);
+			return (1);
+		}
+	}
 
 	va_start(args, fmt);
-	ret = vfprintf(stdout, fmt, args);
+	ret = ndo_vprintf(ndo, fmt, args);
 	va_end(args);
 
 	if (ret < 0)
@@ -630,6 +1179,7 @@ ndo_set_function_pointers(netdissect_options *ndo)
 {
 	ndo->ndo_default_print=ndo_default_print;
 	ndo->ndo_printf=ndo_printf;
+	ndo->ndo_output=ndo_output;
 	ndo->ndo_error=ndo_error;
 	ndo->ndo_warning=ndo_warning;
 }
@@ -38,6 +38,9 @@ void	pretty_print_packet(netdissect_options *ndo,
 	    const struct pcap_pkthdr *h, const u_char *sp,
 	    u_int packets_captured);
 
+void	prefetch_packet(netdissect_options *ndo, const u_char *sp,
+	    u_int caplen);
+
 void	ndo_set_function_pointers(netdissect_options *ndo);
 
 #endif /* print_h */
@@ -0,0 +1,287 @@
+/*
+ * Copyright (c) 2026 The TCPDUMP project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that: (1) source code
+ * distributions retain the above copyright notice and this paragraph
+ * in its entirety, and (2) distributions including binary code include
+ * the above copyright notice and this paragraph in its entirety in
+ * the documentation or other materials provided with the distribution.
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND
+ * WITHOUT ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, WITHOUT
+ * LIMITATION, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include "netdissect-stdinc.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "netdissect.h"
+#include "netdissect-fields.h"
+#include "flows.h"
+#include "rates.h"
+
+#define RATES_SLOTS	(2 * RATES_MAX_KEYS)	/* a power of 2 */
+#define RATES_NONE	(-1)
+
+static const char *const rates_kinds[RATES_NKINDS] = {
+	"all", "ethertype", "proto", "vlan", "mpls"
+};
+
+struct rates_entry {
+	uint64_t key;		/* kind << 32 | value */
+	uint64_t packets;
+	uint64_t bytes;
+};
+
+struct nd_rates {
+	int	format;
+	u_int	interval;	/* seconds */
+	int	started;	/* counting an interval */
+	int	header_done;
+	time_t	start;		/* of the interval being counted */
+	uint64_t packets, bytes;
+	struct rates_entry *e;
+	u_int	nused;
+	u_int	*index;		/* hash slots: an entry + 1, or 0 */
+
+	/* The packet being dissected. */
+	struct nd_flow_pkt pkt;
+	u_int	len;
+	int64_t	ethertype, vlan, mpls;	/* or RATES_NONE */
+};
+
+static void *
+rates_calloc(netdissect_options *ndo, size_t n, size_t size)
+{
+	void *p;
+
+	p = calloc(n, size);
+	if (p == NULL)
+		(*ndo->ndo_error)(ndo, S_ERR_ND_MEM_ALLOC,
+		    "nd_rates_new: calloc");
+	return (p);
+}
+
+/*
+ * Write the rows in "format" for every "interval" seconds.
+ */
+struct nd_rates *
+nd_rates_new(netdissect_options *ndo, int format, u_int interval)
+{
+	struct nd_rates *rt;
+
+	rt = (struct nd_rates *)rates_calloc(ndo, 1, sizeof(*rt));
+	rt->format = format;
+	rt->interval = interval;
+	/* Room for the "other" of each kind once it's full. */
+	rt->e = (struct rates_entry *)rates_calloc(ndo,
+	    RATES_MAX_KEYS + RATES_NKINDS, sizeof(struct rates_entry));
+	rt->index = (u_int *)rates_calloc(ndo, RATES_SLOTS, sizeof(u_int));
+	return (rt);
+}
+
+static void
+rates_count(struct nd_rates *rt, u_int kind, uint32_t value)
+{
+	struct rates_entry *e;
+	uint64_t key;
+	u_int i;
+
+	key = (uint64_t)kind << 32 | value;
+	for (;;) {
+		for (i = (u_int)((key * 0x9e3779b97f4a7c15ULL) >> 40) &
+		    (RATES_SLOTS - 1); rt->index[i] != 0;
+		    i = (i + 1) & (RATES_SLOTS - 1)) {
+			e = &rt->e[rt->index[i] - 1];
+			if (e->key == key) {
+				e->packets++;
+				e->bytes += rt->len;
+				return;
+			}
+		}
+		if (rt->nused < RATES_MAX_KEYS || value == RATES_OTHER)
+			break;
+		value = RATES_OTHER;
+		key = (uint64_t)kind << 32 | value;
+	}
+	e = &rt->e[rt->nused++];
+	e->key = key;
+	e->packets = 1;
+	e->bytes = rt->len;
+	rt->index[i] = rt->nused;
+}
+
+static int
+rates_cmp(const void *a, const void *b)
+{
+	const struct rates_entry *ea = (const struct rates_entry *)a;
+	const struct rates_entry *eb = (const struct rates_entry *)b;
+
+	return (ea->key < eb->key ? -1 : ea->key > eb->key);
+}
+
+static void
+rates_put(u_char *p, uint64_t v, u_int len)
+{
+	while (len != 0) {
+		p[--len] = (u_char)v;
+		v >>= 8;
+	}
+}
+
+static void
+rates_row(netdissect_options *ndo, u_int kind, uint32_t value,
+    uint64_t packets, uint64_t bytes)
+{
+	struct nd_rates *rt = ndo->ndo_rates;
+	u_char rec[RATES_RECORD_LEN];
+	char line[160], val[16];
+	int len;
+
+	if (rt->format == RATES_BINARY) {
+		memset(rec, 0, sizeof(rec));
+		rates_put(rec, (uint64_t)rt->start, 8);
+		rec[8] = (u_char)kind;
+		rates_put(rec + 12, value, 4);
+		rates_put(rec + 16, packets, 8);
+		rates_put(rec + 24, bytes, 8);
+		nd_outbuf_write(ndo, (const char *)rec, sizeof(rec));
+		return;
+	}
+	if (kind == RATES_ALL)
+		val[0] = '\0';
+	else if (value == RATES_OTHER)
+		strcpy(val, "other");
+	else
+		snprintf(val, sizeof(val), "%u", value);
+	len = snprintf(line, sizeof(line), "%" PRId64 ",%u,%s,%s,%" PRIu64
+	    ",%" PRIu64 ",%.2f,%.2f\n", (int64_t)rt->start, rt->interval,
+	    rates_kinds[kind], val, packets, bytes,
+	    (double)packets / rt->interval, (double)bytes * 8 / rt->interval);
+	if (len > 0)
+		nd_outbuf_write(ndo, line,
+		    (size_t)len < sizeof(line) ? (size_t)len : sizeof(line) - 1);
+}
+
+/*
+ * Write the rows for the interval being counted, if it had any packets,
+ * and start counting afresh.
+ */
+void
+nd_rates_report(netdissect_options *ndo)
+{
+	struct nd_rates *rt = ndo->ndo_rates;
+	struct rates_entry *e;
+	u_char hdr[sizeof(RATES_MAGIC) - 1 + 4];
+	static const char csv_header[] =
+	    "time,interval,key,value,packets,bytes,pps,bps\n";
+	u_int i;
+
+	if (rt == NULL)
+		return;
+	if (!rt->header_done) {
+		if (rt->format == RATES_BINARY) {
+			memcpy(hdr, RATES_MAGIC, sizeof(RATES_MAGIC) - 1);
+			rates_put(hdr + sizeof(RATES_MAGIC) - 1, rt->interval,
+			    4);
+			nd_outbuf_write(ndo, (const char *)hdr, sizeof(hdr));
+		} else
+			nd_outbuf_write(ndo, csv_header,
+			    sizeof(csv_header) - 1);
+		rt->header_done = 1;
+	}
+	if (rt->packets != 0) {
+		rates_row(ndo, RATES_ALL, 0, rt->packets, rt->bytes);
+		qsort(rt->e, rt->nused, sizeof(*rt->e), rates_cmp);
+		for (i = 0; i < rt->nused; i++) {
+			e = &rt->e[i];
+			rates_row(ndo, (u_int)(e->key >> 32), (uint32_t)e->key,
+			    e->packets, e->bytes);
+		}
+	}
+	nd_outbuf_flush(ndo);
+	rt->packets = rt->bytes = 0;
+	rt->nused = 0;
+	memset(rt->index, 0, RATES_SLOTS * sizeof(u_int));
+}
+
+/*
+ * Start on a packet of "len" bytes on the wire; its time stamp has been
+ * set in ndo.  A packet from before the interval being counted, out of
+ * order, is counted in it.
+ */
+void
+nd_rates_begin(netdissect_options *ndo, u_int len)
+{
+	struct nd_rates *rt = ndo->ndo_rates;
+	time_t now = ndo->ndo_packet_sec;
+
+	nd_flow_pkt_begin(&rt->pkt, len);
+	rt->len = len;
+	rt->ethertype = rt->vlan = rt->mpls = RATES_NONE;
+	if (!rt->started || now >= rt->start + (time_t)rt->interval) {
+		/* By packet time, so that it works for savefiles too. */
+		if (rt->started)
+			nd_rates_report(ndo);
+		rt->start = now - now % rt->interval;
+		rt->started = 1;
+	}
+}
+
+/*
+ * The field sink.
+ */
+void
+nd_rates_field(netdissect_options *ndo, u_int proto, u_int field,
+    u_int type, const u_char *val, u_int len)
+{
+	struct nd_rates *rt = ndo->ndo_rates;
+	uint64_t v = 0;
+	u_int i;
+
+	nd_flow_pkt_field(&rt->pkt, proto, field, type, val, len);
+	if (type != NDF_T_UINT)
+		return;
+	for (i = 0; i < len; i++)
+		v = v << 8 | val[i];
+	if (proto == NDF_ETHER) {
+		/* The outer frame's tags come before its final type. */
+		if (field == NDF_ETHER_VLAN && rt->vlan == RATES_NONE &&
+		    rt->ethertype == RATES_NONE)
+			rt->vlan = (int64_t)(v & 0xfff);
+		else if (field == NDF_ETHER_TYPE &&
+		    rt->ethertype == RATES_NONE)
+			rt->ethertype = (int64_t)v;
+	} else if (proto == NDF_MPLS && field == NDF_MPLS_LABEL &&
+	    rt->mpls == RATES_NONE)
+		rt->mpls = (int64_t)v;
+}
+
+/*
+ * Count the packet.
+ */
+void
+nd_rates_end(netdissect_options *ndo)
+{
+	struct nd_rates *rt = ndo->ndo_rates;
+
+	rt->packets++;
+	rt->bytes += rt->len;
+	if (rt->ethertype != RATES_NONE)
+		rates_count(rt, RATES_ETHERTYPE, (uint32_t)rt->ethertype);
+	if (rt->pkt.state != FLOWS_PKT_NONE)
+		rates_count(rt, RATES_PROTO, rt->pkt.key.proto);
+	if (rt->vlan != RATES_NONE)
+		rates_count(rt, RATES_VLAN, (uint32_t)rt->vlan);
+	if (rt->mpls != RATES_NONE)
+		rates_count(rt, RATES_MPLS, (uint32_t)rt->mpls);
+}
@@ -0,0 +1,72 @@
+/*
+ * Copyright (c) 2026 The TCPDUMP project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that: (1) source code
+ * distributions retain the above copyright notice and this paragraph
+ * in its entirety, and (2) distributions including binary code include
+ * the above copyright notice and this paragraph in its entirety in
+ * the documentation or other materials provided with the distribution.
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND
+ * WITHOUT ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, WITHOUT
+ * LIMITATION, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE.
+ */
+
+
+#ifndef rates_h
+#define rates_h
+
+/*
+ * Rate time series (--rates): the packets and bytes on the wire in
+ * each interval of packet time, for all packets, by the final Ethertype
+ * of the outermost Ethernet header, by the IP protocol of the outermost
+ * IPv4 or IPv6 header (past any IPv6 extension headers), by the VLAN ID
+ * of the outermost tag and by the top label of the outermost MPLS
+ * stack, from the fields the printers report.
+ *
+ * Each interval's counts are kept in a hash table of at most
+ * RATES_MAX_KEYS keys, emptied when the interval's rows are written;
+ * once it's full, new keys are counted as RATES_OTHER of their kind.
+ * Intervals without packets have no rows.
+ *
+ * In CSV the rows are
+ *
+ *	time,interval,key,value,packets,bytes,pps,bps
+ *
+ * after a line with those names, "time" being the start of the
+ * interval in seconds since 1970, "key" one of "all", "ethertype",
+ * "proto", "vlan" and "mpls", and "value" empty for "all" and "other"
+ * for RATES_OTHER.  The binary stream starts with the 4 bytes "NDR"
+ * 0x01 and the interval as 4 bytes, and each row is RATES_RECORD_LEN
+ * bytes: the time in 8, the key's kind in 1, 3 of zeroes, the value in
+ * 4, the packets in 8 and the bytes in 8, all big-endian.
+ */
+#define RATES_CSV		0
+#define RATES_BINARY		1
+
+#define RATES_MAGIC		"NDR\001"
+#define RATES_RECORD_LEN	32
+
+#define RATES_ALL		0
+#define RATES_ETHERTYPE		1
+#define RATES_PROTO		2
+#define RATES_VLAN		3
+#define RATES_MPLS		4
+#define RATES_NKINDS		5
+
+#define RATES_OTHER		0xffffffffU
+#define RATES_MAX_KEYS		16384
+#define RATES_DEFAULT_INTERVAL	1
+
+struct nd_rates;
+
+extern struct nd_rates *nd_rates_new(netdissect_options *, int, u_int);
+extern void nd_rates_begin(netdissect_options *, u_int);
+extern void nd_rates_field(netdissect_options *, u_int, u_int, u_int,
+    const u_char *, u_int);
+extern void nd_rates_end(netdissect_options *);
+extern void nd_rates_report(netdissect_options *);
+
+#endif /* rates_h */
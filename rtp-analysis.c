@@ -0,0 +1,361 @@
+/*
+ * Copyright (c) 2026 The TCPDUMP project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that: (1) source code
+ * distributions retain the above copyright notice and this paragraph
+ * in its entirety, and (2) distributions including binary code include
+ * the above copyright notice and this paragraph in its entirety in
+ * the documentation or other materials provided with the distribution.
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND
+ * WITHOUT ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, WITHOUT
+ * LIMITATION, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE.
+ */
+
+
+/*
+ * The state for --rtp-analysis is kept for each RTP stream, that is,
+ * each SSRC sent from one address and port to another.  The sequence
+ * numbers are followed as in RFC 3550 appendix A.1: a packet up to
+ * RTP_MAX_DROPOUT ahead of the highest sequence number seen moves it
+ * on, and any it skips are a gap; one up to RTP_MAX_MISORDER behind it
+ * is out of order, or a duplicate if it's the highest again; any other
+ * is taken as the stream starting over if the next packet follows it,
+ * and ignored otherwise.  The packets lost are those expected, from
+ * the first sequence number to the highest, less those received, so
+ * a packet that comes late is not lost.
+ *
+ * The interarrival jitter is that of RFC 3550 section 6.4.1, kept as
+ * in appendix A.8, in units of the payload type's RTP clock; it can
+ * only be worked out for the static payload types of RFC 3551, whose
+ * clock rates are known, and only packets of the stream's first
+ * payload type count for it.
+ *
+ * The streams are in a table, allocated all at once the first time,
+ * with their hash chains, and on a list in the order they were first
+ * seen; rtp_analysis_expire() takes out those that have gone quiet.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include "netdissect-stdinc.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "netdissect.h"
+#include "addrtostr.h"
+#include "extract.h"
+#include "rtp-analysis.h"
+
+#define RA_CHAINS		65536
+#define RTP_MAX_DROPOUT		3000
+#define RTP_MAX_MISORDER	100
+
+struct ra_stream {
+	struct rtp_stream_stats stats;
+	u_char src[16];			/* IPv4 addresses are in the first 4 */
+	u_char dst[16];
+	uint16_t sport;
+	uint16_t dport;
+	u_int alen;
+	uint32_t ssrc;
+	uint32_t cycles;		/* sequence number wraps, times 65536 */
+	uint16_t max_seq;		/* the highest seen */
+	uint16_t base_seq;		/* the first */
+	uint32_t bad_seq;		/* the one that would start over */
+	uint64_t received;		/* not counting duplicates */
+	uint64_t expected_prior;	/* before it last started over */
+	uint64_t received_prior;
+	uint64_t first_us;		/* when the first packet came */
+	int have_transit;
+	uint32_t transit;		/* of the last packet, in clock units */
+	uint32_t jitter;		/* times 16, in clock units */
+	uint32_t max_jitter;
+	char name[2 * INET6_ADDRSTRLEN + 16];
+	struct ra_stream *next;		/* on its hash chain, or the free list */
+	struct ra_stream *prev_seen;	/* on the list in the order seen */
+	struct ra_stream *next_seen;
+};
+
+static ND_THREAD_LOCAL struct ra_stream *ra_table;
+static ND_THREAD_LOCAL struct ra_stream **ra_chains;
+static ND_THREAD_LOCAL struct ra_stream *ra_free;
+static ND_THREAD_LOCAL struct ra_stream *ra_first, *ra_last;
+
+/*
+ * The clock rates of the static payload types, from RFC 3551; 0 if
+ * it's not known.
+ */
+static u_int
+ra_clock_rate(u_int pt)
+{
+	switch (pt) {
+
+	case 0: case 3: case 4: case 5: case 7: case 8: case 9:
+	case 12: case 13: case 15: case 18:
+		return 8000;
+
+	case 6:
+		return 16000;
+
+	case 10: case 11:
+		return 44100;
+
+	case 16:
+		return 11025;
+
+	case 17:
+		return 22050;
+
+	case 14: case 25: case 26: case 28: case 31: case 32: case 33:
+	case 34:
+		return 90000;
+	}
+	return 0;
+}
+
+static uint32_t
+ra_hash(const u_char *src, const u_char *dst, u_int alen, uint16_t sport,
+    uint16_t dport, uint32_t ssrc)
+{
+	uint32_t h = 2166136261U;
+	u_int i;
+
+	for (i = 0; i < alen; i++)
+		h = (h ^ src[i]) * 16777619U;
+	for (i = 0; i < alen; i++)
+		h = (h ^ dst[i]) * 16777619U;
+	h = (h ^ sport) * 16777619U;
+	h = (h ^ dport) * 16777619U;
+	return ((h ^ ssrc) * 16777619U);
+}
+
+/*
+ * Find the stream, or start one; NULL if the table is full.
+ */
+static struct ra_stream *
+ra_find(netdissect_options *ndo, const u_char *src, const u_char *dst,
+    u_int alen, uint16_t sport, uint16_t dport, uint32_t ssrc, int *new)
+{
+	struct ra_stream *s, **sp;
+	char sbuf[INET6_ADDRSTRLEN], dbuf[INET6_ADDRSTRLEN];
+	u_int i;
+
+	if (ra_table == NULL) {
+		ra_table = (struct ra_stream *)calloc(RTP_ANALYSIS_MAX_STREAMS,
+		    sizeof(*ra_table));
+		ra_chains = (struct ra_stream **)calloc(RA_CHAINS,
+		    sizeof(*ra_chains));
+		if (ra_table == NULL || ra_chains == NULL)
+			(*ndo->ndo_error)(ndo, S_ERR_ND_MEM_ALLOC,
+			    "%s: calloc", __func__);
+		for (i = RTP_ANALYSIS_MAX_STREAMS; i != 0; i--) {
+			ra_table[i - 1].next = ra_free;
+			ra_free = &ra_table[i - 1];
+		}
+	}
+	sp = &ra_chains[ra_hash(src, dst, alen, sport, dport, ssrc) %
+	    RA_CHAINS];
+	for (s = *sp; s != NULL; s = s->next)
+		if (s->ssrc == ssrc && s->alen == alen &&
+		    s->sport == sport && s->dport == dport &&
+		    memcmp(s->src, src, alen) == 0 &&
+		    memcmp(s->dst, dst, alen) == 0) {
+			*new = 0;
+			return (s);
+		}
+
+	if ((s = ra_free) == NULL)
+		return (NULL);
+	ra_free = s->next;
+	memset(s, 0, sizeof(*s));
+	memcpy(s->src, src, alen);
+	memcpy(s->dst, dst, alen);
+	s->sport = sport;
+	s->dport = dport;
+	s->alen = alen;
+	s->ssrc = ssrc;
+	if (alen == 4) {
+		addrtostr(src, sbuf, sizeof(sbuf));
+		addrtostr(dst, dbuf, sizeof(dbuf));
+	} else {
+		addrtostr6(src, sbuf, sizeof(sbuf));
+		addrtostr6(dst, dbuf, sizeof(dbuf));
+	}
+	snprintf(s->name, sizeof(s->name), "%s.%u > %s.%u", sbuf, sport,
+	    dbuf, dport);
+	s->stats.rss_stream = s->name;
+	s->stats.rss_ssrc = ssrc;
+	s->next = *sp;
+	*sp = s;
+	s->prev_seen = ra_last;
+	if (ra_last != NULL)
+		ra_last->next_seen = s;
+	else
+		ra_first = s;
+	ra_last = s;
+	*new = 1;
+	return (s);
+}
+
+static uint64_t
+ra_expected(const struct ra_stream *s)
+{
+	return ((uint64_t)s->cycles + s->max_seq - s->base_seq + 1);
+}
+
+/*
+ * Start counting the sequence numbers again, from seq, keeping the
+ * counts so far.
+ */
+static void
+ra_init_seq(struct ra_stream *s, uint16_t seq)
+{
+	if (s->received != 0) {
+		s->expected_prior += ra_expected(s);
+		s->received_prior += s->received;
+	}
+	s->base_seq = s->max_seq = seq;
+	s->bad_seq = 65536 + 1;		/* so seq == bad_seq is false */
+	s->cycles = 0;
+	s->received = 0;
+	s->have_transit = 0;
+}
+
+void
+rtp_analyze(netdissect_options *ndo, const u_char *src, const u_char *dst,
+    u_int alen, u_int sport, u_int dport, const u_char *bp, u_int length)
+{
+	struct ra_stream *s;
+	uint64_t now;
+	uint32_t i0, ts, ssrc, arrival, transit, d;
+	uint16_t seq, udelta;
+	u_int pt;
+	int new;
+
+	/* Only RTP version 2, with its whole fixed header. */
+	if (length < 12 || !ND_TTEST_LEN(bp, 12))
+		return;
+	i0 = EXTRACT_BE_U_4(bp);
+	if ((i0 >> 30) != 2)
+		return;
+	seq = (uint16_t)(i0 & 0xffff);
+	pt = (i0 >> 16) & 0x7f;
+	ts = EXTRACT_BE_U_4(bp + 4);
+	ssrc = EXTRACT_BE_U_4(bp + 8);
+	now = (uint64_t)ND_TS_USEC(ndo->ndo_packet_ts);
+
+	s = ra_find(ndo, src, dst, alen, (uint16_t)sport, (uint16_t)dport,
+	    ssrc, &new);
+	if (s == NULL)
+		return;
+	s->stats.rss_packets++;
+	s->stats.rss_last_us = now;
+	if (new) {
+		s->stats.rss_pt = pt;
+		s->stats.rss_clock = ra_clock_rate(pt);
+		s->first_us = now;
+		ra_init_seq(s, seq);
+	} else {
+		udelta = (uint16_t)(seq - s->max_seq);
+		if (udelta == 0) {
+			s->stats.rss_duplicates++;
+			ND_PRINT(" [duplicate]");
+			return;
+		} else if (udelta < RTP_MAX_DROPOUT) {
+			if (seq < s->max_seq)
+				s->cycles += 65536;
+			if (udelta > 1) {
+				s->stats.rss_gaps++;
+				ND_PRINT(" [%u missing]", udelta - 1U);
+			}
+			s->max_seq = seq;
+		} else if (udelta <= 65536 - RTP_MAX_MISORDER) {
+			/* A jump; it starts over if the next follows it. */
+			if (seq != s->bad_seq) {
+				s->bad_seq = (seq + 1) & 0xffff;
+				s->stats.rss_jumps++;
+				return;
+			}
+			ra_init_seq(s, seq);
+		} else {
+			s->stats.rss_out_of_order++;
+			ND_PRINT(" [out-of-order]");
+		}
+	}
+	s->received++;
+
+	if (s->stats.rss_clock == 0 || pt != s->stats.rss_pt)
+		return;
+	arrival = (uint32_t)((now - s->first_us) * s->stats.rss_clock /
+	    1000000);
+	transit = arrival - ts;
+	if (s->have_transit) {
+		d = transit - s->transit;
+		if ((int32_t)d < 0)
+			d = -d;
+		s->jitter += d - ((s->jitter + 8) >> 4);
+		if (s->jitter > s->max_jitter)
+			s->max_jitter = s->jitter;
+	}
+	s->have_transit = 1;
+	s->transit = transit;
+}
+
+void
+rtp_analysis_foreach(rtp_analysis_fn fn, void *arg)
+{
+	struct ra_stream *s;
+	uint64_t expected;
+
+	for (s = ra_first; s != NULL; s = s->next_seen) {
+		expected = s->expected_prior + ra_expected(s);
+		s->stats.rss_expected = expected;
+		s->stats.rss_lost = (int64_t)(expected - s->received_prior -
+		    s->received);
+		if (s->stats.rss_clock != 0) {
+			s->stats.rss_jitter_us = (uint64_t)s->jitter *
+			    1000000 / 16 / s->stats.rss_clock;
+			s->stats.rss_max_jitter_us = (uint64_t)s->max_jitter *
+			    1000000 / 16 / s->stats.rss_clock;
+		}
+		(*fn)(arg, &s->stats);
+	}
+}
+
+/*
+ * Take out the streams that haven't had a packet since "before", in
+ * microseconds, to make room for new ones.
+ */
+void
+rtp_analysis_expire(uint64_t before)
+{
+	struct ra_stream *s, *next, **sp;
+
+	for (s = ra_first; s != NULL; s = next) {
+		next = s->next_seen;
+		if (s->stats.rss_last_us >= before)
+			continue;
+		sp = &ra_chains[ra_hash(s->src, s->dst, s->alen, s->sport,
+		    s->dport, s->ssrc) % RA_CHAINS];
+		while (*sp != s)
+			sp = &(*sp)->next;
+		*sp = s->next;
+		if (s->prev_seen != NULL)
+			s->prev_seen->next_seen = s->next_seen;
+		else
+			ra_first = s->next_seen;
+		if (s->next_seen != NULL)
+			s->next_seen->prev_seen = s->prev_seen;
+		else
+			ra_last = s->prev_seen;
+		s->next = ra_free;
+		ra_free = s;
+	}
+}
@@ -0,0 +1,36 @@
+/*
+ * Copyright (c) 2026 The TCPDUMP project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that: (1) source code
+ * distributions retain the above copyright notice and this paragraph
+ * in its entirety, and (2) distributions including binary code include
+ * the above copyright notice and this paragraph in its entirety in
+ * the documentation or other materials provided with the distribution.
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND
+ * WITHOUT ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, WITHOUT
+ * LIMITATION, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE.
+ */
+
+
+#ifndef rtp_analysis_h
+#define rtp_analysis_h
+
+/*
+ * --rtp-analysis: follow each RTP stream, by SSRC and the addresses and
+ * ports it's sent from and to, and work out its loss, sequence gaps,
+ * reordering and interarrival jitter as RFC 3550 does.
+ * rtp_analyze() is handed the addresses, of "alen" bytes, and ports,
+ * and the RTP header and length of a packet, and prints the marks for
+ * it.  The streams are kept in a table of RTP_ANALYSIS_MAX_STREAMS,
+ * allocated once; those after that aren't followed until
+ * rtp_analysis_expire() makes room.
+ */
+#define RTP_ANALYSIS_MAX_STREAMS	(1U << 15)	/* most streams followed */
+
+extern void rtp_analyze(netdissect_options *, const u_char *,
+    const u_char *, u_int, u_int, u_int, const u_char *, u_int);
+
+#endif /* rtp_analysis_h */
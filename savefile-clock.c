@@ -0,0 +1,164 @@
+/*
+ * Copyright (c) 2026 The TCPDUMP project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that: (1) source code
+ * distributions retain the above copyright notice and this paragraph
+ * in its entirety, and (2) distributions including binary code include
+ * the above copyright notice and this paragraph in its entirety in
+ * the documentation or other materials provided with the distribution.
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND
+ * WITHOUT ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, WITHOUT
+ * LIMITATION, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE.
+ */
+
+/*
+ * Only the clock thread adds to the counts, and only the one writer
+ * reads them and keeps the count it last saw, so a count that's moved
+ * on means one or more intervals have ended; several ending before the
+ * writer looks are one rotation or flush, not a burst of them.
+ *
+ * The thread works in nanoseconds since the Epoch on the wall clock,
+ * the clock the -G file names and the time() calls it replaces use.
+ * If the clock is stepped, it finds the deadlines it slept past have
+ * passed, and moves the -G one on by whole intervals from the start.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include "netdissect-stdinc.h"
+
+#include "savefile-clock.h"
+
+#ifdef SAVEFILE_CLOCK_SUPPORTED
+#include <errno.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <pcap.h>
+
+#define NS_PER_SEC	1000000000ULL
+#define NS_PER_MS	1000000ULL
+
+struct savefile_clock {
+	uint64_t rotate_ns;		/* the -G interval, or 0 */
+	uint64_t next_rotation;
+	uint64_t flush_ns;		/* the --flush-interval, or 0 */
+	uint64_t next_flush;
+	void	(*wake)(void *);
+	void	*wake_arg;
+	atomic_uint rotations;		/* stored by the clock thread */
+	atomic_uint flushes;
+	u_int	rotations_seen;		/* by the writer */
+	u_int	flushes_seen;
+};
+
+static uint64_t
+clock_now(void)
+{
+	struct timespec ts;
+
+	(void)clock_gettime(CLOCK_REALTIME, &ts);
+	return ((uint64_t)ts.tv_sec * NS_PER_SEC + (uint64_t)ts.tv_nsec);
+}
+
+/*
+ * Set up a clock whose -G intervals of "rotate_secs" run from "start",
+ * and which flushes every "flush_ms" milliseconds; either can be 0.
+ */
+struct savefile_clock *
+savefile_clock_create(time_t start, u_int rotate_secs, u_int flush_ms,
+    void (*wake)(void *), void *wake_arg, char *errbuf)
+{
+	struct savefile_clock *c;
+	uint64_t now;
+
+	c = (struct savefile_clock *)calloc(1, sizeof(*c));
+	if (c == NULL) {
+		snprintf(errbuf, PCAP_ERRBUF_SIZE,
+		    "savefile_clock_create: calloc");
+		return (NULL);
+	}
+	now = clock_now();
+	c->rotate_ns = (uint64_t)rotate_secs * NS_PER_SEC;
+	if (c->rotate_ns != 0)
+		c->next_rotation = (uint64_t)start * NS_PER_SEC + c->rotate_ns;
+	c->flush_ns = (uint64_t)flush_ms * NS_PER_MS;
+	if (c->flush_ns != 0)
+		c->next_flush = (now / c->flush_ns + 1) * c->flush_ns;
+	c->wake = wake;
+	c->wake_arg = wake_arg;
+	atomic_init(&c->rotations, 0);
+	atomic_init(&c->flushes, 0);
+	return (c);
+}
+
+void *
+savefile_clock_main(void *arg)
+{
+	struct savefile_clock *c = (struct savefile_clock *)arg;
+	struct timespec ts;
+	uint64_t now, next;
+	int ticked;
+
+	for (;;) {
+		now = clock_now();
+		ticked = 0;
+		if (c->rotate_ns != 0 && now >= c->next_rotation) {
+			c->next_rotation += ((now - c->next_rotation) /
+			    c->rotate_ns + 1) * c->rotate_ns;
+			atomic_fetch_add(&c->rotations, 1);
+			ticked = 1;
+		}
+		if (c->flush_ns != 0 && now >= c->next_flush) {
+			c->next_flush = (now / c->flush_ns + 1) * c->flush_ns;
+			atomic_fetch_add(&c->flushes, 1);
+			ticked = 1;
+		}
+		if (ticked && c->wake != NULL)
+			(*c->wake)(c->wake_arg);
+
+		next = UINT64_MAX;
+		if (c->rotate_ns != 0)
+			next = c->next_rotation;
+		if (c->flush_ns != 0 && c->next_flush < next)
+			next = c->next_flush;
+		if (next == UINT64_MAX)
+			return (NULL);
+		ts.tv_sec = (time_t)((next - now) / NS_PER_SEC);
+		ts.tv_nsec = (long)((next - now) % NS_PER_SEC);
+		while (nanosleep(&ts, &ts) == -1 && errno == EINTR)
+			;
+	}
+	/* NOTREACHED */
+}
+
+int
+savefile_clock_rotation_due(struct savefile_clock *c)
+{
+	u_int n = atomic_load(&c->rotations);
+
+	if (n == c->rotations_seen)
+		return (0);
+	c->rotations_seen = n;
+	return (1);
+}
+
+int
+savefile_clock_flush_due(struct savefile_clock *c)
+{
+	u_int n = atomic_load(&c->flushes);
+
+	if (n == c->flushes_seen)
+		return (0);
+	c->flushes_seen = n;
+	return (1);
+}
+#endif /* SAVEFILE_CLOCK_SUPPORTED */
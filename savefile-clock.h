@@ -0,0 +1,39 @@
+/*
+ * Copyright (c) 2026 The TCPDUMP project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that: (1) source code
+ * distributions retain the above copyright notice and this paragraph
+ * in its entirety, and (2) distributions including binary code include
+ * the above copyright notice and this paragraph in its entirety in
+ * the documentation or other materials provided with the distribution.
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND
+ * WITHOUT ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, WITHOUT
+ * LIMITATION, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE.
+ */
+
+/*
+ * A clock thread for -G and --flush-interval, so that the thread
+ * writing the savefile doesn't have to look at the time for every
+ * packet.  savefile_clock_main() is the thread; it sleeps until the end
+ * of the next -G interval, counted from the given start, or the next
+ * multiple of the flush interval on the wall clock, counts it and calls
+ * the wake-up function, if any, so that a writer waiting for packets
+ * can notice.  The writer asks savefile_clock_rotation_due() and
+ * savefile_clock_flush_due() whether either has happened since it last
+ * asked, which is just an atomic load.
+ */
+#if defined(HAVE_PTHREADS) && defined(HAVE_STDATOMIC_H) && \
+    !defined(__STDC_NO_ATOMICS__)
+#define SAVEFILE_CLOCK_SUPPORTED
+
+struct savefile_clock;
+
+extern struct savefile_clock *savefile_clock_create(time_t, u_int, u_int,
+    void (*)(void *), void *, char *);
+extern void *savefile_clock_main(void *);
+extern int savefile_clock_rotation_due(struct savefile_clock *);
+extern int savefile_clock_flush_due(struct savefile_clock *);
+#endif
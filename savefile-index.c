@@ -0,0 +1,263 @@
+/*
+ * Copyright (c) 2026 The TCPDUMP project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that: (1) source code
+ * distributions retain the above copyright notice and this paragraph
+ * in its entirety, and (2) distributions including binary code include
+ * the above copyright notice and this paragraph in its entirety in
+ * the documentation or other materials provided with the distribution.
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND
+ * WITHOUT ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, WITHOUT
+ * LIMITATION, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE.
+ */
+
+/*
+ * An index is a header followed by the entries, all in the byte order
+ * of the machine that wrote it; an index from a machine with the other
+ * byte order isn't used, which just means seeking starts at the
+ * beginning of the savefile.  A savefile that's still being written
+ * to has an index that covers the part written so far.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include "netdissect-stdinc.h"
+
+#ifndef _WIN32
+#include <sys/stat.h>
+#endif
+
+#include <errno.h>
+#include <pcap.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "savefile-index.h"
+
+#define SAVEFILE_INDEX_MAGIC	0x54444958	/* "TDIX" */
+#define SAVEFILE_INDEX_VERSION	1
+
+struct savefile_index_hdr {
+	uint32_t magic;
+	uint16_t version;
+	uint16_t flags;		/* none yet */
+	uint32_t interval;
+	uint32_t reserved;
+};
+
+struct savefile_index {
+	FILE	*f;
+	u_int	interval;
+	int	nano;		/* time stamps are in nanoseconds */
+	uint64_t npackets;	/* packets counted so far */
+	u_int	until_next;	/* packets until the next entry */
+};
+
+/*
+ * Return the name of the index of the savefile fname, in memory to be
+ * freed by the caller, or NULL if it can't be allocated.
+ */
+char *
+savefile_index_name(const char *fname)
+{
+	size_t len;
+	char *name;
+
+	len = strlen(fname) + sizeof(SAVEFILE_INDEX_SUFFIX);
+	name = (char *)malloc(len);
+	if (name != NULL)
+		snprintf(name, len, "%s%s", fname, SAVEFILE_INDEX_SUFFIX);
+	return (name);
+}
+
+/*
+ * Is fname a regular file in the pcap format, the records of which can
+ * be sought to?  That isn't done on Windows, where the FILE of a
+ * pcap_t may belong to another C library than ours.
+ */
+int
+savefile_index_seekable(const char *fname)
+{
+#ifndef _WIN32
+	struct stat st;
+	uint32_t magic;
+	FILE *f;
+	int ret;
+
+	if (stat(fname, &st) == -1 || !S_ISREG(st.st_mode))
+		return (0);
+	f = fopen(fname, "rb");
+	if (f == NULL)
+		return (0);
+	ret = fread(&magic, sizeof(magic), 1, f) == 1 &&
+	    (magic == 0xa1b2c3d4 || magic == 0xd4c3b2a1 ||
+	     magic == 0xa1b23c4d || magic == 0x4d3cb2a1);
+	(void)fclose(f);
+	return (ret);
+#else
+	return (0);
+#endif
+}
+
+/*
+ * Start an index, with an entry every interval packets, in f, for a
+ * savefile with time stamps in nanoseconds if nano is set.  On
+ * failure, f is closed and NULL returned with a message in errbuf.
+ */
+struct savefile_index *
+savefile_index_open(FILE *f, u_int interval, int nano, char *errbuf)
+{
+	struct savefile_index_hdr hdr;
+	struct savefile_index *idx;
+
+	idx = (struct savefile_index *)calloc(1, sizeof(*idx));
+	if (idx == NULL) {
+		snprintf(errbuf, PCAP_ERRBUF_SIZE, "out of memory");
+		(void)fclose(f);
+		return (NULL);
+	}
+	memset(&hdr, 0, sizeof(hdr));
+	hdr.magic = SAVEFILE_INDEX_MAGIC;
+	hdr.version = SAVEFILE_INDEX_VERSION;
+	hdr.interval = interval;
+	if (fwrite(&hdr, sizeof(hdr), 1, f) != 1) {
+		snprintf(errbuf, PCAP_ERRBUF_SIZE, "%s", strerror(errno));
+		(void)fclose(f);
+		free(idx);
+		return (NULL);
+	}
+	idx->f = f;
+	idx->interval = interval;
+	idx->nano = nano;
+	return (idx);
+}
+
+/*
+ * Count a packet written to the savefile; returns 1 if it's one to
+ * have an entry, in which case savefile_index_add() must be called for
+ * it before the next packet.
+ */
+int
+savefile_index_next(struct savefile_index *idx)
+{
+	idx->npackets++;
+	if (idx->until_next-- != 0)
+		return (0);
+	idx->until_next = idx->interval - 1;
+	return (1);
+}
+
+/*
+ * Add the entry for the packet just counted, with time stamp ts, whose
+ * record starts at offset; returns -1 if it couldn't be written.
+ */
+int
+savefile_index_add(struct savefile_index *idx, const struct timeval *ts,
+    uint64_t offset)
+{
+	struct savefile_index_entry e;
+	nd_ts_t t = ND_TS_FROM_TIMEVAL(ts, idx->nano);
+
+	memset(&e, 0, sizeof(e));
+	e.packet = idx->npackets;
+	e.offset = offset;
+	e.sec = ND_TS_SEC(t);
+	e.nsec = ND_TS_NSEC(t);
+	if (fwrite(&e, sizeof(e), 1, idx->f) != 1)
+		return (-1);
+	return (0);
+}
+
+/*
+ * Finish the index; on failure, return -1 with a message in errbuf.
+ */
+int
+savefile_index_close(struct savefile_index *idx, char *errbuf)
+{
+	int ret = 0;
+
+	if (fclose(idx->f) != 0) {
+		snprintf(errbuf, PCAP_ERRBUF_SIZE, "%s", strerror(errno));
+		ret = -1;
+	}
+	free(idx);
+	return (ret);
+}
+
+/*
+ * Look in the index of the savefile fname for the last entry before
+ * both packet number packet and time stamp ts; the packets of
+ * the savefile are taken to be in time stamp order, so the search
+ * stops at the first entry that isn't before them.  Returns 1 with
+ * the entry in *entry if there is one, 0 if there's none or no index,
+ * and -1, with a message in errbuf, if the index can't be used.
+ */
+int
+savefile_index_find(const char *fname, uint64_t packet, nd_ts_t ts,
+    struct savefile_index_entry *entry, char *errbuf)
+{
+	struct savefile_index_entry e[256];
+	struct savefile_index_hdr hdr;
+	char *name;
+	size_t i, n;
+	FILE *f;
+	int found = 0;
+
+	name = savefile_index_name(fname);
+	if (name == NULL) {
+		snprintf(errbuf, PCAP_ERRBUF_SIZE, "out of memory");
+		return (-1);
+	}
+	f = fopen(name, "rb");
+	if (f == NULL) {
+		if (errno == ENOENT) {
+			free(name);
+			return (0);
+		}
+		snprintf(errbuf, PCAP_ERRBUF_SIZE, "%s: %s", name,
+		    strerror(errno));
+		free(name);
+		return (-1);
+	}
+	if (fread(&hdr, sizeof(hdr), 1, f) != 1 ||
+	    hdr.magic != SAVEFILE_INDEX_MAGIC) {
+		snprintf(errbuf, PCAP_ERRBUF_SIZE,
+		    "%s isn't a savefile index from a machine with this byte order",
+		    name);
+		goto fail;
+	}
+	if (hdr.version != SAVEFILE_INDEX_VERSION) {
+		snprintf(errbuf, PCAP_ERRBUF_SIZE,
+		    "%s is a version %u savefile index, not version %u",
+		    name, hdr.version, SAVEFILE_INDEX_VERSION);
+		goto fail;
+	}
+	while ((n = fread(e, sizeof(e[0]), sizeof(e) / sizeof(e[0]), f)) != 0) {
+		for (i = 0; i < n; i++) {
+			if (e[i].packet > packet ||
+			    e[i].sec * _NANO_PER_SEC + e[i].nsec >= ts)
+				goto done;
+			*entry = e[i];
+			found = 1;
+		}
+	}
+	if (ferror(f)) {
+		snprintf(errbuf, PCAP_ERRBUF_SIZE, "%s: %s", name,
+		    strerror(errno));
+		goto fail;
+	}
+done:
+	(void)fclose(f);
+	free(name);
+	return (found);
+fail:
+	(void)fclose(f);
+	free(name);
+	return (-1);
+}
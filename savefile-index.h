@@ -0,0 +1,50 @@
+/*
+ * Copyright (c) 2026 The TCPDUMP project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that: (1) source code
+ * distributions retain the above copyright notice and this paragraph
+ * in its entirety, and (2) distributions including binary code include
+ * the above copyright notice and this paragraph in its entirety in
+ * the documentation or other materials provided with the distribution.
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND
+ * WITHOUT ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, WITHOUT
+ * LIMITATION, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE.
+ */
+
+/*
+ * Time indexes of pcap savefiles, for -w with --write-index and -r with
+ * --build-index, and for seeking with --start-time, --end-time and
+ * --start-packet.
+ *
+ * The index of a savefile is in the file with SAVEFILE_INDEX_SUFFIX
+ * appended to its name, and has an entry for every interval'th packet,
+ * starting with the first, giving its number, its time stamp and the
+ * offset of its record in the savefile.
+ */
+#include "timeval-operations.h"
+
+#define SAVEFILE_INDEX_SUFFIX			".idx"
+#define SAVEFILE_INDEX_DEFAULT_INTERVAL		10000
+
+struct savefile_index_entry {
+	uint64_t packet;	/* packet number, from 1 */
+	uint64_t offset;	/* of the packet's record */
+	int64_t	sec;		/* time stamp */
+	uint32_t nsec;
+	uint32_t pad;
+};
+
+struct savefile_index;
+
+extern char *savefile_index_name(const char *);
+extern int savefile_index_seekable(const char *);
+extern struct savefile_index *savefile_index_open(FILE *, u_int, int, char *);
+extern int savefile_index_next(struct savefile_index *);
+extern int savefile_index_add(struct savefile_index *, const struct timeval *,
+    uint64_t);
+extern int savefile_index_close(struct savefile_index *, char *);
+extern int savefile_index_find(const char *, uint64_t, nd_ts_t,
+    struct savefile_index_entry *, char *);
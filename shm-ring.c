@@ -0,0 +1,317 @@
+/*
+ * Copyright (c) 2026 The TCPDUMP project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that: (1) source code
+ * distributions retain the above copyright notice and this paragraph
+ * in its entirety, and (2) distributions including binary code include
+ * the above copyright notice and this paragraph in its entirety in
+ * the documentation or other materials provided with the distribution.
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND
+ * WITHOUT ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, WITHOUT
+ * LIMITATION, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE.
+ */
+
+/*
+ * The writer keeps a copy of the tail, and only loads the reader's
+ * again when the copy says there isn't room, so that it doesn't touch
+ * the reader's cache line for every record; head, tail and the counts
+ * are each on a cache line of their own for the same reason.
+ *
+ * An existing object of the same name is unlinked and a new one made,
+ * rather than being reused, so that a reader still mapping the old one
+ * never sees it start over underneath it.  The object is left in place
+ * when the writer is done, with the finished flag set, so that the
+ * reader can read what's left; the next ring of that name replaces it.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include "netdissect-stdinc.h"
+
+#include <pcap.h>
+
+#include "shm-ring.h"
+
+#ifdef SHM_RING_SUPPORTED
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define SHM_RING_ALIGN		8
+#define SHM_RING_RECORD		8	/* type and length */
+#define SHM_ROUND(n)		(((n) + SHM_RING_ALIGN - 1) & \
+				    ~(uint64_t)(SHM_RING_ALIGN - 1))
+
+/* The header, as laid out in shm-ring.h. */
+struct shm_ring_header {
+	uint32_t	magic;
+	uint32_t	version;
+	uint32_t	header_size;
+	uint32_t	kind;
+	uint64_t	data_size;
+	uint32_t	linktype;
+	uint32_t	snaplen;
+	uint32_t	tsresol;
+	uint32_t	pid;
+	atomic_uint	finished;
+	uint32_t	pad0[5];
+	atomic_uint_least64_t head;	/* offset 64 */
+	uint64_t	pad1[7];
+	atomic_uint_least64_t tail;	/* offset 128 */
+	uint64_t	pad2[7];
+	atomic_uint_least64_t records;	/* offset 192 */
+	atomic_uint_least64_t dropped;
+};
+
+/* A packet record's header, as in a pcap savefile. */
+struct shm_ring_packet {
+	uint32_t ts_sec;
+	uint32_t ts_frac;
+	uint32_t caplen;
+	uint32_t len;
+};
+
+struct shm_ring {
+	struct shm_ring_header *hdr;
+	u_char	*data;
+	size_t	maplen;
+	uint64_t size;
+	uint64_t mask;
+	uint64_t head;			/* the writer's, not yet published */
+	uint64_t tail;			/* the last tail loaded */
+	uint64_t records;
+	uint64_t dropped;
+};
+
+/*
+ * Return 1 if "name", a -w argument, names a shared-memory ring.
+ */
+int
+shm_ring_url(const char *name)
+{
+	return (strncmp(name, "shm:", 4) == 0);
+}
+
+/*
+ * Make a ring for records of "kind", of "size" bytes of data, rounded
+ * up to a power of 2, in the shared-memory object "name" (with or
+ * without the leading "/" that shm_open() wants).  For packets,
+ * "linktype", "snaplen" and "tsresol" are the savefile's.
+ */
+struct shm_ring *
+shm_ring_create(const char *name, u_int kind, size_t size, int linktype,
+    u_int snaplen, u_int tsresol, char *ebuf)
+{
+	struct shm_ring *r;
+	struct shm_ring_header *hdr;
+	char *path;
+	uint64_t datasize;
+	size_t maplen;
+	void *base;
+	int fd;
+
+	if (size < SHM_RING_MIN_SIZE)
+		size = SHM_RING_MIN_SIZE;
+	for (datasize = SHM_RING_MIN_SIZE; datasize < size; datasize <<= 1)
+		if (datasize > SIZE_MAX / 4) {
+			snprintf(ebuf, PCAP_ERRBUF_SIZE,
+			    "shared-memory ring of %zu bytes is too big", size);
+			return (NULL);
+		}
+	maplen = SHM_RING_HEADER_SIZE + (size_t)datasize;
+
+	path = (char *)malloc(strlen(name) + 2);
+	if (path == NULL) {
+		snprintf(ebuf, PCAP_ERRBUF_SIZE, "shm_ring_create: malloc");
+		return (NULL);
+	}
+	(void)snprintf(path, strlen(name) + 2, "%s%s",
+	    name[0] == '/' ? "" : "/", name);
+	(void)shm_unlink(path);
+	fd = shm_open(path, O_RDWR | O_CREAT | O_EXCL, 0666);
+	if (fd == -1) {
+		snprintf(ebuf, PCAP_ERRBUF_SIZE, "shm_open %s: %s", path,
+		    strerror(errno));
+		free(path);
+		return (NULL);
+	}
+	if (ftruncate(fd, (off_t)maplen) == -1) {
+		snprintf(ebuf, PCAP_ERRBUF_SIZE, "%s: %s", path,
+		    strerror(errno));
+		goto fail;
+	}
+	base = mmap(NULL, maplen, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if (base == MAP_FAILED) {
+		snprintf(ebuf, PCAP_ERRBUF_SIZE, "mmap %s: %s", path,
+		    strerror(errno));
+		goto fail;
+	}
+	r = (struct shm_ring *)calloc(1, sizeof(*r));
+	if (r == NULL) {
+		snprintf(ebuf, PCAP_ERRBUF_SIZE, "shm_ring_create: calloc");
+		(void)munmap(base, maplen);
+		goto fail;
+	}
+	(void)close(fd);
+	free(path);
+
+	hdr = (struct shm_ring_header *)base;
+	hdr->version = SHM_RING_VERSION;
+	hdr->header_size = SHM_RING_HEADER_SIZE;
+	hdr->kind = kind;
+	hdr->data_size = datasize;
+	hdr->linktype = (uint32_t)linktype;
+	hdr->snaplen = snaplen;
+	hdr->tsresol = tsresol;
+	hdr->pid = (uint32_t)getpid();
+	atomic_init(&hdr->finished, 0);
+	atomic_init(&hdr->head, 0);
+	atomic_init(&hdr->tail, 0);
+	atomic_init(&hdr->records, 0);
+	atomic_init(&hdr->dropped, 0);
+	/* The magic number last, so that a reader sees the rest first. */
+	atomic_thread_fence(memory_order_release);
+	hdr->magic = SHM_RING_MAGIC;
+
+	r->hdr = hdr;
+	r->data = (u_char *)base + SHM_RING_HEADER_SIZE;
+	r->maplen = maplen;
+	r->size = datasize;
+	r->mask = datasize - 1;
+	return (r);
+
+fail:
+	(void)close(fd);
+	(void)shm_unlink(path);
+	free(path);
+	return (NULL);
+}
+
+/*
+ * Find room for a record with "len" bytes after its type and length,
+ * padding out the end of the data area first if it has to, and return
+ * where it goes, or NULL, having counted it as dropped, if the reader
+ * hasn't left room.
+ */
+static u_char *
+ring_reserve(struct shm_ring *r, uint32_t type, size_t len)
+{
+	uint64_t need, off, pad;
+	uint32_t *rec;
+
+	need = SHM_ROUND(SHM_RING_RECORD + (uint64_t)len);
+	off = r->head & r->mask;
+	pad = need > r->size - off ? r->size - off : 0;
+	if (need + pad > r->size - (r->head - r->tail)) {
+		r->tail = atomic_load_explicit(&r->hdr->tail,
+		    memory_order_acquire);
+		if (need + pad > r->size - (r->head - r->tail)) {
+			r->dropped++;
+			atomic_store_explicit(&r->hdr->dropped, r->dropped,
+			    memory_order_relaxed);
+			return (NULL);
+		}
+	}
+	if (pad != 0) {
+		rec = (uint32_t *)(void *)(r->data + off);
+		rec[0] = SHM_RING_PAD;
+		rec[1] = (uint32_t)(pad - SHM_RING_RECORD);
+		r->head += pad;
+		off = 0;
+	}
+	rec = (uint32_t *)(void *)(r->data + off);
+	rec[0] = type;
+	rec[1] = (uint32_t)len;
+	return ((u_char *)(rec + 2));
+}
+
+/*
+ * Make the record just written, of "len" bytes, visible to the reader.
+ */
+static void
+ring_publish(struct shm_ring *r, size_t len)
+{
+	r->head += SHM_ROUND(SHM_RING_RECORD + (uint64_t)len);
+	r->records++;
+	atomic_store_explicit(&r->hdr->records, r->records,
+	    memory_order_relaxed);
+	atomic_store_explicit(&r->hdr->head, r->head, memory_order_release);
+}
+
+/*
+ * Put a packet in the ring, as a savefile record; return -1 if it was
+ * dropped for want of room.  With nanosecond time stamps, libpcap has
+ * already put nanoseconds in tv_usec.
+ */
+int
+shm_ring_put_packet(struct shm_ring *r, const struct pcap_pkthdr *h,
+    const u_char *sp)
+{
+	struct shm_ring_packet ph;
+	size_t len;
+	u_char *p;
+
+	len = sizeof(ph) + h->caplen;
+	p = ring_reserve(r, SHM_RING_PACKET, len);
+	if (p == NULL)
+		return (-1);
+	ph.ts_sec = (uint32_t)h->ts.tv_sec;
+	ph.ts_frac = (uint32_t)h->ts.tv_usec;
+	ph.caplen = h->caplen;
+	ph.len = h->len;
+	memcpy(p, &ph, sizeof(ph));
+	memcpy(p + sizeof(ph), sp, h->caplen);
+	ring_publish(r, len);
+	return (0);
+}
+
+/*
+ * Put printed output in the ring; return -1 if it was dropped.
+ */
+int
+shm_ring_put_text(struct shm_ring *r, const char *buf, size_t len)
+{
+	u_char *p;
+
+	p = ring_reserve(r, SHM_RING_TEXT, len);
+	if (p == NULL)
+		return (-1);
+	memcpy(p, buf, len);
+	ring_publish(r, len);
+	return (0);
+}
+
+void
+shm_ring_stats(struct shm_ring *r, struct shm_ring_stats *srs)
+{
+	srs->srs_size = r->size;
+	srs->srs_used = r->head - atomic_load_explicit(&r->hdr->tail,
+	    memory_order_acquire);
+	srs->srs_records = r->records;
+	srs->srs_dropped = r->dropped;
+}
+
+/*
+ * Tell the reader there'll be no more, and unmap the ring, leaving the
+ * object for the reader to finish with.
+ */
+void
+shm_ring_close(struct shm_ring *r)
+{
+	atomic_store_explicit(&r->hdr->finished, 1, memory_order_release);
+	(void)munmap((void *)r->hdr, r->maplen);
+	free(r);
+}
+#endif /* SHM_RING_SUPPORTED */
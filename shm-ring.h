@@ -0,0 +1,93 @@
+/*
+ * Copyright (c) 2026 The TCPDUMP project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that: (1) source code
+ * distributions retain the above copyright notice and this paragraph
+ * in its entirety, and (2) distributions including binary code include
+ * the above copyright notice and this paragraph in its entirety in
+ * the documentation or other materials provided with the distribution.
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND
+ * WITHOUT ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, WITHOUT
+ * LIMITATION, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE.
+ */
+
+/*
+ * A ring in POSIX shared memory, for -w shm:name and --shm-output, that
+ * a program on the same machine maps and reads in place, rather than
+ * reading a copy of the output from a pipe.  There's one writer,
+ * tcpdump, and one reader, which gives the room back as it goes; the
+ * writer never waits for it, and records that don't fit are dropped
+ * and counted.
+ *
+ * The layout, which readers depend on; all the numbers are in the
+ * byte order of the machine, and offsets are in bytes:
+ *
+ *	0	uint32	SHM_RING_MAGIC
+ *	4	uint32	SHM_RING_VERSION
+ *	8	uint32	SHM_RING_HEADER_SIZE, where the data starts
+ *	12	uint32	SHM_RING_PACKETS or SHM_RING_OUTPUT
+ *	16	uint64	size of the data area, a power of 2
+ *	24	uint32	link-layer header type (LINKTYPE_), for packets
+ *	28	uint32	snapshot length, for packets
+ *	32	uint32	time stamp units per second, 1000000 or 1000000000
+ *	36	uint32	process ID of the writer
+ *	40	uint32	nonzero once the writer has finished
+ *	64	uint64	head: bytes written since the start, set by the writer
+ *	128	uint64	tail: bytes read since the start, set by the reader
+ *	192	uint64	records written
+ *	200	uint64	records dropped, for want of room
+ *
+ * Record at byte "tail % size" of the data area, if tail != head, is
+ * the next to read.  Records start on an 8-byte boundary, with a
+ * 32-bit type and a 32-bit length of what follows, not counting the
+ * padding to the next boundary; they never wrap around the end of the
+ * data area, but a SHM_RING_PAD record comes first, filling up the rest
+ * of it, if there isn't room there.  A SHM_RING_PACKET record holds a
+ * packet record as in a pcap savefile: 32-bit seconds, fraction in the
+ * units above, captured length and length, then the data; a
+ * SHM_RING_TEXT record is the output printed for one packet (or up to
+ * ND_OUTBUF_SIZE bytes of it), text, JSON or --field-output.
+ *
+ * Head and tail are only ever added to.  The reader loads head with
+ * acquire semantics, reads the records up to it in place and then
+ * stores the new tail with release semantics, which gives the room
+ * back; it polls head to find out about more.
+ */
+#if !defined(_WIN32) && defined(HAVE_SHM_OPEN) && \
+    defined(HAVE_STDATOMIC_H) && !defined(__STDC_NO_ATOMICS__)
+#define SHM_RING_SUPPORTED
+
+#define SHM_RING_MAGIC		0x54445247U	/* "TDRG" */
+#define SHM_RING_VERSION	1
+#define SHM_RING_HEADER_SIZE	4096
+
+#define SHM_RING_PACKETS	1		/* -w shm:name */
+#define SHM_RING_OUTPUT		2		/* --shm-output */
+
+#define SHM_RING_PAD		0		/* record types */
+#define SHM_RING_PACKET		1
+#define SHM_RING_TEXT		2
+
+#define SHM_RING_MIN_SIZE	(64 * 1024)
+
+struct shm_ring;
+
+struct shm_ring_stats {
+	uint64_t srs_size;
+	uint64_t srs_used;		/* bytes not yet read */
+	uint64_t srs_records;
+	uint64_t srs_dropped;
+};
+
+extern int shm_ring_url(const char *);
+extern struct shm_ring *shm_ring_create(const char *, u_int, size_t,
+    int, u_int, u_int, char *);
+extern int shm_ring_put_packet(struct shm_ring *, const struct pcap_pkthdr *,
+    const u_char *);
+extern int shm_ring_put_text(struct shm_ring *, const char *, size_t);
+extern void shm_ring_stats(struct shm_ring *, struct shm_ring_stats *);
+extern void shm_ring_close(struct shm_ring *);
+#endif
@@ -42,15 +42,28 @@ const struct tok signature_check_values[] = {
 
 #ifdef HAVE_LIBCRYPTO
 /*
- * Compute a HMAC MD5 sum.
+ * The HMAC MD5 state for a key, with the padded key already hashed
+ * into the inner and outer contexts, so that a signature costs only
+ * the hashing of the text and of the inner digest.  It's computed
+ * once for the -M secret being used and copied for each signature.
+ */
+struct signature_hmac_key {
+    const char *secret;		/* what it was computed for, or NULL */
+    MD5_CTX inner;
+    MD5_CTX outer;
+};
+
+static ND_THREAD_LOCAL struct signature_hmac_key signature_key;
+
+/*
+ * Set up "hk" for the key "key".
  * Taken from rfc2104, Appendix.
  */
 USES_APPLE_DEPRECATED_API
 static void
-signature_compute_hmac_md5(const uint8_t *text, int text_len, unsigned char *key,
-                           unsigned int key_len, uint8_t *digest)
+signature_hmac_md5_key(struct signature_hmac_key *hk, const unsigned char *key,
+                       unsigned int key_len)
 {
-    MD5_CTX context;
     unsigned char k_ipad[65];    /* inner padding - key XORd with ipad */
     unsigned char k_opad[65];    /* outer padding - key XORd with opad */
     unsigned char tk[16];
@@ -92,19 +105,33 @@ signature_compute_hmac_md5(const uint8_t *text, int text_len, unsigned char *key
         k_opad[i] ^= 0x5c;
     }
 
+    MD5_Init(&hk->inner);                 /* init context for 1st pass */
+    MD5_Update(&hk->inner, k_ipad, 64);   /* start with inner pad */
+    MD5_Init(&hk->outer);                 /* init context for 2nd pass */
+    MD5_Update(&hk->outer, k_opad, 64);   /* start with outer pad */
+}
+
+/*
+ * Compute a HMAC MD5 sum with the key "hk".
+ */
+static void
+signature_compute_hmac_md5(const uint8_t *text, int text_len,
+                           const struct signature_hmac_key *hk,
+                           uint8_t *digest)
+{
+    MD5_CTX context;
+
     /*
      * perform inner MD5
      */
-    MD5_Init(&context);                   /* init context for 1st pass */
-    MD5_Update(&context, k_ipad, 64);     /* start with inner pad */
+    context = hk->inner;
     MD5_Update(&context, text, text_len); /* then text of datagram */
     MD5_Final(digest, &context);          /* finish up 1st pass */
 
     /*
      * perform outer MD5
      */
-    MD5_Init(&context);                   /* init context for 2nd pass */
-    MD5_Update(&context, k_opad, 64);     /* start with outer pad */
+    context = hk->outer;
     MD5_Update(&context, digest, 16);     /* then results of 1st hash */
     MD5_Final(digest, &context);          /* finish up 2nd pass */
 }
@@ -172,9 +199,13 @@ signature_verify(netdissect_options *ndo, const u_char *pptr, u_int plen,
     /*
      * Compute the signature.
      */
-    signature_compute_hmac_md5(packet_copy, plen,
-                               (unsigned char *)ndo->ndo_sigsecret,
-                               strlen(ndo->ndo_sigsecret), sig);
+    if (signature_key.secret != ndo->ndo_sigsecret) {
+        signature_hmac_md5_key(&signature_key,
+                               (const unsigned char *)ndo->ndo_sigsecret,
+                               (unsigned int)strlen(ndo->ndo_sigsecret));
+        signature_key.secret = ndo->ndo_sigsecret;
+    }
+    signature_compute_hmac_md5(packet_copy, plen, &signature_key, sig);
 
     /*
      * Free the copy.
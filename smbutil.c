@@ -22,8 +22,8 @@
 #include "extract.h"
 #include "smb.h"
 
-static int stringlen_is_set;
-static uint32_t stringlen;
+static ND_THREAD_LOCAL int stringlen_is_set;
+static ND_THREAD_LOCAL uint32_t stringlen;
 extern const u_char *startbuf;
 
 /*
@@ -141,7 +141,7 @@ name_interpret(netdissect_options *ndo,
                const u_char *in, const u_char *maxbuf, char *out)
 {
     int ret;
-    u_int len;
+    u_int len, avail;
 
     if (in >= maxbuf)
 	return(-1);	/* name goes past the end of the buffer */
@@ -154,17 +154,25 @@ name_interpret(netdissect_options *ndo,
     if (len > 30 || len == 0)
 	return(0);
 
+    /*
+     * Decode the pairs that were captured and are in the buffer
+     * directly, rather than checking each of them.
+     */
+    avail = (ndo->ndo_snapend > in) ? ND_BYTES_AVAILABLE_AFTER(in) : 0;
+    if (maxbuf <= in)
+	avail = 0;
+    else if (avail > ND_BYTES_BETWEEN(maxbuf, in))
+	avail = ND_BYTES_BETWEEN(maxbuf, in);
     while (len) {
-	ND_TCHECK_2(in);
-	if (in + 1 >= maxbuf)
+	if (avail < 2)
 	    return(-1);	/* name goes past the end of the buffer */
-	if (GET_U_1(in) < 'A' || GET_U_1(in) > 'P' ||
-	    GET_U_1(in + 1) < 'A' || GET_U_1(in + 1) > 'P') {
+	if (in[0] < 'A' || in[0] > 'P' || in[1] < 'A' || in[1] > 'P') {
 	    *out = 0;
 	    return(0);
 	}
-	*out = ((GET_U_1(in) - 'A') << 4) + (GET_U_1(in + 1) - 'A');
+	*out = ((in[0] - 'A') << 4) + (in[1] - 'A');
 	in += 2;
+	avail -= 2;
 	out++;
 	len--;
     }
@@ -337,12 +345,13 @@ trunc:
 
 static void
 write_bits(netdissect_options *ndo,
-           unsigned int val, const char *fmt)
+           unsigned int val, const char *fmt, u_int len)
 {
-    const char *p = fmt;
+    const char *p, *end = fmt + len;
     u_int i = 0;
 
-    while ((p = strchr(fmt, '|'))) {
+    while ((p = (const char *)memchr(fmt, '|',
+                                     ND_BYTES_BETWEEN(end, fmt)))) {
 	u_int l = ND_BYTES_BETWEEN(p, fmt);
 	if (l && (val & (1 << i)))
 	    ND_PRINT("%.*s ", (int)l, fmt);
@@ -353,12 +362,28 @@ write_bits(netdissect_options *ndo,
 
 /* convert a UCS-2 string into an ASCII string */
 #define MAX_UNISTR_SIZE	1000
+
+static void
+unistr_add(char (*buf)[MAX_UNISTR_SIZE+1], size_t *lp, u_int c)
+{
+    if (*lp < MAX_UNISTR_SIZE) {
+	if (ND_ASCII_ISPRINT(c)) {
+	    /* It's a printable ASCII character */
+	    (*buf)[*lp] = (char)c;
+	} else {
+	    /* It's a non-ASCII character or a non-printable ASCII character */
+	    (*buf)[*lp] = '.';
+	}
+	(*lp)++;
+    }
+}
+
 static const u_char *
 unistr(netdissect_options *ndo, char (*buf)[MAX_UNISTR_SIZE+1],
        const u_char *s, uint32_t strsize, int is_null_terminated,
        int use_unicode)
 {
-    u_int c;
+    u_int c, avail, i;
     size_t l = 0;
     const u_char *sp;
 
@@ -377,28 +402,37 @@ unistr(netdissect_options *ndo, char (*buf)[MAX_UNISTR_SIZE+1],
 	 * Find the length, counting the terminating NUL.
 	 */
 	strsize = 0;
-	sp = s;
+	avail = (ndo->ndo_snapend > s) ? ND_BYTES_AVAILABLE_AFTER(s) : 0;
 	if (!use_unicode) {
-	    for (;;) {
-		ND_TCHECK_1(sp);
-		c = GET_U_1(sp);
-		sp++;
-		strsize++;
-		if (c == '\0')
-		    break;
-	    }
+	    sp = (const u_char *)memchr(s, '\0', avail);
+	    if (sp == NULL)
+		goto trunc;	/* the NUL wasn't captured */
+	    strsize = ND_BYTES_BETWEEN(sp, s) + 1;
 	} else {
-	    for (;;) {
-		ND_TCHECK_2(sp);
-		c = GET_LE_U_2(sp);
-		sp += 2;
-		strsize += 2;
-		if (c == '\0')
+	    for (i = 0; i + 1 < avail; i += 2) {
+		if (EXTRACT_LE_U_2(s + i) == 0) {
+		    strsize = i + 2;
 		    break;
+		}
 	    }
+	    if (strsize == 0)
+		goto trunc;	/* the NUL wasn't captured */
 	}
     }
+    /*
+     * Convert the characters that were captured directly; the loops
+     * after that, which check each character, only have the end of
+     * the string, a null terminator and what follows it, or the end
+     * of the captured data, to deal with.
+     */
+    avail = (ndo->ndo_snapend > s) ? ND_BYTES_AVAILABLE_AFTER(s) : 0;
+    if (avail > strsize)
+	avail = strsize;
     if (!use_unicode) {
+	for (i = 0; i < avail && s[i] != 0; i++)
+	    unistr_add(buf, &l, s[i]);
+	s += i;
+	strsize -= i;
     	while (strsize != 0) {
 	    ND_TCHECK_1(s);
 	    c = GET_U_1(s);
@@ -419,18 +453,17 @@ unistr(netdissect_options *ndo, char (*buf)[MAX_UNISTR_SIZE+1],
 		strsize = 0;
 		break;
 	    }
-	    if (l < MAX_UNISTR_SIZE) {
-		if (ND_ASCII_ISPRINT(c)) {
-		    /* It's a printable ASCII character */
-		    (*buf)[l] = (char)c;
-		} else {
-		    /* It's a non-ASCII character or a non-printable ASCII character */
-		    (*buf)[l] = '.';
-		}
-		l++;
-	    }
+	    unistr_add(buf, &l, c);
 	}
     } else {
+	for (i = 0; i + 1 < avail; i += 2) {
+	    c = EXTRACT_LE_U_2(s + i);
+	    if (c == 0)
+		break;
+	    unistr_add(buf, &l, c);
+	}
+	s += i;
+	strsize -= i;
 	while (strsize > 1) {
 	    ND_TCHECK_2(s);
 	    c = GET_LE_U_2(s);
@@ -451,16 +484,7 @@ unistr(netdissect_options *ndo, char (*buf)[MAX_UNISTR_SIZE+1],
 		strsize = 0;
 		break;
 	    }
-	    if (l < MAX_UNISTR_SIZE) {
-		if (ND_ASCII_ISPRINT(c)) {
-		    /* It's a printable ASCII character */
-		    (*buf)[l] = (char)c;
-		} else {
-		    /* It's a non-ASCII character or a non-printable ASCII character */
-		    (*buf)[l] = '.';
-		}
-		l++;
-	    }
+	    unistr_add(buf, &l, c);
 	}
 	if (strsize == 1) {
 	    /* We have half of a code point; skip past it */
@@ -476,65 +500,80 @@ trunc:
     return NULL;
 }
 
+/*
+ * The formats given to smb_fdata() are parsed into an array of these,
+ * once, rather than every time they are used.  An operation is one of
+ * the formatting characters, with fo_sub the character after an 'l'
+ * and fo_num the number after a 'P', 's', 'c', 'h', 'n' or 'T'; a '{'
+ * with the bits named by fo_str and fo_len; or FOP_TEXT, for text to
+ * print as it is.  A '[' has the operations of the item in the
+ * brackets after it, fo_num of them, or -1 if the item is too long.
+ */
+struct smb_fop {
+    u_char fo_op;
+    u_char fo_sub;
+    int fo_num;
+    const char *fo_str;
+    u_int fo_len;
+};
+
+#define FOP_TEXT	0
+
+struct smb_fdesc {
+    const char *fd_fmt;
+    struct smb_fop *fd_ops;
+    const struct smb_fop *fd_end;
+    struct smb_fdesc *fd_next;		/* on its hash chain */
+};
+
+#define SMB_FDESC_CHAINS	256
+#define SMB_FMT_ITEM_LEN	128	/* longest item in brackets, with a NUL */
+
+/* The formatting characters of an item in square brackets. */
+static const char smb_fchars[] = "aA{PrbdDLuUMBwWlSRZYscChnT";
+
+/*
+ * Dissect an item, the operations "op" up to "end" that were in square
+ * brackets in the format.
+ */
 static const u_char *
 smb_fdata1(netdissect_options *ndo,
-           const u_char *buf, const char *fmt, const u_char *maxbuf,
-           int unicodestr)
+           const u_char *buf, const struct smb_fop *op,
+           const struct smb_fop *end, const u_char *maxbuf, int unicodestr)
 {
     int reverse = 0;
-    const char *attrib_fmt = "READONLY|HIDDEN|SYSTEM|VOLUME|DIR|ARCHIVE|";
+    static const char attrib_fmt[] = "READONLY|HIDDEN|SYSTEM|VOLUME|DIR|ARCHIVE|";
     char strbuf[MAX_UNISTR_SIZE+1];
 
-    while (*fmt && buf<maxbuf) {
-	switch (*fmt) {
+    for (; op < end && buf<maxbuf; op++) {
+	switch (op->fo_op) {
 	case 'a':
 	    ND_TCHECK_1(buf);
-	    write_bits(ndo, GET_U_1(buf), attrib_fmt);
+	    write_bits(ndo, GET_U_1(buf), attrib_fmt, sizeof(attrib_fmt) - 1);
 	    buf++;
-	    fmt++;
 	    break;
 
 	case 'A':
 	    ND_TCHECK_2(buf);
-	    write_bits(ndo, GET_LE_U_2(buf), attrib_fmt);
+	    write_bits(ndo, GET_LE_U_2(buf), attrib_fmt, sizeof(attrib_fmt) - 1);
 	    buf += 2;
-	    fmt++;
 	    break;
 
 	case '{':
-	  {
-	    char bitfmt[128];
-	    char *p;
-	    u_int l;
-
-	    p = strchr(++fmt, '}');
-	    l = ND_BYTES_BETWEEN(p, fmt);
-
-	    if (l > sizeof(bitfmt) - 1)
-		l = sizeof(bitfmt)-1;
-
-	    strncpy(bitfmt, fmt, l);
-	    bitfmt[l] = '\0';
-	    fmt = p + 1;
 	    ND_TCHECK_1(buf);
-	    write_bits(ndo, GET_U_1(buf), bitfmt);
+	    write_bits(ndo, GET_U_1(buf), op->fo_str, op->fo_len);
 	    buf++;
 	    break;
-	  }
 
 	case 'P':
 	  {
-	    int l = atoi(fmt + 1);
+	    int l = op->fo_num;
 	    ND_TCHECK_LEN(buf, l);
 	    buf += l;
-	    fmt++;
-	    while (ND_ASCII_ISDIGIT(*fmt))
-		fmt++;
 	    break;
 	  }
 	case 'r':
 	    reverse = !reverse;
-	    fmt++;
 	    break;
 	case 'b':
 	  {
@@ -543,7 +582,6 @@ smb_fdata1(netdissect_options *ndo,
 	    x = GET_U_1(buf);
 	    ND_PRINT("%u (0x%x)", x, x);
 	    buf += 1;
-	    fmt++;
 	    break;
 	  }
 	case 'd':
@@ -554,7 +592,6 @@ smb_fdata1(netdissect_options *ndo,
 			  GET_LE_S_2(buf);
 	    ND_PRINT("%d (0x%x)", x, x);
 	    buf += 2;
-	    fmt++;
 	    break;
 	  }
 	case 'D':
@@ -565,7 +602,6 @@ smb_fdata1(netdissect_options *ndo,
 			  GET_LE_S_4(buf);
 	    ND_PRINT("%d (0x%x)", x, x);
 	    buf += 4;
-	    fmt++;
 	    break;
 	  }
 	case 'L':
@@ -576,7 +612,6 @@ smb_fdata1(netdissect_options *ndo,
 			  GET_LE_U_8(buf);
 	    ND_PRINT("%" PRIu64 " (0x%" PRIx64 ")", x, x);
 	    buf += 8;
-	    fmt++;
 	    break;
 	  }
 	case 'u':
@@ -587,7 +622,6 @@ smb_fdata1(netdissect_options *ndo,
 			  GET_LE_U_2(buf);
 	    ND_PRINT("%u (0x%x)", x, x);
 	    buf += 2;
-	    fmt++;
 	    break;
 	  }
 	case 'U':
@@ -598,7 +632,6 @@ smb_fdata1(netdissect_options *ndo,
 			  GET_LE_U_4(buf);
 	    ND_PRINT("%u (0x%x)", x, x);
 	    buf += 4;
-	    fmt++;
 	    break;
 	  }
 	case 'M':
@@ -614,7 +647,6 @@ smb_fdata1(netdissect_options *ndo,
 	    x = (((uint64_t)x1) << 32) | x2;
 	    ND_PRINT("%" PRIu64 " (0x%" PRIx64 ")", x, x);
 	    buf += 8;
-	    fmt++;
 	    break;
 	  }
 	case 'B':
@@ -624,7 +656,6 @@ smb_fdata1(netdissect_options *ndo,
 	    x = GET_U_1(buf);
 	    ND_PRINT("0x%X", x);
 	    buf += 1;
-	    fmt++;
 	    break;
 	  }
 	case 'w':
@@ -635,7 +666,6 @@ smb_fdata1(netdissect_options *ndo,
 			  GET_LE_U_2(buf);
 	    ND_PRINT("0x%X", x);
 	    buf += 2;
-	    fmt++;
 	    break;
 	  }
 	case 'W':
@@ -646,13 +676,11 @@ smb_fdata1(netdissect_options *ndo,
 			  GET_LE_U_4(buf);
 	    ND_PRINT("0x%X", x);
 	    buf += 4;
-	    fmt++;
 	    break;
 	  }
 	case 'l':
 	  {
-	    fmt++;
-	    switch (*fmt) {
+	    switch (op->fo_sub) {
 
 	    case 'b':
 		ND_TCHECK_1(buf);
@@ -682,18 +710,16 @@ smb_fdata1(netdissect_options *ndo,
 		buf += 4;
 		break;
 	    }
-	    fmt++;
 	    break;
 	  }
 	case 'S':
 	case 'R':	/* like 'S', but always ASCII */
 	  {
 	    /*XXX unistr() */
-	    buf = unistr(ndo, &strbuf, buf, 0, 1, (*fmt == 'R') ? 0 : unicodestr);
+	    buf = unistr(ndo, &strbuf, buf, 0, 1, (op->fo_op == 'R') ? 0 : unicodestr);
 	    ND_PRINT("%s", strbuf);
 	    if (buf == NULL)
 		goto trunc;
-	    fmt++;
 	    break;
 	  }
 	case 'Z':
@@ -704,22 +730,18 @@ smb_fdata1(netdissect_options *ndo,
 		ND_PRINT("Error! ASCIIZ buffer of type %u", GET_U_1(buf));
 		return maxbuf;	/* give up */
 	    }
-	    buf = unistr(ndo, &strbuf, buf + 1, 0, 1, (*fmt == 'Y') ? 0 : unicodestr);
+	    buf = unistr(ndo, &strbuf, buf + 1, 0, 1, (op->fo_op == 'Y') ? 0 : unicodestr);
 	    ND_PRINT("%s", strbuf);
 	    if (buf == NULL)
 		goto trunc;
-	    fmt++;
 	    break;
 	  }
 	case 's':
 	  {
-	    int l = atoi(fmt + 1);
+	    int l = op->fo_num;
 	    ND_TCHECK_LEN(buf, l);
 	    ND_PRINT("%-*.*s", l, l, buf);
 	    buf += l;
-	    fmt++;
-	    while (ND_ASCII_ISDIGIT(*fmt))
-		fmt++;
 	    break;
 	  }
 	case 'c':
@@ -731,9 +753,6 @@ smb_fdata1(netdissect_options *ndo,
 	    ND_TCHECK_LEN(buf, stringlen);
 	    ND_PRINT("%-*.*s", (int)stringlen, (int)stringlen, buf);
 	    buf += stringlen;
-	    fmt++;
-	    while (ND_ASCII_ISDIGIT(*fmt))
-		fmt++;
 	    break;
 	  }
 	case 'C':
@@ -746,25 +765,21 @@ smb_fdata1(netdissect_options *ndo,
 	    ND_PRINT("%s", strbuf);
 	    if (buf == NULL)
 		goto trunc;
-	    fmt++;
 	    break;
 	  }
 	case 'h':
 	  {
-	    int l = atoi(fmt + 1);
+	    int l = op->fo_num;
 	    ND_TCHECK_LEN(buf, l);
 	    while (l--) {
 		ND_PRINT("%02x", GET_U_1(buf));
 		buf++;
 	    }
-	    fmt++;
-	    while (ND_ASCII_ISDIGIT(*fmt))
-		fmt++;
 	    break;
 	  }
 	case 'n':
 	  {
-	    int t = atoi(fmt+1);
+	    int t = op->fo_num;
 	    char nbuf[255];
 	    int name_type;
 	    int len;
@@ -790,19 +805,17 @@ smb_fdata1(netdissect_options *ndo,
 		buf += 16;
 		break;
 	    }
-	    fmt++;
-	    while (ND_ASCII_ISDIGIT(*fmt))
-		fmt++;
 	    break;
 	  }
 	case 'T':
 	  {
 	    time_t t;
-	    struct tm *lt;
+	    struct tm tmbuf, *lt;
+	    char tbuf[sizeof("Thu Jan  1 00:00:00 1970\n")];
 	    const char *tstring;
 	    uint32_t x;
 
-	    switch (atoi(fmt + 1)) {
+	    switch (op->fo_num) {
 	    case 1:
 		ND_TCHECK_4(buf);
 		x = GET_LE_U_4(buf);
@@ -831,27 +844,25 @@ smb_fdata1(netdissect_options *ndo,
 		break;
 	    }
 	    if (t != 0) {
-		lt = localtime(&t);
-		if (lt != NULL)
-		    tstring = asctime(lt);
+		lt = nd_localtime(&t, &tmbuf);
+		/* as asctime() has it, without its static buffer */
+		if (lt != NULL && strftime(tbuf, sizeof(tbuf),
+		    "%a %b %e %H:%M:%S %Y\n", lt) != 0)
+		    tstring = tbuf;
 		else
 		    tstring = "(Can't convert time)\n";
 	    } else
 		tstring = "NULL\n";
 	    ND_PRINT("%s", tstring);
-	    fmt++;
-	    while (ND_ASCII_ISDIGIT(*fmt))
-		fmt++;
 	    break;
 	  }
 	default:
-	    ND_PRINT("%c", *fmt);
-	    fmt++;
+	    ND_PRINT("%.*s", (int)op->fo_len, op->fo_str);
 	    break;
 	}
     }
 
-    if (buf >= maxbuf && *fmt)
+    if (buf >= maxbuf && op < end)
 	ND_PRINT("END OF BUFFER\n");
 
     return(buf);
@@ -861,24 +872,25 @@ trunc:
     return(NULL);
 }
 
-const u_char *
-smb_fdata(netdissect_options *ndo,
-          const u_char *buf, const char *fmt, const u_char *maxbuf,
-          int unicodestr)
+/*
+ * Dissect "buf" as described by the operations "op" up to "end".
+ */
+static const u_char *
+smb_fdata_ops(netdissect_options *ndo,
+              const u_char *buf, const struct smb_fop *op,
+              const struct smb_fop *end, const u_char *maxbuf, int unicodestr)
 {
-    static int depth = 0;
-    char s[128];
-    char *p;
+    static ND_THREAD_LOCAL int depth = 0;
 
-    while (*fmt) {
-	switch (*fmt) {
+    while (op < end) {
+	switch (op->fo_op) {
 	case '*':
 	    /*
 	     * List of multiple instances of something described by the
 	     * remainder of the string (which may itself include a list
 	     * of multiple instances of something, so we recurse).
 	     */
-	    fmt++;
+	    op++;
 	    while (buf < maxbuf) {
 		const u_char *buf2;
 		depth++;
@@ -892,7 +904,8 @@ smb_fdata(netdissect_options *ndo,
 			ND_PRINT("(too many nested levels, not recursing)");
 			buf2 = buf;
 		} else
-			buf2 = smb_fdata(ndo, buf, fmt, maxbuf, unicodestr);
+			buf2 = smb_fdata_ops(ndo, buf, op, end, maxbuf,
+			    unicodestr);
 		depth--;
 		if (buf2 == NULL)
 		    return(NULL);
@@ -906,7 +919,7 @@ smb_fdata(netdissect_options *ndo,
 	    /*
 	     * Just do a bounds check.
 	     */
-	    fmt++;
+	    op++;
 	    if (buf >= maxbuf)
 		return(buf);
 	    break;
@@ -915,7 +928,7 @@ smb_fdata(netdissect_options *ndo,
 	    /*
 	     * XXX - unused?
 	     */
-	    fmt++;
+	    op++;
 	    buf = maxbuf;
 	    break;
 
@@ -923,28 +936,22 @@ smb_fdata(netdissect_options *ndo,
 	    /*
 	     * Done?
 	     */
-	    fmt++;
 	    return(buf);
-	    break;
 
 	case '[':
 	    /*
 	     * Format of an item, enclosed in square brackets; dissect
 	     * the item with smb_fdata1().
 	     */
-	    fmt++;
 	    if (buf >= maxbuf)
 		return(buf);
-	    memset(s, 0, sizeof(s));
-	    p = strchr(fmt, ']');
-	    if ((size_t)(p - fmt + 1) > sizeof(s)) {
+	    if (op->fo_num < 0) {
 		/* overrun */
 		return(buf);
 	    }
-	    strncpy(s, fmt, p - fmt);
-	    s[p - fmt] = '\0';
-	    fmt = p + 1;
-	    buf = smb_fdata1(ndo, buf, s, maxbuf, unicodestr);
+	    buf = smb_fdata1(ndo, buf, op + 1, op + 1 + op->fo_num, maxbuf,
+	        unicodestr);
+	    op += 1 + op->fo_num;
 	    if (buf == NULL) {
 		/*
 		 * Truncated.
@@ -952,7 +959,7 @@ smb_fdata(netdissect_options *ndo,
 		 * If so, print it before quitting, so we don't
 		 * get stuff in the middle of the line.
 		 */
-		if (*fmt == '\n')
+		if (op < end && op->fo_op == FOP_TEXT && op->fo_str[0] == '\n')
 		    ND_PRINT("\n");
 		return(NULL);
 	    }
@@ -962,8 +969,8 @@ smb_fdata(netdissect_options *ndo,
 	    /*
 	     * Not a formatting character, so just print it.
 	     */
-	    ND_PRINT("%c", *fmt);
-	    fmt++;
+	    ND_PRINT("%.*s", (int)op->fo_len, op->fo_str);
+	    op++;
 	    break;
 	}
     }
@@ -976,6 +983,162 @@ smb_fdata(netdissect_options *ndo,
     return(buf);
 }
 
+/*
+ * Parse the item from "fmt" up to "end", the inside of square brackets,
+ * into operations at "op"; return a pointer past the last of them.
+ */
+static struct smb_fop *
+smb_fcompile1(struct smb_fop *op, const char *fmt, const char *end)
+{
+    const char *p;
+
+    while (fmt < end) {
+	op->fo_op = (u_char)*fmt;
+	op->fo_sub = 0;
+	op->fo_num = 0;
+	op->fo_str = NULL;
+	op->fo_len = 0;
+	switch (*fmt) {
+	case '{':
+	    fmt++;
+	    p = (const char *)memchr(fmt, '}', ND_BYTES_BETWEEN(end, fmt));
+	    if (p == NULL)
+		p = end;
+	    op->fo_str = fmt;
+	    op->fo_len = ND_BYTES_BETWEEN(p, fmt);
+	    if (op->fo_len > SMB_FMT_ITEM_LEN - 1)
+		op->fo_len = SMB_FMT_ITEM_LEN - 1;
+	    fmt = (p < end) ? p + 1 : end;
+	    break;
+
+	case 'P':
+	case 's':
+	case 'c':
+	case 'h':
+	case 'n':
+	case 'T':
+	    fmt++;
+	    while (fmt < end && ND_ASCII_ISDIGIT(*fmt)) {
+		op->fo_num = op->fo_num * 10 + (*fmt - '0');
+		fmt++;
+	    }
+	    break;
+
+	case 'l':
+	    fmt++;
+	    if (fmt < end) {
+		op->fo_sub = (u_char)*fmt;
+		fmt++;
+	    }
+	    break;
+
+	default:
+	    if (strchr(smb_fchars, *fmt) != NULL) {
+		fmt++;
+		break;
+	    }
+	    /* Text to print, up to the next formatting character. */
+	    op->fo_op = FOP_TEXT;
+	    op->fo_str = fmt;
+	    while (fmt < end && strchr(smb_fchars, *fmt) == NULL)
+		fmt++;
+	    op->fo_len = ND_BYTES_BETWEEN(fmt, op->fo_str);
+	    break;
+	}
+	op++;
+    }
+    return(op);
+}
+
+/*
+ * Parse "fmt" into the operations it describes.
+ */
+static struct smb_fdesc *
+smb_fcompile(netdissect_options *ndo, const char *fmt)
+{
+    struct smb_fdesc *fd;
+    struct smb_fop *op, *item;
+    const char *p;
+
+    fd = (struct smb_fdesc *)calloc(1, sizeof(*fd));
+    if (fd == NULL)
+	(*ndo->ndo_error)(ndo, S_ERR_ND_MEM_ALLOC, "%s: calloc", __func__);
+    /* Every operation takes up at least one character of the format. */
+    fd->fd_ops = (struct smb_fop *)calloc(strlen(fmt) + 1,
+        sizeof(*fd->fd_ops));
+    if (fd->fd_ops == NULL)
+	(*ndo->ndo_error)(ndo, S_ERR_ND_MEM_ALLOC, "%s: calloc", __func__);
+    fd->fd_fmt = fmt;
+
+    op = fd->fd_ops;
+    while (*fmt) {
+	op->fo_op = (u_char)*fmt;
+	switch (*fmt) {
+	case '*':
+	case '|':
+	case '%':
+	case '#':
+	    fmt++;
+	    op++;
+	    break;
+
+	case '[':
+	    fmt++;
+	    p = strchr(fmt, ']');
+	    if (p == NULL || (size_t)(p - fmt + 1) > SMB_FMT_ITEM_LEN) {
+		/* overrun; nothing after this is dissected */
+		op->fo_num = -1;
+		op++;
+		goto done;
+	    }
+	    item = op;
+	    op = smb_fcompile1(op + 1, fmt, p);
+	    item->fo_num = (int)(op - item - 1);
+	    fmt = p + 1;
+	    break;
+
+	default:
+	    op->fo_op = FOP_TEXT;
+	    op->fo_str = fmt;
+	    while (*fmt && strchr("*|%#[", *fmt) == NULL)
+		fmt++;
+	    op->fo_len = ND_BYTES_BETWEEN(fmt, op->fo_str);
+	    op++;
+	    break;
+	}
+    }
+done:
+    fd->fd_end = op;
+    return(fd);
+}
+
+/*
+ * Dissect "buf", up to "maxbuf", as described by "fmt", which must be a
+ * string constant; the format is parsed the first time it is used, and
+ * the result is kept for this thread.
+ */
+const u_char *
+smb_fdata(netdissect_options *ndo,
+          const u_char *buf, const char *fmt, const u_char *maxbuf,
+          int unicodestr)
+{
+    static ND_THREAD_LOCAL struct smb_fdesc *smb_fdescs[SMB_FDESC_CHAINS];
+    struct smb_fdesc *fd, **fdp;
+
+    fdp = &smb_fdescs[((u_int)((uintptr_t)fmt * 0x9e3779b1U) >> 16) %
+        SMB_FDESC_CHAINS];
+    for (fd = *fdp; fd != NULL; fd = fd->fd_next)
+	if (fd->fd_fmt == fmt)
+	    break;
+    if (fd == NULL) {
+	fd = smb_fcompile(ndo, fmt);
+	fd->fd_next = *fdp;
+	*fdp = fd;
+    }
+    return(smb_fdata_ops(ndo, buf, fd->fd_ops, fd->fd_end, maxbuf,
+        unicodestr));
+}
+
 typedef struct {
     const char *name;
     int code;
@@ -1096,7 +1259,7 @@ static const struct {
 const char *
 smb_errstr(int class, int num)
 {
-    static char ret[128];
+    static ND_THREAD_LOCAL char ret[128];
     int i, j;
 
     ret[0] = 0;
@@ -1988,7 +2151,7 @@ static const nt_err_code_struct nt_errors[] = {
 const char *
 nt_errstr(uint32_t err)
 {
-    static char ret[128];
+    static ND_THREAD_LOCAL char ret[128];
     int i;
 
     ret[0] = 0;
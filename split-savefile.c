@@ -0,0 +1,364 @@
+/*
+ * Copyright (c) 2026 The TCPDUMP project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that: (1) source code
+ * distributions retain the above copyright notice and this paragraph
+ * in its entirety, and (2) distributions including binary code include
+ * the above copyright notice and this paragraph in its entirety in
+ * the documentation or other materials provided with the distribution.
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND
+ * WITHOUT ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, WITHOUT
+ * LIMITATION, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE.
+ */
+
+/*
+ * Each key seen gets a struct split_file, found through a hash of the
+ * key and kept until the end; the open ones are also on a list in the
+ * order they were last written to, so that the one at the tail is the
+ * one to close when another has to be opened.  A file that's been
+ * closed that way is reopened for appending, so it only ever gets the
+ * file header once.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include "netdissect-stdinc.h"
+
+#include <errno.h>
+#include <limits.h>
+#include <pcap.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "split-savefile.h"
+
+#define SPLIT_CHAINS		1024	/* a power of 2 */
+#define SPLIT_HEADER_MAX	64	/* bytes of file header */
+
+/*
+ * The per-packet record header, as written by pcap_dump().
+ */
+struct split_sf_pkthdr {
+	uint32_t	tv_sec;
+	uint32_t	tv_usec;	/* or nanoseconds */
+	uint32_t	caplen;
+	uint32_t	len;
+};
+
+struct split_file {
+	struct split_file *next;	/* on the hash chain */
+	struct split_file *newer;	/* on the list of open files */
+	struct split_file *older;
+	uint32_t key;
+	FILE	*f;			/* NULL if not open */
+	int	created;		/* the header's been written */
+};
+
+struct split_savefile {
+	char	*base;			/* -w name up to its extension */
+	const char *ext;		/* the extension, or "" */
+	const char *tag;
+	u_char	header[SPLIT_HEADER_MAX];
+	size_t	hdrlen;
+	struct split_file *chains[SPLIT_CHAINS];
+	struct split_file *newest;	/* the open files */
+	struct split_file *oldest;
+	u_int	maxopen;
+	struct split_savefile_stats stats;
+};
+
+static u_int
+split_hash(uint32_t key)
+{
+	key ^= key >> 16;
+	key *= 0x85ebca6bU;
+	key ^= key >> 13;
+	return (key & (SPLIT_CHAINS - 1));
+}
+
+static void
+split_unlink(struct split_savefile *ssf, struct split_file *sf)
+{
+	if (sf->newer != NULL)
+		sf->newer->older = sf->older;
+	else
+		ssf->newest = sf->older;
+	if (sf->older != NULL)
+		sf->older->newer = sf->newer;
+	else
+		ssf->oldest = sf->newer;
+	sf->newer = sf->older = NULL;
+}
+
+static void
+split_link(struct split_savefile *ssf, struct split_file *sf)
+{
+	sf->newer = NULL;
+	sf->older = ssf->newest;
+	if (ssf->newest != NULL)
+		ssf->newest->newer = sf;
+	else
+		ssf->oldest = sf;
+	ssf->newest = sf;
+}
+
+static void
+split_name(const struct split_savefile *ssf, uint32_t key, char *name,
+    size_t size)
+{
+	(void)snprintf(name, size, "%s.%s%u%s", ssf->base, ssf->tag, key,
+	    ssf->ext);
+}
+
+/*
+ * Put the name of the file for "key" and errno's message in errbuf;
+ * if they don't both fit, the directory and base name are left out.
+ */
+static void
+split_error(const struct split_savefile *ssf, uint32_t key, char *errbuf)
+{
+	char name[PATH_MAX];
+	int err = errno;
+
+	split_name(ssf, key, name, sizeof(name));
+	if (snprintf(errbuf, PCAP_ERRBUF_SIZE, "%s: %s", name,
+	    strerror(err)) >= PCAP_ERRBUF_SIZE)
+		(void)snprintf(errbuf, PCAP_ERRBUF_SIZE, "....%s%u%s: %s",
+		    ssf->tag, key, ssf->ext, strerror(err));
+}
+
+static int
+split_close_file(struct split_savefile *ssf, struct split_file *sf,
+    char *errbuf)
+{
+	int ret;
+
+	split_unlink(ssf, sf);
+	ret = fclose(sf->f);
+	sf->f = NULL;
+	ssf->stats.sss_open--;
+	if (ret == EOF) {
+		split_error(ssf, sf->key, errbuf);
+		return (-1);
+	}
+	return (0);
+}
+
+/*
+ * Open the file for sf, closing the one written to least recently if
+ * there are too many open, and write the file header if it's new.
+ */
+static int
+split_open_file(struct split_savefile *ssf, struct split_file *sf,
+    char *errbuf)
+{
+	char name[PATH_MAX];
+
+	if (ssf->stats.sss_open == ssf->maxopen &&
+	    split_close_file(ssf, ssf->oldest, errbuf) == -1)
+		return (-1);
+	split_name(ssf, sf->key, name, sizeof(name));
+	sf->f = fopen(name, sf->created ? "ab" : "wb");
+	if (sf->f == NULL) {
+		split_error(ssf, sf->key, errbuf);
+		return (-1);
+	}
+	(void)setvbuf(sf->f, NULL, _IOFBF, SPLIT_SAVEFILE_BUFSIZE);
+	split_link(ssf, sf);
+	ssf->stats.sss_open++;
+	if (sf->created)
+		ssf->stats.sss_reopens++;
+	else {
+		ssf->stats.sss_files++;
+		if (fwrite(ssf->header, 1, ssf->hdrlen, sf->f) != ssf->hdrlen) {
+			split_error(ssf, sf->key, errbuf);
+			return (-1);
+		}
+		sf->created = 1;
+	}
+	return (0);
+}
+
+/*
+ * Set up the split savefiles for the packets from p, named after the
+ * -w file "fname" and "tag", with at most "maxopen" open at once.  On
+ * failure, return NULL with a message in errbuf, which must be
+ * PCAP_ERRBUF_SIZE bytes.
+ */
+struct split_savefile *
+split_savefile_open(pcap_t *p, const char *fname, const char *tag,
+    u_int maxopen, char *errbuf)
+{
+	struct split_savefile *ssf;
+	pcap_dumper_t *pdd;
+	const char *slash, *dot;
+	FILE *fp;
+	long len;
+
+	ssf = (struct split_savefile *)calloc(1, sizeof(*ssf));
+	if (ssf == NULL) {
+		snprintf(errbuf, PCAP_ERRBUF_SIZE, "calloc: %s",
+		    strerror(errno));
+		return (NULL);
+	}
+	ssf->base = strdup(fname);
+	if (ssf->base == NULL) {
+		snprintf(errbuf, PCAP_ERRBUF_SIZE, "strdup: %s",
+		    strerror(errno));
+		free(ssf);
+		return (NULL);
+	}
+	slash = strrchr(fname, '/');
+	dot = strrchr(slash != NULL ? slash + 1 : fname, '.');
+	if (dot != NULL && dot != (slash != NULL ? slash + 1 : fname)) {
+		ssf->base[dot - fname] = '\0';
+		ssf->ext = dot;
+	} else
+		ssf->ext = "";
+	ssf->tag = tag;
+	ssf->maxopen = maxopen;
+
+	/*
+	 * Let libpcap write the file header, so that it gets the
+	 * magic number and link-layer header type right, and keep a
+	 * copy of it for each file.
+	 */
+	fp = tmpfile();
+	if (fp == NULL) {
+		snprintf(errbuf, PCAP_ERRBUF_SIZE, "tmpfile: %s",
+		    strerror(errno));
+		goto fail;
+	}
+	pdd = pcap_dump_fopen(p, fp);
+	if (pdd == NULL) {
+		snprintf(errbuf, PCAP_ERRBUF_SIZE, "%s", pcap_geterr(p));
+		fclose(fp);
+		goto fail;
+	}
+	if (fflush(fp) == EOF || (len = ftell(fp)) <= 0 ||
+	    (size_t)len > sizeof(ssf->header) ||
+	    fseek(fp, 0, SEEK_SET) == -1 ||
+	    fread(ssf->header, 1, (size_t)len, fp) != (size_t)len) {
+		snprintf(errbuf, PCAP_ERRBUF_SIZE,
+		    "unable to make the savefile header for --split-by");
+		pcap_dump_close(pdd);
+		goto fail;
+	}
+	ssf->hdrlen = (size_t)len;
+	pcap_dump_close(pdd);
+	return (ssf);
+
+fail:
+	free(ssf->base);
+	free(ssf);
+	return (NULL);
+}
+
+/*
+ * Write a packet to the file for "key".  On failure, return -1 with a
+ * message in errbuf.
+ */
+int
+split_savefile_dump(struct split_savefile *ssf, uint32_t key,
+    const struct pcap_pkthdr *h, const u_char *sp, char *errbuf)
+{
+	struct split_sf_pkthdr sf_hdr;
+	struct split_file *sf, **chain;
+
+	chain = &ssf->chains[split_hash(key)];
+	for (sf = *chain; sf != NULL; sf = sf->next)
+		if (sf->key == key)
+			break;
+	if (sf == NULL) {
+		sf = (struct split_file *)calloc(1, sizeof(*sf));
+		if (sf == NULL) {
+			snprintf(errbuf, PCAP_ERRBUF_SIZE, "calloc: %s",
+			    strerror(errno));
+			return (-1);
+		}
+		sf->key = key;
+		sf->next = *chain;
+		*chain = sf;
+	}
+	if (sf->f == NULL) {
+		if (split_open_file(ssf, sf, errbuf) == -1)
+			return (-1);
+	} else if (sf != ssf->newest) {
+		split_unlink(ssf, sf);
+		split_link(ssf, sf);
+	}
+
+	sf_hdr.tv_sec = (uint32_t)h->ts.tv_sec;
+	sf_hdr.tv_usec = (uint32_t)h->ts.tv_usec;
+	sf_hdr.caplen = h->caplen;
+	sf_hdr.len = h->len;
+	if (fwrite(&sf_hdr, sizeof(sf_hdr), 1, sf->f) != 1 ||
+	    fwrite(sp, 1, h->caplen, sf->f) != h->caplen) {
+		split_error(ssf, key, errbuf);
+		return (-1);
+	}
+	ssf->stats.sss_packets++;
+	ssf->stats.sss_bytes += sizeof(sf_hdr) + h->caplen;
+	return (0);
+}
+
+/*
+ * Write out what's buffered for the open files.  On failure, return -1
+ * with a message in errbuf.
+ */
+int
+split_savefile_flush(struct split_savefile *ssf, char *errbuf)
+{
+	struct split_file *sf;
+
+	for (sf = ssf->newest; sf != NULL; sf = sf->older) {
+		if (fflush(sf->f) == EOF) {
+			split_error(ssf, sf->key, errbuf);
+			return (-1);
+		}
+	}
+	return (0);
+}
+
+void
+split_savefile_stats(const struct split_savefile *ssf,
+    struct split_savefile_stats *sss)
+{
+	*sss = ssf->stats;
+}
+
+/*
+ * Close the open files and free ssf.  On failure, return -1 with a
+ * message in errbuf about the first file that couldn't be written.
+ */
+int
+split_savefile_close(struct split_savefile *ssf, char *errbuf)
+{
+	struct split_file *sf, *next;
+	char ebuf[PCAP_ERRBUF_SIZE];
+	int ret = 0;
+	u_int i;
+
+	while (ssf->newest != NULL) {
+		if (split_close_file(ssf, ssf->newest, ebuf) == -1 &&
+		    ret == 0) {
+			memcpy(errbuf, ebuf, PCAP_ERRBUF_SIZE);
+			ret = -1;
+		}
+	}
+	for (i = 0; i < SPLIT_CHAINS; i++) {
+		for (sf = ssf->chains[i]; sf != NULL; sf = next) {
+			next = sf->next;
+			free(sf);
+		}
+	}
+	free(ssf->base);
+	free(ssf);
+	return (ret);
+}
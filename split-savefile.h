@@ -0,0 +1,54 @@
+/*
+ * Copyright (c) 2026 The TCPDUMP project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that: (1) source code
+ * distributions retain the above copyright notice and this paragraph
+ * in its entirety, and (2) distributions including binary code include
+ * the above copyright notice and this paragraph in its entirety in
+ * the documentation or other materials provided with the distribution.
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND
+ * WITHOUT ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, WITHOUT
+ * LIMITATION, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE.
+ */
+
+/*
+ * Savefiles split by a key, such as a VXLAN or Geneve VNI or a VLAN ID,
+ * for -w with --split-by.
+ *
+ * The packets with key k are written to the file with the tag and k
+ * put in front of the extension of the -w file name, e.g. "out.pcap"
+ * with tag "vni" has the packets with VNI 5001 in "out.vni5001.pcap".
+ * Each file has its own stdio buffer.  At most "maxopen" of them are
+ * open at once; the one written to least recently is closed to make
+ * room for another, and reopened for appending if there are more
+ * packets for it.
+ */
+#ifndef split_savefile_h
+#define split_savefile_h
+
+#define SPLIT_SAVEFILE_OPEN	64	/* default files open at once */
+#define SPLIT_SAVEFILE_BUFSIZE	65536	/* buffered per open file */
+
+struct split_savefile;
+
+struct split_savefile_stats {
+	uint64_t	sss_packets;	/* written to the split files */
+	uint64_t	sss_bytes;	/* of records, headers included */
+	u_int		sss_files;	/* created */
+	u_int		sss_open;	/* open now */
+	uint64_t	sss_reopens;	/* closed to make room, then reopened */
+};
+
+extern struct split_savefile *split_savefile_open(pcap_t *, const char *,
+    const char *, u_int, char *);
+extern int split_savefile_dump(struct split_savefile *, uint32_t,
+    const struct pcap_pkthdr *, const u_char *, char *);
+extern int split_savefile_flush(struct split_savefile *, char *);
+extern void split_savefile_stats(const struct split_savefile *,
+    struct split_savefile_stats *);
+extern int split_savefile_close(struct split_savefile *, char *);
+
+#endif /* split_savefile_h */
@@ -0,0 +1,563 @@
+/*
+ * Copyright (c) 2026 The TCPDUMP project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that: (1) source code
+ * distributions retain the above copyright notice and this paragraph
+ * in its entirety, and (2) distributions including binary code include
+ * the above copyright notice and this paragraph in its entirety in
+ * the documentation or other materials provided with the distribution.
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND
+ * WITHOUT ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, WITHOUT
+ * LIMITATION, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE.
+ */
+
+/*
+ * Over TCP, each connection carries a pcap savefile: the file header,
+ * as libpcap wrote it for the capture, then the packets, so that
+ * "nc -l 5000 > x.pcap" will do as a collector.  A connection that's
+ * lost is made again, with a new file header, starting with the batch
+ * that was being sent; the packets of that batch that had got through
+ * are sent again.
+ *
+ * Over UDP, each datagram starts with a frame header of three 32-bit
+ * words in network byte order: STREAM_UDP_MAGIC, a sequence number that
+ * goes up by one for each datagram, so that the collector can tell what
+ * it missed, and flags.  With STREAM_UDP_HEADER set, the rest is the
+ * pcap file header, which is sent first and then every
+ * STREAM_UDP_HEADER_EVERY datagrams, for a collector that starts late;
+ * otherwise the rest is one or more whole packet records, as in the
+ * savefile, up to STREAM_UDP_PAYLOAD bytes (a larger packet is sent in
+ * a datagram of its own).
+ *
+ * Packets are put in batches of STREAM_BATCH_SIZE bytes, as records in
+ * the savefile format, by the capture thread; the sender thread takes
+ * the oldest full batch, or the one being filled if there are none,
+ * whenever it's done with the last, so that batches grow as the rate
+ * goes up.  Only as many batches as fit in the size given to
+ * stream_sink_open() are ever allocated, and they're reused; when
+ * they're all waiting to be sent, as they are when the collector can't
+ * be reached, packets are dropped.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include "netdissect-stdinc.h"
+
+#include <pcap.h>
+
+#include "stream-sink.h"
+
+#ifdef STREAM_SINK_SUPPORTED
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <netdb.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL	0
+#endif
+
+#define STREAM_BATCH_SIZE	(1024 * 1024)
+#define STREAM_SNDBUF		(4 * 1024 * 1024)
+#define STREAM_CONNECT_TIMEOUT	5	/* seconds */
+#define STREAM_SEND_TIMEOUT	10	/* seconds a send can stall */
+#define STREAM_BACKOFF_MIN	250	/* milliseconds between attempts */
+#define STREAM_BACKOFF_MAX	8000
+
+#define STREAM_UDP_MAGIC	0x74637064U	/* "tcpd" */
+#define STREAM_UDP_HEADER	0x00000001U
+#define STREAM_UDP_FRAME	12
+#define STREAM_UDP_PAYLOAD	8192
+#define STREAM_UDP_HEADER_EVERY	1024
+
+/* A packet record's header, as in a pcap savefile. */
+struct stream_record {
+	uint32_t ts_sec;
+	uint32_t ts_frac;
+	uint32_t caplen;
+	uint32_t len;
+};
+
+struct stream_batch {
+	struct stream_batch *next;
+	size_t	len;
+	u_int	npackets;
+	u_char	data[STREAM_BATCH_SIZE];
+};
+
+struct stream_sink {
+	char	*host;
+	char	*port;
+	int	udp;
+	u_char	*header;		/* the pcap file header */
+	size_t	headerlen;
+
+	pthread_mutex_t mtx;
+	pthread_cond_t cv;		/* a packet, or stop */
+	struct stream_batch *fill;	/* being filled */
+	struct stream_batch *queue;	/* full, oldest first */
+	struct stream_batch **queue_tail;
+	struct stream_batch *free;
+	u_int	nbatches;
+	u_int	maxbatches;
+	int	sender_waiting;
+	int	stopping;
+	struct stream_sink_stats stats;
+
+	/* Only the sender thread uses these. */
+	int	fd;
+	int	gave_up;		/* stopping, and the collector won't have it */
+	u_int	backoff;
+	uint32_t seq;
+	u_int	since_header;
+	u_char	*dgram;
+};
+
+/*
+ * Return 1 if "name", a -w argument, is a tcp:// or udp:// URL.
+ */
+int
+stream_sink_url(const char *name)
+{
+	return (strncmp(name, "tcp://", 6) == 0 ||
+	    strncmp(name, "udp://", 6) == 0);
+}
+
+/*
+ * Set up a sink for "url", host:port after tcp:// or udp://, the host
+ * being an IPv6 address in brackets if it's one, which holds up to
+ * "bufsize" bytes of packets waiting to be sent, and which starts each
+ * stream with the "headerlen" bytes of file header at "header".
+ */
+struct stream_sink *
+stream_sink_open(const char *url, size_t bufsize, const u_char *header,
+    size_t headerlen, char *ebuf)
+{
+	struct stream_sink *s;
+	char *p;
+
+	s = (struct stream_sink *)calloc(1, sizeof(*s));
+	if (s == NULL) {
+		snprintf(ebuf, PCAP_ERRBUF_SIZE, "stream_sink_open: malloc");
+		return (NULL);
+	}
+	s->fd = -1;
+	s->udp = strncmp(url, "udp://", 6) == 0;
+	s->host = strdup(url + 6);
+	s->header = (u_char *)malloc(headerlen);
+	if (s->udp)
+		s->dgram = (u_char *)malloc(STREAM_UDP_FRAME + STREAM_UDP_PAYLOAD);
+	if (s->host == NULL || s->header == NULL ||
+	    (s->udp && s->dgram == NULL)) {
+		snprintf(ebuf, PCAP_ERRBUF_SIZE, "stream_sink_open: malloc");
+		free(s->host);
+		free(s->header);
+		free(s->dgram);
+		free(s);
+		return (NULL);
+	}
+	memcpy(s->header, header, headerlen);
+	s->headerlen = headerlen;
+	if ((p = strrchr(s->host, ':')) == NULL || p[1] == '\0') {
+		snprintf(ebuf, PCAP_ERRBUF_SIZE, "%s: no port", url);
+		stream_sink_free(s);
+		return (NULL);
+	}
+	*p = '\0';
+	s->port = p + 1;
+	if (s->host[0] == '[' && p > s->host && p[-1] == ']') {
+		p[-1] = '\0';
+		memmove(s->host, s->host + 1, strlen(s->host + 1) + 1);
+	}
+	s->maxbatches = (u_int)(bufsize / STREAM_BATCH_SIZE);
+	if (s->maxbatches < 2)
+		s->maxbatches = 2;
+	s->queue_tail = &s->queue;
+	s->backoff = STREAM_BACKOFF_MIN;
+	pthread_mutex_init(&s->mtx, NULL);
+	pthread_cond_init(&s->cv, NULL);
+	return (s);
+}
+
+/*
+ * On the capture thread: append a packet to the batch being filled,
+ * dropping it if there's no room for it anywhere.
+ */
+void
+stream_sink_dump(struct stream_sink *s, const struct pcap_pkthdr *h,
+    const u_char *sp)
+{
+	struct stream_record rec;
+	struct stream_batch *b;
+	size_t need;
+
+	need = sizeof(rec) + h->caplen;
+	pthread_mutex_lock(&s->mtx);
+	s->stats.sss_packets++;
+	b = s->fill;
+	if (b != NULL && b->len + need > STREAM_BATCH_SIZE) {
+		b->next = NULL;
+		*s->queue_tail = b;
+		s->queue_tail = &b->next;
+		s->fill = b = NULL;
+	}
+	if (b == NULL) {
+		if ((b = s->free) != NULL)
+			s->free = b->next;
+		else if (s->nbatches < s->maxbatches &&
+		    (b = (struct stream_batch *)malloc(sizeof(*b))) != NULL)
+			s->nbatches++;
+		if (b == NULL || need > STREAM_BATCH_SIZE) {
+			if (b != NULL) {
+				b->next = s->free;
+				s->free = b;
+			}
+			s->stats.sss_dropped++;
+			pthread_mutex_unlock(&s->mtx);
+			return;
+		}
+		b->len = 0;
+		b->npackets = 0;
+		s->fill = b;
+	}
+	rec.ts_sec = (uint32_t)h->ts.tv_sec;
+	rec.ts_frac = (uint32_t)h->ts.tv_usec;
+	rec.caplen = h->caplen;
+	rec.len = h->len;
+	memcpy(b->data + b->len, &rec, sizeof(rec));
+	memcpy(b->data + b->len + sizeof(rec), sp, h->caplen);
+	b->len += need;
+	b->npackets++;
+	if (s->sender_waiting)
+		pthread_cond_signal(&s->cv);
+	pthread_mutex_unlock(&s->mtx);
+}
+
+static int
+send_all(int fd, const u_char *p, size_t len)
+{
+	ssize_t n;
+
+	while (len != 0) {
+		n = send(fd, p, len, MSG_NOSIGNAL);
+		if (n == -1) {
+			if (errno == EINTR)
+				continue;
+			return (-1);
+		}
+		p += n;
+		len -= (size_t)n;
+	}
+	return (0);
+}
+
+/*
+ * Send one datagram, of "len" bytes after the frame header at s->dgram.
+ * A datagram the collector wasn't there for is just lost.
+ */
+static int
+send_dgram(struct stream_sink *s, size_t len, uint32_t flags)
+{
+	uint32_t frame[3];
+
+	frame[0] = htonl(STREAM_UDP_MAGIC);
+	frame[1] = htonl(s->seq++);
+	frame[2] = htonl(flags);
+	memcpy(s->dgram, frame, STREAM_UDP_FRAME);
+	if (send(s->fd, s->dgram, STREAM_UDP_FRAME + len, MSG_NOSIGNAL) == -1 &&
+	    errno != ECONNREFUSED && errno != EINTR && errno != ENOBUFS)
+		return (-1);
+	return (0);
+}
+
+static int
+send_udp_header(struct stream_sink *s)
+{
+	memcpy(s->dgram + STREAM_UDP_FRAME, s->header, s->headerlen);
+	s->since_header = 0;
+	return (send_dgram(s, s->headerlen, STREAM_UDP_HEADER));
+}
+
+/*
+ * Send the records of a batch in as few datagrams as they fit in.
+ */
+static int
+send_udp_batch(struct stream_sink *s, const struct stream_batch *b)
+{
+	struct stream_record rec;
+	size_t off, start, reclen;
+
+	for (off = start = 0; start < b->len; start = off) {
+		if (s->since_header++ >= STREAM_UDP_HEADER_EVERY &&
+		    send_udp_header(s) == -1)
+			return (-1);
+		do {
+			memcpy(&rec, b->data + off, sizeof(rec));
+			reclen = sizeof(rec) + rec.caplen;
+			if (off != start &&
+			    off - start + reclen > STREAM_UDP_PAYLOAD)
+				break;
+			off += reclen;
+		} while (off < b->len);
+		if (off - start > STREAM_UDP_PAYLOAD) {
+			/* One packet too large to share a datagram. */
+			u_char *big = (u_char *)malloc(STREAM_UDP_FRAME +
+			    off - start);
+			u_char *save = s->dgram;
+			int ret;
+
+			if (big == NULL)
+				continue;
+			memcpy(big + STREAM_UDP_FRAME, b->data + start,
+			    off - start);
+			s->dgram = big;
+			ret = send_dgram(s, off - start, 0);
+			s->dgram = save;
+			free(big);
+			if (ret == -1)
+				return (-1);
+			continue;
+		}
+		memcpy(s->dgram + STREAM_UDP_FRAME, b->data + start,
+		    off - start);
+		if (send_dgram(s, off - start, 0) == -1)
+			return (-1);
+	}
+	return (0);
+}
+
+/*
+ * Connect "fd" to "ai", giving up after STREAM_CONNECT_TIMEOUT seconds.
+ */
+static int
+connect_timeout(int fd, const struct addrinfo *ai)
+{
+	struct pollfd pfd;
+	socklen_t errlen;
+	int flags, err;
+
+	flags = fcntl(fd, F_GETFL, 0);
+	if (flags == -1 || fcntl(fd, F_SETFL, flags | O_NONBLOCK) == -1)
+		return (-1);
+	if (connect(fd, ai->ai_addr, ai->ai_addrlen) == -1) {
+		if (errno != EINPROGRESS)
+			return (-1);
+		pfd.fd = fd;
+		pfd.events = POLLOUT;
+		if (poll(&pfd, 1, STREAM_CONNECT_TIMEOUT * 1000) != 1)
+			return (-1);
+		errlen = sizeof(err);
+		if (getsockopt(fd, SOL_SOCKET, SO_ERROR, &err, &errlen) == -1 ||
+		    err != 0)
+			return (-1);
+	}
+	return (fcntl(fd, F_SETFL, flags));
+}
+
+/*
+ * Connect to the collector, and start the stream with the file header.
+ */
+static int
+sink_connect(struct stream_sink *s)
+{
+	struct addrinfo hints, *res, *ai;
+	struct timeval tv;
+	int fd, sndbuf = STREAM_SNDBUF;
+
+	memset(&hints, 0, sizeof(hints));
+	hints.ai_family = AF_UNSPEC;
+	hints.ai_socktype = s->udp ? SOCK_DGRAM : SOCK_STREAM;
+	hints.ai_flags = AI_NUMERICSERV;
+	if (getaddrinfo(s->host, s->port, &hints, &res) != 0)
+		return (-1);
+	fd = -1;
+	for (ai = res; ai != NULL; ai = ai->ai_next) {
+		fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+		if (fd == -1)
+			continue;
+		(void)setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &sndbuf,
+		    sizeof(sndbuf));
+		tv.tv_sec = STREAM_SEND_TIMEOUT;
+		tv.tv_usec = 0;
+		(void)setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+		if (connect_timeout(fd, ai) == 0)
+			break;
+		close(fd);
+		fd = -1;
+	}
+	freeaddrinfo(res);
+	if (fd == -1)
+		return (-1);
+	s->fd = fd;
+	if ((s->udp ? send_udp_header(s) :
+	    send_all(fd, s->header, s->headerlen)) == -1) {
+		close(fd);
+		s->fd = -1;
+		return (-1);
+	}
+	s->backoff = STREAM_BACKOFF_MIN;
+	pthread_mutex_lock(&s->mtx);
+	s->stats.sss_connects++;
+	pthread_mutex_unlock(&s->mtx);
+	return (0);
+}
+
+static int
+sink_stopping(struct stream_sink *s)
+{
+	int stopping;
+
+	pthread_mutex_lock(&s->mtx);
+	stopping = s->stopping;
+	pthread_mutex_unlock(&s->mtx);
+	return (stopping);
+}
+
+/*
+ * Send a batch, connecting or reconnecting as often as it takes, until
+ * it's been sent or we're stopping.
+ */
+static int
+send_batch(struct stream_sink *s, const struct stream_batch *b)
+{
+	struct timespec ts;
+	int ret;
+
+	for (;;) {
+		if (s->gave_up)
+			return (-1);
+		if (s->fd != -1) {
+			ret = s->udp ? send_udp_batch(s, b) :
+			    send_all(s->fd, b->data, b->len);
+			if (ret == 0) {
+				pthread_mutex_lock(&s->mtx);
+				s->stats.sss_bytes_sent += b->len;
+				pthread_mutex_unlock(&s->mtx);
+				return (0);
+			}
+			close(s->fd);
+			s->fd = -1;
+		}
+		if (sink_connect(s) == 0)
+			continue;
+		if (sink_stopping(s)) {
+			s->gave_up = 1;
+			return (-1);
+		}
+		ts.tv_sec = s->backoff / 1000;
+		ts.tv_nsec = (long)(s->backoff % 1000) * 1000000;
+		while (nanosleep(&ts, &ts) == -1 && errno == EINTR)
+			;
+		if (s->backoff < STREAM_BACKOFF_MAX)
+			s->backoff *= 2;
+	}
+}
+
+/*
+ * The sender thread.
+ */
+void *
+stream_sink_main(void *arg)
+{
+	struct stream_sink *s = (struct stream_sink *)arg;
+	struct stream_batch *b;
+
+	pthread_mutex_lock(&s->mtx);
+	for (;;) {
+		while (s->queue == NULL &&
+		    (s->fill == NULL || s->fill->len == 0) && !s->stopping) {
+			s->sender_waiting = 1;
+			pthread_cond_wait(&s->cv, &s->mtx);
+			s->sender_waiting = 0;
+		}
+		if ((b = s->queue) != NULL) {
+			s->queue = b->next;
+			if (s->queue == NULL)
+				s->queue_tail = &s->queue;
+		} else if ((b = s->fill) != NULL && b->len != 0)
+			s->fill = NULL;
+		else
+			break;
+		pthread_mutex_unlock(&s->mtx);
+
+		if (send_batch(s, b) == -1) {
+			pthread_mutex_lock(&s->mtx);
+			s->stats.sss_dropped += b->npackets;
+		} else
+			pthread_mutex_lock(&s->mtx);
+		b->next = s->free;
+		s->free = b;
+	}
+	pthread_mutex_unlock(&s->mtx);
+	if (s->fd != -1) {
+		close(s->fd);
+		s->fd = -1;
+	}
+	return (NULL);
+}
+
+/*
+ * Have the sender thread send what's left and return; if the collector
+ * can't be reached, what's left is dropped.
+ */
+void
+stream_sink_stop(struct stream_sink *s)
+{
+	pthread_mutex_lock(&s->mtx);
+	s->stopping = 1;
+	pthread_cond_signal(&s->cv);
+	pthread_mutex_unlock(&s->mtx);
+}
+
+void
+stream_sink_stats(struct stream_sink *s, struct stream_sink_stats *stats)
+{
+	pthread_mutex_lock(&s->mtx);
+	*stats = s->stats;
+	pthread_mutex_unlock(&s->mtx);
+}
+
+/*
+ * Free the sink, once the sender thread has returned, or if it was
+ * never started.
+ */
+void
+stream_sink_free(struct stream_sink *s)
+{
+	struct stream_batch *b, *next;
+
+	for (b = s->free; b != NULL; b = next) {
+		next = b->next;
+		free(b);
+	}
+	for (b = s->queue; b != NULL; b = next) {
+		next = b->next;
+		free(b);
+	}
+	free(s->fill);
+	if (s->fd != -1)
+		close(s->fd);
+	if (s->maxbatches != 0) {
+		pthread_mutex_destroy(&s->mtx);
+		pthread_cond_destroy(&s->cv);
+	}
+	free(s->dgram);
+	free(s->header);
+	free(s->host);
+	free(s);
+}
+#endif /* STREAM_SINK_SUPPORTED */
@@ -0,0 +1,51 @@
+/*
+ * Copyright (c) 2026 The TCPDUMP project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that: (1) source code
+ * distributions retain the above copyright notice and this paragraph
+ * in its entirety, and (2) distributions including binary code include
+ * the above copyright notice and this paragraph in its entirety in
+ * the documentation or other materials provided with the distribution.
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND
+ * WITHOUT ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, WITHOUT
+ * LIMITATION, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE.
+ */
+
+/*
+ * A savefile sent to a collector over the network, for -w tcp://... and
+ * -w udp://...; see stream-sink.c for what's sent.
+ *
+ * stream_sink_dump() appends a packet to a batch in memory, and never
+ * waits; stream_sink_main() is the thread that sends the batches,
+ * connecting, and reconnecting, as need be.  The batches waiting to be
+ * sent are limited to the size given to stream_sink_open(); packets
+ * that don't fit are dropped and counted.  stream_sink_stop() has the
+ * thread send what's left and return, after which stream_sink_free()
+ * can be called.
+ */
+#if defined(HAVE_PTHREADS) && !defined(_WIN32)
+#define STREAM_SINK_SUPPORTED
+
+struct stream_sink;
+
+struct stream_sink_stats {
+	uint64_t sss_packets;		/* handed to stream_sink_dump() */
+	uint64_t sss_dropped;		/* of those, not sent, for want of room */
+	uint64_t sss_bytes_sent;
+	uint64_t sss_connects;		/* successful connections */
+};
+
+extern int stream_sink_url(const char *);
+extern struct stream_sink *stream_sink_open(const char *, size_t,
+    const u_char *, size_t, char *);
+extern void stream_sink_dump(struct stream_sink *,
+    const struct pcap_pkthdr *, const u_char *);
+extern void *stream_sink_main(void *);
+extern void stream_sink_stop(struct stream_sink *);
+extern void stream_sink_stats(struct stream_sink *,
+    struct stream_sink_stats *);
+extern void stream_sink_free(struct stream_sink *);
+#endif
@@ -0,0 +1,462 @@
+/*
+ * Copyright (c) 2026 The TCPDUMP project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that: (1) source code
+ * distributions retain the above copyright notice and this paragraph
+ * in its entirety, and (2) distributions including binary code include
+ * the above copyright notice and this paragraph in its entirety in
+ * the documentation or other materials provided with the distribution.
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND
+ * WITHOUT ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, WITHOUT
+ * LIMITATION, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE.
+ */
+
+
+/*
+ * The state for --tcp-analysis is kept for each direction of each
+ * conversation: the highest sequence number sent so far and when it
+ * was reached, the last acknowledgment and window sent, and one
+ * segment waiting for the ACK that gives an RTT sample.  From the
+ * capture point, that's the time from a segment to the ACK for it, so
+ * it's the RTT of the path on the far side of the capture point from
+ * the sender; Karn's rule applies, so a sample isn't taken when the
+ * segment has been retransmitted.
+ *
+ * A segment that starts below the highest sequence number sent is out
+ * of order if it comes less than an RTT (the lowest seen, or 3 ms
+ * without a sample) after the highest was reached, as it would when
+ * reordered on the way to the capture point, and a retransmission
+ * otherwise; one that starts above it means a segment was lost before
+ * the capture point.  A one-byte segment just below it is a keep-alive,
+ * and one at it into a closed window is a zero window probe; neither is
+ * a retransmission.  An ACK is a duplicate if it acknowledges no more,
+ * and advertises the same window, as the one before from that side,
+ * carries no data, SYN, FIN or RST, and there's unacknowledged data.
+ * A segment fills the window if it takes the data in flight up to the
+ * window the other side last advertised, scaled if both SYNs had the
+ * window scale option.
+ *
+ * The conversations are kept until the end, for the report, up to
+ * TCP_ANALYSIS_MAX_CONNS of them; those after that aren't followed.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include "netdissect-stdinc.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "netdissect.h"
+#include "addrtostr.h"
+#include "extract.h"
+#include "tcp.h"
+#include "tcp-analysis.h"
+
+#define TA_CHAINS		65536
+#define TA_OOO_DEFAULT_US	3000	/* out-of-order window with no RTT */
+
+#define SEQ_LT(a, b)	((int32_t)((a) - (b)) < 0)
+#define SEQ_GT(a, b)	((int32_t)((a) - (b)) > 0)
+#define SEQ_GEQ(a, b)	((int32_t)((a) - (b)) >= 0)
+
+/* The marks a segment can get. */
+#define TA_RETRANSMISSION	0x001
+#define TA_OUT_OF_ORDER		0x002
+#define TA_LOST			0x004
+#define TA_KEEPALIVE		0x008
+#define TA_ZERO_WINDOW_PROBE	0x010
+#define TA_DUP_ACK		0x020
+#define TA_ZERO_WINDOW		0x040
+#define TA_WINDOW_FULL		0x080
+#define TA_RTT			0x100
+
+struct ta_key {
+	u_char src[16];			/* IPv4 addresses are in the first 4 */
+	u_char dst[16];
+	uint16_t sport;
+	uint16_t dport;
+	uint32_t alen;
+};
+
+/* One direction of a conversation. */
+struct ta_half {
+	int seq_valid;
+	uint32_t next_seq;		/* the highest sent, plus one */
+	uint64_t next_us;		/* when it was reached */
+	int ack_valid;
+	uint32_t ack;			/* the last acknowledged */
+	uint32_t win;			/* and window advertised, unscaled */
+	int wscale;			/* from the SYN, or -1 */
+	uint64_t closed_us;		/* when the window closed, if it's 0 */
+	u_int dup_acks;			/* in a row */
+	int rtt_pending;		/* a segment is waiting for its ACK */
+	uint32_t rtt_seq;		/* which the ACK must reach */
+	uint64_t rtt_us;		/* and when it was sent */
+};
+
+struct ta_conn {
+	struct tcp_analysis_stats stats;
+	struct ta_key key;		/* as the first segment went */
+	struct ta_half half[2];		/* [0] from key.src */
+	uint64_t syn_us;		/* when the SYN was sent, or 0 */
+	int syn_half;			/* and by which side */
+	u_int fins;			/* a bit for each side that's sent one */
+	char name[2 * INET6_ADDRSTRLEN + 16];
+	struct ta_conn *next;		/* on its hash chain */
+};
+
+static ND_THREAD_LOCAL struct ta_conn **ta_chains;
+static ND_THREAD_LOCAL struct ta_conn **ta_conns;	/* in order made */
+static ND_THREAD_LOCAL u_int ta_nconns, ta_maxconns;
+
+/*
+ * A hash of the conversation's addresses and ports that's the same
+ * both ways.
+ */
+static uint32_t
+ta_hash(const u_char *src, const u_char *dst, u_int alen, uint16_t sport,
+    uint16_t dport)
+{
+	uint32_t a = 2166136261U, b = 2166136261U;
+	u_int i;
+
+	for (i = 0; i < alen; i++) {
+		a = (a ^ src[i]) * 16777619U;
+		b = (b ^ dst[i]) * 16777619U;
+	}
+	a = (a ^ sport) * 16777619U;
+	b = (b ^ dport) * 16777619U;
+	return (a ^ b);
+}
+
+/*
+ * Find the conversation, or make one, as going the way of this segment;
+ * sets "*dir" to the half of it the segment is going in.  Returns NULL
+ * if it isn't followed.
+ */
+static struct ta_conn *
+ta_find(netdissect_options *ndo, const u_char *src, const u_char *dst,
+    u_int alen, uint16_t sport, uint16_t dport, int *dir)
+{
+	struct ta_conn *c, **cp;
+	char sbuf[INET6_ADDRSTRLEN], dbuf[INET6_ADDRSTRLEN];
+
+	if (ta_chains == NULL) {
+		ta_chains = (struct ta_conn **)calloc(TA_CHAINS,
+		    sizeof(*ta_chains));
+		if (ta_chains == NULL)
+			(*ndo->ndo_error)(ndo, S_ERR_ND_MEM_ALLOC,
+			    "%s: calloc", __func__);
+	}
+	cp = &ta_chains[ta_hash(src, dst, alen, sport, dport) % TA_CHAINS];
+	for (c = *cp; c != NULL; c = c->next) {
+		if (c->key.alen != alen)
+			continue;
+		if (c->key.sport == sport && c->key.dport == dport &&
+		    memcmp(c->key.src, src, alen) == 0 &&
+		    memcmp(c->key.dst, dst, alen) == 0) {
+			*dir = 0;
+			return (c);
+		}
+		if (c->key.sport == dport && c->key.dport == sport &&
+		    memcmp(c->key.src, dst, alen) == 0 &&
+		    memcmp(c->key.dst, src, alen) == 0) {
+			*dir = 1;
+			return (c);
+		}
+	}
+
+	if (ta_nconns == TCP_ANALYSIS_MAX_CONNS)
+		return (NULL);
+	if (ta_nconns == ta_maxconns) {
+		ta_maxconns = ta_maxconns ? ta_maxconns * 2 : 64;
+		ta_conns = (struct ta_conn **)realloc(ta_conns,
+		    ta_maxconns * sizeof(*ta_conns));
+		if (ta_conns == NULL)
+			(*ndo->ndo_error)(ndo, S_ERR_ND_MEM_ALLOC,
+			    "%s: realloc", __func__);
+	}
+	c = (struct ta_conn *)calloc(1, sizeof(*c));
+	if (c == NULL)
+		(*ndo->ndo_error)(ndo, S_ERR_ND_MEM_ALLOC, "%s: calloc",
+		    __func__);
+	memcpy(c->key.src, src, alen);
+	memcpy(c->key.dst, dst, alen);
+	c->key.sport = sport;
+	c->key.dport = dport;
+	c->key.alen = alen;
+	c->half[0].wscale = c->half[1].wscale = -1;
+	if (alen == 4) {
+		addrtostr(src, sbuf, sizeof(sbuf));
+		addrtostr(dst, dbuf, sizeof(dbuf));
+	} else {
+		addrtostr6(src, sbuf, sizeof(sbuf));
+		addrtostr6(dst, dbuf, sizeof(dbuf));
+	}
+	snprintf(c->name, sizeof(c->name), "%s.%u > %s.%u", sbuf, sport,
+	    dbuf, dport);
+	c->stats.tas_conn = c->name;
+	c->next = *cp;
+	*cp = c;
+	ta_conns[ta_nconns++] = c;
+	*dir = 0;
+	return (c);
+}
+
+/*
+ * The window scale option of a SYN, or -1 if it hasn't one.
+ */
+static int
+ta_wscale(netdissect_options *ndo, const u_char *cp, u_int hlen)
+{
+	u_int opt, len;
+
+	while (hlen != 0 && ND_TTEST_1(cp)) {
+		opt = EXTRACT_U_1(cp);
+		if (opt == TCPOPT_EOL)
+			break;
+		if (opt == TCPOPT_NOP) {
+			cp++;
+			hlen--;
+			continue;
+		}
+		if (hlen < 2 || !ND_TTEST_2(cp))
+			break;
+		len = EXTRACT_U_1(cp + 1);
+		if (len < 2 || len > hlen)
+			break;
+		if (opt == TCPOPT_WSCALE && len == 3 && ND_TTEST_3(cp))
+			return (EXTRACT_U_1(cp + 2) > 14 ? 14 :
+			    EXTRACT_U_1(cp + 2));
+		cp += len;
+		hlen -= len;
+	}
+	return (-1);
+}
+
+/*
+ * The window h last advertised, in bytes.
+ */
+static uint64_t
+ta_window(const struct ta_conn *c, const struct ta_half *h)
+{
+	if (c->half[0].wscale >= 0 && c->half[1].wscale >= 0)
+		return ((uint64_t)h->win << h->wscale);
+	return (h->win);
+}
+
+static void
+ta_rtt_sample(struct ta_conn *c, uint64_t us)
+{
+	struct tcp_analysis_stats *s = &c->stats;
+
+	if (s->tas_rtt_samples == 0 || us < s->tas_rtt_min_us)
+		s->tas_rtt_min_us = us;
+	if (us > s->tas_rtt_max_us)
+		s->tas_rtt_max_us = us;
+	s->tas_rtt_total_us += us;
+	s->tas_rtt_samples++;
+}
+
+static void
+ta_print_us(netdissect_options *ndo, uint64_t us)
+{
+	ND_PRINT("%" PRIu64 ".%03u ms", us / 1000, (u_int)(us % 1000));
+}
+
+void
+tcp_analyze(netdissect_options *ndo, const u_char *src, const u_char *dst,
+    u_int alen, const u_char *bp, u_int length)
+{
+	const struct tcphdr *tp = (const struct tcphdr *)bp;
+	struct ta_conn *c;
+	struct ta_half *h, *o;
+	struct tcp_analysis_stats *s;
+	uint32_t seq, ack, end;
+	uint64_t now, ooo_us, rtt;
+	u_int flags, hlen, len, seglen, marks;
+	uint16_t win;
+	int dir;
+
+	hlen = TH_OFF(tp) * 4;
+	if (hlen < sizeof(*tp) || hlen > length)
+		return;
+	c = ta_find(ndo, src, dst, alen, EXTRACT_BE_U_2(tp->th_sport),
+	    EXTRACT_BE_U_2(tp->th_dport), &dir);
+	if (c == NULL)
+		return;
+	h = &c->half[dir];
+	o = &c->half[!dir];
+	s = &c->stats;
+	seq = EXTRACT_BE_U_4(tp->th_seq);
+	ack = EXTRACT_BE_U_4(tp->th_ack);
+	flags = EXTRACT_U_1(tp->th_flags);
+	win = EXTRACT_BE_U_2(tp->th_win);
+	len = length - hlen;
+	seglen = len + ((flags & TH_SYN) ? 1 : 0) + ((flags & TH_FIN) ? 1 : 0);
+	now = (uint64_t)ND_TS_USEC(ndo->ndo_packet_ts);
+	marks = 0;
+	rtt = 0;
+	s->tas_packets++;
+	s->tas_bytes += len;
+
+	if (flags & TH_SYN) {
+		if (!(flags & TH_ACK)) {
+			if (h->seq_valid && seq != h->next_seq - 1) {
+				/* A new conversation on the same ports. */
+				memset(c->half, 0, sizeof(c->half));
+				c->half[0].wscale = c->half[1].wscale = -1;
+				c->fins = 0;
+				s->tas_closed = 0;
+			}
+			if (!h->seq_valid) {
+				c->syn_us = now;
+				c->syn_half = dir;
+			}
+		}
+		h->wscale = ta_wscale(ndo, bp + sizeof(*tp),
+		    hlen - (u_int)sizeof(*tp));
+	}
+
+	/* What the segment sends. */
+	if (!h->seq_valid) {
+		h->seq_valid = 1;
+		h->next_seq = seq + seglen;
+		h->next_us = now;
+		if (seglen != 0) {
+			h->rtt_pending = 1;
+			h->rtt_seq = seq + seglen;
+			h->rtt_us = now;
+		}
+	} else if (flags & TH_RST) {
+		/* Nothing it carries counts. */
+	} else if (len <= 1 && seglen == len && seq == h->next_seq - 1) {
+		marks |= TA_KEEPALIVE;
+		s->tas_keepalives++;
+	} else if (seglen != 0) {
+		end = seq + seglen;
+		ooo_us = s->tas_rtt_samples != 0 ? s->tas_rtt_min_us :
+		    TA_OOO_DEFAULT_US;
+		if (len == 1 && seq == h->next_seq && o->ack_valid &&
+		    o->win == 0) {
+			marks |= TA_ZERO_WINDOW_PROBE;
+			h->next_seq = end;
+			h->next_us = now;
+		} else if (SEQ_GT(seq, h->next_seq)) {
+			marks |= TA_LOST;
+			s->tas_lost++;
+			h->next_seq = end;
+			h->next_us = now;
+			h->rtt_pending = 0;
+		} else if (SEQ_LT(seq, h->next_seq)) {
+			if (now - h->next_us < ooo_us) {
+				marks |= TA_OUT_OF_ORDER;
+				s->tas_out_of_order++;
+			} else {
+				marks |= TA_RETRANSMISSION;
+				s->tas_retransmissions++;
+				h->rtt_pending = 0;
+			}
+			if (SEQ_GT(end, h->next_seq)) {
+				h->next_seq = end;
+				h->next_us = now;
+			}
+		} else {
+			h->next_seq = end;
+			h->next_us = now;
+			if (!h->rtt_pending) {
+				h->rtt_pending = 1;
+				h->rtt_seq = end;
+				h->rtt_us = now;
+			}
+		}
+		if (len != 0 && o->ack_valid && o->win != 0 &&
+		    !(marks & (TA_ZERO_WINDOW_PROBE | TA_RETRANSMISSION |
+		    TA_OUT_OF_ORDER)) &&
+		    (uint64_t)(uint32_t)(h->next_seq - o->ack) >=
+		    ta_window(c, o)) {
+			marks |= TA_WINDOW_FULL;
+			s->tas_window_full++;
+		}
+	}
+
+	/* And what it acknowledges. */
+	if ((flags & TH_ACK) && !(flags & TH_RST)) {
+		if (h->ack_valid && ack == h->ack && win == h->win &&
+		    len == 0 && !(flags & (TH_SYN|TH_FIN)) &&
+		    !(marks & TA_KEEPALIVE) &&
+		    o->seq_valid && o->next_seq != ack) {
+			marks |= TA_DUP_ACK;
+			h->dup_acks++;
+			s->tas_dup_acks++;
+		} else if (!h->ack_valid || SEQ_GT(ack, h->ack))
+			h->dup_acks = 0;
+		if (o->rtt_pending && SEQ_GEQ(ack, o->rtt_seq)) {
+			rtt = now - o->rtt_us;
+			ta_rtt_sample(c, rtt);
+			marks |= TA_RTT;
+			o->rtt_pending = 0;
+		}
+		if (c->syn_us != 0 && dir == c->syn_half &&
+		    !(flags & TH_SYN) && o->seq_valid && ack == o->next_seq) {
+			s->tas_handshake_us = now - c->syn_us;
+			c->syn_us = 0;
+		}
+		if (win == 0) {
+			marks |= TA_ZERO_WINDOW;
+			if (h->closed_us == 0) {
+				s->tas_zero_windows++;
+				h->closed_us = now != 0 ? now : 1;
+			}
+		} else if (h->closed_us != 0) {
+			s->tas_zero_window_us += now - h->closed_us;
+			h->closed_us = 0;
+		}
+		h->ack_valid = 1;
+		h->ack = ack;
+		h->win = win;
+	}
+
+	if (flags & TH_FIN)
+		c->fins |= 1U << dir;
+	if ((flags & TH_RST) || c->fins == 3)
+		s->tas_closed = 1;
+
+	if (marks & TA_RETRANSMISSION)
+		ND_PRINT(" [retransmission]");
+	if (marks & TA_OUT_OF_ORDER)
+		ND_PRINT(" [out-of-order]");
+	if (marks & TA_LOST)
+		ND_PRINT(" [previous segment not captured]");
+	if (marks & TA_KEEPALIVE)
+		ND_PRINT(" [keep-alive]");
+	if (marks & TA_ZERO_WINDOW_PROBE)
+		ND_PRINT(" [zero window probe]");
+	if (marks & TA_DUP_ACK)
+		ND_PRINT(" [dup ack #%u]", h->dup_acks);
+	if (marks & TA_ZERO_WINDOW)
+		ND_PRINT(" [zero window]");
+	if (marks & TA_WINDOW_FULL)
+		ND_PRINT(" [window full]");
+	if ((marks & TA_RTT) && ndo->ndo_vflag) {
+		ND_PRINT(" [rtt ");
+		ta_print_us(ndo, rtt);
+		ND_PRINT("]");
+	}
+}
+
+void
+tcp_analysis_foreach(tcp_analysis_fn fn, void *arg)
+{
+	u_int i;
+
+	for (i = 0; i < ta_nconns; i++)
+		(*fn)(arg, &ta_conns[i]->stats);
+}
@@ -0,0 +1,34 @@
+/*
+ * Copyright (c) 2026 The TCPDUMP project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that: (1) source code
+ * distributions retain the above copyright notice and this paragraph
+ * in its entirety, and (2) distributions including binary code include
+ * the above copyright notice and this paragraph in its entirety in
+ * the documentation or other materials provided with the distribution.
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND
+ * WITHOUT ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, WITHOUT
+ * LIMITATION, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE.
+ */
+
+
+#ifndef tcp_analysis_h
+#define tcp_analysis_h
+
+/*
+ * --tcp-analysis: follow each TCP conversation's sequence numbers,
+ * acknowledgments and windows, and mark the segments that show
+ * trouble: retransmissions, out-of-order segments, segments lost
+ * before the capture point, duplicate ACKs and closed or full windows.
+ * tcp_analyze() is handed the addresses, of "alen" bytes, and the TCP
+ * header and length of a segment, and prints the marks for it.
+ */
+#define TCP_ANALYSIS_MAX_CONNS	(1U << 20)	/* most conversations followed */
+
+extern void tcp_analyze(netdissect_options *, const u_char *,
+    const u_char *, u_int, const u_char *, u_int);
+
+#endif /* tcp_analysis_h */
@@ -0,0 +1,566 @@
+/*
+ * Copyright (c) 2026 The TCPDUMP project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that: (1) source code
+ * distributions retain the above copyright notice and this paragraph
+ * in its entirety, and (2) distributions including binary code include
+ * the above copyright notice and this paragraph in its entirety in
+ * the documentation or other materials provided with the distribution.
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND
+ * WITHOUT ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, WITHOUT
+ * LIMITATION, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE.
+ */
+
+/*
+ * The streams are in a hash table, chained, and on a list with the
+ * one that had a packet most recently first.  A stream has the bytes
+ * from the start of the first message it hasn't handed on, in "buf",
+ * and the segments that came ahead of a gap, in order of sequence
+ * number.  The bytes handed on from "buf" are only dropped from it the
+ * next time the stream has a segment, as the dissector may not return
+ * (it longjmp()s if the message is cut short), and so the stream has to
+ * be up to date before the dissector is called.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include "netdissect-stdinc.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "netdissect.h"
+#include "netdissect-alloc.h"
+#include "extract.h"
+#include "ip.h"
+#include "ip6.h"
+#include "portdispatch.h"
+#include "tcp.h"
+#include "tcp-reasm.h"
+#include "netdissect-state.h"
+
+#define TCP_REASM_MIN_BUCKETS	256
+
+struct tcp_reasm_key {
+	nd_ipv6 src;		/* IPv4 addresses are in the first 4 octets */
+	nd_ipv6 dst;
+	uint32_t port;		/* source port << 16 | destination port */
+	uint32_t alen;		/* 4 or 16 */
+};
+
+struct tcp_reasm_seg {
+	struct tcp_reasm_seg *next;
+	uint32_t seq;
+	u_int len;		/* data follows */
+};
+
+struct tcp_reasm_flow {
+	struct tcp_reasm_flow *hnext;
+	struct tcp_reasm_flow *prev;	/* more recent */
+	struct tcp_reasm_flow *next;	/* less recent */
+	struct tcp_reasm_key key;
+	uint32_t hash;
+	uint32_t last;		/* time stamp, in seconds, of the last packet */
+	int synced;		/* seq is the start of a message */
+	uint32_t seq;		/* of the next byte expected */
+	u_char *buf;
+	u_int off;		/* bytes of buf already handed on */
+	u_int len;		/* bytes in buf */
+	u_int size;		/* bytes allocated for buf */
+	struct tcp_reasm_seg *segs;
+	size_t segbytes;	/* data in segs */
+};
+
+static ND_THREAD_LOCAL struct tcp_reasm_flow **reasm_buckets;
+static ND_THREAD_LOCAL u_int reasm_nbuckets;
+static ND_THREAD_LOCAL u_int reasm_nflows;
+static ND_THREAD_LOCAL struct tcp_reasm_flow *reasm_newest, *reasm_oldest;
+static ND_THREAD_LOCAL size_t reasm_bytes;	/* against the budget */
+
+static uint32_t
+reasm_hash(const struct tcp_reasm_key *key)
+{
+	const u_char *p = (const u_char *)key;
+	uint32_t h = 0, w;
+	size_t i;
+
+	for (i = 0; i < sizeof(*key); i += 4) {
+		memcpy(&w, p + i, 4);
+		h = (h ^ w) * 0x9e3779b1U;
+	}
+	h ^= h >> 16;
+	h *= 0x85ebca6bU;
+	h ^= h >> 13;
+	h *= 0xc2b2ae35U;
+	h ^= h >> 16;
+	return h;
+}
+
+static void
+reasm_free_segs(struct tcp_reasm_flow *f)
+{
+	struct tcp_reasm_seg *s;
+
+	while ((s = f->segs) != NULL) {
+		f->segs = s->next;
+		reasm_bytes -= sizeof(*s) + s->len;
+		free(s);
+	}
+	f->segbytes = 0;
+}
+
+/*
+ * Drop what the stream holds, so that it picks up again at the next
+ * segment.
+ */
+static void
+reasm_flow_reset(struct tcp_reasm_flow *f)
+{
+	reasm_free_segs(f);
+	reasm_bytes -= f->size;
+	free(f->buf);
+	f->buf = NULL;
+	f->off = f->len = f->size = 0;
+	f->synced = 0;
+}
+
+static void
+reasm_flow_free(struct tcp_reasm_flow *f)
+{
+	struct tcp_reasm_flow **fp;
+
+	reasm_flow_reset(f);
+	for (fp = &reasm_buckets[f->hash & (reasm_nbuckets - 1)]; *fp != f;
+	    fp = &(*fp)->hnext)
+		continue;
+	*fp = f->hnext;
+	if (f->prev != NULL)
+		f->prev->next = f->next;
+	else
+		reasm_newest = f->next;
+	if (f->next != NULL)
+		f->next->prev = f->prev;
+	else
+		reasm_oldest = f->prev;
+	reasm_bytes -= sizeof(*f);
+	reasm_nflows--;
+	free(f);
+}
+
+/*
+ * Make room for "n" more bytes for the stream "f", dropping the streams
+ * that had a packet the longest ago.  Returns -1 if there isn't room
+ * even without them.
+ */
+static int
+reasm_reserve(netdissect_options *ndo, const struct tcp_reasm_flow *f,
+    size_t n)
+{
+	while (reasm_bytes + n > ndo->ndo_tcp_reasm_budget) {
+		if (reasm_oldest == NULL || reasm_oldest == f)
+			return (-1);
+		reasm_flow_free(reasm_oldest);
+	}
+	return (0);
+}
+
+static void
+reasm_grow(netdissect_options *ndo)
+{
+	struct tcp_reasm_flow **b, *f, *next;
+	u_int n, i;
+
+	n = reasm_nbuckets != 0 ? reasm_nbuckets * 2 : TCP_REASM_MIN_BUCKETS;
+	b = (struct tcp_reasm_flow **)nd_big_calloc(n, sizeof(*b));
+	if (b == NULL)
+		(*ndo->ndo_error)(ndo, S_ERR_ND_MEM_ALLOC, "%s: calloc",
+		    __func__);
+	for (i = 0; i < reasm_nbuckets; i++) {
+		for (f = reasm_buckets[i]; f != NULL; f = next) {
+			next = f->hnext;
+			f->hnext = b[f->hash & (n - 1)];
+			b[f->hash & (n - 1)] = f;
+		}
+	}
+	nd_big_free(reasm_buckets);
+	reasm_buckets = b;
+	reasm_nbuckets = n;
+}
+
+/*
+ * Find the stream "key", or make one, and make it the most recent.
+ * Returns NULL if there's no room for a new one.
+ */
+static struct tcp_reasm_flow *
+reasm_flow_lookup(netdissect_options *ndo, const struct tcp_reasm_key *key)
+{
+	struct tcp_reasm_flow *f;
+	uint32_t now = (uint32_t)ndo->ndo_packet_sec;
+	uint32_t h = reasm_hash(key);
+
+	f = NULL;
+	if (reasm_nbuckets != 0) {
+		for (f = reasm_buckets[h & (reasm_nbuckets - 1)]; f != NULL;
+		    f = f->hnext)
+			if (f->hash == h &&
+			    memcmp(&f->key, key, sizeof(*key)) == 0)
+				break;
+	}
+	if (f == NULL) {
+		while (reasm_oldest != NULL &&
+		    (int32_t)(now - reasm_oldest->last) > TCP_REASM_IDLE)
+			reasm_flow_free(reasm_oldest);
+		if (reasm_reserve(ndo, NULL, sizeof(*f)) == -1)
+			return (NULL);
+		if (reasm_nflows >= reasm_nbuckets)
+			reasm_grow(ndo);
+		f = (struct tcp_reasm_flow *)calloc(1, sizeof(*f));
+		if (f == NULL)
+			(*ndo->ndo_error)(ndo, S_ERR_ND_MEM_ALLOC,
+			    "%s: calloc", __func__);
+		f->key = *key;
+		f->hash = h;
+		f->hnext = reasm_buckets[h & (reasm_nbuckets - 1)];
+		reasm_buckets[h & (reasm_nbuckets - 1)] = f;
+		reasm_bytes += sizeof(*f);
+		reasm_nflows++;
+	} else if (f != reasm_newest) {
+		/* Take it off the list, to put it back at the front. */
+		f->prev->next = f->next;
+		if (f->next != NULL)
+			f->next->prev = f->prev;
+		else
+			reasm_oldest = f->prev;
+	} else
+		goto done;
+	f->prev = NULL;
+	f->next = reasm_newest;
+	if (reasm_newest != NULL)
+		reasm_newest->prev = f;
+	else
+		reasm_oldest = f;
+	reasm_newest = f;
+done:
+	f->last = now;
+	return (f);
+}
+
+/*
+ * Append "len" bytes to the stream's buffer, after dropping the bytes
+ * already handed on from it.  Returns -1 if there isn't room.
+ */
+static int
+reasm_append(netdissect_options *ndo, struct tcp_reasm_flow *f,
+    const u_char *bp, u_int len)
+{
+	u_char *buf;
+	u_int size;
+
+	if (f->off != 0) {
+		memmove(f->buf, f->buf + f->off, f->len - f->off);
+		f->len -= f->off;
+		f->off = 0;
+	}
+	if (len > TCP_REASM_FLOW_MAX - f->len - f->segbytes)
+		return (-1);
+	if (f->len + len > f->size) {
+		for (size = f->size != 0 ? f->size : 2048;
+		    size < f->len + len; size *= 2)
+			continue;
+		if (reasm_reserve(ndo, f, size - f->size) == -1)
+			return (-1);
+		buf = (u_char *)realloc(f->buf, size);
+		if (buf == NULL)
+			(*ndo->ndo_error)(ndo, S_ERR_ND_MEM_ALLOC,
+			    "%s: realloc", __func__);
+		reasm_bytes += size - f->size;
+		f->buf = buf;
+		f->size = size;
+	}
+	memcpy(f->buf + f->len, bp, len);
+	f->len += len;
+	return (0);
+}
+
+/*
+ * Keep a copy of a segment that came ahead of a gap.  Returns -1 if
+ * there isn't room.
+ */
+static int
+reasm_queue(netdissect_options *ndo, struct tcp_reasm_flow *f, uint32_t seq,
+    const u_char *bp, u_int len)
+{
+	struct tcp_reasm_seg *s, **sp;
+
+	if (len > TCP_REASM_FLOW_MAX - f->len - f->segbytes)
+		return (-1);
+	if (reasm_reserve(ndo, f, sizeof(*s) + len) == -1)
+		return (-1);
+	s = (struct tcp_reasm_seg *)malloc(sizeof(*s) + len);
+	if (s == NULL)
+		(*ndo->ndo_error)(ndo, S_ERR_ND_MEM_ALLOC, "%s: malloc",
+		    __func__);
+	s->seq = seq;
+	s->len = len;
+	memcpy(s + 1, bp, len);
+	for (sp = &f->segs; *sp != NULL &&
+	    (int32_t)((*sp)->seq - seq) <= 0; sp = &(*sp)->next)
+		continue;
+	s->next = *sp;
+	*sp = s;
+	f->segbytes += len;
+	reasm_bytes += sizeof(*s) + len;
+	return (0);
+}
+
+/*
+ * Move the queued segments that the gap has closed up to into the
+ * buffer.  Returns -1 if there isn't room.
+ */
+static int
+reasm_drain(netdissect_options *ndo, struct tcp_reasm_flow *f)
+{
+	struct tcp_reasm_seg *s;
+	uint32_t skip;
+	int ret = 0;
+
+	while ((s = f->segs) != NULL && (int32_t)(s->seq - f->seq) <= 0) {
+		f->segs = s->next;
+		f->segbytes -= s->len;
+		reasm_bytes -= sizeof(*s) + s->len;
+		skip = f->seq - s->seq;
+		if (ret == 0 && skip < s->len) {
+			ret = reasm_append(ndo, f, (const u_char *)(s + 1) + skip,
+			    s->len - skip);
+			f->seq += s->len - skip;
+		}
+		free(s);
+	}
+	return (ret);
+}
+
+/*
+ * Returns the number of bytes, from "bp", in the whole messages there;
+ * sets "*bad" if the framer didn't find a message after them.
+ */
+static u_int
+reasm_frame(const struct port_dissector *pd, const u_char *bp, u_int len,
+    int *bad)
+{
+	u_int n, msglen;
+	int r;
+
+	*bad = 0;
+	for (n = 0; n < len; n += msglen) {
+		r = (*pd->framer)(bp + n, len - n, &msglen);
+		if (r == 0)
+			break;
+		if (r == -1 || msglen == 0 || msglen > TCP_REASM_FLOW_MAX) {
+			*bad = 1;
+			break;
+		}
+		if (msglen > len - n)
+			break;
+	}
+	return (n);
+}
+
+/*
+ * Hand the "len" bytes of whole messages at "bp", which are in the
+ * packet if "inplace" is set and in a stream's buffer otherwise, to the
+ * dissector, with the snapshot end at the end of them.
+ */
+static void
+reasm_dissect(netdissect_options *ndo, const struct port_dissector *pd,
+    const struct port_info *pi, const u_char *bp, u_int len, int inplace)
+{
+	u_int n, msglen;
+	int pushed;
+
+	for (n = 0; n < len; n += msglen) {
+		msglen = len - n;
+		if (pd->flags & PORT_ONE_MESSAGE)
+			(void)(*pd->framer)(bp + n, len - n, &msglen);
+		if (inplace)
+			pushed = nd_push_snapend(ndo, bp + n + msglen);
+		else
+			pushed = nd_push_buffer(ndo, NULL, bp + n,
+			    bp + n + msglen);
+		if (!pushed)
+			(*ndo->ndo_error)(ndo, S_ERR_ND_MEM_ALLOC,
+			    "%s: can't push buffer", __func__);
+		(void)(*pd->printer)(ndo, bp + n, msglen, pi);
+		nd_pop_packet_info(ndo);
+	}
+}
+
+/*
+ * Print a segment, with the ports and IP header in "pi", for the
+ * dissector "pd", which has a framer.  "seq" is the sequence number
+ * and "flags" the flags of the segment, which has "length" bytes of
+ * data at "bp".  Returns 0 if the segment should be dissected as it
+ * is, instead.
+ */
+int
+tcp_reasm_print(netdissect_options *ndo, const struct port_dissector *pd,
+    const struct port_info *pi, uint32_t seq, u_int flags, const u_char *bp,
+    u_int length)
+{
+	const struct ip *ip = (const struct ip *)pi->iph;
+	const struct ip6_hdr *ip6 = (const struct ip6_hdr *)pi->iph;
+	struct tcp_reasm_key key;
+	struct tcp_reasm_flow *f;
+	const u_char *p;
+	u_int n, old;
+	int32_t diff;
+	int bad;
+
+	memset(&key, 0, sizeof(key));
+	if (IP_V(ip) == 6) {
+		UNALIGNED_MEMCPY(&key.src, ip6->ip6_src, sizeof(ip6->ip6_src));
+		UNALIGNED_MEMCPY(&key.dst, ip6->ip6_dst, sizeof(ip6->ip6_dst));
+		key.alen = sizeof(ip6->ip6_src);
+	} else {
+		UNALIGNED_MEMCPY(&key.src, ip->ip_src, sizeof(ip->ip_src));
+		UNALIGNED_MEMCPY(&key.dst, ip->ip_dst, sizeof(ip->ip_dst));
+		key.alen = sizeof(ip->ip_src);
+	}
+	key.port = pi->sport << 16 | pi->dport;
+	f = reasm_flow_lookup(ndo, &key);
+	if (f == NULL)
+		return (0);
+
+	if (flags & TH_RST) {
+		reasm_flow_free(f);
+		return (0);
+	}
+	if (flags & TH_SYN) {
+		reasm_flow_reset(f);
+		seq++;
+		f->seq = seq;
+		f->synced = 1;
+	}
+	if (length == 0)
+		goto done;
+	if (!ND_TTEST_LEN(bp, length)) {
+		/* Part of the stream is missing. */
+		reasm_flow_reset(f);
+		return (0);
+	}
+	if (!f->synced) {
+		f->seq = seq;
+		if (reasm_frame(pd, bp, length, &bad) == 0 && bad)
+			return (0);
+		f->synced = 1;
+	}
+
+	diff = (int32_t)(seq - f->seq);
+	if (diff < 0) {
+		if ((u_int)-diff >= length) {
+			ND_PRINT(" [retransmission]");
+			goto done;
+		}
+		bp += -diff;
+		length -= -diff;
+	} else if (diff > 0) {
+		if (reasm_queue(ndo, f, seq, bp, length) == -1) {
+			reasm_flow_reset(f);
+			return (0);
+		}
+		ND_PRINT(" [out of order]");
+		return (1);
+	}
+
+	if (f->off == f->len && f->segs == NULL) {
+		/*
+		 * Nothing's waiting, so dissect what we can where it is,
+		 * and keep the rest.
+		 */
+		n = reasm_frame(pd, bp, length, &bad);
+		f->seq += length;
+		f->off = f->len = 0;
+		if (bad)
+			reasm_flow_reset(f);
+		else if (n < length &&
+		    reasm_append(ndo, f, bp + n, length - n) == -1)
+			reasm_flow_reset(f);
+		if (n == 0) {
+			if (bad)
+				return (0);
+			ND_PRINT(" [reassembling]");
+			goto done;
+		}
+		reasm_dissect(ndo, pd, pi, bp, n, 1);
+		goto done;
+	}
+
+	/*
+	 * Add this segment, and those queued up that it reaches, to the
+	 * bytes that are waiting, and dissect whatever that finishes.
+	 */
+	if (reasm_append(ndo, f, bp, length) == -1) {
+		reasm_flow_reset(f);
+		return (0);
+	}
+	f->seq += length;
+	if (reasm_drain(ndo, f) == -1) {
+		reasm_flow_reset(f);
+		return (0);
+	}
+	old = f->off;
+	n = reasm_frame(pd, f->buf + old, f->len - old, &bad);
+	f->off += n;
+	p = f->buf + old;
+	if (bad) {
+		/*
+		 * Keep the buffer until the next segment, in case there
+		 * are messages in it to be dissected.
+		 */
+		reasm_free_segs(f);
+		f->off = f->len;
+		f->synced = 0;
+	}
+	if (n == 0) {
+		ND_PRINT(" [reassembling]");
+		goto done;
+	}
+	reasm_dissect(ndo, pd, pi, p, n, 0);
+
+done:
+	if (flags & TH_FIN)
+		reasm_flow_free(f);
+	return (1);
+}
+
+size_t
+tcp_reasm_mem_usage(netdissect_options *ndo _U_)
+{
+	return (reasm_bytes + reasm_nbuckets * sizeof(*reasm_buckets));
+}
+
+/*
+ * For --mem-limit: drop the streams that had a packet the longest ago
+ * until "want" bytes have been given back, or there are none left.  A
+ * stream that's dropped picks up again at the start of the next message
+ * found in it, so what's lost is the messages that were being put
+ * together.
+ */
+uint64_t
+tcp_reasm_mem_reclaim(netdissect_options *ndo _U_, size_t want)
+{
+	size_t target;
+	uint64_t n;
+
+	target = reasm_bytes > want ? reasm_bytes - want : 0;
+	n = 0;
+	while (reasm_oldest != NULL && reasm_bytes > target) {
+		reasm_flow_free(reasm_oldest);
+		n++;
+	}
+	return (n);
+}
@@ -0,0 +1,50 @@
+/*
+ * Copyright (c) 2026 The TCPDUMP project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that: (1) source code
+ * distributions retain the above copyright notice and this paragraph
+ * in its entirety, and (2) distributions including binary code include
+ * the above copyright notice and this paragraph in its entirety in
+ * the documentation or other materials provided with the distribution.
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND
+ * WITHOUT ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, WITHOUT
+ * LIMITATION, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE.
+ */
+
+#ifndef tcp_reasm_h
+#define tcp_reasm_h
+
+/*
+ * TCP stream reassembly, for --tcp-reassembly.
+ *
+ * Each direction of a conversation whose port goes to a dissector with
+ * a framer (see portdispatch.h) is followed as a byte stream, and the
+ * dissector is handed whole messages rather than segments.  Messages
+ * that are all in one segment, in order, are dissected where they are;
+ * only the bytes of a message that isn't finished at the end of a
+ * segment, and segments that arrive ahead of a gap, are copied.
+ *
+ * The copies, and the state of the streams, are limited to
+ * ndo_tcp_reasm_budget bytes in all; streams that haven't had a packet
+ * for the longest are dropped to stay within it, as are those idle for
+ * more than TCP_REASM_IDLE seconds.  A stream also gives up when a
+ * message would need more than TCP_REASM_FLOW_MAX bytes, when a segment
+ * wasn't all captured, or when its framer doesn't find a message where
+ * one should start; it then picks up again at the start of the next
+ * segment, going by whether the framer finds a message there.
+ */
+#define TCP_REASM_DEFAULT_BUDGET	64	/* megabytes */
+#define TCP_REASM_FLOW_MAX	(2U * 1024 * 1024)
+#define TCP_REASM_IDLE		300
+
+struct port_dissector;
+struct port_info;
+
+extern int tcp_reasm_print(netdissect_options *,
+    const struct port_dissector *, const struct port_info *, uint32_t,
+    u_int, const u_char *, u_int);
+
+#endif /* tcp_reasm_h */
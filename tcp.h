@@ -121,6 +121,9 @@ struct tcphdr {
 #ifndef RPKI_RTR_PORT
 #define RPKI_RTR_PORT		323
 #endif
+#ifndef HTTPS_PORT
+#define HTTPS_PORT		443
+#endif
 #ifndef SMB_PORT
 #define SMB_PORT		445
 #endif
@@ -133,6 +136,15 @@ struct tcphdr {
 #ifndef LDP_PORT
 #define LDP_PORT		646
 #endif
+#ifndef DNS_TLS_PORT
+#define DNS_TLS_PORT		853	/* RFC 7858 */
+#endif
+#ifndef IMAPS_PORT
+#define IMAPS_PORT		993
+#endif
+#ifndef POP3S_PORT
+#define POP3S_PORT		995
+#endif
 #ifndef PPTP_PORT
 #define PPTP_PORT		1723
 #endif
@@ -148,6 +160,9 @@ struct tcphdr {
 #ifndef HTTP_PORT_ALT
 #define HTTP_PORT_ALT		8080
 #endif
+#ifndef HTTPS_PORT_ALT
+#define HTTPS_PORT_ALT		8443
+#endif
 #ifndef RTSP_PORT_ALT
 #define RTSP_PORT_ALT		8554
 #endif
@@ -141,16 +141,68 @@ The Regents of the University of California.  All rights reserved.\n";
 #include <sys/sysctl.h>
 #endif /* __FreeBSD__ */
 
+#ifdef __linux__
+#include <sys/socket.h>
+#include <linux/if_packet.h>
+#endif /* __linux__ */
+
+#ifdef HAVE_PTHREADS
+#include <pthread.h>
+#endif /* HAVE_PTHREADS */
+
 #include "netdissect.h"
+#include "netdissect-alloc.h"
+#include "netdissect-fields.h"
+#include "netdissect-memo.h"
+#include "netdissect-plugin.h"
+#include "netdissect-profile.h"
+#include "netdissect-state.h"
 #include "interface.h"
 #include "addrtoname.h"
+#include "name-cache-file.h"
 #include "machdep.h"
 #include "pcap-missing.h"
 #include "ascii_strcasecmp.h"
 
 #include "print.h"
 
+#include "cpu-affinity.h"
+#include "dedup.h"
+#include "anonymize.h"
+#include "dfilter.h"
+#include "host-set.h"
+#include "payload-match.h"
 #include "fptype.h"
+#include "control-socket.h"
+#include "gzip-savefile.h"
+#include "uring-savefile.h"
+#include "compressed-reader.h"
+#include "metrics.h"
+#include "output-buffer.h"
+#include "packet-ring.h"
+#include "savefile-clock.h"
+#include "stream-sink.h"
+#include "shm-ring.h"
+#include "mmap-savefile.h"
+#include "pcapng-savefile.h"
+#include "savefile-index.h"
+#include "flow-index.h"
+#include "split-savefile.h"
+#include "follow-reader.h"
+#include "ip-reasm.h"
+#include "latency.h"
+#include "lsdb.h"
+#include "neighbors.h"
+#include "arp-watch.h"
+#include "flows.h"
+#include "kernel-counts.h"
+#include "rates.h"
+#include "topn.h"
+#include "tcp-reasm.h"
+#include "extract.h"
+#include "ethertype.h"
+#include "ipproto.h"
+#include "udp.h"
 
 #ifndef PATH_MAX
 #define PATH_MAX 1024
@@ -199,6 +251,13 @@ int dflag;				/* print filter code */
 static int Gflag;			/* rotate dump files after this many seconds */
 static int Gflag_count;			/* number of files created with Gflag rotation */
 static time_t Gflag_time;		/* The last time_t the dump file was rotated. */
+static u_int flush_interval;		/* --flush-interval, in milliseconds */
+#ifdef SAVEFILE_CLOCK_SUPPORTED
+static struct savefile_clock *savefile_clock;	/* for -G and --flush-interval */
+static pthread_t clock_tid;
+#endif
+static char **stripe_dirs;		/* --stripe-dir, in order */
+static int nstripe_dirs;
 static int Lflag;			/* list available data link types and exit */
 static int Iflag;			/* rfmon (monitor) mode */
 #ifdef HAVE_PCAP_SET_TSTAMP_TYPE
@@ -221,6 +280,173 @@ static int timeout = 1000;		/* default timeout = 1000 ms = 1 s */
 static int immediate_mode;
 #endif
 static int count_mode;
+static int batch_size;			/* packets per pcap_dispatch() call; 0 = use pcap_loop() */
+static int batch_packets;		/* packets handled so far in the current batch */
+static int mmap_flag;			/* --mmap-savefile */
+static int recycle_flag;		/* --recycle-savefiles */
+static char **recycle_names;		/* the name of each of the -W files */
+static u_int recycle_seq;		/* savefiles opened so far */
+static struct dump_info *recycle_dump_info;	/* to truncate the savefile on exit */
+#ifdef STREAM_SINK_SUPPORTED
+#define STREAM_BUFFER_DEFAULT_SIZE	64	/* megabytes */
+static int stream_flag;			/* -w is a tcp:// or udp:// URL */
+static size_t stream_buffer = (size_t)STREAM_BUFFER_DEFAULT_SIZE * 1024 * 1024;
+static struct dump_info *stream_dump_info;	/* to send what's left on exit */
+static pthread_t stream_tid;
+#endif
+#ifdef SHM_RING_SUPPORTED
+#define SHM_RING_DEFAULT_SIZE	64	/* megabytes */
+static int shm_flag;			/* -w is shm:name */
+static size_t shm_size = (size_t)SHM_RING_DEFAULT_SIZE * 1024 * 1024;
+static struct dump_info *shm_dump_info;	/* to mark it finished on exit */
+static const char *shm_output_name;	/* --shm-output */
+static struct shm_ring *shm_output_ring;
+
+static void shm_output_start(netdissect_options *);
+#endif
+static int pcapng_flag;			/* --pcapng, or more than one -i */
+static int pcapng_nano;			/* time stamps are in nanoseconds */
+static const char *pcapng_ifname;	/* the -i interface, if capturing */
+static u_int pcapng_ifid;		/* interface of the packet being written */
+static struct timeval pcapng_start;	/* when the capture started */
+static struct dump_info *pcapng_dump_info;	/* to finish the savefile on exit */
+#ifdef GZIP_SAVEFILE_SUPPORTED
+static int gzip_level;			/* --gzip-savefile, or 0 */
+static struct dump_info *gzip_dump_info;	/* to finish the savefile on exit */
+#endif
+#ifdef URING_SAVEFILE_SUPPORTED
+static int uring_flag;			/* --io-uring: 1, or 2 with =direct */
+static struct dump_info *uring_dump_info;	/* to finish the savefile on exit */
+#endif
+#ifdef COMPRESSED_READER_SUPPORTED
+static int decompress_threads = 1;	/* --decompress-threads */
+#endif
+#ifndef _WIN32
+static int mmap_read;			/* --mmap-read */
+static struct mmap_reader *mmap_reader;	/* for the savefile being read */
+static int mmap_prefetch;		/* printing on the reading thread */
+static struct dump_info *mmap_dump_info;	/* to finish the savefile on exit */
+static int startup_time;		/* --startup-time, until reported */
+static struct timeval startup_tv;	/* when main() was entered */
+static int startup_profile;		/* --startup-profile */
+#define STARTUP_PHASES	16
+static struct startup_phase {
+	const char *what;
+	struct timeval tv;		/* when it was done */
+} startup_phases[STARTUP_PHASES];
+static u_int nstartup_phases;
+#endif
+static int write_index;			/* --write-index */
+static int build_index;			/* --build-index */
+static u_int index_interval = SAVEFILE_INDEX_DEFAULT_INTERVAL;	/* --index-interval */
+static int index_nano;			/* time stamps are in nanoseconds */
+static int flow_index;			/* --flow-index */
+static int flow_index_dlt;		/* of what's written */
+static int field_output;		/* --field-output */
+static int json_output;			/* --json */
+static int stats_only;			/* --stats-only */
+static const char *display_filter;	/* --display-filter */
+static int flows_format = -1;		/* --flows, FLOWS_TEXT, ... */
+static u_int flows_size = FLOWS_DEFAULT_SIZE;	/* --flow-table-size */
+static u_int flows_active = FLOWS_DEFAULT_ACTIVE;	/* --flow-timeout */
+static u_int flows_idle = FLOWS_DEFAULT_IDLE;
+static int flows_collect;		/* --flow-collector */
+static netdissect_options *flows_ndo;	/* the one adding up flows */
+static u_int topn_count;		/* --top, or 0 */
+static u_int topn_interval = 1;		/* --top-interval, seconds */
+static netdissect_options *topn_ndo;	/* the one counting them */
+static int rates_format = -1;		/* --rates, RATES_CSV, ... */
+static u_int rates_interval = RATES_DEFAULT_INTERVAL;	/* --rate-interval */
+static netdissect_options *rates_ndo;	/* the one adding them up */
+#ifdef KERNEL_COUNTS_SUPPORTED
+static int kernel_counts_flag;		/* --kernel-counts */
+static struct kernel_counts *kcounts;	/* counting them in the kernel */
+#endif
+static const char **plugin_files;	/* --plugin */
+static u_int n_plugin_files;
+static int latency_interval;		/* --latency-report=seconds */
+static time_t latency_next;		/* packet time of the next report */
+static netdissect_options *stats_ndo;	/* the one doing the counting */
+static size_t mem_limit;		/* --mem-limit, for the report */
+#ifdef CONTROL_SOCKET_SUPPORTED
+static const char *control_path;	/* --control-socket */
+static struct control_socket *control;
+static netdissect_options *control_ndo;	/* the one the flags are set in */
+static int control_Oflag;		/* for filters compiled for it */
+static bpf_u_int32 control_netmask;
+static int control_writing;		/* -w given */
+#endif
+#ifdef METRICS_SUPPORTED
+static struct metrics_server *metrics;	/* --metrics */
+static pthread_t metrics_tid;
+static int metrics_live;		/* pd is a live capture */
+#endif
+static uint64_t savefile_packets;	/* written to savefiles */
+static uint64_t savefile_bytes;		/* captured bytes of those */
+static uint64_t savefile_rotations;	/* by -C, -G or "rotate" */
+static volatile sig_atomic_t rotate_requests;	/* forced rotations */
+static sig_atomic_t rotate_requests_seen;
+
+/*
+ * --degrade: while the kernel is dropping packets, or the dissection
+ * threads are falling behind, print them in less detail, a step at a
+ * time down to just counting them, and go back up a step at a time
+ * once the capture has caught up.  The steps are made from the flags
+ * given: without -x, -X and -A, then with one -v fewer each, then with
+ * -q, then none printed.
+ */
+struct degrade_step {
+	int	vflag;
+	int	qflag;
+	int	xflag;
+	int	Xflag;
+	int	Aflag;
+	int	print;			/* 0 = only count the packets */
+};
+
+#define DEGRADE_CALM	5	/* seconds without drops before a step up */
+
+static int degrade;			/* --degrade */
+static struct degrade_step *degrade_steps;	/* degrade_nsteps of them */
+static u_int degrade_nsteps;
+static volatile sig_atomic_t degrade_level;	/* step being used */
+static sig_atomic_t degrade_seen;	/* step ndo last saw */
+static uint64_t degrade_unprinted;	/* counted but not printed */
+static uint64_t degrade_changes;	/* steps down or up */
+static netdissect_options *latency_ndo;	/* the one timing the replies */
+static int ptp_stats;			/* --ptp-stats */
+static int ptp_interval;		/* --ptp-stats=seconds */
+static time_t ptp_next;			/* packet time of the next report */
+static netdissect_options *ptp_ndo;	/* the one timing PTP */
+static int hw_tstamp;			/* --hw-time-stamp, or 0 */
+#define HW_TSTAMP_ARISTA	1	/* the Arista header */
+#define HW_TSTAMP_METAMAKO	2	/* the Metamako trailer */
+static int hw_tstamp_nano;		/* the capture's are in nanoseconds */
+static netdissect_options *bgp_summary_ndo;	/* the one counting prefixes */
+static netdissect_options *bgp_peers_ndo;	/* the one counting messages */
+static netdissect_options *openflow_ndo;	/* the one counting OpenFlow */
+static char *tap_file_name;		/* --extract-payloads */
+static netdissect_options *tap_ndo;	/* the one extracting payloads */
+static netdissect_options *lsdb_ndo;	/* the one keeping the LSDB */
+static netdissect_options *ppp_ndo;	/* the one tracking PPP sessions */
+static netdissect_options *mcast_ndo;	/* the one tracking groups */
+static netdissect_options *label_ndo;	/* the one tracking labels */
+static netdissect_options *tcp_analysis_ndo;	/* the one analyzing TCP */
+static netdissect_options *mptcp_ndo;		/* the one tracking MPTCP */
+static netdissect_options *rtp_ndo;		/* the one analyzing RTP */
+static int rtp_interval;			/* --rtp-analysis=seconds */
+static time_t rtp_next;				/* packet time of the next report */
+static netdissect_options *bfd_ndo;		/* the one tracking BFD */
+static netdissect_options *someip_ndo;		/* the one counting SOME/IP */
+static netdissect_options *v2x_ndo;		/* the one tracking V2X stations */
+static int v2x_interval;			/* --v2x-stations=seconds */
+static time_t v2x_next;				/* packet time of the next report */
+#ifdef ENABLE_DISSECTOR_PROFILE
+static int profile_dissectors;		/* --profile-dissectors */
+static netdissect_options *profile_ndo;	/* the one being profiled */
+static int snaplen_report;		/* --snaplen-report */
+static netdissect_options *snaplen_ndo;	/* the one being accounted */
+#endif
 
 static int infodelay;
 static int infoprint;
@@ -254,7 +480,20 @@ static NORETURN void show_remote_devices_and_exit(void);
 static void print_packet(u_char *, const struct pcap_pkthdr *, const u_char *);
 static void dump_packet_and_trunc(u_char *, const struct pcap_pkthdr *, const u_char *);
 static void dump_packet(u_char *, const struct pcap_pkthdr *, const u_char *);
+static void dissect_packet(netdissect_options *, const struct pcap_pkthdr *,
+    const u_char *);
+static void print_dissected(netdissect_options *, const struct pcap_pkthdr *,
+    const u_char *, u_int);
+#ifndef _WIN32
+static void prefetch_next(u_char *, const u_char *, u_int);
+#endif
 static void droproot(const char *, const char *);
+#ifndef _WIN32
+static void report_startup_time(void);
+static void startup_phase(const char *);
+#else
+#define startup_phase(what)
+#endif
 
 #ifdef SIGNAL_REQ_INFO
 static void requestinfo(int);
@@ -264,6 +503,18 @@ static void requestinfo(int);
 static void flushpcap(int);
 #endif
 
+#if defined(HAVE_LIBCRYPTO) && !defined(_WIN32)
+/*
+ * SIGHUP makes the -E secrets be reread.
+ */
+#define ESPSECRET_RELOAD
+static char *espsecret;			/* -E argument */
+static volatile sig_atomic_t espsecret_generation;	/* count of SIGHUPs */
+static sig_atomic_t espsecret_seen;	/* generation ndo last saw */
+static void reload_espsecret(int);
+static void check_espsecret(netdissect_options *, sig_atomic_t *);
+#endif
+
 #ifdef _WIN32
     static HANDLE timer_handle = INVALID_HANDLE_VALUE;
     static void CALLBACK verbose_stats_dump(PVOID param, BOOLEAN timer_fired);
@@ -272,6 +523,33 @@ static void flushpcap(int);
 #endif /* _WIN32 */
 
 static void info(int);
+static void print_proto_stats(void);
+#ifdef KERNEL_COUNTS_SUPPORTED
+static void topn_kernel_counts(netdissect_options *, void *);
+#endif
+static void print_mem_stats(void);
+static void print_ring_stats(void);
+static void print_stream_stats(void);
+static void print_output_stats(void);
+static void flows_finish(void);
+static void print_latency_report(time_t);
+static void print_bgp_summary(void);
+static void print_openflow_summary(void);
+static void print_resp_commands(void);
+static void print_ppp_sessions(void);
+static void print_mcast_groups(void);
+static void print_label_bindings(void);
+static void print_tcp_analysis(void);
+static void print_mptcp_connections(void);
+static void print_rtp_report(time_t);
+static void print_bfd_sessions(void);
+static void print_someip_summary(void);
+static void print_v2x_report(time_t);
+static void print_lsdb_report(void);
+#ifdef ENABLE_DISSECTOR_PROFILE
+static void print_dissector_profile(void);
+static void print_snaplen_report(void);
+#endif
 static u_int packets_captured;
 
 #ifdef HAVE_PCAP_FINDALLDEVS
@@ -304,12 +582,936 @@ struct dump_info {
 	char	*CurrentFileName;
 	pcap_t	*pd;
 	pcap_dumper_t *pdd;
+	struct mmap_savefile *msf;	/* non-NULL if --mmap-savefile */
+	struct pcapng_savefile *ngsf;	/* non-NULL if --pcapng */
+	struct gzip_savefile *gsf;	/* non-NULL if --gzip-savefile */
+	struct uring_savefile *usf;	/* non-NULL if --io-uring */
+	int	recycle_fd;		/* to truncate it, if --recycle-savefiles */
+	struct stream_sink *ssk;	/* non-NULL if -w tcp:// or udp:// */
+	struct shm_ring *srg;		/* non-NULL if -w shm: */
+	struct savefile_index *idx;	/* non-NULL if --write-index */
+	struct flow_index *fidx;	/* non-NULL if --flow-index */
+	uint64_t fidx_off;		/* of the next record, for fidx */
 	netdissect_options *ndo;
 #ifdef HAVE_CAPSICUM
 	int	dirfd;
 #endif
 };
 
+static int capture_batches(pcap_t *, int, pcap_handler, u_char *,
+    struct dump_info *);
+static void degrade_init(const netdissect_options *);
+static void degrade_check(pcap_t *);
+static void degrade_apply(netdissect_options *, sig_atomic_t *);
+#ifdef CONTROL_SOCKET_SUPPORTED
+static void control_command(void *, char *, char *, size_t);
+#endif
+#ifdef METRICS_SUPPORTED
+static void *metrics_main(void *);
+#endif
+static void close_savefile(struct dump_info *);
+static void rotate_savefile(struct dump_info *);
+#ifdef SAVEFILE_CLOCK_SUPPORTED
+static void savefile_clock_check(struct dump_info *);
+#endif
+static void open_pcapng_savefile(struct dump_info *, FILE *);
+#ifdef GZIP_SAVEFILE_SUPPORTED
+static FILE *open_gzip_savefile(struct dump_info *, int);
+#endif
+#ifdef URING_SAVEFILE_SUPPORTED
+static FILE *open_uring_savefile(struct dump_info *);
+#endif
+#ifndef _WIN32
+static FILE *open_recycled_savefile(struct dump_info *);
+#endif
+#if defined(STREAM_SINK_SUPPORTED) || defined(SHM_RING_SUPPORTED)
+static int unfiled_savefile(const char *);
+static size_t make_savefile_header(struct dump_info *, u_char *, size_t);
+#endif
+#ifdef STREAM_SINK_SUPPORTED
+static void open_stream_sink(struct dump_info *);
+#endif
+#ifdef SHM_RING_SUPPORTED
+static void open_shm_ring(struct dump_info *);
+#endif
+static void pcapng_write_stats(struct dump_info *, struct pcapng_savefile *);
+static void open_savefile_index(struct dump_info *, int);
+static void open_flow_index(struct dump_info *, int);
+static pcap_t *open_savefile(netdissect_options *, const char *, int *,
+    char *);
+
+/*
+ * The part of the savefile to read (--start-time, --end-time and
+ * --start-packet).  The packets before it are skipped, going straight
+ * to the one with the last entry in the savefile's index (if it has
+ * one) before it, and reading stops at the first packet after it.
+ * The filter is applied to the packets in it rather than set on the
+ * pcap_t, so that all the packets are counted.
+ */
+struct range_time {
+	int	set;
+	nd_ts_t	ts;
+};
+
+struct range_info {
+	pcap_handler callback;		/* for the packets in the range */
+	u_char	*user;
+	const struct bpf_program *fcode;
+	int	cnt;			/* -c, counting packets in the range */
+	int	npackets;		/* packets handed to callback */
+	uint64_t packet;		/* number of the last packet read */
+	int	nano;			/* time stamps are in nanoseconds */
+	int	done;			/* went past the end */
+};
+
+static int range_active;		/* any of them given */
+static struct range_time range_start;	/* --start-time */
+static struct range_time range_end;	/* --end-time */
+static u_long range_start_packet;	/* --start-packet */
+static struct range_info range;
+
+static void parse_range_time(const char *, struct range_time *);
+static void range_seek(pcap_t *, const char *);
+static void range_packet(u_char *, const struct pcap_pkthdr *,
+    const u_char *);
+static void build_savefile_index(netdissect_options *, pcap_t *,
+    const char *);
+
+/*
+ * Sampling (--sample, --flow-sample).
+ *
+ * Only one packet in every sample_rate is handed on to be printed or
+ * written: with --sample, every sample_rate'th packet, starting with
+ * the first, and with --flow-sample, the packets of the flows that hash
+ * to a multiple of it, so that the packets of a flow, in both
+ * directions, are all kept or all skipped; packets that aren't IP are
+ * sampled one in sample_rate as for --sample.  The skipped packets
+ * still count as captured, so -# numbers them as if they'd been kept,
+ * and the packets and bytes kept and skipped are reported at the end so
+ * that the counts seen can be scaled back up.
+ */
+struct sample_info {
+	pcap_handler callback;		/* for the packets kept */
+	u_char	*user;
+	int	dlt;
+	int	frag_whole;		/* --ip-reassembly; see flow_hash() */
+	uint64_t packet;		/* packets sampled by count */
+	uint64_t kept, kept_bytes;
+	uint64_t skipped, skipped_bytes;
+};
+
+static u_int sample_rate;		/* 1 in this many, 0 = off */
+static int sample_flows;		/* --flow-sample rather than --sample */
+static struct sample_info sample;
+
+static u_int parse_sample_rate(const char *, const char *);
+static void sample_packet(u_char *, const struct pcap_pkthdr *,
+    const u_char *);
+static uint32_t flow_hash(int, int, const struct pcap_pkthdr *,
+    const u_char *);
+static void print_sample_stats(void);
+static int decap_find(int, const struct pcap_pkthdr *, const u_char *,
+    const u_char **, uint32_t *);
+
+/*
+ * Host allowlists (--hosts-file).
+ *
+ * Only the IPv4 and IPv6 packets with a source or destination address
+ * in the set loaded, or in one of its prefixes, are handed on to be
+ * printed or written; looking an address up costs the same however
+ * many there are, where a filter of as many "host" terms runs through
+ * them all for every packet.  Packets that aren't IP, or whose
+ * link-layer type isn't one of the common ones, are skipped.  As with
+ * --sample, the skipped packets still count as captured, and the
+ * packets kept and skipped are reported at the end.
+ */
+struct hosts_info {
+	pcap_handler callback;		/* for the packets kept */
+	u_char	*user;
+	int	dlt;
+	struct host_set *set;
+	uint64_t kept, kept_bytes;
+	uint64_t skipped, skipped_bytes;
+};
+
+static const char *hosts_file;		/* --hosts-file */
+static struct hosts_info hosts;
+
+static void hosts_packet(u_char *, const struct pcap_pkthdr *,
+    const u_char *);
+static const u_char *link_payload(int, const struct pcap_pkthdr *,
+    const u_char *, u_int *);
+static void print_hosts_stats(void);
+
+/*
+ * Payload searches (--payload-match).
+ *
+ * Only the packets whose payload holds one of the patterns in the file
+ * are handed on to be printed or written, as with "-A | grep -F -f"
+ * but without formatting every packet to search it.  The payload is
+ * what follows the TCP, UDP, SCTP, ICMP or ICMPv6 header of an IP
+ * packet, or its IP header for other protocols and later fragments,
+ * as flow_trunc_len() finds it; for packets that aren't IP, it's what
+ * follows the link-layer header, or the whole packet if the
+ * link-layer type isn't one of the common ones.  The skipped packets
+ * still count as captured, and the packets kept and skipped are
+ * reported at the end.
+ */
+struct payload_info {
+	pcap_handler callback;		/* for the packets kept */
+	u_char	*user;
+	int	dlt;
+	struct payload_matcher *matcher;
+	uint64_t kept, kept_bytes;
+	uint64_t skipped, skipped_bytes;
+};
+
+static const char *payload_file;	/* --payload-match */
+static struct payload_info payload;
+
+static void payload_packet(u_char *, const struct pcap_pkthdr *,
+    const u_char *);
+static u_int flow_trunc_len(int, const struct pcap_pkthdr *, const u_char *,
+    int *);
+static void print_payload_stats(void);
+
+/*
+ * Duplicate suppression (--dedup).
+ *
+ * Packets that are copies of one seen within the last dedup_window
+ * microseconds, as when a tap or SPAN port delivers a frame once on
+ * the way in and again on the way out, aren't handed on to be printed
+ * or written.  With ",ttl", only the IPv4 or IPv6 packet from its
+ * header on is compared, without the TTL or hop limit and the header
+ * checksum, so that a packet copied on both sides of a router is
+ * caught too.  The duplicates still count as captured, and the
+ * packets kept and dropped are reported at the end.
+ */
+struct dedup_info {
+	pcap_handler callback;		/* for the packets kept */
+	u_char	*user;
+	int	dlt;
+	int	nano;			/* time stamps in nanoseconds */
+	struct dedup_table *table;
+	uint64_t kept, kept_bytes;
+	uint64_t dups, dup_bytes;
+};
+
+static u_int dedup_window;		/* --dedup, microseconds, 0 = off */
+static int dedup_ip;			/* --dedup=...,ttl */
+static struct dedup_info dedup;
+
+static void parse_dedup(const char *);
+static void dedup_packet(u_char *, const struct pcap_pkthdr *,
+    const u_char *);
+static void print_dedup_stats(void);
+
+/*
+ * Printing packets from memory (--memo); see netdissect-memo.h.  Each
+ * thread that prints has a memo of its own, and the chunk and file
+ * threads' counts are added to memo_done when they finish.
+ */
+static u_int memo_entries;		/* --memo, 0 = off */
+static u_int memo_mode;			/* ND_MEMO_... */
+static struct nd_memo_ignore memo_ignore[ND_MEMO_MAX_IGNORE];
+static u_int memo_nignore;		/* --memo-ignore */
+static netdissect_options *memo_ndo;	/* the one printing */
+static struct nd_memo_stats memo_done;
+
+static void parse_memo(const char *);
+static void parse_memo_ignore(const char *);
+static void memo_release(netdissect_options *);
+static void print_memo_stats(void);
+
+/*
+ * Per-flow truncation (--flow-truncate).
+ *
+ * The first flow_trunc_packets packets of each IP flow, in both
+ * directions, are written whole, or only those among them up to the
+ * first flow_trunc_bytes bytes if that's set, and for the rest only
+ * the link-layer, IP and transport headers are written, so that the
+ * handshakes are kept and the bulk data isn't.  The flows are counted
+ * in a table of FLOW_TRUNC_SLOTS entries indexed by the same hash as
+ * --flow-sample, in which a flow that hashes to the slot of another
+ * takes it over; a TCP SYN, or FLOW_TRUNC_IDLE seconds without a
+ * packet, starts a flow afresh.  Packets that aren't IP are written
+ * whole.  What was truncated is reported at the end.
+ */
+#define FLOW_TRUNC_SLOTS	65536	/* a power of 2 */
+#define FLOW_TRUNC_IDLE		60	/* seconds */
+
+struct flow_trunc_entry {
+	uint32_t hash;			/* 0 = unused */
+	uint32_t packets;		/* written whole */
+	uint64_t bytes;
+	time_t	last;			/* packet time of the last packet */
+};
+
+struct flow_trunc_info {
+	int	dlt;
+	struct flow_trunc_entry *table;
+	uint64_t whole;
+	uint64_t truncated, saved_bytes;
+};
+
+static u_int flow_trunc_packets;	/* --flow-truncate, 0 = off */
+static uint64_t flow_trunc_bytes;	/* --flow-truncate=...,bytes */
+static struct flow_trunc_info flow_trunc;
+
+static void parse_flow_trunc(const char *);
+static const struct pcap_pkthdr *flow_trunc_header(
+    const struct pcap_pkthdr *, const u_char *, struct pcap_pkthdr *);
+static void print_flow_trunc_stats(void);
+
+/*
+ * Anonymization of what's written (--anonymize).
+ *
+ * Each packet written is copied to anon_buf and its Ethernet, ARP and
+ * IP addresses replaced, as anonymize.c describes, before it's handed
+ * to the writer; what's printed isn't changed.
+ */
+static const char *anon_keyfile;	/* --anonymize */
+static struct anon_state *anon;
+static u_char *anon_buf;		/* MAXIMUM_SNAPLEN bytes */
+static int anon_dlt;
+static uint64_t anon_packets;
+
+static const u_char *anon_data(const struct pcap_pkthdr *, const u_char *);
+static void print_anon_stats(void);
+
+/*
+ * Savefiles per tenant (--split-by).
+ *
+ * The packets to be written that are in a VXLAN or Geneve tunnel, or,
+ * with --split-by=vlan, that have an 802.1Q tag, are written to a
+ * savefile of their own for the VNI of the outermost tunnel or the
+ * first VLAN ID, as split-savefile.h describes, instead of to the -w
+ * file, which gets the rest.  With --inner-filter or --write-inner the
+ * VNI is the one found when the packet was decapsulated, as the frame
+ * handed on may no longer have it.
+ */
+#define SPLIT_BY_VNI	1
+#define SPLIT_BY_VLAN	2
+
+static int split_by;			/* --split-by, SPLIT_BY_ or 0 */
+static u_int split_open_files = SPLIT_SAVEFILE_OPEN;	/* --split-open-files */
+static int split_dlt;
+static struct split_savefile *split;
+
+static int split_dump(const struct pcap_pkthdr *, const u_char *,
+    const struct pcap_pkthdr *, const u_char *);
+static void print_split_stats(void);
+
+/*
+ * With --follow, the -r savefile is read as it's written, as
+ * follow-reader.h describes.  With -C, it's the first of the files a
+ * "tcpdump -w" with the same -C, and -W, rotates through, and the reads
+ * go on from each to the next one MakeFilename() names.
+ */
+static int follow;			/* --follow */
+#ifdef FOLLOW_READER_SUPPORTED
+static struct follow_reader *follow_reader;
+static char *follow_name;		/* -r name the file names are made from */
+static int follow_count;
+static uint64_t follow_files;		/* once the reader's gone */
+
+static void follow_next_name(void *, char *, size_t);
+#endif
+static void print_follow_stats(void);
+
+/*
+ * The flow to read (--flow).
+ *
+ * flow_sel_packet() hands on only the packets of the flow, in either
+ * direction.  If the savefile has a flow index (--flow-index), only
+ * the records it lists for the flow's hash, and those past what it
+ * covers, are read, by flow_sel_loop(), which applies the filter
+ * itself, as the pcap_t would read on past a record the filter
+ * rejects; otherwise the whole savefile is read.
+ */
+#define SAVEFILE_RECORD_HDRLEN	16	/* of a pcap savefile record */
+
+struct flow_sel_info {
+	int	set;
+	u_int	version;		/* 4 or 6 */
+	u_int	proto;
+	u_char	addr[2][16];
+	u_int	port[2];
+	uint32_t hash;			/* flow_hash() of its packets */
+	pcap_handler callback;
+	u_char	*user;
+	int	dlt;
+	int	cnt;			/* -c */
+	int	npackets;
+	int	done;
+	int	indexed;		/* flow_offsets are in use */
+};
+
+static struct flow_sel_info flow_sel;
+static uint64_t *flow_offsets;		/* of the flow's records */
+static size_t flow_noffsets;
+static uint64_t flow_index_end;		/* where the index stops */
+
+static void parse_flow_sel(const char *);
+static void flow_sel_open(pcap_t *, const char *);
+static void flow_sel_packet(u_char *, const struct pcap_pkthdr *,
+    const u_char *);
+static int flow_sel_loop(pcap_t *, const char *, const struct bpf_program *,
+    pcap_handler, u_char *);
+
+/*
+ * Beacon statistics (--beacon-stats).
+ *
+ * 802.11 beacons that repeat the last one from their BSSID are counted
+ * by ieee802_11_beacon_repeat() and not handed on; the counts for each
+ * BSSID are reported at the end.
+ */
+struct beacon_info {
+	pcap_handler callback;		/* for the packets kept */
+	u_char	*user;
+	netdissect_options *ndo;	/* the one counting them */
+	int	radiotap;		/* DLT_IEEE802_11_RADIO */
+	uint64_t repeats;
+};
+
+static int beacon_stats;		/* --beacon-stats */
+static struct beacon_info beacon;
+
+static void beacon_packet(u_char *, const struct pcap_pkthdr *,
+    const u_char *);
+static void print_beacon_stats(void);
+
+/*
+ * The LLDP and CDP neighbor table (--neighbors).
+ *
+ * Advertisements that repeat the last one from their neighbor, before
+ * its time to live has run out, are counted by neighbor_repeat() and
+ * not handed on; the counts for each neighbor are reported at the end.
+ */
+struct neighbor_info {
+	pcap_handler callback;		/* for the packets kept */
+	u_char	*user;
+	netdissect_options *ndo;	/* the one keeping the table */
+	uint64_t repeats;
+};
+
+static int neighbors;			/* --neighbors */
+static struct neighbor_info neighbor;
+
+static void neighbor_packet(u_char *, const struct pcap_pkthdr *,
+    const u_char *);
+static void print_neighbors(void);
+
+/*
+ * 802.15.4 frame counts (--wpan-stats).
+ *
+ * Each frame is counted against its source PAN ID and address by
+ * ieee802_15_4_count(), and handed on; the counts for each source are
+ * reported at the end.
+ */
+struct wpan_info {
+	pcap_handler callback;		/* for all the packets */
+	u_char	*user;
+	netdissect_options *ndo;	/* the one counting them */
+	int	tap;			/* DLT_IEEE802_15_4_TAP */
+};
+
+static int wpan_stats;			/* --wpan-stats */
+static struct wpan_info wpan;
+
+static int wpan_dlt(int);
+static void wpan_packet(u_char *, const struct pcap_pkthdr *,
+    const u_char *);
+static void print_wpan_stats(void);
+
+/*
+ * Tunnel decapsulation (--inner-filter, --write-inner).
+ *
+ * The packets that pass the filter are looked into, through IP-in-IP,
+ * GRE, MPLS, VXLAN, Geneve and MPLS over UDP, down to the innermost
+ * Ethernet frame or IP packet, without copying them; --inner-filter is
+ * matched against that, compiled for Ethernet or raw IP, or against the
+ * packet itself if it isn't encapsulated, and only the packets that
+ * match are handed on.  With --write-inner, what's handed on, to be
+ * printed or written, is the innermost frame, with a zeroed Ethernet
+ * header put in front of an IP packet; that needs an Ethernet capture,
+ * so that the savefile's link-layer type fits.
+ */
+#define DECAP_NONE		0
+#define DECAP_ETHER		1	/* an Ethernet frame */
+#define DECAP_IP		2	/* an IPv4 or IPv6 packet */
+#define DECAP_MAX_DEPTH		8	/* encapsulations looked into */
+#define DECAP_NO_VNI		0xffffffffU
+
+struct decap_info {
+	pcap_handler callback;		/* for the packets that match */
+	u_char	*user;
+	int	dlt;
+	struct bpf_program fcode;	/* for packets not encapsulated */
+	struct bpf_program ether_fcode;	/* for inner Ethernet frames */
+	struct bpf_program ip_fcode;	/* for inner IP packets */
+	u_char	*buf;			/* for an inner IP packet written */
+	size_t	bufsize;
+	uint64_t decapsulated;		/* packets that were encapsulated */
+	uint64_t matched;		/* packets handed on */
+	uint32_t vni;			/* of the packet handed on */
+};
+
+static char *decap_filter;		/* --inner-filter expression */
+static int decap_write_inner;		/* --write-inner */
+static struct decap_info decap;
+
+static void decap_open(pcap_t *, int, bpf_u_int32);
+static void decap_packet(u_char *, const struct pcap_pkthdr *,
+    const u_char *);
+static void print_decap_stats(void);
+
+/*
+ * Flight recorder (--flight-recorder).
+ *
+ * Rather than being written with -w as they come, the packets are kept
+ * in a ring, allocated once, with each packet's header just before its
+ * data; the oldest packets are dropped to make room for new ones, and,
+ * with --flight-window, once they're that many seconds older than the
+ * newest.  When a packet matches the --flight-trigger filter, or on
+ * SIGUSR2, the packets in the ring are written out, followed by those
+ * of the next --flight-after seconds, and then they're kept in the ring
+ * again.  A packet that matches the --flight-start filter does the
+ * same, except that the packets go on being written out as they come
+ * until one matches the --flight-stop filter, and only then for the
+ * next --flight-after seconds.
+ */
+#define FLIGHT_DEFAULT_AFTER	10	/* seconds */
+#define FLIGHT_ALIGN(n)		(((n) + 7) & ~(size_t)7)
+#define FLIGHT_HDRLEN		FLIGHT_ALIGN(sizeof(struct pcap_pkthdr))
+
+struct flight_info {
+	pcap_handler callback;		/* that writes the packets out */
+	u_char	*user;
+	u_char	*ring;
+	size_t	size;			/* of the ring */
+	size_t	head;			/* offset of the oldest packet */
+	size_t	tail;			/* where the next packet goes */
+	size_t	end;			/* end of the packets after head, if wrapped */
+	int	wrapped;		/* packets at the start follow those at head */
+	u_int	npackets;		/* in the ring */
+	time_t	until;			/* writing out until then, if after */
+	int	after_trigger;		/* writing packets out as they come */
+	int	started;		/* ... until --flight-stop matches */
+	struct bpf_program fcode;	/* --flight-trigger */
+	struct bpf_program start_fcode;	/* --flight-start */
+	struct bpf_program stop_fcode;	/* --flight-stop */
+};
+
+static size_t flight_size;		/* --flight-recorder bytes, 0 = off */
+static int flight_window;		/* --flight-window seconds, 0 = none */
+static int flight_after = FLIGHT_DEFAULT_AFTER;	/* --flight-after */
+static char *flight_trigger;		/* --flight-trigger expression */
+static char *flight_start;		/* --flight-start expression */
+static char *flight_stop;		/* --flight-stop expression */
+static struct flight_info flight;
+#ifdef SIGUSR2
+static volatile sig_atomic_t flight_signals;	/* count of SIGUSR2s */
+static sig_atomic_t flight_signals_seen;
+static void flight_signal(int);
+#endif
+
+static void flight_packet(u_char *, const struct pcap_pkthdr *,
+    const u_char *);
+#ifndef _WIN32
+static struct mmap_savefile *open_mmap_savefile(pcap_t *, int, const char *);
+#endif
+
+#ifdef HAVE_PTHREADS
+/*
+ * Savefile writer thread (--writer-thread).
+ *
+ * The capture thread only copies each packet into the fill buffer;
+ * the writer thread takes that buffer, leaving the other (empty) one
+ * to be filled, and does all of the savefile writing, rotation and
+ * compression hand-off, so that a stalled disk doesn't hold up the
+ * capture until both buffers are full.
+ */
+#define WRITER_BUFSIZE	(4 * 1024 * 1024)
+
+struct writer_buffer {
+	u_char	*data;
+	size_t	len;
+};
+
+static int writer_thread;		/* --writer-thread */
+static pthread_t writer_tid;
+static pthread_mutex_t writer_mtx = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t writer_cv = PTHREAD_COND_INITIALIZER;	/* data to write */
+static pthread_cond_t capture_cv = PTHREAD_COND_INITIALIZER;	/* buffer written */
+static struct writer_buffer writer_bufs[2];
+static struct writer_buffer *writer_fill = &writer_bufs[0];
+static int writer_busy;			/* writer is writing the other buffer */
+static int writer_ticked;		/* the savefile clock woke the writer */
+
+static void writer_start(struct dump_info *);
+#ifdef SAVEFILE_CLOCK_SUPPORTED
+static void writer_wake(void *);
+#endif
+static void writer_enqueue(const struct pcap_pkthdr *, const u_char *);
+static void writer_drain(void);
+
+static void start_thread(pthread_t *, void *(*)(void *), void *,
+    const char *);
+#endif /* HAVE_PTHREADS */
+
+#ifdef CPU_AFFINITY_SUPPORTED
+/*
+ * Binding the stages of the capture to CPUs (--cpu-affinity and
+ * --numa-node).
+ *
+ * Each thread of a stage is bound to the next CPU of the stage's set
+ * in turn, when it's started.  The main thread, which reads the
+ * capture with one interface, and dissects the packets unless
+ * --dissect-threads is given, is bound before the interface is
+ * opened.  With --numa-node, so that the capture buffer and the
+ * buffers between the stages are put in the memory of the node the
+ * network adapter is on, the main thread is first bound to all the
+ * CPUs of that node, and the threads of the stages not given to
+ * --cpu-affinity stay on them, as they start out there.
+ */
+struct affinity_stage {
+	const char *name;		/* for --cpu-affinity */
+	const char *what;		/* as handed to start_thread() */
+	struct cpu_affinity *cpus;
+	int next;			/* the CPU of its next thread */
+};
+
+static struct affinity_stage affinity_stages[] = {
+	{ "main", NULL, NULL, 0 },
+	{ "capture", "capture", NULL, 0 },
+	{ "dissect", "dissection", NULL, 0 },
+	{ "output", "output", NULL, 0 },
+	{ "writer", "savefile writer", NULL, 0 },
+	{ NULL, NULL, NULL, 0 }
+};
+
+static const char *numa_node;		/* --numa-node */
+
+static void affinity_option(const char *);
+static void affinity_setup(const char *);
+#endif /* CPU_AFFINITY_SUPPORTED */
+
+#if defined(HAVE_PTHREADS) && !defined(ND_NO_THREAD_LOCAL)
+#define DISSECT_THREADS_SUPPORTED
+/*
+ * Parallel dissection (--dissect-threads).
+ *
+ * The capture thread copies each packet into the next free slot of a
+ * ring and queues the slot for one of the worker threads, each of
+ * which has its own netdissect_options and dissects its queued slots
+ * in order, with its output going to the slot rather than to the
+ * standard output; the output thread writes the output of each slot
+ * in turn, so the output remains in the order in which the packets
+ * were captured.
+ *
+ * Printers such as the TCP, NFS, RX and ISAKMP printers remember
+ * things from earlier packets of a flow, and each worker has its own
+ * copy of that state, so the packet is given to a worker chosen by a
+ * hash of its addresses and ports that's the same for both directions
+ * of the flow; all packets of a flow are thus dissected, in order, by
+ * the same worker.
+ *
+ * With --worker-output, each worker writes its output to a file of its
+ * own instead, with the packet numbers, and frees the slot as soon as
+ * the packet's dissected; there's no output thread, and no waiting for
+ * the workers with earlier packets, and the files can be merged by
+ * packet number afterwards.
+ */
+#define PIPELINE_SLOTS	1024
+
+#define SLOT_FREE	0	/* available to the capture thread */
+#define SLOT_QUEUED	1	/* waiting to be dissected */
+#define SLOT_BUSY	2	/* being dissected */
+#define SLOT_DONE	3	/* waiting to be written out */
+
+struct pipeline_slot {
+	struct pcap_pkthdr hdr;
+	u_char	*data;		/* copy of the packet data */
+	u_int	datasize;	/* allocated size of data */
+	u_int	packet_number;
+	char	*text;		/* dissected output */
+	size_t	textlen;
+	size_t	textsize;	/* allocated size of text */
+	int	state;
+};
+
+struct pipeline_worker {
+	pthread_t tid;
+	netdissect_options ndo;
+	struct pipeline_slot *slot;	/* slot being dissected */
+	const struct addrtoname_tables *tables;
+	struct pipeline_slot *queue[PIPELINE_SLOTS];	/* slots to dissect */
+	u_int	qhead;			/* next slot to dissect */
+	u_int	qtail;			/* next free queue entry */
+	pthread_cond_t cv;		/* slot queued */
+	FILE	*out;			/* --worker-output file, or NULL */
+#ifdef ESPSECRET_RELOAD
+	sig_atomic_t espsecret_seen;	/* generation ndo last saw */
+#endif
+	sig_atomic_t degrade_seen;	/* --degrade step ndo last saw */
+	uint64_t packets;		/* dissected */
+	uint64_t busy_ns;		/* spent dissecting them */
+	u_int	qpeak;			/* most packets queued at once */
+};
+
+static int dissect_threads;		/* --dissect-threads */
+static const char *worker_output;	/* --worker-output prefix */
+static struct pipeline_slot pl_slots[PIPELINE_SLOTS];
+static struct pipeline_worker *pl_workers;
+static pthread_t pl_output_tid;
+static int pl_dlt;			/* link-layer type being dissected */
+static int pl_frag_whole;		/* all fragments hash on addresses */
+static u_int pl_next_fill;		/* next slot to fill */
+static u_int pl_next_emit;		/* next slot to write out */
+static u_int pl_peak;			/* most slots in use at once */
+static uint64_t pl_waits;		/* times the capture waited for a slot */
+static pthread_mutex_t pl_mtx = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t pl_emit_cv = PTHREAD_COND_INITIALIZER;	/* slot done */
+static pthread_cond_t pl_free_cv = PTHREAD_COND_INITIALIZER;	/* slot freed */
+
+static void pipeline_start(netdissect_options *, int);
+static void pipeline_enqueue(const struct pcap_pkthdr *, const u_char *);
+static void pipeline_drain(void);
+static void print_pipeline_stats(void);
+static void worker_ndo_init(netdissect_options *, const netdissect_options *);
+#endif /* defined(HAVE_PTHREADS) && !defined(ND_NO_THREAD_LOCAL) */
+
+#if defined(PACKET_RING_SUPPORTED) && !defined(ND_NO_THREAD_LOCAL)
+/*
+ * Printing on a thread of its own (--print-thread).
+ *
+ * The capture thread only copies each packet into a ring allocated up
+ * front; the print thread takes the packets out in order, and dissects
+ * and prints them with the netdissect_options that the capture thread
+ * would have used and no longer touches.  A burst that the printing
+ * can't keep up with waits in the ring, rather than filling the kernel's
+ * buffer, which is much smaller and can't be enlarged as far.
+ *
+ * When a capture is also being written with -w, the savefile matters
+ * more than the printing, so a packet that finds the ring full isn't
+ * printed, and is counted, rather than holding up the capture.
+ */
+#define PRINT_THREAD_SUPPORTED
+
+#define PRINT_RING_DEFAULT_SIZE	64	/* megabytes */
+
+static size_t print_ring_size;		/* --print-thread, bytes, or 0 */
+static struct packet_ring *print_ring;	/* while the thread's running */
+static int print_lossy;			/* drop rather than wait when it's full */
+static pthread_t print_tid;
+static const struct addrtoname_tables *print_tables;
+
+static void print_thread_start(netdissect_options *);
+#endif
+
+#ifdef OUTPUT_BUFFER_SUPPORTED
+/*
+ * Writing the printed output on a thread of its own (--output-thread).
+ *
+ * The printed output goes into a buffer that a thread writes to the
+ * standard output, so that when the program reading from the pipe falls
+ * behind, the printing goes on until the buffer is full rather than
+ * until the pipe is; then it either waits for the reader or throws the
+ * output away (",drop").
+ */
+#define OUTPUT_BUFFER_DEFAULT_SIZE	16	/* megabytes */
+
+static size_t output_buffer_size;	/* --output-thread, bytes, or 0 */
+static int output_drop;			/* --output-thread=...,drop */
+static struct output_buffer *output_buffer;	/* while the thread runs */
+static pthread_t output_tid;
+
+static void output_thread_start(netdissect_options *);
+#endif
+
+#if defined(DISSECT_THREADS_SUPPORTED) && !defined(_WIN32)
+#define CHUNK_THREADS_SUPPORTED
+/*
+ * Parallel dissection of a savefile by chunk (--chunk-threads).
+ *
+ * The pcap records of the savefile are split into as many runs of
+ * about the same size as there are threads, and each thread reads its
+ * run through its own mapping of the file and dissects it with its own
+ * netdissect_options.  The first thread writes to the standard output;
+ * the others write to temporary files, which are copied to the
+ * standard output in turn once the thread before has finished.
+ *
+ * The saved state of printers such as the TCP printer is per-thread,
+ * so it only covers earlier packets in the same chunk; e.g., a TCP
+ * connection that spans two chunks has absolute sequence numbers in
+ * the first packet of it in the second chunk.  Use -S for output that
+ * doesn't depend on where the file was split.
+ *
+ * The split points other than the first are guessed without reading
+ * the file up to them (see mmap_reader_split()); if the thread before
+ * a chunk doesn't finish exactly where that chunk starts, the guess
+ * was wrong, so the output of that chunk and the ones after it is
+ * thrown away and the rest of the file is dissected by the main
+ * thread instead.
+ */
+struct chunk_worker {
+	pthread_t tid;
+	netdissect_options ndo;
+	const struct addrtoname_tables *tables;
+	const struct bpf_program *fcode;
+	struct mmap_reader *mr;
+	FILE	*out;			/* where the output goes */
+	u_int	npackets;		/* packets dissected */
+	int	status;			/* from mmap_reader_loop() */
+	char	ebuf[PCAP_ERRBUF_SIZE];
+};
+
+static int chunk_threads;		/* --chunk-threads */
+static struct chunk_worker *chunk_workers;	/* while they're running */
+
+static int chunk_run(netdissect_options *, const char *,
+    const struct bpf_program *, pcap_handler, u_char *, char *);
+#endif /* defined(DISSECT_THREADS_SUPPORTED) && !defined(_WIN32) */
+
+#if defined(DISSECT_THREADS_SUPPORTED) && !defined(_WIN32)
+#define FILE_THREADS_SUPPORTED
+/*
+ * Concurrent dissection of the savefiles of a -V list (--file-threads,
+ * --merge-by-time).
+ *
+ * Up to file_threads savefiles are read at a time, each on its own
+ * thread with its own pcap_t and netdissect_options.  The savefiles
+ * are opened, and the filter compiled for them, by the main thread,
+ * as pcap_compile() isn't thread-safe in all versions of libpcap.
+ *
+ * By default the output of each savefile goes to a temporary file
+ * (other than that of the first one, which goes straight to the
+ * standard output), which is copied to the standard output once the
+ * savefiles before it have been; the output is the same as without
+ * --file-threads, other than that the saved state of printers such as
+ * the TCP printer only covers earlier packets in the same savefile.
+ *
+ * With --merge-by-time, each packet's output is written to the
+ * temporary file as a record with the packet's time stamp, and once
+ * all the savefiles have been read the records of all of them are
+ * merged in time stamp order, packets with the same time stamp going
+ * in the order of their savefiles in the list.  That needs a
+ * temporary file per savefile to be open at the end.
+ */
+struct file_job {
+	pthread_t tid;
+	netdissect_options ndo;
+	const struct addrtoname_tables *tables;
+	pcap_t	*pd;			/* non-null while in use */
+	FILE	*out;			/* where the output goes */
+	char	*rec;			/* the packet being printed */
+	size_t	reclen;
+	size_t	recsize;
+	u_int	npackets;		/* packets dissected */
+	int	status;			/* from pcap_loop() */
+};
+
+/*
+ * Header of a packet's record in a --merge-by-time temporary file;
+ * it's followed by len bytes of output.
+ */
+struct file_record {
+	nd_ts_t	ts;
+	size_t	len;
+};
+
+static int file_threads;		/* --file-threads */
+static int merge_by_time;		/* --merge-by-time */
+static struct file_job *file_jobs;	/* file_threads of them */
+
+static int file_run(netdissect_options *, FILE *, char *, int,
+    bpf_u_int32);
+#endif /* defined(DISSECT_THREADS_SUPPORTED) && !defined(_WIN32) */
+
+#if defined(HAVE_PTHREADS) && defined(HAVE_PCAP_BREAKLOOP)
+#define MULTI_IFACE_SUPPORTED
+/*
+ * Capture on more than one interface (-i given more than once).
+ *
+ * The interfaces are all opened, and have the filter compiled for and
+ * set on them, by the main thread, and each then has a capture thread
+ * of its own, which only copies its packets to the end of its queue.
+ * The main thread merges the queues in time stamp order, taking the
+ * oldest of the packets at their fronts once every interface that's
+ * still capturing has a packet queued, or once that packet has been
+ * queued for longer than the capture timeout plus MULTI_HOLD_MS, so
+ * that a quiet interface doesn't hold up the others for long.  The
+ * packets are printed with the name of their interface after the time
+ * stamp, or written with -w to a pcapng savefile with an interface
+ * description block for each interface.
+ *
+ * A capture thread waits for room once MULTI_MAX_QUEUED of its
+ * packets are queued, so that if the main thread can't keep up, it's
+ * the kernel that drops the packets, and they show up in the
+ * statistics.
+ */
+#define MULTI_HOLD_MS		100
+#define MULTI_MAX_QUEUED	65536
+
+struct multi_packet {
+	struct multi_packet *next;
+	struct pcap_pkthdr hdr;
+	struct timeval key;		/* what it's merged by */
+	struct timeval queued;		/* when it was queued */
+	/* followed by hdr.caplen bytes of data */
+};
+
+struct multi_iface {
+	pthread_t tid;
+	const char *name;
+	pcap_t	*pd;
+	if_printer_t printer;		/* for its link-layer header type */
+	int	void_printer;
+	const char *printer_name;
+	struct multi_packet *head;	/* its queue */
+	struct multi_packet *tail;
+	u_int	nqueued;
+	int	running;		/* the capture thread hasn't finished */
+	int	status;			/* from pcap_loop() */
+};
+
+static char **multi_devices;		/* the -i interfaces, in order */
+static int multi_ndevices;
+static struct multi_iface *multi_ifaces;	/* multi_ndevices of them */
+static int multi_stopping;		/* -c count reached */
+static pthread_mutex_t multi_mtx = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t multi_cv = PTHREAD_COND_INITIALIZER;	/* packet queued */
+static pthread_cond_t multi_room_cv = PTHREAD_COND_INITIALIZER;	/* packet taken */
+
+static void multi_open(netdissect_options *, const char *, char *);
+static void multi_setfilter(char *, int, bpf_u_int32);
+static int multi_run(netdissect_options *, int, pcap_handler, u_char *,
+    int, char *);
+
+#if defined(__linux__) && defined(PACKET_FANOUT)
+#define FANOUT_SUPPORTED
+/*
+ * Capture on one interface through more than one socket (--fanout).
+ *
+ * The interface is opened fanout_count times, as if it had been given
+ * to -i that many times, and the sockets are put in one PACKET_FANOUT
+ * group, so that the kernel shares the packets out among them, by flow
+ * or by the CPU that received them; each socket has a capture thread of
+ * its own, and the packets are merged in time stamp order as for more
+ * than one -i.  As the interface is the same, the packets are printed
+ * without its name and written to an ordinary savefile.  Packets that
+ * arrive while the sockets are being opened may be seen more than once.
+ */
+#define FANOUT_MAX		64
+
+static int fanout_count;		/* --fanout=count */
+static int fanout_mode;			/* PACKET_FANOUT_HASH, ... */
+
+static void fanout_join(pcap_t *, const char *);
+#endif /* defined(__linux__) && defined(PACKET_FANOUT) */
+#endif /* defined(HAVE_PTHREADS) && defined(HAVE_PCAP_BREAKLOOP) */
+
 #if defined(HAVE_PCAP_SET_PARSER_DEBUG)
 /*
  * We have pcap_set_parser_debug() in libpcap; declare it (it's not declared
@@ -400,6 +1602,83 @@ warning(const char *fmt, ...)
 static void
 exit_tcpdump(int status)
 {
+#ifdef OUTPUT_BUFFER_SUPPORTED
+	/* Don't lose what's been printed but not yet written. */
+	if (output_buffer != NULL &&
+	    output_buffer_flush(output_buffer) == -1 && status == S_SUCCESS) {
+		(void)fprintf(stderr, "%s: Unable to write output: %s\n",
+		    program_name, pcap_strerror(errno));
+		status = S_ERR_HOST_PROGRAM;
+	}
+#endif
+#ifndef _WIN32
+	/*
+	 * A --mmap-savefile savefile has to be truncated to the length
+	 * actually written.
+	 */
+	if (mmap_dump_info != NULL && mmap_dump_info->msf != NULL)
+		close_savefile(mmap_dump_info);
+	/* As does a --recycle-savefiles one, once it's been written. */
+	if (recycle_dump_info != NULL && recycle_dump_info->pdd != NULL)
+		close_savefile(recycle_dump_info);
+#endif
+	/* So does a pcapng savefile's buffer, with the statistics. */
+	if (pcapng_dump_info != NULL && pcapng_dump_info->ngsf != NULL)
+		close_savefile(pcapng_dump_info);
+#ifdef STREAM_SINK_SUPPORTED
+	/* And the batches not yet sent to a -w tcp:// or udp:// collector. */
+	if (stream_dump_info != NULL && stream_dump_info->ssk != NULL)
+		close_savefile(stream_dump_info);
+#endif
+#ifdef SHM_RING_SUPPORTED
+	/* And the readers of shared-memory rings are told there's no more. */
+	if (shm_dump_info != NULL && shm_dump_info->srg != NULL)
+		close_savefile(shm_dump_info);
+	if (shm_output_ring != NULL) {
+		shm_ring_close(shm_output_ring);
+		shm_output_ring = NULL;
+	}
+#endif
+	/* And the --split-by savefiles their buffers. */
+	if (split != NULL) {
+		char ebuf[PCAP_ERRBUF_SIZE];
+
+		if (split_savefile_close(split, ebuf) == -1) {
+			(void)fprintf(stderr, "%s: --split-by: %s\n",
+			    program_name, ebuf);
+			if (status == S_SUCCESS)
+				status = S_ERR_HOST_PROGRAM;
+		}
+		split = NULL;
+	}
+#ifdef GZIP_SAVEFILE_SUPPORTED
+	/* And a --gzip-savefile savefile has to end its stream. */
+	if (gzip_dump_info != NULL && gzip_dump_info->gsf != NULL)
+		close_savefile(gzip_dump_info);
+#endif
+#ifdef URING_SAVEFILE_SUPPORTED
+	/*
+	 * And an --io-uring savefile, along with those rotated before it,
+	 * may have writes, an fsync and a close still in flight.
+	 */
+	if (uring_dump_info != NULL) {
+		struct dump_info *dump_info = uring_dump_info;
+		char ebuf[PCAP_ERRBUF_SIZE];
+
+		uring_dump_info = NULL;
+		if (dump_info->usf != NULL)
+			close_savefile(dump_info);
+		if (uring_savefile_finish(ebuf) == -1) {
+			(void)fprintf(stderr, "%s: %s\n", program_name, ebuf);
+			if (status == S_SUCCESS)
+				status = S_ERR_HOST_PROGRAM;
+		}
+	}
+#endif
+#ifdef CONTROL_SOCKET_SUPPORTED
+	if (control != NULL)
+		control_socket_close(control);
+#endif
 	nd_cleanup();
 	exit(status);
 }
@@ -692,6 +1971,122 @@ show_remote_devices_and_exit(void)
 #define OPTION_TSTAMP_NANO		134
 #define OPTION_FP_TYPE			135
 #define OPTION_COUNT			136
+#define OPTION_BATCH_SIZE		137
+#define OPTION_WRITER_THREAD		138
+#define OPTION_MMAP_SAVEFILE		139
+#define OPTION_DISSECT_THREADS		140
+#define OPTION_NAME_CACHE_SIZE		141
+#define OPTION_NAME_CACHE_TTL		142
+#define OPTION_RESOLVER_THREADS		143
+#define OPTION_STARTUP_TIME		144
+#define OPTION_FIELD_OUTPUT		145
+#define OPTION_JSON			146
+#define OPTION_DISABLE_DISSECTOR	147
+#define OPTION_PORT_MAP			148
+#define OPTION_STATS_ONLY		149
+#define OPTION_PROFILE_DISSECTORS	150
+#define OPTION_MMAP_READ		151
+#define OPTION_CHUNK_THREADS		152
+#define OPTION_FILE_THREADS		153
+#define OPTION_MERGE_BY_TIME		154
+#define OPTION_WRITE_INDEX		155
+#define OPTION_BUILD_INDEX		156
+#define OPTION_INDEX_INTERVAL		157
+#define OPTION_START_TIME		158
+#define OPTION_END_TIME			159
+#define OPTION_START_PACKET		160
+#define OPTION_TCP_REASSEMBLY		161
+#define OPTION_IP_REASSEMBLY		162
+#define OPTION_IP_REASSEMBLY_OVERLAP	163
+#define OPTION_CALL_CACHE_SIZE		164
+#define OPTION_LATENCY_REPORT		165
+#define OPTION_FLIGHT_RECORDER		166
+#define OPTION_FLIGHT_WINDOW		167
+#define OPTION_FLIGHT_AFTER		168
+#define OPTION_FLIGHT_TRIGGER		169
+#define OPTION_FLIGHT_START		170
+#define OPTION_FLIGHT_STOP		171
+#define OPTION_PCAPNG			172
+#define OPTION_GZIP_SAVEFILE		173
+#define OPTION_SNAPLEN_REPORT		174
+#define OPTION_FANOUT			175
+#define OPTION_CPU_AFFINITY		176
+#define OPTION_NUMA_NODE		177
+#define OPTION_FLOWS			178
+#define OPTION_FLOW_TIMEOUT		179
+#define OPTION_FLOW_TABLE_SIZE		180
+#define OPTION_TOP			181
+#define OPTION_TOP_INTERVAL		182
+#define OPTION_SAMPLE			183
+#define OPTION_FLOW_SAMPLE		184
+#define OPTION_INNER_FILTER		185
+#define OPTION_WRITE_INNER		186
+#define OPTION_BGP_SUMMARY		187
+#define OPTION_BGP_PEERS		188
+#define OPTION_LSDB			189
+#define OPTION_BEACON_STATS		190
+#define OPTION_FLOW_COLLECTOR		191
+#define OPTION_NEIGHBORS		192
+#define OPTION_OPENFLOW_SUMMARY		193
+#define OPTION_PTP_STATS		194
+#define OPTION_HW_TIME_STAMP		195
+#define OPTION_STATE_MEMORY		196
+#define OPTION_MEM_LIMIT		197
+#define OPTION_CONTROL_SOCKET		198
+#define OPTION_METRICS			199
+#define OPTION_DEGRADE			200
+#define OPTION_PRINT_THREAD		201
+#define OPTION_OUTPUT_THREAD		202
+#define OPTION_RESOLVE			203
+#define OPTION_NAME_CACHE_FILE		204
+#define OPTION_WPAN_STATS		205
+#define OPTION_RADIUS_SUMMARY		206
+#define OPTION_DHCP_EVENTS		207
+#define OPTION_EXTRACT_PAYLOADS		208
+#define OPTION_PPP_SESSIONS		209
+#define OPTION_MCAST_GROUPS		210
+#define OPTION_LABEL_BINDINGS		211
+#define OPTION_FILTER_PROGRAM		212
+#define OPTION_HOSTS_FILE		213
+#define OPTION_DISPLAY_FILTER		214
+#define OPTION_DEDUP			215
+#define OPTION_FLOW_TRUNCATE		216
+#define OPTION_ANONYMIZE		217
+#define OPTION_FLOW_INDEX		218
+#define OPTION_FLOW			219
+#define OPTION_DECOMPRESS_THREADS	220
+#define OPTION_TCP_ANALYSIS		221
+#define OPTION_MPTCP_CONNECTIONS	222
+#define OPTION_RTP_ANALYSIS		223
+#define OPTION_BFD_SESSIONS		224
+#define OPTION_HTTP_TRANSACTIONS	225
+#define OPTION_COMMUNITY_ID		226
+#define OPTION_IO_URING			227
+#define OPTION_STRIPE_DIR		228
+#define OPTION_RECYCLE_SAVEFILES	229
+#define OPTION_FLUSH_INTERVAL		230
+#define OPTION_STREAM_BUFFER		231
+#define OPTION_SHM_SIZE			232
+#define OPTION_SHM_OUTPUT		233
+#define OPTION_HUGE_PAGES		234
+#define OPTION_STARTUP_PROFILE		235
+#define OPTION_CHECK_OUTGOING_CKSUMS	236
+#define OPTION_MEMO			237
+#define OPTION_MEMO_IGNORE		238
+#define OPTION_CHANGES_ONLY		239
+#define OPTION_ARP_WATCH		240
+#define OPTION_SOMEIP_SUMMARY		241
+#define OPTION_RATES			242
+#define OPTION_RATE_INTERVAL		243
+#define OPTION_KERNEL_COUNTS		244
+#define OPTION_PLUGIN			245
+#define OPTION_WORKER_OUTPUT		246
+#define OPTION_PAYLOAD_MATCH		247
+#define OPTION_V2X_STATIONS		248
+#define OPTION_MAX_OUTPUT		249
+#define OPTION_SPLIT_BY			250
+#define OPTION_SPLIT_OPEN_FILES		251
+#define OPTION_FOLLOW			252
 
 static const struct option longopts[] = {
 #if defined(HAVE_PCAP_CREATE) || defined(_WIN32)
@@ -716,6 +2111,7 @@ static const struct option longopts[] = {
 	{ "time-stamp-precision", required_argument, NULL, OPTION_TSTAMP_PRECISION},
 #endif
 	{ "dont-verify-checksums", no_argument, NULL, 'K' },
+	{ "check-outgoing-cksums", no_argument, NULL, OPTION_CHECK_OUTGOING_CKSUMS },
 	{ "list-data-link-types", no_argument, NULL, 'L' },
 	{ "no-optimize", no_argument, NULL, 'O' },
 	{ "no-promiscuous-mode", no_argument, NULL, 'p' },
@@ -731,16 +2127,173 @@ static const struct option longopts[] = {
 #ifdef HAVE_PCAP_SET_IMMEDIATE_MODE
 	{ "immediate-mode", no_argument, NULL, OPTION_IMMEDIATE_MODE },
 #endif
+#ifdef FANOUT_SUPPORTED
+	{ "fanout", required_argument, NULL, OPTION_FANOUT },
+#endif
+#ifdef CPU_AFFINITY_SUPPORTED
+	{ "cpu-affinity", required_argument, NULL, OPTION_CPU_AFFINITY },
+	{ "numa-node", required_argument, NULL, OPTION_NUMA_NODE },
+#endif
 #ifdef HAVE_PCAP_SET_PARSER_DEBUG
 	{ "debug-filter-parser", no_argument, NULL, 'Y' },
 #endif
 	{ "relinquish-privileges", required_argument, NULL, 'Z' },
 	{ "count", no_argument, NULL, OPTION_COUNT },
-	{ "fp-type", no_argument, NULL, OPTION_FP_TYPE },
-	{ "number", no_argument, NULL, '#' },
-	{ "print", no_argument, NULL, OPTION_PRINT },
-	{ "version", no_argument, NULL, OPTION_VERSION },
-	{ NULL, 0, NULL, 0 }
+	{ "batch-size", required_argument, NULL, OPTION_BATCH_SIZE },
+#ifdef CHUNK_THREADS_SUPPORTED
+	{ "chunk-threads", required_argument, NULL, OPTION_CHUNK_THREADS },
+#endif
+#ifdef FILE_THREADS_SUPPORTED
+	{ "file-threads", required_argument, NULL, OPTION_FILE_THREADS },
+	{ "merge-by-time", no_argument, NULL, OPTION_MERGE_BY_TIME },
+#endif
+	{ "write-index", no_argument, NULL, OPTION_WRITE_INDEX },
+	{ "build-index", no_argument, NULL, OPTION_BUILD_INDEX },
+	{ "index-interval", required_argument, NULL, OPTION_INDEX_INTERVAL },
+	{ "flow-index", no_argument, NULL, OPTION_FLOW_INDEX },
+	{ "flow", required_argument, NULL, OPTION_FLOW },
+	{ "start-time", required_argument, NULL, OPTION_START_TIME },
+	{ "end-time", required_argument, NULL, OPTION_END_TIME },
+	{ "start-packet", required_argument, NULL, OPTION_START_PACKET },
+	{ "sample", required_argument, NULL, OPTION_SAMPLE },
+	{ "flow-sample", required_argument, NULL, OPTION_FLOW_SAMPLE },
+	{ "inner-filter", required_argument, NULL, OPTION_INNER_FILTER },
+	{ "write-inner", no_argument, NULL, OPTION_WRITE_INNER },
+	{ "flight-recorder", required_argument, NULL, OPTION_FLIGHT_RECORDER },
+	{ "flight-window", required_argument, NULL, OPTION_FLIGHT_WINDOW },
+	{ "flight-after", required_argument, NULL, OPTION_FLIGHT_AFTER },
+	{ "flight-trigger", required_argument, NULL, OPTION_FLIGHT_TRIGGER },
+	{ "flight-start", required_argument, NULL, OPTION_FLIGHT_START },
+	{ "flight-stop", required_argument, NULL, OPTION_FLIGHT_STOP },
+#ifdef HAVE_PTHREADS
+	{ "writer-thread", no_argument, NULL, OPTION_WRITER_THREAD },
+#ifdef SAVEFILE_CLOCK_SUPPORTED
+	{ "flush-interval", required_argument, NULL, OPTION_FLUSH_INTERVAL },
+#endif
+#ifdef STREAM_SINK_SUPPORTED
+	{ "stream-buffer", required_argument, NULL, OPTION_STREAM_BUFFER },
+#endif
+#endif
+#ifdef GZIP_SAVEFILE_SUPPORTED
+	{ "gzip-savefile", optional_argument, NULL, OPTION_GZIP_SAVEFILE },
+#endif
+#ifdef URING_SAVEFILE_SUPPORTED
+	{ "io-uring", optional_argument, NULL, OPTION_IO_URING },
+#endif
+	{ "stripe-dir", required_argument, NULL, OPTION_STRIPE_DIR },
+	{ "huge-pages", optional_argument, NULL, OPTION_HUGE_PAGES },
+#ifdef SHM_RING_SUPPORTED
+	{ "shm-size", required_argument, NULL, OPTION_SHM_SIZE },
+	{ "shm-output", required_argument, NULL, OPTION_SHM_OUTPUT },
+#endif
+#ifdef COMPRESSED_READER_SUPPORTED
+	{ "decompress-threads", required_argument, NULL, OPTION_DECOMPRESS_THREADS },
+#endif
+#ifndef _WIN32
+	{ "mmap-read", no_argument, NULL, OPTION_MMAP_READ },
+	{ "mmap-savefile", no_argument, NULL, OPTION_MMAP_SAVEFILE },
+	{ "recycle-savefiles", no_argument, NULL, OPTION_RECYCLE_SAVEFILES },
+	{ "startup-time", no_argument, NULL, OPTION_STARTUP_TIME },
+	{ "startup-profile", no_argument, NULL, OPTION_STARTUP_PROFILE },
+#endif
+#ifdef DISSECT_THREADS_SUPPORTED
+	{ "dissect-threads", required_argument, NULL, OPTION_DISSECT_THREADS },
+	{ "worker-output", required_argument, NULL, OPTION_WORKER_OUTPUT },
+#endif
+	{ "call-cache-size", required_argument, NULL, OPTION_CALL_CACHE_SIZE },
+	{ "latency-report", optional_argument, NULL, OPTION_LATENCY_REPORT },
+	{ "bgp-summary", no_argument, NULL, OPTION_BGP_SUMMARY },
+	{ "bgp-peers", no_argument, NULL, OPTION_BGP_PEERS },
+	{ "lsdb", no_argument, NULL, OPTION_LSDB },
+	{ "beacon-stats", no_argument, NULL, OPTION_BEACON_STATS },
+	{ "neighbors", no_argument, NULL, OPTION_NEIGHBORS },
+	{ "wpan-stats", no_argument, NULL, OPTION_WPAN_STATS },
+	{ "openflow-summary", no_argument, NULL, OPTION_OPENFLOW_SUMMARY },
+	{ "radius-summary", optional_argument, NULL, OPTION_RADIUS_SUMMARY },
+	{ "dhcp-events", no_argument, NULL, OPTION_DHCP_EVENTS },
+	{ "extract-payloads", required_argument, NULL, OPTION_EXTRACT_PAYLOADS },
+	{ "ppp-sessions", no_argument, NULL, OPTION_PPP_SESSIONS },
+	{ "mcast-groups", no_argument, NULL, OPTION_MCAST_GROUPS },
+	{ "label-bindings", no_argument, NULL, OPTION_LABEL_BINDINGS },
+	{ "tcp-analysis", no_argument, NULL, OPTION_TCP_ANALYSIS },
+	{ "mptcp-connections", no_argument, NULL, OPTION_MPTCP_CONNECTIONS },
+	{ "rtp-analysis", optional_argument, NULL, OPTION_RTP_ANALYSIS },
+	{ "bfd-sessions", no_argument, NULL, OPTION_BFD_SESSIONS },
+	{ "someip-summary", no_argument, NULL, OPTION_SOMEIP_SUMMARY },
+	{ "v2x-stations", optional_argument, NULL, OPTION_V2X_STATIONS },
+	{ "http-transactions", no_argument, NULL, OPTION_HTTP_TRANSACTIONS },
+	{ "community-id", optional_argument, NULL, OPTION_COMMUNITY_ID },
+	{ "filter-program", required_argument, NULL, OPTION_FILTER_PROGRAM },
+	{ "hosts-file", required_argument, NULL, OPTION_HOSTS_FILE },
+	{ "payload-match", required_argument, NULL, OPTION_PAYLOAD_MATCH },
+	{ "display-filter", required_argument, NULL, OPTION_DISPLAY_FILTER },
+	{ "dedup", optional_argument, NULL, OPTION_DEDUP },
+	{ "memo", optional_argument, NULL, OPTION_MEMO },
+	{ "memo-ignore", required_argument, NULL, OPTION_MEMO_IGNORE },
+	{ "changes-only", no_argument, NULL, OPTION_CHANGES_ONLY },
+	{ "arp-watch", optional_argument, NULL, OPTION_ARP_WATCH },
+	{ "flow-truncate", required_argument, NULL, OPTION_FLOW_TRUNCATE },
+	{ "split-by", required_argument, NULL, OPTION_SPLIT_BY },
+	{ "split-open-files", required_argument, NULL, OPTION_SPLIT_OPEN_FILES },
+	{ "follow", no_argument, NULL, OPTION_FOLLOW },
+	{ "anonymize", required_argument, NULL, OPTION_ANONYMIZE },
+	{ "ptp-stats", optional_argument, NULL, OPTION_PTP_STATS },
+	{ "hw-time-stamp", required_argument, NULL, OPTION_HW_TIME_STAMP },
+	{ "name-cache-size", required_argument, NULL, OPTION_NAME_CACHE_SIZE },
+	{ "name-cache-ttl", required_argument, NULL, OPTION_NAME_CACHE_TTL },
+	{ "resolve", required_argument, NULL, OPTION_RESOLVE },
+#ifdef NAME_CACHE_FILE_SUPPORTED
+	{ "name-cache-file", required_argument, NULL, OPTION_NAME_CACHE_FILE },
+#endif
+#ifdef ASYNC_RESOLVER_SUPPORTED
+	{ "resolver-threads", required_argument, NULL, OPTION_RESOLVER_THREADS },
+#endif
+	{ "disable-dissector", required_argument, NULL, OPTION_DISABLE_DISSECTOR },
+	{ "field-output", no_argument, NULL, OPTION_FIELD_OUTPUT },
+	{ "fp-type", no_argument, NULL, OPTION_FP_TYPE },
+	{ "ip-reassembly", optional_argument, NULL, OPTION_IP_REASSEMBLY },
+	{ "ip-reassembly-overlap", required_argument, NULL, OPTION_IP_REASSEMBLY_OVERLAP },
+	{ "json", no_argument, NULL, OPTION_JSON },
+	{ "number", no_argument, NULL, '#' },
+	{ "pcapng", no_argument, NULL, OPTION_PCAPNG },
+	{ "port-map", required_argument, NULL, OPTION_PORT_MAP },
+	{ "plugin", required_argument, NULL, OPTION_PLUGIN },
+	{ "print", no_argument, NULL, OPTION_PRINT },
+#ifdef ENABLE_DISSECTOR_PROFILE
+	{ "profile-dissectors", no_argument, NULL, OPTION_PROFILE_DISSECTORS },
+	{ "snaplen-report", no_argument, NULL, OPTION_SNAPLEN_REPORT },
+#endif
+	{ "stats-only", no_argument, NULL, OPTION_STATS_ONLY },
+	{ "state-memory", required_argument, NULL, OPTION_STATE_MEMORY },
+	{ "mem-limit", required_argument, NULL, OPTION_MEM_LIMIT },
+	{ "max-output-per-packet", required_argument, NULL, OPTION_MAX_OUTPUT },
+#ifdef CONTROL_SOCKET_SUPPORTED
+	{ "control-socket", required_argument, NULL, OPTION_CONTROL_SOCKET },
+#endif
+#ifdef METRICS_SUPPORTED
+	{ "metrics", required_argument, NULL, OPTION_METRICS },
+#endif
+	{ "degrade", no_argument, NULL, OPTION_DEGRADE },
+#ifdef PRINT_THREAD_SUPPORTED
+	{ "print-thread", optional_argument, NULL, OPTION_PRINT_THREAD },
+#endif
+#ifdef OUTPUT_BUFFER_SUPPORTED
+	{ "output-thread", optional_argument, NULL, OPTION_OUTPUT_THREAD },
+#endif
+	{ "flows", optional_argument, NULL, OPTION_FLOWS },
+	{ "flow-timeout", required_argument, NULL, OPTION_FLOW_TIMEOUT },
+	{ "flow-table-size", required_argument, NULL, OPTION_FLOW_TABLE_SIZE },
+	{ "flow-collector", no_argument, NULL, OPTION_FLOW_COLLECTOR },
+	{ "top", optional_argument, NULL, OPTION_TOP },
+	{ "top-interval", required_argument, NULL, OPTION_TOP_INTERVAL },
+	{ "rates", optional_argument, NULL, OPTION_RATES },
+	{ "rate-interval", required_argument, NULL, OPTION_RATE_INTERVAL },
+#ifdef KERNEL_COUNTS_SUPPORTED
+	{ "kernel-counts", no_argument, NULL, OPTION_KERNEL_COUNTS },
+#endif
+	{ "tcp-reassembly", optional_argument, NULL, OPTION_TCP_REASSEMBLY },
+	{ "version", no_argument, NULL, OPTION_VERSION },
+	{ NULL, 0, NULL, 0 }
 };
 
 #ifdef HAVE_PCAP_FINDALLDEVS_EX
@@ -755,6 +2308,68 @@ static const struct option longopts[] = {
 #define IMMEDIATE_MODE_USAGE ""
 #endif
 
+#ifdef HAVE_PTHREADS
+#define WRITER_THREAD_USAGE " [ --writer-thread ]"
+#else
+#define WRITER_THREAD_USAGE ""
+#endif
+
+#ifdef SAVEFILE_CLOCK_SUPPORTED
+#define FLUSH_INTERVAL_USAGE " [ --flush-interval=ms ]"
+#else
+#define FLUSH_INTERVAL_USAGE ""
+#endif
+
+#ifdef METRICS_SUPPORTED
+#define METRICS_USAGE " [ --metrics [address:]port ]"
+#else
+#define METRICS_USAGE ""
+#endif
+
+#ifdef CONTROL_SOCKET_SUPPORTED
+#define CONTROL_SOCKET_USAGE " [ --control-socket path ]"
+#else
+#define CONTROL_SOCKET_USAGE ""
+#endif
+
+#ifndef _WIN32
+#define MMAP_SAVEFILE_USAGE "[ --mmap-read ] [ --mmap-savefile ] [ --recycle-savefiles ] [ --startup-time ] [ --startup-profile ]"
+#else
+#define MMAP_SAVEFILE_USAGE ""
+#endif
+
+#ifdef CHUNK_THREADS_SUPPORTED
+#define CHUNK_THREADS_USAGE " [ --chunk-threads count ]"
+#else
+#define CHUNK_THREADS_USAGE ""
+#endif
+
+#ifdef FILE_THREADS_SUPPORTED
+#define FILE_THREADS_USAGE " [ --file-threads count ]"
+#define MERGE_BY_TIME_USAGE " [ --merge-by-time ]"
+#else
+#define FILE_THREADS_USAGE ""
+#define MERGE_BY_TIME_USAGE ""
+#endif
+
+#ifdef DISSECT_THREADS_SUPPORTED
+#define DISSECT_THREADS_USAGE " [ --dissect-threads count ]\n\t\t[ --worker-output prefix ]"
+#else
+#define DISSECT_THREADS_USAGE ""
+#endif
+
+#ifdef ASYNC_RESOLVER_SUPPORTED
+#define RESOLVER_THREADS_USAGE " [ --resolver-threads count ]"
+#else
+#define RESOLVER_THREADS_USAGE ""
+#endif
+
+#ifdef NAME_CACHE_FILE_SUPPORTED
+#define NAME_CACHE_FILE_USAGE " [ --name-cache-file file ]"
+#else
+#define NAME_CACHE_FILE_USAGE ""
+#endif
+
 #ifndef _WIN32
 /* Drop root privileges and chroot if necessary */
 static void
@@ -835,10 +2450,10 @@ MakeFilename(char *buffer, char *orig_name, int cnt, int max_chars)
 
         /* Process with strftime if Gflag is set. */
         if (Gflag != 0) {
-          struct tm *local_tm;
+          struct tm local_tmbuf, *local_tm;
 
           /* Convert Gflag_time to a usable format */
-          if ((local_tm = localtime(&Gflag_time)) == NULL) {
+          if ((local_tm = nd_localtime(&Gflag_time, &local_tmbuf)) == NULL) {
                   error("MakeTimedFilename: localtime");
           }
 
@@ -859,6 +2474,45 @@ MakeFilename(char *buffer, char *orig_name, int cnt, int max_chars)
         free(filename);
 }
 
+#ifdef FOLLOW_READER_SUPPORTED
+/*
+ * Name the file after the one being followed, as rotate_savefile()
+ * would have named it, wrapping around after -W files.
+ */
+static void
+follow_next_name(void *arg _U_, char *buf, size_t size _U_)
+{
+	follow_count++;
+	if (Wflag > 0 && follow_count >= Wflag)
+		follow_count = 0;
+	MakeFilename(buf, follow_name, follow_count, WflagChars);
+}
+#endif
+
+/*
+ * With --stripe-dir, put the savefile MakeFilename() named in "buffer"
+ * in the next of the directories in turn.  The -C file number, plus the
+ * number of -G rotations, picks the directory, so a name that -W reuses
+ * is always in the same one.
+ */
+static void
+StripeFilename(char *buffer)
+{
+	char *filename;
+	int n;
+
+	if (nstripe_dirs == 0)
+		return;
+	n = (Gflag_count + Cflag_count) % nstripe_dirs;
+	filename = strdup(buffer);
+	if (filename == NULL)
+		error("StripeFilename: strdup");
+	if (snprintf(buffer, PATH_MAX + 1, "%s/%s", stripe_dirs[n],
+	    filename) > PATH_MAX)
+		error("filename is too long (> %d)", PATH_MAX);
+	free(filename);
+}
+
 static char *
 get_next_file(FILE *VFile, char *ptr)
 {
@@ -905,6 +2559,15 @@ capdns_setup(void)
 }
 #endif	/* HAVE_CASPER */
 
+/*
+ * Are the time stamps of the packets read in nanoseconds?
+ */
+static int
+nano_tstamps(const netdissect_options *ndo _U_)
+{
+	return (ND_TSTAMP_NANO(ndo));
+}
+
 #ifdef HAVE_PCAP_SET_TSTAMP_PRECISION
 static int
 tstamp_precision_from_string(const char *precision)
@@ -1085,6 +2748,54 @@ read_infile(char *fname)
 	return (cp);
 }
 
+/*
+ * Read a filter program in the form -ddd prints it in, the number of
+ * instructions and then the code, jt, jf and k of each instruction on
+ * a line of its own, so that a filter can be compiled once and used on
+ * many machines without compiling it again.  It's for the link-layer
+ * header type it was compiled for.
+ */
+static void
+read_filter_program(char *fname, struct bpf_program *fp)
+{
+	char *buf, *cp, *endp;
+	uint64_t n, v[4];
+	u_int i, j;
+
+	buf = read_infile(fname);
+	cp = buf;
+	n = strtoull(cp, &endp, 10);
+	if (endp == cp || n == 0 || n > BPF_MAXINSNS)
+		error("%s: bad instruction count", fname);
+	cp = endp;
+	fp->bf_len = (u_int)n;
+	fp->bf_insns = (struct bpf_insn *)calloc(fp->bf_len, sizeof(struct bpf_insn));
+	if (fp->bf_insns == NULL)
+		error("read_filter_program: calloc");
+	for (i = 0; i < fp->bf_len; i++) {
+		for (j = 0; j < 4; j++) {
+			v[j] = strtoull(cp, &endp, 10);
+			if (endp == cp)
+				error("%s: instruction %u is cut short", fname, i);
+			cp = endp;
+		}
+		if (v[0] > 0xffff || v[1] > 0xff || v[2] > 0xff ||
+		    v[3] > 0xffffffff)
+			error("%s: instruction %u is out of range", fname, i);
+		fp->bf_insns[i].code = (u_short)v[0];
+		fp->bf_insns[i].jt = (u_char)v[1];
+		fp->bf_insns[i].jf = (u_char)v[2];
+		fp->bf_insns[i].k = (bpf_u_int32)v[3];
+	}
+	while (*cp == ' ' || *cp == '\t' || *cp == '\r' || *cp == '\n')
+		cp++;
+	if (*cp != '\0')
+		error("%s: more than %u instructions", fname, fp->bf_len);
+	free(buf);
+	if (!bpf_validate(fp->bf_insns, (int)fp->bf_len))
+		error("%s: not a valid BPF program", fname);
+}
+
 #ifdef HAVE_PCAP_FINDALLDEVS
 static long
 parse_interface_number(const char *device)
@@ -1410,6 +3121,8 @@ open_interface(const char *device, netdissect_options *ndo, char *ebuf)
 		if (status != 0)
 			error("%s: pcap_setdirection() failed: %s",
 			      device,  pcap_geterr(pc));
+		/* Whatever the link-layer type, it was all sent by us. */
+		ndo->ndo_all_outgoing = (Qflag == PCAP_D_OUT);
 		}
 #endif /* HAVE_PCAP_SETDIRECTION */
 #else /* HAVE_PCAP_CREATE */
@@ -1445,6 +3158,7 @@ main(int argc, char **argv)
 	int cnt, op, i;
 	bpf_u_int32 localnet = 0, netmask = 0;
 	char *cp, *infile, *cmdbuf, *device, *RFileName, *VFileName, *WFileName;
+	char *progfile;
 	char *endp;
 	pcap_handler callback;
 	int dlt;
@@ -1454,6 +3168,7 @@ main(int argc, char **argv)
 	void (*oldhandler)(int);
 #endif
 	struct dump_info dumpinfo;
+	int zfd = -1;			/* of a compressed savefile, or -1 */
 	u_char *pcap_userdata;
 	char ebuf[PCAP_ERRBUF_SIZE];
 	char VFileLine[PATH_MAX + 1];
@@ -1469,6 +3184,7 @@ main(int argc, char **argv)
 #endif
 	int status;
 	FILE *VFile;
+	FILE *WFile;
 #ifdef HAVE_CAPSICUM
 	cap_rights_t rights;
 	int cansandbox;
@@ -1481,18 +3197,33 @@ main(int argc, char **argv)
 	netdissect_options Ndo;
 	netdissect_options *ndo = &Ndo;
 
+#ifndef _WIN32
+	(void)gettimeofday(&startup_tv, NULL);
+#endif
+
 	/*
 	 * Initialize the netdissect code.
 	 */
 	if (nd_init(ebuf, sizeof(ebuf)) == -1)
 		error("%s", ebuf);
 
+	/*
+	 * Read the time zone now, before any dissection thread starts;
+	 * nd_localtime() uses localtime_r(), which needn't.
+	 */
+#ifdef _WIN32
+	_tzset();
+#else
+	tzset();
+#endif
+
 	memset(ndo, 0, sizeof(*ndo));
 	ndo_set_function_pointers(ndo);
 
 	cnt = -1;
 	device = NULL;
 	infile = NULL;
+	progfile = NULL;
 	RFileName = NULL;
 	VFileName = NULL;
 	VFile = NULL;
@@ -1602,6 +3333,9 @@ main(int argc, char **argv)
 			warning("crypto code not compiled in");
 #endif
 			ndo->ndo_espsecret = optarg;
+#ifdef ESPSECRET_RELOAD
+			espsecret = optarg;
+#endif
 			break;
 
 		case 'f':
@@ -1637,6 +3371,13 @@ main(int argc, char **argv)
 			break;
 
 		case 'i':
+#ifdef MULTI_IFACE_SUPPORTED
+			multi_devices = (char **)realloc(multi_devices,
+			    (multi_ndevices + 1) * sizeof(*multi_devices));
+			if (multi_devices == NULL)
+				error("realloc of the interface list");
+			multi_devices[multi_ndevices++] = optarg;
+#endif
 			device = optarg;
 			break;
 
@@ -1686,7 +3427,8 @@ main(int argc, char **argv)
 
 		case 'm':
 			if (nd_have_smi_support()) {
-				if (nd_load_smi_module(optarg, ebuf, sizeof(ebuf)) == -1)
+				/* It's loaded for the first SNMP packet. */
+				if (nd_defer_smi_module(optarg, ebuf, sizeof(ebuf)) == -1)
 					error("%s", ebuf);
 			} else {
 				(void)fprintf(stderr, "%s: ignoring option `-m %s' ",
@@ -1886,10 +3628,171 @@ main(int argc, char **argv)
 			break;
 #endif
 
+#ifdef FANOUT_SUPPORTED
+		case OPTION_FANOUT:
+			errno = 0;
+			fanout_count = (int)strtol(optarg, &endp, 10);
+			if (endp == optarg || errno != 0 || fanout_count < 2 ||
+			    fanout_count > FANOUT_MAX)
+				error("invalid fanout count %s", optarg);
+			if (*endp == '\0' || strcmp(endp, ",hash") == 0)
+				fanout_mode = PACKET_FANOUT_HASH;
+			else if (strcmp(endp, ",lb") == 0)
+				fanout_mode = PACKET_FANOUT_LB;
+			else if (strcmp(endp, ",cpu") == 0)
+				fanout_mode = PACKET_FANOUT_CPU;
+			else
+				error("invalid fanout mode %s", optarg);
+			break;
+#endif
+
+#ifdef CPU_AFFINITY_SUPPORTED
+		case OPTION_CPU_AFFINITY:
+			affinity_option(optarg);
+			break;
+
+		case OPTION_NUMA_NODE:
+			if (strcmp(optarg, "auto") != 0 &&
+			    (strtol(optarg, &endp, 10) < 0 || endp == optarg ||
+			    *endp != '\0'))
+				error("invalid NUMA node %s", optarg);
+			numa_node = optarg;
+			break;
+#endif
+
+		case OPTION_DISABLE_DISSECTOR:
+			if (nd_disable_dissector(optarg) == -1)
+				error("unknown dissector %s", optarg);
+			break;
+
+		case OPTION_FIELD_OUTPUT:
+			field_output = 1;
+			break;
+
+		case OPTION_PORT_MAP:
+			cp = strchr(optarg, '=');
+			if (cp == NULL || cp == optarg)
+				error("invalid port mapping %s", optarg);
+			i = atoi(optarg);
+			if (i < 0 || i > 65535 || strspn(optarg, "0123456789") !=
+			    (size_t)(cp - optarg))
+				error("invalid port in mapping %s", optarg);
+			if (nd_map_port(i, cp + 1) == -1)
+				error("unknown port dissector %s", cp + 1);
+			break;
+
+		case OPTION_PLUGIN:
+			plugin_files = (const char **)realloc(plugin_files,
+			    (n_plugin_files + 1) * sizeof(*plugin_files));
+			if (plugin_files == NULL)
+				error("--plugin: out of memory");
+			plugin_files[n_plugin_files++] = optarg;
+			break;
+
+		case OPTION_JSON:
+			json_output = 1;
+			break;
+
 		case OPTION_PRINT:
 			print = 1;
 			break;
 
+#ifdef ENABLE_DISSECTOR_PROFILE
+		case OPTION_PROFILE_DISSECTORS:
+			profile_dissectors = 1;
+			break;
+
+		case OPTION_SNAPLEN_REPORT:
+			snaplen_report = 1;
+			break;
+#endif
+
+		case OPTION_FLOWS:
+			if (optarg == NULL || strcmp(optarg, "text") == 0)
+				flows_format = FLOWS_TEXT;
+			else if (strcmp(optarg, "json") == 0)
+				flows_format = FLOWS_JSON;
+			else if (strcmp(optarg, "ipfix") == 0)
+				flows_format = FLOWS_IPFIX;
+			else
+				error("invalid flow record format %s", optarg);
+			break;
+
+		case OPTION_FLOW_TIMEOUT:
+			errno = 0;
+			i = (int)strtol(optarg, &endp, 10);
+			if (endp == optarg || errno != 0 || i <= 0)
+				error("invalid flow timeout %s", optarg);
+			flows_active = (u_int)i;
+			if (*endp == ',') {
+				optarg = endp + 1;
+				i = (int)strtol(optarg, &endp, 10);
+				if (endp == optarg || errno != 0 || i <= 0)
+					error("invalid flow idle timeout %s",
+					    optarg);
+				flows_idle = (u_int)i;
+			}
+			if (*endp != '\0')
+				error("invalid flow timeout %s", optarg);
+			break;
+
+		case OPTION_FLOW_TABLE_SIZE:
+			i = atoi(optarg);
+			if (i <= 0 || i > (1 << 26))
+				error("invalid flow table size %s", optarg);
+			flows_size = (u_int)i;
+			break;
+
+		case OPTION_FLOW_COLLECTOR:
+			flows_collect = 1;
+			break;
+
+		case OPTION_TOP:
+			if (optarg == NULL)
+				topn_count = TOPN_DEFAULT_COUNT;
+			else {
+				i = atoi(optarg);
+				if (i <= 0 || i > 1000)
+					error("invalid --top count %s", optarg);
+				topn_count = (u_int)i;
+			}
+			break;
+
+		case OPTION_TOP_INTERVAL:
+			i = atoi(optarg);
+			if (i <= 0)
+				error("invalid --top interval %s", optarg);
+			topn_interval = (u_int)i;
+			break;
+
+		case OPTION_RATES:
+			if (optarg == NULL || strcmp(optarg, "csv") == 0)
+				rates_format = RATES_CSV;
+			else if (strcmp(optarg, "binary") == 0)
+				rates_format = RATES_BINARY;
+			else
+				error("invalid rate series format %s", optarg);
+			break;
+
+		case OPTION_RATE_INTERVAL:
+			i = atoi(optarg);
+			if (i <= 0)
+				error("invalid --rates interval %s", optarg);
+			rates_interval = (u_int)i;
+			break;
+
+#ifdef KERNEL_COUNTS_SUPPORTED
+		case OPTION_KERNEL_COUNTS:
+			kernel_counts_flag = 1;
+			break;
+#endif
+
+		case OPTION_STATS_ONLY:
+			stats_only = 1;
+			/* Nothing's printed, so don't look anything up. */
+			ndo->ndo_nflag = 1;
+			break;
+
 #ifdef HAVE_PCAP_SET_TSTAMP_PRECISION
 		case OPTION_TSTAMP_MICRO:
 			ndo->ndo_tstamp_precision = PCAP_TSTAMP_PRECISION_MICRO;
@@ -1915,1136 +3818,9345 @@ main(int argc, char **argv)
 			count_mode = 1;
 			break;
 
-		default:
-			print_usage();
-			exit_tcpdump(S_ERR_HOST_PROGRAM);
-			/* NOTREACHED */
-		}
+		case OPTION_BATCH_SIZE:
+			batch_size = atoi(optarg);
+			if (batch_size <= 0)
+				error("invalid batch size %s", optarg);
+			break;
 
-#ifdef HAVE_PCAP_FINDALLDEVS
-	if (Dflag)
-		show_devices_and_exit();
+#ifdef CHUNK_THREADS_SUPPORTED
+		case OPTION_CHUNK_THREADS:
+			chunk_threads = atoi(optarg);
+			if (chunk_threads <= 0)
+				error("invalid number of chunk threads %s",
+				    optarg);
+			break;
 #endif
-#ifdef HAVE_PCAP_FINDALLDEVS_EX
-	if (remote_interfaces_source != NULL)
-		show_remote_devices_and_exit();
+
+#ifdef FILE_THREADS_SUPPORTED
+		case OPTION_FILE_THREADS:
+			file_threads = atoi(optarg);
+			if (file_threads <= 0)
+				error("invalid number of file threads %s",
+				    optarg);
+			break;
+
+		case OPTION_MERGE_BY_TIME:
+			merge_by_time = 1;
+			break;
 #endif
 
-	switch (ndo->ndo_tflag) {
+		case OPTION_WRITE_INDEX:
+			write_index = 1;
+			break;
 
-	case 0: /* Default */
-	case 1: /* No time stamp */
-	case 2: /* Unix timeval style */
-	case 3: /* Microseconds/nanoseconds since previous packet */
-	case 4: /* Date + Default */
-	case 5: /* Microseconds/nanoseconds since first packet */
-		break;
+		case OPTION_BUILD_INDEX:
+			build_index = 1;
+			break;
 
-	default: /* Not supported */
-		error("only -t, -tt, -ttt, -tttt and -ttttt are supported");
-		break;
-	}
+		case OPTION_INDEX_INTERVAL:
+			index_interval = (u_int)atoi(optarg);
+			if (atoi(optarg) <= 0)
+				error("invalid index interval %s", optarg);
+			break;
 
-	if (ndo->ndo_fflag != 0 && (VFileName != NULL || RFileName != NULL))
-		error("-f can not be used with -V or -r");
+		case OPTION_FLOW_INDEX:
+			flow_index = 1;
+			break;
 
-	if (VFileName != NULL && RFileName != NULL)
-		error("-V and -r are mutually exclusive.");
+		case OPTION_FLOW:
+			parse_flow_sel(optarg);
+			break;
 
-	/*
-	 * If we're printing dissected packets to the standard output,
-	 * and either the standard output is a terminal or we're doing
-	 * "line" buffering, set the capture timeout to .1 second rather
-	 * than 1 second, as the user's probably expecting to see packets
-	 * pop up immediately shortly after they arrive.
-	 *
-	 * XXX - would there be some value appropriate for all cases,
-	 * based on, say, the buffer size and packet input rate?
-	 */
-	if ((WFileName == NULL || print) && (isatty(1) || lflag))
-		timeout = 100;
+		case OPTION_START_TIME:
+			parse_range_time(optarg, &range_start);
+			break;
 
-#ifdef WITH_CHROOT
-	/* if run as root, prepare for chrooting */
-	if (getuid() == 0 || geteuid() == 0) {
-		/* future extensibility for cmd-line arguments */
-		if (!chroot_dir)
-			chroot_dir = WITH_CHROOT;
-	}
-#endif
+		case OPTION_END_TIME:
+			parse_range_time(optarg, &range_end);
+			break;
 
-#ifdef WITH_USER
-	/* if run as root, prepare for dropping root privileges */
-	if (getuid() == 0 || geteuid() == 0) {
-		/* Run with '-Z root' to restore old behaviour */
-		if (!username)
-			username = WITH_USER;
-	}
-#endif
+		case OPTION_START_PACKET:
+			range_start_packet = strtoul(optarg, &end, 10);
+			if (end == optarg || *end != '\0' ||
+			    range_start_packet == 0)
+				error("invalid packet number %s", optarg);
+			break;
 
-	if (RFileName != NULL || VFileName != NULL) {
-		/*
-		 * If RFileName is non-null, it's the pathname of a
-		 * savefile to read.  If VFileName is non-null, it's
-		 * the pathname of a file containing a list of pathnames
-		 * (one per line) of savefiles to read.
-		 *
-		 * In either case, we're reading a savefile, not doing
-		 * a live capture.
-		 */
-#ifndef _WIN32
-		/*
-		 * We don't need network access, so relinquish any set-UID
-		 * or set-GID privileges we have (if any).
-		 *
-		 * We do *not* want set-UID privileges when opening a
-		 * trace file, as that might let the user read other
-		 * people's trace files (especially if we're set-UID
-		 * root).
-		 */
-		if (setgid(getgid()) != 0 || setuid(getuid()) != 0 )
-			fprintf(stderr, "Warning: setgid/setuid failed !\n");
-#endif /* _WIN32 */
-		if (VFileName != NULL) {
-			if (VFileName[0] == '-' && VFileName[1] == '\0')
-				VFile = stdin;
-			else
-				VFile = fopen(VFileName, "r");
+		case OPTION_SAMPLE:
+			sample_rate = parse_sample_rate(optarg, "--sample");
+			sample_flows = 0;
+			break;
 
-			if (VFile == NULL)
-				error("Unable to open file: %s\n", pcap_strerror(errno));
+		case OPTION_FLOW_SAMPLE:
+			sample_rate = parse_sample_rate(optarg,
+			    "--flow-sample");
+			sample_flows = 1;
+			break;
 
-			ret = get_next_file(VFile, VFileLine);
-			if (!ret)
-				error("Nothing in %s\n", VFileName);
-			RFileName = VFileLine;
-		}
+		case OPTION_INNER_FILTER:
+			decap_filter = optarg;
+			break;
 
-#ifdef HAVE_PCAP_SET_TSTAMP_PRECISION
-		pd = pcap_open_offline_with_tstamp_precision(RFileName,
-		    ndo->ndo_tstamp_precision, ebuf);
-#else
-		pd = pcap_open_offline(RFileName, ebuf);
+		case OPTION_WRITE_INNER:
+			decap_write_inner = 1;
+			break;
+
+		case OPTION_FLIGHT_RECORDER:
+			i = atoi(optarg);
+			if (i <= 0 || (size_t)i > SIZE_MAX / 1000000)
+				error("invalid flight recorder size %s", optarg);
+			flight_size = (size_t)i * 1000000;
+			break;
+
+		case OPTION_FLIGHT_WINDOW:
+			flight_window = atoi(optarg);
+			if (flight_window <= 0)
+				error("invalid flight recorder window %s", optarg);
+			break;
+
+		case OPTION_FLIGHT_AFTER:
+			flight_after = atoi(optarg);
+			if (flight_after < 0)
+				error("invalid flight recorder time %s", optarg);
+			break;
+
+		case OPTION_FLIGHT_TRIGGER:
+			flight_trigger = optarg;
+			break;
+
+		case OPTION_FLIGHT_START:
+			flight_start = optarg;
+			break;
+
+		case OPTION_FLIGHT_STOP:
+			flight_stop = optarg;
+			break;
+
+		case OPTION_TCP_REASSEMBLY:
+			i = TCP_REASM_DEFAULT_BUDGET;
+			if (optarg != NULL) {
+				i = atoi(optarg);
+				if (i <= 0 || (size_t)i > SIZE_MAX / 1000000)
+					error("invalid reassembly budget %s",
+					    optarg);
+			}
+			ndo->ndo_tcp_reasm_budget = (size_t)i * 1000000;
+			break;
+
+		case OPTION_IP_REASSEMBLY:
+			i = IP_REASM_DEFAULT_BUDGET;
+			if (optarg != NULL) {
+				i = atoi(optarg);
+				if (i <= 0 || (size_t)i > SIZE_MAX / 1000000)
+					error("invalid reassembly budget %s",
+					    optarg);
+			}
+			ndo->ndo_ip_reasm_budget = (size_t)i * 1000000;
+			break;
+
+		case OPTION_IP_REASSEMBLY_OVERLAP:
+			if (strcmp(optarg, "first") == 0)
+				ndo->ndo_ip_reasm_overlap = IP_REASM_OVERLAP_FIRST;
+			else if (strcmp(optarg, "last") == 0)
+				ndo->ndo_ip_reasm_overlap = IP_REASM_OVERLAP_LAST;
+			else if (strcmp(optarg, "drop") == 0)
+				ndo->ndo_ip_reasm_overlap = IP_REASM_OVERLAP_DROP;
+			else
+				error("invalid fragment overlap policy %s",
+				    optarg);
+			break;
+
+#ifdef HAVE_PTHREADS
+		case OPTION_WRITER_THREAD:
+			writer_thread = 1;
+			break;
 #endif
 
-		if (pd == NULL)
-			error("%s", ebuf);
-#ifdef HAVE_CAPSICUM
-		cap_rights_init(&rights, CAP_READ);
-		if (cap_rights_limit(fileno(pcap_file(pd)), &rights) < 0 &&
-		    errno != ENOSYS) {
-			error("unable to limit pcap descriptor");
-		}
+#ifdef STREAM_SINK_SUPPORTED
+		case OPTION_STREAM_BUFFER:
+			i = atoi(optarg);
+			if (i <= 0)
+				error("invalid stream buffer size %s", optarg);
+			stream_buffer = (size_t)i * 1024 * 1024;
+			break;
 #endif
-		dlt = pcap_datalink(pd);
-		dlt_name = pcap_datalink_val_to_name(dlt);
-		fprintf(stderr, "reading from file %s", RFileName);
-		if (dlt_name == NULL) {
-			fprintf(stderr, ", link-type %u", dlt);
-		} else {
-			fprintf(stderr, ", link-type %s (%s)", dlt_name,
-				pcap_datalink_val_to_description(dlt));
-		}
-		fprintf(stderr, ", snapshot length %d\n", pcap_snapshot(pd));
-#ifdef DLT_LINUX_SLL2
-		if (dlt == DLT_LINUX_SLL2)
-			fprintf(stderr, "Warning: interface names might be incorrect\n");
+
+#ifdef SHM_RING_SUPPORTED
+		case OPTION_SHM_SIZE:
+			i = atoi(optarg);
+			if (i <= 0)
+				error("invalid shared-memory ring size %s", optarg);
+			shm_size = (size_t)i * 1024 * 1024;
+			break;
+
+		case OPTION_SHM_OUTPUT:
+			shm_output_name = optarg;
+			break;
 #endif
-	} else if (dflag && !device) {
-		int dump_dlt = DLT_EN10MB;
-		/*
-		 * We're dumping the compiled code without an explicit
-		 * device specification.  (If a device is specified, we
-		 * definitely want to open it to use the DLT of that device.)
-		 * Either default to DLT_EN10MB with a warning, or use
-		 * the user-specified value if supplied.
-		 */
-		/*
-		 * If no snapshot length was specified, or a length of 0 was
-		 * specified, default to 256KB.
-		 */
-		if (ndo->ndo_snaplen == 0)
-			ndo->ndo_snaplen = MAXIMUM_SNAPLEN;
-		/*
-		 * If a DLT was specified with the -y flag, use that instead.
-		 */
-		if (yflag_dlt != -1)
-			dump_dlt = yflag_dlt;
-		else
-			fprintf(stderr, "Warning: assuming Ethernet\n");
-	        pd = pcap_open_dead(dump_dlt, ndo->ndo_snaplen);
-	} else {
-		/*
-		 * We're doing a live capture.
-		 */
-		if (device == NULL) {
-			/*
-			 * No interface was specified.  Pick one.
-			 */
-#ifdef HAVE_PCAP_FINDALLDEVS
-			/*
-			 * Find the list of interfaces, and pick
-			 * the first interface.
-			 */
-			if (pcap_findalldevs(&devlist, ebuf) == -1)
-				error("%s", ebuf);
-			if (devlist == NULL)
-				error("no interfaces available for capture");
-			device = strdup(devlist->name);
-			pcap_freealldevs(devlist);
-#else /* HAVE_PCAP_FINDALLDEVS */
-			/*
-			 * Use whatever interface pcap_lookupdev()
-			 * chooses.
-			 */
-			device = pcap_lookupdev(ebuf);
-			if (device == NULL)
-				error("%s", ebuf);
+
+#ifdef SAVEFILE_CLOCK_SUPPORTED
+		case OPTION_FLUSH_INTERVAL:
+			flush_interval = atoi(optarg);
+			if (flush_interval == 0 || flush_interval > 3600000)
+				error("invalid flush interval %s", optarg);
+			break;
 #endif
-		}
 
-		/*
-		 * Try to open the interface with the specified name.
-		 */
-		pd = open_interface(device, ndo, ebuf);
-		if (pd == NULL) {
-			/*
-			 * That failed.  If we can get a list of
-			 * interfaces, and the interface name
-			 * is purely numeric, try to use it as
-			 * a 1-based index in the list of
-			 * interfaces.
-			 */
-#ifdef HAVE_PCAP_FINDALLDEVS
-			devnum = parse_interface_number(device);
-			if (devnum == -1) {
-				/*
-				 * It's not a number; just report
-				 * the open error and fail.
-				 */
-				error("%s", ebuf);
-			}
+#ifndef _WIN32
+		case OPTION_MMAP_READ:
+			mmap_read = 1;
+			break;
 
-			/*
-			 * OK, it's a number; try to find the
-			 * interface with that index, and try
-			 * to open it.
-			 *
-			 * find_interface_by_number() exits if it
-			 * couldn't be found.
-			 */
-			device = find_interface_by_number(device, devnum);
-			pd = open_interface(device, ndo, ebuf);
-			if (pd == NULL)
-				error("%s", ebuf);
-#else /* HAVE_PCAP_FINDALLDEVS */
-			/*
-			 * We can't get a list of interfaces; just
-			 * fail.
-			 */
-			error("%s", ebuf);
-#endif /* HAVE_PCAP_FINDALLDEVS */
-		}
+		case OPTION_PCAPNG:
+			pcapng_flag = 1;
+			break;
 
-		/*
-		 * Let user own process after capture device has
-		 * been opened.
-		 */
-#ifndef _WIN32
-		if (setgid(getgid()) != 0 || setuid(getuid()) != 0)
-			fprintf(stderr, "Warning: setgid/setuid failed !\n");
-#endif /* _WIN32 */
-#if !defined(HAVE_PCAP_CREATE) && defined(_WIN32)
-		if(Bflag != 0)
-			if(pcap_setbuff(pd, Bflag)==-1){
-				error("%s", pcap_geterr(pd));
+#ifdef GZIP_SAVEFILE_SUPPORTED
+		case OPTION_GZIP_SAVEFILE:
+			gzip_level = 1;
+			if (optarg != NULL) {
+				gzip_level = atoi(optarg);
+				if (gzip_level < 1 || gzip_level > 9)
+					error("invalid compression level %s",
+					    optarg);
 			}
-#endif /* !defined(HAVE_PCAP_CREATE) && defined(_WIN32) */
-		if (Lflag)
-			show_dlts_and_exit(pd, device);
-		if (yflag_dlt >= 0) {
-#ifdef HAVE_PCAP_SET_DATALINK
-			if (pcap_set_datalink(pd, yflag_dlt) < 0)
-				error("%s", pcap_geterr(pd));
-#else
+			break;
+#endif
+
+#ifdef URING_SAVEFILE_SUPPORTED
+		case OPTION_IO_URING:
+			uring_flag = 1;
+			if (optarg != NULL) {
+				if (strcmp(optarg, "direct") != 0)
+					error("invalid --io-uring argument %s",
+					    optarg);
+				uring_flag = 2;
+			}
+			break;
+#endif
+
+		case OPTION_HUGE_PAGES:
 			/*
-			 * We don't actually support changing the
-			 * data link type, so we only let them
-			 * set it to what it already is.
+			 * Nothing that nd_big_calloc() allocates has been
+			 * allocated yet.
 			 */
-			if (yflag_dlt != pcap_datalink(pd)) {
-				error("%s is not one of the DLTs supported by this device\n",
-				      yflag_dlt_name);
-			}
+			if (optarg == NULL || ascii_strcasecmp(optarg, "2m") == 0)
+				nd_big_pages(ND_PAGES_2M);
+			else if (ascii_strcasecmp(optarg, "1g") == 0)
+				nd_big_pages(ND_PAGES_1G);
+			else if (strcmp(optarg, "thp") == 0)
+				nd_big_pages(ND_PAGES_THP);
+			else
+				error("invalid --huge-pages argument %s", optarg);
+			break;
+
+		case OPTION_STRIPE_DIR:
+			stripe_dirs = (char **)realloc(stripe_dirs,
+			    (nstripe_dirs + 1) * sizeof(*stripe_dirs));
+			if (stripe_dirs == NULL)
+				error("realloc of the --stripe-dir list");
+			stripe_dirs[nstripe_dirs++] = optarg;
+			break;
+
+#ifdef COMPRESSED_READER_SUPPORTED
+		case OPTION_DECOMPRESS_THREADS:
+			decompress_threads = atoi(optarg);
+			if (decompress_threads <= 0)
+				error("invalid number of decompression threads %s",
+				    optarg);
+			break;
 #endif
-			(void)fprintf(stderr, "%s: data link type %s\n",
-				      program_name, yflag_dlt_name);
-			(void)fflush(stderr);
-		}
-		i = pcap_snapshot(pd);
-		if (ndo->ndo_snaplen < i) {
-			if (ndo->ndo_snaplen != 0)
-				warning("snaplen raised from %d to %d", ndo->ndo_snaplen, i);
-			ndo->ndo_snaplen = i;
-		} else if (ndo->ndo_snaplen > i) {
-			warning("snaplen lowered from %d to %d", ndo->ndo_snaplen, i);
-			ndo->ndo_snaplen = i;
-		}
-                if(ndo->ndo_fflag != 0) {
-                        if (pcap_lookupnet(device, &localnet, &netmask, ebuf) < 0) {
-                                warning("foreign (-f) flag used but: %s", ebuf);
-                        }
-                }
 
-	}
-	if (infile)
-		cmdbuf = read_infile(infile);
-	else
-		cmdbuf = copy_argv(&argv[optind]);
+		case OPTION_MMAP_SAVEFILE:
+			mmap_flag = 1;
+			break;
 
-#ifdef HAVE_PCAP_SET_OPTIMIZER_DEBUG
-	pcap_set_optimizer_debug(dflag);
+		case OPTION_RECYCLE_SAVEFILES:
+			recycle_flag = 1;
+			break;
+
+		case OPTION_STARTUP_TIME:
+			startup_time = 1;
+			break;
+
+		case OPTION_STARTUP_PROFILE:
+			startup_time = 1;
+			startup_profile = 1;
+			break;
 #endif
-	if (pcap_compile(pd, &fcode, cmdbuf, Oflag, netmask) < 0)
-		error("%s", pcap_geterr(pd));
-	if (dflag) {
-		bpf_dump(&fcode, dflag);
-		pcap_close(pd);
-		free(cmdbuf);
-		pcap_freecode(&fcode);
-		exit_tcpdump(S_SUCCESS);
-	}
 
-#ifdef HAVE_CASPER
-	if (!ndo->ndo_nflag)
-		capdns = capdns_setup();
-#endif	/* HAVE_CASPER */
+#ifdef DISSECT_THREADS_SUPPORTED
+		case OPTION_DISSECT_THREADS:
+			dissect_threads = atoi(optarg);
+			if (dissect_threads <= 0)
+				error("invalid number of dissection threads %s",
+				    optarg);
+			break;
 
-	init_print(ndo, localnet, netmask);
+		case OPTION_WORKER_OUTPUT:
+			worker_output = optarg;
+			break;
+#endif
 
-#ifndef _WIN32
-	(void)setsignal(SIGPIPE, cleanup);
-	(void)setsignal(SIGTERM, cleanup);
-#endif /* _WIN32 */
-	(void)setsignal(SIGINT, cleanup);
-#if defined(HAVE_FORK) || defined(HAVE_VFORK)
-	(void)setsignal(SIGCHLD, child_cleanup);
+		case OPTION_NAME_CACHE_SIZE:
+			i = atoi(optarg);
+			if (i <= 0)
+				error("invalid name cache size %s", optarg);
+			ndo->ndo_name_cache_size = i;
+			break;
+
+		case OPTION_NAME_CACHE_TTL:
+			i = atoi(optarg);
+			if (i < 0)
+				error("invalid name cache TTL %s", optarg);
+			ndo->ndo_name_cache_ttl = i;
+			break;
+
+		case OPTION_RESOLVE:
+			if (add_resolve_prefix(ndo, optarg) == -1)
+				error("invalid prefix to resolve %s", optarg);
+			break;
+
+#ifdef NAME_CACHE_FILE_SUPPORTED
+		case OPTION_NAME_CACHE_FILE:
+			if (name_cache_file_open(optarg, ebuf) == -1)
+				error("%s", ebuf);
+			break;
 #endif
-	/* Cooperate with nohup(1) */
-#ifndef _WIN32
-	if ((oldhandler = setsignal(SIGHUP, cleanup)) != SIG_DFL)
-		(void)setsignal(SIGHUP, oldhandler);
-#endif /* _WIN32 */
 
-#ifndef _WIN32
-	/*
-	 * If a user name was specified with "-Z", attempt to switch to
-	 * that user's UID.  This would probably be used with sudo,
-	 * to allow tcpdump to be run in a special restricted
-	 * account (if you just want to allow users to open capture
-	 * devices, and can't just give users that permission,
-	 * you'd make tcpdump set-UID or set-GID).
-	 *
-	 * Tcpdump doesn't necessarily write only to one savefile;
-	 * the general only way to allow a -Z instance to write to
-	 * savefiles as the user under whose UID it's run, rather
-	 * than as the user specified with -Z, would thus be to switch
-	 * to the original user ID before opening a capture file and
-	 * then switch back to the -Z user ID after opening the savefile.
-	 * Switching to the -Z user ID only after opening the first
-	 * savefile doesn't handle the general case.
-	 */
-
-	if (getuid() == 0 || geteuid() == 0) {
-#ifdef HAVE_LIBCAP_NG
-		/* Initialize capng */
-		capng_clear(CAPNG_SELECT_BOTH);
-		if (username) {
-DIAG_OFF_CLANG(assign-enum)
-			capng_updatev(
-				CAPNG_ADD,
-				CAPNG_PERMITTED | CAPNG_EFFECTIVE,
-				CAP_SETUID,
-				CAP_SETGID,
-				-1);
-DIAG_ON_CLANG(assign-enum)
-		}
-		if (chroot_dir) {
-DIAG_OFF_CLANG(assign-enum)
-			capng_update(
-				CAPNG_ADD,
-				CAPNG_PERMITTED | CAPNG_EFFECTIVE,
-				CAP_SYS_CHROOT
-				);
-DIAG_ON_CLANG(assign-enum)
-		}
+		case OPTION_CALL_CACHE_SIZE:
+			i = atoi(optarg);
+			if (i <= 0)
+				error("invalid call cache size %s", optarg);
+			ndo->ndo_call_cache_size = i;
+			break;
 
-		if (WFileName) {
-DIAG_OFF_CLANG(assign-enum)
-			capng_update(
-				CAPNG_ADD,
-				CAPNG_PERMITTED | CAPNG_EFFECTIVE,
-				CAP_DAC_OVERRIDE
-				);
-DIAG_ON_CLANG(assign-enum)
-		}
-		capng_apply(CAPNG_SELECT_BOTH);
-#endif /* HAVE_LIBCAP_NG */
-		if (username || chroot_dir)
-			droproot(username, chroot_dir);
+		case OPTION_STATE_MEMORY:
+			i = atoi(optarg);
+			if (i <= 0 || (size_t)i > SIZE_MAX / 1000000)
+				error("invalid state memory budget %s", optarg);
+			ndo->ndo_state_budget = (size_t)i * 1000000;
+			break;
 
-	}
-#endif /* _WIN32 */
+		case OPTION_MEM_LIMIT:
+			i = atoi(optarg);
+			if (i <= 0 || (size_t)i > SIZE_MAX / 1000000)
+				error("invalid memory limit %s", optarg);
+			ndo->ndo_mem_limit = (size_t)i * 1000000;
+			mem_limit = ndo->ndo_mem_limit;
+			break;
 
-	if (pcap_setfilter(pd, &fcode) < 0)
-		error("%s", pcap_geterr(pd));
-#ifdef HAVE_CAPSICUM
-	if (RFileName == NULL && VFileName == NULL && pcap_fileno(pd) != -1) {
-		static const unsigned long cmds[] = { BIOCGSTATS, BIOCROTZBUF };
+		case OPTION_MAX_OUTPUT:
+			i = atoi(optarg);
+			if (i <= 0)
+				error("invalid output limit %s", optarg);
+			ndo->ndo_max_output = (size_t)i;
+			break;
 
-		/*
-		 * The various libpcap devices use a combination of
-		 * read (bpf), ioctl (bpf, netmap), poll (netmap)
-		 * so we add the relevant access rights.
-		 */
-		cap_rights_init(&rights, CAP_IOCTL, CAP_READ, CAP_EVENT);
-		if (cap_rights_limit(pcap_fileno(pd), &rights) < 0 &&
-		    errno != ENOSYS) {
-			error("unable to limit pcap descriptor");
-		}
-		if (cap_ioctls_limit(pcap_fileno(pd), cmds,
-		    sizeof(cmds) / sizeof(cmds[0])) < 0 && errno != ENOSYS) {
-			error("unable to limit ioctls on pcap descriptor");
-		}
-	}
+#ifdef CONTROL_SOCKET_SUPPORTED
+		case OPTION_CONTROL_SOCKET:
+			control_path = optarg;
+			break;
 #endif
-	if (WFileName) {
-		/* Do not exceed the default PATH_MAX for files. */
-		dumpinfo.CurrentFileName = (char *)malloc(PATH_MAX + 1);
 
-		if (dumpinfo.CurrentFileName == NULL)
-			error("malloc of dumpinfo.CurrentFileName");
+#ifdef METRICS_SUPPORTED
+		case OPTION_METRICS:
+			metrics = metrics_open(optarg, ebuf);
+			if (metrics == NULL)
+				error("--metrics: %s", ebuf);
+			break;
+#endif
 
-		/* We do not need numbering for dumpfiles if Cflag isn't set. */
-		if (Cflag != 0)
-		  MakeFilename(dumpinfo.CurrentFileName, WFileName, 0, WflagChars);
-		else
-		  MakeFilename(dumpinfo.CurrentFileName, WFileName, 0, 0);
+		case OPTION_DEGRADE:
+			degrade = 1;
+			break;
 
-		pdd = pcap_dump_open(pd, dumpinfo.CurrentFileName);
-#ifdef HAVE_LIBCAP_NG
-		/* Give up CAP_DAC_OVERRIDE capability.
-		 * Only allow it to be restored if the -C or -G flag have been
-		 * set since we may need to create more files later on.
-		 */
-		capng_update(
-			CAPNG_DROP,
-			(Cflag || Gflag ? 0 : CAPNG_PERMITTED)
-				| CAPNG_EFFECTIVE,
-			CAP_DAC_OVERRIDE
-			);
-		capng_apply(CAPNG_SELECT_BOTH);
-#endif /* HAVE_LIBCAP_NG */
-		if (pdd == NULL)
-			error("%s", pcap_geterr(pd));
-#ifdef HAVE_CAPSICUM
-		set_dumper_capsicum_rights(pdd);
-#endif
-		if (Cflag != 0 || Gflag != 0) {
-#ifdef HAVE_CAPSICUM
-			dumpinfo.WFileName = strdup(basename(WFileName));
-			if (dumpinfo.WFileName == NULL) {
-				error("Unable to allocate memory for file %s",
-				    WFileName);
+#ifdef PRINT_THREAD_SUPPORTED
+		case OPTION_PRINT_THREAD:
+			i = PRINT_RING_DEFAULT_SIZE;
+			if (optarg != NULL) {
+				i = atoi(optarg);
+				if (i <= 0)
+					error("invalid print thread ring size %s",
+					    optarg);
 			}
-			dumpinfo.dirfd = open(dirname(WFileName),
-			    O_DIRECTORY | O_RDONLY);
-			if (dumpinfo.dirfd < 0) {
-				error("unable to open directory %s",
-				    dirname(WFileName));
+			print_ring_size = (size_t)i * 1024 * 1024;
+			break;
+#endif
+
+#ifdef OUTPUT_BUFFER_SUPPORTED
+		case OPTION_OUTPUT_THREAD:
+			i = OUTPUT_BUFFER_DEFAULT_SIZE;
+			output_drop = 0;
+			if (optarg != NULL) {
+				errno = 0;
+				i = (int)strtol(optarg, &endp, 10);
+				if (endp == optarg || errno != 0 || i <= 0)
+					error("invalid output thread buffer size %s",
+					    optarg);
+				if (strcmp(endp, ",drop") == 0)
+					output_drop = 1;
+				else if (*endp != '\0' &&
+				    strcmp(endp, ",block") != 0)
+					error("invalid output thread mode %s",
+					    optarg);
 			}
-			cap_rights_init(&rights, CAP_CREATE, CAP_FCNTL,
-			    CAP_FTRUNCATE, CAP_LOOKUP, CAP_SEEK, CAP_WRITE);
-			if (cap_rights_limit(dumpinfo.dirfd, &rights) < 0 &&
-			    errno != ENOSYS) {
-				error("unable to limit directory rights");
+			output_buffer_size = (size_t)i * 1024 * 1024;
+			break;
+#endif
+
+		case OPTION_LATENCY_REPORT:
+			ndo->ndo_latency = 1;
+			if (optarg != NULL) {
+				i = atoi(optarg);
+				if (i <= 0)
+					error("invalid latency report interval %s",
+					    optarg);
+				latency_interval = i;
 			}
-			if (cap_fcntls_limit(dumpinfo.dirfd, CAP_FCNTL_GETFL) < 0 &&
-			    errno != ENOSYS) {
-				error("unable to limit dump descriptor fcntls");
+			break;
+
+		case OPTION_BGP_SUMMARY:
+			ndo->ndo_bgp_summary = 1;
+			break;
+
+		case OPTION_BGP_PEERS:
+			ndo->ndo_bgp_peers = 1;
+			break;
+
+		case OPTION_LSDB:
+			ndo->ndo_lsdb = 1;
+			break;
+
+		case OPTION_BEACON_STATS:
+			beacon_stats = 1;
+			break;
+
+		case OPTION_NEIGHBORS:
+			neighbors = 1;
+			break;
+
+		case OPTION_WPAN_STATS:
+			wpan_stats = 1;
+			break;
+
+		case OPTION_OPENFLOW_SUMMARY:
+			ndo->ndo_openflow_summary = 1;
+			break;
+
+		case OPTION_RADIUS_SUMMARY:
+			if (radius_summary_attrs(optarg != NULL ? optarg :
+			    RADIUS_SUMMARY_DEFAULT) == -1)
+				error("invalid RADIUS attribute list %s", optarg);
+			ndo->ndo_radius_summary = 1;
+			break;
+
+		case OPTION_DHCP_EVENTS:
+			ndo->ndo_dhcp_events = 1;
+			break;
+
+		case OPTION_EXTRACT_PAYLOADS:
+			tap_file_name = optarg;
+			break;
+
+		case OPTION_PPP_SESSIONS:
+			ndo->ndo_ppp_sessions = 1;
+			break;
+
+		case OPTION_MCAST_GROUPS:
+			ndo->ndo_mcast_groups = 1;
+			break;
+
+		case OPTION_FILTER_PROGRAM:
+			progfile = optarg;
+			break;
+
+		case OPTION_HOSTS_FILE:
+			hosts_file = optarg;
+			break;
+
+		case OPTION_PAYLOAD_MATCH:
+			payload_file = optarg;
+			break;
+
+		case OPTION_DISPLAY_FILTER:
+			display_filter = optarg;
+			break;
+
+		case OPTION_DEDUP:
+			parse_dedup(optarg);
+			break;
+
+		case OPTION_MEMO:
+			parse_memo(optarg);
+			break;
+
+		case OPTION_MEMO_IGNORE:
+			parse_memo_ignore(optarg);
+			break;
+
+		case OPTION_CHANGES_ONLY:
+			ndo->ndo_changes_only = 1;
+			break;
+
+		case OPTION_ARP_WATCH:
+			ndo->ndo_arp_watch = ARP_WATCH_DEFAULT_RATE;
+			if (optarg != NULL) {
+				i = atoi(optarg);
+				if (i <= 0)
+					error("invalid --arp-watch rate %s", optarg);
+				ndo->ndo_arp_watch = i;
 			}
-#else	/* !HAVE_CAPSICUM */
-			dumpinfo.WFileName = WFileName;
+			break;
+
+		case OPTION_FLOW_TRUNCATE:
+			parse_flow_trunc(optarg);
+			break;
+
+		case OPTION_SPLIT_BY:
+			if (strcmp(optarg, "vni") == 0)
+				split_by = SPLIT_BY_VNI;
+			else if (strcmp(optarg, "vlan") == 0)
+				split_by = SPLIT_BY_VLAN;
+			else
+				error("invalid --split-by %s; it must be vni or vlan",
+				    optarg);
+			break;
+
+		case OPTION_SPLIT_OPEN_FILES:
+			i = atoi(optarg);
+			if (i <= 0)
+				error("invalid number of open files %s", optarg);
+			split_open_files = (u_int)i;
+			break;
+
+		case OPTION_FOLLOW:
+#ifndef FOLLOW_READER_SUPPORTED
+			error("--follow isn't supported on this platform");
 #endif
-			callback = dump_packet_and_trunc;
-			dumpinfo.pd = pd;
-			dumpinfo.pdd = pdd;
-			pcap_userdata = (u_char *)&dumpinfo;
-		} else {
-			callback = dump_packet;
-			dumpinfo.WFileName = WFileName;
-			dumpinfo.pd = pd;
-			dumpinfo.pdd = pdd;
-			pcap_userdata = (u_char *)&dumpinfo;
-		}
-		if (print) {
-			dlt = pcap_datalink(pd);
-			ndo->ndo_if_printer = get_if_printer(ndo, dlt);
-			dumpinfo.ndo = ndo;
-		} else
-			dumpinfo.ndo = NULL;
+			follow = 1;
+			break;
 
-#ifdef HAVE_PCAP_DUMP_FLUSH
-		if (Uflag)
-			pcap_dump_flush(pdd);
+		case OPTION_ANONYMIZE:
+#ifndef HAVE_LIBCRYPTO
+			error("--anonymize: crypto code not compiled in");
 #endif
-	} else {
-		dlt = pcap_datalink(pd);
-		ndo->ndo_if_printer = get_if_printer(ndo, dlt);
-		callback = print_packet;
-		pcap_userdata = (u_char *)ndo;
-	}
+			anon_keyfile = optarg;
+			break;
 
-#ifdef SIGNAL_REQ_INFO
-	/*
-	 * We can't get statistics when reading from a file rather
-	 * than capturing from a device.
-	 */
-	if (RFileName == NULL)
-		(void)setsignal(SIGNAL_REQ_INFO, requestinfo);
+		case OPTION_LABEL_BINDINGS:
+			ndo->ndo_label_bindings = 1;
+			break;
+
+		case OPTION_TCP_ANALYSIS:
+			ndo->ndo_tcp_analysis = 1;
+			break;
+
+		case OPTION_MPTCP_CONNECTIONS:
+			ndo->ndo_mptcp_connections = 1;
+			break;
+
+		case OPTION_RTP_ANALYSIS:
+			ndo->ndo_rtp_analysis = 1;
+			if (optarg != NULL) {
+				i = atoi(optarg);
+				if (i <= 0)
+					error("invalid RTP report interval %s",
+					    optarg);
+				rtp_interval = i;
+			}
+			break;
+
+		case OPTION_BFD_SESSIONS:
+			ndo->ndo_bfd_sessions = 1;
+			break;
+
+		case OPTION_SOMEIP_SUMMARY:
+			ndo->ndo_someip_summary = 1;
+			break;
+
+		case OPTION_V2X_STATIONS:
+			ndo->ndo_v2x_stations = 1;
+			if (optarg != NULL) {
+				i = atoi(optarg);
+				if (i <= 0)
+					error("invalid V2X station report interval %s",
+					    optarg);
+				v2x_interval = i;
+			}
+			break;
+
+		case OPTION_HTTP_TRANSACTIONS:
+			ndo->ndo_http_transactions = 1;
+			break;
+
+		case OPTION_COMMUNITY_ID:
+#ifndef HAVE_LIBCRYPTO
+			error("--community-id: crypto code not compiled in");
 #endif
-#ifdef SIGNAL_FLUSH_PCAP
-	(void)setsignal(SIGNAL_FLUSH_PCAP, flushpcap);
+			ndo->ndo_community_id = 1;
+			if (optarg != NULL) {
+				u_long seed;
+
+				seed = strtoul(optarg, &end, 0);
+				if (*optarg == '\0' || *end != '\0' ||
+				    seed > 65535)
+					error("invalid Community ID seed %s",
+					    optarg);
+				ndo->ndo_community_seed = (uint16_t)seed;
+			}
+			break;
+
+		case OPTION_HW_TIME_STAMP:
+			if (strcmp(optarg, "arista") == 0)
+				hw_tstamp = HW_TSTAMP_ARISTA;
+			else if (strcmp(optarg, "metamako") == 0)
+				hw_tstamp = HW_TSTAMP_METAMAKO;
+			else
+				error("invalid hardware time stamp type %s",
+				    optarg);
+			break;
+
+		case OPTION_CHECK_OUTGOING_CKSUMS:
+			ndo->ndo_check_outgoing = 1;
+			break;
+
+		case OPTION_PTP_STATS:
+			ptp_stats = 1;
+			if (optarg != NULL) {
+				i = atoi(optarg);
+				if (i <= 0)
+					error("invalid PTP report interval %s",
+					    optarg);
+				ptp_interval = i;
+			}
+			break;
+
+#ifdef ASYNC_RESOLVER_SUPPORTED
+		case OPTION_RESOLVER_THREADS:
+			i = atoi(optarg);
+			if (i <= 0)
+				error("invalid number of resolver threads %s",
+				    optarg);
+			ndo->ndo_resolver_threads = i;
+			break;
 #endif
 
-	if (ndo->ndo_vflag > 0 && WFileName && !print) {
-		/*
-		 * When capturing to a file, if "--print" wasn't specified,
-		 *"-v" means tcpdump should, once per second,
-		 * "v"erbosely report the number of packets captured.
+		default:
+			print_usage();
+			exit_tcpdump(S_ERR_HOST_PROGRAM);
+			/* NOTREACHED */
+		}
+
+#ifdef HAVE_PCAP_FINDALLDEVS
+	if (Dflag)
+		show_devices_and_exit();
+#endif
+#ifdef HAVE_PCAP_FINDALLDEVS_EX
+	if (remote_interfaces_source != NULL)
+		show_remote_devices_and_exit();
+#endif
+
+	switch (ndo->ndo_tflag) {
+
+	case 0: /* Default */
+	case 1: /* No time stamp */
+	case 2: /* Unix timeval style */
+	case 3: /* Microseconds/nanoseconds since previous packet */
+	case 4: /* Date + Default */
+	case 5: /* Microseconds/nanoseconds since first packet */
+		break;
+
+	default: /* Not supported */
+		error("only -t, -tt, -ttt, -tttt and -ttttt are supported");
+		break;
+	}
+
+	if (ndo->ndo_fflag != 0 && (VFileName != NULL || RFileName != NULL))
+		error("-f can not be used with -V or -r");
+
+	if (VFileName != NULL && RFileName != NULL)
+		error("-V and -r are mutually exclusive.");
+
+	if (field_output && json_output)
+		error("--field-output and --json are mutually exclusive.");
+
+	if (stats_only && (field_output || json_output))
+		error("--stats-only can not be used with --field-output or --json");
+	if (flows_format != -1 && (field_output || json_output || stats_only))
+		error("--flows can not be used with --field-output, --json or --stats-only");
+	if (flows_collect && flows_format == -1)
+		error("--flow-collector requires --flows");
+	if (topn_count != 0 && (field_output || json_output || stats_only ||
+	    flows_format != -1))
+		error("--top can not be used with --field-output, --json, --stats-only or --flows");
+	if (rates_format != -1 && (field_output || json_output ||
+	    stats_only || flows_format != -1 || topn_count != 0))
+		error("--rates can not be used with --field-output, --json, --stats-only, --flows or --top");
+#ifdef KERNEL_COUNTS_SUPPORTED
+	if (kernel_counts_flag) {
+		if (!stats_only && topn_count == 0)
+			error("--kernel-counts requires --stats-only or --top");
+		if (RFileName != NULL || VFileName != NULL)
+			error("--kernel-counts can only be used for a live capture");
+#ifdef MULTI_IFACE_SUPPORTED
+		if (multi_ndevices > 1)
+			error("--kernel-counts can not be used with more than one -i");
+#endif
+	}
+#endif
+	if (hw_tstamp != 0) {
+		/* The hardware time stamps are in nanoseconds. */
+#ifdef HAVE_PCAP_SET_TSTAMP_PRECISION
+		ndo->ndo_tstamp_precision = PCAP_TSTAMP_PRECISION_NANO;
+		hw_tstamp_nano = 1;
+#endif
+	}
+	if (ptp_stats && (field_output || json_output || stats_only ||
+	    flows_format != -1 || topn_count != 0 || rates_format != -1))
+		error("--ptp-stats can not be used with --field-output, --json, --stats-only, --flows, --top or --rates");
+	if (display_filter != NULL && (field_output || json_output ||
+	    stats_only || flows_format != -1 || topn_count != 0 ||
+	    rates_format != -1 || ptp_stats))
+		error("--display-filter can not be used with --field-output, --json, --stats-only, --flows, --top, --rates or --ptp-stats");
+	if (ndo->ndo_changes_only && (field_output || json_output))
+		error("--changes-only can not be used with --field-output or --json");
+	if (ndo->ndo_arp_watch && (field_output || json_output))
+		error("--arp-watch can not be used with --field-output or --json");
+	if (memo_nignore != 0 && memo_entries == 0)
+		error("--memo-ignore requires --memo");
+	if (memo_entries != 0 && (field_output || json_output ||
+	    display_filter != NULL))
+		error("--memo can not be used with --field-output, --json or --display-filter");
+	/*
+	 * What's fed by the printers misses the packets printed from the
+	 * memo, unless they're all dissected anyway.
+	 */
+	if (memo_entries != 0 && memo_mode != ND_MEMO_VERIFY &&
+	    (stats_only || flows_format != -1 || topn_count != 0 ||
+	     rates_format != -1 || ptp_stats || tap_file_name != NULL || ndo->ndo_latency ||
+	     ndo->ndo_bgp_summary || ndo->ndo_bgp_peers || ndo->ndo_lsdb ||
+	     ndo->ndo_openflow_summary || ndo->ndo_radius_summary ||
+	     ndo->ndo_dhcp_events || ndo->ndo_ppp_sessions ||
+	     ndo->ndo_mcast_groups || ndo->ndo_label_bindings ||
+	     ndo->ndo_tcp_analysis || ndo->ndo_mptcp_connections ||
+	     ndo->ndo_rtp_analysis || ndo->ndo_bfd_sessions ||
+	     ndo->ndo_someip_summary || ndo->ndo_v2x_stations ||
+	     ndo->ndo_http_transactions || ndo->ndo_changes_only ||
+	     ndo->ndo_arp_watch))
+		error("--memo can only be used with --stats-only, --flows, --top, --rates, --extract-payloads, --changes-only, --arp-watch or the summaries as --memo=verify");
+
+#ifdef HAVE_PTHREADS
+	if (writer_thread && WFileName == NULL)
+		error("--writer-thread can only be used with -w");
+#endif
+	if (flush_interval != 0 && WFileName == NULL)
+		error("--flush-interval can only be used with -w");
+#ifdef STREAM_SINK_SUPPORTED
+	if (WFileName != NULL && stream_sink_url(WFileName))
+		stream_flag = 1;
+#endif
+#ifdef SHM_RING_SUPPORTED
+	if (WFileName != NULL && shm_ring_url(WFileName))
+		shm_flag = 1;
+#endif
+#if defined(STREAM_SINK_SUPPORTED) || defined(SHM_RING_SUPPORTED)
+	/*
+	 * A stream or a ring has no file to rotate, compress, index or
+	 * seek in, and what's sent is in the pcap format.
+	 */
+	if (WFileName != NULL && unfiled_savefile(WFileName)) {
+		if (Cflag != 0 || Gflag != 0 || zflag != NULL)
+			error("-w %s can not be used with -C, -G or -z", WFileName);
+		if (pcapng_flag || mmap_flag || recycle_flag ||
+		    nstripe_dirs != 0)
+			error("-w %s can not be used with --pcapng, more than one -i, --mmap-savefile, --recycle-savefiles or --stripe-dir",
+			    WFileName);
+#ifdef GZIP_SAVEFILE_SUPPORTED
+		if (gzip_level != 0)
+			error("-w %s can not be used with --gzip-savefile",
+			    WFileName);
+#endif
+#ifdef URING_SAVEFILE_SUPPORTED
+		if (uring_flag != 0)
+			error("-w %s can not be used with --io-uring", WFileName);
+#endif
+		if (split_by != 0)
+			error("-w %s can not be used with --split-by", WFileName);
+#ifdef HAVE_CAPSICUM
+		/* Nor can a connection be made in the sandbox. */
+		error("-w %s can not be used in a Capsicum sandbox", WFileName);
+#endif
+	}
+#endif
+	if (mmap_flag && (WFileName == NULL || Cflag == 0))
+		error("--mmap-savefile can only be used with -w and -C");
+	if (recycle_flag) {
+		if (WFileName == NULL || strcmp(WFileName, "-") == 0 ||
+		    Cflag == 0 || Wflag == 0)
+			error("--recycle-savefiles can only be used with -w, -C and -W");
+		/* These write the file some other way, or replace it. */
+		if (zflag != NULL || mmap_flag)
+			error("--recycle-savefiles can not be used with -z or --mmap-savefile");
+#ifdef GZIP_SAVEFILE_SUPPORTED
+		if (gzip_level != 0)
+			error("--recycle-savefiles can not be used with --gzip-savefile");
+#endif
+#ifdef URING_SAVEFILE_SUPPORTED
+		if (uring_flag != 0)
+			error("--recycle-savefiles can not be used with --io-uring");
+#endif
+#ifdef HAVE_CAPSICUM
+		error("--recycle-savefiles can not be used in a Capsicum sandbox");
+#endif
+		recycle_names = (char **)calloc(Wflag, sizeof(*recycle_names));
+		if (recycle_names == NULL)
+			error("calloc of the --recycle-savefiles names");
+	}
+	if (nstripe_dirs != 0) {
+		if (WFileName == NULL || (Cflag == 0 && Gflag == 0))
+			error("--stripe-dir can only be used with -w and -C or -G");
+		/* The -w name is made relative to each directory. */
+		if (strcmp(WFileName, "-") == 0 || WFileName[0] == '/')
+			error("--stripe-dir needs a relative -w file name");
+#ifdef HAVE_CAPSICUM
+		/* Rotated savefiles are created in the -w directory. */
+		error("--stripe-dir can not be used in a Capsicum sandbox");
+#endif
+	}
+#ifdef GZIP_SAVEFILE_SUPPORTED
+	if (gzip_level != 0) {
+		if (WFileName == NULL)
+			error("--gzip-savefile can only be used with -w");
+		if (zflag != NULL || mmap_flag || write_index)
+			error("--gzip-savefile can not be used with -z, --mmap-savefile or --write-index");
+	}
+#endif
+#ifdef URING_SAVEFILE_SUPPORTED
+	if (uring_flag != 0) {
+		if (WFileName == NULL || strcmp(WFileName, "-") == 0)
+			error("--io-uring can only be used with -w and a file");
+		/* -z would compress a savefile before it's all written. */
+		if (zflag != NULL || mmap_flag)
+			error("--io-uring can not be used with -z or --mmap-savefile");
+#ifdef GZIP_SAVEFILE_SUPPORTED
+		if (gzip_level != 0)
+			error("--io-uring can not be used with --gzip-savefile");
+#endif
+	}
+#endif
+	if (progfile != NULL) {
+		if (infile != NULL || optind < argc)
+			error("--filter-program can not be used with -F or a filter expression");
+#ifdef FILE_THREADS_SUPPORTED
+		if (file_threads || merge_by_time)
+			error("--filter-program can not be used with --file-threads or --merge-by-time");
+#endif
+#ifdef MULTI_IFACE_SUPPORTED
+		if (multi_ndevices > 1)
+			error("--filter-program can not be used with more than one -i");
+#endif
+	}
+	if (flow_trunc_packets != 0) {
+		if (WFileName == NULL)
+			error("--flow-truncate can only be used with -w");
+#ifdef MULTI_IFACE_SUPPORTED
+		if (multi_ndevices > 1)
+			error("--flow-truncate can not be used with more than one -i");
+#endif
+	}
+	if (split_by != 0) {
+		if (WFileName == NULL)
+			error("--split-by can only be used with -w");
+		if (strcmp(WFileName, "-") == 0)
+			error("--split-by can not be used with -w -");
+#ifdef MULTI_IFACE_SUPPORTED
+		if (multi_ndevices > 1)
+			error("--split-by can not be used with more than one -i");
+#endif
+#ifdef HAVE_CAPSICUM
+		/* The split savefiles are created in the -w directory. */
+		error("--split-by can not be used in a Capsicum sandbox");
+#endif
+	}
+	if (follow) {
+		if (RFileName == NULL || VFileName != NULL)
+			error("--follow can only be used with -r");
+		if (Gflag != 0)
+			error("--follow can not be used with -G");
+		/* These read the file some other way, or seek in it. */
+		if (mmap_read || build_index || flow_sel.set)
+			error("--follow can not be used with --mmap-read, --build-index or --flow");
+		if (range_start.set || range_end.set || range_start_packet != 0)
+			error("--follow can not be used with --start-time, --end-time or --start-packet");
+#ifdef CHUNK_THREADS_SUPPORTED
+		if (chunk_threads)
+			error("--follow can not be used with --chunk-threads");
+#endif
+#ifdef FILE_THREADS_SUPPORTED
+		if (file_threads || merge_by_time)
+			error("--follow can not be used with --file-threads or --merge-by-time");
+#endif
+#ifdef HAVE_CAPSICUM
+		/* The next files are opened as they're started. */
+		error("--follow can not be used in a Capsicum sandbox");
+#endif
+#ifdef FOLLOW_READER_SUPPORTED
+		if (Cflag != 0) {
+			follow_name = RFileName;
+			RFileName = (char *)malloc(PATH_MAX + 1);
+			if (RFileName == NULL)
+				error("malloc of the --follow file name");
+			MakeFilename(RFileName, follow_name, 0, WflagChars);
+		}
+#endif
+	}
+	if (anon_keyfile != NULL) {
+		if (WFileName == NULL)
+			error("--anonymize can only be used with -w");
+#ifdef MULTI_IFACE_SUPPORTED
+		if (multi_ndevices > 1)
+			error("--anonymize can not be used with more than one -i");
+#endif
+	}
+	if (pcapng_flag) {
+		if (WFileName == NULL)
+			error("--pcapng can only be used with -w");
+		if (mmap_flag || write_index)
+			error("--pcapng can not be used with --mmap-savefile or --write-index");
+	}
+#ifndef _WIN32
+	if (mmap_read && RFileName == NULL && VFileName == NULL)
+		error("--mmap-read can only be used with -r or -V");
+	if (mmap_read && batch_size != 0)
+		error("--mmap-read can not be used with --batch-size");
+#endif
+	if (ndo->ndo_rtp_analysis && ndo->ndo_packettype != PT_RTP)
+		error("--rtp-analysis needs -T rtp");
+#ifdef COMPRESSED_READER_SUPPORTED
+	if (decompress_threads != 1 && RFileName == NULL && VFileName == NULL)
+		error("--decompress-threads can only be used with -r or -V");
+#endif
+#ifdef DISSECT_THREADS_SUPPORTED
+	/*
+	 * The time since the previous or first packet depends on that
+	 * packet having been dissected by the same thread.
+	 */
+	if (dissect_threads && (ndo->ndo_tflag == 3 || ndo->ndo_tflag == 5))
+		error("--dissect-threads can not be used with -ttt or -ttttt");
+	/* The counters aren't shared between threads. */
+	if (dissect_threads && stats_only)
+		error("--dissect-threads can not be used with --stats-only");
+	if (dissect_threads && flows_format != -1)
+		error("--dissect-threads can not be used with --flows");
+	if (dissect_threads && topn_count != 0)
+		error("--dissect-threads can not be used with --top");
+	if (dissect_threads && rates_format != -1)
+		error("--dissect-threads can not be used with --rates");
+	if (dissect_threads && ndo->ndo_latency)
+		error("--dissect-threads can not be used with --latency-report");
+	if (dissect_threads && (ndo->ndo_bgp_summary || ndo->ndo_bgp_peers))
+		error("--dissect-threads can not be used with --bgp-summary or --bgp-peers");
+	if (dissect_threads && ndo->ndo_openflow_summary)
+		error("--dissect-threads can not be used with --openflow-summary");
+	if (dissect_threads && ptp_stats)
+		error("--dissect-threads can not be used with --ptp-stats");
+	if (dissect_threads && ndo->ndo_lsdb)
+		error("--dissect-threads can not be used with --lsdb");
+	if (dissect_threads && tap_file_name != NULL)
+		error("--dissect-threads can not be used with --extract-payloads");
+	if (dissect_threads && ndo->ndo_ppp_sessions)
+		error("--dissect-threads can not be used with --ppp-sessions");
+	if (dissect_threads && ndo->ndo_mcast_groups)
+		error("--dissect-threads can not be used with --mcast-groups");
+	if (dissect_threads && ndo->ndo_label_bindings)
+		error("--dissect-threads can not be used with --label-bindings");
+	if (dissect_threads && ndo->ndo_tcp_analysis)
+		error("--dissect-threads can not be used with --tcp-analysis");
+	if (dissect_threads && ndo->ndo_mptcp_connections)
+		error("--dissect-threads can not be used with --mptcp-connections");
+	if (dissect_threads && ndo->ndo_rtp_analysis)
+		error("--dissect-threads can not be used with --rtp-analysis");
+	if (dissect_threads && ndo->ndo_bfd_sessions)
+		error("--dissect-threads can not be used with --bfd-sessions");
+	if (dissect_threads && ndo->ndo_someip_summary)
+		error("--dissect-threads can not be used with --someip-summary");
+	if (dissect_threads && ndo->ndo_v2x_stations)
+		error("--dissect-threads can not be used with --v2x-stations");
+	if (worker_output != NULL && !dissect_threads)
+		error("--worker-output requires --dissect-threads");
+#ifdef OUTPUT_BUFFER_SUPPORTED
+	if (worker_output != NULL && output_buffer_size != 0)
+		error("--worker-output can not be used with --output-thread");
+#endif
+#ifdef ENABLE_DISSECTOR_PROFILE
+	if (dissect_threads && (profile_dissectors || snaplen_report))
+		error("--dissect-threads can not be used with --profile-dissectors or --snaplen-report");
+#endif
+#endif
+#ifdef PRINT_THREAD_SUPPORTED
+	if (print_ring_size != 0) {
+		if (dissect_threads)
+			error("--print-thread can not be used with --dissect-threads");
+#ifdef CHUNK_THREADS_SUPPORTED
+		if (chunk_threads)
+			error("--print-thread can not be used with --chunk-threads");
+#endif
+#ifdef FILE_THREADS_SUPPORTED
+		if (file_threads || merge_by_time)
+			error("--print-thread can not be used with --file-threads or --merge-by-time");
+#endif
+#ifdef MULTI_IFACE_SUPPORTED
+		if (multi_ndevices > 1)
+			error("--print-thread can not be used with more than one -i");
+#endif
+		/*
+		 * The reports are made on the capture thread, and some of
+		 * what they report on is kept per thread.
 		 */
-#ifdef _WIN32
+		if (stats_only || flows_format != -1 || topn_count != 0 ||
+		    rates_format != -1 || ndo->ndo_latency || ptp_stats ||
+		    ndo->ndo_lsdb)
+			error("--print-thread can not be used with --stats-only, --flows, --top, --rates, --latency-report, --ptp-stats or --lsdb");
+		if (ndo->ndo_bgp_summary || ndo->ndo_bgp_peers ||
+		    ndo->ndo_openflow_summary)
+			error("--print-thread can not be used with --bgp-summary, --bgp-peers or --openflow-summary");
+		if (tap_file_name != NULL)
+			error("--print-thread can not be used with --extract-payloads");
+		if (ndo->ndo_ppp_sessions)
+			error("--print-thread can not be used with --ppp-sessions");
+		if (ndo->ndo_mcast_groups)
+			error("--print-thread can not be used with --mcast-groups");
+		if (ndo->ndo_label_bindings)
+			error("--print-thread can not be used with --label-bindings");
+		if (ndo->ndo_tcp_analysis)
+			error("--print-thread can not be used with --tcp-analysis");
+		if (ndo->ndo_mptcp_connections)
+			error("--print-thread can not be used with --mptcp-connections");
+		if (ndo->ndo_rtp_analysis)
+			error("--print-thread can not be used with --rtp-analysis");
+		if (ndo->ndo_bfd_sessions)
+			error("--print-thread can not be used with --bfd-sessions");
+		if (ndo->ndo_someip_summary)
+			error("--print-thread can not be used with --someip-summary");
+		if (ndo->ndo_v2x_stations)
+			error("--print-thread can not be used with --v2x-stations");
+#ifdef ENABLE_DISSECTOR_PROFILE
+		if (profile_dissectors || snaplen_report)
+			error("--print-thread can not be used with --profile-dissectors or --snaplen-report");
+#endif
+	}
+#endif
+#ifdef CHUNK_THREADS_SUPPORTED
+	if (chunk_threads) {
+		if (RFileName == NULL && VFileName == NULL)
+			error("--chunk-threads can only be used with -r or -V");
+		if (WFileName != NULL || count_mode)
+			error("--chunk-threads can not be used with -w or --count");
+		if (dissect_threads || batch_size != 0)
+			error("--chunk-threads can not be used with --dissect-threads or --batch-size");
 		/*
-		 * https://blogs.msdn.microsoft.com/oldnewthing/20151230-00/?p=92741
-		 *
-		 * suggests that this dates back to W2K.
+		 * How many packets are in the chunks before a chunk
+		 * isn't known until they've been read.
+		 */
+		if (cnt != -1 || ndo->ndo_packet_number)
+			error("--chunk-threads can not be used with -c or -#");
+		if (ndo->ndo_tflag == 3 || ndo->ndo_tflag == 5)
+			error("--chunk-threads can not be used with -ttt or -ttttt");
+		if (stats_only || flows_format != -1 || topn_count != 0 ||
+		    rates_format != -1)
+			error("--chunk-threads can not be used with --stats-only, --flows, --top or --rates");
+		if (sample_rate != 0)
+			error("--chunk-threads can not be used with --sample or --flow-sample");
+		if (hosts_file != NULL)
+			error("--chunk-threads can not be used with --hosts-file");
+		if (payload_file != NULL)
+			error("--chunk-threads can not be used with --payload-match");
+		if (dedup_window != 0)
+			error("--chunk-threads can not be used with --dedup");
+		if (beacon_stats)
+			error("--chunk-threads can not be used with --beacon-stats");
+		if (neighbors)
+			error("--chunk-threads can not be used with --neighbors");
+		if (wpan_stats)
+			error("--chunk-threads can not be used with --wpan-stats");
+		if (decap_filter != NULL || decap_write_inner)
+			error("--chunk-threads can not be used with --inner-filter or --write-inner");
+		if (ndo->ndo_latency)
+			error("--chunk-threads can not be used with --latency-report");
+		if (ndo->ndo_bgp_summary || ndo->ndo_bgp_peers)
+			error("--chunk-threads can not be used with --bgp-summary or --bgp-peers");
+		if (ndo->ndo_openflow_summary)
+			error("--chunk-threads can not be used with --openflow-summary");
+		if (ptp_stats)
+			error("--chunk-threads can not be used with --ptp-stats");
+		if (ndo->ndo_lsdb)
+			error("--chunk-threads can not be used with --lsdb");
+		if (tap_file_name != NULL)
+			error("--chunk-threads can not be used with --extract-payloads");
+		if (ndo->ndo_ppp_sessions)
+			error("--chunk-threads can not be used with --ppp-sessions");
+		if (ndo->ndo_mcast_groups)
+			error("--chunk-threads can not be used with --mcast-groups");
+		if (ndo->ndo_label_bindings)
+			error("--chunk-threads can not be used with --label-bindings");
+		if (ndo->ndo_tcp_analysis)
+			error("--chunk-threads can not be used with --tcp-analysis");
+		if (ndo->ndo_mptcp_connections)
+			error("--chunk-threads can not be used with --mptcp-connections");
+		if (ndo->ndo_rtp_analysis)
+			error("--chunk-threads can not be used with --rtp-analysis");
+		if (ndo->ndo_bfd_sessions)
+			error("--chunk-threads can not be used with --bfd-sessions");
+		if (ndo->ndo_someip_summary)
+			error("--chunk-threads can not be used with --someip-summary");
+		if (ndo->ndo_v2x_stations)
+			error("--chunk-threads can not be used with --v2x-stations");
+		if (ndo->ndo_http_transactions)
+			error("--chunk-threads can not be used with --http-transactions");
+		if (ndo->ndo_tcp_reasm_budget != 0)
+			error("--chunk-threads can not be used with --tcp-reassembly");
+		if (ndo->ndo_ip_reasm_budget != 0)
+			error("--chunk-threads can not be used with --ip-reassembly");
+#ifdef ENABLE_DISSECTOR_PROFILE
+		if (profile_dissectors || snaplen_report)
+			error("--chunk-threads can not be used with --profile-dissectors or --snaplen-report");
+#endif
+		/* The chunks are read through mappings. */
+		mmap_read = 1;
+	}
+#endif
+#ifdef FILE_THREADS_SUPPORTED
+	if (merge_by_time && file_threads == 0)
+		file_threads = 1;
+	if (file_threads) {
+		if (VFileName == NULL)
+			error("--file-threads and --merge-by-time can only be used with -V");
+		if (WFileName != NULL || count_mode)
+			error("--file-threads and --merge-by-time can not be used with -w or --count");
+		if (dissect_threads || chunk_threads || batch_size != 0 ||
+		    mmap_read)
+			error("--file-threads and --merge-by-time can not be used with --dissect-threads, --chunk-threads, --batch-size or --mmap-read");
+		/*
+		 * Neither how many packets are in the savefiles before
+		 * a savefile nor the last packet before its first packet
+		 * is known until they've been read.
+		 */
+		if (cnt != -1 || ndo->ndo_packet_number)
+			error("--file-threads and --merge-by-time can not be used with -c or -#");
+		if (ndo->ndo_tflag == 3 || ndo->ndo_tflag == 5)
+			error("--file-threads and --merge-by-time can not be used with -ttt or -ttttt");
+		if (stats_only || flows_format != -1 || topn_count != 0 ||
+		    rates_format != -1)
+			error("--file-threads and --merge-by-time can not be used with --stats-only, --flows, --top or --rates");
+		if (sample_rate != 0)
+			error("--file-threads and --merge-by-time can not be used with --sample or --flow-sample");
+		if (hosts_file != NULL)
+			error("--file-threads and --merge-by-time can not be used with --hosts-file");
+		if (payload_file != NULL)
+			error("--file-threads and --merge-by-time can not be used with --payload-match");
+		if (dedup_window != 0)
+			error("--file-threads and --merge-by-time can not be used with --dedup");
+		if (beacon_stats)
+			error("--file-threads and --merge-by-time can not be used with --beacon-stats");
+		if (neighbors)
+			error("--file-threads and --merge-by-time can not be used with --neighbors");
+		if (wpan_stats)
+			error("--file-threads and --merge-by-time can not be used with --wpan-stats");
+		if (decap_filter != NULL || decap_write_inner)
+			error("--file-threads and --merge-by-time can not be used with --inner-filter or --write-inner");
+		if (ndo->ndo_latency)
+			error("--file-threads and --merge-by-time can not be used with --latency-report");
+		if (ndo->ndo_bgp_summary || ndo->ndo_bgp_peers)
+			error("--file-threads and --merge-by-time can not be used with --bgp-summary or --bgp-peers");
+		if (ndo->ndo_openflow_summary)
+			error("--file-threads and --merge-by-time can not be used with --openflow-summary");
+		if (ptp_stats)
+			error("--file-threads and --merge-by-time can not be used with --ptp-stats");
+		if (ndo->ndo_lsdb)
+			error("--file-threads and --merge-by-time can not be used with --lsdb");
+		if (tap_file_name != NULL)
+			error("--file-threads and --merge-by-time can not be used with --extract-payloads");
+		if (ndo->ndo_ppp_sessions)
+			error("--file-threads and --merge-by-time can not be used with --ppp-sessions");
+		if (ndo->ndo_mcast_groups)
+			error("--file-threads and --merge-by-time can not be used with --mcast-groups");
+		if (ndo->ndo_label_bindings)
+			error("--file-threads and --merge-by-time can not be used with --label-bindings");
+		if (ndo->ndo_tcp_analysis)
+			error("--file-threads and --merge-by-time can not be used with --tcp-analysis");
+		if (ndo->ndo_mptcp_connections)
+			error("--file-threads and --merge-by-time can not be used with --mptcp-connections");
+		if (ndo->ndo_rtp_analysis)
+			error("--file-threads and --merge-by-time can not be used with --rtp-analysis");
+		if (ndo->ndo_bfd_sessions)
+			error("--file-threads and --merge-by-time can not be used with --bfd-sessions");
+		if (ndo->ndo_someip_summary)
+			error("--file-threads and --merge-by-time can not be used with --someip-summary");
+		if (ndo->ndo_v2x_stations)
+			error("--file-threads and --merge-by-time can not be used with --v2x-stations");
+		if (ndo->ndo_http_transactions)
+			error("--file-threads and --merge-by-time can not be used with --http-transactions");
+		if (ndo->ndo_tcp_reasm_budget != 0)
+			error("--file-threads and --merge-by-time can not be used with --tcp-reassembly");
+		if (ndo->ndo_ip_reasm_budget != 0)
+			error("--file-threads and --merge-by-time can not be used with --ip-reassembly");
+#ifdef ENABLE_DISSECTOR_PROFILE
+		if (profile_dissectors || snaplen_report)
+			error("--file-threads and --merge-by-time can not be used with --profile-dissectors or --snaplen-report");
+#endif
+	}
+#endif
+	/*
+	 * --bgp-peers and --openflow-summary count whole messages, and
+	 * --http-transactions pairs them, however they were segmented.
+	 */
+	if ((ndo->ndo_bgp_peers || ndo->ndo_openflow_summary ||
+	    ndo->ndo_http_transactions) &&
+	    ndo->ndo_tcp_reasm_budget == 0)
+		ndo->ndo_tcp_reasm_budget =
+		    (size_t)TCP_REASM_DEFAULT_BUDGET * 1000000;
+	if (write_index) {
+		if (WFileName == NULL)
+			error("--write-index can only be used with -w");
+		if (strcmp(WFileName, "-") == 0)
+			error("--write-index can not be used with -w -");
+		index_nano = nano_tstamps(ndo);
+	}
+	if (build_index) {
+		if (RFileName == NULL)
+			error("--build-index can only be used with -r");
+		if (WFileName != NULL)
+			error("--build-index can not be used with -w");
+	}
+	if (flow_index) {
+		if (WFileName == NULL && !build_index)
+			error("--flow-index can only be used with -w or --build-index");
+		if (WFileName != NULL && strcmp(WFileName, "-") == 0)
+			error("--flow-index can not be used with -w -");
+		if (pcapng_flag)
+			error("--flow-index can not be used with --pcapng");
+#ifdef GZIP_SAVEFILE_SUPPORTED
+		if (gzip_level != 0)
+			error("--flow-index can not be used with --gzip-savefile");
+#endif
+#ifdef MULTI_IFACE_SUPPORTED
+		if (multi_ndevices > 1)
+			error("--flow-index can not be used with more than one -i");
+#endif
+	}
+	if (flow_sel.set) {
+		if (RFileName == NULL)
+			error("--flow can only be used with -r");
+		if (build_index)
+			error("--flow can not be used with --build-index");
+		if (range_start.set || range_end.set || range_start_packet != 0)
+			error("--flow can not be used with --start-time, --end-time or --start-packet");
+		if (batch_size != 0)
+			error("--flow can not be used with --batch-size");
+#ifdef CHUNK_THREADS_SUPPORTED
+		if (chunk_threads)
+			error("--flow can not be used with --chunk-threads");
+#endif
+	}
+	if (flight_size == 0 && (flight_window != 0 || flight_trigger != NULL ||
+	    flight_start != NULL || flight_stop != NULL ||
+	    flight_after != FLIGHT_DEFAULT_AFTER))
+		error("--flight-window, --flight-after, --flight-trigger, --flight-start and --flight-stop can only be used with --flight-recorder");
+	if ((flight_start == NULL) != (flight_stop == NULL))
+		error("--flight-start and --flight-stop must be used together");
+	if (flight_size != 0) {
+		if (WFileName == NULL)
+			error("--flight-recorder can only be used with -w");
+		if (count_mode)
+			error("--flight-recorder can not be used with --count");
+	}
+#ifdef MULTI_IFACE_SUPPORTED
+	if (multi_ndevices > 1) {
+		if (RFileName != NULL || VFileName != NULL)
+			error("-i can only be given more than once for a live capture");
+		if (mmap_flag || write_index)
+			error("-i can not be given more than once with --mmap-savefile or --write-index");
+		if (writer_thread || flight_size != 0 || batch_size != 0)
+			error("-i can not be given more than once with --writer-thread, --flight-recorder or --batch-size");
+#ifdef DISSECT_THREADS_SUPPORTED
+		if (dissect_threads)
+			error("-i can not be given more than once with --dissect-threads");
+#endif
+		/* The first one is opened as pd, as if it were the only one. */
+		device = multi_devices[0];
+		/* Only a pcapng savefile can have more than one interface. */
+		pcapng_flag = 1;
+	}
+#ifdef FANOUT_SUPPORTED
+	if (fanout_count != 0) {
+		if (RFileName != NULL || VFileName != NULL)
+			error("--fanout can only be used for a live capture");
+		if (multi_ndevices > 1)
+			error("--fanout can not be used with more than one -i");
+		if (flight_size != 0 || batch_size != 0)
+			error("--fanout can not be used with --flight-recorder or --batch-size");
+		if (writer_thread && pcapng_flag)
+			error("--fanout can not be used with --writer-thread and --pcapng");
+		/*
+		 * The same interface, opened once for each socket in the
+		 * group; the first one is pd, as for more than one -i.
+		 */
+		multi_ndevices = fanout_count;
+	}
+#endif
+#endif
+#ifdef CONTROL_SOCKET_SUPPORTED
+	/*
+	 * The socket is only looked at by capture_batches(), and the
+	 * flags are only set in the one netdissect_options.
+	 */
+	if (control_path != NULL) {
+		if (VFileName != NULL || mmap_read)
+			error("--control-socket can not be used with -V or --mmap-read");
+#ifdef CHUNK_THREADS_SUPPORTED
+		if (chunk_threads)
+			error("--control-socket can not be used with --chunk-threads");
+#endif
+#ifdef MULTI_IFACE_SUPPORTED
+		if (multi_ndevices > 1)
+			error("--control-socket can not be used with more than one -i or with --fanout");
+#endif
+#ifdef DISSECT_THREADS_SUPPORTED
+		if (dissect_threads)
+			error("--control-socket can not be used with --dissect-threads");
+#endif
+#ifdef PRINT_THREAD_SUPPORTED
+		if (print_ring_size != 0)
+			error("--control-socket can not be used with --print-thread");
+#endif
+	}
+#endif
+	/*
+	 * The drops are only looked at by capture_batches(), for the one
+	 * pcap_t.
+	 */
+	if (degrade) {
+		if (RFileName != NULL || VFileName != NULL)
+			error("--degrade can only be used for a live capture");
+		if ((WFileName != NULL && !print) || count_mode)
+			error("--degrade can only be used when printing packets");
+		if (field_output || json_output || stats_only ||
+		    flows_format != -1 || topn_count != 0 ||
+		    rates_format != -1 || ptp_stats)
+			error("--degrade can not be used with --field-output, --json, --stats-only, --flows, --top, --rates or --ptp-stats");
+#ifdef CONTROL_SOCKET_SUPPORTED
+		if (control_path != NULL)
+			error("--degrade can not be used with --control-socket");
+#endif
+#ifdef MULTI_IFACE_SUPPORTED
+		if (multi_ndevices > 1)
+			error("--degrade can not be used with more than one -i or with --fanout");
+#endif
+	}
+#ifdef OUTPUT_BUFFER_SUPPORTED
+	if (output_buffer_size != 0) {
+		if ((WFileName != NULL && !print) || count_mode)
+			error("--output-thread can only be used when printing packets");
+#ifdef CHUNK_THREADS_SUPPORTED
+		if (chunk_threads)
+			error("--output-thread can not be used with --chunk-threads");
+#endif
+#ifdef FILE_THREADS_SUPPORTED
+		if (file_threads || merge_by_time)
+			error("--output-thread can not be used with --file-threads or --merge-by-time");
+#endif
+		/*
+		 * Throwing away part of the field output would leave the
+		 * rest of it unreadable.
+		 */
+		if (output_drop && field_output)
+			error("--output-thread with drop can not be used with --field-output");
+	}
+#endif
+#ifdef SHM_RING_SUPPORTED
+	if (shm_output_name != NULL) {
+		if ((WFileName != NULL && !print) || count_mode)
+			error("--shm-output can only be used when printing packets");
+#ifdef OUTPUT_BUFFER_SUPPORTED
+		if (output_buffer_size != 0)
+			error("--shm-output can not be used with --output-thread");
+#endif
+#ifdef CHUNK_THREADS_SUPPORTED
+		if (chunk_threads)
+			error("--shm-output can not be used with --chunk-threads");
+#endif
+#ifdef FILE_THREADS_SUPPORTED
+		if (file_threads || merge_by_time)
+			error("--shm-output can not be used with --file-threads or --merge-by-time");
+#endif
+	}
+#endif
+	if (range_start.set || range_end.set || range_start_packet != 0) {
+		if (RFileName == NULL)
+			error("--start-time, --end-time and --start-packet can only be used with -r");
+		if (batch_size != 0)
+			error("--start-time, --end-time and --start-packet can not be used with --batch-size");
+#ifdef CHUNK_THREADS_SUPPORTED
+		if (chunk_threads)
+			error("--start-time, --end-time and --start-packet can not be used with --chunk-threads");
+#endif
+		range_active = 1;
+		if (range_start_packet == 0)
+			range_start_packet = 1;
+	}
+
+	/*
+	 * If we're printing dissected packets to the standard output,
+	 * and either the standard output is a terminal or we're doing
+	 * "line" buffering, set the capture timeout to .1 second rather
+	 * than 1 second, as the user's probably expecting to see packets
+	 * pop up immediately shortly after they arrive.
+	 *
+	 * XXX - would there be some value appropriate for all cases,
+	 * based on, say, the buffer size and packet input rate?
+	 */
+	if ((WFileName == NULL || print) && (isatty(1) || lflag))
+		timeout = 100;
+
+#ifdef WITH_CHROOT
+	/* if run as root, prepare for chrooting */
+	if (getuid() == 0 || geteuid() == 0) {
+		/* future extensibility for cmd-line arguments */
+		if (!chroot_dir)
+			chroot_dir = WITH_CHROOT;
+	}
+#endif
+
+#ifdef WITH_USER
+	/* if run as root, prepare for dropping root privileges */
+	if (getuid() == 0 || geteuid() == 0) {
+		/* Run with '-Z root' to restore old behaviour */
+		if (!username)
+			username = WITH_USER;
+	}
+#endif
+
+	startup_phase("parsing the options");
+	if (RFileName != NULL || VFileName != NULL) {
+		/*
+		 * If RFileName is non-null, it's the pathname of a
+		 * savefile to read.  If VFileName is non-null, it's
+		 * the pathname of a file containing a list of pathnames
+		 * (one per line) of savefiles to read.
 		 *
-		 * I don't know what a "long wait" is, but we'll assume
-		 * that printing the stats could be a "long wait".
+		 * In either case, we're reading a savefile, not doing
+		 * a live capture.
 		 */
-		CreateTimerQueueTimer(&timer_handle, NULL,
-		    verbose_stats_dump, NULL, 1000, 1000,
-		    WT_EXECUTEDEFAULT|WT_EXECUTELONGFUNCTION);
-		setvbuf(stderr, NULL, _IONBF, 0);
-#else /* _WIN32 */
+#ifdef CPU_AFFINITY_SUPPORTED
+		affinity_setup(NULL);
+#endif
+#ifndef _WIN32
 		/*
-		 * Assume this is UN*X, and that it has setitimer(); that
-		 * dates back to UNIX 95.
+		 * We don't need network access, so relinquish any set-UID
+		 * or set-GID privileges we have (if any).
+		 *
+		 * We do *not* want set-UID privileges when opening a
+		 * trace file, as that might let the user read other
+		 * people's trace files (especially if we're set-UID
+		 * root).
 		 */
-		struct itimerval timer;
-		(void)setsignal(SIGALRM, verbose_stats_dump);
-		timer.it_interval.tv_sec = 1;
-		timer.it_interval.tv_usec = 0;
-		timer.it_value.tv_sec = 1;
-		timer.it_value.tv_usec = 1;
-		setitimer(ITIMER_REAL, &timer, NULL);
+		if (setgid(getgid()) != 0 || setuid(getuid()) != 0 )
+			fprintf(stderr, "Warning: setgid/setuid failed !\n");
 #endif /* _WIN32 */
-	}
+		if (VFileName != NULL) {
+			if (VFileName[0] == '-' && VFileName[1] == '\0')
+				VFile = stdin;
+			else
+				VFile = fopen(VFileName, "r");
+
+			if (VFile == NULL)
+				error("Unable to open file: %s\n", pcap_strerror(errno));
+
+			ret = get_next_file(VFile, VFileLine);
+			if (!ret)
+				error("Nothing in %s\n", VFileName);
+			RFileName = VFileLine;
+		}
+
+		pd = open_savefile(ndo, RFileName, &zfd, ebuf);
+		if (pd == NULL)
+			error("%s", ebuf);
+#ifdef CHUNK_THREADS_SUPPORTED
+		if (chunk_threads && zfd != -1)
+			error("--chunk-threads can not be used with a compressed savefile");
+#endif
+#ifdef HAVE_CAPSICUM
+		cap_rights_init(&rights, CAP_READ);
+		if (cap_rights_limit(zfd != -1 ? zfd : fileno(pcap_file(pd)),
+		    &rights) < 0 && errno != ENOSYS) {
+			error("unable to limit pcap descriptor");
+		}
+#endif
+#ifndef _WIN32
+		/* A compressed savefile is read through its decompressor. */
+		if (mmap_read && zfd == -1 &&
+		    (mmap_reader = mmap_reader_open(pd, RFileName, ebuf)) == NULL)
+			error("%s", ebuf);
+#endif
+		dlt = pcap_datalink(pd);
+		dlt_name = pcap_datalink_val_to_name(dlt);
+		fprintf(stderr, "reading from file %s", RFileName);
+		if (dlt_name == NULL) {
+			fprintf(stderr, ", link-type %u", dlt);
+		} else {
+			fprintf(stderr, ", link-type %s (%s)", dlt_name,
+				pcap_datalink_val_to_description(dlt));
+		}
+		fprintf(stderr, ", snapshot length %d\n", pcap_snapshot(pd));
+#ifdef DLT_LINUX_SLL2
+		if (dlt == DLT_LINUX_SLL2)
+			fprintf(stderr, "Warning: interface names might be incorrect\n");
+#endif
+		if (build_index) {
+			build_savefile_index(ndo, pd, RFileName);
+			exit_tcpdump(0);
+		}
+		if (flow_sel.set)
+			flow_sel_open(pd, RFileName);
+	} else if (dflag && !device) {
+		int dump_dlt = DLT_EN10MB;
+		/*
+		 * We're dumping the compiled code without an explicit
+		 * device specification.  (If a device is specified, we
+		 * definitely want to open it to use the DLT of that device.)
+		 * Either default to DLT_EN10MB with a warning, or use
+		 * the user-specified value if supplied.
+		 */
+		/*
+		 * If no snapshot length was specified, or a length of 0 was
+		 * specified, default to 256KB.
+		 */
+		if (ndo->ndo_snaplen == 0)
+			ndo->ndo_snaplen = MAXIMUM_SNAPLEN;
+		/*
+		 * If a DLT was specified with the -y flag, use that instead.
+		 */
+		if (yflag_dlt != -1)
+			dump_dlt = yflag_dlt;
+		else
+			fprintf(stderr, "Warning: assuming Ethernet\n");
+	        pd = pcap_open_dead(dump_dlt, ndo->ndo_snaplen);
+	} else {
+		/*
+		 * We're doing a live capture.
+		 */
+		if (device == NULL) {
+			/*
+			 * No interface was specified.  Pick one.
+			 */
+#ifdef HAVE_PCAP_FINDALLDEVS
+			/*
+			 * Find the list of interfaces, and pick
+			 * the first interface.
+			 */
+			if (pcap_findalldevs(&devlist, ebuf) == -1)
+				error("%s", ebuf);
+			if (devlist == NULL)
+				error("no interfaces available for capture");
+			device = strdup(devlist->name);
+			pcap_freealldevs(devlist);
+#else /* HAVE_PCAP_FINDALLDEVS */
+			/*
+			 * Use whatever interface pcap_lookupdev()
+			 * chooses.
+			 */
+			device = pcap_lookupdev(ebuf);
+			if (device == NULL)
+				error("%s", ebuf);
+#endif
+		}
+
+#ifdef CPU_AFFINITY_SUPPORTED
+		/* Before it's opened, so its buffer is allocated there. */
+		affinity_setup(device);
+#endif
+
+		/*
+		 * Try to open the interface with the specified name.
+		 */
+		pd = open_interface(device, ndo, ebuf);
+		if (pd == NULL) {
+			/*
+			 * That failed.  If we can get a list of
+			 * interfaces, and the interface name
+			 * is purely numeric, try to use it as
+			 * a 1-based index in the list of
+			 * interfaces.
+			 */
+#ifdef HAVE_PCAP_FINDALLDEVS
+			devnum = parse_interface_number(device);
+			if (devnum == -1) {
+				/*
+				 * It's not a number; just report
+				 * the open error and fail.
+				 */
+				error("%s", ebuf);
+			}
+
+			/*
+			 * OK, it's a number; try to find the
+			 * interface with that index, and try
+			 * to open it.
+			 *
+			 * find_interface_by_number() exits if it
+			 * couldn't be found.
+			 */
+			device = find_interface_by_number(device, devnum);
+			pd = open_interface(device, ndo, ebuf);
+			if (pd == NULL)
+				error("%s", ebuf);
+#else /* HAVE_PCAP_FINDALLDEVS */
+			/*
+			 * We can't get a list of interfaces; just
+			 * fail.
+			 */
+			error("%s", ebuf);
+#endif /* HAVE_PCAP_FINDALLDEVS */
+		}
+
+#ifdef MULTI_IFACE_SUPPORTED
+		if (multi_ndevices > 1)
+			multi_open(ndo, device, ebuf);
+#endif
+#ifdef KERNEL_COUNTS_SUPPORTED
+		/* While we still have the privileges for it. */
+		if (kernel_counts_flag) {
+			kcounts = kernel_counts_open(device, ebuf);
+			if (kcounts == NULL)
+				error("%s", ebuf);
+		}
+#endif
+
+		/*
+		 * Let user own process after capture device has
+		 * been opened.
+		 */
+#ifndef _WIN32
+		if (setgid(getgid()) != 0 || setuid(getuid()) != 0)
+			fprintf(stderr, "Warning: setgid/setuid failed !\n");
+#endif /* _WIN32 */
+#if !defined(HAVE_PCAP_CREATE) && defined(_WIN32)
+		if(Bflag != 0)
+			if(pcap_setbuff(pd, Bflag)==-1){
+				error("%s", pcap_geterr(pd));
+			}
+#endif /* !defined(HAVE_PCAP_CREATE) && defined(_WIN32) */
+		if (Lflag)
+			show_dlts_and_exit(pd, device);
+		if (yflag_dlt >= 0) {
+#ifdef HAVE_PCAP_SET_DATALINK
+			if (pcap_set_datalink(pd, yflag_dlt) < 0)
+				error("%s", pcap_geterr(pd));
+#else
+			/*
+			 * We don't actually support changing the
+			 * data link type, so we only let them
+			 * set it to what it already is.
+			 */
+			if (yflag_dlt != pcap_datalink(pd)) {
+				error("%s is not one of the DLTs supported by this device\n",
+				      yflag_dlt_name);
+			}
+#endif
+			(void)fprintf(stderr, "%s: data link type %s\n",
+				      program_name, yflag_dlt_name);
+			(void)fflush(stderr);
+		}
+		i = pcap_snapshot(pd);
+		if (ndo->ndo_snaplen < i) {
+			if (ndo->ndo_snaplen != 0)
+				warning("snaplen raised from %d to %d", ndo->ndo_snaplen, i);
+			ndo->ndo_snaplen = i;
+		} else if (ndo->ndo_snaplen > i) {
+			warning("snaplen lowered from %d to %d", ndo->ndo_snaplen, i);
+			ndo->ndo_snaplen = i;
+		}
+                if(ndo->ndo_fflag != 0) {
+                        if (pcap_lookupnet(device, &localnet, &netmask, ebuf) < 0) {
+                                warning("foreign (-f) flag used but: %s", ebuf);
+                        }
+                }
+
+	}
+	if (infile)
+		cmdbuf = read_infile(infile);
+	else
+		cmdbuf = copy_argv(&argv[optind]);
+
+#ifdef HAVE_PCAP_SET_OPTIMIZER_DEBUG
+	pcap_set_optimizer_debug(dflag);
+#endif
+	startup_phase("opening the capture");
+	if (progfile != NULL)
+		read_filter_program(progfile, &fcode);
+	else if (pcap_compile(pd, &fcode, cmdbuf, Oflag, netmask) < 0)
+		error("%s", pcap_geterr(pd));
+	startup_phase("compiling the filter");
+	if (dflag) {
+		bpf_dump(&fcode, dflag);
+		pcap_close(pd);
+		free(cmdbuf);
+		pcap_freecode(&fcode);
+		exit_tcpdump(S_SUCCESS);
+	}
+
+#ifdef HAVE_CASPER
+	/*
+	 * This can't wait for the first lookup, as the sandbox is entered
+	 * before then, and the Casper process can't be started in it.
+	 */
+	if (!ndo->ndo_nflag) {
+		capdns = capdns_setup();
+		startup_phase("starting the Casper DNS service");
+	}
+#endif	/* HAVE_CASPER */
+
+	init_print(ndo, localnet, netmask);
+	for (i = 0; i < (int)n_plugin_files; i++) {
+		if (nd_load_plugin(plugin_files[i], ebuf, sizeof(ebuf)) == -1)
+			error("--plugin: %s", ebuf);
+	}
+	startup_phase("setting up the printers");
+
+#ifndef _WIN32
+	(void)setsignal(SIGPIPE, cleanup);
+	(void)setsignal(SIGTERM, cleanup);
+#endif /* _WIN32 */
+	(void)setsignal(SIGINT, cleanup);
+#if defined(HAVE_FORK) || defined(HAVE_VFORK)
+	(void)setsignal(SIGCHLD, child_cleanup);
+#endif
+	/* Cooperate with nohup(1) */
+#ifndef _WIN32
+	if ((oldhandler = setsignal(SIGHUP, cleanup)) != SIG_DFL)
+		(void)setsignal(SIGHUP, oldhandler);
+#endif /* _WIN32 */
+#ifdef ESPSECRET_RELOAD
+	/* With -E, SIGHUP rereads the secrets rather than exiting. */
+	if (espsecret != NULL)
+		(void)setsignal(SIGHUP, reload_espsecret);
+#endif
+
+#ifndef _WIN32
+	/*
+	 * If a user name was specified with "-Z", attempt to switch to
+	 * that user's UID.  This would probably be used with sudo,
+	 * to allow tcpdump to be run in a special restricted
+	 * account (if you just want to allow users to open capture
+	 * devices, and can't just give users that permission,
+	 * you'd make tcpdump set-UID or set-GID).
+	 *
+	 * Tcpdump doesn't necessarily write only to one savefile;
+	 * the general only way to allow a -Z instance to write to
+	 * savefiles as the user under whose UID it's run, rather
+	 * than as the user specified with -Z, would thus be to switch
+	 * to the original user ID before opening a capture file and
+	 * then switch back to the -Z user ID after opening the savefile.
+	 * Switching to the -Z user ID only after opening the first
+	 * savefile doesn't handle the general case.
+	 */
+
+	if (getuid() == 0 || geteuid() == 0) {
+#ifdef HAVE_LIBCAP_NG
+		/* Initialize capng */
+		capng_clear(CAPNG_SELECT_BOTH);
+		if (username) {
+DIAG_OFF_CLANG(assign-enum)
+			capng_updatev(
+				CAPNG_ADD,
+				CAPNG_PERMITTED | CAPNG_EFFECTIVE,
+				CAP_SETUID,
+				CAP_SETGID,
+				-1);
+DIAG_ON_CLANG(assign-enum)
+		}
+		if (chroot_dir) {
+DIAG_OFF_CLANG(assign-enum)
+			capng_update(
+				CAPNG_ADD,
+				CAPNG_PERMITTED | CAPNG_EFFECTIVE,
+				CAP_SYS_CHROOT
+				);
+DIAG_ON_CLANG(assign-enum)
+		}
+
+		if (WFileName) {
+DIAG_OFF_CLANG(assign-enum)
+			capng_update(
+				CAPNG_ADD,
+				CAPNG_PERMITTED | CAPNG_EFFECTIVE,
+				CAP_DAC_OVERRIDE
+				);
+DIAG_ON_CLANG(assign-enum)
+		}
+		capng_apply(CAPNG_SELECT_BOTH);
+#endif /* HAVE_LIBCAP_NG */
+		if (username || chroot_dir) {
+			/* The tables may need files we won't be able to read. */
+			load_addrtoname_tables(ndo);
+			droproot(username, chroot_dir);
+		}
+
+	}
+#endif /* _WIN32 */
+
+	if (!range_active && !flow_sel.indexed &&
+	    pcap_setfilter(pd, &fcode) < 0)
+		error("%s", pcap_geterr(pd));
+#ifdef MULTI_IFACE_SUPPORTED
+	if (multi_ndevices > 1)
+		multi_setfilter(cmdbuf, Oflag, netmask);
+#endif
+#ifdef HAVE_CAPSICUM
+	if (RFileName == NULL && VFileName == NULL && pcap_fileno(pd) != -1) {
+		static const unsigned long cmds[] = { BIOCGSTATS, BIOCROTZBUF };
+
+		/*
+		 * The various libpcap devices use a combination of
+		 * read (bpf), ioctl (bpf, netmap), poll (netmap)
+		 * so we add the relevant access rights.
+		 */
+		cap_rights_init(&rights, CAP_IOCTL, CAP_READ, CAP_EVENT);
+		if (cap_rights_limit(pcap_fileno(pd), &rights) < 0 &&
+		    errno != ENOSYS) {
+			error("unable to limit pcap descriptor");
+		}
+		if (cap_ioctls_limit(pcap_fileno(pd), cmds,
+		    sizeof(cmds) / sizeof(cmds[0])) < 0 && errno != ENOSYS) {
+			error("unable to limit ioctls on pcap descriptor");
+		}
+	}
+#endif
+	if (WFileName) {
+		/* Do not exceed the default PATH_MAX for files. */
+		dumpinfo.CurrentFileName = (char *)malloc(PATH_MAX + 1);
+
+		if (dumpinfo.CurrentFileName == NULL)
+			error("malloc of dumpinfo.CurrentFileName");
+
+		/* We do not need numbering for dumpfiles if Cflag isn't set. */
+		if (Cflag != 0)
+		  MakeFilename(dumpinfo.CurrentFileName, WFileName, 0, WflagChars);
+		else
+		  MakeFilename(dumpinfo.CurrentFileName, WFileName, 0, 0);
+		StripeFilename(dumpinfo.CurrentFileName);
+
+		dumpinfo.msf = NULL;
+		dumpinfo.ngsf = NULL;
+		dumpinfo.gsf = NULL;
+		dumpinfo.usf = NULL;
+		dumpinfo.recycle_fd = -1;
+		dumpinfo.ssk = NULL;
+		dumpinfo.srg = NULL;
+		dumpinfo.idx = NULL;
+		dumpinfo.pd = pd;
+		WFile = NULL;
+#ifdef GZIP_SAVEFILE_SUPPORTED
+		if (gzip_level != 0) {
+			WFile = open_gzip_savefile(&dumpinfo,
+			    strcmp(dumpinfo.CurrentFileName, "-") == 0 ?
+			    dup(STDOUT_FILENO) :
+			    open(dumpinfo.CurrentFileName,
+			    O_CREAT | O_WRONLY | O_TRUNC, 0644));
+			gzip_dump_info = &dumpinfo;
+		}
+#endif
+#ifdef URING_SAVEFILE_SUPPORTED
+		if (uring_flag != 0) {
+			WFile = open_uring_savefile(&dumpinfo);
+			uring_dump_info = &dumpinfo;
+		}
+#endif
+#ifndef _WIN32
+		if (recycle_flag) {
+			WFile = open_recycled_savefile(&dumpinfo);
+			recycle_dump_info = &dumpinfo;
+		}
+#endif
+#ifdef STREAM_SINK_SUPPORTED
+		if (stream_flag) {
+			open_stream_sink(&dumpinfo);
+			stream_dump_info = &dumpinfo;
+		} else
+#endif
+#ifdef SHM_RING_SUPPORTED
+		if (shm_flag) {
+			open_shm_ring(&dumpinfo);
+			shm_dump_info = &dumpinfo;
+		} else
+#endif
+		if (pcapng_flag) {
+			pcapng_nano = nano_tstamps(ndo);
+			if (RFileName == NULL)
+				pcapng_ifname = device;
+			(void)gettimeofday(&pcapng_start, NULL);
+			open_pcapng_savefile(&dumpinfo, WFile);
+			pcapng_dump_info = &dumpinfo;
+		} else
+#ifndef _WIN32
+		if (mmap_flag) {
+			dumpinfo.msf = open_mmap_savefile(pd,
+			    open(dumpinfo.CurrentFileName,
+			    O_CREAT | O_RDWR | O_TRUNC, 0644),
+			    dumpinfo.CurrentFileName);
+			mmap_dump_info = &dumpinfo;
+		} else
+#endif
+		if (WFile != NULL)
+			pdd = pcap_dump_fopen(pd, WFile);
+		else
+			pdd = pcap_dump_open(pd, dumpinfo.CurrentFileName);
+		if (write_index)
+			open_savefile_index(&dumpinfo, 0);
+		if (flow_index) {
+			flow_index_dlt = pcap_datalink(pd);
+			open_flow_index(&dumpinfo, 0);
+		}
+#ifdef HAVE_LIBCAP_NG
+		/* Give up CAP_DAC_OVERRIDE capability.
+		 * Only allow it to be restored if the -C or -G flag have been
+		 * set since we may need to create more files later on.
+		 */
+		capng_update(
+			CAPNG_DROP,
+			(Cflag || Gflag ? 0 : CAPNG_PERMITTED)
+				| CAPNG_EFFECTIVE,
+			CAP_DAC_OVERRIDE
+			);
+		capng_apply(CAPNG_SELECT_BOTH);
+#endif /* HAVE_LIBCAP_NG */
+		if (!mmap_flag && dumpinfo.ngsf == NULL &&
+		    dumpinfo.ssk == NULL && dumpinfo.srg == NULL && pdd == NULL)
+			error("%s", pcap_geterr(pd));
+#ifdef HAVE_CAPSICUM
+		if (!mmap_flag && dumpinfo.ngsf == NULL && dumpinfo.gsf == NULL)
+			set_dumper_capsicum_rights(pdd);
+#endif
+		if (Cflag != 0 || Gflag != 0) {
+#ifdef HAVE_CAPSICUM
+			dumpinfo.WFileName = strdup(basename(WFileName));
+			if (dumpinfo.WFileName == NULL) {
+				error("Unable to allocate memory for file %s",
+				    WFileName);
+			}
+			dumpinfo.dirfd = open(dirname(WFileName),
+			    O_DIRECTORY | O_RDONLY);
+			if (dumpinfo.dirfd < 0) {
+				error("unable to open directory %s",
+				    dirname(WFileName));
+			}
+			cap_rights_init(&rights, CAP_CREATE, CAP_FCNTL,
+			    CAP_FTRUNCATE, CAP_LOOKUP, CAP_SEEK, CAP_WRITE);
+			if (mmap_flag)
+				cap_rights_set(&rights, CAP_MMAP_RW);
+			if (cap_rights_limit(dumpinfo.dirfd, &rights) < 0 &&
+			    errno != ENOSYS) {
+				error("unable to limit directory rights");
+			}
+			if (cap_fcntls_limit(dumpinfo.dirfd, CAP_FCNTL_GETFL) < 0 &&
+			    errno != ENOSYS) {
+				error("unable to limit dump descriptor fcntls");
+			}
+#else	/* !HAVE_CAPSICUM */
+			dumpinfo.WFileName = WFileName;
+#endif
+			callback = dump_packet_and_trunc;
+			dumpinfo.pd = pd;
+			dumpinfo.pdd = pdd;
+			pcap_userdata = (u_char *)&dumpinfo;
+		} else {
+			callback = dump_packet;
+			dumpinfo.WFileName = WFileName;
+			dumpinfo.pd = pd;
+			dumpinfo.pdd = pdd;
+			pcap_userdata = (u_char *)&dumpinfo;
+		}
+		if (print) {
+			dlt = pcap_datalink(pd);
+			ndo->ndo_if_printer = get_if_printer(ndo, dlt);
+			dumpinfo.ndo = ndo;
+		} else
+			dumpinfo.ndo = NULL;
+		if (flow_trunc_packets != 0) {
+			flow_trunc.table = (struct flow_trunc_entry *)calloc(
+			    FLOW_TRUNC_SLOTS, sizeof(*flow_trunc.table));
+			if (flow_trunc.table == NULL)
+				error("--flow-truncate: out of memory");
+			flow_trunc.dlt = pcap_datalink(pd);
+		}
+		if (anon_keyfile != NULL) {
+			if ((anon = anon_new(anon_keyfile, ebuf)) == NULL)
+				error("%s", ebuf);
+			anon_buf = (u_char *)malloc(MAXIMUM_SNAPLEN);
+			if (anon_buf == NULL)
+				error("--anonymize: out of memory");
+			anon_dlt = pcap_datalink(pd);
+		}
+		if (split_by != 0) {
+			split_dlt = pcap_datalink(pd);
+			split = split_savefile_open(pd, WFileName,
+			    split_by == SPLIT_BY_VNI ? "vni" : "vlan",
+			    split_open_files, ebuf);
+			if (split == NULL)
+				error("--split-by: %s", ebuf);
+		}
+
+#ifdef HAVE_PCAP_DUMP_FLUSH
+		if (Uflag && pdd != NULL)
+			pcap_dump_flush(pdd);
+#endif
+	} else {
+		dlt = pcap_datalink(pd);
+		ndo->ndo_if_printer = get_if_printer(ndo, dlt);
+		callback = print_packet;
+		pcap_userdata = (u_char *)ndo;
+	}
+
+#ifdef SIGNAL_REQ_INFO
+	/*
+	 * We can't get statistics when reading from a file rather
+	 * than capturing from a device.
+	 */
+	if (RFileName == NULL)
+		(void)setsignal(SIGNAL_REQ_INFO, requestinfo);
+#endif
+#ifdef METRICS_SUPPORTED
+	if (metrics != NULL) {
+		metrics_live = RFileName == NULL && VFileName == NULL;
+		start_thread(&metrics_tid, metrics_main, NULL, "metrics");
+	}
+#endif
+#ifdef CONTROL_SOCKET_SUPPORTED
+	if (control_path != NULL) {
+		control_ndo = ndo;
+		control_Oflag = Oflag;
+		control_netmask = netmask;
+		control_writing = WFileName != NULL;
+		control = control_socket_open(control_path, ebuf);
+		if (control == NULL)
+			error("--control-socket: %s", ebuf);
+	}
+#endif
+	if (degrade)
+		degrade_init(ndo);
+	if (flight_size != 0) {
+		/*
+		 * Hand the packets to flight_packet(), which keeps them
+		 * until there's a trigger.
+		 */
+		flight.callback = callback;
+		flight.user = pcap_userdata;
+		flight.size = flight_size;
+		flight.ring = (u_char *)nd_big_calloc(1, flight_size);
+		if (flight.ring == NULL)
+			error("unable to allocate %zu bytes for the flight recorder",
+			    flight_size);
+		if (flight_trigger != NULL &&
+		    pcap_compile(pd, &flight.fcode, flight_trigger, Oflag,
+		    netmask) < 0)
+			error("%s", pcap_geterr(pd));
+		if (flight_start != NULL &&
+		    (pcap_compile(pd, &flight.start_fcode, flight_start, Oflag,
+		    netmask) < 0 ||
+		    pcap_compile(pd, &flight.stop_fcode, flight_stop, Oflag,
+		    netmask) < 0))
+			error("%s", pcap_geterr(pd));
+		callback = flight_packet;
+		pcap_userdata = (u_char *)&flight;
+	}
+	if (sample_rate > 1) {
+		/*
+		 * Hand the packets to sample_packet(), which only hands
+		 * on the ones sampled.
+		 */
+		sample.callback = callback;
+		sample.user = pcap_userdata;
+		sample.dlt = pcap_datalink(pd);
+		sample.frag_whole = ndo->ndo_ip_reasm_budget != 0;
+		callback = sample_packet;
+		pcap_userdata = (u_char *)&sample;
+	}
+	if (hosts_file != NULL) {
+		/*
+		 * Hand the packets to hosts_packet(), which only hands
+		 * on the ones to or from the hosts in the file.
+		 */
+		if ((hosts.set = host_set_load(hosts_file, ebuf)) == NULL)
+			error("%s", ebuf);
+		hosts.callback = callback;
+		hosts.user = pcap_userdata;
+		hosts.dlt = pcap_datalink(pd);
+		callback = hosts_packet;
+		pcap_userdata = (u_char *)&hosts;
+	}
+	if (payload_file != NULL) {
+		/*
+		 * Hand the packets to payload_packet(), which only hands
+		 * on the ones whose payload holds one of the patterns.
+		 */
+		if ((payload.matcher = payload_match_load(payload_file,
+		    ebuf)) == NULL)
+			error("--payload-match: %s", ebuf);
+		payload.callback = callback;
+		payload.user = pcap_userdata;
+		payload.dlt = pcap_datalink(pd);
+		callback = payload_packet;
+		pcap_userdata = (u_char *)&payload;
+	}
+	if (dedup_window != 0) {
+		/*
+		 * Hand the packets to dedup_packet(), which only hands
+		 * on the ones that aren't copies of a recent one.
+		 */
+		if ((dedup.table = dedup_new(dedup_window)) == NULL)
+			error("--dedup: out of memory");
+		dedup.callback = callback;
+		dedup.user = pcap_userdata;
+		dedup.dlt = pcap_datalink(pd);
+		dedup.nano = nano_tstamps(ndo);
+		callback = dedup_packet;
+		pcap_userdata = (u_char *)&dedup;
+	}
+	if (beacon_stats) {
+		/*
+		 * Hand the packets to beacon_packet(), which only hands
+		 * on the ones that aren't repeated beacons.
+		 */
+		dlt = pcap_datalink(pd);
+		if (dlt != DLT_IEEE802_11 && dlt != DLT_IEEE802_11_RADIO)
+			error("--beacon-stats can only be used with 802.11 link-layer types");
+		beacon.callback = callback;
+		beacon.user = pcap_userdata;
+		beacon.ndo = ndo;
+		beacon.radiotap = dlt == DLT_IEEE802_11_RADIO;
+		callback = beacon_packet;
+		pcap_userdata = (u_char *)&beacon;
+	}
+	if (neighbors) {
+		/*
+		 * Hand the packets to neighbor_packet(), which only hands
+		 * on the ones that aren't repeated advertisements.
+		 */
+		if (pcap_datalink(pd) != DLT_EN10MB)
+			error("--neighbors can only be used with Ethernet");
+		neighbor.callback = callback;
+		neighbor.user = pcap_userdata;
+		neighbor.ndo = ndo;
+		callback = neighbor_packet;
+		pcap_userdata = (u_char *)&neighbor;
+	}
+	if (wpan_stats) {
+		/*
+		 * Hand the packets to wpan_packet(), which counts them
+		 * and hands them all on.
+		 */
+		dlt = pcap_datalink(pd);
+		if (!wpan_dlt(dlt))
+			error("--wpan-stats can only be used with 802.15.4 link-layer types");
+		wpan.callback = callback;
+		wpan.user = pcap_userdata;
+		wpan.ndo = ndo;
+		wpan.tap = wpan_dlt(dlt) == 2;
+		callback = wpan_packet;
+		pcap_userdata = (u_char *)&wpan;
+	}
+	if (decap_filter != NULL || decap_write_inner) {
+		/*
+		 * Hand the packets to decap_packet(), which only hands on
+		 * the ones whose innermost packet matches --inner-filter.
+		 */
+		decap.callback = callback;
+		decap.user = pcap_userdata;
+		decap_open(pd, Oflag, netmask);
+		callback = decap_packet;
+		pcap_userdata = (u_char *)&decap;
+	}
+	if (flow_sel.set) {
+		/*
+		 * Hand the packets to flow_sel_packet(), which only hands
+		 * on the ones of the flow, and does -c.
+		 */
+		flow_sel.callback = callback;
+		flow_sel.user = pcap_userdata;
+		flow_sel.dlt = pcap_datalink(pd);
+		flow_sel.cnt = cnt;
+		callback = flow_sel_packet;
+		pcap_userdata = (u_char *)&flow_sel;
+		cnt = -1;
+	}
+	if (range_active) {
+		/*
+		 * Hand the packets to range_packet(), which counts them,
+		 * picks out those in the range and does -c.
+		 */
+		range.callback = callback;
+		range.user = pcap_userdata;
+		range.fcode = &fcode;
+		range.cnt = cnt;
+		range.nano = nano_tstamps(ndo);
+		callback = range_packet;
+		pcap_userdata = (u_char *)&range;
+		cnt = -1;
+		range_seek(pd, RFileName);
+	}
+#ifdef SIGUSR2
+	/* With --flight-recorder, SIGUSR2 is a trigger. */
+	if (flight_size != 0)
+		(void)setsignal(SIGUSR2, flight_signal);
+	else
+#endif
+#ifdef SIGNAL_FLUSH_PCAP
+	(void)setsignal(SIGNAL_FLUSH_PCAP, flushpcap);
+#else
+	;
+#endif
+
+	if (ndo->ndo_vflag > 0 && WFileName && !print) {
+		/*
+		 * When capturing to a file, if "--print" wasn't specified,
+		 *"-v" means tcpdump should, once per second,
+		 * "v"erbosely report the number of packets captured.
+		 */
+#ifdef _WIN32
+		/*
+		 * https://blogs.msdn.microsoft.com/oldnewthing/20151230-00/?p=92741
+		 *
+		 * suggests that this dates back to W2K.
+		 *
+		 * I don't know what a "long wait" is, but we'll assume
+		 * that printing the stats could be a "long wait".
+		 */
+		CreateTimerQueueTimer(&timer_handle, NULL,
+		    verbose_stats_dump, NULL, 1000, 1000,
+		    WT_EXECUTEDEFAULT|WT_EXECUTELONGFUNCTION);
+		setvbuf(stderr, NULL, _IONBF, 0);
+#else /* _WIN32 */
+		/*
+		 * Assume this is UN*X, and that it has setitimer(); that
+		 * dates back to UNIX 95.
+		 */
+		struct itimerval timer;
+		(void)setsignal(SIGALRM, verbose_stats_dump);
+		timer.it_interval.tv_sec = 1;
+		timer.it_interval.tv_usec = 0;
+		timer.it_value.tv_sec = 1;
+		timer.it_value.tv_usec = 1;
+		setitimer(ITIMER_REAL, &timer, NULL);
+#endif /* _WIN32 */
+	}
+
+	if (RFileName == NULL) {
+		/*
+		 * Live capture (if -V was specified, we set RFileName
+		 * to a file from the -V file).  Print a message to
+		 * the standard error on UN*X.
+		 */
+		if (!ndo->ndo_vflag && !WFileName) {
+			(void)fprintf(stderr,
+			    "%s: verbose output suppressed, use -v or -vv for full protocol decode\n",
+			    program_name);
+		} else
+			(void)fprintf(stderr, "%s: ", program_name);
+		dlt = pcap_datalink(pd);
+		dlt_name = pcap_datalink_val_to_name(dlt);
+		(void)fprintf(stderr, "listening on %s", device);
+		if (dlt_name == NULL) {
+			(void)fprintf(stderr, ", link-type %u", dlt);
+		} else {
+			(void)fprintf(stderr, ", link-type %s (%s)", dlt_name,
+				      pcap_datalink_val_to_description(dlt));
+		}
+		(void)fprintf(stderr, ", snapshot length %d bytes\n", ndo->ndo_snaplen);
+		(void)fflush(stderr);
+	}
+
+#ifdef HAVE_CAPSICUM
+	cansandbox = (VFileName == NULL && zflag == NULL);
+#ifdef HAVE_CASPER
+	cansandbox = (cansandbox && (ndo->ndo_nflag || capdns != NULL));
+#else
+	cansandbox = (cansandbox && ndo->ndo_nflag);
+#endif /* HAVE_CASPER */
+	if (cansandbox)
+		load_addrtoname_tables(ndo);
+	if (cansandbox && cap_enter() < 0 && errno != ENOSYS)
+		error("unable to enter the capability mode");
+#endif	/* HAVE_CAPSICUM */
+
+#ifdef SAVEFILE_CLOCK_SUPPORTED
+	/* Start the clock first, so the writer can be woken by it. */
+	if (WFileName != NULL && (Gflag != 0 || flush_interval != 0)) {
+		savefile_clock = savefile_clock_create(Gflag_time, Gflag,
+		    flush_interval, writer_thread ? writer_wake : NULL, NULL,
+		    ebuf);
+		if (savefile_clock == NULL)
+			error("%s", ebuf);
+		start_thread(&clock_tid, savefile_clock_main, savefile_clock,
+		    "savefile clock");
+	}
+#endif
+#ifdef HAVE_PTHREADS
+	if (writer_thread)
+		writer_start(&dumpinfo);
+#endif
+	if (field_output && (WFileName == NULL || print) && !count_mode) {
+		if (nd_field_output_init(ndo) == -1)
+			error("unable to write the field record header");
+	}
+	if (json_output && (WFileName == NULL || print) && !count_mode)
+		nd_json_output_init(ndo);
+	if (stats_only && (WFileName == NULL || print) && !count_mode) {
+		nd_stats_output_init(ndo);
+		stats_ndo = ndo;
+	}
+	if (flows_format != -1 && (WFileName == NULL || print) && !count_mode) {
+		nd_flows_output_init(ndo, flows_format, flows_size,
+		    flows_active, flows_idle, flows_collect);
+		flows_ndo = ndo;
+	}
+	if (topn_count != 0 && (WFileName == NULL || print) && !count_mode) {
+		nd_topn_output_init(ndo, topn_count, topn_interval,
+		    isatty(1));
+		topn_ndo = ndo;
+#ifdef KERNEL_COUNTS_SUPPORTED
+		if (kernel_counts_flag)
+			nd_topn_set_extra(ndo, "kernel", topn_kernel_counts,
+			    NULL);
+#endif
+	}
+	if (rates_format != -1 && (WFileName == NULL || print) &&
+	    !count_mode) {
+		nd_rates_output_init(ndo, rates_format, rates_interval);
+		rates_ndo = ndo;
+	}
+	if (ptp_stats && (WFileName == NULL || print) && !count_mode) {
+		nd_ptp_output_init(ndo);
+		ptp_ndo = ndo;
+	}
+	if (display_filter != NULL && (WFileName == NULL || print) &&
+	    !count_mode) {
+		struct nd_dfilter *df;
+
+		df = nd_dfilter_compile(display_filter, ebuf, sizeof(ebuf));
+		if (df == NULL)
+			error("--display-filter: %s", ebuf);
+		nd_dfilter_output_init(ndo, df);
+	}
+	if (memo_entries != 0 && (WFileName == NULL || print) && !count_mode) {
+		ndo->ndo_memo = nd_memo_new(memo_entries, memo_mode,
+		    memo_ignore, memo_nignore);
+		if (ndo->ndo_memo == NULL)
+			error("--memo: out of memory");
+		memo_ndo = ndo;
+	}
+	if (ndo->ndo_latency && (WFileName == NULL || print) && !count_mode)
+		latency_ndo = ndo;
+	if (ndo->ndo_bgp_summary && (WFileName == NULL || print) && !count_mode)
+		bgp_summary_ndo = ndo;
+	if (ndo->ndo_bgp_peers && (WFileName == NULL || print) && !count_mode)
+		bgp_peers_ndo = ndo;
+	if (ndo->ndo_openflow_summary && (WFileName == NULL || print) &&
+	    !count_mode)
+		openflow_ndo = ndo;
+	if (ndo->ndo_lsdb && (WFileName == NULL || print) && !count_mode)
+		lsdb_ndo = ndo;
+	if (ndo->ndo_ppp_sessions && (WFileName == NULL || print) &&
+	    !count_mode)
+		ppp_ndo = ndo;
+	if (ndo->ndo_mcast_groups && (WFileName == NULL || print) &&
+	    !count_mode)
+		mcast_ndo = ndo;
+	if (ndo->ndo_label_bindings && (WFileName == NULL || print) &&
+	    !count_mode)
+		label_ndo = ndo;
+	if (ndo->ndo_tcp_analysis && (WFileName == NULL || print) &&
+	    !count_mode)
+		tcp_analysis_ndo = ndo;
+	if (ndo->ndo_mptcp_connections && (WFileName == NULL || print) &&
+	    !count_mode)
+		mptcp_ndo = ndo;
+	if (ndo->ndo_rtp_analysis && (WFileName == NULL || print) &&
+	    !count_mode)
+		rtp_ndo = ndo;
+	if (ndo->ndo_bfd_sessions && (WFileName == NULL || print) &&
+	    !count_mode)
+		bfd_ndo = ndo;
+	if (ndo->ndo_someip_summary && (WFileName == NULL || print) &&
+	    !count_mode)
+		someip_ndo = ndo;
+	if (ndo->ndo_v2x_stations && (WFileName == NULL || print) &&
+	    !count_mode)
+		v2x_ndo = ndo;
+	if (tap_file_name != NULL && (WFileName == NULL || print) &&
+	    !count_mode) {
+		ndo->ndo_tap_file = fopen(tap_file_name, "wb");
+		if (ndo->ndo_tap_file == NULL)
+			error("unable to open file %s: %s", tap_file_name,
+			    pcap_strerror(errno));
+		tap_ndo = ndo;
+	}
+#ifdef ENABLE_DISSECTOR_PROFILE
+	if (profile_dissectors && (WFileName == NULL || print) && !count_mode) {
+		nd_profile_init(ndo);
+		profile_ndo = ndo;
+	}
+	if (snaplen_report && (WFileName == NULL || print) && !count_mode) {
+		nd_snaplen_init(ndo);
+		snaplen_ndo = ndo;
+	}
+#endif
+	startup_phase("opening savefiles, dropping privileges and the rest");
+#ifdef OUTPUT_BUFFER_SUPPORTED
+	if (output_buffer_size != 0)
+		output_thread_start(ndo);
+#endif
+#ifdef SHM_RING_SUPPORTED
+	if (shm_output_name != NULL)
+		shm_output_start(ndo);
+#endif
+#ifdef DISSECT_THREADS_SUPPORTED
+	if (dissect_threads && (WFileName == NULL || print) && !count_mode)
+		pipeline_start(ndo, dlt);
+#endif
+#ifdef PRINT_THREAD_SUPPORTED
+	if (print_ring_size != 0 && (WFileName == NULL || print) && !count_mode) {
+		print_lossy = WFileName != NULL && RFileName == NULL;
+		print_thread_start(ndo);
+	}
+#endif
+	startup_phase("starting threads");
+#ifndef _WIN32
+	/*
+	 * With the savefile mapped, the packet after the one being printed
+	 * is in hand, so what printing it will need can be prefetched, if
+	 * it's printed on this thread.
+	 */
+	mmap_prefetch = mmap_read && (WFileName == NULL || print) &&
+	    !count_mode;
+#ifdef DISSECT_THREADS_SUPPORTED
+	if (pl_workers != NULL)
+		mmap_prefetch = 0;
+#endif
+#ifdef PRINT_THREAD_SUPPORTED
+	if (print_ring != NULL)
+		mmap_prefetch = 0;
+#endif
+#endif
+
+#ifdef FILE_THREADS_SUPPORTED
+	if (file_threads)
+		status = file_run(ndo, VFile, cmdbuf, Oflag, netmask);
+	else
+#endif
+	do {
+#ifdef CHUNK_THREADS_SUPPORTED
+		if (chunk_threads)
+			status = chunk_run(ndo, RFileName, &fcode, callback,
+			    pcap_userdata, ebuf);
+		else
+#endif
+#ifndef _WIN32
+		if (flow_sel.indexed)
+			status = flow_sel_loop(pd, RFileName, &fcode,
+			    callback, pcap_userdata);
+		else
+		if (mmap_reader != NULL) {
+			if (mmap_prefetch)
+				mmap_reader_set_prefetch(mmap_reader,
+				    prefetch_next, (u_char *)ndo);
+			status = mmap_reader_loop(mmap_reader, cnt,
+			    range_active ? NULL : &fcode,
+			    callback, pcap_userdata, ebuf);
+		} else
+#endif
+#ifdef MULTI_IFACE_SUPPORTED
+		if (multi_ndevices > 1)
+			status = multi_run(ndo, cnt, callback, pcap_userdata,
+			    WFileName == NULL || print, ebuf);
+		else
+#endif
+		if (batch_size != 0 || degrade
+#ifdef CONTROL_SOCKET_SUPPORTED
+		    || control != NULL
+#endif
+#ifdef SAVEFILE_CLOCK_SUPPORTED
+		    || savefile_clock != NULL
+#endif
+		    )
+			status = capture_batches(pd, cnt, callback,
+			    pcap_userdata, WFileName != NULL ? &dumpinfo : NULL);
+		else
+			status = pcap_loop(pd, cnt, callback, pcap_userdata);
+		if (status == -2 && (range.done || flow_sel.done)) {
+			/*
+			 * That was range_packet() stopping at the end, or
+			 * flow_sel_packet() at the -c'th packet.
+			 */
+			status = 0;
+		}
+#ifdef HAVE_PTHREADS
+		/*
+		 * Get everything written out before reporting the
+		 * statistics, and before closing the pcap_t that the
+		 * writer uses to open new savefiles.
+		 */
+		if (writer_thread)
+			writer_drain();
+#endif
+#ifdef DISSECT_THREADS_SUPPORTED
+		if (pl_workers != NULL)
+			pipeline_drain();
+#endif
+#ifdef PRINT_THREAD_SUPPORTED
+		if (print_ring != NULL)
+			packet_ring_drain(print_ring);
+#endif
+#ifdef OUTPUT_BUFFER_SUPPORTED
+		/*
+		 * Get the printed output written out before anything
+		 * else is written to the standard output.
+		 */
+		if (output_buffer != NULL &&
+		    output_buffer_flush(output_buffer) == -1)
+			error("Unable to write output: %s",
+			    pcap_strerror(errno));
+#endif
+		if (WFileName == NULL) {
+			/*
+			 * We're printing packets.  Flush the printed output,
+			 * so it doesn't get intermingled with error output.
+			 */
+			if (status == -2) {
+				/*
+				 * We got interrupted, so perhaps we didn't
+				 * manage to finish a line we were printing.
+				 * Print an extra newline, just in case.
+				 */
+				putchar('\n');
+			}
+			(void)fflush(stdout);
+		}
+                if (status == -2) {
+			/*
+			 * We got interrupted. If we are reading multiple
+			 * files (via -V) set these so that we stop.
+			 */
+			VFileName = NULL;
+			ret = NULL;
+		}
+		if (status == -1) {
+			/*
+			 * Error.  Report it.
+			 */
+#ifndef _WIN32
+			if (mmap_reader != NULL)
+				(void)fprintf(stderr, "%s: pcap_loop: %s\n",
+				    program_name, ebuf);
+			else
+#endif
+#ifdef MULTI_IFACE_SUPPORTED
+			if (multi_ndevices > 1)
+				(void)fprintf(stderr, "%s: pcap_loop: %s\n",
+				    program_name, ebuf);
+			else
+#endif
+			(void)fprintf(stderr, "%s: pcap_loop: %s\n",
+			    program_name, pcap_geterr(pd));
+		}
+		if (RFileName == NULL) {
+			/*
+			 * We're doing a live capture.  Report the capture
+			 * statistics.
+			 */
+			info(1);
+		}
+#ifndef _WIN32
+		if (mmap_reader != NULL) {
+			mmap_reader_close(mmap_reader);
+			mmap_reader = NULL;
+		}
+#endif
+#ifdef FOLLOW_READER_SUPPORTED
+		/* pcap_close() frees the reader. */
+		if (follow_reader != NULL) {
+			follow_files = follow_reader_files(follow_reader);
+			follow_reader = NULL;
+		}
+#endif
+		pcap_close(pd);
+		if (VFileName != NULL) {
+			ret = get_next_file(VFile, VFileLine);
+			if (ret) {
+				int new_dlt;
+
+				RFileName = VFileLine;
+				pd = open_savefile(ndo, RFileName, &zfd, ebuf);
+				if (pd == NULL)
+					error("%s", ebuf);
+#ifdef CHUNK_THREADS_SUPPORTED
+				if (chunk_threads && zfd != -1)
+					error("--chunk-threads can not be used with a compressed savefile");
+#endif
+#ifdef HAVE_CAPSICUM
+				cap_rights_init(&rights, CAP_READ);
+				if (cap_rights_limit(zfd != -1 ? zfd :
+				    fileno(pcap_file(pd)), &rights) < 0 &&
+				    errno != ENOSYS) {
+					error("unable to limit pcap descriptor");
+				}
+#endif
+#ifndef _WIN32
+				if (mmap_read && zfd == -1 && (mmap_reader =
+				    mmap_reader_open(pd, RFileName, ebuf)) == NULL)
+					error("%s", ebuf);
+#endif
+				new_dlt = pcap_datalink(pd);
+				if (new_dlt != dlt) {
+					/*
+					 * The new file has a different
+					 * link-layer header type from the
+					 * previous one.
+					 */
+					if (WFileName != NULL) {
+						/*
+						 * We're writing raw packets
+						 * that match the filter to
+						 * a pcap file.  pcap files
+						 * don't support multiple
+						 * different link-layer
+						 * header types, so we fail
+						 * here.
+						 */
+						error("%s: new dlt does not match original", RFileName);
+					}
+
+					/*
+					 * We're printing the decoded packets;
+					 * switch to the new DLT.
+					 *
+					 * To do that, we need to change
+					 * the printer, change the DLT name,
+					 * and recompile the filter with
+					 * the new DLT.
+					 */
+					dlt = new_dlt;
+					ndo->ndo_if_printer = get_if_printer(ndo, dlt);
+					dedup.dlt = dlt;
+					payload.dlt = dlt;
+					if (beacon_stats) {
+						if (dlt != DLT_IEEE802_11 &&
+						    dlt != DLT_IEEE802_11_RADIO)
+							error("--beacon-stats can only be used with 802.11 link-layer types");
+						beacon.radiotap =
+						    dlt == DLT_IEEE802_11_RADIO;
+					}
+					if (neighbors && dlt != DLT_EN10MB)
+						error("--neighbors can only be used with Ethernet");
+					if (wpan_stats) {
+						if (!wpan_dlt(dlt))
+							error("--wpan-stats can only be used with 802.15.4 link-layer types");
+						wpan.tap = wpan_dlt(dlt) == 2;
+					}
+#ifdef DISSECT_THREADS_SUPPORTED
+					/*
+					 * The pipeline has been drained,
+					 * so the workers are all idle.
+					 */
+					pl_dlt = dlt;
+					for (i = 0; pl_workers != NULL &&
+					    i < dissect_threads; i++) {
+						pl_workers[i].ndo.ndo_if_printer =
+						    ndo->ndo_if_printer;
+						pl_workers[i].ndo.ndo_void_printer =
+						    ndo->ndo_void_printer;
+						pl_workers[i].ndo.ndo_if_printer_name =
+						    ndo->ndo_if_printer_name;
+					}
+#endif
+					if (progfile != NULL)
+						error("%s: --filter-program can not be used when the link-layer type changes", RFileName);
+					if (pcap_compile(pd, &fcode, cmdbuf, Oflag, netmask) < 0)
+						error("%s", pcap_geterr(pd));
+				}
+
+				/*
+				 * Set the filter on the new file.
+				 */
+				if (pcap_setfilter(pd, &fcode) < 0)
+					error("%s", pcap_geterr(pd));
+
+				/*
+				 * Report the new file.
+				 */
+				dlt_name = pcap_datalink_val_to_name(dlt);
+				fprintf(stderr, "reading from file %s", RFileName);
+				if (dlt_name == NULL) {
+					fprintf(stderr, ", link-type %u", dlt);
+				} else {
+					fprintf(stderr, ", link-type %s (%s)",
+						dlt_name,
+						pcap_datalink_val_to_description(dlt));
+				}
+				fprintf(stderr, ", snapshot length %d\n", pcap_snapshot(pd));
+			}
+		}
+	}
+	while (ret != NULL);
+
+	flows_finish();
+	if (topn_ndo != NULL)
+		nd_topn_report(topn_ndo);
+	if (rates_ndo != NULL)
+		nd_rates_report(rates_ndo);
+	if (ptp_ndo != NULL)
+		ptp_stats_report(ptp_ndo, 0);
+	if (count_mode && RFileName != NULL)
+		fprintf(stderr, "%u packet%s\n", packets_captured,
+			PLURAL_SUFFIX(packets_captured));
+	if (RFileName != NULL) {
+		print_decap_stats();
+		print_sample_stats();
+		print_hosts_stats();
+		print_payload_stats();
+		print_dedup_stats();
+		print_memo_stats();
+		print_flow_trunc_stats();
+		print_anon_stats();
+		print_split_stats();
+		print_follow_stats();
+		print_beacon_stats();
+		print_neighbors();
+		print_wpan_stats();
+		print_proto_stats();
+		print_mem_stats();
+#ifdef DISSECT_THREADS_SUPPORTED
+		print_pipeline_stats();
+#endif
+		print_ring_stats();
+		print_stream_stats();
+		print_output_stats();
+		print_latency_report(0);
+		print_bgp_summary();
+		print_openflow_summary();
+		print_resp_commands();
+		print_ppp_sessions();
+		print_mcast_groups();
+		print_label_bindings();
+		print_tcp_analysis();
+		print_mptcp_connections();
+		print_rtp_report(0);
+		print_bfd_sessions();
+		print_someip_summary();
+		print_v2x_report(0);
+		print_lsdb_report();
+#ifdef ENABLE_DISSECTOR_PROFILE
+		print_dissector_profile();
+		print_snaplen_report();
+#endif
+	}
+
+	free(cmdbuf);
+	pcap_freecode(&fcode);
+	exit_tcpdump(status == -1 ? 1 : 0);
+}
+
+/*
+ * Catch a signal.
+ */
+static void
+(*setsignal (int sig, void (*func)(int)))(int)
+{
+#ifdef _WIN32
+	return (signal(sig, func));
+#else
+	struct sigaction old, new;
+
+	memset(&new, 0, sizeof(new));
+	new.sa_handler = func;
+	if (sig == SIGCHLD || sig == SIGHUP)
+		new.sa_flags = SA_RESTART;
+	if (sigaction(sig, &new, &old) < 0)
+		return (SIG_ERR);
+	return (old.sa_handler);
+#endif
+}
+
+/* make a clean exit on interrupts */
+static void
+cleanup(int signo _U_)
+{
+#ifdef _WIN32
+	if (timer_handle != INVALID_HANDLE_VALUE) {
+		DeleteTimerQueueTimer(NULL, timer_handle, NULL);
+		CloseHandle(timer_handle);
+		timer_handle = INVALID_HANDLE_VALUE;
+        }
+#else /* _WIN32 */
+	struct itimerval timer;
+
+	timer.it_interval.tv_sec = 0;
+	timer.it_interval.tv_usec = 0;
+	timer.it_value.tv_sec = 0;
+	timer.it_value.tv_usec = 0;
+	setitimer(ITIMER_REAL, &timer, NULL);
+#endif /* _WIN32 */
+
+#ifndef _WIN32
+	if (mmap_reader != NULL)
+		mmap_reader_breakloop(mmap_reader);
+#endif
+#ifdef FOLLOW_READER_SUPPORTED
+	/* Don't leave a read waiting for more. */
+	if (follow_reader != NULL)
+		follow_reader_stop(follow_reader);
+#endif
+#ifdef CHUNK_THREADS_SUPPORTED
+	if (chunk_workers != NULL) {
+		int i;
+
+		for (i = 0; i < chunk_threads; i++)
+			if (chunk_workers[i].mr != NULL)
+				mmap_reader_breakloop(chunk_workers[i].mr);
+	}
+#endif
+#ifdef MULTI_IFACE_SUPPORTED
+	if (multi_ifaces != NULL) {
+		int i;
+
+		for (i = 0; i < multi_ndevices; i++)
+			if (multi_ifaces[i].pd != NULL)
+				pcap_breakloop(multi_ifaces[i].pd);
+	}
+#endif
+#if defined(FILE_THREADS_SUPPORTED) && defined(HAVE_PCAP_BREAKLOOP)
+	if (file_jobs != NULL) {
+		int i;
+
+		for (i = 0; i < file_threads; i++)
+			if (file_jobs[i].pd != NULL)
+				pcap_breakloop(file_jobs[i].pd);
+	}
+#endif
+#ifdef HAVE_PCAP_BREAKLOOP
+	/*
+	 * We have "pcap_breakloop()"; use it, so that we do as little
+	 * as possible in the signal handler (it's probably not safe
+	 * to do anything with standard I/O streams in a signal handler -
+	 * the ANSI C standard doesn't say it is).
+	 */
+	pcap_breakloop(pd);
+#else
+	/*
+	 * We don't have "pcap_breakloop()"; this isn't safe, but
+	 * it's the best we can do.  Print the summary if we're
+	 * not reading from a savefile - i.e., if we're doing a
+	 * live capture - and exit.
+	 */
+	if (pd != NULL && pcap_file(pd) == NULL) {
+		/*
+		 * We got interrupted, so perhaps we didn't
+		 * manage to finish a line we were printing.
+		 * Print an extra newline, just in case.
+		 */
+		putchar('\n');
+		(void)fflush(stdout);
+		info(1);
+	}
+	exit_tcpdump(S_SUCCESS);
+#endif
+}
+
+/*
+  On windows, we do not use a fork, so we do not care less about
+  waiting a child processes to die
+ */
+#if defined(HAVE_FORK) || defined(HAVE_VFORK)
+static void
+child_cleanup(int signo _U_)
+{
+  wait(NULL);
+}
+#endif /* HAVE_FORK && HAVE_VFORK */
+
+static void
+print_proto_stat(void *arg _U_, const char *name, uint64_t packets,
+    uint64_t bytes)
+{
+	if (name == NULL)
+		(void)fprintf(stderr, "%-16s %12s %14s\n%-16s",
+		    "protocol", "packets", "bytes", "all");
+	else
+		(void)fprintf(stderr, "%-16s", name);
+	(void)fprintf(stderr, " %12" PRIu64 " %14" PRIu64 "\n", packets,
+	    bytes);
+}
+
+#ifdef KERNEL_COUNTS_SUPPORTED
+static void
+print_kernel_stat(void *arg _U_, const char *name, uint64_t packets,
+    uint64_t bytes)
+{
+	if (name == NULL)
+		(void)fprintf(stderr, "%-16s %12s %14s\n%-16s",
+		    "kernel", "packets", "bytes", "all");
+	else
+		(void)fprintf(stderr, "%-16s", name);
+	(void)fprintf(stderr, " %12" PRIu64 " %14" PRIu64 "\n", packets,
+	    bytes);
+}
+
+static void
+topn_kernel_row(void *arg, const char *name, uint64_t packets,
+    uint64_t bytes)
+{
+	nd_topn_row((netdissect_options *)arg, name, packets, bytes);
+}
+
+/*
+ * The --top report's table of what the kernel counted in the interval.
+ */
+static void
+topn_kernel_counts(netdissect_options *ndo, void *arg _U_)
+{
+	kernel_counts_foreach(kcounts, 1, topn_kernel_row, ndo);
+}
+#endif
+
+static void
+print_vni_stat(void *arg, const char *proto, uint32_t vni, uint64_t packets,
+    uint64_t bytes)
+{
+	char name[32];
+
+	if (*(int *)arg == 0) {
+		(void)fprintf(stderr, "%-16s %12s %14s\n", "vni", "packets",
+		    "bytes");
+		*(int *)arg = 1;
+	}
+	(void)snprintf(name, sizeof(name), "%s %u", proto, vni);
+	(void)fprintf(stderr, "%-16s %12" PRIu64 " %14" PRIu64 "\n", name,
+	    packets, bytes);
+}
+
+static void
+print_meta_stat(void *arg, const char *what, uint32_t value,
+    uint64_t packets, uint64_t bytes)
+{
+	char name[40];
+
+	if (*(int *)arg == 0) {
+		(void)fprintf(stderr, "%-16s %12s %14s\n", "metadata",
+		    "packets", "bytes");
+		*(int *)arg = 1;
+	}
+	(void)snprintf(name, sizeof(name), "%s %u", what, value);
+	(void)fprintf(stderr, "%-16s %12" PRIu64 " %14" PRIu64 "\n", name,
+	    packets, bytes);
+}
+
+static void
+print_nfs_latency(void *arg _U_, const struct latency_hist *lh)
+{
+	if (strcmp(lh->lh_proto, "nfs") != 0)
+		return;
+	(void)fprintf(stderr,
+	    "nfs %s %" PRIu64 " replies, %.3f/%.3f/%.3f ms min/avg/max\n",
+	    lh->lh_what, lh->lh_count,
+	    (double)lh->lh_min_us / 1000.0,
+	    (double)lh->lh_total_us / lh->lh_count / 1000.0,
+	    (double)lh->lh_max_us / 1000.0);
+}
+
+static void
+print_nfs4_op(void *arg _U_, const char *name, uint64_t calls,
+    uint64_t errors)
+{
+	(void)fprintf(stderr, "nfs v4 %s %" PRIu64 " calls, %" PRIu64
+	    " failed\n", name, calls, errors);
+}
+
+static void
+print_esp_sa(void *arg _U_, uint32_t spi, const char *dst, uint64_t packets,
+    uint64_t missing, uint64_t replayed, uint64_t late)
+{
+	(void)fprintf(stderr,
+	    "esp spi 0x%08x to %s %" PRIu64 " packets, %" PRIu64
+	    " missing, %" PRIu64 " replayed, %" PRIu64 " too old\n",
+	    spi, dst, packets, missing, replayed, late);
+}
+
+/*
+ * Report the --stats-only counters, if we're keeping them.
+ */
+static void
+print_proto_stats(void)
+{
+	struct tcp_conn_stats tcs;
+	struct arp_watch_stats aws;
+	struct nd_state_stats nss;
+	uint64_t unmatched;
+	int vni_header = 0;
+	int meta_header = 0;
+
+	if (stats_ndo == NULL)
+		return;
+	nd_stats_foreach(stats_ndo, print_proto_stat, NULL);
+#ifdef KERNEL_COUNTS_SUPPORTED
+	if (kcounts != NULL)
+		kernel_counts_foreach(kcounts, 0, print_kernel_stat, NULL);
+#endif
+	nd_stats_vni_foreach(stats_ndo, print_vni_stat, &vni_header);
+	nd_stats_meta_foreach(stats_ndo, print_meta_stat, &meta_header);
+	tcp_conn_stats(stats_ndo, &tcs);
+	if (tcs.tcs_slots != 0)
+		(void)fprintf(stderr,
+		    "tcp conversations %u (peak %u, %u slots), %" PRIu64
+		    " closed, %" PRIu64 " idle\n", tcs.tcs_conns,
+		    tcs.tcs_peak, tcs.tcs_slots, tcs.tcs_closed,
+		    tcs.tcs_evicted);
+	latency_foreach(print_nfs_latency, NULL);
+	unmatched = nfs_unmatched_replies();
+	if (unmatched != 0)
+		(void)fprintf(stderr, "nfs replies without a call %" PRIu64 "\n",
+		    unmatched);
+	nfs4_op_foreach(print_nfs4_op, NULL);
+	esp_sa_foreach(stats_ndo, print_esp_sa, NULL);
+	if (stats_ndo->ndo_arp_watch) {
+		arp_watch_stats(stats_ndo, &aws);
+		(void)fprintf(stderr,
+		    "arp-watch neighbors %u, %" PRIu64 " new, %" PRIu64
+		    " moved, %" PRIu64 " over the rate, %" PRIu64
+		    " refreshed, %" PRIu64 " evicted\n", aws.aws_bindings,
+		    aws.aws_new, aws.aws_moved, aws.aws_over_rate,
+		    aws.aws_refreshed, aws.aws_evicted);
+	}
+	nd_state_stats(&nss);
+	if (nss.nss_refused != 0)
+		(void)fprintf(stderr,
+		    "dissector state peak %zu bytes, %" PRIu64
+		    " tables refused by --state-memory\n", nss.nss_peak,
+		    nss.nss_refused);
+}
+
+static void
+print_mem_pool(void *arg _U_, const char *name, uint64_t evicted)
+{
+	if (evicted != 0)
+		(void)fprintf(stderr, "  %s: %" PRIu64 " evicted\n", name,
+		    evicted);
+}
+
+/*
+ * Report the --mem-limit peak, and what was evicted from each pool to
+ * stay under it.
+ */
+static void
+print_mem_stats(void)
+{
+	if (mem_limit == 0)
+		return;
+	(void)fprintf(stderr, "cache memory peak %zu of %zu bytes\n",
+	    nd_mem_peak(), mem_limit);
+	nd_mem_foreach(print_mem_pool, NULL);
+}
+
+/*
+ * Report how often --degrade changed the detail, and how many packets
+ * it only counted.
+ */
+static void
+print_degrade_stats(void)
+{
+	if (!degrade)
+		return;
+	(void)fprintf(stderr,
+	    "%" PRIu64 " change%s of detail, %" PRIu64 " packet%s not printed\n",
+	    degrade_changes, PLURAL_SUFFIX(degrade_changes),
+	    degrade_unprinted, PLURAL_SUFFIX(degrade_unprinted));
+}
+
+/*
+ * Report how much of the --print-thread ring was used, and how often
+ * the capture had to wait for the print thread.
+ */
+static void
+print_ring_stats(void)
+{
+#ifdef PRINT_THREAD_SUPPORTED
+	struct packet_ring_stats prs;
+
+	if (print_ring == NULL)
+		return;
+	packet_ring_stats(print_ring, &prs);
+	if (print_lossy)
+		(void)fprintf(stderr,
+		    "print ring peak %zu of %zu bytes, %" PRIu64 " packet%s not printed\n",
+		    prs.prs_peak, prs.prs_size, prs.prs_dropped,
+		    PLURAL_SUFFIX(prs.prs_dropped));
+	else
+		(void)fprintf(stderr,
+		    "print ring peak %zu of %zu bytes, %" PRIu64 " wait%s for room\n",
+		    prs.prs_peak, prs.prs_size, prs.prs_waits,
+		    PLURAL_SUFFIX(prs.prs_waits));
+#endif
+}
+
+/*
+ * Report how many packets were dropped for want of room while waiting
+ * to be sent with -w tcp:// or udp://, and how often the collector was
+ * connected to, and how many records the reader of a shared-memory
+ * ring left no room for.
+ */
+static void
+print_stream_stats(void)
+{
+#ifdef STREAM_SINK_SUPPORTED
+	struct stream_sink_stats sss;
+#endif
+#ifdef SHM_RING_SUPPORTED
+	struct shm_ring_stats srs;
+#endif
+
+#ifdef STREAM_SINK_SUPPORTED
+	if (stream_dump_info != NULL && stream_dump_info->ssk != NULL) {
+		stream_sink_stats(stream_dump_info->ssk, &sss);
+		(void)fprintf(stderr,
+		    "%" PRIu64 " packet%s not sent, %" PRIu64 " bytes sent in %" PRIu64 " connection%s\n",
+		    sss.sss_dropped, PLURAL_SUFFIX(sss.sss_dropped),
+		    sss.sss_bytes_sent, sss.sss_connects,
+		    PLURAL_SUFFIX(sss.sss_connects));
+	}
+#endif
+#ifdef SHM_RING_SUPPORTED
+	if (shm_dump_info != NULL && shm_dump_info->srg != NULL) {
+		shm_ring_stats(shm_dump_info->srg, &srs);
+		(void)fprintf(stderr,
+		    "%" PRIu64 " packet%s not put in the shared-memory ring\n",
+		    srs.srs_dropped, PLURAL_SUFFIX(srs.srs_dropped));
+	}
+	if (shm_output_ring != NULL) {
+		shm_ring_stats(shm_output_ring, &srs);
+		(void)fprintf(stderr,
+		    "%" PRIu64 " output record%s not put in the shared-memory ring\n",
+		    srs.srs_dropped, PLURAL_SUFFIX(srs.srs_dropped));
+	}
+#endif
+}
+
+static void
+print_output_stats(void)
+{
+#ifdef OUTPUT_BUFFER_SUPPORTED
+	struct output_buffer_stats obs;
+
+	if (output_buffer == NULL)
+		return;
+	output_buffer_stats(output_buffer, &obs);
+	(void)fprintf(stderr,
+	    "output buffer peak %zu of %zu bytes, %" PRIu64 " wait%s for the reader",
+	    obs.obs_peak, obs.obs_size, obs.obs_waits,
+	    PLURAL_SUFFIX(obs.obs_waits));
+	if (output_drop)
+		(void)fprintf(stderr, ", %" PRIu64 " byte%s of output dropped",
+		    obs.obs_dropped_bytes, PLURAL_SUFFIX(obs.obs_dropped_bytes));
+	(void)fputc('\n', stderr);
+#endif
+}
+
+/*
+ * Export the flows still in the --flows table at the end of the capture.
+ */
+static void
+flows_finish(void)
+{
+	uint64_t exported, full;
+
+	if (flows_ndo == NULL)
+		return;
+	nd_flows_flush(flows_ndo);
+	nd_outbuf_flush(flows_ndo);
+	nd_flows_counts(flows_ndo, &exported, &full);
+	if (full != 0)
+		warning("the flow table filled up %" PRIu64 " time%s, so flows were exported early; see --flow-table-size",
+		    full, PLURAL_SUFFIX(full));
+}
+
+static void
+print_latency_hist(void *arg _U_, const struct latency_hist *lh)
+{
+	u_int b;
+
+	(void)fprintf(stderr,
+	    "%-8s %-24s %8" PRIu64 " %9.3f %9.3f %9.3f %9.3f %9.3f\n",
+	    lh->lh_proto, lh->lh_what, lh->lh_count,
+	    (double)lh->lh_min_us / 1000.0,
+	    (double)latency_percentile(lh, 50) / 1000.0,
+	    (double)latency_percentile(lh, 90) / 1000.0,
+	    (double)latency_percentile(lh, 99) / 1000.0,
+	    (double)lh->lh_max_us / 1000.0);
+	if (latency_ndo->ndo_vflag == 0)
+		return;
+	for (b = 0; b < LATENCY_BUCKETS; b++)
+		if (lh->lh_buckets[b] != 0)
+			(void)fprintf(stderr, "%35s>= %.3f ms %8" PRIu64 "\n",
+			    "", (double)latency_bucket_low(b) / 1000.0,
+			    lh->lh_buckets[b]);
+}
+
+#ifdef ENABLE_SMB
+static void
+print_smb2_share(void *arg _U_, const struct smb2_share_stats *ss)
+{
+	double secs;
+
+	(void)fprintf(stderr, "smb2 %s: read %" PRIu64 " bytes in %" PRIu64
+	    " replies, write %" PRIu64 " bytes in %" PRIu64 " replies",
+	    ss->ss_share, ss->ss_read_bytes, ss->ss_reads,
+	    ss->ss_write_bytes, ss->ss_writes);
+	secs = (double)(ss->ss_last_ts - ss->ss_first_ts) / 1000000000.0;
+	if (secs > 0)
+		(void)fprintf(stderr,
+		    ", %.3f MB/s read, %.3f MB/s write over %.3f s",
+		    (double)ss->ss_read_bytes / secs / 1000000.0,
+		    (double)ss->ss_write_bytes / secs / 1000000.0, secs);
+	(void)fputc('\n', stderr);
+}
+#endif
+
+#ifdef DLT_USB_LINUX
+static void
+print_usb_endpoint(void *arg _U_, const struct usb_endpoint_stats *ues)
+{
+	static const char *transfer_names[] = {
+		"isochronous", "interrupt", "control", "bulk"
+	};
+	double secs;
+
+	(void)fprintf(stderr, "usb %u:%u:%u %s %s: %" PRIu64 " URB%s, %"
+	    PRIu64 " bytes, %" PRIu64 " error%s",
+	    ues->ues_bus, ues->ues_device, ues->ues_endpoint & 0x7f,
+	    (ues->ues_endpoint & 0x80) ? "in" : "out",
+	    transfer_names[ues->ues_transfer_type & 3], ues->ues_urbs,
+	    PLURAL_SUFFIX(ues->ues_urbs), ues->ues_bytes, ues->ues_errors,
+	    PLURAL_SUFFIX(ues->ues_errors));
+	secs = (double)(ues->ues_last_ts - ues->ues_first_ts) / 1000000000.0;
+	if (secs > 0)
+		(void)fprintf(stderr, ", %.3f MB/s over %.3f s",
+		    (double)ues->ues_bytes / secs / 1000000.0, secs);
+	(void)fputc('\n', stderr);
+}
+#endif
+
+/*
+ * Report the --latency-report response times, up to the packet time
+ * "to" if it's not 0.
+ */
+static void
+print_latency_report(time_t to)
+{
+	struct tm tmbuf, *tm;
+	char buf[32];
+
+	if (latency_ndo == NULL)
+		return;
+	if (to != 0 && (tm = nd_localtime(&to, &tmbuf)) != NULL &&
+	    strftime(buf, sizeof(buf), "%Y-%m-%d %H:%M:%S", tm) != 0)
+		(void)fprintf(stderr, "response times to %s\n", buf);
+	(void)fprintf(stderr, "%-8s %-24s %8s %9s %9s %9s %9s %9s\n",
+	    "protocol", "request", "replies", "min ms", "p50 ms", "p90 ms",
+	    "p99 ms", "max ms");
+	latency_foreach(print_latency_hist, NULL);
+#ifdef ENABLE_SMB
+	smb2_share_foreach(print_smb2_share, NULL);
+#endif
+#ifdef DLT_USB_LINUX
+	usb_endpoint_foreach(print_usb_endpoint, NULL);
+#endif
+}
+
+static void
+print_bgp_peer(void *arg _U_, const char *peer, const char *family,
+    uint64_t announced, uint64_t withdrawn)
+{
+	(void)fprintf(stderr,
+	    "bgp %s %s %" PRIu64 " announced, %" PRIu64 " withdrawn\n",
+	    peer, family, announced, withdrawn);
+}
+
+static void
+print_bgp_session(void *arg _U_, const struct bgp_session_stats *bss)
+{
+	u_int i;
+
+	(void)fprintf(stderr, "bgp %s > %s: %" PRIu64 " OPEN, %" PRIu64
+	    " UPDATE, %" PRIu64 " NOTIFICATION, %" PRIu64 " KEEPALIVE, %"
+	    PRIu64 " ROUTE-REFRESH", bss->bss_src, bss->bss_dst,
+	    bss->bss_opens, bss->bss_updates, bss->bss_notifications,
+	    bss->bss_keepalives, bss->bss_route_refreshes);
+	if (bss->bss_unknown != 0)
+		(void)fprintf(stderr, ", %" PRIu64 " unknown",
+		    bss->bss_unknown);
+	(void)fprintf(stderr, "\n");
+	if (bss->bss_updates != 0)
+		(void)fprintf(stderr,
+		    "    updates: %" PRIu64 " announced, %" PRIu64
+		    " withdrawn, %" PRIu64 " End-of-RIB, over %.3f s, at most %u in a second\n",
+		    bss->bss_announced, bss->bss_withdrawn, bss->bss_eor,
+		    (double)bss->bss_update_us / 1000000.0,
+		    bss->bss_update_peak);
+	if (bss->bss_keepalive_intervals != 0)
+		(void)fprintf(stderr,
+		    "    keepalives: every %.3f s (%.3f to %.3f), %.3f s jitter\n",
+		    (double)bss->bss_keepalive_mean_us / 1000000.0,
+		    (double)bss->bss_keepalive_min_us / 1000000.0,
+		    (double)bss->bss_keepalive_max_us / 1000000.0,
+		    (double)bss->bss_keepalive_jitter_us / 1000000.0);
+	for (i = 0; i < bss->bss_nnotifications; i++)
+		(void)fprintf(stderr, "    notification %s: %" PRIu64 "\n",
+		    bss->bss_notification[i], bss->bss_notification_count[i]);
+	if (bss->bss_other_notifications != 0)
+		(void)fprintf(stderr, "    notification other: %" PRIu64 "\n",
+		    bss->bss_other_notifications);
+}
+
+/*
+ * Report the --bgp-summary prefix counts per peer and AFI/SAFI and the
+ * --bgp-peers message counts per speaker and peer.
+ */
+static void
+print_bgp_summary(void)
+{
+	if (bgp_summary_ndo != NULL)
+		bgp_peer_foreach(print_bgp_peer, NULL);
+	if (bgp_peers_ndo != NULL)
+		bgp_session_foreach(print_bgp_session, NULL);
+}
+
+static void
+print_openflow_rate(const char *what, const struct openflow_rate *r)
+{
+	double secs;
+
+	if (r->or_count == 0)
+		return;
+	(void)fprintf(stderr, "    %s: %" PRIu64, what, r->or_count);
+	secs = (double)(r->or_last_us - r->or_first_us) / 1000000.0;
+	if (secs > 0)
+		(void)fprintf(stderr, " over %.3f s, %.1f/s", secs,
+		    (double)(r->or_count - 1) / secs);
+	(void)fprintf(stderr, ", at most %u in a second\n", r->or_peak);
+}
+
+static void
+print_openflow_switch(void *arg _U_, const struct openflow_switch_stats *ofs)
+{
+	(void)fprintf(stderr, "openflow %s", ofs->ofs_switch);
+	if (ofs->ofs_have_dpid)
+		(void)fprintf(stderr, " dpid %016" PRIx64, ofs->ofs_dpid);
+	(void)fprintf(stderr, ": %" PRIu64 " messages from it, %" PRIu64
+	    " to it, %" PRIu64 " FLOW_REMOVED, %" PRIu64 " PORT_STATUS, %"
+	    PRIu64 " ERROR\n", ofs->ofs_messages_from, ofs->ofs_messages_to,
+	    ofs->ofs_flow_removed, ofs->ofs_port_status, ofs->ofs_errors);
+	print_openflow_rate("FLOW_MOD", &ofs->ofs_flow_mods);
+	print_openflow_rate("PACKET_IN", &ofs->ofs_packet_ins);
+	print_openflow_rate("PACKET_OUT", &ofs->ofs_packet_outs);
+}
+
+/*
+ * Report the --openflow-summary message counts and rates per switch.
+ */
+static void
+print_openflow_summary(void)
+{
+	if (openflow_ndo != NULL)
+		openflow_switch_foreach(print_openflow_switch, NULL);
+}
+
+static void
+print_resp_command(void *arg _U_, const struct resp_command_stats *rc)
+{
+	(void)fprintf(stderr, "resp %s: %" PRIu64 " command%s, %" PRIu64
+	    " bytes\n", rc->rc_name, rc->rc_count,
+	    PLURAL_SUFFIX(rc->rc_count), rc->rc_bytes);
+}
+
+/*
+ * Report the Redis commands --extract-payloads has written out, by name.
+ */
+static void
+print_resp_commands(void)
+{
+	if (tap_ndo != NULL)
+		resp_command_foreach(print_resp_command, NULL);
+}
+
+static const char *ppp_session_states[] = {
+	"seen", "setting up", "up", "down"
+};
+
+static void
+print_ppp_session(void *arg _U_, const struct ppp_session_stats *pss)
+{
+	if (pss->pss_proto == PPP_SESSION_PPPOE)
+		(void)fprintf(stderr, "pppoe session 0x%x", pss->pss_session);
+	else if (pss->pss_session == PPP_SESSION_TUNNEL)
+		(void)fprintf(stderr, "l2tp tunnel %u", pss->pss_tunnel);
+	else
+		(void)fprintf(stderr, "l2tp session %u/%u", pss->pss_tunnel,
+		    pss->pss_session);
+	(void)fprintf(stderr, ": %s", ppp_session_states[pss->pss_state]);
+	if (pss->pss_session != PPP_SESSION_TUNNEL)
+		(void)fprintf(stderr, ", %" PRIu64 " packet%s, %" PRIu64
+		    " bytes", pss->pss_packets, PLURAL_SUFFIX(pss->pss_packets),
+		    pss->pss_bytes);
+	(void)fprintf(stderr, ", %" PRIu64 " control message%s\n",
+	    pss->pss_control, PLURAL_SUFFIX(pss->pss_control));
+}
+
+/*
+ * Report the L2TP tunnels and sessions and PPPoE sessions --ppp-sessions
+ * has seen, with their states and traffic.
+ */
+static void
+print_ppp_sessions(void)
+{
+	if (ppp_ndo != NULL)
+		ppp_session_foreach(print_ppp_session, NULL);
+}
+
+static void
+print_mcast_group(void *arg _U_, const struct mcast_group_stats *mgs)
+{
+	(void)fprintf(stderr, "mcast %s: %u member%s%s, %" PRIu64
+	    " report%s, %" PRIu64 " join%s, %" PRIu64 " leave%s, %" PRIu64
+	    " PIM join%s, %" PRIu64 " PIM prune%s\n", mgs->mgs_group,
+	    mgs->mgs_members, PLURAL_SUFFIX(mgs->mgs_members),
+	    mgs->mgs_upstream ? ", joined upstream" : "",
+	    mgs->mgs_reports, PLURAL_SUFFIX(mgs->mgs_reports),
+	    mgs->mgs_joins, PLURAL_SUFFIX(mgs->mgs_joins),
+	    mgs->mgs_leaves, PLURAL_SUFFIX(mgs->mgs_leaves),
+	    mgs->mgs_pim_joins, PLURAL_SUFFIX(mgs->mgs_pim_joins),
+	    mgs->mgs_pim_prunes, PLURAL_SUFFIX(mgs->mgs_pim_prunes));
+}
+
+/*
+ * Report the (S,G) and (*,G) state --mcast-groups has kept.
+ */
+static void
+print_mcast_groups(void)
+{
+	if (mcast_ndo != NULL)
+		mcast_group_foreach(print_mcast_group, NULL);
+}
+
+static void
+print_label_binding(void *arg _U_, const struct label_binding_stats *lbs)
+{
+	(void)fprintf(stderr, "%s: label %u%s, %" PRIu64 " change%s, %"
+	    PRIu64 " refresh%s\n", lbs->lbs_name, lbs->lbs_label,
+	    lbs->lbs_bound ? "" : " withdrawn",
+	    lbs->lbs_changes, PLURAL_SUFFIX(lbs->lbs_changes),
+	    lbs->lbs_refreshes, lbs->lbs_refreshes != 1 ? "es" : "");
+}
+
+/*
+ * Report the labels --label-bindings has seen bound, and how often.
+ */
+static void
+print_label_bindings(void)
+{
+	if (label_ndo != NULL)
+		label_binding_foreach(print_label_binding, NULL);
+}
+
+static void
+print_tcp_conversation(void *arg _U_, const struct tcp_analysis_stats *tas)
+{
+	uint64_t avg;
+
+	(void)fprintf(stderr, "tcp %s: %" PRIu64 " packet%s, %" PRIu64
+	    " byte%s, %" PRIu64 " retransmission%s, %" PRIu64
+	    " out-of-order, %" PRIu64 " lost, %" PRIu64 " keep-alive%s, %"
+	    PRIu64 " dup ack%s, %" PRIu64 " zero window%s (%" PRIu64
+	    ".%03u ms), %" PRIu64 " window full", tas->tas_conn,
+	    tas->tas_packets, PLURAL_SUFFIX(tas->tas_packets),
+	    tas->tas_bytes, PLURAL_SUFFIX(tas->tas_bytes),
+	    tas->tas_retransmissions, PLURAL_SUFFIX(tas->tas_retransmissions),
+	    tas->tas_out_of_order, tas->tas_lost,
+	    tas->tas_keepalives, PLURAL_SUFFIX(tas->tas_keepalives),
+	    tas->tas_dup_acks, PLURAL_SUFFIX(tas->tas_dup_acks),
+	    tas->tas_zero_windows, PLURAL_SUFFIX(tas->tas_zero_windows),
+	    tas->tas_zero_window_us / 1000,
+	    (u_int)(tas->tas_zero_window_us % 1000),
+	    tas->tas_window_full);
+	if (tas->tas_rtt_samples != 0) {
+		avg = tas->tas_rtt_total_us / tas->tas_rtt_samples;
+		(void)fprintf(stderr, ", rtt min/avg/max %" PRIu64 ".%03u/%"
+		    PRIu64 ".%03u/%" PRIu64 ".%03u ms",
+		    tas->tas_rtt_min_us / 1000,
+		    (u_int)(tas->tas_rtt_min_us % 1000),
+		    avg / 1000, (u_int)(avg % 1000),
+		    tas->tas_rtt_max_us / 1000,
+		    (u_int)(tas->tas_rtt_max_us % 1000));
+	}
+	if (tas->tas_handshake_us != 0)
+		(void)fprintf(stderr, ", handshake %" PRIu64 ".%03u ms",
+		    tas->tas_handshake_us / 1000,
+		    (u_int)(tas->tas_handshake_us % 1000));
+	(void)fprintf(stderr, "%s\n", tas->tas_closed ? ", closed" : "");
+}
+
+/*
+ * Report what --tcp-analysis found in each conversation.
+ */
+static void
+print_tcp_analysis(void)
+{
+	if (tcp_analysis_ndo != NULL)
+		tcp_analysis_foreach(print_tcp_conversation, NULL);
+}
+
+static void
+print_mptcp_connection(void *arg _U_, const struct mptcp_conn_stats *mcs)
+{
+	uint64_t us = mcs->mcs_last_us - mcs->mcs_first_us;
+
+	(void)fprintf(stderr, "mptcp %s", mcs->mcs_first);
+	if (mcs->mcs_tokens & 1)
+		(void)fprintf(stderr, " token 0x%08x", mcs->mcs_token[0]);
+	if (mcs->mcs_tokens & 2)
+		(void)fprintf(stderr, " %s 0x%08x",
+		    (mcs->mcs_tokens & 1) ? "and" : "token", mcs->mcs_token[1]);
+	(void)fprintf(stderr, ": %u subflow%s, %" PRIu64 " packet%s, %"
+	    PRIu64 ".%06u s, %" PRIu64 " byte%s sent, %" PRIu64
+	    " byte%s received", mcs->mcs_subflows,
+	    PLURAL_SUFFIX(mcs->mcs_subflows),
+	    mcs->mcs_packets, PLURAL_SUFFIX(mcs->mcs_packets),
+	    us / 1000000, (u_int)(us % 1000000),
+	    mcs->mcs_data[0], PLURAL_SUFFIX(mcs->mcs_data[0]),
+	    mcs->mcs_data[1], PLURAL_SUFFIX(mcs->mcs_data[1]));
+	if (us != 0)
+		(void)fprintf(stderr, ", %.3f/%.3f kbit/s",
+		    (double)mcs->mcs_data[0] * 8000 / (double)us,
+		    (double)mcs->mcs_data[1] * 8000 / (double)us);
+	if (mcs->mcs_fast_close)
+		(void)fprintf(stderr, ", fast closed");
+	else if (mcs->mcs_data_fins == 3)
+		(void)fprintf(stderr, ", closed");
+	(void)fprintf(stderr, "\n");
+}
+
+static void
+print_mptcp_subflow(void *arg _U_, const struct mptcp_subflow_stats *mss)
+{
+	(void)fprintf(stderr, "\t%s %s: %" PRIu64 " packet%s, %" PRIu64
+	    " byte%s sent, %" PRIu64 " byte%s received\n",
+	    mss->mss_join ? "join" : "capable", mss->mss_name,
+	    mss->mss_packets, PLURAL_SUFFIX(mss->mss_packets),
+	    mss->mss_data[0], PLURAL_SUFFIX(mss->mss_data[0]),
+	    mss->mss_data[1], PLURAL_SUFFIX(mss->mss_data[1]));
+}
+
+/*
+ * Report the MPTCP connections --mptcp-connections has followed, and
+ * their subflows.
+ */
+static void
+print_mptcp_connections(void)
+{
+	if (mptcp_ndo != NULL)
+		mptcp_conn_foreach(print_mptcp_connection,
+		    print_mptcp_subflow, NULL);
+}
+
+static void
+print_rtp_stream(void *arg, const struct rtp_stream_stats *rss)
+{
+	const uint64_t *since = (const uint64_t *)arg;
+	uint64_t lost_permille;
+
+	lost_permille = rss->rss_lost > 0 && rss->rss_expected != 0 ?
+	    (uint64_t)rss->rss_lost * 1000 / rss->rss_expected : 0;
+	(void)fprintf(stderr, "rtp %s ssrc 0x%08x pt %u: %" PRIu64
+	    " packet%s, %" PRId64 " lost (%" PRIu64 ".%u%%), %" PRIu64
+	    " gap%s, %" PRIu64 " out-of-order, %" PRIu64 " duplicate%s",
+	    rss->rss_stream, rss->rss_ssrc, rss->rss_pt,
+	    rss->rss_packets, PLURAL_SUFFIX(rss->rss_packets),
+	    rss->rss_lost, lost_permille / 10, (u_int)(lost_permille % 10),
+	    rss->rss_gaps, PLURAL_SUFFIX(rss->rss_gaps),
+	    rss->rss_out_of_order,
+	    rss->rss_duplicates, PLURAL_SUFFIX(rss->rss_duplicates));
+	if (rss->rss_jumps != 0)
+		(void)fprintf(stderr, ", %" PRIu64 " sequence jump%s",
+		    rss->rss_jumps, PLURAL_SUFFIX(rss->rss_jumps));
+	if (rss->rss_clock != 0)
+		(void)fprintf(stderr, ", jitter %" PRIu64 ".%03u ms (max %"
+		    PRIu64 ".%03u ms)",
+		    rss->rss_jitter_us / 1000,
+		    (u_int)(rss->rss_jitter_us % 1000),
+		    rss->rss_max_jitter_us / 1000,
+		    (u_int)(rss->rss_max_jitter_us % 1000));
+	if (since != NULL && rss->rss_last_us < *since)
+		(void)fprintf(stderr, ", ended");
+	(void)fputc('\n', stderr);
+}
+
+/*
+ * Report the --rtp-analysis streams, up to the packet time "to" if
+ * it's not 0; then the streams that had no packets in the interval
+ * ending then are done with, and make room for new ones.
+ */
+static void
+print_rtp_report(time_t to)
+{
+	struct tm tmbuf, *tm;
+	char buf[32];
+	uint64_t since;
+
+	if (rtp_ndo == NULL)
+		return;
+	if (to == 0) {
+		rtp_analysis_foreach(print_rtp_stream, NULL);
+		return;
+	}
+	if ((tm = nd_localtime(&to, &tmbuf)) != NULL &&
+	    strftime(buf, sizeof(buf), "%Y-%m-%d %H:%M:%S", tm) != 0)
+		(void)fprintf(stderr, "rtp streams to %s\n", buf);
+	since = (uint64_t)(to - rtp_interval) * 1000000;
+	rtp_analysis_foreach(print_rtp_stream, &since);
+	rtp_analysis_expire(since);
+}
+
+static void
+print_bfd_session(void *arg _U_, const struct bfd_session_stats *bss)
+{
+	(void)fprintf(stderr, "bfd %s: %s, %" PRIu64 " packet%s, %" PRIu64
+	    " transition%s, interval %u.%03u ms", bss->bss_name,
+	    bss->bss_state, bss->bss_packets, PLURAL_SUFFIX(bss->bss_packets),
+	    bss->bss_transitions, PLURAL_SUFFIX(bss->bss_transitions),
+	    bss->bss_interval / 1000, bss->bss_interval % 1000);
+	if (bss->bss_gaps != 0)
+		(void)fprintf(stderr, ", jitter %" PRIu64 ".%03u ms, max gap %"
+		    PRIu64 ".%03u ms", bss->bss_dev_total / bss->bss_gaps / 1000,
+		    (u_int)(bss->bss_dev_total / bss->bss_gaps % 1000),
+		    bss->bss_max_gap / 1000, (u_int)(bss->bss_max_gap % 1000));
+	(void)fprintf(stderr, ", %" PRIu64 " late (%" PRIu64
+	    " over the detection time), %" PRIu64 " early\n", bss->bss_late,
+	    bss->bss_detect, bss->bss_early);
+}
+
+/*
+ * Report the BFD sessions --bfd-sessions has followed.
+ */
+static void
+print_bfd_sessions(void)
+{
+	if (bfd_ndo != NULL)
+		bfd_session_foreach(print_bfd_session, NULL);
+}
+
+static void
+print_someip_method(void *arg _U_, const struct someip_method_stats *sms)
+{
+	double secs;
+
+	(void)fprintf(stderr, "someip service 0x%04x %s 0x%04x: %" PRIu64
+	    " message%s", sms->sms_service,
+	    sms->sms_method & 0x8000 ? "event" : "method",
+	    sms->sms_method & 0x7fff, sms->sms_messages,
+	    PLURAL_SUFFIX(sms->sms_messages));
+	secs = (double)(sms->sms_last_us - sms->sms_first_us) / 1000000.0;
+	if (secs > 0)
+		(void)fprintf(stderr, " over %.3f s, %.1f/s", secs,
+		    (double)(sms->sms_messages - 1) / secs);
+	(void)fprintf(stderr, ", at most %u in a second\n", sms->sms_peak);
+	if (sms->sms_notifications != 0)
+		(void)fprintf(stderr, "    %" PRIu64 " notification%s\n",
+		    sms->sms_notifications,
+		    PLURAL_SUFFIX(sms->sms_notifications));
+	if (sms->sms_requests != 0 || sms->sms_no_return != 0 ||
+	    sms->sms_responses != 0)
+		(void)fprintf(stderr, "    %" PRIu64 " request%s, %" PRIu64
+		    " without return, %" PRIu64 " response%s (%" PRIu64
+		    " error%s, %" PRIu64 " unmatched)\n", sms->sms_requests,
+		    PLURAL_SUFFIX(sms->sms_requests), sms->sms_no_return,
+		    sms->sms_responses, PLURAL_SUFFIX(sms->sms_responses),
+		    sms->sms_errors, PLURAL_SUFFIX(sms->sms_errors),
+		    sms->sms_unmatched);
+	if (sms->sms_timed != 0)
+		(void)fprintf(stderr, "    response time min %" PRIu64
+		    ".%03u ms, mean %" PRIu64 ".%03u ms, max %" PRIu64
+		    ".%03u ms\n", sms->sms_rtt_min_us / 1000,
+		    (u_int)(sms->sms_rtt_min_us % 1000),
+		    sms->sms_rtt_total_us / sms->sms_timed / 1000,
+		    (u_int)(sms->sms_rtt_total_us / sms->sms_timed % 1000),
+		    sms->sms_rtt_max_us / 1000,
+		    (u_int)(sms->sms_rtt_max_us % 1000));
+}
+
+/*
+ * Report the --someip-summary counts, rates and response times per
+ * method and event.
+ */
+static void
+print_someip_summary(void)
+{
+	if (someip_ndo != NULL)
+		someip_method_foreach(print_someip_method, NULL);
+}
+
+static void
+print_v2x_station(void *arg, const struct v2x_station_stats *vss)
+{
+	const uint64_t *since = (const uint64_t *)arg;
+	double secs;
+
+	(void)fprintf(stderr, "v2x %s: %" PRIu64 " message%s",
+	    vss->vss_station, vss->vss_messages,
+	    PLURAL_SUFFIX(vss->vss_messages));
+	secs = (double)(vss->vss_last_us - vss->vss_first_us) / 1000000.0;
+	if (secs > 0)
+		(void)fprintf(stderr, " over %.3f s, %.1f/s, longest gap %"
+		    PRIu64 ".%03u s", secs,
+		    (double)(vss->vss_messages - 1) / secs,
+		    vss->vss_max_gap_us / 1000000,
+		    (u_int)(vss->vss_max_gap_us / 1000 % 1000));
+	(void)fprintf(stderr, ", at most %u in a second", vss->vss_peak);
+	if (since != NULL) {
+		(void)fprintf(stderr, ", %" PRIu64 " in the last %d s",
+		    vss->vss_recent, v2x_interval);
+		if (vss->vss_last_us < *since)
+			(void)fprintf(stderr, ", gone");
+	}
+	(void)fputc('\n', stderr);
+	if (vss->vss_beacons != 0 || vss->vss_single_hop != 0 ||
+	    vss->vss_multi_hop != 0 || vss->vss_unicasts != 0)
+		(void)fprintf(stderr, "    %" PRIu64 " beacon%s, %" PRIu64
+		    " single-hop, %" PRIu64 " multi-hop, %" PRIu64
+		    " unicast; %" PRIu64 " CAM%s, %" PRIu64 " DENM%s\n",
+		    vss->vss_beacons, PLURAL_SUFFIX(vss->vss_beacons),
+		    vss->vss_single_hop, vss->vss_multi_hop,
+		    vss->vss_unicasts, vss->vss_cams,
+		    PLURAL_SUFFIX(vss->vss_cams), vss->vss_denms,
+		    PLURAL_SUFFIX(vss->vss_denms));
+	if (vss->vss_have_position)
+		(void)fprintf(stderr, "    at lat %.7f lon %.7f, moved %"
+		    PRIu64 " time%s\n", (double)vss->vss_lat / 10000000.0,
+		    (double)vss->vss_lon / 10000000.0, vss->vss_moves,
+		    PLURAL_SUFFIX(vss->vss_moves));
+}
+
+/*
+ * Report the --v2x-stations table, up to the packet time "to" if it's
+ * not 0; then the stations not heard from in the interval ending then
+ * are dropped, as rtp_analysis_expire() drops RTP streams.
+ */
+static void
+print_v2x_report(time_t to)
+{
+	struct tm tmbuf, *tm;
+	char buf[32];
+	uint64_t since;
+
+	if (v2x_ndo == NULL)
+		return;
+	if (to == 0) {
+		v2x_station_foreach(print_v2x_station, NULL);
+		return;
+	}
+	if ((tm = nd_localtime(&to, &tmbuf)) != NULL &&
+	    strftime(buf, sizeof(buf), "%Y-%m-%d %H:%M:%S", tm) != 0)
+		(void)fprintf(stderr, "v2x stations to %s\n", buf);
+	since = (uint64_t)(to - v2x_interval) * 1000000;
+	v2x_station_foreach(print_v2x_station, &since);
+	v2x_station_expire(since);
+}
+
+/*
+ * Report how many LSPs and LSAs --lsdb has kept, and what the copies of
+ * them seen were.
+ */
+static void
+print_lsdb_report(void)
+{
+	static const char *proto[LSDB_PROTOS] = { "isis", "ospf" };
+	struct lsdb_counts lc;
+	u_int i;
+
+	if (lsdb_ndo == NULL)
+		return;
+	for (i = 0; i < LSDB_PROTOS; i++) {
+		lsdb_counts(i, &lc);
+		if (lc.lc_entries == 0)
+			continue;
+		(void)fprintf(stderr, "lsdb %s %" PRIu64 " %s: %" PRIu64
+		    " new, %" PRIu64 " repeated, %" PRIu64 " refreshed, %"
+		    PRIu64 " changed, %" PRIu64 " older\n", proto[i],
+		    lc.lc_entries, i == LSDB_ISIS ? "LSPs" : "LSAs",
+		    lc.lc_copies[LSDB_NEW], lc.lc_copies[LSDB_REPEAT],
+		    lc.lc_copies[LSDB_REFRESH], lc.lc_copies[LSDB_CHANGE],
+		    lc.lc_copies[LSDB_OLDER]);
+	}
+}
+
+#ifdef ENABLE_DISSECTOR_PROFILE
+static void
+print_dissector_call(void *arg _U_, const char *name, uint64_t calls,
+    uint64_t total_ns, uint64_t self_ns, uint64_t truncated)
+{
+	(void)fprintf(stderr, "%-16s %10" PRIu64 " %12.3f %12.3f %10" PRIu64 "\n",
+	    name, calls, (double)total_ns / 1000000.0,
+	    (double)self_ns / 1000000.0, truncated);
+}
+
+/*
+ * Report the --profile-dissectors counters, if we're keeping them.
+ */
+static void
+print_dissector_profile(void)
+{
+	if (profile_ndo == NULL)
+		return;
+	(void)fprintf(stderr, "%-16s %10s %12s %12s %10s\n", "dissector",
+	    "calls", "total ms", "self ms", "truncated");
+	nd_profile_foreach(profile_ndo, print_dissector_call, NULL);
+}
+
+static void
+print_snaplen_path(void *arg _U_, const char *path, uint64_t packets,
+    uint64_t truncated, u_int max, u_int most)
+{
+	(void)fprintf(stderr, "%-32s %10" PRIu64 " %10" PRIu64 " %7u %7u\n",
+	    path, packets, truncated, max, most);
+}
+
+/*
+ * Report the --snaplen-report counters, if we're keeping them, and the
+ * snapshot length that would have done for 99.9% of the packets.
+ */
+static void
+print_snaplen_report(void)
+{
+	uint64_t packets;
+	u_int snaplen;
+
+	if (snaplen_ndo == NULL)
+		return;
+	(void)fprintf(stderr, "%-32s %10s %10s %7s %7s\n", "protocol path",
+	    "packets", "truncated", "max", "99.9%");
+	nd_snaplen_foreach(snaplen_ndo, 999, print_snaplen_path, NULL);
+	snaplen = nd_snaplen_recommend(snaplen_ndo, 999, &packets);
+	if (packets != 0)
+		(void)fprintf(stderr,
+		    "-s %u is enough for 99.9%% of the %" PRIu64 " packets\n",
+		    snaplen, packets);
+}
+#endif
+
+static void
+info(int verbose)
+{
+	struct pcap_stat stats;
+
+	print_decap_stats();
+	print_sample_stats();
+	print_hosts_stats();
+	print_payload_stats();
+	print_dedup_stats();
+	print_memo_stats();
+	print_flow_trunc_stats();
+	print_anon_stats();
+	print_split_stats();
+	print_follow_stats();
+	print_beacon_stats();
+	print_neighbors();
+	print_wpan_stats();
+	print_proto_stats();
+	print_mem_stats();
+	print_degrade_stats();
+#ifdef DISSECT_THREADS_SUPPORTED
+	print_pipeline_stats();
+#endif
+	print_ring_stats();
+	print_stream_stats();
+	print_output_stats();
+	print_latency_report(0);
+	print_bgp_summary();
+	print_openflow_summary();
+	print_resp_commands();
+	print_ppp_sessions();
+	print_mcast_groups();
+	print_label_bindings();
+	print_tcp_analysis();
+	print_mptcp_connections();
+	print_rtp_report(0);
+	print_bfd_sessions();
+	print_someip_summary();
+	print_v2x_report(0);
+	print_lsdb_report();
+#ifdef ENABLE_DISSECTOR_PROFILE
+	print_dissector_profile();
+	print_snaplen_report();
+#endif
+
+	/*
+	 * Older versions of libpcap didn't set ps_ifdrop on some
+	 * platforms; initialize it to 0 to handle that.
+	 */
+	stats.ps_ifdrop = 0;
+	if (pcap_stats(pd, &stats) < 0) {
+		(void)fprintf(stderr, "pcap_stats: %s\n", pcap_geterr(pd));
+		infoprint = 0;
+		return;
+	}
+#ifdef MULTI_IFACE_SUPPORTED
+	/* With more than one -i, the statistics are for all of them. */
+	if (multi_ifaces != NULL) {
+		struct pcap_stat istats;
+		int i;
+
+		for (i = 1; i < multi_ndevices; i++) {
+			istats.ps_ifdrop = 0;
+			if (pcap_stats(multi_ifaces[i].pd, &istats) < 0) {
+				(void)fprintf(stderr, "pcap_stats: %s: %s\n",
+				    multi_ifaces[i].name,
+				    pcap_geterr(multi_ifaces[i].pd));
+				infoprint = 0;
+				return;
+			}
+			stats.ps_recv += istats.ps_recv;
+			stats.ps_drop += istats.ps_drop;
+			stats.ps_ifdrop += istats.ps_ifdrop;
+		}
+	}
+#endif
+
+	if (!verbose)
+		fprintf(stderr, "%s: ", program_name);
+
+	(void)fprintf(stderr, "%u packet%s captured", packets_captured,
+	    PLURAL_SUFFIX(packets_captured));
+	if (!verbose)
+		fputs(", ", stderr);
+	else
+		putc('\n', stderr);
+	(void)fprintf(stderr, "%u packet%s received by filter", stats.ps_recv,
+	    PLURAL_SUFFIX(stats.ps_recv));
+	if (!verbose)
+		fputs(", ", stderr);
+	else
+		putc('\n', stderr);
+	(void)fprintf(stderr, "%u packet%s dropped by kernel", stats.ps_drop,
+	    PLURAL_SUFFIX(stats.ps_drop));
+	if (stats.ps_ifdrop != 0) {
+		if (!verbose)
+			fputs(", ", stderr);
+		else
+			putc('\n', stderr);
+		(void)fprintf(stderr, "%u packet%s dropped by interface\n",
+		    stats.ps_ifdrop, PLURAL_SUFFIX(stats.ps_ifdrop));
+	} else
+		putc('\n', stderr);
+	infoprint = 0;
+}
+
+#if defined(HAVE_FORK) || defined(HAVE_VFORK)
+#ifdef HAVE_FORK
+#define fork_subprocess() fork()
+#else
+#define fork_subprocess() vfork()
+#endif
+static void
+compress_savefile(const char *filename)
+{
+	pid_t child;
+
+	child = fork_subprocess();
+	if (child == -1) {
+		fprintf(stderr,
+			"compress_savefile: fork failed: %s\n",
+			pcap_strerror(errno));
+		return;
+	}
+	if (child != 0) {
+		/* Parent process. */
+		return;
+	}
+
+	/*
+	 * Child process.
+	 * Set to lowest priority so that this doesn't disturb the capture.
+	 */
+#ifdef NZERO
+	setpriority(PRIO_PROCESS, 0, NZERO - 1);
+#else
+	setpriority(PRIO_PROCESS, 0, 19);
+#endif
+	if (execlp(zflag, zflag, filename, (char *)NULL) == -1)
+		fprintf(stderr,
+			"compress_savefile: execlp(%s, %s) failed: %s\n",
+			zflag,
+			filename,
+			pcap_strerror(errno));
+#ifdef HAVE_FORK
+	exit(S_ERR_HOST_PROGRAM);
+#else
+	_exit(S_ERR_HOST_PROGRAM);
+#endif
+}
+#else  /* HAVE_FORK && HAVE_VFORK */
+static void
+compress_savefile(const char *filename)
+{
+	fprintf(stderr,
+		"compress_savefile failed. Functionality not implemented under your system\n");
+}
+#endif /* HAVE_FORK && HAVE_VFORK */
+
+#ifndef _WIN32
+/*
+ * Set up a --mmap-savefile savefile, preallocated for the -C file size,
+ * on fd, which is the result of opening fname for reading and writing.
+ */
+static struct mmap_savefile *
+open_mmap_savefile(pcap_t *pc, int fd, const char *fname)
+{
+	struct mmap_savefile *msf;
+	char ebuf[PCAP_ERRBUF_SIZE];
+
+	if (fd < 0)
+		error("unable to open file %s: %s", fname,
+		    pcap_strerror(errno));
+	msf = mmap_savefile_open(pc, fd, (uint64_t)Cflag, ebuf);
+	if (msf == NULL)
+		error("%s: %s", fname, ebuf);
+	return (msf);
+}
+#endif /* _WIN32 */
+
+#ifdef GZIP_SAVEFILE_SUPPORTED
+/*
+ * Set up a --gzip-savefile stream for dump_info->CurrentFileName on fd,
+ * which is the result of opening it for writing.
+ */
+static FILE *
+open_gzip_savefile(struct dump_info *dump_info, int fd)
+{
+	char ebuf[PCAP_ERRBUF_SIZE];
+
+	if (fd < 0)
+		error("unable to open file %s: %s", dump_info->CurrentFileName,
+		    pcap_strerror(errno));
+	dump_info->gsf = gzip_savefile_open(fd, gzip_level, ebuf);
+	if (dump_info->gsf == NULL)
+		error("%s: %s", dump_info->CurrentFileName, ebuf);
+	return (gzip_savefile_file(dump_info->gsf));
+}
+#endif /* GZIP_SAVEFILE_SUPPORTED */
+
+#ifdef URING_SAVEFILE_SUPPORTED
+/*
+ * Create dump_info->CurrentFileName, and set up an --io-uring stream
+ * for it.
+ */
+static FILE *
+open_uring_savefile(struct dump_info *dump_info)
+{
+	char ebuf[PCAP_ERRBUF_SIZE];
+
+	dump_info->usf = uring_savefile_open(dump_info->CurrentFileName,
+	    uring_flag == 2, ebuf);
+	if (dump_info->usf == NULL)
+		error("%s", ebuf);
+	return (uring_savefile_file(dump_info->usf));
+}
+#endif /* URING_SAVEFILE_SUPPORTED */
+
+#ifndef _WIN32
+/*
+ * Open dump_info->CurrentFileName for --recycle-savefiles.  The -W
+ * savefiles are created once, with room for -C bytes, and after that
+ * the oldest one is overwritten in place, renamed first if -G has
+ * given the new one a different name; close_savefile() truncates it to
+ * what was written.
+ */
+static FILE *
+open_recycled_savefile(struct dump_info *dump_info)
+{
+	const char *name = dump_info->CurrentFileName;
+	char **slot;
+	FILE *fp;
+	int fd;
+
+	slot = &recycle_names[recycle_seq++ % (u_int)Wflag];
+	if (*slot != NULL && strcmp(*slot, name) != 0) {
+		if (rename(*slot, name) == -1)
+			error("unable to rename %s to %s: %s", *slot, name,
+			    pcap_strerror(errno));
+		free(*slot);
+		*slot = NULL;
+	}
+	fd = open(name, O_CREAT | O_WRONLY, 0644);
+	if (fd < 0)
+		error("unable to open file %s: %s", name, pcap_strerror(errno));
+	if (*slot == NULL) {
+#ifdef HAVE_POSIX_FALLOCATE
+		/* If this fails, the file just grows as it's written. */
+		(void)posix_fallocate(fd, 0, (off_t)Cflag);
+#endif
+		*slot = strdup(name);
+		if (*slot == NULL)
+			error("strdup of %s", name);
+	}
+	dump_info->recycle_fd = dup(fd);
+	if (dump_info->recycle_fd < 0)
+		error("unable to dup the descriptor of %s: %s", name,
+		    pcap_strerror(errno));
+	fp = fdopen(fd, "w");
+	if (fp == NULL)
+		error("unable to fdopen file %s", name);
+	return (fp);
+}
+#endif /* _WIN32 */
+
+#if defined(STREAM_SINK_SUPPORTED) || defined(SHM_RING_SUPPORTED)
+/*
+ * Return 1 if "name", a -w argument, is sent somewhere other than a
+ * file.
+ */
+static int
+unfiled_savefile(const char *name _U_)
+{
+#ifdef STREAM_SINK_SUPPORTED
+	if (stream_sink_url(name))
+		return (1);
+#endif
+#ifdef SHM_RING_SUPPORTED
+	if (shm_ring_url(name))
+		return (1);
+#endif
+	return (0);
+}
+
+/*
+ * Have libpcap write the file header into "header", as it would for a
+ * file, and return its length.
+ */
+static size_t
+make_savefile_header(struct dump_info *dump_info, u_char *header,
+    size_t size)
+{
+	pcap_dumper_t *p;
+	FILE *fp;
+	long len;
+
+	fp = fmemopen(header, size, "w");
+	if (fp == NULL)
+		error("fmemopen: %s", pcap_strerror(errno));
+	p = pcap_dump_fopen(dump_info->pd, fp);
+	if (p == NULL)
+		error("%s", pcap_geterr(dump_info->pd));
+	if (fflush(fp) == EOF || (len = ftell(fp)) <= 0)
+		error("unable to make the savefile header for %s",
+		    dump_info->CurrentFileName);
+	pcap_dump_close(p);
+	return ((size_t)len);
+}
+#endif
+
+#ifdef STREAM_SINK_SUPPORTED
+/*
+ * Set up the sink for -w tcp:// or udp://, and start the thread that
+ * sends to the collector.
+ */
+static void
+open_stream_sink(struct dump_info *dump_info)
+{
+	char ebuf[PCAP_ERRBUF_SIZE];
+	u_char header[64];
+	size_t len;
+
+	len = make_savefile_header(dump_info, header, sizeof(header));
+	dump_info->ssk = stream_sink_open(dump_info->CurrentFileName,
+	    stream_buffer, header, len, ebuf);
+	if (dump_info->ssk == NULL)
+		error("%s", ebuf);
+	start_thread(&stream_tid, stream_sink_main, dump_info->ssk,
+	    "stream sink");
+}
+#endif /* STREAM_SINK_SUPPORTED */
+
+#ifdef SHM_RING_SUPPORTED
+/*
+ * Set up the ring for -w shm:name, describing the packets as the file
+ * header libpcap would write does.
+ */
+static void
+open_shm_ring(struct dump_info *dump_info)
+{
+	char ebuf[PCAP_ERRBUF_SIZE];
+	u_char header[64];
+	uint32_t magic, snaplen, linktype;
+
+	(void)make_savefile_header(dump_info, header, sizeof(header));
+	memcpy(&magic, header, 4);
+	memcpy(&snaplen, header + 16, 4);
+	memcpy(&linktype, header + 20, 4);
+	dump_info->srg = shm_ring_create(dump_info->CurrentFileName + 4,
+	    SHM_RING_PACKETS, shm_size, (int)linktype, snaplen,
+	    magic == 0xa1b23c4d ? 1000000000 : 1000000, ebuf);
+	if (dump_info->srg == NULL)
+		error("%s", ebuf);
+}
+#endif /* SHM_RING_SUPPORTED */
+
+/*
+ * The number of interfaces in a --pcapng savefile, and the pcap_t and
+ * name of interface "ifid"; the name is NULL when reading a savefile.
+ */
+static u_int
+pcapng_ninterfaces(void)
+{
+#ifdef MULTI_IFACE_SUPPORTED
+	if (multi_ifaces != NULL)
+		return ((u_int)multi_ndevices);
+#endif
+	return (1);
+}
+
+static pcap_t *
+pcapng_interface(u_int ifid, const char **namep)
+{
+#ifdef MULTI_IFACE_SUPPORTED
+	if (multi_ifaces != NULL) {
+		*namep = multi_ifaces[ifid].name;
+		return (multi_ifaces[ifid].pd);
+	}
+#endif
+	*namep = pcapng_ifname;
+	return (pd);
+}
+
+/*
+ * Set up a --pcapng savefile as dump_info->CurrentFileName, on fp if
+ * it's already open, with an interface description for each interface.
+ */
+static void
+open_pcapng_savefile(struct dump_info *dump_info, FILE *fp)
+{
+	char ebuf[PCAP_ERRBUF_SIZE];
+	const char *name;
+	pcap_t *pc;
+	u_int i;
+
+	if (fp != NULL)
+		dump_info->ngsf = pcapng_savefile_fopen(fp, pcapng_nano, ebuf);
+	else
+		dump_info->ngsf = pcapng_savefile_open(
+		    dump_info->CurrentFileName, pcapng_nano, ebuf);
+	if (dump_info->ngsf == NULL)
+		error("%s: %s", dump_info->CurrentFileName, ebuf);
+	for (i = 0; i < pcapng_ninterfaces(); i++) {
+		pc = pcapng_interface(i, &name);
+		if (pcapng_savefile_add_interface(dump_info->ngsf, name,
+		    pcap_datalink(pc), pcap_snapshot(pc)) == -1)
+			error("unable to write to %s: %s",
+			    dump_info->CurrentFileName, pcap_strerror(errno));
+	}
+}
+
+/*
+ * Write the capture statistics of each interface, as of now, to a
+ * --pcapng savefile that's being closed, so the savefile records how
+ * many packets were dropped while it was written.
+ */
+static void
+pcapng_write_stats(struct dump_info *dump_info, struct pcapng_savefile *ngsf)
+{
+	struct pcap_stat stats;
+	struct timeval start, end;
+	const char *name;
+	pcap_t *pc;
+	u_int i;
+
+	start = pcapng_start;
+	(void)gettimeofday(&end, NULL);
+	if (pcapng_nano) {
+		start.tv_usec *= 1000;
+		end.tv_usec *= 1000;
+	}
+	for (i = 0; i < pcapng_ninterfaces(); i++) {
+		pc = pcapng_interface(i, &name);
+		if (pcap_stats(pc, &stats) < 0)
+			continue;
+		if (pcapng_savefile_stats(ngsf, i, &start, &end, &stats) == -1)
+			error("unable to write to %s: %s",
+			    dump_info->CurrentFileName, pcap_strerror(errno));
+	}
+}
+
+/*
+ * Open dump_info->CurrentFileName as the new savefile.
+ */
+static void
+open_next_savefile(struct dump_info *dump_info)
+{
+	FILE *fp;
+#ifdef HAVE_CAPSICUM
+	int fd;
+#endif
+
+#ifdef HAVE_LIBCAP_NG
+	capng_update(CAPNG_ADD, CAPNG_EFFECTIVE, CAP_DAC_OVERRIDE);
+	capng_apply(CAPNG_SELECT_BOTH);
+#endif /* HAVE_LIBCAP_NG */
+#ifdef HAVE_CAPSICUM
+	fd = openat(dump_info->dirfd, dump_info->CurrentFileName,
+	    O_CREAT | (mmap_flag ? O_RDWR : O_WRONLY) | O_TRUNC, 0644);
+	if (fd < 0) {
+		error("unable to open file %s",
+		    dump_info->CurrentFileName);
+	}
+	if (mmap_flag)
+		dump_info->msf = open_mmap_savefile(dump_info->pd, fd,
+		    dump_info->CurrentFileName);
+	else {
+#ifdef GZIP_SAVEFILE_SUPPORTED
+		if (gzip_level != 0)
+			fp = open_gzip_savefile(dump_info, fd);
+		else
+#endif
+		fp = fdopen(fd, "w");
+		if (fp == NULL) {
+			error("unable to fdopen file %s",
+			    dump_info->CurrentFileName);
+		}
+		if (pcapng_flag)
+			open_pcapng_savefile(dump_info, fp);
+		else
+			dump_info->pdd = pcap_dump_fopen(dump_info->pd, fp);
+	}
+#else	/* !HAVE_CAPSICUM */
+	fp = NULL;
+#ifdef GZIP_SAVEFILE_SUPPORTED
+	if (gzip_level != 0)
+		fp = open_gzip_savefile(dump_info,
+		    open(dump_info->CurrentFileName, O_CREAT | O_WRONLY | O_TRUNC,
+		    0644));
+#endif
+#ifdef URING_SAVEFILE_SUPPORTED
+	if (uring_flag != 0)
+		fp = open_uring_savefile(dump_info);
+#endif
+#ifndef _WIN32
+	if (recycle_flag)
+		fp = open_recycled_savefile(dump_info);
+#endif
+	if (pcapng_flag)
+		open_pcapng_savefile(dump_info, fp);
+	else
+#ifndef _WIN32
+	if (mmap_flag)
+		dump_info->msf = open_mmap_savefile(dump_info->pd,
+		    open(dump_info->CurrentFileName, O_CREAT | O_RDWR | O_TRUNC,
+		    0644), dump_info->CurrentFileName);
+	else
+#endif
+	if (fp != NULL)
+		dump_info->pdd = pcap_dump_fopen(dump_info->pd, fp);
+	else
+		dump_info->pdd = pcap_dump_open(dump_info->pd,
+		    dump_info->CurrentFileName);
+#endif
+	if (write_index)
+		open_savefile_index(dump_info, 1);
+	if (flow_index)
+		open_flow_index(dump_info, 1);
+#ifdef HAVE_LIBCAP_NG
+	capng_update(CAPNG_DROP, CAPNG_EFFECTIVE, CAP_DAC_OVERRIDE);
+	capng_apply(CAPNG_SELECT_BOTH);
+#endif /* HAVE_LIBCAP_NG */
+	if (mmap_flag || pcapng_flag)
+		return;
+	if (dump_info->pdd == NULL)
+		error("%s", pcap_geterr(pd));
+#ifdef HAVE_CAPSICUM
+	if (dump_info->gsf == NULL)
+		set_dumper_capsicum_rights(dump_info->pdd);
+#endif
+}
+
+/*
+ * Open the index of dump_info->CurrentFileName for --write-index, in
+ * dump_info->dirfd if at_dirfd is set.
+ */
+static void
+open_savefile_index(struct dump_info *dump_info, int at_dirfd _U_)
+{
+	char ebuf[PCAP_ERRBUF_SIZE];
+	char *name;
+	FILE *fp;
+#ifdef HAVE_CAPSICUM
+	int fd;
+#endif
+
+	name = savefile_index_name(dump_info->CurrentFileName);
+	if (name == NULL)
+		error("malloc of the index file name");
+#ifdef HAVE_CAPSICUM
+	if (at_dirfd) {
+		fd = openat(dump_info->dirfd, name,
+		    O_CREAT | O_WRONLY | O_TRUNC, 0644);
+		fp = fd < 0 ? NULL : fdopen(fd, "wb");
+	} else
+#endif
+	fp = fopen(name, "wb");
+	if (fp == NULL)
+		error("unable to open file %s: %s", name, pcap_strerror(errno));
+	dump_info->idx = savefile_index_open(fp, index_interval,
+	    index_nano, ebuf);
+	if (dump_info->idx == NULL)
+		error("%s: %s", name, ebuf);
+	free(name);
+}
+
+/*
+ * Return the offset at which the next packet will be written to the
+ * current savefile.
+ */
+static uint64_t
+savefile_offset(struct dump_info *dump_info)
+{
+#ifdef HAVE_PCAP_DUMP_FTELL64
+	int64_t off;
+#else
+	long off;
+#endif
+
+#ifndef _WIN32
+	if (dump_info->msf != NULL)
+		return (mmap_savefile_length(dump_info->msf));
+#endif
+#ifdef HAVE_PCAP_DUMP_FTELL64
+	off = pcap_dump_ftell64(dump_info->pdd);
+#else
+	off = pcap_dump_ftell(dump_info->pdd);
+#endif
+	if (off == -1)
+		error("ftell fails on output file");
+	return ((uint64_t)off);
+}
+
+/*
+ * Open the flow index of dump_info->CurrentFileName for --flow-index,
+ * in dump_info->dirfd if at_dirfd is set.  The offsets of the records
+ * are counted from where the savefile is now, after its header.
+ */
+static void
+open_flow_index(struct dump_info *dump_info, int at_dirfd _U_)
+{
+	char ebuf[PCAP_ERRBUF_SIZE];
+	char *name;
+	FILE *fp;
+#ifdef HAVE_CAPSICUM
+	int fd;
+#endif
+
+	name = flow_index_name(dump_info->CurrentFileName);
+	if (name == NULL)
+		error("malloc of the flow index file name");
+#ifdef HAVE_CAPSICUM
+	if (at_dirfd) {
+		fd = openat(dump_info->dirfd, name,
+		    O_CREAT | O_WRONLY | O_TRUNC, 0644);
+		fp = fd < 0 ? NULL : fdopen(fd, "wb");
+	} else
+#endif
+	fp = fopen(name, "wb");
+	if (fp == NULL)
+		error("unable to open file %s: %s", name, pcap_strerror(errno));
+	dump_info->fidx = flow_index_open(fp, ebuf);
+	if (dump_info->fidx == NULL)
+		error("%s: %s", name, ebuf);
+	dump_info->fidx_off = savefile_offset(dump_info);
+	free(name);
+}
+
+static void
+close_savefile(struct dump_info *dump_info)
+{
+	struct savefile_index *idx;
+	struct flow_index *fidx;
+	struct pcapng_savefile *ngsf;
+#ifdef GZIP_SAVEFILE_SUPPORTED
+	struct gzip_savefile *gsf;
+#endif
+#ifdef URING_SAVEFILE_SUPPORTED
+	struct uring_savefile *usf;
+#endif
+#ifdef STREAM_SINK_SUPPORTED
+	struct stream_sink *ssk;
+#endif
+#ifdef SHM_RING_SUPPORTED
+	struct shm_ring *srg;
+#endif
+	char ebuf[PCAP_ERRBUF_SIZE];
+#ifndef _WIN32
+	struct mmap_savefile *msf;
+	uint64_t length = 0;
+	int fd;
+#endif
+
+	idx = dump_info->idx;
+	if (idx != NULL) {
+		dump_info->idx = NULL;
+		if (savefile_index_close(idx, ebuf) == -1)
+			error("%s%s: %s", dump_info->CurrentFileName,
+			    SAVEFILE_INDEX_SUFFIX, ebuf);
+	}
+	fidx = dump_info->fidx;
+	if (fidx != NULL) {
+		dump_info->fidx = NULL;
+		if (flow_index_close(fidx, ebuf) == -1)
+			error("%s%s: %s", dump_info->CurrentFileName,
+			    FLOW_INDEX_SUFFIX, ebuf);
+	}
+#ifndef _WIN32
+	msf = dump_info->msf;
+	if (msf != NULL) {
+		/*
+		 * Clear msf first, so the exit_tcpdump() call in
+		 * error() doesn't try to close it again.
+		 */
+		dump_info->msf = NULL;
+		if (mmap_savefile_close(msf, ebuf) == -1)
+			error("%s: %s", dump_info->CurrentFileName, ebuf);
+		return;
+	}
+#endif
+	ngsf = dump_info->ngsf;
+#ifndef _WIN32
+	if (dump_info->recycle_fd != -1) {
+		/* Where the packets end; what's after it is from before. */
+		length = ngsf != NULL ? pcapng_savefile_length(ngsf) :
+		    savefile_offset(dump_info);
+	}
+#endif
+	if (ngsf != NULL) {
+		/* As above. */
+		dump_info->ngsf = NULL;
+		if (pcapng_ifname != NULL)
+			pcapng_write_stats(dump_info, ngsf);
+		if (pcapng_savefile_close(ngsf) == -1)
+			error("unable to write to %s: %s",
+			    dump_info->CurrentFileName, pcap_strerror(errno));
+	} else if (dump_info->pdd != NULL) {
+		pcap_dump_close(dump_info->pdd);
+		dump_info->pdd = NULL;
+	}
+#ifdef STREAM_SINK_SUPPORTED
+	ssk = dump_info->ssk;
+	if (ssk != NULL) {
+		struct stream_sink_stats sss;
+
+		/* Send what's left, if the collector will have it. */
+		dump_info->ssk = NULL;
+		stream_sink_stop(ssk);
+		pthread_join(stream_tid, NULL);
+		stream_sink_stats(ssk, &sss);
+		if (sss.sss_dropped != 0)
+			(void)fprintf(stderr,
+			    "%s: %" PRIu64 " packet%s not sent to %s\n",
+			    program_name, sss.sss_dropped,
+			    PLURAL_SUFFIX(sss.sss_dropped),
+			    dump_info->CurrentFileName);
+		stream_sink_free(ssk);
+	}
+#endif
+#ifdef SHM_RING_SUPPORTED
+	srg = dump_info->srg;
+	if (srg != NULL) {
+		struct shm_ring_stats srs;
+
+		dump_info->srg = NULL;
+		shm_ring_stats(srg, &srs);
+		if (srs.srs_dropped != 0)
+			(void)fprintf(stderr,
+			    "%s: %" PRIu64 " packet%s not put in %s\n",
+			    program_name, srs.srs_dropped,
+			    PLURAL_SUFFIX(srs.srs_dropped),
+			    dump_info->CurrentFileName);
+		shm_ring_close(srg);
+	}
+#endif
+#ifndef _WIN32
+	fd = dump_info->recycle_fd;
+	if (fd != -1) {
+		dump_info->recycle_fd = -1;
+		if (ftruncate(fd, (off_t)length) == -1)
+			error("unable to truncate %s: %s",
+			    dump_info->CurrentFileName, pcap_strerror(errno));
+		close(fd);
+	}
+#endif
+#ifdef GZIP_SAVEFILE_SUPPORTED
+	/* The stream's closed by now; see whether the compressor finished. */
+	gsf = dump_info->gsf;
+	if (gsf != NULL) {
+		dump_info->gsf = NULL;
+		if (gzip_savefile_close(gsf) == -1)
+			error("unable to write to %s: %s",
+			    dump_info->CurrentFileName, pcap_strerror(errno));
+	}
+#endif
+#ifdef URING_SAVEFILE_SUPPORTED
+	/*
+	 * Likewise; its last writes, fsync and close are left in flight,
+	 * and a failure of those is reported when the next savefile is
+	 * opened, or on exit.
+	 */
+	usf = dump_info->usf;
+	if (usf != NULL) {
+		dump_info->usf = NULL;
+		if (uring_savefile_close(usf) == -1)
+			error("unable to write to %s: %s",
+			    dump_info->CurrentFileName, pcap_strerror(errno));
+	}
+#endif
+}
+
+/*
+ * Write a packet to the current savefile.
+ */
+static void
+savefile_dump(struct dump_info *dump_info, const struct pcap_pkthdr *h,
+    const u_char *sp)
+{
+	savefile_packets++;
+	savefile_bytes += h->caplen;
+	if (dump_info->idx != NULL && savefile_index_next(dump_info->idx) &&
+	    savefile_index_add(dump_info->idx, &h->ts,
+	    savefile_offset(dump_info)) == -1)
+		error("unable to write the index of %s: %s",
+		    dump_info->CurrentFileName, pcap_strerror(errno));
+	if (dump_info->fidx != NULL) {
+		if (flow_index_add(dump_info->fidx,
+		    flow_hash(flow_index_dlt, 0, h, sp), dump_info->fidx_off,
+		    SAVEFILE_RECORD_HDRLEN + h->caplen) == -1)
+			error("unable to write the flow index of %s: %s",
+			    dump_info->CurrentFileName, pcap_strerror(errno));
+		dump_info->fidx_off += SAVEFILE_RECORD_HDRLEN + h->caplen;
+	}
+#ifndef _WIN32
+	if (dump_info->msf != NULL) {
+		/*
+		 * The file has room for one full-sized packet past the
+		 * -C size, and rotate_savefile() is called before every
+		 * packet in this mode, so this shouldn't happen.
+		 */
+		if (mmap_savefile_dump(dump_info->msf, h, sp) == -1)
+			error("no room for packet in %s",
+			    dump_info->CurrentFileName);
+		return;
+	}
+#endif
+#ifdef STREAM_SINK_SUPPORTED
+	if (dump_info->ssk != NULL) {
+		stream_sink_dump(dump_info->ssk, h, sp);
+		return;
+	}
+#endif
+#ifdef SHM_RING_SUPPORTED
+	/* A packet the reader has left no room for is counted. */
+	if (dump_info->srg != NULL) {
+		(void)shm_ring_put_packet(dump_info->srg, h, sp);
+		return;
+	}
+#endif
+	if (dump_info->ngsf != NULL) {
+		if (pcapng_savefile_dump(dump_info->ngsf, pcapng_ifid, h,
+		    sp) == -1)
+			error("unable to write to %s: %s",
+			    dump_info->CurrentFileName, pcap_strerror(errno));
+		return;
+	}
+	pcap_dump((u_char *)dump_info->pdd, h, sp);
+}
+
+/*
+ * Flush the current savefile for -U.  Packets written to a
+ * --mmap-savefile savefile are visible to readers as soon as they've
+ * been copied into the mapping, so there's nothing to do for those;
+ * a --gzip-savefile savefile is flushed to the end of a deflate block,
+ * and --io-uring waits for what's been written to reach the file.
+ */
+static void
+savefile_flush(struct dump_info *dump_info _U_)
+{
+	if (dump_info->ngsf != NULL) {
+		if (pcapng_savefile_flush(dump_info->ngsf) == -1)
+			error("unable to write to %s: %s",
+			    dump_info->CurrentFileName, pcap_strerror(errno));
+	}
+#ifndef _WIN32
+	else if (dump_info->msf != NULL)
+		return;
+#endif
+#ifdef STREAM_SINK_SUPPORTED
+	/* The sender thread sends packets as soon as it gets them. */
+	else if (dump_info->ssk != NULL)
+		return;
+#endif
+#ifdef SHM_RING_SUPPORTED
+	/* The reader sees each packet as soon as it's in the ring. */
+	else if (dump_info->srg != NULL)
+		return;
+#endif
+#ifdef HAVE_PCAP_DUMP_FLUSH
+	else
+		pcap_dump_flush(dump_info->pdd);
+#endif
+#ifdef GZIP_SAVEFILE_SUPPORTED
+	/* Push it all through the compressor, too. */
+	if (dump_info->gsf != NULL &&
+	    gzip_savefile_flush(dump_info->gsf) == -1)
+		error("unable to write to %s: %s",
+		    dump_info->CurrentFileName, pcap_strerror(errno));
+#endif
+#ifdef URING_SAVEFILE_SUPPORTED
+	if (dump_info->usf != NULL &&
+	    uring_savefile_flush(dump_info->usf) == -1)
+		error("unable to write to %s: %s",
+		    dump_info->CurrentFileName, pcap_strerror(errno));
+#endif
+}
+
+/*
+ * Return 1 if the current -G interval is over.  With the savefile
+ * clock running, it's the clock that says so, without a system call.
+ */
+static int
+Gflag_elapsed(void)
+{
+	time_t t;
+
+#ifdef SAVEFILE_CLOCK_SUPPORTED
+	if (savefile_clock != NULL)
+		return (savefile_clock_rotation_due(savefile_clock));
+#endif
+	if ((t = time(NULL)) == (time_t)-1) {
+		error("rotate_savefile: can't get current_time: %s",
+		    pcap_strerror(errno));
+	}
+	return (t - Gflag_time >= Gflag);
+}
+
+#ifdef SAVEFILE_CLOCK_SUPPORTED
+/*
+ * Rotate or flush the current savefile if the savefile clock says it's
+ * time, when there may be no packets coming in to have that done.
+ */
+static void
+savefile_clock_check(struct dump_info *dump_info)
+{
+	if (Gflag != 0)
+		rotate_savefile(dump_info);
+	if (flush_interval != 0 && savefile_clock_flush_due(savefile_clock))
+		savefile_flush(dump_info);
+}
+#endif
+
+/*
+ * Close the current savefile and open a new one if -G or -C says it's
+ * time to do so.
+ */
+static void
+rotate_savefile(struct dump_info *dump_info)
+{
+	/*
+	 * XXX - this won't force the file to rotate on the specified time
+	 * boundary, but it will rotate on the first packet received after the
+	 * specified Gflag number of seconds. Note: if a Gflag time boundary
+	 * and a Cflag size boundary coincide, the time rotation will occur
+	 * first thereby cancelling the Cflag boundary (since the file should
+	 * be 0).
+	 *
+	 * A rotation asked for with --control-socket is done now, as
+	 * if the interval or the size had been reached.
+	 */
+	sig_atomic_t requests = rotate_requests;
+	int forced = requests != rotate_requests_seen;
+
+	rotate_requests_seen = requests;
+	if (Gflag != 0) {
+		/* Check if it is time to rotate */
+		time_t t;
+
+		/* If the time is greater than the specified window, rotate */
+		if (Gflag_elapsed() || forced) {
+			forced = 0;
+			/* Get the current time */
+			if ((t = time(NULL)) == (time_t)-1) {
+				error("rotate_savefile: can't get current_time: %s",
+				    pcap_strerror(errno));
+			}
+			/* Update the Gflag_time */
+			Gflag_time = t;
+			/* Update Gflag_count */
+			Gflag_count++;
+			/*
+			 * Close the current file and open a new one.
+			 */
+			close_savefile(dump_info);
+
+			/*
+			 * Compress the file we just closed, if the user asked for it
+			 */
+			if (zflag != NULL)
+				compress_savefile(dump_info->CurrentFileName);
+
+			/*
+			 * Check to see if we've exceeded the Wflag (when
+			 * not using Cflag).
+			 */
+			if (Cflag == 0 && Wflag > 0 && Gflag_count >= Wflag) {
+				(void)fprintf(stderr, "Maximum file limit reached: %d\n",
+				    Wflag);
+				info(1);
+				exit_tcpdump(S_SUCCESS);
+				/* NOTREACHED */
+			}
+			if (dump_info->CurrentFileName != NULL)
+				free(dump_info->CurrentFileName);
+			/* Allocate space for max filename + \0. */
+			dump_info->CurrentFileName = (char *)malloc(PATH_MAX + 1);
+			if (dump_info->CurrentFileName == NULL)
+				error("rotate_savefile: malloc");
+			/*
+			 * Gflag was set otherwise we wouldn't be here. Reset the count
+			 * so multiple files would end with 1,2,3 in the filename.
+			 * The counting is handled with the -C flow after this.
+			 */
+			Cflag_count = 0;
+
+			/*
+			 * This is always the first file in the Cflag
+			 * rotation: e.g. 0
+			 * We also don't need numbering if Cflag is not set.
+			 */
+			if (Cflag != 0)
+				MakeFilename(dump_info->CurrentFileName, dump_info->WFileName, 0,
+				    WflagChars);
+			else
+				MakeFilename(dump_info->CurrentFileName, dump_info->WFileName, 0, 0);
+			StripeFilename(dump_info->CurrentFileName);
+
+			open_next_savefile(dump_info);
+			savefile_rotations++;
+		}
+	}
+
+	/*
+	 * XXX - this won't prevent capture files from getting
+	 * larger than Cflag - the last packet written to the
+	 * file could put it over Cflag.
+	 */
+	if (Cflag != 0) {
+#ifdef HAVE_PCAP_DUMP_FTELL64
+		int64_t size;
+#else
+		/*
+		 * XXX - this only handles a Cflag value > 2^31-1 on
+		 * LP64 platforms; to handle ILP32 (32-bit UN*X and
+		 * Windows) or LLP64 (64-bit Windows) would require
+		 * a version of libpcap with pcap_dump_ftell64().
+		 */
+		long size;
+#endif
+
+#ifndef _WIN32
+		if (dump_info->msf != NULL)
+			size = mmap_savefile_length(dump_info->msf);
+		else
+#endif
+		if (dump_info->ngsf != NULL)
+			size = pcapng_savefile_length(dump_info->ngsf);
+		else
+#ifdef HAVE_PCAP_DUMP_FTELL64
+		size = pcap_dump_ftell64(dump_info->pdd);
+#else
+		size = pcap_dump_ftell(dump_info->pdd);
+#endif
+
+		if (size == -1)
+			error("ftell fails on output file");
+		if (size > Cflag || forced) {
+			/*
+			 * Close the current file and open a new one.
+			 */
+			close_savefile(dump_info);
+
+			/*
+			 * Compress the file we just closed, if the user
+			 * asked for it.
+			 */
+			if (zflag != NULL)
+				compress_savefile(dump_info->CurrentFileName);
+
+			Cflag_count++;
+			if (Wflag > 0) {
+				if (Cflag_count >= Wflag)
+					Cflag_count = 0;
+			}
+			if (dump_info->CurrentFileName != NULL)
+				free(dump_info->CurrentFileName);
+			dump_info->CurrentFileName = (char *)malloc(PATH_MAX + 1);
+			if (dump_info->CurrentFileName == NULL)
+				error("rotate_savefile: malloc");
+			MakeFilename(dump_info->CurrentFileName, dump_info->WFileName, Cflag_count, WflagChars);
+			StripeFilename(dump_info->CurrentFileName);
+			open_next_savefile(dump_info);
+			savefile_rotations++;
+		}
+	}
+}
+
+/*
+ * If --hw-time-stamp was given and the Ethernet frame "sp" has a
+ * hardware time stamp, put it in "*ts", in the precision of the capture
+ * time stamps, and return 1; otherwise return 0.
+ */
+static int
+hw_tstamp_get(const struct pcap_pkthdr *h, const u_char *sp,
+    struct timeval *ts)
+{
+	time_t secs;
+	uint32_t nsecs;
+
+	if (hw_tstamp == 0 ||
+	    !arista_hw_tstamp(sp, h->caplen, h->len,
+	    hw_tstamp == HW_TSTAMP_METAMAKO, h->ts.tv_sec, &secs, &nsecs))
+		return (0);
+	ts->tv_sec = secs;
+	ts->tv_usec = hw_tstamp_nano ? nsecs : nsecs / 1000;
+	return (1);
+}
+
+/*
+ * Return the header of the packet "sp", about to be printed by "ndo",
+ * with the packet's hardware time stamp, if it's an Ethernet frame with
+ * one, in place of the capture time stamp; that header goes in "*hw".
+ * The time stamp is then the one printed, the one -ttt and -ttttt count
+ * from, and the one --merge-by-time merges by.
+ */
+static const struct pcap_pkthdr *
+hw_tstamp_header(const netdissect_options *ndo, const struct pcap_pkthdr *h,
+    const u_char *sp, struct pcap_pkthdr *hw)
+{
+	if (hw_tstamp == 0 || ndo->ndo_void_printer ||
+	    ndo->ndo_if_printer.uint_printer != ether_if_print)
+		return (h);
+	*hw = *h;
+	if (!hw_tstamp_get(h, sp, &hw->ts))
+		return (h);
+	return (hw);
+}
+
+#ifndef _WIN32
+/*
+ * Called by mmap_reader_loop() with the packet after the one it's about
+ * to hand over.
+ */
+static void
+prefetch_next(u_char *user, const u_char *sp, u_int caplen)
+{
+	prefetch_packet((netdissect_options *)user, sp, caplen);
+}
+#endif
+
+/*
+ * Print a packet, or hand it to the dissection threads or the print
+ * thread.
+ */
+static void
+dissect_packet(netdissect_options *ndo, const struct pcap_pkthdr *h,
+    const u_char *sp)
+{
+	struct pcap_pkthdr hw;
+
+	if (degrade && !degrade_steps[degrade_level].print) {
+		degrade_unprinted++;
+		return;
+	}
+	h = hw_tstamp_header(ndo, h, sp, &hw);
+#ifdef DISSECT_THREADS_SUPPORTED
+	if (pl_workers != NULL) {
+		pipeline_enqueue(h, sp);
+		return;
+	}
+#endif
+#ifdef PRINT_THREAD_SUPPORTED
+	if (print_ring != NULL) {
+		if ((print_lossy ?
+		    packet_ring_try_put(print_ring, h, sp, packets_captured) :
+		    packet_ring_put(print_ring, h, sp, packets_captured)) == -1)
+			error("packet too large (%u bytes) for the print thread ring",
+			    h->caplen);
+		return;
+	}
+#endif
+	print_dissected(ndo, h, sp, packets_captured);
+}
+
+/*
+ * Print a packet, on whichever thread is doing the printing.
+ */
+static void
+print_dissected(netdissect_options *ndo, const struct pcap_pkthdr *h,
+    const u_char *sp, u_int packet_number)
+{
+	if (degrade)
+		degrade_apply(ndo, &degrade_seen);
+#ifdef ESPSECRET_RELOAD
+	check_espsecret(ndo, &espsecret_seen);
+#endif
+	if (latency_interval != 0 && latency_ndo != NULL &&
+	    h->ts.tv_sec >= latency_next) {
+		/* Report on the interval just ended, by packet time. */
+		if (latency_next != 0) {
+			print_latency_report(latency_next);
+			latency_reset();
+#ifdef ENABLE_SMB
+			smb2_share_reset();
+#endif
+#ifdef DLT_USB_LINUX
+			usb_endpoint_reset();
+#endif
+		}
+		latency_next = h->ts.tv_sec - h->ts.tv_sec % latency_interval +
+		    latency_interval;
+	}
+	if (ptp_interval != 0 && ptp_ndo != NULL && h->ts.tv_sec >= ptp_next) {
+		/* Report up to the interval just ended, by packet time. */
+		if (ptp_next != 0)
+			ptp_stats_report(ptp_ndo, ptp_next);
+		ptp_next = h->ts.tv_sec - h->ts.tv_sec % ptp_interval +
+		    ptp_interval;
+	}
+	if (rtp_interval != 0 && rtp_ndo != NULL && h->ts.tv_sec >= rtp_next) {
+		/* Report on the interval just ended, by packet time. */
+		if (rtp_next != 0)
+			print_rtp_report(rtp_next);
+		rtp_next = h->ts.tv_sec - h->ts.tv_sec % rtp_interval +
+		    rtp_interval;
+	}
+	if (v2x_interval != 0 && v2x_ndo != NULL && h->ts.tv_sec >= v2x_next) {
+		/* Report on the interval just ended, by packet time. */
+		if (v2x_next != 0)
+			print_v2x_report(v2x_next);
+		v2x_next = h->ts.tv_sec - h->ts.tv_sec % v2x_interval +
+		    v2x_interval;
+	}
+	pretty_print_packet(ndo, h, sp, packet_number);
+	/* With -l, a program reading a pipe gets each packet's records. */
+	if (lflag && ndo->ndo_tap_file != NULL)
+		(void)fflush(ndo->ndo_tap_file);
+}
+
+static void
+dump_packet_and_trunc(u_char *user, const struct pcap_pkthdr *h, const u_char *sp)
+{
+	struct dump_info *dump_info;
+	const struct pcap_pkthdr *hd;
+	struct pcap_pkthdr ht;
+	const u_char *spd;
+
+	++packets_captured;
+
+	++infodelay;
+
+	dump_info = (struct dump_info *)user;
+
+	/*
+	 * What's written may be cut shorter than what's printed, and
+	 * anonymized.
+	 */
+	hd = h;
+	if (flow_trunc.table != NULL)
+		hd = flow_trunc_header(h, sp, &ht);
+	spd = sp;
+	if (anon != NULL)
+		spd = anon_data(hd, sp);
+	if (split != NULL && split_dump(h, sp, hd, spd)) {
+		/* Written to the savefile of its VNI or VLAN. */
+	} else
+#ifdef HAVE_PTHREADS
+	if (writer_thread)
+		writer_enqueue(hd, spd);
+	else
+#endif
+	{
+		/*
+		 * When processing packets in batches, check whether
+		 * to rotate only once per batch, before its first
+		 * packet.
+		 */
+		if (batch_size == 0 || batch_packets == 0 || mmap_flag)
+			rotate_savefile(dump_info);
+		batch_packets++;
+
+		savefile_dump(dump_info, hd, spd);
+#ifdef HAVE_PCAP_DUMP_FLUSH
+		if (Uflag && batch_size == 0 && flush_interval == 0)
+			savefile_flush(dump_info);
+#endif
+#ifdef SAVEFILE_CLOCK_SUPPORTED
+		if (flush_interval != 0 &&
+		    savefile_clock_flush_due(savefile_clock))
+			savefile_flush(dump_info);
+#endif
+	}
+
+	if (dump_info->ndo != NULL)
+		dissect_packet(dump_info->ndo, h, sp);
+#ifndef _WIN32
+	if (startup_time)
+		report_startup_time();
+#endif
+
+	--infodelay;
+	if (infoprint)
+		info(0);
+}
+
+static void
+dump_packet(u_char *user, const struct pcap_pkthdr *h, const u_char *sp)
+{
+	struct dump_info *dump_info;
+	const struct pcap_pkthdr *hd;
+	struct pcap_pkthdr ht;
+	const u_char *spd;
+
+	++packets_captured;
+
+	++infodelay;
+
+	dump_info = (struct dump_info *)user;
+
+	/*
+	 * What's written may be cut shorter than what's printed, and
+	 * anonymized.
+	 */
+	hd = h;
+	if (flow_trunc.table != NULL)
+		hd = flow_trunc_header(h, sp, &ht);
+	spd = sp;
+	if (anon != NULL)
+		spd = anon_data(hd, sp);
+	if (split != NULL && split_dump(h, sp, hd, spd)) {
+		/* Written to the savefile of its VNI or VLAN. */
+	} else
+#ifdef HAVE_PTHREADS
+	if (writer_thread)
+		writer_enqueue(hd, spd);
+	else
+#endif
+	{
+		savefile_dump(dump_info, hd, spd);
+#ifdef HAVE_PCAP_DUMP_FLUSH
+		if (Uflag && batch_size == 0 && flush_interval == 0)
+			savefile_flush(dump_info);
+#endif
+#ifdef SAVEFILE_CLOCK_SUPPORTED
+		if (flush_interval != 0 &&
+		    savefile_clock_flush_due(savefile_clock))
+			savefile_flush(dump_info);
+#endif
+	}
+
+	if (dump_info->ndo != NULL)
+		dissect_packet(dump_info->ndo, h, sp);
+#ifndef _WIN32
+	if (startup_time)
+		report_startup_time();
+#endif
+
+	--infodelay;
+	if (infoprint)
+		info(0);
+}
+
+#ifndef _WIN32
+static double
+startup_ms(const struct timeval *from, const struct timeval *to)
+{
+	return ((double)(to->tv_sec - from->tv_sec) * 1000.0 +
+	    (double)(to->tv_usec - from->tv_usec) / 1000.0);
+}
+
+/*
+ * With --startup-profile, note that "what" has just been done, for
+ * report_startup_time().
+ */
+static void
+startup_phase(const char *what)
+{
+	struct startup_phase *sp;
+
+	if (!startup_profile || nstartup_phases == STARTUP_PHASES)
+		return;
+	sp = &startup_phases[nstartup_phases++];
+	sp->what = what;
+	(void)gettimeofday(&sp->tv, NULL);
+}
+
+/*
+ * Report how long it took from entering main() to having handled the
+ * first packet, which includes any tables built on first use, and,
+ * with --startup-profile, how long each part of that took.
+ */
+static void
+report_startup_time(void)
+{
+	const struct timeval *prev;
+	struct timeval now;
+	u_int i;
+
+	startup_time = 0;
+	(void)gettimeofday(&now, NULL);
+	(void)fprintf(stderr, "%s: first packet handled %.3f ms after start-up\n",
+	    program_name, startup_ms(&startup_tv, &now));
+	if (!startup_profile)
+		return;
+	prev = &startup_tv;
+	for (i = 0; i < nstartup_phases; i++) {
+		(void)fprintf(stderr, "%10.3f ms  %s\n",
+		    startup_ms(prev, &startup_phases[i].tv),
+		    startup_phases[i].what);
+		prev = &startup_phases[i].tv;
+	}
+	(void)fprintf(stderr, "%10.3f ms  %s\n", startup_ms(prev, &now),
+	    "waiting for and handling the first packet");
+}
+#endif
+
+static void
+print_packet(u_char *user, const struct pcap_pkthdr *h, const u_char *sp)
+{
+	++packets_captured;
+
+	++infodelay;
+
+	if (!count_mode)
+		dissect_packet((netdissect_options *)user, h, sp);
+#ifndef _WIN32
+	if (startup_time)
+		report_startup_time();
+#endif
+
+	--infodelay;
+	if (infoprint)
+		info(0);
+}
+
+/*
+ * Parse a --sample or --flow-sample rate, "1/N" or "N".
+ */
+static u_int
+parse_sample_rate(const char *arg, const char *option)
+{
+	const char *p = arg;
+	char *end;
+	u_long n;
+
+	if (strncmp(p, "1/", 2) == 0)
+		p += 2;
+	errno = 0;
+	n = strtoul(p, &end, 10);
+	if (end == p || *end != '\0' || errno != 0 || n == 0 || n > UINT_MAX)
+		error("invalid %s rate %s", option, arg);
+	return ((u_int)n);
+}
+
+static void
+sample_packet(u_char *user, const struct pcap_pkthdr *h, const u_char *sp)
+{
+	struct sample_info *s = (struct sample_info *)user;
+	uint32_t hash = 0;
+	int keep;
+
+	if (sample_flows)
+		hash = flow_hash(s->dlt, s->frag_whole, h, sp);
+	if (hash != 0) {
+		/*
+		 * The high-order bits, as --dissect-threads picks the
+		 * worker with the low-order ones.
+		 */
+		keep = ((hash >> 16 | hash << 16) % sample_rate) == 0;
+	} else
+		keep = (s->packet++ % sample_rate) == 0;
+	if (keep) {
+		s->kept++;
+		s->kept_bytes += h->len;
+		(*s->callback)(s->user, h, sp);
+	} else {
+		s->skipped++;
+		s->skipped_bytes += h->len;
+		packets_captured++;
+	}
+}
+
+/*
+ * Report what --sample or --flow-sample kept and skipped.
+ */
+static void
+print_sample_stats(void)
+{
+	if (sample_rate <= 1)
+		return;
+	(void)fprintf(stderr,
+	    "%s 1 in %u: %" PRIu64 " packet%s (%" PRIu64 " bytes) kept, %" PRIu64 " packet%s (%" PRIu64 " bytes) skipped\n",
+	    sample_flows ? "flow-sampled" : "sampled", sample_rate,
+	    sample.kept, PLURAL_SUFFIX(sample.kept), sample.kept_bytes,
+	    sample.skipped, PLURAL_SUFFIX(sample.skipped),
+	    sample.skipped_bytes);
+}
+
+static void
+hosts_packet(u_char *user, const struct pcap_pkthdr *h, const u_char *sp)
+{
+	struct hosts_info *hi = (struct hosts_info *)user;
+	const u_char *p, *ep = sp + h->caplen;
+	u_int type, version;
+	int keep = 0;
+
+	if ((p = link_payload(hi->dlt, h, sp, &type)) != NULL &&
+	    (type == 0 || type == ETHERTYPE_IP || type == ETHERTYPE_IPV6) &&
+	    ep - p >= 1) {
+		version = *p >> 4;
+		if (version == 4 && ep - p >= 20)
+			keep = host_set_match(hi->set, p + 12, 4) ||
+			    host_set_match(hi->set, p + 16, 4);
+		else if (version == 6 && ep - p >= 40)
+			keep = host_set_match(hi->set, p + 8, 16) ||
+			    host_set_match(hi->set, p + 24, 16);
+	}
+	if (keep) {
+		hi->kept++;
+		hi->kept_bytes += h->len;
+		(*hi->callback)(hi->user, h, sp);
+	} else {
+		hi->skipped++;
+		hi->skipped_bytes += h->len;
+		packets_captured++;
+	}
+}
+
+/*
+ * Report what --hosts-file kept and skipped.
+ */
+static void
+print_hosts_stats(void)
+{
+	if (hosts.set == NULL)
+		return;
+	(void)fprintf(stderr,
+	    "hosts-file %u address%s, %u prefix%s: %" PRIu64 " packet%s (%" PRIu64 " bytes) kept, %" PRIu64 " packet%s (%" PRIu64 " bytes) skipped\n",
+	    host_set_addresses(hosts.set),
+	    host_set_addresses(hosts.set) != 1 ? "es" : "",
+	    host_set_prefixes(hosts.set),
+	    host_set_prefixes(hosts.set) != 1 ? "es" : "",
+	    hosts.kept, PLURAL_SUFFIX(hosts.kept), hosts.kept_bytes,
+	    hosts.skipped, PLURAL_SUFFIX(hosts.skipped),
+	    hosts.skipped_bytes);
+}
+
+static void
+payload_packet(u_char *user, const struct pcap_pkthdr *h, const u_char *sp)
+{
+	struct payload_info *pi = (struct payload_info *)user;
+	const u_char *p;
+	u_int off, type;
+	int syn;
+
+	if ((off = flow_trunc_len(pi->dlt, h, sp, &syn)) == 0 &&
+	    (p = link_payload(pi->dlt, h, sp, &type)) != NULL)
+		off = (u_int)(p - sp);
+	if (off < h->caplen &&
+	    payload_match(pi->matcher, sp + off, h->caplen - off)) {
+		pi->kept++;
+		pi->kept_bytes += h->len;
+		(*pi->callback)(pi->user, h, sp);
+	} else {
+		pi->skipped++;
+		pi->skipped_bytes += h->len;
+		packets_captured++;
+	}
+}
+
+/*
+ * Report what --payload-match kept and skipped.
+ */
+static void
+print_payload_stats(void)
+{
+	if (payload.matcher == NULL)
+		return;
+	(void)fprintf(stderr,
+	    "payload-match %u pattern%s: %" PRIu64 " packet%s (%" PRIu64 " bytes) kept, %" PRIu64 " packet%s (%" PRIu64 " bytes) skipped\n",
+	    payload_match_patterns(payload.matcher),
+	    PLURAL_SUFFIX(payload_match_patterns(payload.matcher)),
+	    payload.kept, PLURAL_SUFFIX(payload.kept), payload.kept_bytes,
+	    payload.skipped, PLURAL_SUFFIX(payload.skipped),
+	    payload.skipped_bytes);
+}
+
+/*
+ * Parse the --memo argument, "entries", "mode" or "entries,mode", where
+ * the mode is "compact" or "verify", if there is one.
+ */
+static void
+parse_memo(const char *arg)
+{
+	const char *mode;
+	char *end;
+	u_long n;
+
+	memo_entries = ND_MEMO_DEFAULT_ENTRIES;
+	memo_mode = ND_MEMO_COPY;
+	if (arg == NULL)
+		return;
+	mode = arg;
+	if (*arg >= '0' && *arg <= '9') {
+		errno = 0;
+		n = strtoul(arg, &end, 10);
+		if (errno != 0 || n == 0 || n > (1U << 24))
+			error("invalid memo size %s", arg);
+		memo_entries = (u_int)n;
+		if (*end == '\0')
+			return;
+		if (*end != ',')
+			error("invalid memo size %s", arg);
+		mode = end + 1;
+	}
+	if (strcmp(mode, "compact") == 0)
+		memo_mode = ND_MEMO_COMPACT;
+	else if (strcmp(mode, "verify") == 0)
+		memo_mode = ND_MEMO_VERIFY;
+	else
+		error("invalid memo mode %s", mode);
+}
+
+/*
+ * Parse the --memo-ignore argument, a comma-separated list of
+ * "offset" or "offset:length", in bytes from the start of the packet.
+ */
+static void
+parse_memo_ignore(const char *arg)
+{
+	const char *p;
+	char *end;
+	u_long off, len;
+
+	for (p = arg;; p = end + 1) {
+		if (memo_nignore == ND_MEMO_MAX_IGNORE)
+			error("more than %u --memo-ignore ranges",
+			    ND_MEMO_MAX_IGNORE);
+		errno = 0;
+		off = strtoul(p, &end, 10);
+		if (end == p || errno != 0 || off >= ND_MEMO_MAX_CAPLEN)
+			error("invalid memo-ignore offset in %s", arg);
+		len = 1;
+		if (*end == ':') {
+			p = end + 1;
+			len = strtoul(p, &end, 10);
+			if (end == p || errno != 0 || len == 0 ||
+			    len > ND_MEMO_MAX_CAPLEN)
+				error("invalid memo-ignore length in %s", arg);
+		}
+		memo_ignore[memo_nignore].nmi_offset = (u_int)off;
+		memo_ignore[memo_nignore].nmi_len = (u_int)len;
+		memo_nignore++;
+		if (*end == '\0')
+			break;
+		if (*end != ',')
+			error("invalid memo-ignore range in %s", arg);
+	}
+}
+
+static void
+memo_add(struct nd_memo_stats *t, const struct nd_memo_stats *nms)
+{
+	t->nms_hits += nms->nms_hits;
+	t->nms_misses += nms->nms_misses;
+	t->nms_skipped += nms->nms_skipped;
+	t->nms_evicted += nms->nms_evicted;
+	t->nms_mismatches += nms->nms_mismatches;
+}
+
+/*
+ * Add a thread's memo counts to memo_done, and free its memo.
+ */
+static void
+memo_release(netdissect_options *wndo)
+{
+	struct nd_memo_stats nms;
+
+	if (wndo->ndo_memo == NULL)
+		return;
+	nd_memo_stats(wndo->ndo_memo, &nms);
+	memo_add(&memo_done, &nms);
+	nd_memo_free(wndo->ndo_memo);
+	wndo->ndo_memo = NULL;
+}
+
+/*
+ * Report what --memo printed from memory, for all the threads.
+ */
+static void
+print_memo_stats(void)
+{
+	struct nd_memo_stats t, nms;
+#ifdef DISSECT_THREADS_SUPPORTED
+	int i;
+#endif
+
+	if (memo_ndo == NULL)
+		return;
+	t = memo_done;
+	nd_memo_stats(memo_ndo->ndo_memo, &nms);
+	memo_add(&t, &nms);
+#ifdef DISSECT_THREADS_SUPPORTED
+	for (i = 0; pl_workers != NULL && i < dissect_threads; i++) {
+		nd_memo_stats(pl_workers[i].ndo.ndo_memo, &nms);
+		memo_add(&t, &nms);
+	}
+#endif
+	(void)fprintf(stderr,
+	    "memo: %" PRIu64 " hit%s, %" PRIu64 " remembered, %" PRIu64 " not remembered, %" PRIu64 " evicted",
+	    t.nms_hits, PLURAL_SUFFIX(t.nms_hits), t.nms_misses,
+	    t.nms_skipped, t.nms_evicted);
+	if (memo_mode == ND_MEMO_VERIFY)
+		(void)fprintf(stderr, ", %" PRIu64 " mismatch%s",
+		    t.nms_mismatches, t.nms_mismatches == 1 ? "" : "es");
+	(void)fputc('\n', stderr);
+}
+
+/*
+ * Parse the --dedup argument, "microseconds" or "microseconds,ttl", if
+ * there is one.
+ */
+static void
+parse_dedup(const char *arg)
+{
+	char *end;
+	u_long n;
+
+	dedup_window = DEDUP_DEFAULT_WINDOW;
+	dedup_ip = 0;
+	if (arg == NULL)
+		return;
+	errno = 0;
+	n = strtoul(arg, &end, 10);
+	if (end == arg || errno != 0 || n == 0 || n > UINT_MAX)
+		error("invalid dedup window %s", arg);
+	if (strcmp(end, ",ttl") == 0)
+		dedup_ip = 1;
+	else if (*end != '\0')
+		error("invalid dedup mode %s", arg);
+	dedup_window = (u_int)n;
+}
+
+/*
+ * Parse the --flow-truncate argument, "packets" or "packets,bytes".
+ */
+static void
+parse_flow_trunc(const char *arg)
+{
+	char *end;
+	u_long n;
+
+	errno = 0;
+	n = strtoul(arg, &end, 10);
+	if (end == arg || errno != 0 || n == 0 || n > UINT_MAX)
+		error("invalid flow truncation packet count %s", arg);
+	flow_trunc_packets = (u_int)n;
+	flow_trunc_bytes = 0;
+	if (*end == ',') {
+		arg = end + 1;
+		errno = 0;
+		flow_trunc_bytes = strtoull(arg, &end, 10);
+		if (end == arg || errno != 0 || flow_trunc_bytes == 0)
+			error("invalid flow truncation byte count %s", arg);
+	}
+	if (*end != '\0')
+		error("invalid flow truncation limit %s", end);
+}
+
+/*
+ * How much of the packet to keep when only its headers are written:
+ * up to the end of its TCP, UDP, SCTP, ICMP or ICMPv6 header, or of
+ * its IP header for other protocols and later fragments.  Returns 0
+ * if it's not IP.  Sets *synp if it's a TCP SYN without an ACK.
+ */
+static u_int
+flow_trunc_len(int dlt, const struct pcap_pkthdr *h, const u_char *sp,
+    int *synp)
+{
+	const u_char *p, *ep = sp + h->caplen, *l4;
+	u_int type, proto;
+
+	*synp = 0;
+	if ((p = link_payload(dlt, h, sp, &type)) == NULL ||
+	    (type != 0 && type != ETHERTYPE_IP && type != ETHERTYPE_IPV6) ||
+	    ep - p < 1)
+		return (0);
+	switch (*p >> 4) {
+
+	case 4:
+		if (ep - p < 20)
+			return (0);
+		proto = p[9];
+		l4 = p + (p[0] & 0x0f) * 4;
+		if ((EXTRACT_BE_U_2(p + 6) & 0x1fff) != 0)
+			return ((u_int)(l4 - sp));
+		break;
+
+	case 6:
+		if (ep - p < 40)
+			return (0);
+		proto = p[6];
+		l4 = p + 40;
+		for (;;) {
+			if (proto == IPPROTO_HOPOPTS ||
+			    proto == IPPROTO_ROUTING ||
+			    proto == IPPROTO_DSTOPTS) {
+				if (ep - l4 < 2)
+					return ((u_int)(l4 - sp));
+				proto = l4[0];
+				l4 += (l4[1] + 1) * 8;
+			} else if (proto == IPPROTO_FRAGMENT) {
+				if (ep - l4 < 8 ||
+				    (EXTRACT_BE_U_2(l4 + 2) & 0xfff8) != 0)
+					return ((u_int)(l4 + 8 - sp));
+				proto = l4[0];
+				l4 += 8;
+			} else
+				break;
+		}
+		break;
+
+	default:
+		return (0);
+	}
+
+	switch (proto) {
+
+	case IPPROTO_TCP:
+		if (ep - l4 < 14)
+			return ((u_int)(l4 + 20 - sp));
+		*synp = (l4[13] & 0x12) == 0x02;
+		return ((u_int)(l4 + (l4[12] >> 4) * 4 - sp));
+
+	case IPPROTO_SCTP:
+		return ((u_int)(l4 + 12 - sp));
+
+	case IPPROTO_UDP:
+	case IPPROTO_ICMP:
+	case IPPROTO_ICMPV6:
+		return ((u_int)(l4 + 8 - sp));
+
+	default:
+		return ((u_int)(l4 - sp));
+	}
+}
+
+/*
+ * Work out how much of the packet to write: return "h" if it's to be
+ * written whole, or "ht", filled in with a shorter captured length,
+ * if only its headers are.
+ */
+static const struct pcap_pkthdr *
+flow_trunc_header(const struct pcap_pkthdr *h, const u_char *sp,
+    struct pcap_pkthdr *ht)
+{
+	struct flow_trunc_entry *e;
+	uint32_t hash;
+	u_int len;
+	int syn;
+
+	if ((len = flow_trunc_len(flow_trunc.dlt, h, sp, &syn)) == 0 ||
+	    (hash = flow_hash(flow_trunc.dlt, 0, h, sp)) == 0) {
+		flow_trunc.whole++;
+		return (h);
+	}
+	e = &flow_trunc.table[hash & (FLOW_TRUNC_SLOTS - 1)];
+	if (e->hash != hash || syn ||
+	    h->ts.tv_sec - e->last > FLOW_TRUNC_IDLE) {
+		e->hash = hash;
+		e->packets = 0;
+		e->bytes = 0;
+	}
+	e->last = h->ts.tv_sec;
+	if (e->packets < flow_trunc_packets &&
+	    (flow_trunc_bytes == 0 || e->bytes < flow_trunc_bytes)) {
+		e->packets++;
+		e->bytes += h->len;
+		flow_trunc.whole++;
+		return (h);
+	}
+	if (len >= h->caplen) {
+		flow_trunc.whole++;
+		return (h);
+	}
+	*ht = *h;
+	ht->caplen = len;
+	flow_trunc.truncated++;
+	flow_trunc.saved_bytes += h->caplen - len;
+	return (ht);
+}
+
+/*
+ * Report what --flow-truncate wrote whole and cut short.
+ */
+static void
+print_flow_trunc_stats(void)
+{
+	if (flow_trunc.table == NULL)
+		return;
+	(void)fprintf(stderr, "flow-truncate %u packet%s",
+	    flow_trunc_packets, PLURAL_SUFFIX(flow_trunc_packets));
+	if (flow_trunc_bytes != 0)
+		(void)fprintf(stderr, ", %" PRIu64 " bytes", flow_trunc_bytes);
+	(void)fprintf(stderr,
+	    ": %" PRIu64 " packet%s written whole, %" PRIu64 " cut to %s headers (%" PRIu64 " bytes left out)\n",
+	    flow_trunc.whole, PLURAL_SUFFIX(flow_trunc.whole),
+	    flow_trunc.truncated,
+	    flow_trunc.truncated == 1 ? "its" : "their",
+	    flow_trunc.saved_bytes);
+}
+
+/*
+ * Copy the part of the packet that's to be written to anon_buf and
+ * anonymize it there.
+ */
+static const u_char *
+anon_data(const struct pcap_pkthdr *h, const u_char *sp)
+{
+	const u_char *p;
+	u_int type;
+
+	memcpy(anon_buf, sp, h->caplen);
+	anon_packets++;
+	if ((p = link_payload(anon_dlt, h, sp, &type)) == NULL) {
+		p = sp + h->caplen;	/* only the link-layer header, if any */
+		type = 0;
+	}
+	anon_packet(anon, anon_buf, h->caplen, anon_dlt == DLT_EN10MB,
+	    (u_int)(p - sp), type);
+	return (anon_buf);
+}
+
+/*
+ * Report how many packets were anonymized and how well the address
+ * mappings were memoized.
+ */
+static void
+print_anon_stats(void)
+{
+	uint64_t lookups, misses;
+
+	if (anon == NULL)
+		return;
+	anon_cache_stats(anon, &lookups, &misses);
+	(void)fprintf(stderr,
+	    "anonymized %" PRIu64 " packet%s: %" PRIu64 " address lookup%s, %" PRIu64 " mapped afresh\n",
+	    anon_packets, PLURAL_SUFFIX(anon_packets),
+	    lookups, PLURAL_SUFFIX(lookups), misses);
+}
+
+/*
+ * Parse the --flow argument, "proto,address,port,address,port", with
+ * proto tcp, udp or sctp, and work out the hash of the flow's packets
+ * by making up one.
+ */
+static void
+parse_flow_sel(const char *arg)
+{
+	char buf[128], *fields[5], *cp, *end;
+	struct pcap_pkthdr h;
+	u_char pkt[44];
+	u_long port;
+	u_int i, alen;
+
+	if (strlen(arg) >= sizeof(buf))
+		error("invalid flow %s", arg);
+	strcpy(buf, arg);
+	for (i = 0, cp = buf; i < 5; i++) {
+		fields[i] = cp;
+		if ((cp = strchr(cp, ',')) == NULL)
+			break;
+		*cp++ = '\0';
+	}
+	if (i != 4 || cp != NULL)
+		error("invalid flow %s; it must be proto,address,port,address,port",
+		    arg);
+	if (strcmp(fields[0], "tcp") == 0)
+		flow_sel.proto = IPPROTO_TCP;
+	else if (strcmp(fields[0], "udp") == 0)
+		flow_sel.proto = IPPROTO_UDP;
+	else if (strcmp(fields[0], "sctp") == 0)
+		flow_sel.proto = IPPROTO_SCTP;
+	else
+		error("invalid flow protocol %s; it must be tcp, udp or sctp",
+		    fields[0]);
+	for (i = 0; i < 2; i++) {
+		if (inet_pton(AF_INET, fields[1 + 2 * i],
+		    flow_sel.addr[i]) == 1)
+			flow_sel.version = 4;
+		else if (inet_pton(AF_INET6, fields[1 + 2 * i],
+		    flow_sel.addr[i]) == 1)
+			flow_sel.version = 6;
+		else
+			error("invalid flow address %s", fields[1 + 2 * i]);
+		if (i == 1 && flow_sel.version !=
+		    (strchr(fields[1], ':') != NULL ? 6U : 4U))
+			error("invalid flow %s; the addresses must both be IPv4 or IPv6",
+			    arg);
+		errno = 0;
+		port = strtoul(fields[2 + 2 * i], &end, 10);
+		if (end == fields[2 + 2 * i] || *end != '\0' || errno != 0 ||
+		    port > 65535)
+			error("invalid flow port %s", fields[2 + 2 * i]);
+		flow_sel.port[i] = (u_int)port;
+	}
+
+	memset(pkt, 0, sizeof(pkt));
+	if (flow_sel.version == 4) {
+		pkt[0] = 0x45;
+		pkt[9] = (u_char)flow_sel.proto;
+		memcpy(pkt + 12, flow_sel.addr[0], 4);
+		memcpy(pkt + 16, flow_sel.addr[1], 4);
+		alen = 20;
+	} else {
+		pkt[0] = 0x60;
+		pkt[6] = (u_char)flow_sel.proto;
+		memcpy(pkt + 8, flow_sel.addr[0], 16);
+		memcpy(pkt + 24, flow_sel.addr[1], 16);
+		alen = 40;
+	}
+	pkt[alen] = (u_char)(flow_sel.port[0] >> 8);
+	pkt[alen + 1] = (u_char)flow_sel.port[0];
+	pkt[alen + 2] = (u_char)(flow_sel.port[1] >> 8);
+	pkt[alen + 3] = (u_char)flow_sel.port[1];
+	memset(&h, 0, sizeof(h));
+	h.caplen = h.len = alen + 4;
+	flow_sel.hash = flow_hash(DLT_RAW, 0, &h, pkt);
+	flow_sel.set = 1;
+}
+
+/*
+ * Is the packet one of the flow, in either direction?  Fragments
+ * other than the first, which have no ports, aren't.
+ */
+static int
+flow_sel_match(int dlt, const struct pcap_pkthdr *h, const u_char *sp)
+{
+	const u_char *p, *ep = sp + h->caplen, *l4, *src, *dst;
+	u_int type, proto, alen, sport, dport;
+
+	if ((p = link_payload(dlt, h, sp, &type)) == NULL ||
+	    (type != 0 && type != ETHERTYPE_IP && type != ETHERTYPE_IPV6) ||
+	    ep - p < 1 || (*p >> 4) != flow_sel.version)
+		return (0);
+	if (flow_sel.version == 4) {
+		if (ep - p < 20 || (EXTRACT_BE_U_2(p + 6) & 0x1fff) != 0)
+			return (0);
+		proto = p[9];
+		src = p + 12;
+		dst = p + 16;
+		alen = 4;
+		l4 = p + (p[0] & 0x0f) * 4;
+	} else {
+		if (ep - p < 40)
+			return (0);
+		proto = p[6];
+		src = p + 8;
+		dst = p + 24;
+		alen = 16;
+		l4 = p + 40;
+		while (proto == IPPROTO_HOPOPTS || proto == IPPROTO_ROUTING ||
+		    proto == IPPROTO_DSTOPTS || proto == IPPROTO_FRAGMENT) {
+			if (ep - l4 < 8 || (proto == IPPROTO_FRAGMENT &&
+			    (EXTRACT_BE_U_2(l4 + 2) & 0xfff8) != 0))
+				return (0);
+			proto = l4[0];
+			l4 += proto == IPPROTO_FRAGMENT ? 8 : (l4[1] + 1) * 8;
+		}
+	}
+	if (proto != flow_sel.proto || ep - l4 < 4)
+		return (0);
+	sport = EXTRACT_BE_U_2(l4);
+	dport = EXTRACT_BE_U_2(l4 + 2);
+	return ((memcmp(src, flow_sel.addr[0], alen) == 0 &&
+		 memcmp(dst, flow_sel.addr[1], alen) == 0 &&
+		 sport == flow_sel.port[0] && dport == flow_sel.port[1]) ||
+		(memcmp(src, flow_sel.addr[1], alen) == 0 &&
+		 memcmp(dst, flow_sel.addr[0], alen) == 0 &&
+		 sport == flow_sel.port[1] && dport == flow_sel.port[0]));
+}
+
+/*
+ * Look up the flow in the flow index of the savefile fname, which pc
+ * has just been opened on, if it has one that can be used.
+ */
+static void
+flow_sel_open(pcap_t *pc _U_, const char *fname)
+{
+#ifndef _WIN32
+	char ebuf[PCAP_ERRBUF_SIZE];
+	struct pcap_pkthdr *h;
+	const u_char *data;
+	off_t here;
+
+	if (mmap_read || !savefile_index_seekable(fname))
+		return;
+	switch (flow_index_find(fname, flow_sel.hash, &flow_offsets,
+	    &flow_noffsets, &flow_index_end, ebuf)) {
+
+	case -1:
+		warning("%s; reading all of %s", ebuf, fname);
+		return;
+
+	case 0:
+		return;
+	}
+
+	/*
+	 * Check that the index is of this savefile: the first record
+	 * it lists for the flow should be one of the flow's, and what
+	 * it covers should end at a record or at the end of the file.
+	 */
+	here = ftello(pcap_file(pc));
+	if (here == -1)
+		error("%s: %s", fname, pcap_strerror(errno));
+	if ((flow_noffsets != 0 &&
+	     (fseeko(pcap_file(pc), (off_t)flow_offsets[0], SEEK_SET) != 0 ||
+	      pcap_next_ex(pc, &h, &data) != 1 ||
+	      flow_hash(pcap_datalink(pc), 0, h, data) != flow_sel.hash)) ||
+	    (flow_index_end > (uint64_t)here &&
+	     (fseeko(pcap_file(pc), (off_t)flow_index_end, SEEK_SET) != 0 ||
+	      pcap_next_ex(pc, &h, &data) == -1))) {
+		warning("%s%s isn't a flow index of %s; reading all of it",
+		    fname, FLOW_INDEX_SUFFIX, fname);
+		free(flow_offsets);
+		flow_offsets = NULL;
+		flow_noffsets = 0;
+		if (fseeko(pcap_file(pc), here, SEEK_SET) != 0)
+			error("%s: %s", fname, pcap_strerror(errno));
+		return;
+	}
+	if (flow_index_end < (uint64_t)here)
+		flow_index_end = (uint64_t)here;
+	flow_sel.indexed = 1;
+#else
+	(void)fname;
+#endif
+}
+
+static void
+flow_sel_packet(u_char *user, const struct pcap_pkthdr *h, const u_char *sp)
+{
+	struct flow_sel_info *f = (struct flow_sel_info *)user;
+
+	if (f->done)
+		return;
+	/*
+	 * The other packets aren't counted, as they aren't read at all
+	 * with a flow index, so -# numbers the flow's packets from 1.
+	 */
+	if (!flow_sel_match(f->dlt, h, sp))
+		return;
+	(*f->callback)(f->user, h, sp);
+	if (++f->npackets != f->cnt)
+		return;
+	f->done = 1;
+#ifndef _WIN32
+	if (mmap_reader != NULL)
+		mmap_reader_breakloop(mmap_reader);
+	else
+#endif
+#ifdef HAVE_PCAP_BREAKLOOP
+	pcap_breakloop(pd);
+#else
+	;
+#endif
+}
+
+#ifndef _WIN32
+/*
+ * Read the records the flow index of the savefile fname lists for the
+ * flow, then those past what it covers, applying the filter "fp", and hand them to
+ * "callback"; returns what pcap_loop() would.
+ */
+static int
+flow_sel_loop(pcap_t *pc, const char *fname, const struct bpf_program *fp,
+    pcap_handler callback, u_char *user)
+{
+	struct pcap_pkthdr *h;
+	const u_char *data;
+	size_t i;
+	int status;
+
+	for (i = 0; i < flow_noffsets && !flow_sel.done; i++) {
+		if (fseeko(pcap_file(pc), (off_t)flow_offsets[i],
+		    SEEK_SET) != 0)
+			error("%s: %s", fname, pcap_strerror(errno));
+		if ((status = pcap_next_ex(pc, &h, &data)) == -1)
+			return (-1);
+		if (status != 1)
+			error("%s%s lists records past the end of %s",
+			    fname, FLOW_INDEX_SUFFIX, fname);
+		if (fp->bf_insns == NULL || pcap_offline_filter(fp, h, data))
+			(*callback)(user, h, data);
+	}
+	if (flow_sel.done)
+		return (0);
+	if (fseeko(pcap_file(pc), (off_t)flow_index_end, SEEK_SET) != 0)
+		error("%s: %s", fname, pcap_strerror(errno));
+	while (!flow_sel.done &&
+	    (status = pcap_next_ex(pc, &h, &data)) == 1) {
+		if (fp->bf_insns == NULL || pcap_offline_filter(fp, h, data))
+			(*callback)(user, h, data);
+	}
+	if (flow_sel.done || status == -2)
+		return (0);
+	return (status);
+}
+#endif
+
+static void
+dedup_packet(u_char *user, const struct pcap_pkthdr *h, const u_char *sp)
+{
+	struct dedup_info *d = (struct dedup_info *)user;
+	const u_char *ip = NULL;
+	uint64_t now;
+	u_int type;
+
+	now = (uint64_t)ND_TS_USEC(ND_TS_FROM_TIMEVAL(&h->ts, d->nano));
+	if (dedup_ip && (ip = link_payload(d->dlt, h, sp, &type)) != NULL &&
+	    type != 0 && type != ETHERTYPE_IP && type != ETHERTYPE_IPV6)
+		ip = NULL;
+	if (dedup_seen(d->table, now, sp, h->caplen, h->len, ip)) {
+		d->dups++;
+		d->dup_bytes += h->len;
+		packets_captured++;
+		return;
+	}
+	d->kept++;
+	d->kept_bytes += h->len;
+	(*d->callback)(d->user, h, sp);
+}
+
+/*
+ * Report what --dedup kept and dropped.
+ */
+static void
+print_dedup_stats(void)
+{
+	if (dedup.table == NULL)
+		return;
+	(void)fprintf(stderr,
+	    "dedup within %uus: %" PRIu64 " packet%s (%" PRIu64 " bytes) kept, %" PRIu64 " duplicate%s (%" PRIu64 " bytes) dropped\n",
+	    dedup_window, dedup.kept, PLURAL_SUFFIX(dedup.kept),
+	    dedup.kept_bytes, dedup.dups, PLURAL_SUFFIX(dedup.dups),
+	    dedup.dup_bytes);
+}
+
+static void
+beacon_packet(u_char *user, const struct pcap_pkthdr *h, const u_char *sp)
+{
+	struct beacon_info *b = (struct beacon_info *)user;
+
+	if (ieee802_11_beacon_repeat(b->ndo, b->radiotap, sp, h->len,
+	    h->caplen)) {
+		b->repeats++;
+		packets_captured++;
+		return;
+	}
+	(*b->callback)(b->user, h, sp);
+}
+
+static void
+print_bssid(void *arg _U_, const struct bssid_stats *bs)
+{
+	(void)fprintf(stderr,
+	    "bssid %02x:%02x:%02x:%02x:%02x:%02x \"%s\"",
+	    bs->bs_bssid[0], bs->bs_bssid[1], bs->bs_bssid[2],
+	    bs->bs_bssid[3], bs->bs_bssid[4], bs->bs_bssid[5], bs->bs_ssid);
+	if (bs->bs_freq != 0)
+		(void)fprintf(stderr, " %u MHz", bs->bs_freq);
+	(void)fprintf(stderr, ": %" PRIu64 " beacon%s, %" PRIu64 " changed",
+	    bs->bs_beacons, PLURAL_SUFFIX(bs->bs_beacons), bs->bs_changes);
+	if (bs->bs_signals != 0)
+		(void)fprintf(stderr, ", signal %ddBm (%d to %d)",
+		    (int)(bs->bs_signal_total / (int64_t)bs->bs_signals),
+		    bs->bs_signal_min, bs->bs_signal_max);
+	(void)fprintf(stderr, "\n");
+}
+
+/*
+ * Report the beacons --beacon-stats counted for each BSSID.
+ */
+static void
+print_beacon_stats(void)
+{
+	if (!beacon_stats || beacon.ndo == NULL)
+		return;
+	bssid_foreach(print_bssid, NULL);
+	(void)fprintf(stderr, "%" PRIu64 " repeated beacon%s not printed\n",
+	    beacon.repeats, PLURAL_SUFFIX(beacon.repeats));
+}
+
+static void
+neighbor_packet(u_char *user, const struct pcap_pkthdr *h, const u_char *sp)
+{
+	struct neighbor_info *n = (struct neighbor_info *)user;
+
+	if (neighbor_repeat(n->ndo, sp, h->len, h->caplen, h->ts.tv_sec)) {
+		n->repeats++;
+		packets_captured++;
+		return;
+	}
+	(*n->callback)(n->user, h, sp);
+}
+
+static void
+print_neighbor(void *arg _U_, const struct neighbor_stats *ns)
+{
+	(void)fprintf(stderr,
+	    "%s neighbor \"%s\" port \"%s\": %" PRIu64 " advertisement%s, %"
+	    PRIu64 " changed, %" PRIu64 " after expiring, ttl %u\n",
+	    ns->ns_proto == NEIGHBOR_LLDP ? "lldp" : "cdp", ns->ns_chassis,
+	    ns->ns_port, ns->ns_adverts, PLURAL_SUFFIX(ns->ns_adverts),
+	    ns->ns_changes, ns->ns_expiries, ns->ns_ttl);
+}
+
+/*
+ * Report the advertisements --neighbors counted for each neighbor.
+ */
+static void
+print_neighbors(void)
+{
+	if (!neighbors || neighbor.ndo == NULL)
+		return;
+	neighbor_foreach(print_neighbor, NULL);
+	(void)fprintf(stderr,
+	    "%" PRIu64 " repeated advertisement%s not printed\n",
+	    neighbor.repeats, PLURAL_SUFFIX(neighbor.repeats));
+}
+
+/*
+ * Return 1 for an 802.15.4 link-layer type, 2 if it has a TAP header,
+ * and 0 for any other.
+ */
+static int
+wpan_dlt(int dlt)
+{
+	switch (dlt) {
+
+#ifdef DLT_IEEE802_15_4
+	case DLT_IEEE802_15_4:
+#endif
+#ifdef DLT_IEEE802_15_4_NOFCS
+	case DLT_IEEE802_15_4_NOFCS:
+#endif
+		return (1);
+
+#ifdef DLT_IEEE802_15_4_TAP
+	case DLT_IEEE802_15_4_TAP:
+		return (2);
+#endif
+	}
+	return (0);
+}
+
+static void
+wpan_packet(u_char *user, const struct pcap_pkthdr *h, const u_char *sp)
+{
+	struct wpan_info *w = (struct wpan_info *)user;
+
+	ieee802_15_4_count(w->ndo, w->tap, sp, h->len, h->caplen);
+	(*w->callback)(w->user, h, sp);
+}
+
+static void
+print_wpan_source(void *arg _U_, const struct wpan_stats *ws)
+{
+	static const char *type_names[] = {
+		"beacon", "data", "ack", "command",
+		"reserved", "multipurpose", "fragment", "extended"
+	};
+	const char *sep;
+	u_int i;
+
+	if (ws->ws_has_pan)
+		(void)fprintf(stderr, "%04x:", ws->ws_pan);
+	else
+		(void)fprintf(stderr, "-:");
+	if (ws->ws_addr_len == 2)
+		(void)fprintf(stderr, "%04x", EXTRACT_LE_U_2(ws->ws_addr));
+	else if (ws->ws_addr_len == 8) {
+		for (i = 8; i != 0; i--)
+			(void)fprintf(stderr, "%02x%s", ws->ws_addr[i - 1],
+			    i > 1 ? ":" : "");
+	} else
+		(void)fprintf(stderr, "none");
+	(void)fprintf(stderr, ": %" PRIu64 " frame%s, %" PRIu64 " bytes (",
+	    ws->ws_frames, PLURAL_SUFFIX(ws->ws_frames), ws->ws_bytes);
+	sep = "";
+	for (i = 0; i < 8; i++) {
+		if (ws->ws_types[i] == 0)
+			continue;
+		(void)fprintf(stderr, "%s%" PRIu64 " %s", sep, ws->ws_types[i],
+		    type_names[i]);
+		sep = ", ";
+	}
+	(void)fprintf(stderr, ")\n");
+}
+
+/*
+ * Report the frames --wpan-stats counted for each source.
+ */
+static void
+print_wpan_stats(void)
+{
+	if (!wpan_stats || wpan.ndo == NULL)
+		return;
+	wpan_foreach(print_wpan_source, NULL);
+}
+
+/*
+ * Parse a --start-time or --end-time argument, which is either seconds
+ * since the epoch or a local date and time as YYYY-MM-DD HH:MM[:SS],
+ * with 'T' allowed in place of the space, and either of them with an
+ * optional fraction of a second.
+ */
+static void
+parse_range_time(const char *arg, struct range_time *t)
+{
+	int year, mon, day, hour, min, sec = 0, n = 0;
+	struct tm tm;
+	const char *p;
+	char *end;
+	int64_t secs;
+	uint32_t nsec, scale;
+
+	if (sscanf(arg, "%4d-%2d-%2d%*1[ T]%2d:%2d%n", &year, &mon, &day,
+	    &hour, &min, &n) == 5 && n != 0) {
+		p = arg + n;
+		if (*p == ':') {
+			if (sscanf(p + 1, "%2d%n", &sec, &n) != 1)
+				error("invalid time %s", arg);
+			p += 1 + n;
+		}
+		memset(&tm, 0, sizeof(tm));
+		tm.tm_year = year - 1900;
+		tm.tm_mon = mon - 1;
+		tm.tm_mday = day;
+		tm.tm_hour = hour;
+		tm.tm_min = min;
+		tm.tm_sec = sec;
+		tm.tm_isdst = -1;
+		secs = mktime(&tm);
+		if (secs == -1)
+			error("invalid time %s", arg);
+	} else {
+		secs = strtol(arg, &end, 10);
+		if (end == arg)
+			error("invalid time %s", arg);
+		p = end;
+	}
+	nsec = 0;
+	if (*p == '.') {
+		for (p++, scale = 100000000; *p >= '0' && *p <= '9'; p++) {
+			nsec += (uint32_t)(*p - '0') * scale;
+			scale /= 10;
+		}
+	}
+	if (*p != '\0')
+		error("invalid time %s", arg);
+	t->ts = secs * _NANO_PER_SEC + nsec;
+	t->set = 1;
+}
+
+/*
+ * Compare a packet's time stamp with a --start-time or --end-time.
+ */
+static int
+range_cmp(const struct pcap_pkthdr *h, const struct range_time *t, int nano)
+{
+	nd_ts_t ts = ND_TS_FROM_TIMEVAL(&h->ts, nano);
+
+	if (ts != t->ts)
+		return (ts < t->ts ? -1 : 1);
+	return (0);
+}
+
+static void
+range_packet(u_char *user, const struct pcap_pkthdr *h, const u_char *sp)
+{
+	struct range_info *r = (struct range_info *)user;
+
+	if (r->done)
+		return;
+	r->packet++;
+	if (r->packet < range_start_packet ||
+	    (range_start.set && range_cmp(h, &range_start, r->nano) < 0))
+		return;
+	if (range_end.set && range_cmp(h, &range_end, r->nano) > 0)
+		r->done = 1;
+	else if (r->fcode->bf_insns == NULL ||
+	    pcap_offline_filter(r->fcode, h, sp) != 0) {
+		/* Have -# number from the first packet's number. */
+		if (r->npackets == 0)
+			packets_captured = (u_int)(r->packet - 1);
+		(*r->callback)(r->user, h, sp);
+		if (++r->npackets == r->cnt)
+			r->done = 1;
+	}
+	if (!r->done)
+		return;
+#ifndef _WIN32
+	if (mmap_reader != NULL)
+		mmap_reader_breakloop(mmap_reader);
+	else
+#endif
+#ifdef HAVE_PCAP_BREAKLOOP
+	pcap_breakloop(pd);
+#else
+	;
+#endif
+}
+
+/*
+ * Drop the oldest packet in the flight recorder's ring.
+ */
+static void
+flight_drop(struct flight_info *f)
+{
+	struct pcap_pkthdr hdr;
+
+	memcpy(&hdr, f->ring + f->head, sizeof(hdr));
+	f->head += FLIGHT_HDRLEN + FLIGHT_ALIGN(hdr.caplen);
+	if (--f->npackets == 0) {
+		f->head = f->tail = 0;
+		f->wrapped = 0;
+	} else if (f->wrapped && f->head == f->end) {
+		f->head = 0;
+		f->wrapped = 0;
+	}
+}
+
+/*
+ * Put a packet in the ring, dropping the oldest packets to make room.
+ */
+static void
+flight_keep(struct flight_info *f, const struct pcap_pkthdr *h,
+    const u_char *sp)
+{
+	struct pcap_pkthdr hdr;
+	size_t need;
+
+	need = FLIGHT_HDRLEN + FLIGHT_ALIGN(h->caplen);
+	if (need > f->size)
+		return;
+	for (;;) {
+		if (!f->wrapped) {
+			if (f->size - f->tail >= need)
+				break;
+			if (f->npackets == 0) {
+				f->head = f->tail = 0;
+				break;
+			}
+			/* Go back to the start of the ring. */
+			f->end = f->tail;
+			f->tail = 0;
+			f->wrapped = 1;
+		}
+		if (f->head - f->tail >= need)
+			break;
+		flight_drop(f);
+	}
+	memcpy(f->ring + f->tail, h, sizeof(*h));
+	memcpy(f->ring + f->tail + FLIGHT_HDRLEN, sp, h->caplen);
+	f->tail += need;
+	f->npackets++;
+
+	/* Keep no more than --flight-window seconds of packets. */
+	while (flight_window != 0 && f->npackets > 1) {
+		memcpy(&hdr, f->ring + f->head, sizeof(hdr));
+		if (h->ts.tv_sec - hdr.ts.tv_sec <= flight_window)
+			break;
+		flight_drop(f);
+	}
+}
+
+/*
+ * Write out the packets in the ring, oldest first, and empty it.
+ */
+static void
+flight_write(struct flight_info *f)
+{
+	struct pcap_pkthdr hdr;
+
+	while (f->npackets != 0) {
+		memcpy(&hdr, f->ring + f->head, sizeof(hdr));
+		(*f->callback)(f->user, &hdr, f->ring + f->head + FLIGHT_HDRLEN);
+		flight_drop(f);
+	}
+}
+
+/*
+ * Does a packet match a flight recorder filter, if there is one?
+ */
+static int
+flight_match(const struct bpf_program *fcode, const struct pcap_pkthdr *h,
+    const u_char *sp)
+{
+	return (fcode->bf_insns != NULL &&
+	    pcap_offline_filter(fcode, h, sp) != 0);
+}
+
+static void
+flight_packet(u_char *user, const struct pcap_pkthdr *h, const u_char *sp)
+{
+	struct flight_info *f = (struct flight_info *)user;
+	int triggered, started = 0;
+
+	if (f->started) {
+		/* Only the stop filter matters until it matches. */
+		(*f->callback)(f->user, h, sp);
+		if (flight_match(&f->stop_fcode, h, sp)) {
+			f->started = 0;
+			f->after_trigger = 1;
+			f->until = h->ts.tv_sec + flight_after;
+		}
+		return;
+	}
+	triggered = flight_match(&f->fcode, h, sp);
+#ifdef SIGUSR2
+	if (flight_signals != flight_signals_seen) {
+		flight_signals_seen = flight_signals;
+		triggered = 1;
+	}
+#endif
+	if (!triggered)
+		started = triggered = flight_match(&f->start_fcode, h, sp);
+	if (triggered) {
+		/* This packet goes out last, and sets the --flight-window. */
+		flight_keep(f, h, sp);
+		flight_write(f);
+		f->started = started;
+		f->after_trigger = !started;
+		f->until = h->ts.tv_sec + flight_after;
+	} else if (f->after_trigger && h->ts.tv_sec <= f->until)
+		(*f->callback)(f->user, h, sp);
+	else {
+		f->after_trigger = 0;
+		flight_keep(f, h, sp);
+	}
+}
+
+#ifndef _WIN32
+/*
+ * Does the record at off in the savefile pc is reading look like that
+ * of a packet with time stamp sec?  This catches an index that's not
+ * of this savefile.
+ */
+static int
+range_record_at(pcap_t *pc, uint64_t off, int64_t sec)
+{
+	FILE *f = pcap_file(pc);
+	uint32_t hdr[4];
+	off_t here;
+	u_int i;
+	int ok;
+
+	here = ftello(f);
+	ok = here != -1 && fseeko(f, (off_t)off, SEEK_SET) == 0 &&
+	    fread(hdr, sizeof(hdr[0]), 4, f) == 4;
+	if (ok && pcap_is_swapped(pc)) {
+		for (i = 0; i < 4; i++)
+			hdr[i] = (hdr[i] >> 24) | ((hdr[i] >> 8) & 0xff00) |
+			    ((hdr[i] & 0xff00) << 8) | (hdr[i] << 24);
+	}
+	ok = ok && hdr[0] == (uint32_t)sec && hdr[3] != 0 && hdr[2] <= hdr[3];
+	if (here == -1 || fseeko(f, here, SEEK_SET) != 0)
+		error("%s", pcap_strerror(errno));
+	return (ok);
+}
+#endif
+
+/*
+ * Skip to the start of the range, if there's an index of the savefile
+ * fname, which pc is open on, that says where to.
+ */
+static void
+range_seek(pcap_t *pc _U_, const char *fname)
+{
+#ifndef _WIN32
+	struct savefile_index_entry e;
+	char ebuf[PCAP_ERRBUF_SIZE];
+
+	if (range_start_packet == 1 && !range_start.set)
+		return;
+	if (!savefile_index_seekable(fname))
+		return;
+	switch (savefile_index_find(fname, range_start_packet,
+	    range_start.set ? range_start.ts : INT64_MAX, &e, ebuf)) {
+
+	case -1:
+		warning("%s; reading from the start", ebuf);
+		return;
+
+	case 0:
+		return;
+	}
+	if (!range_record_at(pc, e.offset, e.sec)) {
+		warning("%s%s isn't an index of %s; reading from the start",
+		    fname, SAVEFILE_INDEX_SUFFIX, fname);
+		return;
+	}
+	if (mmap_reader != NULL)
+		mmap_reader_seek(mmap_reader, e.offset);
+	else if (fseeko(pcap_file(pc), (off_t)e.offset, SEEK_SET) != 0)
+		error("%s: %s", fname, pcap_strerror(errno));
+	range.packet = e.packet - 1;
+#else
+	(void)fname;
+#endif
+}
+
+struct build_info {
+	struct savefile_index *idx;
+	struct flow_index *fidx;	/* if --flow-index */
+	pcap_t	*pc;
+	int	dlt;
+	uint64_t next_off;		/* of the record after the last one */
+	uint64_t rec_off;		/* of this record, for fidx */
+	uint64_t npackets;
+};
+
+/*
+ * Offset of the next record of the savefile pc is reading.
+ */
+static uint64_t
+build_offset(pcap_t *pc _U_)
+{
+#ifndef _WIN32
+	off_t off;
+
+	if (mmap_reader != NULL)
+		return (mmap_reader_offset(mmap_reader));
+	off = ftello(pcap_file(pc));
+	if (off == -1)
+		error("ftell fails on input file");
+	return ((uint64_t)off);
+#else
+	return (0);
+#endif
+}
+
+static void
+build_index_packet(u_char *user, const struct pcap_pkthdr *h,
+    const u_char *sp)
+{
+	struct build_info *b = (struct build_info *)user;
+
+	if (savefile_index_next(b->idx) &&
+	    savefile_index_add(b->idx, &h->ts, b->next_off) == -1)
+		error("unable to write the index: %s", pcap_strerror(errno));
+	if (b->fidx != NULL) {
+		if (flow_index_add(b->fidx, flow_hash(b->dlt, 0, h, sp),
+		    b->rec_off, SAVEFILE_RECORD_HDRLEN + h->caplen) == -1)
+			error("unable to write the flow index: %s",
+			    pcap_strerror(errno));
+		b->rec_off += SAVEFILE_RECORD_HDRLEN + h->caplen;
+	}
+	/* Only look up the offset of records that get an entry. */
+	if (++b->npackets % index_interval == 0)
+		b->next_off = build_offset(b->pc);
+}
+
+/*
+ * Write the index of the savefile fname, which pc has just been opened
+ * on, for --build-index, and its flow index too with --flow-index.
+ */
+static void
+build_savefile_index(netdissect_options *ndo, pcap_t *pc, const char *fname)
+{
+	char ebuf[PCAP_ERRBUF_SIZE];
+	struct build_info b;
+	char *name, *fname_fidx = NULL;
+	FILE *fp;
+	int status;
+
+	if (!savefile_index_seekable(fname))
+		error("%s isn't a pcap savefile that can be indexed", fname);
+	name = savefile_index_name(fname);
+	if (name == NULL)
+		error("malloc of the index file name");
+	fp = fopen(name, "wb");
+	if (fp == NULL)
+		error("unable to open file %s: %s", name, pcap_strerror(errno));
+	memset(&b, 0, sizeof(b));
+	b.idx = savefile_index_open(fp, index_interval, nano_tstamps(ndo),
+	    ebuf);
+	if (b.idx == NULL)
+		error("%s: %s", name, ebuf);
+	b.pc = pc;
+	b.next_off = build_offset(pc);
+	if (flow_index) {
+		fname_fidx = flow_index_name(fname);
+		if (fname_fidx == NULL)
+			error("malloc of the flow index file name");
+		fp = fopen(fname_fidx, "wb");
+		if (fp == NULL)
+			error("unable to open file %s: %s", fname_fidx,
+			    pcap_strerror(errno));
+		b.fidx = flow_index_open(fp, ebuf);
+		if (b.fidx == NULL)
+			error("%s: %s", fname_fidx, ebuf);
+		b.dlt = pcap_datalink(pc);
+		b.rec_off = b.next_off;
+	}
+#ifndef _WIN32
+	if (mmap_reader != NULL)
+		status = mmap_reader_loop(mmap_reader, -1, NULL,
+		    build_index_packet, (u_char *)&b, ebuf);
+	else
+#endif
+	status = pcap_loop(pc, -1, build_index_packet, (u_char *)&b);
+	if (status == -1) {
+#ifndef _WIN32
+		if (mmap_reader != NULL)
+			error("%s", ebuf);
+#endif
+		error("%s", pcap_geterr(pc));
+	}
+	if (savefile_index_close(b.idx, ebuf) == -1)
+		error("%s: %s", name, ebuf);
+	free(name);
+	if (b.fidx != NULL) {
+		if (flow_index_close(b.fidx, ebuf) == -1)
+			error("%s: %s", fname_fidx, ebuf);
+		free(fname_fidx);
+	}
+}
+
+#ifdef HAVE_PTHREADS
+static void *
+writer_main(void *arg)
+{
+	struct dump_info *dump_info = (struct dump_info *)arg;
+	struct writer_buffer *buf;
+	struct pcap_pkthdr h;
+	size_t off;
+
+	pthread_mutex_lock(&writer_mtx);
+	for (;;) {
+		while (writer_fill->len == 0 && !writer_ticked)
+			pthread_cond_wait(&writer_cv, &writer_mtx);
+		writer_ticked = 0;
+#ifdef SAVEFILE_CLOCK_SUPPORTED
+		if (writer_fill->len == 0) {
+			/* Nothing's come in; rotate or flush on time anyway. */
+			pthread_mutex_unlock(&writer_mtx);
+			savefile_clock_check(dump_info);
+			pthread_mutex_lock(&writer_mtx);
+			continue;
+		}
+#endif
+
+		/*
+		 * Take the fill buffer, and let the capture thread
+		 * fill the other one, which we've already written out.
+		 */
+		buf = writer_fill;
+		writer_fill = (buf == &writer_bufs[0]) ?
+		    &writer_bufs[1] : &writer_bufs[0];
+		writer_busy = 1;
+		pthread_cond_broadcast(&capture_cv);
+		pthread_mutex_unlock(&writer_mtx);
+
+		for (off = 0; off < buf->len; off += sizeof(h) + h.caplen) {
+			memcpy(&h, buf->data + off, sizeof(h));
+			if (Cflag != 0 || Gflag != 0)
+				rotate_savefile(dump_info);
+			savefile_dump(dump_info, &h,
+			    buf->data + off + sizeof(h));
+		}
+#ifdef HAVE_PCAP_DUMP_FLUSH
+		if (Uflag && flush_interval == 0)
+			savefile_flush(dump_info);
+#endif
+#ifdef SAVEFILE_CLOCK_SUPPORTED
+		if (flush_interval != 0 &&
+		    savefile_clock_flush_due(savefile_clock))
+			savefile_flush(dump_info);
+#endif
+		buf->len = 0;
+
+		pthread_mutex_lock(&writer_mtx);
+		writer_busy = 0;
+		pthread_cond_broadcast(&capture_cv);
+	}
+	/* NOTREACHED */
+	return (NULL);
+}
+
+/*
+ * Start a thread; signals are handled by the capture thread, so block
+ * them all while creating the thread, so that it inherits that mask.
+ */
+static void
+start_thread(pthread_t *tid, void *(*func)(void *), void *arg,
+    const char *what)
+{
+	sigset_t mask, omask;
+	int err;
+#ifdef CPU_AFFINITY_SUPPORTED
+	struct affinity_stage *as;
+	struct cpu_affinity *saved = NULL;
+	char ebuf[PCAP_ERRBUF_SIZE];
+
+	/* Likewise, it inherits the CPUs this thread is bound to. */
+	for (as = &affinity_stages[1]; as->name != NULL; as++)
+		if (as->cpus != NULL && strcmp(as->what, what) == 0)
+			break;
+	if (as->name != NULL) {
+		if ((saved = cpu_affinity_get(ebuf)) == NULL ||
+		    cpu_affinity_bind(as->cpus, as->next++, ebuf) == -1)
+			error("%s thread: %s", what, ebuf);
+	}
+#endif
+
+	sigfillset(&mask);
+	pthread_sigmask(SIG_SETMASK, &mask, &omask);
+	err = pthread_create(tid, NULL, func, arg);
+	pthread_sigmask(SIG_SETMASK, &omask, NULL);
+	if (err != 0)
+		error("unable to create %s thread: %s", what, strerror(err));
+#ifdef CPU_AFFINITY_SUPPORTED
+	if (saved != NULL) {
+		if (cpu_affinity_bind(saved, -1, ebuf) == -1)
+			error("%s", ebuf);
+		cpu_affinity_free(saved);
+	}
+#endif
+}
+
+#ifdef SAVEFILE_CLOCK_SUPPORTED
+/*
+ * Called by the savefile clock thread, to have a writer that's waiting
+ * for packets look at the clock.
+ */
+static void
+writer_wake(void *arg _U_)
+{
+	pthread_mutex_lock(&writer_mtx);
+	writer_ticked = 1;
+	pthread_cond_broadcast(&writer_cv);
+	pthread_mutex_unlock(&writer_mtx);
+}
+#endif
+
+static void
+writer_start(struct dump_info *dump_info)
+{
+	int i;
+
+	for (i = 0; i < 2; i++) {
+		writer_bufs[i].data = (u_char *)malloc(WRITER_BUFSIZE);
+		if (writer_bufs[i].data == NULL)
+			error("writer_start: malloc");
+		writer_bufs[i].len = 0;
+	}
+
+	start_thread(&writer_tid, writer_main, dump_info,
+	    "savefile writer");
+}
+
+/*
+ * Copy a packet into the fill buffer, waiting for the writer to take
+ * the buffer if there's no room in it.
+ */
+static void
+writer_enqueue(const struct pcap_pkthdr *h, const u_char *sp)
+{
+	size_t need = sizeof(*h) + h->caplen;
+
+	if (need > WRITER_BUFSIZE)
+		error("packet too large (%u bytes) for the writer buffer",
+		    h->caplen);
+	pthread_mutex_lock(&writer_mtx);
+	while (WRITER_BUFSIZE - writer_fill->len < need) {
+		pthread_cond_signal(&writer_cv);
+		pthread_cond_wait(&capture_cv, &writer_mtx);
+	}
+	memcpy(writer_fill->data + writer_fill->len, h, sizeof(*h));
+	memcpy(writer_fill->data + writer_fill->len + sizeof(*h), sp,
+	    h->caplen);
+	writer_fill->len += need;
+	if (!writer_busy)
+		pthread_cond_signal(&writer_cv);
+	pthread_mutex_unlock(&writer_mtx);
+}
+
+/*
+ * Wait until the writer has written out everything queued so far.
+ */
+static void
+writer_drain(void)
+{
+	pthread_mutex_lock(&writer_mtx);
+	while (writer_fill->len != 0 || writer_busy) {
+		pthread_cond_signal(&writer_cv);
+		pthread_cond_wait(&capture_cv, &writer_mtx);
+	}
+	pthread_mutex_unlock(&writer_mtx);
+}
+#endif /* HAVE_PTHREADS */
+
+#ifdef CPU_AFFINITY_SUPPORTED
+/*
+ * Handle --cpu-affinity stage=cpus.
+ */
+static void
+affinity_option(const char *arg)
+{
+	struct affinity_stage *as;
+	const char *cpus;
+	char ebuf[PCAP_ERRBUF_SIZE];
+	size_t len;
+
+	cpus = strchr(arg, '=');
+	if (cpus == NULL)
+		error("invalid --cpu-affinity %s, not stage=cpus", arg);
+	len = (size_t)(cpus - arg);
+	for (as = affinity_stages; as->name != NULL; as++)
+		if (strlen(as->name) == len && strncmp(as->name, arg, len) == 0)
+			break;
+	if (as->name == NULL)
+		error("unknown --cpu-affinity stage %.*s", (int)len, arg);
+	cpu_affinity_free(as->cpus);
+	if ((as->cpus = cpu_affinity_parse(cpus + 1, ebuf)) == NULL)
+		error("%s", ebuf);
+}
+
+/*
+ * Bind the main thread, before "device", or the savefile if it's NULL,
+ * is opened.
+ */
+static void
+affinity_setup(const char *device)
+{
+	struct cpu_affinity *node_cpus;
+	char ebuf[PCAP_ERRBUF_SIZE];
+	int node = -1;
+
+	if (numa_node != NULL) {
+		if (strcmp(numa_node, "auto") != 0)
+			node = atoi(numa_node);
+		else if (device == NULL)
+			error("--numa-node=auto can only be used for a live capture");
+		else if ((node = cpu_affinity_device_node(device)) < 0)
+			warning("can't find the NUMA node of %s", device);
+		if (node >= 0) {
+			if ((node_cpus = cpu_affinity_node(node, ebuf)) == NULL ||
+			    cpu_affinity_bind(node_cpus, -1, ebuf) == -1)
+				error("%s", ebuf);
+			cpu_affinity_free(node_cpus);
+		}
+	}
+	if (affinity_stages[0].cpus != NULL &&
+	    cpu_affinity_bind(affinity_stages[0].cpus, 0, ebuf) == -1)
+		error("main thread: %s", ebuf);
+}
+#endif /* CPU_AFFINITY_SUPPORTED */
+
+static uint32_t
+flow_addr_hash(const u_char *p, u_int len)
+{
+	uint32_t hash = 2166136261U;
+
+	while (len-- != 0)
+		hash = (hash ^ *p++) * 16777619U;
+	return (hash);
+}
+
+/*
+ * Hash the addresses and, for TCP, UDP and SCTP, the ports of an IPv4
+ * or IPv6 packet, in a way that doesn't depend on which end of the
+ * flow sent the packet.  Fragments other than the first hash on the
+ * addresses only, as they carry no ports; they're printed without
+ * looking at any saved state.  With "frag_whole" (--ip-reassembly),
+ * all fragments, the first too, hash on the addresses only, so that
+ * those of a datagram are kept together.  So does ISAKMP, on UDP port
+ * 500 or 4500.  An ICMP or ICMPv6 error hashes like the packet it
+ * quotes, as the printer dissects that packet too.
+ *
+ * Returns 0 if the packet isn't IPv4 or IPv6 or is cut short by the
+ * snapshot length.
+ */
+static uint32_t
+flow_ip_hash(const u_char *p, const u_char *ep, int frag_whole,
+    int quoted)
+{
+	const u_char *l4;
+	u_int proto;
+	uint32_t hash, qhash;
+
+	if (ep - p < 1)
+		return (0);
+	switch (*p >> 4) {
+
+	case 4:
+		if (ep - p < 20)
+			return (0);
+		hash = flow_addr_hash(p + 12, 4) +
+		    flow_addr_hash(p + 16, 4);
+		proto = p[9];
+		if ((EXTRACT_BE_U_2(p + 6) &
+		    (frag_whole ? 0x3fff : 0x1fff)) != 0)
+			return (hash);
+		l4 = p + (p[0] & 0x0f) * 4;
+		break;
+
+	case 6:
+		if (ep - p < 40)
+			return (0);
+		hash = flow_addr_hash(p + 8, 16) +
+		    flow_addr_hash(p + 24, 16);
+		proto = p[6];
+		l4 = p + 40;
+		for (;;) {
+			if (proto == IPPROTO_HOPOPTS ||
+			    proto == IPPROTO_ROUTING ||
+			    proto == IPPROTO_DSTOPTS) {
+				if (ep - l4 < 2)
+					return (hash);
+				proto = l4[0];
+				l4 += (l4[1] + 1) * 8;
+			} else if (proto == IPPROTO_FRAGMENT) {
+				if (ep - l4 < 8 || frag_whole ||
+				    (EXTRACT_BE_U_2(l4 + 2) & 0xfff8) != 0)
+					return (hash);
+				proto = l4[0];
+				l4 += 8;
+			} else
+				break;
+		}
+		break;
+
+	default:
+		return (0);
+	}
+	if (ep - l4 < 4)
+		return (hash);
+
+	switch (proto) {
+
+	case IPPROTO_UDP:
+		/*
+		 * ISAKMP moves from port 500 to the NAT-T port 4500 part
+		 * way through an exchange, and the printer remembers the
+		 * cookies of the initiator from port 500; keep both on
+		 * one worker.
+		 */
+		if (EXTRACT_BE_U_2(l4) == ISAKMP_PORT ||
+		    EXTRACT_BE_U_2(l4) == ISAKMP_PORT_NATT ||
+		    EXTRACT_BE_U_2(l4 + 2) == ISAKMP_PORT ||
+		    EXTRACT_BE_U_2(l4 + 2) == ISAKMP_PORT_NATT)
+			break;
+		/* FALLTHROUGH */
+
+	case IPPROTO_TCP:
+	case IPPROTO_SCTP:
+		hash = hash * 31 + EXTRACT_BE_U_2(l4) + EXTRACT_BE_U_2(l4 + 2);
+		break;
+
+	case IPPROTO_ICMP:
+		/* unreachable, source quench, redirect, time exceeded,
+		   parameter problem */
+		if (!quoted && (l4[0] == 3 || l4[0] == 4 || l4[0] == 5 ||
+		    l4[0] == 11 || l4[0] == 12) &&
+		    (qhash = flow_ip_hash(l4 + 8, ep, frag_whole, 1)) != 0)
+			hash = qhash;
+		break;
+
+	case IPPROTO_ICMPV6:
+		/* unreachable, packet too big, time exceeded, parameter
+		   problem */
+		if (!quoted && l4[0] >= 1 && l4[0] <= 4 &&
+		    (qhash = flow_ip_hash(l4 + 8, ep, frag_whole, 1)) != 0)
+			hash = qhash;
+		break;
+	}
+	return (hash);
+}
+
+/*
+ * Find the network-layer header of a packet of link-layer type "dlt",
+ * for the common link-layer types, and set "*typep" to its Ethertype,
+ * or to 0 if it's IP and the version has to be gone by.  Returns NULL
+ * if the link-layer type isn't one of those or the packet is too short.
+ */
+static const u_char *
+link_payload(int dlt, const struct pcap_pkthdr *h, const u_char *sp,
+    u_int *typep)
+{
+	const u_char *p = sp, *ep = sp + h->caplen;
+	u_int type;
+
+	switch (dlt) {
+
+	case DLT_EN10MB:
+		if (ep - p < 14)
+			return (NULL);
+		type = EXTRACT_BE_U_2(p + 12);
+		p += 14;
+		while ((type == ETHERTYPE_8021Q || type == ETHERTYPE_8021QinQ ||
+		    type == ETHERTYPE_8021Q9100 || type == ETHERTYPE_8021Q9200) &&
+		    ep - p >= 4) {
+			type = EXTRACT_BE_U_2(p + 2);
+			p += 4;
+		}
+		break;
+
+#ifdef DLT_LINUX_SLL
+	case DLT_LINUX_SLL:
+		if (ep - p < 16)
+			return (NULL);
+		type = EXTRACT_BE_U_2(p + 14);
+		p += 16;
+		break;
+#endif
+
+#ifdef DLT_LINUX_SLL2
+	case DLT_LINUX_SLL2:
+		if (ep - p < 20)
+			return (NULL);
+		type = EXTRACT_BE_U_2(p);
+		p += 20;
+		break;
+#endif
 
-	if (RFileName == NULL) {
+	case DLT_NULL:
+#ifdef DLT_LOOP
+	case DLT_LOOP:
+#endif
 		/*
-		 * Live capture (if -V was specified, we set RFileName
-		 * to a file from the -V file).  Print a message to
-		 * the standard error on UN*X.
+		 * The address family may be in either byte order, and
+		 * its values differ between OSes; go by the IP version.
 		 */
-		if (!ndo->ndo_vflag && !WFileName) {
-			(void)fprintf(stderr,
-			    "%s: verbose output suppressed, use -v or -vv for full protocol decode\n",
-			    program_name);
-		} else
-			(void)fprintf(stderr, "%s: ", program_name);
-		dlt = pcap_datalink(pd);
-		dlt_name = pcap_datalink_val_to_name(dlt);
-		(void)fprintf(stderr, "listening on %s", device);
-		if (dlt_name == NULL) {
-			(void)fprintf(stderr, ", link-type %u", dlt);
-		} else {
-			(void)fprintf(stderr, ", link-type %s (%s)", dlt_name,
-				      pcap_datalink_val_to_description(dlt));
+		if (ep - p < 4)
+			return (NULL);
+		p += 4;
+		type = 0;
+		break;
+
+	case DLT_RAW:
+#ifdef DLT_IPV4
+	case DLT_IPV4:
+#endif
+#ifdef DLT_IPV6
+	case DLT_IPV6:
+#endif
+		type = 0;
+		break;
+
+	default:
+		return (NULL);
+	}
+
+	*typep = type;
+	return (p);
+}
+
+/*
+ * Hash the flow of a packet of link-layer type "dlt", to pick its
+ * --dissect-threads worker or to --flow-sample it.  A packet in a
+ * tunnel that decap_find() looks into hashes on the innermost IP
+ * packet, as the outer headers of the two directions of one flow
+ * needn't match; VXLAN and Geneve pick the outer UDP source port from
+ * the inner headers of each direction.  Returns 0 for all packets that
+ * aren't IP, or whose link-layer type isn't one of the common ones.
+ */
+static uint32_t
+flow_hash(int dlt, int frag_whole, const struct pcap_pkthdr *h,
+    const u_char *sp)
+{
+	const u_char *p, *ep = sp + h->caplen, *inner;
+	struct pcap_pkthdr ih;
+	u_int type;
+	uint32_t hash, vni;
+
+	switch (decap_find(dlt, h, sp, &inner, &vni)) {
+
+	case DECAP_ETHER:
+		ih.caplen = (bpf_u_int32)(ep - inner);
+		p = link_payload(DLT_EN10MB, &ih, inner, &type);
+		break;
+
+	case DECAP_IP:
+		p = inner;
+		type = 0;
+		break;
+
+	default:
+		p = NULL;
+		break;
+	}
+	hash = 0;
+	if (p != NULL && (type == 0 || type == ETHERTYPE_IP ||
+	    type == ETHERTYPE_IPV6))
+		hash = flow_ip_hash(p, ep, frag_whole, 0);
+	if (hash == 0) {
+		/* Not in a tunnel, or not IP inside it. */
+		if ((p = link_payload(dlt, h, sp, &type)) == NULL)
+			return (0);
+		switch (type) {
+
+		case 0:		/* no link-layer type; go by the IP version */
+		case ETHERTYPE_IP:
+		case ETHERTYPE_IPV6:
+			hash = flow_ip_hash(p, ep, frag_whole, 0);
+			break;
+
+		default:
+			return (0);
 		}
-		(void)fprintf(stderr, ", snapshot length %d bytes\n", ndo->ndo_snaplen);
-		(void)fflush(stderr);
 	}
 
-#ifdef HAVE_CAPSICUM
-	cansandbox = (VFileName == NULL && zflag == NULL);
-#ifdef HAVE_CASPER
-	cansandbox = (cansandbox && (ndo->ndo_nflag || capdns != NULL));
-#else
-	cansandbox = (cansandbox && ndo->ndo_nflag);
-#endif /* HAVE_CASPER */
-	if (cansandbox && cap_enter() < 0 && errno != ENOSYS)
-		error("unable to enter the capability mode");
-#endif	/* HAVE_CAPSICUM */
+	/* Mix the bits, so that the low-order ones can be used. */
+	hash ^= hash >> 16;
+	hash *= 0x85ebca6bU;
+	hash ^= hash >> 13;
+	hash *= 0xc2b2ae35U;
+	hash ^= hash >> 16;
+	return (hash);
+}
 
-	do {
-		status = pcap_loop(pd, cnt, callback, pcap_userdata);
-		if (WFileName == NULL) {
-			/*
-			 * We're printing packets.  Flush the printed output,
-			 * so it doesn't get intermingled with error output.
-			 */
-			if (status == -2) {
-				/*
-				 * We got interrupted, so perhaps we didn't
-				 * manage to finish a line we were printing.
-				 * Print an extra newline, just in case.
-				 */
-				putchar('\n');
+/*
+ * Find the innermost Ethernet frame or IP packet of a packet of
+ * link-layer type "dlt", and set "*innerp" to it, and "*vnip" to the
+ * VNI of the outermost VXLAN or Geneve tunnel, or DECAP_NO_VNI.
+ * Returns DECAP_NONE if the packet isn't encapsulated in any of the
+ * ways looked into.
+ */
+static int
+decap_find(int dlt, const struct pcap_pkthdr *h, const u_char *sp,
+    const u_char **innerp, uint32_t *vnip)
+{
+	const u_char *p, *ep = sp + h->caplen, *l4;
+	u_int type, proto, depth, hlen, flags;
+	int kind = DECAP_NONE;
+
+	*vnip = DECAP_NO_VNI;
+	if ((p = link_payload(dlt, h, sp, &type)) == NULL)
+		return (DECAP_NONE);
+	for (depth = 0; depth < DECAP_MAX_DEPTH; depth++) {
+		/* At a header of Ethertype "type", or IP if it's 0. */
+		switch (type) {
+
+		case ETHERTYPE_TEB:
+			*innerp = p;
+			kind = DECAP_ETHER;
+			if (ep - p < 14)
+				return (kind);
+			type = EXTRACT_BE_U_2(p + 12);
+			p += 14;
+			while ((type == ETHERTYPE_8021Q ||
+			    type == ETHERTYPE_8021QinQ) && ep - p >= 4) {
+				type = EXTRACT_BE_U_2(p + 2);
+				p += 4;
 			}
-			(void)fflush(stdout);
+			continue;
+
+		case ETHERTYPE_MPLS:
+		case ETHERTYPE_MPLS_MULTI:
+			/* Down to the bottom of the label stack. */
+			do {
+				if (ep - p < 4)
+					return (kind);
+				flags = p[2];
+				p += 4;
+			} while ((flags & 0x01) == 0);
+			/* There's no type; go by the IP version. */
+			if (ep - p < 1 || (*p >> 4 != 4 && *p >> 4 != 6))
+				return (kind);
+			*innerp = p;
+			kind = DECAP_IP;
+			type = 0;
+			continue;
+
+		case 0:
+		case ETHERTYPE_IP:
+		case ETHERTYPE_IPV6:
+			break;
+
+		default:
+			return (kind);
 		}
-                if (status == -2) {
-			/*
-			 * We got interrupted. If we are reading multiple
-			 * files (via -V) set these so that we stop.
-			 */
-			VFileName = NULL;
-			ret = NULL;
+
+		if (ep - p < 1)
+			return (kind);
+		switch (*p >> 4) {
+
+		case 4:
+			hlen = (p[0] & 0x0f) * 4;
+			/* A fragment has only part of what's inside. */
+			if (ep - p < 20 || hlen < 20 || (u_int)(ep - p) < hlen ||
+			    (EXTRACT_BE_U_2(p + 6) & 0x3fff) != 0)
+				return (kind);
+			proto = p[9];
+			l4 = p + hlen;
+			break;
+
+		case 6:
+			if (ep - p < 40)
+				return (kind);
+			proto = p[6];
+			l4 = p + 40;
+			break;
+
+		default:
+			return (kind);
 		}
-		if (status == -1) {
-			/*
-			 * Error.  Report it.
-			 */
-			(void)fprintf(stderr, "%s: pcap_loop: %s\n",
-			    program_name, pcap_geterr(pd));
+
+		switch (proto) {
+
+		case IPPROTO_IPV4:
+		case IPPROTO_IPV6:
+			p = l4;
+			*innerp = p;
+			kind = DECAP_IP;
+			type = 0;
+			continue;
+
+		case IPPROTO_GRE:
+			if (ep - l4 < 4)
+				return (kind);
+			flags = EXTRACT_BE_U_2(l4);
+			/* Version 0, without source routing. */
+			if ((flags & 0x4007) != 0)
+				return (kind);
+			type = EXTRACT_BE_U_2(l4 + 2);
+			hlen = 4 + ((flags & 0x8000) ? 4 : 0) +
+			    ((flags & 0x2000) ? 4 : 0) +
+			    ((flags & 0x1000) ? 4 : 0);
+			break;
+
+		case IPPROTO_UDP:
+			if (ep - l4 < 16)
+				return (kind);
+			switch (EXTRACT_BE_U_2(l4 + 2)) {
+
+			case VXLAN_PORT:
+				if ((l4[8] & 0x08) == 0)	/* no VNI */
+					return (kind);
+				type = ETHERTYPE_TEB;
+				hlen = 16;
+				if (*vnip == DECAP_NO_VNI)
+					*vnip = EXTRACT_BE_U_3(l4 + 12);
+				break;
+
+			case GENEVE_PORT:
+				if ((l4[8] >> 6) != 0)		/* version */
+					return (kind);
+				type = EXTRACT_BE_U_2(l4 + 10);
+				hlen = 16 + (l4[8] & 0x3f) * 4;
+				if (*vnip == DECAP_NO_VNI)
+					*vnip = EXTRACT_BE_U_3(l4 + 12);
+				break;
+
+			case MPLS_PORT:
+				type = ETHERTYPE_MPLS;
+				hlen = 8;
+				break;
+
+			default:
+				return (kind);
+			}
+			break;
+
+		default:
+			return (kind);
 		}
-		if (RFileName == NULL) {
-			/*
-			 * We're doing a live capture.  Report the capture
-			 * statistics.
-			 */
-			info(1);
+
+		/* Into the payload of the tunnel. */
+		if ((u_int)(ep - l4) < hlen)
+			return (kind);
+		p = l4 + hlen;
+		if (type == ETHERTYPE_IP || type == ETHERTYPE_IPV6) {
+			*innerp = p;
+			kind = DECAP_IP;
+			type = 0;
 		}
-		pcap_close(pd);
-		if (VFileName != NULL) {
-			ret = get_next_file(VFile, VFileLine);
-			if (ret) {
-				int new_dlt;
+	}
+	return (kind);
+}
 
-				RFileName = VFileLine;
-				pd = pcap_open_offline(RFileName, ebuf);
-				if (pd == NULL)
-					error("%s", ebuf);
-#ifdef HAVE_CAPSICUM
-				cap_rights_init(&rights, CAP_READ);
-				if (cap_rights_limit(fileno(pcap_file(pd)),
-				    &rights) < 0 && errno != ENOSYS) {
-					error("unable to limit pcap descriptor");
-				}
+/*
+ * Compile --inner-filter for the link-layer type of "pc", for Ethernet
+ * and for raw IP.
+ */
+static void
+decap_open(pcap_t *pc, int optimize, bpf_u_int32 mask)
+{
+	pcap_t *dead;
+	int snaplen;
+
+	decap.dlt = pcap_datalink(pc);
+	if (decap_write_inner && decap.dlt != DLT_EN10MB)
+		error("--write-inner can only be used with Ethernet captures");
+	snaplen = pcap_snapshot(pc);
+	if (snaplen <= 0)
+		snaplen = MAXIMUM_SNAPLEN;
+	if (decap_filter != NULL) {
+		if (pcap_compile(pc, &decap.fcode, decap_filter, optimize,
+		    mask) < 0)
+			error("--inner-filter: %s", pcap_geterr(pc));
+		dead = pcap_open_dead(DLT_EN10MB, snaplen);
+		if (dead == NULL ||
+		    pcap_compile(dead, &decap.ether_fcode, decap_filter,
+		    optimize, mask) < 0)
+			error("--inner-filter: %s", dead != NULL ?
+			    pcap_geterr(dead) : "can't compile for Ethernet");
+		pcap_close(dead);
+		dead = pcap_open_dead(DLT_RAW, snaplen);
+		if (dead == NULL ||
+		    pcap_compile(dead, &decap.ip_fcode, decap_filter,
+		    optimize, mask) < 0)
+			error("--inner-filter: %s", dead != NULL ?
+			    pcap_geterr(dead) : "can't compile for raw IP");
+		pcap_close(dead);
+	}
+	if (decap_write_inner) {
+		decap.bufsize = 14 + (size_t)snaplen;
+		decap.buf = (u_char *)malloc(decap.bufsize);
+		if (decap.buf == NULL)
+			error("unable to allocate %zu bytes for --write-inner",
+			    decap.bufsize);
+	}
+}
+
+static void
+decap_packet(u_char *user, const struct pcap_pkthdr *h, const u_char *sp)
+{
+	struct decap_info *d = (struct decap_info *)user;
+	const struct bpf_program *fcode;
+	struct pcap_pkthdr ih;
+	const u_char *inner = sp;
+	size_t off;
+	int kind;
+
+	kind = decap_find(d->dlt, h, sp, &inner, &d->vni);
+	if (kind == DECAP_NONE) {
+		fcode = &d->fcode;
+		ih = *h;
+	} else {
+		d->decapsulated++;
+		off = (size_t)(inner - sp);
+		ih.ts = h->ts;
+		ih.caplen = h->caplen - (bpf_u_int32)off;
+		ih.len = h->len - (bpf_u_int32)off;
+		fcode = kind == DECAP_ETHER ? &d->ether_fcode : &d->ip_fcode;
+	}
+	if (fcode->bf_insns != NULL &&
+	    pcap_offline_filter(fcode, &ih, inner) == 0)
+		return;
+	d->matched++;
+	if (!decap_write_inner || kind == DECAP_NONE)
+		(*d->callback)(d->user, h, sp);
+	else if (kind == DECAP_ETHER)
+		(*d->callback)(d->user, &ih, inner);
+	else {
+		/* Give the IP packet an Ethernet header to be written with. */
+		if (ih.caplen > d->bufsize - 14)
+			ih.caplen = (bpf_u_int32)(d->bufsize - 14);
+		memset(d->buf, 0, 12);
+		d->buf[12] = (*inner >> 4) == 6 ? 0x86 : 0x08;
+		d->buf[13] = (*inner >> 4) == 6 ? 0xdd : 0x00;
+		memcpy(d->buf + 14, inner, ih.caplen);
+		ih.caplen += 14;
+		ih.len += 14;
+		(*d->callback)(d->user, &ih, d->buf);
+	}
+}
+
+/*
+ * Report how many packets were decapsulated and how many matched
+ * --inner-filter.
+ */
+static void
+print_decap_stats(void)
+{
+	if (decap_filter == NULL && !decap_write_inner)
+		return;
+	(void)fprintf(stderr,
+	    "%" PRIu64 " packet%s decapsulated, %" PRIu64 " packet%s matched\n",
+	    decap.decapsulated, PLURAL_SUFFIX(decap.decapsulated),
+	    decap.matched, PLURAL_SUFFIX(decap.matched));
+}
+
+/*
+ * If the packet to be written has a VNI or VLAN ID to split by, write
+ * "hd" and "spd", what's to be written of it, to the savefile for that,
+ * and return 1; otherwise return 0, for it to be written to the -w
+ * file.
+ */
+static int
+split_dump(const struct pcap_pkthdr *h, const u_char *sp,
+    const struct pcap_pkthdr *hd, const u_char *spd)
+{
+	char ebuf[PCAP_ERRBUF_SIZE];
+	const u_char *inner;
+	uint32_t key;
+	u_int type;
+
+	if (split_by == SPLIT_BY_VNI) {
+		if (decap_filter != NULL || decap_write_inner)
+			key = decap.vni;
+		else
+			(void)decap_find(split_dlt, h, sp, &inner, &key);
+		if (key == DECAP_NO_VNI)
+			return (0);
+	} else {
+		if (split_dlt != DLT_EN10MB || h->caplen < 16)
+			return (0);
+		type = EXTRACT_BE_U_2(sp + 12);
+		if (type != ETHERTYPE_8021Q && type != ETHERTYPE_8021QinQ &&
+		    type != ETHERTYPE_8021Q9100 && type != ETHERTYPE_8021Q9200)
+			return (0);
+		key = EXTRACT_BE_U_2(sp + 14) & 0x0fff;
+	}
+	if (split_savefile_dump(split, key, hd, spd, ebuf) == -1)
+		error("--split-by: %s", ebuf);
+#ifdef HAVE_PCAP_DUMP_FLUSH
+	if (Uflag && split_savefile_flush(split, ebuf) == -1)
+		error("--split-by: %s", ebuf);
 #endif
-				new_dlt = pcap_datalink(pd);
-				if (new_dlt != dlt) {
-					/*
-					 * The new file has a different
-					 * link-layer header type from the
-					 * previous one.
-					 */
-					if (WFileName != NULL) {
-						/*
-						 * We're writing raw packets
-						 * that match the filter to
-						 * a pcap file.  pcap files
-						 * don't support multiple
-						 * different link-layer
-						 * header types, so we fail
-						 * here.
-						 */
-						error("%s: new dlt does not match original", RFileName);
-					}
+	return (1);
+}
 
-					/*
-					 * We're printing the decoded packets;
-					 * switch to the new DLT.
-					 *
-					 * To do that, we need to change
-					 * the printer, change the DLT name,
-					 * and recompile the filter with
-					 * the new DLT.
-					 */
-					dlt = new_dlt;
-					ndo->ndo_if_printer = get_if_printer(ndo, dlt);
-					if (pcap_compile(pd, &fcode, cmdbuf, Oflag, netmask) < 0)
-						error("%s", pcap_geterr(pd));
-				}
+/*
+ * Report how many packets went to the --split-by savefiles, and how
+ * often one had to be closed to make room for another.
+ */
+static void
+print_split_stats(void)
+{
+	struct split_savefile_stats sss;
 
-				/*
-				 * Set the filter on the new file.
-				 */
-				if (pcap_setfilter(pd, &fcode) < 0)
-					error("%s", pcap_geterr(pd));
+	if (split == NULL)
+		return;
+	split_savefile_stats(split, &sss);
+	(void)fprintf(stderr,
+	    "%" PRIu64 " packet%s written to %u split savefile%s, %" PRIu64 " reopen%s\n",
+	    sss.sss_packets, PLURAL_SUFFIX(sss.sss_packets), sss.sss_files,
+	    PLURAL_SUFFIX(sss.sss_files), sss.sss_reopens,
+	    PLURAL_SUFFIX(sss.sss_reopens));
+}
 
-				/*
-				 * Report the new file.
-				 */
-				dlt_name = pcap_datalink_val_to_name(dlt);
-				fprintf(stderr, "reading from file %s", RFileName);
-				if (dlt_name == NULL) {
-					fprintf(stderr, ", link-type %u", dlt);
-				} else {
-					fprintf(stderr, ", link-type %s (%s)",
-						dlt_name,
-						pcap_datalink_val_to_description(dlt));
-				}
-				fprintf(stderr, ", snapshot length %d\n", pcap_snapshot(pd));
-			}
+/*
+ * Report how many of the -C files --follow went through.
+ */
+static void
+print_follow_stats(void)
+{
+#ifdef FOLLOW_READER_SUPPORTED
+	uint64_t files;
+
+	if (follow_name == NULL)
+		return;
+	files = follow_reader != NULL ? follow_reader_files(follow_reader) :
+	    follow_files;
+	(void)fprintf(stderr, "%" PRIu64 " savefile%s followed\n", files,
+	    PLURAL_SUFFIX(files));
+#endif
+}
+
+#ifdef DISSECT_THREADS_SUPPORTED
+/*
+ * Output function for the workers' netdissect_options: append the
+ * output to the slot being dissected.
+ */
+static int
+pipeline_output(netdissect_options *ndo, const char *buf, size_t len)
+{
+	struct pipeline_slot *slot;
+	size_t newsize;
+	char *text;
+
+	slot = ((struct pipeline_worker *)ndo->ndo_output_arg)->slot;
+	if (slot->textsize - slot->textlen < len) {
+		newsize = slot->textsize != 0 ? slot->textsize : 256;
+		while (newsize - slot->textlen < len)
+			newsize *= 2;
+		text = (char *)realloc(slot->text, newsize);
+		if (text == NULL) {
+			errno = ENOMEM;
+			return (-1);
+		}
+		slot->text = text;
+		slot->textsize = newsize;
+	}
+	memcpy(slot->text + slot->textlen, buf, len);
+	slot->textlen += len;
+	return (0);
+}
+
+/*
+ * Output function for the workers' netdissect_options with
+ * --worker-output: write the output to the worker's file.
+ */
+static int
+pipeline_file_output(netdissect_options *ndo, const char *buf, size_t len)
+{
+	struct pipeline_worker *w;
+
+	w = (struct pipeline_worker *)ndo->ndo_output_arg;
+	if (fwrite(buf, 1, len, w->out) != len)
+		return (-1);
+	return (0);
+}
+
+static uint64_t
+pipeline_now(void)
+{
+#ifdef CLOCK_MONOTONIC
+	struct timespec ts;
+
+	(void)clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ((uint64_t)ts.tv_sec * 1000000000 + (uint64_t)ts.tv_nsec);
+#else
+	return ((uint64_t)clock() * (1000000000 / CLOCKS_PER_SEC));
+#endif
+}
+
+static void *
+pipeline_worker_main(void *arg)
+{
+	struct pipeline_worker *w = (struct pipeline_worker *)arg;
+	struct pipeline_slot *slot, *next;
+	uint64_t start;
+
+	if (!w->ndo.ndo_nflag)
+		copy_addrtoname_tables(&w->ndo, w->tables);
+
+	pthread_mutex_lock(&pl_mtx);
+	for (;;) {
+		while (w->qhead == w->qtail)
+			pthread_cond_wait(&w->cv, &pl_mtx);
+		slot = w->queue[w->qhead++ % PIPELINE_SLOTS];
+		slot->state = SLOT_BUSY;
+		next = w->qhead != w->qtail ?
+		    w->queue[w->qhead % PIPELINE_SLOTS] : NULL;
+		pthread_mutex_unlock(&pl_mtx);
+
+		if (next != NULL)
+			prefetch_packet(&w->ndo, next->data, next->hdr.caplen);
+		w->slot = slot;
+		slot->textlen = 0;
+#ifdef ESPSECRET_RELOAD
+		check_espsecret(&w->ndo, &w->espsecret_seen);
+#endif
+		if (degrade)
+			degrade_apply(&w->ndo, &w->degrade_seen);
+		start = pipeline_now();
+		pretty_print_packet(&w->ndo, &slot->hdr, slot->data,
+		    slot->packet_number);
+		w->busy_ns += pipeline_now() - start;
+		w->packets++;
+
+		pthread_mutex_lock(&pl_mtx);
+		if (w->out != NULL) {
+			/* Written already; nothing to wait for. */
+			slot->state = SLOT_FREE;
+			pl_next_emit++;
+			pthread_cond_broadcast(&pl_free_cv);
+			continue;
 		}
+		slot->state = SLOT_DONE;
+		if (slot == &pl_slots[pl_next_emit % PIPELINE_SLOTS])
+			pthread_cond_signal(&pl_emit_cv);
 	}
-	while (ret != NULL);
+	/* NOTREACHED */
+	return (NULL);
+}
 
-	if (count_mode && RFileName != NULL)
-		fprintf(stderr, "%u packet%s\n", packets_captured,
-			PLURAL_SUFFIX(packets_captured));
+static void *
+pipeline_output_main(void *arg _U_)
+{
+	struct pipeline_slot *slot;
+
+	pthread_mutex_lock(&pl_mtx);
+	for (;;) {
+		slot = &pl_slots[pl_next_emit % PIPELINE_SLOTS];
+		while (slot->state != SLOT_DONE)
+			pthread_cond_wait(&pl_emit_cv, &pl_mtx);
+		pthread_mutex_unlock(&pl_mtx);
+
+#ifdef OUTPUT_BUFFER_SUPPORTED
+		if (output_buffer != NULL) {
+			if (output_buffer_write(output_buffer, slot->text,
+			    slot->textlen) == -1)
+				error("Unable to write output: %s",
+				    pcap_strerror(errno));
+		} else
+#endif
+#ifdef SHM_RING_SUPPORTED
+		if (shm_output_ring != NULL) {
+			if (slot->textlen != 0)
+				(void)shm_ring_put_text(shm_output_ring,
+				    slot->text, slot->textlen);
+		} else
+#endif
+		if (fwrite(slot->text, 1, slot->textlen, stdout) !=
+		    slot->textlen)
+			error("Unable to write output: %s",
+			    pcap_strerror(errno));
 
-	free(cmdbuf);
-	pcap_freecode(&fcode);
-	exit_tcpdump(status == -1 ? 1 : 0);
+		pthread_mutex_lock(&pl_mtx);
+		slot->state = SLOT_FREE;
+		pl_next_emit++;
+		pthread_cond_broadcast(&pl_free_cv);
+	}
+	/* NOTREACHED */
+}
+
+static void
+pipeline_start(netdissect_options *ndo, int dlt)
+{
+	const struct addrtoname_tables *tables;
+	struct pipeline_worker *w;
+	char name[PATH_MAX];
+	int i;
+
+	pl_workers = (struct pipeline_worker *)calloc(dissect_threads,
+	    sizeof(*pl_workers));
+	if (pl_workers == NULL)
+		error("pipeline_start: calloc");
+	pl_dlt = dlt;
+	pl_frag_whole = ndo->ndo_ip_reasm_budget != 0;
+	tables = get_addrtoname_tables();
+	for (i = 0; i < dissect_threads; i++) {
+		w = &pl_workers[i];
+		pthread_cond_init(&w->cv, NULL);
+		worker_ndo_init(&w->ndo, ndo);
+		w->ndo.ndo_output = pipeline_output;
+		w->ndo.ndo_output_arg = w;
+		if (worker_output != NULL) {
+			(void)snprintf(name, sizeof(name), "%s.%d",
+			    worker_output, i);
+			w->out = fopen(name, "w");
+			if (w->out == NULL)
+				error("--worker-output: can't create %s: %s",
+				    name, pcap_strerror(errno));
+			(void)setvbuf(w->out, NULL, _IOFBF, 1024 * 1024);
+			w->ndo.ndo_output = pipeline_file_output;
+			/* What the files are merged by. */
+			w->ndo.ndo_packet_number = 1;
+		}
+		w->tables = tables;
+		start_thread(&w->tid, pipeline_worker_main, w, "dissection");
+	}
+	if (worker_output == NULL)
+		start_thread(&pl_output_tid, pipeline_output_main, NULL,
+		    "output");
 }
 
 /*
- * Catch a signal.
+ * Make a copy of ndo for a thread, with its own output buffer and none
+ * of the per-packet buffers of ndo.
  */
 static void
-(*setsignal (int sig, void (*func)(int)))(int)
+worker_ndo_init(netdissect_options *wndo, const netdissect_options *ndo)
 {
-#ifdef _WIN32
-	return (signal(sig, func));
-#else
-	struct sigaction old, new;
-
-	memset(&new, 0, sizeof(new));
-	new.sa_handler = func;
-	if (sig == SIGCHLD)
-		new.sa_flags = SA_RESTART;
-	if (sigaction(sig, &new, &old) < 0)
-		return (SIG_ERR);
-	return (old.sa_handler);
-#endif
+	*wndo = *ndo;
+	wndo->ndo_outbuf = NULL;
+	wndo->ndo_arena = NULL;
+	wndo->ndo_arena_used = 0;
+	wndo->ndo_arena_peak = 0;
+	wndo->ndo_name_cache_hits = 0;
+	wndo->ndo_name_cache_misses = 0;
+	wndo->ndo_packet_info_free = NULL;
+	wndo->ndo_field_buf = NULL;
+	wndo->ndo_field_len = 0;
+	wndo->ndo_field_size = 0;
+	wndo->ndo_state = NULL;
+	wndo->ndo_mem_charged = 0;
+	if (nd_outbuf_init(wndo, ND_OUTBUF_SIZE) == -1)
+		error("worker_ndo_init: malloc");
+	if (ndo->ndo_memo != NULL &&
+	    (wndo->ndo_memo = nd_memo_dup(ndo->ndo_memo)) == NULL)
+		error("worker_ndo_init: malloc");
 }
 
-/* make a clean exit on interrupts */
+/*
+ * Copy a packet into the next slot, waiting for the slot to be written
+ * out if it's still in use, and queue it for the worker that handles
+ * its flow.
+ */
 static void
-cleanup(int signo _U_)
+pipeline_enqueue(const struct pcap_pkthdr *h, const u_char *sp)
 {
-#ifdef _WIN32
-	if (timer_handle != INVALID_HANDLE_VALUE) {
-		DeleteTimerQueueTimer(NULL, timer_handle, NULL);
-		CloseHandle(timer_handle);
-		timer_handle = INVALID_HANDLE_VALUE;
-        }
-#else /* _WIN32 */
-	struct itimerval timer;
+	struct pipeline_worker *w;
+	struct pipeline_slot *slot;
+	u_char *data;
 
-	timer.it_interval.tv_sec = 0;
-	timer.it_interval.tv_usec = 0;
-	timer.it_value.tv_sec = 0;
-	timer.it_value.tv_usec = 0;
-	setitimer(ITIMER_REAL, &timer, NULL);
-#endif /* _WIN32 */
+	w = &pl_workers[flow_hash(pl_dlt, pl_frag_whole, h, sp) %
+	    dissect_threads];
+
+	pthread_mutex_lock(&pl_mtx);
+	slot = &pl_slots[pl_next_fill % PIPELINE_SLOTS];
+	if (slot->state != SLOT_FREE)
+		pl_waits++;
+	while (slot->state != SLOT_FREE)
+		pthread_cond_wait(&pl_free_cv, &pl_mtx);
+	pthread_mutex_unlock(&pl_mtx);
 
-#ifdef HAVE_PCAP_BREAKLOOP
-	/*
-	 * We have "pcap_breakloop()"; use it, so that we do as little
-	 * as possible in the signal handler (it's probably not safe
-	 * to do anything with standard I/O streams in a signal handler -
-	 * the ANSI C standard doesn't say it is).
-	 */
-	pcap_breakloop(pd);
-#else
 	/*
-	 * We don't have "pcap_breakloop()"; this isn't safe, but
-	 * it's the best we can do.  Print the summary if we're
-	 * not reading from a savefile - i.e., if we're doing a
-	 * live capture - and exit.
+	 * The slot isn't in use by any other thread, so it can be
+	 * filled in without holding the lock.
 	 */
-	if (pd != NULL && pcap_file(pd) == NULL) {
-		/*
-		 * We got interrupted, so perhaps we didn't
-		 * manage to finish a line we were printing.
-		 * Print an extra newline, just in case.
-		 */
-		putchar('\n');
-		(void)fflush(stdout);
-		info(1);
+	if (slot->datasize < h->caplen) {
+		data = (u_char *)realloc(slot->data, h->caplen);
+		if (data == NULL)
+			error("pipeline_enqueue: realloc");
+		slot->data = data;
+		slot->datasize = h->caplen;
 	}
-	exit_tcpdump(S_SUCCESS);
-#endif
+	slot->hdr = *h;
+	memcpy(slot->data, sp, h->caplen);
+	slot->packet_number = packets_captured;
+
+	pthread_mutex_lock(&pl_mtx);
+	slot->state = SLOT_QUEUED;
+	pl_next_fill++;
+	if (pl_next_fill - pl_next_emit > pl_peak)
+		pl_peak = pl_next_fill - pl_next_emit;
+	w->queue[w->qtail++ % PIPELINE_SLOTS] = slot;
+	if (w->qtail - w->qhead > w->qpeak)
+		w->qpeak = w->qtail - w->qhead;
+	pthread_cond_signal(&w->cv);
+	pthread_mutex_unlock(&pl_mtx);
 }
 
 /*
-  On windows, we do not use a fork, so we do not care less about
-  waiting a child processes to die
+ * Wait until everything queued so far has been written out, and, with
+ * --worker-output, flush the workers' files, as they're all idle.
  */
-#if defined(HAVE_FORK) || defined(HAVE_VFORK)
 static void
-child_cleanup(int signo _U_)
+pipeline_drain(void)
 {
-  wait(NULL);
+	int i;
+
+	pthread_mutex_lock(&pl_mtx);
+	while (pl_next_emit != pl_next_fill)
+		pthread_cond_wait(&pl_free_cv, &pl_mtx);
+	pthread_mutex_unlock(&pl_mtx);
+	for (i = 0; i < dissect_threads; i++) {
+		if (pl_workers[i].out != NULL &&
+		    fflush(pl_workers[i].out) != 0)
+			error("--worker-output: error writing: %s",
+			    pcap_strerror(errno));
+	}
 }
-#endif /* HAVE_FORK && HAVE_VFORK */
 
+/*
+ * Report, for --dissect-threads, how far behind the capture each stage
+ * got, and what each thread did.  The counters are each written by one
+ * thread and read here without locking, as the --metrics page reads
+ * them; a value may be a packet behind.
+ */
 static void
-info(int verbose)
+print_pipeline_stats(void)
 {
-	struct pcap_stat stats;
+	const struct pipeline_worker *w;
+	uint64_t dissected, lookups;
+	int i;
 
-	/*
-	 * Older versions of libpcap didn't set ps_ifdrop on some
-	 * platforms; initialize it to 0 to handle that.
-	 */
-	stats.ps_ifdrop = 0;
-	if (pcap_stats(pd, &stats) < 0) {
-		(void)fprintf(stderr, "pcap_stats: %s\n", pcap_geterr(pd));
-		infoprint = 0;
+	if (pl_workers == NULL)
 		return;
+	dissected = 0;
+	for (i = 0; i < dissect_threads; i++)
+		dissected += pl_workers[i].packets;
+	(void)fprintf(stderr,
+	    "pipeline %u packet%s queued, %" PRIu64 " dissected, %u written out; peak %u of %u slots, %" PRIu64 " wait%s for a slot\n",
+	    pl_next_fill, PLURAL_SUFFIX(pl_next_fill), dissected,
+	    pl_next_emit, pl_peak, PIPELINE_SLOTS, pl_waits,
+	    PLURAL_SUFFIX(pl_waits));
+	for (i = 0; i < dissect_threads; i++) {
+		w = &pl_workers[i];
+		(void)fprintf(stderr,
+		    "  thread %d: %" PRIu64 " packet%s in %.3f s, queue peak %u, arena peak %zu bytes",
+		    i, w->packets, PLURAL_SUFFIX(w->packets),
+		    (double)w->busy_ns / 1000000000, w->qpeak,
+		    w->ndo.ndo_arena_peak);
+		lookups = w->ndo.ndo_name_cache_hits +
+		    w->ndo.ndo_name_cache_misses;
+		if (lookups != 0)
+			(void)fprintf(stderr,
+			    ", name cache %" PRIu64 " of %" PRIu64 " hit",
+			    w->ndo.ndo_name_cache_hits, lookups);
+		(void)fputc('\n', stderr);
 	}
+}
+#endif /* DISSECT_THREADS_SUPPORTED */
 
-	if (!verbose)
-		fprintf(stderr, "%s: ", program_name);
+#ifdef PRINT_THREAD_SUPPORTED
+static void *
+print_thread_main(void *arg)
+{
+	netdissect_options *ndo = (netdissect_options *)arg;
+	struct pcap_pkthdr h;
+	const u_char *sp, *next;
+	u_int packet_number, caplen;
 
-	(void)fprintf(stderr, "%u packet%s captured", packets_captured,
-	    PLURAL_SUFFIX(packets_captured));
-	if (!verbose)
-		fputs(", ", stderr);
-	else
-		putc('\n', stderr);
-	(void)fprintf(stderr, "%u packet%s received by filter", stats.ps_recv,
-	    PLURAL_SUFFIX(stats.ps_recv));
-	if (!verbose)
-		fputs(", ", stderr);
-	else
-		putc('\n', stderr);
-	(void)fprintf(stderr, "%u packet%s dropped by kernel", stats.ps_drop,
-	    PLURAL_SUFFIX(stats.ps_drop));
-	if (stats.ps_ifdrop != 0) {
-		if (!verbose)
-			fputs(", ", stderr);
-		else
-			putc('\n', stderr);
-		(void)fprintf(stderr, "%u packet%s dropped by interface\n",
-		    stats.ps_ifdrop, PLURAL_SUFFIX(stats.ps_ifdrop));
-	} else
-		putc('\n', stderr);
-	infoprint = 0;
+	if (!ndo->ndo_nflag)
+		copy_addrtoname_tables(ndo, print_tables);
+	for (;;) {
+		sp = packet_ring_get(print_ring, &h, &packet_number);
+		if ((next = packet_ring_peek(print_ring, &caplen)) != NULL)
+			prefetch_packet(ndo, next, caplen);
+		print_dissected(ndo, &h, sp, packet_number);
+		packet_ring_release(print_ring);
+	}
+	/* NOTREACHED */
+	return (NULL);
 }
 
-#if defined(HAVE_FORK) || defined(HAVE_VFORK)
-#ifdef HAVE_FORK
-#define fork_subprocess() fork()
-#else
-#define fork_subprocess() vfork()
-#endif
+/*
+ * From now on, ndo is the print thread's.
+ */
 static void
-compress_savefile(const char *filename)
+print_thread_start(netdissect_options *ndo)
 {
-	pid_t child;
+	char ebuf[PCAP_ERRBUF_SIZE];
 
-	child = fork_subprocess();
-	if (child == -1) {
-		fprintf(stderr,
-			"compress_savefile: fork failed: %s\n",
-			pcap_strerror(errno));
-		return;
+	print_ring = packet_ring_create(print_ring_size, ebuf);
+	if (print_ring == NULL)
+		error("--print-thread: %s", ebuf);
+	print_tables = get_addrtoname_tables();
+	start_thread(&print_tid, print_thread_main, ndo, "dissection");
+}
+#endif /* PRINT_THREAD_SUPPORTED */
+
+#ifdef OUTPUT_BUFFER_SUPPORTED
+/*
+ * Output function for the netdissect_options with --output-thread.
+ */
+static int
+output_thread_output(netdissect_options *ndo _U_, const char *buf,
+    size_t len)
+{
+	return (output_buffer_write(output_buffer, buf, len));
+}
+
+static void
+output_thread_start(netdissect_options *ndo)
+{
+	char ebuf[PCAP_ERRBUF_SIZE];
+
+	/* Anything already printed goes out first. */
+	(void)fflush(stdout);
+	output_buffer = output_buffer_create(fileno(stdout),
+	    output_buffer_size, output_drop, ebuf);
+	if (output_buffer == NULL)
+		error("--output-thread: %s", ebuf);
+	ndo->ndo_output = output_thread_output;
+	start_thread(&output_tid, output_buffer_run, output_buffer, "output");
+}
+#endif /* OUTPUT_BUFFER_SUPPORTED */
+
+#ifdef SHM_RING_SUPPORTED
+/*
+ * Output function for the netdissect_options with --shm-output; the
+ * output for a packet the reader has left no room for is counted.
+ */
+static int
+shm_output(netdissect_options *ndo _U_, const char *buf, size_t len)
+{
+	(void)shm_ring_put_text(shm_output_ring, buf, len);
+	return (0);
+}
+
+static void
+shm_output_start(netdissect_options *ndo)
+{
+	char ebuf[PCAP_ERRBUF_SIZE];
+
+	/* Anything already printed goes out first. */
+	(void)fflush(stdout);
+	shm_output_ring = shm_ring_create(shm_output_name, SHM_RING_OUTPUT,
+	    shm_size, 0, 0, 0, ebuf);
+	if (shm_output_ring == NULL)
+		error("--shm-output: %s", ebuf);
+	ndo->ndo_output = shm_output;
+}
+#endif /* SHM_RING_SUPPORTED */
+
+#ifdef CHUNK_THREADS_SUPPORTED
+/*
+ * Output function for the chunk workers' netdissect_options.
+ */
+static int
+chunk_output(netdissect_options *ndo, const char *buf, size_t len)
+{
+	struct chunk_worker *w = (struct chunk_worker *)ndo->ndo_output_arg;
+
+	if (fwrite(buf, 1, len, w->out) != len)
+		return (-1);
+	return (0);
+}
+
+static void
+chunk_packet(u_char *user, const struct pcap_pkthdr *h, const u_char *sp)
+{
+	struct chunk_worker *w = (struct chunk_worker *)user;
+	struct pcap_pkthdr hw;
+
+	h = hw_tstamp_header(&w->ndo, h, sp, &hw);
+	pretty_print_packet(&w->ndo, h, sp, ++w->npackets);
+}
+
+static void *
+chunk_worker_main(void *arg)
+{
+	struct chunk_worker *w = (struct chunk_worker *)arg;
+
+	if (!w->ndo.ndo_nflag)
+		copy_addrtoname_tables(&w->ndo, w->tables);
+	w->status = mmap_reader_loop(w->mr, 0, w->fcode, chunk_packet,
+	    (u_char *)w, w->ebuf);
+	return (NULL);
+}
+
+/*
+ * Copy a chunk worker's or file job's temporary file to the standard
+ * output.
+ */
+static void
+chunk_copy_output(FILE *f)
+{
+	char buf[65536];
+	size_t n;
+
+	rewind(f);
+	while ((n = fread(buf, 1, sizeof(buf), f)) != 0)
+		if (fwrite(buf, 1, n, stdout) != n)
+			error("Unable to write output: %s",
+			    pcap_strerror(errno));
+	if (ferror(f))
+		error("Unable to read dissected output: %s",
+		    pcap_strerror(errno));
+}
+
+/*
+ * Dissect the savefile fname, which mmap_reader is open on, in chunks
+ * on chunk_threads threads; returns what pcap_loop() would, with the
+ * error in ebuf.  If the chunks turn out to have been split in the
+ * wrong place, the rest of the file is handed to callback instead.
+ */
+static int
+chunk_run(netdissect_options *ndo, const char *fname,
+    const struct bpf_program *fcode, pcap_handler callback, u_char *user,
+    char *ebuf)
+{
+	const struct addrtoname_tables *tables;
+	struct chunk_worker *w, *workers;
+	uint64_t *offsets, resume = 0;
+	int i, j, status = 0, failed = -1;
+
+	offsets = (uint64_t *)calloc(chunk_threads + 1, sizeof(*offsets));
+	workers = (struct chunk_worker *)calloc(chunk_threads,
+	    sizeof(*workers));
+	if (offsets == NULL || workers == NULL)
+		error("chunk_run: calloc");
+	mmap_reader_split(mmap_reader, chunk_threads, offsets);
+	tables = get_addrtoname_tables();
+	for (i = 0; i < chunk_threads; i++) {
+		w = &workers[i];
+		worker_ndo_init(&w->ndo, ndo);
+		w->ndo.ndo_output = chunk_output;
+		w->ndo.ndo_output_arg = w;
+		w->tables = tables;
+		w->fcode = fcode;
+		w->mr = mmap_reader_open(pd, fname, ebuf);
+		if (w->mr == NULL)
+			error("%s", ebuf);
+		mmap_reader_set_range(w->mr, offsets[i], offsets[i + 1]);
+		w->out = i == 0 ? stdout : tmpfile();
+		if (w->out == NULL)
+			error("Unable to create a temporary file: %s",
+			    pcap_strerror(errno));
 	}
-	if (child != 0) {
-		/* Parent process. */
-		return;
+	chunk_workers = workers;
+	for (i = 0; i < chunk_threads; i++)
+		start_thread(&workers[i].tid, chunk_worker_main, &workers[i],
+		    "dissection");
+
+	for (i = 0; i < chunk_threads; i++) {
+		w = &workers[i];
+		pthread_join(w->tid, NULL);
+		nd_outbuf_free(&w->ndo);
+		nd_state_free_all(&w->ndo);
+		memo_release(&w->ndo);
+		if (failed != -1)
+			continue;
+		if (i != 0)
+			chunk_copy_output(w->out);
+		packets_captured += w->npackets;
+		if (w->status != 0) {
+			status = w->status;
+			if (status == -1)
+				(void)strlcpy(ebuf, w->ebuf, PCAP_ERRBUF_SIZE);
+			failed = i;
+		} else if (i + 1 < chunk_threads &&
+		    mmap_reader_offset(w->mr) != offsets[i + 1]) {
+			/*
+			 * The next chunk didn't start at a record;
+			 * stop the rest and read on from here.
+			 */
+			resume = mmap_reader_offset(w->mr);
+			failed = i;
+			for (j = i + 1; j < chunk_threads; j++)
+				mmap_reader_breakloop(workers[j].mr);
+		}
 	}
+	chunk_workers = NULL;
+	for (i = 0; i < chunk_threads; i++) {
+		w = &workers[i];
+		if (i != 0)
+			(void)fclose(w->out);
+		mmap_reader_close(w->mr);
+	}
+	free(workers);
 
-	/*
-	 * Child process.
-	 * Set to lowest priority so that this doesn't disturb the capture.
-	 */
-#ifdef NZERO
-	setpriority(PRIO_PROCESS, 0, NZERO - 1);
+	if (status == 0 && failed != -1) {
+		(void)fflush(stdout);
+		(void)fprintf(stderr,
+		    "%s: chunk %d of %s didn't start at a packet; reading the rest on one thread\n",
+		    program_name, failed + 2, fname);
+		mmap_reader_set_range(mmap_reader, resume, offsets[chunk_threads]);
+		status = mmap_reader_loop(mmap_reader, 0, fcode, callback,
+		    user, ebuf);
+	}
+	free(offsets);
+	return (status);
+}
+#endif /* CHUNK_THREADS_SUPPORTED */
+
+/*
+ * Open the savefile fname for reading.  One compressed with gzip or
+ * zstd is read through a decompressor; *zfdp, if zfdp isn't NULL, is
+ * then set to the descriptor of the compressed file, and otherwise to
+ * -1.
+ */
+static pcap_t *
+open_savefile(netdissect_options *ndo _U_, const char *fname, int *zfdp,
+    char *ebuf)
+{
+#ifdef COMPRESSED_READER_SUPPORTED
+	struct compressed_reader *cr;
+	FILE *fp;
+	pcap_t *pc;
+#endif
+
+	if (zfdp != NULL)
+		*zfdp = -1;
+#ifdef FOLLOW_READER_SUPPORTED
+	if (follow) {
+		FILE *ffp;
+		pcap_t *fpc;
+
+#ifdef COMPRESSED_READER_SUPPORTED
+		/* What's compressed can't be read before it's finished. */
+		if (compressed_reader_probe(fname)) {
+			snprintf(ebuf, PCAP_ERRBUF_SIZE,
+			    "--follow can not be used with a compressed savefile");
+			return (NULL);
+		}
+#endif
+		follow_reader = follow_reader_open(fname,
+		    follow_name != NULL ? follow_next_name : NULL, NULL, ebuf);
+		if (follow_reader == NULL)
+			return (NULL);
+		ffp = follow_reader_file(follow_reader);
+#ifdef HAVE_PCAP_SET_TSTAMP_PRECISION
+		fpc = pcap_fopen_offline_with_tstamp_precision(ffp,
+		    ndo->ndo_tstamp_precision, ebuf);
 #else
-	setpriority(PRIO_PROCESS, 0, 19);
+		fpc = pcap_fopen_offline(ffp, ebuf);
+#endif
+		if (fpc == NULL) {
+			/* This frees the reader. */
+			follow_reader = NULL;
+			(void)fclose(ffp);
+		}
+		return (fpc);
+	}
+#endif
+#ifdef COMPRESSED_READER_SUPPORTED
+	if (compressed_reader_probe(fname)) {
+		cr = compressed_reader_open(fname, decompress_threads, ebuf);
+		if (cr == NULL)
+			return (NULL);
+		fp = compressed_reader_file(cr);
+#ifdef HAVE_PCAP_SET_TSTAMP_PRECISION
+		pc = pcap_fopen_offline_with_tstamp_precision(fp,
+		    ndo->ndo_tstamp_precision, ebuf);
+#else
+		pc = pcap_fopen_offline(fp, ebuf);
+#endif
+		if (pc == NULL) {
+			/* This frees the reader. */
+			(void)fclose(fp);
+			return (NULL);
+		}
+		if (zfdp != NULL)
+			*zfdp = compressed_reader_fd(cr);
+		return (pc);
+	}
 #endif
-	if (execlp(zflag, zflag, filename, (char *)NULL) == -1)
-		fprintf(stderr,
-			"compress_savefile: execlp(%s, %s) failed: %s\n",
-			zflag,
-			filename,
-			pcap_strerror(errno));
-#ifdef HAVE_FORK
-	exit(S_ERR_HOST_PROGRAM);
+#ifdef HAVE_PCAP_SET_TSTAMP_PRECISION
+	return (pcap_open_offline_with_tstamp_precision(fname,
+	    ndo->ndo_tstamp_precision, ebuf));
 #else
-	_exit(S_ERR_HOST_PROGRAM);
+	return (pcap_open_offline(fname, ebuf));
 #endif
 }
-#else  /* HAVE_FORK && HAVE_VFORK */
-static void
-compress_savefile(const char *filename)
+
+#ifdef FILE_THREADS_SUPPORTED
+/*
+ * Output function for the file jobs' netdissect_options.
+ */
+static int
+file_output(netdissect_options *ndo, const char *buf, size_t len)
 {
-	fprintf(stderr,
-		"compress_savefile failed. Functionality not implemented under your system\n");
+	struct file_job *job = (struct file_job *)ndo->ndo_output_arg;
+	char *rec;
+	size_t size;
+
+	if (!merge_by_time) {
+		if (fwrite(buf, 1, len, job->out) != len)
+			return (-1);
+		return (0);
+	}
+	if (job->reclen + len > job->recsize) {
+		size = job->recsize != 0 ? job->recsize : 1024;
+		while (size < job->reclen + len)
+			size *= 2;
+		rec = (char *)realloc(job->rec, size);
+		if (rec == NULL)
+			return (-1);
+		job->rec = rec;
+		job->recsize = size;
+	}
+	memcpy(job->rec + job->reclen, buf, len);
+	job->reclen += len;
+	return (0);
 }
-#endif /* HAVE_FORK && HAVE_VFORK */
 
 static void
-dump_packet_and_trunc(u_char *user, const struct pcap_pkthdr *h, const u_char *sp)
+file_packet(u_char *user, const struct pcap_pkthdr *h, const u_char *sp)
 {
-	struct dump_info *dump_info;
+	struct file_job *job = (struct file_job *)user;
+	struct file_record r;
+	struct pcap_pkthdr hw;
+
+	h = hw_tstamp_header(&job->ndo, h, sp, &hw);
+	job->reclen = 0;
+	pretty_print_packet(&job->ndo, h, sp, ++job->npackets);
+	if (merge_by_time) {
+		r.ts = job->ndo.ndo_packet_ts;
+		r.len = job->reclen;
+		if (fwrite(&r, sizeof(r), 1, job->out) != 1 ||
+		    fwrite(job->rec, 1, r.len, job->out) != r.len)
+			error("Unable to write dissected output: %s",
+			    pcap_strerror(errno));
+	}
+}
 
-	++packets_captured;
+static void *
+file_job_main(void *arg)
+{
+	struct file_job *job = (struct file_job *)arg;
 
-	++infodelay;
+	if (!job->ndo.ndo_nflag)
+		copy_addrtoname_tables(&job->ndo, job->tables);
+	job->status = pcap_loop(job->pd, -1, file_packet, (u_char *)job);
+	return (NULL);
+}
 
-	dump_info = (struct dump_info *)user;
+/*
+ * Open the savefile fname for a job, reporting it as the main loop
+ * does, and set the filter on it; returns NULL, with the error in
+ * ebuf, if that can't be done.
+ */
+static pcap_t *
+file_open(netdissect_options *ndo, const char *fname, char *cmdbuf,
+    int Oflag, bpf_u_int32 netmask, char *ebuf)
+{
+	struct bpf_program fcode;
+	const char *dlt_name;
+	pcap_t *pc;
+	int dlt;
 
-	/*
-	 * XXX - this won't force the file to rotate on the specified time
-	 * boundary, but it will rotate on the first packet received after the
-	 * specified Gflag number of seconds. Note: if a Gflag time boundary
-	 * and a Cflag size boundary coincide, the time rotation will occur
-	 * first thereby cancelling the Cflag boundary (since the file should
-	 * be 0).
-	 */
-	if (Gflag != 0) {
-		/* Check if it is time to rotate */
-		time_t t;
+	pc = open_savefile(ndo, fname, NULL, ebuf);
+	if (pc == NULL)
+		return (NULL);
+	dlt = pcap_datalink(pc);
+	dlt_name = pcap_datalink_val_to_name(dlt);
+	fprintf(stderr, "reading from file %s", fname);
+	if (dlt_name == NULL) {
+		fprintf(stderr, ", link-type %u", dlt);
+	} else {
+		fprintf(stderr, ", link-type %s (%s)", dlt_name,
+			pcap_datalink_val_to_description(dlt));
+	}
+	fprintf(stderr, ", snapshot length %d\n", pcap_snapshot(pc));
+	if (pcap_compile(pc, &fcode, cmdbuf, Oflag, netmask) < 0) {
+		(void)strlcpy(ebuf, pcap_geterr(pc), PCAP_ERRBUF_SIZE);
+		pcap_close(pc);
+		return (NULL);
+	}
+	if (pcap_setfilter(pc, &fcode) < 0) {
+		(void)strlcpy(ebuf, pcap_geterr(pc), PCAP_ERRBUF_SIZE);
+		pcap_freecode(&fcode);
+		pcap_close(pc);
+		return (NULL);
+	}
+	pcap_freecode(&fcode);
+	return (pc);
+}
 
-		/* Get the current time */
-		if ((t = time(NULL)) == (time_t)-1) {
-			error("dump_and_trunc_packet: can't get current_time: %s",
-			    pcap_strerror(errno));
-		}
+/*
+ * Order of two records in the --merge-by-time heap.
+ */
+static int
+file_record_before(const struct file_record *heads, u_int a, u_int b)
+{
+	if (heads[a].ts != heads[b].ts)
+		return (heads[a].ts < heads[b].ts);
+	return (a < b);
+}
 
+static void
+file_heap_down(u_int *heap, u_int n, u_int i, const struct file_record *heads)
+{
+	u_int c, t;
 
-		/* If the time is greater than the specified window, rotate */
-		if (t - Gflag_time >= Gflag) {
-#ifdef HAVE_CAPSICUM
-			FILE *fp;
-			int fd;
-#endif
+	while ((c = 2 * i + 1) < n) {
+		if (c + 1 < n && file_record_before(heads, heap[c + 1], heap[c]))
+			c++;
+		if (!file_record_before(heads, heap[c], heap[i]))
+			break;
+		t = heap[i];
+		heap[i] = heap[c];
+		heap[c] = t;
+		i = c;
+	}
+}
 
-			/* Update the Gflag_time */
-			Gflag_time = t;
-			/* Update Gflag_count */
-			Gflag_count++;
-			/*
-			 * Close the current file and open a new one.
-			 */
-			pcap_dump_close(dump_info->pdd);
+/*
+ * Read the header of the next record of a --merge-by-time temporary
+ * file; returns 0 at the end of it.
+ */
+static int
+file_record_read(FILE *f, struct file_record *r)
+{
+	if (fread(r, sizeof(*r), 1, f) == 1)
+		return (1);
+	if (ferror(f))
+		error("Unable to read dissected output: %s",
+		    pcap_strerror(errno));
+	return (0);
+}
 
-			/*
-			 * Compress the file we just closed, if the user asked for it
-			 */
-			if (zflag != NULL)
-				compress_savefile(dump_info->CurrentFileName);
+/*
+ * Write the records of the --merge-by-time temporary files to the
+ * standard output in time stamp order, and close the files.
+ */
+static void
+file_merge(FILE **outs, u_int nouts)
+{
+	struct file_record *heads;
+	u_int *heap, n, i;
+	char *buf = NULL, *p;
+	size_t bufsize = 0;
+	FILE *f;
+
+	heads = (struct file_record *)calloc(nouts, sizeof(*heads));
+	heap = (u_int *)calloc(nouts, sizeof(*heap));
+	if (nouts != 0 && (heads == NULL || heap == NULL))
+		error("file_merge: calloc");
+	n = 0;
+	for (i = 0; i < nouts; i++) {
+		rewind(outs[i]);
+		if (file_record_read(outs[i], &heads[i]))
+			heap[n++] = i;
+	}
+	i = n / 2;
+	while (i-- != 0)
+		file_heap_down(heap, n, i, heads);
+
+	while (n != 0) {
+		i = heap[0];
+		f = outs[i];
+		if (heads[i].len > bufsize) {
+			p = (char *)realloc(buf, heads[i].len);
+			if (p == NULL)
+				error("file_merge: realloc");
+			buf = p;
+			bufsize = heads[i].len;
+		}
+		if (fread(buf, 1, heads[i].len, f) != heads[i].len)
+			error("Unable to read dissected output: %s",
+			    ferror(f) ? pcap_strerror(errno) : "truncated");
+		if (fwrite(buf, 1, heads[i].len, stdout) != heads[i].len)
+			error("Unable to write output: %s",
+			    pcap_strerror(errno));
+		if (!file_record_read(f, &heads[i]))
+			heap[0] = heap[--n];
+		file_heap_down(heap, n, 0, heads);
+	}
+	for (i = 0; i < nouts; i++)
+		(void)fclose(outs[i]);
+	free(buf);
+	free(heap);
+	free(heads);
+}
 
-			/*
-			 * Check to see if we've exceeded the Wflag (when
-			 * not using Cflag).
-			 */
-			if (Cflag == 0 && Wflag > 0 && Gflag_count >= Wflag) {
-				(void)fprintf(stderr, "Maximum file limit reached: %d\n",
-				    Wflag);
-				info(1);
-				exit_tcpdump(S_SUCCESS);
-				/* NOTREACHED */
+/*
+ * Dissect the savefile pd is open on and the rest of those listed in
+ * VFile on file_threads threads; returns what pcap_loop() would for
+ * the first of them that didn't finish, having reported any error.
+ */
+static int
+file_run(netdissect_options *ndo, FILE *VFile, char *cmdbuf, int Oflag,
+    bpf_u_int32 netmask)
+{
+	const struct addrtoname_tables *tables;
+	char fname[PATH_MAX + 1], ebuf[PCAP_ERRBUF_SIZE];
+	struct file_job *job;
+	FILE **outs = NULL, **p;
+	u_int started = 0, joined = 0, nouts = 0;
+	int i, status = 0, more = 1, failed = 0;
+
+	file_jobs = (struct file_job *)calloc(file_threads,
+	    sizeof(*file_jobs));
+	if (file_jobs == NULL)
+		error("file_run: calloc");
+	tables = get_addrtoname_tables();
+
+	for (;;) {
+		/*
+		 * Keep file_threads savefiles being read, unless
+		 * reading one has failed or been interrupted.  If one
+		 * can't be opened, those before it are finished and
+		 * written out before giving up, as they are without
+		 * --file-threads.
+		 */
+		while (status == 0 && more &&
+		    started - joined < (u_int)file_threads) {
+			job = &file_jobs[started % file_threads];
+			if (started == 0)
+				job->pd = pd;
+			else if (get_next_file(VFile, fname) != NULL) {
+				job->pd = file_open(ndo, fname, cmdbuf, Oflag,
+				    netmask, ebuf);
+				if (job->pd == NULL) {
+					more = 0;
+					failed = 1;
+					break;
+				}
+			} else {
+				more = 0;
+				break;
 			}
-			if (dump_info->CurrentFileName != NULL)
-				free(dump_info->CurrentFileName);
-			/* Allocate space for max filename + \0. */
-			dump_info->CurrentFileName = (char *)malloc(PATH_MAX + 1);
-			if (dump_info->CurrentFileName == NULL)
-				error("dump_packet_and_trunc: malloc");
-			/*
-			 * Gflag was set otherwise we wouldn't be here. Reset the count
-			 * so multiple files would end with 1,2,3 in the filename.
-			 * The counting is handled with the -C flow after this.
-			 */
-			Cflag_count = 0;
+			worker_ndo_init(&job->ndo, ndo);
+			job->ndo.ndo_output = file_output;
+			job->ndo.ndo_output_arg = job;
+			job->ndo.ndo_if_printer = get_if_printer(&job->ndo,
+			    pcap_datalink(job->pd));
+			job->tables = tables;
+			job->npackets = 0;
+			job->out = started == 0 && !merge_by_time ?
+			    stdout : tmpfile();
+			if (job->out == NULL)
+				error("Unable to create a temporary file: %s",
+				    pcap_strerror(errno));
+			start_thread(&job->tid, file_job_main, job,
+			    "dissection");
+			started++;
+		}
+		if (joined == started)
+			break;
 
+		job = &file_jobs[joined % file_threads];
+		pthread_join(job->tid, NULL);
+		nd_outbuf_free(&job->ndo);
+		nd_state_free_all(&job->ndo);
+		memo_release(&job->ndo);
+		if (status != 0) {
 			/*
-			 * This is always the first file in the Cflag
-			 * rotation: e.g. 0
-			 * We also don't need numbering if Cflag is not set.
+			 * One before this one failed or was interrupted;
+			 * what this one printed isn't written out.
 			 */
-			if (Cflag != 0)
-				MakeFilename(dump_info->CurrentFileName, dump_info->WFileName, 0,
-				    WflagChars);
-			else
-				MakeFilename(dump_info->CurrentFileName, dump_info->WFileName, 0, 0);
-
-#ifdef HAVE_LIBCAP_NG
-			capng_update(CAPNG_ADD, CAPNG_EFFECTIVE, CAP_DAC_OVERRIDE);
-			capng_apply(CAPNG_SELECT_BOTH);
-#endif /* HAVE_LIBCAP_NG */
-#ifdef HAVE_CAPSICUM
-			fd = openat(dump_info->dirfd,
-			    dump_info->CurrentFileName,
-			    O_CREAT | O_WRONLY | O_TRUNC, 0644);
-			if (fd < 0) {
-				error("unable to open file %s",
-				    dump_info->CurrentFileName);
+			(void)fclose(job->out);
+		} else {
+			packets_captured += job->npackets;
+			if (merge_by_time) {
+				p = (FILE **)realloc(outs,
+				    (nouts + 1) * sizeof(*outs));
+				if (p == NULL)
+					error("file_run: realloc");
+				outs = p;
+				outs[nouts++] = job->out;
+			} else if (job->out != stdout) {
+				chunk_copy_output(job->out);
+				(void)fclose(job->out);
 			}
-			fp = fdopen(fd, "w");
-			if (fp == NULL) {
-				error("unable to fdopen file %s",
-				    dump_info->CurrentFileName);
+			if (job->status != 0) {
+				status = job->status;
+				if (status == -1)
+					(void)fprintf(stderr,
+					    "%s: pcap_loop: %s\n",
+					    program_name, pcap_geterr(job->pd));
+				for (i = 0; i < file_threads; i++)
+					if (file_jobs[i].pd != NULL &&
+					    &file_jobs[i] != job)
+						pcap_breakloop(file_jobs[i].pd);
 			}
-			dump_info->pdd = pcap_dump_fopen(dump_info->pd, fp);
-#else	/* !HAVE_CAPSICUM */
-			dump_info->pdd = pcap_dump_open(dump_info->pd, dump_info->CurrentFileName);
+		}
+		if (job->pd != pd) {
+			pcap_t *pc = job->pd;
+
+			job->pd = NULL;
+			pcap_close(pc);
+		}
+		joined++;
+	}
+	if (merge_by_time)
+		file_merge(outs, nouts);
+	free(outs);
+
+	for (i = 0; i < file_threads; i++)
+		free(file_jobs[i].rec);
+	free(file_jobs);
+	file_jobs = NULL;
+	if (status == -2)
+		putchar('\n');
+	(void)fflush(stdout);
+	pcap_close(pd);
+	if (failed && status == 0)
+		error("%s", ebuf);
+	return (status);
+}
+#endif /* FILE_THREADS_SUPPORTED */
+
+#ifdef MULTI_IFACE_SUPPORTED
+/*
+ * Open the interfaces given with -i other than the first, which has
+ * been opened as pd, in the same way.
+ */
+static void
+multi_open(netdissect_options *ndo, const char *device, char *ebuf)
+{
+	struct multi_iface *mi;
+#ifdef HAVE_PCAP_FINDALLDEVS
+	long devnum;
 #endif
-#ifdef HAVE_LIBCAP_NG
-			capng_update(CAPNG_DROP, CAPNG_EFFECTIVE, CAP_DAC_OVERRIDE);
-			capng_apply(CAPNG_SELECT_BOTH);
-#endif /* HAVE_LIBCAP_NG */
-			if (dump_info->pdd == NULL)
-				error("%s", pcap_geterr(pd));
-#ifdef HAVE_CAPSICUM
-			set_dumper_capsicum_rights(dump_info->pdd);
+	int i;
+
+	multi_ifaces = (struct multi_iface *)calloc(multi_ndevices,
+	    sizeof(*multi_ifaces));
+	if (multi_ifaces == NULL)
+		error("multi_open: calloc");
+	multi_ifaces[0].name = device;
+	multi_ifaces[0].pd = pd;
+#ifdef FANOUT_SUPPORTED
+	if (fanout_count != 0) {
+		fanout_join(pd, device);
+		for (i = 1; i < multi_ndevices; i++) {
+			mi = &multi_ifaces[i];
+			mi->name = device;
+			mi->pd = open_interface(device, ndo, ebuf);
+			if (mi->pd == NULL)
+				error("%s", ebuf);
+			fanout_join(mi->pd, device);
+		}
+		return;
+	}
 #endif
+	for (i = 1; i < multi_ndevices; i++) {
+		mi = &multi_ifaces[i];
+		mi->name = multi_devices[i];
+		mi->pd = open_interface(mi->name, ndo, ebuf);
+#ifdef HAVE_PCAP_FINDALLDEVS
+		/* As with the first, it may be an interface number. */
+		if (mi->pd == NULL &&
+		    (devnum = parse_interface_number(mi->name)) != -1) {
+			mi->name = find_interface_by_number(mi->name, devnum);
+			mi->pd = open_interface(mi->name, ndo, ebuf);
 		}
+#endif
+		if (mi->pd == NULL)
+			error("%s", ebuf);
 	}
+}
 
-	/*
-	 * XXX - this won't prevent capture files from getting
-	 * larger than Cflag - the last packet written to the
-	 * file could put it over Cflag.
-	 */
-	if (Cflag != 0) {
-#ifdef HAVE_PCAP_DUMP_FTELL64
-		int64_t size = pcap_dump_ftell64(dump_info->pdd);
+/*
+ * Whether the interfaces are all one, opened for --fanout.
+ */
+static int
+multi_fanout(void)
+{
+#ifdef FANOUT_SUPPORTED
+	return (fanout_count != 0);
 #else
-		/*
-		 * XXX - this only handles a Cflag value > 2^31-1 on
-		 * LP64 platforms; to handle ILP32 (32-bit UN*X and
-		 * Windows) or LLP64 (64-bit Windows) would require
-		 * a version of libpcap with pcap_dump_ftell64().
-		 */
-		long size = pcap_dump_ftell(dump_info->pdd);
+	return (0);
 #endif
+}
 
-		if (size == -1)
-			error("ftell fails on output file");
-		if (size > Cflag) {
-#ifdef HAVE_CAPSICUM
-			FILE *fp;
-			int fd;
+#ifdef FANOUT_SUPPORTED
+/*
+ * Put the socket of "pc" in this process's fanout group, creating the
+ * group if it's the first.
+ */
+static void
+fanout_join(pcap_t *pc, const char *device)
+{
+	uint32_t arg;
+
+	arg = ((uint32_t)getpid() & 0xffff) | ((uint32_t)fanout_mode << 16);
+#ifdef PACKET_FANOUT_FLAG_DEFRAG
+	/* Hash fragments on the reassembled datagram, so they stay together. */
+	if (fanout_mode == PACKET_FANOUT_HASH)
+		arg |= (uint32_t)PACKET_FANOUT_FLAG_DEFRAG << 16;
 #endif
+	if (setsockopt(pcap_fileno(pc), SOL_PACKET, PACKET_FANOUT, &arg,
+	    sizeof(arg)) == -1)
+		error("%s: can't join the fanout group: %s", device,
+		    pcap_strerror(errno));
+}
+#endif /* FANOUT_SUPPORTED */
 
-			/*
-			 * Close the current file and open a new one.
-			 */
-			pcap_dump_close(dump_info->pdd);
+/*
+ * Compile the filter for, and set it on, the interfaces other than
+ * the first, as their link-layer header types may differ from its.
+ */
+static void
+multi_setfilter(char *cmdbuf, int Oflag, bpf_u_int32 netmask)
+{
+	struct bpf_program fcode;
+	struct multi_iface *mi;
+	int i;
+
+	for (i = 1; i < multi_ndevices; i++) {
+		mi = &multi_ifaces[i];
+		if (pcap_compile(mi->pd, &fcode, cmdbuf, Oflag, netmask) < 0)
+			error("%s: %s", mi->name, pcap_geterr(mi->pd));
+		if (pcap_setfilter(mi->pd, &fcode) < 0)
+			error("%s: %s", mi->name, pcap_geterr(mi->pd));
+		pcap_freecode(&fcode);
+	}
+}
+
+static void
+multi_capture_packet(u_char *user, const struct pcap_pkthdr *h,
+    const u_char *sp)
+{
+	struct multi_iface *mi = (struct multi_iface *)user;
+	struct multi_packet *mp;
+
+	mp = (struct multi_packet *)malloc(sizeof(*mp) + h->caplen);
+	if (mp == NULL)
+		error("multi_capture_packet: malloc");
+	mp->next = NULL;
+	mp->hdr = *h;
+	memcpy(mp + 1, sp, h->caplen);
+	/* It's printed with its hardware time stamp, so merge by that. */
+	if (pcap_datalink(mi->pd) != DLT_EN10MB ||
+	    !hw_tstamp_get(h, sp, &mp->key))
+		mp->key = h->ts;
+	(void)gettimeofday(&mp->queued, NULL);
+
+	pthread_mutex_lock(&multi_mtx);
+	while (mi->nqueued >= MULTI_MAX_QUEUED && !multi_stopping)
+		pthread_cond_wait(&multi_room_cv, &multi_mtx);
+	if (multi_stopping) {
+		pthread_mutex_unlock(&multi_mtx);
+		free(mp);
+		return;
+	}
+	if (mi->tail != NULL)
+		mi->tail->next = mp;
+	else
+		mi->head = mp;
+	mi->tail = mp;
+	if (mi->nqueued++ == 0)
+		pthread_cond_signal(&multi_cv);
+	pthread_mutex_unlock(&multi_mtx);
+}
+
+static void *
+multi_capture_main(void *arg)
+{
+	struct multi_iface *mi = (struct multi_iface *)arg;
+
+	mi->status = pcap_loop(mi->pd, -1, multi_capture_packet,
+	    (u_char *)mi);
+	pthread_mutex_lock(&multi_mtx);
+	mi->running = 0;
+	pthread_cond_signal(&multi_cv);
+	pthread_mutex_unlock(&multi_mtx);
+	return (NULL);
+}
+
+/*
+ * Pick the interface with the packet to be handled next, or return -1
+ * if that has to wait, setting *deadline to when to give up waiting
+ * for the interfaces with no packets queued, or to 0 if there's no
+ * packet to give up waiting for; called with multi_mtx held.
+ */
+static int
+multi_next(const struct timeval *now, int hold_ms, struct timeval *deadline)
+{
+	const struct multi_iface *mi;
+	int i, best = -1, waiting = 0;
+
+	for (i = 0; i < multi_ndevices; i++) {
+		mi = &multi_ifaces[i];
+		if (mi->head == NULL) {
+			if (mi->running)
+				waiting = 1;
+			continue;
+		}
+		if (best == -1 ||
+		    timercmp(&mi->head->key,
+		    &multi_ifaces[best].head->key, <))
+			best = i;
+	}
+	timerclear(deadline);
+	if (best == -1 || !waiting)
+		return (best);
+	deadline->tv_sec = multi_ifaces[best].head->queued.tv_sec +
+	    hold_ms / 1000;
+	deadline->tv_usec = multi_ifaces[best].head->queued.tv_usec +
+	    (hold_ms % 1000) * 1000;
+	if (deadline->tv_usec >= 1000000) {
+		deadline->tv_sec++;
+		deadline->tv_usec -= 1000000;
+	}
+	return (timercmp(now, deadline, <) ? -1 : best);
+}
+
+/*
+ * Capture on all the interfaces, handing the packets to the callback
+ * in time stamp order, up to cnt of them if cnt > 0; returns what
+ * pcap_loop() would, with any error in ebuf.  printing says whether
+ * the packets are being dissected.
+ */
+static int
+multi_run(netdissect_options *ndo, int cnt, pcap_handler callback,
+    u_char *user, int printing, char *ebuf)
+{
+	struct multi_iface *mi;
+	struct multi_packet *mp;
+	struct timeval now, deadline;
+	struct timespec ts;
+	const char *dlt_name;
+	int i, dlt, hold_ms, handled = 0, status = 0;
+
+	for (i = 0; i < multi_ndevices; i++) {
+		mi = &multi_ifaces[i];
+		dlt = pcap_datalink(mi->pd);
+		if (i != 0 && !multi_fanout()) {
+			dlt_name = pcap_datalink_val_to_name(dlt);
+			(void)fprintf(stderr, "%s: listening on %s",
+			    program_name, mi->name);
+			if (dlt_name == NULL)
+				(void)fprintf(stderr, ", link-type %u", dlt);
+			else
+				(void)fprintf(stderr, ", link-type %s (%s)",
+				    dlt_name,
+				    pcap_datalink_val_to_description(dlt));
+			(void)fprintf(stderr, ", snapshot length %d bytes\n",
+			    pcap_snapshot(mi->pd));
+		}
+		if (printing) {
+			mi->printer = get_if_printer(ndo, dlt);
+			mi->void_printer = ndo->ndo_void_printer;
+			mi->printer_name = ndo->ndo_if_printer_name;
+		}
+	}
+	(void)fflush(stderr);
+
+	hold_ms = (immediate_mode ? 0 : timeout) + MULTI_HOLD_MS;
+	for (i = 0; i < multi_ndevices; i++) {
+		multi_ifaces[i].running = 1;
+		start_thread(&multi_ifaces[i].tid, multi_capture_main,
+		    &multi_ifaces[i], "capture");
+	}
+
+	pthread_mutex_lock(&multi_mtx);
+	for (;;) {
+		(void)gettimeofday(&now, NULL);
+		i = multi_next(&now, hold_ms, &deadline);
+		if (i == -1) {
+			if (timerisset(&deadline)) {
+				ts.tv_sec = deadline.tv_sec;
+				ts.tv_nsec = deadline.tv_usec * 1000;
+				pthread_cond_timedwait(&multi_cv, &multi_mtx,
+				    &ts);
+				continue;
+			}
+			for (i = 0; i < multi_ndevices; i++)
+				if (multi_ifaces[i].running)
+					break;
+			if (i == multi_ndevices)
+				break;		/* all finished, and drained */
+			pthread_cond_wait(&multi_cv, &multi_mtx);
+			continue;
+		}
+		mi = &multi_ifaces[i];
+		mp = mi->head;
+		if ((mi->head = mp->next) == NULL)
+			mi->tail = NULL;
+		if (mi->nqueued-- == MULTI_MAX_QUEUED)
+			pthread_cond_broadcast(&multi_room_cv);
+		pthread_mutex_unlock(&multi_mtx);
+
+		pcapng_ifid = (u_int)i;
+		if (printing) {
+			ndo->ndo_if_printer = mi->printer;
+			ndo->ndo_void_printer = mi->void_printer;
+			ndo->ndo_if_printer_name = mi->printer_name;
+			if (!multi_fanout())
+				ndo->ndo_ifname = mi->name;
+		}
+		(*callback)(user, &mp->hdr, (const u_char *)(mp + 1));
+		free(mp);
 
+		pthread_mutex_lock(&multi_mtx);
+		if (cnt > 0 && ++handled >= cnt && !multi_stopping) {
 			/*
-			 * Compress the file we just closed, if the user
-			 * asked for it.
+			 * That's all of them; stop capturing, and throw
+			 * away what's queued.
 			 */
-			if (zflag != NULL)
-				compress_savefile(dump_info->CurrentFileName);
-
-			Cflag_count++;
-			if (Wflag > 0) {
-				if (Cflag_count >= Wflag)
-					Cflag_count = 0;
-			}
-			if (dump_info->CurrentFileName != NULL)
-				free(dump_info->CurrentFileName);
-			dump_info->CurrentFileName = (char *)malloc(PATH_MAX + 1);
-			if (dump_info->CurrentFileName == NULL)
-				error("dump_packet_and_trunc: malloc");
-			MakeFilename(dump_info->CurrentFileName, dump_info->WFileName, Cflag_count, WflagChars);
-#ifdef HAVE_LIBCAP_NG
-			capng_update(CAPNG_ADD, CAPNG_EFFECTIVE, CAP_DAC_OVERRIDE);
-			capng_apply(CAPNG_SELECT_BOTH);
-#endif /* HAVE_LIBCAP_NG */
-#ifdef HAVE_CAPSICUM
-			fd = openat(dump_info->dirfd, dump_info->CurrentFileName,
-			    O_CREAT | O_WRONLY | O_TRUNC, 0644);
-			if (fd < 0) {
-				error("unable to open file %s",
-				    dump_info->CurrentFileName);
-			}
-			fp = fdopen(fd, "w");
-			if (fp == NULL) {
-				error("unable to fdopen file %s",
-				    dump_info->CurrentFileName);
+			multi_stopping = 1;
+			pthread_cond_broadcast(&multi_room_cv);
+			for (i = 0; i < multi_ndevices; i++) {
+				mi = &multi_ifaces[i];
+				pcap_breakloop(mi->pd);
+				while ((mp = mi->head) != NULL) {
+					mi->head = mp->next;
+					free(mp);
+				}
+				mi->tail = NULL;
+				mi->nqueued = 0;
 			}
-			dump_info->pdd = pcap_dump_fopen(dump_info->pd, fp);
-#else	/* !HAVE_CAPSICUM */
-			dump_info->pdd = pcap_dump_open(dump_info->pd, dump_info->CurrentFileName);
-#endif
-#ifdef HAVE_LIBCAP_NG
-			capng_update(CAPNG_DROP, CAPNG_EFFECTIVE, CAP_DAC_OVERRIDE);
-			capng_apply(CAPNG_SELECT_BOTH);
-#endif /* HAVE_LIBCAP_NG */
-			if (dump_info->pdd == NULL)
-				error("%s", pcap_geterr(pd));
-#ifdef HAVE_CAPSICUM
-			set_dumper_capsicum_rights(dump_info->pdd);
-#endif
 		}
 	}
+	pthread_mutex_unlock(&multi_mtx);
+
+	for (i = 0; i < multi_ndevices; i++) {
+		mi = &multi_ifaces[i];
+		pthread_join(mi->tid, NULL);
+		if (status == 0 ||
+		    (status == -2 && mi->status == -1)) {
+			status = mi->status;
+			if (status == -1)
+				snprintf(ebuf, PCAP_ERRBUF_SIZE, "%s: %s",
+				    mi->name, pcap_geterr(mi->pd));
+		}
+	}
+	if (multi_stopping && status == -2)
+		status = 0;
+	return (status);
+}
+#endif /* MULTI_IFACE_SUPPORTED */
 
-	pcap_dump((u_char *)dump_info->pdd, h, sp);
+/*
+ * Like pcap_loop(), but hand packets to the callback with pcap_dispatch()
+ * at most batch_size at a time, so that the per-packet work that doesn't
+ * need to be done for every packet (savefile rotation checks and -U
+ * flushes) is done once per batch, and so that --control-socket
+ * commands are carried out, and --degrade looks at the drops, between
+ * batches.
+ */
+static int
+capture_batches(pcap_t *pc, int count, pcap_handler callback, u_char *user,
+    struct dump_info *dump_info)
+{
+	int n, status;
+
+	for (;;) {
+		/* Without --batch-size, a batch is what one read gets. */
+		n = batch_size != 0 ? batch_size : -1;
+		if (count > 0 && (n == -1 || count < n))
+			n = count;
+		batch_packets = 0;
+		status = pcap_dispatch(pc, n, callback, user);
+		if (status < 0)
+			return (status);
+#ifdef CONTROL_SOCKET_SUPPORTED
+		if (control != NULL)
+			control_socket_poll(control, control_command, NULL);
+#endif
+		if (degrade)
+			degrade_check(pc);
 #ifdef HAVE_PCAP_DUMP_FLUSH
-	if (Uflag)
-		pcap_dump_flush(dump_info->pdd);
+		/*
+		 * The writer thread, if any, does its own flushing.
+		 */
+		if (Uflag && flush_interval == 0 && dump_info != NULL &&
+		    status > 0
+#ifdef HAVE_PTHREADS
+		    && !writer_thread
+#endif
+		    )
+			savefile_flush(dump_info);
 #endif
+#ifdef SAVEFILE_CLOCK_SUPPORTED
+		/*
+		 * The read can have timed out with no packets; rotate or
+		 * flush on time anyway.
+		 */
+		if (savefile_clock != NULL && dump_info != NULL &&
+		    !writer_thread)
+			savefile_clock_check(dump_info);
+#endif
+		if (count > 0) {
+			count -= status;
+			if (count <= 0)
+				return (0);
+		}
+		/*
+		 * When reading a savefile, 0 packets means end of file;
+		 * when capturing, it just means the timeout expired.
+		 */
+		if (status == 0 && pcap_file(pc) != NULL)
+			return (0);
+	}
+}
 
-	if (dump_info->ndo != NULL)
-		pretty_print_packet(dump_info->ndo, h, sp, packets_captured);
+/*
+ * Make the --degrade steps from the flags in ndo, most detailed first.
+ */
+static void
+degrade_init(const netdissect_options *ndo)
+{
+	struct degrade_step step;
+
+	degrade_steps = (struct degrade_step *)calloc(ndo->ndo_vflag + 4,
+	    sizeof(*degrade_steps));
+	if (degrade_steps == NULL)
+		error("degrade_init: calloc");
+	step.vflag = ndo->ndo_vflag;
+	step.qflag = ndo->ndo_qflag;
+	step.xflag = ndo->ndo_xflag;
+	step.Xflag = ndo->ndo_Xflag;
+	step.Aflag = ndo->ndo_Aflag;
+	step.print = 1;
+	degrade_steps[degrade_nsteps++] = step;
+	if (step.xflag || step.Xflag || step.Aflag) {
+		step.xflag = step.Xflag = step.Aflag = 0;
+		degrade_steps[degrade_nsteps++] = step;
+	}
+	while (step.vflag > 0) {
+		step.vflag--;
+		degrade_steps[degrade_nsteps++] = step;
+	}
+	if (!step.qflag) {
+		step.qflag = 1;
+		degrade_steps[degrade_nsteps++] = step;
+	}
+	step.print = 0;
+	degrade_steps[degrade_nsteps++] = step;
+}
 
-	--infodelay;
-	if (infoprint)
-		info(0);
+/*
+ * Describe a --degrade step by the flags it prints with.
+ */
+static const char *
+degrade_name(const struct degrade_step *step, char *buf, size_t size)
+{
+	size_t len;
+	int i;
+
+	if (!step->print)
+		return ("only counting packets");
+	len = strlcpy(buf, "printing with -", size);
+	if (step->qflag && len < size - 1)
+		buf[len++] = 'q';
+	for (i = 0; i < step->vflag && len < size - 1; i++)
+		buf[len++] = 'v';
+	for (i = 0; i < step->xflag && len < size - 1; i++)
+		buf[len++] = 'x';
+	for (i = 0; i < step->Xflag && len < size - 1; i++)
+		buf[len++] = 'X';
+	for (i = 0; i < step->Aflag && len < size - 1; i++)
+		buf[len++] = 'A';
+	if (len == sizeof("printing with -") - 1)
+		return ("printing with the default detail");
+	buf[len] = '\0';
+	return (buf);
 }
 
+/*
+ * Called between batches with --degrade; once a second, go down a step
+ * if the kernel has dropped packets since the last look, or if more
+ * than three quarters of the dissection thread slots, of the print
+ * thread ring or of the --output-thread buffer are in use (or that
+ * buffer has dropped output), and go up a step after DEGRADE_CALM
+ * seconds of none of those.
+ */
 static void
-dump_packet(u_char *user, const struct pcap_pkthdr *h, const u_char *sp)
+degrade_check(pcap_t *pc)
 {
-	struct dump_info *dump_info;
+	static time_t next;
+	static u_int last_drop, calm;
+	static int have_drop;
+#ifdef OUTPUT_BUFFER_SUPPORTED
+	static uint64_t last_output_dropped;
+#endif
+	struct pcap_stat stats;
+	char buf[48];
+	time_t now;
+	u_int dropped, queued;
+	int backlog, output_backlog;
 
-	++packets_captured;
+	now = time(NULL);
+	if (now < next)
+		return;
+	next = now + 1;
+
+	dropped = 0;
+	memset(&stats, 0, sizeof(stats));
+	if (pcap_stats(pc, &stats) == 0) {
+		if (have_drop)
+			dropped = stats.ps_drop - last_drop;
+		last_drop = stats.ps_drop;
+		have_drop = 1;
+	}
+	queued = 0;
+	backlog = 0;
+	output_backlog = 0;
+#ifdef DISSECT_THREADS_SUPPORTED
+	if (pl_workers != NULL) {
+		pthread_mutex_lock(&pl_mtx);
+		queued = pl_next_fill - pl_next_emit;
+		pthread_mutex_unlock(&pl_mtx);
+		backlog = queued > PIPELINE_SLOTS / 4 * 3;
+	}
+#endif
+#ifdef PRINT_THREAD_SUPPORTED
+	if (print_ring != NULL) {
+		struct packet_ring_stats prs;
 
-	++infodelay;
+		packet_ring_stats(print_ring, &prs);
+		queued = prs.prs_queued;
+		backlog = prs.prs_used > prs.prs_size / 4 * 3;
+	}
+#endif
+#ifdef OUTPUT_BUFFER_SUPPORTED
+	/*
+	 * Less detail is less output, so it helps a reader of the output
+	 * that's falling behind, too.
+	 */
+	if (output_buffer != NULL && !backlog) {
+		struct output_buffer_stats obs;
+
+		output_buffer_stats(output_buffer, &obs);
+		if (obs.obs_used > obs.obs_size / 4 * 3 ||
+		    obs.obs_dropped != last_output_dropped)
+			output_backlog = 1;
+		last_output_dropped = obs.obs_dropped;
+	}
+#endif
 
-	dump_info = (struct dump_info *)user;
+	if (dropped != 0 || backlog || output_backlog) {
+		calm = 0;
+		if (degrade_level + 1 >= (sig_atomic_t)degrade_nsteps)
+			return;
+		degrade_level++;
+		degrade_changes++;
+		if (dropped != 0)
+			(void)fprintf(stderr,
+			    "%s: %u packet%s dropped by kernel, now %s\n",
+			    program_name, dropped, PLURAL_SUFFIX(dropped),
+			    degrade_name(&degrade_steps[degrade_level], buf,
+			    sizeof(buf)));
+		else if (backlog)
+			(void)fprintf(stderr,
+			    "%s: %u packet%s waiting for dissection, now %s\n",
+			    program_name, queued, PLURAL_SUFFIX(queued),
+			    degrade_name(&degrade_steps[degrade_level], buf,
+			    sizeof(buf)));
+		else
+			(void)fprintf(stderr,
+			    "%s: output waiting to be written, now %s\n",
+			    program_name,
+			    degrade_name(&degrade_steps[degrade_level], buf,
+			    sizeof(buf)));
+	} else if (degrade_level > 0 && ++calm >= DEGRADE_CALM) {
+		calm = 0;
+		degrade_level--;
+		degrade_changes++;
+		(void)fprintf(stderr, "%s: caught up, now %s\n",
+		    program_name,
+		    degrade_name(&degrade_steps[degrade_level], buf,
+		    sizeof(buf)));
+	}
+}
 
-	pcap_dump((u_char *)dump_info->pdd, h, sp);
-#ifdef HAVE_PCAP_DUMP_FLUSH
-	if (Uflag)
-		pcap_dump_flush(dump_info->pdd);
+/*
+ * If the --degrade step has changed since the last packet this
+ * netdissect_options printed, set its flags for the new one.
+ */
+static void
+degrade_apply(netdissect_options *ndo, sig_atomic_t *seen)
+{
+	sig_atomic_t level = degrade_level;
+	const struct degrade_step *step;
+
+	if (*seen == level)
+		return;
+	*seen = level;
+	step = &degrade_steps[level];
+	ndo->ndo_vflag = step->vflag;
+	ndo->ndo_qflag = step->qflag;
+	ndo->ndo_xflag = step->xflag;
+	ndo->ndo_Xflag = step->Xflag;
+	ndo->ndo_Aflag = step->Aflag;
+}
+
+#ifdef CONTROL_SOCKET_SUPPORTED
+/*
+ * Carry out a --control-socket command.
+ */
+static void
+control_command(void *arg _U_, char *cmd, char *reply, size_t size)
+{
+	struct bpf_program fcode;
+	struct pcap_stat stats;
+	char *args, *endp;
+	long value;
+
+	args = cmd + strcspn(cmd, " \t");
+	if (*args != '\0')
+		*args++ = '\0';
+	args += strspn(args, " \t");
+
+	if (strcmp(cmd, "filter") == 0) {
+		if (pcap_compile(pd, &fcode, args, control_Oflag,
+		    control_netmask) < 0) {
+			snprintf(reply, size, "error: %s\n", pcap_geterr(pd));
+			return;
+		}
+		if (pcap_setfilter(pd, &fcode) < 0)
+			snprintf(reply, size, "error: %s\n", pcap_geterr(pd));
+		else
+			snprintf(reply, size, "ok\n");
+		pcap_freecode(&fcode);
+	} else if (strcmp(cmd, "verbose") == 0 || strcmp(cmd, "hex") == 0) {
+		value = strtol(args, &endp, 10);
+		if (*args == '\0' || *endp != '\0' || value < 0 || value > 4) {
+			snprintf(reply, size, "error: invalid level \"%s\"\n",
+			    args);
+			return;
+		}
+		if (cmd[0] == 'v')
+			control_ndo->ndo_vflag = (int)value;
+		else
+			control_ndo->ndo_xflag = (int)value;
+		snprintf(reply, size, "ok\n");
+	} else if (strcmp(cmd, "rotate") == 0) {
+		if (!control_writing || (Cflag == 0 && Gflag == 0)) {
+			snprintf(reply, size,
+			    "error: not writing with -C or -G\n");
+			return;
+		}
+		/* It's done before the next packet is written. */
+		rotate_requests++;
+		snprintf(reply, size, "ok\n");
+	} else if (strcmp(cmd, "stats") == 0) {
+		memset(&stats, 0, sizeof(stats));
+		if (pcap_stats(pd, &stats) < 0)
+			snprintf(reply, size, "captured %u\n", packets_captured);
+		else
+			snprintf(reply, size,
+			    "captured %u received %u dropped %u ifdropped %u\n",
+			    packets_captured, stats.ps_recv, stats.ps_drop,
+			    stats.ps_ifdrop);
+	} else
+		snprintf(reply, size, "error: unknown command \"%s\"; the "
+		    "commands are filter, verbose, hex, rotate and stats\n",
+		    cmd);
+}
 #endif
 
-	if (dump_info->ndo != NULL)
-		pretty_print_packet(dump_info->ndo, h, sp, packets_captured);
+#ifdef METRICS_SUPPORTED
+static void
+metrics_proto_packets(void *arg, const char *name, uint64_t packets,
+    uint64_t bytes _U_)
+{
+	char label[64];
 
-	--infodelay;
-	if (infoprint)
-		info(0);
+	if (name == NULL)
+		return;
+	snprintf(label, sizeof(label), "protocol=\"%s\"", name);
+	metrics_value((struct metrics_page *)arg, "tcpdump_protocol_packets",
+	    "_total", label, packets);
 }
 
 static void
-print_packet(u_char *user, const struct pcap_pkthdr *h, const u_char *sp)
+metrics_proto_bytes(void *arg, const char *name, uint64_t packets _U_,
+    uint64_t bytes)
 {
-	++packets_captured;
+	char label[64];
 
-	++infodelay;
+	if (name == NULL)
+		return;
+	snprintf(label, sizeof(label), "protocol=\"%s\"", name);
+	metrics_value((struct metrics_page *)arg, "tcpdump_protocol_bytes",
+	    "_total", label, bytes);
+}
 
-	if (!count_mode)
-		pretty_print_packet((netdissect_options *)user, h, sp, packets_captured);
+/*
+ * Make the --metrics page, on the metrics thread.  The counters are
+ * read without locking, as info() reads them from a signal handler; a
+ * value may be a packet behind.
+ */
+static void
+metrics_collect(struct metrics_page *mp, void *arg _U_)
+{
+	struct pcap_stat stats;
+	struct nd_big_alloc_stats nbs;
+#ifdef DISSECT_THREADS_SUPPORTED
+	char label[32];
+	int i;
+#endif
 
-	--infodelay;
-	if (infoprint)
-		info(0);
+	metrics_family(mp, "tcpdump_packets_captured", "counter",
+	    "Packets that passed the filter and were handled.");
+	metrics_value(mp, "tcpdump_packets_captured", "_total", NULL,
+	    packets_captured);
+	memset(&stats, 0, sizeof(stats));
+	if (metrics_live && pcap_stats(pd, &stats) == 0) {
+		metrics_family(mp, "tcpdump_pcap_received", "counter",
+		    "Packets received by the filter, as pcap_stats() counts.");
+		metrics_value(mp, "tcpdump_pcap_received", "_total", NULL,
+		    stats.ps_recv);
+		metrics_family(mp, "tcpdump_pcap_dropped", "counter",
+		    "Packets dropped by the kernel for want of buffer space.");
+		metrics_value(mp, "tcpdump_pcap_dropped", "_total", NULL,
+		    stats.ps_drop);
+		metrics_family(mp, "tcpdump_pcap_ifdropped", "counter",
+		    "Packets dropped by the interface or its driver.");
+		metrics_value(mp, "tcpdump_pcap_ifdropped", "_total", NULL,
+		    stats.ps_ifdrop);
+	}
+	metrics_family(mp, "tcpdump_savefile_packets", "counter",
+	    "Packets written to savefiles.");
+	metrics_value(mp, "tcpdump_savefile_packets", "_total", NULL,
+	    savefile_packets);
+	metrics_family(mp, "tcpdump_savefile_bytes", "counter",
+	    "Captured bytes of the packets written to savefiles.");
+	metrics_value(mp, "tcpdump_savefile_bytes", "_total", NULL,
+	    savefile_bytes);
+	metrics_family(mp, "tcpdump_savefile_rotations", "counter",
+	    "New savefiles started by -C, -G or a rotate command.");
+	metrics_value(mp, "tcpdump_savefile_rotations", "_total", NULL,
+	    savefile_rotations);
+	if (degrade) {
+		metrics_family(mp, "tcpdump_degrade_step", "gauge",
+		    "Steps down from the detail asked for, with --degrade.");
+		metrics_value(mp, "tcpdump_degrade_step", "", NULL,
+		    (uint64_t)degrade_level);
+		metrics_family(mp, "tcpdump_degrade_unprinted", "counter",
+		    "Packets counted but not printed by --degrade.");
+		metrics_value(mp, "tcpdump_degrade_unprinted", "_total", NULL,
+		    degrade_unprinted);
+	}
+	if (stats_ndo != NULL) {
+		metrics_family(mp, "tcpdump_protocol_packets", "counter",
+		    "Packets with each protocol, counted by --stats-only.");
+		nd_stats_foreach(stats_ndo, metrics_proto_packets, mp);
+		metrics_family(mp, "tcpdump_protocol_bytes", "counter",
+		    "Bytes of the packets with each protocol.");
+		nd_stats_foreach(stats_ndo, metrics_proto_bytes, mp);
+	}
+	if (writer_thread) {
+		metrics_family(mp, "tcpdump_writer_queue_bytes", "gauge",
+		    "Packet bytes waiting for the savefile writer thread.");
+		pthread_mutex_lock(&writer_mtx);
+		metrics_value(mp, "tcpdump_writer_queue_bytes", "", NULL,
+		    writer_bufs[0].len + writer_bufs[1].len);
+		pthread_mutex_unlock(&writer_mtx);
+	}
+#ifdef DISSECT_THREADS_SUPPORTED
+	if (pl_workers != NULL) {
+		metrics_family(mp, "tcpdump_dissect_queue_packets", "gauge",
+		    "Packets waiting for each --dissect-threads thread.");
+		pthread_mutex_lock(&pl_mtx);
+		for (i = 0; i < dissect_threads; i++) {
+			snprintf(label, sizeof(label), "thread=\"%d\"", i);
+			metrics_value(mp, "tcpdump_dissect_queue_packets", "",
+			    label, pl_workers[i].qtail - pl_workers[i].qhead);
+		}
+		metrics_family(mp, "tcpdump_dissect_packets", "counter",
+		    "Packets dissected by each --dissect-threads thread.");
+		for (i = 0; i < dissect_threads; i++) {
+			snprintf(label, sizeof(label), "thread=\"%d\"", i);
+			metrics_value(mp, "tcpdump_dissect_packets", "_total",
+			    label, pl_workers[i].packets);
+		}
+		metrics_family(mp, "tcpdump_pipeline_slots", "gauge",
+		    "Packets captured and not yet written out.");
+		metrics_value(mp, "tcpdump_pipeline_slots", "", NULL,
+		    pl_next_fill - pl_next_emit);
+		pthread_mutex_unlock(&pl_mtx);
+	}
+#endif
+#ifdef PRINT_THREAD_SUPPORTED
+	if (print_ring != NULL) {
+		struct packet_ring_stats prs;
+
+		packet_ring_stats(print_ring, &prs);
+		metrics_family(mp, "tcpdump_print_ring_packets", "gauge",
+		    "Packets waiting for the --print-thread thread.");
+		metrics_value(mp, "tcpdump_print_ring_packets", "", NULL,
+		    prs.prs_queued);
+		metrics_family(mp, "tcpdump_print_ring_bytes", "gauge",
+		    "Bytes of the --print-thread ring in use.");
+		metrics_value(mp, "tcpdump_print_ring_bytes", "", NULL,
+		    prs.prs_used);
+		metrics_family(mp, "tcpdump_print_ring_waits", "counter",
+		    "Times the capture waited for room in the ring.");
+		metrics_value(mp, "tcpdump_print_ring_waits", "_total", NULL,
+		    prs.prs_waits);
+		metrics_family(mp, "tcpdump_print_ring_dropped", "counter",
+		    "Packets written with -w but not printed, the ring being full.");
+		metrics_value(mp, "tcpdump_print_ring_dropped", "_total", NULL,
+		    prs.prs_dropped);
+	}
+#endif
+#ifdef STREAM_SINK_SUPPORTED
+	if (stream_dump_info != NULL && stream_dump_info->ssk != NULL) {
+		struct stream_sink_stats sss;
+
+		stream_sink_stats(stream_dump_info->ssk, &sss);
+		metrics_family(mp, "tcpdump_stream_sent_bytes", "counter",
+		    "Bytes sent to the -w tcp:// or udp:// collector.");
+		metrics_value(mp, "tcpdump_stream_sent_bytes", "_total", NULL,
+		    sss.sss_bytes_sent);
+		metrics_family(mp, "tcpdump_stream_dropped", "counter",
+		    "Packets not sent to the collector, for want of room.");
+		metrics_value(mp, "tcpdump_stream_dropped", "_total", NULL,
+		    sss.sss_dropped);
+		metrics_family(mp, "tcpdump_stream_connects", "counter",
+		    "Connections made to the collector.");
+		metrics_value(mp, "tcpdump_stream_connects", "_total", NULL,
+		    sss.sss_connects);
+	}
+#endif
+#ifdef SHM_RING_SUPPORTED
+	if ((shm_dump_info != NULL && shm_dump_info->srg != NULL) ||
+	    shm_output_ring != NULL) {
+		struct shm_ring_stats srs[2];
+		static const char *labels[2] = {
+			"ring=\"packets\"", "ring=\"output\""
+		};
+		int have[2], j;
+
+		have[0] = shm_dump_info != NULL && shm_dump_info->srg != NULL;
+		if (have[0])
+			shm_ring_stats(shm_dump_info->srg, &srs[0]);
+		have[1] = shm_output_ring != NULL;
+		if (have[1])
+			shm_ring_stats(shm_output_ring, &srs[1]);
+		metrics_family(mp, "tcpdump_shm_ring_bytes", "gauge",
+		    "Bytes in a shared-memory ring not yet read.");
+		for (j = 0; j < 2; j++)
+			if (have[j])
+				metrics_value(mp, "tcpdump_shm_ring_bytes", "",
+				    labels[j], srs[j].srs_used);
+		metrics_family(mp, "tcpdump_shm_ring_dropped", "counter",
+		    "Records not put in a shared-memory ring, for want of room.");
+		for (j = 0; j < 2; j++)
+			if (have[j])
+				metrics_value(mp, "tcpdump_shm_ring_dropped",
+				    "_total", labels[j], srs[j].srs_dropped);
+	}
+#endif
+#ifdef OUTPUT_BUFFER_SUPPORTED
+	if (output_buffer != NULL) {
+		struct output_buffer_stats obs;
+
+		output_buffer_stats(output_buffer, &obs);
+		metrics_family(mp, "tcpdump_output_buffer_bytes", "gauge",
+		    "Bytes of printed output waiting to be written.");
+		metrics_value(mp, "tcpdump_output_buffer_bytes", "", NULL,
+		    obs.obs_used);
+		metrics_family(mp, "tcpdump_output_waits", "counter",
+		    "Times the printing waited for the reader of the output.");
+		metrics_value(mp, "tcpdump_output_waits", "_total", NULL,
+		    obs.obs_waits);
+		metrics_family(mp, "tcpdump_output_dropped_bytes", "counter",
+		    "Bytes of printed output thrown away for want of room.");
+		metrics_value(mp, "tcpdump_output_dropped_bytes", "_total",
+		    NULL, obs.obs_dropped_bytes);
+	}
+#endif
+	nd_big_alloc_stats(&nbs);
+	if (nbs.nbs_huge_bytes != 0 || nbs.nbs_thp_bytes != 0 ||
+	    nbs.nbs_fallbacks != 0) {
+		metrics_family(mp, "tcpdump_big_alloc_bytes", "gauge",
+		    "Bytes of rings and tables, by the pages --huge-pages got.");
+		metrics_value(mp, "tcpdump_big_alloc_bytes", "",
+		    "pages=\"huge\"", nbs.nbs_huge_bytes);
+		metrics_value(mp, "tcpdump_big_alloc_bytes", "",
+		    "pages=\"thp\"", nbs.nbs_thp_bytes);
+		metrics_value(mp, "tcpdump_big_alloc_bytes", "",
+		    "pages=\"normal\"", nbs.nbs_normal_bytes);
+		metrics_family(mp, "tcpdump_big_alloc_fallbacks", "counter",
+		    "Allocations that got smaller pages than --huge-pages asked for.");
+		metrics_value(mp, "tcpdump_big_alloc_fallbacks", "_total",
+		    NULL, nbs.nbs_fallbacks);
+	}
+}
+
+static void *
+metrics_main(void *arg _U_)
+{
+	return (metrics_serve(metrics, metrics_collect, NULL));
 }
+#endif
 
 #ifdef SIGNAL_REQ_INFO
 static void
@@ -3066,6 +13178,40 @@ flushpcap(int signo _U_)
 }
 #endif
 
+#ifdef SIGUSR2
+static void
+flight_signal(int signo _U_)
+{
+	flight_signals++;
+}
+#endif
+
+#ifdef ESPSECRET_RELOAD
+static void
+reload_espsecret(int signo _U_)
+{
+	espsecret_generation++;
+}
+
+/*
+ * If the secrets have been asked to be reread since the last check
+ * for this netdissect_options, discard its SAs; they're decoded from
+ * the -E argument again, including rereading any secrets file, the
+ * next time they're needed.
+ */
+static void
+check_espsecret(netdissect_options *ndo, sig_atomic_t *seen)
+{
+	sig_atomic_t generation = espsecret_generation;
+
+	if (*seen != generation) {
+		*seen = generation;
+		esp_print_freesecrets(ndo);
+		ndo->ndo_espsecret = espsecret;
+	}
+}
+#endif
+
 static void
 print_packets_captured (void)
 {
@@ -3139,9 +13285,75 @@ print_usage(void)
 	(void)fprintf(stderr,
 "Usage: %s [-Abd" D_FLAG "efhH" I_FLAG J_FLAG "KlLnNOpqStu" U_FLAG "vxX#]" B_FLAG_USAGE " [ -c count ] [--count]\n", program_name);
 	(void)fprintf(stderr,
-"\t\t[ -C file_size ] [ -E algo:secret ] [ -F file ] [ -G seconds ]\n");
+"\t\t[ --arp-watch[=rate] ] [ --batch-size count ] [ --beacon-stats ]\n");
+	(void)fprintf(stderr,
+"\t\t[ --bgp-peers ] [ --bgp-summary ]\n");
+	(void)fprintf(stderr,
+"\t\t[ -C file_size ]" CONTROL_SOCKET_USAGE "\n");
+	(void)fprintf(stderr,
+"\t\t[ --call-cache-size count ]" CHUNK_THREADS_USAGE "\n");
+	(void)fprintf(stderr,
+"\t\t[ --changes-only ] [ --check-outgoing-cksums ]\n");
+#ifdef CPU_AFFINITY_SUPPORTED
 	(void)fprintf(stderr,
-"\t\t[ -i interface ]" IMMEDIATE_MODE_USAGE j_FLAG_USAGE "\n");
+"\t\t[ --cpu-affinity stage=cpus ] [ --numa-node node|auto ]\n");
+#endif
+#ifdef COMPRESSED_READER_SUPPORTED
+	(void)fprintf(stderr,
+"\t\t[ --decompress-threads count ]\n");
+#endif
+	(void)fprintf(stderr,
+"\t\t[ --degrade ] [ --disable-dissector name ] [ -E algo:secret ]\n");
+	(void)fprintf(stderr,
+"\t\t[ --field-output ] [ -F file ]" FILE_THREADS_USAGE "\n");
+	(void)fprintf(stderr,
+"\t\t[ -G seconds ]\n");
+	(void)fprintf(stderr,
+"\t\t[ --flight-recorder megabytes ] [ --flight-window seconds ]\n");
+	(void)fprintf(stderr,
+"\t\t[ --flows[=text|json|ipfix] ] [ --flow-timeout active[,idle] ]\n");
+	(void)fprintf(stderr,
+"\t\t[ --flow-table-size count ] [ --flow-collector ]\n");
+	(void)fprintf(stderr,
+"\t\t[ --flight-after seconds ] [ --flight-trigger expression ]\n");
+	(void)fprintf(stderr,
+"\t\t[ --flight-start expression ] [ --flight-stop expression ]\n");
+	(void)fprintf(stderr,
+"\t\t[ --build-index ] [ --index-interval count ] [ --write-index ]\n");
+	(void)fprintf(stderr,
+"\t\t[ --flow-index ] [ --flow=proto,address,port,address,port ]\n");
+#if !defined(_WIN32) || defined(HAVE_PTHREADS)
+	(void)fprintf(stderr,
+"\t\t" MMAP_SAVEFILE_USAGE WRITER_THREAD_USAGE FLUSH_INTERVAL_USAGE "\n");
+#endif
+#ifdef GZIP_SAVEFILE_SUPPORTED
+	(void)fprintf(stderr,
+"\t\t[ --gzip-savefile[=level] ]\n");
+#endif
+#ifdef URING_SAVEFILE_SUPPORTED
+	(void)fprintf(stderr,
+"\t\t[ --io-uring[=direct] ]\n");
+#endif
+	(void)fprintf(stderr,
+"\t\t[ --stripe-dir directory ] [ --huge-pages[=thp|2m|1g] ]\n");
+#ifdef STREAM_SINK_SUPPORTED
+	(void)fprintf(stderr,
+"\t\t[ --stream-buffer=megabytes ]\n");
+#endif
+#ifdef SHM_RING_SUPPORTED
+	(void)fprintf(stderr,
+"\t\t[ --shm-output=name ] [ --shm-size=megabytes ]\n");
+#endif
+	(void)fprintf(stderr,
+"\t\t[ -i interface ]" IMMEDIATE_MODE_USAGE j_FLAG_USAGE " [ --json ]\n");
+#ifdef FANOUT_SUPPORTED
+	(void)fprintf(stderr,
+"\t\t[ --fanout count[,hash|lb|cpu] ]\n");
+#endif
+	(void)fprintf(stderr,
+"\t\t[ --latency-report[=seconds] ] [ --lsdb ]\n");
+	(void)fprintf(stderr,
+"\t\t[ --ip-reassembly[=megabytes] ] [ --ip-reassembly-overlap=policy ]\n");
 #ifdef HAVE_PCAP_FINDALLDEVS_EX
 	(void)fprintf(stderr,
 "\t\t" LIST_REMOTE_INTERFACES_USAGE "\n");
@@ -3151,9 +13363,76 @@ print_usage(void)
 "\t\t" m_FLAG_USAGE "\n");
 #endif
 	(void)fprintf(stderr,
-"\t\t[ -M secret ] [ --number ] [ --print ]" Q_FLAG_USAGE "\n");
+"\t\t[ -M secret ]" MERGE_BY_TIME_USAGE " [ --name-cache-size count ]\n");
+	(void)fprintf(stderr,
+"\t\t[ --name-cache-ttl seconds ] [ --neighbors ] [ --number ]\n");
+
+	(void)fprintf(stderr,
+"\t\t[ --resolve [!]prefix ]" NAME_CACHE_FILE_USAGE " [ --wpan-stats ]\n");
+	(void)fprintf(stderr,
+"\t\t[ --openflow-summary ] [ --pcapng ] [ --port-map port=name ]\n");
+	(void)fprintf(stderr,
+"\t\t[ --plugin file ]\n");
+#ifdef OUTPUT_BUFFER_SUPPORTED
+	(void)fprintf(stderr,
+"\t\t[ --output-thread[=megabytes[,block|drop]] ]\n");
+#endif
+	(void)fprintf(stderr,
+"\t\t[ --ptp-stats[=seconds] ]" METRICS_USAGE "\n");
+	(void)fprintf(stderr,
+"\t\t[ --print ]" Q_FLAG_USAGE DISSECT_THREADS_USAGE "\n");
+#ifdef PRINT_THREAD_SUPPORTED
+	(void)fprintf(stderr,
+"\t\t[ --print-thread[=megabytes] ]\n");
+#endif
+#ifdef ENABLE_DISSECTOR_PROFILE
+	(void)fprintf(stderr,
+"\t\t[ --profile-dissectors ] [ --snaplen-report ]\n");
+#endif
+	(void)fprintf(stderr,
+"\t\t[ --radius-summary[=attribute,...] ] [ --dhcp-events ]\n");
+	(void)fprintf(stderr,
+"\t\t[ --extract-payloads=file ] [ --ppp-sessions ] [ --mcast-groups ]\n");
+	(void)fprintf(stderr,
+"\t\t[ --label-bindings ] [ --filter-program=file ] [ --hosts-file=file ]\n");
+	(void)fprintf(stderr,
+"\t\t[ --display-filter=expression ] [ --dedup[=microseconds[,ttl]] ]\n");
+	(void)fprintf(stderr,
+"\t\t[ --memo[=entries][,compact|verify] ] [ --memo-ignore=offset[:length],... ]\n");
+	(void)fprintf(stderr,
+"\t\t[ --flow-truncate=packets[,bytes] ] [ --anonymize=keyfile ]\n");
 	(void)fprintf(stderr,
-"\t\t[ -r file ] [ -s snaplen ] [ -T type ] [ --version ]\n");
+"\t\t[ --split-by=vni|vlan ] [ --split-open-files=count ] [ --follow ]\n");
+	(void)fprintf(stderr,
+"\t\t[ --tcp-analysis ] [ --mptcp-connections ] [ --http-transactions ]\n");
+	(void)fprintf(stderr,
+"\t\t[ --rtp-analysis[=seconds] ] [ --bfd-sessions ] [ --someip-summary ]\n");
+	(void)fprintf(stderr,
+"\t\t[ --v2x-stations[=seconds] ]\n");
+	(void)fprintf(stderr,
+"\t\t[ --community-id[=seed] ] [ --payload-match=file ]\n");
+	(void)fprintf(stderr,
+"\t\t[ -r file ]" RESOLVER_THREADS_USAGE " [ -s snaplen ] [ --stats-only ]\n");
+	(void)fprintf(stderr,
+"\t\t[ --start-packet number ] [ --start-time time ] [ --end-time time ]\n");
+	(void)fprintf(stderr,
+"\t\t[ --state-memory megabytes ] [ --mem-limit megabytes ]\n");
+	(void)fprintf(stderr,
+"\t\t[ --max-output-per-packet bytes ]\n");
+	(void)fprintf(stderr,
+"\t\t[ --sample 1/N ] [ --flow-sample 1/N ]\n");
+	(void)fprintf(stderr,
+"\t\t[ --inner-filter expression ] [ --write-inner ]\n");
+	(void)fprintf(stderr,
+"\t\t[ -T type ] [ --tcp-reassembly[=megabytes] ] [ --version ]\n");
+	(void)fprintf(stderr,
+"\t\t[ --top[=count] ] [ --top-interval seconds ]\n");
+	(void)fprintf(stderr,
+"\t\t[ --rates[=format] ] [ --rate-interval seconds ]\n");
+#ifdef KERNEL_COUNTS_SUPPORTED
+	(void)fprintf(stderr,
+"\t\t[ --kernel-counts ]\n");
+#endif
 	(void)fprintf(stderr,
 "\t\t[ -V file ] [ -w file ] [ -W filecount ] [ -y datalinktype ]\n");
 #ifdef HAVE_PCAP_SET_TSTAMP_PRECISION
@@ -3161,5 +13440,7 @@ print_usage(void)
 "\t\t[ --time-stamp-precision precision ] [ --micro ] [ --nano ]\n");
 #endif
 	(void)fprintf(stderr,
+"\t\t[ --hw-time-stamp arista|metamako ]\n");
+	(void)fprintf(stderr,
 "\t\t[ -z postrotate-command ] [ -Z user ] [ expression ]\n");
 }
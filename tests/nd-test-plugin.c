@@ -0,0 +1,80 @@
+/*
+ * Copyright (c) 2026 The TCPDUMP project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that: (1) source code
+ * distributions retain the above copyright notice and this paragraph
+ * in its entirety, and (2) distributions including binary code include
+ * the above copyright notice and this paragraph in its entirety in
+ * the documentation or other materials provided with the distribution.
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND
+ * WITHOUT ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, WITHOUT
+ * LIMITATION, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE.
+ */
+
+/*
+ * The dissector plugin the --plugin tests load: a made-up protocol of
+ * an op code, a flags byte and a 16-bit value, on UDP port 7777 and on
+ * the local experimental Ethertype 0x88b5.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include "netdissect-stdinc.h"
+
+#include "netdissect.h"
+#include "extract.h"
+#include "ipproto.h"
+#include "netdissect-plugin.h"
+
+#define NDTEST_PORT		7777
+#define NDTEST_ETHERTYPE	0x88b5
+
+static void
+ndtest_print(netdissect_options *ndo, const u_char *bp, u_int length)
+{
+	ndo->ndo_protocol = "ndtest";
+	ND_PRINT("NDTEST op %u", GET_U_1(bp));
+	if (ndo->ndo_vflag)
+		ND_PRINT(", flags 0x%02x", GET_U_1(bp + 1));
+	ND_PRINT(", value %u, length %u", GET_BE_U_2(bp + 2), length);
+}
+
+static int
+ndtest_udp_print(netdissect_options *ndo, const u_char *bp, u_int length,
+    const struct port_info *pi _U_)
+{
+	ndtest_print(ndo, bp, length);
+	return (1);
+}
+
+static void
+ndtest_ether_print(netdissect_options *ndo, const u_char *bp, u_int length,
+    u_int caplen _U_, const struct lladdr_info *src _U_,
+    const struct lladdr_info *dst _U_)
+{
+	ndtest_print(ndo, bp, length);
+}
+
+static const struct port_dissector ndtest_udp = {
+	"ndtest", ndtest_udp_print, NULL, 0
+};
+
+static const struct ethertype_dissector ndtest_ether = {
+	NDTEST_ETHERTYPE, "ndtest", ndtest_ether_print
+};
+
+static int
+ndtest_init(void)
+{
+	if (nd_register_port(IPPROTO_UDP, NDTEST_PORT, NDTEST_PORT,
+	    PORT_EITHER, &ndtest_udp) == -1)
+		return (-1);
+	return (nd_register_ethertype(&ndtest_ether));
+}
+
+ND_PLUGIN("ndtest", ndtest_init);
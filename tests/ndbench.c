@@ -0,0 +1,576 @@
+/*
+ * Copyright (c) 2026 The TCPDUMP project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that: (1) source code
+ * distributions retain the above copyright notice and this paragraph
+ * in its entirety, and (2) distributions including binary code include
+ * the above copyright notice and this paragraph in its entirety in
+ * the documentation or other materials provided with the distribution.
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND
+ * WITHOUT ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, WITHOUT
+ * LIMITATION, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE.
+ */
+
+/*
+ * ndbench: time the dissectors, in-process, on the savefiles that the
+ * tests use and on some larger synthetic workloads.
+ *
+ * Each workload is read into memory and handed to pretty_print_packet()
+ * a number of times, with the output formatted as usual and then thrown
+ * away; the fastest pass is reported, as nanoseconds and nd_malloc()
+ * calls per packet.  "make bench" runs it on every savefile named in
+ * tests/TESTLIST.
+ *
+ * With -o the results are also written to a baseline file, one
+ * tab-separated "name packets ns/packet allocs/packet" line per
+ * workload; with -b they're compared against one, and the exit status
+ * is 1 if any workload got slower by more than the threshold.
+ *
+ * With -x the GET_BE_U_2/4/8 accessors are timed instead, on their
+ * own, at every alignment, for comparing extract.h implementations on
+ * a processor; the results are in the same form, per access.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include "netdissect-stdinc.h"
+
+#include <pcap.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#ifdef HAVE_GETOPT_LONG
+#include <getopt.h>
+#else
+#include "missing/getopt_long.h"
+#endif
+
+#include "netdissect.h"
+#include "netdissect-profile.h"
+#include "extract.h"
+#include "print.h"
+#include "pcap-missing.h"
+#include "pktgen.h"
+
+#define DEFAULT_ITERATIONS	10
+#define DEFAULT_SYNTHETIC	100000
+#define DEFAULT_THRESHOLD	20	/* percent */
+#define EXTRACT_BUFSIZE		4096
+#define EXTRACT_PASSES		2000
+
+struct packet {
+	struct pcap_pkthdr h;
+	u_char *data;
+};
+
+struct workload {
+	char name[128];
+	int dlt;
+	u_int snaplen;
+	struct packet *packets;
+	u_int npackets;
+};
+
+struct result {
+	char name[128];
+	u_int npackets;
+	double ns;
+	double allocs;
+};
+
+static const struct option longopts[] = {
+	{ NULL, 0, NULL, 0 }
+};
+
+static const char *program_name = "ndbench";
+static struct result *baseline;
+static u_int nbaseline;
+static int regressions;
+
+static void NORETURN
+error(const char *fmt, ...)
+{
+	va_list ap;
+
+	(void)fprintf(stderr, "%s: ", program_name);
+	va_start(ap, fmt);
+	(void)vfprintf(stderr, fmt, ap);
+	va_end(ap);
+	(void)fputc('\n', stderr);
+	exit(2);
+}
+
+static uint64_t
+now_ns(void)
+{
+#ifdef CLOCK_MONOTONIC
+	struct timespec ts;
+
+	(void)clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ((uint64_t)ts.tv_sec * 1000000000 + (uint64_t)ts.tv_nsec);
+#else
+	return ((uint64_t)clock() * (1000000000 / CLOCKS_PER_SEC));
+#endif
+}
+
+/* The output is formatted, then dropped. */
+static int
+null_output(netdissect_options *ndo _U_, const char *buf _U_,
+	    size_t len _U_)
+{
+	return (0);
+}
+
+static void
+add_packet(struct workload *w, const struct pcap_pkthdr *h,
+	   const u_char *data)
+{
+	struct packet *p;
+
+	if ((w->npackets & (w->npackets - 1)) == 0) {
+		p = (struct packet *)realloc(w->packets,
+		    (w->npackets != 0 ? w->npackets * 2 : 1) * sizeof(*p));
+		if (p == NULL)
+			error("out of memory");
+		w->packets = p;
+	}
+	p = &w->packets[w->npackets++];
+	p->h = *h;
+	p->data = (u_char *)malloc(h->caplen != 0 ? h->caplen : 1);
+	if (p->data == NULL)
+		error("out of memory");
+	memcpy(p->data, data, h->caplen);
+}
+
+static void
+free_workload(struct workload *w)
+{
+	u_int i;
+
+	for (i = 0; i < w->npackets; i++)
+		free(w->packets[i].data);
+	free(w->packets);
+	w->packets = NULL;
+	w->npackets = 0;
+}
+
+/*
+ * Read a savefile into memory.  Returns -1, having said why, if it
+ * can't be used.
+ */
+static int
+load_savefile(struct workload *w, const char *dir, const char *file)
+{
+	char path[1024], ebuf[PCAP_ERRBUF_SIZE];
+	struct pcap_pkthdr *h;
+	const u_char *data;
+	pcap_t *pd;
+
+	(void)snprintf(path, sizeof(path), "%s/%s", dir, file);
+	(void)snprintf(w->name, sizeof(w->name), "%s", file);
+	pd = pcap_open_offline(path, ebuf);
+	if (pd == NULL) {
+		(void)fprintf(stderr, "%s: skipping %s: %s\n", program_name,
+		    file, ebuf);
+		return (-1);
+	}
+	w->dlt = pcap_datalink(pd);
+	w->snaplen = pcap_snapshot(pd);
+	if (!has_printer(w->dlt)) {
+		(void)fprintf(stderr, "%s: skipping %s: no printer for link type %d\n",
+		    program_name, file, w->dlt);
+		pcap_close(pd);
+		return (-1);
+	}
+	while (pcap_next_ex(pd, &h, &data) == 1)
+		add_packet(w, h, data);
+	pcap_close(pd);
+	if (w->npackets == 0) {
+		free_workload(w);
+		return (-1);
+	}
+	return (0);
+}
+
+/*
+ * Synthetic workloads, "count" packets each: one per pktgen kind, and
+ * the default mix of them.
+ */
+static const char *const synthetic_mixes[] = {
+	"tcp", "dns", "ip6", "vxlan", "geneve", "esp", "bgp", "l2tp", NULL
+};
+
+static void
+make_synthetic(struct workload *w, const char *mix, u_int count)
+{
+	u_char pkt[PKTGEN_MAXLEN];
+	char ebuf[128];
+	struct pcap_pkthdr h;
+	struct pktgen *g;
+	u_int i;
+
+	(void)snprintf(w->name, sizeof(w->name), "synthetic-%s",
+	    mix != NULL ? mix : "mix");
+	g = pktgen_create(mix != NULL ? mix : PKTGEN_DEFAULT_MIX, 1, 1000000,
+	    ebuf, sizeof(ebuf));
+	if (g == NULL)
+		error("%s", ebuf);
+	w->dlt = DLT_EN10MB;
+	w->snaplen = 262144;
+	memset(&h, 0, sizeof(h));
+	for (i = 0; i < count; i++) {
+		h.caplen = h.len = pktgen_next(g, pkt, &h.ts);
+		add_packet(w, &h, pkt);
+	}
+	pktgen_destroy(g);
+}
+
+/*
+ * Dissect the workload "iterations" times, after a pass to warm the
+ * caches up, and keep the fastest.
+ */
+static void
+run_workload(netdissect_options *ndo, const struct workload *w,
+	     u_int iterations, struct result *r)
+{
+	uint64_t start, ns, best, mallocs;
+	u_int it, i;
+
+	ndo->ndo_if_printer = get_if_printer(ndo, w->dlt);
+	ndo->ndo_snaplen = w->snaplen;
+	for (i = 0; i < w->npackets; i++)
+		pretty_print_packet(ndo, &w->packets[i].h,
+		    w->packets[i].data, i + 1);
+	best = 0;
+	mallocs = ndo->ndo_nd_mallocs;
+	for (it = 0; it < iterations; it++) {
+		start = now_ns();
+		for (i = 0; i < w->npackets; i++)
+			pretty_print_packet(ndo, &w->packets[i].h,
+			    w->packets[i].data, i + 1);
+		ns = now_ns() - start;
+		if (it == 0 || ns < best)
+			best = ns;
+	}
+	mallocs = ndo->ndo_nd_mallocs - mallocs;
+	(void)snprintf(r->name, sizeof(r->name), "%s", w->name);
+	r->npackets = w->npackets;
+	r->ns = (double)best / w->npackets;
+	r->allocs = (double)mallocs / ((double)iterations * w->npackets);
+}
+
+static void
+load_baseline(const char *file)
+{
+	char line[256];
+	struct result r, *b;
+	FILE *f;
+
+	f = fopen(file, "r");
+	if (f == NULL)
+		error("can't open %s", file);
+	while (fgets(line, sizeof(line), f) != NULL) {
+		if (line[0] == '#')
+			continue;
+		if (sscanf(line, "%127s %u %lf %lf", r.name, &r.npackets,
+		    &r.ns, &r.allocs) != 4)
+			continue;
+		b = (struct result *)realloc(baseline,
+		    (nbaseline + 1) * sizeof(*b));
+		if (b == NULL)
+			error("out of memory");
+		b[nbaseline++] = r;
+		baseline = b;
+	}
+	(void)fclose(f);
+}
+
+static const struct result *
+find_baseline(const char *name)
+{
+	u_int i;
+
+	for (i = 0; i < nbaseline; i++)
+		if (strcmp(baseline[i].name, name) == 0)
+			return (&baseline[i]);
+	return (NULL);
+}
+
+static void
+report(const struct result *r, FILE *out, u_int threshold)
+{
+	const struct result *b;
+
+	(void)printf("%-40s %8u %10.1f %8.2f", r->name, r->npackets, r->ns,
+	    r->allocs);
+	if ((b = find_baseline(r->name)) != NULL && b->ns > 0) {
+		(void)printf(" %+7.1f%%", (r->ns - b->ns) * 100.0 / b->ns);
+		if (r->ns > b->ns * (100 + threshold) / 100.0) {
+			(void)printf(" REGRESSION");
+			regressions++;
+		}
+	}
+	(void)putchar('\n');
+	if (out != NULL)
+		(void)fprintf(out, "%s\t%u\t%.1f\t%.2f\n", r->name, r->npackets,
+		    r->ns, r->allocs);
+}
+
+/*
+ * Time one accessor over a buffer, at every byte offset, "iterations"
+ * times, and keep the fastest; the sum keeps the loads from being
+ * optimized away.
+ */
+#define EXTRACT_BENCH(name, get, size) \
+static void \
+name(netdissect_options *ndo, const u_char *buf, u_int iterations, \
+     struct result *r) \
+{ \
+	uint64_t start, ns, best, sum; \
+	u_int it, pass, i; \
+\
+	best = 0; \
+	sum = 0; \
+	for (it = 0; it < iterations; it++) { \
+		start = now_ns(); \
+		for (pass = 0; pass < EXTRACT_PASSES; pass++) \
+			for (i = 0; i <= EXTRACT_BUFSIZE - (size); i++) \
+				sum += get(buf + i); \
+		ns = now_ns() - start; \
+		if (it == 0 || ns < best) \
+			best = ns; \
+	} \
+	extract_sink += sum; \
+	r->npackets = EXTRACT_BUFSIZE - (size) + 1; \
+	r->ns = (double)best / ((double)EXTRACT_PASSES * r->npackets); \
+	r->allocs = 0; \
+}
+
+static volatile uint64_t extract_sink;
+
+EXTRACT_BENCH(bench_be_u_2, GET_BE_U_2, 2)
+EXTRACT_BENCH(bench_be_u_4, GET_BE_U_4, 4)
+EXTRACT_BENCH(bench_be_u_8, GET_BE_U_8, 8)
+
+static void
+run_extract(netdissect_options *ndo, u_int iterations, FILE *out,
+	    u_int threshold)
+{
+	static const struct {
+		const char *name;
+		void (*bench)(netdissect_options *, const u_char *, u_int,
+		    struct result *);
+	} benches[] = {
+		{ "extract-be-u-2", bench_be_u_2 },
+		{ "extract-be-u-4", bench_be_u_4 },
+		{ "extract-be-u-8", bench_be_u_8 },
+	};
+	u_char *buf;
+	struct result r;
+	u_int i;
+
+	if ((buf = (u_char *)malloc(EXTRACT_BUFSIZE)) == NULL)
+		error("out of memory");
+	for (i = 0; i < EXTRACT_BUFSIZE; i++)
+		buf[i] = (u_char)(i * 131 + 7);
+	ndo->ndo_packetp = buf;
+	ndo->ndo_snapend = buf + EXTRACT_BUFSIZE;
+	for (i = 0; i < sizeof(benches) / sizeof(benches[0]); i++) {
+		(void)snprintf(r.name, sizeof(r.name), "%s", benches[i].name);
+		(*benches[i].bench)(ndo, buf, iterations, &r);
+		report(&r, out, threshold);
+	}
+	ndo->ndo_packetp = ndo->ndo_snapend = NULL;
+	free(buf);
+}
+
+/*
+ * Returns non-zero if "file" was already named earlier in TESTLIST.
+ */
+static int
+seen(char **names, u_int n, const char *file)
+{
+	u_int i;
+
+	for (i = 0; i < n; i++)
+		if (strcmp(names[i], file) == 0)
+			return (1);
+	return (0);
+}
+
+#ifdef ENABLE_DISSECTOR_PROFILE
+static void
+print_dissector_call(void *arg _U_, const char *name, uint64_t calls,
+    uint64_t total_ns, uint64_t self_ns, uint64_t truncated)
+{
+	(void)printf("%-16s %10" PRIu64 " %12.3f %12.3f %10" PRIu64 "\n",
+	    name, calls, (double)total_ns / 1000000.0,
+	    (double)self_ns / 1000000.0, truncated);
+}
+#endif
+
+static void NORETURN
+usage(void)
+{
+	(void)fprintf(stderr,
+"Usage: %s [ -b baseline ] [ -d dir ] [ -n iterations ] [ -o baseline ]\n"
+"\t\t[ -s count ] [ -t percent ] [ -vx ] [ savefile ... ]\n",
+	    program_name);
+	exit(2);
+}
+
+int
+main(int argc, char **argv)
+{
+	netdissect_options Ndo;
+	netdissect_options *ndo = &Ndo;
+	char ebuf[PCAP_ERRBUF_SIZE], line[1024], path[1024], file[256];
+	const char *dir = "tests", *out_file = NULL;
+	char **names = NULL, **n;
+	u_int nnames = 0, iterations = DEFAULT_ITERATIONS;
+	u_int synthetic = DEFAULT_SYNTHETIC, threshold = DEFAULT_THRESHOLD;
+	struct workload w;
+	struct result r;
+	FILE *list, *out = NULL;
+	u_int i;
+	int op, extract = 0;
+
+	if (nd_init(ebuf, sizeof(ebuf)) == -1)
+		error("%s", ebuf);
+	memset(ndo, 0, sizeof(*ndo));
+	ndo_set_function_pointers(ndo);
+	ndo->program_name = program_name;
+
+	while ((op = getopt_long(argc, argv, "b:d:n:o:s:t:vx", longopts,
+	    NULL)) != -1) {
+		switch (op) {
+
+		case 'b':
+			load_baseline(optarg);
+			break;
+
+		case 'd':
+			dir = optarg;
+			break;
+
+		case 'n':
+			iterations = (u_int)atoi(optarg);
+			if (iterations == 0)
+				error("invalid iteration count %s", optarg);
+			break;
+
+		case 'o':
+			out_file = optarg;
+			break;
+
+		case 's':
+			synthetic = (u_int)atoi(optarg);
+			break;
+
+		case 't':
+			threshold = (u_int)atoi(optarg);
+			break;
+
+		case 'v':
+			ndo->ndo_vflag++;
+			break;
+
+		case 'x':
+			extract = 1;
+			break;
+
+		default:
+			usage();
+		}
+	}
+
+	/* Don't let name lookups into the timings. */
+	ndo->ndo_nflag = 1;
+	init_print(ndo, 0, 0);
+	if (nd_outbuf_init(ndo, 65536) == -1)
+		error("out of memory");
+	ndo->ndo_output = null_output;
+#ifdef ENABLE_DISSECTOR_PROFILE
+	nd_profile_init(ndo);
+#endif
+
+	if (out_file != NULL && (out = fopen(out_file, "w")) == NULL)
+		error("can't create %s", out_file);
+	if (out != NULL)
+		(void)fprintf(out, "# name\tpackets\tns/packet\tallocs/packet\n");
+	(void)printf("%-40s %8s %10s %8s\n", "workload", "packets", "ns/pkt",
+	    "allocs");
+
+	if (extract) {
+		run_extract(ndo, iterations, out, threshold);
+		synthetic = 0;
+	} else if (optind < argc) {
+		for (i = optind; i < (u_int)argc; i++) {
+			memset(&w, 0, sizeof(w));
+			if (load_savefile(&w, ".", argv[i]) == -1)
+				continue;
+			run_workload(ndo, &w, iterations, &r);
+			report(&r, out, threshold);
+			free_workload(&w);
+		}
+	} else {
+		(void)snprintf(path, sizeof(path), "%s/TESTLIST", dir);
+		if ((list = fopen(path, "r")) == NULL)
+			error("can't open %s", path);
+		while (fgets(line, sizeof(line), list) != NULL) {
+			if (line[0] == '#' ||
+			    sscanf(line, "%*s %255s", file) != 1 ||
+			    seen(names, nnames, file))
+				continue;
+			n = (char **)realloc(names,
+			    (nnames + 1) * sizeof(*names));
+			if (n == NULL || (n[nnames] = strdup(file)) == NULL)
+				error("out of memory");
+			names = n;
+			nnames++;
+			memset(&w, 0, sizeof(w));
+			if (load_savefile(&w, dir, file) == -1)
+				continue;
+			run_workload(ndo, &w, iterations, &r);
+			report(&r, out, threshold);
+			free_workload(&w);
+		}
+		(void)fclose(list);
+	}
+
+	for (i = 0; synthetic != 0 && i < sizeof(synthetic_mixes) /
+	    sizeof(synthetic_mixes[0]); i++) {
+		memset(&w, 0, sizeof(w));
+		make_synthetic(&w, synthetic_mixes[i], synthetic);
+		run_workload(ndo, &w, iterations, &r);
+		report(&r, out, threshold);
+		free_workload(&w);
+	}
+
+#ifdef ENABLE_DISSECTOR_PROFILE
+	(void)printf("\n%-16s %10s %12s %12s %10s\n", "dissector", "calls",
+	    "total ms", "self ms", "truncated");
+	nd_profile_foreach(ndo, print_dissector_call, NULL);
+#endif
+
+	if (out != NULL && fclose(out) != 0)
+		error("error writing %s", out_file);
+	for (i = 0; i < nnames; i++)
+		free(names[i]);
+	free(names);
+	nd_cleanup();
+	if (regressions != 0) {
+		(void)fprintf(stderr, "%s: %d workload%s slower than the baseline\n",
+		    program_name, regressions, regressions == 1 ? " is" : "s are");
+		return (1);
+	}
+	return (0);
+}
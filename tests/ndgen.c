@@ -0,0 +1,258 @@
+/*
+ * Copyright (c) 2026 The TCPDUMP project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that: (1) source code
+ * distributions retain the above copyright notice and this paragraph
+ * in its entirety, and (2) distributions including binary code include
+ * the above copyright notice and this paragraph in its entirety in
+ * the documentation or other materials provided with the distribution.
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND
+ * WITHOUT ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, WITHOUT
+ * LIMITATION, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE.
+ */
+
+/*
+ * ndgen: write a savefile of synthetic traffic, for timing tcpdump -r
+ * on more than the test savefiles hold.
+ *
+ * The packets come from pktgen, so the same mix and seed always give
+ * the same file.  The file is written here rather than with pcap_dump(),
+ * so that a multi-gigabyte one doesn't take longer to make than to read,
+ * and so that it can be pcapng with libpcaps that can't write that.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include "netdissect-stdinc.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef HAVE_GETOPT_LONG
+#include <getopt.h>
+#else
+#include "missing/getopt_long.h"
+#endif
+
+#include "pktgen.h"
+
+#define DEFAULT_COUNT	1000000
+#define DEFAULT_RATE	100000		/* packets per second */
+#define SNAPLEN		262144
+#define LINKTYPE_ETHERNET	1
+
+static const struct option longopts[] = {
+	{ NULL, 0, NULL, 0 }
+};
+
+static const char *program_name = "ndgen";
+
+static void NORETURN
+error(const char *fmt, ...)
+{
+	va_list ap;
+
+	(void)fprintf(stderr, "%s: ", program_name);
+	va_start(ap, fmt);
+	(void)vfprintf(stderr, fmt, ap);
+	va_end(ap);
+	(void)fputc('\n', stderr);
+	exit(2);
+}
+
+static void
+put(FILE *f, const void *p, size_t len)
+{
+	if (fwrite(p, 1, len, f) != len)
+		error("write error");
+}
+
+static void
+put_32(FILE *f, uint32_t v)
+{
+	put(f, &v, 4);
+}
+
+static void
+put_16(FILE *f, uint16_t v)
+{
+	put(f, &v, 2);
+}
+
+/*
+ * The file header; both formats are written in the host's byte order,
+ * which readers figure out from the magic number.
+ */
+static void
+write_header(FILE *f, int pcapng)
+{
+	if (!pcapng) {
+		put_32(f, 0xa1b2c3d4);
+		put_16(f, 2);
+		put_16(f, 4);
+		put_32(f, 0);			/* thiszone */
+		put_32(f, 0);			/* sigfigs */
+		put_32(f, SNAPLEN);
+		put_32(f, LINKTYPE_ETHERNET);
+		return;
+	}
+	/* Section Header Block, no options */
+	put_32(f, 0x0a0d0d0a);
+	put_32(f, 28);
+	put_32(f, 0x1a2b3c4d);
+	put_16(f, 1);
+	put_16(f, 0);
+	put_32(f, 0xffffffff);			/* section length unknown */
+	put_32(f, 0xffffffff);
+	put_32(f, 28);
+	/* Interface Description Block, microsecond time stamps */
+	put_32(f, 1);
+	put_32(f, 20);
+	put_16(f, LINKTYPE_ETHERNET);
+	put_16(f, 0);
+	put_32(f, SNAPLEN);
+	put_32(f, 20);
+}
+
+/*
+ * Returns the number of bytes written.
+ */
+static u_int
+write_packet(FILE *f, int pcapng, const struct timeval *ts,
+	     const u_char *pkt, u_int len)
+{
+	static const u_char pad[4];
+	uint64_t t;
+	u_int padlen;
+
+	if (!pcapng) {
+		put_32(f, (uint32_t)ts->tv_sec);
+		put_32(f, (uint32_t)ts->tv_usec);
+		put_32(f, len);
+		put_32(f, len);
+		put(f, pkt, len);
+		return (16 + len);
+	}
+	/* Enhanced Packet Block */
+	padlen = (4 - len % 4) % 4;
+	t = (uint64_t)ts->tv_sec * 1000000 + (uint64_t)ts->tv_usec;
+	put_32(f, 6);
+	put_32(f, 32 + len + padlen);
+	put_32(f, 0);				/* interface */
+	put_32(f, (uint32_t)(t >> 32));
+	put_32(f, (uint32_t)t);
+	put_32(f, len);
+	put_32(f, len);
+	put(f, pkt, len);
+	put(f, pad, padlen);
+	put_32(f, 32 + len + padlen);
+	return (32 + len + padlen);
+}
+
+static void NORETURN
+usage(void)
+{
+	(void)fprintf(stderr,
+"Usage: %s [ -c count ] [ -C megabytes ] [ -F pcap|pcapng ] [ -m mix ]\n"
+"\t\t[ -r rate ] [ -s seed ] -w file\n"
+"The default mix is %s.\n",
+	    program_name, PKTGEN_DEFAULT_MIX);
+	exit(2);
+}
+
+int
+main(int argc, char **argv)
+{
+	const char *out_file = NULL, *mix = PKTGEN_DEFAULT_MIX;
+	u_long count = DEFAULT_COUNT, rate = DEFAULT_RATE, seed = 1;
+	uint64_t limit = 0, written;
+	u_char pkt[PKTGEN_MAXLEN];
+	char ebuf[128];
+	struct pktgen *g;
+	struct timeval ts;
+	u_long n;
+	u_int len;
+	FILE *f;
+	int pcapng = 0, op;
+
+	while ((op = getopt_long(argc, argv, "c:C:F:m:r:s:w:", longopts,
+	    NULL)) != -1) {
+		switch (op) {
+
+		case 'c':
+			count = strtoul(optarg, NULL, 10);
+			break;
+
+		case 'C':
+			limit = (uint64_t)strtoul(optarg, NULL, 10) * 1000000;
+			if (limit == 0)
+				error("invalid file size %s", optarg);
+			count = 0;
+			break;
+
+		case 'F':
+			if (strcmp(optarg, "pcap") == 0)
+				pcapng = 0;
+			else if (strcmp(optarg, "pcapng") == 0)
+				pcapng = 1;
+			else
+				error("unknown file format %s", optarg);
+			break;
+
+		case 'm':
+			mix = optarg;
+			break;
+
+		case 'r':
+			rate = strtoul(optarg, NULL, 10);
+			if (rate == 0 || rate > 1000000000)
+				error("invalid rate %s", optarg);
+			break;
+
+		case 's':
+			seed = strtoul(optarg, NULL, 0);
+			break;
+
+		case 'w':
+			out_file = optarg;
+			break;
+
+		default:
+			usage();
+		}
+	}
+	if (out_file == NULL || optind != argc)
+		usage();
+	if (count == 0 && limit == 0)
+		error("no packet count or file size");
+
+	g = pktgen_create(mix, (uint32_t)seed, (u_int)rate, ebuf,
+	    sizeof(ebuf));
+	if (g == NULL)
+		error("%s", ebuf);
+	if (strcmp(out_file, "-") == 0)
+		f = stdout;
+	else if ((f = fopen(out_file, "wb")) == NULL)
+		error("can't create %s", out_file);
+	(void)setvbuf(f, NULL, _IOFBF, 1024 * 1024);
+
+	write_header(f, pcapng);
+	written = 0;
+	for (n = 0; count == 0 || n < count; n++) {
+		len = pktgen_next(g, pkt, &ts);
+		written += write_packet(f, pcapng, &ts, pkt, len);
+		if (limit != 0 && written >= limit)
+			break;
+	}
+	if (fflush(f) != 0 || (f != stdout && fclose(f) != 0))
+		error("error writing %s", out_file);
+	pktgen_destroy(g);
+	return (0);
+}
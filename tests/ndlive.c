@@ -0,0 +1,585 @@
+/*
+ * Copyright (c) 2026 The TCPDUMP project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that: (1) source code
+ * distributions retain the above copyright notice and this paragraph
+ * in its entirety, and (2) distributions including binary code include
+ * the above copyright notice and this paragraph in its entirety in
+ * the documentation or other materials provided with the distribution.
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND
+ * WITHOUT ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, WITHOUT
+ * LIMITATION, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE.
+ */
+
+/*
+ * ndlive: find the packet rate at which each tcpdump mode starts to
+ * drop packets on a live capture.
+ *
+ * Traffic, from pktgen or replayed from a savefile, is sent with
+ * pcap_inject() on one interface at doubling rates, while tcpdump
+ * captures on an interface that sees it: the same one, or the other
+ * end of a veth pair, which -V makes with ip(8) and removes afterwards.
+ * For each mode and rate tcpdump is started, sent the traffic for a
+ * few seconds once it's listening, given a second to catch up and
+ * stopped with SIGINT, and the counts it reports on the standard error
+ * from pcap_stats() are recorded.  The result is a table, and with -o
+ * a tab-separated file, for comparing one release with another.
+ *
+ * It needs the privileges to capture and to send.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include "netdissect-stdinc.h"
+
+#include <pcap.h>
+#include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#ifdef HAVE_GETOPT_LONG
+#include <getopt.h>
+#else
+#include "missing/getopt_long.h"
+#endif
+
+#include "pktgen.h"
+
+#define DEFAULT_MIN_RATE	10000		/* packets per second */
+#define DEFAULT_MAX_RATE	1280000
+#define DEFAULT_SECONDS		5
+#define DEFAULT_PACKETS		10000		/* of pktgen traffic, cycled */
+#define DEFAULT_THRESHOLD	0.1		/* percent */
+#define VETH_SEND		"ndlive0"
+#define VETH_CAPTURE		"ndlive1"
+#define MAX_ARGS		64
+
+/*
+ * The modes; "%s" in the arguments is a directory for the savefiles.
+ */
+struct mode {
+	const char *name;
+	const char *args;
+};
+
+static const struct mode modes[] = {
+	{ "default",		"" },
+	{ "-v",			"-v" },
+	{ "-w",			"-w %s/ndlive.pcap" },
+	{ "-w-z",		"-w %s/ndlive.pcap -C 100 -z gzip" },
+	{ "dissect-threads",	"--dissect-threads 4" },
+};
+
+#define NMODES	(sizeof(modes) / sizeof(modes[0]))
+
+struct packet {
+	u_char *data;
+	u_int len;
+};
+
+struct traffic {
+	struct packet *packets;
+	u_int npackets;
+};
+
+/* What tcpdump reported for one run. */
+struct counts {
+	u_long captured;
+	u_long received;
+	u_long dropped;		/* by the kernel and by the interface */
+};
+
+static const struct option longopts[] = {
+	{ NULL, 0, NULL, 0 }
+};
+
+static const char *program_name = "ndlive";
+static int made_veth;
+static char save_dir[] = "/tmp/ndliveXXXXXX";
+static int made_save_dir;
+
+static void NORETURN
+error(const char *fmt, ...)
+{
+	va_list ap;
+
+	(void)fprintf(stderr, "%s: ", program_name);
+	va_start(ap, fmt);
+	(void)vfprintf(stderr, fmt, ap);
+	va_end(ap);
+	(void)fputc('\n', stderr);
+	exit(2);
+}
+
+static uint64_t
+now_ns(void)
+{
+	struct timespec ts;
+
+	(void)clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ((uint64_t)ts.tv_sec * 1000000000 + (uint64_t)ts.tv_nsec);
+}
+
+static void
+sleep_ns(uint64_t ns)
+{
+	struct timespec ts;
+
+	ts.tv_sec = (time_t)(ns / 1000000000);
+	ts.tv_nsec = (long)(ns % 1000000000);
+	while (nanosleep(&ts, &ts) == -1 && errno == EINTR)
+		;
+}
+
+static void
+cleanup(void)
+{
+	char cmd[128];
+
+	if (made_veth)
+		(void)system("ip link del " VETH_SEND);
+	if (made_save_dir) {
+		(void)snprintf(cmd, sizeof(cmd), "rm -rf %s", save_dir);
+		(void)system(cmd);
+	}
+}
+
+static void
+add_packet(struct traffic *t, const u_char *data, u_int len)
+{
+	struct packet *p;
+
+	p = (struct packet *)realloc(t->packets,
+	    (t->npackets + 1) * sizeof(*p));
+	if (p == NULL)
+		error("out of memory");
+	t->packets = p;
+	p = &t->packets[t->npackets++];
+	if ((p->data = (u_char *)malloc(len)) == NULL)
+		error("out of memory");
+	memcpy(p->data, data, len);
+	p->len = len;
+}
+
+static void
+load_synthetic(struct traffic *t, const char *mix, u_int count)
+{
+	u_char pkt[PKTGEN_MAXLEN];
+	char ebuf[128];
+	struct timeval ts;
+	struct pktgen *g;
+	u_int i;
+
+	g = pktgen_create(mix, 1, 1000000, ebuf, sizeof(ebuf));
+	if (g == NULL)
+		error("%s", ebuf);
+	for (i = 0; i < count; i++)
+		add_packet(t, pkt, pktgen_next(g, pkt, &ts));
+	pktgen_destroy(g);
+}
+
+static void
+load_savefile(struct traffic *t, const char *file)
+{
+	char ebuf[PCAP_ERRBUF_SIZE];
+	struct pcap_pkthdr *h;
+	const u_char *data;
+	pcap_t *pd;
+
+	if ((pd = pcap_open_offline(file, ebuf)) == NULL)
+		error("%s", ebuf);
+	if (pcap_datalink(pd) != DLT_EN10MB)
+		error("%s isn't an Ethernet savefile", file);
+	while (pcap_next_ex(pd, &h, &data) == 1)
+		if (h->caplen == h->len)
+			add_packet(t, data, h->caplen);
+	pcap_close(pd);
+	if (t->npackets == 0)
+		error("%s has no complete packets", file);
+}
+
+/*
+ * Send "rate" packets a second for "seconds", cycling through the
+ * traffic; returns the number sent.  The packets are paced against
+ * the clock, so a sender that can't keep up sends fewer.
+ */
+static uint64_t
+send_traffic(pcap_t *pd, const struct traffic *t, u_long rate,
+	     u_int seconds)
+{
+	uint64_t start, end, due, now, sent, n;
+	const struct packet *p;
+	u_int i;
+
+	start = now_ns();
+	end = start + (uint64_t)seconds * 1000000000;
+	sent = 0;
+	i = 0;
+	for (n = 0; ; n++) {
+		due = start + n * 1000000000 / rate;
+		if (due >= end)
+			break;
+		now = now_ns();
+		if (now >= end)
+			break;
+		if (due > now + 100000)
+			sleep_ns(due - now);
+		p = &t->packets[i];
+		if (pcap_inject(pd, p->data, p->len) != -1)
+			sent++;
+		if (++i == t->npackets)
+			i = 0;
+	}
+	return (sent);
+}
+
+/*
+ * Find "N packet(s) <what>" in tcpdump's report.
+ */
+static int
+find_count(const char *text, const char *what, u_long *count)
+{
+	const char *p;
+	char *end;
+	u_long n;
+
+	for (p = text; *p != '\0'; p++) {
+		if (!isdigit((u_char)*p) ||
+		    (p > text && isdigit((u_char)p[-1])))
+			continue;
+		n = strtoul(p, &end, 10);
+		if (strncmp(end, " packet", 7) != 0)
+			continue;
+		end += 7;
+		if (*end == 's')
+			end++;
+		if (*end == ' ' && strncmp(end + 1, what, strlen(what)) == 0) {
+			*count = n;
+			return (1);
+		}
+	}
+	return (0);
+}
+
+/*
+ * Read what the child writes to "fd" until "until" appears or, if it's
+ * NULL, until end of file; returns 0 if it didn't appear.
+ */
+static int
+read_output(int fd, char *buf, size_t size, size_t *len, const char *until)
+{
+	ssize_t n;
+
+	for (;;) {
+		if (until != NULL && strstr(buf, until) != NULL)
+			return (1);
+		if (*len + 1 >= size)
+			return (until == NULL);
+		n = read(fd, buf + *len, size - 1 - *len);
+		if (n == -1 && errno == EINTR)
+			continue;
+		if (n <= 0)
+			return (until == NULL);
+		*len += (size_t)n;
+		buf[*len] = '\0';
+	}
+}
+
+/*
+ * Run tcpdump in "mode" on "device" while sending the traffic at
+ * "rate"; returns -1 if it couldn't be run in that mode, with its
+ * complaint in "buf".
+ */
+static int
+run_one(const char *tcpdump, const char *device, const struct mode *mode,
+	const char *extra, pcap_t *pd, const struct traffic *t, u_long rate,
+	u_int seconds, uint64_t *sent, struct counts *c, char *buf,
+	size_t size)
+{
+	char path[1024], args[1024], *argv[MAX_ARGS + 1], *tok;
+	u_long ifdrop;
+	size_t len;
+	pid_t pid;
+	int fds[2], argc, status, nullfd;
+
+	/*
+	 * execv() wants writable strings; the path has a buffer of its
+	 * own, as it may have spaces, and an interface name has none.
+	 */
+	(void)snprintf(path, sizeof(path), "%s", tcpdump);
+	(void)snprintf(args, sizeof(args), "-n -i %s ", device);
+	len = strlen(args);
+	(void)snprintf(args + len, sizeof(args) - len, mode->args, save_dir);
+	if (extra != NULL) {
+		(void)strncat(args, " ", sizeof(args) - strlen(args) - 1);
+		(void)strncat(args, extra, sizeof(args) - strlen(args) - 1);
+	}
+	argc = 0;
+	argv[argc++] = path;
+	for (tok = strtok(args, " "); tok != NULL && argc < MAX_ARGS;
+	    tok = strtok(NULL, " "))
+		argv[argc++] = tok;
+	argv[argc] = NULL;
+
+	if (pipe(fds) == -1)
+		error("pipe: %s", strerror(errno));
+	if ((pid = fork()) == -1)
+		error("fork: %s", strerror(errno));
+	if (pid == 0) {
+		nullfd = open("/dev/null", O_WRONLY);
+		(void)dup2(nullfd, 1);
+		(void)dup2(fds[1], 2);
+		(void)close(fds[0]);
+		(void)close(fds[1]);
+		(void)execv(path, argv);
+		(void)fprintf(stderr, "can't run %s: %s\n", tcpdump,
+		    strerror(errno));
+		_exit(127);
+	}
+	(void)close(fds[1]);
+
+	buf[0] = '\0';
+	len = 0;
+	if (!read_output(fds[0], buf, size, &len, "listening on")) {
+		(void)read_output(fds[0], buf, size, &len, NULL);
+		(void)close(fds[0]);
+		(void)waitpid(pid, &status, 0);
+		return (-1);
+	}
+	sleep_ns(500000000);
+	*sent = send_traffic(pd, t, rate, seconds);
+	sleep_ns(1000000000);
+	(void)kill(pid, SIGINT);
+	(void)read_output(fds[0], buf, size, &len, NULL);
+	(void)close(fds[0]);
+	(void)waitpid(pid, &status, 0);
+
+	memset(c, 0, sizeof(*c));
+	if (!find_count(buf, "captured", &c->captured) ||
+	    !find_count(buf, "received by filter", &c->received) ||
+	    !find_count(buf, "dropped by kernel", &c->dropped))
+		return (-1);
+	if (find_count(buf, "dropped by interface", &ifdrop))
+		c->dropped += ifdrop;
+	return (0);
+}
+
+static const struct mode *
+find_mode(const char *name)
+{
+	u_int i;
+
+	for (i = 0; i < NMODES; i++)
+		if (strcmp(modes[i].name, name) == 0)
+			return (&modes[i]);
+	return (NULL);
+}
+
+static void NORETURN
+usage(void)
+{
+	u_int i;
+
+	(void)fprintf(stderr,
+"Usage: %s [ -a args ] [ -d seconds ] [ -i interface [ -I interface ] | -V ]\n"
+"\t\t[ -m mode[,mode...] ] [ -M mix | -s savefile ] [ -o file ]\n"
+"\t\t[ -p tcpdump ] [ -r rate ] [ -R rate ] [ -t percent ]\n"
+"The modes are",
+	    program_name);
+	for (i = 0; i < NMODES; i++)
+		(void)fprintf(stderr, "%s %s", i == 0 ? "" : ",",
+		    modes[i].name);
+	(void)fprintf(stderr, "; the default mix is %s.\n",
+	    PKTGEN_DEFAULT_MIX);
+	exit(2);
+}
+
+int
+main(int argc, char **argv)
+{
+	const char *tcpdump = "./tcpdump", *send_device = NULL;
+	const char *capture_device = NULL, *extra = NULL, *mix = NULL;
+	const char *savefile = NULL, *out_file = NULL;
+	const struct mode *run[NMODES];
+	u_long min_rate = DEFAULT_MIN_RATE, max_rate = DEFAULT_MAX_RATE;
+	u_long rate, limit;
+	u_int seconds = DEFAULT_SECONDS, nrun = 0, i;
+	double threshold = DEFAULT_THRESHOLD, pct;
+	char ebuf[PCAP_ERRBUF_SIZE], buf[8192], *list, *name;
+	struct traffic t;
+	struct counts c;
+	uint64_t sent;
+	FILE *out = NULL;
+	pcap_t *pd;
+	int veth = 0, op;
+
+	while ((op = getopt_long(argc, argv, "a:d:i:I:m:M:o:p:r:R:s:t:V",
+	    longopts, NULL)) != -1) {
+		switch (op) {
+
+		case 'a':
+			extra = optarg;
+			break;
+
+		case 'd':
+			seconds = (u_int)atoi(optarg);
+			if (seconds == 0)
+				error("invalid duration %s", optarg);
+			break;
+
+		case 'i':
+			send_device = optarg;
+			break;
+
+		case 'I':
+			capture_device = optarg;
+			break;
+
+		case 'm':
+			if ((list = strdup(optarg)) == NULL)
+				error("out of memory");
+			for (name = strtok(list, ","); name != NULL;
+			    name = strtok(NULL, ",")) {
+				if (nrun == NMODES)
+					error("too many modes");
+				if ((run[nrun++] = find_mode(name)) == NULL)
+					error("unknown mode %s", name);
+			}
+			free(list);
+			break;
+
+		case 'M':
+			mix = optarg;
+			break;
+
+		case 'o':
+			out_file = optarg;
+			break;
+
+		case 'p':
+			tcpdump = optarg;
+			break;
+
+		case 'r':
+			min_rate = strtoul(optarg, NULL, 10);
+			if (min_rate == 0)
+				error("invalid rate %s", optarg);
+			break;
+
+		case 'R':
+			max_rate = strtoul(optarg, NULL, 10);
+			if (max_rate == 0)
+				error("invalid rate %s", optarg);
+			break;
+
+		case 's':
+			savefile = optarg;
+			break;
+
+		case 't':
+			threshold = atof(optarg);
+			break;
+
+		case 'V':
+			veth = 1;
+			break;
+
+		default:
+			usage();
+		}
+	}
+	if (optind != argc || (veth == (send_device != NULL)) ||
+	    (mix != NULL && savefile != NULL))
+		usage();
+	if (nrun == 0)
+		for (; nrun < NMODES; nrun++)
+			run[nrun] = &modes[nrun];
+
+	if (atexit(cleanup) != 0)
+		error("atexit failed");
+	if (veth) {
+		if (system("ip link add " VETH_SEND " type veth peer name "
+		    VETH_CAPTURE " && ip link set " VETH_SEND " up && "
+		    "ip link set " VETH_CAPTURE " up") != 0)
+			error("can't create the veth pair");
+		made_veth = 1;
+		send_device = VETH_SEND;
+		capture_device = VETH_CAPTURE;
+	}
+	if (capture_device == NULL)
+		capture_device = send_device;
+	if (mkdtemp(save_dir) == NULL)
+		error("can't create a directory for savefiles: %s",
+		    strerror(errno));
+	made_save_dir = 1;
+
+	memset(&t, 0, sizeof(t));
+	if (savefile != NULL)
+		load_savefile(&t, savefile);
+	else
+		load_synthetic(&t, mix != NULL ? mix : PKTGEN_DEFAULT_MIX,
+		    DEFAULT_PACKETS);
+
+	if ((pd = pcap_open_live(send_device, 65535, 0, 1000, ebuf)) == NULL)
+		error("%s", ebuf);
+	if (out_file != NULL && (out = fopen(out_file, "w")) == NULL)
+		error("can't create %s", out_file);
+	if (out != NULL)
+		(void)fprintf(out,
+		    "# mode\trate\tsent\tcaptured\treceived\tdropped\n");
+
+	(void)printf("%-16s %10s %10s %10s %10s %10s %7s\n", "mode", "rate/s",
+	    "sent/s", "captured", "received", "dropped", "drop%");
+	for (i = 0; i < nrun; i++) {
+		limit = 0;
+		for (rate = min_rate; rate <= max_rate; rate *= 2) {
+			if (run_one(tcpdump, capture_device, run[i], extra, pd,
+			    &t, rate, seconds, &sent, &c, buf,
+			    sizeof(buf)) == -1) {
+				(void)printf("%-16s not run: %s", run[i]->name,
+				    buf[0] != '\0' ? buf : "no counts\n");
+				limit = (u_long)-1;
+				break;
+			}
+			pct = c.received != 0 ?
+			    (double)c.dropped * 100.0 / c.received : 0.0;
+			(void)printf("%-16s %10lu %10" PRIu64 " %10lu %10lu %10lu %7.2f\n",
+			    run[i]->name, rate, sent / seconds, c.captured,
+			    c.received, c.dropped, pct);
+			(void)fflush(stdout);
+			if (out != NULL)
+				(void)fprintf(out, "%s\t%lu\t%" PRIu64 "\t%lu\t%lu\t%lu\n",
+				    run[i]->name, rate, sent, c.captured,
+				    c.received, c.dropped);
+			if (limit == 0 && pct > threshold)
+				limit = rate;
+		}
+		if (limit == 0)
+			(void)printf("%-16s no drops above %.2f%% up to %lu packets/s\n",
+			    run[i]->name, threshold, max_rate);
+		else if (limit != (u_long)-1)
+			(void)printf("%-16s drops above %.2f%% from %lu packets/s\n",
+			    run[i]->name, threshold, limit);
+	}
+
+	pcap_close(pd);
+	if (out != NULL && fclose(out) != 0)
+		error("error writing %s", out_file);
+	for (i = 0; i < t.npackets; i++)
+		free(t.packets[i].data);
+	free(t.packets);
+	return (0);
+}
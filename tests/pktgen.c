@@ -0,0 +1,1038 @@
+/*
+ * Copyright (c) 2026 The TCPDUMP project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that: (1) source code
+ * distributions retain the above copyright notice and this paragraph
+ * in its entirety, and (2) distributions including binary code include
+ * the above copyright notice and this paragraph in its entirety in
+ * the documentation or other materials provided with the distribution.
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND
+ * WITHOUT ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, WITHOUT
+ * LIMITATION, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include "netdissect-stdinc.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * ESP is encrypted only if there's a libcrypto with
+ * EVP_CIPHER_CTX_new(); otherwise the ciphertext is random bytes.
+ */
+#if defined(HAVE_LIBCRYPTO) && defined(HAVE_OPENSSL_EVP_H) && \
+    defined(HAVE_EVP_CIPHER_CTX_NEW)
+#define PKTGEN_ENCRYPT
+#include <openssl/evp.h>
+#endif
+
+#include "pktgen.h"
+
+#define KIND_TCP	0
+#define KIND_DNS	1
+#define KIND_IP6	2
+#define KIND_VXLAN	3
+#define KIND_GENEVE	4
+#define KIND_ESP	5
+#define KIND_BGP	6
+#define KIND_L2TP	7
+#define NKINDS		8
+
+static const char *const kind_names[NKINDS] = {
+	"tcp", "dns", "ip6", "vxlan", "geneve", "esp", "bgp", "l2tp"
+};
+
+#define NFLOWS		64	/* TCP flows in progress at once */
+#define NBGP		4	/* BGP sessions */
+
+#define TH_FIN	0x01
+#define TH_SYN	0x02
+#define TH_PUSH	0x08
+#define TH_ACK	0x10
+
+struct flow {
+	uint32_t caddr, saddr;		/* client and server */
+	uint16_t cport, sport;
+	uint32_t cseq, sseq;
+	uint32_t tsval;
+	u_int step, nsteps;
+};
+
+/* The SAs in tests/esp-secrets.txt. */
+struct esp_sa {
+	uint32_t spi;
+	uint32_t dst;
+	u_int ivlen;			/* also the block size */
+	u_int keylen;
+	const char *key;		/* in hex */
+};
+
+static const struct esp_sa esp_sas[] = {
+	{ 0x12345678, 0xc001022d, 8, 24,
+	  "43434545464649494a4a4c4c4f4f51515252545457575840" },
+	{ 0xabcdabcd, 0xc0000101, 8, 24,
+	  "434545464649494a4a4c4c4f4f5151525254545757584043" },
+	{ 0xd1234567, 0xc001022d, 16, 32,
+	  "aaaabbbbccccdddd4043434545464649494a4a4c4c4f4f515152525454575758" }
+};
+#define NSAS	(sizeof(esp_sas) / sizeof(esp_sas[0]))
+
+struct pktgen {
+	u_int kind[NKINDS];		/* by cumulative weight */
+	u_int weight[NKINDS];
+	u_int nkinds;
+	u_int total_weight;
+	uint32_t rng;
+	uint64_t now_ns;		/* since PKTGEN_START_TIME */
+	uint64_t interval_ns;
+	uint16_t ip_id;
+	struct flow flows[NFLOWS];
+	struct flow bgp[NBGP];
+	uint16_t l2tp_ns;
+	uint32_t esp_seq[NSAS];
+	u_char esp_key[NSAS][32];
+#ifdef PKTGEN_ENCRYPT
+	EVP_CIPHER_CTX *ctx;
+#endif
+};
+
+static const char *const dns_names[] = {
+	"www.example.com", "mail.example.org", "ns1.example.net",
+	"api.example.com", "cdn.example.net", "login.example.org"
+};
+#define NDNS_NAMES	(sizeof(dns_names) / sizeof(dns_names[0]))
+
+static const uint16_t tcp_ports[] = { 80, 443, 22, 8080, 5001, 993 };
+#define NTCP_PORTS	(sizeof(tcp_ports) / sizeof(tcp_ports[0]))
+
+/* xorshift32; never 0 */
+static uint32_t
+rnd(struct pktgen *g)
+{
+	uint32_t x = g->rng;
+
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	g->rng = x;
+	return (x);
+}
+
+static u_int
+rnd_range(struct pktgen *g, u_int lo, u_int hi)
+{
+	return (lo + rnd(g) % (hi - lo + 1));
+}
+
+static void
+rnd_fill(struct pktgen *g, u_char *p, u_int len)
+{
+	uint32_t r = 0;
+	u_int i;
+
+	for (i = 0; i < len; i++) {
+		if ((i & 3) == 0)
+			r = rnd(g);
+		p[i] = (u_char)r;
+		r >>= 8;
+	}
+}
+
+static void
+put_16(u_char *p, u_int v)
+{
+	p[0] = (u_char)(v >> 8);
+	p[1] = (u_char)v;
+}
+
+static void
+put_32(u_char *p, uint32_t v)
+{
+	p[0] = (u_char)(v >> 24);
+	p[1] = (u_char)(v >> 16);
+	p[2] = (u_char)(v >> 8);
+	p[3] = (u_char)v;
+}
+
+/* Ones'-complement sum, to be folded by cksum_fold(). */
+static uint32_t
+cksum_add(uint32_t sum, const u_char *p, u_int len)
+{
+	u_int i;
+
+	for (i = 0; i + 1 < len; i += 2)
+		sum += (uint32_t)p[i] << 8 | p[i + 1];
+	if (len & 1)
+		sum += (uint32_t)p[len - 1] << 8;
+	return (sum);
+}
+
+static uint16_t
+cksum_fold(uint32_t sum)
+{
+	while (sum >> 16)
+		sum = (sum & 0xffff) + (sum >> 16);
+	return ((uint16_t)~sum);
+}
+
+/*
+ * Ethernet header, with the MAC addresses made from the IPv4 ones.
+ */
+static u_int
+put_ether(u_char *p, uint32_t src, uint32_t dst, u_int type)
+{
+	p[0] = 0x02;
+	p[1] = 0x00;
+	put_32(p + 2, dst);
+	p[6] = 0x02;
+	p[7] = 0x00;
+	put_32(p + 8, src);
+	put_16(p + 12, type);
+	return (14);
+}
+
+/*
+ * IPv4 header for "len" bytes of payload; fills in the transport
+ * checksum at "ck" bytes into the payload, if it's non-negative.
+ */
+static u_int
+put_ip(struct pktgen *g, u_char *p, uint32_t src, uint32_t dst,
+       u_int proto, u_int len, int ck)
+{
+	uint32_t sum;
+	u_char pseudo[4];
+
+	memset(p, 0, 20);
+	p[0] = 0x45;
+	put_16(p + 2, 20 + len);
+	put_16(p + 4, g->ip_id++);
+	p[6] = 0x40;			/* DF */
+	p[8] = 64;
+	p[9] = (u_char)proto;
+	put_32(p + 12, src);
+	put_32(p + 16, dst);
+	put_16(p + 10, cksum_fold(cksum_add(0, p, 20)));
+	if (ck >= 0) {
+		put_16(p + 20 + ck, 0);
+		sum = cksum_add(0, p + 12, 8);
+		pseudo[0] = 0;
+		pseudo[1] = (u_char)proto;
+		put_16(pseudo + 2, len);
+		sum = cksum_add(sum, pseudo, 4);
+		sum = cksum_add(sum, p + 20, len);
+		put_16(p + 20 + ck, cksum_fold(sum));
+	}
+	return (20);
+}
+
+static u_int
+put_udp(u_char *p, u_int sport, u_int dport, u_int len)
+{
+	put_16(p, sport);
+	put_16(p + 2, dport);
+	put_16(p + 4, 8 + len);
+	put_16(p + 6, 0);
+	return (8);
+}
+
+/*
+ * A TCP segment in IPv4, with "paylen" bytes of payload already at
+ * p + 20 + 20 + optlen.  Returns the length from the IP header on.
+ */
+static u_int
+put_tcp(struct pktgen *g, u_char *p, uint32_t src, uint32_t dst,
+	u_int sport, u_int dport, uint32_t seq, uint32_t ack, u_int flags,
+	const u_char *opts, u_int optlen, u_int paylen)
+{
+	u_char *th = p + 20;
+
+	put_16(th, sport);
+	put_16(th + 2, dport);
+	put_32(th + 4, seq);
+	put_32(th + 8, flags & TH_ACK ? ack : 0);
+	th[12] = (u_char)((20 + optlen) / 4 << 4);
+	th[13] = (u_char)flags;
+	put_16(th + 14, 65535);
+	put_16(th + 18, 0);
+	memcpy(th + 20, opts, optlen);
+	put_ip(g, p, src, dst, 6, 20 + optlen + paylen, 16);
+	return (20 + 20 + optlen + paylen);
+}
+
+static void
+new_flow(struct pktgen *g, struct flow *f, uint32_t cnet, uint32_t snet,
+	 u_int sport)
+{
+	f->caddr = cnet | rnd_range(g, 1, 254);
+	f->saddr = snet | rnd_range(g, 1, 30);
+	f->cport = (uint16_t)rnd_range(g, 32768, 60999);
+	f->sport = (uint16_t)sport;
+	f->cseq = rnd(g);
+	f->sseq = rnd(g);
+	f->tsval = rnd(g);
+	f->step = 0;
+	f->nsteps = rnd_range(g, 6, 40);
+}
+
+static const char http_request[] =
+	"GET /index.html HTTP/1.1\r\nHost: www.example.com\r\n"
+	"User-Agent: ndgen\r\nAccept: */*\r\n\r\n";
+static const char http_response[] =
+	"HTTP/1.1 200 OK\r\nContent-Type: text/html\r\n"
+	"Content-Length: 1024\r\n\r\n";
+
+/*
+ * The next segment of a TCP flow, with its options.
+ */
+static u_int
+gen_tcp(struct pktgen *g, u_char *p)
+{
+	struct flow *f = &g->flows[rnd(g) % NFLOWS];
+	u_char opts[40], *pay;
+	u_int optlen, paylen, flags, off;
+	int from_client;
+
+	if (f->nsteps == 0 || f->step > f->nsteps)
+		new_flow(g, f, 0x0a000000, 0xc0a80000,
+		    tcp_ports[rnd(g) % NTCP_PORTS]);
+	from_client = f->step == 0 || f->step == 2 ||
+	    (f->step > 2 && (f->step & 1)) || f->step == f->nsteps - 1;
+	if (f->step == f->nsteps)
+		from_client = 0;
+	f->tsval += rnd_range(g, 1, 10);
+
+	optlen = 0;
+	if (f->step < 2) {
+		opts[0] = 2; opts[1] = 4;		/* MSS */
+		put_16(opts + 2, 1460);
+		opts[4] = 4; opts[5] = 2;		/* SACK permitted */
+		opts[6] = 8; opts[7] = 10;		/* time stamps */
+		put_32(opts + 8, f->tsval);
+		put_32(opts + 12, f->step == 0 ? 0 : f->tsval - 1);
+		opts[16] = 1;				/* NOP */
+		opts[17] = 3; opts[18] = 3; opts[19] = 7;	/* wscale */
+		optlen = 20;
+	} else {
+		opts[0] = 1; opts[1] = 1;
+		opts[2] = 8; opts[3] = 10;
+		put_32(opts + 4, f->tsval);
+		put_32(opts + 8, f->tsval - 1);
+		optlen = 12;
+		if ((rnd(g) & 15) == 0) {
+			opts[12] = 1; opts[13] = 1;
+			opts[14] = 5; opts[15] = 10;	/* SACK */
+			put_32(opts + 16, f->cseq + 1000);
+			put_32(opts + 20, f->cseq + 2448);
+			optlen = 24;
+		}
+	}
+
+	off = 14;
+	pay = p + off + 20 + 20 + optlen;
+	paylen = 0;
+	if (f->step == 0)
+		flags = TH_SYN;
+	else if (f->step == 1)
+		flags = TH_SYN | TH_ACK;
+	else if (f->step >= f->nsteps - 1)
+		flags = TH_FIN | TH_ACK;
+	else {
+		flags = TH_ACK;
+		if (f->step > 2) {
+			flags |= TH_PUSH;
+			if (f->sport == 80 && f->step <= 4) {
+				paylen = from_client ? sizeof(http_request) - 1 :
+				    sizeof(http_response) - 1;
+				memcpy(pay, from_client ? http_request :
+				    http_response, paylen);
+			} else {
+				paylen = from_client ? rnd_range(g, 20, 200) :
+				    rnd_range(g, 100, 1448);
+				rnd_fill(g, pay, paylen);
+			}
+		}
+	}
+
+	if (from_client) {
+		put_ether(p, f->caddr, f->saddr, 0x0800);
+		off += put_tcp(g, p + off, f->caddr, f->saddr, f->cport,
+		    f->sport, f->cseq, f->sseq, flags, opts, optlen, paylen);
+		f->cseq += paylen + (flags & (TH_SYN | TH_FIN) ? 1 : 0);
+	} else {
+		put_ether(p, f->saddr, f->caddr, 0x0800);
+		off += put_tcp(g, p + off, f->saddr, f->caddr, f->sport,
+		    f->cport, f->sseq, f->cseq, flags, opts, optlen, paylen);
+		f->sseq += paylen + (flags & (TH_SYN | TH_FIN) ? 1 : 0);
+	}
+	f->step++;
+	return (off);
+}
+
+/*
+ * Writes "name" as DNS labels.
+ */
+static u_int
+put_dns_name(u_char *p, const char *name)
+{
+	const char *dot;
+	u_int len, off = 0;
+
+	for (;;) {
+		dot = strchr(name, '.');
+		len = dot != NULL ? (u_int)(dot - name) : (u_int)strlen(name);
+		p[off++] = (u_char)len;
+		memcpy(p + off, name, len);
+		off += len;
+		if (dot == NULL)
+			break;
+		name = dot + 1;
+	}
+	p[off++] = 0;
+	return (off);
+}
+
+static u_int
+gen_dns(struct pktgen *g, u_char *p)
+{
+	uint32_t client, server;
+	u_char *d;
+	u_int off, len, sport, n, i;
+	int answer;
+
+	client = 0x0a000000 | rnd_range(g, 1, 254);
+	server = 0x0a0000fe;
+	answer = rnd(g) & 1;
+	sport = rnd_range(g, 32768, 60999);
+	d = p + 14 + 20 + 8;
+	put_16(d, rnd(g));
+	put_16(d + 2, answer ? 0x8180 : 0x0100);
+	put_16(d + 4, 1);
+	n = answer ? rnd_range(g, 1, 3) : 0;
+	put_16(d + 6, n);
+	put_16(d + 8, 0);
+	put_16(d + 10, 0);
+	len = 12;
+	len += put_dns_name(d + len, dns_names[rnd(g) % NDNS_NAMES]);
+	put_16(d + len, (rnd(g) & 3) == 0 ? 28 : 1);	/* AAAA or A */
+	put_16(d + len + 2, 1);
+	len += 4;
+	for (i = 0; i < n; i++) {
+		put_16(d + len, 0xc00c);
+		put_16(d + len + 2, 1);
+		put_16(d + len + 4, 1);
+		put_32(d + len + 6, 300);
+		put_16(d + len + 10, 4);
+		put_32(d + len + 12, 0xc6336400 | rnd_range(g, 1, 254));
+		len += 16;
+	}
+
+	if (answer) {
+		off = put_ether(p, server, client, 0x0800);
+		put_udp(p + off + 20, 53, sport, len);
+		off += put_ip(g, p + off, server, client, 17, 8 + len, 6);
+	} else {
+		off = put_ether(p, client, server, 0x0800);
+		put_udp(p + off + 20, sport, 53, len);
+		off += put_ip(g, p + off, client, server, 17, 8 + len, 6);
+	}
+	return (off + 8 + len);
+}
+
+static u_int
+gen_ip6(struct pktgen *g, u_char *p)
+{
+	u_char *ip6 = p + 14, *uh = ip6 + 40, pseudo[8];
+	u_int len;
+	uint32_t sum;
+
+	len = rnd_range(g, 32, 512);
+	put_ether(p, 0x20010db8, 0x20010db9, 0x86dd);
+	memset(ip6, 0, 40);
+	put_32(ip6, 0x60000000 | (rnd(g) & 0xfffff));
+	put_16(ip6 + 4, 8 + len);
+	ip6[6] = 17;
+	ip6[7] = 64;
+	put_32(ip6 + 8, 0x20010db8);
+	put_32(ip6 + 20, rnd_range(g, 1, 1000));
+	put_32(ip6 + 24, 0x20010db8);
+	put_32(ip6 + 28, 0x00010000);
+	put_32(ip6 + 36, rnd_range(g, 1, 32));
+	put_udp(uh, rnd_range(g, 5000, 5099), 5001, len);
+	rnd_fill(g, uh + 8, len);
+	sum = cksum_add(0, ip6 + 8, 32);
+	put_32(pseudo, 8 + len);
+	put_32(pseudo + 4, 17);
+	sum = cksum_add(sum, pseudo, 8);
+	sum = cksum_add(sum, uh, 8 + len);
+	put_16(uh + 6, cksum_fold(sum));
+	return (14 + 40 + 8 + len);
+}
+
+/*
+ * An inner Ethernet frame with ICMP echo, TCP or UDP in it.
+ */
+static u_int
+gen_inner(struct pktgen *g, u_char *p, u_int proto)
+{
+	uint32_t src, dst;
+	u_int off, len;
+	u_char opts[1];
+
+	src = 0xac100000 | rnd_range(g, 1, 254);
+	dst = 0xac100100 | rnd_range(g, 1, 254);
+	off = put_ether(p, src, dst, 0x0800);
+	switch (proto) {
+
+	case 1:
+		len = rnd_range(g, 16, 128);
+		p[off + 20] = 8;			/* echo request */
+		p[off + 21] = 0;
+		put_16(p + off + 24, rnd(g));
+		put_16(p + off + 26, rnd(g));
+		rnd_fill(g, p + off + 28, len - 8);
+		put_16(p + off + 22, 0);
+		put_16(p + off + 22, cksum_fold(cksum_add(0, p + off + 20,
+		    len)));
+		off += put_ip(g, p + off, src, dst, 1, len, -1) + len;
+		break;
+
+	case 6:
+		len = rnd_range(g, 0, 512);
+		rnd_fill(g, p + off + 40, len);
+		off += put_tcp(g, p + off, src, dst, rnd_range(g, 32768, 60999),
+		    tcp_ports[rnd(g) % NTCP_PORTS], rnd(g), rnd(g),
+		    TH_ACK | TH_PUSH, opts, 0, len);
+		break;
+
+	default:
+		len = rnd_range(g, 16, 512);
+		put_udp(p + off + 20, rnd_range(g, 32768, 60999), 5001, len);
+		rnd_fill(g, p + off + 28, len);
+		off += put_ip(g, p + off, src, dst, 17, 8 + len, 6) + 8 + len;
+		break;
+	}
+	return (off);
+}
+
+static u_int
+gen_vxlan(struct pktgen *g, u_char *p)
+{
+	uint32_t src, dst;
+	u_int off, len;
+	u_char *vh;
+
+	src = 0x0a640000 | rnd_range(g, 1, 8);
+	dst = 0x0a640100 | rnd_range(g, 1, 8);
+	off = put_ether(p, src, dst, 0x0800);
+	vh = p + off + 20 + 8;
+	memset(vh, 0, 8);
+	vh[0] = 0x08;
+	put_32(vh + 4, rnd_range(g, 1, 16) << 8);
+	len = 8 + gen_inner(g, vh + 8, rnd(g) & 1 ? 6 : 1);
+	put_udp(p + off + 20, rnd_range(g, 49152, 65535), 4789, len);
+	off += put_ip(g, p + off, src, dst, 17, 8 + len, -1);
+	return (off + 8 + len);
+}
+
+static u_int
+gen_geneve(struct pktgen *g, u_char *p)
+{
+	uint32_t src, dst;
+	u_int off, len, optlen;
+	u_char *gh;
+
+	src = 0x0a650000 | rnd_range(g, 1, 8);
+	dst = 0x0a650100 | rnd_range(g, 1, 8);
+	off = put_ether(p, src, dst, 0x0800);
+	gh = p + off + 20 + 8;
+	optlen = (rnd(g) & 3) == 0 ? 8 : 0;
+	gh[0] = (u_char)(optlen / 4);
+	gh[1] = 0;
+	put_16(gh + 2, 0x6558);			/* Ethernet */
+	put_32(gh + 4, rnd_range(g, 1, 16) << 8);
+	if (optlen != 0) {
+		put_16(gh + 8, 0x0102);		/* option class */
+		gh[10] = 0x80;			/* critical type 0 */
+		gh[11] = 1;			/* 4 bytes of data */
+		put_32(gh + 12, rnd(g));
+	}
+	len = 8 + optlen + gen_inner(g, gh + 8 + optlen, 17);
+	put_udp(p + off + 20, rnd_range(g, 49152, 65535), 6081, len);
+	off += put_ip(g, p + off, src, dst, 17, 8 + len, -1);
+	return (off + 8 + len);
+}
+
+static u_int
+gen_esp(struct pktgen *g, u_char *p)
+{
+	u_int sa, off, len, padlen, i, elen;
+	const struct esp_sa *s;
+	u_char *eh, *iv, *pt;
+	uint32_t src = 0xc0010217;	/* 192.1.2.23 */
+#ifdef PKTGEN_ENCRYPT
+	int outl;
+#endif
+
+	sa = rnd(g) % NSAS;
+	s = &esp_sas[sa];
+	off = put_ether(p, src, s->dst, 0x0800);
+	eh = p + off + 20;
+	iv = eh + 8;
+
+	/*
+	 * Tunnel mode: an IPv4 packet, then padding, pad length and next
+	 * header.  The inner Ethernet header lands on the ESP header, so
+	 * that's written afterwards.
+	 */
+	pt = iv + s->ivlen;
+	len = gen_inner(g, pt - 14, rnd(g) & 1 ? 1 : 17) - 14;
+	put_32(eh, s->spi);
+	put_32(eh + 4, ++g->esp_seq[sa]);
+	rnd_fill(g, iv, s->ivlen);
+	padlen = (s->ivlen - (len + 2) % s->ivlen) % s->ivlen;
+	for (i = 0; i < padlen; i++)
+		pt[len + i] = (u_char)(i + 1);
+	pt[len + padlen] = (u_char)padlen;
+	pt[len + padlen + 1] = 4;		/* IPv4 */
+	elen = len + padlen + 2;
+#ifdef PKTGEN_ENCRYPT
+	if (g->ctx != NULL &&
+	    EVP_EncryptInit_ex(g->ctx, s->keylen == 24 ? EVP_des_ede3_cbc() :
+	    EVP_aes_256_cbc(), NULL, g->esp_key[sa], iv) == 1) {
+		EVP_CIPHER_CTX_set_padding(g->ctx, 0);
+		if (EVP_EncryptUpdate(g->ctx, pt, &outl, pt, (int)elen) != 1 ||
+		    EVP_EncryptFinal_ex(g->ctx, pt + outl, &outl) != 1)
+			rnd_fill(g, pt, elen);
+	} else
+		rnd_fill(g, pt, elen);
+#else
+	rnd_fill(g, pt, elen);
+#endif
+	rnd_fill(g, pt + elen, 12);		/* HMAC-96, unchecked */
+	len = 8 + s->ivlen + elen + 12;
+	off += put_ip(g, p + off, src, s->dst, 50, len, -1);
+	return (off + len);
+}
+
+static u_int
+gen_bgp(struct pktgen *g, u_char *p)
+{
+	struct flow *f = &g->bgp[rnd(g) % NBGP];
+	u_char *m, *a, opts[12];
+	u_int len, attrlen, wlen, n, i, plen, segs;
+	int from_client;
+
+	if (f->nsteps == 0)
+		new_flow(g, f, 0x0ac80000, 0x0ac80100, 179);
+	f->nsteps = 1;				/* sessions don't end */
+	from_client = rnd(g) & 1;
+	f->tsval += rnd_range(g, 1, 100);
+	opts[0] = 1; opts[1] = 1;
+	opts[2] = 8; opts[3] = 10;
+	put_32(opts + 4, f->tsval);
+	put_32(opts + 8, f->tsval - 1);
+
+	m = p + 14 + 20 + 20 + sizeof(opts);
+	memset(m, 0xff, 16);
+	if ((rnd(g) & 7) == 0) {
+		put_16(m + 16, 19);
+		m[18] = 4;			/* KEEPALIVE */
+		len = 19;
+	} else {
+		m[18] = 2;			/* UPDATE */
+		len = 19;
+		wlen = 0;
+		if ((rnd(g) & 3) == 0) {
+			n = rnd_range(g, 1, 4);
+			for (i = 0; i < n; i++) {
+				m[len + 2 + wlen] = 24;
+				put_16(m + len + 3 + wlen, 0xc633);
+				m[len + 5 + wlen] = (u_char)rnd(g);
+				wlen += 4;
+			}
+		}
+		put_16(m + len, wlen);
+		len += 2 + wlen;
+		a = m + len + 2;
+		attrlen = 0;
+		a[attrlen++] = 0x40; a[attrlen++] = 1;	/* ORIGIN IGP */
+		a[attrlen++] = 1; a[attrlen++] = 0;
+		segs = rnd_range(g, 1, 6);
+		a[attrlen++] = 0x40; a[attrlen++] = 2;	/* AS_PATH */
+		a[attrlen++] = (u_char)(2 + 2 * segs);
+		a[attrlen++] = 2;			/* AS_SEQUENCE */
+		a[attrlen++] = (u_char)segs;
+		for (i = 0; i < segs; i++) {
+			put_16(a + attrlen, rnd_range(g, 64512, 65534));
+			attrlen += 2;
+		}
+		a[attrlen++] = 0x40; a[attrlen++] = 3;	/* NEXT_HOP */
+		a[attrlen++] = 4;
+		put_32(a + attrlen, from_client ? f->caddr : f->saddr);
+		attrlen += 4;
+		if (rnd(g) & 1) {
+			a[attrlen++] = 0x80; a[attrlen++] = 4;	/* MED */
+			a[attrlen++] = 4;
+			put_32(a + attrlen, rnd_range(g, 0, 1000));
+			attrlen += 4;
+		}
+		put_16(m + len, attrlen);
+		len += 2 + attrlen;
+		n = rnd_range(g, 1, 32);
+		for (i = 0; i < n; i++) {
+			plen = rnd_range(g, 16, 24);
+			m[len++] = (u_char)plen;
+			put_32(m + len, 0x64000000 | (rnd(g) & 0x3fff00));
+			len += (plen + 7) / 8;
+		}
+		put_16(m + 16, len);
+	}
+
+	if (from_client) {
+		put_ether(p, f->caddr, f->saddr, 0x0800);
+		len = put_tcp(g, p + 14, f->caddr, f->saddr, f->cport, 179,
+		    f->cseq, f->sseq, TH_ACK | TH_PUSH, opts, sizeof(opts),
+		    len);
+		f->cseq += len - 52;
+	} else {
+		put_ether(p, f->saddr, f->caddr, 0x0800);
+		len = put_tcp(g, p + 14, f->saddr, f->caddr, 179, f->cport,
+		    f->sseq, f->cseq, TH_ACK | TH_PUSH, opts, sizeof(opts),
+		    len);
+		f->sseq += len - 52;
+	}
+	return (14 + len);
+}
+
+/*
+ * An L2TP AVP: mandatory, in the IETF space, with "len" bytes of value
+ * from "val", or random ones if it's NULL.
+ */
+static u_int
+put_avp(struct pktgen *g, u_char *p, u_int type, const void *val, u_int len)
+{
+	put_16(p, 0x8000 | (6 + len));
+	put_16(p + 2, 0);
+	put_16(p + 4, type);
+	if (val != NULL)
+		memcpy(p + 6, val, len);
+	else
+		rnd_fill(g, p + 6, len);
+	return (6 + len);
+}
+
+static u_int
+put_avp_16(struct pktgen *g, u_char *p, u_int type, u_int v)
+{
+	u_char b[2];
+
+	put_16(b, v);
+	return (put_avp(g, p, type, b, 2));
+}
+
+static u_int
+put_avp_32(struct pktgen *g, u_char *p, u_int type, uint32_t v)
+{
+	u_char b[4];
+
+	put_32(b, v);
+	return (put_avp(g, p, type, b, 4));
+}
+
+static u_int
+put_avp_str(struct pktgen *g, u_char *p, u_int type, const char *s)
+{
+	return (put_avp(g, p, type, s, (u_int)strlen(s)));
+}
+
+/*
+ * An L2TPv2 control message, with the AVPs of its type.
+ */
+static u_int
+gen_l2tp(struct pktgen *g, u_char *p)
+{
+	static const u_char msgtypes[] = {
+		1, 2, 3, 4, 6, 10, 11, 12, 14, 15, 16
+	};
+	uint32_t lac = 0x0a0a0001, lns = 0x0a0b0001;
+	u_int msgtype, off, len, tunnel, session;
+	u_char *m, *a, b[32];
+
+	tunnel = rnd_range(g, 1, 64);
+	session = rnd_range(g, 1, 1024);
+	m = p + 14 + 20 + 8;
+	if ((rnd(g) & 7) == 0) {
+		msgtype = 0;			/* a ZLB acknowledgement */
+		session = 0;
+	} else
+		msgtype = msgtypes[rnd(g) % sizeof(msgtypes)];
+	if (msgtype >= 1 && msgtype <= 6)
+		session = 0;
+	put_16(m, 0xc802);			/* T, L, S, version 2 */
+	put_16(m + 4, tunnel);
+	put_16(m + 6, session);
+	put_16(m + 8, g->l2tp_ns++);
+	put_16(m + 10, g->l2tp_ns);
+	a = m + 12;
+	off = 0;
+	if (msgtype != 0)
+		off += put_avp_16(g, a + off, 0, msgtype);
+	switch (msgtype) {
+
+	case 1:					/* SCCRQ */
+	case 2:					/* SCCRP */
+		off += put_avp_16(g, a + off, 2, 0x0100);
+		off += put_avp_str(g, a + off, 7, msgtype == 1 ?
+		    "lac1.example.net" : "lns1.example.net");
+		off += put_avp_32(g, a + off, 3, 3);
+		off += put_avp_32(g, a + off, 4, 3);
+		off += put_avp_16(g, a + off, 6, 0x0680);
+		off += put_avp_str(g, a + off, 8, "ndgen");
+		off += put_avp_16(g, a + off, 9, rnd_range(g, 1, 64));
+		off += put_avp_16(g, a + off, 10, 4);
+		if (msgtype == 1) {
+			off += put_avp(g, a + off, 5, NULL, 8);
+			off += put_avp(g, a + off, 11, NULL, 16);
+		} else
+			off += put_avp(g, a + off, 13, NULL, 16);
+		break;
+
+	case 3:					/* SCCCN */
+		off += put_avp(g, a + off, 13, NULL, 16);
+		break;
+
+	case 4:					/* StopCCN */
+		off += put_avp_16(g, a + off, 9, tunnel);
+		put_16(b, 6);
+		put_16(b + 2, 0);
+		memcpy(b + 4, "Shutdown", 8);
+		off += put_avp(g, a + off, 1, b, 12);
+		break;
+
+	case 10:				/* ICRQ */
+		off += put_avp_16(g, a + off, 14, rnd_range(g, 1, 1024));
+		off += put_avp_32(g, a + off, 15, rnd(g));
+		off += put_avp_32(g, a + off, 18, 2);
+		off += put_avp_32(g, a + off, 25, rnd_range(g, 0, 47));
+		off += put_avp_str(g, a + off, 22, "5551234");
+		off += put_avp_str(g, a + off, 21, "5556789");
+		off += put_avp_str(g, a + off, 23, "1");
+		break;
+
+	case 11:				/* ICRP */
+		off += put_avp_16(g, a + off, 14, rnd_range(g, 1, 1024));
+		break;
+
+	case 12:				/* ICCN */
+		off += put_avp_32(g, a + off, 24, 100000000);
+		off += put_avp_32(g, a + off, 19, 1);
+		off += put_avp_32(g, a + off, 38, 100000000);
+		off += put_avp(g, a + off, 26, NULL, 14);
+		off += put_avp(g, a + off, 27, NULL, 14);
+		off += put_avp(g, a + off, 28, NULL, 14);
+		off += put_avp_16(g, a + off, 29, 2);	/* CHAP */
+		off += put_avp_str(g, a + off, 30, "user@example.net");
+		off += put_avp(g, a + off, 31, NULL, 16);
+		off += put_avp_16(g, a + off, 32, rnd_range(g, 0, 255));
+		off += put_avp(g, a + off, 33, NULL, 16);
+		off += put_avp_str(g, a + off, 37, "group1");
+		off += put_avp(g, a + off, 39, NULL, 0);
+		off += put_avp_32(g, a + off, 16, 9600);
+		off += put_avp_32(g, a + off, 17, 100000000);
+		break;
+
+	case 14:				/* CDN */
+		put_16(b, 3);
+		put_16(b + 2, 0);
+		memcpy(b + 4, "Session timeout", 15);
+		off += put_avp(g, a + off, 1, b, 19);
+		off += put_avp_16(g, a + off, 14, session);
+		put_16(b, 16);
+		b[2] = 0x02;
+		memcpy(b + 3, "normal", 6);
+		off += put_avp(g, a + off, 12, b, 9);
+		put_16(b, 1);
+		put_16(b + 2, 0xc021);
+		b[4] = 1;
+		off += put_avp(g, a + off, 46, b, 5);
+		break;
+
+	case 15:				/* WEN */
+		put_16(b, 0);
+		rnd_fill(g, b + 2, 24);
+		off += put_avp(g, a + off, 34, b, 26);
+		break;
+
+	case 16:				/* SLI */
+		put_16(b, 0);
+		put_32(b + 2, 0xffffffff);
+		put_32(b + 6, 0);
+		off += put_avp(g, a + off, 35, b, 10);
+		break;
+	}
+	if (msgtype != 0 && (rnd(g) & 3) == 0) {
+		/* An AVP a dissector has to skip: vendor or hidden. */
+		if (rnd(g) & 1) {
+			put_16(a + off, 10);		/* not mandatory */
+			put_16(a + off + 2, 9);		/* Cisco */
+			put_16(a + off + 4, 1);
+			rnd_fill(g, a + off + 6, 4);
+		} else {
+			put_16(a + off, 0xc000 | 10);
+			put_16(a + off + 2, 0);
+			put_16(a + off + 4, 36);	/* Random Vector */
+			rnd_fill(g, a + off + 6, 4);
+		}
+		off += 10;
+	}
+	len = 12 + off;
+	put_16(m + 2, len);
+	if (rnd(g) & 1) {
+		put_ether(p, lac, lns, 0x0800);
+		put_udp(p + 14 + 20, 1701, 1701, len);
+		put_ip(g, p + 14, lac, lns, 17, 8 + len, -1);
+	} else {
+		put_ether(p, lns, lac, 0x0800);
+		put_udp(p + 14 + 20, 1701, 1701, len);
+		put_ip(g, p + 14, lns, lac, 17, 8 + len, -1);
+	}
+	return (14 + 20 + 8 + len);
+}
+
+static int
+hexval(int c)
+{
+	if (c >= '0' && c <= '9')
+		return (c - '0');
+	if (c >= 'a' && c <= 'f')
+		return (c - 'a' + 10);
+	return (0);
+}
+
+/*
+ * Make a generator for "mix"; returns NULL, with the reason in
+ * "errbuf", if the mix isn't valid.  "rate" is in packets per second.
+ */
+struct pktgen *
+pktgen_create(const char *mix, uint32_t seed, u_int rate, char *errbuf,
+	      size_t errbuflen)
+{
+	struct pktgen *g;
+	const char *p, *end, *eq;
+	u_int i, k, w;
+	size_t len;
+
+	g = (struct pktgen *)calloc(1, sizeof(*g));
+	if (g == NULL) {
+		(void)snprintf(errbuf, errbuflen, "out of memory");
+		return (NULL);
+	}
+	for (p = mix; *p != '\0'; p = *end == ',' ? end + 1 : end) {
+		end = strchr(p, ',');
+		if (end == NULL)
+			end = p + strlen(p);
+		eq = memchr(p, '=', end - p);
+		len = (size_t)((eq != NULL ? eq : end) - p);
+		for (k = 0; k < NKINDS; k++)
+			if (strlen(kind_names[k]) == len &&
+			    strncmp(kind_names[k], p, len) == 0)
+				break;
+		w = eq != NULL ? (u_int)atoi(eq + 1) : 1;
+		if (k == NKINDS || w == 0 || g->nkinds == NKINDS) {
+			(void)snprintf(errbuf, errbuflen,
+			    "invalid traffic mix entry \"%.*s\"",
+			    (int)(end - p), p);
+			free(g);
+			return (NULL);
+		}
+		g->total_weight += w;
+		g->kind[g->nkinds] = k;
+		g->weight[g->nkinds++] = g->total_weight;
+	}
+	if (g->nkinds == 0) {
+		(void)snprintf(errbuf, errbuflen, "empty traffic mix");
+		free(g);
+		return (NULL);
+	}
+	g->rng = seed != 0 ? seed : 1;
+	g->interval_ns = rate != 0 ? 1000000000 / rate : 1000;
+	for (i = 0; i < NSAS; i++)
+		for (k = 0; k < esp_sas[i].keylen; k++)
+			g->esp_key[i][k] = (u_char)(
+			    hexval(esp_sas[i].key[2 * k]) << 4 |
+			    hexval(esp_sas[i].key[2 * k + 1]));
+#ifdef PKTGEN_ENCRYPT
+	g->ctx = EVP_CIPHER_CTX_new();
+#endif
+	return (g);
+}
+
+/*
+ * Write the next packet to "buf", which must have room for
+ * PKTGEN_MAXLEN bytes; returns its length.
+ */
+u_int
+pktgen_next(struct pktgen *g, u_char *buf, struct timeval *ts)
+{
+	u_int i, r, len;
+
+	r = rnd(g) % g->total_weight;
+	for (i = 0; r >= g->weight[i]; i++)
+		continue;
+	switch (g->kind[i]) {
+
+	case KIND_TCP:
+		len = gen_tcp(g, buf);
+		break;
+
+	case KIND_DNS:
+		len = gen_dns(g, buf);
+		break;
+
+	case KIND_IP6:
+		len = gen_ip6(g, buf);
+		break;
+
+	case KIND_VXLAN:
+		len = gen_vxlan(g, buf);
+		break;
+
+	case KIND_GENEVE:
+		len = gen_geneve(g, buf);
+		break;
+
+	case KIND_ESP:
+		len = gen_esp(g, buf);
+		break;
+
+	case KIND_BGP:
+		len = gen_bgp(g, buf);
+		break;
+
+	default:
+		len = gen_l2tp(g, buf);
+		break;
+	}
+	ts->tv_sec = PKTGEN_START_TIME + (time_t)(g->now_ns / 1000000000);
+	ts->tv_usec = (long)(g->now_ns % 1000000000 / 1000);
+	g->now_ns += g->interval_ns;
+	return (len);
+}
+
+void
+pktgen_destroy(struct pktgen *g)
+{
+#ifdef PKTGEN_ENCRYPT
+	if (g->ctx != NULL)
+		EVP_CIPHER_CTX_free(g->ctx);
+#endif
+	free(g);
+}
@@ -0,0 +1,54 @@
+/*
+ * Copyright (c) 2026 The TCPDUMP project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that: (1) source code
+ * distributions retain the above copyright notice and this paragraph
+ * in its entirety, and (2) distributions including binary code include
+ * the above copyright notice and this paragraph in its entirety in
+ * the documentation or other materials provided with the distribution.
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND
+ * WITHOUT ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, WITHOUT
+ * LIMITATION, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE.
+ */
+
+#ifndef pktgen_h
+#define pktgen_h
+
+/*
+ * Synthetic Ethernet traffic for benchmarking, used by ndgen and
+ * ndbench.  A generator is made from a mix, a comma-separated list of
+ * kinds with optional weights, e.g. "tcp=60,dns=20,vxlan=20", and a
+ * seed; the same mix and seed always give the same packets.
+ *
+ * The kinds are
+ *
+ *	tcp	TCP flows, with MSS, window scale, SACK and time stamp
+ *		options, from the handshake through the data to the FIN
+ *	dns	DNS queries and their answers over UDP
+ *	ip6	UDP over IPv6
+ *	vxlan	TCP and ICMP inside VXLAN
+ *	geneve	UDP inside Geneve, some with an option
+ *	esp	tunnel-mode ESP for the tests/esp-secrets.txt SAs, so that
+ *		-E 'file tests/esp-secrets.txt' decrypts it when libcrypto
+ *		is available to encrypt it
+ *	bgp	BGP UPDATEs announcing and withdrawing prefixes
+ *	l2tp	L2TPv2 control messages, with the AVPs of each type
+ *
+ * The packets are spaced 1/rate seconds apart from a fixed start time.
+ */
+#define PKTGEN_MAXLEN	2048		/* longest packet generated */
+#define PKTGEN_DEFAULT_MIX \
+	"tcp=40,dns=15,ip6=10,vxlan=10,geneve=5,esp=10,bgp=10"
+#define PKTGEN_START_TIME	1700000000	/* seconds since the epoch */
+
+struct pktgen;
+
+extern struct pktgen *pktgen_create(const char *, uint32_t, u_int, char *,
+    size_t);
+extern u_int pktgen_next(struct pktgen *, u_char *, struct timeval *);
+extern void pktgen_destroy(struct pktgen *);
+
+#endif /* pktgen_h */
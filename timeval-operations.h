@@ -75,4 +75,39 @@
 		}                                                  \
 	} while (0)
 
+/*
+ * A time stamp as a count of nanoseconds since the Epoch, whatever the
+ * precision it was captured with; 64 signed bits hold one from 1678 to
+ * 2262, and a difference of two is a signed count too.  It's
+ * what the dissectors and the analyses that time packets work in, so
+ * that differences and comparisons are plain integer arithmetic rather
+ * than a timeval carry, and so a nanosecond capture keeps its
+ * nanoseconds.
+ */
+typedef int64_t nd_ts_t;
+
+#define ND_TS_SEC(ts)	((ts) / _NANO_PER_SEC)
+#define ND_TS_NSEC(ts)	((uint32_t)((ts) % _NANO_PER_SEC))	/* ts >= 0 */
+#define ND_TS_USEC(ts)	((ts) / 1000)		/* microseconds since the Epoch */
+
+/*
+ * A pcap time stamp, whose tv_usec holds nanoseconds if "nano_prec" is
+ * set and microseconds otherwise.  A tv_sec out of that range, as a
+ * damaged savefile can have, is clamped to it, leaving room for a
+ * 32-bit tv_usec of microseconds, rather than overflowing.
+ */
+#define ND_TS_SEC_MAX	((int64_t)(INT64_MAX / _NANO_PER_SEC) - 4295)
+#define ND_TS_FROM_TIMEVAL(tvp, nano_prec) \
+	(((int64_t)(tvp)->tv_sec > ND_TS_SEC_MAX ? ND_TS_SEC_MAX : \
+	  (int64_t)(tvp)->tv_sec < -ND_TS_SEC_MAX ? -ND_TS_SEC_MAX : \
+	  (nd_ts_t)(tvp)->tv_sec) * _NANO_PER_SEC + \
+	 (nd_ts_t)(tvp)->tv_usec * ((nano_prec) ? 1 : 1000))
+
+/*
+ * The time from "from" to "to", in microseconds, or 0 if "to" is the
+ * earlier: a capture can go back in time.
+ */
+#define ND_TS_ELAPSED_US(from, to) \
+	((to) > (from) ? (uint64_t)ND_TS_USEC((to) - (from)) : 0)
+
 #endif /* netdissect_timeval_operations_h */
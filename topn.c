@@ -0,0 +1,448 @@
+/*
+ * Copyright (c) 2026 The TCPDUMP project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that: (1) source code
+ * distributions retain the above copyright notice and this paragraph
+ * in its entirety, and (2) distributions including binary code include
+ * the above copyright notice and this paragraph in its entirety in
+ * the documentation or other materials provided with the distribution.
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND
+ * WITHOUT ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, WITHOUT
+ * LIMITATION, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include "netdissect-stdinc.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "netdissect.h"
+#include "addrtostr.h"
+#include "ipproto.h"
+#include "flows.h"
+#include "topn.h"
+
+#define TOPN_SRC	0
+#define TOPN_DST	1
+#define TOPN_PORT	2
+#define TOPN_PROTO	3
+#define TOPN_NSKETCHES	4
+
+static const char *const topn_titles[TOPN_NSKETCHES] = {
+	"source", "destination", "port", "protocol"
+};
+
+struct topn_key {
+	uint8_t len;
+	u_char b[17];
+};
+
+struct topn_entry {
+	struct topn_key key;
+	uint32_t hash;
+	u_int heap;		/* its place in the heap */
+	uint64_t packets;
+	uint64_t bytes;
+	uint64_t err;		/* packets it inherited */
+};
+
+struct topn_sketch {
+	struct topn_entry *e;
+	u_int *heap;		/* entries, least packets first */
+	u_int *index;		/* hash slots: an entry + 1, or 0 */
+	u_int nused;
+};
+
+struct nd_topn {
+	u_int n;		/* entries reported */
+	u_int k;		/* counters of each sketch */
+	u_int mask;		/* of the index slots */
+	u_int interval;		/* seconds */
+	int clear;		/* clear the terminal before a report */
+	time_t next_report;
+	uint64_t packets, bytes;
+	struct topn_sketch sk[TOPN_NSKETCHES];
+	struct nd_flow_pkt pkt;
+	u_int *top;		/* scratch for a report */
+	const char *extra_title;
+	nd_topn_extra_fn extra;
+	void *extra_arg;
+};
+
+static void *
+topn_calloc(netdissect_options *ndo, size_t n, size_t size)
+{
+	void *p;
+
+	p = calloc(n, size);
+	if (p == NULL)
+		(*ndo->ndo_error)(ndo, S_ERR_ND_MEM_ALLOC, "nd_topn_new: calloc");
+	return (p);
+}
+
+/*
+ * Report the "n" busiest of each every "interval" seconds, clearing
+ * the terminal first if "clear" is set.
+ */
+struct nd_topn *
+nd_topn_new(netdissect_options *ndo, u_int n, u_int interval, int clear)
+{
+	struct nd_topn *tn;
+	u_int i, size;
+
+	tn = (struct nd_topn *)topn_calloc(ndo, 1, sizeof(*tn));
+	tn->n = n;
+	tn->k = n * TOPN_COUNTERS_PER;
+	for (size = 16; size < 2 * tn->k; size *= 2)
+		continue;
+	tn->mask = size - 1;
+	tn->interval = interval;
+	tn->clear = clear;
+	for (i = 0; i < TOPN_NSKETCHES; i++) {
+		tn->sk[i].e = (struct topn_entry *)topn_calloc(ndo, tn->k,
+		    sizeof(struct topn_entry));
+		tn->sk[i].heap = (u_int *)topn_calloc(ndo, tn->k,
+		    sizeof(u_int));
+		tn->sk[i].index = (u_int *)topn_calloc(ndo, size,
+		    sizeof(u_int));
+	}
+	tn->top = (u_int *)topn_calloc(ndo, n, sizeof(u_int));
+	return (tn);
+}
+
+static uint32_t
+topn_hash(const struct topn_key *k)
+{
+	uint32_t h = 2166136261U;
+	u_int i;
+
+	for (i = 0; i < k->len; i++)
+		h = (h ^ k->b[i]) * 16777619U;
+	return (h);
+}
+
+static void
+topn_swap(struct topn_sketch *sk, u_int a, u_int b)
+{
+	u_int t;
+
+	t = sk->heap[a];
+	sk->heap[a] = sk->heap[b];
+	sk->heap[b] = t;
+	sk->e[sk->heap[a]].heap = a;
+	sk->e[sk->heap[b]].heap = b;
+}
+
+static void
+topn_sift_up(struct topn_sketch *sk, u_int pos)
+{
+	while (pos != 0 && sk->e[sk->heap[(pos - 1) / 2]].packets >
+	    sk->e[sk->heap[pos]].packets) {
+		topn_swap(sk, pos, (pos - 1) / 2);
+		pos = (pos - 1) / 2;
+	}
+}
+
+static void
+topn_sift_down(struct topn_sketch *sk, u_int pos)
+{
+	u_int c;
+
+	while ((c = 2 * pos + 1) < sk->nused) {
+		if (c + 1 < sk->nused &&
+		    sk->e[sk->heap[c + 1]].packets < sk->e[sk->heap[c]].packets)
+			c++;
+		if (sk->e[sk->heap[pos]].packets <= sk->e[sk->heap[c]].packets)
+			break;
+		topn_swap(sk, pos, c);
+		pos = c;
+	}
+}
+
+/*
+ * Take entry "x" out of the index, moving the entries after it back,
+ * as far as their home slots allow.
+ */
+static void
+topn_unindex(struct nd_topn *tn, struct topn_sketch *sk, u_int x)
+{
+	u_int i, j, home;
+
+	for (i = sk->e[x].hash & tn->mask; sk->index[i] != x + 1;
+	    i = (i + 1) & tn->mask)
+		continue;
+	for (j = (i + 1) & tn->mask; sk->index[j] != 0;
+	    j = (j + 1) & tn->mask) {
+		home = sk->e[sk->index[j] - 1].hash & tn->mask;
+		if (i <= j ? (i < home && home <= j) : (i < home || home <= j))
+			continue;
+		sk->index[i] = sk->index[j];
+		i = j;
+	}
+	sk->index[i] = 0;
+}
+
+static void
+topn_count(struct nd_topn *tn, struct topn_sketch *sk,
+    const struct topn_key *key, uint64_t bytes)
+{
+	struct topn_entry *e;
+	uint32_t h;
+	u_int i, x;
+
+	h = topn_hash(key);
+	for (i = h & tn->mask; sk->index[i] != 0; i = (i + 1) & tn->mask) {
+		e = &sk->e[sk->index[i] - 1];
+		if (e->hash == h && e->key.len == key->len &&
+		    memcmp(e->key.b, key->b, key->len) == 0) {
+			e->packets++;
+			e->bytes += bytes;
+			topn_sift_down(sk, e->heap);
+			return;
+		}
+	}
+	if (sk->nused < tn->k) {
+		x = sk->nused++;
+		e = &sk->e[x];
+		e->packets = e->bytes = e->err = 0;
+		e->heap = x;
+		sk->heap[x] = x;
+	} else {
+		/* Take over the counter with the least packets. */
+		x = sk->heap[0];
+		e = &sk->e[x];
+		topn_unindex(tn, sk, x);
+		for (i = h & tn->mask; sk->index[i] != 0;
+		    i = (i + 1) & tn->mask)
+			continue;
+		e->err = e->packets;
+	}
+	e->key = *key;
+	e->hash = h;
+	e->packets++;
+	e->bytes += bytes;
+	sk->index[i] = x + 1;
+	if (e->packets == 1)
+		topn_sift_up(sk, e->heap);
+	else
+		topn_sift_down(sk, e->heap);
+}
+
+static void
+topn_key_name(const struct topn_key *key, u_int which, char *buf,
+    size_t size)
+{
+	const char *name;
+
+	switch (which) {
+
+	case TOPN_SRC:
+	case TOPN_DST:
+		if (key->b[0] == 4)
+			addrtostr(key->b + 1, buf, size);
+		else
+			addrtostr6(key->b + 1, buf, size);
+		return;
+
+	case TOPN_PORT:
+		if ((name = netdb_protoname(key->b[0])) != NULL)
+			snprintf(buf, size, "%s %u", name,
+			    key->b[1] << 8 | key->b[2]);
+		else
+			snprintf(buf, size, "proto %u %u", key->b[0],
+			    key->b[1] << 8 | key->b[2]);
+		return;
+
+	default:
+		if ((name = netdb_protoname(key->b[0])) != NULL)
+			snprintf(buf, size, "%s", name);
+		else
+			snprintf(buf, size, "proto %u", key->b[0]);
+		return;
+	}
+}
+
+static void
+topn_write(netdissect_options *ndo, const char *fmt, ...)
+    PRINTFLIKE(2, 3);
+
+static void
+topn_write(netdissect_options *ndo, const char *fmt, ...)
+{
+	char line[256];
+	va_list ap;
+	int len;
+
+	va_start(ap, fmt);
+	len = vsnprintf(line, sizeof(line), fmt, ap);
+	va_end(ap);
+	if (len > 0)
+		nd_outbuf_write(ndo, line,
+		    (size_t)len < sizeof(line) ? (size_t)len : sizeof(line) - 1);
+}
+
+/*
+ * Write the report on the interval that's ending, and start counting
+ * the next.
+ */
+void
+nd_topn_report(netdissect_options *ndo)
+{
+	struct nd_topn *tn = ndo->ndo_topn;
+	struct topn_sketch *sk;
+	struct topn_entry *e;
+	char name[INET6_ADDRSTRLEN + 16], when[32];
+	struct tm tmbuf, *tm;
+	time_t t;
+	u_int s, i, j, ntop;
+
+	if (tn == NULL)
+		return;
+	if (tn->clear)
+		topn_write(ndo, "\033[H\033[2J");
+	t = tn->next_report - tn->interval;	/* the start of the interval */
+	if (tn->next_report == 0 || (tm = nd_localtime(&t, &tmbuf)) == NULL ||
+	    strftime(when, sizeof(when), "%Y-%m-%d %H:%M:%S", tm) == 0)
+		when[0] = '\0';
+	topn_write(ndo, "%s%s%" PRIu64 " packets, %" PRIu64 " bytes\n",
+	    when, when[0] != '\0' ? " " : "", tn->packets, tn->bytes);
+	for (s = 0; s < TOPN_NSKETCHES; s++) {
+		sk = &tn->sk[s];
+		/* Insertion into the top n; n is small. */
+		ntop = 0;
+		for (i = 0; i < sk->nused; i++) {
+			for (j = ntop; j != 0 &&
+			    sk->e[tn->top[j - 1]].packets < sk->e[i].packets;
+			    j--)
+				if (j < tn->n)
+					tn->top[j] = tn->top[j - 1];
+			if (j < tn->n) {
+				tn->top[j] = i;
+				if (ntop < tn->n)
+					ntop++;
+			}
+		}
+		topn_write(ndo, "%-40s %12s %14s\n", topn_titles[s], "packets",
+		    "bytes");
+		for (i = 0; i < ntop; i++) {
+			e = &sk->e[tn->top[i]];
+			topn_key_name(&e->key, s, name, sizeof(name));
+			if (ndo->ndo_vflag && e->err != 0)
+				topn_write(ndo, "%-40s %12" PRIu64 " %14" PRIu64
+				    " (at most %" PRIu64 " too many)\n", name,
+				    e->packets, e->bytes, e->err);
+			else
+				topn_write(ndo, "%-40s %12" PRIu64 " %14" PRIu64
+				    "\n", name, e->packets, e->bytes);
+		}
+		sk->nused = 0;
+		memset(sk->index, 0, (tn->mask + 1) * sizeof(u_int));
+	}
+	if (tn->extra != NULL) {
+		topn_write(ndo, "%-40s %12s %14s\n", tn->extra_title, "packets",
+		    "bytes");
+		(*tn->extra)(ndo, tn->extra_arg);
+	}
+	topn_write(ndo, "\n");
+	nd_outbuf_flush(ndo);
+	tn->packets = tn->bytes = 0;
+}
+
+/*
+ * Add a table titled "title" to each report, written by "fn".
+ */
+void
+nd_topn_set_extra(netdissect_options *ndo, const char *title,
+    nd_topn_extra_fn fn, void *arg)
+{
+	struct nd_topn *tn = ndo->ndo_topn;
+
+	tn->extra_title = title;
+	tn->extra = fn;
+	tn->extra_arg = arg;
+}
+
+/*
+ * Write a row of the extra table, "name" being NULL for the totals.
+ */
+void
+nd_topn_row(netdissect_options *ndo, const char *name, uint64_t packets,
+    uint64_t bytes)
+{
+	topn_write(ndo, "%-40s %12" PRIu64 " %14" PRIu64 "\n",
+	    name != NULL ? name : "all", packets, bytes);
+}
+
+/*
+ * Start on a packet of "len" bytes on the wire; its time stamp has been
+ * set in ndo.
+ */
+void
+nd_topn_begin(netdissect_options *ndo, u_int len)
+{
+	struct nd_topn *tn = ndo->ndo_topn;
+	time_t now = ndo->ndo_packet_sec;
+
+	nd_flow_pkt_begin(&tn->pkt, len);
+	if (now >= tn->next_report) {
+		/* Report on the interval just ended, by packet time. */
+		if (tn->next_report != 0)
+			nd_topn_report(ndo);
+		tn->next_report = now - now % tn->interval + tn->interval;
+	}
+}
+
+/*
+ * The field sink.
+ */
+void
+nd_topn_field(netdissect_options *ndo, u_int proto, u_int field,
+    u_int type, const u_char *val, u_int len)
+{
+	nd_flow_pkt_field(&ndo->ndo_topn->pkt, proto, field, type, val, len);
+}
+
+/*
+ * Count the packet, if it had an IP header.
+ */
+void
+nd_topn_end(netdissect_options *ndo)
+{
+	struct nd_topn *tn = ndo->ndo_topn;
+	const struct nd_flow_key *fk = &tn->pkt.key;
+	struct topn_key key;
+	uint64_t bytes;
+	u_int alen;
+
+	bytes = tn->pkt.ip_bytes != 0 ? tn->pkt.ip_bytes : tn->pkt.len;
+	tn->packets++;
+	tn->bytes += bytes;
+	if (tn->pkt.state == FLOWS_PKT_NONE)
+		return;
+	alen = fk->af == 4 ? 4 : 16;
+	key.len = (uint8_t)(1 + alen);
+	key.b[0] = fk->af;
+	memcpy(key.b + 1, fk->src, alen);
+	topn_count(tn, &tn->sk[TOPN_SRC], &key, bytes);
+	memcpy(key.b + 1, fk->dst, alen);
+	topn_count(tn, &tn->sk[TOPN_DST], &key, bytes);
+	key.len = 1;
+	key.b[0] = fk->proto;
+	topn_count(tn, &tn->sk[TOPN_PROTO], &key, bytes);
+	if (tn->pkt.state >= FLOWS_PKT_L4 &&
+	    (fk->proto == IPPROTO_TCP || fk->proto == IPPROTO_UDP)) {
+		key.len = 3;
+		key.b[1] = (u_char)(fk->dport >> 8);
+		key.b[2] = (u_char)fk->dport;
+		topn_count(tn, &tn->sk[TOPN_PORT], &key, bytes);
+	}
+}
@@ -0,0 +1,57 @@
+/*
+ * Copyright (c) 2026 The TCPDUMP project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that: (1) source code
+ * distributions retain the above copyright notice and this paragraph
+ * in its entirety, and (2) distributions including binary code include
+ * the above copyright notice and this paragraph in its entirety in
+ * the documentation or other materials provided with the distribution.
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND
+ * WITHOUT ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, WITHOUT
+ * LIMITATION, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE.
+ */
+
+
+#ifndef topn_h
+#define topn_h
+
+/*
+ * Heavy hitters (--top): the busiest source addresses, destination
+ * addresses, destination ports and IP protocols, by packets, over each
+ * interval of packet time, from the same fields as --flows.
+ *
+ * Each is counted with a SpaceSaving sketch of TOPN_COUNTERS_PER times
+ * as many counters as are reported, so the memory used doesn't grow
+ * with the traffic: a key that's not being counted takes over the
+ * counter with the least count, and inherits that count as its error.
+ * A reported count is then at most the error too high, and the error
+ * is at most the packets of the interval over the number of counters.
+ */
+/*
+ * A table of another kind can be added to each report with
+ * nd_topn_set_extra(); its function writes the rows with nd_topn_row(),
+ * a NULL name being for the totals.
+ */
+#define TOPN_DEFAULT_COUNT	10
+#define TOPN_COUNTERS_PER	64
+
+struct nd_topn;
+
+extern struct nd_topn *nd_topn_new(netdissect_options *, u_int, u_int, int);
+extern void nd_topn_begin(netdissect_options *, u_int);
+extern void nd_topn_field(netdissect_options *, u_int, u_int, u_int,
+    const u_char *, u_int);
+extern void nd_topn_end(netdissect_options *);
+extern void nd_topn_report(netdissect_options *);
+
+typedef void (*nd_topn_extra_fn)(netdissect_options *, void *);
+
+extern void nd_topn_set_extra(netdissect_options *, const char *,
+    nd_topn_extra_fn, void *);
+extern void nd_topn_row(netdissect_options *, const char *, uint64_t,
+    uint64_t);
+
+#endif /* topn_h */
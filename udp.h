@@ -179,6 +179,9 @@ struct udphdr {
 #ifndef WB_PORT
 #define WB_PORT				4567
 #endif
+#ifndef IPFIX_PORT
+#define IPFIX_PORT			4739	/* RFC 7011 */
+#endif
 #ifndef BFD_MULTIHOP_PORT
 #define BFD_MULTIHOP_PORT		4784	/* RFC 5883 */
 #endif
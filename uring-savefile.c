@@ -0,0 +1,670 @@
+/*
+ * Copyright (c) 2026 The TCPDUMP project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that: (1) source code
+ * distributions retain the above copyright notice and this paragraph
+ * in its entirety, and (2) distributions including binary code include
+ * the above copyright notice and this paragraph in its entirety in
+ * the documentation or other materials provided with the distribution.
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND
+ * WITHOUT ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, WITHOUT
+ * LIMITATION, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE.
+ */
+
+/*
+ * Even on the writer thread, a savefile written with standard I/O is
+ * written with one write(2) at a time, each waiting for the data to be
+ * copied, so a fast array of disks can't be kept busy.  With
+ * --io-uring, the stream libpcap writes to copies the savefile into a
+ * few large, aligned buffers instead; each is handed to the kernel with
+ * io_uring once it's full, and filling the next one goes on while it's
+ * being written.  The buffers are registered with the ring if the
+ * locked memory limit allows, so the kernel doesn't have to map them
+ * for each write, and --io-uring=direct opens the savefile with
+ * O_DIRECT so that the data doesn't go through the page cache.
+ *
+ * Closing a savefile, when -C or -G rotates it, queues the write of
+ * its last buffer, an fsync and the close as a chain, and doesn't wait
+ * for them; their result is reported by the next uring_savefile_open()
+ * or by uring_savefile_finish().
+ *
+ * There's one ring and set of buffers, shared by the savefiles written
+ * one after another; they're to be used by one thread at a time.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#define _GNU_SOURCE	/* for fopencookie() and O_DIRECT */
+
+#include "netdissect-stdinc.h"
+
+#include <errno.h>
+#include <pcap.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "uring-savefile.h"
+
+#ifdef URING_SAVEFILE_SUPPORTED
+
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <fcntl.h>
+#include <linux/io_uring.h>
+#include <unistd.h>
+
+#define URING_NBUFS	4
+#define URING_BUFSIZE	(1024 * 1024)	/* a multiple of URING_ALIGN */
+#define URING_ALIGN	4096		/* enough for O_DIRECT everywhere */
+#define URING_ENTRIES	16
+
+/*
+ * What a completion is for is in the low bits of its user_data, above
+ * them the buffer written or the savefile fsynced or closed.
+ */
+#define URING_OP_WRITE	0
+#define URING_OP_FSYNC	1
+#define URING_OP_CLOSE	2
+#define URING_OP_MASK	3
+
+struct uring_buf {
+	u_char *data;
+	struct uring_savefile *owner;	/* NULL if free */
+	size_t used;			/* filled so far */
+	size_t wlen;			/* length of the write in flight */
+	int busy;			/* a write of it is in flight */
+};
+
+struct uring_savefile {
+	int fd;
+	char *name;
+	FILE *fp;
+	int direct;			/* opened with O_DIRECT */
+	struct uring_buf *fill;		/* being filled, or NULL */
+	uint64_t fill_off;		/* where in the file fill goes */
+	uint64_t offset;		/* bytes written to the stream */
+	u_int inflight;			/* requests not yet completed */
+	int error;			/* errno of the first failure, or 0 */
+	int reported;			/* error returned by uring_savefile_close() */
+	int fp_closed;			/* the stream has been closed */
+	int released;			/* uring_savefile_close() was called */
+	struct uring_savefile *next;	/* on ring.closing */
+};
+
+static struct {
+	int ready;
+	int fd;
+	u_int entries;
+	u_int *sq_head, *sq_tail, *sq_array, sq_mask;
+	u_int *cq_head, *cq_tail, cq_mask;
+	struct io_uring_sqe *sqes;
+	struct io_uring_cqe *cqes;
+	u_int pending;			/* queued but not yet submitted */
+	u_int inflight;			/* submitted but not yet completed */
+	int fixed;			/* the buffers are registered */
+	struct uring_buf bufs[URING_NBUFS];
+	struct uring_savefile *closing;	/* closed, with requests in flight */
+	char deferred[PCAP_ERRBUF_SIZE];	/* failure of one of those */
+} ring;
+
+static int
+uring_setup(char *errbuf)
+{
+	struct io_uring_params p;
+	struct iovec iov[URING_NBUFS];
+	size_t sq_size, cq_size;
+	u_char *sq, *cq, *mem;
+	void *sqes;
+	int fd, i;
+
+	memset(&p, 0, sizeof(p));
+	fd = (int)syscall(__NR_io_uring_setup, URING_ENTRIES, &p);
+	if (fd < 0) {
+		(void)snprintf(errbuf, PCAP_ERRBUF_SIZE,
+		    "can't set up io_uring: %s", strerror(errno));
+		return (-1);
+	}
+	sq_size = p.sq_off.array + p.sq_entries * sizeof(u_int);
+	cq_size = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+	if ((p.features & IORING_FEAT_SINGLE_MMAP) && cq_size > sq_size)
+		sq_size = cq_size;
+	sq = mmap(NULL, sq_size, PROT_READ | PROT_WRITE,
+	    MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+	if (sq == MAP_FAILED)
+		goto fail;
+	if (p.features & IORING_FEAT_SINGLE_MMAP)
+		cq = sq;
+	else {
+		cq = mmap(NULL, cq_size, PROT_READ | PROT_WRITE,
+		    MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+		if (cq == MAP_FAILED)
+			goto fail;
+	}
+	sqes = mmap(NULL, p.sq_entries * sizeof(struct io_uring_sqe),
+	    PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd,
+	    IORING_OFF_SQES);
+	if (sqes == MAP_FAILED)
+		goto fail;
+	if (posix_memalign((void **)&mem, URING_ALIGN,
+	    URING_NBUFS * URING_BUFSIZE) != 0) {
+		errno = ENOMEM;
+		goto fail;
+	}
+
+	ring.fd = fd;
+	ring.entries = p.sq_entries;
+	ring.sq_head = (u_int *)(sq + p.sq_off.head);
+	ring.sq_tail = (u_int *)(sq + p.sq_off.tail);
+	ring.sq_array = (u_int *)(sq + p.sq_off.array);
+	ring.sq_mask = *(u_int *)(sq + p.sq_off.ring_mask);
+	ring.cq_head = (u_int *)(cq + p.cq_off.head);
+	ring.cq_tail = (u_int *)(cq + p.cq_off.tail);
+	ring.cq_mask = *(u_int *)(cq + p.cq_off.ring_mask);
+	ring.cqes = (struct io_uring_cqe *)(cq + p.cq_off.cqes);
+	ring.sqes = (struct io_uring_sqe *)sqes;
+	for (i = 0; i < URING_NBUFS; i++) {
+		ring.bufs[i].data = mem + (size_t)i * URING_BUFSIZE;
+		iov[i].iov_base = ring.bufs[i].data;
+		iov[i].iov_len = URING_BUFSIZE;
+	}
+	/* Registering them can fail under RLIMIT_MEMLOCK; that's OK. */
+	ring.fixed = syscall(__NR_io_uring_register, fd,
+	    IORING_REGISTER_BUFFERS, iov, URING_NBUFS) == 0;
+	ring.ready = 1;
+	return (0);
+
+fail:
+	(void)snprintf(errbuf, PCAP_ERRBUF_SIZE,
+	    "can't map the io_uring: %s", strerror(errno));
+	(void)close(fd);
+	return (-1);
+}
+
+/*
+ * Note the first failure of a request for usf.
+ */
+static void
+uring_fail(struct uring_savefile *usf, int err)
+{
+	if (usf->error == 0)
+		usf->error = err;
+}
+
+/*
+ * Free a savefile that's been closed and has nothing left in flight,
+ * keeping any failure it had that hasn't been reported.
+ */
+static void
+uring_retire(struct uring_savefile *usf)
+{
+	struct uring_savefile **pp;
+
+	for (pp = &ring.closing; *pp != NULL; pp = &(*pp)->next)
+		if (*pp == usf) {
+			*pp = usf->next;
+			break;
+		}
+	if (usf->error != 0 && !usf->reported && ring.deferred[0] == '\0')
+		(void)snprintf(ring.deferred, sizeof(ring.deferred),
+		    "unable to write to %s: %s", usf->name,
+		    strerror(usf->error));
+	free(usf->name);
+	free(usf);
+}
+
+static void
+uring_complete(const struct io_uring_cqe *cqe)
+{
+	uintptr_t p = (uintptr_t)cqe->user_data & ~(uintptr_t)URING_OP_MASK;
+	struct uring_savefile *usf;
+	struct uring_buf *b;
+
+	switch (cqe->user_data & URING_OP_MASK) {
+
+	case URING_OP_WRITE:
+		b = (struct uring_buf *)p;
+		usf = b->owner;
+		if (cqe->res < 0)
+			uring_fail(usf, -cqe->res);
+		else if ((size_t)cqe->res != b->wlen)
+			uring_fail(usf, EIO);	/* a short write */
+		b->busy = 0;
+		if (b != usf->fill)
+			b->owner = NULL;
+		break;
+
+	case URING_OP_FSYNC:
+		usf = (struct uring_savefile *)p;
+		if (cqe->res < 0 && cqe->res != -ECANCELED)
+			uring_fail(usf, -cqe->res);
+		break;
+
+	default:
+		usf = (struct uring_savefile *)p;
+		/*
+		 * It's cancelled if the write or fsync before it failed,
+		 * and fails with EINVAL on kernels without
+		 * IORING_OP_CLOSE; either way, it wasn't closed.
+		 */
+		if (cqe->res == -ECANCELED || cqe->res == -EINVAL) {
+			if (close(usf->fd) == -1)
+				uring_fail(usf, errno);
+		} else if (cqe->res < 0)
+			uring_fail(usf, -cqe->res);
+		break;
+	}
+	ring.inflight--;
+	usf->inflight--;
+	if (usf->released && usf->inflight == 0)
+		uring_retire(usf);
+}
+
+/*
+ * Submit what's been queued, and wait for at least min_complete
+ * requests to complete; handle whatever has completed.
+ */
+static int
+uring_enter(u_int min_complete)
+{
+	u_int head, tail;
+	int n;
+
+	for (;;) {
+		n = (int)syscall(__NR_io_uring_enter, ring.fd, ring.pending,
+		    min_complete, min_complete != 0 ?
+		    IORING_ENTER_GETEVENTS : 0, NULL, 0);
+		if (n >= 0)
+			break;
+		if (errno != EINTR)
+			return (-1);
+	}
+	ring.pending -= (u_int)n;
+	ring.inflight += (u_int)n;
+
+	head = *ring.cq_head;
+	tail = __atomic_load_n(ring.cq_tail, __ATOMIC_ACQUIRE);
+	for (; head != tail; head++)
+		uring_complete(&ring.cqes[head & ring.cq_mask]);
+	__atomic_store_n(ring.cq_head, head, __ATOMIC_RELEASE);
+	return (0);
+}
+
+/*
+ * Wait until there's room for "n" more requests, so that a chain of
+ * them is submitted all at once.
+ */
+static int
+uring_reserve(u_int n)
+{
+	while (ring.inflight + ring.pending + n > ring.entries)
+		if (uring_enter(1) == -1)
+			return (-1);
+	return (0);
+}
+
+static struct io_uring_sqe *
+uring_sqe(uint8_t opcode, int fd, uint8_t flags, uintptr_t data)
+{
+	struct io_uring_sqe *sqe;
+	u_int tail;
+
+	tail = *ring.sq_tail;
+	sqe = &ring.sqes[tail & ring.sq_mask];
+	memset(sqe, 0, sizeof(*sqe));
+	sqe->opcode = opcode;
+	sqe->fd = fd;
+	sqe->flags = flags;
+	sqe->user_data = data;
+	ring.sq_array[tail & ring.sq_mask] = tail & ring.sq_mask;
+	__atomic_store_n(ring.sq_tail, tail + 1, __ATOMIC_RELEASE);
+	ring.pending++;
+	return (sqe);
+}
+
+/*
+ * Queue the write of the first "len" bytes of b to where it goes in
+ * usf; room for the request has to have been reserved.
+ */
+static void
+uring_write(struct uring_savefile *usf, struct uring_buf *b, size_t len,
+	    uint8_t flags)
+{
+	struct io_uring_sqe *sqe;
+
+	sqe = uring_sqe(ring.fixed ? IORING_OP_WRITE_FIXED : IORING_OP_WRITE,
+	    usf->fd, flags, (uintptr_t)b | URING_OP_WRITE);
+	sqe->off = usf->fill_off;
+	sqe->addr = (uintptr_t)b->data;
+	sqe->len = (uint32_t)len;
+	if (ring.fixed)
+		sqe->buf_index = (uint16_t)(b - ring.bufs);
+	b->wlen = len;
+	b->busy = 1;
+	usf->inflight++;
+}
+
+/* Wait for everything in flight for usf, other than its close. */
+static int
+uring_wait_all(struct uring_savefile *usf)
+{
+	while (usf->inflight != 0)
+		if (uring_enter(1) == -1)
+			return (-1);
+	return (0);
+}
+
+/*
+ * Turn O_DIRECT off or on again, for a write that isn't a multiple of
+ * the alignment; nothing of usf may be in flight.
+ */
+static int
+uring_set_direct(struct uring_savefile *usf, int on)
+{
+	int flags;
+
+	flags = fcntl(usf->fd, F_GETFL);
+	if (flags == -1)
+		return (-1);
+	flags = on ? (flags | O_DIRECT) : (flags & ~O_DIRECT);
+	return (fcntl(usf->fd, F_SETFL, flags));
+}
+
+/*
+ * Give usf a buffer to fill, waiting for one to be written out if
+ * they're all in use.
+ */
+static int
+uring_take_buf(struct uring_savefile *usf)
+{
+	u_int i;
+
+	for (;;) {
+		for (i = 0; i < URING_NBUFS; i++)
+			if (ring.bufs[i].owner == NULL) {
+				usf->fill = &ring.bufs[i];
+				usf->fill->owner = usf;
+				usf->fill->used = 0;
+				return (0);
+			}
+		if (uring_enter(1) == -1)
+			return (-1);
+	}
+}
+
+static ssize_t
+uring_cookie_write(void *cookie, const char *buf, size_t len)
+{
+	struct uring_savefile *usf = (struct uring_savefile *)cookie;
+	struct uring_buf *b;
+	size_t left, n;
+
+	/* A short count is taken as an error. */
+	if (usf->error != 0) {
+		errno = usf->error;
+		return (0);
+	}
+	for (left = len; left != 0; left -= n, buf += n) {
+		if (usf->fill == NULL && uring_take_buf(usf) == -1)
+			goto fail;
+		b = usf->fill;
+		n = URING_BUFSIZE - b->used;
+		if (n > left)
+			n = left;
+		memcpy(b->data + b->used, buf, n);
+		b->used += n;
+		if (b->used < URING_BUFSIZE)
+			continue;
+
+		/* It's full; send it off, and go on with another one. */
+		if (uring_reserve(1) == -1)
+			goto fail;
+		usf->fill = NULL;
+		uring_write(usf, b, URING_BUFSIZE, 0);
+		usf->fill_off += URING_BUFSIZE;
+		if (uring_enter(0) == -1)
+			goto fail;
+	}
+	usf->offset += len;
+	return ((ssize_t)len);
+
+fail:
+	uring_fail(usf, errno);
+	return (0);
+}
+
+static int
+uring_cookie_seek(void *cookie, off64_t *offset, int whence)
+{
+	if (*offset != 0 || whence != SEEK_CUR) {
+		errno = ESPIPE;
+		return (-1);
+	}
+	*offset = (off64_t)((struct uring_savefile *)cookie)->offset;
+	return (0);
+}
+
+/*
+ * Queue the write of what's left, then the fsync and close, and
+ * return without waiting for them.
+ */
+static int
+uring_cookie_close(void *cookie)
+{
+	struct uring_savefile *usf = (struct uring_savefile *)cookie;
+	struct uring_buf *b = usf->fill;
+
+	usf->fp_closed = 1;
+	if (b != NULL && b->used % URING_ALIGN != 0 && usf->direct &&
+	    (uring_wait_all(usf) == -1 || uring_set_direct(usf, 0) == -1))
+		goto fail;
+	if (uring_reserve(3) == -1)
+		goto fail;
+	if (b != NULL) {
+		usf->fill = NULL;
+		if (b->used != 0)
+			uring_write(usf, b, b->used, IOSQE_IO_LINK);
+		else
+			b->owner = NULL;
+	}
+	(void)uring_sqe(IORING_OP_FSYNC, usf->fd, IOSQE_IO_LINK,
+	    (uintptr_t)usf | URING_OP_FSYNC);
+	(void)uring_sqe(IORING_OP_CLOSE, usf->fd, 0,
+	    (uintptr_t)usf | URING_OP_CLOSE);
+	usf->inflight += 2;
+	usf->next = ring.closing;
+	ring.closing = usf;
+	if (uring_enter(0) == -1)
+		return (-1);
+	return (usf->error != 0 ? -1 : 0);
+
+fail:
+	uring_fail(usf, errno);
+	if (b != NULL) {
+		usf->fill = NULL;
+		if (!b->busy)
+			b->owner = NULL;
+	}
+	(void)close(usf->fd);
+	usf->next = ring.closing;
+	ring.closing = usf;
+	return (-1);
+}
+
+/*
+ * Wait for the earlier savefile "name", if it's still being written,
+ * as -W can have a new savefile reuse the name.
+ */
+static int
+uring_wait_name(const char *name)
+{
+	struct uring_savefile *usf;
+
+	for (;;) {
+		for (usf = ring.closing; usf != NULL; usf = usf->next)
+			if (strcmp(usf->name, name) == 0)
+				break;
+		if (usf == NULL)
+			return (0);
+		if (uring_enter(1) == -1)
+			return (-1);
+	}
+}
+
+/*
+ * Create the savefile "name", with O_DIRECT if "direct" is set, and
+ * write what's written to the stream returned by uring_savefile_file()
+ * to it.  On failure, NULL is returned with a message in errbuf, which
+ * is also where a failure to write an earlier savefile is reported.
+ */
+struct uring_savefile *
+uring_savefile_open(const char *name, int direct, char *errbuf)
+{
+	struct uring_savefile *usf;
+	cookie_io_functions_t io;
+
+	if (!ring.ready && uring_setup(errbuf) == -1)
+		return (NULL);
+	if (uring_wait_name(name) == -1) {
+		(void)snprintf(errbuf, PCAP_ERRBUF_SIZE, "io_uring: %s",
+		    strerror(errno));
+		return (NULL);
+	}
+	if (ring.deferred[0] != '\0') {
+		(void)snprintf(errbuf, PCAP_ERRBUF_SIZE, "%s", ring.deferred);
+		return (NULL);
+	}
+	usf = (struct uring_savefile *)calloc(1, sizeof(*usf));
+	if (usf == NULL || (usf->name = strdup(name)) == NULL) {
+		(void)snprintf(errbuf, PCAP_ERRBUF_SIZE, "out of memory");
+		free(usf);
+		return (NULL);
+	}
+	usf->direct = direct;
+	usf->fd = open(name, O_CREAT | O_WRONLY | O_TRUNC |
+	    (direct ? O_DIRECT : 0), 0644);
+	if (usf->fd < 0) {
+		(void)snprintf(errbuf, PCAP_ERRBUF_SIZE,
+		    "unable to open file %s: %s", name, strerror(errno));
+		free(usf->name);
+		free(usf);
+		return (NULL);
+	}
+	io.read = NULL;
+	io.write = uring_cookie_write;
+	io.seek = uring_cookie_seek;
+	io.close = uring_cookie_close;
+	usf->fp = fopencookie(usf, "w", io);
+	if (usf->fp == NULL) {
+		(void)snprintf(errbuf, PCAP_ERRBUF_SIZE,
+		    "%s: can't open a stream: %s", name, strerror(errno));
+		(void)close(usf->fd);
+		free(usf->name);
+		free(usf);
+		return (NULL);
+	}
+	return (usf);
+}
+
+/*
+ * The stream to write the savefile to; it's to be closed with fclose(),
+ * or by pcap_dump_close() or pcapng_savefile_close(), before
+ * uring_savefile_close() is called.
+ */
+FILE *
+uring_savefile_file(const struct uring_savefile *usf)
+{
+	return (usf->fp);
+}
+
+/*
+ * Write out everything written to the stream so far, and wait for it
+ * to be written, for -U.  With O_DIRECT, a part-filled buffer is
+ * written without it, and written again once it's full.  Returns -1,
+ * with errno set, on an error.
+ */
+int
+uring_savefile_flush(struct uring_savefile *usf)
+{
+	struct uring_buf *b;
+
+	if (fflush(usf->fp) == EOF)
+		return (-1);
+	b = usf->fill;
+	if (b != NULL && b->used != 0) {
+		if (usf->direct &&
+		    (uring_wait_all(usf) == -1 || uring_set_direct(usf, 0) == -1))
+			goto fail;
+		if (uring_reserve(1) == -1)
+			goto fail;
+		uring_write(usf, b, b->used, 0);
+		if (!usf->direct) {
+			usf->fill = NULL;
+			usf->fill_off += b->used;
+		}
+		if (uring_wait_all(usf) == -1 ||
+		    (usf->direct && uring_set_direct(usf, 1) == -1))
+			goto fail;
+	} else if (uring_wait_all(usf) == -1)
+		goto fail;
+	if (usf->error != 0) {
+		errno = usf->error;
+		return (-1);
+	}
+	return (0);
+
+fail:
+	uring_fail(usf, errno);
+	return (-1);
+}
+
+/*
+ * Let go of usf, closing the stream first if that hasn't been done.
+ * Returns -1, with errno set, if writing the savefile has failed so far;
+ * what's still in flight is reported later.
+ */
+int
+uring_savefile_close(struct uring_savefile *usf)
+{
+	int err;
+
+	if (!usf->fp_closed)
+		(void)fclose(usf->fp);
+	err = usf->error;
+	usf->reported = err != 0;
+	usf->released = 1;
+	if (usf->inflight == 0)
+		uring_retire(usf);
+	if (err != 0) {
+		errno = err;
+		return (-1);
+	}
+	return (0);
+}
+
+/*
+ * Wait for the savefiles that have been closed to be written out and
+ * closed; returns -1, with a message in errbuf, if one of them failed.
+ */
+int
+uring_savefile_finish(char *errbuf)
+{
+	while (ring.closing != NULL)
+		if (uring_enter(1) == -1) {
+			(void)snprintf(errbuf, PCAP_ERRBUF_SIZE,
+			    "io_uring: %s", strerror(errno));
+			return (-1);
+		}
+	if (ring.deferred[0] != '\0') {
+		(void)snprintf(errbuf, PCAP_ERRBUF_SIZE, "%s", ring.deferred);
+		return (-1);
+	}
+	return (0);
+}
+#endif /* URING_SAVEFILE_SUPPORTED */
@@ -0,0 +1,33 @@
+/*
+ * Copyright (c) 2026 The TCPDUMP project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that: (1) source code
+ * distributions retain the above copyright notice and this paragraph
+ * in its entirety, and (2) distributions including binary code include
+ * the above copyright notice and this paragraph in its entirety in
+ * the documentation or other materials provided with the distribution.
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND
+ * WITHOUT ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, WITHOUT
+ * LIMITATION, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE.
+ */
+
+/*
+ * Savefiles written with io_uring, for -w with --io-uring; libpcap or
+ * the pcapng writer write the savefile to a standard I/O stream, which
+ * fills large buffers that are written out asynchronously.
+ */
+#if defined(__linux__) && defined(HAVE_LINUX_IO_URING_H) && \
+    defined(HAVE_FOPENCOOKIE) && defined(__GNUC__)
+#define URING_SAVEFILE_SUPPORTED
+
+struct uring_savefile;
+
+extern struct uring_savefile *uring_savefile_open(const char *, int, char *);
+extern FILE *uring_savefile_file(const struct uring_savefile *);
+extern int uring_savefile_flush(struct uring_savefile *);
+extern int uring_savefile_close(struct uring_savefile *);
+extern int uring_savefile_finish(char *);
+#endif
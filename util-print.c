@@ -46,6 +46,7 @@
 #ifdef HAVE_FCNTL_H
 #include <fcntl.h>
 #endif
+#include <limits.h>
 #include <stdio.h>
 #include <stdarg.h>
 #include <stdlib.h>
@@ -54,6 +55,7 @@
 #include "netdissect-ctype.h"
 
 #include "netdissect.h"
+#include "netdissect-profile.h"
 #include "extract.h"
 #include "ascii_strcasecmp.h"
 #include "timeval-operations.h"
@@ -80,6 +82,38 @@ fn_print_char(netdissect_options *ndo, u_char c)
 	ND_PRINT("%c", c);
 }
 
+/*
+ * Print the run of printable characters at the start of the (at most)
+ * n bytes at s, stopping at ep (if given) or at the end of the captured
+ * data, with one ND_PRINT() rather than one per character; return the
+ * length of the run.  The caller prints whatever stopped it, if
+ * anything, with fn_print_char(), after fetching it with GET_U_1() so
+ * that running off the end of the captured data is caught as it
+ * otherwise would be.
+ */
+static u_int
+nd_print_printable(netdissect_options *ndo,
+                   const u_char *s, u_int n, const u_char *ep)
+{
+	u_int i;
+
+	if (ndo->ndo_snapend <= s)
+		return (0);
+	if (n > ND_BYTES_AVAILABLE_AFTER(s))
+		n = ND_BYTES_AVAILABLE_AFTER(s);
+	if (ep != NULL) {
+		if (ep <= s)
+			return (0);
+		if (n > ND_BYTES_BETWEEN(ep, s))
+			n = ND_BYTES_BETWEEN(ep, s);
+	}
+	for (i = 0; i < n && ND_ASCII_ISPRINT(s[i]); i++)
+		continue;
+	if (i != 0)
+		ND_PRINT("%.*s", (int)i, (const char *)s);
+	return (i);
+}
+
 /*
  * Print a null-terminated string, filtering out non-printable characters.
  * DON'T USE IT with a pointer on the packet buffer because there is no
@@ -88,7 +122,16 @@ fn_print_char(netdissect_options *ndo, u_char c)
 void
 fn_print_str(netdissect_options *ndo, const u_char *s)
 {
+	const u_char *p;
+
 	while (*s != '\0') {
+		for (p = s; ND_ASCII_ISPRINT(*p); p++)
+			continue;
+		if (p != s) {
+			ND_PRINT("%.*s", (int)(p - s), (const char *)s);
+			s = p;
+			continue;
+		}
 		fn_print_char(ndo, *s);
 		s++;
        }
@@ -110,6 +153,9 @@ nd_print(netdissect_options *ndo,
 
 	ret = 1;			/* assume truncated */
 	while (ep == NULL || s < ep) {
+		s += nd_print_printable(ndo, s, UINT_MAX, ep);
+		if (ep != NULL && s >= ep)
+			break;
 		c = GET_U_1(s);
 		s++;
 		if (c == '\0') {
@@ -143,11 +189,15 @@ u_int
 nd_printztn(netdissect_options *ndo,
          const u_char *s, u_int n, const u_char *ep)
 {
-	u_int bytes;
+	u_int bytes, run;
 	u_char c;
 
 	bytes = 0;
 	for (;;) {
+		run = nd_print_printable(ndo, s, n, ep);
+		s += run;
+		bytes += run;
+		n -= run;
 		if (n == 0 || (ep != NULL && s >= ep)) {
 			/*
 			 * Truncated.  This includes "no null before we
@@ -187,9 +237,15 @@ int
 nd_printn(netdissect_options *ndo,
           const u_char *s, u_int n, const u_char *ep)
 {
+	u_int run;
 	u_char c;
 
 	while (n > 0 && (ep == NULL || s < ep)) {
+		run = nd_print_printable(ndo, s, n, ep);
+		s += run;
+		n -= run;
+		if (n == 0 || (ep != NULL && s >= ep))
+			break;
 		n--;
 		c = GET_U_1(s);
 		s++;
@@ -212,10 +268,16 @@ nd_printzp(netdissect_options *ndo,
            const u_char *ep)
 {
 	int ret;
+	u_int run;
 	u_char c;
 
 	ret = 1;			/* assume truncated */
 	while (n > 0 && (ep == NULL || s < ep)) {
+		run = nd_print_printable(ndo, s, n, ep);
+		s += run;
+		n -= run;
+		if (n == 0 || (ep != NULL && s >= ep))
+			break;
 		n--;
 		c = GET_U_1(s);
 		s++;
@@ -229,28 +291,79 @@ nd_printzp(netdissect_options *ndo,
 }
 
 /*
- * Print the timestamp .FRAC part (Microseconds/nanoseconds)
+ * Put "v" in decimal, zero-padded to at least "width" (at most 9)
+ * digits, at "cp"; return a pointer past the last digit.
  */
-static void
-ts_frac_print(netdissect_options *ndo, long usec)
+static char *
+ts_format_digits(char *cp, u_int v, u_int width)
+{
+	char digits[10];
+	u_int n = 0;
+
+	do {
+		digits[n++] = (char)('0' + v % 10);
+		v /= 10;
+	} while (v != 0);
+	while (n < width)
+		digits[n++] = '0';
+	while (n != 0)
+		*cp++ = digits[--n];
+	return (cp);
+}
+
+/*
+ * Put the timestamp .FRAC part (Microseconds/nanoseconds) at "cp";
+ * return a pointer past it.  At most sizeof(".{unknown}") - 1 bytes
+ * are written.
+ */
+static char *
+ts_frac_format(netdissect_options *ndo _U_, long usec, char *cp)
 {
 #ifdef HAVE_PCAP_SET_TSTAMP_PRECISION
 	switch (ndo->ndo_tstamp_precision) {
 
 	case PCAP_TSTAMP_PRECISION_MICRO:
-		ND_PRINT(".%06u", (unsigned)usec);
-		break;
+		*cp++ = '.';
+		return (ts_format_digits(cp, (unsigned)usec, 6));
 
 	case PCAP_TSTAMP_PRECISION_NANO:
-		ND_PRINT(".%09u", (unsigned)usec);
-		break;
+		*cp++ = '.';
+		return (ts_format_digits(cp, (unsigned)usec, 9));
 
 	default:
-		ND_PRINT(".{unknown}");
-		break;
+		memcpy(cp, ".{unknown}", sizeof(".{unknown}") - 1);
+		return (cp + sizeof(".{unknown}") - 1);
 	}
 #else
-	ND_PRINT(".%06u", (unsigned)usec);
+	*cp++ = '.';
+	return (ts_format_digits(cp, (unsigned)usec, 6));
+#endif
+}
+
+/*
+ * localtime() and gmtime() fill in a struct tm that libc shares between
+ * threads, so they race when several packets are dissected at once;
+ * these fill in the caller's instead.  They return "tm", or NULL if the
+ * time can't be converted.  tzset() has to have been called, as
+ * localtime_r() needn't.
+ */
+struct tm *
+nd_localtime(const time_t *t, struct tm *tm)
+{
+#ifdef _WIN32
+	return (localtime_s(tm, t) == 0 ? tm : NULL);
+#else
+	return (localtime_r(t, tm));
+#endif
+}
+
+struct tm *
+nd_gmtime(const time_t *t, struct tm *tm)
+{
+#ifdef _WIN32
+	return (gmtime_s(tm, t) == 0 ? tm : NULL);
+#else
+	return (gmtime_r(t, tm));
 #endif
 }
 
@@ -258,36 +371,56 @@ ts_frac_print(netdissect_options *ndo, long usec)
  * Print the timestamp as [YY:MM:DD] HH:MM:SS.FRAC.
  *   if time_flag == LOCAL_TIME print local time else UTC/GMT time
  *   if date_flag == WITH_DATE print YY:MM:DD before HH:MM:SS.FRAC
+ *
+ * Consecutive packets mostly have the same seconds, so the formatted
+ * date and time for the last one is kept rather than calling
+ * nd_localtime()/nd_gmtime() and strftime() every time.
  */
 static void
 ts_date_hmsfrac_print(netdissect_options *ndo, long sec, long usec,
 		      enum date_flag date_flag, enum time_flag time_flag)
 {
-	time_t Time = sec;
-	struct tm *tm;
-	char timestr[32];
+	static ND_THREAD_LOCAL struct {
+		long sec;
+		int flags;		/* date_flag | time_flag << 1, -1 if unset */
+		size_t len;
+		char str[32];
+	} last = { 0, -1, 0, "" };
+	int flags = date_flag | time_flag << 1;
+	char timestr[sizeof(last.str) + sizeof(".{unknown}")];
+	char *cp;
 
 	if ((unsigned)sec & 0x80000000) {
 		ND_PRINT("[Error converting time]");
 		return;
 	}
 
-	if (time_flag == LOCAL_TIME)
-		tm = localtime(&Time);
-	else
-		tm = gmtime(&Time);
+	if (sec != last.sec || flags != last.flags) {
+		time_t Time = sec;
+		struct tm tmbuf, *tm;
 
-	if (!tm) {
-		ND_PRINT("[Error converting time]");
-		return;
+		if (time_flag == LOCAL_TIME)
+			tm = nd_localtime(&Time, &tmbuf);
+		else
+			tm = nd_gmtime(&Time, &tmbuf);
+
+		if (!tm) {
+			ND_PRINT("[Error converting time]");
+			return;
+		}
+		if (date_flag == WITH_DATE)
+			last.len = strftime(last.str, sizeof(last.str),
+			    "%Y-%m-%d %H:%M:%S", tm);
+		else
+			last.len = strftime(last.str, sizeof(last.str),
+			    "%H:%M:%S", tm);
+		last.sec = sec;
+		last.flags = flags;
 	}
-	if (date_flag == WITH_DATE)
-		strftime(timestr, sizeof(timestr), "%Y-%m-%d %H:%M:%S", tm);
-	else
-		strftime(timestr, sizeof(timestr), "%H:%M:%S", tm);
+	memcpy(timestr, last.str, last.len);
+	cp = ts_frac_format(ndo, usec, timestr + last.len);
+	*cp = '\0';
 	ND_PRINT("%s", timestr);
-
-	ts_frac_print(ndo, usec);
 }
 
 /*
@@ -296,13 +429,52 @@ ts_date_hmsfrac_print(netdissect_options *ndo, long sec, long usec,
 static void
 ts_unix_print(netdissect_options *ndo, long sec, long usec)
 {
+	char timestr[sizeof("4294967295") + sizeof(".{unknown}")];
+	char *cp;
+
 	if ((unsigned)sec & 0x80000000) {
 		ND_PRINT("[Error converting time]");
 		return;
 	}
 
-	ND_PRINT("%u", (unsigned)sec);
-	ts_frac_print(ndo, usec);
+	cp = ts_format_digits(timestr, (unsigned)sec, 1);
+	cp = ts_frac_format(ndo, usec, cp);
+	*cp = '\0';
+	ND_PRINT("%s", timestr);
+}
+
+/*
+ * Print the time from the reference time stamp to "ts", and make "ts"
+ * the reference if "update" is set; the first time stamp is the first
+ * reference.
+ */
+static void
+ts_relative_print(netdissect_options *ndo, nd_ts_t ts, int update)
+{
+	static ND_THREAD_LOCAL nd_ts_t ts_ref;
+	static ND_THREAD_LOCAL int ts_ref_set;
+	nd_ts_t delta;
+	long frac;
+	int negative_offset;
+
+	if (!ts_ref_set) {
+		ts_ref = ts; /* set timestamp for first packet */
+		ts_ref_set = 1;
+	}
+
+	negative_offset = ts < ts_ref;
+	delta = negative_offset ? ts_ref - ts : ts - ts_ref;
+	frac = (long)(delta % _NANO_PER_SEC);
+	if (!ND_TSTAMP_NANO(ndo))
+		frac /= 1000;
+
+	ND_PRINT((negative_offset ? "-" : " "));
+	ts_date_hmsfrac_print(ndo, (long)(delta / _NANO_PER_SEC), frac,
+			      WITHOUT_DATE, UTC_TIME);
+	ND_PRINT(" ");
+
+	if (update)
+		ts_ref = ts; /* set timestamp for previous packet */
 }
 
 /*
@@ -312,11 +484,6 @@ void
 ts_print(netdissect_options *ndo,
          const struct timeval *tvp)
 {
-	static struct timeval tv_ref;
-	struct timeval tv_result;
-	int negative_offset;
-	int nano_prec;
-
 	switch (ndo->ndo_tflag) {
 
 	case 0: /* Default */
@@ -335,37 +502,9 @@ ts_print(netdissect_options *ndo,
 
 	case 3: /* Microseconds/nanoseconds since previous packet */
         case 5: /* Microseconds/nanoseconds since first packet */
-#ifdef HAVE_PCAP_SET_TSTAMP_PRECISION
-		switch (ndo->ndo_tstamp_precision) {
-		case PCAP_TSTAMP_PRECISION_MICRO:
-			nano_prec = 0;
-			break;
-		case PCAP_TSTAMP_PRECISION_NANO:
-			nano_prec = 1;
-			break;
-		default:
-			nano_prec = 0;
-			break;
-		}
-#else
-		nano_prec = 0;
-#endif
-		if (!(netdissect_timevalisset(&tv_ref)))
-			tv_ref = *tvp; /* set timestamp for first packet */
-
-		negative_offset = netdissect_timevalcmp(tvp, &tv_ref, <);
-		if (negative_offset)
-			netdissect_timevalsub(&tv_ref, tvp, &tv_result, nano_prec);
-		else
-			netdissect_timevalsub(tvp, &tv_ref, &tv_result, nano_prec);
-
-		ND_PRINT((negative_offset ? "-" : " "));
-		ts_date_hmsfrac_print(ndo, tv_result.tv_sec, tv_result.tv_usec,
-				      WITHOUT_DATE, UTC_TIME);
-		ND_PRINT(" ");
-
-                if (ndo->ndo_tflag == 3)
-			tv_ref = *tvp; /* set timestamp for previous packet */
+		ts_relative_print(ndo,
+		    ND_TS_FROM_TIMEVAL(tvp, ND_TSTAMP_NANO(ndo)),
+		    ndo->ndo_tflag == 3);
 		break;
 
 	case 4: /* Date + Default */
@@ -443,6 +582,7 @@ signed_relts_print(netdissect_options *ndo,
 /* Print the truncated string */
 void nd_print_trunc(netdissect_options *ndo)
 {
+	ND_SNAPLEN_TRUNCATED();
 	ND_PRINT(" [|%s]", ndo->ndo_protocol);
 }
 
@@ -491,6 +631,162 @@ print_unknown_data(netdissect_options *ndo, const u_char *cp,const char *ident,i
 	return(1); /* everything is ok */
 }
 
+/*
+ * Token tables with at least TOK_INDEX_MIN entries get an index the
+ * first time a thread looks something up in them: a direct map if
+ * their values are dense enough, otherwise a sorted copy for binary
+ * search.  As with a linear scan, the first entry for a value wins.
+ * The indexes are per thread and kept in a hash table keyed by the
+ * table's address, which works because all token tables are static.
+ */
+#define TOK_INDEX_MIN		16
+#define TOK_DENSE_MAX		4096	/* largest direct-mapped range */
+
+enum tok_index_kind { TOK_LINEAR, TOK_DENSE, TOK_SORTED };
+
+struct tok_index {
+	const struct tok *table;	/* NULL if the slot is free */
+	enum tok_index_kind kind;
+	u_int base;			/* TOK_DENSE: lowest value */
+	u_int n;			/* number of map or sorted entries */
+	const char **map;		/* TOK_DENSE: name for v - base */
+	struct tok *sorted;		/* TOK_SORTED: by value, no duplicates */
+};
+
+static ND_THREAD_LOCAL struct tok_index *tok_indexes;
+static ND_THREAD_LOCAL u_int tok_indexes_size;	/* a power of 2 */
+static ND_THREAD_LOCAL u_int tok_indexes_used;
+
+struct tok_sortent {
+	u_int v;
+	u_int pos;			/* position in the table */
+	const char *s;
+};
+
+static int
+tok_sortent_cmp(const void *a, const void *b)
+{
+	const struct tok_sortent *x = a, *y = b;
+
+	if (x->v != y->v)
+		return (x->v < y->v ? -1 : 1);
+	return (x->pos < y->pos ? -1 : x->pos > y->pos);
+}
+
+static u_int
+tok_index_hash(const struct tok *lp)
+{
+	return (u_int)(((uintptr_t)lp >> 3) * 0x9e3779b1U);
+}
+
+/*
+ * Fill in "ti" for the table "lp"; if memory is short, leave it a
+ * linear scan.
+ */
+static void
+tok_index_build(struct tok_index *ti, const struct tok *lp)
+{
+	const struct tok *p;
+	struct tok_sortent *ents;
+	u_int n, i, j, lo, hi;
+
+	ti->table = lp;
+	ti->kind = TOK_LINEAR;
+	lo = hi = lp->v;
+	for (p = lp, n = 0; p->s != NULL; p++, n++) {
+		if (p->v < lo)
+			lo = p->v;
+		if (p->v > hi)
+			hi = p->v;
+	}
+	if (n < TOK_INDEX_MIN)
+		return;
+
+	if (hi - lo < TOK_DENSE_MAX && hi - lo < 4 * n) {
+		ti->map = (const char **)calloc(hi - lo + 1,
+		    sizeof(*ti->map));
+		if (ti->map == NULL)
+			return;
+		for (p = lp; p->s != NULL; p++)
+			if (ti->map[p->v - lo] == NULL)
+				ti->map[p->v - lo] = p->s;
+		ti->base = lo;
+		ti->n = hi - lo + 1;
+		ti->kind = TOK_DENSE;
+		return;
+	}
+
+	ents = (struct tok_sortent *)malloc(n * sizeof(*ents));
+	if (ents == NULL)
+		return;
+	for (i = 0; i < n; i++) {
+		ents[i].v = lp[i].v;
+		ents[i].pos = i;
+		ents[i].s = lp[i].s;
+	}
+	qsort(ents, n, sizeof(*ents), tok_sortent_cmp);
+	ti->sorted = (struct tok *)malloc(n * sizeof(*ti->sorted));
+	if (ti->sorted == NULL) {
+		free(ents);
+		return;
+	}
+	for (i = j = 0; i < n; i++) {
+		if (j != 0 && ti->sorted[j - 1].v == ents[i].v)
+			continue;
+		ti->sorted[j].v = ents[i].v;
+		ti->sorted[j].s = ents[i].s;
+		j++;
+	}
+	free(ents);
+	ti->n = j;
+	ti->kind = TOK_SORTED;
+}
+
+/*
+ * Return the index for "lp", building it if need be, or NULL if there
+ * isn't room to keep one.
+ */
+static const struct tok_index *
+tok_index_get(const struct tok *lp)
+{
+	struct tok_index *ti;
+	u_int i, mask;
+
+	if (tok_indexes_used * 2 >= tok_indexes_size) {
+		struct tok_index *nt;
+		u_int nsize = tok_indexes_size ? tok_indexes_size * 2 : 256;
+
+		nt = (struct tok_index *)calloc(nsize, sizeof(*nt));
+		if (nt == NULL)
+			return (NULL);
+		for (i = 0; i < tok_indexes_size; i++) {
+			u_int k;
+
+			if (tok_indexes[i].table == NULL)
+				continue;
+			k = tok_index_hash(tok_indexes[i].table) & (nsize - 1);
+			while (nt[k].table != NULL)
+				k = (k + 1) & (nsize - 1);
+			nt[k] = tok_indexes[i];
+		}
+		free(tok_indexes);
+		tok_indexes = nt;
+		tok_indexes_size = nsize;
+	}
+
+	mask = tok_indexes_size - 1;
+	for (i = tok_index_hash(lp) & mask; ; i = (i + 1) & mask) {
+		ti = &tok_indexes[i];
+		if (ti->table == lp)
+			return (ti);
+		if (ti->table == NULL)
+			break;
+	}
+	tok_index_build(ti, lp);
+	tok_indexes_used++;
+	return (ti);
+}
+
 /*
  * Convert a token value to a string; use "fmt" if not found.
  */
@@ -498,11 +794,31 @@ const char *
 tok2strbuf(const struct tok *lp, const char *fmt,
 	   u_int v, char *buf, size_t bufsize)
 {
-	if (lp != NULL) {
-		while (lp->s != NULL) {
-			if (lp->v == v)
-				return (lp->s);
-			++lp;
+	if (lp != NULL && lp->s != NULL) {
+		const struct tok_index *ti = tok_index_get(lp);
+
+		if (ti == NULL || ti->kind == TOK_LINEAR) {
+			while (lp->s != NULL) {
+				if (lp->v == v)
+					return (lp->s);
+				++lp;
+			}
+		} else if (ti->kind == TOK_DENSE) {
+			if (v - ti->base < ti->n && ti->map[v - ti->base] != NULL)
+				return (ti->map[v - ti->base]);
+		} else {
+			u_int lo = 0, hi = ti->n;
+
+			while (lo < hi) {
+				u_int mid = lo + (hi - lo) / 2;
+
+				if (ti->sorted[mid].v < v)
+					lo = mid + 1;
+				else
+					hi = mid;
+			}
+			if (lo < ti->n && ti->sorted[lo].v == v)
+				return (ti->sorted[lo].s);
 		}
 	}
 	if (fmt == NULL)
@@ -521,8 +837,8 @@ const char *
 tok2str(const struct tok *lp, const char *fmt,
 	u_int v)
 {
-	static char buf[4][TOKBUFSIZE];
-	static int idx = 0;
+	static ND_THREAD_LOCAL char buf[4][TOKBUFSIZE];
+	static ND_THREAD_LOCAL int idx = 0;
 	char *ret;
 
 	ret = buf[idx];
@@ -531,59 +847,63 @@ tok2str(const struct tok *lp, const char *fmt,
 }
 
 /*
- * Convert a bit token value to a string; use "fmt" if not found.
+ * Convert a bit token value to a string in "buf"; use "fmt" if not found.
  * this is useful for parsing bitfields, the output strings are separated
- * if the s field is positive.
+ * by "sep".
  */
-static char *
-bittok2str_internal(const struct tok *lp, const char *fmt,
-	   u_int v, const char *sep)
+char *
+bittok2strbuf(const struct tok *lp, const char *fmt,
+	   u_int v, const char *sep, char *buf, size_t bufsize)
 {
-        static char buf[1024+1]; /* our string buffer */
         char *bufp = buf;
-        size_t space_left = sizeof(buf), string_size;
-        u_int rotbit; /* this is the bit we rotate through all bitpositions */
+        size_t space_left = bufsize, string_size;
         u_int tokval;
         const char * sepstr = "";
 
 	while (lp != NULL && lp->s != NULL) {
             tokval=lp->v;   /* load our first value */
-            rotbit=1;
-            while (rotbit != 0) {
-                /*
-                 * lets AND the rotating bit with our token value
-                 * and see if we have got a match
-                 */
-		if (tokval == (v&rotbit)) {
-                    /* ok we have found something */
-                    if (space_left <= 1)
-                        return (buf); /* only enough room left for NUL, if that */
-                    string_size = strlcpy(bufp, sepstr, space_left);
-                    if (string_size >= space_left)
-                        return (buf);    /* we ran out of room */
-                    bufp += string_size;
-                    space_left -= string_size;
-                    if (space_left <= 1)
-                        return (buf); /* only enough room left for NUL, if that */
-                    string_size = strlcpy(bufp, lp->s, space_left);
-                    if (string_size >= space_left)
-                        return (buf);    /* we ran out of room */
-                    bufp += string_size;
-                    space_left -= string_size;
-                    sepstr = sep;
-                    break;
-                }
-                rotbit=rotbit<<1; /* no match - lets shift and try again */
+            /*
+             * A token matches if it equals (v & bit) for some single
+             * bit: a zero token matches if any bit of v is clear, any
+             * other token must be one of the bits set in v.
+             */
+            if (tokval == 0 ? v != 0xffffffff :
+                ((tokval & (tokval - 1)) == 0 && (v & tokval) != 0)) {
+                /* ok we have found something */
+                if (space_left <= 1)
+                    return (buf); /* only enough room left for NUL, if that */
+                string_size = strlcpy(bufp, sepstr, space_left);
+                if (string_size >= space_left)
+                    return (buf);    /* we ran out of room */
+                bufp += string_size;
+                space_left -= string_size;
+                if (space_left <= 1)
+                    return (buf); /* only enough room left for NUL, if that */
+                string_size = strlcpy(bufp, lp->s, space_left);
+                if (string_size >= space_left)
+                    return (buf);    /* we ran out of room */
+                bufp += string_size;
+                space_left -= string_size;
+                sepstr = sep;
             }
             lp++;
 	}
 
         if (bufp == buf)
             /* bummer - lets print the "unknown" message as advised in the fmt string if we got one */
-            (void)snprintf(buf, sizeof(buf), fmt == NULL ? "#%08x" : fmt, v);
+            (void)snprintf(buf, bufsize, fmt == NULL ? "#%08x" : fmt, v);
         return (buf);
 }
 
+static char *
+bittok2str_internal(const struct tok *lp, const char *fmt,
+	   u_int v, const char *sep)
+{
+        static ND_THREAD_LOCAL char buf[1024+1]; /* our string buffer */
+
+        return (bittok2strbuf(lp, fmt, v, sep, buf, sizeof(buf)));
+}
+
 /*
  * Convert a bit token value to a string; use "fmt" if not found.
  * this is useful for parsing bitfields, the output strings are not separated.
@@ -616,7 +936,7 @@ const char *
 tok2strary_internal(const char **lp, int n, const char *fmt,
 	int v)
 {
-	static char buf[TOKBUFSIZE];
+	static ND_THREAD_LOCAL char buf[TOKBUFSIZE];
 
 	if (v >= 0 && v < n && lp[v] != NULL)
 		return lp[v];
@@ -704,14 +1024,20 @@ fetch_token(netdissect_options *ndo, const u_char *pptr, u_int idx, u_int len,
     u_char *tbuf, size_t tbuflen)
 {
 	size_t toklen = 0;
+	u_int caplen;
 	u_char c;
 
+	/*
+	 * Check the bounds once, and look at the captured bytes
+	 * directly, rather than a byte at a time.
+	 */
+	caplen = (ndo->ndo_snapend > pptr) ? ND_BYTES_AVAILABLE_AFTER(pptr) : 0;
 	for (; idx < len; idx++) {
-		if (!ND_TTEST_1(pptr + idx)) {
+		if (idx >= caplen) {
 			/* ran past end of captured data */
 			return (0);
 		}
-		c = GET_U_1(pptr + idx);
+		c = pptr[idx];
 		if (!ND_ISASCII(c)) {
 			/* not an ASCII character */
 			return (0);
@@ -741,24 +1067,13 @@ fetch_token(netdissect_options *ndo, const u_char *pptr, u_int idx, u_int len,
 	 * Skip past any white space after the token, until we see
 	 * an end-of-line (CR or LF).
 	 */
-	for (; idx < len; idx++) {
-		if (!ND_TTEST_1(pptr + idx)) {
-			/* ran past end of captured data */
-			break;
-		}
-		c = GET_U_1(pptr + idx);
-		if (c == '\r' || c == '\n') {
-			/* end of line */
-			break;
-		}
-		if (!ND_ASCII_ISPRINT(c)) {
-			/* not a printable ASCII character */
-			break;
-		}
-		if (c != ' ' && c != '\t' && c != '\r' && c != '\n') {
-			/* beginning of next token */
-			break;
-		}
+	while (idx < len && idx < caplen && pptr[idx] == ' ') {
+		/*
+		 * Anything else is the end of the line, the beginning
+		 * of the next token or not a printable ASCII character;
+		 * a tab isn't printable.
+		 */
+		idx++;
 	}
 	return (idx);
 }
@@ -775,60 +1090,66 @@ print_txt_line(netdissect_options *ndo, const char *prefix,
 {
 	u_int startidx;
 	u_int linelen;
+	u_int caplen, end;
 	u_char c;
 
+	/*
+	 * Find the end of the captured part of the line once, and
+	 * then just look for the first byte that isn't printable
+	 * ASCII or a tab; a line is almost all of those.
+	 */
+	caplen = (ndo->ndo_snapend > pptr) ? ND_BYTES_AVAILABLE_AFTER(pptr) : 0;
+	end = len < caplen ? len : caplen;
 	startidx = idx;
-	while (idx < len) {
-		ND_TCHECK_1(pptr + idx);
-		c = GET_U_1(pptr + idx);
-		if (c == '\n') {
-			/*
-			 * LF without CR; end of line.
-			 * Skip the LF and print the line, with the
-			 * exception of the LF.
-			 */
-			linelen = idx - startidx;
-			idx++;
-			goto print;
-		} else if (c == '\r') {
-			/* CR - any LF? */
-			if ((idx+1) >= len) {
-				/* not in this packet */
-				return (0);
-			}
-			ND_TCHECK_1(pptr + idx + 1);
-			if (GET_U_1(pptr + idx + 1) == '\n') {
-				/*
-				 * CR-LF; end of line.
-				 * Skip the CR-LF and print the line, with
-				 * the exception of the CR-LF.
-				 */
-				linelen = idx - startidx;
-				idx += 2;
-				goto print;
-			}
+	while (idx < end &&
+	    (ND_ASCII_ISPRINT(pptr[idx]) || pptr[idx] == '\t'))
+		idx++;
+	if (idx >= end) {
+		/*
+		 * All printable ASCII, but no line ending after that
+		 * point in the buffer or in the captured data; treat
+		 * this as if it were truncated.
+		 */
+		goto trunc;
+	}
 
-			/*
-			 * CR followed by something else; treat this
-			 * as if it were binary data, and don't print
-			 * it.
-			 */
+	c = pptr[idx];
+	if (c == '\n') {
+		/*
+		 * LF without CR; end of line.
+		 * Skip the LF and print the line, with the
+		 * exception of the LF.
+		 */
+		linelen = idx - startidx;
+		idx++;
+		goto print;
+	} else if (c == '\r') {
+		/* CR - any LF? */
+		if ((idx+1) >= len) {
+			/* not in this packet */
 			return (0);
-		} else if (!ND_ASCII_ISPRINT(c) && c != '\t') {
+		}
+		if ((idx+1) >= caplen)
+			goto trunc;
+		if (pptr[idx + 1] == '\n') {
 			/*
-			 * Not a printable ASCII character and not a tab;
-			 * treat this as if it were binary data, and
-			 * don't print it.
+			 * CR-LF; end of line.
+			 * Skip the CR-LF and print the line, with
+			 * the exception of the CR-LF.
 			 */
-			return (0);
+			linelen = idx - startidx;
+			idx += 2;
+			goto print;
 		}
-		idx++;
 	}
 
 	/*
-	 * All printable ASCII, but no line ending after that point
-	 * in the buffer; treat this as if it were truncated.
+	 * CR followed by something else, or not a printable ASCII
+	 * character and not a tab; treat this as if it were binary
+	 * data, and don't print it.
 	 */
+	return (0);
+
 trunc:
 	linelen = idx - startidx;
 	ND_PRINT("%s%.*s", prefix, (int)linelen, pptr + startidx);
@@ -0,0 +1,204 @@
+/*
+ * Copyright (c) 2026 The TCPDUMP project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that: (1) source code
+ * distributions retain the above copyright notice and this paragraph
+ * in its entirety, and (2) distributions including binary code include
+ * the above copyright notice and this paragraph in its entirety in
+ * the documentation or other materials provided with the distribution.
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND
+ * WITHOUT ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, WITHOUT
+ * LIMITATION, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE.
+ */
+
+
+/*
+ * The state for --v2x-stations is kept for each station, a
+ * GeoNetworking one by the GN address in the source position vector of
+ * its packets, which beacons carry even when they carry nothing else,
+ * and a CALM FAST one by the link-layer address it sends from.  A
+ * station's peak rate is the most messages in one second of packet
+ * time, and its longest gap how long it was silent; a beacon sender
+ * whose gap is much longer than its beacon interval lost some.
+ *
+ * The stations are allocated as they're first heard from, on hash
+ * chains and on a list in that order; v2x_station_expire() frees those
+ * that have gone quiet, so that a roadside unit's table holds the
+ * vehicles in range, not all those that ever passed.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include "netdissect-stdinc.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "netdissect.h"
+#include "v2x-stations.h"
+
+#define V2X_CHAINS	4096
+#define V2X_ADDR_LEN	8		/* the longer, a GN address */
+
+struct v2x_station {
+	struct v2x_station_stats stats;
+	u_int kind;			/* V2X_GEONET or V2X_CALM_FAST */
+	u_char addr[V2X_ADDR_LEN];	/* a MAC address in the first 6 */
+	uint64_t second;		/* the second "in_second" were in */
+	u_int in_second;
+	char name[5 + V2X_ADDR_LEN * 3];
+	struct v2x_station *next;	/* on its hash chain */
+	struct v2x_station *prev_seen;	/* on the list in the order seen */
+	struct v2x_station *next_seen;
+};
+
+static ND_THREAD_LOCAL struct v2x_station **v2x_chains;
+static ND_THREAD_LOCAL struct v2x_station *v2x_first, *v2x_last;
+
+static uint32_t
+v2x_hash(u_int kind, const u_char *addr)
+{
+	uint32_t h = 2166136261U;
+	u_int i;
+
+	h = (h ^ kind) * 16777619U;
+	for (i = 0; i < V2X_ADDR_LEN; i++)
+		h = (h ^ addr[i]) * 16777619U;
+	return (h);
+}
+
+/*
+ * Find the station, or start one.
+ */
+static struct v2x_station *
+v2x_find(netdissect_options *ndo, u_int kind, const u_char *addr)
+{
+	struct v2x_station *s, **sp;
+	u_char key[V2X_ADDR_LEN];
+	u_int alen, i;
+	char *cp;
+
+	memset(key, 0, sizeof(key));
+	alen = kind == V2X_GEONET ? V2X_ADDR_LEN : MAC_ADDR_LEN;
+	memcpy(key, addr, alen);
+	if (v2x_chains == NULL) {
+		v2x_chains = (struct v2x_station **)calloc(V2X_CHAINS,
+		    sizeof(*v2x_chains));
+		if (v2x_chains == NULL)
+			(*ndo->ndo_error)(ndo, S_ERR_ND_MEM_ALLOC,
+			    "%s: calloc", __func__);
+	}
+	sp = &v2x_chains[v2x_hash(kind, key) % V2X_CHAINS];
+	for (s = *sp; s != NULL; s = s->next)
+		if (s->kind == kind && memcmp(s->addr, key, sizeof(key)) == 0)
+			return (s);
+
+	s = (struct v2x_station *)calloc(1, sizeof(*s));
+	if (s == NULL)
+		(*ndo->ndo_error)(ndo, S_ERR_ND_MEM_ALLOC, "%s: calloc",
+		    __func__);
+	s->kind = kind;
+	memcpy(s->addr, key, sizeof(key));
+	cp = s->name;
+	cp += snprintf(cp, sizeof(s->name), "%s ",
+	    kind == V2X_GEONET ? "gn" : "calm");
+	for (i = 0; i < alen; i++)
+		cp += snprintf(cp, sizeof(s->name) - (cp - s->name),
+		    i == 0 ? "%02x" : ":%02x", key[i]);
+	s->stats.vss_station = s->name;
+	s->next = *sp;
+	*sp = s;
+	s->prev_seen = v2x_last;
+	if (v2x_last != NULL)
+		v2x_last->next_seen = s;
+	else
+		v2x_first = s;
+	v2x_last = s;
+	return (s);
+}
+
+struct v2x_station_stats *
+v2x_station_count(netdissect_options *ndo, u_int kind, const u_char *addr)
+{
+	struct v2x_station *s;
+	struct v2x_station_stats *st;
+	uint64_t now;
+
+	s = v2x_find(ndo, kind, addr);
+	st = &s->stats;
+	now = (uint64_t)ND_TS_USEC(ndo->ndo_packet_ts);
+	if (st->vss_messages++ == 0)
+		st->vss_first_us = now;
+	else if (now > st->vss_last_us &&
+	    now - st->vss_last_us > st->vss_max_gap_us)
+		st->vss_max_gap_us = now - st->vss_last_us;
+	st->vss_last_us = now;
+	st->vss_recent++;
+	if (st->vss_messages == 1 ||
+	    ndo->ndo_packet_sec != (time_t)s->second) {
+		s->second = ndo->ndo_packet_sec;
+		s->in_second = 0;
+	}
+	if (++s->in_second > st->vss_peak)
+		st->vss_peak = s->in_second;
+	return (st);
+}
+
+void
+v2x_station_position(struct v2x_station_stats *st, int32_t lat,
+    int32_t lon)
+{
+	if (st->vss_have_position &&
+	    (lat != st->vss_lat || lon != st->vss_lon))
+		st->vss_moves++;
+	st->vss_have_position = 1;
+	st->vss_lat = lat;
+	st->vss_lon = lon;
+}
+
+void
+v2x_station_foreach(v2x_station_fn fn, void *arg)
+{
+	struct v2x_station *s;
+
+	for (s = v2x_first; s != NULL; s = s->next_seen)
+		(*fn)(arg, &s->stats);
+}
+
+/*
+ * Take out the stations that haven't been heard from since "before",
+ * in microseconds, and start counting the recent messages of the
+ * others again.
+ */
+void
+v2x_station_expire(uint64_t before)
+{
+	struct v2x_station *s, *next, **sp;
+
+	for (s = v2x_first; s != NULL; s = next) {
+		next = s->next_seen;
+		if (s->stats.vss_last_us >= before) {
+			s->stats.vss_recent = 0;
+			continue;
+		}
+		sp = &v2x_chains[v2x_hash(s->kind, s->addr) % V2X_CHAINS];
+		while (*sp != s)
+			sp = &(*sp)->next;
+		*sp = s->next;
+		if (s->prev_seen != NULL)
+			s->prev_seen->next_seen = s->next_seen;
+		else
+			v2x_first = s->next_seen;
+		if (s->next_seen != NULL)
+			s->next_seen->prev_seen = s->prev_seen;
+		else
+			v2x_last = s->prev_seen;
+		free(s);
+	}
+}
@@ -0,0 +1,41 @@
+/*
+ * Copyright (c) 2026 The TCPDUMP project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that: (1) source code
+ * distributions retain the above copyright notice and this paragraph
+ * in its entirety, and (2) distributions including binary code include
+ * the above copyright notice and this paragraph in its entirety in
+ * the documentation or other materials provided with the distribution.
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND
+ * WITHOUT ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, WITHOUT
+ * LIMITATION, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE.
+ */
+
+
+#ifndef v2x_stations_h
+#define v2x_stations_h
+
+/*
+ * --v2x-stations: a table of the GeoNetworking stations, by GN address,
+ * and CALM FAST ones, by link-layer address, with how many messages
+ * each has sent and how fast, and where it last said it was.
+ * v2x_station_count() counts a message from the station with the
+ * address at "addr", the 8-byte GN address for V2X_GEONET and the MAC
+ * address for V2X_CALM_FAST, and returns its counters, for the printer
+ * to add what kind of message it was; v2x_station_position() records the position
+ * in a GeoNetworking long position vector.  The stations are kept in
+ * the order first heard from until v2x_station_expire() takes out
+ * those that have gone.
+ */
+#define V2X_GEONET	0
+#define V2X_CALM_FAST	1
+
+extern struct v2x_station_stats *v2x_station_count(netdissect_options *,
+    u_int, const u_char *);
+extern void v2x_station_position(struct v2x_station_stats *, int32_t,
+    int32_t);
+
+#endif /* v2x_stations_h */
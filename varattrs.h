@@ -56,4 +56,46 @@
   #define _U_
 #endif
 
+/*
+ * Storage class for the caches and scratch buffers that the dissectors
+ * keep in static variables, so that each thread dissecting packets has
+ * its own copy; ND_NO_THREAD_LOCAL is defined if we don't know how to
+ * do that, in which case only one thread may dissect packets.
+ */
+#if defined(__STDC_VERSION__) && __STDC_VERSION__ >= 201112L
+  #define ND_THREAD_LOCAL _Thread_local
+#elif defined(_MSC_VER)
+  #define ND_THREAD_LOCAL __declspec(thread)
+#elif ND_IS_AT_LEAST_GNUC_VERSION(3,3) || defined(__clang__) \
+    || ND_IS_AT_LEAST_SUNC_VERSION(5,9)
+  #define ND_THREAD_LOCAL __thread
+#else
+  #define ND_THREAD_LOCAL
+  #define ND_NO_THREAD_LOCAL
+#endif
+
+/*
+ * ND_PREFETCH(p) asks for the cache line holding what p points to to be
+ * fetched, to be read soon; it does nothing if the compiler has no way
+ * to ask.
+ */
+#if ND_IS_AT_LEAST_GNUC_VERSION(3,1) || defined(__clang__)
+  #define ND_PREFETCH(p) __builtin_prefetch((p), 0, 3)
+#else
+  #define ND_PREFETCH(p) ((void)(p))
+#endif
+
+/*
+ * ND_ALIGNED(n), between "struct" and the tag, has the structure start
+ * on an n-byte boundary, e.g. a cache line; it does nothing if the
+ * compiler has no way to ask.
+ */
+#if ND_IS_AT_LEAST_GNUC_VERSION(2,7) || defined(__clang__)
+  #define ND_ALIGNED(n) __attribute__((aligned(n)))
+#elif defined(_MSC_VER)
+  #define ND_ALIGNED(n) __declspec(align(n))
+#else
+  #define ND_ALIGNED(n)
+#endif
+
 #endif